@@ -0,0 +1,531 @@
+/**
+ * @file ac_bench.c
+ * @brief Benchmark driver: repeated runs, JSON results, baseline diff
+ *
+ * Runs the registered suites (the bench_* programs next to it, each in
+ * its JSON mode) several times, flattens every case metric to a key
+ * "suite/case/metric", and writes the median and MAD (median absolute
+ * deviation) of each to a results file. Given a baseline written the
+ * same way, it prints the metrics that moved.
+ *
+ * A metric counts as changed when its median moved by more than -t
+ * percent (5) and by more than -k (3) robust standard deviations of the
+ * two runs together (1.4826 * MAD, combined in quadrature), so a noisy
+ * case needs a larger move to be reported. Changes in the metric's bad
+ * direction are regressions and set the exit status to 2.
+ *
+ * Usage: ac_bench [-s suite,...] [-n repeat] [-o results.json]
+ *                 [-b baseline.json] [-t pct] [-k sigmas] [-a] [-l] [-v]
+ *
+ * Typical use: save a baseline on the main branch, then compare a change
+ * against it:
+ *
+ *   ac_bench -o base.json
+ *   ac_bench -b base.json
+ */
+
+#include "cJSON.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef ARC_BENCH_DATA_DIR
+#define ARC_BENCH_DATA_DIR "data"
+#endif
+
+#define MAX_REPEAT   64
+
+/*============================================================================
+ * Suites
+ *============================================================================*/
+
+typedef struct {
+    const char *name;
+    const char *binary;
+    const char *args;                /* JSON output at the driver's run length */
+    const char *array;               /* Member holding the cases */
+    const char *keys;                /* Members naming a case */
+    const char *metrics;             /* Compared: +name higher is better, -name lower */
+} suite_t;
+
+static const suite_t s_suites[] = {
+    { "parsers", "bench_parsers", "-j '" ARC_BENCH_DATA_DIR "' 200", "cases", "name",
+      "-ns_per_op,-allocs_per_op" },
+    { "markdown", "bench_markdown", "-j '" ARC_BENCH_DATA_DIR "' 200", "cases", "name",
+      "-ns_per_op,-allocs_per_op" },
+    { "core", "bench_core", "200", "cases", "name",
+      "-ns_per_op,-allocs_per_op,-heap_peak" },
+    { "agent", "bench_agent", "-j -r 10", "variants", "name",
+      "+iter_per_s,-cpu_us_per_iter,-allocs_per_iter,-overhead_p50_us,-overhead_p99_us" },
+    { "pool", "bench_pool", "-j -d 300 -t 1,8 -c 4", "cells", "threads,connections",
+      "+ops_per_s,+fairness" },
+    { "stream", "bench_stream", "-j -d 2 -r 200,800", "cases", "name",
+      "-line_p99_ms,-cb_p99_us" },
+};
+
+#define SUITE_COUNT ((int)(sizeof(s_suites) / sizeof(s_suites[0])))
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+
+static struct {
+    int selected[SUITE_COUNT];
+    int repeat;
+    const char *output;
+    const char *baseline;
+    double threshold_pct;
+    double sigmas;
+    int all;
+    int verbose;
+    char dir[1024];                  /* Where the suite programs are */
+} s_cfg = {
+    .repeat = 5,
+    .output = "ac_bench_results.json",
+    .threshold_pct = 5.0,
+    .sigmas = 3.0,
+};
+
+/*============================================================================
+ * Metrics
+ *============================================================================*/
+
+typedef struct {
+    char key[192];
+    int higher;                      /* 1 = higher is better */
+    double samples[MAX_REPEAT];
+    int count;
+    double median;
+    double mad;
+} metric_t;
+
+static metric_t *s_metrics;
+static int s_metric_count;
+
+static metric_t *metric_get(const char *key, int higher) {
+    for (int i = 0; i < s_metric_count; i++) {
+        if (strcmp(s_metrics[i].key, key) == 0) {
+            return &s_metrics[i];
+        }
+    }
+    metric_t *grown = realloc(s_metrics, (size_t)(s_metric_count + 1) * sizeof(metric_t));
+    if (!grown) {
+        return NULL;
+    }
+    s_metrics = grown;
+    metric_t *m = &s_metrics[s_metric_count++];
+    memset(m, 0, sizeof(*m));
+    snprintf(m->key, sizeof(m->key), "%s", key);
+    m->higher = higher;
+    return m;
+}
+
+static int by_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double median_of(double *v, int n) {
+    qsort(v, (size_t)n, sizeof(double), by_double);
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+static void metric_finish(metric_t *m) {
+    double v[MAX_REPEAT];
+    memcpy(v, m->samples, (size_t)m->count * sizeof(double));
+    m->median = median_of(v, m->count);
+    for (int i = 0; i < m->count; i++) {
+        v[i] = fabs(m->samples[i] - m->median);
+    }
+    m->mad = median_of(v, m->count);
+}
+
+/** Whether the comma-separated list has the name (of length len) */
+static const char *list_find(const char *list, const char *name, size_t len) {
+    for (const char *p = list; *p;) {
+        const char *end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        const char *item = (*p == '+' || *p == '-') ? p + 1 : p;
+        size_t ilen = n - (size_t)(item - p);
+        if (ilen == len && strncmp(item, name, len) == 0) {
+            return p;
+        }
+        p = end ? end + 1 : p + n;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Case label from the suite's key members ("sse_parse", "4x8")
+ */
+static void case_label(const suite_t *suite, const cJSON *item, char *out, size_t size) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (const char *p = suite->keys; *p;) {
+        const char *end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        char name[64];
+        snprintf(name, sizeof(name), "%.*s", (int)n, p);
+        const cJSON *v = cJSON_GetObjectItem(item, name);
+        int w = 0;
+        if (cJSON_IsString(v)) {
+            w = snprintf(out + used, size - used, "%s%s", used ? "x" : "", v->valuestring);
+        } else if (cJSON_IsNumber(v)) {
+            w = snprintf(out + used, size - used, "%s%g", used ? "x" : "", v->valuedouble);
+        }
+        if (w > 0 && (size_t)w < size - used) {
+            used += (size_t)w;
+        }
+        p = end ? end + 1 : p + n;
+    }
+}
+
+/**
+ * @brief Add one run's output of a suite to the samples
+ *
+ * @return Cases read, -1 when the output is not the suite's JSON
+ */
+static int collect(const suite_t *suite, const char *output) {
+    cJSON *root = cJSON_Parse(output);
+    const cJSON *cases = cJSON_GetObjectItem(root, suite->array);
+    if (!cJSON_IsArray(cases)) {
+        cJSON_Delete(root);
+        return -1;
+    }
+    int count = 0;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, cases) {
+        char label[96];
+        case_label(suite, item, label, sizeof(label));
+        const cJSON *field;
+        cJSON_ArrayForEach(field, item) {
+            const char *spec = list_find(suite->metrics, field->string, strlen(field->string));
+            if (!spec || !cJSON_IsNumber(field)) {
+                continue;
+            }
+            char key[192];
+            snprintf(key, sizeof(key), "%s/%s/%s", suite->name, label, field->string);
+            metric_t *m = metric_get(key, *spec == '+');
+            if (m && m->count < MAX_REPEAT) {
+                m->samples[m->count++] = field->valuedouble;
+            }
+        }
+        count++;
+    }
+    cJSON_Delete(root);
+    return count;
+}
+
+/*============================================================================
+ * Runs
+ *============================================================================*/
+
+static char *run_capture(const char *cmd, int *status) {
+    FILE *p = popen(cmd, "r");
+    if (!p) {
+        *status = -1;
+        return NULL;
+    }
+    size_t len = 0, cap = 4096;
+    char *out = malloc(cap);
+    size_t n;
+    while (out && (n = fread(out + len, 1, cap - len - 1, p)) > 0) {
+        len += n;
+        if (cap - len < 1024) {
+            char *grown = realloc(out, cap * 2);
+            if (!grown) {
+                free(out);
+                out = NULL;
+                break;
+            }
+            out = grown;
+            cap *= 2;
+        }
+    }
+    if (out) {
+        out[len] = '\0';
+    }
+    *status = pclose(p);
+    return out;
+}
+
+/** @return 0 on success, 1 when the program is not built, -1 when it failed */
+static int run_suite(const suite_t *suite) {
+    char path[1200];
+    snprintf(path, sizeof(path), "%s/%s", s_cfg.dir, suite->binary);
+    if (access(path, X_OK) != 0) {
+        return 1;
+    }
+    char cmd[1600];
+    snprintf(cmd, sizeof(cmd), "'%s' %s%s", path, suite->args,
+             s_cfg.verbose ? "" : " 2>/dev/null");
+
+    int tty = isatty(STDERR_FILENO);
+    for (int r = 0; r < s_cfg.repeat; r++) {
+        if (tty) {
+            fprintf(stderr, "\r%-10s run %d/%d", suite->name, r + 1, s_cfg.repeat);
+        }
+        int status;
+        char *out = run_capture(cmd, &status);
+        int cases = out && status == 0 ? collect(suite, out) : -1;
+        free(out);
+        if (cases < 0) {
+            fprintf(stderr, "%s%-10s run %d failed (status %d)\n", tty ? "\r" : "", suite->name,
+                    r + 1, status);
+            return -1;
+        }
+    }
+    fprintf(stderr, "%s%-10s %d runs%12s\n", tty ? "\r" : "", suite->name, s_cfg.repeat, "");
+    return 0;
+}
+
+/*============================================================================
+ * Results and Baseline
+ *============================================================================*/
+
+static int write_results(const char *path, const char *ran) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return -1;
+    }
+    fprintf(f, "{\"ac_bench\":1,\"repeat\":%d,\"suites\":\"%s\",\"metrics\":{", s_cfg.repeat, ran);
+    for (int i = 0; i < s_metric_count; i++) {
+        const metric_t *m = &s_metrics[i];
+        fprintf(f, "%s\n  \"%s\":{\"median\":%.6g,\"mad\":%.6g,\"better\":\"%s\",\"samples\":[",
+                i ? "," : "", m->key, m->median, m->mad, m->higher ? "higher" : "lower");
+        for (int k = 0; k < m->count; k++) {
+            fprintf(f, "%s%.6g", k ? "," : "", m->samples[k]);
+        }
+        fprintf(f, "]}");
+    }
+    fprintf(f, "\n}}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static cJSON *load_baseline(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = size > 0 ? malloc((size_t)size + 1) : NULL;
+    cJSON *root = NULL;
+    if (data && fread(data, 1, (size_t)size, f) == (size_t)size) {
+        data[size] = '\0';
+        root = cJSON_Parse(data);
+    }
+    free(data);
+    fclose(f);
+    if (root && !cJSON_IsObject(cJSON_GetObjectItem(root, "metrics"))) {
+        cJSON_Delete(root);
+        root = NULL;
+    }
+    return root;
+}
+
+static double number(const cJSON *obj, const char *key) {
+    const cJSON *v = cJSON_GetObjectItem(obj, key);
+    return cJSON_IsNumber(v) ? v->valuedouble : 0.0;
+}
+
+/** Whether the key belongs to a suite that ran this time */
+static int key_ran(const char *key) {
+    for (int i = 0; i < SUITE_COUNT; i++) {
+        size_t n = strlen(s_suites[i].name);
+        if (s_cfg.selected[i] == 2 && strncmp(key, s_suites[i].name, n) == 0 && key[n] == '/') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Print the metrics that moved against the baseline
+ *
+ * @return Number of regressions
+ */
+static int compare(const cJSON *baseline) {
+    const cJSON *base = cJSON_GetObjectItem(baseline, "metrics");
+    int regressed = 0, improved = 0, same = 0, added = 0, gone = 0;
+
+    printf("%-64s %12s %12s %8s %7s  %s\n", "metric", "baseline", "current", "delta%", "noise%",
+           "");
+    for (int i = 0; i < s_metric_count; i++) {
+        const metric_t *m = &s_metrics[i];
+        const cJSON *b = cJSON_GetObjectItem(base, m->key);
+        if (!b) {
+            added++;
+            if (s_cfg.all) {
+                printf("%-64.64s %12s %12.4g %8s %7s  new\n", m->key, "-", m->median, "-", "-");
+            }
+            continue;
+        }
+        double bm = number(b, "median"), bmad = number(b, "mad");
+        double diff = m->median - bm;
+        double noise = s_cfg.sigmas * 1.4826 * sqrt(m->mad * m->mad + bmad * bmad);
+        double rel = bm != 0.0 ? 100.0 * diff / fabs(bm) : (diff != 0.0 ? INFINITY : 0.0);
+        double noise_pct = bm != 0.0 ? 100.0 * noise / fabs(bm) : 0.0;
+        const char *verdict = "";
+        if (fabs(diff) > noise && fabs(rel) >= s_cfg.threshold_pct) {
+            int better = m->higher ? diff > 0 : diff < 0;
+            verdict = better ? "improved" : "REGRESSED";
+            better ? improved++ : regressed++;
+        } else {
+            same++;
+        }
+        if (*verdict || s_cfg.all) {
+            printf("%-64.64s %12.4g %12.4g %+8.1f %7.1f  %s\n", m->key, bm, m->median, rel,
+                   noise_pct, verdict);
+        }
+    }
+    const cJSON *b;
+    cJSON_ArrayForEach(b, base) {
+        int found = 0;
+        for (int i = 0; i < s_metric_count && !found; i++) {
+            found = strcmp(s_metrics[i].key, b->string) == 0;
+        }
+        if (!found && key_ran(b->string)) {
+            gone++;
+            if (s_cfg.all) {
+                printf("%-64.64s %12.4g %12s %8s %7s  gone\n", b->string, number(b, "median"),
+                       "-", "-", "-");
+            }
+        }
+    }
+    printf("\n%d regressed, %d improved, %d unchanged, %d new, %d gone "
+           "(threshold %.1f%%, %.1f sigma)\n", regressed, improved, same, added, gone,
+           s_cfg.threshold_pct, s_cfg.sigmas);
+    return regressed;
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n\n"
+           "  -s <name,...>  Suites to run (default all built; -l lists them)\n"
+           "  -n <runs>      Runs per suite (default 5, max %d)\n"
+           "  -o <file>      Results file (default ac_bench_results.json)\n"
+           "  -b <file>      Baseline results to compare against\n"
+           "  -t <pct>       Smallest change reported (default 5)\n"
+           "  -k <sigmas>    Change must exceed this many robust deviations (default 3)\n"
+           "  -d <dir>       Directory of the bench programs (default: next to %s)\n"
+           "  -a             Show every metric in the comparison\n"
+           "  -l             List the suites\n"
+           "  -v             Show the suites' stderr\n"
+           "  -h             Show this help message\n\n"
+           "Exit status: 0, 1 on errors, 2 when something regressed.\n", prog, MAX_REPEAT, prog);
+}
+
+static int select_suites(const char *arg) {
+    for (const char *p = arg; *p;) {
+        const char *end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        int found = 0;
+        for (int i = 0; i < SUITE_COUNT; i++) {
+            if (strlen(s_suites[i].name) == n && strncmp(p, s_suites[i].name, n) == 0) {
+                s_cfg.selected[i] = 1;
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "ac_bench: unknown suite '%.*s'\n", (int)n, p);
+            return -1;
+        }
+        p = end ? end + 1 : p + n;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int chosen = 0;
+    int c;
+    const char *slash = strrchr(argv[0], '/');
+    snprintf(s_cfg.dir, sizeof(s_cfg.dir), "%.*s", slash ? (int)(slash - argv[0]) : 1,
+             slash ? argv[0] : ".");
+
+    while ((c = getopt(argc, argv, "s:n:o:b:t:k:d:alvh")) != -1) {
+        switch (c) {
+        case 's':
+            if (select_suites(optarg) != 0) {
+                return 1;
+            }
+            chosen = 1;
+            break;
+        case 'n': s_cfg.repeat = atoi(optarg); break;
+        case 'o': s_cfg.output = optarg; break;
+        case 'b': s_cfg.baseline = optarg; break;
+        case 't': s_cfg.threshold_pct = atof(optarg); break;
+        case 'k': s_cfg.sigmas = atof(optarg); break;
+        case 'd': snprintf(s_cfg.dir, sizeof(s_cfg.dir), "%s", optarg); break;
+        case 'a': s_cfg.all = 1; break;
+        case 'l':
+            for (int i = 0; i < SUITE_COUNT; i++) {
+                printf("%-10s %s %s\n", s_suites[i].name, s_suites[i].binary, s_suites[i].args);
+            }
+            return 0;
+        case 'v': s_cfg.verbose = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (s_cfg.repeat < 1 || s_cfg.repeat > MAX_REPEAT) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    cJSON *baseline = NULL;
+    if (s_cfg.baseline && !(baseline = load_baseline(s_cfg.baseline))) {
+        fprintf(stderr, "ac_bench: cannot read baseline %s\n", s_cfg.baseline);
+        return 1;
+    }
+
+    /* selected: 0 = skip, 1 = wanted, 2 = ran */
+    char ran[256] = "";
+    int failed = 0;
+    for (int i = 0; i < SUITE_COUNT; i++) {
+        if (chosen && !s_cfg.selected[i]) {
+            continue;
+        }
+        int rc = run_suite(&s_suites[i]);
+        if (rc == 1) {
+            fprintf(stderr, "%-10s not built, skipped\n", s_suites[i].name);
+            failed += chosen;
+            continue;
+        }
+        if (rc < 0) {
+            failed++;
+            continue;
+        }
+        s_cfg.selected[i] = 2;
+        size_t used = strlen(ran);
+        snprintf(ran + used, sizeof(ran) - used, "%s%s", used ? "," : "", s_suites[i].name);
+    }
+    for (int i = 0; i < s_metric_count; i++) {
+        metric_finish(&s_metrics[i]);
+    }
+
+    if (s_cfg.output && write_results(s_cfg.output, ran) != 0) {
+        fprintf(stderr, "ac_bench: cannot write %s\n", s_cfg.output);
+        failed++;
+    } else if (s_cfg.output) {
+        fprintf(stderr, "%d metrics from %s written to %s\n", s_metric_count,
+                ran[0] ? ran : "no suites", s_cfg.output);
+    }
+
+    int regressed = 0;
+    if (baseline) {
+        regressed = compare(baseline);
+        cJSON_Delete(baseline);
+    }
+    free(s_metrics);
+    return failed ? 1 : regressed ? 2 : 0;
+}
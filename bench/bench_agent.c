@@ -0,0 +1,451 @@
+/**
+ * @file bench_agent.c
+ * @brief End-to-end ReACT loop throughput
+ *
+ * Runs N concurrent agents, each for a number of runs of M iterations
+ * (M-1 tool rounds with MOC-wrapped no-op tools, then the answer),
+ * against mock_llm. Four variants: the sync and streaming loops, each
+ * with and without the shared HTTP pool. Each variant runs in its own
+ * process so peak RSS and pool state do not carry over.
+ *
+ * Reported per variant:
+ * - iter/s         ReACT iterations per second, all agents together
+ * - cpu_us/iter    user + system CPU of the process per iteration
+ * - allocs/iter    ArC heap allocations per iteration, counted with
+ *                  ac_alloc_count_start() (-1 without ARC_RUNTIME_ALLOCATOR)
+ * - p50/p99 us     per-iteration time outside the network and connect
+ *                  phases (arc/profile.h): the loop's own overhead
+ * - rss_kb         peak resident set size
+ *
+ * The mock server runs in a separate process, so its CPU is not
+ * counted. With -l the server delays the first token; iter/s then
+ * includes the wait, the overhead columns do not.
+ *
+ * Usage: bench_agent [-a agents] [-m iterations] [-r runs] [-l ms]
+ *                    [-P provider] [-u api_base] [-j]
+ */
+
+#include "arc/agent.h"
+#include "arc/allocator.h"
+#include "arc/http_pool.h"
+#include "arc/log.h"
+#include "arc/profile.h"
+#include "arc/session.h"
+#include "arc/tool.h"
+#include "bench_mock.h"
+#include "bench_tools.h"
+#include "bench_tools_gen.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================
+ * Allocation Counting
+ *============================================================================*/
+
+/**
+ * @brief ArC heap allocations so far, all threads (new blocks and resizes)
+ */
+static uint64_t bench_allocs(void) {
+    ac_alloc_counts_t counts;
+    ac_alloc_count_total(&counts);
+    return counts.allocs + counts.reallocs;
+}
+
+/*============================================================================
+ * Tools (no-ops; MOC generates the wrappers from bench_tools.h)
+ *============================================================================*/
+
+const char* bench_lookup(const char* key) {
+    (void)key;
+    return "42";
+}
+
+int bench_add(int a, int b) {
+    return a + b;
+}
+
+bool bench_switch(int channel, bool on) {
+    (void)channel;
+    return on;
+}
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+
+static struct {
+    int agents;
+    int iterations;
+    int runs;
+    int latency_ms;
+    const char *provider;
+    char api_base[128];
+    int json;
+} s_cfg = { 8, 8, 20, 0, "openai", "", 0 };
+
+typedef struct {
+    const char *name;
+    int stream;
+    int pool;
+} variant_t;
+
+static const variant_t s_variants[] = {
+    { "sync",             0, 0 },
+    { "sync/pool",        0, 1 },
+    { "stream",           1, 0 },
+    { "stream/pool",      1, 1 },
+};
+
+typedef struct {
+    uint64_t iterations;
+    uint64_t failed_runs;
+    double seconds;
+    double cpu_us_per_iter;
+    double allocs_per_iter;
+    double overhead_p50_us;
+    double overhead_p99_us;
+    long rss_kb;
+} result_t;
+
+/*============================================================================
+ * Mock Server
+ *============================================================================*/
+
+static char s_script_path[64];
+
+/**
+ * @brief Script: M-1 steps calling one tool each, then the answer
+ */
+static int write_script(int iterations) {
+    snprintf(s_script_path, sizeof(s_script_path), "/tmp/bench_agent_%d.txt", (int)getpid());
+    FILE *f = fopen(s_script_path, "w");
+    if (!f) {
+        return -1;
+    }
+    static const char *const steps[] = {
+        "tool bench_lookup {\"key\":\"threshold\"}",
+        "tool bench_add {\"a\":2,\"b\":40}",
+        "tool bench_switch {\"channel\":3,\"on\":true}",
+    };
+    for (int i = 0; i < iterations - 1; i++) {
+        fprintf(f, "%s\n\n", steps[i % 3]);
+    }
+    fprintf(f, "text Done.\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static int mock_start(void) {
+    if (write_script(s_cfg.iterations) != 0) {
+        return -1;
+    }
+    char ttft[16];
+    snprintf(ttft, sizeof(ttft), "%d", s_cfg.latency_ms);
+    int port = bench_mock_start((const char *const[]){ "-s", s_script_path, "-t", ttft, NULL });
+    if (port < 0) {
+        return -1;
+    }
+    snprintf(s_cfg.api_base, sizeof(s_cfg.api_base),
+             strcmp(s_cfg.provider, "anthropic") == 0 ? "http://127.0.0.1:%d"
+                                                      : "http://127.0.0.1:%d/v1", port);
+    return 0;
+}
+
+static void mock_stop(void) {
+    bench_mock_stop();
+    if (s_script_path[0]) {
+        unlink(s_script_path);
+    }
+}
+
+/*============================================================================
+ * Variant Run
+ *============================================================================*/
+
+/* Per-iteration overhead samples, filled by the profiler callbacks */
+static struct {
+    pthread_mutex_t lock;
+    uint64_t *us;
+    size_t count;
+    size_t cap;
+    int recording;
+} s_samples = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static atomic_ulong s_failed;
+static pthread_barrier_t s_start;
+
+static void on_iteration(void *ctx, const ac_prof_iteration_t *it) {
+    (void)ctx;
+    uint64_t waiting = it->phase_us[AC_PROF_NETWORK] + it->phase_us[AC_PROF_CONNECT];
+    uint64_t us = it->total_us > waiting ? it->total_us - waiting : 0;
+    pthread_mutex_lock(&s_samples.lock);
+    if (s_samples.recording && s_samples.count < s_samples.cap) {
+        s_samples.us[s_samples.count++] = us;
+    }
+    pthread_mutex_unlock(&s_samples.lock);
+}
+
+static int on_stream(const ac_stream_event_t *event, void *user_data) {
+    (void)event;
+    (void)user_data;
+    return 0;
+}
+
+static int run_once(int stream) {
+    ac_session_t *session = ac_session_open();
+    if (!session) {
+        return -1;
+    }
+    ac_session_profile(session, &(ac_profile_config_t){ .on_iteration = on_iteration });
+    ac_tool_registry_t *tools = ac_tool_registry_create(session);
+    ac_tool_registry_attach(tools, &ALL_TOOLS_TABLE);
+
+    ac_agent_params_t params = {
+        .name = "bench",
+        .instructions = "You are a benchmark.",
+        .llm = {
+            .provider = s_cfg.provider,
+            .model = "bench",
+            .api_key = "bench",
+            .api_base = s_cfg.api_base,
+        },
+        .tools = tools,
+        .max_iterations = s_cfg.iterations + 1,
+    };
+    if (stream) {
+        params.callbacks.on_stream = on_stream;
+    }
+    ac_agent_t *agent = ac_agent_create(session, &params);
+    ac_agent_result_t *result = agent ? ac_agent_run(agent, "Check the plant.") : NULL;
+    int ok = result && result->content && strcmp(result->content, "Done.") == 0;
+    ac_session_close(session);
+    return ok ? 0 : -1;
+}
+
+typedef struct {
+    int stream;
+} worker_arg_t;
+
+static void *worker(void *p) {
+    const worker_arg_t *arg = (const worker_arg_t *)p;
+    run_once(arg->stream);           /* Warm-up: connections, lazy state */
+    pthread_barrier_wait(&s_start);
+    for (int i = 0; i < s_cfg.runs; i++) {
+        if (run_once(arg->stream) != 0) {
+            atomic_fetch_add(&s_failed, 1);
+        }
+    }
+    return NULL;
+}
+
+static double cpu_us(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 +
+           (double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const uint64_t *sorted, size_t n, double p) {
+    return n ? (double)sorted[(size_t)(p * (double)(n - 1) + 0.5)] : 0.0;
+}
+
+static void run_variant(const variant_t *v, result_t *out) {
+    memset(out, 0, sizeof(*out));
+    /* Still single-threaded: the child has just forked */
+    int counting = ac_alloc_count_start() == ARC_OK;
+    if (v->pool) {
+        ac_http_pool_init(&(ac_http_pool_config_t){ .max_connections = (size_t)s_cfg.agents });
+    }
+
+    s_samples.cap = (size_t)s_cfg.agents * (size_t)(s_cfg.runs + 1) * (size_t)(s_cfg.iterations + 1);
+    s_samples.us = malloc(s_samples.cap * sizeof(uint64_t));
+    pthread_barrier_init(&s_start, NULL, (unsigned)s_cfg.agents + 1);
+
+    worker_arg_t arg = { v->stream };
+    pthread_t *threads = malloc((size_t)s_cfg.agents * sizeof(pthread_t));
+    for (int i = 0; i < s_cfg.agents; i++) {
+        pthread_create(&threads[i], NULL, worker, &arg);
+    }
+
+    pthread_barrier_wait(&s_start);
+    pthread_mutex_lock(&s_samples.lock);
+    s_samples.recording = 1;
+    pthread_mutex_unlock(&s_samples.lock);
+    uint64_t allocs = bench_allocs();
+    double cpu = cpu_us();
+    double t0 = now_s();
+
+    for (int i = 0; i < s_cfg.agents; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    out->seconds = now_s() - t0;
+    cpu = cpu_us() - cpu;
+    allocs = bench_allocs() - allocs;
+    out->iterations = s_samples.count;
+    out->failed_runs = atomic_load(&s_failed);
+    if (out->iterations) {
+        out->cpu_us_per_iter = cpu / (double)out->iterations;
+        out->allocs_per_iter = counting ? (double)allocs / (double)out->iterations : -1.0;
+    }
+    qsort(s_samples.us, s_samples.count, sizeof(uint64_t), cmp_u64);
+    out->overhead_p50_us = percentile(s_samples.us, s_samples.count, 0.50);
+    out->overhead_p99_us = percentile(s_samples.us, s_samples.count, 0.99);
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    out->rss_kb = ru.ru_maxrss;
+
+    if (v->pool) {
+        ac_http_pool_shutdown();
+    }
+    free(threads);
+    free(s_samples.us);
+    pthread_barrier_destroy(&s_start);
+}
+
+/**
+ * @brief Run a variant in a child process and collect its result
+ */
+static int run_isolated(const variant_t *v, result_t *out) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        run_variant(v, out);
+        ssize_t n = write(fds[1], out, sizeof(*out));
+        _exit(n == (ssize_t)sizeof(*out) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t n = pid > 0 ? read(fds[0], out, sizeof(*out)) : -1;
+    close(fds[0]);
+    int status = 0;
+    if (pid > 0) {
+        waitpid(pid, &status, 0);
+    }
+    return n == (ssize_t)sizeof(*out) && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/*============================================================================
+ * Report
+ *============================================================================*/
+
+static void print_table(const result_t *results, const int *ok) {
+    printf("# %d agents x %d runs x %d iterations, %s, %d ms time to first token\n",
+           s_cfg.agents, s_cfg.runs, s_cfg.iterations, s_cfg.provider, s_cfg.latency_ms);
+    printf("%-12s %10s %12s %12s %10s %10s %10s %7s\n",
+           "variant", "iter/s", "cpu_us/iter", "allocs/iter", "p50_us", "p99_us", "rss_kb", "failed");
+    for (size_t i = 0; i < sizeof(s_variants) / sizeof(s_variants[0]); i++) {
+        const result_t *r = &results[i];
+        if (!ok[i]) {
+            printf("%-12s %10s\n", s_variants[i].name, "error");
+            continue;
+        }
+        printf("%-12s %10.0f %12.1f %12.1f %10.0f %10.0f %10ld %7llu\n", s_variants[i].name,
+               (double)r->iterations / r->seconds, r->cpu_us_per_iter, r->allocs_per_iter,
+               r->overhead_p50_us, r->overhead_p99_us, r->rss_kb,
+               (unsigned long long)r->failed_runs);
+    }
+}
+
+static void print_json(const result_t *results, const int *ok) {
+    printf("{\"agents\":%d,\"runs\":%d,\"iterations\":%d,\"provider\":\"%s\","
+           "\"latency_ms\":%d,\"variants\":[", s_cfg.agents, s_cfg.runs, s_cfg.iterations,
+           s_cfg.provider, s_cfg.latency_ms);
+    int first = 1;
+    for (size_t i = 0; i < sizeof(s_variants) / sizeof(s_variants[0]); i++) {
+        const result_t *r = &results[i];
+        if (!ok[i]) {
+            continue;
+        }
+        printf("%s{\"name\":\"%s\",\"iter_per_s\":%.1f,\"cpu_us_per_iter\":%.2f,"
+               "\"allocs_per_iter\":%.2f,\"overhead_p50_us\":%.0f,\"overhead_p99_us\":%.0f,"
+               "\"rss_kb\":%ld,\"failed_runs\":%llu}", first ? "" : ",", s_variants[i].name,
+               (double)r->iterations / r->seconds, r->cpu_us_per_iter, r->allocs_per_iter,
+               r->overhead_p50_us, r->overhead_p99_us, r->rss_kb,
+               (unsigned long long)r->failed_runs);
+        first = 0;
+    }
+    printf("]}\n");
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n\n"
+           "  -a <n>         Concurrent agents (default 8)\n"
+           "  -m <n>         Iterations per run, the last one answers (default 8)\n"
+           "  -r <n>         Runs per agent (default 20)\n"
+           "  -l <ms>        Simulated time to first token (default 0)\n"
+           "  -P <provider>  openai or anthropic (default openai)\n"
+           "  -u <api_base>  Use a running mock_llm instead of starting one\n"
+           "  -j             Print a JSON report\n"
+           "  -h             Show this help message\n", prog);
+}
+
+int main(int argc, char **argv) {
+    int c;
+    const char *url = NULL;
+    while ((c = getopt(argc, argv, "a:m:r:l:P:u:jh")) != -1) {
+        switch (c) {
+        case 'a': s_cfg.agents = atoi(optarg); break;
+        case 'm': s_cfg.iterations = atoi(optarg); break;
+        case 'r': s_cfg.runs = atoi(optarg); break;
+        case 'l': s_cfg.latency_ms = atoi(optarg); break;
+        case 'P': s_cfg.provider = optarg; break;
+        case 'u': url = optarg; break;
+        case 'j': s_cfg.json = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (s_cfg.agents < 1 || s_cfg.iterations < 1 || s_cfg.runs < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    ac_log_set_level(AC_LOG_LEVEL_ERROR);
+
+    if (url) {
+        snprintf(s_cfg.api_base, sizeof(s_cfg.api_base), "%s", url);
+    } else if (mock_start() != 0) {
+        fprintf(stderr, "bench_agent: cannot start mock_llm (build tools or pass -u)\n");
+        mock_stop();
+        return 1;
+    }
+
+    enum { VARIANTS = sizeof(s_variants) / sizeof(s_variants[0]) };
+    result_t results[VARIANTS];
+    int ok[VARIANTS];
+    for (int i = 0; i < VARIANTS; i++) {
+        ok[i] = run_isolated(&s_variants[i], &results[i]) == 0;
+    }
+    mock_stop();
+
+    if (s_cfg.json) {
+        print_json(results, ok);
+    } else {
+        print_table(results, ok);
+    }
+    return 0;
+}
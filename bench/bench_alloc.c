@@ -0,0 +1,59 @@
+/**
+ * @file bench_alloc.c
+ * @brief Whole-process heap allocation count (glibc malloc interposition)
+ */
+
+#include "bench_alloc.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define BENCH_ALLOC_ASAN 1
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+#define BENCH_ALLOC_ASAN 1
+#endif
+
+#if defined(__GLIBC__) && !defined(BENCH_ALLOC_ASAN)
+
+static atomic_long s_allocs;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+    atomic_fetch_add_explicit(&s_allocs, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    atomic_fetch_add_explicit(&s_allocs, 1, memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    atomic_fetch_add_explicit(&s_allocs, 1, memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+long bench_alloc_count(void) {
+    return atomic_load_explicit(&s_allocs, memory_order_relaxed);
+}
+
+#else
+
+long bench_alloc_count(void) {
+    return -1;
+}
+
+#endif
@@ -0,0 +1,29 @@
+/**
+ * @file bench_alloc.h
+ * @brief Whole-process heap allocation count for the benchmarks
+ *
+ * For code that allocates with plain malloc (the Markdown renderer);
+ * ArC's own allocations are counted with ac_alloc_count_start()
+ * (arc/allocator.h) instead.
+ */
+
+#ifndef BENCH_ALLOC_H
+#define BENCH_ALLOC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief malloc, calloc and realloc calls so far, all threads
+ *
+ * @return Count, or -1 where malloc cannot be interposed (not glibc, or
+ *         built with AddressSanitizer, which owns the allocator)
+ */
+long bench_alloc_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_ALLOC_H */
@@ -0,0 +1,529 @@
+/**
+ * @file bench_core.c
+ * @brief Portable ac_core benchmark with a machine-readable report
+ *
+ * Runs the same scenarios on a desktop build and on embedded targets
+ * (ESP32, STM32, other FreeRTOS ports), so builds can be compared on
+ * the hardware they ship on:
+ * - sse_parse: SSE framing of an OpenAI stream (sse_parser_feed)
+ * - response_parse: non-stream response parsed into an arena and
+ *   turned into a history message, as a non-streaming turn does
+ * - message_serialize: history serialization (ac_messages_to_json_string)
+ * - tool_dispatch: name lookup and call through ac_tool_registry_call
+ *
+ * Fixtures are generated in memory (no file system, no sockets) and are
+ * sized for a device heap. Timing uses ac_platform_monotonic_us(); on
+ * FreeRTOS that is tick resolution unless the port overrides it with a
+ * hardware timer (esp_timer_get_time, DWT cycle counter), so keep
+ * min_ms well above the tick.
+ *
+ * The report is one JSON object on stdout: the target and the build
+ * switches that change the measured paths, then one line per case with
+ * ops, ns_per_op, bytes_per_s, allocs_per_op, heap_peak (bytes live
+ * at once during an op) and arena_bytes (arena high-water of the case).
+ * Heap figures come from a counting allocator with ARC_RUNTIME_ALLOCATOR
+ * and from the process pool with ARC_STATIC_MEMORY; they are -1 when the
+ * build has neither.
+ *
+ * Host:     bench_core [min_ms_per_case]
+ * Firmware: build this file with ARC_BENCH_NO_MAIN and call
+ *           bench_core_run(min_ms) from a task with a 16 KiB stack; the
+ *           report goes wherever printf is retargeted (UART, RTT).
+ */
+
+#include "arc.h"
+#include "arc/allocator.h"
+#include "arc/arena.h"
+#include "arc/log.h"
+#include "arc/message.h"
+#include "arc/platform.h"
+#include "arc/session.h"
+#include "arc/sse_parser.h"
+#include "arc/static_pool.h"
+#include "arc/tool.h"
+#include "message/message_json.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ARC_PLATFORM_EMBEDDED
+#define BENCH_EMBEDDED       1
+#define BENCH_DEFAULT_MS     200
+#define BENCH_CHUNK_SIZE     512     /* Typical lwIP/mbedTLS read */
+#else
+#define BENCH_EMBEDDED       0
+#define BENCH_DEFAULT_MS     300
+#define BENCH_CHUNK_SIZE     1400    /* One TCP segment */
+#endif
+
+#define BENCH_STREAM_DELTAS  96      /* Content deltas in the SSE fixture */
+#define BENCH_HISTORY_TURNS  8       /* User / tool call / tool result turns */
+#define BENCH_TOOL_RESULT    1024    /* Tool result bytes per turn */
+#define BENCH_TOOLS          16      /* Tools in the dispatch registry */
+
+int bench_core_run(uint32_t min_ms);
+
+/*============================================================================
+ * Heap Accounting
+ *============================================================================*/
+
+typedef struct {
+    uint64_t allocs;                 /* Allocations served */
+    size_t live;                     /* Bytes live now */
+    size_t peak;                     /* Highest live since the last reset */
+} heap_count_t;
+
+static heap_count_t s_heap;
+
+#if ARC_RUNTIME_ALLOCATOR
+#define BENCH_HEAP_COUNTS 1
+
+/* Size prefix: keeps the counts exact when free() gets no size */
+#define HEAP_HDR 16
+
+static ac_allocator_t s_base;
+
+static void heap_grow(size_t n) {
+    s_heap.live += n;
+    if (s_heap.live > s_heap.peak) {
+        s_heap.peak = s_heap.live;
+    }
+}
+
+static void *count_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    unsigned char *p = s_base.alloc(s_base.ctx, size + HEAP_HDR);
+    if (!p) {
+        return NULL;
+    }
+    memcpy(p, &size, sizeof(size));
+    s_heap.allocs++;
+    heap_grow(size);
+    return p + HEAP_HDR;
+}
+
+static void count_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    if (!ptr) {
+        return;
+    }
+    unsigned char *p = (unsigned char *)ptr - HEAP_HDR;
+    size_t n;
+    memcpy(&n, p, sizeof(n));
+    s_heap.live -= n;
+    s_base.free(s_base.ctx, p, n + HEAP_HDR);
+}
+
+static void *count_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)old_size;
+    if (!ptr) {
+        return count_alloc(ctx, new_size);
+    }
+    unsigned char *p = (unsigned char *)ptr - HEAP_HDR;
+    size_t n;
+    memcpy(&n, p, sizeof(n));
+    unsigned char *q = s_base.realloc(s_base.ctx, p, n + HEAP_HDR, new_size + HEAP_HDR);
+    if (!q) {
+        return NULL;
+    }
+    memcpy(q, &new_size, sizeof(new_size));
+    s_heap.allocs++;
+    s_heap.live -= n;
+    heap_grow(new_size);
+    return q + HEAP_HDR;
+}
+
+static void heap_setup(void) {
+    s_base = *ac_allocator_get();
+    ac_allocator_set(&(ac_allocator_t){ count_alloc, count_realloc, count_free, NULL });
+}
+
+static void heap_sample(heap_count_t *out) {
+    *out = s_heap;
+}
+
+static void heap_reset_peak(void) {
+    s_heap.peak = s_heap.live;
+}
+
+#elif ARC_STATIC_MEMORY
+#define BENCH_HEAP_COUNTS 1
+
+static void heap_setup(void) {
+}
+
+/* The pool's peak cannot be reset: heap_peak is then the case's high-water
+ * above what was live when it started, and the first case sets the bar. */
+static void heap_sample(heap_count_t *out) {
+    ac_static_pool_stats_t st;
+    ac_static_pool_t *pool = ac_static_memory_pool();
+    memset(out, 0, sizeof(*out));
+    if (pool && ac_static_pool_get_stats(pool, &st) == ARC_OK) {
+        out->allocs = st.allocations;
+        out->live = st.in_use;
+        out->peak = st.peak;
+    }
+}
+
+static void heap_reset_peak(void) {
+}
+
+#else
+#define BENCH_HEAP_COUNTS 0
+
+static void heap_setup(void) {
+}
+
+static void heap_sample(heap_count_t *out) {
+    memset(out, 0, sizeof(*out));
+}
+
+static void heap_reset_peak(void) {
+}
+#endif
+
+/*============================================================================
+ * Harness
+ *============================================================================*/
+
+typedef struct {
+    const char *name;
+    void (*run)(void *arg);
+    void *arg;
+    size_t bytes;                    /* Input (or output) bytes per op */
+    arena_t *arena;                  /* Arena the case allocates from (optional) */
+} bench_case_t;
+
+static uint64_t s_min_us;
+static int s_first_case;
+
+static void bench_run(const bench_case_t *c) {
+    /* Warm up: first run fills caches and lazy state */
+    c->run(c->arg);
+
+    heap_count_t before, after;
+    heap_reset_peak();
+    heap_sample(&before);
+
+    uint64_t ops = 0;
+    uint64_t start = ac_platform_monotonic_us();
+    uint64_t elapsed;
+    do {
+        c->run(c->arg);
+        ops++;
+        elapsed = ac_platform_monotonic_us() - start;
+    } while (elapsed < s_min_us);
+
+    heap_sample(&after);
+
+    uint64_t ns_op = elapsed * 1000 / ops;
+    uint64_t bytes_s = c->bytes && elapsed ? (uint64_t)c->bytes * ops * 1000000 / elapsed : 0;
+    long long allocs = -1, peak = -1, arena_bytes = -1;
+    if (BENCH_HEAP_COUNTS) {
+        /* Rounded to the nearest whole allocation */
+        allocs = (long long)((after.allocs - before.allocs + ops / 2) / ops);
+        peak = (long long)(after.peak - before.live);
+    }
+    arena_telemetry_t tel;
+    if (c->arena && arena_get_telemetry(c->arena, &tel)) {
+        arena_bytes = (long long)tel.peak_allocated;
+    }
+
+    printf("%s    {\"name\":\"%s\",\"ops\":%" PRIu64 ",\"ns_per_op\":%" PRIu64
+           ",\"bytes_per_s\":%" PRIu64 ",\"allocs_per_op\":%lld,\"heap_peak\":%lld"
+           ",\"arena_bytes\":%lld}",
+           s_first_case ? "" : ",\n", c->name, ops, ns_op, bytes_s,
+           allocs, peak, arena_bytes);
+    s_first_case = 0;
+}
+
+static const char *target_name(void) {
+#if defined(ARC_PLATFORM_ESP32)
+    return "esp32";
+#elif defined(ARC_PLATFORM_STM32)
+    return "stm32";
+#elif defined(ARC_PLATFORM_ZEPHYR)
+    return "zephyr";
+#elif defined(ARC_PLATFORM_FREERTOS)
+    return "freertos";
+#elif defined(ARC_PLATFORM_WINDOWS)
+    return "windows";
+#elif defined(ARC_PLATFORM_MACOS)
+    return "macos";
+#elif defined(ARC_PLATFORM_LINUX)
+    return "linux";
+#else
+    return "unknown";
+#endif
+}
+
+static void report_begin(uint32_t min_ms) {
+    printf("{\"bench\":\"ac_core\",\"version\":\"%d.%d.%d\",\n",
+           ARC_VERSION_MAJOR, ARC_VERSION_MINOR, ARC_VERSION_PATCH);
+    printf("  \"target\":{\"platform\":\"%s\",\"embedded\":%d,\"pointer_bits\":%u},\n",
+           target_name(), BENCH_EMBEDDED, (unsigned)(sizeof(void *) * 8));
+    printf("  \"config\":{\"json_inplace\":%d,\"stack_budget\":%d,\"static_memory\":%d,"
+           "\"runtime_allocator\":%d,\"arena_cache\":%d},\n",
+           ARC_JSON_INPLACE, ARC_STACK_BUDGET, ARC_STATIC_MEMORY,
+           ARC_RUNTIME_ALLOCATOR, (int)ARC_ARENA_CACHE_SIZE);
+    printf("  \"min_ms\":%" PRIu32 ",\"chunk_size\":%d,\n", min_ms, BENCH_CHUNK_SIZE);
+    printf("  \"cases\":[\n");
+    s_first_case = 1;
+}
+
+static void report_end(int status) {
+    printf("\n  ],\"status\":%d}\n", status);
+}
+
+/*============================================================================
+ * SSE Parse
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t events;
+} sse_arg_t;
+
+/**
+ * @brief OpenAI chat stream: role chunk, content deltas, finish, [DONE]
+ */
+static char *build_stream(size_t *len) {
+    static const char *chunk =
+        "data: {\"id\":\"chatcmpl-AbC123\",\"object\":\"chat.completion.chunk\","
+        "\"created\":1760000000,\"model\":\"gpt-4o-mini\",\"choices\":[{\"index\":0,"
+        "\"delta\":{\"content\":\"%s\"},\"finish_reason\":null}]}\n\n";
+    static const char *words[] = {
+        "The stream", " handler reads", " each delta", " in place,", " \\\"quoted\\\"",
+        " caf\\u00e9", " and", " line\\nbreaks", " from", " the buffer.",
+    };
+    size_t cap = (size_t)BENCH_STREAM_DELTAS * 256 + 512;
+    char *out = malloc(cap);
+    if (!out) {
+        return NULL;
+    }
+    size_t n = 0;
+    for (int i = 0; i < BENCH_STREAM_DELTAS; i++) {
+        n += (size_t)snprintf(out + n, cap - n, chunk, words[i % 10]);
+    }
+    n += (size_t)snprintf(out + n, cap - n,
+                          "data: {\"id\":\"chatcmpl-AbC123\",\"choices\":[{\"index\":0,"
+                          "\"delta\":{},\"finish_reason\":\"stop\"}]}\n\ndata: [DONE]\n\n");
+    *len = n;
+    return out;
+}
+
+static int count_event(const sse_event_t *event, void *ctx) {
+    (void)event;
+    ((sse_arg_t *)ctx)->events++;
+    return 0;
+}
+
+static void run_sse(void *arg) {
+    sse_arg_t *a = (sse_arg_t *)arg;
+    sse_parser_t p;
+    sse_parser_init(&p, count_event, a);
+    a->events = 0;
+    for (size_t off = 0; off < a->len; off += BENCH_CHUNK_SIZE) {
+        size_t n = a->len - off;
+        sse_parser_feed(&p, a->data + off, n < BENCH_CHUNK_SIZE ? n : BENCH_CHUNK_SIZE);
+    }
+    sse_parser_free(&p);
+}
+
+/*============================================================================
+ * Response Parse
+ *============================================================================*/
+
+static const char s_response[] =
+    "{\"id\":\"chatcmpl-AbC123\",\"object\":\"chat.completion\",\"created\":1760000000,"
+    "\"model\":\"gpt-4o-mini\",\"choices\":[{\"index\":0,\"message\":{\"role\":\"assistant\","
+    "\"content\":\"The sensor reads 21.5 \\u00b0C. I will raise the setpoint to 22 \\u00b0C "
+    "and check the valve state; the last three readings were 21.1, 21.3 and 21.5, so "
+    "the trend is up and no further action is needed after this change.\","
+    "\"tool_calls\":[{\"id\":\"call_Xa81\",\"type\":\"function\",\"function\":{"
+    "\"name\":\"set_thermostat\",\"arguments\":\"{\\\"zone\\\":\\\"living\\\","
+    "\\\"celsius\\\":22}\"}},{\"id\":\"call_Xa82\",\"type\":\"function\",\"function\":{"
+    "\"name\":\"read_valve\",\"arguments\":\"{\\\"zone\\\":\\\"living\\\"}\"}}]},"
+    "\"logprobs\":null,\"finish_reason\":\"tool_calls\"}],\"usage\":{\"prompt_tokens\":412,"
+    "\"completion_tokens\":71,\"total_tokens\":483},\"system_fingerprint\":\"fp_50cad350e4\"}";
+
+typedef struct {
+    arena_t *arena;
+} parse_arg_t;
+
+static void run_parse(void *arg) {
+    parse_arg_t *a = (parse_arg_t *)arg;
+    ac_chat_response_t response;
+    arena_reset(a->arena);
+    ac_chat_response_init_arena(&response, a->arena);
+    if (ac_chat_response_parse(s_response, &response) == ARC_OK) {
+        ac_message_from_response(a->arena, &response);
+    }
+    ac_chat_response_free(&response);
+}
+
+/*============================================================================
+ * Message Serialization
+ *============================================================================*/
+
+/**
+ * @brief Device-agent history: user turns, tool calls, tool results
+ */
+static ac_message_t *build_history(arena_t *arena) {
+    char *result = arena_alloc(arena, BENCH_TOOL_RESULT);
+    if (!result) {
+        return NULL;
+    }
+    static const char line[] = "{\"t\":21.5,\"rh\":48,\"note\":\"ok\"}\n";
+    for (int i = 0; i < BENCH_TOOL_RESULT - 1; i++) {
+        result[i] = line[i % (sizeof(line) - 1)];
+    }
+    result[BENCH_TOOL_RESULT - 1] = '\0';
+
+    ac_message_t *head = NULL;
+    for (int t = 0; t < BENCH_HISTORY_TURNS; t++) {
+        ac_tool_call_t *call = ac_tool_call_create(arena, "call_Xa81", "read_sensors",
+                                                   "{\"zone\":\"living\",\"window_s\":60}");
+        ac_message_append(&head, ac_message_create(arena, AC_ROLE_USER,
+                                                   "How warm is the living room, and is "
+                                                   "the valve open?"));
+        ac_message_append(&head, ac_message_create_with_tool_calls(arena, "Reading the sensors.",
+                                                                   call));
+        ac_message_append(&head, ac_message_create_tool_result(arena, "call_Xa81", result));
+    }
+    return head;
+}
+
+typedef struct {
+    const ac_message_t *messages;
+    size_t out_len;
+} history_arg_t;
+
+static void run_history(void *arg) {
+    history_arg_t *a = (history_arg_t *)arg;
+    char *json = ac_messages_to_json_string(a->messages);
+    if (json) {
+        a->out_len = strlen(json);
+        ARC_FREE(json);
+    }
+}
+
+/*============================================================================
+ * Tool Dispatch
+ *============================================================================*/
+
+static char *echo_tool(const ac_tool_ctx_t *ctx, const char *args_json, void *priv) {
+    (void)ctx;
+    (void)args_json;
+    (void)priv;
+    return ac_strdup("{\"ok\":true,\"celsius\":22}");
+}
+
+typedef struct {
+    ac_tool_registry_t *registry;
+} tool_arg_t;
+
+static void run_tool(void *arg) {
+    tool_arg_t *a = (tool_arg_t *)arg;
+    char *result = ac_tool_registry_call(a->registry, "tool_11",
+                                         "{\"zone\":\"living\",\"celsius\":22}", NULL);
+    ARC_FREE(result);
+}
+
+/*============================================================================
+ * Entry Points
+ *============================================================================*/
+
+/**
+ * @brief Run every case and print the report
+ *
+ * @param min_ms  Minimum run time per case (0 = platform default)
+ * @return 0 on success, 1 if a fixture could not be built
+ */
+int bench_core_run(uint32_t min_ms) {
+    if (min_ms == 0) {
+        min_ms = BENCH_DEFAULT_MS;
+    }
+    s_min_us = (uint64_t)min_ms * 1000;
+    ac_log_set_level(AC_LOG_LEVEL_ERROR);
+    heap_setup();
+
+    int status = 0;
+    report_begin(min_ms);
+
+    /* SSE parse */
+    sse_arg_t sse = { 0 };
+    sse.data = build_stream(&sse.len);
+    if (sse.data) {
+        bench_case_t c = { "sse_parse", run_sse, &sse, sse.len, NULL };
+        bench_run(&c);
+        free(sse.data);
+    } else {
+        status = 1;
+    }
+
+    /* Response parse */
+    parse_arg_t parse = { arena_create(4096) };
+    if (parse.arena) {
+        bench_case_t c = { "response_parse", run_parse, &parse, sizeof(s_response) - 1,
+                           parse.arena };
+        bench_run(&c);
+        arena_destroy(parse.arena);
+    } else {
+        status = 1;
+    }
+
+    /* Message serialization */
+    arena_t *arena = arena_create(16 * 1024);
+    history_arg_t history = { arena ? build_history(arena) : NULL, 0 };
+    if (history.messages) {
+        run_history(&history);
+        bench_case_t c = { "message_serialize", run_history, &history, history.out_len,
+                           arena };
+        bench_run(&c);
+    } else {
+        status = 1;
+    }
+    arena_destroy(arena);
+
+    /* Tool dispatch */
+    ac_session_t *session = ac_session_open();
+    ac_tool_registry_t *registry = session ? ac_tool_registry_create(session) : NULL;
+    if (registry) {
+        for (int i = 0; i < BENCH_TOOLS; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "tool_%02d", i);
+            ac_tool_t tool = {
+                .name = name,
+                .description = "Set a zone's thermostat",
+                .parameters = "{\"type\":\"object\",\"properties\":{"
+                              "\"zone\":{\"type\":\"string\"},"
+                              "\"celsius\":{\"type\":\"number\"}},"
+                              "\"required\":[\"zone\",\"celsius\"]}",
+                .execute = echo_tool,
+            };
+            ac_tool_registry_add(registry, &tool);
+        }
+        tool_arg_t tool = { registry };
+        bench_case_t c = { "tool_dispatch", run_tool, &tool, 0, NULL };
+        bench_run(&c);
+    } else {
+        status = 1;
+    }
+    ac_session_close(session);
+
+    report_end(status);
+    return status;
+}
+
+#ifndef ARC_BENCH_NO_MAIN
+int main(int argc, char **argv) {
+    uint32_t min_ms = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 0;
+    return bench_core_run(min_ms);
+}
+#endif
@@ -0,0 +1,384 @@
+/**
+ * @file bench_markdown.c
+ * @brief Markdown parsing and rendering benchmarks
+ *
+ * Replays model output through the terminal renderer the way the chat
+ * examples drive it:
+ * - md_stream_feed with token-sized chunks (as a provider streams them),
+ *   with line-end writes and with 16 ms batching
+ * - md_parse of the whole document
+ * - md_render_blocks of the parsed document
+ *
+ * Documents in data/markdown/ cover long prose, wide tables, deep lists,
+ * large code fences in several languages, and CJK text; each is repeated
+ * BENCH_MD_REPEAT times. Output goes to a callback that only counts, so
+ * results are ns/op, MB/s over the Markdown input, output callback calls
+ * per operation (writes/op), and heap allocations per operation
+ * (bench_alloc.h: glibc only, not under ASan). Layout is fixed at
+ * BENCH_MD_WIDTH columns whatever the terminal. -j prints the same as
+ * JSON (the format ac_bench reads).
+ *
+ * Usage: bench_markdown [-j] [data_dir] [min_ms_per_case]
+ */
+
+#include "bench_alloc.h"
+#include "md.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef ARC_BENCH_DATA_DIR
+#define ARC_BENCH_DATA_DIR "bench/data"
+#endif
+
+/** Each document is this many copies of its fixture */
+#define BENCH_MD_REPEAT 8
+
+/** Columns the output is laid out for */
+#define BENCH_MD_WIDTH 100
+
+/*============================================================================
+ * Output Counting
+ *============================================================================*/
+
+typedef struct {
+    unsigned long writes;
+    size_t bytes;
+} sink_t;
+
+static void sink_output(const char *text, size_t len, void *userdata) {
+    sink_t *sink = (sink_t *)userdata;
+    (void)text;
+    sink->writes++;
+    sink->bytes += len;
+}
+
+/*============================================================================
+ * Harness
+ *============================================================================*/
+
+typedef struct {
+    const char *name;
+    void (*run)(void *arg);
+    void *arg;
+    size_t bytes;                    /* Input bytes per op */
+    sink_t *sink;                    /* Output of the case (NULL = none) */
+} bench_case_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t s_min_ns = 300ull * 1000000ull;
+static int s_json;
+static int s_json_cases;
+static int s_counting;               /* bench_alloc_count() works here */
+
+static void bench_run_json(const bench_case_t *c, uint64_t ops, double ns_op,
+                           unsigned long writes, long allocs) {
+    printf("%s\n  {\"name\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.0f,\"bytes_per_s\":%.0f",
+           s_json_cases++ ? "," : "", c->name, (unsigned long long)ops, ns_op,
+           (double)c->bytes / ns_op * 1e9);
+    if (c->sink) {
+        printf(",\"writes_per_op\":%.1f", (double)writes / (double)ops);
+    }
+    if (s_counting) {
+        printf(",\"allocs_per_op\":%.2f", (double)allocs / (double)ops);
+    }
+    printf("}");
+}
+
+static void bench_run(const bench_case_t *c) {
+    /* Warm up: first run fills caches and lazy state */
+    c->run(c->arg);
+
+    uint64_t ops = 0;
+    long allocs = bench_alloc_count();
+    unsigned long writes = c->sink ? c->sink->writes : 0;
+    uint64_t start = now_ns();
+    uint64_t elapsed;
+    do {
+        c->run(c->arg);
+        ops++;
+        elapsed = now_ns() - start;
+    } while (elapsed < s_min_ns);
+    allocs = bench_alloc_count() - allocs;
+
+    double ns_op = (double)elapsed / (double)ops;
+    if (s_json) {
+        bench_run_json(c, ops, ns_op, c->sink ? c->sink->writes - writes : 0, allocs);
+        return;
+    }
+    printf("%-40s %8llu %12.0f", c->name, (unsigned long long)ops, ns_op);
+    printf(" %9.1f", (double)c->bytes / ns_op * 1e9 / (1024.0 * 1024.0));
+    if (c->sink) {
+        printf(" %10.1f", (double)(c->sink->writes - writes) / (double)ops);
+    } else {
+        printf(" %10s", "-");
+    }
+    if (s_counting) {
+        printf(" %10.1f\n", (double)allocs / (double)ops);
+    } else {
+        printf(" %10s\n", "n/a");
+    }
+}
+
+static void bench_header(void) {
+    if (s_json) {
+        printf("{\"bench\":\"markdown\",\"min_ms\":%llu,\"cases\":[",
+               (unsigned long long)(s_min_ns / 1000000ull));
+        return;
+    }
+    printf("%-40s %8s %12s %9s %10s %10s\n",
+           "case", "ops", "ns/op", "MB/s", "writes/op", "allocs/op");
+}
+
+static void bench_footer(void) {
+    if (s_json) {
+        printf("\n]}\n");
+    }
+}
+
+/*============================================================================
+ * Fixtures
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t len;
+} blob_t;
+
+static int load_file(const char *dir, const char *name, blob_t *out) {
+    char path[1024];
+    int n = snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (n < 0 || (size_t)n >= sizeof(path)) {
+        fprintf(stderr, "bench: path too long: %s/%s\n", dir, name);
+        return -1;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "bench: cannot open %s\n", path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    out->data = malloc((size_t)size + 1);
+    if (!out->data || fread(out->data, 1, (size_t)size, f) != (size_t)size) {
+        fclose(f);
+        free(out->data);
+        return -1;
+    }
+    out->data[size] = '\0';
+    out->len = (size_t)size;
+    fclose(f);
+    return 0;
+}
+
+/** n copies of a document, separated by a blank line */
+static blob_t repeat_doc(const blob_t *doc, int n) {
+    blob_t out = { 0 };
+    out.data = malloc((doc->len + 1) * (size_t)n + 1);
+    if (!out.data) {
+        return out;
+    }
+    for (int i = 0; i < n; i++) {
+        memcpy(out.data + out.len, doc->data, doc->len);
+        out.len += doc->len;
+        out.data[out.len++] = '\n';
+    }
+    out.data[out.len] = '\0';
+    return out;
+}
+
+/**
+ * @brief Split a document into token-sized deltas
+ *
+ * Sizes cycle through a few typical token lengths; a delta never ends
+ * inside a UTF-8 sequence, as providers send whole characters.
+ * @return Number of deltas; ends[i] is the end offset of delta i
+ */
+static size_t split_tokens(const blob_t *doc, size_t **ends) {
+    static const size_t sizes[] = { 4, 3, 6, 2, 5, 4, 9, 3 };
+    size_t count = 0;
+    size_t cap = doc->len / 2 + 1;
+    *ends = malloc(cap * sizeof(size_t));
+    if (!*ends) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    while (pos < doc->len) {
+        size_t end = pos + sizes[count % (sizeof(sizes) / sizeof(sizes[0]))];
+        if (end > doc->len) {
+            end = doc->len;
+        }
+        while (end < doc->len && ((unsigned char)doc->data[end] & 0xC0) == 0x80) {
+            end++;
+        }
+        (*ends)[count++] = end;
+        pos = end;
+    }
+    return count;
+}
+
+/*============================================================================
+ * Streaming
+ *============================================================================*/
+
+typedef struct {
+    const blob_t *doc;
+    size_t *ends;
+    size_t delta_count;
+    md_stream_t *stream;
+} stream_arg_t;
+
+static void run_stream(void *arg) {
+    stream_arg_t *a = (stream_arg_t *)arg;
+    size_t pos = 0;
+    for (size_t i = 0; i < a->delta_count; i++) {
+        md_stream_feed(a->stream, a->doc->data + pos, a->ends[i] - pos);
+        pos = a->ends[i];
+    }
+    md_stream_finish(a->stream);
+    md_stream_reset(a->stream);
+}
+
+/*============================================================================
+ * Whole Documents
+ *============================================================================*/
+
+static void run_parse(void *arg) {
+    const blob_t *doc = (const blob_t *)arg;
+    md_block_token_t *tokens = md_parse(doc->data);
+    md_free_tokens(tokens);
+}
+
+typedef struct {
+    md_block_token_t *tokens;
+    md_renderer_t renderer;
+    int cold;                        /* Drop cached highlighting before each op */
+} render_arg_t;
+
+static void run_render(void *arg) {
+    render_arg_t *a = (render_arg_t *)arg;
+    if (a->cold) {
+        md_highlight_cache_clear();
+    }
+    md_render_blocks(&a->renderer, a->tokens);
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "-j") == 0) {
+        s_json = 1;
+        argc--;
+        argv++;
+    }
+    const char *dir = argc > 1 ? argv[1] : ARC_BENCH_DATA_DIR;
+    if (argc > 2) {
+        s_min_ns = strtoull(argv[2], NULL, 10) * 1000000ull;
+    }
+    s_counting = bench_alloc_count() >= 0;
+
+    static const char *const files[] = {
+        "prose.md", "tables.md", "lists.md", "code.md", "cjk.md",
+    };
+    enum { DOC_COUNT = sizeof(files) / sizeof(files[0]) };
+
+    char md_dir[1024];
+    snprintf(md_dir, sizeof(md_dir), "%s/markdown", dir);
+
+    blob_t docs[DOC_COUNT];
+    for (int i = 0; i < DOC_COUNT; i++) {
+        blob_t raw;
+        if (load_file(md_dir, files[i], &raw) != 0) {
+            return 1;
+        }
+        docs[i] = repeat_doc(&raw, BENCH_MD_REPEAT);
+        free(raw.data);
+        if (!docs[i].data) {
+            return 1;
+        }
+    }
+
+    bench_header();
+
+    /* Streaming, token by token */
+    static const struct {
+        const char *suffix;
+        int batch_ms;
+    } modes[] = {
+        { "", 0 },
+        { "/batch16", MD_ASYNC_FRAME_MS },
+    };
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        for (int i = 0; i < DOC_COUNT; i++) {
+            char name[64];
+            sink_t sink = { 0 };
+            stream_arg_t a = { &docs[i], NULL, 0, md_stream_new() };
+            a.delta_count = split_tokens(&docs[i], &a.ends);
+            if (!a.stream || !a.ends) {
+                return 1;
+            }
+            md_stream_set_output(a.stream, sink_output, &sink);
+            md_stream_set_width(a.stream, BENCH_MD_WIDTH);
+            md_stream_set_batching(a.stream, modes[m].batch_ms);
+
+            snprintf(name, sizeof(name), "md_stream_feed/%s%s", files[i], modes[m].suffix);
+            bench_case_t c = { name, run_stream, &a, docs[i].len, &sink };
+            bench_run(&c);
+
+            md_stream_free(a.stream);
+            free(a.ends);
+        }
+    }
+
+    /* Parsing */
+    for (int i = 0; i < DOC_COUNT; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "md_parse/%s", files[i]);
+        bench_case_t c = { name, run_parse, &docs[i], docs[i].len, NULL };
+        bench_run(&c);
+    }
+
+    /* Rendering parsed documents */
+    for (int i = 0; i <= DOC_COUNT; i++) {
+        /* The extra pass renders code.md with the highlight cache cleared */
+        int cold = i == DOC_COUNT;
+        const blob_t *doc = cold ? &docs[3] : &docs[i];
+        char name[64];
+        sink_t sink = { 0 };
+        render_arg_t a = { md_parse(doc->data), { 0 }, cold };
+        if (!a.tokens) {
+            return 1;
+        }
+        md_renderer_init(&a.renderer);
+        md_renderer_set_output(&a.renderer, sink_output, &sink);
+        md_renderer_set_batching(&a.renderer, 0);
+        a.renderer.term_width = BENCH_MD_WIDTH;
+
+        snprintf(name, sizeof(name), "md_render_blocks/%s%s", cold ? files[3] : files[i],
+                 cold ? "/cold" : "");
+        bench_case_t c = { name, run_render, &a, doc->len, &sink };
+        bench_run(&c);
+        md_free_tokens(a.tokens);
+    }
+    bench_footer();
+
+    for (int i = 0; i < DOC_COUNT; i++) {
+        free(docs[i].data);
+    }
+    md_highlight_cache_clear();
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file bench_mock.c
+ * @brief Start mock_llm for the end-to-end benchmarks
+ */
+
+#include "bench_mock.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MOCK_MAX_ARGS 32
+
+static pid_t s_pid;
+
+static int free_port(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    int port = -1;
+    if (fd >= 0 && bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        getsockname(fd, (struct sockaddr *)&addr, &len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return port;
+}
+
+static int port_open(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t)port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int ok = fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    if (fd >= 0) {
+        close(fd);
+    }
+    return ok;
+}
+
+int bench_mock_start(const char *const *args) {
+    const char *path = ARC_MOCK_LLM_PATH;
+    int port = free_port();
+    if (!path || port < 0) {
+        return -1;
+    }
+    char port_arg[16];
+    snprintf(port_arg, sizeof(port_arg), "%d", port);
+    const char *argv[MOCK_MAX_ARGS + 4] = { path, "-p", port_arg };
+    int argc = 3;
+    for (int i = 0; args && args[i] && i < MOCK_MAX_ARGS; i++) {
+        argv[argc++] = args[i];
+    }
+    argv[argc] = NULL;
+
+    s_pid = fork();
+    if (s_pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+        }
+        execv(path, (char *const *)argv);
+        _exit(127);
+    }
+    if (s_pid < 0) {
+        return -1;
+    }
+    for (int i = 0; i < 200 && !port_open(port); i++) {
+        usleep(10000);
+    }
+    if (!port_open(port)) {
+        bench_mock_stop();
+        return -1;
+    }
+    return port;
+}
+
+void bench_mock_stop(void) {
+    if (s_pid > 0) {
+        kill(s_pid, SIGTERM);
+        waitpid(s_pid, NULL, 0);
+        s_pid = 0;
+    }
+}
@@ -0,0 +1,35 @@
+/**
+ * @file bench_mock.h
+ * @brief Start mock_llm for the end-to-end benchmarks
+ */
+
+#ifndef BENCH_MOCK_H
+#define BENCH_MOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ARC_MOCK_LLM_PATH
+#define ARC_MOCK_LLM_PATH NULL
+#endif
+
+/**
+ * @brief Start mock_llm on a free loopback port and wait until it listens
+ *
+ * @param args  Extra options, NULL-terminated (-p is added); output is
+ *              discarded
+ * @return Port, or -1 (no mock_llm in this build, or it did not start)
+ */
+int bench_mock_start(const char *const *args);
+
+/**
+ * @brief Stop the server started by bench_mock_start()
+ */
+void bench_mock_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_MOCK_H */
@@ -0,0 +1,599 @@
+/**
+ * @file bench_parsers.c
+ * @brief Parser and serializer micro-benchmarks
+ *
+ * Measures the hot paths between the socket and the agent loop:
+ * - SSE framing (sse_parser_feed) over provider streams
+ * - Provider event handling: a full streaming call against a loopback
+ *   server replaying the stream, so every event goes through the real
+ *   provider handler
+ * - Non-stream response parsing (OpenAI and Anthropic)
+ * - History serialization (ac_messages_to_json_string)
+ * - Tool schema building
+ *
+ * Streams in data/ follow each provider's wire format (OpenAI, Anthropic,
+ * Kimi with reasoning_content). Results are ns/op, MB/s over the input or
+ * output, ns/event where it applies, and ArC heap allocations per
+ * operation (ac_alloc_count_start(); libcurl's own are not counted). -j
+ * prints the same as JSON (the format ac_bench reads).
+ *
+ * Usage: bench_parsers [-j] [data_dir] [min_ms_per_case]
+ */
+
+#include "arc/allocator.h"
+#include "arc/arena.h"
+#include "arc/llm.h"
+#include "arc/log.h"
+#include "arc/message.h"
+#include "arc/session.h"
+#include "arc/sse_parser.h"
+#include "arc/tool.h"
+#include "message/message_json.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef ARC_BENCH_DATA_DIR
+#define ARC_BENCH_DATA_DIR "bench/data"
+#endif
+
+/** Bytes handed to sse_parser_feed per call (one TCP segment) */
+#define BENCH_CHUNK_SIZE 1400
+
+/** Provider streams are replayed this many times per request */
+#define BENCH_STREAM_REPEAT 8
+
+/*============================================================================
+ * Allocation Counting
+ *============================================================================*/
+
+static int s_counting;               /* ac_alloc_count_start() succeeded */
+
+/**
+ * @brief ArC heap allocations so far, all threads (new blocks and resizes)
+ */
+static uint64_t bench_allocs(void) {
+    ac_alloc_counts_t counts;
+    ac_alloc_count_total(&counts);
+    return counts.allocs + counts.reallocs;
+}
+
+/*============================================================================
+ * Harness
+ *============================================================================*/
+
+typedef struct {
+    const char *name;
+    void (*run)(void *arg);
+    void *arg;
+    size_t bytes;                    /* Input (or output) bytes per op */
+    size_t events;                   /* Events per op (0 = n/a) */
+} bench_case_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t s_min_ns = 300ull * 1000000ull;
+static int s_json;
+static int s_json_cases;
+
+static void bench_run_json(const bench_case_t *c, uint64_t ops, double ns_op, uint64_t allocs) {
+    printf("%s\n  {\"name\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.0f,\"bytes_per_s\":%.0f",
+           s_json_cases++ ? "," : "", c->name, (unsigned long long)ops, ns_op,
+           c->bytes ? (double)c->bytes / ns_op * 1e9 : 0.0);
+    if (c->events) {
+        printf(",\"ns_per_event\":%.1f", ns_op / (double)c->events);
+    }
+    if (s_counting) {
+        printf(",\"allocs_per_op\":%.2f", (double)allocs / (double)ops);
+    }
+    printf("}");
+}
+
+static void bench_run(const bench_case_t *c) {
+    /* Warm up: first run fills caches and lazy state */
+    c->run(c->arg);
+
+    uint64_t ops = 0;
+    uint64_t allocs = bench_allocs();
+    uint64_t start = now_ns();
+    uint64_t elapsed;
+    do {
+        c->run(c->arg);
+        ops++;
+        elapsed = now_ns() - start;
+    } while (elapsed < s_min_ns);
+    allocs = bench_allocs() - allocs;
+
+    double ns_op = (double)elapsed / (double)ops;
+    if (s_json) {
+        bench_run_json(c, ops, ns_op, allocs);
+        return;
+    }
+    printf("%-34s %8llu %12.0f", c->name, (unsigned long long)ops, ns_op);
+    if (c->bytes) {
+        printf(" %9.1f", (double)c->bytes / ns_op * 1e9 / (1024.0 * 1024.0));
+    } else {
+        printf(" %9s", "-");
+    }
+    if (c->events) {
+        printf(" %9.1f", ns_op / (double)c->events);
+    } else {
+        printf(" %9s", "-");
+    }
+    if (s_counting) {
+        printf(" %10.1f\n", (double)allocs / (double)ops);
+    } else {
+        printf(" %10s\n", "n/a");
+    }
+}
+
+static void bench_header(void) {
+    if (s_json) {
+        printf("{\"bench\":\"parsers\",\"min_ms\":%llu,\"cases\":[",
+               (unsigned long long)(s_min_ns / 1000000ull));
+        return;
+    }
+    printf("%-34s %8s %12s %9s %9s %10s\n",
+           "case", "ops", "ns/op", "MB/s", "ns/event", "allocs/op");
+}
+
+static void bench_footer(void) {
+    if (s_json) {
+        printf("\n]}\n");
+    }
+}
+
+/*============================================================================
+ * Fixtures
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t len;
+} blob_t;
+
+static int load_file(const char *dir, const char *name, blob_t *out) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "bench: cannot open %s\n", path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    out->data = malloc((size_t)size + 1);
+    if (!out->data || fread(out->data, 1, (size_t)size, f) != (size_t)size) {
+        fclose(f);
+        free(out->data);
+        return -1;
+    }
+    out->data[size] = '\0';
+    out->len = (size_t)size;
+    fclose(f);
+    return 0;
+}
+
+/**
+ * @brief Stream body replaying the fixture's events n times, then its last event
+ *
+ * The last event terminates the stream ([DONE] / message_stop), so it is
+ * sent once.
+ */
+static blob_t repeat_stream(const blob_t *stream, int n) {
+    blob_t out = { 0 };
+    size_t body = stream->len;
+    while (body >= 2 && stream->data[body - 1] == '\n' && stream->data[body - 2] == '\n') {
+        body--;
+    }
+    const char *last = stream->data;
+    for (const char *p = stream->data; p + 1 < stream->data + body; p++) {
+        if (p[0] == '\n' && p[1] == '\n') {
+            last = p + 2;
+        }
+    }
+    size_t head = (size_t)(last - stream->data);
+    size_t tail = stream->len - head;
+
+    out.len = head * (size_t)n + tail;
+    out.data = malloc(out.len + 1);
+    if (!out.data) {
+        out.len = 0;
+        return out;
+    }
+    for (int i = 0; i < n; i++) {
+        memcpy(out.data + head * (size_t)i, stream->data, head);
+    }
+    memcpy(out.data + head * (size_t)n, last, tail);
+    out.data[out.len] = '\0';
+    return out;
+}
+
+/*============================================================================
+ * SSE Framing
+ *============================================================================*/
+
+typedef struct {
+    const blob_t *stream;
+    size_t events;
+} sse_arg_t;
+
+static int count_event(const sse_event_t *event, void *ctx) {
+    (void)event;
+    ((sse_arg_t *)ctx)->events++;
+    return 0;
+}
+
+static void run_sse(void *arg) {
+    sse_arg_t *a = (sse_arg_t *)arg;
+    sse_parser_t p;
+    sse_parser_init(&p, count_event, a);
+    a->events = 0;
+    for (size_t off = 0; off < a->stream->len; off += BENCH_CHUNK_SIZE) {
+        size_t n = a->stream->len - off;
+        sse_parser_feed(&p, a->stream->data + off, n < BENCH_CHUNK_SIZE ? n : BENCH_CHUNK_SIZE);
+    }
+    sse_parser_free(&p);
+}
+
+/*============================================================================
+ * Provider Event Handling (loopback replay)
+ *============================================================================*/
+
+typedef struct {
+    int listen_fd;
+    int port;
+    const blob_t *body;              /* Response for the next request */
+    pthread_t thread;
+} replay_server_t;
+
+/**
+ * @brief Serve one canned SSE response per connection, forever
+ */
+static void *replay_thread(void *arg) {
+    replay_server_t *srv = (replay_server_t *)arg;
+    char req[65536];
+
+    for (;;) {
+        int fd = accept(srv->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+
+        /* Read headers, then the Content-Length body (or none) */
+        size_t got = 0;
+        size_t need = 0;
+        for (;;) {
+            ssize_t n = read(fd, req + got, sizeof(req) - 1 - got);
+            if (n <= 0) {
+                break;
+            }
+            got += (size_t)n;
+            req[got] = '\0';
+            char *end = strstr(req, "\r\n\r\n");
+            if (end && need == 0) {
+                char *cl = strstr(req, "Content-Length:");
+                if (!cl) {
+                    cl = strstr(req, "content-length:");
+                }
+                need = (size_t)(end + 4 - req) + (cl ? (size_t)strtoul(cl + 15, NULL, 10) : 0);
+            }
+            if (need && got >= need) {
+                break;
+            }
+            if (got == sizeof(req) - 1) {
+                got = 0;                 /* Large body: drain it */
+                need = need > sizeof(req) - 1 ? need - (sizeof(req) - 1) : 0;
+            }
+        }
+
+        const blob_t *body = srv->body;
+        char head[256];
+        int hn = snprintf(head, sizeof(head),
+                          "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                          "Content-Length: %zu\r\nConnection: close\r\n\r\n", body->len);
+        if (write(fd, head, (size_t)hn) < 0 ||
+            write(fd, body->data, body->len) < 0) {
+            /* Client went away: nothing to do */
+        }
+        close(fd);
+    }
+}
+
+static int replay_start(replay_server_t *srv) {
+    srv->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (srv->listen_fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(srv->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t alen = sizeof(addr);
+    if (bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(srv->listen_fd, 16) != 0 ||
+        getsockname(srv->listen_fd, (struct sockaddr *)&addr, &alen) != 0) {
+        close(srv->listen_fd);
+        return -1;
+    }
+    srv->port = ntohs(addr.sin_port);
+    return pthread_create(&srv->thread, NULL, replay_thread, srv) == 0 ? 0 : -1;
+}
+
+typedef struct {
+    replay_server_t *srv;
+    const blob_t *body;
+    ac_llm_t *llm;
+    ac_message_t *messages;
+    size_t events;
+} stream_arg_t;
+
+static int count_stream_event(const ac_stream_event_t *event, void *user_data) {
+    (void)event;
+    ((stream_arg_t *)user_data)->events++;
+    return 0;
+}
+
+static void run_stream(void *arg) {
+    stream_arg_t *a = (stream_arg_t *)arg;
+    ac_chat_response_t response;
+    a->srv->body = a->body;
+    a->events = 0;
+    ac_llm_chat_stream(a->llm, a->messages, NULL, count_stream_event, a, &response);
+    ac_chat_response_free(&response);
+}
+
+/*============================================================================
+ * Response Parsing
+ *============================================================================*/
+
+typedef struct {
+    const blob_t *json;
+    int anthropic;
+} parse_arg_t;
+
+static void run_parse(void *arg) {
+    parse_arg_t *a = (parse_arg_t *)arg;
+    ac_chat_response_t response;
+    ac_chat_response_init(&response);
+    if (a->anthropic) {
+        ac_chat_response_parse_anthropic(a->json->data, &response);
+    } else {
+        ac_chat_response_parse(a->json->data, &response);
+    }
+    ac_chat_response_free(&response);
+}
+
+/*============================================================================
+ * History Serialization
+ *============================================================================*/
+
+/**
+ * @brief Typical coding-agent history: user turns, tool calls, large tool results
+ */
+static ac_message_t *build_history(arena_t *arena, int turns) {
+    static const char *args = "{\"path\":\"src/llm/providers/openai.c\",\"start_line\":120}";
+    char *result = arena_alloc(arena, 8192);
+    for (int i = 0; i < 8191; i++) {
+        result[i] = "static int x = 0;\n\t/* \"quoted\" */ "[i % 34];
+    }
+    result[8191] = '\0';
+
+    ac_message_t *head = NULL;
+    ac_message_t **tail = &head;
+    for (int t = 0; t < turns; t++) {
+        ac_message_t *msgs[3];
+        msgs[0] = ac_message_create(arena, AC_ROLE_USER,
+                                    "Find where the stream deltas are decoded and explain "
+                                    "the buffering, with line numbers.");
+        ac_tool_call_t *call = ac_tool_call_create(arena, "call_abc123", "read_file", args);
+        msgs[1] = ac_message_create_with_tool_calls(arena, "Reading the provider source.", call);
+        msgs[2] = ac_message_create_tool_result(arena, "call_abc123", result);
+        for (int i = 0; i < 3; i++) {
+            if (msgs[i]) {
+                *tail = msgs[i];
+                tail = &msgs[i]->next;
+            }
+        }
+    }
+    return head;
+}
+
+typedef struct {
+    const ac_message_t *messages;
+    size_t out_len;
+} history_arg_t;
+
+static void run_history(void *arg) {
+    history_arg_t *a = (history_arg_t *)arg;
+    char *json = ac_messages_to_json_string(a->messages);
+    if (json) {
+        a->out_len = strlen(json);
+        free(json);
+    }
+}
+
+/*============================================================================
+ * Tool Schema
+ *============================================================================*/
+
+static char *noop_tool(const ac_tool_ctx_t *ctx, const char *args_json, void *priv) {
+    (void)ctx;
+    (void)args_json;
+    (void)priv;
+    return NULL;
+}
+
+typedef struct {
+    ac_tool_registry_t *registry;
+    size_t out_len;
+} schema_arg_t;
+
+static void run_schema(void *arg) {
+    schema_arg_t *a = (schema_arg_t *)arg;
+    char *json = ac_tool_registry_schema(a->registry);
+    if (json) {
+        a->out_len = strlen(json);
+        free(json);
+    }
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "-j") == 0) {
+        s_json = 1;
+        argc--;
+        argv++;
+    }
+    const char *dir = argc > 1 ? argv[1] : ARC_BENCH_DATA_DIR;
+    if (argc > 2) {
+        s_min_ns = strtoull(argv[2], NULL, 10) * 1000000ull;
+    }
+    ac_log_set_level(AC_LOG_LEVEL_ERROR);
+    s_counting = ac_alloc_count_start() == ARC_OK;
+
+    static const struct {
+        const char *file;
+        const char *provider;
+    } streams[] = {
+        { "openai.sse", "openai" },
+        { "anthropic.sse", "anthropic" },
+        { "kimi.sse", "openai" },
+    };
+    enum { STREAM_COUNT = sizeof(streams) / sizeof(streams[0]) };
+
+    blob_t raw[STREAM_COUNT];
+    blob_t replay[STREAM_COUNT];
+    blob_t resp_openai, resp_anthropic;
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        if (load_file(dir, streams[i].file, &raw[i]) != 0) {
+            return 1;
+        }
+        replay[i] = repeat_stream(&raw[i], BENCH_STREAM_REPEAT);
+    }
+    if (load_file(dir, "openai_response.json", &resp_openai) != 0 ||
+        load_file(dir, "anthropic_response.json", &resp_anthropic) != 0) {
+        return 1;
+    }
+
+    bench_header();
+
+    /* SSE framing */
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        char name[64];
+        sse_arg_t a = { &raw[i], 0 };
+        run_sse(&a);
+        snprintf(name, sizeof(name), "sse_parser_feed/%s", streams[i].file);
+        bench_case_t c = { name, run_sse, &a, raw[i].len, a.events };
+        bench_run(&c);
+    }
+
+    /* Provider event handling */
+    replay_server_t srv;
+    memset(&srv, 0, sizeof(srv));
+    if (replay_start(&srv) != 0) {
+        fprintf(stderr, "bench: loopback server failed, skipping provider cases\n");
+    } else {
+        char base[64];
+        snprintf(base, sizeof(base), "http://127.0.0.1:%d", srv.port);
+        arena_t *arena = arena_create(1024 * 1024);
+        ac_message_t *msg = ac_message_create(arena, AC_ROLE_USER, "hi");
+
+        for (int i = 0; i < STREAM_COUNT; i++) {
+            char name[64];
+            ac_llm_t *llm = ac_llm_create(arena, &(ac_llm_params_t){
+                .provider = streams[i].provider,
+                .model = "bench",
+                .api_key = "bench",
+                .api_base = base,
+            });
+            if (!llm) {
+                continue;
+            }
+            stream_arg_t a = { &srv, &replay[i], llm, msg, 0 };
+            run_stream(&a);
+            snprintf(name, sizeof(name), "provider_stream/%s", streams[i].file);
+            bench_case_t c = { name, run_stream, &a, replay[i].len, a.events };
+            bench_run(&c);
+            ac_llm_cleanup(llm);
+        }
+        arena_destroy(arena);
+    }
+
+    /* Response parsing */
+    {
+        parse_arg_t po = { &resp_openai, 0 };
+        parse_arg_t pa = { &resp_anthropic, 1 };
+        bench_case_t co = { "ac_chat_response_parse", run_parse, &po, resp_openai.len, 0 };
+        bench_case_t ca = { "ac_chat_response_parse_anthropic", run_parse, &pa,
+                            resp_anthropic.len, 0 };
+        bench_run(&co);
+        bench_run(&ca);
+    }
+
+    /* History serialization */
+    {
+        arena_t *arena = arena_create(4 * 1024 * 1024);
+        history_arg_t a = { build_history(arena, 50), 0 };
+        run_history(&a);
+        bench_case_t c = { "ac_messages_to_json_string/150msg", run_history, &a, a.out_len, 150 };
+        bench_run(&c);
+        arena_destroy(arena);
+    }
+
+    /* Tool schema */
+    {
+        ac_session_t *session = ac_session_open();
+        ac_tool_registry_t *registry = ac_tool_registry_create(session);
+        for (int i = 0; i < 40; i++) {
+            char tool_name[32];
+            snprintf(tool_name, sizeof(tool_name), "tool_%02d", i);
+            ac_tool_t tool = {
+                .name = tool_name,
+                .description = "Search a file for a pattern and return matching lines with context",
+                .parameters = "{\"type\":\"object\",\"properties\":{"
+                              "\"path\":{\"type\":\"string\",\"description\":\"File to search\"},"
+                              "\"pattern\":{\"type\":\"string\",\"description\":\"Regex\"},"
+                              "\"context\":{\"type\":\"integer\",\"description\":\"Lines around\"}},"
+                              "\"required\":[\"path\",\"pattern\"]}",
+                .execute = noop_tool,
+            };
+            ac_tool_registry_add(registry, &tool);
+        }
+        schema_arg_t a = { registry, 0 };
+        run_schema(&a);
+        bench_case_t c = { "ac_tool_registry_schema/40tools", run_schema, &a, a.out_len, 40 };
+        bench_run(&c);
+        ac_session_close(session);
+    }
+    bench_footer();
+
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        free(raw[i].data);
+        free(replay[i].data);
+    }
+    free(resp_openai.data);
+    free(resp_anthropic.data);
+    return 0;
+}
@@ -0,0 +1,414 @@
+/**
+ * @file bench_pool.c
+ * @brief HTTP pool under contention
+ *
+ * Threads loop acquire -> request -> release on the shared pool
+ * (arc/http_pool.h) for a fixed time, over a grid of thread counts and
+ * max_connections sizes, each cell in its own process with a fresh pool.
+ * Requests go to mock_llm (a short non-streamed chat completion); with
+ * -H the client is held for a fixed time instead, which isolates the
+ * pool from the network.
+ *
+ * Reported per cell, from ac_http_pool_get_stats() unless noted:
+ * - ops/s          acquire/release cycles per second
+ * - p50/p99/max    acquire wait, upper bound of the histogram bucket
+ * - timeout%       acquires that gave up after -T ms
+ * - hit%           acquires served by an idle pooled client
+ * - contended%     acquires that found no idle client
+ * - reuse%         requests that did not open a connection (multiplexed
+ *                  pools, per-origin counters)
+ * - fairness       Jain's index over per-thread cycle counts (1 = even)
+ *
+ * Usage: bench_pool [-t threads,...] [-c connections,...] [-d ms] [-T ms]
+ *                   [-H us] [-u url] [-v] [-j]
+ */
+
+#include "arc/http_pool.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "bench_mock.h"
+#include "http_client.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_GRID     8
+#define MAX_THREADS  256
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+
+static struct {
+    int threads[MAX_GRID];
+    int thread_count;
+    int connections[MAX_GRID];
+    int connection_count;
+    int duration_ms;
+    int timeout_ms;
+    int hold_us;
+    char url[160];
+    int verbose;
+    int json;
+} s_cfg = {
+    .threads = { 1, 4, 16, 64 }, .thread_count = 4,
+    .connections = { 2, 8, 32 }, .connection_count = 3,
+    .duration_ms = 1000, .timeout_ms = 100,
+};
+
+typedef struct {
+    int threads;
+    int connections;
+    uint64_t cycles;
+    uint64_t failed_requests;
+    double seconds;
+    double fairness;
+    uint64_t min_cycles;             /* Slowest thread */
+    uint64_t max_cycles;             /* Fastest thread */
+    ac_http_pool_stats_t stats;
+    int ok;
+} cell_t;
+
+/*============================================================================
+ * Cell Run
+ *============================================================================*/
+
+static atomic_int s_stop;
+static pthread_barrier_t s_start;
+
+static const char s_body[] =
+    "{\"model\":\"bench\",\"max_tokens\":4,\"messages\":[{\"role\":\"user\",\"content\":\"hi\"}]}";
+
+typedef struct {
+    uint64_t cycles;
+    uint64_t failed;
+} thread_result_t;
+
+static void *worker(void *p) {
+    thread_result_t *res = (thread_result_t *)p;
+    arc_http_header_t *headers = arc_http_header_create("Content-Type", "application/json");
+    pthread_barrier_wait(&s_start);
+    while (!atomic_load_explicit(&s_stop, memory_order_relaxed)) {
+        arc_http_client_t *client = ac_http_pool_acquire((uint32_t)s_cfg.timeout_ms);
+        if (!client) {
+            continue;                /* Counted by the pool as a timeout */
+        }
+        if (s_cfg.hold_us) {
+            usleep((useconds_t)s_cfg.hold_us);
+        } else {
+            arc_http_request_t req = {
+                .url = s_cfg.url,
+                .method = ARC_HTTP_POST,
+                .headers = headers,
+                .body = s_body,
+                .timeout_ms = 10000,
+            };
+            arc_http_response_t resp;
+            memset(&resp, 0, sizeof(resp));
+            if (arc_http_request(client, &req, &resp) != ARC_OK || resp.status_code != 200) {
+                res->failed++;
+            }
+            arc_http_response_free(&resp);
+        }
+        ac_http_pool_release(client);
+        res->cycles++;
+    }
+    arc_http_header_free(headers);
+    return NULL;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void run_cell(cell_t *cell) {
+    ac_http_pool_config_t config = {
+        .max_connections = (size_t)cell->connections,
+        .acquire_timeout_ms = (uint32_t)s_cfg.timeout_ms,
+    };
+    if (ac_http_pool_init(&config) != ARC_OK) {
+        return;
+    }
+
+    static pthread_t threads[MAX_THREADS];
+    static thread_result_t results[MAX_THREADS];
+    pthread_barrier_init(&s_start, NULL, (unsigned)cell->threads + 1);
+    for (int i = 0; i < cell->threads; i++) {
+        pthread_create(&threads[i], NULL, worker, &results[i]);
+    }
+    pthread_barrier_wait(&s_start);
+    double t0 = now_s();
+    ac_platform_sleep_ms((uint32_t)s_cfg.duration_ms);
+    atomic_store(&s_stop, 1);
+    for (int i = 0; i < cell->threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    cell->seconds = now_s() - t0;
+    pthread_barrier_destroy(&s_start);
+
+    double sum = 0.0, sum_sq = 0.0;
+    cell->min_cycles = UINT64_MAX;
+    for (int i = 0; i < cell->threads; i++) {
+        uint64_t c = results[i].cycles;
+        cell->cycles += c;
+        cell->failed_requests += results[i].failed;
+        cell->min_cycles = c < cell->min_cycles ? c : cell->min_cycles;
+        cell->max_cycles = c > cell->max_cycles ? c : cell->max_cycles;
+        sum += (double)c;
+        sum_sq += (double)c * (double)c;
+    }
+    cell->fairness = sum_sq > 0.0 ? sum * sum / ((double)cell->threads * sum_sq) : 0.0;
+
+    ac_http_pool_get_stats(&cell->stats);
+    ac_http_pool_shutdown();
+    cell->ok = 1;
+}
+
+/**
+ * @brief Run a cell in a child process (fresh pool, no leftover threads)
+ */
+static void run_isolated(cell_t *cell) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        run_cell(cell);
+        ssize_t n = write(fds[1], cell, sizeof(*cell));
+        _exit(n == (ssize_t)sizeof(*cell) ? 0 : 1);
+    }
+    close(fds[1]);
+    cell_t out;
+    ssize_t n = pid > 0 ? read(fds[0], &out, sizeof(out)) : -1;
+    close(fds[0]);
+    if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    }
+    if (n == (ssize_t)sizeof(out)) {
+        *cell = out;
+    }
+}
+
+/*============================================================================
+ * Report
+ *============================================================================*/
+
+/** Upper bound in us of histogram bucket i (the last one is open) */
+static uint64_t bucket_us(int i) {
+    return i == 0 ? 1 : (uint64_t)1 << i;
+}
+
+static const char *latency_quantile(const ac_http_pool_stats_t *st, double q, char *buf,
+                                    size_t size) {
+    uint64_t total = 0;
+    for (int i = 0; i < AC_HTTP_POOL_LATENCY_BUCKETS; i++) {
+        total += st->acquire_latency[i];
+    }
+    if (!total) {
+        return "-";
+    }
+    uint64_t target = (uint64_t)(q * (double)total + 0.5);
+    uint64_t seen = 0;
+    for (int i = 0; i < AC_HTTP_POOL_LATENCY_BUCKETS; i++) {
+        seen += st->acquire_latency[i];
+        if (seen >= target && seen) {
+            if (i == AC_HTTP_POOL_LATENCY_BUCKETS - 1) {
+                snprintf(buf, size, ">%llu", (unsigned long long)bucket_us(i - 1));
+            } else {
+                snprintf(buf, size, "<%llu", (unsigned long long)bucket_us(i));
+            }
+            return buf;
+        }
+    }
+    return "-";
+}
+
+static double pct(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+/** Requests that found a connection already open (-1 = no per-origin data) */
+static double reuse_pct(const ac_http_pool_stats_t *st) {
+    uint64_t requests = 0, opened = 0;
+    for (size_t i = 0; i < st->origin_count; i++) {
+        requests += st->origins[i].total_requests;
+        opened += st->origins[i].connections_opened;
+    }
+    return requests ? 100.0 * (double)(requests - (opened < requests ? opened : requests)) /
+                      (double)requests
+                    : -1.0;
+}
+
+static void print_table(const cell_t *cells, int count) {
+    printf("# %d ms per cell, acquire timeout %d ms, %s\n", s_cfg.duration_ms, s_cfg.timeout_ms,
+           s_cfg.hold_us ? "clients held without requests" : "one request per acquire");
+    printf("%7s %5s %10s %9s %9s %9s %9s %6s %10s %7s %8s %6s\n", "threads", "conns", "ops/s",
+           "p50_us", "p99_us", "max_us", "timeout%", "hit%", "contended%", "reuse%", "fairness",
+           "failed");
+    for (int i = 0; i < count; i++) {
+        const cell_t *c = &cells[i];
+        if (!c->ok) {
+            printf("%7d %5d %10s\n", c->threads, c->connections, "error");
+            continue;
+        }
+        const ac_http_pool_stats_t *st = &c->stats;
+        char p50[24], p99[24], max[24];
+        double reuse = reuse_pct(st);
+        printf("%7d %5d %10.0f %9s %9s %9s %9.2f %6.1f %10.1f ", c->threads, c->connections,
+               (double)c->cycles / c->seconds, latency_quantile(st, 0.50, p50, sizeof(p50)),
+               latency_quantile(st, 0.99, p99, sizeof(p99)),
+               latency_quantile(st, 1.0, max, sizeof(max)), pct(st->timeouts, st->total_acquires),
+               pct(st->pool_hits, st->total_acquires),
+               pct(st->contended_acquires, st->total_acquires));
+        if (reuse < 0) {
+            printf("%7s", "-");
+        } else {
+            printf("%7.1f", reuse);
+        }
+        printf(" %8.3f %6llu\n", c->fairness, (unsigned long long)c->failed_requests);
+
+        if (s_cfg.verbose) {
+            for (int b = 0; b < AC_HTTP_POOL_LATENCY_BUCKETS; b++) {
+                if (st->acquire_latency[b]) {
+                    printf("        <%-9llu %llu\n", (unsigned long long)bucket_us(b),
+                           (unsigned long long)st->acquire_latency[b]);
+                }
+            }
+        }
+    }
+}
+
+static void print_json(const cell_t *cells, int count) {
+    printf("{\"duration_ms\":%d,\"timeout_ms\":%d,\"hold_us\":%d,\"cells\":[", s_cfg.duration_ms,
+           s_cfg.timeout_ms, s_cfg.hold_us);
+    int first = 1;
+    for (int i = 0; i < count; i++) {
+        const cell_t *c = &cells[i];
+        if (!c->ok) {
+            continue;
+        }
+        const ac_http_pool_stats_t *st = &c->stats;
+        printf("%s{\"threads\":%d,\"connections\":%d,\"ops_per_s\":%.1f,\"acquires\":%llu,"
+               "\"timeouts\":%llu,\"pool_hits\":%llu,\"contended\":%llu,\"reuse_pct\":%.1f,"
+               "\"fairness\":%.4f,\"min_cycles\":%llu,\"max_cycles\":%llu,\"failed\":%llu,"
+               "\"acquire_latency\":[", first ? "" : ",", c->threads, c->connections,
+               (double)c->cycles / c->seconds, (unsigned long long)st->total_acquires,
+               (unsigned long long)st->timeouts, (unsigned long long)st->pool_hits,
+               (unsigned long long)st->contended_acquires, reuse_pct(st), c->fairness,
+               (unsigned long long)c->min_cycles, (unsigned long long)c->max_cycles,
+               (unsigned long long)c->failed_requests);
+        for (int b = 0; b < AC_HTTP_POOL_LATENCY_BUCKETS; b++) {
+            printf("%s%llu", b ? "," : "", (unsigned long long)st->acquire_latency[b]);
+        }
+        printf("]}");
+        first = 0;
+    }
+    printf("]}\n");
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+static int parse_list(const char *arg, int *out, int *count, int max_value) {
+    *count = 0;
+    while (*arg && *count < MAX_GRID) {
+        char *end;
+        long v = strtol(arg, &end, 10);
+        if (end == arg || v < 1 || v > max_value) {
+            return -1;
+        }
+        out[(*count)++] = (int)v;
+        arg = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') {
+            return -1;
+        }
+    }
+    return *count ? 0 : -1;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n\n"
+           "  -t <n,...>  Thread counts (default 1,4,16,64, max %d)\n"
+           "  -c <n,...>  max_connections sizes (default 2,8,32)\n"
+           "  -d <ms>     Duration per cell (default 1000)\n"
+           "  -T <ms>     Acquire timeout (default 100)\n"
+           "  -H <us>     Hold each client this long instead of sending a request\n"
+           "  -u <url>    Request URL (default: a mock_llm started for the run)\n"
+           "  -v          Print the acquire wait histogram of each cell\n"
+           "  -j          Print a JSON report\n"
+           "  -h          Show this help message\n", prog, MAX_THREADS);
+}
+
+int main(int argc, char **argv) {
+    int c;
+    while ((c = getopt(argc, argv, "t:c:d:T:H:u:vjh")) != -1) {
+        switch (c) {
+        case 't':
+            if (parse_list(optarg, s_cfg.threads, &s_cfg.thread_count, MAX_THREADS) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'c':
+            if (parse_list(optarg, s_cfg.connections, &s_cfg.connection_count, 4096) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'd': s_cfg.duration_ms = atoi(optarg); break;
+        case 'T': s_cfg.timeout_ms = atoi(optarg); break;
+        case 'H': s_cfg.hold_us = atoi(optarg); break;
+        case 'u': snprintf(s_cfg.url, sizeof(s_cfg.url), "%s", optarg); break;
+        case 'v': s_cfg.verbose = 1; break;
+        case 'j': s_cfg.json = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    ac_log_set_level(AC_LOG_LEVEL_ERROR);
+
+    int started = 0;
+    if (!s_cfg.hold_us && !s_cfg.url[0]) {
+        int port = bench_mock_start((const char *const[]){ "-n", "4", NULL });
+        if (port < 0) {
+            fprintf(stderr, "bench_pool: cannot start mock_llm (build tools, pass -u or -H)\n");
+            return 1;
+        }
+        snprintf(s_cfg.url, sizeof(s_cfg.url), "http://127.0.0.1:%d/v1/chat/completions", port);
+        started = 1;
+    }
+
+    cell_t cells[MAX_GRID * MAX_GRID];
+    int count = 0;
+    for (int t = 0; t < s_cfg.thread_count; t++) {
+        for (int k = 0; k < s_cfg.connection_count; k++) {
+            cell_t *cell = &cells[count++];
+            memset(cell, 0, sizeof(*cell));
+            cell->threads = s_cfg.threads[t];
+            cell->connections = s_cfg.connections[k];
+            run_isolated(cell);
+        }
+    }
+    if (started) {
+        bench_mock_stop();
+    }
+
+    if (s_cfg.json) {
+        print_json(cells, count);
+    } else {
+        print_table(cells, count);
+    }
+    return 0;
+}
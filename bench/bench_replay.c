@@ -0,0 +1,709 @@
+/**
+ * @file bench_replay.c
+ * @brief Trace-driven workload replay against mock_llm
+ *
+ * Reads the files written by the JSON trace exporter
+ * (arc/trace_exporters.h, one file per agent run) and plays the same
+ * workload shape back against mock_llm:
+ *
+ * - arrivals       every run starts at its recorded offset from the
+ *                  first one, on its own thread, so runs overlap as
+ *                  they did
+ * - message sizes  each LLM call sends a request body of the recorded
+ *                  history size (messages + tool schema) and asks for
+ *                  the recorded completion tokens as max_tokens;
+ *                  streamed calls are streamed
+ * - tool latencies the time between a response and the next request of
+ *                  the run (tool calls, hooks, agent work) is slept;
+ *                  recorded tool time is reported next to it
+ * - concurrency    follows from the above; peak runs and peak LLM calls
+ *                  in flight are reported for both sides
+ *
+ * Within a run the calls stay closed-loop: the next request waits for
+ * the previous response, so a slower server shows up as drift (request
+ * issued later than scheduled) rather than as a reordered workload.
+ * -x divides every recorded interval, 2 replays twice as fast. With -L
+ * each call is held to its recorded (scaled) latency, so a fast mock
+ * still reproduces the recorded occupancy; otherwise latency is whatever
+ * mock_llm is told to produce (-t, -r).
+ *
+ * The wire format is always OpenAI chat completions: what is replayed
+ * is sizes and timing, not the recorded provider or content. Calls whose
+ * history was not sampled are sized from the recorded prompt tokens.
+ *
+ * Usage: bench_replay [-x scale] [-L] [-t ttft_ms] [-r tok/s] [-u url]
+ *                     [-v] [-j] trace.json|dir ...
+ */
+
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "bench_mock.h"
+#include "cJSON.h"
+#include "http_client.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+
+static struct {
+    double scale;
+    int hold_latency;
+    int ttft_ms;
+    int rate;
+    char url[160];
+    int verbose;
+    int json;
+} s_cfg = {
+    .scale = 1.0,
+};
+
+/*============================================================================
+ * Workload
+ *============================================================================*/
+
+typedef struct {
+    uint64_t start_ms;               /* Request, from run start */
+    uint64_t end_ms;                 /* Response, from run start */
+    uint64_t duration_ms;            /* Recorded LLM latency */
+    size_t bytes;                    /* Request history size */
+    int completion_tokens;
+    int stream;
+    char model[64];
+} call_t;
+
+typedef struct {
+    char name[96];
+    uint64_t start_ms;               /* Absolute (exporter clock) */
+    uint64_t duration_ms;
+    call_t *calls;
+    int call_count;
+    int tool_calls;
+    uint64_t tool_ms;                /* Sum of recorded tool durations */
+
+    /* Replay results */
+    double lag_ms;                   /* Start later than scheduled */
+    double *latency_ms;              /* Per call */
+    double *drift_ms;                /* Per call: issued later than scheduled */
+    double end_s;                    /* Replay finish, from replay start */
+    double gap_s;                    /* Slept between responses and requests */
+    int failed;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+} run_t;
+
+static run_t *s_runs;
+static int s_run_count;
+
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    if (data) {
+        data[size] = '\0';
+    }
+    fclose(f);
+    return data;
+}
+
+static uint64_t number(const cJSON *obj, const char *key) {
+    const cJSON *item = cJSON_GetObjectItem(obj, key);
+    return cJSON_IsNumber(item) && item->valuedouble > 0 ? (uint64_t)item->valuedouble : 0;
+}
+
+static size_t printed_size(const cJSON *item) {
+    if (!item || cJSON_IsNull(item)) {
+        return 0;
+    }
+    char *text = cJSON_PrintUnformatted(item);
+    size_t n = text ? strlen(text) : 0;
+    cJSON_free(text);
+    return n;
+}
+
+/**
+ * @brief Turn one exported run into a call list
+ *
+ * With delta history sampling a request carries only the messages added
+ * since the previous one (message_offset > 0), so sizes accumulate.
+ */
+static int load_run(const char *path, run_t *run) {
+    char *text = read_file(path);
+    cJSON *root = text ? cJSON_Parse(text) : NULL;
+    free(text);
+    const cJSON *events = cJSON_GetObjectItem(root, "events");
+    if (!cJSON_IsArray(events)) {
+        cJSON_Delete(root);
+        return -1;
+    }
+
+    memset(run, 0, sizeof(*run));
+    const cJSON *agent = cJSON_GetObjectItem(root, "agent_name");
+    const char *base = strrchr(path, '/');
+    snprintf(run->name, sizeof(run->name), "%s",
+             cJSON_IsString(agent) ? agent->valuestring : base ? base + 1 : path);
+
+    int capacity = 0;
+    size_t history = 0, tools = 0;
+    uint64_t last_ms = 0;
+    const cJSON *ev;
+    cJSON_ArrayForEach(ev, events) {
+        const cJSON *type = cJSON_GetObjectItem(ev, "type");
+        const cJSON *data = cJSON_GetObjectItem(ev, "data");
+        uint64_t ts = number(ev, "timestamp_ms");
+        if (!cJSON_IsString(type)) {
+            continue;
+        }
+        if (!run->start_ms) {
+            run->start_ms = ts;
+        }
+        uint64_t at = ts > run->start_ms ? ts - run->start_ms : 0;
+        last_ms = at > last_ms ? at : last_ms;
+
+        if (strcmp(type->valuestring, "llm_request") == 0) {
+            if (run->call_count == capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                call_t *grown = realloc(run->calls, (size_t)capacity * sizeof(call_t));
+                if (!grown) {
+                    break;
+                }
+                run->calls = grown;
+            }
+            const cJSON *messages = cJSON_GetObjectItem(data, "messages");
+            size_t size = printed_size(messages);
+            history = number(data, "message_offset") > 0 ? history + size : size;
+            if (!tools) {
+                tools = printed_size(cJSON_GetObjectItem(data, "tools"));
+            }
+            call_t *call = &run->calls[run->call_count++];
+            memset(call, 0, sizeof(*call));
+            call->start_ms = at;
+            call->end_ms = at;
+            call->bytes = cJSON_IsArray(messages) ? history + tools : 0;
+            const cJSON *model = cJSON_GetObjectItem(data, "model");
+            snprintf(call->model, sizeof(call->model), "%s",
+                     cJSON_IsString(model) ? model->valuestring : "replay");
+        } else if (strcmp(type->valuestring, "llm_response") == 0 && run->call_count) {
+            call_t *call = &run->calls[run->call_count - 1];
+            call->end_ms = at;
+            call->duration_ms = number(data, "duration_ms");
+            call->completion_tokens = (int)number(data, "completion_tokens");
+            if (!call->bytes) {
+                call->bytes = (size_t)number(data, "prompt_tokens") * 4;
+            }
+            call->stream = number(cJSON_GetObjectItem(data, "timing"), "deltas") > 0;
+        } else if (strcmp(type->valuestring, "tool_end") == 0) {
+            run->tool_calls++;
+            run->tool_ms += number(data, "duration_ms");
+        }
+    }
+    run->duration_ms = last_ms;
+    cJSON_Delete(root);
+    return run->call_count ? 0 : -1;
+}
+
+static int has_suffix(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static void add_run(const char *path) {
+    run_t run;
+    if (load_run(path, &run) != 0) {
+        if (s_cfg.verbose) {
+            fprintf(stderr, "bench_replay: %s: no LLM calls, skipped\n", path);
+        }
+        return;
+    }
+    run_t *grown = realloc(s_runs, (size_t)(s_run_count + 1) * sizeof(run_t));
+    if (!grown) {
+        free(run.calls);
+        return;
+    }
+    s_runs = grown;
+    s_runs[s_run_count++] = run;
+}
+
+static void add_path(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        add_run(path);
+        return;
+    }
+    DIR *dir = opendir(path);
+    struct dirent *de;
+    while (dir && (de = readdir(dir)) != NULL) {
+        if (has_suffix(de->d_name, ".json")) {
+            char full[1024];
+            snprintf(full, sizeof(full), "%s/%s", path, de->d_name);
+            add_run(full);
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+}
+
+static int by_start(const void *a, const void *b) {
+    uint64_t x = ((const run_t *)a)->start_ms, y = ((const run_t *)b)->start_ms;
+    return x < y ? -1 : x > y;
+}
+
+/*============================================================================
+ * Replay
+ *============================================================================*/
+
+static double s_t0;                  /* Replay start (monotonic s) */
+static uint64_t s_first_ms;          /* Earliest recorded run start */
+static atomic_int s_active_runs, s_peak_runs;
+static atomic_int s_inflight, s_peak_inflight;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void sleep_until(double t) {
+    double d = t - now_s();
+    if (d > 0) {
+        struct timespec ts = { (time_t)d, (long)((d - (double)(time_t)d) * 1e9) };
+        while (nanosleep(&ts, &ts) != 0) {
+        }
+    }
+}
+
+static void enter(atomic_int *count, atomic_int *peak) {
+    int n = atomic_fetch_add(count, 1) + 1;
+    int p = atomic_load(peak);
+    while (n > p && !atomic_compare_exchange_weak(peak, &p, n)) {
+    }
+}
+
+static int count_bytes(const char *data, size_t len, void *user_data) {
+    (void)data;
+    *(uint64_t *)user_data += len;
+    return 0;
+}
+
+static char *build_body(const call_t *call, size_t *len) {
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "{\"model\":\"%s\",\"max_tokens\":%d,\"stream\":%s,"
+                     "\"messages\":[{\"role\":\"user\",\"content\":\"",
+                     call->model, call->completion_tokens > 0 ? call->completion_tokens : 1,
+                     call->stream ? "true" : "false");
+    static const char tail[] = "\"}]}";
+    size_t size = (size_t)n + sizeof(tail) - 1;
+    size = call->bytes > size ? call->bytes : size;
+    char *body = malloc(size + 1);
+    if (!body) {
+        return NULL;
+    }
+    memcpy(body, head, (size_t)n);
+    memset(body + n, 'x', size - (size_t)n - (sizeof(tail) - 1));
+    memcpy(body + size - (sizeof(tail) - 1), tail, sizeof(tail));
+    *len = size;
+    return body;
+}
+
+static void *run_thread(void *p) {
+    run_t *run = (run_t *)p;
+    double scheduled = s_t0 + (double)(run->start_ms - s_first_ms) / 1000.0 / s_cfg.scale;
+    sleep_until(scheduled);
+    double start = now_s();
+    run->lag_ms = (start - scheduled) * 1000.0;
+    enter(&s_active_runs, &s_peak_runs);
+
+    arc_http_client_t *client = NULL;
+    arc_http_header_t *headers = arc_http_header_create("Content-Type", "application/json");
+    if (arc_http_client_create(NULL, &client) != ARC_OK) {
+        run->failed = run->call_count;
+    }
+
+    /* Closed loop: each gap is slept after the previous response */
+    double prev_end = start;
+    uint64_t prev_end_ms = 0;
+    for (int i = 0; client && i < run->call_count; i++) {
+        const call_t *call = &run->calls[i];
+        uint64_t gap = call->start_ms > prev_end_ms ? call->start_ms - prev_end_ms : 0;
+        sleep_until(prev_end + (double)gap / 1000.0 / s_cfg.scale);
+        run->gap_s += now_s() - prev_end;
+
+        size_t len = 0;
+        char *body = build_body(call, &len);
+        double issued = now_s();
+        run->drift_ms[i] = (issued - start - (double)call->start_ms / 1000.0 / s_cfg.scale) * 1000.0;
+        enter(&s_inflight, &s_peak_inflight);
+
+        arc_http_response_t resp;
+        memset(&resp, 0, sizeof(resp));
+        arc_http_request_t req = {
+            .url = s_cfg.url,
+            .method = ARC_HTTP_POST,
+            .headers = headers,
+            .body = body,
+            .body_len = len,
+            .timeout_ms = 60000,
+        };
+        uint64_t received = 0;
+        arc_err_t err;
+        if (call->stream) {
+            arc_http_stream_request_t sreq = { .base = req, .on_data = count_bytes,
+                                               .user_data = &received };
+            err = body ? arc_http_request_stream(client, &sreq, &resp) : ARC_ERR_NO_MEMORY;
+        } else {
+            err = body ? arc_http_request(client, &req, &resp) : ARC_ERR_NO_MEMORY;
+            received = resp.body_len;
+        }
+        if (err != ARC_OK || resp.status_code != 200) {
+            run->failed++;
+        }
+        arc_http_response_free(&resp);
+        free(body);
+        run->bytes_sent += len;
+        run->bytes_received += received;
+
+        if (s_cfg.hold_latency) {
+            sleep_until(issued + (double)call->duration_ms / 1000.0 / s_cfg.scale);
+        }
+        prev_end = now_s();
+        run->latency_ms[i] = (prev_end - issued) * 1000.0;
+        atomic_fetch_sub(&s_inflight, 1);
+        prev_end_ms = call->end_ms;
+    }
+
+    /* Whatever followed the last response (final tools, agent_end) */
+    if (run->duration_ms > prev_end_ms) {
+        sleep_until(prev_end + (double)(run->duration_ms - prev_end_ms) / 1000.0 / s_cfg.scale);
+    }
+    run->gap_s += now_s() - prev_end;
+    atomic_fetch_sub(&s_active_runs, 1);
+    run->end_s = now_s() - s_t0;
+    arc_http_header_free(headers);
+    if (client) {
+        arc_http_client_destroy(client);
+    }
+    return NULL;
+}
+
+/*============================================================================
+ * Report
+ *============================================================================*/
+
+typedef struct {
+    double at;
+    int delta;
+} edge_t;
+
+static int by_edge(const void *a, const void *b) {
+    const edge_t *x = a, *y = b;
+    if (x->at != y->at) {
+        return x->at < y->at ? -1 : 1;
+    }
+    return x->delta - y->delta;      /* Ends before starts at the same time */
+}
+
+/** Peak number of overlapping [start, end] intervals */
+static int peak_overlap(edge_t *edges, int count) {
+    qsort(edges, (size_t)count, sizeof(edge_t), by_edge);
+    int cur = 0, peak = 0;
+    for (int i = 0; i < count; i++) {
+        cur += edges[i].delta;
+        peak = cur > peak ? cur : peak;
+    }
+    return peak;
+}
+
+static int by_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double quantile(double *v, int n, double q) {
+    if (n == 0) {
+        return 0.0;
+    }
+    qsort(v, (size_t)n, sizeof(double), by_double);
+    int i = (int)(q * (double)(n - 1) + 0.5);
+    return v[i];
+}
+
+typedef struct {
+    double span_s;
+    int peak_runs;
+    int peak_inflight;
+    int calls;
+    double llm_p50, llm_p99;
+    double kb_per_call;
+    int tool_calls;
+    double tool_s;
+    double gap_s;
+    /* Replay only */
+    double lag_p50, lag_p99, lag_max;
+    double drift_p50, drift_p99, drift_max;
+    int failed;
+} summary_t;
+
+static void summarize(summary_t *rec, summary_t *rep) {
+    memset(rec, 0, sizeof(*rec));
+    memset(rep, 0, sizeof(*rep));
+    int calls = 0;
+    for (int i = 0; i < s_run_count; i++) {
+        calls += s_runs[i].call_count;
+    }
+    double *rl = malloc(sizeof(double) * (size_t)(calls + 1));
+    double *pl = malloc(sizeof(double) * (size_t)(calls + 1));
+    double *dr = malloc(sizeof(double) * (size_t)(calls + 1));
+    double *lag = malloc(sizeof(double) * (size_t)(s_run_count + 1));
+    edge_t *runs = malloc(sizeof(edge_t) * (size_t)(2 * s_run_count + 1));
+    edge_t *inflight = malloc(sizeof(edge_t) * (size_t)(2 * calls + 1));
+    if (!rl || !pl || !dr || !lag || !runs || !inflight) {
+        goto done;
+    }
+
+    uint64_t bytes = 0, sent = 0;
+    int k = 0, e = 0;
+    for (int i = 0; i < s_run_count; i++) {
+        const run_t *r = &s_runs[i];
+        double start = (double)(r->start_ms - s_first_ms) / 1000.0 / s_cfg.scale;
+        double end = start + (double)r->duration_ms / 1000.0 / s_cfg.scale;
+        runs[2 * i] = (edge_t){ start, 1 };
+        runs[2 * i + 1] = (edge_t){ end, -1 };
+        rec->span_s = end > rec->span_s ? end : rec->span_s;
+        rep->span_s = r->end_s > rep->span_s ? r->end_s : rep->span_s;
+        rec->tool_calls += r->tool_calls;
+        rec->tool_s += (double)r->tool_ms / 1000.0 / s_cfg.scale;
+        rep->gap_s += r->gap_s;
+        uint64_t prev_end_ms = 0;
+        lag[i] = r->lag_ms;
+        rep->failed += r->failed;
+        sent += r->bytes_sent;
+        for (int c = 0; c < r->call_count; c++, k++) {
+            const call_t *call = &r->calls[c];
+            rl[k] = (double)call->duration_ms / s_cfg.scale;
+            pl[k] = r->latency_ms[c];
+            dr[k] = r->drift_ms[c];
+            bytes += call->bytes;
+            inflight[e++] = (edge_t){ start + (double)call->start_ms / 1000.0 / s_cfg.scale, 1 };
+            inflight[e++] = (edge_t){ start + (double)call->end_ms / 1000.0 / s_cfg.scale, -1 };
+            rec->gap_s += call->start_ms > prev_end_ms ? (double)(call->start_ms - prev_end_ms) : 0.0;
+            prev_end_ms = call->end_ms;
+        }
+        rec->gap_s += r->duration_ms > prev_end_ms ? (double)(r->duration_ms - prev_end_ms) : 0.0;
+    }
+    rec->calls = rep->calls = calls;
+    rec->peak_runs = peak_overlap(runs, 2 * s_run_count);
+    rec->peak_inflight = peak_overlap(inflight, e);
+    rep->peak_runs = atomic_load(&s_peak_runs);
+    rep->peak_inflight = atomic_load(&s_peak_inflight);
+    rec->kb_per_call = calls ? (double)bytes / 1024.0 / calls : 0.0;
+    rep->kb_per_call = calls ? (double)sent / 1024.0 / calls : 0.0;
+    rec->gap_s /= 1000.0 * s_cfg.scale;
+    rec->llm_p50 = quantile(rl, calls, 0.50);
+    rec->llm_p99 = quantile(rl, calls, 0.99);
+    rep->llm_p50 = quantile(pl, calls, 0.50);
+    rep->llm_p99 = quantile(pl, calls, 0.99);
+    rep->lag_p50 = quantile(lag, s_run_count, 0.50);
+    rep->lag_p99 = quantile(lag, s_run_count, 0.99);
+    rep->lag_max = quantile(lag, s_run_count, 1.0);
+    rep->drift_p50 = quantile(dr, calls, 0.50);
+    rep->drift_p99 = quantile(dr, calls, 0.99);
+    rep->drift_max = quantile(dr, calls, 1.0);
+
+done:
+    free(rl);
+    free(pl);
+    free(dr);
+    free(lag);
+    free(runs);
+    free(inflight);
+}
+
+static void print_table(const summary_t *rec, const summary_t *rep) {
+    printf("# %d runs, time scale x%g, %s\n", s_run_count, s_cfg.scale,
+           s_cfg.hold_latency ? "LLM latency held to the recording"
+                              : "LLM latency from the server");
+    printf("# recorded times are divided by the scale\n");
+    printf("%-16s %12s %12s\n", "", "recorded", "replayed");
+    printf("%-16s %12.2f %12.2f\n", "span_s", rec->span_s, rep->span_s);
+    printf("%-16s %12d %12d\n", "peak_runs", rec->peak_runs, rep->peak_runs);
+    printf("%-16s %12d %12d\n", "peak_llm", rec->peak_inflight, rep->peak_inflight);
+    printf("%-16s %12d %12d\n", "llm_calls", rec->calls, rep->calls);
+    printf("%-16s %12.1f %12.1f\n", "llm_p50_ms", rec->llm_p50, rep->llm_p50);
+    printf("%-16s %12.1f %12.1f\n", "llm_p99_ms", rec->llm_p99, rep->llm_p99);
+    printf("%-16s %12.1f %12.1f\n", "kb_per_call", rec->kb_per_call, rep->kb_per_call);
+    printf("%-16s %12d %12s\n", "tool_calls", rec->tool_calls, "-");
+    printf("%-16s %12.2f %12s\n", "tool_s", rec->tool_s, "-");
+    printf("%-16s %12.2f %12.2f\n", "gap_s", rec->gap_s, rep->gap_s);
+    printf("%-16s %12s %5.1f/%.1f/%.1f\n", "lag_ms", "-", rep->lag_p50, rep->lag_p99,
+           rep->lag_max);
+    printf("%-16s %12s %5.1f/%.1f/%.1f\n", "drift_ms", "-", rep->drift_p50, rep->drift_p99,
+           rep->drift_max);
+    printf("%-16s %12s %12d\n", "failed", "-", rep->failed);
+
+    if (s_cfg.verbose) {
+        printf("\n%-24s %8s %6s %6s %10s %10s\n", "run", "start_s", "calls", "tools", "lag_ms",
+               "end_s");
+        for (int i = 0; i < s_run_count; i++) {
+            const run_t *r = &s_runs[i];
+            printf("%-24.24s %8.2f %6d %6d %10.1f %10.2f\n", r->name,
+                   (double)(r->start_ms - s_first_ms) / 1000.0 / s_cfg.scale, r->call_count,
+                   r->tool_calls, r->lag_ms, r->end_s);
+        }
+    }
+}
+
+static void print_side(const char *name, const summary_t *s, int replay) {
+    printf("\"%s\":{\"span_s\":%.3f,\"peak_runs\":%d,\"peak_llm\":%d,\"llm_calls\":%d,"
+           "\"llm_p50_ms\":%.2f,\"llm_p99_ms\":%.2f,\"kb_per_call\":%.2f,\"gap_s\":%.3f",
+           name, s->span_s, s->peak_runs, s->peak_inflight, s->calls, s->llm_p50, s->llm_p99,
+           s->kb_per_call, s->gap_s);
+    if (!replay) {
+        printf(",\"tool_calls\":%d,\"tool_s\":%.3f", s->tool_calls, s->tool_s);
+    } else {
+        printf(",\"lag_ms\":[%.2f,%.2f,%.2f],\"drift_ms\":[%.2f,%.2f,%.2f],\"failed\":%d",
+               s->lag_p50, s->lag_p99, s->lag_max, s->drift_p50, s->drift_p99, s->drift_max,
+               s->failed);
+    }
+    printf("}");
+}
+
+static void print_json(const summary_t *rec, const summary_t *rep) {
+    printf("{\"runs\":%d,\"scale\":%g,\"hold_latency\":%d,", s_run_count, s_cfg.scale,
+           s_cfg.hold_latency);
+    print_side("recorded", rec, 0);
+    printf(",");
+    print_side("replayed", rep, 1);
+    printf("}\n");
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options] trace.json|dir ...\n\n"
+           "Replays runs written by the JSON trace exporter against mock_llm.\n\n"
+           "  -x <scale>  Time scale: recorded intervals are divided by it (default 1)\n"
+           "  -L          Hold each LLM call to its recorded latency\n"
+           "  -t <ms>     mock_llm time to first token (default 0)\n"
+           "  -r <tok/s>  mock_llm tokens per second (default 0 = no delay)\n"
+           "  -u <url>    Chat completions URL (default: a mock_llm started for the run)\n"
+           "  -v          Per-run lines; report skipped files\n"
+           "  -j          Print a JSON report\n"
+           "  -h          Show this help message\n", prog);
+}
+
+int main(int argc, char **argv) {
+    int c;
+    while ((c = getopt(argc, argv, "x:Lt:r:u:vjh")) != -1) {
+        switch (c) {
+        case 'x': s_cfg.scale = atof(optarg); break;
+        case 'L': s_cfg.hold_latency = 1; break;
+        case 't': s_cfg.ttft_ms = atoi(optarg); break;
+        case 'r': s_cfg.rate = atoi(optarg); break;
+        case 'u': snprintf(s_cfg.url, sizeof(s_cfg.url), "%s", optarg); break;
+        case 'v': s_cfg.verbose = 1; break;
+        case 'j': s_cfg.json = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind >= argc || s_cfg.scale <= 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+    ac_log_set_level(AC_LOG_LEVEL_ERROR);
+
+    for (int i = optind; i < argc; i++) {
+        add_path(argv[i]);
+    }
+    if (!s_run_count) {
+        fprintf(stderr, "bench_replay: no runs with LLM calls in the given traces\n");
+        return 1;
+    }
+    qsort(s_runs, (size_t)s_run_count, sizeof(run_t), by_start);
+    s_first_ms = s_runs[0].start_ms;
+    for (int i = 0; i < s_run_count; i++) {
+        s_runs[i].latency_ms = calloc((size_t)s_runs[i].call_count, sizeof(double));
+        s_runs[i].drift_ms = calloc((size_t)s_runs[i].call_count, sizeof(double));
+        if (!s_runs[i].latency_ms || !s_runs[i].drift_ms) {
+            fprintf(stderr, "bench_replay: out of memory\n");
+            return 1;
+        }
+    }
+
+    int started = 0;
+    if (!s_cfg.url[0]) {
+        char ttft[16], rate[16];
+        snprintf(ttft, sizeof(ttft), "%d", s_cfg.ttft_ms);
+        snprintf(rate, sizeof(rate), "%d", s_cfg.rate);
+        /* Reply length comes from each request's max_tokens */
+        int port = bench_mock_start(
+            (const char *const[]){ "-n", "1000000", "-t", ttft, "-r", rate, NULL });
+        if (port < 0) {
+            fprintf(stderr, "bench_replay: cannot start mock_llm (build tools or pass -u)\n");
+            return 1;
+        }
+        snprintf(s_cfg.url, sizeof(s_cfg.url), "http://127.0.0.1:%d/v1/chat/completions", port);
+        started = 1;
+    }
+
+    /* One thread per run; each sleeps until its own arrival time */
+    pthread_t *threads = calloc((size_t)s_run_count, sizeof(pthread_t));
+    if (!threads) {
+        return 1;
+    }
+    s_t0 = now_s() + 0.05;
+    int created = 0;
+    for (int i = 0; i < s_run_count; i++, created++) {
+        sleep_until(s_t0 + (double)(s_runs[i].start_ms - s_first_ms) / 1000.0 / s_cfg.scale -
+                    0.01);
+        if (pthread_create(&threads[i], NULL, run_thread, &s_runs[i]) != 0) {
+            fprintf(stderr, "bench_replay: cannot start run %d\n", i);
+            break;
+        }
+    }
+    for (int i = 0; i < created; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    if (started) {
+        bench_mock_stop();
+    }
+
+    summary_t rec, rep;
+    summarize(&rec, &rep);
+    if (s_cfg.json) {
+        print_json(&rec, &rep);
+    } else {
+        print_table(&rec, &rep);
+    }
+    for (int i = 0; i < s_run_count; i++) {
+        free(s_runs[i].calls);
+        free(s_runs[i].latency_ms);
+        free(s_runs[i].drift_ms);
+    }
+    free(s_runs);
+    return rep.failed ? 1 : 0;
+}
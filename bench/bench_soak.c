@@ -0,0 +1,436 @@
+/**
+ * @file bench_soak.c
+ * @brief Long-session soak: memory growth and latency drift
+ *
+ * Drives one agent through thousands of user turns against mock_llm
+ * (started with a per-turn script: a tool call returning a large result,
+ * then the answer), keeping the conversation, and samples at intervals:
+ *
+ * - rss_kb         resident set size
+ * - arena_kb       bytes allocated in the agent arena (capacity in
+ *                  brackets)
+ * - msgs           messages sent with the last request
+ * - body_kb        request body bytes per turn
+ * - ser_us         time building request bodies per turn (arc/profile.h)
+ * - ovh_us         loop time outside network and connect per turn
+ *
+ * Window values are means over the turns since the previous sample. At
+ * the end each series is fitted to turn^k over the second half of the
+ * run. State (rss, arena) is flagged when it grows faster than linearly
+ * (k > 1.1), or grows at all (k > 0.25) while the history sent stays
+ * flat: memory the compaction does not give back. Per-turn costs are
+ * flagged when they keep growing (k > 0.25), since that makes the
+ * session's total cost superlinear. The exit status is 2 when anything
+ * is flagged.
+ *
+ * With history limits (-M, -K, -B; 32000 tokens by default) sizes should
+ * level off; with -K 0 expect body_kb and ser_us to grow linearly, and
+ * the run to slow down accordingly.
+ *
+ * Usage: bench_soak [-n turns] [-R result_bytes] [-i interval] [-M max_messages]
+ *                   [-K max_tokens] [-B max_tool_bytes] [-P provider] [-s]
+ *                   [-u api_base] [-j]
+ */
+
+#include "arc/agent.h"
+#include "arc/agent_hooks.h"
+#include "arc/allocator.h"
+#include "arc/log.h"
+#include "arc/profile.h"
+#include "arc/session.h"
+#include "arc/tool.h"
+#include "bench_mock.h"
+#include "http_client.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+
+static struct {
+    int turns;
+    size_t result_bytes;
+    int interval;
+    size_t max_messages;
+    size_t max_tokens;
+    size_t max_tool_bytes;
+    const char *provider;
+    int stream;
+    char api_base[128];
+    int json;
+} s_cfg = { .turns = 2000, .result_bytes = 4096, .max_tokens = 32000, .provider = "openai" };
+
+/*============================================================================
+ * Measurement
+ *============================================================================*/
+
+enum { M_RSS, M_ARENA, M_MSGS, M_BODY, M_SER, M_OVH, M_COUNT };
+
+static const struct {
+    const char *name;
+    int per_turn;                    /* Cost per turn (else state size) */
+} s_metrics[M_COUNT] = {
+    { "rss_kb", 0 }, { "arena_kb", 0 }, { "msgs", 0 },
+    { "body_kb", 1 }, { "ser_us", 1 }, { "ovh_us", 1 },
+};
+
+typedef struct {
+    int turn;
+    double value[M_COUNT];
+    double arena_capacity_kb;
+} sample_t;
+
+/* Accumulated by the hooks and profiler since the last sample */
+static struct {
+    uint64_t serialize_us;
+    uint64_t overhead_us;
+    size_t message_count;
+    size_t arena_allocated;
+    size_t arena_capacity;
+} s_window;
+
+static void on_iteration(void *ctx, const ac_prof_iteration_t *it) {
+    (void)ctx;
+    uint64_t waiting = it->phase_us[AC_PROF_NETWORK] + it->phase_us[AC_PROF_CONNECT];
+    s_window.serialize_us += it->phase_us[AC_PROF_SERIALIZE];
+    s_window.overhead_us += it->total_us > waiting ? it->total_us - waiting : 0;
+}
+
+static void on_llm_request(void *ctx, const ac_hook_llm_request_t *info) {
+    (void)ctx;
+    s_window.message_count = info->message_count;
+}
+
+static void on_run_end(void *ctx, const ac_hook_run_end_t *info) {
+    (void)ctx;
+    if (info->arena) {
+        s_window.arena_allocated = info->arena->total_allocated;
+        s_window.arena_capacity = info->arena->total_capacity;
+    }
+}
+
+static long rss_kb(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    long pages = 0, resident = 0;
+    if (f) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(f);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * @brief Exponent k of value ~ turn^k, least squares on the second half
+ */
+static double growth_exponent(const sample_t *samples, int count, int metric) {
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int n = 0;
+    for (int i = count / 2; i < count; i++) {
+        double v = samples[i].value[metric];
+        if (v <= 0 || samples[i].turn <= 0) {
+            continue;
+        }
+        double x = log((double)samples[i].turn);
+        double y = log(v);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        n++;
+    }
+    double d = (double)n * sxx - sx * sx;
+    return n >= 3 && d > 0 ? ((double)n * sxy - sx * sy) / d : 0.0;
+}
+
+typedef enum { FLAG_NONE, FLAG_SUPERLINEAR, FLAG_RETAINED, FLAG_GROWING } flag_t;
+
+static const char *const s_flag_names[] = {
+    "", "SUPERLINEAR", "RETAINED (history is flat)", "GROWING (total cost superlinear)",
+};
+
+/**
+ * @param history_k  Exponent of the message count
+ */
+static flag_t flag_of(int metric, double k, double history_k) {
+    if (s_metrics[metric].per_turn) {
+        return k > 0.25 ? FLAG_GROWING : FLAG_NONE;
+    }
+    if (k > 1.1) {
+        return FLAG_SUPERLINEAR;
+    }
+    return metric != M_MSGS && history_k < 0.1 && k > 0.25 ? FLAG_RETAINED : FLAG_NONE;
+}
+
+/*============================================================================
+ * Tool
+ *============================================================================*/
+
+static char *s_result;
+
+static char *soak_fetch(const ac_tool_ctx_t *ctx, const char *args, void *priv) {
+    (void)ctx;
+    (void)args;
+    (void)priv;
+    return ac_strdup(s_result);
+}
+
+static void make_result(void) {
+    static const char words[] = "sensor reading nominal within tolerance at sample ";
+    s_result = malloc(s_cfg.result_bytes + 1);
+    for (size_t i = 0; i < s_cfg.result_bytes; i++) {
+        s_result[i] = words[i % (sizeof(words) - 1)];
+    }
+    s_result[s_cfg.result_bytes] = '\0';
+}
+
+/*============================================================================
+ * Mock Server
+ *============================================================================*/
+
+static char s_script_path[64];
+
+static int mock_start(void) {
+    snprintf(s_script_path, sizeof(s_script_path), "/tmp/bench_soak_%d.txt", (int)getpid());
+    FILE *f = fopen(s_script_path, "w");
+    if (!f) {
+        return -1;
+    }
+    fprintf(f, "tool soak_fetch {}\n\ntext Noted.\n");
+    if (fclose(f) != 0) {
+        return -1;
+    }
+    int port = bench_mock_start((const char *const[]){ "-l", "-s", s_script_path, "-n", "16",
+                                                       NULL });
+    if (port < 0) {
+        return -1;
+    }
+    snprintf(s_cfg.api_base, sizeof(s_cfg.api_base),
+             strcmp(s_cfg.provider, "anthropic") == 0 ? "http://127.0.0.1:%d"
+                                                      : "http://127.0.0.1:%d/v1", port);
+    return 0;
+}
+
+static void mock_stop(void) {
+    bench_mock_stop();
+    if (s_script_path[0]) {
+        unlink(s_script_path);
+    }
+}
+
+/*============================================================================
+ * Soak
+ *============================================================================*/
+
+static int on_stream(const ac_stream_event_t *event, void *user_data) {
+    (void)event;
+    (void)user_data;
+    return 0;
+}
+
+static void print_row(const sample_t *s) {
+    printf("%6d %9.0f %9.0f [%7.0f] %6.0f %9.1f %9.0f %9.0f\n", s->turn, s->value[M_RSS],
+           s->value[M_ARENA], s->arena_capacity_kb, s->value[M_MSGS], s->value[M_BODY],
+           s->value[M_SER], s->value[M_OVH]);
+}
+
+static int soak(sample_t *samples, int *count, int *failed) {
+    ac_session_t *session = ac_session_open();
+    if (!session) {
+        return -1;
+    }
+    ac_session_profile(session, &(ac_profile_config_t){ .on_iteration = on_iteration });
+    ac_tool_registry_t *tools = ac_tool_registry_create(session);
+    ac_tool_registry_add(tools, &(ac_tool_t){
+        .name = "soak_fetch",
+        .description = "Fetch the latest sensor log",
+        .parameters = "{\"type\":\"object\",\"properties\":{}}",
+        .execute = soak_fetch,
+    });
+
+    ac_agent_params_t params = {
+        .name = "soak",
+        .instructions = "You watch the plant sensors.",
+        .llm = {
+            .provider = s_cfg.provider,
+            .model = "bench",
+            .api_key = "bench",
+            .api_base = s_cfg.api_base,
+        },
+        .tools = tools,
+        .memory = {
+            .max_messages = s_cfg.max_messages,
+            .max_tokens = s_cfg.max_tokens,
+            .max_tool_bytes = s_cfg.max_tool_bytes,
+        },
+    };
+    if (s_cfg.stream) {
+        params.callbacks.on_stream = on_stream;
+    }
+    ac_agent_t *agent = ac_agent_create(session, &params);
+    if (!agent) {
+        ac_session_close(session);
+        return -1;
+    }
+    static const ac_agent_hooks_t hooks = {
+        .on_llm_request = on_llm_request,
+        .on_run_end = on_run_end,
+    };
+    ac_agent_add_hooks(agent, &hooks);
+
+    if (!s_cfg.json) {
+        printf("%6s %9s %9s %9s %6s %9s %9s %9s\n", "turn", "rss_kb", "arena_kb", "[cap]",
+               "msgs", "body_kb", "ser_us", "ovh_us");
+    }
+    arc_http_io_stats_t io;
+    arc_http_get_io_stats(&io);
+    uint64_t body_bytes = io.body_bytes;
+    int since = 0;
+    char prompt[64];
+    for (int turn = 1; turn <= s_cfg.turns; turn++) {
+        snprintf(prompt, sizeof(prompt), "Check the sensors (round %d).", turn);
+        ac_agent_result_t *result = ac_agent_run(agent, prompt);
+        if (!result || !result->content) {
+            (*failed)++;
+        }
+        since++;
+        if (turn % s_cfg.interval != 0 && turn != s_cfg.turns) {
+            continue;
+        }
+
+        arc_http_get_io_stats(&io);
+        sample_t *s = &samples[(*count)++];
+        s->turn = turn;
+        s->value[M_RSS] = (double)rss_kb();
+        s->value[M_ARENA] = (double)s_window.arena_allocated / 1024.0;
+        s->arena_capacity_kb = (double)s_window.arena_capacity / 1024.0;
+        s->value[M_MSGS] = (double)s_window.message_count;
+        s->value[M_BODY] = (double)(io.body_bytes - body_bytes) / 1024.0 / since;
+        s->value[M_SER] = (double)s_window.serialize_us / since;
+        s->value[M_OVH] = (double)s_window.overhead_us / since;
+        body_bytes = io.body_bytes;
+        s_window.serialize_us = 0;
+        s_window.overhead_us = 0;
+        since = 0;
+        if (!s_cfg.json) {
+            print_row(s);
+            fflush(stdout);
+        }
+    }
+    ac_agent_remove_hooks(agent, &hooks);
+    ac_session_close(session);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n\n"
+           "  -n <turns>     User turns (default 2000)\n"
+           "  -R <bytes>     Tool result size (default 4096)\n"
+           "  -i <turns>     Sample interval (default turns/20)\n"
+           "  -M <n>         History limit: max messages (default unlimited)\n"
+           "  -K <n>         History limit: max tokens (default 32000, 0 = unlimited)\n"
+           "  -B <n>         History limit: max tool output bytes (default unlimited)\n"
+           "  -P <provider>  openai or anthropic (default openai)\n"
+           "  -s             Streaming loop\n"
+           "  -u <api_base>  Use a running mock_llm started with -l and a\n"
+           "                 soak_fetch script step\n"
+           "  -j             Print a JSON report\n"
+           "  -h             Show this help message\n", prog);
+}
+
+int main(int argc, char **argv) {
+    int c;
+    const char *url = NULL;
+    while ((c = getopt(argc, argv, "n:R:i:M:K:B:P:su:jh")) != -1) {
+        switch (c) {
+        case 'n': s_cfg.turns = atoi(optarg); break;
+        case 'R': s_cfg.result_bytes = strtoul(optarg, NULL, 10); break;
+        case 'i': s_cfg.interval = atoi(optarg); break;
+        case 'M': s_cfg.max_messages = strtoul(optarg, NULL, 10); break;
+        case 'K': s_cfg.max_tokens = strtoul(optarg, NULL, 10); break;
+        case 'B': s_cfg.max_tool_bytes = strtoul(optarg, NULL, 10); break;
+        case 'P': s_cfg.provider = optarg; break;
+        case 's': s_cfg.stream = 1; break;
+        case 'u': url = optarg; break;
+        case 'j': s_cfg.json = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (s_cfg.turns < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (s_cfg.interval < 1) {
+        s_cfg.interval = s_cfg.turns >= 20 ? s_cfg.turns / 20 : 1;
+    }
+    ac_log_set_level(AC_LOG_LEVEL_ERROR);
+    make_result();
+
+    if (url) {
+        snprintf(s_cfg.api_base, sizeof(s_cfg.api_base), "%s", url);
+    } else if (mock_start() != 0) {
+        fprintf(stderr, "bench_soak: cannot start mock_llm (build tools or pass -u)\n");
+        mock_stop();
+        return 1;
+    }
+
+    int max_samples = s_cfg.turns / s_cfg.interval + 2;
+    sample_t *samples = calloc((size_t)max_samples, sizeof(sample_t));
+    int count = 0, failed = 0;
+    int rc = soak(samples, &count, &failed);
+    mock_stop();
+    if (rc != 0) {
+        fprintf(stderr, "bench_soak: cannot create the agent\n");
+        return 1;
+    }
+
+    double k[M_COUNT];
+    flag_t flags[M_COUNT];
+    int any = 0;
+    for (int m = 0; m < M_COUNT; m++) {
+        k[m] = growth_exponent(samples, count, m);
+    }
+    for (int m = 0; m < M_COUNT; m++) {
+        flags[m] = flag_of(m, k[m], k[M_MSGS]);
+        any |= flags[m] != FLAG_NONE;
+    }
+
+    if (s_cfg.json) {
+        printf("{\"turns\":%d,\"result_bytes\":%zu,\"max_messages\":%zu,\"max_tokens\":%zu,"
+               "\"max_tool_bytes\":%zu,\"provider\":\"%s\",\"stream\":%d,\"failed_turns\":%d,"
+               "\"samples\":[", s_cfg.turns, s_cfg.result_bytes, s_cfg.max_messages,
+               s_cfg.max_tokens, s_cfg.max_tool_bytes, s_cfg.provider, s_cfg.stream, failed);
+        for (int i = 0; i < count; i++) {
+            printf("%s{\"turn\":%d", i ? "," : "", samples[i].turn);
+            for (int m = 0; m < M_COUNT; m++) {
+                printf(",\"%s\":%.1f", s_metrics[m].name, samples[i].value[m]);
+            }
+            printf("}");
+        }
+        printf("],\"growth\":{");
+        for (int m = 0; m < M_COUNT; m++) {
+            static const char *const json_flags[] = { "null", "\"superlinear\"",
+                                                      "\"retained\"", "\"growing\"" };
+            printf("%s\"%s\":{\"exponent\":%.2f,\"flag\":%s}", m ? "," : "", s_metrics[m].name,
+                   k[m], json_flags[flags[m]]);
+        }
+        printf("}}\n");
+    } else {
+        printf("\ngrowth ~ turn^k over the second half (%d failed turns):\n", failed);
+        for (int m = 0; m < M_COUNT; m++) {
+            printf("  %-9s k = %5.2f  %s\n", s_metrics[m].name, k[m], s_flag_names[flags[m]]);
+        }
+    }
+    free(samples);
+    free(s_result);
+    return any ? 2 : 0;
+}
@@ -0,0 +1,807 @@
+/**
+ * @file bench_stream.c
+ * @brief Token-rate stream simulator: delta-to-screen latency of the renderer
+ *
+ * Plays an ac_stream_event_t sequence into the stream callback the chat
+ * examples use, at a set token rate, without a model or a network:
+ *
+ * - synthetic: Markdown documents (data/markdown/, or -f) cut into
+ *   token-sized text deltas (1-7 bytes, whole UTF-8 characters)
+ * - recorded: a saved provider response (-R, OpenAI or Anthropic JSON);
+ *   its thinking, text and tool_use blocks become the usual START /
+ *   DELTA / STOP events, each block's content cut the same way
+ *
+ * One delta is one token. Deltas go out on a fixed schedule (so a slow
+ * callback shows up as lag, the way it would hold up the network read),
+ * optionally in bursts (-b tokens at once, as coalesced TCP reads
+ * deliver them), with jitter (-J) and periodic stalls (-s ms:every).
+ *
+ * The callback renders the way chat_stream does: text through md_async
+ * (render thread, frames of -F ms) or, with mode "sync", through
+ * md_stream on the callback thread as chat_markdown does. Output goes to
+ * a counting sink, or to the terminal with -o.
+ *
+ * A text delta is on screen once the line it belongs to is complete and
+ * has been rendered (the end of each frame, or the end of the feed call
+ * in sync mode), or once its block's finish has been. Reported per mode
+ * and rate:
+ *
+ * - tok_s     tokens per second achieved
+ * - lag_ms    worst delay of a delta against its schedule
+ * - cb_us     time spent in the callback per event (p99)
+ * - line_ms   delta completing a line -> line on screen (p50/p99/max):
+ *             the renderer's own latency
+ * - delta_ms  any delta -> on screen (p50/p99), which adds the wait for
+ *             the rest of its line
+ *
+ * A case keeps up when it keeps to its schedule (stalls included) within
+ * 5% and line_ms p99 stays within -m ms (50); the exit status is 2 when one does not. Lines with
+ * '|' that are held until the next line shows whether a table starts are
+ * counted as shown when complete, so table latency reads low by a line.
+ *
+ * Usage: bench_stream [-r rate,...] [-M async,sync] [-f doc.md | -R response.json]
+ *                     [-b burst] [-J jitter_pct] [-s ms:every] [-d seconds]
+ *                     [-F frame_ms] [-m budget_ms] [-S seed] [-o] [-j]
+ */
+
+#include "arc/llm.h"
+#include "arc/log.h"
+#include "arc/message.h"
+#include "md.h"
+#include "message/message_json.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef ARC_BENCH_DATA_DIR
+#define ARC_BENCH_DATA_DIR "bench/data"
+#endif
+
+/** Columns the output is laid out for (counting sink) */
+#define BENCH_STREAM_WIDTH 100
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+
+static struct {
+    const char *rates;
+    const char *modes;
+    const char *document;
+    const char *recording;
+    int burst;
+    int jitter_pct;
+    int stall_ms;
+    int stall_every;
+    int seconds;
+    int frame_ms;
+    int budget_ms;
+    uint32_t seed;
+    int terminal;
+    int json;
+} s_cfg = {
+    .rates = "50,200,400",
+    .modes = "async,sync",
+    .burst = 1,
+    .seconds = 10,
+    .frame_ms = MD_ASYNC_FRAME_MS,
+    .budget_ms = 50,
+    .seed = 1,
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000ull;
+}
+
+static uint32_t rng_next(uint32_t *state) {
+    /* xorshift32 */
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/*============================================================================
+ * Event Sequence
+ *============================================================================*/
+
+typedef struct {
+    ac_stream_event_t event;         /* delta points into s_text */
+    size_t feed_end;                 /* Text deltas: fed bytes up to and including it */
+    int finish;                      /* Text deltas: finishes before its block's */
+} sim_event_t;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} text_t;
+
+static int append(text_t *t, const char *data, size_t n) {
+    if (t->len + n + 1 > t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 4096;
+        while (cap < t->len + n + 1) {
+            cap *= 2;
+        }
+        char *grown = realloc(t->data, cap);
+        if (!grown) {
+            return -1;
+        }
+        t->data = grown;
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, data, n);
+    t->len += n;
+    t->data[t->len] = '\0';
+    return 0;
+}
+
+static sim_event_t *s_events;
+static int s_event_count;
+static int s_event_cap;
+static text_t s_text;                /* Delta text of the whole sequence */
+static text_t s_fed;                 /* The text deltas alone: what md_stream is fed */
+
+static sim_event_t *push_event(ac_stream_event_type_t type) {
+    if (s_event_count == s_event_cap) {
+        int cap = s_event_cap ? s_event_cap * 2 : 1024;
+        sim_event_t *grown = realloc(s_events, (size_t)cap * sizeof(sim_event_t));
+        if (!grown) {
+            return NULL;
+        }
+        s_events = grown;
+        s_event_cap = cap;
+    }
+    sim_event_t *e = &s_events[s_event_count++];
+    memset(e, 0, sizeof(*e));
+    e->event.type = type;
+    return e;
+}
+
+/**
+ * @brief Add one content block as START, token-sized DELTAs, STOP
+ */
+static int push_block(ac_block_type_t block_type, ac_delta_type_t delta_type, const char *text,
+                      const ac_content_block_t *tool, int index, int *finishes, uint32_t *rng) {
+    sim_event_t *e = push_event(AC_STREAM_CONTENT_BLOCK_START);
+    if (!e) {
+        return -1;
+    }
+    e->event.block_index = index;
+    e->event.block_type = block_type;
+    if (tool) {
+        e->event.tool_id = tool->id;
+        e->event.tool_name = tool->name;
+    }
+
+    size_t len = text ? strlen(text) : 0;
+    for (size_t at = 0; at < len;) {
+        size_t n = 1 + rng_next(rng) % 7;
+        if (n > len - at) {
+            n = len - at;
+        }
+        while (at + n < len && ((unsigned char)text[at + n] & 0xC0) == 0x80) {
+            n++;                     /* Whole UTF-8 characters */
+        }
+        /* Offsets for now: s_text may still move */
+        if (!(e = push_event(AC_STREAM_DELTA))) {
+            return -1;
+        }
+        e->event.block_index = index;
+        e->event.block_type = block_type;
+        e->event.delta_type = delta_type;
+        e->event.delta = (const char *)(uintptr_t)s_text.len;
+        e->event.delta_len = n;
+        if (append(&s_text, text + at, n) != 0) {
+            return -1;
+        }
+        if (delta_type == AC_DELTA_TEXT) {
+            if (append(&s_fed, text + at, n) != 0) {
+                return -1;
+            }
+            e->feed_end = s_fed.len;
+            e->finish = *finishes;
+        }
+        at += n;
+    }
+
+    if (!(e = push_event(AC_STREAM_CONTENT_BLOCK_STOP))) {
+        return -1;
+    }
+    e->event.block_index = index;
+    e->event.block_type = block_type;
+    if (tool) {
+        e->event.tool_id = tool->id;
+        e->event.tool_name = tool->name;
+        e->event.tool_input = tool->input;
+    }
+    if (block_type == AC_BLOCK_TEXT) {
+        (*finishes)++;
+    }
+    return 0;
+}
+
+static char *load_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "bench_stream: cannot open %s\n", path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data) {
+        data[size] = '\0';
+        *len = (size_t)size;
+    }
+    return data;
+}
+
+static ac_chat_response_t s_response;
+
+/**
+ * @brief Build the event sequence from a recorded response or documents
+ */
+static int build_sequence(void) {
+    uint32_t rng = s_cfg.seed ? s_cfg.seed : 1;
+    int finishes = 0;
+    int rc = 0;
+
+    if (!push_event(AC_STREAM_MESSAGE_START)) {
+        return -1;
+    }
+    if (s_cfg.recording) {
+        size_t len;
+        char *json = load_file(s_cfg.recording, &len);
+        if (!json) {
+            return -1;
+        }
+        ac_chat_response_init(&s_response);
+        arc_err_t err = strstr(json, "\"choices\"")
+            ? ac_chat_response_parse(json, &s_response)
+            : ac_chat_response_parse_anthropic(json, &s_response);
+        free(json);
+        if (err != ARC_OK) {
+            fprintf(stderr, "bench_stream: %s is not an OpenAI or Anthropic response\n",
+                    s_cfg.recording);
+            return -1;
+        }
+        int index = 0;
+        for (const ac_content_block_t *b = s_response.blocks; b && rc == 0; b = b->next) {
+            switch (b->type) {
+            case AC_BLOCK_TEXT:
+                rc = push_block(AC_BLOCK_TEXT, AC_DELTA_TEXT, b->text, NULL, index++,
+                                &finishes, &rng);
+                break;
+            case AC_BLOCK_THINKING:
+                rc = push_block(AC_BLOCK_THINKING, AC_DELTA_THINKING, b->text, NULL, index++,
+                                &finishes, &rng);
+                break;
+            case AC_BLOCK_REASONING:
+                rc = push_block(AC_BLOCK_REASONING, AC_DELTA_REASONING, b->text, NULL, index++,
+                                &finishes, &rng);
+                break;
+            case AC_BLOCK_TOOL_USE:
+                rc = push_block(AC_BLOCK_TOOL_USE, AC_DELTA_INPUT_JSON, b->input, b, index++,
+                                &finishes, &rng);
+                break;
+            default:
+                break;
+            }
+        }
+        if (!s_response.blocks) {
+            /* OpenAI responses fill the legacy fields only */
+            if (s_response.content) {
+                rc = push_block(AC_BLOCK_TEXT, AC_DELTA_TEXT, s_response.content, NULL, index++,
+                                &finishes, &rng);
+            }
+            for (const ac_tool_call_t *t = s_response.tool_calls; t && rc == 0; t = t->next) {
+                ac_content_block_t tool = { .type = AC_BLOCK_TOOL_USE, .id = t->id,
+                                            .name = t->name, .input = t->arguments };
+                rc = push_block(AC_BLOCK_TOOL_USE, AC_DELTA_INPUT_JSON, t->arguments, &tool,
+                                index++, &finishes, &rng);
+            }
+        }
+    } else if (s_cfg.document) {
+        size_t len;
+        char *doc = load_file(s_cfg.document, &len);
+        if (!doc) {
+            return -1;
+        }
+        rc = push_block(AC_BLOCK_TEXT, AC_DELTA_TEXT, doc, NULL, 0, &finishes, &rng);
+        free(doc);
+    } else {
+        static const char *const docs[] = { "prose.md", "lists.md", "code.md", "tables.md",
+                                            "cjk.md" };
+        text_t all = { NULL, 0, 0 };
+        for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); i++) {
+            char path[1024];
+            size_t len;
+            snprintf(path, sizeof(path), "%s/markdown/%s", ARC_BENCH_DATA_DIR, docs[i]);
+            char *doc = load_file(path, &len);
+            if (!doc) {
+                free(all.data);
+                return -1;
+            }
+            rc = append(&all, doc, len);
+            rc = rc == 0 ? append(&all, "\n", 1) : rc;
+            free(doc);
+            if (rc != 0) {
+                free(all.data);
+                return -1;
+            }
+        }
+        rc = push_block(AC_BLOCK_TEXT, AC_DELTA_TEXT, all.data, NULL, 0, &finishes, &rng);
+        free(all.data);
+    }
+    if (rc != 0) {
+        return -1;
+    }
+
+    sim_event_t *e = push_event(AC_STREAM_MESSAGE_DELTA);
+    if (!e || !push_event(AC_STREAM_MESSAGE_STOP)) {
+        return -1;
+    }
+    e->event.stop_reason = s_response.stop_reason    ? s_response.stop_reason
+                           : s_response.finish_reason ? s_response.finish_reason
+                                                      : "end_turn";
+
+    /* s_text is final: turn offsets into pointers */
+    for (int i = 0; i < s_event_count; i++) {
+        if (s_events[i].event.type == AC_STREAM_DELTA) {
+            s_events[i].event.delta = s_text.data + (uintptr_t)s_events[i].event.delta;
+        }
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Renderer Under Test
+ *============================================================================*/
+
+typedef struct {
+    uint64_t t_us;
+    size_t fed;
+    size_t finished;
+} frame_t;
+
+typedef struct {
+    int sync;                        /* Render on the callback thread */
+    md_async_t *ui;
+    md_stream_t *stream;
+    size_t fed;                      /* Sync: bytes fed so far */
+    size_t finished;                 /* Sync: finishes so far */
+    frame_t *frames;                 /* One per event at most */
+    int frame_count;
+    uint64_t writes;
+    uint64_t bytes;
+} renderer_t;
+
+static void sink_output(const char *text, size_t len, void *userdata) {
+    renderer_t *r = (renderer_t *)userdata;
+    r->writes++;
+    r->bytes += len;
+    if (s_cfg.terminal && fwrite(text, 1, len, stdout) != len) {
+        s_cfg.terminal = 0;
+    }
+}
+
+static void on_frame(size_t fed, size_t finished, void *userdata) {
+    renderer_t *r = (renderer_t *)userdata;
+    if (r->frame_count <= s_event_count) {
+        r->frames[r->frame_count++] = (frame_t){ now_us(), fed, finished };
+    }
+}
+
+static void ui_write(renderer_t *r, const char *text, size_t len) {
+    if (r->sync) {
+        md_stream_write(r->stream, text, len);
+    } else {
+        md_async_write(r->ui, text, len);
+    }
+}
+
+/**
+ * @brief The chat_stream callback, rendering through md_async or md_stream
+ */
+static int render_callback(const ac_stream_event_t *event, void *user_data) {
+    renderer_t *r = (renderer_t *)user_data;
+    switch (event->type) {
+    case AC_STREAM_CONTENT_BLOCK_START:
+        if (event->block_type == AC_BLOCK_THINKING || event->block_type == AC_BLOCK_REASONING) {
+            ui_write(r, "\033[36m[thinking] ", 15);
+        } else if (event->block_type == AC_BLOCK_TOOL_USE) {
+            char line[256];
+            int n = snprintf(line, sizeof(line), "\033[33m[tool: %s] ",
+                             event->tool_name ? event->tool_name : "?");
+            ui_write(r, line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+        }
+        break;
+    case AC_STREAM_DELTA:
+        if (event->delta_type == AC_DELTA_THINKING || event->delta_type == AC_DELTA_REASONING) {
+            ui_write(r, event->delta, event->delta_len);
+        } else if (event->delta_type == AC_DELTA_TEXT) {
+            if (r->sync) {
+                md_stream_feed(r->stream, event->delta, event->delta_len);
+                r->fed += event->delta_len;
+            } else {
+                md_async_feed(r->ui, event->delta, event->delta_len);
+            }
+        }
+        break;
+    case AC_STREAM_CONTENT_BLOCK_STOP:
+        if (event->block_type == AC_BLOCK_TEXT) {
+            if (r->sync) {
+                md_stream_finish(r->stream);
+                md_stream_reset(r->stream);
+                r->finished++;
+            } else {
+                md_async_finish(r->ui);
+            }
+        } else {
+            ui_write(r, "\033[0m\n", 5);
+        }
+        break;
+    case AC_STREAM_MESSAGE_STOP:
+        ui_write(r, "\033[0m\n", 5);
+        break;
+    default:
+        break;
+    }
+    if (r->sync) {
+        /* Written by the time the feed returns: that is this mode's frame */
+        r->frames[r->frame_count++] = (frame_t){ now_us(), r->fed, r->finished };
+    }
+    return 0;
+}
+
+static int renderer_open(renderer_t *r, int sync) {
+    memset(r, 0, sizeof(*r));
+    r->sync = sync;
+    r->frames = calloc((size_t)s_event_count + 1, sizeof(frame_t));
+    r->stream = md_stream_new();
+    if (!r->frames || !r->stream) {
+        return -1;
+    }
+    md_stream_set_output(r->stream, sink_output, r);
+    if (!s_cfg.terminal) {
+        md_stream_set_width(r->stream, BENCH_STREAM_WIDTH);
+    }
+    if (!sync) {
+        r->ui = md_async_new(r->stream, s_cfg.frame_ms);
+        if (!r->ui) {
+            return -1;
+        }
+        r->stream = NULL;            /* Owned by r->ui */
+        md_async_set_frame_callback(r->ui, on_frame, r);
+    }
+    return 0;
+}
+
+static void renderer_close(renderer_t *r) {
+    if (r->ui) {
+        md_async_wait(r->ui);
+        md_async_free(r->ui);
+    }
+    md_stream_free(r->stream);
+    free(r->frames);
+}
+
+/*============================================================================
+ * Simulation
+ *============================================================================*/
+
+typedef struct {
+    char name[32];
+    int rate;
+    int tokens;
+    double tok_s;
+    double lag_ms;
+    double cb_p99_us;
+    double line_p50, line_p99, line_max;
+    double delta_p50, delta_p99;
+    int frames;
+    uint64_t writes;
+    int ok;
+} result_t;
+
+static int by_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double quantile(double *v, int n, double q) {
+    if (n == 0) {
+        return 0.0;
+    }
+    qsort(v, (size_t)n, sizeof(double), by_double);
+    int i = (int)(q * (double)(n - 1) + 0.5);
+    return v[i];
+}
+
+static void sleep_until(uint64_t t_us) {
+    uint64_t now = now_us();
+    if (t_us > now) {
+        uint64_t d = t_us - now;
+        struct timespec ts = { (time_t)(d / 1000000ull), (long)(d % 1000000ull) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+/**
+ * @brief Time the fed byte at pos reached the screen (0 = never)
+ *
+ * It is shown by the first frame that fed the newline ending its line,
+ * or rendered the finish of its block.
+ */
+static uint64_t shown_at(const renderer_t *r, size_t pos, int finish, int *first_frame) {
+    const char *nl = memchr(s_fed.data + pos, '\n', s_fed.len - pos);
+    size_t line_end = nl ? (size_t)(nl - s_fed.data) + 1 : (size_t)-1;
+    for (int f = *first_frame; f < r->frame_count; f++) {
+        if (r->frames[f].fed >= line_end || r->frames[f].finished > (size_t)finish) {
+            *first_frame = f;        /* Positions only grow: the next search starts here */
+            return r->frames[f].t_us;
+        }
+    }
+    return 0;
+}
+
+static int simulate(int sync, int rate, result_t *res) {
+    renderer_t r;
+    if (renderer_open(&r, sync) != 0) {
+        renderer_close(&r);
+        return -1;
+    }
+    uint64_t *emitted = calloc((size_t)s_event_count, sizeof(uint64_t));
+    double *cb = calloc((size_t)s_event_count, sizeof(double));
+    double *line = calloc((size_t)s_event_count, sizeof(double));
+    double *delta = calloc((size_t)s_event_count, sizeof(double));
+    if (!emitted || !cb || !line || !delta) {
+        free(emitted);
+        free(cb);
+        free(line);
+        free(delta);
+        renderer_close(&r);
+        return -1;
+    }
+
+    /* Fixed schedule: token k of burst g is due at start + g * burst / rate */
+    uint32_t rng = s_cfg.seed ? s_cfg.seed : 1;
+    double interval_us = 1e6 * (double)s_cfg.burst / (double)rate;
+    uint64_t start = now_us();
+    uint64_t deadline = s_cfg.seconds > 0 ? start + (uint64_t)s_cfg.seconds * 1000000ull : 0;
+    uint64_t stalled_us = 0;
+    double lag_us = 0.0;
+    int tokens = 0, events = 0;
+    uint64_t end = start, last_due = start;
+    for (int i = 0; i < s_event_count; i++) {
+        sim_event_t *e = &s_events[i];
+        int is_delta = e->event.type == AC_STREAM_DELTA;
+        int stop = deadline && now_us() >= deadline;
+        if (is_delta && stop) {
+            continue;                /* Out of time: skip to the closing events */
+        }
+        if (is_delta) {
+            if (tokens > 0 && s_cfg.stall_every > 0 && tokens % s_cfg.stall_every == 0) {
+                stalled_us += (uint64_t)s_cfg.stall_ms * 1000ull;
+            }
+            double due = (double)(tokens / s_cfg.burst) * interval_us;
+            if (s_cfg.jitter_pct > 0 && tokens % s_cfg.burst == 0) {
+                double j = (double)(rng_next(&rng) % 2001) / 1000.0 - 1.0;
+                due += j * interval_us * s_cfg.jitter_pct / 100.0;
+            }
+            uint64_t due_us = start + stalled_us + (due > 0 ? (uint64_t)due : 0);
+            sleep_until(due_us);
+            last_due = due_us;
+            uint64_t now = now_us();
+            if (now > due_us && (double)(now - due_us) > lag_us) {
+                lag_us = (double)(now - due_us);
+            }
+            tokens++;
+        }
+        uint64_t t0 = now_us();
+        render_callback(&e->event, &r);
+        uint64_t t1 = now_us();
+        emitted[i] = t0;
+        cb[events++] = (double)(t1 - t0);
+        if (is_delta) {
+            end = t1;
+        }
+    }
+    if (r.ui) {
+        md_async_wait(r.ui);
+    }
+
+    /* Screen times of the text deltas that went out: the whole delta, and
+     * the line it completes (its first newline) */
+    int lines = 0, deltas = 0, delta_frame = 0, line_frame = 0;
+    for (int i = 0; i < s_event_count; i++) {
+        const sim_event_t *e = &s_events[i];
+        if (!emitted[i] || e->event.type != AC_STREAM_DELTA ||
+            e->event.delta_type != AC_DELTA_TEXT) {
+            continue;
+        }
+        uint64_t shown = shown_at(&r, e->feed_end - 1, e->finish, &delta_frame);
+        if (shown) {
+            delta[deltas++] = shown > emitted[i] ? (double)(shown - emitted[i]) / 1000.0 : 0.0;
+        }
+        if (memchr(e->event.delta, '\n', e->event.delta_len)) {
+            shown = shown_at(&r, e->feed_end - e->event.delta_len, e->finish, &line_frame);
+            if (shown) {
+                line[lines++] = shown > emitted[i] ? (double)(shown - emitted[i]) / 1000.0 : 0.0;
+            }
+        }
+    }
+
+    snprintf(res->name, sizeof(res->name), "%s/%d", sync ? "sync" : "async", rate);
+    res->rate = rate;
+    res->tokens = tokens;
+    res->tok_s = end > start && tokens > 1 ? (double)tokens * 1e6 / (double)(end - start) : 0.0;
+    res->lag_ms = lag_us / 1000.0;
+    res->cb_p99_us = quantile(cb, events, 0.99);
+    res->line_p50 = quantile(line, lines, 0.50);
+    res->line_p99 = quantile(line, lines, 0.99);
+    res->line_max = lines ? line[lines - 1] : 0.0;
+    res->delta_p50 = quantile(delta, deltas, 0.50);
+    res->delta_p99 = quantile(delta, deltas, 0.99);
+    res->frames = r.frame_count;
+    res->writes = r.writes;
+    /* Kept the schedule (stalls included) within 5%, and drew lines in time */
+    double scheduled_us = (double)(last_due - start) + interval_us / s_cfg.burst;
+    res->ok = (double)(end - start) <= scheduled_us * 1.05 + 1000.0 &&
+              res->line_p99 <= (double)s_cfg.budget_ms;
+
+    free(emitted);
+    free(cb);
+    free(line);
+    free(delta);
+    renderer_close(&r);
+    return 0;
+}
+
+/*============================================================================
+ * Report
+ *============================================================================*/
+
+static void print_header(void) {
+    if (s_cfg.json) {
+        printf("{\"bench\":\"stream\",\"events\":%d,\"fed_bytes\":%zu,\"burst\":%d,"
+               "\"jitter_pct\":%d,\"stall_ms\":%d,\"stall_every\":%d,\"frame_ms\":%d,"
+               "\"budget_ms\":%d,\"cases\":[", s_event_count, s_fed.len, s_cfg.burst,
+               s_cfg.jitter_pct, s_cfg.stall_ms, s_cfg.stall_every, s_cfg.frame_ms,
+               s_cfg.budget_ms);
+        return;
+    }
+    printf("%-12s %6s %7s %7s %7s %21s %15s %7s %8s  %s\n", "case", "tokens", "tok_s",
+           "lag_ms", "cb_us", "line_ms p50/p99/max", "delta_ms p50/p99", "frames", "writes",
+           "keeps up");
+}
+
+static void print_result(const result_t *res, int index) {
+    if (s_cfg.json) {
+        printf("%s\n  {\"name\":\"%s\",\"rate\":%d,\"tokens\":%d,\"tok_per_s\":%.1f,"
+               "\"lag_ms\":%.2f,\"cb_p99_us\":%.1f,\"line_p50_ms\":%.2f,\"line_p99_ms\":%.2f,"
+               "\"line_max_ms\":%.2f,\"delta_p50_ms\":%.2f,\"delta_p99_ms\":%.2f,"
+               "\"frames\":%d,\"writes\":%llu,\"keeps_up\":%s}",
+               index ? "," : "", res->name, res->rate, res->tokens, res->tok_s, res->lag_ms,
+               res->cb_p99_us, res->line_p50, res->line_p99, res->line_max, res->delta_p50,
+               res->delta_p99, res->frames, (unsigned long long)res->writes,
+               res->ok ? "true" : "false");
+        return;
+    }
+    char line[32], delta[32];
+    snprintf(line, sizeof(line), "%.1f/%.1f/%.1f", res->line_p50, res->line_p99, res->line_max);
+    snprintf(delta, sizeof(delta), "%.1f/%.1f", res->delta_p50, res->delta_p99);
+    printf("%-12s %6d %7.1f %7.1f %7.1f %21s %15s %7d %8llu  %s\n", res->name, res->tokens,
+           res->tok_s, res->lag_ms, res->cb_p99_us, line, delta, res->frames,
+           (unsigned long long)res->writes, res->ok ? "yes" : "NO");
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n\n"
+           "  -r <rate,...>   Tokens per second (default 50,200,400)\n"
+           "  -M <mode,...>   async (render thread) and/or sync (default async,sync)\n"
+           "  -f <doc.md>     Document to stream (default data/markdown/*.md)\n"
+           "  -R <file.json>  Recorded OpenAI or Anthropic response to stream\n"
+           "  -b <tokens>     Tokens delivered together (default 1)\n"
+           "  -J <pct>        Jitter of delivery times, percent of the interval\n"
+           "  -s <ms:every>   Stall for ms every so many tokens\n"
+           "  -d <seconds>    Stop each case after this long (default 10, 0 = whole stream)\n"
+           "  -F <ms>         md_async frame interval (default %d)\n"
+           "  -m <ms>         line_ms p99 budget to keep up (default 50)\n"
+           "  -S <seed>       Token cut and jitter sequence (default 1)\n"
+           "  -o              Render to the terminal instead of a counting sink\n"
+           "  -j              Print a JSON report\n"
+           "  -h              Show this help message\n", prog, MD_ASYNC_FRAME_MS);
+}
+
+int main(int argc, char **argv) {
+    int c;
+    while ((c = getopt(argc, argv, "r:M:f:R:b:J:s:d:F:m:S:ojh")) != -1) {
+        switch (c) {
+        case 'r': s_cfg.rates = optarg; break;
+        case 'M': s_cfg.modes = optarg; break;
+        case 'f': s_cfg.document = optarg; break;
+        case 'R': s_cfg.recording = optarg; break;
+        case 'b': s_cfg.burst = atoi(optarg); break;
+        case 'J': s_cfg.jitter_pct = atoi(optarg); break;
+        case 's':
+            if (sscanf(optarg, "%d:%d", &s_cfg.stall_ms, &s_cfg.stall_every) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'd': s_cfg.seconds = atoi(optarg); break;
+        case 'F': s_cfg.frame_ms = atoi(optarg); break;
+        case 'm': s_cfg.budget_ms = atoi(optarg); break;
+        case 'S': s_cfg.seed = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'o': s_cfg.terminal = 1; break;
+        case 'j': s_cfg.json = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (s_cfg.burst < 1 || s_cfg.jitter_pct < 0 || s_cfg.jitter_pct > 100 ||
+        s_cfg.stall_ms < 0 || s_cfg.stall_every < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    ac_log_set_level(AC_LOG_LEVEL_ERROR);
+    if (build_sequence() != 0) {
+        return 1;
+    }
+
+    print_header();
+    int count = 0, failed = 0;
+    for (const char *m = s_cfg.modes; *m;) {
+        size_t mlen = strcspn(m, ",");
+        int sync = mlen == 4 && strncmp(m, "sync", 4) == 0;
+        if (!sync && !(mlen == 5 && strncmp(m, "async", 5) == 0)) {
+            fprintf(stderr, "bench_stream: unknown mode '%.*s'\n", (int)mlen, m);
+            return 1;
+        }
+        for (const char *p = s_cfg.rates; *p;) {
+            int rate = atoi(p);
+            if (rate > 0) {
+                result_t res;
+                memset(&res, 0, sizeof(res));
+                if (simulate(sync, rate, &res) != 0) {
+                    fprintf(stderr, "bench_stream: cannot start the renderer\n");
+                    return 1;
+                }
+                if (s_cfg.terminal) {
+                    fflush(stdout);
+                    fprintf(stderr, "\n");
+                }
+                print_result(&res, count++);
+                failed += !res.ok;
+            }
+            p += strcspn(p, ",");
+            p += *p == ',';
+        }
+        m += mlen;
+        m += *m == ',';
+    }
+    if (s_cfg.json) {
+        printf("\n]}\n");
+    }
+
+    ac_chat_response_free(&s_response);
+    free(s_events);
+    free(s_text.data);
+    free(s_fed.data);
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file bench_tools.h
+ * @brief No-op tools for bench_agent
+ *
+ * Wrapped by MOC like application tools, so the benchmark pays the same
+ * argument parsing and result formatting per call.
+ */
+
+#ifndef BENCH_TOOLS_H
+#define BENCH_TOOLS_H
+
+#include <stdbool.h>
+
+/* AC_TOOL_META marker - recognized by MOC but ignored by compiler */
+#define AC_TOOL_META
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @description: Look up a configuration value
+ * @param: key  Configuration key
+ */
+AC_TOOL_META const char* bench_lookup(const char* key);
+
+/**
+ * @description: Add two integers
+ * @param: a  First operand
+ * @param: b  Second operand
+ */
+AC_TOOL_META int bench_add(int a, int b);
+
+/**
+ * @description: Switch an output on or off
+ * @param: channel  Output channel
+ * @param: on  Desired state
+ */
+AC_TOOL_META bool bench_switch(int channel, bool on);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_TOOLS_H */
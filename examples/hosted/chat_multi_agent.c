@@ -9,9 +9,9 @@
  *
  * This demo showcases:
  * - Multiple agents in one session
- * - Parallel agent execution using pthreads
+ * - Fan-out / fan-in as an agent swarm (DAG on the session executor)
  * - HTTP connection pool for efficient resource usage
- * - Agent coordination pattern
+ * - Swarm report: critical path and utilization
  *
  * Usage:
  *   1. Create .env file with OPENAI_API_KEY=sk-xxx
@@ -22,10 +22,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <pthread.h>
 #include <arc.h>
 #include <arc/env.h>
 #include <arc/http_pool.h>
+#include <arc/swarm.h>
 
 /*===========================================================================
  * Configuration
@@ -33,7 +33,6 @@
 
 #define NUM_EXPERTS     10
 #define MAX_INPUT_LEN   256
-#define MAX_OUTPUT_LEN  4096
 #define EXPERT_TIMEOUT_MS   60000   /* 60s for each expert */
 #define SUMMARY_TIMEOUT_MS  120000  /* 120s for summary (longer input) */
 
@@ -151,42 +150,36 @@ static const expert_def_t EXPERTS[NUM_EXPERTS] = {
 };
 
 /*===========================================================================
- * Worker Thread Data
+ * Summary Prompt
  *===========================================================================*/
 
-typedef struct {
-    int id;
-    ac_agent_t *agent;
-    const char *input;
-    char output[MAX_OUTPUT_LEN];
-    int success;
-    uint64_t duration_ms;
-} worker_task_t;
-
-/*===========================================================================
- * Worker Thread Function
- *===========================================================================*/
-
-static void *worker_thread(void *arg) {
-    worker_task_t *task = (worker_task_t *)arg;
-
-    uint64_t start_ms = ac_platform_timestamp_ms();
-
-    /* Run the agent */
-    ac_agent_result_t *result = ac_agent_run(task->agent, task->input);
+/* Fan-in: wrap the expert outputs (inputs[i].name is the domain) */
+static char *build_summary_prompt(
+    const char *message,
+    const ac_swarm_input_t *inputs,
+    size_t count,
+    void *user_data
+) {
+    (void)user_data;
 
-    task->duration_ms = ac_platform_timestamp_ms() - start_ms;
+    size_t size = strlen(message) + 1024;
+    for (size_t i = 0; i < count; i++) {
+        size += strlen(inputs[i].name) + strlen(inputs[i].output) + 32;
+    }
 
-    if (result && result->content) {
-        strncpy(task->output, result->content, MAX_OUTPUT_LEN - 1);
-        task->output[MAX_OUTPUT_LEN - 1] = '\0';
-        task->success = 1;
-    } else {
-        snprintf(task->output, MAX_OUTPUT_LEN, "[Agent %d failed to respond]", task->id);
-        task->success = 0;
+    char *prompt = malloc(size);
+    if (!prompt) {
+        return NULL;
     }
 
-    return NULL;
+    size_t off = (size_t)snprintf(prompt, size, "%s", message);
+    for (size_t i = 0; i < count; i++) {
+        off += (size_t)snprintf(prompt + off, size - off,
+                                "## %s专家\n%s\n\n", inputs[i].name, inputs[i].output);
+    }
+    snprintf(prompt + off, size - off,
+             "\n请综合以上各领域的分析，给出一个全面而有深度的总结。");
+    return prompt;
 }
 
 /*===========================================================================
@@ -370,123 +363,110 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        /* Prepare worker tasks */
-        pthread_t threads[NUM_EXPERTS];
-        worker_task_t tasks[NUM_EXPERTS];
+        /* Recreate summary agent each round to free memory */
+        if (round > 1) {
+            ac_agent_destroy(summary_agent);
+            summary_agent = create_summary_agent(session, model, api_key, base_url);
+            if (!summary_agent) {
+                fprintf(stderr, "[!] Failed to recreate summary agent\n");
+                break;
+            }
+        }
 
         char prompt[512];
         snprintf(prompt, sizeof(prompt), "请分析这个词：%s", input);
 
-        uint64_t parallel_start = ac_platform_timestamp_ms();
+        char summary_message[512];
+        snprintf(summary_message, sizeof(summary_message),
+                 "用户想要了解「%s」这个词。以下是各领域专家的分析：\n\n", input);
 
-        /* Launch all expert threads */
-        printf("[Phase 1] Launching %d expert agents in parallel...\n", NUM_EXPERTS);
+        /*
+         * Fan-out / fan-in: every expert is a task, the summary depends on
+         * all of them. Runs on the session executor, capped at the HTTP
+         * pool size.
+         */
+        ac_swarm_t *swarm = ac_swarm_create(session, NULL);
+        if (!swarm) {
+            fprintf(stderr, "[!] Failed to create swarm\n");
+            break;
+        }
+
+        size_t expert_ids[NUM_EXPERTS];
+        int expert_added[NUM_EXPERTS] = {0};
+        size_t summary_id = 0;
 
         for (int i = 0; i < NUM_EXPERTS; i++) {
-            tasks[i].id = i;
-            tasks[i].agent = experts[i];
-            tasks[i].input = prompt;
-            tasks[i].success = 0;
-            tasks[i].output[0] = '\0';
-
-            if (pthread_create(&threads[i], NULL, worker_thread, &tasks[i]) != 0) {
-                fprintf(stderr, "[!] Failed to create thread for expert %d\n", i);
-                tasks[i].success = 0;
-                snprintf(tasks[i].output, MAX_OUTPUT_LEN, "[Thread creation failed]");
-            }
+            if (!experts[i]) continue;
+            expert_added[i] = ac_swarm_add(swarm, &(ac_swarm_task_t){
+                .name = EXPERTS[i].domain,
+                .agent = experts[i],
+                .message = prompt,
+            }, &expert_ids[i]) == ARC_OK;
         }
 
-        /* Wait for all threads */
-        printf("[Phase 2] Waiting for all experts to complete...\n");
+        ac_swarm_add(swarm, &(ac_swarm_task_t){
+            .name = "Summary",
+            .agent = summary_agent,
+            .message = summary_message,
+            .build_prompt = build_summary_prompt,
+        }, &summary_id);
 
         for (int i = 0; i < NUM_EXPERTS; i++) {
-            pthread_join(threads[i], NULL);
+            if (expert_added[i]) {
+                ac_swarm_depend(swarm, summary_id, expert_ids[i]);
+            }
         }
 
-        uint64_t parallel_end = ac_platform_timestamp_ms();
+        printf("[Phase 1] Running %d experts in parallel, then the summary...\n", NUM_EXPERTS);
+
+        arc_err_t run_err = ac_swarm_run(swarm);
 
         /* Print individual results */
-        printf("\n[Phase 3] Expert Analysis Results:\n\n");
+        printf("\n[Phase 2] Expert Analysis Results:\n\n");
 
         int success_count = 0;
-        size_t total_summary_len = 0;
-
         for (int i = 0; i < NUM_EXPERTS; i++) {
-            printf("┌─ [%s] %s (%lums)\n",
-                   EXPERTS[i].domain,
-                   EXPERTS[i].name,
-                   (unsigned long)tasks[i].duration_ms);
-            printf("│  %s\n", tasks[i].output);
+            const char *output = expert_added[i]
+                ? ac_swarm_output(swarm, expert_ids[i]) : NULL;
+
+            printf("┌─ [%s] %s\n", EXPERTS[i].domain, EXPERTS[i].name);
+            printf("│  %s\n", output ? output : "[Agent failed to respond]");
             printf("└─\n\n");
 
-            if (tasks[i].success) {
+            if (output) {
                 success_count++;
-                total_summary_len += strlen(tasks[i].output) + 100;
             }
         }
 
-        printf("[Stats] %d/%d experts responded, parallel time: %lums\n\n",
-               success_count, NUM_EXPERTS, (unsigned long)(parallel_end - parallel_start));
-
-        /* Build summary prompt */
-        if (success_count > 0) {
-            printf("[Phase 4] Generating comprehensive summary...\n\n");
-
-            /* Recreate summary agent each round to free memory */
-            if (round > 1) {
-                ac_agent_destroy(summary_agent);
-                summary_agent = create_summary_agent(session, model, api_key, base_url);
-                if (!summary_agent) {
-                    fprintf(stderr, "[!] Failed to recreate summary agent\n");
-                    continue;
-                }
-            }
+        printf("╔══════════════════════════════════════════════════════════════╗\n");
+        printf("║                      综合总结                                ║\n");
+        printf("╚══════════════════════════════════════════════════════════════╝\n\n");
 
-            size_t summary_prompt_size = total_summary_len + 1024;
-            char *summary_prompt = malloc(summary_prompt_size);
-            if (!summary_prompt) {
-                fprintf(stderr, "[!] Memory allocation failed\n");
-                continue;
-            }
-
-            snprintf(summary_prompt, summary_prompt_size,
-                     "用户想要了解「%s」这个词。以下是各领域专家的分析：\n\n", input);
-
-            for (int i = 0; i < NUM_EXPERTS; i++) {
-                if (tasks[i].success) {
-                    char section[MAX_OUTPUT_LEN + 128];
-                    snprintf(section, sizeof(section),
-                             "## %s专家\n%s\n\n", EXPERTS[i].domain, tasks[i].output);
-                    strncat(summary_prompt, section, summary_prompt_size - strlen(summary_prompt) - 1);
-                }
-            }
-
-            strncat(summary_prompt,
-                    "\n请综合以上各领域的分析，给出一个全面而有深度的总结。",
-                    summary_prompt_size - strlen(summary_prompt) - 1);
-
-            uint64_t summary_start = ac_platform_timestamp_ms();
-
-            ac_agent_result_t *result = ac_agent_run(summary_agent, summary_prompt);
-
-            uint64_t summary_end = ac_platform_timestamp_ms();
-
-            printf("╔══════════════════════════════════════════════════════════════╗\n");
-            printf("║                      综合总结                                ║\n");
-            printf("╚══════════════════════════════════════════════════════════════╝\n\n");
-
-            if (result && result->content) {
-                printf("%s\n", result->content);
-            } else {
-                printf("[Summary agent failed to respond]\n");
-            }
-
-            printf("\n[Stats] Summary generation time: %lums\n",
-                   (unsigned long)(summary_end - summary_start));
+        const char *summary = ac_swarm_output(swarm, summary_id);
+        if (summary) {
+            printf("%s\n", summary);
+        } else {
+            printf("[Summary skipped: %d/%d experts responded (%s)]\n",
+                   success_count, NUM_EXPERTS, ac_strerror(run_err));
+        }
 
-            free(summary_prompt);
+        /* Print swarm report */
+        ac_swarm_report_t report;
+        if (ac_swarm_get_report(swarm, &report) == ARC_OK) {
+            printf("\n[Swarm] %zu/%zu done, wall=%llums, busy=%llums, queued=%llums\n",
+                   report.done, report.tasks,
+                   (unsigned long long)report.wall_ms,
+                   (unsigned long long)report.busy_ms,
+                   (unsigned long long)report.queue_ms);
+            printf("[Swarm] critical path=%llums (%zu tasks), parallelism=%.1fx, "
+                   "utilization=%.0f%% of %zu slots\n",
+                   (unsigned long long)report.critical_path_ms,
+                   report.critical_path_tasks, report.parallelism,
+                   report.utilization * 100.0, report.peak_inflight);
         }
 
+        ac_swarm_destroy(swarm);
+
         /* Print HTTP pool stats */
         ac_http_pool_stats_t stats;
         if (ac_http_pool_get_stats(&stats) == ARC_OK) {
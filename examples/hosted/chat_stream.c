@@ -6,6 +6,8 @@
  * - Agent API with streaming mode
  * - Extended thinking mode (Claude thinking blocks)
  * - Automatic message history management
+ * - Markdown rendered on its own thread (md_async), so a slow terminal
+ *   never holds up the network read the stream callback runs on
  *
  * Usage:
  *   1. Create .env file with ANTHROPIC_API_KEY=sk-xxx
@@ -24,12 +26,14 @@
 #include <signal.h>
 #include <arc.h>
 #include <arc/env.h>
+#include "markdown/md.h"
 
 #define MAX_INPUT_LEN 4096
 #define DEFAULT_MODEL "claude-sonnet-4-5-20250514"
 
 static volatile int g_running = 1;
 static int g_show_thinking = 1;
+static md_async_t *g_ui = NULL;
 
 /* ANSI color codes */
 #define COLOR_RESET    "\033[0m"
@@ -51,8 +55,15 @@ static void print_usage(void) {
     printf("  /quit      - Exit\n\n");
 }
 
+static void ui_print(const char *text) {
+    md_async_write(g_ui, text, strlen(text));
+}
+
 /**
  * @brief Stream callback - called for each streaming event
+ *
+ * Runs on the thread reading the response, so it only queues output for
+ * the render thread.
  */
 static int stream_callback(const ac_stream_event_t* event, void* user_data) {
     (void)user_data;
@@ -64,13 +75,14 @@ static int stream_callback(const ac_stream_event_t* event, void* user_data) {
             
         case AC_STREAM_CONTENT_BLOCK_START:
             if (event->block_type == AC_BLOCK_THINKING && g_show_thinking) {
-                printf("%s[thinking] ", COLOR_THINKING);
-                fflush(stdout);
+                ui_print(COLOR_THINKING "[thinking] ");
             } else if (event->block_type == AC_BLOCK_TEXT) {
-                printf("%s", COLOR_TEXT);
+                ui_print(COLOR_TEXT);
             } else if (event->block_type == AC_BLOCK_TOOL_USE) {
-                printf("%s[tool: %s] ", COLOR_INFO, event->tool_name ? event->tool_name : "?");
-                fflush(stdout);
+                char line[256];
+                snprintf(line, sizeof(line), "%s[tool: %s] ", COLOR_INFO,
+                         event->tool_name ? event->tool_name : "?");
+                ui_print(line);
             }
             break;
             
@@ -78,21 +90,22 @@ static int stream_callback(const ac_stream_event_t* event, void* user_data) {
             if (event->delta && event->delta_len > 0) {
                 if (event->delta_type == AC_DELTA_THINKING) {
                     if (g_show_thinking) {
-                        printf("%.*s", (int)event->delta_len, event->delta);
-                        fflush(stdout);
+                        md_async_write(g_ui, event->delta, event->delta_len);
                     }
                 } else if (event->delta_type == AC_DELTA_TEXT) {
-                    printf("%.*s", (int)event->delta_len, event->delta);
-                    fflush(stdout);
+                    md_async_feed(g_ui, event->delta, event->delta_len);
                 }
             }
             break;
             
         case AC_STREAM_CONTENT_BLOCK_STOP:
             if (event->block_type == AC_BLOCK_THINKING && g_show_thinking) {
-                printf("%s\n", COLOR_RESET);
+                ui_print(COLOR_RESET "\n");
             } else if (event->block_type == AC_BLOCK_TOOL_USE) {
-                printf("%s\n", COLOR_RESET);
+                ui_print(COLOR_RESET "\n");
+            } else if (event->block_type == AC_BLOCK_TEXT) {
+                /* Render the last partial line before anything else */
+                md_async_finish(g_ui);
             }
             break;
             
@@ -101,13 +114,16 @@ static int stream_callback(const ac_stream_event_t* event, void* user_data) {
             break;
             
         case AC_STREAM_MESSAGE_STOP:
-            printf("%s\n", COLOR_RESET);
+            ui_print(COLOR_RESET "\n");
             break;
             
-        case AC_STREAM_ERROR:
-            printf("\n%s[Error: %s]%s\n", COLOR_INFO, 
-                   event->error_msg ? event->error_msg : "Unknown", COLOR_RESET);
+        case AC_STREAM_ERROR: {
+            char line[512];
+            snprintf(line, sizeof(line), "\n%s[Error: %s]%s\n", COLOR_INFO,
+                     event->error_msg ? event->error_msg : "Unknown", COLOR_RESET);
+            ui_print(line);
             return -1;  /* Abort */
+        }
             
         default:
             break;
@@ -139,10 +155,18 @@ int main(int argc, char *argv[]) {
     /* Setup signal handler */
     signal(SIGINT, signal_handler);
 
+    /* Render thread for the responses */
+    g_ui = md_async_new(md_stream_new(), MD_ASYNC_FRAME_MS);
+    if (!g_ui) {
+        fprintf(stderr, "Failed to start renderer\n");
+        return 1;
+    }
+
     /* Create session */
     ac_session_t *session = ac_session_open();
     if (!session) {
         fprintf(stderr, "Failed to create session\n");
+        md_async_free(g_ui);
         return 1;
     }
 
@@ -172,6 +196,7 @@ int main(int argc, char *argv[]) {
     if (!agent) {
         fprintf(stderr, "Failed to create agent\n");
         ac_session_close(session);
+        md_async_free(g_ui);
         return 1;
     }
 
@@ -228,6 +253,10 @@ int main(int argc, char *argv[]) {
         /* Run agent - streaming happens via callback */
         ac_agent_result_t *result = ac_agent_run(agent, input);
 
+        /* Let the render thread catch up before printing again */
+        md_async_finish(g_ui);
+        md_async_wait(g_ui);
+
         if (!result) {
             printf("[Error: Agent run failed]\n");
         }
@@ -237,6 +266,7 @@ int main(int argc, char *argv[]) {
 
     /* Cleanup - session handles everything */
     ac_session_close(session);
+    md_async_free(g_ui);
 
     printf("Goodbye!\n");
     return 0;
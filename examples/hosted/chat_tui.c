@@ -8,6 +8,11 @@
  *   - Editable input area with cursor support
  *   - Streaming response display
  *
+ * Wrapped lines are cached per message by md_transcript, and only the
+ * rows that changed are redrawn: a keystroke leaves the message plane
+ * alone, and a response whose height did not change repaints just its
+ * own bubble. notcurses_render() then writes only the damaged cells.
+ *
  * Usage:
  *   1. Create .env file with OPENAI_API_KEY=sk-xxx
  *   2. Run ./chat_tui
@@ -21,6 +26,7 @@
 #include <notcurses/notcurses.h>
 #include "arc.h"
 #include <arc/env.h>
+#include "md_transcript.h"
 
 /*============================================================================
  * Constants
@@ -49,22 +55,6 @@
 #define COLOR_USER_NAME    0x00d4ff
 #define COLOR_AI_NAME      0x7fdbda
 
-/*============================================================================
- * Message Structure
- *============================================================================*/
-
-typedef enum {
-    MSG_USER,
-    MSG_ASSISTANT,
-    MSG_SYSTEM
-} msg_type_t;
-
-typedef struct {
-    msg_type_t type;
-    char *content;
-    int content_len;
-} chat_message_t;
-
 /*============================================================================
  * Application State
  *============================================================================*/
@@ -83,10 +73,13 @@ typedef struct {
     unsigned int msg_area_rows;
 
     /* Messages */
-    chat_message_t messages[MAX_MESSAGES];
-    int message_count;
+    md_transcript_t *transcript;
     int scroll_offset;
 
+    /* Redraw state */
+    int layout_dirty;           /* Planes recreated: repaint everything */
+    int messages_dirty;         /* Scrolled or streaming toggled */
+
     /* Input buffer (manual implementation for better control) */
     char input_buffer[MAX_MESSAGE_LEN];
     int input_len;
@@ -120,9 +113,7 @@ static void app_cleanup(void) {
     }
 
     /* Free messages */
-    for (int i = 0; i < g_app.message_count; i++) {
-        free(g_app.messages[i].content);
-    }
+    md_transcript_free(g_app.transcript);
 
     /* Free streaming buffer */
     free(g_app.streaming_buffer);
@@ -172,19 +163,18 @@ static int utf8_display_width(const char *str, int len) {
  * Message Management
  *============================================================================*/
 
-static void add_message(msg_type_t type, const char *content) {
-    if (g_app.message_count >= MAX_MESSAGES) {
-        /* Remove oldest message */
-        free(g_app.messages[0].content);
-        memmove(&g_app.messages[0], &g_app.messages[1],
-                sizeof(chat_message_t) * (MAX_MESSAGES - 1));
-        g_app.message_count--;
+static void add_message(md_transcript_role_t role, const char *content) {
+    if (md_transcript_count(g_app.transcript) >= MAX_MESSAGES) {
+        md_transcript_drop_oldest(g_app.transcript);
     }
+    md_transcript_append(g_app.transcript, role, content);
+}
 
-    g_app.messages[g_app.message_count].type = type;
-    g_app.messages[g_app.message_count].content = strdup(content);
-    g_app.messages[g_app.message_count].content_len = strlen(content);
-    g_app.message_count++;
+static void set_last_message(const char *content) {
+    size_t count = md_transcript_count(g_app.transcript);
+    if (count > 0) {
+        md_transcript_set_text(g_app.transcript, count - 1, content);
+    }
 }
 
 /*============================================================================
@@ -221,128 +211,56 @@ static void render_header(void) {
     }
 }
 
-/* Word wrap a string, returns number of lines */
-static int wrap_text(const char *text, int max_width, char ***lines_out, int **line_lens) {
-    if (!text || max_width <= 0) return 0;
-
-    int capacity = 16;
-    char **lines = malloc(capacity * sizeof(char*));
-    int *lens = malloc(capacity * sizeof(int));
-    int count = 0;
-
-    const char *p = text;
-
-    while (*p) {
-        /* Find line break or wrap point */
-        const char *line_start = p;
-        int line_width = 0;
-        const char *wrap_point = NULL;
-        const char *line_end = p;
-
-        while (*p && *p != '\n') {
-            unsigned char c = (unsigned char)*p;
-            int char_width = 1;
-            int char_len = 1;
-
-            if (c < 0x80) {
-                char_len = 1;
-                char_width = 1;
-            } else if ((c & 0xE0) == 0xC0) {
-                char_len = 2;
-                char_width = 1;
-            } else if ((c & 0xF0) == 0xE0) {
-                char_len = 3;
-                char_width = 2;
-            } else if ((c & 0xF8) == 0xF0) {
-                char_len = 4;
-                char_width = 2;
-            }
-
-            if (line_width + char_width > max_width) {
-                /* Need to wrap */
-                if (wrap_point && wrap_point > line_start) {
-                    line_end = wrap_point;
-                } else {
-                    line_end = p;
-                }
-                break;
-            }
-
-            line_width += char_width;
-            line_end = p + char_len;
-
-            /* Track word boundaries */
-            if (*p == ' ') {
-                wrap_point = p + 1;
-            }
-
-            p += char_len;
-        }
-
-        /* Store line */
-        if (count >= capacity) {
-            capacity *= 2;
-            lines = realloc(lines, capacity * sizeof(char*));
-            lens = realloc(lens, capacity * sizeof(int));
-        }
-
-        int len = line_end - line_start;
-        lines[count] = malloc(len + 1);
-        memcpy(lines[count], line_start, len);
-        lines[count][len] = '\0';
-        lens[count] = len;
-        count++;
-
-        /* Skip newline */
-        if (*p == '\n') p++;
-        else if (line_end > line_start) p = line_end;
+/* Bubble geometry for the current terminal width */
+static int bubble_max_width(void) {
+    int bubble_max = (int)(g_app.term_cols * MAX_BUBBLE_WIDTH_RATIO);
+    return bubble_max < 20 ? 20 : bubble_max;
+}
 
-        /* Skip leading space on wrapped lines */
-        while (*p == ' ') p++;
-    }
+static int bubble_content_width(void) {
+    return bubble_max_width() - BUBBLE_PADDING * 2 - 2;
+}
 
-    *lines_out = lines;
-    *line_lens = lens;
-    return count;
+/* Rows taken by a message: name label, borders, lines and spacing */
+static int message_height(size_t index) {
+    size_t line_count;
+    md_transcript_lines(g_app.transcript, index, &line_count, NULL);
+    return line_count > 0 ? (int)line_count + 4 : 0;
 }
 
-static void free_wrapped_lines(char **lines, int *lens, int count) {
-    for (int i = 0; i < count; i++) {
-        free(lines[i]);
+/* Blank rows [y, y + height) of the messages plane, clipped to it */
+static void clear_rows(struct ncplane *n, int y, int height) {
+    ncplane_set_fg_rgb(n, COLOR_TEXT);
+    ncplane_set_bg_rgb(n, COLOR_BG);
+    ncplane_set_styles(n, NCSTYLE_NONE);
+    for (int row = y; row < y + height; row++) {
+        if (row < 0 || row >= (int)g_app.msg_area_rows) continue;
+        for (unsigned int col = 0; col < g_app.term_cols; col++) {
+            ncplane_putchar_yx(n, row, col, ' ');
+        }
     }
-    free(lines);
-    free(lens);
 }
 
-/* Render a single message bubble, returns height used */
-static int render_message_bubble(struct ncplane *n, int y, chat_message_t *msg,
-                                  int max_width, int is_streaming) {
-    int bubble_max = (int)(g_app.term_cols * MAX_BUBBLE_WIDTH_RATIO);
-    if (bubble_max < 20) bubble_max = 20;
-    int content_max = bubble_max - BUBBLE_PADDING * 2 - 2;
-
-    char **lines;
-    int *line_lens;
-    int line_count = wrap_text(msg->content, content_max, &lines, &line_lens);
-    if (line_count == 0) return 0;
+/* Render a single message bubble from its cached lines */
+static void render_message_bubble(struct ncplane *n, int y, size_t index, int is_streaming) {
+    size_t line_count;
+    int max_line_width;
+    const md_transcript_line_t *lines =
+        md_transcript_lines(g_app.transcript, index, &line_count, &max_line_width);
+    if (line_count == 0) return;
 
     /* Calculate bubble width */
-    int max_line_width = 0;
-    for (int i = 0; i < line_count; i++) {
-        int w = utf8_display_width(lines[i], line_lens[i]);
-        if (w > max_line_width) max_line_width = w;
-    }
+    int bubble_max = bubble_max_width();
     int bubble_width = max_line_width + BUBBLE_PADDING * 2 + 2;
     if (bubble_width > bubble_max) bubble_width = bubble_max;
 
-    int bubble_height = line_count + 2;  /* +2 for top/bottom borders */
-
     /* Calculate x position */
     int x;
     uint32_t bubble_color, name_color;
     const char *name_label;
+    md_transcript_role_t role = md_transcript_role(g_app.transcript, index);
 
-    if (msg->type == MSG_USER) {
+    if (role == MD_TRANSCRIPT_USER) {
         x = g_app.term_cols - bubble_width - 2;
         bubble_color = COLOR_USER_BUBBLE;
         name_color = COLOR_USER_NAME;
@@ -354,16 +272,11 @@ static int render_message_bubble(struct ncplane *n, int y, chat_message_t *msg,
         name_label = "AI";
     }
 
-    if (y < 0) {
-        free_wrapped_lines(lines, line_lens, line_count);
-        return bubble_height + 2;  /* +2 for name label and spacing */
-    }
-
     /* Render name label */
     ncplane_set_fg_rgb(n, name_color);
     ncplane_set_bg_rgb(n, COLOR_BG);
     ncplane_set_styles(n, NCSTYLE_BOLD);
-    if (msg->type == MSG_USER) {
+    if (role == MD_TRANSCRIPT_USER) {
         ncplane_printf_yx(n, y, x + bubble_width - strlen(name_label), "%s", name_label);
     } else {
         ncplane_printf_yx(n, y, x, "%s", name_label);
@@ -383,59 +296,100 @@ static int render_message_bubble(struct ncplane *n, int y, chat_message_t *msg,
     ncplane_putstr(n, "╮");
     y++;
 
-    /* Content lines */
-    for (int i = 0; i < line_count; i++) {
-        ncplane_printf_yx(n, y, x, "│");
-        ncplane_set_bg_rgb(n, bubble_color);
+    /* Content lines, skipping rows outside the plane */
+    for (size_t i = 0; i < line_count; i++, y++) {
+        if (y < 0 || y >= (int)g_app.msg_area_rows) continue;
 
-        /* Padding and content */
-        for (int p = 0; p < BUBBLE_PADDING; p++) {
-            ncplane_putstr(n, " ");
-        }
-        ncplane_putstr(n, lines[i]);
+        ncplane_putstr_yx(n, y, x, "│");
+        ncplane_printf(n, "%*s%.*s", BUBBLE_PADDING, "", (int)lines[i].len, lines[i].text);
 
         /* Fill remaining space */
-        int line_w = utf8_display_width(lines[i], line_lens[i]);
-        int remaining = bubble_width - 2 - BUBBLE_PADDING * 2 - line_w;
-        for (int p = 0; p < remaining; p++) {
-            ncplane_putstr(n, " ");
-        }
-        for (int p = 0; p < BUBBLE_PADDING; p++) {
-            ncplane_putstr(n, " ");
-        }
-
+        int remaining = bubble_width - 2 - BUBBLE_PADDING - lines[i].width;
+        ncplane_printf(n, "%*s", remaining > 0 ? remaining : 0, "");
         ncplane_putstr(n, "│");
-        y++;
     }
 
-    /* Bottom border with optional streaming indicator */
-    ncplane_printf_yx(n, y, x, "╰");
+    /* Bottom border */
+    ncplane_putstr_yx(n, y, x, "╰");
     for (int i = 1; i < bubble_width - 1; i++) {
         ncplane_putstr(n, "─");
     }
     ncplane_putstr(n, "╯");
-    y++;
 
     /* Streaming indicator */
     if (is_streaming) {
         ncplane_set_fg_rgb(n, COLOR_ACCENT);
         ncplane_set_bg_rgb(n, COLOR_BG);
-        ncplane_putstr_yx(n, y - 1, x + bubble_width + 1, "▌");
+        ncplane_putstr_yx(n, y, x + bubble_width + 1, "▌");
     }
+}
 
-    free_wrapped_lines(lines, line_lens, line_count);
-    return bubble_height + 2;  /* +2 for name label and spacing */
+/*
+ * Row of the first message when the transcript is bottom-anchored.
+ * Summing cached heights is cheap; nothing is wrapped here.
+ */
+static int messages_start_y(void) {
+    int total_height = 0;
+    size_t count = md_transcript_count(g_app.transcript);
+    for (size_t i = 0; i < count; i++) {
+        total_height += message_height(i);
+    }
+
+    int start_y = (int)g_app.msg_area_rows - total_height;
+    if (start_y > 0) start_y = 0;
+    return start_y + g_app.scroll_offset;
+}
+
+/* Draw messages [first, count) from row y on, stopping below the plane */
+static void render_messages_from(struct ncplane *n, size_t first, int y) {
+    size_t count = md_transcript_count(g_app.transcript);
+    for (size_t i = first; i < count && y < (int)g_app.msg_area_rows; i++) {
+        int h = message_height(i);
+        if (y + h > 0) {
+            int is_streaming = (i == count - 1) && g_app.is_streaming;
+            render_message_bubble(n, y, i, is_streaming);
+        }
+        y += h;
+    }
 }
 
 static void render_messages(void) {
     struct ncplane *n = g_app.messages_plane;
+    size_t first;
+    int shifted;
+    int damaged = md_transcript_take_damage(g_app.transcript, &first, &shifted);
+
+    /* Keystrokes in the input line leave the transcript untouched */
+    if (!damaged && !g_app.messages_dirty && !g_app.layout_dirty) return;
+
+    size_t count = md_transcript_count(g_app.transcript);
+
+    /*
+     * Same heights as last frame: only the bubbles from the first damaged
+     * message on changed, and they sit in the same rows as before.
+     */
+    if (damaged && !shifted && !g_app.messages_dirty && !g_app.layout_dirty) {
+        int y = messages_start_y();
+        for (size_t i = 0; i < first; i++) {
+            y += message_height(i);
+        }
+        int height = 0;
+        for (size_t i = first; i < count; i++) {
+            height += message_height(i);
+        }
+        clear_rows(n, y, height);
+        render_messages_from(n, first, y);
+        return;
+    }
+
+    g_app.messages_dirty = 0;
 
     /* Clear messages area */
     ncplane_set_fg_rgb(n, COLOR_TEXT);
     ncplane_set_bg_rgb(n, COLOR_BG);
     ncplane_erase(n);
 
-    if (g_app.message_count == 0) {
+    if (count == 0) {
         /* Welcome message */
         ncplane_set_fg_rgb(n, COLOR_TEXT_DIM);
         int y = g_app.msg_area_rows / 2 - 1;
@@ -445,35 +399,14 @@ static void render_messages(void) {
         return;
     }
 
-    /* Calculate total height needed */
-    int total_height = 0;
-    int *msg_heights = malloc(g_app.message_count * sizeof(int));
-
-    for (int i = 0; i < g_app.message_count; i++) {
-        int h = render_message_bubble(n, -1, &g_app.messages[i], g_app.term_cols, 0);
-        msg_heights[i] = h;
-        total_height += h;
-    }
-
-    /* Auto-scroll to bottom */
-    int visible_height = g_app.msg_area_rows;
-    int start_y = visible_height - total_height;
-    if (start_y > 0) start_y = 0;
-    start_y += g_app.scroll_offset;
-
-    /* Render messages */
-    int y = start_y;
-    for (int i = 0; i < g_app.message_count; i++) {
-        int is_last = (i == g_app.message_count - 1);
-        int is_streaming = is_last && g_app.is_streaming;
-
-        if (y + msg_heights[i] > 0 && y < (int)g_app.msg_area_rows) {
-            render_message_bubble(n, y, &g_app.messages[i], g_app.term_cols, is_streaming);
-        }
-        y += msg_heights[i];
+    /* Skip the messages above the viewport without touching the plane */
+    int y = messages_start_y();
+    size_t i = 0;
+    while (i < count && y + message_height(i) <= 0) {
+        y += message_height(i);
+        i++;
     }
-
-    free(msg_heights);
+    render_messages_from(n, i, y);
 }
 
 static void render_input(void) {
@@ -536,9 +469,12 @@ static void render_input(void) {
 }
 
 static void render_all(void) {
-    render_header();
+    if (g_app.layout_dirty) {
+        render_header();
+    }
     render_messages();
     render_input();
+    g_app.layout_dirty = 0;
     notcurses_render(g_app.nc);
 }
 
@@ -605,6 +541,10 @@ static void setup_planes(void) {
         .cols = g_app.term_cols - 4,
     };
     g_app.input_plane = ncplane_create(g_app.stdplane, &input_opts);
+
+    /* Re-wrap the transcript for the new width */
+    md_transcript_set_width(g_app.transcript, bubble_content_width());
+    g_app.layout_dirty = 1;
 }
 
 /*============================================================================
@@ -617,7 +557,7 @@ static void send_message(void) {
     if (g_app.input_len == 0 || g_app.is_streaming) return;
 
     /* Add user message to display */
-    add_message(MSG_USER, g_app.input_buffer);
+    add_message(MD_TRANSCRIPT_USER, g_app.input_buffer);
 
     /* Add to conversation history */
     ac_message_append(&g_app.history,
@@ -629,10 +569,11 @@ static void send_message(void) {
     g_app.cursor_pos = 0;
 
     /* Add placeholder for AI response */
-    add_message(MSG_ASSISTANT, "...");
+    add_message(MD_TRANSCRIPT_ASSISTANT, "...");
 
     /* Start processing (blocking mode for now) */
     g_app.is_streaming = 1;
+    g_app.messages_dirty = 1;
     render_all();
 
     /* Perform chat completion */
@@ -640,29 +581,20 @@ static void send_message(void) {
     arc_err_t err = ac_llm_chat(g_app.llm, g_app.history, NULL, &resp);
 
     g_app.is_streaming = 0;
+    g_app.messages_dirty = 1;
 
     if (err == ARC_OK && resp.content) {
         /* Update last message with response */
-        if (g_app.message_count > 0) {
-            chat_message_t *last = &g_app.messages[g_app.message_count - 1];
-            free(last->content);
-            last->content = strdup(resp.content);
-            last->content_len = strlen(resp.content);
-        }
+        set_last_message(resp.content);
 
         /* Add to conversation history */
         ac_message_append(&g_app.history,
             ac_message_create(AC_ROLE_ASSISTANT, resp.content));
     } else {
         /* Update last message with error */
-        if (g_app.message_count > 0) {
-            chat_message_t *last = &g_app.messages[g_app.message_count - 1];
-            free(last->content);
-            char error_msg[256];
-            snprintf(error_msg, sizeof(error_msg), "Error: %s", ac_strerror(err));
-            last->content = strdup(error_msg);
-            last->content_len = strlen(error_msg);
-        }
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "Error: %s", ac_strerror(err));
+        set_last_message(error_msg);
     }
 
     ac_chat_response_free(&resp);
@@ -789,23 +721,27 @@ static void handle_input(ncinput *ni) {
 
     if (ni->id == NCKEY_UP) {
         g_app.scroll_offset += 3;
+        g_app.messages_dirty = 1;
         return;
     }
 
     if (ni->id == NCKEY_DOWN) {
         g_app.scroll_offset -= 3;
         if (g_app.scroll_offset < 0) g_app.scroll_offset = 0;
+        g_app.messages_dirty = 1;
         return;
     }
 
     if (ni->id == NCKEY_PGUP) {
         g_app.scroll_offset += g_app.msg_area_rows / 2;
+        g_app.messages_dirty = 1;
         return;
     }
 
     if (ni->id == NCKEY_PGDOWN) {
         g_app.scroll_offset -= g_app.msg_area_rows / 2;
         if (g_app.scroll_offset < 0) g_app.scroll_offset = 0;
+        g_app.messages_dirty = 1;
         return;
     }
 
@@ -817,10 +753,7 @@ static void handle_input(ncinput *ni) {
 
     /* Ctrl+L to clear history */
     if (ni->ctrl && (ni->id == 'l' || ni->id == 'L')) {
-        for (int i = 0; i < g_app.message_count; i++) {
-            free(g_app.messages[i].content);
-        }
-        g_app.message_count = 0;
+        md_transcript_clear(g_app.transcript);
         g_app.scroll_offset = 0;
 
         ac_message_free(g_app.history);
@@ -914,6 +847,14 @@ int main(int argc, char *argv[]) {
         ac_message_create(AC_ROLE_SYSTEM,
             "You are a helpful assistant. Be concise and clear."));
 
+    /* Transcript; wrap width is set with the planes */
+    g_app.transcript = md_transcript_new(0);
+    if (!g_app.transcript) {
+        AC_LOG_ERROR( "Failed to create transcript\n");
+        app_cleanup();
+        return 1;
+    }
+
     /* Allocate streaming buffer */
     g_app.streaming_cap = 4096;
     g_app.streaming_buffer = malloc(g_app.streaming_cap);
@@ -8,6 +8,7 @@
 #include "minimal_cli.h"
 #include "builtin_tools.h"
 #include <arc.h>
+#include <arc/http_pool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,6 +52,13 @@ static const char *get_default_model(const char *provider) {
     return "gpt-4o-mini";
 }
 
+static const char *get_endpoint(const minimal_cli_config_t *config) {
+    if (config->api_base) return config->api_base;
+
+    return strcmp(get_provider_name(config->provider), "anthropic") == 0
+               ? "https://api.anthropic.com" : "https://api.openai.com/v1";
+}
+
 /*============================================================================
  * Create/Destroy
  *============================================================================*/
@@ -70,6 +78,11 @@ minimal_cli_t *minimal_cli_create(const minimal_cli_config_t *config) {
     /* Copy config */
     memcpy(&cli->config, config, sizeof(minimal_cli_config_t));
 
+    /* Set up curl and connect to the endpoint while we get to the prompt */
+    ac_http_pool_init_async(&(ac_http_pool_config_t){
+        .warm_urls = (const char *const[]){ get_endpoint(config), NULL },
+    });
+
     /* Configure safe mode for builtin tools */
     builtin_tools_set_safe_mode(config->safe_mode);
 
@@ -90,6 +103,7 @@ void minimal_cli_destroy(minimal_cli_t *cli) {
     if (cli->session) {
         ac_session_close(cli->session);
     }
+    ac_http_pool_shutdown();
 
     free(cli);
 }
@@ -229,12 +243,8 @@ int minimal_cli_run_interactive(minimal_cli_t *cli) {
         .max_iterations = cli->config.max_iterations > 0 ? cli->config.max_iterations : 5,
     };
 
-    /* Create agent for interactive session */
-    ac_agent_t *agent = ac_agent_create(cli->session, &params);
-    if (!agent) {
-        AC_LOG_ERROR("Failed to create agent");
-        return -1;
-    }
+    /* Created on the first message, so the prompt need not wait for the network */
+    ac_agent_t *agent = NULL;
 
     while (1) {
         /* Prompt */
@@ -281,6 +291,11 @@ int minimal_cli_run_interactive(minimal_cli_t *cli) {
             continue;
         }
 
+        if (!agent && !(agent = ac_agent_create(cli->session, &params))) {
+            AC_LOG_ERROR("Failed to create agent");
+            return -1;
+        }
+
         /* Send message to agent */
         ac_agent_result_t *result = ac_agent_run(agent, input);
 
@@ -53,6 +53,7 @@ typedef struct {
     int verbose;
     int quiet;
     int json_output;
+    int timing;                /* Print the start-up breakdown */
 } minimal_cli_config_t;
 
 /*============================================================================
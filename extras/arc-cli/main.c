@@ -6,6 +6,7 @@
 #include "minimal_cli.h"
 #include "builtin_tools.h"
 #include <arc/log.h>
+#include <arc/platform.h>
 #include <arc/sandbox.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -130,6 +131,34 @@ static ac_sandbox_confirm_result_t sandbox_confirm_callback(
     }
 }
 
+/*============================================================================
+ * Startup Timing
+ *============================================================================*/
+
+/* Start-up phases, printed by --timing before the first prompt */
+static struct {
+    uint64_t start_us;
+    uint64_t last_us;
+    char phases[256];
+    size_t len;
+} s_timing;
+
+static void timing_mark(const char *phase) {
+    uint64_t now = ac_platform_monotonic_us();
+    if (s_timing.len < sizeof(s_timing.phases)) {
+        int n = snprintf(s_timing.phases + s_timing.len, sizeof(s_timing.phases) - s_timing.len,
+                         "%s%s %.1f ms", s_timing.len ? ", " : "", phase,
+                         (double)(now - s_timing.last_us) / 1000.0);
+        s_timing.len += n > 0 ? (size_t)n : 0;
+    }
+    s_timing.last_us = now;
+}
+
+static void timing_report(void) {
+    fprintf(stderr, "Startup: %s; ready %.1f ms after main()\n", s_timing.phases,
+            (double)(s_timing.last_us - s_timing.start_us) / 1000.0);
+}
+
 /*============================================================================
  * Help & Version
  *============================================================================*/
@@ -163,6 +192,7 @@ static void print_usage(const char *prog) {
     printf("  --verbose               Enable verbose output\n");
     printf("  --quiet                 Quiet mode (minimal output)\n");
     printf("  --json                  JSON output format\n");
+    printf("  --timing                Print where start-up time went\n");
     printf("\n");
     printf("Examples:\n");
     printf("  %s \"What time is it?\"\n", prog);
@@ -358,6 +388,8 @@ static int parse_args(int argc, char **argv,
             config->quiet = 1;
         } else if (strcmp(argv[i], "--json") == 0) {
             config->json_output = 1;
+        } else if (strcmp(argv[i], "--timing") == 0) {
+            config->timing = 1;
         } else if (argv[i][0] != '-') {
             /* First non-option argument is the prompt */
             *prompt = argv[i];
@@ -402,11 +434,14 @@ int main(int argc, char **argv) {
     int ret;
     ac_sandbox_t *sandbox = NULL;
 
+    s_timing.start_us = s_timing.last_us = ac_platform_monotonic_us();
+
     /* Parse arguments */
     ret = parse_args(argc, argv, &config, &interactive, &prompt);
     if (ret != 0) {
         return ret > 0 ? 0 : 1;
     }
+    timing_mark("config");
 
     /* Initialize sandbox if enabled */
     if (config.enable_sandbox) {
@@ -457,6 +492,7 @@ int main(int argc, char **argv) {
             /* Set sandbox for tools - tools will use ac_sandbox_exec() */
             builtin_tools_set_sandbox(sandbox);
         }
+        timing_mark("sandbox");
     }
 
     /* Create CLI instance */
@@ -468,6 +504,10 @@ int main(int argc, char **argv) {
         }
         return 1;
     }
+    timing_mark("session");
+    if (config.timing) {
+        timing_report();
+    }
 
     /* Run */
     if (interactive) {
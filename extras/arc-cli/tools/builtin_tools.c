@@ -98,6 +98,39 @@ static int is_dangerous_command(const char* cmd) {
  * Tool: shell_execute
  *============================================================================*/
 
+/* Output returned to the model; longer output keeps its head and tail */
+#define SHELL_OUTPUT_MAX 65536
+
+/* Copy captured output as a string, eliding the middle of long output */
+static char* shell_output_excerpt(const ac_sandbox_output_t* output) {
+    size_t total;
+    const char* data = ac_sandbox_output_data(output, &total);
+    if (total <= SHELL_OUTPUT_MAX) {
+        char* copy = malloc(total + 1);
+        if (copy) {
+            memcpy(copy, data, total);
+            copy[total] = '\0';
+        }
+        return copy;
+    }
+
+    size_t head_len, tail_len;
+    const char* head = ac_sandbox_output_head(output, SHELL_OUTPUT_MAX / 2, &head_len);
+    const char* tail = ac_sandbox_output_tail(output, SHELL_OUTPUT_MAX / 2, &tail_len);
+    char marker[96];
+    int marker_len = snprintf(marker, sizeof(marker), "\n[... %zu bytes omitted ...]\n",
+                              total - head_len - tail_len);
+
+    char* copy = malloc(head_len + (size_t)marker_len + tail_len + 1);
+    if (copy) {
+        memcpy(copy, head, head_len);
+        memcpy(copy + head_len, marker, (size_t)marker_len);
+        memcpy(copy + head_len + (size_t)marker_len, tail, tail_len);
+        copy[head_len + (size_t)marker_len + tail_len] = '\0';
+    }
+    return copy;
+}
+
 const char* shell_execute(const char* command) {
     if (!command || strlen(command) == 0) {
         return json_error("command parameter is required");
@@ -108,16 +141,9 @@ const char* shell_execute(const char* command) {
 
     /* If sandbox is configured, use sandboxed execution */
     if (g_sandbox) {
-        /* Allocate result buffer */
-        size_t result_cap = 65536;
-        result = malloc(result_cap);
-        if (!result) {
-            return json_error("Memory allocation failed");
-        }
-        result[0] = '\0';
-
-        /* Execute in sandboxed subprocess */
-        arc_err_t err = ac_sandbox_exec(g_sandbox, command, result, result_cap, &exit_code);
+        /* Execute in sandboxed subprocess; the output is kept whole */
+        ac_sandbox_output_t* output = NULL;
+        arc_err_t err = ac_sandbox_exec_capture(g_sandbox, command, NULL, &output, &exit_code);
 
         if (err == ARC_ERR_INVALID_ARG) {
             /* Command was blocked by sandbox */
@@ -129,19 +155,23 @@ const char* shell_execute(const char* command) {
                 "The sandbox policy prevents executing this command. "
                 "The command may contain dangerous patterns or access restricted resources. "
                 "Consider using a safer alternative or check the workspace configuration.");
-            free(result);
             return json_result(json);
         } else if (err == ARC_ERR_TIMEOUT) {
             cJSON* json = cJSON_CreateObject();
             cJSON_AddStringToObject(json, "error", "Command execution timed out");
             cJSON_AddStringToObject(json, "command", command);
-            free(result);
+            ac_sandbox_output_free(output);
             return json_result(json);
         } else if (err != ARC_OK) {
-            free(result);
             return json_error("Failed to execute command in sandbox");
         }
 
+        result = shell_output_excerpt(output);
+        ac_sandbox_output_free(output);
+        if (!result) {
+            return json_error("Memory allocation failed");
+        }
+
         /* Build response */
         cJSON* json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "command", command);
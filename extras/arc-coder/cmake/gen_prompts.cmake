@@ -1,5 +1,7 @@
 # gen_prompts.cmake
-# Converts prompt .txt files to embedded C strings
+# Converts prompt .txt files to embedded C strings, each with a render plan:
+# the literal runs and ${placeholder}s of the text, by byte offset, so
+# rendering needs no search at runtime.
 #
 # Input variables:
 #   PROMPT_DIR - Directory containing prompts/system/ and prompts/tools/
@@ -8,6 +10,9 @@
 
 cmake_minimum_required(VERSION 3.15)
 
+# Placeholders a plan may refer to; the index is the PROMPT_VAR_* value
+set(PROMPT_VARS workspace cwd directory os shell user safe_mode sandbox)
+
 # Helper function to escape string for C
 function(escape_for_c INPUT_STRING OUTPUT_VAR)
     # Escape backslashes first
@@ -30,6 +35,60 @@ function(filename_to_identifier FILENAME OUTPUT_VAR)
     set(${OUTPUT_VAR} "${result}" PARENT_SCOPE)
 endfunction()
 
+# Helper function to build the render plan of a prompt
+#   CONTENT     - Prompt text
+#   PLAN_NAME   - Identifier of the generated segment array
+#   OUTPUT_DEF  - Receives the array definition ("" for an empty prompt)
+#   OUTPUT_REF  - Receives "array, count" for the lookup table
+function(build_render_plan CONTENT PLAN_NAME OUTPUT_DEF OUTPUT_REF)
+    string(LENGTH "${CONTENT}" total)
+    set(segments "")
+    set(count 0)
+    set(literal_start 0)
+    set(scan 0)
+    while(scan LESS total)
+        string(SUBSTRING "${CONTENT}" ${scan} -1 rest)
+        string(FIND "${rest}" "\${" rel)
+        if(rel EQUAL -1)
+            break()
+        endif()
+        math(EXPR at "${scan} + ${rel}")
+        string(SUBSTRING "${rest}" ${rel} -1 from)
+        string(REGEX MATCH "^\\$\\{([a-z_]+)\\}" placeholder "${from}")
+        set(var -1)
+        if(placeholder)
+            list(FIND PROMPT_VARS "${CMAKE_MATCH_1}" var)
+        endif()
+        if(var EQUAL -1)
+            math(EXPR scan "${at} + 2")
+            continue()
+        endif()
+        string(LENGTH "${placeholder}" placeholder_len)
+        if(at GREATER literal_start)
+            math(EXPR len "${at} - ${literal_start}")
+            string(APPEND segments "    { ${literal_start}, ${len}, -1 },\n")
+            math(EXPR count "${count} + 1")
+        endif()
+        string(APPEND segments "    { ${at}, ${placeholder_len}, ${var} },\n")
+        math(EXPR count "${count} + 1")
+        math(EXPR scan "${at} + ${placeholder_len}")
+        set(literal_start ${scan})
+    endwhile()
+    if(total GREATER literal_start)
+        math(EXPR len "${total} - ${literal_start}")
+        string(APPEND segments "    { ${literal_start}, ${len}, -1 },\n")
+        math(EXPR count "${count} + 1")
+    endif()
+
+    if(count EQUAL 0)
+        set(${OUTPUT_DEF} "" PARENT_SCOPE)
+        set(${OUTPUT_REF} "NULL, 0" PARENT_SCOPE)
+    else()
+        set(${OUTPUT_DEF} "static const prompt_segment_t ${PLAN_NAME}[] = {\n${segments}};\n\n" PARENT_SCOPE)
+        set(${OUTPUT_REF} "${PLAN_NAME}, ${count}" PARENT_SCOPE)
+    endif()
+endfunction()
+
 # Start building output
 set(C_CONTENT "/**\n * @file prompts_gen.c\n * @brief Auto-generated embedded prompts\n * DO NOT EDIT - Generated by gen_prompts.cmake\n */\n\n#include \"prompts_gen.h\"\n#include <stddef.h>\n\n")
 set(H_CONTENT "/**\n * @file prompts_gen.h\n * @brief Auto-generated embedded prompts header\n * DO NOT EDIT - Generated by gen_prompts.cmake\n */\n\n#ifndef PROMPTS_GEN_H\n#define PROMPTS_GEN_H\n\n#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n")
@@ -47,15 +106,18 @@ foreach(FILE ${SYSTEM_FILES})
     file(READ "${FILE}" FILE_CONTENT)
     escape_for_c("${FILE_CONTENT}" ESCAPED_CONTENT)
     
+    build_render_plan("${FILE_CONTENT}" PLAN_SYSTEM_${IDENTIFIER} PLAN_DEF PLAN_REF)
+    string(LENGTH "${FILE_CONTENT}" CONTENT_LENGTH)
+
     # Add to C file
-    set(C_CONTENT "${C_CONTENT}const char PROMPT_SYSTEM_${IDENTIFIER}[] =\n    \"${ESCAPED_CONTENT}\";\n\n")
+    set(C_CONTENT "${C_CONTENT}const char PROMPT_SYSTEM_${IDENTIFIER}[] =\n    \"${ESCAPED_CONTENT}\";\n\n${PLAN_DEF}")
     
     # Add to H file
     set(H_CONTENT "${H_CONTENT}extern const char PROMPT_SYSTEM_${IDENTIFIER}[];\n")
     
     # Build list entry
     get_filename_component(name_we "${FILE}" NAME_WE)
-    set(SYSTEM_PROMPT_LIST "${SYSTEM_PROMPT_LIST}    { \"${name_we}\", PROMPT_SYSTEM_${IDENTIFIER} },\n")
+    set(SYSTEM_PROMPT_LIST "${SYSTEM_PROMPT_LIST}    { \"${name_we}\", PROMPT_SYSTEM_${IDENTIFIER}, ${CONTENT_LENGTH}, ${PLAN_REF} },\n")
 endforeach()
 
 # Process tool prompts
@@ -71,27 +133,38 @@ foreach(FILE ${TOOL_FILES})
     file(READ "${FILE}" FILE_CONTENT)
     escape_for_c("${FILE_CONTENT}" ESCAPED_CONTENT)
     
+    build_render_plan("${FILE_CONTENT}" PLAN_TOOL_${IDENTIFIER} PLAN_DEF PLAN_REF)
+    string(LENGTH "${FILE_CONTENT}" CONTENT_LENGTH)
+
     # Add to C file
-    set(C_CONTENT "${C_CONTENT}const char PROMPT_TOOL_${IDENTIFIER}[] =\n    \"${ESCAPED_CONTENT}\";\n\n")
+    set(C_CONTENT "${C_CONTENT}const char PROMPT_TOOL_${IDENTIFIER}[] =\n    \"${ESCAPED_CONTENT}\";\n\n${PLAN_DEF}")
     
     # Add to H file
     set(H_CONTENT "${H_CONTENT}extern const char PROMPT_TOOL_${IDENTIFIER}[];\n")
     
     # Build list entry
     get_filename_component(name_we "${FILE}" NAME_WE)
-    set(TOOL_PROMPT_LIST "${TOOL_PROMPT_LIST}    { \"${name_we}\", PROMPT_TOOL_${IDENTIFIER} },\n")
+    set(TOOL_PROMPT_LIST "${TOOL_PROMPT_LIST}    { \"${name_we}\", PROMPT_TOOL_${IDENTIFIER}, ${CONTENT_LENGTH}, ${PLAN_REF} },\n")
 endforeach()
 
 # Add lookup structures
-set(H_CONTENT "${H_CONTENT}\n/* Prompt Lookup */\ntypedef struct {\n    const char *name;\n    const char *content;\n} prompt_entry_t;\n\nextern const prompt_entry_t SYSTEM_PROMPTS[];\nextern const int SYSTEM_PROMPTS_COUNT;\n\nextern const prompt_entry_t TOOL_PROMPTS[];\nextern const int TOOL_PROMPTS_COUNT;\n\n")
+set(VAR_DEFINES "")
+set(var_index 0)
+foreach(VAR ${PROMPT_VARS})
+    string(TOUPPER "${VAR}" VAR_UPPER)
+    set(VAR_DEFINES "${VAR_DEFINES}#define PROMPT_VAR_${VAR_UPPER} ${var_index}\n")
+    math(EXPR var_index "${var_index} + 1")
+endforeach()
+set(H_CONTENT "${H_CONTENT}\n/* Render Plans */\n${VAR_DEFINES}#define PROMPT_VAR_COUNT ${var_index}\n\ntypedef struct {\n    unsigned int offset;            /* Into the prompt text */\n    unsigned int len;\n    int var;                        /* PROMPT_VAR_*, -1 for literal text */\n} prompt_segment_t;\n")
+set(H_CONTENT "${H_CONTENT}\n/* Prompt Lookup */\ntypedef struct {\n    const char *name;\n    const char *content;\n    unsigned int length;\n    const prompt_segment_t *plan;   /* Covers content in order */\n    unsigned int plan_len;\n} prompt_entry_t;\n\nextern const prompt_entry_t SYSTEM_PROMPTS[];\nextern const int SYSTEM_PROMPTS_COUNT;\n\nextern const prompt_entry_t TOOL_PROMPTS[];\nextern const int TOOL_PROMPTS_COUNT;\n\n")
 
 # Add lookup arrays to C file
 list(LENGTH SYSTEM_FILES SYSTEM_COUNT)
 list(LENGTH TOOL_FILES TOOL_COUNT)
 
-set(C_CONTENT "${C_CONTENT}/* System Prompt Lookup Table */\nconst prompt_entry_t SYSTEM_PROMPTS[] = {\n${SYSTEM_PROMPT_LIST}    { NULL, NULL }\n};\nconst int SYSTEM_PROMPTS_COUNT = ${SYSTEM_COUNT};\n\n")
+set(C_CONTENT "${C_CONTENT}/* System Prompt Lookup Table */\nconst prompt_entry_t SYSTEM_PROMPTS[] = {\n${SYSTEM_PROMPT_LIST}    { NULL, NULL, 0, NULL, 0 }\n};\nconst int SYSTEM_PROMPTS_COUNT = ${SYSTEM_COUNT};\n\n")
 
-set(C_CONTENT "${C_CONTENT}/* Tool Prompt Lookup Table */\nconst prompt_entry_t TOOL_PROMPTS[] = {\n${TOOL_PROMPT_LIST}    { NULL, NULL }\n};\nconst int TOOL_PROMPTS_COUNT = ${TOOL_COUNT};\n")
+set(C_CONTENT "${C_CONTENT}/* Tool Prompt Lookup Table */\nconst prompt_entry_t TOOL_PROMPTS[] = {\n${TOOL_PROMPT_LIST}    { NULL, NULL, 0, NULL, 0 }\n};\nconst int TOOL_PROMPTS_COUNT = ${TOOL_COUNT};\n")
 
 # Finish header
 set(H_CONTENT "${H_CONTENT}#ifdef __cplusplus\n}\n#endif\n\n#endif /* PROMPTS_GEN_H */\n")
@@ -41,6 +41,7 @@ typedef struct {
 
     /* Agent Configuration */
     int max_iterations;         /* Max tool call iterations */
+    int tool_workers;           /* Read-only tool calls of a turn run at once (0/1 = sequential) */
     int enable_tools;           /* Enable tool calling */
 
     /* Safety Configuration */
@@ -55,6 +56,7 @@ typedef struct {
     int verbose;
     int quiet;
     int json_output;
+    int timing;                 /* Print the start-up breakdown */
 } code_agent_config_t;
 
 /*============================================================================
@@ -0,0 +1,84 @@
+/**
+ * @file code_subagent.h
+ * @brief Sub-agents behind the task tool
+ *
+ * Each task call runs a fresh agent in the main agent's session, so its
+ * model requests and tool batches go to the session executor. The task
+ * tool is parallel-safe: the task calls of one turn run at once, up to
+ * the main agent's tool_workers.
+ *
+ * A sub-agent has its own arenas, freed when its task ends. The tool
+ * registry of each agent type is built once and shared by every
+ * sub-agent of that type, as is the file cache behind the tools. With a
+ * progress callback on the calling tool (streaming runs), the
+ * sub-agent's text and tool calls are relayed through it as they come.
+ *
+ * When a task ends, its conversation is kept as a shared history
+ * segment under a session id ("task-1", ...) until shutdown. A task
+ * given that id starts a new sub-agent from the segment, so it continues
+ * the earlier conversation without copying it.
+ */
+
+#ifndef CODE_SUBAGENT_H
+#define CODE_SUBAGENT_H
+
+#include <arc.h>
+#include "prompt_loader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of a session id buffer, terminator included */
+#define CODE_SUBAGENT_ID_SIZE 32
+
+/**
+ * @brief What sub-agents are made from
+ */
+typedef struct {
+    ac_session_t *session;           /**< Session they run in */
+    ac_llm_params_t llm;             /**< Model (strings must outlive the sub-agents) */
+    const char *instructions;        /**< Main agent's system prompt (copied) */
+    const prompt_context_t *prompt_ctx;  /**< For the tool descriptions */
+    int max_iterations;
+    int tool_workers;
+} code_subagent_config_t;
+
+/**
+ * @brief Build the shared registries; the task tool fails until this ran
+ *
+ * @return 0 on success, -1 on error
+ */
+int code_subagent_init(const code_subagent_config_t *config);
+
+/**
+ * @brief Forget the configuration (before the session closes)
+ */
+void code_subagent_shutdown(void);
+
+/**
+ * @brief Agent types and their tools, one per line (for the task prompt)
+ */
+const char *code_subagent_describe(void);
+
+/**
+ * @brief Run a task on a new sub-agent and wait for its answer
+ *
+ * @param type         Agent type (NULL = "general", or the resumed session's)
+ * @param description  Short task description (for progress, optional)
+ * @param prompt       The task
+ * @param ctx          Context of the calling tool (progress, deadline; may be NULL)
+ * @param session_id   CODE_SUBAGENT_ID_SIZE buffer: session to resume ("" = none);
+ *                     receives the session to resume this task with ("" if
+ *                     it could not be kept)
+ * @param err          Receives a message on failure
+ * @return The sub-agent's final message (free()), NULL on failure
+ */
+char *code_subagent_run(const char *type, const char *description, const char *prompt,
+                        const ac_tool_ctx_t *ctx, char *session_id, char *err, size_t err_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CODE_SUBAGENT_H */
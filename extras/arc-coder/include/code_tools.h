@@ -4,6 +4,13 @@
  *
  * Tools for code operations, following opencode's design patterns.
  * MOC processes this file to generate wrappers and JSON schemas.
+ *
+ * The read-only tools are parallel-safe: with tool_workers > 1 the agent
+ * runs consecutive calls to them concurrently. Tools that write files or
+ * run commands stay barriers, so they keep their order relative to every
+ * other call of the turn. The task tool is parallel-safe too, so the
+ * sub-agents of one turn work at once; splitting work between them so
+ * they do not edit the same files is up to the model.
  */
 
 #ifndef CODE_TOOLS_H
@@ -44,6 +51,7 @@ AC_TOOL_META const char* bash(
 
 /**
  * @description: Read a file from the filesystem. Returns file content with line numbers. Use absolute paths.
+ * @parallel_safe
  * @param: filePath  Absolute path to the file to read
  * @param: offset    Starting line number (0-based, optional)
  * @param: limit     Number of lines to read (optional, defaults to 2000)
@@ -92,6 +100,7 @@ AC_TOOL_META const char* edit_file(
 
 /**
  * @description: List files and directories in a given path. Returns file names with types. Use absolute paths.
+ * @parallel_safe
  * @param: path    Absolute path to directory to list
  * @param: ignore  Comma-separated glob patterns to ignore (optional, e.g. "node_modules,*.log")
  */
@@ -106,6 +115,7 @@ AC_TOOL_META const char* ls(
 
 /**
  * @description: Search file contents using regular expressions. Returns matching lines with file paths and line numbers.
+ * @parallel_safe
  * @param: pattern   Regular expression pattern to search for
  * @param: path      File or directory to search in (defaults to workspace)
  * @param: include   Glob pattern to filter files (optional, e.g. "*.c" or "*.{ts,tsx}")
@@ -122,6 +132,7 @@ AC_TOOL_META const char* grep(
 
 /**
  * @description: Find files matching a glob pattern. Returns matching file paths sorted by modification time.
+ * @parallel_safe
  * @param: pattern    Glob pattern to match (e.g. star-star-slash-star.ts)
  * @param: path       Directory to search in (optional, defaults to workspace)
  */
@@ -130,6 +141,63 @@ AC_TOOL_META const char* glob_files(
     const char* path
 );
 
+/*============================================================================
+ * LSP Tool - Code Intelligence
+ *============================================================================*/
+
+/**
+ * @description: Query the language server of a file's language: goToDefinition, findReferences, hover, documentSymbol, workspaceSymbol, goToImplementation, prepareCallHierarchy, incomingCalls or outgoingCalls.
+ * @parallel_safe
+ * @param: operation  Operation to perform (e.g. goToDefinition)
+ * @param: filePath   Absolute path to the file to operate on
+ * @param: line       Line number (1-based; required for position operations)
+ * @param: character  Character offset in the line (1-based; required for position operations)
+ * @param: query      Symbol name to search for (workspaceSymbol only)
+ */
+AC_TOOL_META const char* lsp(
+    const char* operation,
+    const char* filePath,
+    int line,
+    int character,
+    const char* query
+);
+
+/*============================================================================
+ * Webfetch Tool - Web Content
+ *============================================================================*/
+
+/**
+ * @description: Fetch a URL and return its content as markdown (default), text or html. HTTP URLs are upgraded to HTTPS. Responses are cached and revalidated, so fetching a page again is cheap.
+ * @parallel_safe
+ * @param: url      Fully-formed URL to fetch
+ * @param: format   Output format: markdown, text or html (optional, defaults to markdown)
+ * @param: timeout  Timeout in milliseconds (optional, defaults to 30000, at most 120000)
+ */
+AC_TOOL_META const char* webfetch(
+    const char* url,
+    const char* format,
+    int timeout
+);
+
+/*============================================================================
+ * Task Tool - Sub-agents
+ *============================================================================*/
+
+/**
+ * @description: Launch a sub-agent that handles a complex, multistep task autonomously and returns its final message. Several task calls in one message run at once.
+ * @parallel_safe
+ * @param: description    Short (3-5 word) description of the task
+ * @param: prompt         The task for the agent to perform
+ * @param: subagent_type  Type of agent to use (optional, defaults to general)
+ * @param: session_id     Session id from an earlier task result, to continue that agent's conversation (optional)
+ */
+AC_TOOL_META const char* task(
+    const char* description,
+    const char* prompt,
+    const char* subagent_type,
+    const char* session_id
+);
+
 /*============================================================================
  * Configuration (Internal Use - NOT Tool)
  *============================================================================*/
@@ -167,6 +235,11 @@ void code_tools_set_sandbox(struct ac_sandbox *sandbox);
  */
 struct ac_sandbox *code_tools_get_sandbox(void);
 
+/**
+ * @brief Stop the language servers the lsp tool started
+ */
+void code_tools_shutdown(void);
+
 #ifdef __cplusplus
 }
 #endif
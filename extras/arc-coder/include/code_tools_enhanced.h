@@ -81,6 +81,23 @@ int code_tools_register_enhanced(
     const prompt_context_t *ctx
 );
 
+/**
+ * @brief Register the enhanced tools that pass a filter
+ *
+ * Like code_tools_register_enhanced(), for registries that offer only
+ * some tools (e.g. the read-only ones of a sub-agent).
+ *
+ * @param registry  Tool registry to add tools to
+ * @param ctx       Prompt context for placeholder substitution
+ * @param keep      Returns nonzero for tools to register (NULL = all)
+ * @return Number of tools registered, or -1 on error
+ */
+int code_tools_register_filtered(
+    ac_tool_registry_t *registry,
+    const prompt_context_t *ctx,
+    int (*keep)(const ac_tool_t *tool)
+);
+
 /*============================================================================
  * Tool Name Mapping
  *============================================================================*/
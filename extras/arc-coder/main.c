@@ -7,6 +7,7 @@
 #include "code_tools.h"
 #include "prompt_loader.h"
 #include <arc/log.h>
+#include <arc/platform.h>
 #include <arc/sandbox.h>
 #include <arc/trace_exporters.h>
 #include <stdio.h>
@@ -93,6 +94,34 @@ static ac_sandbox_confirm_result_t sandbox_confirm_callback(
     }
 }
 
+/*============================================================================
+ * Startup Timing
+ *============================================================================*/
+
+/* Start-up phases, printed by --timing once the agent is ready */
+static struct {
+    uint64_t start_us;
+    uint64_t last_us;
+    char phases[256];
+    size_t len;
+} s_timing;
+
+static void timing_mark(const char *phase) {
+    uint64_t now = ac_platform_monotonic_us();
+    if (s_timing.len < sizeof(s_timing.phases)) {
+        int n = snprintf(s_timing.phases + s_timing.len, sizeof(s_timing.phases) - s_timing.len,
+                         "%s%s %.1f ms", s_timing.len ? ", " : "", phase,
+                         (double)(now - s_timing.last_us) / 1000.0);
+        s_timing.len += n > 0 ? (size_t)n : 0;
+    }
+    s_timing.last_us = now;
+}
+
+static void timing_report(void) {
+    fprintf(stderr, "Startup: %s; ready %.1f ms after main()\n", s_timing.phases,
+            (double)(s_timing.last_us - s_timing.start_us) / 1000.0);
+}
+
 /*============================================================================
  * Help & Version
  *============================================================================*/
@@ -115,6 +144,7 @@ static void print_usage(const char *prog) {
     printf("Agent Options:\n");
     printf("  --workspace PATH        Workspace directory (default: current dir)\n");
     printf("  --max-iter N            Max tool iterations (default: 10)\n");
+    printf("  --tool-workers N        Read-only tool calls run at once (default: 8)\n");
     printf("  --system-prompt NAME    System prompt to use (default: anthropic)\n");
     printf("  --timeout MS            Request timeout in ms (default: 120000)\n");
     printf("\n");
@@ -127,6 +157,7 @@ static void print_usage(const char *prog) {
     printf("  --verbose               Enable verbose output\n");
     printf("  --quiet                 Quiet mode (minimal output)\n");
     printf("  --json                  JSON output format\n");
+    printf("  --timing                Print where start-up time went\n");
     printf("\n");
     printf("Examples:\n");
     printf("  %s \"Read main.c and explain what it does\"\n", prog);
@@ -140,6 +171,12 @@ static void print_usage(const char *prog) {
     printf("  CODE_AGENT_MODEL        Default model\n");
     printf("  CODE_AGENT_PROVIDER     Default provider\n");
     printf("  CODE_AGENT_WORKSPACE    Default workspace\n");
+    printf("  CODE_INDEX              Trigram index for grep (default: true)\n");
+    printf("  WEBFETCH_CACHE          HTTP cache of the webfetch tool (default: true)\n");
+    printf("  WEBFETCH_CACHE_DIR      Its directory (default: ~/.cache/arc-coder/webfetch)\n");
+    printf("  LSP_IDLE_TIMEOUT        Seconds before an unused language server stops (default: 600)\n");
+    printf("  LSP_CLANGD, LSP_PYTHON  Language server commands (also LSP_GOPLS, LSP_RUST_ANALYZER,\n");
+    printf("                          LSP_TYPESCRIPT)\n");
     printf("\n");
     printf("Available System Prompts:\n");
     int count = prompt_system_count();
@@ -208,6 +245,12 @@ static int parse_args(int argc, char **argv,
         AC_LOG_INFO("max iterations default:%d",config->max_iterations);
     }
 
+    /* Parse tool concurrency from env */
+    const char *workers_str = getenv("TOOL_WORKERS");
+    if (workers_str) {
+        config->tool_workers = atoi(workers_str);
+    }
+
     config->timeout_ms = 60000;
     config->enable_tools = 1;
 
@@ -285,6 +328,12 @@ static int parse_args(int argc, char **argv,
                 return -1;
             }
             config->max_iterations = atoi(argv[i]);
+        } else if (strcmp(argv[i], "--tool-workers") == 0) {
+            if (++i >= argc) {
+                fprintf(stderr, "Error: --tool-workers requires an argument\n");
+                return -1;
+            }
+            config->tool_workers = atoi(argv[i]);
         } else if (strcmp(argv[i], "--system-prompt") == 0) {
             if (++i >= argc) {
                 fprintf(stderr, "Error: --system-prompt requires an argument\n");
@@ -309,6 +358,8 @@ static int parse_args(int argc, char **argv,
             config->quiet = 1;
         } else if (strcmp(argv[i], "--json") == 0) {
             config->json_output = 1;
+        } else if (strcmp(argv[i], "--timing") == 0) {
+            config->timing = 1;
         } else if (argv[i][0] != '-') {
             *task = argv[i];
         } else {
@@ -345,11 +396,14 @@ int main(int argc, char **argv) {
     int ret;
     ac_sandbox_t *sandbox = NULL;
 
+    s_timing.start_us = s_timing.last_us = ac_platform_monotonic_us();
+
     /* Parse arguments */
     ret = parse_args(argc, argv, &config, &interactive, &task);
     if (ret != 0) {
         return ret > 0 ? 0 : 1;
     }
+    timing_mark("config");
 
     /* Initialize trace exporter - save traces to ./logs directory */
     ac_trace_json_config_t trace_config = {
@@ -364,6 +418,7 @@ int main(int argc, char **argv) {
     } else if (!config.quiet) {
         printf("Trace: enabled (output: ./logs)\n");
     }
+    timing_mark("trace");
 
     /* Initialize sandbox if enabled */
     if (config.enable_sandbox) {
@@ -399,6 +454,7 @@ int main(int argc, char **argv) {
                 fprintf(stderr, "Warning: Failed to create sandbox\n");
             }
         }
+        timing_mark("sandbox");
     }
 
     /* Create agent */
@@ -408,6 +464,10 @@ int main(int argc, char **argv) {
         if (sandbox) ac_sandbox_destroy(sandbox);
         return 1;
     }
+    timing_mark("agent");
+    if (config.timing) {
+        timing_report();
+    }
 
     /* Run */
     if (interactive) {
@@ -424,6 +484,7 @@ int main(int argc, char **argv) {
 
     /* Cleanup */
     code_agent_destroy(agent);
+    code_tools_shutdown();
 
     code_tools_set_sandbox(NULL);
     if (sandbox) {
@@ -6,8 +6,10 @@
 #include "code_agent.h"
 #include "code_tools.h"
 #include "code_tools_enhanced.h"
+#include "code_subagent.h"
 #include "prompt_loader.h"
 #include <arc.h>
+#include <arc/http_pool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,6 +27,8 @@ struct code_agent {
     ac_session_t *session;
     char *rendered_system_prompt;
     prompt_context_t prompt_ctx;  /**< Context for prompt placeholder substitution */
+    ac_tool_registry_t *tools;    /**< Main agent's tools (NULL = disabled) */
+    int tool_count;
 };
 
 /*============================================================================
@@ -41,6 +45,7 @@ code_agent_config_t code_agent_default_config(void) {
         .timeout_ms = 120000,
         .workspace = NULL,  /* Will default to cwd */
         .max_iterations = 10,
+        .tool_workers = 8,
         .enable_tools = 1,
         .safe_mode = 1,
         .enable_sandbox = 1,
@@ -80,6 +85,14 @@ static const char *get_default_model(const char *provider) {
     return "gpt-4o-mini";
 }
 
+/** Endpoint the provider will talk to, for pre-connecting */
+static const char *get_endpoint(const code_agent_config_t *config) {
+    if (config->api_base) return config->api_base;
+
+    return strcmp(get_provider_name(config->provider), "anthropic") == 0
+               ? "https://api.anthropic.com" : "https://api.openai.com/v1";
+}
+
 /*============================================================================
  * Create/Destroy
  *============================================================================*/
@@ -99,6 +112,15 @@ code_agent_t *code_agent_create(const code_agent_config_t *config) {
     /* Copy config */
     memcpy(&agent->config, config, sizeof(code_agent_config_t));
 
+    /*
+     * curl, TLS and the connection to the model's endpoint are set up in
+     * the background while the prompt and tools load; the main agent is
+     * only created on the first task and finds them ready.
+     */
+    ac_http_pool_init_async(&(ac_http_pool_config_t){
+        .warm_urls = (const char *const[]){ get_endpoint(config), NULL },
+    });
+
     /* Set default workspace if not provided */
     if (!agent->config.workspace) {
         static char cwd[4096];
@@ -142,15 +164,46 @@ code_agent_t *code_agent_create(const code_agent_config_t *config) {
         return NULL;
     }
 
+    /* Sub-agents of the task tool run in the same session, on the same model */
+    if (agent->config.enable_tools) {
+        code_subagent_config_t subagents = {
+            .session = agent->session,
+            .llm = {
+                .provider = get_provider_name(agent->config.provider),
+                .model = agent->config.model ? agent->config.model
+                                             : get_default_model(agent->config.provider),
+                .api_key = agent->config.api_key,
+                .api_base = agent->config.api_base,
+                .temperature = agent->config.temperature,
+                .timeout_ms = agent->config.timeout_ms,
+            },
+            .instructions = agent->rendered_system_prompt,
+            .prompt_ctx = &agent->prompt_ctx,
+            .max_iterations = agent->config.max_iterations,
+            .tool_workers = agent->config.tool_workers,
+        };
+        if (code_subagent_init(&subagents) != 0) {
+            AC_LOG_WARN("Sub-agents unavailable: the task tool will fail");
+        }
+
+        /* Main agent's tools, with enhanced prompt-based descriptions */
+        agent->tools = ac_tool_registry_create(agent->session);
+        if (agent->tools) {
+            agent->tool_count = code_tools_register_enhanced(agent->tools, &agent->prompt_ctx);
+        }
+    }
+
     return agent;
 }
 
 void code_agent_destroy(code_agent_t *agent) {
     if (!agent) return;
 
+    code_subagent_shutdown();
     if (agent->session) {
         ac_session_close(agent->session);
     }
+    ac_http_pool_shutdown();
 
     if (agent->rendered_system_prompt) {
         free(agent->rendered_system_prompt);
@@ -159,53 +212,45 @@ void code_agent_destroy(code_agent_t *agent) {
     free(agent);
 }
 
-/*============================================================================
- * Run Once Mode
- *============================================================================*/
-
-int code_agent_run_once(code_agent_t *agent, const char *task) {
-    if (!agent || !task) return -1;
-
-    const char *provider = get_provider_name(agent->config.provider);
-    const char *model = agent->config.model ?
-                        agent->config.model :
-                        get_default_model(agent->config.provider);
-
-    if (!agent->config.quiet) {
-        printf("[Task] %s\n\n", task);
-    }
-
-    /* Create tool registry with enhanced descriptions */
-    ac_tool_registry_t *tools = NULL;
-    if (agent->config.enable_tools) {
-        tools = ac_tool_registry_create(agent->session);
-        if (tools) {
-            /* Use enhanced registration with prompt-based descriptions */
-            int registered = code_tools_register_enhanced(tools, &agent->prompt_ctx);
-            if (!agent->config.quiet && registered > 0) {
-                printf("Registered %d tools with enhanced descriptions\n", registered);
-            }
-        }
-    }
-
-    /* Build agent configuration */
+/**
+ * @brief Create the main agent in the agent's session
+ */
+static ac_agent_t *create_main_agent(code_agent_t *agent) {
     ac_agent_params_t params = {
         .name = "CodeAgent",
         .instructions = agent->rendered_system_prompt,
         .llm = {
-            .provider = provider,
-            .model = model,
+            .provider = get_provider_name(agent->config.provider),
+            .model = agent->config.model ? agent->config.model
+                                         : get_default_model(agent->config.provider),
             .api_key = agent->config.api_key,
             .api_base = agent->config.api_base,
             .temperature = agent->config.temperature,
             .timeout_ms = agent->config.timeout_ms,
         },
-        .tools = tools,
+        .tools = agent->tools,
         .max_iterations = agent->config.max_iterations,
+        .tool_workers = agent->config.tool_workers,
+        .memory = { .dedup_tool_results = 1 },   /* Files are read again and again */
     };
+    return ac_agent_create(agent->session, &params);
+}
 
-    /* Create and run agent */
-    ac_agent_t *ac_agent = ac_agent_create(agent->session, &params);
+/*============================================================================
+ * Run Once Mode
+ *============================================================================*/
+
+int code_agent_run_once(code_agent_t *agent, const char *task) {
+    if (!agent || !task) return -1;
+
+    if (!agent->config.quiet) {
+        printf("[Task] %s\n\n", task);
+        if (agent->tool_count > 0) {
+            printf("Registered %d tools with enhanced descriptions\n", agent->tool_count);
+        }
+    }
+
+    ac_agent_t *ac_agent = create_main_agent(agent);
     if (!ac_agent) {
         AC_LOG_ERROR("Failed to create agent");
         return -1;
@@ -261,41 +306,12 @@ int code_agent_run_interactive(code_agent_t *agent) {
         printf("Type 'exit' or 'quit' to exit, 'help' for commands.\n\n");
     }
 
-    /* Create tool registry with enhanced descriptions */
-    ac_tool_registry_t *tools = NULL;
-    if (agent->config.enable_tools) {
-        tools = ac_tool_registry_create(agent->session);
-        if (tools) {
-            /* Use enhanced registration with prompt-based descriptions */
-            int registered = code_tools_register_enhanced(tools, &agent->prompt_ctx);
-            if (!agent->config.quiet && registered > 0) {
-                printf("Tools: %d registered with enhanced prompts\n\n", registered);
-            }
-        }
+    if (!agent->config.quiet && agent->tool_count > 0) {
+        printf("Tools: %d registered with enhanced prompts\n\n", agent->tool_count);
     }
 
-    /* Build agent configuration */
-    ac_agent_params_t params = {
-        .name = "CodeAgent",
-        .instructions = agent->rendered_system_prompt,
-        .llm = {
-            .provider = provider,
-            .model = model,
-            .api_key = agent->config.api_key,
-            .api_base = agent->config.api_base,
-            .temperature = agent->config.temperature,
-            .timeout_ms = agent->config.timeout_ms,
-        },
-        .tools = tools,
-        .max_iterations = agent->config.max_iterations,
-    };
-
-    /* Create agent for session */
-    ac_agent_t *ac_agent = ac_agent_create(agent->session, &params);
-    if (!ac_agent) {
-        AC_LOG_ERROR("Failed to create agent");
-        return -1;
-    }
+    /* Created on the first task, so the prompt need not wait for the network */
+    ac_agent_t *ac_agent = NULL;
 
     while (1) {
         printf("> ");
@@ -336,6 +352,9 @@ int code_agent_run_interactive(code_agent_t *agent) {
             printf("  ls             List directory contents\n");
             printf("  grep           Search file contents\n");
             printf("  glob_files     Find files by pattern\n");
+            printf("  lsp            Query language servers (definitions, references)\n");
+            printf("  webfetch       Fetch web pages as markdown\n");
+            printf("  task           Run sub-agents on parts of a task\n");
             printf("\n");
             continue;
         }
@@ -362,6 +381,11 @@ int code_agent_run_interactive(code_agent_t *agent) {
             continue;
         }
 
+        if (!ac_agent && !(ac_agent = create_main_agent(agent))) {
+            AC_LOG_ERROR("Failed to create agent");
+            return -1;
+        }
+
         /* Run task */
         ac_agent_result_t *result = ac_agent_run(ac_agent, input);
 
@@ -0,0 +1,349 @@
+/**
+ * @file code_subagent.c
+ * @brief Sub-agents behind the task tool
+ */
+
+#include "code_subagent.h"
+#include "code_tools_enhanced.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Agent Types
+ *============================================================================*/
+
+typedef struct {
+    const char *name;
+    const char *description;         /* For the task tool's {agents} list */
+    const char *instructions;        /* Added to the main system prompt */
+    int read_only;                   /* Only the parallel-safe tools */
+} subagent_type_t;
+
+#define SUBAGENT_PREAMBLE \
+    "You are a sub-agent, started by the main agent through its task tool. " \
+    "Work on the task autonomously: nobody will answer questions. Your final " \
+    "message is all the main agent sees of your work, so make it contain " \
+    "everything the task asked for."
+
+static const subagent_type_t TYPES[] = {
+    {
+        "general",
+        "General-purpose agent for researching complex questions, searching for code, "
+        "and executing multi-step tasks, changes to files included "
+        "(Tools: all except task)",
+        SUBAGENT_PREAMBLE,
+        0
+    },
+    {
+        "explore",
+        "Fast read-only agent for finding files, searching code and answering questions "
+        "about the codebase (Tools: read_file, ls, grep, glob_files, lsp, webfetch)",
+        SUBAGENT_PREAMBLE " You can only read: do not try to change files or run commands.",
+        1
+    },
+};
+
+#define TYPE_COUNT (sizeof(TYPES) / sizeof(TYPES[0]))
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+/* Set by code_subagent_init() before the first run, then only read */
+static struct {
+    ac_session_t *session;
+    ac_llm_params_t llm;
+    int max_iterations;
+    int tool_workers;
+    ac_tool_registry_t *registries[TYPE_COUNT];
+    char *instructions[TYPE_COUNT];
+} g_subagents;
+
+/* Finished sub-agents that a later task call can resume */
+typedef struct {
+    char id[CODE_SUBAGENT_ID_SIZE];
+    size_t type;
+    ac_history_segment_t *history;   /* Conversation after its last task */
+} subagent_session_t;
+
+static pthread_mutex_t g_sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+static subagent_session_t *g_sessions;  /* Under g_sessions_lock, up to the counter */
+static size_t g_session_count;
+static size_t g_session_capacity;
+
+static int keep_for_general(const ac_tool_t *tool) {
+    return strcmp(tool->name, "task") != 0;    /* Sub-agents do not nest */
+}
+
+static int keep_for_read_only(const ac_tool_t *tool) {
+    return tool->parallel_safe && strcmp(tool->name, "task") != 0;
+}
+
+int code_subagent_init(const code_subagent_config_t *config) {
+    if (!config || !config->session) {
+        return -1;
+    }
+    code_subagent_shutdown();
+
+    for (size_t i = 0; i < TYPE_COUNT; i++) {
+        ac_tool_registry_t *registry = ac_tool_registry_create(config->session);
+        if (!registry ||
+            code_tools_register_filtered(registry, config->prompt_ctx,
+                                         TYPES[i].read_only ? keep_for_read_only
+                                                            : keep_for_general) < 0) {
+            code_subagent_shutdown();
+            return -1;
+        }
+        g_subagents.registries[i] = registry;
+
+        const char *base = config->instructions ? config->instructions : "";
+        size_t len = strlen(base) + strlen(TYPES[i].instructions) + 3;
+        g_subagents.instructions[i] = malloc(len);
+        if (!g_subagents.instructions[i]) {
+            code_subagent_shutdown();
+            return -1;
+        }
+        snprintf(g_subagents.instructions[i], len, "%s%s%s", base, base[0] ? "\n\n" : "",
+                 TYPES[i].instructions);
+    }
+
+    g_subagents.llm = config->llm;
+    g_subagents.max_iterations = config->max_iterations;
+    g_subagents.tool_workers = config->tool_workers;
+    g_subagents.session = config->session;
+    return 0;
+}
+
+void code_subagent_shutdown(void) {
+    /* Registries live in the session arena and go with the session */
+    for (size_t i = 0; i < TYPE_COUNT; i++) {
+        free(g_subagents.instructions[i]);
+    }
+    memset(&g_subagents, 0, sizeof(g_subagents));
+
+    pthread_mutex_lock(&g_sessions_lock);
+    for (size_t i = 0; i < g_session_count; i++) {
+        ac_history_segment_release(g_sessions[i].history);
+    }
+    free(g_sessions);
+    g_sessions = NULL;
+    g_session_count = 0;
+    g_session_capacity = 0;
+    pthread_mutex_unlock(&g_sessions_lock);
+}
+
+const char *code_subagent_describe(void) {
+    static char list[1024];
+    if (!list[0]) {
+        size_t len = 0;
+        for (size_t i = 0; i < TYPE_COUNT && len < sizeof(list); i++) {
+            len += (size_t)snprintf(list + len, sizeof(list) - len, "%s- %s: %s",
+                                    i ? "\n" : "", TYPES[i].name, TYPES[i].description);
+        }
+    }
+    return list;
+}
+
+/*============================================================================
+ * Sessions
+ *============================================================================*/
+
+/** Call with g_sessions_lock held */
+static subagent_session_t *session_find(const char *id) {
+    for (size_t i = 0; i < g_session_count; i++) {
+        if (strcmp(g_sessions[i].id, id) == 0) {
+            return &g_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Take a reference to the history of session id, and its type
+ *
+ * @return 0, -1 (with err set) if there is no such session
+ */
+static int session_resume(const char *id, size_t *type, ac_history_segment_t **history,
+                          char *err, size_t err_size) {
+    pthread_mutex_lock(&g_sessions_lock);
+    subagent_session_t *session = session_find(id);
+    if (session) {
+        *type = session->type;
+        *history = ac_history_segment_retain(session->history);
+    }
+    pthread_mutex_unlock(&g_sessions_lock);
+    if (!session) {
+        snprintf(err, err_size, "Unknown session_id '%s'", id);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Keep the agent's conversation for a later task call
+ *
+ * Stores it under id when resuming, under a new id otherwise. Concurrent
+ * tasks resuming the same session each continue from where it was; the
+ * one that ends last is kept.
+ *
+ * @param id  Session to update ("" = new one), receives its id
+ * @return 0, -1 if the conversation could not be kept (id set to "")
+ */
+static int session_store(ac_agent_t *agent, size_t type, char *id) {
+    ac_history_segment_t *history = NULL;
+    if (ac_agent_history_share(agent, &history) != ARC_OK) {
+        id[0] = '\0';
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_sessions_lock);
+    subagent_session_t *session = id[0] ? session_find(id) : NULL;
+    if (!session && g_session_count == g_session_capacity) {
+        size_t capacity = g_session_capacity ? g_session_capacity * 2 : 8;
+        subagent_session_t *grown = realloc(g_sessions, capacity * sizeof(*grown));
+        if (grown) {
+            g_sessions = grown;
+            g_session_capacity = capacity;
+        }
+    }
+    if (!session && g_session_count < g_session_capacity) {
+        session = &g_sessions[g_session_count];
+        snprintf(session->id, sizeof(session->id), "task-%zu", ++g_session_count);
+        session->history = NULL;
+    }
+    if (session) {
+        ac_history_segment_release(session->history);
+        session->history = history;
+        session->type = type;
+        memcpy(id, session->id, sizeof(session->id));
+    }
+    pthread_mutex_unlock(&g_sessions_lock);
+
+    if (!session) {
+        ac_history_segment_release(history);
+        id[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Running
+ *============================================================================*/
+
+typedef struct {
+    const ac_tool_ctx_t *ctx;
+    ac_agent_t *agent;
+    double progress;                 /* Bytes relayed */
+} relay_t;
+
+static void relay_text(relay_t *relay, const char *text, size_t len) {
+    relay->progress += (double)len;
+    ac_tool_progress_t progress = {
+        .tool_name = "task",
+        .progress = relay->progress,
+        .message = text,
+        .message_len = len
+    };
+    relay->ctx->on_progress(&progress, relay->ctx->progress_user_data);
+}
+
+/** Relay the sub-agent's text and tool calls as progress of the task call */
+static int relay_stream(const ac_stream_event_t *event, void *user_data) {
+    relay_t *relay = (relay_t *)user_data;
+    if (ac_tool_ctx_cancelled(relay->ctx)) {
+        ac_agent_cancel(relay->agent);
+        return 1;
+    }
+    if (event->type == AC_STREAM_DELTA && event->delta_type == AC_DELTA_TEXT && event->delta) {
+        relay_text(relay, event->delta, event->delta_len);
+    } else if (event->type == AC_STREAM_CONTENT_BLOCK_START && event->tool_name) {
+        char line[160];
+        int len = snprintf(line, sizeof(line), "\n[%s]\n", event->tool_name);
+        relay_text(relay, line, len < (int)sizeof(line) ? (size_t)len : sizeof(line) - 1);
+    }
+    return 0;
+}
+
+char *code_subagent_run(const char *type, const char *description, const char *prompt,
+                        const ac_tool_ctx_t *ctx, char *session_id, char *err, size_t err_size) {
+    if (!g_subagents.session) {
+        snprintf(err, err_size, "Sub-agents are not available");
+        return NULL;
+    }
+    size_t t = 0;
+    while (t < TYPE_COUNT && type && type[0] && strcmp(TYPES[t].name, type) != 0) {
+        t++;
+    }
+    if (t == TYPE_COUNT) {
+        snprintf(err, err_size, "Unknown subagent_type '%s'", type);
+        return NULL;
+    }
+    ac_history_segment_t *history = NULL;
+    if (session_id[0]) {
+        size_t resumed;
+        if (session_resume(session_id, &resumed, &history, err, err_size) != 0) {
+            return NULL;
+        }
+        if (type && type[0] && resumed != t) {
+            snprintf(err, err_size, "session_id '%s' belongs to subagent_type '%s', not '%s'",
+                     session_id, TYPES[resumed].name, TYPES[t].name);
+            ac_history_segment_release(history);
+            return NULL;
+        }
+        t = resumed;
+    }
+
+    /* Also names the trace file, so keep it to file name characters */
+    char name[96];
+    int len = snprintf(name, sizeof(name), "CodeAgent-%s%s%.64s", TYPES[t].name,
+                       description && description[0] ? "-" : "", description ? description : "");
+    for (int i = 0; i < len && i < (int)sizeof(name) - 1; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '-') {
+            name[i] = '_';
+        }
+    }
+    relay_t relay = { ctx, NULL, 0 };
+    int stream = ctx && ctx->on_progress;
+    ac_llm_params_t llm = g_subagents.llm;
+    if (ctx && ctx->cancel) {
+        llm.cancel = ctx->cancel;    /* Cancelling the main run stops the sub-agent too */
+    }
+    ac_agent_t *agent = ac_agent_create(g_subagents.session, &(ac_agent_params_t){
+        .name = name,
+        .instructions = g_subagents.instructions[t],
+        .llm = llm,
+        .tools = g_subagents.registries[t],
+        .max_iterations = g_subagents.max_iterations,
+        .tool_workers = g_subagents.tool_workers,
+        .memory = { .dedup_tool_results = 1 },
+        .callbacks = { stream ? relay_stream : NULL, &relay },
+    });
+    if (!agent || (history && ac_agent_history_attach(agent, history) != ARC_OK)) {
+        snprintf(err, err_size, agent ? "Failed to resume sub-agent" : "Failed to create sub-agent");
+        ac_history_segment_release(history);
+        if (agent) {
+            ac_agent_destroy(agent);
+        }
+        return NULL;
+    }
+    ac_history_segment_release(history);    /* The agent holds its own reference */
+    relay.agent = agent;
+    if (ctx && ctx->deadline_ms) {
+        ac_agent_set_deadline(agent, ctx->deadline_ms);
+    }
+
+    ac_agent_result_t *result = ac_agent_run(agent, prompt);
+    char *answer = result && result->content ? strdup(result->content) : NULL;
+    if (!answer) {
+        snprintf(err, err_size, ac_tool_ctx_cancelled(ctx) ? "Sub-agent cancelled"
+                                                            : "Sub-agent failed");
+    } else {
+        session_store(agent, t, session_id);
+    }
+    ac_agent_destroy(agent);
+    return answer;
+}
@@ -6,6 +6,7 @@
  */
 
 #include "code_tools_enhanced.h"
+#include "code_subagent.h"
 #include "code_tools_gen.h"
 #include "prompt_loader.h"
 #include <stdlib.h>
@@ -29,6 +30,9 @@ static const code_tool_name_map_t TOOL_NAME_MAP[] = {
     { "ls",         "ls" },
     { "grep",       "grep" },
     { "glob_files", "glob" },
+    { "lsp",        "lsp" },
+    { "webfetch",   "webfetch" },
+    { "task",       "task" },
     { NULL, NULL }
 };
 
@@ -49,6 +53,29 @@ const char *code_tool_get_prompt_name(const char *moc_name) {
  * Enhanced Tool Creation
  *============================================================================*/
 
+/**
+ * @brief Replace the first {name} of a rendered description (frees desc)
+ */
+static char *fill_placeholder(char *desc, const char *name, const char *value) {
+    char *at = strstr(desc, name);
+    if (!at) {
+        return desc;
+    }
+    size_t name_len = strlen(name);
+    size_t value_len = strlen(value);
+    size_t len = strlen(desc) - name_len + value_len;
+    char *filled = malloc(len + 1);
+    if (!filled) {
+        return desc;
+    }
+    size_t head = (size_t)(at - desc);
+    memcpy(filled, desc, head);
+    memcpy(filled + head, value, value_len);
+    strcpy(filled + head + value_len, at + name_len);
+    free(desc);
+    return filled;
+}
+
 ac_tool_t **code_tools_enhanced_create(
     const prompt_context_t *ctx,
     size_t *out_count
@@ -86,6 +113,10 @@ ac_tool_t **code_tools_enhanced_create(
 
         if (rendered_desc) {
             /* Use rendered prompt as description */
+            if (strcmp(moc_tool->name, "task") == 0) {
+                rendered_desc = fill_placeholder(rendered_desc, "{agents}",
+                                                 code_subagent_describe());
+            }
             tool->description = rendered_desc;
         }
         /* else: keep MOC-generated description */
@@ -119,6 +150,14 @@ void code_tools_enhanced_free(ac_tool_t **tools, size_t count) {
 int code_tools_register_enhanced(
     ac_tool_registry_t *registry,
     const prompt_context_t *ctx
+) {
+    return code_tools_register_filtered(registry, ctx, NULL);
+}
+
+int code_tools_register_filtered(
+    ac_tool_registry_t *registry,
+    const prompt_context_t *ctx,
+    int (*keep)(const ac_tool_t *tool)
 ) {
     if (!registry) return -1;
 
@@ -128,7 +167,7 @@ int code_tools_register_enhanced(
 
     int registered = 0;
     for (size_t i = 0; i < count; i++) {
-        if (tools[i]) {
+        if (tools[i] && (!keep || keep(tools[i]))) {
             if (ac_tool_registry_add(registry, tools[i]) == ARC_OK) {
                 registered++;
             }
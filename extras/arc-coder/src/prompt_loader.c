@@ -1,6 +1,10 @@
 /**
  * @file prompt_loader.c
  * @brief Prompt Loading and Rendering Implementation
+ *
+ * Prompts are compiled in with a render plan (gen_prompts.cmake): the
+ * offsets of their literal runs and placeholders. Rendering sizes the
+ * result from the plan and fills it with one memcpy per segment.
  */
 
 #include "prompt_loader.h"
@@ -24,112 +28,180 @@
  * Prompt Access
  *============================================================================*/
 
-const char *prompt_get_system(const char *name) {
+static const prompt_entry_t *find_prompt(const prompt_entry_t *table, int count,
+                                         const char *name) {
     if (!name) return NULL;
-    
-    for (int i = 0; i < SYSTEM_PROMPTS_COUNT; i++) {
-        if (SYSTEM_PROMPTS[i].name && strcmp(SYSTEM_PROMPTS[i].name, name) == 0) {
-            return SYSTEM_PROMPTS[i].content;
+
+    for (int i = 0; i < count; i++) {
+        if (table[i].name && strcmp(table[i].name, name) == 0) {
+            return &table[i];
         }
     }
-    
+
     return NULL;
 }
 
+const char *prompt_get_system(const char *name) {
+    const prompt_entry_t *entry = find_prompt(SYSTEM_PROMPTS, SYSTEM_PROMPTS_COUNT, name);
+    return entry ? entry->content : NULL;
+}
+
 const char *prompt_get_tool(const char *name) {
-    if (!name) return NULL;
-    
-    for (int i = 0; i < TOOL_PROMPTS_COUNT; i++) {
-        if (TOOL_PROMPTS[i].name && strcmp(TOOL_PROMPTS[i].name, name) == 0) {
-            return TOOL_PROMPTS[i].content;
-        }
-    }
-    
-    return NULL;
+    const prompt_entry_t *entry = find_prompt(TOOL_PROMPTS, TOOL_PROMPTS_COUNT, name);
+    return entry ? entry->content : NULL;
 }
 
 /*============================================================================
- * Variable Substitution Helper
+ * Render Plans
  *============================================================================*/
 
+/* Placeholder names, indexed by PROMPT_VAR_* */
+static const char *const VAR_NAMES[PROMPT_VAR_COUNT] = {
+    [PROMPT_VAR_WORKSPACE] = "workspace",
+    [PROMPT_VAR_CWD]       = "cwd",
+    [PROMPT_VAR_DIRECTORY] = "directory",
+    [PROMPT_VAR_OS]        = "os",
+    [PROMPT_VAR_SHELL]     = "shell",
+    [PROMPT_VAR_USER]      = "user",
+    [PROMPT_VAR_SAFE_MODE] = "safe_mode",
+    [PROMPT_VAR_SANDBOX]   = "sandbox",
+};
+
 /**
- * @brief Replace all occurrences of a pattern in a string
+ * @brief Fill a plan's text in, one memcpy per segment
+ *
+ * Placeholders whose value is NULL are kept as they are.
  */
-static char *string_replace(const char *str, const char *pattern, const char *replacement) {
-    if (!str || !pattern || !replacement) return NULL;
-    
-    size_t pattern_len = strlen(pattern);
-    size_t replacement_len = strlen(replacement);
-    
-    if (pattern_len == 0) {
-        return strdup(str);
-    }
-    
-    /* Count occurrences */
-    int count = 0;
-    const char *p = str;
-    while ((p = strstr(p, pattern)) != NULL) {
-        count++;
-        p += pattern_len;
+static char *render_plan(const char *text, const prompt_segment_t *plan, size_t plan_len,
+                         const char *const values[PROMPT_VAR_COUNT]) {
+    size_t value_lens[PROMPT_VAR_COUNT];
+    for (int v = 0; v < PROMPT_VAR_COUNT; v++) {
+        value_lens[v] = values[v] ? strlen(values[v]) : 0;
     }
-    
-    if (count == 0) {
-        return strdup(str);
+
+    size_t total = 0;
+    for (size_t i = 0; i < plan_len; i++) {
+        int v = plan[i].var;
+        total += v >= 0 && values[v] ? value_lens[v] : plan[i].len;
     }
-    
-    /* Allocate result */
-    size_t str_len = strlen(str);
-    size_t result_len = str_len + count * (replacement_len - pattern_len);
-    char *result = malloc(result_len + 1);
+
+    char *result = malloc(total + 1);
     if (!result) return NULL;
-    
-    /* Build result */
+
     char *dst = result;
-    const char *src = str;
-    
-    while (*src) {
-        if (strncmp(src, pattern, pattern_len) == 0) {
-            memcpy(dst, replacement, replacement_len);
-            dst += replacement_len;
-            src += pattern_len;
+    for (size_t i = 0; i < plan_len; i++) {
+        int v = plan[i].var;
+        if (v >= 0 && values[v]) {
+            memcpy(dst, values[v], value_lens[v]);
+            dst += value_lens[v];
         } else {
-            *dst++ = *src++;
+            memcpy(dst, text + plan[i].offset, plan[i].len);
+            dst += plan[i].len;
         }
     }
     *dst = '\0';
-    
+
     return result;
 }
 
+/** Render an embedded prompt from its precomputed plan */
+static char *render_entry(const prompt_entry_t *entry,
+                          const char *const values[PROMPT_VAR_COUNT]) {
+    return render_plan(entry->content, entry->plan, entry->plan_len, values);
+}
+
+/**
+ * @brief Plan of a template only known at runtime
+ *
+ * Same segments as gen_prompts.cmake produces, into a malloc'd array.
+ *
+ * @return Number of segments, or -1 out of memory
+ */
+static long plan_template(const char *template, prompt_segment_t **plan) {
+    size_t cap = 8;
+    size_t n = 0;
+    prompt_segment_t *segments = malloc(cap * sizeof(*segments));
+    if (!segments) return -1;
+
+    size_t literal_start = 0;
+    const char *p = template;
+    while ((p = strstr(p, "${")) != NULL) {
+        const char *close = strchr(p + 2, '}');
+        int var = -1;
+        for (int v = 0; close && v < PROMPT_VAR_COUNT && var < 0; v++) {
+            size_t name_len = strlen(VAR_NAMES[v]);
+            if ((size_t)(close - p - 2) == name_len && memcmp(p + 2, VAR_NAMES[v], name_len) == 0) {
+                var = v;
+            }
+        }
+        if (var < 0) {
+            p += 2;
+            continue;
+        }
+
+        if (n + 2 > cap) {
+            cap *= 2;
+            prompt_segment_t *grown = realloc(segments, cap * sizeof(*segments));
+            if (!grown) {
+                free(segments);
+                return -1;
+            }
+            segments = grown;
+        }
+        size_t at = (size_t)(p - template);
+        if (at > literal_start) {
+            segments[n++] = (prompt_segment_t){ (unsigned int)literal_start,
+                                                (unsigned int)(at - literal_start), -1 };
+        }
+        segments[n++] = (prompt_segment_t){ (unsigned int)at,
+                                            (unsigned int)(close + 1 - p), var };
+        p = close + 1;
+        literal_start = (size_t)(p - template);
+    }
+
+    size_t total = literal_start + strlen(template + literal_start);
+    if (total > literal_start) {
+        if (n + 1 > cap) {
+            prompt_segment_t *grown = realloc(segments, (cap + 1) * sizeof(*segments));
+            if (!grown) {
+                free(segments);
+                return -1;
+            }
+            segments = grown;
+        }
+        segments[n++] = (prompt_segment_t){ (unsigned int)literal_start,
+                                            (unsigned int)(total - literal_start), -1 };
+    }
+
+    *plan = segments;
+    return (long)n;
+}
+
 /*============================================================================
  * Prompt Rendering
  *============================================================================*/
 
 char *prompt_render_system(const char *name, const char *workspace) {
-    const char *content = prompt_get_system(name);
-    if (!content) return NULL;
-    
+    const prompt_entry_t *entry = find_prompt(SYSTEM_PROMPTS, SYSTEM_PROMPTS_COUNT, name);
+    if (!entry) return NULL;
+
     /* Replace ${workspace} */
-    const char *ws = workspace ? workspace : ".";
-    char *result = string_replace(content, "${workspace}", ws);
-    
-    return result;
+    const char *values[PROMPT_VAR_COUNT] = { 0 };
+    values[PROMPT_VAR_WORKSPACE] = workspace ? workspace : ".";
+
+    return render_entry(entry, values);
 }
 
 char *prompt_render_tool(const char *name, const char *workspace) {
-    const char *content = prompt_get_tool(name);
-    if (!content) return NULL;
-    
+    const prompt_entry_t *entry = find_prompt(TOOL_PROMPTS, TOOL_PROMPTS_COUNT, name);
+    if (!entry) return NULL;
+
     /* Replace ${workspace} and ${directory} */
-    const char *ws = workspace ? workspace : ".";
-    
-    char *temp = string_replace(content, "${workspace}", ws);
-    if (!temp) return NULL;
-    
-    char *result = string_replace(temp, "${directory}", ws);
-    free(temp);
-    
-    return result;
+    const char *values[PROMPT_VAR_COUNT] = { 0 };
+    values[PROMPT_VAR_WORKSPACE] = workspace ? workspace : ".";
+    values[PROMPT_VAR_DIRECTORY] = values[PROMPT_VAR_WORKSPACE];
+
+    return render_entry(entry, values);
 }
 
 /*============================================================================
@@ -191,13 +263,13 @@ void prompt_context_init(prompt_context_t *ctx, const char *workspace) {
         ctx->shell = "sh";
     }
     
-    /* POSIX: Get username */
-    struct passwd *pw = getpwuid(getuid());
-    if (pw) {
-        ctx->user = pw->pw_name;
+    /* POSIX: Get username ($USER first: getpwuid() reads /etc/passwd) */
+    const char *user_env = getenv("USER");
+    struct passwd *pw = user_env && *user_env ? NULL : getpwuid(getuid());
+    if (user_env && *user_env) {
+        ctx->user = user_env;
     } else {
-        const char *user_env = getenv("USER");
-        ctx->user = user_env ? user_env : "unknown";
+        ctx->user = pw ? pw->pw_name : "unknown";
     }
 #endif
     
@@ -210,62 +282,57 @@ void prompt_context_init(prompt_context_t *ctx, const char *workspace) {
  * Context-based Rendering
  *============================================================================*/
 
-char *prompt_render(const char *template, const prompt_context_t *ctx) {
-    if (!template) return NULL;
-    
-    /* Use defaults if no context */
+/**
+ * @brief Placeholder values of a context (defaults if ctx is NULL)
+ */
+static void context_values(const prompt_context_t *ctx, const char *values[PROMPT_VAR_COUNT]) {
     prompt_context_t default_ctx;
     if (!ctx) {
         prompt_context_init(&default_ctx, ".");
         ctx = &default_ctx;
     }
-    
-    /* Apply substitutions in sequence */
-    char *result = strdup(template);
-    if (!result) return NULL;
-    
-    /* Define placeholder mappings */
-    struct {
-        const char *placeholder;
-        const char *value;
-    } mappings[] = {
-        { "${workspace}", ctx->workspace },
-        { "${cwd}", ctx->cwd },
-        { "${directory}", ctx->directory },
-        { "${os}", ctx->os },
-        { "${shell}", ctx->shell },
-        { "${user}", ctx->user },
-        { "${safe_mode}", ctx->safe_mode ? "enabled" : "disabled" },
-        { "${sandbox}", ctx->sandbox_enabled ? "enabled" : "disabled" },
-        { NULL, NULL }
-    };
-    
-    /* Apply each substitution */
-    for (int i = 0; mappings[i].placeholder != NULL; i++) {
-        if (!mappings[i].value) continue;
-        
-        char *temp = string_replace(result, mappings[i].placeholder, mappings[i].value);
-        if (temp) {
-            free(result);
-            result = temp;
-        }
-    }
-    
+
+    values[PROMPT_VAR_WORKSPACE] = ctx->workspace;
+    values[PROMPT_VAR_CWD] = ctx->cwd;
+    values[PROMPT_VAR_DIRECTORY] = ctx->directory;
+    values[PROMPT_VAR_OS] = ctx->os;
+    values[PROMPT_VAR_SHELL] = ctx->shell;
+    values[PROMPT_VAR_USER] = ctx->user;
+    values[PROMPT_VAR_SAFE_MODE] = ctx->safe_mode ? "enabled" : "disabled";
+    values[PROMPT_VAR_SANDBOX] = ctx->sandbox_enabled ? "enabled" : "disabled";
+}
+
+char *prompt_render(const char *template, const prompt_context_t *ctx) {
+    if (!template) return NULL;
+
+    const char *values[PROMPT_VAR_COUNT];
+    context_values(ctx, values);
+
+    prompt_segment_t *plan;
+    long plan_len = plan_template(template, &plan);
+    if (plan_len < 0) return NULL;
+
+    char *result = render_plan(template, plan, (size_t)plan_len, values);
+    free(plan);
     return result;
 }
 
 char *prompt_render_system_ctx(const char *name, const prompt_context_t *ctx) {
-    const char *content = prompt_get_system(name);
-    if (!content) return NULL;
-    
-    return prompt_render(content, ctx);
+    const prompt_entry_t *entry = find_prompt(SYSTEM_PROMPTS, SYSTEM_PROMPTS_COUNT, name);
+    if (!entry) return NULL;
+
+    const char *values[PROMPT_VAR_COUNT];
+    context_values(ctx, values);
+    return render_entry(entry, values);
 }
 
 char *prompt_render_tool_ctx(const char *name, const prompt_context_t *ctx) {
-    const char *content = prompt_get_tool(name);
-    if (!content) return NULL;
-    
-    return prompt_render(content, ctx);
+    const prompt_entry_t *entry = find_prompt(TOOL_PROMPTS, TOOL_PROMPTS_COUNT, name);
+    if (!entry) return NULL;
+
+    const char *values[PROMPT_VAR_COUNT];
+    context_values(ctx, values);
+    return render_entry(entry, values);
 }
 
 /*============================================================================
@@ -0,0 +1,271 @@
+/**
+ * @file file_cache.c
+ * @brief Mapped, line-indexed cache of the files the tools read and edit
+ */
+
+#include "file_cache.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILE_CACHE_SLOTS     32
+#define FILE_CACHE_MAX_BYTES (256u * 1024 * 1024)  /* Kept mapped when unpinned */
+
+#ifdef __APPLE__
+#define MTIME_NS(st) ((int64_t)(st)->st_mtimespec.tv_sec * 1000000000 + (st)->st_mtimespec.tv_nsec)
+#else
+#define MTIME_NS(st) ((int64_t)(st)->st_mtim.tv_sec * 1000000000 + (st)->st_mtim.tv_nsec)
+#endif
+
+typedef struct {
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    int64_t mtime_ns;
+    file_view_t view;
+    size_t *lines;
+    unsigned long last_use;
+    int refs;                        /* Views not yet released */
+    int cached;                      /* In g_entries (else freed on its last release) */
+} cache_entry_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static cache_entry_t *g_entries[FILE_CACHE_SLOTS];
+static unsigned long g_clock;
+static size_t g_mapped;              /* By cached entries */
+
+/*============================================================================
+ * Entries
+ *============================================================================*/
+
+static void entry_free(cache_entry_t *e) {
+    if (e->view.size > 0) {
+        munmap((void *)e->view.data, e->view.size);
+    }
+    free(e->lines);
+    free(e->path);
+    free(e);
+}
+
+/** Take slot i out of the cache; the entry goes once nothing pins it (lock held) */
+static void detach(int i) {
+    cache_entry_t *e = g_entries[i];
+    g_entries[i] = NULL;
+    e->cached = 0;
+    g_mapped -= e->view.size;
+    if (e->refs == 0) {
+        entry_free(e);
+    }
+}
+
+/** Least recently used unpinned slot (lock held), -1 if every one is pinned */
+static int oldest_slot(void) {
+    int oldest = -1;
+    for (int i = 0; i < FILE_CACHE_SLOTS; i++) {
+        cache_entry_t *e = g_entries[i];
+        if (e && e->refs == 0 && (oldest < 0 || e->last_use < g_entries[oldest]->last_use)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+/** A free slot for an entry of size bytes, evicting as needed (lock held) */
+static int make_room(size_t size) {
+    for (;;) {
+        int free_slot = -1;
+        for (int i = 0; i < FILE_CACHE_SLOTS && free_slot < 0; i++) {
+            if (!g_entries[i]) {
+                free_slot = i;
+            }
+        }
+        if (free_slot >= 0 && (g_mapped == 0 || g_mapped + size <= FILE_CACHE_MAX_BYTES)) {
+            return free_slot;
+        }
+        int victim = oldest_slot();
+        if (victim < 0) {
+            return free_slot;        /* Over budget while pinned: still cache it */
+        }
+        detach(victim);
+    }
+}
+
+/**
+ * @brief Map a file and index its lines
+ *
+ * @return 0, -1 unreadable, -3 out of memory
+ */
+static int entry_load(cache_entry_t *e, int fd, const struct stat *st) {
+    size_t size = (size_t)st->st_size;
+    const char *data = "";
+    if (size > 0) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            return -1;
+        }
+        data = (const char *)map;
+    }
+
+    /* Line starts: 0, then after every '\n' that is not the last byte */
+    size_t count = size > 0 ? 1 : 0;
+    for (const char *p = data; (p = memchr(p, '\n', size - (size_t)(p - data))); p++) {
+        count += (size_t)(p + 1 - data) < size;
+    }
+    size_t *lines = malloc((count ? count : 1) * sizeof(size_t));
+    if (!lines) {
+        if (size > 0) {
+            munmap((void *)data, size);
+        }
+        return -3;
+    }
+    size_t n = 0;
+    if (size > 0) {
+        lines[n++] = 0;
+    }
+    for (const char *p = data; (p = memchr(p, '\n', size - (size_t)(p - data))); p++) {
+        if ((size_t)(p + 1 - data) < size) {
+            lines[n++] = (size_t)(p + 1 - data);
+        }
+    }
+
+    e->dev = st->st_dev;
+    e->ino = st->st_ino;
+    e->mtime_ns = MTIME_NS(st);
+    e->view.data = data;
+    e->view.size = size;
+    e->view.lines = lines;
+    e->view.line_count = count;
+    e->view.entry = e;
+    e->lines = lines;
+    return 0;
+}
+
+/** Slot of the cached, unchanged entry for path (lock held), -1 if none */
+static int lookup(const char *path, const struct stat *st) {
+    for (int i = 0; i < FILE_CACHE_SLOTS; i++) {
+        cache_entry_t *e = g_entries[i];
+        if (!e || strcmp(e->path, path) != 0) {
+            continue;
+        }
+        if (e->dev == st->st_dev && e->ino == st->st_ino &&
+            e->view.size == (size_t)st->st_size && e->mtime_ns == MTIME_NS(st)) {
+            return i;
+        }
+        detach(i);                   /* Changed on disk */
+        return -1;
+    }
+    return -1;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+int file_cache_get(const char *path, file_view_t *view) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+    pthread_mutex_lock(&g_lock);
+    int slot = lookup(path, &st);
+    if (slot >= 0) {
+        cache_entry_t *e = g_entries[slot];
+        e->refs++;
+        e->last_use = ++g_clock;
+        *view = e->view;
+        pthread_mutex_unlock(&g_lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    /* Map and index outside the lock, so other files are served meanwhile */
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    cache_entry_t *e = calloc(1, sizeof(cache_entry_t));
+    int rc = -3;
+    if (e && (e->path = strdup(path)) != NULL) {
+        rc = entry_load(e, fd, &st);
+    }
+    close(fd);
+    if (rc != 0) {
+        if (e) {
+            free(e->path);
+            free(e);
+        }
+        return rc;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    slot = lookup(path, &st);        /* Another thread may have loaded it too */
+    if (slot >= 0) {
+        entry_free(e);
+        e = g_entries[slot];
+    } else {
+        slot = make_room(e->view.size);
+        if (slot >= 0) {
+            g_entries[slot] = e;
+            e->cached = 1;
+            g_mapped += e->view.size;
+        }
+    }
+    e->refs++;
+    e->last_use = ++g_clock;
+    *view = e->view;
+    pthread_mutex_unlock(&g_lock);
+    return 0;
+}
+
+void file_cache_release(const file_view_t *view) {
+    cache_entry_t *e = (cache_entry_t *)view->entry;
+    pthread_mutex_lock(&g_lock);
+    if (--e->refs == 0 && !e->cached) {
+        entry_free(e);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void file_view_line(const file_view_t *view, size_t line, const char **start, size_t *len) {
+    size_t begin = view->lines[line];
+    size_t end = line + 1 < view->line_count ? view->lines[line + 1] : view->size;
+    if (end > begin && view->data[end - 1] == '\n') {
+        end--;
+    }
+    *start = view->data + begin;
+    *len = end - begin;
+}
+
+void file_cache_invalidate(const char *path) {
+    struct stat st;
+    int known = stat(path, &st) == 0;
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < FILE_CACHE_SLOTS; i++) {
+        cache_entry_t *e = g_entries[i];
+        if (e && (strcmp(e->path, path) == 0 ||
+                  (known && e->dev == st.st_dev && e->ino == st.st_ino))) {
+            detach(i);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void file_cache_clear(void) {
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < FILE_CACHE_SLOTS; i++) {
+        if (g_entries[i]) {
+            detach(i);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+}
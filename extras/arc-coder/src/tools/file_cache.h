@@ -0,0 +1,68 @@
+/**
+ * @file file_cache.h
+ * @brief Mapped, line-indexed cache of the files the tools read and edit
+ *
+ * Keeps recently used files mapped together with the offset of every
+ * line, keyed by path and checked against (device, inode, size, mtime)
+ * on each lookup. Reading a range of lines then needs neither reopening
+ * the file nor scanning it from the start.
+ *
+ * Tools that write a file call file_cache_invalidate(), so a rewrite
+ * that lands within the filesystem's mtime granularity is not missed.
+ * Tools running concurrently may share the cache: a view pins its file
+ * until it is released.
+ */
+
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *data;                /**< Contents, not NUL-terminated */
+    size_t size;
+    const size_t *lines;             /**< Offset of each line's first byte */
+    size_t line_count;               /**< A last line without '\n' counts */
+    void *entry;                     /**< Pinned until file_cache_release() */
+} file_view_t;
+
+/**
+ * @brief View of a regular file, from the cache when it is unchanged
+ *
+ * The view stays valid until file_cache_release(), even if the file is
+ * invalidated or evicted meanwhile.
+ *
+ * @return 0, -1 if it cannot be opened or is not a regular file, -3 out
+ *         of memory
+ */
+int file_cache_get(const char *path, file_view_t *view);
+
+/**
+ * @brief Release a view from file_cache_get()
+ */
+void file_cache_release(const file_view_t *view);
+
+/**
+ * @brief Bounds of a line of a view, without its '\n'
+ */
+void file_view_line(const file_view_t *view, size_t line, const char **start, size_t *len);
+
+/**
+ * @brief Forget a file (any path naming the same inode) after writing it
+ */
+void file_cache_invalidate(const char *path);
+
+/**
+ * @brief Unmap everything
+ */
+void file_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FILE_CACHE_H */
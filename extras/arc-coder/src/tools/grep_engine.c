@@ -0,0 +1,1136 @@
+/**
+ * @file grep_engine.c
+ * @brief Parallel content search behind the grep tool
+ */
+
+#include "grep_engine.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef ARC_CODER_PCRE2
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#else
+#include <regex.h>
+#endif
+
+#define GREP_MAX_MATCHES   500
+#define GREP_MAX_THREADS   16
+#define GREP_MAX_DEPTH     20
+#define GREP_LINE_MAX      200       /* Longer lines are cut in results */
+#define GREP_READ_MAX      65536     /* Files up to this size are read, larger ones mapped */
+#define GREP_BINARY_PROBE  8192      /* A NUL in the first bytes marks a binary file */
+#define GREP_MAX_LITERALS  8         /* Alternatives given a literal prefilter */
+
+/*============================================================================
+ * Matcher
+ *============================================================================*/
+
+typedef struct {
+    char text[128];                  /* Lowercased when folding */
+    size_t len;
+    size_t anchor;                   /* Byte located with memchr */
+} literal_t;
+
+typedef struct {
+#ifdef ARC_CODER_PCRE2
+    pcre2_code *code;
+#else
+    regex_t regex;
+    int compiled;
+#endif
+    literal_t literals[GREP_MAX_LITERALS];  /* Every match contains one of these */
+    int literal_count;               /* 0 = no prefilter */
+    int pure;                        /* The pattern is just the literals */
+    int fold;                        /* Case-insensitive */
+} matcher_t;
+
+static int is_alpha(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static unsigned char lower(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c + 32) : c;
+}
+
+/** Index of the ']' closing the class opened at p[i] (or of the NUL) */
+static size_t skip_class(const char *p, size_t i) {
+    i++;
+    if (p[i] == '^') {
+        i++;
+    }
+    if (p[i] == ']') {
+        i++;                         /* Leading ']' is a member */
+    }
+    for (; p[i] && p[i] != ']'; i++) {
+        if (p[i] == '\\' && p[i + 1]) {
+            i++;
+        } else if (p[i] == '[' && p[i + 1] == ':') {
+            const char *end = strstr(p + i + 2, ":]");
+            if (end) {
+                i = (size_t)(end - p) + 1;   /* [:alpha:] */
+            }
+        }
+    }
+    return i;
+}
+
+/** Index of the ')' closing the group opened at p[i] (or of the NUL) */
+static size_t skip_group(const char *p, size_t i) {
+    int depth = 0;
+    for (; p[i]; i++) {
+        if (p[i] == '\\' && p[i + 1]) {
+            i++;
+        } else if (p[i] == '[') {
+            i = skip_class(p, i);
+            if (!p[i]) {
+                break;
+            }
+        } else if (p[i] == '(') {
+            depth++;
+        } else if (p[i] == ')' && --depth == 0) {
+            break;
+        }
+    }
+    return i;
+}
+
+/**
+ * @brief Longest run of characters every match of p[0..n) must contain
+ *
+ * p is one top-level alternative. Only top-level atoms count: groups
+ * and classes end a run, and an optional quantifier (?, *, {) drops its
+ * character. *pure is set when the whole alternative is one plain run.
+ */
+static size_t required_literal(const char *pattern, size_t n, char *out, size_t cap,
+                               int *pure) {
+    char p[1024];
+    if (n >= sizeof(p)) {
+        *pure = 0;
+        return 0;
+    }
+    memcpy(p, pattern, n);
+    p[n] = '\0';
+    char run[128];
+    size_t run_len = 0, best = 0;
+    *pure = 1;
+
+#define END_RUN()                                                    \
+    do {                                                             \
+        if (run_len > best) {                                        \
+            memcpy(out, run, run_len);                               \
+            best = run_len;                                          \
+        }                                                            \
+        run_len = 0;                                                 \
+    } while (0)
+
+    for (size_t i = 0; p[i]; i++) {
+        unsigned char c = (unsigned char)p[i];
+        int literal = 0;
+
+        if (c == '\\') {
+            unsigned char e = (unsigned char)p[i + 1];
+            if (!e) {
+                break;
+            }
+            i++;
+            if ((e >= '0' && e <= '9') || is_alpha(e)) {
+                *pure = 0;           /* \w, \d, \b, \x41, \Q...: not a plain byte */
+                END_RUN();
+                continue;
+            }
+            c = e;
+            literal = 1;
+            *pure = 0;               /* Escaped, so the pattern text differs */
+        } else if (c == '(' || c == '[') {
+            /* Skip the group or class */
+            *pure = 0;
+            END_RUN();
+            i = c == '[' ? skip_class(p, i) : skip_group(p, i);
+            if (!p[i]) {
+                break;
+            }
+            continue;
+        } else if (strchr(".^$)", c)) {
+            *pure = 0;
+            END_RUN();
+            continue;
+        } else if (strchr("*?{+", c)) {
+            /* Quantifier after a group or class, or a lazy/possessive suffix */
+            *pure = 0;
+            END_RUN();
+            if (c == '{') {
+                while (p[i] && p[i] != '}') {
+                    i++;
+                }
+                if (!p[i]) {
+                    break;
+                }
+            }
+            continue;
+        } else {
+            literal = 1;
+        }
+
+        if (literal) {
+            unsigned char q = (unsigned char)p[i + 1];
+            if (q == '*' || q == '?' || q == '{') {
+                *pure = 0;           /* Optional: not required */
+                END_RUN();
+            } else if (q == '+') {
+                *pure = 0;           /* Required once, then anything may repeat */
+                if (run_len < sizeof(run)) {
+                    run[run_len++] = (char)c;
+                }
+                END_RUN();
+            } else if (run_len < sizeof(run)) {
+                run[run_len++] = (char)c;
+            } else {
+                *pure = 0;
+            }
+        }
+    }
+    END_RUN();
+#undef END_RUN
+
+    if (best > cap) {
+        best = cap;
+        *pure = 0;
+    }
+    return best;
+}
+
+/** Length of the top-level alternative starting at p (up to '|' or the end) */
+static size_t alternative_len(const char *p) {
+    size_t i = 0;
+    for (; p[i] && p[i] != '|'; i++) {
+        if (p[i] == '\\' && p[i + 1]) {
+            i++;
+        } else if (p[i] == '[' || p[i] == '(') {
+            i = p[i] == '[' ? skip_class(p, i) : skip_group(p, i);
+            if (!p[i]) {
+                break;
+            }
+        }
+    }
+    return i;
+}
+
+/**
+ * @brief How common a byte is in source text (higher = more common)
+ *
+ * The literal is located by its rarest byte; locating a space or an 'e'
+ * would stop memchr every few bytes.
+ */
+static int byte_frequency(unsigned char c) {
+    static const char common[] =
+        " etaoinsrlcdu_hpm\n\t(),;.=fgbyv*\"-/x0k1>w:{}2<[]&'#+!|3qz4j5%689\\$@?`~^";
+    const char *at = c ? strchr(common, lower(c)) : NULL;
+    return at ? (int)(sizeof(common) - (size_t)(at - common)) : 0;
+}
+
+static int matcher_init(matcher_t *m, const char *pattern, int case_sensitive,
+                        char *error, size_t error_size) {
+    memset(m, 0, sizeof(*m));
+    /* Inline options like (?i) may make a case-sensitive pattern caseless */
+    m->fold = !case_sensitive || strstr(pattern, "(?") != NULL;
+
+    /* One literal per top-level alternative, or no prefilter at all */
+    m->pure = 1;
+    for (const char *alt = pattern;; alt++) {
+        if (m->literal_count == GREP_MAX_LITERALS) {
+            m->literal_count = 0;
+            break;
+        }
+        size_t n = alternative_len(alt);
+        int pure;
+        literal_t *lit = &m->literals[m->literal_count];
+        lit->len = required_literal(alt, n, lit->text, sizeof(lit->text), &pure);
+        if (lit->len < 2 && !(pure && lit->len == 1)) {
+            m->literal_count = 0;    /* A single byte filters too little to pay for itself */
+            break;
+        }
+        m->pure &= pure;
+        m->literal_count++;
+
+        /* Anchor on the rarest byte; a folded letter costs a second memchr */
+        int best = 0;
+        for (size_t i = 0; i < lit->len; i++) {
+            unsigned char c = (unsigned char)lit->text[i];
+            if (m->fold) {
+                c = lower(c);
+                lit->text[i] = (char)c;
+            }
+            int cost = byte_frequency(c) + (m->fold && is_alpha(c) ? 4 : 0);
+            if (i == 0 || cost < best) {
+                best = cost;
+                lit->anchor = i;
+            }
+        }
+        alt += n;
+        if (!*alt) {
+            break;
+        }
+    }
+    if (m->pure && m->literal_count > 0) {
+        return 0;                    /* No regex needed */
+    }
+    m->pure = 0;
+
+#ifdef ARC_CODER_PCRE2
+    int code;
+    PCRE2_SIZE offset;
+    m->code = pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED,
+                            PCRE2_MULTILINE | (case_sensitive ? 0 : PCRE2_CASELESS), &code, &offset,
+                            NULL);
+    if (!m->code) {
+        PCRE2_UCHAR msg[200];
+        pcre2_get_error_message(code, msg, sizeof(msg));
+        snprintf(error, error_size, "%s at offset %zu", (const char *)msg, (size_t)offset);
+        return -1;
+    }
+    /* Fails harmlessly (and matching interprets) when built without JIT */
+    pcre2_jit_compile(m->code, PCRE2_JIT_COMPLETE);
+#else
+    int rc = regcomp(&m->regex, pattern, REG_EXTENDED | REG_NOSUB | REG_NEWLINE |
+                                         (case_sensitive ? 0 : REG_ICASE));
+    if (rc != 0) {
+        regerror(rc, &m->regex, error, error_size);
+        return -1;
+    }
+    m->compiled = 1;
+#endif
+    return 0;
+}
+
+static void matcher_free(matcher_t *m) {
+#ifdef ARC_CODER_PCRE2
+    pcre2_code_free(m->code);
+#else
+    if (m->compiled) {
+        regfree(&m->regex);
+    }
+#endif
+}
+
+/**
+ * @brief Next occurrence of a literal in [p, end), or NULL
+ */
+static const char *find_literal(const matcher_t *m, const literal_t *lit, const char *p,
+                                const char *end) {
+    size_t n = lit->len;
+    size_t a = lit->anchor;
+    unsigned char c = (unsigned char)lit->text[a];
+    int both = m->fold && is_alpha(c);
+    const char *lo = NULL, *up = NULL;
+
+    if ((size_t)(end - p) < n) {
+        return NULL;
+    }
+    for (const char *from = p + a; from + (n - a) <= end;) {
+        const char *hit;
+        size_t left = (size_t)(end - from);
+        if (both) {
+            /* Nearest of either case; each side is only rescanned once passed */
+            if (!lo || lo < from) {
+                lo = memchr(from, c, left);
+                lo = lo ? lo : end;
+            }
+            if (!up || up < from) {
+                up = memchr(from, c - 32, left);
+                up = up ? up : end;
+            }
+            hit = lo < up ? lo : up;
+            if (hit == end) {
+                return NULL;
+            }
+        } else {
+            hit = memchr(from, c, left);
+            if (!hit) {
+                return NULL;
+            }
+        }
+        const char *start = hit - a;
+        if (start + n > end) {
+            return NULL;
+        }
+        size_t i = 0;
+        if (m->fold) {
+            while (i < n && lower((unsigned char)start[i]) == (unsigned char)lit->text[i]) {
+                i++;
+            }
+        } else {
+            i = memcmp(start, lit->text, n) == 0 ? n : 0;
+        }
+        if (i == n) {
+            return start;
+        }
+        from = hit + 1;
+    }
+    return NULL;
+}
+
+/*============================================================================
+ * Search State
+ *============================================================================*/
+
+typedef struct ignore_rule {
+    char *glob;
+    int negate;
+    int dir_only;
+    int anchored;                    /* Matched against the path from the file's directory */
+} ignore_rule_t;
+
+/** One .gitignore, chained to those of the directories above */
+typedef struct ignore {
+    const struct ignore *parent;
+    char *base;                      /* Its directory, relative to the search root ("" = root) */
+    ignore_rule_t *rules;
+    int count;
+    struct ignore *all_next;         /* Every ignore of the search, for freeing */
+} ignore_t;
+
+typedef struct dir_job {
+    char *path;
+    char *rel;                       /* Relative to the search root */
+    int depth;
+    const ignore_t *ignore;
+    struct dir_job *next;
+} dir_job_t;
+
+typedef struct {
+    const matcher_t *matcher;        /* NULL when only walking */
+    const char *include;
+    int max_matches;
+    grep_visit_fn visit;             /* Walk without searching */
+    void *visit_ctx;
+
+    const char *root;                /* Searching a list of files under root */
+    const char *const *list;
+    size_t list_count;
+    size_t list_next;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    dir_job_t *jobs;
+    int pending;                     /* Jobs queued or being walked */
+    ignore_t *ignores;
+
+    grep_match_t *matches;
+    int count;
+    int cap;
+    volatile int stop;               /* max_matches reached */
+    int failed;                      /* Out of memory */
+    size_t files;
+    size_t bytes;
+} search_t;
+
+typedef struct {
+    search_t *search;
+#ifdef ARC_CODER_PCRE2
+    pcre2_match_data *match_data;
+#else
+    char *line;
+    size_t line_cap;
+#endif
+    const char *next[GREP_MAX_LITERALS];  /* Next hit of each literal in the buffer
+                                              (NULL = not searched yet, end = none) */
+    char *buf;                       /* Small files are read here */
+    void *scratch;                   /* For the visitor */
+    size_t files;
+    size_t bytes;
+} worker_t;
+
+/*============================================================================
+ * Matching
+ *============================================================================*/
+
+/** Whether [line, line + len) matches the regex */
+static int line_matches(worker_t *w, const char *line, size_t len) {
+    const matcher_t *m = w->search->matcher;
+    if (m->pure) {
+        return 1;                    /* Found by find_literal */
+    }
+#ifdef ARC_CODER_PCRE2
+    return pcre2_match(m->code, (PCRE2_SPTR)line, len, 0, 0, w->match_data, NULL) >= 0;
+#else
+    if (len + 1 > w->line_cap) {
+        size_t cap = len + 1 > 256 ? len + 1 : 256;
+        char *grown = realloc(w->line, cap);
+        if (!grown) {
+            return 0;
+        }
+        w->line = grown;
+        w->line_cap = cap;
+    }
+    memcpy(w->line, line, len);
+    w->line[len] = '\0';
+    return regexec(&m->regex, w->line, 0, NULL, 0) == 0;
+#endif
+}
+
+/**
+ * @brief Where the next matching line could start: the literal's line, or
+ *        the line of the regex's next match over the rest of the buffer
+ */
+static const char *next_candidate(worker_t *w, const char *p, const char *end) {
+    const matcher_t *m = w->search->matcher;
+    if (m->literal_count > 0) {
+        /* Earliest hit of any literal; each is scanned once per buffer */
+        const char *first = end;
+        for (int k = 0; k < m->literal_count; k++) {
+            if (!w->next[k] || (w->next[k] < p && w->next[k] != end)) {
+                const char *hit = find_literal(m, &m->literals[k], p, end);
+                w->next[k] = hit ? hit : end;
+            }
+            first = w->next[k] < first ? w->next[k] : first;
+        }
+        return first < end ? first : NULL;
+    }
+#ifdef ARC_CODER_PCRE2
+    if (pcre2_match(m->code, (PCRE2_SPTR)p, (PCRE2_SIZE)(end - p), 0, 0, w->match_data,
+                    NULL) < 0) {
+        return NULL;
+    }
+    return p + pcre2_get_ovector_pointer(w->match_data)[0];
+#else
+    return p;                        /* Every line */
+#endif
+}
+
+static void add_match(worker_t *w, const char *file, int line_no, const char *line, size_t len) {
+    search_t *s = w->search;
+    char *content = malloc(len > GREP_LINE_MAX ? GREP_LINE_MAX + 4 : len + 1);
+    char *name = strdup(file);
+    if (!content || !name) {
+        free(content);
+        free(name);
+        s->failed = 1;
+        s->stop = 1;
+        return;
+    }
+    if (len > GREP_LINE_MAX) {
+        memcpy(content, line, GREP_LINE_MAX);
+        memcpy(content + GREP_LINE_MAX, "...", 4);
+    } else {
+        memcpy(content, line, len);
+        content[len] = '\0';
+    }
+
+    pthread_mutex_lock(&s->lock);
+    if (s->count < s->max_matches) {
+        if (s->count == s->cap) {
+            int cap = s->cap ? s->cap * 2 : 64;
+            grep_match_t *grown = realloc(s->matches, (size_t)cap * sizeof(grep_match_t));
+            if (!grown) {
+                s->failed = 1;
+                s->stop = 1;
+                pthread_mutex_unlock(&s->lock);
+                free(content);
+                free(name);
+                return;
+            }
+            s->matches = grown;
+            s->cap = cap;
+        }
+        s->matches[s->count++] = (grep_match_t){ name, line_no, content };
+        name = content = NULL;
+    }
+    if (s->count >= s->max_matches) {
+        s->stop = 1;
+    }
+    pthread_mutex_unlock(&s->lock);
+    free(content);
+    free(name);
+}
+
+static void search_buffer(worker_t *w, const char *file, const char *buf, size_t len) {
+    size_t probe = len < GREP_BINARY_PROBE ? len : GREP_BINARY_PROBE;
+    if (memchr(buf, '\0', probe)) {
+        return;                      /* Binary */
+    }
+    w->files++;
+    w->bytes += len;
+    memset((void *)w->next, 0, sizeof(w->next));
+
+    const char *end = buf + len;
+    const char *counted = buf;       /* Newlines before here are in line_no */
+    int line_no = 1;
+    for (const char *p = buf; p < end && !w->search->stop;) {
+        const char *hit = next_candidate(w, p, end);
+        if (!hit) {
+            break;
+        }
+        const char *start = hit;
+        while (start > p && start[-1] != '\n') {
+            start--;
+        }
+        const char *nl = memchr(hit, '\n', (size_t)(end - hit));
+        const char *stop = nl ? nl : end;
+
+        if (line_matches(w, start, (size_t)(stop - start))) {
+            for (const char *q = counted; (q = memchr(q, '\n', (size_t)(start - q))); q++) {
+                line_no++;
+            }
+            counted = start;
+            add_match(w, file, line_no, start, (size_t)(stop - start));
+        }
+        p = nl ? nl + 1 : end;
+    }
+}
+
+static void search_file(worker_t *w, const char *file) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size <= GREP_READ_MAX) {
+        size_t got = 0;
+        ssize_t n;
+        while (got < size && (n = read(fd, w->buf + got, size - got)) > 0) {
+            got += (size_t)n;
+        }
+        close(fd);
+        search_buffer(w, file, w->buf, got);
+        return;
+    }
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(map, size, MADV_SEQUENTIAL);
+#endif
+    search_buffer(w, file, (const char *)map, size);
+    munmap(map, size);
+}
+
+/*============================================================================
+ * Ignore Rules
+ *============================================================================*/
+
+static const char *const s_skip_dirs[] = {
+    "node_modules", "__pycache__", "build", "dist", "vendor",
+};
+
+/** fnmatch with one level of "{a,b}" alternatives */
+static int glob_match(const char *glob, const char *name, int flags) {
+    const char *open = strchr(glob, '{');
+    const char *close = open ? strchr(open, '}') : NULL;
+    if (!close) {
+        return fnmatch(glob, name, flags) == 0;
+    }
+    char expanded[512];
+    size_t head = (size_t)(open - glob);
+    for (const char *alt = open + 1; alt <= close;) {
+        size_t n = strcspn(alt, ",}");
+        if (alt + n > close) {
+            n = (size_t)(close - alt);
+        }
+        snprintf(expanded, sizeof(expanded), "%.*s%.*s%s", (int)head, glob, (int)n, alt, close + 1);
+        if (fnmatch(expanded, name, flags) == 0) {
+            return 1;
+        }
+        alt += n + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse dir/.gitignore; NULL when there is none (or it is empty)
+ */
+static ignore_t *ignore_load(search_t *s, const char *dir, const char *rel,
+                             const ignore_t *parent) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/.gitignore", dir);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return NULL;
+    }
+    ignore_t *ig = calloc(1, sizeof(ignore_t));
+    int cap = 0;
+    char line[1024];
+    while (ig && fgets(line, sizeof(line), f)) {
+        size_t n = strcspn(line, "\r\n");
+        while (n > 0 && line[n - 1] == ' ') {
+            n--;
+        }
+        line[n] = '\0';
+        char *g = line;
+        if (!*g || *g == '#') {
+            continue;
+        }
+        ignore_rule_t rule = { 0 };
+        if (*g == '!') {
+            rule.negate = 1;
+            g++;
+        }
+        n = strlen(g);
+        if (n > 0 && g[n - 1] == '/') {
+            rule.dir_only = 1;
+            g[--n] = '\0';
+        }
+        if (strncmp(g, "**/", 3) == 0) {
+            g += 3;                  /* Any depth: same as unanchored */
+        }
+        if (*g == '/') {
+            rule.anchored = 1;
+            g++;
+        } else if (strchr(g, '/')) {
+            rule.anchored = 1;
+        }
+        if (!*g) {
+            continue;
+        }
+        if (ig->count == cap) {
+            cap = cap ? cap * 2 : 16;
+            ignore_rule_t *grown = realloc(ig->rules, (size_t)cap * sizeof(ignore_rule_t));
+            if (!grown) {
+                break;
+            }
+            ig->rules = grown;
+        }
+        rule.glob = strdup(g);
+        if (rule.glob) {
+            ig->rules[ig->count++] = rule;
+        }
+    }
+    fclose(f);
+    if (!ig) {
+        return NULL;
+    }
+    ig->parent = parent;
+    ig->base = strdup(rel);
+    if (ig->count == 0 || !ig->base) {
+        free(ig->rules);
+        free(ig->base);
+        free(ig);
+        return NULL;
+    }
+    pthread_mutex_lock(&s->lock);
+    ig->all_next = s->ignores;
+    s->ignores = ig;
+    pthread_mutex_unlock(&s->lock);
+    return ig;
+}
+
+/**
+ * @brief Verdict of the rules for a path: 1 ignored, 0 re-included, -1 none
+ *
+ * Files nearer the path are consulted after those above it, and later
+ * rules after earlier ones, so the last match wins as in git.
+ */
+static int ignore_verdict(const ignore_t *ig, const char *rel, const char *name, int is_dir) {
+    if (!ig) {
+        return -1;
+    }
+    int verdict = ignore_verdict(ig->parent, rel, name, is_dir);
+    size_t base_len = strlen(ig->base);
+    const char *sub = base_len ? rel + base_len + 1 : rel;
+    for (int i = 0; i < ig->count; i++) {
+        const ignore_rule_t *r = &ig->rules[i];
+        if (r->dir_only && !is_dir) {
+            continue;
+        }
+        int hit = r->anchored ? fnmatch(r->glob, sub, FNM_PATHNAME) == 0
+                              : fnmatch(r->glob, name, 0) == 0;
+        if (hit) {
+            verdict = !r->negate;
+        }
+    }
+    return verdict;
+}
+
+/*============================================================================
+ * Walker
+ *============================================================================*/
+
+static int push_dir(search_t *s, const char *path, const char *rel, int depth,
+                    const ignore_t *ignore) {
+    dir_job_t *job = malloc(sizeof(dir_job_t));
+    char *p = strdup(path);
+    char *r = strdup(rel);
+    if (!job || !p || !r) {
+        free(job);
+        free(p);
+        free(r);
+        return -1;
+    }
+    *job = (dir_job_t){ p, r, depth, ignore, NULL };
+    pthread_mutex_lock(&s->lock);
+    job->next = s->jobs;             /* Depth first keeps the queue short */
+    s->jobs = job;
+    s->pending++;
+    pthread_cond_signal(&s->work);
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
+
+static void walk_dir(worker_t *w, const dir_job_t *job) {
+    search_t *s = w->search;
+    DIR *dir = opendir(job->path);
+    if (!dir) {
+        return;
+    }
+    const ignore_t *ignore = ignore_load(s, job->path, job->rel, job->ignore);
+    if (!ignore) {
+        ignore = job->ignore;
+    }
+    struct stat st;
+    if (s->visit && stat(job->path, &st) == 0) {
+        s->visit(s->visit_ctx, &w->scratch, job->path, job->rel, &st);
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) && !s->stop) {
+        const char *name = entry->d_name;
+        if (name[0] == '.') {
+            continue;                /* ., .., hidden files and .git */
+        }
+
+        char full[4096], rel[4096];
+        int n = snprintf(full, sizeof(full), "%s/%s", job->path, name);
+        int m = snprintf(rel, sizeof(rel), "%s%s%s", job->rel, job->rel[0] ? "/" : "", name);
+        if (n < 0 || (size_t)n >= sizeof(full) || m < 0 || (size_t)m >= sizeof(rel)) {
+            continue;
+        }
+
+        int is_dir = 0, is_reg = 0;
+#ifdef DT_DIR
+        if (entry->d_type == DT_DIR) {
+            is_dir = 1;
+        } else if (entry->d_type == DT_REG) {
+            is_reg = 1;
+        } else
+#endif
+        {
+            /* Symlink or unknown type: follow it */
+            if (stat(full, &st) != 0) {
+                continue;
+            }
+            is_dir = S_ISDIR(st.st_mode);
+            is_reg = S_ISREG(st.st_mode);
+        }
+
+        if (is_dir) {
+            int skip = 0;
+            for (size_t i = 0; i < sizeof(s_skip_dirs) / sizeof(s_skip_dirs[0]); i++) {
+                skip |= strcmp(name, s_skip_dirs[i]) == 0;
+            }
+            if (skip || job->depth >= GREP_MAX_DEPTH ||
+                ignore_verdict(ignore, rel, name, 1) == 1) {
+                continue;
+            }
+            if (push_dir(s, full, rel, job->depth + 1, ignore) != 0) {
+                s->failed = 1;
+                s->stop = 1;
+            }
+        } else if (is_reg) {
+            if (s->include && *s->include && !glob_match(s->include, name, FNM_NOESCAPE)) {
+                continue;
+            }
+            if (ignore_verdict(ignore, rel, name, 0) == 1) {
+                continue;
+            }
+            if (!s->visit) {
+                search_file(w, full);
+            } else if (stat(full, &st) == 0) {
+                s->visit(s->visit_ctx, &w->scratch, full, rel, &st);
+            }
+        }
+    }
+    closedir(dir);
+}
+
+/** Search the files of s->list, taking the next one until none are left */
+static void search_list(worker_t *w) {
+    search_t *s = w->search;
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        size_t i = s->list_next++;
+        pthread_mutex_unlock(&s->lock);
+        if (i >= s->list_count || s->stop) {
+            return;
+        }
+        const char *rel = s->list[i];
+        const char *name = strrchr(rel, '/');
+        name = name ? name + 1 : rel;
+        if (s->include && *s->include && !glob_match(s->include, name, FNM_NOESCAPE)) {
+            continue;
+        }
+        char full[4096];
+        int n = snprintf(full, sizeof(full), "%s/%s", s->root, rel);
+        if (n > 0 && (size_t)n < sizeof(full)) {
+            search_file(w, full);
+        }
+    }
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    search_t *s = w->search;
+    if (s->list) {
+        search_list(w);
+    }
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        while (!s->jobs && s->pending > 0) {
+            pthread_cond_wait(&s->work, &s->lock);
+        }
+        if (!s->jobs) {
+            break;                   /* Nothing queued and nobody walking */
+        }
+        dir_job_t *job = s->jobs;
+        s->jobs = job->next;
+        pthread_mutex_unlock(&s->lock);
+
+        if (!s->stop) {
+            walk_dir(w, job);
+        }
+        free(job->path);
+        free(job->rel);
+        free(job);
+
+        pthread_mutex_lock(&s->lock);
+        if (--s->pending == 0) {
+            pthread_cond_broadcast(&s->work);
+        }
+    }
+    s->files += w->files;
+    s->bytes += w->bytes;
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+static int worker_init(worker_t *w, search_t *s) {
+    memset(w, 0, sizeof(*w));
+    w->search = s;
+    if (!s->matcher) {
+        return 0;
+    }
+    w->buf = malloc(GREP_READ_MAX);
+#ifdef ARC_CODER_PCRE2
+    if (s->matcher->code) {
+        w->match_data = pcre2_match_data_create_from_pattern(s->matcher->code, NULL);
+        if (!w->match_data) {
+            free(w->buf);
+            return -1;
+        }
+    }
+#endif
+    return w->buf ? 0 : -1;
+}
+
+static void worker_free(worker_t *w) {
+#ifdef ARC_CODER_PCRE2
+    pcre2_match_data_free(w->match_data);
+#else
+    free(w->line);
+#endif
+    free(w->buf);
+    free(w->scratch);
+}
+
+/** Run the workers until the queue (or list) is done */
+static void run_workers(search_t *s, int threads) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    threads = threads > GREP_MAX_THREADS ? GREP_MAX_THREADS : threads;
+    if (s->list && (size_t)threads > s->list_count) {
+        threads = (int)s->list_count;
+    }
+
+    worker_t workers[GREP_MAX_THREADS];
+    pthread_t tids[GREP_MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < threads && !s->failed; i++) {
+        if (worker_init(&workers[i], s) != 0) {
+            worker_free(&workers[i]);
+            break;
+        }
+        if (pthread_create(&tids[i], NULL, worker_main, &workers[i]) != 0) {
+            worker_free(&workers[i]);
+            break;
+        }
+        started++;
+    }
+    if (started == 0 && !s->failed) {
+        /* No threads: walk on this one */
+        if (worker_init(&workers[0], s) == 0) {
+            worker_main(&workers[0]);
+        } else {
+            s->failed = 1;
+        }
+        worker_free(&workers[0]);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+        worker_free(&workers[i]);
+    }
+    /* Jobs left when the walk failed to start */
+    while (s->jobs) {
+        dir_job_t *job = s->jobs;
+        s->jobs = job->next;
+        free(job->path);
+        free(job->rel);
+        free(job);
+    }
+}
+
+static void search_free(search_t *s) {
+    while (s->ignores) {
+        ignore_t *ig = s->ignores;
+        s->ignores = ig->all_next;
+        for (int i = 0; i < ig->count; i++) {
+            free(ig->rules[i].glob);
+        }
+        free(ig->rules);
+        free(ig->base);
+        free(ig);
+    }
+    pthread_cond_destroy(&s->work);
+    pthread_mutex_destroy(&s->lock);
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+static int by_file_line(const void *a, const void *b) {
+    const grep_match_t *x = (const grep_match_t *)a, *y = (const grep_match_t *)b;
+    int c = strcmp(x->file, y->file);
+    return c ? c : (x->line > y->line) - (x->line < y->line);
+}
+
+int grep_engine_run(const char *pattern, const char *path, const grep_options_t *options,
+                    grep_result_t *result) {
+    grep_options_t defaults = { 0 };
+    if (!options) {
+        options = &defaults;
+    }
+    memset(result, 0, sizeof(*result));
+
+    matcher_t matcher;
+    if (matcher_init(&matcher, pattern, options->case_sensitive, result->error,
+                     sizeof(result->error)) != 0) {
+        return -1;
+    }
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        matcher_free(&matcher);
+        return -2;
+    }
+
+    search_t s;
+    memset(&s, 0, sizeof(s));
+    s.matcher = &matcher;
+    s.include = options->include;
+    s.max_matches = options->max_matches > 0 ? options->max_matches : GREP_MAX_MATCHES;
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.work, NULL);
+
+    if (options->files) {
+        s.root = path;
+        s.list = options->files;
+        s.list_count = options->file_count;
+        run_workers(&s, options->threads);
+    } else if (!S_ISDIR(st.st_mode)) {
+        worker_t w;
+        if (worker_init(&w, &s) == 0) {
+            search_file(&w, path);
+            s.files = w.files;
+            s.bytes = w.bytes;
+        } else {
+            s.failed = 1;
+        }
+        worker_free(&w);
+    } else {
+        if (push_dir(&s, path, "", 0, NULL) != 0) {
+            s.failed = 1;
+        }
+        run_workers(&s, options->threads);
+    }
+    search_free(&s);
+    matcher_free(&matcher);
+
+    if (s.count > 1) {
+        qsort(s.matches, (size_t)s.count, sizeof(grep_match_t), by_file_line);
+    }
+    result->matches = s.matches;
+    result->count = s.count;
+    result->truncated = s.count >= s.max_matches;
+    result->files = s.files;
+    result->bytes = s.bytes;
+    if (s.failed) {
+        grep_result_free(result);
+        return -3;
+    }
+    return 0;
+}
+
+void grep_result_free(grep_result_t *result) {
+    if (!result) {
+        return;
+    }
+    for (int i = 0; i < result->count; i++) {
+        free(result->matches[i].file);
+        free(result->matches[i].content);
+    }
+    free(result->matches);
+    result->matches = NULL;
+    result->count = 0;
+}
+
+int grep_engine_walk(const char *root, int threads, grep_visit_fn visit, void *ctx) {
+    struct stat st;
+    if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return -2;
+    }
+    search_t s;
+    memset(&s, 0, sizeof(s));
+    s.visit = visit;
+    s.visit_ctx = ctx;
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.work, NULL);
+    if (push_dir(&s, root, "", 0, NULL) != 0) {
+        s.failed = 1;
+    }
+    run_workers(&s, threads);
+    search_free(&s);
+    return s.failed ? -3 : 0;
+}
+
+int grep_engine_literals(const char *pattern, int case_sensitive, char literals[][128],
+                         int max) {
+    matcher_t m;
+    char error[8];
+    if (matcher_init(&m, pattern, case_sensitive, error, sizeof(error)) != 0) {
+        return 0;
+    }
+    int count = m.literal_count <= max ? m.literal_count : 0;
+    for (int i = 0; i < count; i++) {
+        size_t n = m.literals[i].len < 127 ? m.literals[i].len : 127;
+        memcpy(literals[i], m.literals[i].text, n);
+        literals[i][n] = '\0';
+    }
+    matcher_free(&m);
+    return count;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file grep_engine.h
+ * @brief Parallel content search behind the grep tool
+ *
+ * Walks a directory tree with a pool of threads sharing a queue of
+ * directories, honouring .gitignore files at and below the searched
+ * directory, and searches each file in one pass over its bytes (mmap for
+ * large files). A literal the pattern cannot match without (one per
+ * top-level alternative) is located with memchr first, so files and
+ * lines without it never reach the regex engine; patterns that are plain
+ * literals never do at all.
+ *
+ * Regexes use PCRE2 (JIT-compiled when the build supports it) with
+ * ARC_CODER_PCRE2, POSIX extended regexes otherwise.
+ */
+
+#ifndef GREP_ENGINE_H
+#define GREP_ENGINE_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    char *file;
+    int line;                        /**< 1-based */
+    char *content;                   /**< The line, cut at 200 bytes ("...") */
+} grep_match_t;
+
+typedef struct {
+    const char *include;             /**< File name glob, "{a,b}" alternatives allowed (NULL = all) */
+    int max_matches;                 /**< Stop after this many (0 = 500) */
+    int threads;                     /**< Walker threads (0 = online CPUs, at most 16) */
+    int case_sensitive;              /**< Default: case-insensitive */
+    const char *const *files;        /**< Search only these, relative to path, instead
+                                          of walking it (NULL = walk) */
+    size_t file_count;
+} grep_options_t;
+
+typedef struct {
+    grep_match_t *matches;           /**< Sorted by file, then line */
+    int count;
+    int truncated;                   /**< max_matches reached: which ones were kept
+                                          depends on thread timing */
+    size_t files;                    /**< Files searched */
+    size_t bytes;                    /**< Bytes searched */
+    char error[256];                 /**< Why the pattern did not compile */
+} grep_result_t;
+
+/**
+ * @brief Search a file or a directory tree
+ *
+ * @return 0 on success, -1 if the pattern does not compile (result->error
+ *         says why), -2 if path does not exist, -3 out of memory
+ */
+int grep_engine_run(const char *pattern, const char *path, const grep_options_t *options,
+                    grep_result_t *result);
+
+/**
+ * @brief Free the matches of a result
+ */
+void grep_result_free(grep_result_t *result);
+
+/**
+ * @brief Called for every directory and file a search of the tree would visit
+ *
+ * Runs on the walker threads, concurrently. rel is relative to the root
+ * ("" for the root itself). *scratch starts NULL and belongs to the
+ * calling thread for the whole walk; it is free()d afterwards.
+ */
+typedef void (*grep_visit_fn)(void *ctx, void **scratch, const char *path, const char *rel,
+                              const struct stat *st);
+
+/**
+ * @brief Walk a tree the way grep_engine_run() does, without searching
+ *
+ * @return 0 on success, -2 if root is not a directory, -3 out of memory
+ */
+int grep_engine_walk(const char *root, int threads, grep_visit_fn visit, void *ctx);
+
+/**
+ * @brief Literals a pattern cannot match without
+ *
+ * Every match contains one of the returned literals (lowercased unless
+ * the match is case-sensitive).
+ *
+ * @return Number of literals, 0 when the pattern has no usable ones
+ */
+int grep_engine_literals(const char *pattern, int case_sensitive, char literals[][128],
+                         int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GREP_ENGINE_H */
@@ -0,0 +1,760 @@
+/**
+ * @file html_extract.c
+ * @brief Streaming conversion of fetched pages to markdown or text
+ *
+ * A byte-at-a-time state machine, so chunk boundaries can fall anywhere:
+ * inside a tag, an entity or a comment. Only the current tag (attributes
+ * included, cut at TAG_MAX) and the output are buffered. Whitespace is
+ * collapsed outside <pre>; line breaks and spaces owed by block tags are
+ * kept pending and only written before the next visible text, so empty
+ * blocks leave no blank runs behind.
+ */
+
+#include "html_extract.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define TAG_MAX     2048
+#define LIST_DEPTH  16
+#define HREF_MAX    1024
+
+typedef enum {
+    ST_SNIFF,                        /* Before the first non-blank byte */
+    ST_PASS,                         /* Not HTML, or the html format */
+    ST_TEXT,
+    ST_TAG_OPEN,                     /* After '<' */
+    ST_TAG,                          /* Inside <...> */
+    ST_COMMENT,                      /* Inside <!-- ... --> */
+    ST_RAWTEXT,                      /* Inside <script>, <style>, ... (dropped) */
+    ST_ENTITY                        /* After '&' */
+} state_t;
+
+struct html_extract {
+    html_extract_format_t format;
+    char *out;
+    size_t len;
+    size_t cap;
+    size_t max;
+    int full;
+
+    state_t state;
+    char tag[TAG_MAX];
+    size_t tag_len;
+    char quote;                      /* Open attribute quote */
+    char last;                       /* Last non-blank byte of the tag */
+    char entity[12];
+    size_t entity_len;
+    int dashes;                      /* Consecutive '-' in a comment */
+    char raw_end[16];                /* "</script" etc. */
+    size_t raw_match;
+
+    int skip;                        /* Depth of dropped elements (<head>, <svg>, ...) */
+    int pre;
+    int pending_nl;                  /* Line breaks owed before the next text */
+    int pending_space;
+    char prefix[48];                 /* Written after the owed line breaks */
+    int line_start;
+    int cells;                       /* Cells written in the current table row */
+
+    int in_link;
+    size_t link_start;               /* Output length at the link's '[' */
+    char href[HREF_MAX];
+    char origin[256];                /* scheme://host[:port] of the page */
+
+    struct {
+        int ordered;
+        int counter;
+    } lists[LIST_DEPTH];
+    int list_depth;
+};
+
+/*============================================================================
+ * Output
+ *============================================================================*/
+
+static void put(html_extract_t *ex, const char *s, size_t n) {
+    if (ex->full || n == 0) {
+        return;
+    }
+    if (ex->len + n > ex->max) {
+        n = ex->max - ex->len;
+        while (n > 0 && ((unsigned char)s[n] & 0xC0) == 0x80) {
+            n--;                     /* Do not split a UTF-8 sequence */
+        }
+        ex->full = 1;
+    }
+    if (ex->len + n + 1 > ex->cap) {
+        size_t cap = ex->cap * 2;
+        while (cap < ex->len + n + 1) {
+            cap *= 2;
+        }
+        if (cap > ex->max + 1) {
+            cap = ex->max + 1;
+        }
+        char *out = realloc(ex->out, cap);
+        if (!out) {
+            ex->full = 1;
+            return;
+        }
+        ex->out = out;
+        ex->cap = cap;
+    }
+    memcpy(ex->out + ex->len, s, n);
+    ex->len += n;
+    ex->out[ex->len] = '\0';
+    ex->line_start = n > 0 ? s[n - 1] == '\n' : ex->line_start;
+}
+
+static void puts_(html_extract_t *ex, const char *s) {
+    put(ex, s, strlen(s));
+}
+
+/** Write the line breaks, space and prefix owed before visible output */
+static void flush_pending(html_extract_t *ex) {
+    if (ex->len > 0) {
+        int nl = ex->pending_nl - (ex->line_start ? 1 : 0);
+        for (int i = 0; i < nl; i++) {
+            put(ex, "\n", 1);
+        }
+        if (ex->pending_nl == 0 && ex->pending_space && !ex->line_start) {
+            put(ex, " ", 1);
+        }
+    }
+    ex->pending_nl = 0;
+    ex->pending_space = 0;
+    if (ex->prefix[0]) {
+        puts_(ex, ex->prefix);
+        ex->prefix[0] = '\0';
+    }
+}
+
+static void block(html_extract_t *ex, int lines) {
+    if (ex->pending_nl < lines) {
+        ex->pending_nl = lines;
+    }
+    ex->pending_space = 0;
+}
+
+static void text(html_extract_t *ex, const char *s, size_t n) {
+    if (ex->skip) {
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        char c = s[i];
+        if (ex->pre) {
+            flush_pending(ex);
+            put(ex, &c, 1);
+        } else if (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f') {
+            ex->pending_space = 1;
+        } else {
+            flush_pending(ex);
+            put(ex, &c, 1);
+        }
+    }
+}
+
+/** Opening markup: written like text */
+static void markup_open(html_extract_t *ex, const char *s) {
+    if (ex->format == HTML_EXTRACT_MARKDOWN && !ex->skip) {
+        flush_pending(ex);
+        puts_(ex, s);
+    }
+}
+
+/** Closing markup: sticks to the text before it, owed space stays owed */
+static void markup_close(html_extract_t *ex, const char *s) {
+    if (ex->format == HTML_EXTRACT_MARKDOWN && !ex->skip && ex->len > 0) {
+        puts_(ex, s);
+    }
+}
+
+/*============================================================================
+ * Entities
+ *============================================================================*/
+
+static size_t utf8_encode(unsigned long cp, char *out) {
+    if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        cp = 0xFFFD;
+    }
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static const struct {
+    const char *name;
+    unsigned long cp;
+} ENTITIES[] = {
+    { "amp", '&' }, { "lt", '<' }, { "gt", '>' }, { "quot", '"' }, { "apos", '\'' },
+    { "nbsp", ' ' }, { "mdash", 0x2014 }, { "ndash", 0x2013 }, { "hellip", 0x2026 },
+    { "lsquo", 0x2018 }, { "rsquo", 0x2019 }, { "ldquo", 0x201C }, { "rdquo", 0x201D },
+    { "copy", 0xA9 }, { "reg", 0xAE }, { "trade", 0x2122 }, { "times", 0xD7 },
+    { "middot", 0xB7 }, { "bull", 0x2022 }, { "rarr", 0x2192 }, { "larr", 0x2190 },
+};
+
+/* Letters U+00C0..U+00FF, in code point order */
+static const char *const LATIN1[] = {
+    "Agrave", "Aacute", "Acirc", "Atilde", "Auml", "Aring", "AElig", "Ccedil",
+    "Egrave", "Eacute", "Ecirc", "Euml", "Igrave", "Iacute", "Icirc", "Iuml",
+    "ETH", "Ntilde", "Ograve", "Oacute", "Ocirc", "Otilde", "Ouml", "times",
+    "Oslash", "Ugrave", "Uacute", "Ucirc", "Uuml", "Yacute", "THORN", "szlig",
+    "agrave", "aacute", "acirc", "atilde", "auml", "aring", "aelig", "ccedil",
+    "egrave", "eacute", "ecirc", "euml", "igrave", "iacute", "icirc", "iuml",
+    "eth", "ntilde", "ograve", "oacute", "ocirc", "otilde", "ouml", "divide",
+    "oslash", "ugrave", "uacute", "ucirc", "uuml", "yacute", "thorn", "yuml",
+};
+
+/** Text of the entity collected in ex->entity (terminated by ';') */
+static void entity_end(html_extract_t *ex) {
+    ex->entity[ex->entity_len] = '\0';
+    const char *e = ex->entity;
+    unsigned long cp = 0;
+    int known = 0;
+
+    if (e[0] == '#') {
+        char *end = NULL;
+        cp = (e[1] == 'x' || e[1] == 'X') ? strtoul(e + 2, &end, 16) : strtoul(e + 1, &end, 10);
+        known = end && *end == '\0' && end != e + 1;
+    } else {
+        for (size_t i = 0; i < sizeof(ENTITIES) / sizeof(ENTITIES[0]); i++) {
+            if (strcmp(ENTITIES[i].name, e) == 0) {
+                cp = ENTITIES[i].cp;
+                known = 1;
+                break;
+            }
+        }
+        for (size_t i = 0; !known && i < sizeof(LATIN1) / sizeof(LATIN1[0]); i++) {
+            if (strcmp(LATIN1[i], e) == 0) {
+                cp = 0xC0 + i;
+                known = 1;
+            }
+        }
+    }
+
+    if (!known) {
+        text(ex, "&", 1);
+        text(ex, e, ex->entity_len);
+        text(ex, ";", 1);
+        return;
+    }
+    char utf8[4];
+    text(ex, utf8, utf8_encode(cp, utf8));
+}
+
+/*============================================================================
+ * Tags
+ *============================================================================*/
+
+static int name_is(const char *name, const char *const *list) {
+    for (size_t i = 0; list[i]; i++) {
+        if (strcmp(name, list[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Contents never shown */
+static const char *const SKIP_TAGS[] = {
+    "head", "svg", "template", "select", "iframe", "object", "canvas", "noscript", NULL
+};
+/* Contents are raw text up to the end tag (and dropped) */
+static const char *const RAW_TAGS[] = { "script", "style", "textarea", "title", NULL };
+static const char *const BLOCK_TAGS[] = {
+    "div", "section", "article", "main", "header", "footer", "nav", "aside", "form",
+    "table", "dl", "dt", "dd", "figure", "figcaption", "details", "summary", "address",
+    "center", "fieldset", NULL
+};
+
+/**
+ * @brief Value of an attribute of the current tag
+ */
+static int tag_attr(const html_extract_t *ex, const char *attr, char *out, size_t out_size) {
+    size_t alen = strlen(attr);
+    const char *p = ex->tag;
+    const char *end = ex->tag + ex->tag_len;
+
+    while (p < end && !isspace((unsigned char)*p)) {
+        p++;                         /* Tag name */
+    }
+    while (p < end) {
+        while (p < end && (isspace((unsigned char)*p) || *p == '/')) {
+            p++;
+        }
+        const char *name = p;
+        while (p < end && *p != '=' && !isspace((unsigned char)*p) && *p != '/') {
+            p++;
+        }
+        size_t nlen = (size_t)(p - name);
+        while (p < end && isspace((unsigned char)*p)) {
+            p++;
+        }
+        const char *value = NULL;
+        size_t vlen = 0;
+        if (p < end && *p == '=') {
+            p++;
+            while (p < end && isspace((unsigned char)*p)) {
+                p++;
+            }
+            if (p < end && (*p == '"' || *p == '\'')) {
+                char q = *p++;
+                value = p;
+                while (p < end && *p != q) {
+                    p++;
+                }
+                vlen = (size_t)(p - value);
+                if (p < end) {
+                    p++;
+                }
+            } else {
+                value = p;
+                while (p < end && !isspace((unsigned char)*p)) {
+                    p++;
+                }
+                vlen = (size_t)(p - value);
+            }
+        }
+        if (nlen == 0 && !value) {
+            break;
+        }
+        if (nlen == alen && strncasecmp(name, attr, alen) == 0 && value) {
+            if (vlen >= out_size) {
+                vlen = out_size - 1;
+            }
+            memcpy(out, value, vlen);
+            out[vlen] = '\0';
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Link target as the reader needs it; empty for in-page and script links */
+static void resolve_href(const html_extract_t *ex, const char *href, char *out, size_t out_size) {
+    while (isspace((unsigned char)*href)) {
+        href++;
+    }
+    if (href[0] == '\0' || href[0] == '#' || strncasecmp(href, "javascript:", 11) == 0) {
+        out[0] = '\0';
+    } else if (href[0] == '/' && href[1] == '/') {
+        snprintf(out, out_size, "https:%s", href);
+    } else if (href[0] == '/' && ex->origin[0]) {
+        snprintf(out, out_size, "%s%s", ex->origin, href);
+    } else {
+        snprintf(out, out_size, "%s", href);
+    }
+}
+
+static void list_item(html_extract_t *ex) {
+    block(ex, 1);
+    int depth = ex->list_depth > 0 ? ex->list_depth : 1;
+    int indent = (depth - 1) * 2;
+    if (indent > 20) {
+        indent = 20;
+    }
+    if (ex->list_depth > 0 && ex->list_depth <= LIST_DEPTH &&
+        ex->lists[ex->list_depth - 1].ordered) {
+        snprintf(ex->prefix, sizeof(ex->prefix), "%*s%d. ", indent, "",
+                 ++ex->lists[ex->list_depth - 1].counter);
+    } else {
+        snprintf(ex->prefix, sizeof(ex->prefix), "%*s- ", indent, "");
+    }
+}
+
+static void start_tag(html_extract_t *ex, const char *name, int self_closing) {
+    int md = ex->format == HTML_EXTRACT_MARKDOWN;
+
+    if (name_is(name, SKIP_TAGS)) {
+        if (!self_closing) {
+            ex->skip++;
+        }
+        return;
+    }
+    if (name_is(name, RAW_TAGS)) {
+        if (!self_closing) {
+            snprintf(ex->raw_end, sizeof(ex->raw_end), "</%s", name);
+            ex->raw_match = 0;
+            ex->state = ST_RAWTEXT;
+        }
+        return;
+    }
+    if (ex->skip) {
+        return;
+    }
+
+    if (name[0] == 'h' && name[1] >= '1' && name[1] <= '6' && name[2] == '\0') {
+        block(ex, 2);
+        if (md) {
+            int level = name[1] - '0';
+            memset(ex->prefix, '#', (size_t)level);
+            ex->prefix[level] = ' ';
+            ex->prefix[level + 1] = '\0';
+        }
+    } else if (strcmp(name, "p") == 0 || strcmp(name, "blockquote") == 0) {
+        block(ex, 2);
+        if (md && name[0] == 'b') {
+            snprintf(ex->prefix, sizeof(ex->prefix), "> ");
+        }
+    } else if (strcmp(name, "br") == 0) {
+        block(ex, 1);
+    } else if (strcmp(name, "hr") == 0) {
+        block(ex, 2);
+        if (md) {
+            flush_pending(ex);
+            puts_(ex, "---");
+        }
+        block(ex, 2);
+    } else if (strcmp(name, "ul") == 0 || strcmp(name, "ol") == 0) {
+        block(ex, ex->list_depth == 0 ? 2 : 1);
+        if (ex->list_depth < LIST_DEPTH) {
+            ex->lists[ex->list_depth].ordered = name[0] == 'o';
+            ex->lists[ex->list_depth].counter = 0;
+        }
+        ex->list_depth++;
+    } else if (strcmp(name, "li") == 0) {
+        list_item(ex);
+    } else if (strcmp(name, "pre") == 0) {
+        block(ex, 2);
+        if (md) {
+            flush_pending(ex);
+            puts_(ex, "```\n");
+        }
+        ex->pre++;
+    } else if (strcmp(name, "tr") == 0) {
+        block(ex, 1);
+        ex->cells = 0;
+    } else if (strcmp(name, "td") == 0 || strcmp(name, "th") == 0) {
+        if (ex->cells++ > 0) {
+            flush_pending(ex);
+            puts_(ex, " | ");
+        }
+    } else if (name_is(name, BLOCK_TAGS)) {
+        block(ex, 1);
+    } else if (!md) {
+        return;                      /* The rest is markup only */
+    } else if (strcmp(name, "a") == 0) {
+        char href[HREF_MAX];
+        if (!ex->in_link && tag_attr(ex, "href", href, sizeof(href))) {
+            resolve_href(ex, href, ex->href, sizeof(ex->href));
+            if (ex->href[0]) {
+                flush_pending(ex);
+                ex->link_start = ex->len;
+                puts_(ex, "[");
+                ex->in_link = 1;
+            }
+        }
+    } else if (strcmp(name, "img") == 0) {
+        char alt[256], src[HREF_MAX], url[HREF_MAX];
+        if (tag_attr(ex, "alt", alt, sizeof(alt)) && alt[0] &&
+            tag_attr(ex, "src", src, sizeof(src))) {
+            resolve_href(ex, src, url, sizeof(url));
+            flush_pending(ex);
+            puts_(ex, "![");
+            puts_(ex, alt);
+            puts_(ex, "](");
+            puts_(ex, url);
+            puts_(ex, ")");
+        }
+    } else if (strcmp(name, "strong") == 0 || strcmp(name, "b") == 0) {
+        markup_open(ex, "**");
+    } else if (strcmp(name, "em") == 0 || strcmp(name, "i") == 0) {
+        markup_open(ex, "*");
+    } else if (strcmp(name, "code") == 0 && !ex->pre) {
+        markup_open(ex, "`");
+    }
+}
+
+static void end_tag(html_extract_t *ex, const char *name) {
+    int md = ex->format == HTML_EXTRACT_MARKDOWN;
+
+    if (name_is(name, SKIP_TAGS)) {
+        if (ex->skip > 0) {
+            ex->skip--;
+        }
+        return;
+    }
+    if (ex->skip) {
+        return;
+    }
+
+    if ((name[0] == 'h' && name[1] >= '1' && name[1] <= '6' && name[2] == '\0') ||
+        strcmp(name, "p") == 0 || strcmp(name, "blockquote") == 0) {
+        ex->prefix[0] = '\0';
+        block(ex, 2);
+    } else if (strcmp(name, "ul") == 0 || strcmp(name, "ol") == 0) {
+        if (ex->list_depth > 0) {
+            ex->list_depth--;
+        }
+        block(ex, ex->list_depth == 0 ? 2 : 1);
+    } else if (strcmp(name, "li") == 0) {
+        block(ex, 1);
+    } else if (strcmp(name, "pre") == 0) {
+        if (ex->pre > 0) {
+            ex->pre--;
+            if (md) {
+                if (!ex->line_start) {
+                    puts_(ex, "\n");
+                }
+                puts_(ex, "```");
+            }
+            block(ex, 2);
+        }
+    } else if (strcmp(name, "tr") == 0 || name_is(name, BLOCK_TAGS)) {
+        block(ex, 1);
+    } else if (!md) {
+        return;
+    } else if (strcmp(name, "a") == 0) {
+        if (ex->in_link) {
+            ex->in_link = 0;
+            if (ex->len == ex->link_start + 1 && !ex->full) {
+                ex->len = ex->link_start;        /* No text: drop the link */
+                ex->out[ex->len] = '\0';
+            } else {
+                puts_(ex, "](");
+                puts_(ex, ex->href);
+                puts_(ex, ")");
+            }
+        }
+    } else if (strcmp(name, "strong") == 0 || strcmp(name, "b") == 0) {
+        markup_close(ex, "**");
+    } else if (strcmp(name, "em") == 0 || strcmp(name, "i") == 0) {
+        markup_close(ex, "*");
+    } else if (strcmp(name, "code") == 0 && !ex->pre) {
+        markup_close(ex, "`");
+    }
+}
+
+/** A complete tag is in ex->tag (without the angle brackets) */
+static void tag_end(html_extract_t *ex) {
+    ex->tag[ex->tag_len] = '\0';
+    const char *p = ex->tag;
+    int closing = *p == '/';
+    if (closing) {
+        p++;
+    }
+    if (!isalpha((unsigned char)*p)) {
+        return;                      /* <!DOCTYPE>, <?xml?> */
+    }
+
+    char name[16];
+    size_t n = 0;
+    while (isalnum((unsigned char)p[n]) && n < sizeof(name) - 1) {
+        name[n] = (char)tolower((unsigned char)p[n]);
+        n++;
+    }
+    name[n] = '\0';
+
+    if (closing) {
+        end_tag(ex, name);
+    } else {
+        start_tag(ex, name, ex->last == '/');
+    }
+}
+
+/*============================================================================
+ * State Machine
+ *============================================================================*/
+
+static void feed_html(html_extract_t *ex, const char *data, size_t len) {
+    const char *run = NULL;          /* Start of a run of plain text */
+
+    for (size_t i = 0; i < len && !ex->full; i++) {
+        char c = data[i];
+        switch (ex->state) {
+        case ST_TEXT:
+            if (c == '<' || c == '&') {
+                if (run) {
+                    text(ex, run, (size_t)(data + i - run));
+                    run = NULL;
+                }
+                ex->state = c == '<' ? ST_TAG_OPEN : ST_ENTITY;
+                ex->entity_len = 0;
+            } else if (!run) {
+                run = data + i;
+            }
+            break;
+
+        case ST_TAG_OPEN:
+            if (isalpha((unsigned char)c) || c == '/' || c == '!' || c == '?') {
+                ex->state = ST_TAG;
+                ex->tag[0] = c;
+                ex->tag_len = 1;
+                ex->quote = 0;
+                ex->last = c;
+            } else {
+                text(ex, "<", 1);
+                ex->state = ST_TEXT;
+                i--;                 /* Read c again as text */
+            }
+            break;
+
+        case ST_TAG:
+            if (ex->quote) {
+                if (c == ex->quote) {
+                    ex->quote = 0;
+                }
+            } else if (c == '>') {
+                ex->state = ST_TEXT;
+                tag_end(ex);
+                break;
+            } else if ((c == '"' || c == '\'') && ex->last == '=') {
+                ex->quote = c;
+            }
+            if (!isspace((unsigned char)c)) {
+                ex->last = c;
+            }
+            if (ex->tag_len < TAG_MAX - 1) {
+                ex->tag[ex->tag_len++] = c;
+            }
+            if (ex->tag_len == 3 && memcmp(ex->tag, "!--", 3) == 0) {
+                ex->state = ST_COMMENT;
+                ex->dashes = 0;
+            }
+            break;
+
+        case ST_COMMENT:
+            if (c == '>' && ex->dashes >= 2) {
+                ex->state = ST_TEXT;
+            }
+            ex->dashes = c == '-' ? ex->dashes + 1 : 0;
+            break;
+
+        case ST_RAWTEXT: {
+            char lc = (char)tolower((unsigned char)c);
+            if (lc == ex->raw_end[ex->raw_match]) {
+                if (ex->raw_end[++ex->raw_match] == '\0') {
+                    /* The end tag: read the rest of it as a tag */
+                    ex->tag_len = strlen(ex->raw_end) - 1;
+                    memcpy(ex->tag, ex->raw_end + 1, ex->tag_len);
+                    ex->last = ex->tag[ex->tag_len - 1];
+                    ex->quote = 0;
+                    ex->state = ST_TAG;
+                }
+            } else {
+                ex->raw_match = lc == ex->raw_end[0] ? 1 : 0;
+            }
+            break;
+        }
+
+        case ST_ENTITY:
+            if (c == ';') {
+                entity_end(ex);
+                ex->state = ST_TEXT;
+            } else if ((isalnum((unsigned char)c) || (c == '#' && ex->entity_len == 0)) &&
+                       ex->entity_len < sizeof(ex->entity) - 1) {
+                ex->entity[ex->entity_len++] = c;
+            } else {
+                text(ex, "&", 1);    /* Not an entity after all */
+                text(ex, ex->entity, ex->entity_len);
+                ex->state = ST_TEXT;
+                i--;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (run && !ex->full) {
+        text(ex, run, (size_t)(data + len - run));
+    }
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+html_extract_t *html_extract_create(html_extract_format_t format, const char *base_url,
+                                    size_t max_out) {
+    html_extract_t *ex = calloc(1, sizeof(*ex));
+    if (!ex) {
+        return NULL;
+    }
+    ex->format = format;
+    ex->max = max_out > 0 ? max_out : 1;
+    ex->cap = ex->max < 4096 ? ex->max + 1 : 4096;
+    ex->out = malloc(ex->cap);
+    if (!ex->out) {
+        free(ex);
+        return NULL;
+    }
+    ex->out[0] = '\0';
+    ex->line_start = 1;
+    ex->state = format == HTML_EXTRACT_HTML ? ST_PASS : ST_SNIFF;
+
+    if (base_url) {
+        const char *host = strstr(base_url, "://");
+        if (host) {
+            size_t n = (size_t)(host + 3 - base_url) + strcspn(host + 3, "/?#");
+            if (n < sizeof(ex->origin)) {
+                memcpy(ex->origin, base_url, n);
+                ex->origin[n] = '\0';
+            }
+        }
+    }
+    return ex;
+}
+
+int html_extract_feed(html_extract_t *ex, const char *data, size_t len) {
+    if (!ex || ex->full) {
+        return 1;
+    }
+
+    if (ex->state == ST_SNIFF) {
+        /* HTML starts with a tag; skip a BOM and blank lines to see */
+        while (len > 0 && (isspace((unsigned char)*data) || (unsigned char)*data == 0xEF ||
+                           (unsigned char)*data == 0xBB || (unsigned char)*data == 0xBF)) {
+            data++;
+            len--;
+        }
+        if (len == 0) {
+            return 0;
+        }
+        ex->state = *data == '<' ? ST_TEXT : ST_PASS;
+    }
+
+    if (ex->state == ST_PASS) {
+        put(ex, data, len);
+    } else {
+        feed_html(ex, data, len);
+    }
+    return ex->full;
+}
+
+const char *html_extract_output(html_extract_t *ex, size_t *len, int *truncated) {
+    if (len) {
+        *len = ex->len;
+    }
+    if (truncated) {
+        *truncated = ex->full;
+    }
+    return ex->out;
+}
+
+void html_extract_destroy(html_extract_t *ex) {
+    if (ex) {
+        free(ex->out);
+        free(ex);
+    }
+}
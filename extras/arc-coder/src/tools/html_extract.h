@@ -0,0 +1,68 @@
+/**
+ * @file html_extract.h
+ * @brief Streaming conversion of fetched pages to markdown or text
+ *
+ * Fed the body chunk by chunk as it arrives, so a page is never held in
+ * memory as a whole: only the output is kept, up to a size cap, and the
+ * caller stops the download once the cap is reached. Scripts, styles and
+ * the document head are dropped; headings, paragraphs, lists, links,
+ * emphasis, code and preformatted blocks become their markdown form.
+ *
+ * Whether a body is HTML is sniffed from its first bytes; anything else
+ * (plain text, JSON, markdown) passes through unchanged, as does every
+ * body in the "html" format.
+ */
+
+#ifndef HTML_EXTRACT_H
+#define HTML_EXTRACT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    HTML_EXTRACT_MARKDOWN,
+    HTML_EXTRACT_TEXT,
+    HTML_EXTRACT_HTML                /**< Raw body, only capped */
+} html_extract_format_t;
+
+typedef struct html_extract html_extract_t;
+
+/**
+ * @brief Start a conversion
+ *
+ * @param format    Output format
+ * @param base_url  URL of the page, to make root-relative links absolute (may be NULL)
+ * @param max_out   Output cap in bytes
+ * @return Converter, NULL out of memory
+ */
+html_extract_t *html_extract_create(html_extract_format_t format, const char *base_url,
+                                    size_t max_out);
+
+/**
+ * @brief Convert the next chunk of the body
+ *
+ * @return 0 to go on, 1 once the output is full (the rest is not needed)
+ */
+int html_extract_feed(html_extract_t *ex, const char *data, size_t len);
+
+/**
+ * @brief Output so far, NUL-terminated (owned by the converter)
+ *
+ * @param len        Receives the length (may be NULL)
+ * @param truncated  Receives 1 if the cap cut the output (may be NULL)
+ */
+const char *html_extract_output(html_extract_t *ex, size_t *len, int *truncated);
+
+/**
+ * @brief Free a converter
+ */
+void html_extract_destroy(html_extract_t *ex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTML_EXTRACT_H */
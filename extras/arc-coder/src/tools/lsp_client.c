@@ -0,0 +1,1211 @@
+/**
+ * @file lsp_client.c
+ * @brief Pool of persistent language server sessions
+ *
+ * Ownership: the pool list, each acquirer and each server's reader
+ * thread hold a reference. The reader owns the process: it notices the
+ * server's exit (or idleness, after which it asks it to exit), reaps it
+ * and fails whatever is still waiting. The last reference frees.
+ */
+
+#include "lsp_client.h"
+#include "file_cache.h"
+#include <arc/env.h>
+#include <arc/platform.h>
+#include <cJSON.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+
+#define LSP_INIT_TIMEOUT_MS  60000          /* Start and initialize handshake */
+#define LSP_IDLE_DEFAULT_S   600
+#define LSP_EXIT_GRACE_MS    1000           /* exit notification to SIGKILL */
+#define LSP_POLL_MS          1000           /* Reader wakeups, to check idleness */
+#define LSP_MAX_MESSAGE      (64u * 1024 * 1024)
+
+#ifdef MSG_NOSIGNAL
+#define LSP_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define LSP_SEND_FLAGS 0
+#endif
+
+/*============================================================================
+ * Servers and Languages
+ *============================================================================*/
+
+typedef struct {
+    const char *name;
+    const char *env;                 /* Overrides the command */
+    const char *commands[3];         /* Else the first found on PATH */
+} lsp_server_def_t;
+
+enum { SERVER_CLANGD, SERVER_PYTHON, SERVER_GOPLS, SERVER_RUST, SERVER_TYPESCRIPT };
+
+static const lsp_server_def_t SERVERS[] = {
+    [SERVER_CLANGD]     = { "clangd", "LSP_CLANGD", { "clangd", NULL, NULL } },
+    [SERVER_PYTHON]     = { "python", "LSP_PYTHON",
+                            { "pyright-langserver --stdio", "basedpyright-langserver --stdio", "pylsp" } },
+    [SERVER_GOPLS]      = { "gopls", "LSP_GOPLS", { "gopls", NULL, NULL } },
+    [SERVER_RUST]       = { "rust-analyzer", "LSP_RUST_ANALYZER", { "rust-analyzer", NULL, NULL } },
+    [SERVER_TYPESCRIPT] = { "typescript", "LSP_TYPESCRIPT",
+                            { "typescript-language-server --stdio", NULL, NULL } },
+};
+
+typedef struct {
+    const char *ext;
+    const char *language_id;
+    int server;
+} lsp_language_t;
+
+static const lsp_language_t LANGUAGES[] = {
+    { "c", "c", SERVER_CLANGD },
+    { "h", "c", SERVER_CLANGD },
+    { "cc", "cpp", SERVER_CLANGD },
+    { "cpp", "cpp", SERVER_CLANGD },
+    { "cxx", "cpp", SERVER_CLANGD },
+    { "hh", "cpp", SERVER_CLANGD },
+    { "hpp", "cpp", SERVER_CLANGD },
+    { "hxx", "cpp", SERVER_CLANGD },
+    { "py", "python", SERVER_PYTHON },
+    { "pyi", "python", SERVER_PYTHON },
+    { "go", "go", SERVER_GOPLS },
+    { "rs", "rust", SERVER_RUST },
+    { "ts", "typescript", SERVER_TYPESCRIPT },
+    { "tsx", "typescriptreact", SERVER_TYPESCRIPT },
+    { "js", "javascript", SERVER_TYPESCRIPT },
+    { "jsx", "javascriptreact", SERVER_TYPESCRIPT },
+    { "mjs", "javascript", SERVER_TYPESCRIPT },
+    { "cjs", "javascript", SERVER_TYPESCRIPT },
+};
+
+static const lsp_language_t *language_of(const char *path) {
+    const char *slash = strrchr(path, '/');
+    const char *dot = strrchr(slash ? slash : path, '.');
+    if (!dot) {
+        return NULL;
+    }
+    for (size_t i = 0; i < sizeof(LANGUAGES) / sizeof(LANGUAGES[0]); i++) {
+        if (strcasecmp(dot + 1, LANGUAGES[i].ext) == 0) {
+            return &LANGUAGES[i];
+        }
+    }
+    return NULL;
+}
+
+/** Whether the first word of a command is an executable on PATH */
+static int command_found(const char *command) {
+    char word[256];
+    size_t n = strcspn(command, " \t");
+    if (n == 0 || n >= sizeof(word)) {
+        return 0;
+    }
+    memcpy(word, command, n);
+    word[n] = '\0';
+    if (strchr(word, '/')) {
+        return access(word, X_OK) == 0;
+    }
+
+    const char *path = getenv("PATH");
+    while (path && *path) {
+        size_t len = strcspn(path, ":");
+        char candidate[4096];
+        if (len > 0 && len + n + 2 <= sizeof(candidate)) {
+            memcpy(candidate, path, len);
+            candidate[len] = '/';
+            memcpy(candidate + len + 1, word, n + 1);
+            if (access(candidate, X_OK) == 0) {
+                return 1;
+            }
+        }
+        path += len;
+        path += *path == ':';
+    }
+    return 0;
+}
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+typedef struct lsp_doc {
+    char *path;                      /* Canonical */
+    char *uri;
+    const char *language_id;
+    int version;
+    char *text;                      /* As the server last saw it, NUL-terminated */
+    size_t len;
+    struct lsp_doc *next;
+} lsp_doc_t;
+
+typedef struct lsp_pending {
+    long id;
+    cJSON *message;                  /* Response, once it arrived */
+    struct lsp_pending *next;
+} lsp_pending_t;
+
+enum { STATE_STARTING, STATE_READY, STATE_DEAD };
+
+struct lsp_server {
+    const lsp_server_def_t *def;
+    char *root;                      /* Canonical workspace */
+    int fd;                          /* The server's stdin/stdout, -1 once closed */
+    pid_t pid;
+
+    pthread_mutex_t lock;            /* Fields below, up to refs */
+    pthread_cond_t cond;             /* Responses, readiness, death */
+    pthread_mutex_t write_lock;      /* Whole messages onto fd */
+    int state;
+    char error[256];                 /* Why it is dead */
+    long next_id;
+    lsp_pending_t *pending;
+    lsp_doc_t *docs;
+    cJSON *capabilities;             /* Set before STATE_READY, then fixed */
+    int sync_kind;                   /* TextDocumentSyncKind: 0 none, 1 full, 2 incremental */
+    uint64_t kill_at;                /* Asked to exit; SIGKILL due then */
+
+    /* Guarded by g_pool_lock */
+    int refs;
+    int linked;                      /* In g_servers */
+    uint64_t last_used;
+    struct lsp_server *next;
+};
+
+static pthread_mutex_t g_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_pool_cond = PTHREAD_COND_INITIALIZER;   /* Readers exiting */
+static lsp_server_t *g_servers;
+static int g_live_readers;
+
+static void server_free(lsp_server_t *s) {
+    while (s->docs) {
+        lsp_doc_t *doc = s->docs;
+        s->docs = doc->next;
+        free(doc->path);
+        free(doc->uri);
+        free(doc->text);
+        free(doc);
+    }
+    cJSON_Delete(s->capabilities);
+    pthread_mutex_destroy(&s->lock);
+    pthread_mutex_destroy(&s->write_lock);
+    pthread_cond_destroy(&s->cond);
+    free(s->root);
+    free(s);
+}
+
+/** Drop a reference (g_pool_lock held) */
+static void server_unref_locked(lsp_server_t *s) {
+    if (--s->refs == 0 && !s->linked) {
+        server_free(s);
+    }
+}
+
+static void server_unlink_locked(lsp_server_t *s) {
+    if (!s->linked) {
+        return;
+    }
+    for (lsp_server_t **p = &g_servers; *p; p = &(*p)->next) {
+        if (*p == s) {
+            *p = s->next;
+            break;
+        }
+    }
+    s->linked = 0;
+}
+
+/** Mark dead and fail everything waiting on the server */
+static void server_fail(lsp_server_t *s, const char *why) {
+    pthread_mutex_lock(&s->lock);
+    if (s->state != STATE_DEAD) {
+        s->state = STATE_DEAD;
+        snprintf(s->error, sizeof(s->error), "%s", why);
+    }
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/*============================================================================
+ * Messages
+ *============================================================================*/
+
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, LSP_SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/** Content-Length framed message (takes msg over; free()) */
+static char *frame(cJSON *msg, size_t *len) {
+    cJSON_AddStringToObject(msg, "jsonrpc", "2.0");
+    char *body = cJSON_PrintUnformatted(msg);
+    cJSON_Delete(msg);
+    if (!body) {
+        return NULL;
+    }
+    size_t body_len = strlen(body);
+    char header[64];
+    int header_len = snprintf(header, sizeof(header), "Content-Length: %zu\r\n\r\n", body_len);
+    char *framed = malloc((size_t)header_len + body_len);
+    if (framed) {
+        memcpy(framed, header, (size_t)header_len);
+        memcpy(framed + header_len, body, body_len);
+        *len = (size_t)header_len + body_len;
+    }
+    free(body);
+    return framed;
+}
+
+/** Write a framed message (write_lock held) */
+static int write_frame_locked(lsp_server_t *s, const char *framed, size_t len) {
+    return framed && s->fd >= 0 && send_all(s->fd, framed, len) == 0 ? 0 : -1;
+}
+
+/** Frame and send a message (takes msg over) */
+static int server_send(lsp_server_t *s, cJSON *msg) {
+    size_t len = 0;
+    char *framed = frame(msg, &len);
+    pthread_mutex_lock(&s->write_lock);
+    int rc = write_frame_locked(s, framed, len);
+    pthread_mutex_unlock(&s->write_lock);
+    free(framed);
+    return rc;
+}
+
+static cJSON *notification(const char *method, cJSON *params) {
+    cJSON *msg = cJSON_CreateObject();
+    cJSON_AddStringToObject(msg, "method", method);
+    cJSON_AddItemToObject(msg, "params", params ? params : cJSON_CreateObject());
+    return msg;
+}
+
+/** Answer a request the server sent us, with the least that satisfies it */
+static void answer_server_request(lsp_server_t *s, const cJSON *request, const char *method) {
+    cJSON *reply = cJSON_CreateObject();
+    cJSON_AddItemToObject(reply, "id", cJSON_Duplicate(cJSON_GetObjectItem(request, "id"), 1));
+    if (strcmp(method, "workspace/configuration") == 0) {
+        /* One (absent) setting per item asked for */
+        cJSON *items = cJSON_GetObjectItem(cJSON_GetObjectItem(request, "params"), "items");
+        cJSON *result = cJSON_CreateArray();
+        for (int i = 0; i < cJSON_GetArraySize(items); i++) {
+            cJSON_AddItemToArray(result, cJSON_CreateNull());
+        }
+        cJSON_AddItemToObject(reply, "result", result);
+    } else {
+        cJSON_AddItemToObject(reply, "result", cJSON_CreateNull());
+    }
+    server_send(s, reply);
+}
+
+static void dispatch(lsp_server_t *s, cJSON *msg) {
+    const cJSON *id = cJSON_GetObjectItem(msg, "id");
+    const cJSON *method = cJSON_GetObjectItem(msg, "method");
+    if (cJSON_IsString(method)) {
+        if (id) {
+            answer_server_request(s, msg, method->valuestring);
+        }
+        cJSON_Delete(msg);          /* Notifications (diagnostics, logs) are not used */
+        return;
+    }
+    if (!cJSON_IsNumber(id)) {
+        cJSON_Delete(msg);
+        return;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    for (lsp_pending_t *p = s->pending; p; p = p->next) {
+        if (p->id == (long)id->valuedouble && !p->message) {
+            p->message = msg;
+            msg = NULL;
+            pthread_cond_broadcast(&s->cond);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    cJSON_Delete(msg);              /* Late answer to a request that timed out */
+}
+
+/**
+ * @brief Take complete messages off the front of the read buffer
+ * @return Bytes consumed, or -1 on a malformed frame
+ */
+static long parse_messages(lsp_server_t *s, char *buf, size_t len) {
+    size_t used = 0;
+    for (;;) {
+        char *start = buf + used;
+        size_t avail = len - used;
+        char *end = NULL;
+        for (size_t i = 0; i + 3 < avail; i++) {
+            if (memcmp(start + i, "\r\n\r\n", 4) == 0) {
+                end = start + i;
+                break;
+            }
+        }
+        if (!end) {
+            return (long)used;
+        }
+
+        size_t body_len = 0;
+        int found = 0;
+        for (char *line = start; line < end;) {
+            char *eol = line;
+            while (eol < end && *eol != '\r') {
+                eol++;
+            }
+            if (strncasecmp(line, "Content-Length:", 15) == 0) {
+                body_len = strtoul(line + 15, NULL, 10);
+                found = 1;
+            }
+            line = eol + 2;
+        }
+        if (!found || body_len > LSP_MAX_MESSAGE) {
+            return -1;
+        }
+        size_t header_len = (size_t)(end - start) + 4;
+        if (avail < header_len + body_len) {
+            return (long)used;
+        }
+
+        cJSON *msg = cJSON_ParseWithLength(start + header_len, body_len);
+        if (msg) {
+            dispatch(s, msg);
+        }
+        used += header_len + body_len;
+    }
+}
+
+/*============================================================================
+ * Server Process
+ *============================================================================*/
+
+/** Ask the server to exit; the reader kills it if it does not in time */
+static void server_stop(lsp_server_t *s) {
+    pthread_mutex_lock(&s->lock);
+    int first = s->kill_at == 0;
+    if (first) {
+        s->kill_at = ac_platform_timestamp_ms() + LSP_EXIT_GRACE_MS;
+        s->next_id++;
+    }
+    long id = s->next_id;
+    pthread_mutex_unlock(&s->lock);
+    if (!first) {
+        return;
+    }
+
+    /* Nobody waits for the shutdown reply: exit follows it at once */
+    cJSON *shutdown_msg = cJSON_CreateObject();
+    cJSON_AddNumberToObject(shutdown_msg, "id", (double)id);
+    cJSON_AddStringToObject(shutdown_msg, "method", "shutdown");
+    server_send(s, shutdown_msg);
+    server_send(s, notification("exit", NULL));
+
+    pthread_mutex_lock(&s->write_lock);
+    if (s->fd >= 0) {
+        shutdown(s->fd, SHUT_WR);
+    }
+    pthread_mutex_unlock(&s->write_lock);
+}
+
+static int idle_timeout_ms(void) {
+    const char *value = ac_env_get("LSP_IDLE_TIMEOUT", NULL);
+    int seconds = value ? atoi(value) : LSP_IDLE_DEFAULT_S;
+    return (seconds > 0 ? seconds : LSP_IDLE_DEFAULT_S) * 1000;
+}
+
+static void *reader_main(void *arg) {
+    lsp_server_t *s = (lsp_server_t *)arg;
+    uint64_t idle_ms = (uint64_t)idle_timeout_ms();
+    size_t cap = 65536;
+    size_t len = 0;
+    char *buf = malloc(cap);
+    const char *why = "language server exited";
+
+    while (buf) {
+        pthread_mutex_lock(&s->lock);
+        uint64_t kill_at = s->kill_at;
+        pthread_mutex_unlock(&s->lock);
+        uint64_t now = ac_platform_timestamp_ms();
+        if (kill_at && now >= kill_at) {
+            why = "language server stopped";
+            break;
+        }
+
+        int wait_ms = LSP_POLL_MS;
+        if (kill_at && kill_at - now < (uint64_t)wait_ms) {
+            wait_ms = (int)(kill_at - now);
+        }
+        struct pollfd pfd = { s->fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, wait_ms);
+        if (ready == 0) {
+            /* Idle: retire unless someone holds it besides this thread */
+            int retire = 0;
+            pthread_mutex_lock(&g_pool_lock);
+            if (s->linked && s->refs == 1 && now - s->last_used >= idle_ms) {
+                server_unlink_locked(s);
+                retire = 1;
+            }
+            pthread_mutex_unlock(&g_pool_lock);
+            if (retire) {
+                server_fail(s, "language server idle");
+                server_stop(s);
+            }
+            continue;
+        }
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (len == cap) {
+            char *grown = cap < LSP_MAX_MESSAGE * 2 ? realloc(buf, cap * 2) : NULL;
+            if (!grown) {
+                why = "language server message too large";
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(s->fd, buf + len, cap - len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+        long used = parse_messages(s, buf, len);
+        if (used < 0) {
+            why = "malformed message from language server";
+            break;
+        }
+        memmove(buf, buf + used, len - (size_t)used);
+        len -= (size_t)used;
+    }
+    free(buf);
+
+    server_fail(s, why);
+    pthread_mutex_lock(&s->write_lock);
+    close(s->fd);
+    s->fd = -1;
+    pthread_mutex_unlock(&s->write_lock);
+
+    /* Gone by EOF usually; its whole group goes regardless */
+    uint64_t give_up = ac_platform_timestamp_ms() + LSP_EXIT_GRACE_MS;
+    while (waitpid(s->pid, NULL, WNOHANG) == 0) {
+        if (ac_platform_timestamp_ms() >= give_up) {
+            kill(-s->pid, SIGKILL);
+            waitpid(s->pid, NULL, 0);
+            break;
+        }
+        struct timespec ts = { 0, 10 * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+
+    pthread_mutex_lock(&g_pool_lock);
+    server_unlink_locked(s);
+    server_unref_locked(s);
+    g_live_readers--;
+    pthread_cond_broadcast(&g_pool_cond);
+    pthread_mutex_unlock(&g_pool_lock);
+    return NULL;
+}
+
+/**
+ * @brief Start the server in its own process group, in the workspace
+ *
+ * stdin and stdout are one end of a socket pair, so a write to a server
+ * that died fails instead of raising SIGPIPE; stderr goes to /dev/null.
+ */
+static int server_spawn(lsp_server_t *s, const char *command) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    size_t script_len = strlen(command) + 32;
+    char *script = malloc(script_len);
+    if (!script) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    snprintf(script, script_len, "cd \"$1\" && exec %s", command);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attr);
+    sigset_t all;
+    sigset_t none;
+    sigfillset(&all);
+    sigemptyset(&none);
+
+    int rc = posix_spawn_file_actions_adddup2(&actions, fds[1], STDIN_FILENO);
+    if (rc == 0) rc = posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    if (rc == 0) rc = posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    if (rc == 0) rc = posix_spawnattr_setpgroup(&attr, 0);
+    if (rc == 0) rc = posix_spawnattr_setsigdefault(&attr, &all);
+    if (rc == 0) rc = posix_spawnattr_setsigmask(&attr, &none);
+    if (rc == 0) {
+        rc = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF |
+                                             POSIX_SPAWN_SETSIGMASK);
+    }
+    if (rc == 0) {
+        char *const argv[] = { "sh", "-c", script, "sh", s->root, NULL };
+        rc = posix_spawn(&s->pid, "/bin/sh", &actions, &attr, argv, environ);
+    }
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    free(script);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return -1;
+    }
+    s->fd = fds[0];
+    return 0;
+}
+
+static cJSON *initialize_params(const lsp_server_t *s) {
+    char *root_uri = lsp_path_to_uri(s->root);
+    const char *base = strrchr(s->root, '/');
+
+    cJSON *params = cJSON_CreateObject();
+    cJSON_AddNumberToObject(params, "processId", (double)getpid());
+    cJSON_AddStringToObject(params, "rootPath", s->root);
+    cJSON_AddStringToObject(params, "rootUri", root_uri ? root_uri : "");
+    cJSON *folders = cJSON_AddArrayToObject(params, "workspaceFolders");
+    cJSON *folder = cJSON_CreateObject();
+    cJSON_AddStringToObject(folder, "uri", root_uri ? root_uri : "");
+    cJSON_AddStringToObject(folder, "name", base && base[1] ? base + 1 : s->root);
+    cJSON_AddItemToArray(folders, folder);
+    cJSON *info = cJSON_AddObjectToObject(params, "clientInfo");
+    cJSON_AddStringToObject(info, "name", "arc-coder");
+    free(root_uri);
+
+    cJSON *caps = cJSON_AddObjectToObject(params, "capabilities");
+    cJSON *workspace = cJSON_AddObjectToObject(caps, "workspace");
+    cJSON_AddBoolToObject(workspace, "workspaceFolders", 1);
+    cJSON_AddBoolToObject(workspace, "configuration", 1);
+    cJSON_AddObjectToObject(workspace, "symbol");
+
+    cJSON *text = cJSON_AddObjectToObject(caps, "textDocument");
+    cJSON *sync = cJSON_AddObjectToObject(text, "synchronization");
+    cJSON_AddBoolToObject(sync, "didSave", 0);
+    cJSON_AddBoolToObject(cJSON_AddObjectToObject(text, "definition"), "linkSupport", 1);
+    cJSON_AddBoolToObject(cJSON_AddObjectToObject(text, "implementation"), "linkSupport", 1);
+    cJSON_AddObjectToObject(text, "references");
+    cJSON *hover = cJSON_AddObjectToObject(text, "hover");
+    cJSON *formats = cJSON_AddArrayToObject(hover, "contentFormat");
+    cJSON_AddItemToArray(formats, cJSON_CreateString("plaintext"));
+    cJSON_AddItemToArray(formats, cJSON_CreateString("markdown"));
+    cJSON_AddBoolToObject(cJSON_AddObjectToObject(text, "documentSymbol"),
+                          "hierarchicalDocumentSymbolSupport", 1);
+    cJSON_AddObjectToObject(text, "callHierarchy");
+    return params;
+}
+
+/** Spawn and initialize; the server is STATE_READY or STATE_DEAD afterwards */
+static void server_start(lsp_server_t *s, const char *command) {
+    if (server_spawn(s, command) != 0) {
+        char why[256];
+        snprintf(why, sizeof(why), "could not start %s: %s", command, strerror(errno));
+        server_fail(s, why);
+        pthread_mutex_lock(&g_pool_lock);
+        server_unlink_locked(s);
+        server_unref_locked(s);      /* The reader's, which never ran */
+        pthread_mutex_unlock(&g_pool_lock);
+        return;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_mutex_lock(&g_pool_lock);
+    g_live_readers++;
+    pthread_mutex_unlock(&g_pool_lock);
+    pthread_t reader;
+    if (pthread_create(&reader, &attr, reader_main, s) != 0) {
+        pthread_attr_destroy(&attr);
+        kill(-s->pid, SIGKILL);
+        waitpid(s->pid, NULL, 0);
+        close(s->fd);
+        s->fd = -1;
+        server_fail(s, "could not start reader thread");
+        pthread_mutex_lock(&g_pool_lock);
+        g_live_readers--;
+        server_unlink_locked(s);
+        server_unref_locked(s);
+        pthread_mutex_unlock(&g_pool_lock);
+        return;
+    }
+    pthread_attr_destroy(&attr);
+
+    cJSON *result = NULL;
+    char err[200];
+    if (lsp_request(s, "initialize", initialize_params(s), LSP_INIT_TIMEOUT_MS, &result,
+                    err, sizeof(err)) != 0) {
+        char why[256];
+        snprintf(why, sizeof(why), "initialize failed: %s", err);
+        server_fail(s, why);
+        server_stop(s);
+        return;
+    }
+
+    cJSON *caps = cJSON_DetachItemFromObject(result, "capabilities");
+    cJSON_Delete(result);
+    const cJSON *sync = cJSON_GetObjectItem(caps, "textDocumentSync");
+    int sync_kind = 1;
+    if (cJSON_IsNumber(sync)) {
+        sync_kind = sync->valueint;
+    } else if (cJSON_IsObject(sync)) {
+        const cJSON *change = cJSON_GetObjectItem(sync, "change");
+        sync_kind = cJSON_IsNumber(change) ? change->valueint : 0;
+    }
+    server_send(s, notification("initialized", NULL));
+
+    pthread_mutex_lock(&s->lock);
+    s->capabilities = caps ? caps : cJSON_CreateObject();
+    s->sync_kind = sync_kind;
+    if (s->state == STATE_STARTING) {
+        s->state = STATE_READY;
+    }
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/*============================================================================
+ * Pool
+ *============================================================================*/
+
+int lsp_pool_acquire(const char *workspace, const char *path, lsp_server_t **server,
+                     char *err, size_t err_size) {
+    *server = NULL;
+    const lsp_language_t *lang = language_of(path);
+    if (!lang) {
+        snprintf(err, err_size, "No language server is configured for this file type");
+        return -1;
+    }
+    const lsp_server_def_t *def = &SERVERS[lang->server];
+    char *root = realpath(workspace, NULL);
+    if (!root) {
+        snprintf(err, err_size, "Workspace not found: %s", workspace);
+        return -2;
+    }
+
+    pthread_mutex_lock(&g_pool_lock);
+    lsp_server_t *s = g_servers;
+    while (s && (s->def != def || strcmp(s->root, root) != 0)) {
+        s = s->next;
+    }
+    const char *command = NULL;
+    if (s) {
+        free(root);
+        s->refs++;
+        s->last_used = ac_platform_timestamp_ms();
+    } else {
+        command = ac_env_get(def->env, NULL);
+        for (int i = 0; !command && i < 3 && def->commands[i]; i++) {
+            if (command_found(def->commands[i])) {
+                command = def->commands[i];
+            }
+        }
+        if (!command) {
+            pthread_mutex_unlock(&g_pool_lock);
+            free(root);
+            snprintf(err, err_size, "No %s language server found on PATH (set %s to its command)",
+                     def->name, def->env);
+            return -1;
+        }
+        s = calloc(1, sizeof(lsp_server_t));
+        if (!s) {
+            pthread_mutex_unlock(&g_pool_lock);
+            free(root);
+            snprintf(err, err_size, "Out of memory");
+            return -2;
+        }
+        s->def = def;
+        s->root = root;
+        s->fd = -1;
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_mutex_init(&s->write_lock, NULL);
+        pthread_cond_init(&s->cond, NULL);
+        s->refs = 2;                 /* The caller and the reader */
+        s->linked = 1;
+        s->last_used = ac_platform_timestamp_ms();
+        s->next = g_servers;
+        g_servers = s;
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+
+    if (command) {
+        server_start(s, command);
+    }
+
+    pthread_mutex_lock(&s->lock);
+    while (s->state == STATE_STARTING) {
+        pthread_cond_wait(&s->cond, &s->lock);
+    }
+    int ready = s->state == STATE_READY;
+    if (!ready) {
+        snprintf(err, err_size, "%s: %s", def->name, s->error);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    if (!ready) {
+        lsp_pool_release(s);
+        return -2;
+    }
+    *server = s;
+    return 0;
+}
+
+void lsp_pool_release(lsp_server_t *server) {
+    if (!server) {
+        return;
+    }
+    pthread_mutex_lock(&g_pool_lock);
+    server->last_used = ac_platform_timestamp_ms();
+    /* A dead server leaves the pool, so the next query starts a new one */
+    pthread_mutex_lock(&server->lock);
+    int dead = server->state == STATE_DEAD;
+    pthread_mutex_unlock(&server->lock);
+    if (dead) {
+        server_unlink_locked(server);
+    }
+    server_unref_locked(server);
+    pthread_mutex_unlock(&g_pool_lock);
+}
+
+void lsp_pool_shutdown(void) {
+    pthread_mutex_lock(&g_pool_lock);
+    lsp_server_t *list = g_servers;
+    g_servers = NULL;
+    for (lsp_server_t *s = list; s; s = s->next) {
+        s->linked = 0;               /* The list's reference goes to this function */
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+
+    for (lsp_server_t *s = list, *next; s; s = next) {
+        next = s->next;
+        server_stop(s);
+        pthread_mutex_lock(&g_pool_lock);
+        server_unref_locked(s);
+        pthread_mutex_unlock(&g_pool_lock);
+    }
+
+    /* Readers reap their servers, killing those that do not exit in time */
+    uint64_t give_up = ac_platform_timestamp_ms() + LSP_EXIT_GRACE_MS * 3;
+    pthread_mutex_lock(&g_pool_lock);
+    while (g_live_readers > 0 && ac_platform_timestamp_ms() < give_up) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += 100 * 1000000L;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&g_pool_cond, &g_pool_lock, &until);
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+}
+
+const cJSON *lsp_server_capabilities(const lsp_server_t *server) {
+    return server->capabilities;
+}
+
+const char *lsp_server_name(const lsp_server_t *server) {
+    return server->def->name;
+}
+
+/*============================================================================
+ * Requests
+ *============================================================================*/
+
+int lsp_request(lsp_server_t *s, const char *method, cJSON *params, int timeout_ms,
+                cJSON **result, char *err, size_t err_size) {
+    *result = NULL;
+    lsp_pending_t pending = { 0 };
+
+    pthread_mutex_lock(&s->lock);
+    if (s->state == STATE_DEAD) {
+        snprintf(err, err_size, "%s", s->error);
+        pthread_mutex_unlock(&s->lock);
+        cJSON_Delete(params);
+        return -1;
+    }
+    pending.id = ++s->next_id;
+    pending.next = s->pending;
+    s->pending = &pending;
+    pthread_mutex_unlock(&s->lock);
+
+    cJSON *msg = cJSON_CreateObject();
+    cJSON_AddNumberToObject(msg, "id", (double)pending.id);
+    cJSON_AddStringToObject(msg, "method", method);
+    if (params) {
+        cJSON_AddItemToObject(msg, "params", params);
+    }
+    int sent = server_send(s, msg) == 0;
+
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeout_ms / 1000;
+    until.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+
+    int timed_out = 0;
+    pthread_mutex_lock(&s->lock);
+    while (sent && !pending.message && s->state != STATE_DEAD && !timed_out) {
+        timed_out = pthread_cond_timedwait(&s->cond, &s->lock, &until) == ETIMEDOUT;
+    }
+    for (lsp_pending_t **p = &s->pending; *p; p = &(*p)->next) {
+        if (*p == &pending) {
+            *p = pending.next;
+            break;
+        }
+    }
+    if (!pending.message && !timed_out) {
+        snprintf(err, err_size, "%s", s->state == STATE_DEAD ? s->error : "send failed");
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    if (!pending.message) {
+        if (timed_out) {
+            cJSON *cancel = cJSON_CreateObject();
+            cJSON_AddNumberToObject(cancel, "id", (double)pending.id);
+            server_send(s, notification("$/cancelRequest", cancel));
+            snprintf(err, err_size, "%s did not answer %s within %d ms",
+                     s->def->name, method, timeout_ms);
+            return -2;
+        }
+        return -1;
+    }
+
+    const cJSON *error = cJSON_GetObjectItem(pending.message, "error");
+    if (error) {
+        const cJSON *message = cJSON_GetObjectItem(error, "message");
+        snprintf(err, err_size, "%s", cJSON_IsString(message) ? message->valuestring
+                                                              : "error response");
+        cJSON_Delete(pending.message);
+        return -1;
+    }
+    *result = cJSON_DetachItemFromObject(pending.message, "result");
+    cJSON_Delete(pending.message);
+    if (!*result) {
+        *result = cJSON_CreateNull();
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Documents
+ *============================================================================*/
+
+/** LSP position (line, UTF-16 units) of a byte offset */
+static void text_position(const char *text, size_t offset, int *line, int *character) {
+    int l = 0;
+    int c = 0;
+    for (size_t i = 0; i < offset; i++) {
+        unsigned char ch = (unsigned char)text[i];
+        if (ch == '\n' || (ch == '\r' && text[i + 1] != '\n')) {
+            l++;
+            c = 0;
+        } else if (ch == '\r') {
+            /* First half of \r\n: the line ends at the \n */
+        } else if ((ch & 0xC0) != 0x80) {
+            c += ch >= 0xF0 ? 2 : 1; /* Outside the BMP: a surrogate pair */
+        }
+    }
+    *line = l;
+    *character = c;
+}
+
+static cJSON *range_json(int start_line, int start_char, int end_line, int end_char) {
+    cJSON *range = cJSON_CreateObject();
+    cJSON *start = cJSON_AddObjectToObject(range, "start");
+    cJSON_AddNumberToObject(start, "line", start_line);
+    cJSON_AddNumberToObject(start, "character", start_char);
+    cJSON *end = cJSON_AddObjectToObject(range, "end");
+    cJSON_AddNumberToObject(end, "line", end_line);
+    cJSON_AddNumberToObject(end, "character", end_char);
+    return range;
+}
+
+/**
+ * @brief The change from doc's text to data, as one content change
+ *
+ * Incremental servers get the span between the common prefix and the
+ * common suffix, widened so it splits neither a UTF-8 sequence nor a
+ * \r\n; others get the whole text.
+ */
+static cJSON *content_change(const lsp_doc_t *doc, const char *data, size_t size, int sync_kind) {
+    cJSON *change = cJSON_CreateObject();
+    if (sync_kind != 2) {
+        cJSON_AddStringToObject(change, "text", data);
+        return change;
+    }
+
+    const char *old = doc->text;
+    size_t max = doc->len < size ? doc->len : size;
+    size_t prefix = 0;
+    while (prefix < max && old[prefix] == data[prefix]) {
+        prefix++;
+    }
+    while (prefix > 0 && ((unsigned char)old[prefix] & 0xC0) == 0x80) {
+        prefix--;
+    }
+    if (prefix > 0 && old[prefix - 1] == '\r') {
+        prefix--;
+    }
+    size_t suffix = 0;
+    while (suffix < max - prefix && old[doc->len - 1 - suffix] == data[size - 1 - suffix]) {
+        suffix++;
+    }
+    while (suffix > 0 && ((unsigned char)old[doc->len - suffix] & 0xC0) == 0x80) {
+        suffix--;
+    }
+    if (suffix > 0 && old[doc->len - suffix] == '\n' && doc->len - suffix > prefix &&
+        old[doc->len - suffix - 1] == '\r') {
+        suffix--;
+    }
+
+    int start_line, start_char, end_line, end_char;
+    text_position(old, prefix, &start_line, &start_char);
+    text_position(old, doc->len - suffix, &end_line, &end_char);
+    cJSON_AddItemToObject(change, "range", range_json(start_line, start_char, end_line, end_char));
+
+    size_t text_len = size - suffix - prefix;
+    char *text = malloc(text_len + 1);
+    if (text) {
+        memcpy(text, data + prefix, text_len);
+        text[text_len] = '\0';
+    }
+    cJSON_AddStringToObject(change, "text", text ? text : "");
+    free(text);
+    return change;
+}
+
+/**
+ * @brief Open or update a document (canonical path)
+ *
+ * @param open  Open it if it is not yet; else leave unopened files alone
+ */
+static int sync_document(lsp_server_t *s, const char *path, int open) {
+    file_view_t view;
+    if (file_cache_get(path, &view) != 0) {
+        return -1;
+    }
+    char *data = malloc(view.size + 1);
+    if (!data) {
+        file_cache_release(&view);
+        return -1;
+    }
+    memcpy(data, view.data, view.size);
+    data[view.size] = '\0';
+    size_t size = view.size;
+    file_cache_release(&view);
+
+    pthread_mutex_lock(&s->lock);
+    if (s->state == STATE_DEAD) {
+        pthread_mutex_unlock(&s->lock);
+        free(data);
+        return -1;
+    }
+    lsp_doc_t *doc = s->docs;
+    while (doc && strcmp(doc->path, path) != 0) {
+        doc = doc->next;
+    }
+
+    cJSON *msg = NULL;
+    if (!doc && open) {
+        const lsp_language_t *lang = language_of(path);
+        doc = calloc(1, sizeof(lsp_doc_t));
+        if (doc && (doc->path = strdup(path)) && (doc->uri = lsp_path_to_uri(path))) {
+            doc->language_id = lang ? lang->language_id : "plaintext";
+            doc->version = 1;
+            cJSON *params = cJSON_CreateObject();
+            cJSON *item = cJSON_AddObjectToObject(params, "textDocument");
+            cJSON_AddStringToObject(item, "uri", doc->uri);
+            cJSON_AddStringToObject(item, "languageId", doc->language_id);
+            cJSON_AddNumberToObject(item, "version", doc->version);
+            cJSON_AddStringToObject(item, "text", data);
+            msg = notification("textDocument/didOpen", params);
+            doc->next = s->docs;
+            s->docs = doc;
+        } else if (doc) {
+            free(doc->path);
+            free(doc);
+            doc = NULL;
+        }
+    } else if (doc && (doc->len != size || memcmp(doc->text, data, size) != 0)) {
+        doc->version++;
+        cJSON *params = cJSON_CreateObject();
+        cJSON *item = cJSON_AddObjectToObject(params, "textDocument");
+        cJSON_AddStringToObject(item, "uri", doc->uri);
+        cJSON_AddNumberToObject(item, "version", doc->version);
+        cJSON *changes = cJSON_AddArrayToObject(params, "contentChanges");
+        cJSON_AddItemToArray(changes, content_change(doc, data, size, s->sync_kind));
+        msg = s->sync_kind ? notification("textDocument/didChange", params) : NULL;
+        if (!msg) {
+            cJSON_Delete(params);
+        }
+    }
+
+    int rc = doc || !open ? 0 : -1;
+    if (doc && (!doc->text || doc->len != size || memcmp(doc->text, data, size) != 0)) {
+        free(doc->text);
+        doc->text = data;
+        doc->len = size;
+        data = NULL;
+    }
+
+    /* Versions must reach the server in order: take the writer before letting go */
+    size_t len = 0;
+    char *framed = msg ? frame(msg, &len) : NULL;
+    if (msg) {
+        pthread_mutex_lock(&s->write_lock);
+    }
+    pthread_mutex_unlock(&s->lock);
+    if (msg) {
+        rc = write_frame_locked(s, framed, len) == 0 ? rc : -1;
+        pthread_mutex_unlock(&s->write_lock);
+    }
+    free(framed);
+    free(data);
+    return rc;
+}
+
+int lsp_sync_document(lsp_server_t *server, const char *path) {
+    char *canonical = realpath(path, NULL);
+    if (!canonical) {
+        return -1;
+    }
+    int rc = sync_document(server, canonical, 1);
+    free(canonical);
+    return rc;
+}
+
+void lsp_pool_file_changed(const char *path) {
+    char *canonical = realpath(path, NULL);
+    if (!canonical || !language_of(canonical)) {
+        free(canonical);
+        return;
+    }
+
+    /* Hold the ready servers, then sync outside the pool lock */
+    lsp_server_t *held[16];
+    int count = 0;
+    pthread_mutex_lock(&g_pool_lock);
+    for (lsp_server_t *s = g_servers; s && count < 16; s = s->next) {
+        s->refs++;
+        held[count++] = s;
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+
+    for (int i = 0; i < count; i++) {
+        pthread_mutex_lock(&held[i]->lock);
+        int ready = held[i]->state == STATE_READY;
+        pthread_mutex_unlock(&held[i]->lock);
+        if (ready) {
+            sync_document(held[i], canonical, 0);
+        }
+        pthread_mutex_lock(&g_pool_lock);
+        server_unref_locked(held[i]);
+        pthread_mutex_unlock(&g_pool_lock);
+    }
+    free(canonical);
+}
+
+/*============================================================================
+ * URIs
+ *============================================================================*/
+
+char *lsp_path_to_uri(const char *path) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t len = strlen(path);
+    char *uri = malloc(7 + len * 3 + 1);
+    if (!uri) {
+        return NULL;
+    }
+    char *p = uri;
+    memcpy(p, "file://", 7);
+    p += 7;
+    for (const unsigned char *c = (const unsigned char *)path; *c; c++) {
+        if ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') ||
+            strchr("/-._~", *c)) {
+            *p++ = (char)*c;
+        } else {
+            *p++ = '%';
+            *p++ = hex[*c >> 4];
+            *p++ = hex[*c & 15];
+        }
+    }
+    *p = '\0';
+    return uri;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+char *lsp_uri_to_path(const char *uri) {
+    if (strncmp(uri, "file://", 7) != 0) {
+        return NULL;
+    }
+    const char *p = strchr(uri + 7, '/');   /* Past an authority such as localhost */
+    if (!p) {
+        return NULL;
+    }
+    char *path = malloc(strlen(p) + 1);
+    if (!path) {
+        return NULL;
+    }
+    char *out = path;
+    for (; *p; p++) {
+        int hi, lo;
+        if (*p == '%' && (hi = hex_value(p[1])) >= 0 && (lo = hex_value(p[2])) >= 0) {
+            *out++ = (char)(hi * 16 + lo);
+            p += 2;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+    return path;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file lsp_client.h
+ * @brief Pool of persistent language server sessions
+ *
+ * Keeps one initialized server per (server, workspace) and reuses it for
+ * every query of the process, so only the first query of a language pays
+ * for the server's start and indexing. Servers talk JSON-RPC over a
+ * socket on their stdin/stdout; a reader thread per server dispatches
+ * responses, so queries from several tool calls can be in flight at once.
+ *
+ * Documents are opened on first use and kept in step with the disk:
+ * before a query, and right after the edit and write tools change a file
+ * (lsp_pool_file_changed()), a changed document is sent as a single
+ * incremental didChange covering the span that differs.
+ *
+ * A server nobody used for LSP_IDLE_TIMEOUT seconds (default 600) is shut
+ * down. The command of a server can be overridden with its environment
+ * variable, e.g. LSP_CLANGD="clangd --background-index".
+ */
+
+#ifndef LSP_CLIENT_H
+#define LSP_CLIENT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct cJSON;
+
+typedef struct lsp_server lsp_server_t;
+
+/**
+ * @brief Server for a file's language in a workspace, started on first use
+ *
+ * Waits for the server's initialize handshake when it is just starting.
+ *
+ * @param workspace  Workspace root the server indexes
+ * @param path       File the query is about (selects the server)
+ * @param server     Receives the server; lsp_pool_release() it
+ * @param err        Receives a message on failure
+ * @return 0, -1 if no server handles the file type, -2 if it could not
+ *         be started or initialized
+ */
+int lsp_pool_acquire(const char *workspace, const char *path, lsp_server_t **server,
+                     char *err, size_t err_size);
+
+/**
+ * @brief Release a server from lsp_pool_acquire()
+ */
+void lsp_pool_release(lsp_server_t *server);
+
+/**
+ * @brief Open a document, or send what changed since it was last sent
+ *
+ * @return 0, -1 if the file cannot be read or the server is gone
+ */
+int lsp_sync_document(lsp_server_t *server, const char *path);
+
+/**
+ * @brief Send a request and wait for its result
+ *
+ * @param params   Request params, taken over (may be NULL)
+ * @param result   Receives the result, possibly a JSON null (cJSON_Delete() it)
+ * @param err      Receives a message on failure
+ * @return 0, -1 on an error response or if the server is gone, -2 on timeout
+ */
+int lsp_request(lsp_server_t *server, const char *method, struct cJSON *params,
+                int timeout_ms, struct cJSON **result, char *err, size_t err_size);
+
+/**
+ * @brief Capabilities the server announced in its initialize result
+ */
+const struct cJSON *lsp_server_capabilities(const lsp_server_t *server);
+
+/**
+ * @brief Name of the server (e.g. "clangd")
+ */
+const char *lsp_server_name(const lsp_server_t *server);
+
+/**
+ * @brief Bring a changed file up to date in the servers that have it open
+ *
+ * Starts nothing; files no server has open are left alone.
+ */
+void lsp_pool_file_changed(const char *path);
+
+/**
+ * @brief Shut every server down
+ */
+void lsp_pool_shutdown(void);
+
+/**
+ * @brief file:// URI of an absolute path (free())
+ */
+char *lsp_path_to_uri(const char *path);
+
+/**
+ * @brief Path of a file:// URI (free()), NULL for other schemes
+ */
+char *lsp_uri_to_path(const char *uri);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LSP_CLIENT_H */
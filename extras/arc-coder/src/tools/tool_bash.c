@@ -1,17 +1,31 @@
 /**
  * @file tool_bash.c
  * @brief Bash Tool Implementation
+ *
+ * Commands run without blocking on their output: each chunk is streamed
+ * to the agent as tool progress while only the head and tail are kept.
+ * A command that outruns the output budget or its timeout is stopped.
  */
 
 #include "code_tools.h"
+#include <arc/platform.h>
 #include <arc/sandbox.h>
+#include <arc/tool.h>
 #include <cJSON.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+extern char **environ;
+
 /*============================================================================
  * Static State
  *============================================================================*/
@@ -106,6 +120,269 @@ static int is_dangerous_command(const char *cmd) {
     return 0;
 }
 
+/*============================================================================
+ * Output Capture
+ *============================================================================*/
+
+#define BASH_DEFAULT_TIMEOUT_MS 120000
+#define BASH_HEAD_BYTES    10000                 /* Output kept from the start */
+#define BASH_TAIL_BYTES    20000                 /* ... and from the end */
+#define BASH_OUTPUT_BUDGET (8u * 1024 * 1024)    /* Output after which the command is stopped */
+#define BASH_KILL_GRACE_MS 2000
+#define BASH_POLL_MS       100
+#define BASH_DRAIN_MS      200                   /* Output still read once the shell exited */
+
+typedef struct {
+    char head[BASH_HEAD_BYTES];
+    size_t head_len;
+    char tail[BASH_TAIL_BYTES];                  /* Ring of the latest output past the head */
+    size_t tail_seen;                            /* Bytes that went past the head */
+    size_t total;
+    volatile int stop;                           /* Budget used up or run cancelled */
+    const ac_tool_ctx_t *ctx;                    /* Tool call being served (may be NULL) */
+} bash_output_t;
+
+/**
+ * @brief Keep a chunk of output and stream it to the agent
+ *
+ * Memory stays bounded however much the command writes: the first bytes
+ * go to the head, the rest through the tail ring.
+ */
+static void output_append(ac_sandbox_stream_t stream, const char *data, size_t len,
+                          void *user_data) {
+    (void)stream;
+    bash_output_t *out = (bash_output_t *)user_data;
+    const char *chunk = data;
+    size_t chunk_len = len;
+
+    if (out->head_len < BASH_HEAD_BYTES) {
+        size_t n = BASH_HEAD_BYTES - out->head_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(out->head + out->head_len, data, n);
+        out->head_len += n;
+        data += n;
+        len -= n;
+    }
+    if (len > BASH_TAIL_BYTES) {
+        out->tail_seen += len - BASH_TAIL_BYTES;
+        data += len - BASH_TAIL_BYTES;
+        len = BASH_TAIL_BYTES;
+    }
+    while (len > 0) {
+        size_t pos = out->tail_seen % BASH_TAIL_BYTES;
+        size_t n = BASH_TAIL_BYTES - pos;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(out->tail + pos, data, n);
+        out->tail_seen += n;
+        data += n;
+        len -= n;
+    }
+    out->total += chunk_len;
+
+    if (out->total >= BASH_OUTPUT_BUDGET || ac_tool_ctx_cancelled(out->ctx)) {
+        out->stop = 1;
+    }
+    if (out->ctx && out->ctx->on_progress) {
+        ac_tool_progress_t progress = {
+            .tool_name = "bash",
+            .progress = (double)out->total,
+            .message = chunk,
+            .message_len = chunk_len
+        };
+        out->ctx->on_progress(&progress, out->ctx->progress_user_data);
+    }
+}
+
+/**
+ * @brief Head and tail of the output, joined by a note of what was left out
+ *
+ * Where the output was cut, the head ends and the tail starts at a line
+ * boundary when there is one.
+ *
+ * @return Malloc'd text, NULL out of memory
+ */
+static char *output_text(const bash_output_t *out, size_t *omitted) {
+    *omitted = 0;
+    if (out->tail_seen <= BASH_TAIL_BYTES) {
+        char *text = malloc(out->head_len + out->tail_seen + 1);
+        if (text) {
+            memcpy(text, out->head, out->head_len);
+            memcpy(text + out->head_len, out->tail, out->tail_seen);
+            text[out->head_len + out->tail_seen] = '\0';
+        }
+        return text;
+    }
+
+    char *tail = malloc(BASH_TAIL_BYTES);
+    if (!tail) {
+        return NULL;
+    }
+    size_t pos = out->tail_seen % BASH_TAIL_BYTES;
+    memcpy(tail, out->tail + pos, BASH_TAIL_BYTES - pos);
+    memcpy(tail + BASH_TAIL_BYTES - pos, out->tail, pos);
+
+    size_t head_len = out->head_len;
+    while (head_len > 0 && out->head[head_len - 1] != '\n') {
+        head_len--;
+    }
+    if (head_len == 0) {
+        head_len = out->head_len;
+    }
+    const char *nl = memchr(tail, '\n', BASH_TAIL_BYTES - 1);
+    size_t skip = nl ? (size_t)(nl + 1 - tail) : 0;
+    *omitted = out->total - head_len - (BASH_TAIL_BYTES - skip);
+
+    char note[96];
+    int note_len = snprintf(note, sizeof(note), "%s... [%zu bytes omitted] ...\n",
+                            head_len > 0 && out->head[head_len - 1] == '\n' ? "" : "\n",
+                            *omitted);
+    char *text = malloc(head_len + (size_t)note_len + BASH_TAIL_BYTES - skip + 1);
+    if (text) {
+        char *p = text;
+        memcpy(p, out->head, head_len);
+        p += head_len;
+        memcpy(p, note, (size_t)note_len);
+        p += note_len;
+        memcpy(p, tail + skip, BASH_TAIL_BYTES - skip);
+        p += BASH_TAIL_BYTES - skip;
+        *p = '\0';
+    }
+    free(tail);
+    return text;
+}
+
+/*============================================================================
+ * Unsandboxed Runner
+ *============================================================================*/
+
+/**
+ * @brief Run a command without a sandbox, as ac_sandbox_exec_ex() would
+ *
+ * /bin/sh runs in its own process group, stdin on /dev/null, stdout and
+ * stderr on one non-blocking pipe read as output arrives. At the deadline,
+ * or once out->stop is set, the group gets SIGTERM and then SIGKILL.
+ *
+ * @return ARC_OK, ARC_ERR_TIMEOUT, ARC_ERR_CANCELLED, or ARC_ERR_IO if
+ *         the shell could not be started
+ */
+static arc_err_t run_unsandboxed(const char *command, int timeout_ms, bash_output_t *out,
+                                 int *exit_code) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return ARC_ERR_IO;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attr);
+    sigset_t all;
+    sigset_t none;
+    sigfillset(&all);
+    sigemptyset(&none);
+
+    int rc = posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    if (rc == 0) rc = posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    if (rc == 0) rc = posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+    if (rc == 0) rc = posix_spawnattr_setpgroup(&attr, 0);
+    if (rc == 0) rc = posix_spawnattr_setsigdefault(&attr, &all);
+    if (rc == 0) rc = posix_spawnattr_setsigmask(&attr, &none);
+    if (rc == 0) {
+        rc = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF |
+                                             POSIX_SPAWN_SETSIGMASK);
+    }
+    pid_t pid = -1;
+    if (rc == 0) {
+        char *const argv[] = { "sh", "-c", (char *)command, NULL };
+        rc = posix_spawn(&pid, "/bin/sh", &actions, &attr, argv, environ);
+    }
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return ARC_ERR_IO;
+    }
+
+    uint64_t now = ac_platform_timestamp_ms();
+    uint64_t deadline = now + (uint64_t)timeout_ms;
+    uint64_t kill_at = 0;
+    uint64_t drain_until = 0;
+    arc_err_t ending = ARC_OK;          /* Why the group was signalled */
+    int fd = fds[0];
+    int status = 0;
+    int status_known = 0;
+    int exited = 0;
+
+    for (;;) {
+        if (!exited) {
+            pid_t r = waitpid(pid, &status, WNOHANG);
+            if (r == pid || (r < 0 && errno != EINTR)) {
+                exited = 1;
+                status_known = r == pid;
+                drain_until = now + BASH_DRAIN_MS;
+            }
+        }
+        /* Background jobs may keep the pipe open; do not wait for them */
+        if (exited && (fd < 0 || now >= drain_until)) {
+            break;
+        }
+
+        if (!exited && ending == ARC_OK && (now >= deadline || out->stop)) {
+            ending = now >= deadline ? ARC_ERR_TIMEOUT : ARC_ERR_CANCELLED;
+            kill(-pid, SIGTERM);
+            kill_at = now + BASH_KILL_GRACE_MS;
+        }
+        if (!exited && kill_at && now >= kill_at) {
+            kill(-pid, SIGKILL);
+            kill_at = 0;
+        }
+
+        if (fd >= 0) {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            if (poll(&pfd, 1, BASH_POLL_MS) > 0) {
+                char buf[4096];
+                ssize_t n;
+                while ((n = read(fd, buf, sizeof(buf))) > 0) {
+                    output_append(AC_SANDBOX_STDOUT, buf, (size_t)n, out);
+                }
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+        } else {
+            /* Output closed; the exit is usually a moment away */
+            struct timespec ts = { 0, 5 * 1000000L };
+            nanosleep(&ts, NULL);
+        }
+        now = ac_platform_timestamp_ms();
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (ending != ARC_OK) {
+        *exit_code = -1;
+        return ending;
+    }
+    if (status_known && WIFEXITED(status)) {
+        *exit_code = WEXITSTATUS(status);
+    } else if (status_known && WIFSIGNALED(status)) {
+        *exit_code = 128 + WTERMSIG(status);
+    } else {
+        *exit_code = -1;
+    }
+    return ARC_OK;
+}
+
 /*============================================================================
  * Bash Tool Implementation
  *============================================================================*/
@@ -122,7 +399,7 @@ const char *bash(
 
     /* Default values */
     const char *cwd = workdir && strlen(workdir) > 0 ? workdir : g_workspace;
-    int timeout_ms = timeout > 0 ? timeout : 120000;
+    int timeout_ms = timeout > 0 ? timeout : BASH_DEFAULT_TIMEOUT_MS;
 
     /* Safety check */
     if (g_safe_mode && is_dangerous_command(command)) {
@@ -135,103 +412,82 @@ const char *bash(
         return json_result(json);
     }
 
-    char *result = NULL;
-    int exit_code = 0;
+    bash_output_t *out = calloc(1, sizeof(bash_output_t));
+    if (!out) {
+        return json_error("Memory allocation failed");
+    }
+    out->ctx = ac_tool_current_ctx();
 
-    /* Sandbox execution if available */
+    int exit_code = 0;
+    arc_err_t err;
     if (g_sandbox) {
-        size_t result_cap = 65536;
-        result = malloc(result_cap);
-        if (!result) {
-            return json_error("Memory allocation failed");
-        }
-        result[0] = '\0';
-
-        arc_err_t err = ac_sandbox_exec(g_sandbox, command, result, result_cap, &exit_code);
-
+        ac_sandbox_exec_opts_t opts = {
+            .timeout_ms = timeout_ms,
+            .on_output = output_append,
+            .user_data = out,
+            .stop = &out->stop,
+        };
+        err = ac_sandbox_exec_ex(g_sandbox, command, &opts, &exit_code);
         if (err == ARC_ERR_INVALID_ARG) {
             cJSON *json = cJSON_CreateObject();
             cJSON_AddStringToObject(json, "error", "Command blocked by sandbox");
             cJSON_AddStringToObject(json, "command", command);
             cJSON_AddStringToObject(json, "reason", ac_sandbox_denial_reason());
-            free(result);
-            return json_result(json);
-        } else if (err == ARC_ERR_TIMEOUT) {
-            cJSON *json = cJSON_CreateObject();
-            cJSON_AddStringToObject(json, "error", "Command timed out");
-            cJSON_AddStringToObject(json, "command", command);
-            cJSON_AddNumberToObject(json, "timeout_ms", timeout_ms);
-            free(result);
+            free(out);
             return json_result(json);
-        } else if (err != ARC_OK) {
-            free(result);
-            return json_error("Failed to execute command in sandbox");
         }
     } else {
-        /* Non-sandbox execution */
-        /* Build command with cd */
-        char full_cmd[8192];
-        snprintf(full_cmd, sizeof(full_cmd), "cd \"%s\" && %s", cwd, command);
-
-        /* Allocate output buffer */
-        size_t result_cap = 65536;
-        size_t result_len = 0;
-        result = malloc(result_cap);
-        if (!result) {
+        size_t full_len = strlen(cwd) + strlen(command) + 16;
+        char *full_cmd = malloc(full_len);
+        if (!full_cmd) {
+            free(out);
             return json_error("Memory allocation failed");
         }
-        result[0] = '\0';
-
-        /* Execute */
-        FILE *fp = popen(full_cmd, "r");
-        if (!fp) {
-            free(result);
-            return json_error("Failed to execute command");
-        }
-
-        char buffer[256];
-        while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-            size_t len = strlen(buffer);
-            if (result_len + len + 1 > result_cap) {
-                result_cap *= 2;
-                char *new_result = realloc(result, result_cap);
-                if (!new_result) {
-                    free(result);
-                    pclose(fp);
-                    return json_error("Memory allocation failed");
-                }
-                result = new_result;
-            }
-            strcpy(result + result_len, buffer);
-            result_len += len;
-        }
-
-        int status = pclose(fp);
-        exit_code = WEXITSTATUS(status);
+        snprintf(full_cmd, full_len, "cd \"%s\" && %s", cwd, command);
+        err = run_unsandboxed(full_cmd, timeout_ms, out, &exit_code);
+        free(full_cmd);
+    }
+    if (err != ARC_OK && err != ARC_ERR_TIMEOUT && err != ARC_ERR_CANCELLED) {
+        free(out);
+        return json_error(g_sandbox ? "Failed to execute command in sandbox"
+                                    : "Failed to execute command");
     }
 
-    /* Truncate if too long */
-    const long unsigned int MAX_OUTPUT = 30000;
-    int truncated = 0;
-    if (strlen(result) > MAX_OUTPUT) {
-        result[MAX_OUTPUT] = '\0';
-        truncated = 1;
+    size_t omitted;
+    char *output = output_text(out, &omitted);
+    if (!output) {
+        free(out);
+        return json_error("Memory allocation failed");
     }
 
     /* Build response */
     cJSON *json = cJSON_CreateObject();
+    if (err == ARC_ERR_TIMEOUT) {
+        cJSON_AddStringToObject(json, "error", "Command timed out");
+        cJSON_AddNumberToObject(json, "timeout_ms", timeout_ms);
+    } else if (err == ARC_ERR_CANCELLED && out->total >= BASH_OUTPUT_BUDGET) {
+        cJSON_AddStringToObject(json, "error", "Command stopped: output budget exceeded");
+        cJSON_AddNumberToObject(json, "output_budget", BASH_OUTPUT_BUDGET);
+    } else if (err == ARC_ERR_CANCELLED) {
+        cJSON_AddStringToObject(json, "error", "Command cancelled");
+    }
     cJSON_AddStringToObject(json, "command", command);
     cJSON_AddNumberToObject(json, "exit_code", exit_code);
-    cJSON_AddStringToObject(json, "output", result);
+    cJSON_AddStringToObject(json, "output", output);    /* Captured up to the kill, if any */
     if (description && strlen(description) > 0) {
         cJSON_AddStringToObject(json, "description", description);
     }
-    if (truncated) {
+    if (omitted > 0) {
+        char note[160];
+        snprintf(note, sizeof(note),
+                 "Output was %zu bytes; %zu bytes in the middle were omitted",
+                 out->total, omitted);
         cJSON_AddBoolToObject(json, "truncated", 1);
-        cJSON_AddStringToObject(json, "truncation_note",
-            "Output exceeded 30000 characters and was truncated");
+        cJSON_AddNumberToObject(json, "output_bytes", (double)out->total);
+        cJSON_AddStringToObject(json, "truncation_note", note);
     }
 
-    free(result);
+    free(output);
+    free(out);
     return json_result(json);
 }
@@ -3,9 +3,12 @@
  * @brief Edit Tool Implementation
  *
  * Implements string replacement editing following opencode's approach.
+ * The file is searched in place through file_cache.c's mapping.
  */
 
 #include "code_tools.h"
+#include "file_cache.h"
+#include "lsp_client.h"
 #include <arc/sandbox.h>
 #include <cJSON.h>
 #include <stdio.h>
@@ -56,15 +59,32 @@ static const char *json_error_edit(const char *msg) {
     return json_result_edit(json);
 }
 
+/* Next occurrence of needle in [p, end), or NULL */
+static const char *find_bytes(const char *p, const char *end, const char *needle,
+                              size_t needle_len) {
+    while ((size_t)(end - p) >= needle_len) {
+        p = memchr(p, needle[0], (size_t)(end - p) - needle_len + 1);
+        if (!p) {
+            return NULL;
+        }
+        if (memcmp(p, needle, needle_len) == 0) {
+            return p;
+        }
+        p++;
+    }
+    return NULL;
+}
+
 /* Count occurrences of a substring */
-static int count_occurrences(const char *haystack, const char *needle) {
+static int count_occurrences(const char *data, size_t size, const char *needle) {
     int count = 0;
     size_t needle_len = strlen(needle);
 
     if (needle_len == 0) return 0;
 
-    const char *p = haystack;
-    while ((p = strstr(p, needle)) != NULL) {
+    const char *end = data + size;
+    const char *p = data;
+    while ((p = find_bytes(p, end, needle, needle_len)) != NULL) {
         count++;
         p += needle_len;
     }
@@ -72,58 +92,29 @@ static int count_occurrences(const char *haystack, const char *needle) {
     return count;
 }
 
-/* Replace first occurrence */
-static char *replace_first(const char *content, const char *old_str, const char *new_str) {
-    const char *pos = strstr(content, old_str);
-    if (!pos) return NULL;
-
-    size_t content_len = strlen(content);
+/* Replace the first occurrence, or all of them (count of them) */
+static char *replace(const char *data, size_t size, const char *old_str, const char *new_str,
+                     int count, size_t *result_len) {
     size_t old_len = strlen(old_str);
     size_t new_len = strlen(new_str);
-    size_t result_len = content_len - old_len + new_len;
+    *result_len = size - (size_t)count * old_len + (size_t)count * new_len;
 
-    char *result = malloc(result_len + 1);
-    if (!result) return NULL;
-
-    /* Copy prefix */
-    size_t prefix_len = pos - content;
-    memcpy(result, content, prefix_len);
-
-    /* Copy replacement */
-    memcpy(result + prefix_len, new_str, new_len);
-
-    /* Copy suffix */
-    memcpy(result + prefix_len + new_len, pos + old_len, content_len - prefix_len - old_len + 1);
-
-    return result;
-}
-
-/* Replace all occurrences */
-static char *replace_all(const char *content, const char *old_str, const char *new_str) {
-    int count = count_occurrences(content, old_str);
-    if (count == 0) return NULL;
-
-    size_t content_len = strlen(content);
-    size_t old_len = strlen(old_str);
-    size_t new_len = strlen(new_str);
-    size_t result_len = content_len + count * ((int)new_len - (int)old_len);
-
-    char *result = malloc(result_len + 1);
+    char *result = malloc(*result_len + 1);
     if (!result) return NULL;
 
     char *dst = result;
-    const char *src = content;
-
-    while (*src) {
-        if (strncmp(src, old_str, old_len) == 0) {
-            memcpy(dst, new_str, new_len);
-            dst += new_len;
-            src += old_len;
-        } else {
-            *dst++ = *src++;
-        }
-    }
-    *dst = '\0';
+    const char *src = data;
+    const char *end = data + size;
+    for (int i = 0; i < count; i++) {
+        const char *pos = find_bytes(src, end, old_str, old_len);
+        memcpy(dst, src, (size_t)(pos - src));
+        dst += pos - src;
+        memcpy(dst, new_str, new_len);
+        dst += new_len;
+        src = pos + old_len;
+    }
+    memcpy(dst, src, (size_t)(end - src));
+    result[*result_len] = '\0';
 
     return result;
 }
@@ -167,33 +158,23 @@ const char *edit_file(
     }
 
     /* Read file */
-    FILE *fp = fopen(filePath, "r");
-    if (!fp) {
+    file_view_t view;
+    int rc = file_cache_get(filePath, &view);
+    if (rc == -3) {
+        return json_error_edit("Memory allocation failed");
+    }
+    if (rc != 0) {
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error", "File not found");
         cJSON_AddStringToObject(json, "path", filePath);
         return json_result_edit(json);
     }
 
-    fseek(fp, 0, SEEK_END);
-    long file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
-    char *content = malloc(file_size + 1);
-    if (!content) {
-        fclose(fp);
-        return json_error_edit("Memory allocation failed");
-    }
-
-    size_t read_size = fread(content, 1, file_size, fp);
-    content[read_size] = '\0';
-    fclose(fp);
-
     /* Count occurrences */
-    int occurrences = count_occurrences(content, oldString);
+    int occurrences = count_occurrences(view.data, view.size, oldString);
 
     if (occurrences == 0) {
-        free(content);
+        file_cache_release(&view);
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error", "oldString not found in file");
         cJSON_AddStringToObject(json, "path", filePath);
@@ -204,7 +185,7 @@ const char *edit_file(
 
     /* Check for multiple occurrences without replaceAll */
     if (occurrences > 1 && !replaceAll) {
-        free(content);
+        file_cache_release(&view);
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error",
             "oldString found multiple times - provide more context or use replaceAll");
@@ -217,34 +198,28 @@ const char *edit_file(
     }
 
     /* Perform replacement */
-    char *new_content;
-    int replacements;
-
-    if (replaceAll) {
-        new_content = replace_all(content, oldString, newString);
-        replacements = occurrences;
-    } else {
-        new_content = replace_first(content, oldString, newString);
-        replacements = 1;
-    }
-
-    free(content);
+    int replacements = replaceAll ? occurrences : 1;
+    size_t new_len;
+    char *new_content = replace(view.data, view.size, oldString, newString, replacements,
+                                &new_len);
+    file_cache_release(&view);
 
     if (!new_content) {
         return json_error_edit("Failed to perform replacement");
     }
 
     /* Write back */
-    fp = fopen(filePath, "w");
+    FILE *fp = fopen(filePath, "w");
     if (!fp) {
         free(new_content);
         return json_error_edit("Failed to open file for writing");
     }
 
-    size_t new_len = strlen(new_content);
     size_t written = fwrite(new_content, 1, new_len, fp);
     fclose(fp);
     free(new_content);
+    file_cache_invalidate(filePath);
+    lsp_pool_file_changed(filePath);
 
     if (written != new_len) {
         return json_error_edit("Failed to write complete content");
@@ -2,10 +2,15 @@
  * @file tool_grep.c
  * @brief Grep Tool Implementation
  *
- * Content search using regex patterns.
+ * Content search using regex patterns (grep_engine.c does the search,
+ * trigram_index.c narrows it for the workspace), and file name globbing.
  */
 
 #include "code_tools.h"
+#include "grep_engine.h"
+#include "trigram_index.h"
+#include <arc/env.h>
+#include <arc/platform.h>
 #include <arc/sandbox.h>
 #include <cJSON.h>
 #include <stdio.h>
@@ -14,7 +19,7 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <fnmatch.h>
-#include <regex.h>
+#include <pthread.h>
 
 /*============================================================================
  * External State
@@ -27,7 +32,8 @@ extern struct ac_sandbox *code_tools_get_sandbox(void);
  * Helper Functions
  *============================================================================*/
 
-static char g_grep_result_buffer[131072];  /* 128KB */
+/* Per thread: read-only tools run concurrently (@parallel_safe) */
+static ARC_THREAD_LOCAL char g_grep_result_buffer[131072];  /* 128KB */
 
 static const char *json_result_grep(cJSON *json) {
     if (!json) {
@@ -60,116 +66,48 @@ static const char *json_error_grep(const char *msg) {
     return json_result_grep(json);
 }
 
-/* Check if file matches include pattern */
-static int matches_include(const char *filename, const char *include) {
-    if (!include || strlen(include) == 0) return 1;  /* No filter = match all */
-
-    return fnmatch(include, filename, FNM_NOESCAPE) == 0;
-}
-
-/* Search a single file */
-static void search_file(
-    const char *filepath,
-    regex_t *regex,
-    cJSON *matches,
-    int *match_count,
-    int max_matches
-) {
-    if (*match_count >= max_matches) return;
-
-    FILE *fp = fopen(filepath, "r");
-    if (!fp) return;
-
-    char line[4096];
-    int line_num = 0;
-    int file_matches = 0;
-
-    while (fgets(line, sizeof(line), fp) && *match_count < max_matches) {
-        line_num++;
-
-        /* Remove trailing newline */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') {
-            line[len - 1] = '\0';
-            len--;
-        }
-
-        /* Check for match */
-        if (regexec(regex, line, 0, NULL, 0) == 0) {
-            cJSON *match = cJSON_CreateObject();
-            cJSON_AddStringToObject(match, "file", filepath);
-            cJSON_AddNumberToObject(match, "line", line_num);
+/*============================================================================
+ * Workspace Index
+ *============================================================================*/
 
-            /* Truncate long lines */
-            if (len > 200) {
-                line[200] = '\0';
-                strcat(line, "...");
-            }
-            cJSON_AddStringToObject(match, "content", line);
+static pthread_mutex_t g_index_lock = PTHREAD_MUTEX_INITIALIZER;
+static trigram_index_t *g_index;     /* Guarded by g_index_lock */
 
-            cJSON_AddItemToArray(matches, match);
-            (*match_count)++;
-            file_matches++;
-        }
+/**
+ * @brief Files under dir that may match, from the workspace's trigram index
+ *
+ * @return 1 with the candidates, 0 to walk dir instead (outside the
+ *         workspace, pattern without usable literals, CODE_INDEX=false)
+ */
+static int index_candidates(const char *pattern, const char *dir, char ***files,
+                            size_t *count) {
+    const char *enabled = ac_env_get("CODE_INDEX", "true");
+    if (enabled && (strcmp(enabled, "false") == 0 || strcmp(enabled, "0") == 0)) {
+        return 0;
     }
-
-    fclose(fp);
-}
-
-/* Recursively search directory */
-static void search_directory(
-    const char *dir_path,
-    regex_t *regex,
-    const char *include,
-    cJSON *matches,
-    int *match_count,
-    int max_matches,
-    int depth
-) {
-    if (*match_count >= max_matches || depth > 20) return;
-
-    DIR *dir = opendir(dir_path);
-    if (!dir) return;
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) && *match_count < max_matches) {
-        /* Skip . and .. */
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
+    char *workspace = realpath(code_tools_get_workspace(), NULL);
+    char *target = realpath(dir, NULL);
+    int rc = 0;
+    size_t len = workspace ? strlen(workspace) : 0;
+    if (workspace && target && strncmp(target, workspace, len) == 0 &&
+        (target[len] == '\0' || target[len] == '/')) {
+        pthread_mutex_lock(&g_index_lock);
+        if (g_index && strcmp(trigram_index_root(g_index), workspace) != 0) {
+            trigram_index_close(g_index);
+            g_index = NULL;
         }
-
-        /* Skip hidden files/dirs */
-        if (entry->d_name[0] == '.') {
-            continue;
-        }
-
-        /* Skip common non-code directories */
-        if (strcmp(entry->d_name, "node_modules") == 0 ||
-            strcmp(entry->d_name, "__pycache__") == 0 ||
-            strcmp(entry->d_name, ".git") == 0 ||
-            strcmp(entry->d_name, "build") == 0 ||
-            strcmp(entry->d_name, "dist") == 0 ||
-            strcmp(entry->d_name, "vendor") == 0) {
-            continue;
+        if (!g_index) {
+            g_index = trigram_index_open(workspace);
         }
-
-        char full_path[4096];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
-
-        struct stat st;
-        if (stat(full_path, &st) != 0) continue;
-
-        if (S_ISDIR(st.st_mode)) {
-            search_directory(full_path, regex, include, matches, match_count, max_matches, depth + 1);
-        } else if (S_ISREG(st.st_mode)) {
-            /* Check include pattern */
-            if (matches_include(entry->d_name, include)) {
-                search_file(full_path, regex, matches, match_count, max_matches);
-            }
+        if (g_index && trigram_index_refresh(g_index) == 0) {
+            const char *rel = target[len] == '/' ? target + len + 1 : "";
+            rc = trigram_index_candidates(g_index, pattern, 0, rel, files, count) == 1;
         }
+        pthread_mutex_unlock(&g_index_lock);
     }
-
-    closedir(dir);
+    free(workspace);
+    free(target);
+    return rc;
 }
 
 /*============================================================================
@@ -200,41 +138,45 @@ const char *grep(
         }
     }
 
-    /* Compile regex */
-    regex_t regex;
-    int ret = regcomp(&regex, pattern, REG_EXTENDED | REG_ICASE | REG_NEWLINE);
-    if (ret != 0) {
-        char error_buf[256];
-        regerror(ret, &regex, error_buf, sizeof(error_buf));
-
+    /* Search, only the files the index cannot rule out when there is one */
+    grep_options_t options = { .include = include };
+    char **candidates = NULL;
+    size_t candidate_count = 0;
+    struct stat st;
+    int indexed = stat(search_path, &st) == 0 && S_ISDIR(st.st_mode) &&
+                  index_candidates(pattern, search_path, &candidates, &candidate_count);
+    if (indexed) {
+        options.files = (const char *const *)candidates;
+        options.file_count = candidate_count;
+    }
+    grep_result_t result;
+    int rc = grep_engine_run(pattern, search_path, &options, &result);
+    trigram_index_free_list(candidates, candidate_count);
+    if (rc == -1) {
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error", "Invalid regex pattern");
         cJSON_AddStringToObject(json, "pattern", pattern);
-        cJSON_AddStringToObject(json, "reason", error_buf);
+        cJSON_AddStringToObject(json, "reason", result.error);
         return json_result_grep(json);
     }
-
-    /* Search */
-    cJSON *matches = cJSON_CreateArray();
-    int match_count = 0;
-    const int MAX_MATCHES = 500;
-
-    struct stat st;
-    if (stat(search_path, &st) != 0) {
-        regfree(&regex);
+    if (rc == -2) {
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error", "Path not found");
         cJSON_AddStringToObject(json, "path", search_path);
         return json_result_grep(json);
     }
-
-    if (S_ISDIR(st.st_mode)) {
-        search_directory(search_path, &regex, include, matches, &match_count, MAX_MATCHES, 0);
-    } else {
-        search_file(search_path, &regex, matches, &match_count, MAX_MATCHES);
+    if (rc != 0) {
+        return json_error_grep("Out of memory");
     }
 
-    regfree(&regex);
+    cJSON *matches = cJSON_CreateArray();
+    for (int i = 0; i < result.count; i++) {
+        cJSON *match = cJSON_CreateObject();
+        cJSON_AddStringToObject(match, "file", result.matches[i].file);
+        cJSON_AddNumberToObject(match, "line", result.matches[i].line);
+        cJSON_AddStringToObject(match, "content", result.matches[i].content);
+        cJSON_AddItemToArray(matches, match);
+    }
 
     /* Build response */
     cJSON *json = cJSON_CreateObject();
@@ -243,13 +185,18 @@ const char *grep(
     if (include && strlen(include) > 0) {
         cJSON_AddStringToObject(json, "include", include);
     }
-    cJSON_AddNumberToObject(json, "match_count", match_count);
+    cJSON_AddNumberToObject(json, "match_count", result.count);
+    cJSON_AddNumberToObject(json, "files_searched", (double)result.files);
+    if (indexed) {
+        cJSON_AddBoolToObject(json, "indexed", 1);
+    }
     cJSON_AddItemToObject(json, "matches", matches);
 
-    if (match_count >= MAX_MATCHES) {
+    if (result.truncated) {
         cJSON_AddBoolToObject(json, "truncated", 1);
         cJSON_AddStringToObject(json, "note", "Results truncated at 500 matches");
     }
+    grep_result_free(&result);
 
     return json_result_grep(json);
 }
@@ -4,6 +4,7 @@
  */
 
 #include "code_tools.h"
+#include <arc/platform.h>
 #include <arc/sandbox.h>
 #include <cJSON.h>
 #include <stdio.h>
@@ -24,7 +25,8 @@ extern struct ac_sandbox *code_tools_get_sandbox(void);
  * Helper Functions
  *============================================================================*/
 
-static char g_ls_result_buffer[65536];
+/* Per thread: read-only tools run concurrently (@parallel_safe) */
+static ARC_THREAD_LOCAL char g_ls_result_buffer[65536];
 
 static const char *json_result_ls(cJSON *json) {
     if (!json) {
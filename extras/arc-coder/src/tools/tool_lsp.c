@@ -0,0 +1,479 @@
+/**
+ * @file tool_lsp.c
+ * @brief LSP Tool Implementation
+ *
+ * Queries go to the persistent servers of lsp_client.c: the first query
+ * of a language in a workspace starts and initializes its server, later
+ * ones reuse it and only send what changed in the file queried.
+ */
+
+#include "code_tools.h"
+#include "file_cache.h"
+#include "lsp_client.h"
+#include <arc/platform.h>
+#include <arc/sandbox.h>
+#include <cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LSP_REQUEST_TIMEOUT_MS 30000     /* A fresh server may still be indexing */
+#define LSP_MAX_RESULTS        200
+#define LSP_MAX_LINE_TEXT      200
+
+/*============================================================================
+ * External State (from tool_bash.c)
+ *============================================================================*/
+
+extern const char *code_tools_get_workspace(void);
+extern struct ac_sandbox *code_tools_get_sandbox(void);
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+/* Per thread: read-only tools run concurrently (@parallel_safe) */
+static ARC_THREAD_LOCAL char g_lsp_result_buffer[131072];  /* 128KB */
+
+static const char *json_result_lsp(cJSON *json) {
+    if (!json) {
+        return "{\"error\": \"Failed to create response\"}";
+    }
+
+    char *str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+
+    if (!str) {
+        return "{\"error\": \"Failed to serialize response\"}";
+    }
+
+    size_t len = strlen(str);
+    if (len >= sizeof(g_lsp_result_buffer)) {
+        len = sizeof(g_lsp_result_buffer) - 1;
+    }
+    memcpy(g_lsp_result_buffer, str, len);
+    g_lsp_result_buffer[len] = '\0';
+
+    free(str);
+    return g_lsp_result_buffer;
+}
+
+static const char *json_error_lsp(const char *msg) {
+    cJSON *json = cJSON_CreateObject();
+    if (json) {
+        cJSON_AddStringToObject(json, "error", msg);
+    }
+    return json_result_lsp(json);
+}
+
+static const char *SYMBOL_KINDS[] = {
+    "", "file", "module", "namespace", "package", "class", "method", "property",
+    "field", "constructor", "enum", "interface", "function", "variable", "constant",
+    "string", "number", "boolean", "array", "object", "key", "null", "enum member",
+    "struct", "event", "operator", "type parameter"
+};
+
+static const char *symbol_kind(const cJSON *item) {
+    const cJSON *kind = cJSON_GetObjectItem(item, "kind");
+    int k = cJSON_IsNumber(kind) ? kind->valueint : 0;
+    return k > 0 && k < (int)(sizeof(SYMBOL_KINDS) / sizeof(SYMBOL_KINDS[0])) ? SYMBOL_KINDS[k]
+                                                                               : "symbol";
+}
+
+/*============================================================================
+ * Results
+ *============================================================================*/
+
+typedef struct {
+    cJSON *results;
+    int count;
+    int truncated;
+} result_list_t;
+
+/** Add a location, with its line's text, to the results; returns the entry */
+static cJSON *add_location(result_list_t *list, const char *uri, const cJSON *range) {
+    if (list->count >= LSP_MAX_RESULTS) {
+        list->truncated = 1;
+        return NULL;
+    }
+    const cJSON *start = cJSON_GetObjectItem(range, "start");
+    const cJSON *line = cJSON_GetObjectItem(start, "line");
+    const cJSON *character = cJSON_GetObjectItem(start, "character");
+    char *path = uri ? lsp_uri_to_path(uri) : NULL;
+    if (!cJSON_IsNumber(line)) {
+        free(path);
+        return NULL;
+    }
+
+    cJSON *entry = cJSON_CreateObject();
+    cJSON_AddStringToObject(entry, "path", path ? path : (uri ? uri : ""));
+    cJSON_AddNumberToObject(entry, "line", line->valueint + 1);
+    cJSON_AddNumberToObject(entry, "character",
+                            cJSON_IsNumber(character) ? character->valueint + 1 : 1);
+
+    file_view_t view;
+    if (path && file_cache_get(path, &view) == 0) {
+        if (line->valueint >= 0 && (size_t)line->valueint < view.line_count) {
+            const char *text;
+            size_t len;
+            file_view_line(&view, (size_t)line->valueint, &text, &len);
+            while (len > 0 && (*text == ' ' || *text == '\t')) {
+                text++;
+                len--;
+            }
+            while (len > 0 && (text[len - 1] == '\r' || text[len - 1] == ' ')) {
+                len--;
+            }
+            char snippet[LSP_MAX_LINE_TEXT + 4];
+            int truncated = len > LSP_MAX_LINE_TEXT;
+            snprintf(snippet, sizeof(snippet), "%.*s%s",
+                     (int)(truncated ? LSP_MAX_LINE_TEXT : len), text, truncated ? "..." : "");
+            cJSON_AddStringToObject(entry, "text", snippet);
+        }
+        file_cache_release(&view);
+    }
+    free(path);
+
+    cJSON_AddItemToArray(list->results, entry);
+    list->count++;
+    return entry;
+}
+
+/** Location | Location[] | LocationLink[] | null */
+static void add_locations(result_list_t *list, const cJSON *result) {
+    if (cJSON_IsObject(result)) {
+        const cJSON *uri = cJSON_GetObjectItem(result, "uri");
+        if (cJSON_IsString(uri)) {
+            add_location(list, uri->valuestring, cJSON_GetObjectItem(result, "range"));
+        }
+        return;
+    }
+    const cJSON *item;
+    cJSON_ArrayForEach(item, result) {
+        const cJSON *uri = cJSON_GetObjectItem(item, "uri");
+        const cJSON *target = cJSON_GetObjectItem(item, "targetUri");
+        if (cJSON_IsString(uri)) {
+            add_location(list, uri->valuestring, cJSON_GetObjectItem(item, "range"));
+        } else if (cJSON_IsString(target)) {
+            add_location(list, target->valuestring,
+                         cJSON_GetObjectItem(item, "targetSelectionRange"));
+        }
+    }
+}
+
+/** A named item (symbol, call hierarchy item) with its kind */
+static void add_symbol(result_list_t *list, const char *uri, const cJSON *item,
+                       const cJSON *range, const char *container) {
+    cJSON *entry = add_location(list, uri, range);
+    if (!entry) {
+        return;
+    }
+    const cJSON *name = cJSON_GetObjectItem(item, "name");
+    const cJSON *detail = cJSON_GetObjectItem(item, "detail");
+    cJSON_AddStringToObject(entry, "name", cJSON_IsString(name) ? name->valuestring : "");
+    cJSON_AddStringToObject(entry, "kind", symbol_kind(item));
+    if (cJSON_IsString(detail) && detail->valuestring[0]) {
+        cJSON_AddStringToObject(entry, "detail", detail->valuestring);
+    }
+    if (container && container[0]) {
+        cJSON_AddStringToObject(entry, "container", container);
+    }
+}
+
+/** DocumentSymbol[] (nested under children) */
+static void add_document_symbols(result_list_t *list, const char *uri, const cJSON *symbols,
+                                 const char *container) {
+    const cJSON *item;
+    cJSON_ArrayForEach(item, symbols) {
+        const cJSON *range = cJSON_GetObjectItem(item, "selectionRange");
+        add_symbol(list, uri, item, range ? range : cJSON_GetObjectItem(item, "range"), container);
+        const cJSON *name = cJSON_GetObjectItem(item, "name");
+        add_document_symbols(list, uri, cJSON_GetObjectItem(item, "children"),
+                             cJSON_IsString(name) ? name->valuestring : NULL);
+    }
+}
+
+/** DocumentSymbol[] or SymbolInformation[] */
+static void add_symbols(result_list_t *list, const char *uri, const cJSON *result) {
+    const cJSON *item;
+    cJSON_ArrayForEach(item, result) {
+        const cJSON *location = cJSON_GetObjectItem(item, "location");
+        if (!location) {
+            add_document_symbols(list, uri, result, NULL);
+            return;
+        }
+        const cJSON *item_uri = cJSON_GetObjectItem(location, "uri");
+        const cJSON *container = cJSON_GetObjectItem(item, "containerName");
+        add_symbol(list, cJSON_IsString(item_uri) ? item_uri->valuestring : uri, item,
+                   cJSON_GetObjectItem(location, "range"),
+                   cJSON_IsString(container) ? container->valuestring : NULL);
+    }
+}
+
+/** Hover contents: MarkupContent | MarkedString | MarkedString[] */
+static void append_hover(cJSON *json, const cJSON *result) {
+    const cJSON *contents = cJSON_GetObjectItem(result, "contents");
+    size_t cap = 4096;
+    size_t len = 0;
+    char *text = malloc(cap);
+    if (!text) {
+        return;
+    }
+    text[0] = '\0';
+
+    const cJSON *parts = cJSON_IsArray(contents) ? contents : NULL;
+    const cJSON *part = parts ? parts->child : contents;
+    for (; part; part = parts ? part->next : NULL) {
+        const cJSON *value = cJSON_IsString(part) ? part : cJSON_GetObjectItem(part, "value");
+        if (cJSON_IsString(value)) {
+            size_t n = strlen(value->valuestring);
+            if (len + n + 2 > cap) {
+                while (len + n + 2 > cap) {
+                    cap *= 2;
+                }
+                char *grown = realloc(text, cap);
+                if (!grown) {
+                    break;
+                }
+                text = grown;
+            }
+            len += (size_t)snprintf(text + len, cap - len, "%s%s", len ? "\n" : "",
+                                    value->valuestring);
+        }
+        if (!parts) {
+            break;
+        }
+    }
+    cJSON_AddStringToObject(json, "contents", text);
+    free(text);
+}
+
+/*============================================================================
+ * Operations
+ *============================================================================*/
+
+typedef struct {
+    const char *operation;
+    const char *method;
+    const char *capability;          /* Server capability it needs */
+    int needs_position;
+} lsp_operation_t;
+
+static const lsp_operation_t OPERATIONS[] = {
+    { "goToDefinition",       "textDocument/definition",           "definitionProvider",      1 },
+    { "findReferences",       "textDocument/references",           "referencesProvider",      1 },
+    { "hover",                "textDocument/hover",                "hoverProvider",           1 },
+    { "documentSymbol",       "textDocument/documentSymbol",       "documentSymbolProvider",  0 },
+    { "workspaceSymbol",      "workspace/symbol",                  "workspaceSymbolProvider", 0 },
+    { "goToImplementation",   "textDocument/implementation",       "implementationProvider",  1 },
+    { "prepareCallHierarchy", "textDocument/prepareCallHierarchy", "callHierarchyProvider",   1 },
+    { "incomingCalls",        "callHierarchy/incomingCalls",       "callHierarchyProvider",   1 },
+    { "outgoingCalls",        "callHierarchy/outgoingCalls",       "callHierarchyProvider",   1 },
+};
+
+static const lsp_operation_t *find_operation(const char *name) {
+    for (size_t i = 0; i < sizeof(OPERATIONS) / sizeof(OPERATIONS[0]); i++) {
+        if (strcmp(OPERATIONS[i].operation, name) == 0) {
+            return &OPERATIONS[i];
+        }
+    }
+    return NULL;
+}
+
+static int has_capability(const lsp_server_t *server, const char *name) {
+    const cJSON *cap = cJSON_GetObjectItem(lsp_server_capabilities(server), name);
+    return cap && !cJSON_IsFalse(cap) && !cJSON_IsNull(cap);
+}
+
+static cJSON *document_params(const char *uri) {
+    cJSON *params = cJSON_CreateObject();
+    cJSON_AddStringToObject(cJSON_AddObjectToObject(params, "textDocument"), "uri", uri);
+    return params;
+}
+
+static cJSON *position_params(const char *uri, int line, int character) {
+    cJSON *params = document_params(uri);
+    cJSON *position = cJSON_AddObjectToObject(params, "position");
+    cJSON_AddNumberToObject(position, "line", line - 1);
+    cJSON_AddNumberToObject(position, "character", character - 1);
+    return params;
+}
+
+/** Params of the request, NULL if incoming/outgoing calls have no item there */
+static cJSON *request_params(lsp_server_t *server, const lsp_operation_t *op, const char *uri,
+                             int line, int character, const char *query, char *err,
+                             size_t err_size, int *rc) {
+    *rc = 0;
+    if (strcmp(op->method, "workspace/symbol") == 0) {
+        cJSON *params = cJSON_CreateObject();
+        cJSON_AddStringToObject(params, "query", query ? query : "");
+        return params;
+    }
+    if (!op->needs_position) {
+        return document_params(uri);
+    }
+    cJSON *params = position_params(uri, line, character);
+    if (strcmp(op->method, "textDocument/references") == 0) {
+        cJSON_AddBoolToObject(cJSON_AddObjectToObject(params, "context"), "includeDeclaration", 1);
+    }
+    if (strncmp(op->method, "callHierarchy/", 14) != 0) {
+        return params;
+    }
+
+    /* Calls start from the item prepared at the position */
+    cJSON *items = NULL;
+    *rc = lsp_request(server, "textDocument/prepareCallHierarchy", params,
+                      LSP_REQUEST_TIMEOUT_MS, &items, err, err_size);
+    if (*rc != 0) {
+        return NULL;
+    }
+    cJSON *item = cJSON_IsArray(items) ? cJSON_DetachItemFromArray(items, 0) : NULL;
+    cJSON_Delete(items);
+    if (!item) {
+        return NULL;
+    }
+    cJSON *call_params = cJSON_CreateObject();
+    cJSON_AddItemToObject(call_params, "item", item);
+    return call_params;
+}
+
+static void add_result(result_list_t *list, cJSON *json, const lsp_operation_t *op,
+                       const char *uri, const cJSON *result) {
+    if (strcmp(op->operation, "hover") == 0) {
+        append_hover(json, result);
+    } else if (strcmp(op->operation, "documentSymbol") == 0 ||
+               strcmp(op->operation, "workspaceSymbol") == 0) {
+        add_symbols(list, uri, result);
+    } else if (strcmp(op->operation, "prepareCallHierarchy") == 0) {
+        const cJSON *item;
+        cJSON_ArrayForEach(item, result) {
+            const cJSON *item_uri = cJSON_GetObjectItem(item, "uri");
+            add_symbol(list, cJSON_IsString(item_uri) ? item_uri->valuestring : uri, item,
+                       cJSON_GetObjectItem(item, "selectionRange"), NULL);
+        }
+    } else if (strncmp(op->method, "callHierarchy/", 14) == 0) {
+        const char *key = strcmp(op->operation, "incomingCalls") == 0 ? "from" : "to";
+        const cJSON *call;
+        cJSON_ArrayForEach(call, result) {
+            const cJSON *item = cJSON_GetObjectItem(call, key);
+            const cJSON *item_uri = cJSON_GetObjectItem(item, "uri");
+            add_symbol(list, cJSON_IsString(item_uri) ? item_uri->valuestring : uri, item,
+                       cJSON_GetObjectItem(item, "selectionRange"), NULL);
+        }
+    } else {
+        add_locations(list, result);
+    }
+}
+
+/*============================================================================
+ * LSP Tool Implementation
+ *============================================================================*/
+
+const char *lsp(
+    const char *operation,
+    const char *filePath,
+    int line,
+    int character,
+    const char *query
+) {
+    if (!operation || !operation[0]) {
+        return json_error_lsp("operation parameter is required");
+    }
+    if (!filePath || !filePath[0]) {
+        return json_error_lsp("filePath parameter is required");
+    }
+    const lsp_operation_t *op = find_operation(operation);
+    if (!op) {
+        return json_error_lsp("Unknown operation");
+    }
+    if (op->needs_position && (line < 1 || character < 1)) {
+        return json_error_lsp("line and character (1-based) are required for this operation");
+    }
+
+    /* Sandbox check */
+    ac_sandbox_t *sandbox = code_tools_get_sandbox();
+    if (sandbox && !ac_sandbox_check_path(sandbox, filePath, AC_SANDBOX_PERM_FS_READ)) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "File access blocked by sandbox");
+        cJSON_AddStringToObject(json, "path", filePath);
+        cJSON_AddStringToObject(json, "reason", ac_sandbox_denial_reason());
+        return json_result_lsp(json);
+    }
+
+    const char *workspace = code_tools_get_workspace();
+    char err[512];
+    lsp_server_t *server = NULL;
+    if (lsp_pool_acquire(workspace && workspace[0] ? workspace : ".", filePath, &server,
+                         err, sizeof(err)) != 0) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", err);
+        cJSON_AddStringToObject(json, "path", filePath);
+        return json_result_lsp(json);
+    }
+
+    if (!has_capability(server, op->capability)) {
+        snprintf(err, sizeof(err), "%s does not support %s", lsp_server_name(server), operation);
+        lsp_pool_release(server);
+        return json_error_lsp(err);
+    }
+    if (lsp_sync_document(server, filePath) != 0) {
+        lsp_pool_release(server);
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "File not found");
+        cJSON_AddStringToObject(json, "path", filePath);
+        return json_result_lsp(json);
+    }
+
+    char *canonical = realpath(filePath, NULL);
+    char *uri = lsp_path_to_uri(canonical ? canonical : filePath);
+    free(canonical);
+    if (!uri) {
+        lsp_pool_release(server);
+        return json_error_lsp("Memory allocation failed");
+    }
+
+    int rc;
+    cJSON *result = NULL;
+    cJSON *params = request_params(server, op, uri, line, character, query, err, sizeof(err), &rc);
+    if (params) {
+        rc = lsp_request(server, op->method, params, LSP_REQUEST_TIMEOUT_MS, &result,
+                         err, sizeof(err));
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "operation", operation);
+    cJSON_AddStringToObject(json, "server", lsp_server_name(server));
+    lsp_pool_release(server);
+    if (rc != 0) {
+        free(uri);
+        cJSON_Delete(json);
+        return json_error_lsp(err);
+    }
+
+    result_list_t list = { cJSON_CreateArray(), 0, 0 };
+    if (result) {
+        add_result(&list, json, op, uri, result);
+    }
+    cJSON_Delete(result);
+    free(uri);
+
+    if (strcmp(op->operation, "hover") == 0) {
+        cJSON_Delete(list.results);
+        if (!cJSON_GetObjectItem(json, "contents")) {
+            cJSON_AddStringToObject(json, "contents", "");
+        }
+    } else {
+        cJSON_AddNumberToObject(json, "count", list.count);
+        cJSON_AddItemToObject(json, "results", list.results);
+        if (list.truncated) {
+            char note[128];
+            snprintf(note, sizeof(note), "Showing the first %d results", LSP_MAX_RESULTS);
+            cJSON_AddStringToObject(json, "note", note);
+        }
+    }
+    return json_result_lsp(json);
+}
+
+void code_tools_shutdown(void) {
+    lsp_pool_shutdown();
+}
@@ -1,9 +1,14 @@
 /**
  * @file tool_read.c
  * @brief Read Tool Implementation
+ *
+ * Files come from file_cache.c, so a read at an offset starts at that
+ * line without scanning the lines before it.
  */
 
 #include "code_tools.h"
+#include "file_cache.h"
+#include <arc/platform.h>
 #include <arc/sandbox.h>
 #include <cJSON.h>
 #include <stdio.h>
@@ -22,7 +27,8 @@ extern struct ac_sandbox *code_tools_get_sandbox(void);
  * Helper Functions
  *============================================================================*/
 
-static char g_read_result_buffer[131072];  /* 128KB */
+/* Per thread: read-only tools run concurrently (@parallel_safe) */
+static ARC_THREAD_LOCAL char g_read_result_buffer[131072];  /* 128KB */
 
 static const char *json_result_read(cJSON *json) {
     if (!json) {
@@ -116,22 +122,21 @@ const char *read_file(
     }
 
     /* Open file */
-    FILE *fp = fopen(filePath, "r");
-    if (!fp) {
+    file_view_t view;
+    int rc = file_cache_get(filePath, &view);
+    if (rc == -3) {
+        return json_error_read("Memory allocation failed");
+    }
+    if (rc != 0) {
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error", "File not found");
         cJSON_AddStringToObject(json, "path", filePath);
         return json_result_read(json);
     }
 
-    /* Get file size */
-    fseek(fp, 0, SEEK_END);
-    long file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
     /* Check if empty */
-    if (file_size == 0) {
-        fclose(fp);
+    if (view.size == 0) {
+        file_cache_release(&view);
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "path", filePath);
         cJSON_AddStringToObject(json, "content", "<file is empty>");
@@ -139,79 +144,52 @@ const char *read_file(
         return json_result_read(json);
     }
 
-    /* Read lines */
-    char line_buf[4096];
-    int current_line = 0;
+    int total_lines = (int)view.line_count;
     int lines_read = 0;
-    int total_lines = 0;
 
     /* Build content with line numbers */
     size_t content_cap = 65536;
     size_t content_len = 0;
     char *content = malloc(content_cap);
     if (!content) {
-        fclose(fp);
+        file_cache_release(&view);
         return json_error_read("Memory allocation failed");
     }
     content[0] = '\0';
 
-    /* First pass: count total lines and read requested range */
-    while (fgets(line_buf, sizeof(line_buf), fp) != NULL) {
-        total_lines++;
-
-        /* Skip lines before offset */
-        if (current_line < line_offset) {
-            current_line++;
-            continue;
-        }
-
-        /* Stop if we've read enough */
-        if (lines_read >= line_limit) {
-            current_line++;
-            continue;
-        }
-
-        /* Format line with line number (1-based) */
-        char formatted_line[4200];
-        int line_len = strlen(line_buf);
-
-        /* Remove trailing newline for processing */
-        if (line_len > 0 && line_buf[line_len - 1] == '\n') {
-            line_buf[line_len - 1] = '\0';
-            line_len--;
-        }
+    /* The requested range, straight from the line index */
+    for (int current_line = line_offset;
+         current_line < total_lines && lines_read < line_limit; current_line++) {
+        const char *line;
+        size_t line_len;
+        file_view_line(&view, (size_t)current_line, &line, &line_len);
 
         /* Truncate if too long */
-        if (line_len > MAX_LINE_LENGTH) {
-            line_buf[MAX_LINE_LENGTH] = '\0';
-            snprintf(formatted_line, sizeof(formatted_line),
-                     "%05d| %s...\n", current_line + 1, line_buf);
-        } else {
-            snprintf(formatted_line, sizeof(formatted_line),
-                     "%05d| %s\n", current_line + 1, line_buf);
+        int truncated = line_len > (size_t)MAX_LINE_LENGTH;
+        if (truncated) {
+            line_len = MAX_LINE_LENGTH;
         }
 
-        /* Append to content */
-        size_t formatted_len = strlen(formatted_line);
-        if (content_len + formatted_len + 1 > content_cap) {
-            content_cap *= 2;
+        /* Format line with line number (1-based); %.*s stops at a NUL like the JSON would */
+        size_t needed = line_len + 32;
+        if (content_len + needed > content_cap) {
+            while (content_len + needed > content_cap) {
+                content_cap *= 2;
+            }
             char *new_content = realloc(content, content_cap);
             if (!new_content) {
                 free(content);
-                fclose(fp);
+                file_cache_release(&view);
                 return json_error_read("Memory allocation failed");
             }
             content = new_content;
         }
-
-        strcpy(content + content_len, formatted_line);
-        content_len += formatted_len;
-
-        current_line++;
+        content_len += (size_t)snprintf(content + content_len, content_cap - content_len,
+                                        "%05d| %.*s%s\n", current_line + 1, (int)line_len, line,
+                                        truncated ? "..." : "");
         lines_read++;
     }
-
-    fclose(fp);
+    file_cache_release(&view);
 
     /* Build response */
     cJSON *json = cJSON_CreateObject();
@@ -0,0 +1,96 @@
+/**
+ * @file tool_task.c
+ * @brief Task Tool Implementation
+ *
+ * Hands the task to a sub-agent (code_subagent.c) and returns its final
+ * message as the tool result, with the session_id that resumes it.
+ */
+
+#include "code_tools.h"
+#include "code_subagent.h"
+#include <arc/platform.h>
+#include <arc/tool.h>
+#include <cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+/* Per thread: task calls run concurrently (@parallel_safe) */
+static ARC_THREAD_LOCAL char g_task_result_buffer[131072];  /* 128KB */
+
+static const char *json_result_task(cJSON *json) {
+    if (!json) {
+        return "{\"error\": \"Failed to create response\"}";
+    }
+
+    char *str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+
+    if (!str) {
+        return "{\"error\": \"Failed to serialize response\"}";
+    }
+
+    size_t len = strlen(str);
+    if (len >= sizeof(g_task_result_buffer)) {
+        len = sizeof(g_task_result_buffer) - 1;
+    }
+    memcpy(g_task_result_buffer, str, len);
+    g_task_result_buffer[len] = '\0';
+
+    free(str);
+    return g_task_result_buffer;
+}
+
+static const char *json_error_task(const char *msg) {
+    cJSON *json = cJSON_CreateObject();
+    if (json) {
+        cJSON_AddStringToObject(json, "error", msg);
+    }
+    return json_result_task(json);
+}
+
+/*============================================================================
+ * Task Tool Implementation
+ *============================================================================*/
+
+const char *task(
+    const char *description,
+    const char *prompt,
+    const char *subagent_type,
+    const char *session_id
+) {
+    if (!prompt || !prompt[0]) {
+        return json_error_task("prompt parameter is required");
+    }
+    char session[CODE_SUBAGENT_ID_SIZE] = "";
+    if (session_id && session_id[0]) {
+        if (strlen(session_id) >= sizeof(session)) {
+            return json_error_task("Unknown session_id");
+        }
+        strcpy(session, session_id);
+    }
+
+    char err[256];
+    char *answer = code_subagent_run(subagent_type, description, prompt, ac_tool_current_ctx(),
+                                     session, err, sizeof(err));
+    if (!answer) {
+        return json_error_task(err);
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    if (subagent_type && subagent_type[0]) {
+        cJSON_AddStringToObject(json, "subagent_type", subagent_type);
+    } else if (!session_id || !session_id[0]) {
+        cJSON_AddStringToObject(json, "subagent_type", "general");
+    }
+    if (session[0]) {
+        cJSON_AddStringToObject(json, "session_id", session);
+    }
+    cJSON_AddStringToObject(json, "result", answer);
+    free(answer);
+    return json_result_task(json);
+}
@@ -0,0 +1,436 @@
+/**
+ * @file tool_webfetch.c
+ * @brief Webfetch Tool Implementation
+ *
+ * Pages are fetched on a client of the shared HTTP pool, so concurrent
+ * fetches (the tool is parallel-safe) multiplex on its engine instead of
+ * each opening connections of its own. The body is streamed through
+ * html_extract.c as it arrives and the download stops once the output cap
+ * is reached; what comes out is kept in web_cache.c and revalidated with
+ * its ETag or Last-Modified once stale, so a repeated documentation
+ * lookup costs a 304 or nothing at all.
+ */
+
+#include "code_tools.h"
+#include "html_extract.h"
+#include "http_client.h"
+#include "web_cache.h"
+#include <arc/error.h>
+#include <arc/http_pool.h>
+#include <arc/platform.h>
+#include <arc/tool.h>
+#include <cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define WEBFETCH_DEFAULT_TIMEOUT_MS 30000
+#define WEBFETCH_MAX_TIMEOUT_MS     120000
+#define WEBFETCH_MAX_OUTPUT         (100 * 1024)       /* Converted content */
+#define WEBFETCH_MAX_BODY           (5 * 1024 * 1024)  /* Raw bytes read per page */
+#define WEBFETCH_MAX_REDIRECTS      5
+#define WEBFETCH_MAX_ERROR_BODY     4096               /* Of an error page */
+#define WEBFETCH_URL_MAX            2048
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+/* Per thread: read-only tools run concurrently (@parallel_safe) */
+static ARC_THREAD_LOCAL char g_webfetch_result_buffer[262144];  /* 256KB */
+
+static const char *json_result_webfetch(cJSON *json) {
+    if (!json) {
+        return "{\"error\": \"Failed to create response\"}";
+    }
+
+    char *str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+
+    if (!str) {
+        return "{\"error\": \"Failed to serialize response\"}";
+    }
+
+    size_t len = strlen(str);
+    if (len >= sizeof(g_webfetch_result_buffer)) {
+        len = sizeof(g_webfetch_result_buffer) - 1;
+    }
+    memcpy(g_webfetch_result_buffer, str, len);
+    g_webfetch_result_buffer[len] = '\0';
+
+    free(str);
+    return g_webfetch_result_buffer;
+}
+
+static const char *json_error_webfetch(const char *msg, const char *url) {
+    cJSON *json = cJSON_CreateObject();
+    if (json) {
+        cJSON_AddStringToObject(json, "error", msg);
+        if (url) {
+            cJSON_AddStringToObject(json, "url", url);
+        }
+    }
+    return json_result_webfetch(json);
+}
+
+/*============================================================================
+ * URLs
+ *============================================================================*/
+
+/** Length of scheme://authority, 0 if url is not absolute http(s) */
+static size_t origin_length(const char *url) {
+    size_t scheme = strncasecmp(url, "https://", 8) == 0 ? 8
+                  : strncasecmp(url, "http://", 7) == 0  ? 7 : 0;
+    return scheme ? scheme + strcspn(url + scheme, "/?#") : 0;
+}
+
+static int is_local_host(const char *url) {
+    static const char *const LOCAL[] = { "localhost", "127.0.0.1", "[::1]" };
+    const char *host = url + 7;      /* After http:// */
+    size_t len = strcspn(host, ":/?#");
+    for (size_t i = 0; i < sizeof(LOCAL) / sizeof(LOCAL[0]); i++) {
+        if (len == strlen(LOCAL[i]) && strncasecmp(host, LOCAL[i], len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** The URL to fetch: http upgraded to https, except for this machine */
+static int normalize_url(const char *url, char *out, size_t out_size) {
+    if (origin_length(url) == 0 || strpbrk(url, " \t\r\n")) {
+        return -1;
+    }
+    int n = strncasecmp(url, "http://", 7) == 0 && !is_local_host(url)
+          ? snprintf(out, out_size, "https://%s", url + 7)
+          : snprintf(out, out_size, "%s", url);
+    return n > 0 && (size_t)n < out_size ? 0 : -1;
+}
+
+/** Resolve a Location header against the URL it came from */
+static int resolve_location(const char *base, const char *location, char *out, size_t out_size) {
+    int n;
+    if (origin_length(location) > 0) {
+        n = snprintf(out, out_size, "%s", location);
+    } else if (location[0] == '/' && location[1] == '/') {
+        size_t scheme = strcspn(base, ":");
+        n = snprintf(out, out_size, "%.*s:%s", (int)scheme, base, location);
+    } else if (location[0] == '/') {
+        n = snprintf(out, out_size, "%.*s%s", (int)origin_length(base), base, location);
+    } else {
+        /* Relative to the directory of the base path */
+        size_t origin = origin_length(base);
+        size_t path = origin + strcspn(base + origin, "?#");
+        size_t dir = path;
+        while (dir > origin && base[dir - 1] != '/') {
+            dir--;
+        }
+        n = dir > origin ? snprintf(out, out_size, "%.*s%s", (int)dir, base, location)
+                         : snprintf(out, out_size, "%.*s/%s", (int)origin, base, location);
+    }
+    return n > 0 && (size_t)n < out_size && !strpbrk(out, " \t\r\n") ? 0 : -1;
+}
+
+/*============================================================================
+ * Fetching
+ *============================================================================*/
+
+/* Response headers the cache and the redirects need */
+static const char *const CAPTURE_HEADERS[] = {
+    "ETag", "Last-Modified", "Cache-Control", "Expires", "Date", "Age",
+    "Content-Type", "Location", NULL
+};
+
+typedef struct {
+    html_extract_t *extract;
+    const ac_tool_ctx_t *ctx;
+    size_t received;
+    int cut;                         /* Stopped before the end of the body */
+} fetch_state_t;
+
+static int on_body(const char *data, size_t len, void *user_data) {
+    fetch_state_t *state = (fetch_state_t *)user_data;
+    if (ac_tool_ctx_cancelled(state->ctx)) {
+        return 1;
+    }
+    state->received += len;
+    if (html_extract_feed(state->extract, data, len) || state->received >= WEBFETCH_MAX_BODY) {
+        state->cut = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static const char *find_header(const arc_http_response_t *response, const char *name) {
+    const arc_http_header_t *h = arc_http_header_find(response->headers, name);
+    return h ? h->value : NULL;
+}
+
+/**
+ * One GET, the body converted as it arrives. Validators are sent when
+ * the URL is the one the cached entry came from.
+ */
+static arc_err_t fetch_once(arc_http_client_t *client, const char *url, html_extract_format_t format,
+                            const web_cache_entry_t *cached, uint32_t timeout_ms,
+                            const ac_tool_ctx_t *ctx, fetch_state_t *state,
+                            arc_http_response_t *response) {
+    arc_http_header_t *headers = NULL;
+    arc_http_header_append(&headers, arc_http_header_create("User-Agent", "arc-coder webfetch"));
+    arc_http_header_append(&headers, arc_http_header_create("Accept",
+        format == HTML_EXTRACT_HTML ? "text/html,*/*;q=0.8"
+                                    : "text/html,text/markdown,text/plain;q=0.9,*/*;q=0.8"));
+    if (cached && cached->final_url && strcmp(cached->final_url, url) == 0) {
+        if (cached->etag) {
+            arc_http_header_append(&headers, arc_http_header_create("If-None-Match", cached->etag));
+        }
+        if (cached->last_modified) {
+            arc_http_header_append(&headers,
+                                   arc_http_header_create("If-Modified-Since", cached->last_modified));
+        }
+    }
+
+    memset(state, 0, sizeof(*state));
+    state->ctx = ctx;
+    state->extract = html_extract_create(format, url, WEBFETCH_MAX_OUTPUT);
+    if (!state->extract) {
+        arc_http_header_free(headers);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    arc_http_stream_request_t request = {
+        .base = {
+            .url = url,
+            .method = ARC_HTTP_GET,
+            .headers = headers,
+            .timeout_ms = timeout_ms,
+            .verify_ssl = 1,
+            .cancel = ctx ? ctx->cancel : NULL,
+            .capture_headers = CAPTURE_HEADERS,
+        },
+        .on_data = on_body,
+        .user_data = state,
+    };
+    arc_err_t err = arc_http_request_stream(client, &request, response);
+    arc_http_header_free(headers);
+    return err;
+}
+
+/*============================================================================
+ * Results
+ *============================================================================*/
+
+static const char *FORMAT_NAMES[] = { "markdown", "text", "html" };
+
+static const char *content_result(const char *url, int status, const web_cache_entry_t *entry,
+                                  html_extract_format_t format, const char *cache) {
+    cJSON *json = cJSON_CreateObject();
+    if (!json) {
+        return json_result_webfetch(NULL);
+    }
+    cJSON_AddStringToObject(json, "url", entry->final_url ? entry->final_url : url);
+    cJSON_AddNumberToObject(json, "status", status);
+    if (entry->content_type) {
+        cJSON_AddStringToObject(json, "content_type", entry->content_type);
+    }
+    cJSON_AddStringToObject(json, "format", FORMAT_NAMES[format]);
+    cJSON_AddStringToObject(json, "cache", cache);
+    if (entry->truncated) {
+        cJSON_AddBoolToObject(json, "truncated", 1);
+    }
+    cJSON_AddStringToObject(json, "content", entry->content ? entry->content : "");
+    return json_result_webfetch(json);
+}
+
+static void read_cache_headers(const arc_http_response_t *response, web_cache_headers_t *out) {
+    out->date = find_header(response, "Date");
+    out->age = find_header(response, "Age");
+    out->cache_control = find_header(response, "Cache-Control");
+    out->expires = find_header(response, "Expires");
+    out->etag = find_header(response, "ETag");
+    out->last_modified = find_header(response, "Last-Modified");
+}
+
+/*============================================================================
+ * Webfetch Tool
+ *============================================================================*/
+
+const char *webfetch(
+    const char *url,
+    const char *format,
+    int timeout
+) {
+    if (!url || !url[0]) {
+        return json_error_webfetch("url parameter is required", NULL);
+    }
+    html_extract_format_t fmt = HTML_EXTRACT_MARKDOWN;
+    if (format && format[0]) {
+        size_t i = 0;
+        while (i < 3 && strcasecmp(format, FORMAT_NAMES[i]) != 0) {
+            i++;
+        }
+        if (i == 3) {
+            return json_error_webfetch("format must be markdown, text or html", url);
+        }
+        fmt = (html_extract_format_t)i;
+    }
+
+    char target[WEBFETCH_URL_MAX];
+    if (normalize_url(url, target, sizeof(target)) != 0) {
+        return json_error_webfetch("url must be a full http:// or https:// URL", url);
+    }
+
+    const ac_tool_ctx_t *ctx = ac_tool_current_ctx();
+    uint32_t timeout_ms = timeout > 0 ? (uint32_t)timeout : WEBFETCH_DEFAULT_TIMEOUT_MS;
+    if (timeout_ms > WEBFETCH_MAX_TIMEOUT_MS) {
+        timeout_ms = WEBFETCH_MAX_TIMEOUT_MS;
+    }
+    if (ctx && ctx->deadline_ms) {
+        uint64_t now = ac_platform_timestamp_ms();
+        if (now >= ctx->deadline_ms) {
+            return json_error_webfetch("Run deadline reached", url);
+        }
+        if (ctx->deadline_ms - now < timeout_ms) {
+            timeout_ms = (uint32_t)(ctx->deadline_ms - now);
+        }
+    }
+
+    /* A fresh entry needs no request at all */
+    const char *name = FORMAT_NAMES[fmt];
+    web_cache_entry_t cached;
+    int have_cached = web_cache_lookup(target, name, &cached) == 0;
+    if (have_cached && web_cache_is_fresh(&cached, time(NULL))) {
+        const char *result = content_result(target, 200, &cached, fmt, "hit");
+        web_cache_entry_free(&cached);
+        return result;
+    }
+
+    arc_http_client_t *client = NULL;
+    int from_pool = ac_http_pool_is_initialized();
+    if (from_pool) {
+        client = ac_http_pool_acquire(timeout_ms);
+    } else if (arc_http_client_create(&(arc_http_client_config_t){
+                   .default_timeout_ms = timeout_ms, .http2 = 1 }, &client) != ARC_OK) {
+        client = NULL;
+    }
+    if (!client) {
+        if (have_cached) {
+            web_cache_entry_free(&cached);
+        }
+        return json_error_webfetch("No HTTP client available", url);
+    }
+
+    /* Redirects are followed here: the transport does not, and the cache keys by the first URL */
+    char current[WEBFETCH_URL_MAX];
+    snprintf(current, sizeof(current), "%s", target);
+    fetch_state_t state;
+    arc_http_response_t response;
+    arc_err_t err = ARC_OK;
+    int hops = 0;
+    const char *result = NULL;
+    for (;;) {
+        memset(&response, 0, sizeof(response));
+        err = fetch_once(client, current, fmt, have_cached ? &cached : NULL, timeout_ms, ctx,
+                         &state, &response);
+        int status = response.status_code;
+        const char *location = find_header(&response, "Location");
+        if (err != ARC_OK || status < 300 || status >= 400 || status == 304 || !location) {
+            break;
+        }
+        char next[WEBFETCH_URL_MAX];
+        if (++hops > WEBFETCH_MAX_REDIRECTS ||
+            resolve_location(current, location, next, sizeof(next)) != 0) {
+            result = json_error_webfetch(hops > WEBFETCH_MAX_REDIRECTS ? "Too many redirects"
+                                                                       : "Invalid redirect", current);
+            break;
+        }
+        memcpy(current, next, sizeof(current));
+        html_extract_destroy(state.extract);
+        state.extract = NULL;
+        arc_http_response_free(&response);
+    }
+
+    if (result) {
+        /* Already decided */
+    } else if (ac_tool_ctx_cancelled(ctx)) {
+        result = json_error_webfetch("Fetch cancelled", url);
+    } else if (err != ARC_OK) {
+        /* Unreachable: a stale copy beats nothing, unless the server forbade it */
+        if (have_cached && !cached.must_revalidate) {
+            result = content_result(target, 200, &cached, fmt, "stale");
+        } else {
+            char msg[512];
+            snprintf(msg, sizeof(msg), "Fetch failed: %s",
+                     response.error_msg ? response.error_msg : ac_strerror(err));
+            result = json_error_webfetch(msg, current);
+        }
+    } else if (response.status_code == 304 && have_cached) {
+        web_cache_headers_t headers;
+        read_cache_headers(&response, &headers);
+        if (web_cache_apply_headers(&cached, &headers, time(NULL))) {
+            web_cache_store(target, name, &cached);
+        }
+        result = content_result(target, 200, &cached, fmt, "revalidated");
+    } else if (response.status_code >= 200 && response.status_code < 300) {
+        size_t len = 0;
+        int truncated = 0;
+        const char *out = html_extract_output(state.extract, &len, &truncated);
+        if (memchr(out, '\0', len)) {
+            result = json_error_webfetch("Binary content is not supported", current);
+        } else {
+            const char *type = find_header(&response, "Content-Type");
+            web_cache_entry_t entry = {
+                .final_url = strdup(current),
+                .content_type = type ? strdup(type) : NULL,
+                .truncated = truncated || state.cut,
+                .content = (char *)out,
+                .content_len = len,
+            };
+            web_cache_headers_t headers;
+            read_cache_headers(&response, &headers);
+            if (response.status_code == 200 &&
+                web_cache_apply_headers(&entry, &headers, time(NULL))) {
+                web_cache_store(target, name, &entry);
+            }
+            result = content_result(target, response.status_code, &entry, fmt, "miss");
+            entry.content = NULL;        /* Owned by the converter */
+            web_cache_entry_free(&entry);
+        }
+    } else {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "HTTP %d", response.status_code);
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", msg);
+        cJSON_AddStringToObject(json, "url", current);
+        cJSON_AddNumberToObject(json, "status", response.status_code);
+        size_t len = 0;
+        const char *out = html_extract_output(state.extract, &len, NULL);
+        if (len > WEBFETCH_MAX_ERROR_BODY) {
+            len = WEBFETCH_MAX_ERROR_BODY;
+            while (len > 0 && ((unsigned char)out[len] & 0xC0) == 0x80) {
+                len--;           /* Not inside a UTF-8 sequence */
+            }
+        }
+        if (len > 0 && !memchr(out, '\0', len)) {
+            char *head = strndup(out, len);
+            if (head) {
+                cJSON_AddStringToObject(json, "content", head);
+                free(head);
+            }
+        }
+        result = json_result_webfetch(json);
+    }
+
+    html_extract_destroy(state.extract);
+    arc_http_response_free(&response);
+    if (from_pool) {
+        ac_http_pool_release(client);
+    } else {
+        arc_http_client_destroy(client);
+    }
+    if (have_cached) {
+        web_cache_entry_free(&cached);
+    }
+    return result;
+}
@@ -4,6 +4,8 @@
  */
 
 #include "code_tools.h"
+#include "file_cache.h"
+#include "lsp_client.h"
 #include <arc/sandbox.h>
 #include <cJSON.h>
 #include <stdio.h>
@@ -142,6 +144,8 @@ const char *write_file(
     size_t content_len = strlen(content);
     size_t written = fwrite(content, 1, content_len, fp);
     fclose(fp);
+    file_cache_invalidate(filePath);
+    lsp_pool_file_changed(filePath);
 
     if (written != content_len) {
         cJSON *json = cJSON_CreateObject();
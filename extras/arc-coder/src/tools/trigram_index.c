@@ -0,0 +1,623 @@
+/**
+ * @file trigram_index.c
+ * @brief Persistent trigram index that narrows grep to candidate files
+ */
+
+#include "trigram_index.h"
+#include "grep_engine.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#define INDEX_MAGIC        "ARCTRI01"
+#define INDEX_MAX_FILE     (16 * 1024 * 1024)  /* Larger files are always candidates */
+#define INDEX_BINARY_PROBE 8192                /* Same test as grep_engine.c */
+#define INDEX_MAX_LITERALS 8
+#define GRAM_BITS          (1u << 24)
+
+#ifdef __APPLE__
+#define MTIME_NS(st) ((int64_t)(st)->st_mtimespec.tv_sec * 1000000000 + (st)->st_mtimespec.tv_nsec)
+#else
+#define MTIME_NS(st) ((int64_t)(st)->st_mtim.tv_sec * 1000000000 + (st)->st_mtim.tv_nsec)
+#endif
+
+enum {
+    ENTRY_TEXT,                      /* grams holds every trigram */
+    ENTRY_BINARY,                    /* Never searched */
+    ENTRY_LARGE,                     /* Not indexed: always a candidate */
+};
+
+typedef struct {
+    char *rel;                       /* Relative to the root */
+    int64_t mtime_ns;
+    int64_t size;
+    uint32_t *grams;                 /* Sorted */
+    uint32_t count;
+    uint8_t state;
+    uint8_t seen;                    /* Visited by the current walk */
+} entry_t;
+
+struct trigram_index {
+    char *root;
+    char *cache_path;                /* NULL = not saved */
+    pthread_mutex_t lock;            /* Taken by walker threads for the fields below */
+
+    entry_t *entries;                /* Sorted by rel */
+    size_t count;
+    entry_t *added;                  /* Files new in the current walk */
+    size_t added_count;
+    size_t added_cap;
+    char **dirs;                     /* Walked directories, sorted */
+    size_t dir_count;
+    size_t dir_cap;
+    int changed;                     /* Since the last save */
+    int failed;                      /* Out of memory during the walk */
+    int walked;                      /* dirs is valid */
+
+    int inotify;                     /* -1 = not watching */
+    int watch_failed;
+};
+
+/*============================================================================
+ * Trigrams
+ *============================================================================*/
+
+static unsigned char lower(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c + 32) : c;
+}
+
+static int by_gram(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/** Trigrams seen in the current file; one per walker thread */
+typedef struct {
+    uint8_t bits[GRAM_BITS / 8];
+} gram_set_t;
+
+/**
+ * @brief Distinct trigrams of a buffer, sorted
+ *
+ * @return 0, or -1 out of memory
+ */
+static int collect_grams(gram_set_t *set, const unsigned char *p, size_t len, uint32_t **out,
+                         uint32_t *count) {
+    uint32_t *grams = NULL;
+    size_t n = 0, cap = 0;
+    uint32_t gram = 0;
+    int failed = 0;
+    for (size_t i = 0; i < len; i++) {
+        gram = ((gram << 8) | lower(p[i])) & (GRAM_BITS - 1);
+        if (i < 2 || (set->bits[gram >> 3] & (1u << (gram & 7)))) {
+            continue;
+        }
+        if (n == cap) {
+            cap = cap ? cap * 2 : 1024;
+            uint32_t *grown = realloc(grams, cap * sizeof(uint32_t));
+            if (!grown) {
+                failed = 1;
+                break;
+            }
+            grams = grown;
+        }
+        set->bits[gram >> 3] |= (uint8_t)(1u << (gram & 7));
+        grams[n++] = gram;
+    }
+    for (size_t i = 0; i < n; i++) {
+        set->bits[grams[i] >> 3] = 0;  /* Clear for the next file */
+    }
+    if (failed) {
+        free(grams);
+        return -1;
+    }
+    qsort(grams, n, sizeof(uint32_t), by_gram);
+    *out = grams;
+    *count = (uint32_t)n;
+    return 0;
+}
+
+/**
+ * @brief Read a file and fill in its state and trigrams
+ *
+ * @return 0, or -1 out of memory
+ */
+static int index_file(gram_set_t *set, const char *path, entry_t *e) {
+    e->grams = NULL;
+    e->count = 0;
+    e->state = ENTRY_LARGE;
+    if (e->size > INDEX_MAX_FILE) {
+        return 0;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;                    /* Unreadable now: let grep find out */
+    }
+    size_t size = (size_t)e->size;
+    unsigned char *buf = malloc(size ? size : 1);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+    size_t got = 0;
+    ssize_t n;
+    while (got < size && (n = read(fd, buf + got, size - got)) > 0) {
+        got += (size_t)n;
+    }
+    close(fd);
+
+    int rc = 0;
+    if (memchr(buf, '\0', got < INDEX_BINARY_PROBE ? got : INDEX_BINARY_PROBE)) {
+        e->state = ENTRY_BINARY;
+    } else if (collect_grams(set, buf, got, &e->grams, &e->count) == 0) {
+        e->state = ENTRY_TEXT;
+    } else {
+        rc = -1;
+    }
+    free(buf);
+    return rc;
+}
+
+/*============================================================================
+ * Walking
+ *============================================================================*/
+
+static int by_rel(const void *a, const void *b) {
+    return strcmp(((const entry_t *)a)->rel, ((const entry_t *)b)->rel);
+}
+
+static int by_string(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static entry_t *find_entry(trigram_index_t *index, const char *rel) {
+    entry_t key = { 0 };
+    key.rel = (char *)rel;
+    return bsearch(&key, index->entries, index->count, sizeof(entry_t), by_rel);
+}
+
+static void add_dir(trigram_index_t *index, const char *path, const char *rel) {
+#ifdef __linux__
+    if (index->inotify >= 0 &&
+        inotify_add_watch(index->inotify, path,
+                          IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                              IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+        index->watch_failed = 1;     /* Out of watches: walk every time */
+    }
+#else
+    (void)path;
+#endif
+    char *copy = strdup(rel);
+    pthread_mutex_lock(&index->lock);
+    if (copy && index->dir_count == index->dir_cap) {
+        size_t cap = index->dir_cap ? index->dir_cap * 2 : 64;
+        char **grown = realloc(index->dirs, cap * sizeof(char *));
+        if (grown) {
+            index->dirs = grown;
+            index->dir_cap = cap;
+        } else {
+            free(copy);
+            copy = NULL;
+        }
+    }
+    if (copy) {
+        index->dirs[index->dir_count++] = copy;
+    } else {
+        index->failed = 1;
+    }
+    pthread_mutex_unlock(&index->lock);
+}
+
+static void visit(void *ctx, void **scratch, const char *path, const char *rel,
+                  const struct stat *st) {
+    trigram_index_t *index = (trigram_index_t *)ctx;
+    if (S_ISDIR(st->st_mode)) {
+        add_dir(index, path, rel);
+        return;
+    }
+
+    /* Entries are only read during the walk, and each file is visited once */
+    entry_t *e = find_entry(index, rel);
+    if (e && e->mtime_ns == MTIME_NS(st) && e->size == (int64_t)st->st_size) {
+        e->seen = 1;
+        return;
+    }
+    if (!*scratch) {
+        *scratch = calloc(1, sizeof(gram_set_t));
+        if (!*scratch) {
+            index->failed = 1;
+            return;
+        }
+    }
+    entry_t fresh = { 0 };
+    fresh.mtime_ns = MTIME_NS(st);
+    fresh.size = (int64_t)st->st_size;
+    fresh.seen = 1;
+    if (index_file((gram_set_t *)*scratch, path, &fresh) != 0) {
+        index->failed = 1;
+        return;
+    }
+
+    pthread_mutex_lock(&index->lock);
+    index->changed = 1;
+    if (e) {
+        /* Other threads may be comparing e->rel, so it stays put */
+        free(e->grams);
+        e->mtime_ns = fresh.mtime_ns;
+        e->size = fresh.size;
+        e->grams = fresh.grams;
+        e->count = fresh.count;
+        e->state = fresh.state;
+        e->seen = 1;
+        pthread_mutex_unlock(&index->lock);
+        return;
+    }
+    fresh.rel = strdup(rel);
+    if (fresh.rel && index->added_count == index->added_cap) {
+        size_t cap = index->added_cap ? index->added_cap * 2 : 64;
+        entry_t *grown = realloc(index->added, cap * sizeof(entry_t));
+        if (grown) {
+            index->added = grown;
+            index->added_cap = cap;
+        } else {
+            free(fresh.rel);
+            fresh.rel = NULL;
+        }
+    }
+    if (fresh.rel) {
+        index->added[index->added_count++] = fresh;
+    } else {
+        free(fresh.grams);
+        index->failed = 1;
+    }
+    pthread_mutex_unlock(&index->lock);
+}
+
+static void free_dirs(trigram_index_t *index) {
+    for (size_t i = 0; i < index->dir_count; i++) {
+        free(index->dirs[i]);
+    }
+    index->dir_count = 0;
+}
+
+/** Whether watched directories changed since the last walk (1), or not (0) */
+static int tree_changed(trigram_index_t *index) {
+#ifdef __linux__
+    if (index->inotify < 0) {
+        return 1;
+    }
+    char events[4096];
+    int changed = 0;
+    while (read(index->inotify, events, sizeof(events)) > 0) {
+        changed = 1;                 /* Any event: the walk sorts out what */
+    }
+    return changed;
+#else
+    (void)index;
+    return 1;
+#endif
+}
+
+/*============================================================================
+ * Persistence
+ *============================================================================*/
+
+/** $XDG_CACHE_HOME/arc/codesearch/<hash of root>.idx, creating the directories */
+static char *cache_path_for(const char *root) {
+    char dir[4096];
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (xdg && *xdg) {
+        snprintf(dir, sizeof(dir), "%s", xdg);
+    } else if (home && *home) {
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+    } else {
+        return NULL;
+    }
+    mkdir(dir, 0755);
+    strncat(dir, "/arc", sizeof(dir) - strlen(dir) - 1);
+    mkdir(dir, 0755);
+    strncat(dir, "/codesearch", sizeof(dir) - strlen(dir) - 1);
+    mkdir(dir, 0755);
+
+    uint64_t hash = 1469598103934665603ULL;  /* FNV-1a */
+    for (const unsigned char *p = (const unsigned char *)root; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    char path[4200];
+    snprintf(path, sizeof(path), "%s/%016llx.idx", dir, (unsigned long long)hash);
+    return strdup(path);
+}
+
+static int write_all(FILE *f, const void *p, size_t n) {
+    return fwrite(p, 1, n, f) == n ? 0 : -1;
+}
+
+static int read_all(FILE *f, void *p, size_t n) {
+    return fread(p, 1, n, f) == n ? 0 : -1;
+}
+
+static void save(trigram_index_t *index) {
+    if (!index->cache_path) {
+        return;
+    }
+    char tmp[4300];
+    snprintf(tmp, sizeof(tmp), "%s.%ld", index->cache_path, (long)getpid());
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        return;
+    }
+    uint32_t root_len = (uint32_t)strlen(index->root);
+    uint64_t count = index->count;
+    int rc = write_all(f, INDEX_MAGIC, 8) | write_all(f, &root_len, sizeof(root_len)) |
+             write_all(f, index->root, root_len) | write_all(f, &count, sizeof(count));
+    for (size_t i = 0; i < index->count && rc == 0; i++) {
+        const entry_t *e = &index->entries[i];
+        uint32_t rel_len = (uint32_t)strlen(e->rel);
+        rc = write_all(f, &rel_len, sizeof(rel_len)) | write_all(f, e->rel, rel_len) |
+             write_all(f, &e->mtime_ns, sizeof(e->mtime_ns)) |
+             write_all(f, &e->size, sizeof(e->size)) | write_all(f, &e->state, 1) |
+             write_all(f, &e->count, sizeof(e->count)) |
+             write_all(f, e->grams, e->count * sizeof(uint32_t));
+    }
+    if (fclose(f) != 0 || rc != 0 || rename(tmp, index->cache_path) != 0) {
+        remove(tmp);
+        return;
+    }
+    index->changed = 0;
+}
+
+static void free_entries(entry_t *entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(entries[i].rel);
+        free(entries[i].grams);
+    }
+    free(entries);
+}
+
+/** Load the saved index; a missing, stale or damaged one leaves it empty */
+static void load(trigram_index_t *index) {
+    FILE *f = index->cache_path ? fopen(index->cache_path, "rb") : NULL;
+    if (!f) {
+        return;
+    }
+    char magic[8];
+    uint32_t root_len;
+    uint64_t count;
+    char root[4096];
+    if (read_all(f, magic, 8) != 0 || memcmp(magic, INDEX_MAGIC, 8) != 0 ||
+        read_all(f, &root_len, sizeof(root_len)) != 0 || root_len >= sizeof(root) ||
+        read_all(f, root, root_len) != 0 || read_all(f, &count, sizeof(count)) != 0 ||
+        count > (1u << 24)) {
+        fclose(f);
+        return;
+    }
+    root[root_len] = '\0';
+    entry_t *entries = calloc(count ? (size_t)count : 1, sizeof(entry_t));
+    if (strcmp(root, index->root) != 0 || !entries) {
+        free(entries);               /* Another root with the same hash */
+        fclose(f);
+        return;
+    }
+    size_t loaded = 0;
+    int ok = 1;
+    for (; loaded < count && ok; loaded++) {
+        entry_t *e = &entries[loaded];
+        uint32_t rel_len;
+        ok = read_all(f, &rel_len, sizeof(rel_len)) == 0 && rel_len < 4096 &&
+             (e->rel = malloc(rel_len + 1)) != NULL && read_all(f, e->rel, rel_len) == 0;
+        if (ok) {
+            e->rel[rel_len] = '\0';
+            ok = read_all(f, &e->mtime_ns, sizeof(e->mtime_ns)) == 0 &&
+                 read_all(f, &e->size, sizeof(e->size)) == 0 && read_all(f, &e->state, 1) == 0 &&
+                 read_all(f, &e->count, sizeof(e->count)) == 0 && e->count <= GRAM_BITS &&
+                 (e->grams = malloc(e->count ? e->count * sizeof(uint32_t) : 1)) != NULL &&
+                 read_all(f, e->grams, e->count * sizeof(uint32_t)) == 0;
+        }
+    }
+    fclose(f);
+    if (!ok) {
+        free_entries(entries, loaded);
+        return;
+    }
+    qsort(entries, (size_t)count, sizeof(entry_t), by_rel);
+    index->entries = entries;
+    index->count = (size_t)count;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+trigram_index_t *trigram_index_open(const char *root) {
+    char *canonical = realpath(root, NULL);
+    trigram_index_t *index = canonical ? calloc(1, sizeof(trigram_index_t)) : NULL;
+    if (!index) {
+        free(canonical);
+        return NULL;
+    }
+    index->root = canonical;
+    index->cache_path = cache_path_for(canonical);
+    index->inotify = -1;
+#ifdef __linux__
+    index->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    pthread_mutex_init(&index->lock, NULL);
+    load(index);
+    return index;
+}
+
+void trigram_index_close(trigram_index_t *index) {
+    if (!index) {
+        return;
+    }
+    if (index->inotify >= 0) {
+        close(index->inotify);
+    }
+    free_entries(index->entries, index->count);
+    free_dirs(index);
+    free(index->dirs);
+    free(index->added);
+    pthread_mutex_destroy(&index->lock);
+    free(index->cache_path);
+    free(index->root);
+    free(index);
+}
+
+const char *trigram_index_root(const trigram_index_t *index) {
+    return index->root;
+}
+
+int trigram_index_refresh(trigram_index_t *index) {
+    if (index->walked && !tree_changed(index)) {
+        return 0;
+    }
+    free_dirs(index);
+    index->walked = 0;
+    index->failed = 0;
+    index->watch_failed = 0;
+    for (size_t i = 0; i < index->count; i++) {
+        index->entries[i].seen = 0;
+    }
+
+    int rc = grep_engine_walk(index->root, 0, visit, index);
+    if (rc != 0 || index->failed) {
+        free_entries(index->added, index->added_count);
+        index->added = NULL;
+        index->added_count = index->added_cap = 0;
+        return -1;
+    }
+
+    /* Drop files that are gone, then merge in the new ones */
+    size_t kept = 0;
+    for (size_t i = 0; i < index->count; i++) {
+        entry_t *e = &index->entries[i];
+        if (e->seen) {
+            index->entries[kept++] = *e;
+        } else {
+            free(e->rel);
+            free(e->grams);
+            index->changed = 1;
+        }
+    }
+    index->count = kept;
+    if (index->added_count > 0) {
+        entry_t *grown = realloc(index->entries, (kept + index->added_count) * sizeof(entry_t));
+        if (!grown) {
+            free_entries(index->added, index->added_count);
+            index->added = NULL;
+            index->added_count = index->added_cap = 0;
+            return -1;
+        }
+        memcpy(grown + kept, index->added, index->added_count * sizeof(entry_t));
+        index->entries = grown;
+        index->count += index->added_count;
+        free(index->added);
+        index->added = NULL;
+        index->added_count = index->added_cap = 0;
+    }
+    qsort(index->entries, index->count, sizeof(entry_t), by_rel);
+    qsort(index->dirs, index->dir_count, sizeof(char *), by_string);
+    index->walked = 1;
+
+#ifdef __linux__
+    if (index->watch_failed && index->inotify >= 0) {
+        close(index->inotify);
+        index->inotify = -1;
+    }
+#endif
+    if (index->changed) {
+        save(index);
+    }
+    return 0;
+}
+
+int trigram_index_candidates(trigram_index_t *index, const char *pattern, int case_sensitive,
+                             const char *dir, char ***files, size_t *count) {
+    *files = NULL;
+    *count = 0;
+    if (!index->walked ||
+        !bsearch(&dir, index->dirs, index->dir_count, sizeof(char *), by_string)) {
+        return 0;                    /* Not a directory the walk covers */
+    }
+
+    /* The trigrams of each literal; a file must hold all of one set */
+    char literals[INDEX_MAX_LITERALS][128];
+    uint32_t grams[INDEX_MAX_LITERALS][126];
+    size_t gram_count[INDEX_MAX_LITERALS];
+    int n = grep_engine_literals(pattern, case_sensitive, literals, INDEX_MAX_LITERALS);
+    if (n == 0) {
+        return 0;
+    }
+    for (int k = 0; k < n; k++) {
+        const unsigned char *l = (const unsigned char *)literals[k];
+        size_t len = strlen(literals[k]);
+        if (len < 3) {
+            return 0;
+        }
+        gram_count[k] = len - 2;
+        for (size_t i = 0; i + 2 < len; i++) {
+            grams[k][i] = ((uint32_t)lower(l[i]) << 16) | ((uint32_t)lower(l[i + 1]) << 8) |
+                          lower(l[i + 2]);
+        }
+    }
+
+    size_t prefix = strlen(dir);
+    size_t cap = 64;
+    char **list = malloc(cap * sizeof(char *));  /* Never NULL: no candidates is not "walk" */
+    if (!list) {
+        return -1;
+    }
+    for (size_t i = 0; i < index->count; i++) {
+        const entry_t *e = &index->entries[i];
+        if (prefix && (strncmp(e->rel, dir, prefix) != 0 || e->rel[prefix] != '/')) {
+            continue;
+        }
+        int hit = e->state == ENTRY_LARGE;
+        for (int k = 0; k < n && !hit && e->state == ENTRY_TEXT; k++) {
+            hit = 1;
+            for (size_t g = 0; g < gram_count[k] && hit; g++) {
+                hit = bsearch(&grams[k][g], e->grams, e->count, sizeof(uint32_t), by_gram) != NULL;
+            }
+        }
+        if (!hit) {
+            continue;
+        }
+        if (*count == cap) {
+            cap *= 2;
+            char **grown = realloc(list, cap * sizeof(char *));
+            if (!grown) {
+                trigram_index_free_list(list, *count);
+                *count = 0;
+                return -1;
+            }
+            list = grown;
+        }
+        list[*count] = strdup(e->rel + (prefix ? prefix + 1 : 0));
+        if (!list[*count]) {
+            trigram_index_free_list(list, *count);
+            *count = 0;
+            return -1;
+        }
+        (*count)++;
+    }
+    *files = list;
+    return 1;
+}
+
+void trigram_index_free_list(char **files, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(files[i]);
+    }
+    free(files);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file trigram_index.h
+ * @brief Persistent trigram index that narrows grep to candidate files
+ *
+ * Records, for every file a grep of the workspace would read, the set of
+ * byte trigrams (ASCII-lowercased) it contains. A match must contain one
+ * of the pattern's required literals (grep_engine_literals()), so when
+ * each is at least three bytes long only files holding every trigram of
+ * one of them can match, and only those are searched.
+ *
+ * The index is kept in $XDG_CACHE_HOME/arc/codesearch (~/.cache/...),
+ * one file per workspace, and brought up to date before each query: the
+ * tree is walked and files whose size or mtime changed are read again.
+ * On Linux, inotify watches on the indexed directories let a query skip
+ * the walk while nothing has changed.
+ */
+
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct trigram_index trigram_index_t;
+
+/**
+ * @brief Open the index of a workspace, loading the saved one if any
+ *
+ * @return Index, or NULL if root does not exist or out of memory
+ */
+trigram_index_t *trigram_index_open(const char *root);
+
+/**
+ * @brief Close an index (it is saved by trigram_index_refresh())
+ */
+void trigram_index_close(trigram_index_t *index);
+
+/**
+ * @brief Canonical workspace path the index covers
+ */
+const char *trigram_index_root(const trigram_index_t *index);
+
+/**
+ * @brief Bring the index up to date with the tree, saving it if it changed
+ *
+ * @return 0 on success, -1 if the walk failed (the index is left as it was)
+ */
+int trigram_index_refresh(trigram_index_t *index);
+
+/**
+ * @brief Files under dir that may match a pattern
+ *
+ * @param dir    Directory searched, relative to the root ("" = root)
+ * @param files  Receives paths relative to dir, possibly none (never NULL on 1);
+ *               free with trigram_index_free_list()
+ * @return 1 with the candidates, 0 if the pattern (or dir) cannot be
+ *         narrowed and the tree must be walked, -1 out of memory
+ */
+int trigram_index_candidates(trigram_index_t *index, const char *pattern, int case_sensitive,
+                             const char *dir, char ***files, size_t *count);
+
+/**
+ * @brief Free a list returned by trigram_index_candidates()
+ */
+void trigram_index_free_list(char **files, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRIGRAM_INDEX_H */
@@ -0,0 +1,311 @@
+/**
+ * @file web_cache.c
+ * @brief On-disk HTTP cache of the webfetch tool
+ *
+ * An entry file is a few "key value" lines, a blank line and the
+ * content. Its name is a hash of format and URL; both are stored too and
+ * compared on lookup, so a hash collision reads as a miss.
+ */
+
+#define _GNU_SOURCE  /* timegm, strptime */
+
+#include "web_cache.h"
+#include <arc/env.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ENTRY_MAGIC           "arc-webfetch 1"
+#define HEURISTIC_MAX_SECONDS 86400  /* Cap of the Last-Modified heuristic */
+
+/*============================================================================
+ * Location
+ *============================================================================*/
+
+static char g_dir[1024];
+static int g_enabled;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+static int mkdir_p(char *path) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            int rc = mkdir(path, 0700);
+            *p = '/';
+            if (rc != 0 && errno != EEXIST) {
+                return -1;
+            }
+        }
+    }
+    return mkdir(path, 0700) == 0 || errno == EEXIST ? 0 : -1;
+}
+
+static void cache_init(void) {
+    const char *flag = ac_env_get("WEBFETCH_CACHE", "true");
+    if (strcmp(flag, "false") == 0 || strcmp(flag, "0") == 0) {
+        return;
+    }
+
+    const char *dir = ac_env_get("WEBFETCH_CACHE_DIR", NULL);
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    int n;
+    if (dir && dir[0]) {
+        n = snprintf(g_dir, sizeof(g_dir), "%s", dir);
+    } else if (xdg && xdg[0]) {
+        n = snprintf(g_dir, sizeof(g_dir), "%s/arc-coder/webfetch", xdg);
+    } else if (home && home[0]) {
+        n = snprintf(g_dir, sizeof(g_dir), "%s/.cache/arc-coder/webfetch", home);
+    } else {
+        return;
+    }
+    g_enabled = n > 0 && (size_t)n < sizeof(g_dir) && mkdir_p(g_dir) == 0;
+}
+
+int web_cache_enabled(void) {
+    pthread_once(&g_once, cache_init);
+    return g_enabled;
+}
+
+static void entry_path(const char *url, const char *format, char *out, size_t out_size) {
+    uint64_t h = 1469598103934665603ULL;  /* FNV-1a */
+    for (const char *p = format; *p; p++) {
+        h = (h ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    h = (h ^ 0xFF) * 1099511628211ULL;
+    for (const char *p = url; *p; p++) {
+        h = (h ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    snprintf(out, out_size, "%s/%016llx", g_dir, (unsigned long long)h);
+}
+
+/*============================================================================
+ * Freshness (RFC 9111 section 4.2)
+ *============================================================================*/
+
+/** HTTP-date in any of its three forms, -1 if invalid */
+static time_t parse_http_date(const char *s) {
+    static const char *const FORMATS[] = {
+        "%a, %d %b %Y %H:%M:%S GMT",  /* IMF-fixdate */
+        "%A, %d-%b-%y %H:%M:%S GMT",  /* RFC 850 */
+        "%a %b %e %H:%M:%S %Y",       /* asctime */
+    };
+    if (!s) {
+        return -1;
+    }
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    for (size_t i = 0; i < sizeof(FORMATS) / sizeof(FORMATS[0]); i++) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        const char *end = strptime(s, FORMATS[i], &tm);
+        if (end) {
+            return timegm(&tm);
+        }
+    }
+    return -1;
+}
+
+/** Whether a Cache-Control list has a directive; its argument goes to value */
+static int cc_directive(const char *cc, const char *name, long *value) {
+    size_t len = strlen(name);
+    const char *p = cc;
+    while (p && *p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        if (strncasecmp(p, name, len) == 0 && (p[len] == '\0' || p[len] == ',' ||
+                                                p[len] == '=' || p[len] == ' ')) {
+            if (value) {
+                const char *v = p[len] == '=' ? p + len + 1 : NULL;
+                *value = v ? strtol(v + (*v == '"'), NULL, 10) : -1;
+            }
+            return 1;
+        }
+        p = strchr(p, ',');
+    }
+    return 0;
+}
+
+static void replace(char **field, const char *value) {
+    if (value) {
+        free(*field);
+        *field = strdup(value);
+    }
+}
+
+int web_cache_apply_headers(web_cache_entry_t *entry, const web_cache_headers_t *headers,
+                            time_t received) {
+    const char *cc = headers->cache_control ? headers->cache_control : "";
+    if (cc_directive(cc, "no-store", NULL)) {
+        return 0;
+    }
+
+    replace(&entry->etag, headers->etag);
+    replace(&entry->last_modified, headers->last_modified);
+
+    /* Age when received: the larger of what the clocks and the Age header say */
+    time_t date = parse_http_date(headers->date);
+    if (date < 0) {
+        date = received;
+    }
+    long apparent = received > date ? (long)(received - date) : 0;
+    long age = headers->age ? strtol(headers->age, NULL, 10) : 0;
+    entry->age = age > apparent ? age : apparent;
+    entry->stored = received;
+
+    long max_age = -1;
+    if (cc_directive(cc, "max-age", &max_age) && max_age >= 0) {
+        entry->lifetime = max_age;
+    } else if (headers->expires) {
+        time_t expires = parse_http_date(headers->expires);
+        entry->lifetime = expires > date ? (long)(expires - date) : 0;  /* Invalid = expired */
+    } else {
+        time_t modified = parse_http_date(entry->last_modified);
+        long heuristic = modified >= 0 && date > modified ? (long)(date - modified) / 10 : 0;
+        entry->lifetime = heuristic < HEURISTIC_MAX_SECONDS ? heuristic : HEURISTIC_MAX_SECONDS;
+    }
+    entry->no_cache = cc_directive(cc, "no-cache", NULL);
+    entry->must_revalidate = cc_directive(cc, "must-revalidate", NULL);
+
+    /* Without validators an entry is only good while fresh */
+    return entry->etag || entry->last_modified || (!entry->no_cache && entry->lifetime > 0);
+}
+
+int web_cache_is_fresh(const web_cache_entry_t *entry, time_t now) {
+    long current_age = entry->age + (now > entry->stored ? (long)(now - entry->stored) : 0);
+    return !entry->no_cache && entry->lifetime > current_age;
+}
+
+/*============================================================================
+ * Entry Files
+ *============================================================================*/
+
+int web_cache_lookup(const char *url, const char *format, web_cache_entry_t *entry) {
+    memset(entry, 0, sizeof(*entry));
+    if (!web_cache_enabled()) {
+        return -1;
+    }
+
+    char path[1100];
+    entry_path(url, format, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+
+    char line[4096];
+    int ok = fgets(line, sizeof(line), f) && strncmp(line, ENTRY_MAGIC "\n", sizeof(line)) == 0;
+    int matched = 0;
+    while (ok && fgets(line, sizeof(line), f) && line[0] != '\n') {
+        line[strcspn(line, "\n")] = '\0';
+        char *value = strchr(line, ' ');
+        if (!value) {
+            continue;
+        }
+        *value++ = '\0';
+        if (strcmp(line, "url") == 0) {
+            matched += strcmp(value, url) == 0;
+        } else if (strcmp(line, "format") == 0) {
+            matched += strcmp(value, format) == 0;
+        } else if (strcmp(line, "final") == 0) {
+            replace(&entry->final_url, value);
+        } else if (strcmp(line, "content-type") == 0) {
+            replace(&entry->content_type, value);
+        } else if (strcmp(line, "etag") == 0) {
+            replace(&entry->etag, value);
+        } else if (strcmp(line, "last-modified") == 0) {
+            replace(&entry->last_modified, value);
+        } else if (strcmp(line, "stored") == 0) {
+            entry->stored = (time_t)strtoll(value, NULL, 10);
+        } else if (strcmp(line, "age") == 0) {
+            entry->age = strtol(value, NULL, 10);
+        } else if (strcmp(line, "lifetime") == 0) {
+            entry->lifetime = strtol(value, NULL, 10);
+        } else if (strcmp(line, "flags") == 0) {
+            ok = sscanf(value, "%d %d %d", &entry->no_cache, &entry->must_revalidate,
+                        &entry->truncated) == 3;
+        }
+    }
+
+    if (ok && matched == 2) {
+        long start = ftell(f);
+        fseek(f, 0, SEEK_END);
+        long end = ftell(f);
+        fseek(f, start, SEEK_SET);
+        entry->content_len = start >= 0 && end >= start ? (size_t)(end - start) : 0;
+        entry->content = malloc(entry->content_len + 1);
+        ok = entry->content && fread(entry->content, 1, entry->content_len, f) ==
+                                   entry->content_len;
+        if (ok) {
+            entry->content[entry->content_len] = '\0';
+        }
+    }
+    fclose(f);
+
+    if (!ok || matched != 2) {
+        web_cache_entry_free(entry);
+        return -1;
+    }
+    return 0;
+}
+
+static void put_field(FILE *f, const char *key, const char *value) {
+    /* Header values carry no line breaks, but URLs are the model's */
+    if (value && !strpbrk(value, "\r\n")) {
+        fprintf(f, "%s %s\n", key, value);
+    }
+}
+
+int web_cache_store(const char *url, const char *format, const web_cache_entry_t *entry) {
+    static atomic_uint g_seq;
+    if (!web_cache_enabled() || strpbrk(url, "\r\n")) {
+        return -1;
+    }
+
+    char path[1100], tmp[1200];
+    entry_path(url, format, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.%ld.%u.tmp", path, (long)getpid(),
+             atomic_fetch_add(&g_seq, 1));
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        return -1;
+    }
+    fprintf(f, ENTRY_MAGIC "\n");
+    put_field(f, "url", url);
+    put_field(f, "format", format);
+    put_field(f, "final", entry->final_url);
+    put_field(f, "content-type", entry->content_type);
+    put_field(f, "etag", entry->etag);
+    put_field(f, "last-modified", entry->last_modified);
+    fprintf(f, "stored %lld\nage %ld\nlifetime %ld\nflags %d %d %d\n\n",
+            (long long)entry->stored, entry->age, entry->lifetime,
+            entry->no_cache, entry->must_revalidate, entry->truncated);
+    int ok = fwrite(entry->content, 1, entry->content_len, f) == entry->content_len;
+    ok = fclose(f) == 0 && ok;
+
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+void web_cache_entry_free(web_cache_entry_t *entry) {
+    free(entry->final_url);
+    free(entry->content_type);
+    free(entry->etag);
+    free(entry->last_modified);
+    free(entry->content);
+    memset(entry, 0, sizeof(*entry));
+}
@@ -0,0 +1,104 @@
+/**
+ * @file web_cache.h
+ * @brief On-disk HTTP cache of the webfetch tool
+ *
+ * A private cache in the sense of RFC 9111: one file per (URL, format)
+ * under $WEBFETCH_CACHE_DIR, else $XDG_CACHE_HOME/arc-coder/webfetch,
+ * else ~/.cache/arc-coder/webfetch. It keeps the converted content, not
+ * the page, together with what deciding its freshness needs: when it was
+ * received, its age then, its freshness lifetime (max-age, else Expires,
+ * else a tenth of the time since Last-Modified, at most a day) and its
+ * validators (ETag, Last-Modified) for revalidating it once stale.
+ *
+ * no-store responses are not kept; no-cache ones are kept but always
+ * revalidated. Files are replaced by rename, so concurrent fetches of
+ * one URL never see a partial entry. WEBFETCH_CACHE=false disables the
+ * cache.
+ */
+
+#ifndef WEB_CACHE_H
+#define WEB_CACHE_H
+
+#include <stddef.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Caching-related headers of a response (any may be NULL)
+ */
+typedef struct {
+    const char *date;
+    const char *age;
+    const char *cache_control;
+    const char *expires;
+    const char *etag;
+    const char *last_modified;
+} web_cache_headers_t;
+
+/**
+ * @brief A cached response
+ */
+typedef struct {
+    char *final_url;                 /**< After redirects */
+    char *content_type;
+    char *etag;
+    char *last_modified;
+    time_t stored;                   /**< When it was received or last revalidated */
+    long age;                        /**< Its age at that time, seconds */
+    long lifetime;                   /**< Freshness lifetime, seconds */
+    int no_cache;                    /**< Revalidate before every use */
+    int must_revalidate;             /**< Never serve it stale */
+    int truncated;                   /**< Content was cut at the size cap */
+    char *content;
+    size_t content_len;
+} web_cache_entry_t;
+
+/**
+ * @brief Whether the cache is enabled (WEBFETCH_CACHE)
+ */
+int web_cache_enabled(void);
+
+/**
+ * @brief Look an entry up
+ *
+ * @return 0 and the entry (web_cache_entry_free() it), -1 if not cached
+ */
+int web_cache_lookup(const char *url, const char *format, web_cache_entry_t *entry);
+
+/**
+ * @brief Whether an entry may be used without asking the server
+ */
+int web_cache_is_fresh(const web_cache_entry_t *entry, time_t now);
+
+/**
+ * @brief Set an entry's freshness and validators from response headers
+ *
+ * For a 304, headers the response leaves out keep their stored values.
+ *
+ * @param received  When the response arrived
+ * @return 1 if the response may be stored, 0 if not (no-store, or
+ *         neither fresh for a while nor revalidatable)
+ */
+int web_cache_apply_headers(web_cache_entry_t *entry, const web_cache_headers_t *headers,
+                            time_t received);
+
+/**
+ * @brief Write an entry (replacing an older one)
+ *
+ * @return 0, -1 on I/O errors (the fetch result is unaffected)
+ */
+int web_cache_store(const char *url, const char *format, const web_cache_entry_t *entry);
+
+/**
+ * @brief Free what an entry owns
+ */
+void web_cache_entry_free(web_cache_entry_t *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WEB_CACHE_H */
@@ -0,0 +1,81 @@
+# stack_report.cmake
+# Lists ac_core's largest stack frames from -fstack-usage output
+#
+# Input variables:
+#   SU_DIR     - Build directory holding the .su files (searched recursively)
+#   SOURCE_DIR - ac_core source directory (paths are shown relative to it)
+#   TOP        - Number of functions to list (default 40)
+#
+# A frame marked "dynamic" also uses alloca/VLA space on top of the
+# figure shown. The deepest path through the run loop is what a task
+# stack must hold: add up the frames of the functions it calls.
+
+cmake_minimum_required(VERSION 3.14)
+
+if(NOT TOP)
+    set(TOP 40)
+endif()
+
+file(GLOB_RECURSE SU_FILES "${SU_DIR}/*.su")
+if(NOT SU_FILES)
+    message(FATAL_ERROR "No .su files under ${SU_DIR}: build ac_core with ARC_STACK_USAGE=ON")
+endif()
+
+# One entry per function: "<bytes, zero-padded>|<bytes>|<qualifier>|<function>|<location>"
+set(ENTRIES "")
+foreach(su ${SU_FILES})
+    file(STRINGS "${su}" lines)
+    foreach(line ${lines})
+        # path:line:column:function<TAB>bytes<TAB>qualifier
+        if(NOT line MATCHES "^(.*):([0-9]+):[0-9]+:([^\t]+)\t([0-9]+)\t(.*)$")
+            continue()
+        endif()
+        set(path "${CMAKE_MATCH_1}")
+        set(lineno "${CMAKE_MATCH_2}")
+        set(func "${CMAKE_MATCH_3}")
+        set(bytes "${CMAKE_MATCH_4}")
+        set(qualifier "${CMAKE_MATCH_5}")
+
+        file(RELATIVE_PATH rel "${SOURCE_DIR}" "${path}")
+        if(rel MATCHES "^\\.\\.")
+            set(rel "${path}")
+        endif()
+
+        string(LENGTH "${bytes}" digits)
+        math(EXPR pad "10 - ${digits}")
+        string(REPEAT "0" ${pad} zeros)
+        list(APPEND ENTRIES "${zeros}${bytes}|${bytes}|${qualifier}|${func}|${rel}:${lineno}")
+    endforeach()
+endforeach()
+
+list(SORT ENTRIES ORDER DESCENDING)
+list(LENGTH ENTRIES count)
+
+message("ac_core stack usage: ${count} functions, largest ${TOP} frames")
+message("")
+message("     bytes  kind             function")
+
+set(shown 0)
+foreach(entry ${ENTRIES})
+    if(shown GREATER_EQUAL TOP)
+        break()
+    endif()
+    string(REPLACE "|" ";" fields "${entry}")
+    list(GET fields 1 bytes)
+    list(GET fields 2 qualifier)
+    list(GET fields 3 func)
+    list(GET fields 4 location)
+
+    string(LENGTH "${bytes}" len)
+    math(EXPR pad "10 - ${len}")
+    string(REPEAT " " ${pad} indent)
+    string(LENGTH "${qualifier}" len)
+    math(EXPR pad "17 - ${len}")
+    if(pad LESS 1)
+        set(pad 1)
+    endif()
+    string(REPEAT " " ${pad} gap)
+
+    message("${indent}${bytes}  ${qualifier}${gap}${func}  (${location})")
+    math(EXPR shown "${shown} + 1")
+endforeach()
@@ -37,6 +37,7 @@
 
 /* Core headers */
 #include "arc/error.h"
+#include "arc/allocator.h"
 #include "arc/arena.h"
 #include "arc/session.h"
 #include "arc/agent.h"
@@ -44,8 +45,12 @@
 #include "arc/tool.h"
 #include "arc/mcp.h"
 #include "arc/llm.h"
+#include "arc/tokens.h"
 #include "arc/log.h"
 #include "arc/trace.h"
+#include "arc/metrics.h"
+#include "arc/profile.h"
+#include "arc/priority.h"
 
 
 #ifdef __cplusplus
@@ -0,0 +1,70 @@
+/**
+ * @file affinity.h
+ * @brief CPU and NUMA placement of arc's threads
+ *
+ * The session executor's workers (ac_session_set_executor_affinity())
+ * and the HTTP pool's I/O thread (ac_http_pool_config_t.io_affinity)
+ * can be pinned. On a multi-socket host AC_AFFINITY_NUMA spreads the
+ * workers over the nodes, each allowed on every CPU of its node, and
+ * workers steal from siblings on their own node first. With local_memory
+ * the arena blocks such a thread allocates are placed on its node, and
+ * the arena block cache hands freed blocks back to threads of the node
+ * they live on.
+ *
+ * Placement is best effort: where the platform cannot pin (or reports a
+ * single node) threads run unpinned and nothing fails.
+ */
+
+#ifndef ARC_AFFINITY_H
+#define ARC_AFFINITY_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    AC_AFFINITY_NONE = 0,           /**< Threads float (default) */
+    AC_AFFINITY_CPUS,               /**< Thread i on cpus[i % cpu_count] */
+    AC_AFFINITY_NUMA                /**< Thread i on the CPUs of node i % nodes */
+} ac_affinity_mode_t;
+
+/**
+ * @brief Placement of a group of threads
+ */
+typedef struct {
+    ac_affinity_mode_t mode;
+    const int *cpus;                /**< AC_AFFINITY_CPUS: CPU ids (copied by the setters) */
+    size_t cpu_count;
+    int local_memory;               /**< Place arena blocks allocated on these threads on their node */
+} ac_affinity_t;
+
+/**
+ * @brief Node thread index of the group is placed on
+ *
+ * @return Node, -1 if the thread is not placed (AC_AFFINITY_NONE, NULL)
+ */
+int ac_affinity_node_of(const ac_affinity_t *affinity, size_t index);
+
+/**
+ * @brief Pin the calling thread as thread index of the group
+ *
+ * Records the node for ac_affinity_memory_node() when local_memory is set.
+ *
+ * @return Node the thread was placed on, -1 if not placed
+ */
+int ac_affinity_apply(const ac_affinity_t *affinity, size_t index);
+
+/**
+ * @brief Node the calling thread's arena blocks are placed on
+ *
+ * @return Node, -1 if the thread was not placed with local_memory
+ */
+int ac_affinity_memory_node(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_AFFINITY_H */
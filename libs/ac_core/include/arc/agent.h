@@ -46,6 +46,7 @@
 #include "session.h"
 #include "llm.h"
 #include "tool.h"
+#include "memory.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -90,6 +91,71 @@ typedef struct {
  * Agent Configuration
  *============================================================================*/
 
+/**
+ * @brief Outcome of a draft iteration (see ac_agent_draft_t)
+ *
+ * Reported in the llm_response hook and trace event of the draft call.
+ */
+typedef enum {
+    AC_DRAFT_NONE = 0,               /**< Not a draft call */
+    AC_DRAFT_ACCEPTED,               /**< Draft tool calls executed as proposed */
+    AC_DRAFT_DECLINED,               /**< Draft answered in text: escalated */
+    AC_DRAFT_REJECTED,               /**< Draft failed the checks: escalated */
+    AC_DRAFT_FAILED                  /**< Draft request failed: escalated */
+} ac_draft_decision_t;
+
+/**
+ * @brief Fast model drafting tool-routing iterations
+ *
+ * Each ReACT iteration of a sync run first goes to the draft model, with
+ * the same history and tools. Its tool calls are executed as proposed
+ * when the response was not cut off, every call names a registered tool
+ * with a JSON object as arguments, and there are at most max_tool_calls.
+ * Anything else - a text answer, a failed check, an error - re-asks the
+ * iteration of the agent's llm, so final answers always come from it.
+ * Streaming runs do not draft.
+ */
+typedef struct {
+    ac_llm_params_t llm;             /**< Draft model (provider NULL = off) */
+    int max_tool_calls;              /**< Escalate drafts with more calls (0 = no limit) */
+} ac_agent_draft_t;
+
+/**
+ * @brief Why an iteration got its thinking budget and max_tokens
+ *
+ * Reported in the llm_request hook and trace event.
+ */
+typedef enum {
+    AC_BUDGET_FIXED = 0,             /**< Controller off: configured values */
+    AC_BUDGET_OPEN,                  /**< Turn on a new user message: full budget */
+    AC_BUDGET_TOOL_RESULT,           /**< Turn after tool results: sized to the last turn's thinking */
+    AC_BUDGET_ESCALATED,             /**< Last turn was cut off or used its whole budget */
+    AC_BUDGET_SLO                    /**< Cut to fit latency_slo_ms */
+} ac_budget_reason_t;
+
+/**
+ * @brief Thinking budget and max_tokens picked per iteration
+ *
+ * Off, every call gets llm.thinking.budget_tokens and llm.max_tokens. On,
+ * the turn answering a new user message gets the full budget, and a turn
+ * after tool results (mostly routing the next call) twice the thinking
+ * the previous turn used, at least min_thinking. A turn after one that
+ * was cut off (finish reason length) or used its whole budget gets the
+ * full budget and max_tokens. With a latency SLO, turns that are not
+ * escalated get no more thinking than the observed output rate produces
+ * in that time, again at least min_thinking.
+ *
+ * max_tokens follows the thinking budget: it is the budget plus the room
+ * the configuration leaves for the answer (llm.max_tokens less
+ * llm.thinking.budget_tokens). Without thinking only escalation changes it.
+ */
+typedef struct {
+    int enabled;                     /**< 1 = adapt per iteration */
+    int min_thinking;                /**< Smallest thinking budget (0 = 1024) */
+    int max_tokens;                  /**< max_tokens of escalated turns (0 = llm.max_tokens) */
+    uint32_t latency_slo_ms;         /**< Target duration of one call (0 = none) */
+} ac_agent_budget_t;
+
 /**
  * @brief Agent configuration parameters
  *
@@ -128,7 +194,13 @@ typedef struct {
     ac_llm_params_t llm;             /**< LLM configuration */
     ac_tool_registry_t *tools;       /**< Tool registry (optional) */
     int max_iterations;              /**< Max ReACT loops (default: 10) */
+    int tool_workers;                /**< Max concurrent tool calls per turn (0/1 = sequential) */
+    int eager_tools;                 /**< Streaming: start parallel-safe tools as their blocks complete */
+    ac_memory_config_t memory;       /**< History budget (max_messages/max_tokens/max_tool_bytes, 0 = unlimited) */
     ac_agent_callbacks_t callbacks;  /**< Streaming callbacks (optional) */
+    ac_agent_draft_t draft;          /**< Fast model for tool-routing iterations (optional) */
+    ac_agent_budget_t budget;        /**< Per-iteration thinking budget and max_tokens (optional) */
+    ac_priority_t priority;          /**< Class of this agent's runs, tool jobs and requests (overrides NORMAL llm.priority) */
 } ac_agent_params_t;
 
 /*============================================================================
@@ -160,12 +232,384 @@ ac_agent_t *ac_agent_create(ac_session_t *session, const ac_agent_params_t *para
  */
 ac_agent_result_t *ac_agent_run(ac_agent_t *agent, const char *message);
 
+/**
+ * @brief Run agent synchronously with images attached to the message
+ *
+ * Each image becomes an AC_BLOCK_IMAGE block of the user message (see
+ * ac_block_create_image()). Files are read while each request is sent,
+ * so they must stay unchanged while the conversation holds them; buffers
+ * must outlive the agent.
+ *
+ * @param agent    Agent handle
+ * @param message  User message
+ * @param images   Attachments (path or data, media_type optional)
+ * @param count    Number of images
+ * @return Result (owned by agent's arena), NULL on error (including an
+ *         image that cannot be read or is not PNG, JPEG, GIF or WebP)
+ */
+ac_agent_result_t *ac_agent_run_attached(ac_agent_t *agent, const char *message,
+                                         const ac_attachment_t *images, size_t count);
+
+/**
+ * @brief Add a message to the run in progress (thread-safe)
+ *
+ * For follow-ups typed while the agent is still working. The message is
+ * copied and queued; at the next iteration boundary (after the current
+ * tool results, or after the answer, which then no longer ends the run)
+ * everything queued goes into history as one user message and the
+ * model sees it in the same run. The run's result is the answer to the
+ * whole exchange.
+ *
+ * Once the run has answered with nothing queued it is closing and sends
+ * are refused: start a new run with the message instead. A message the
+ * run could not take any more (it failed, was cancelled or reached
+ * max_iterations) is placed ahead of the next run's message.
+ *
+ * @param agent    Agent handle
+ * @param message  User message
+ * @return ARC_OK if queued, ARC_ERR_INVALID_STATE if no run can take it
+ */
+arc_err_t ac_agent_send(ac_agent_t *agent, const char *message);
+
+/**
+ * @brief Stop the run in progress, whatever started it (thread-safe)
+ *
+ * In-flight model requests (including retry back-off and rate limit
+ * queues) and MCP calls are aborted within milliseconds, tools see
+ * ac_tool_ctx_cancelled() and tool calls not yet started are skipped.
+ * The run then ends with a result whose content is NULL. No-op when the
+ * agent is idle.
+ *
+ * If params.llm.cancel was set, in-flight work watches that flag instead
+ * and this call only takes effect between iterations; setting the flag
+ * stops the run just like this call does.
+ */
+void ac_agent_cancel(ac_agent_t *agent);
+
+/**
+ * @brief Absolute deadline for runs (ac_platform_timestamp_ms, 0 = none)
+ *
+ * Model requests are cut to the time left and not retried past it; tools
+ * get it in ac_tool_ctx_t. Once it passes the run stops as if cancelled.
+ * Read when a run starts: a change during a run only applies at the
+ * next iteration boundary.
+ */
+void ac_agent_set_deadline(ac_agent_t *agent, uint64_t deadline_ms);
+
+/*============================================================================
+ * Async Run API
+ *============================================================================*/
+
+/**
+ * @brief Async run handle
+ *
+ * Returned by ac_agent_run_async(). Must be released with
+ * ac_agent_run_release() once the caller is done with it.
+ */
+typedef struct ac_agent_run ac_agent_run_t;
+
+/**
+ * @brief Async run state
+ */
+typedef enum {
+    AC_RUN_PENDING = 0,              /**< Queued, not started */
+    AC_RUN_RUNNING,                  /**< Executing on a worker */
+    AC_RUN_DONE,                     /**< Finished with a result */
+    AC_RUN_FAILED,                   /**< Finished without a result */
+    AC_RUN_CANCELLED                 /**< Cancelled before completion */
+} ac_run_status_t;
+
+/**
+ * @brief Completion callback
+ *
+ * Invoked on the worker thread before waiters are woken.
+ * result is NULL if the run failed or was cancelled.
+ */
+typedef void (*ac_agent_done_fn)(
+    ac_agent_t *agent,
+    ac_agent_result_t *result,
+    void *user_data
+);
+
+/**
+ * @brief Run agent asynchronously
+ *
+ * Queues the run on the session executor (ARC_SESSION_EXECUTOR_THREADS
+ * workers shared by all agents in the session) and returns immediately.
+ * An agent runs one conversation at a time; ac_agent_run() and further
+ * async runs on the same agent fail until this one completes.
+ *
+ * On FreeRTOS the run goes to the session's queue and executes on a
+ * pool task. Without thread support it executes inline and the returned
+ * handle is already complete.
+ *
+ * @param agent      Agent handle
+ * @param message    User message (copied)
+ * @param on_done    Completion callback (optional)
+ * @param user_data  Passed to on_done
+ * @return Run handle, NULL on error
+ */
+ac_agent_run_t *ac_agent_run_async(
+    ac_agent_t *agent,
+    const char *message,
+    ac_agent_done_fn on_done,
+    void *user_data
+);
+
+/**
+ * @brief Get the current state of a run (non-blocking)
+ */
+ac_run_status_t ac_agent_run_poll(ac_agent_run_t *run);
+
+/**
+ * @brief Block until the run completes
+ *
+ * @return Result (owned by agent's arena), NULL if failed or cancelled
+ */
+ac_agent_result_t *ac_agent_run_wait(ac_agent_run_t *run);
+
+/**
+ * @brief Request cancellation
+ *
+ * A queued run is dropped; a running one stops like ac_agent_cancel().
+ */
+void ac_agent_run_cancel(ac_agent_run_t *run);
+
+/**
+ * @brief Release a run handle
+ *
+ * The run itself is not cancelled; its completion callback still fires.
+ */
+void ac_agent_run_release(ac_agent_run_t *run);
+
+/*============================================================================
+ * Stepped Run API
+ *============================================================================*/
+
+/**
+ * @brief Where a stepped run stands
+ */
+typedef enum {
+    AC_STEP_AWAIT_LLM = 0,           /**< Model request in flight */
+    AC_STEP_AWAIT_TOOLS,             /**< Tool calls executing */
+    AC_STEP_DONE                     /**< Finished (or no stepped run) */
+} ac_step_state_t;
+
+/**
+ * @brief Called when a stepped run's pending work has finished
+ *
+ * Invoked on the worker thread that did the work, or on the HTTP
+ * engine's I/O thread (the host loop with an external_loop pool) for a
+ * model request; it should only wake the thread that steps the agent
+ * (eventfd, uv_async_send, ...) and must not call ac_agent_step() itself.
+ */
+typedef void (*ac_agent_wake_fn)(ac_agent_t *agent, void *user_data);
+
+/**
+ * @brief Start a run that is advanced with ac_agent_step()
+ *
+ * The ReACT loop runs as a state machine instead of on the caller's
+ * stack: model requests go out on the HTTP pool's shared engine and
+ * tool batches execute on the session executor, while everything in
+ * between (history, hooks, budget enforcement) runs inside
+ * ac_agent_step() on the caller's thread. One thread can thus drive
+ * many conversations, stepping each agent when its wake callback fires.
+ * Model calls the engine cannot take (no pool, rate limiting, draft
+ * routing, chained responses, retry backoff; see ac_llm_chat_submit())
+ * run on the executor instead.
+ *
+ * @code
+ * ac_agent_start(agent, "Summarize the report", on_wake, loop);
+ * // on each wake for this agent:
+ * ac_agent_result_t *result;
+ * if (ac_agent_step(agent, &result) == AC_STEP_DONE) {
+ *     handle(result);
+ * }
+ * @endcode
+ *
+ * With message NULL the run continues the history as it stands, which
+ * must end with a user or tool message: restore a snapshot saved between
+ * steps and start again to resume an interrupted run.
+ *
+ * Stepped runs do not stream (on_stream is not called). Without worker
+ * threads each phase runs inline in the start/step call that submits it.
+ * The agent must not be destroyed while a phase is pending; closing the
+ * session first finishes or drops pending phases.
+ *
+ * @param agent      Agent handle (not running)
+ * @param message    User message (copied into history), NULL to resume
+ * @param wake       Completion callback for pending phases (optional: poll)
+ * @param user_data  Passed to wake
+ * @return ARC_OK, ARC_ERR_INVALID_STATE (already running, or nothing to
+ *         resume), ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_agent_start(
+    ac_agent_t *agent,
+    const char *message,
+    ac_agent_wake_fn wake,
+    void *user_data
+);
+
+/**
+ * @brief Advance a stepped run as far as it goes without blocking
+ *
+ * Returns at once while a phase is still pending. Once it has finished,
+ * records its outcome and submits the next phase. Call from one thread.
+ *
+ * @param agent   Agent handle
+ * @param result  Set when AC_STEP_DONE is returned: the result (as from
+ *                ac_agent_run(), owned by the agent's arena), NULL if the
+ *                run failed; NULL otherwise (optional)
+ * @return State after this step; AC_STEP_DONE ends the run, the agent
+ *         is free for the next one
+ */
+ac_step_state_t ac_agent_step(ac_agent_t *agent, ac_agent_result_t **result);
+
+/**
+ * @brief Stop a stepped run
+ *
+ * Same as ac_agent_cancel(): a pending model request or tool batch is
+ * aborted and the step after it returns AC_STEP_DONE with a result
+ * whose content is NULL.
+ */
+void ac_agent_step_cancel(ac_agent_t *agent);
+
+/*============================================================================
+ * Snapshot API
+ *============================================================================*/
+
+/**
+ * @brief Save the agent's conversation history as a binary snapshot
+ *
+ * The file is a flat image (records with offsets, string pool) meant to
+ * be restored in place by ac_agent_snapshot_restore(). It is written to
+ * a temporary name and renamed, so a crash never leaves a partial file.
+ * Snapshots use native byte order and are not portable across machines.
+ *
+ * Also allowed between ac_agent_step() calls of a stepped run (from the
+ * stepping thread): the snapshot then checkpoints the run so far, and
+ * ac_agent_start() with a NULL message resumes it after a restore.
+ *
+ * @param agent  Agent handle (not running, or stepped)
+ * @param path   Snapshot file
+ * @return ARC_OK, ARC_ERR_INVALID_STATE if a run is in progress, ARC_ERR_IO
+ */
+arc_err_t ac_agent_snapshot_save(ac_agent_t *agent, const char *path);
+
+/**
+ * @brief Replace the agent's history with a saved snapshot
+ *
+ * The file is memory-mapped and restored messages point into the
+ * mapping; only the list nodes, and messages added by later runs, are
+ * allocated from the agent arena. The mapping is released when the
+ * agent is destroyed. On error the current history is left unchanged.
+ *
+ * @param agent  Agent handle (must not be running)
+ * @param path   Snapshot file written by ac_agent_snapshot_save()
+ * @return ARC_OK, ARC_ERR_NOT_FOUND, ARC_ERR_PARSE (not a snapshot or
+ *         corrupt), ARC_ERR_INVALID_STATE if a run is in progress
+ */
+arc_err_t ac_agent_snapshot_restore(ac_agent_t *agent, const char *path);
+
+/*============================================================================
+ * Shared History
+ *============================================================================*/
+
+/**
+ * @brief Immutable, reference-counted run of messages
+ *
+ * Lets several agents start from one conversation without copying it:
+ * hand a finished conversation to the next agent, or branch it to try
+ * several approaches in parallel.
+ *
+ * @code
+ * ac_history_segment_t *seg;
+ * ac_agent_history_share(planner, &seg);
+ * for (int i = 0; i < 3; i++) {
+ *     ac_agent_history_attach(branch[i], seg);
+ *     runs[i] = ac_agent_run_async(branch[i], approach[i], NULL, NULL);
+ * }
+ * ac_history_segment_release(seg);
+ * @endcode
+ */
+typedef struct ac_history_segment ac_history_segment_t;
+
+/**
+ * @brief Freeze the agent's history into a segment
+ *
+ * The first share copies the history once. After that, while the agent
+ * only appends (no trimming or eviction happened), sharing copies just
+ * the messages added since its last share or attach; the new segment
+ * references the old one as its prefix.
+ *
+ * @param agent  Agent handle (must not be running)
+ * @param out    New reference, release with ac_history_segment_release()
+ * @return ARC_OK, ARC_ERR_INVALID_STATE if a run is in progress,
+ *         ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_agent_history_share(ac_agent_t *agent, ac_history_segment_t **out);
+
+/**
+ * @brief Replace the agent's history with a segment
+ *
+ * Only list nodes are allocated from the agent arena; message strings
+ * and serialized request fragments stay in the segment, which the agent
+ * references until it is destroyed. Later runs append and trim the
+ * agent's own view, never the segment.
+ *
+ * With instructions that differ from the segment's leading system
+ * message, the agent's own system message replaces it, so a handoff
+ * target keeps its role.
+ *
+ * @param agent    Agent handle (must not be running)
+ * @param segment  Segment from ac_agent_history_share()
+ * @return ARC_OK, ARC_ERR_INVALID_STATE if a run is in progress,
+ *         ARC_ERR_NO_MEMORY (history left unchanged)
+ */
+arc_err_t ac_agent_history_attach(ac_agent_t *agent, ac_history_segment_t *segment);
+
+/**
+ * @brief Create a child agent that continues this agent's conversation
+ *
+ * The child has the same configuration (instructions, llm, draft, tools,
+ * memory limits, stream callback) and starts from the parent's history
+ * as a shared segment, so forking copies no message strings; forks taken
+ * at the same point share one segment. Agent-level hooks are not copied.
+ * The child belongs to the session like any agent and runs independently
+ * of the parent and its siblings, e.g. one async run per fork for
+ * best-of-N. With a stateful provider it continues the parent's stored
+ * response, and the shared prefix keeps hitting the prompt cache.
+ *
+ * @param agent  Parent (must not be running)
+ * @return Child agent, NULL on error or if the parent is running
+ */
+ac_agent_t *ac_agent_fork(ac_agent_t *agent);
+
+/**
+ * @brief Take another reference to a segment
+ *
+ * @return segment
+ */
+ac_history_segment_t *ac_history_segment_retain(ac_history_segment_t *segment);
+
+/**
+ * @brief Drop a reference (NULL-safe); the last one frees the segment
+ */
+void ac_history_segment_release(ac_history_segment_t *segment);
+
+/**
+ * @brief Number of messages in a segment, its prefix included
+ */
+size_t ac_history_segment_count(const ac_history_segment_t *segment);
+
 /**
  * @brief Destroy an agent
  *
- * Destroys the agent and frees its arena.
+ * Destroys the agent and frees its arena, taking it out of its session.
  * Note: Normally you don't need to call this directly - agents are
- * automatically destroyed when their session is closed.
+ * automatically destroyed when their session is closed. Agents made for
+ * one job (a sub-agent per tool call) should be, so their arenas do not
+ * pile up until then. Not while a run of the agent is in progress.
  *
  * @param agent  Agent handle
  */
@@ -176,6 +620,7 @@ void ac_agent_destroy(ac_agent_t *agent);
  *============================================================================*/
 
 #define AC_AGENT_DEFAULT_MAX_ITERATIONS  10
+#define AC_AGENT_MAX_TOOL_WORKERS        16
 
 #ifdef __cplusplus
 }
@@ -9,6 +9,14 @@
  * Compile-time control:
  * - Define AC_DISABLE_HOOKS to completely disable hooks (zero overhead)
  *
+ * Scopes:
+ * - Global (ac_agent_set_hooks): every agent in the process
+ * - Session (ac_session_add_hooks): agents of one session
+ * - Agent (ac_agent_add_hooks): one agent
+ * Sessions and agents take several subscribers; each event goes to the
+ * global hooks, then the session's, then the agent's, in the order they
+ * were added. Agents nobody listens to skip building the hook info.
+ *
  * Use cases:
  * - Tracing/observability (ac_trace module)
  * - Metrics collection
@@ -34,6 +42,11 @@
  *
  * // Unregister hooks
  * ac_agent_set_hooks(NULL);
+ *
+ * // Or observe a single agent
+ * ac_agent_add_hooks(agent, &hooks);
+ * ac_agent_run(agent, "Hello");
+ * ac_agent_remove_hooks(agent, &hooks);
  * @endcode
  */
 
@@ -42,12 +55,17 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "arc/arena.h"
+#include "arc/error.h"
 #include "arc/message.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct ac_agent ac_agent_t;
+typedef struct ac_session ac_session_t;
+
 /*============================================================================
  * Hook Info Structures
  *
@@ -76,6 +94,7 @@ typedef struct {
     int total_prompt_tokens;     /**< Total prompt tokens used */
     int total_completion_tokens; /**< Total completion tokens used */
     uint64_t duration_ms;        /**< Total execution time in ms */
+    const arena_telemetry_t *arena; /**< Agent arena telemetry (may be NULL) */
 } ac_hook_run_end_t;
 
 /**
@@ -99,6 +118,9 @@ typedef struct {
     const ac_message_t *messages;     /**< Message list (raw pointer) */
     const char *tools_schema;         /**< Tools schema as JSON (may be NULL) */
     size_t message_count;             /**< Number of messages */
+    int max_tokens;                   /**< max_tokens of this call (0 = provider default) */
+    int thinking_budget;              /**< Thinking budget of this call (0 = thinking off) */
+    int budget_reason;                /**< ac_budget_reason_t of both */
 } ac_hook_llm_request_t;
 
 /**
@@ -117,6 +139,10 @@ typedef struct {
     int total_tokens;                 /**< Total tokens used */
     const char *finish_reason;        /**< Finish reason */
     uint64_t duration_ms;             /**< LLM request duration in ms */
+    uint32_t ratelimit_wait_ms;       /**< Part of duration_ms queued by the rate limiter */
+    int draft;                        /**< ac_draft_decision_t of a draft call (0 = not one) */
+    int thinking_tokens;              /**< Thinking/reasoning tokens (reported or estimated, 0 = none) */
+    ac_llm_timing_t timing;           /**< Connect, first byte/token, inter-token gaps */
 } ac_hook_llm_response_t;
 
 /**
@@ -139,8 +165,40 @@ typedef struct {
     const char *result;          /**< Tool result as JSON */
     uint64_t duration_ms;        /**< Tool execution time in ms */
     int success;                 /**< 1 if successful, 0 if error */
+    int cache_status;            /**< ac_tool_cache_status_t of this call */
+    uint64_t cache_hits;         /**< Registry's MCP result cache hits so far */
+    uint64_t cache_misses;       /**< Registry's MCP result cache misses so far */
+    uint64_t processes;          /**< Commands the call ran (ac_tool_usage_t) */
+    uint64_t cpu_usec;           /**< Their CPU time */
+    uint64_t memory_peak;        /**< Largest peak memory of one, bytes */
+    uint64_t io_read_bytes;      /**< Their block IO */
+    uint64_t io_write_bytes;
 } ac_hook_tool_end_t;
 
+/**
+ * @brief MCP connection events (SSE stream reconnects)
+ */
+typedef enum {
+    AC_MCP_CONN_LOST,            /**< Stream dropped, reconnecting */
+    AC_MCP_CONN_RETRY,           /**< Reconnect attempt failed, backing off */
+    AC_MCP_CONN_RESTORED         /**< Stream re-established */
+} ac_mcp_conn_event_t;
+
+/**
+ * @brief MCP connection event info
+ *
+ * Delivered on the transport's background thread, not the agent's.
+ */
+typedef struct {
+    const char *server_url;      /**< MCP server URL */
+    ac_mcp_conn_event_t event;   /**< What happened */
+    int attempt;                 /**< Failed attempts so far (RETRY, RESTORED) */
+    uint32_t delay_ms;           /**< Backoff before the next attempt (LOST, RETRY) */
+    uint64_t downtime_ms;        /**< Time since the stream was lost (RESTORED) */
+    int resumed;                 /**< RESTORED: same session, pending calls kept */
+    const char *error;           /**< Why the stream ended or the attempt failed */
+} ac_hook_mcp_connection_t;
+
 /*============================================================================
  * Agent Hooks Structure
  *============================================================================*/
@@ -171,6 +229,9 @@ typedef struct {
     void (*on_tool_start)(void *ctx, const ac_hook_tool_start_t *info);
     void (*on_tool_end)(void *ctx, const ac_hook_tool_end_t *info);
 
+    /* MCP transport (background thread) */
+    void (*on_mcp_connection)(void *ctx, const ac_hook_mcp_connection_t *info);
+
 } ac_agent_hooks_t;
 
 /*============================================================================
@@ -181,22 +242,55 @@ typedef struct {
  * @brief Set global agent hooks
  *
  * Registers hooks that will be called for all agent executions.
- * Only one set of hooks can be active at a time.
+ * Only one set of global hooks can be active at a time; use the session
+ * or agent scopes below for more subscribers.
  *
  * @param hooks Hooks structure (copied), or NULL to disable hooks
  *
- * Thread safety: This function is not thread-safe.
- * Set hooks before starting any agent runs.
+ * Thread safety: may be called while agents run. A run already inside a
+ * callback finishes it with the hooks it started with.
  */
 void ac_agent_set_hooks(const ac_agent_hooks_t *hooks);
 
 /**
  * @brief Get current hooks
  *
- * @return Current hooks, or NULL if not set
+ * @return Current global hooks (valid until they change), or NULL if not set
  */
 const ac_agent_hooks_t *ac_agent_get_hooks(void);
 
+/**
+ * @brief Subscribe hooks to every agent of a session
+ *
+ * The structure is copied; its address identifies the subscriber for
+ * ac_session_remove_hooks(). Safe while the session's agents run.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_MEMORY,
+ *         ARC_ERR_EXISTS (already subscribed)
+ */
+arc_err_t ac_session_add_hooks(ac_session_t *session, const ac_agent_hooks_t *hooks);
+
+/**
+ * @brief Unsubscribe hooks added with ac_session_add_hooks()
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_NOT_FOUND
+ */
+arc_err_t ac_session_remove_hooks(ac_session_t *session, const ac_agent_hooks_t *hooks);
+
+/**
+ * @brief Subscribe hooks to one agent
+ *
+ * Same rules as ac_session_add_hooks(). Subscribers are dropped with the
+ * agent. on_mcp_connection is only delivered to global hooks (the
+ * transport belongs to no agent).
+ */
+arc_err_t ac_agent_add_hooks(ac_agent_t *agent, const ac_agent_hooks_t *hooks);
+
+/**
+ * @brief Unsubscribe hooks added with ac_agent_add_hooks()
+ */
+arc_err_t ac_agent_remove_hooks(ac_agent_t *agent, const ac_agent_hooks_t *hooks);
+
 #ifdef __cplusplus
 }
 #endif
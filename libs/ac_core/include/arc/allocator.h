@@ -0,0 +1,157 @@
+/**
+ * @file allocator.h
+ * @brief Runtime allocator interface
+ *
+ * ArC allocates through ARC_MALLOC/ARC_FREE (platform.h). With
+ * ARC_RUNTIME_ALLOCATOR enabled (desktop default) those go through the
+ * functions below, which forward to an installable allocator: jemalloc or
+ * mimalloc arenas, counting allocators for benchmarks and leak tests.
+ *
+ * Two scopes:
+ * - Process-wide: ac_allocator_set(), once at startup before any other
+ *   ArC call. Covers every heap allocation of the library, including
+ *   cJSON and the strings handed across the API (tool results must then
+ *   be allocated with ARC_MALLOC/ac_alloc, since ArC frees them).
+ * - Per session: ac_session_open_with(). Backs the arenas of the session
+ *   and its agents, which hold nearly all per-session memory.
+ *
+ * Size-aware free: free() receives the allocation size when the caller
+ * knows it (arena blocks, most buffers) and 0 otherwise; realloc() gets
+ * old_size on the same terms.
+ *
+ * Example:
+ * @code
+ * static size_t live;
+ * static void *count_alloc(void *ctx, size_t n) { (void)ctx; live++; return malloc(n); }
+ * static void *count_realloc(void *ctx, void *p, size_t old, size_t n) {
+ *     (void)ctx; (void)old; if (!p) live++; return realloc(p, n);
+ * }
+ * static void count_free(void *ctx, void *p, size_t n) { (void)ctx; (void)n; if (p) live--; free(p); }
+ *
+ * ac_allocator_set(&(ac_allocator_t){ count_alloc, count_realloc, count_free, NULL });
+ * @endcode
+ */
+
+#ifndef ARC_ALLOCATOR_H
+#define ARC_ALLOCATOR_H
+
+#include "error.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Allocator Interface
+ *============================================================================*/
+
+/**
+ * @brief Allocator vtable
+ *
+ * All three functions are required. realloc(ctx, NULL, 0, n) must behave
+ * as alloc; free(ctx, NULL, 0) must be a no-op.
+ */
+typedef struct {
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*free)(void *ctx, void *ptr, size_t size);   /* size 0 = unknown */
+    void *ctx;                                          /* Passed to every call */
+} ac_allocator_t;
+
+/*============================================================================
+ * Process-wide Allocator
+ *============================================================================*/
+
+/**
+ * @brief Install the process-wide allocator (copied; NULL restores libc)
+ *
+ * Call before any other ArC function: memory is always freed by the
+ * allocator current at the time, so nothing may be live across a switch.
+ * Blocks held by the arena block cache are released first.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG (missing function),
+ *         ARC_ERR_NOT_IMPLEMENTED (built without ARC_RUNTIME_ALLOCATOR)
+ */
+arc_err_t ac_allocator_set(const ac_allocator_t *allocator);
+
+/**
+ * @brief Current process-wide allocator (the libc one if none installed)
+ */
+const ac_allocator_t *ac_allocator_get(void);
+
+/*============================================================================
+ * Allocation Counting
+ *
+ * A counting allocator layered over the installed one, for tests that
+ * hold code to an allocation budget ("a streaming delta allocates
+ * nothing", "appending a message allocates at most twice"):
+ *
+ * @code
+ * ac_alloc_count_start();
+ * ac_alloc_counts_t before, after;
+ * ac_alloc_count_thread(&before);
+ * sse_parser_feed(&parser, chunk, len);
+ * ac_alloc_count_thread(&after);
+ * assert(after.allocs - before.allocs == 0);
+ * ac_alloc_count_stop();
+ * @endcode
+ *
+ * Per-thread counts leave out the library's background threads (HTTP
+ * pool, executors); on targets without thread-local storage they are the
+ * process totals. Blocks allocated before start may be freed while
+ * counting and the other way round: the counter forwards every call
+ * unchanged.
+ *============================================================================*/
+
+typedef struct {
+    uint64_t allocs;                 /**< New blocks (alloc, calloc, realloc of NULL) */
+    uint64_t reallocs;               /**< Resizes of existing blocks */
+    uint64_t frees;                  /**< Blocks freed */
+    uint64_t bytes;                  /**< Bytes requested by allocs and reallocs */
+} ac_alloc_counts_t;
+
+/**
+ * @brief Start counting on top of the current allocator
+ *
+ * Same rules as ac_allocator_set(): call it while no other thread is in
+ * ArC, e.g. in a test's setup.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_STATE (already counting),
+ *         ARC_ERR_NOT_IMPLEMENTED (built without ARC_RUNTIME_ALLOCATOR)
+ */
+arc_err_t ac_alloc_count_start(void);
+
+/**
+ * @brief Put back the allocator that was current at start
+ */
+void ac_alloc_count_stop(void);
+
+/**
+ * @brief Calling thread's counts so far (compare two readings)
+ */
+void ac_alloc_count_thread(ac_alloc_counts_t *counts);
+
+/**
+ * @brief All threads' counts since ac_alloc_count_start()
+ */
+void ac_alloc_count_total(ac_alloc_counts_t *counts);
+
+/*============================================================================
+ * Allocation Functions (what ARC_MALLOC & co. expand to)
+ *============================================================================*/
+
+void *ac_alloc(size_t size);
+void *ac_calloc(size_t n, size_t size);
+void *ac_realloc(void *ptr, size_t size);
+void ac_free(void *ptr);
+void ac_free_sized(void *ptr, size_t size);
+char *ac_strdup(const char *s);
+char *ac_strndup(const char *s, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_ALLOCATOR_H */
@@ -5,8 +5,17 @@
  * Provides efficient arena-based memory allocation with automatic expansion.
  * Features:
  * - Automatic block chaining when capacity is exceeded
- * - Thread-safe mode (optional, via ARC_ARENA_THREAD_SAFE)
+ * - Thread-safe mode (optional, via ARC_ARENA_THREAD_SAFE): lock-free
+ *   allocation, a mutex only when a block fills up
+ * - Checkpoints: arena_mark()/arena_rewind() release everything allocated
+ *   after a mark, keeping earlier allocations intact
  * - All memory is freed at once when the arena is destroyed
+ * - Block cache: destroyed arenas hand their blocks to a process-wide
+ *   cache (power-of-two size classes, ARC_ARENA_CACHE_SIZE bytes at
+ *   most) that new arenas draw from before calling malloc
+ * - Telemetry: allocations are attributed to the arena's current tag
+ *   (arena_set_tag()); arena_get_telemetry() reports per-tag bytes, the
+ *   high-water mark and bytes stranded at the ends of filled blocks
  *
  * Example:
  * @code
@@ -14,13 +23,22 @@
  * char *buf = arena_alloc(arena, 4096);        // Auto-expands if needed
  * arena_destroy(arena);                         // Frees all blocks
  * @endcode
+ *
+ * Scratch scope:
+ * @code
+ * arena_scratch_t scratch = arena_scratch_begin(arena);
+ * char *tmp = arena_alloc(arena, 256);         // Transient
+ * arena_scratch_end(&scratch);                  // tmp released, memory kept
+ * @endcode
  */
 
 #ifndef ARC_ARENA_H
 #define ARC_ARENA_H
 
+#include "allocator.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,6 +50,30 @@ extern "C" {
 
 typedef struct arena_ arena_t;
 
+/*============================================================================
+ * Strings with Length
+ *============================================================================*/
+
+/**
+ * @brief A string and its length
+ *
+ * ptr stays NUL-terminated, so it can still be passed on as a C string,
+ * but len is what counts: the bytes may contain NULs, and whoever holds
+ * the pair never has to strlen() it again.
+ */
+typedef struct {
+    const char *ptr;            /* NULL = absent */
+    size_t len;                 /* Bytes before the terminating NUL */
+} ac_str_t;
+
+/**
+ * @brief A C string as ac_str_t (measured once)
+ */
+static inline ac_str_t ac_str(const char *s) {
+    ac_str_t str = { s, s ? strlen(s) : 0 };
+    return str;
+}
+
 /*============================================================================
  * Arena Statistics
  *============================================================================*/
@@ -44,8 +86,74 @@ typedef struct {
     size_t total_allocated;     /* Total bytes allocated */
     size_t block_count;         /* Number of blocks */
     size_t largest_block;       /* Size of largest block */
+    size_t cache_hits;          /* Blocks taken from the block cache */
+    size_t cache_misses;        /* Blocks that had to be allocated */
 } arena_stats_t;
 
+/*============================================================================
+ * Arena Telemetry
+ *============================================================================*/
+
+/**
+ * @brief Allocation-site tags
+ *
+ * Values from ARENA_TAG_USER up to ARENA_TAG_MAX - 1 are free for
+ * application use.
+ */
+typedef enum {
+    ARENA_TAG_OTHER = 0,        /* Untagged */
+    ARENA_TAG_HISTORY,          /* Conversation messages */
+    ARENA_TAG_LLM,              /* Provider responses and requests */
+    ARENA_TAG_TOOLS,            /* Tool calls and results */
+    ARENA_TAG_MCP,              /* MCP client state */
+    ARENA_TAG_MEMORY,           /* Persistent memory and snapshots */
+    ARENA_TAG_USER = 8,
+    ARENA_TAG_MAX = 16
+} arena_tag_t;
+
+/**
+ * @brief Bytes attributed to one tag (cumulative since arena_create())
+ */
+typedef struct {
+    size_t bytes;               /* Bytes allocated, after alignment */
+    size_t count;               /* Number of allocations */
+} arena_tag_stats_t;
+
+/**
+ * @brief Arena telemetry (see arena_get_telemetry())
+ */
+typedef struct {
+    size_t total_capacity;      /* Total capacity across all blocks */
+    size_t total_allocated;     /* Bytes allocated now */
+    size_t peak_allocated;      /* High-water mark of total_allocated */
+    size_t wasted_tail;         /* Unused bytes at the end of filled blocks */
+    arena_tag_stats_t tags[ARENA_TAG_MAX];  /* Zero unless ARC_ARENA_TELEMETRY */
+} arena_telemetry_t;
+
+/*============================================================================
+ * Arena Checkpoints
+ *============================================================================*/
+
+/**
+ * @brief Allocation position returned by arena_mark()
+ *
+ * Treat as opaque. A mark is invalidated by rewinding to an earlier mark
+ * or by arena_reset().
+ */
+typedef struct {
+    void *block;                /* Block current at mark time */
+    size_t used;                /* Bytes used in that block */
+    size_t allocated;           /* total_allocated at mark time */
+} arena_mark_t;
+
+/**
+ * @brief Scoped scratch region (see arena_scratch_begin())
+ */
+typedef struct {
+    arena_t *arena;
+    arena_mark_t mark;
+} arena_scratch_t;
+
 /*============================================================================
  * Arena API
  *============================================================================*/
@@ -62,6 +170,18 @@ typedef struct {
  */
 arena_t* arena_create(size_t capacity);
 
+/**
+ * @brief Create an arena whose blocks come from allocator
+ *
+ * Such arenas do not use the block cache. The allocator must outlive the
+ * arena.
+ *
+ * @param capacity   Initial capacity in bytes (minimum 4KB enforced)
+ * @param allocator  Allocator for blocks (NULL = same as arena_create())
+ * @return Arena handle, NULL on error
+ */
+arena_t* arena_create_with(size_t capacity, const ac_allocator_t *allocator);
+
 /**
  * @brief Allocate memory from arena
  *
@@ -84,6 +204,18 @@ char* arena_alloc(arena_t *arena, size_t size);
  */
 char* arena_strdup(arena_t *arena, const char* str);
 
+/**
+ * @brief Duplicate len bytes in arena, NUL-terminated
+ *
+ * Embedded NULs are copied like any other byte.
+ *
+ * @param arena  Arena handle
+ * @param str    Bytes to duplicate
+ * @param len    Number of bytes
+ * @return Duplicated string, NULL on error
+ */
+char* arena_strndup(arena_t *arena, const char* str, size_t len);
+
 /**
  * @brief Reset arena (clear all allocations, keep memory)
  *
@@ -95,16 +227,60 @@ char* arena_strdup(arena_t *arena, const char* str);
  */
 int arena_reset(arena_t *arena);
 
+/**
+ * @brief Record the current allocation position
+ *
+ * @param arena  Arena handle
+ * @return Mark to pass to arena_rewind()
+ */
+arena_mark_t arena_mark(arena_t *arena);
+
+/**
+ * @brief Release everything allocated after a mark
+ *
+ * Pointers obtained after the mark become invalid; blocks are kept
+ * for reuse. Marks nest: rewinding to an outer mark also releases
+ * inner ones.
+ *
+ * @param arena  Arena handle
+ * @param mark   Mark from arena_mark() on the same arena
+ * @return 1 on success, 0 on error (stale or foreign mark)
+ */
+int arena_rewind(arena_t *arena, arena_mark_t mark);
+
+/**
+ * @brief Begin a scratch scope (arena_mark() bundled with its arena)
+ */
+arena_scratch_t arena_scratch_begin(arena_t *arena);
+
+/**
+ * @brief End a scratch scope, rewinding to where it began
+ */
+void arena_scratch_end(arena_scratch_t *scratch);
+
 /**
  * @brief Destroy arena and free all memory
  *
- * Frees all blocks and the arena structure.
+ * Frees the arena structure; blocks go to the block cache while it has
+ * room and are freed otherwise.
  *
  * @param arena  Arena handle
  * @return 1 on success, 0 on error
  */
 int arena_destroy(arena_t *arena);
 
+/**
+ * @brief Check whether ptr points into one of the arena's blocks
+ *
+ * Lets a free hook tell arena memory from heap memory. Cost is linear
+ * in the number of blocks.
+ *
+ * @param arena  Arena handle
+ * @param ptr    Pointer to test
+ * @return 1 if owned by the arena, 0 otherwise
+ */
+int arena_contains(const arena_t *arena, const void *ptr);
+
 /**
  * @brief Get arena memory statistics
  *
@@ -114,6 +290,45 @@ int arena_destroy(arena_t *arena);
  */
 int arena_get_stats(const arena_t *arena, arena_stats_t *stats);
 
+/**
+ * @brief Attribute subsequent allocations to tag
+ *
+ * The tag belongs to the arena, not the calling thread. A no-op
+ * returning ARENA_TAG_OTHER when ARC_ARENA_TELEMETRY is 0.
+ *
+ * @param arena  Arena handle
+ * @param tag    Tag in [0, ARENA_TAG_MAX); out of range maps to ARENA_TAG_OTHER
+ * @return Previous tag, so callers can restore it
+ */
+int arena_set_tag(arena_t *arena, int tag);
+
+/**
+ * @brief Get arena telemetry
+ *
+ * Per-tag counters survive arena_reset() and arena_rewind(); the
+ * high-water mark covers the arena's whole lifetime.
+ *
+ * @param arena      Arena handle
+ * @param telemetry  Output telemetry structure
+ * @return 1 on success, 0 on error
+ */
+int arena_get_telemetry(const arena_t *arena, arena_telemetry_t *telemetry);
+
+/**
+ * @brief Short name of a tag ("history", "llm", ...; "user" past ARENA_TAG_USER)
+ */
+const char *arena_tag_name(int tag);
+
+/**
+ * @brief Free every block held by the block cache
+ *
+ * Optional: call at shutdown so leak checkers see a clean heap, or to
+ * return memory after a burst of short-lived arenas.
+ *
+ * @return Bytes released
+ */
+size_t arena_cache_trim(void);
+
 #ifdef __cplusplus
 }
 #endif
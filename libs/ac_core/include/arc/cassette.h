@@ -0,0 +1,97 @@
+/**
+ * @file cassette.h
+ * @brief HTTP record/replay for benchmarks and regression runs
+ *
+ * Record mode captures every arc_http request of the process (LLM
+ * providers, MCP over HTTP) into a cassette file: the request's key and
+ * the full response, as stream chunks with their arrival times for
+ * streaming calls. Replay mode serves the recorded responses instead of
+ * the network, at recorded speed or as fast as possible, so a real agent
+ * session can be rerun to measure the CPU side (serialization, parsing,
+ * rendering) without a server.
+ *
+ * A request is keyed by method, URL and body; headers are left out, so
+ * API keys never reach the cassette and a replay needs none. Identical
+ * requests are answered in the order they were recorded. A request whose
+ * body differs (a timestamp in the prompt) falls back to the oldest
+ * unused recording for the same method and URL.
+ *
+ * Requests submitted straight to an HTTP engine (arc_http_transfer) are
+ * not covered; clients that route through an engine are.
+ *
+ * Usage:
+ * @code
+ * // Record a session
+ * ac_cassette_start(&(ac_cassette_config_t){ AC_CASSETTE_RECORD, "run.cassette" });
+ * ... run agents against the real provider ...
+ * ac_cassette_stop();
+ *
+ * // Replay it, without network, as fast as possible
+ * ac_cassette_start(&(ac_cassette_config_t){ AC_CASSETTE_REPLAY, "run.cassette",
+ *                                            .strict = 1 });
+ * @endcode
+ */
+
+#ifndef ARC_CASSETTE_H
+#define ARC_CASSETTE_H
+
+#include <stdint.h>
+#include "arc/error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    AC_CASSETTE_RECORD = 1,          /**< Perform requests and append them to the file */
+    AC_CASSETTE_REPLAY               /**< Answer requests from the file */
+} ac_cassette_mode_t;
+
+typedef struct {
+    ac_cassette_mode_t mode;
+    const char *path;                /**< Cassette file (record truncates it) */
+    int realtime;                    /**< Replay: keep the recorded time to first byte and
+                                          chunk spacing (default: no delays) */
+    int strict;                      /**< Replay: fail requests not on the cassette with
+                                          ARC_ERR_NOT_FOUND (default: send them) */
+} ac_cassette_config_t;
+
+typedef struct {
+    uint64_t recorded;               /**< Requests written */
+    uint64_t replayed;               /**< Requests answered from the cassette */
+    uint64_t fallbacks;              /**< Of those, matched by method and URL only */
+    uint64_t misses;                 /**< Requests not on the cassette */
+} ac_cassette_stats_t;
+
+/**
+ * @brief Start recording or replaying (process-wide)
+ *
+ * Call before the requests to capture start; requests in flight are not
+ * affected.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_INVALID_STATE (already
+ *         started), ARC_ERR_IO (cannot open the file), ARC_ERR_PARSE (not
+ *         a cassette), ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_cassette_start(const ac_cassette_config_t *config);
+
+/**
+ * @brief Stop and close the cassette
+ *
+ * Wait for requests in flight to finish first: a recording that ends
+ * after this is dropped.
+ *
+ * @return ARC_OK, ARC_ERR_IO (the recording could not be written fully)
+ */
+arc_err_t ac_cassette_stop(void);
+
+/**
+ * @brief Counters since ac_cassette_start()
+ */
+void ac_cassette_get_stats(ac_cassette_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_CASSETTE_H */
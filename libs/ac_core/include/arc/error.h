@@ -36,6 +36,9 @@ typedef enum {
     ARC_ERR_PARSE = -15,             /* Parse error */
     ARC_ERR_RESPONSE_TOO_LARGE = -16, /* Response size exceeds limit */
     ARC_ERR_INVALID_STATE = -17,     /* Invalid state for operation */
+    ARC_ERR_EXISTS = -18,            /* Resource already exists */
+    ARC_ERR_CANCELLED = -19,         /* Operation cancelled */
+    ARC_ERR_CONTEXT_OVERFLOW = -20,  /* Request exceeds the model context window */
 } arc_err_t;
 
 /*============================================================================
@@ -0,0 +1,109 @@
+/**
+ * @file http_faults.h
+ * @brief Network fault and latency injection at the arc_http boundary
+ *
+ * Turns a good network into a controlled bad one, for tuning retries,
+ * hedging and timeouts and for measuring tail latency with the
+ * benchmarks. Every arc_http request of the process (LLM providers, MCP
+ * over HTTP) can be given:
+ *
+ * - extra latency with uniform jitter before it is sent
+ * - a bandwidth cap on the request and response bodies
+ * - slow-drip delivery of streamed responses (small pieces, paced)
+ * - mid-stream disconnects: the stream stops after a random number of
+ *   bytes and the request fails with ARC_ERR_NETWORK; a non-streamed
+ *   response is performed and then dropped
+ * - a rate of HTTP error answers (429 with Retry-After, 5xx) returned
+ *   without contacting the server
+ *
+ * Faults sit above the cassette (arc/cassette.h), so a replayed session
+ * can be run through a bad network without any server.
+ *
+ * Besides ac_http_faults_start(), the ARC_HTTP_FAULTS environment
+ * variable enables injection on the first request of the process, with
+ * the spec syntax of ac_http_faults_parse():
+ *
+ * @code
+ * ARC_HTTP_FAULTS="latency_ms=200,jitter_ms=100,error_pct=5,error_status=429" ./agent
+ * @endcode
+ *
+ * Requests submitted straight to an HTTP engine (arc_http_transfer) are
+ * not covered; clients that route through an engine are.
+ */
+
+#ifndef ARC_HTTP_FAULTS_H
+#define ARC_HTTP_FAULTS_H
+
+#include <stdint.h>
+#include "arc/error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t latency_ms;             /**< Added before each request */
+    uint32_t jitter_ms;              /**< Uniform 0..jitter_ms on top of the latency */
+    uint32_t bandwidth;              /**< Bytes per second for request and response
+                                          bodies (0 = unlimited) */
+    uint32_t drip_bytes;             /**< Streams: deliver chunks in pieces this size
+                                          (0 = as received) */
+    uint32_t drip_ms;                /**< Streams: pause before each piece */
+    uint32_t disconnect_pct;         /**< Requests cut off (0-100) */
+    uint32_t disconnect_bytes;       /**< Streams are cut within the first this many
+                                          bytes (default 4096) */
+    uint32_t error_pct;              /**< Requests answered with an HTTP error (0-100) */
+    uint32_t error_status;           /**< Status of those answers (default 503) */
+    uint32_t retry_after_ms;         /**< Retry-After of 429 answers (default 1000) */
+    uint32_t seed;                   /**< Random sequence (same seed, same faults for
+                                          the same request order) */
+    char url_match[96];              /**< Only URLs containing this ("" = all) */
+} ac_http_faults_config_t;
+
+typedef struct {
+    uint64_t requests;               /**< Requests matched */
+    uint64_t errors;                 /**< Answered with an injected HTTP error */
+    uint64_t disconnects;            /**< Cut off */
+    uint64_t delay_ms;               /**< Latency, jitter, bandwidth and drip waits */
+} ac_http_faults_stats_t;
+
+/**
+ * @brief Parse a spec of comma-separated key=value pairs
+ *
+ * Keys are the field names of ac_http_faults_config_t (latency_ms,
+ * jitter_ms, bandwidth, drip_bytes, drip_ms, disconnect_pct,
+ * disconnect_bytes, error_pct, error_status, retry_after_ms, seed,
+ * url_match). Fields not named keep their value in *config.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_PARSE (unknown key or bad
+ *         value)
+ */
+arc_err_t ac_http_faults_parse(const char *spec, ac_http_faults_config_t *config);
+
+/**
+ * @brief Start injecting faults (process-wide)
+ *
+ * Replaces the configuration of a previous start or of ARC_HTTP_FAULTS.
+ * Requests in flight keep the configuration they started with.
+ *
+ * @param config  Faults (NULL = parse ARC_HTTP_FAULTS)
+ * @return ARC_OK, ARC_ERR_NOT_FOUND (NULL config and the variable is not
+ *         set), ARC_ERR_PARSE
+ */
+arc_err_t ac_http_faults_start(const ac_http_faults_config_t *config);
+
+/**
+ * @brief Stop injecting faults (ARC_HTTP_FAULTS is not read again)
+ */
+void ac_http_faults_stop(void);
+
+/**
+ * @brief Counters since the last start
+ */
+void ac_http_faults_get_stats(ac_http_faults_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HTTP_FAULTS_H */
@@ -13,6 +13,7 @@
 #include "arena.h"
 #include "error.h"
 #include "message.h"
+#include "priority.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,6 +50,7 @@ typedef enum {
     AC_STREAM_MESSAGE_DELTA,       /**< Message-level update */
     AC_STREAM_MESSAGE_STOP,        /**< Message finished */
     AC_STREAM_ERROR,               /**< Error occurred */
+    AC_STREAM_TOOL_PROGRESS,       /**< Running tool reported progress (agent) */
 } ac_stream_event_type_t;
 
 typedef enum {
@@ -78,6 +80,11 @@ typedef struct {
     /* Tool use info */
     const char* tool_id;           /**< Tool call ID */
     const char* tool_name;         /**< Tool/function name */
+    const char* tool_input;        /**< Complete arguments (tool_use BLOCK_STOP only) */
+
+    /* Tool progress (TOOL_PROGRESS: partial output in delta) */
+    double progress;               /**< Progress so far */
+    double progress_total;         /**< Expected total (0 = unknown) */
     
     /* Message level info (for MESSAGE_DELTA/STOP) */
     const char* stop_reason;       /**< Stop reason */
@@ -121,6 +128,198 @@ typedef struct {
     int include_encrypted;   /**< Include encrypted reasoning items */
 } ac_stateful_config_t;
 
+/*============================================================================
+ * Retry Configuration
+ *============================================================================*/
+
+/**
+ * @brief Retry and hedging policy for transient provider failures
+ *
+ * Timeouts, network errors and HTTP 408/429/5xx are retried after
+ * base_delay_ms * 2^n (capped at max_delay_ms, full jitter), or after the
+ * server's Retry-After when that is longer. A Retry-After beyond
+ * max_delay_ms fails the call instead of blocking. Streaming calls are
+ * only retried while no event has reached the callback yet.
+ *
+ * Hedging (non-streaming, pooled HTTP clients, thread builds only): if an
+ * attempt is still running after the hedge delay, an identical request is
+ * sent; the first success wins and the other one is cancelled.
+ */
+typedef struct {
+    int max_retries;         /**< Attempts after the first (0 = no retry) */
+    int base_delay_ms;       /**< First backoff (default: 500) */
+    int max_delay_ms;        /**< Backoff cap (default: 30000) */
+    int hedge_after_ms;      /**< 0 = off, > 0 = fixed delay, AC_LLM_HEDGE_P95 = adaptive */
+} ac_llm_retry_config_t;
+
+/** Hedge at the p95 of recent successful call latencies */
+#define AC_LLM_HEDGE_P95                -1
+
+#define AC_LLM_RETRY_DEFAULT_BASE_MS    500
+#define AC_LLM_RETRY_DEFAULT_MAX_MS     30000
+
+/*============================================================================
+ * Response Cache
+ *============================================================================*/
+
+/**
+ * @brief Exact-match response cache (evaluation and CI replay)
+ *
+ * Requests are keyed by a hash of everything that shapes the answer:
+ * provider, endpoint, model, generation parameters, tools and messages.
+ * A hit returns the stored response without a network call (and reports
+ * no token usage); streaming calls replay it as a synthetic event
+ * sequence. Only worth enabling for deterministic replays: the cache has
+ * no notion of expiry.
+ *
+ * The in-memory LRU is process-wide and shared by every LLM client that
+ * enables it. The optional directory store survives across processes.
+ */
+typedef struct {
+    int max_entries;         /**< In-memory LRU capacity (0 = cache off) */
+    const char* dir;         /**< On-disk store (optional, created if missing) */
+} ac_llm_cache_config_t;
+
+/*============================================================================
+ * Client Rate Limiting
+ *============================================================================*/
+
+/**
+ * @brief Process-wide request and token quotas per (provider, api_key)
+ *
+ * All clients that enable the limiter share one pair of token buckets
+ * (requests/min, tokens/min) per provider and API key, so many agents on
+ * one key queue instead of racing into 429s. Buckets follow the quota
+ * headers of every response (x-ratelimit-* from OpenAI,
+ * anthropic-ratelimit-* from Anthropic); a 429 stops the key until its
+ * Retry-After. A request is charged one request plus its estimated prompt
+ * tokens and max_tokens. Requests that do not fit wait, served by
+ * ac_llm_params_t.priority class and in arrival order within a class
+ * (arc/priority.h). Time spent queued is reported in ac_chat_response_t.ratelimit_wait_ms
+ * and in the LLM response trace event.
+ */
+typedef struct {
+    int enabled;             /**< Queue requests against the key's quota */
+    int requests_per_min;    /**< Limit until headers report one (0 = from headers only) */
+    int tokens_per_min;      /**< Limit until headers report one (0 = from headers only) */
+    int max_wait_ms;         /**< Fail with ARC_ERR_TIMEOUT instead of queueing longer (0 = no cap) */
+} ac_llm_rate_limit_config_t;
+
+/*============================================================================
+ * Endpoint Routing
+ *============================================================================*/
+
+/**
+ * @brief How a routed call picks among healthy endpoints
+ */
+typedef enum {
+    AC_LLM_ROUTE_WEIGHTED = 0,       /**< Random by weight, scaled down by recent error rate */
+    AC_LLM_ROUTE_LEAST_OUTSTANDING   /**< Fewest in-flight requests, ties by latency EWMA */
+} ac_llm_route_policy_t;
+
+/**
+ * @brief One gateway serving the model
+ */
+typedef struct {
+    const char* api_base;    /**< Endpoint base URL (required) */
+    const char* api_key;     /**< Overrides params.api_key (optional) */
+    int weight;              /**< Share under AC_LLM_ROUTE_WEIGHTED (default: 1) */
+} ac_llm_endpoint_t;
+
+/**
+ * @brief Route one logical LLM over several endpoints of the same model
+ *
+ * Each endpoint gets its own instance of the selected provider. Health is
+ * tracked per endpoint (latency and error-rate EWMAs, consecutive
+ * failures); eject_errors failures in a row take an endpoint out for
+ * eject_ms, after which a single probe request decides whether it is
+ * back. A transient failure (timeout, network, HTTP 408/429/5xx) fails
+ * over to the next endpoint within the same call; streams only until the
+ * first event has been delivered. Requests continuing a stored response
+ * prefer the endpoint that produced the last one.
+ */
+typedef struct {
+    const ac_llm_endpoint_t* endpoints;  /**< Endpoint array (copied, at most 64) */
+    int endpoint_count;                  /**< 0 = routing off: params.api_base only */
+    ac_llm_route_policy_t policy;        /**< Selection policy (default: WEIGHTED) */
+    int eject_errors;                    /**< Consecutive failures that eject (default: 3) */
+    int eject_ms;                        /**< Ejection before a probe (default: 30000) */
+} ac_llm_routing_config_t;
+
+#define AC_LLM_ROUTE_MAX_ENDPOINTS       64
+#define AC_LLM_ROUTE_DEFAULT_EJECT_ERRORS 3
+#define AC_LLM_ROUTE_DEFAULT_EJECT_MS    30000
+
+/*============================================================================
+ * Prompt Caching (Anthropic)
+ *============================================================================*/
+
+/**
+ * @brief Where cache breakpoints (cache_control markers) are placed
+ *
+ * AUTO marks the last tool definition, the system prompt and the newest
+ * message, so each turn reads the previous turn's prefix from the cache
+ * and writes its own additions. Usage is reported in
+ * ac_chat_response_t.cache_creation_tokens / cache_read_tokens.
+ * Providers without prompt caching ignore the setting.
+ */
+typedef enum {
+    AC_PROMPT_CACHE_AUTO = 0,        /**< Tools, system and history (default) */
+    AC_PROMPT_CACHE_STATIC,          /**< Tools and system only */
+    AC_PROMPT_CACHE_OFF              /**< No markers */
+} ac_prompt_cache_t;
+
+/*============================================================================
+ * Structured Output
+ *============================================================================*/
+
+/**
+ * @brief Ask for the answer as JSON matching a schema
+ *
+ * OpenAI Chat Completions sends it as response_format (type json_schema),
+ * the Responses API as text.format. Anthropic has no such field: the
+ * schema (an object type there) becomes the input_schema of an extra
+ * tool, forced with tool_choice "any" (plain "auto" when thinking is on,
+ * which rules out forcing), and a call to it is turned back into the
+ * text answer, both in the response and in the stream events.
+ *
+ * Streamed answers are checked as they arrive: the first byte that
+ * cannot continue a JSON value stops the stream rather than paying for
+ * the rest of it. The finished answer is checked against the schema
+ * (the subset in json_schema.h); a mismatch is reported in
+ * ac_chat_response_t.format_error, and such responses are not cached.
+ */
+typedef struct {
+    const char* schema;      /**< JSON Schema of the answer (NULL = off) */
+    const char* name;        /**< Schema/tool name (default: "answer") */
+    int strict;              /**< Provider-side strict mode (OpenAI) */
+} ac_response_format_t;
+
+#define AC_RESPONSE_FORMAT_DEFAULT_NAME "answer"
+
+/*============================================================================
+ * Embeddings Configuration
+ *============================================================================*/
+
+/**
+ * @brief How ac_llm_embed() talks to the provider
+ *
+ * Inputs go out in provider requests of up to max_batch inputs.
+ * Concurrent ac_llm_embed() calls on one client share those requests:
+ * inputs queued by other threads ride along in the next one, and up to
+ * AC_LLM_EMBED_MAX_INFLIGHT requests run at once. linger_ms trades
+ * latency for fuller requests when callers trickle in.
+ */
+typedef struct {
+    const char* model;       /**< Embedding model (default: params.model) */
+    int dimensions;          /**< Shorter vectors, if the model can (0 = model default) */
+    int max_batch;           /**< Inputs per provider request (default: 256) */
+    uint32_t linger_ms;      /**< Wait for more inputs before sending a partial request (default: 0) */
+} ac_llm_embed_config_t;
+
+#define AC_LLM_EMBED_DEFAULT_BATCH 256
+#define AC_LLM_EMBED_MAX_INFLIGHT  4
+
 /*============================================================================
  * LLM Parameters
  *============================================================================*/
@@ -147,6 +346,7 @@ typedef struct {
     float temperature;              /**< Sampling temperature (0.0-2.0, default: 0.7) */
     float top_p;                    /**< Nucleus sampling (0.0-1.0) */
     int max_tokens;                 /**< Max tokens to generate (0 = no limit) */
+    int context_window;             /**< Model context in tokens: larger requests fail before sending (0 = no check) */
     int timeout_ms;                 /**< Request timeout in ms (default: 60000) */
     
     /*========== Thinking/Reasoning (v2) ==========*/
@@ -157,6 +357,45 @@ typedef struct {
     
     /*========== Streaming (v2) ==========*/
     int stream;                     /**< Enable streaming mode */
+
+    /*========== Structured Output ==========*/
+    ac_response_format_t response_format;  /**< JSON answer schema (default: off) */
+
+    /*========== Embeddings ==========*/
+    ac_llm_embed_config_t embed;    /**< ac_llm_embed() model and batching */
+
+    /*========== Transport ==========*/
+    int compress_requests;          /**< gzip request bodies (endpoint must accept Content-Encoding: gzip) */
+    ac_llm_retry_config_t retry;    /**< Retry/hedging policy (default: no retry) */
+    const volatile int* cancel;     /**< Abort the in-flight request once *cancel != 0 (optional) */
+    uint64_t deadline_ms;           /**< Absolute end of a call, retries included (ac_platform_timestamp_ms, 0 = none) */
+    ac_priority_t priority;         /**< Class in the rate limiter and HTTP pool queues (default: NORMAL) */
+    ac_llm_routing_config_t routing;  /**< Several endpoints for one model (default: off) */
+    ac_llm_rate_limit_config_t rate_limit;  /**< Shared per-key quota queue (default: off) */
+
+    /**
+     * Send calls over one WebSocket kept open for the life of the client
+     * instead of one HTTP request each (openai_responses; libcurl
+     * backend). Responses chain on the connection without store, so each
+     * agent turn sends only its new messages. An endpoint that refuses
+     * the upgrade is used over HTTP.
+     */
+    int websocket;                  /**< Persistent WebSocket transport (default: off) */
+
+    /*========== Prompt Caching ==========*/
+    ac_prompt_cache_t prompt_cache; /**< Cache breakpoint policy (default: AUTO) */
+
+    /*========== Response Cache ==========*/
+    ac_llm_cache_config_t response_cache;  /**< Local exact-match cache (default: off) */
+
+    /**
+     * Identical concurrent requests (same key as the response cache) share
+     * one upstream call: later callers wait for the first one's response,
+     * streaming callers receive its events as they arrive. Requests are
+     * matched across every client in the process that enables this; the
+     * shared copies report no token usage.
+     */
+    int coalesce;                   /**< Single-flight identical requests (default: off) */
 } ac_llm_params_t;
 
 /*============================================================================
@@ -229,6 +468,68 @@ arc_err_t ac_llm_chat_stream(
     ac_chat_response_t* response
 );
 
+/**
+ * @brief Raw stream callback for ac_llm_chat_stream_raw()
+ *
+ * @param data      Bytes of the provider's response body, as received
+ * @param len       Number of bytes
+ * @param user_data User context
+ * @return 0 to continue, non-zero to abort
+ */
+typedef int (*ac_llm_raw_callback_t)(
+    const char* data,
+    size_t len,
+    void* user_data
+);
+
+/**
+ * @brief Streaming chat that passes the provider's event stream through
+ *
+ * For gateways that relay a stream to their own clients: the upstream
+ * SSE body reaches sink chunk by chunk as it arrives, in the provider's
+ * own wire format, with no stream events decoded or encoded on the way.
+ *
+ * response, if given, is decoded from the same chunks after sink has
+ * had them, for the conversation history; without it nothing is
+ * decoded at all. An error body is not passed to sink, so a failed
+ * attempt is still retried; once bytes have reached sink it is not.
+ * Cached answers and request coalescing are not used; a response_format
+ * is checked on response only.
+ *
+ * @param llm       LLM handle
+ * @param messages  Message history (linked list)
+ * @param tools     JSON array of tool definitions (NULL for no tools)
+ * @param sink      Raw body callback
+ * @param user_data User context passed to sink
+ * @param response  Optional: accumulated final response (caller must free)
+ * @return ARC_OK on success, ARC_ERR_NOT_IMPLEMENTED if the provider
+ *         cannot stream raw
+ */
+arc_err_t ac_llm_chat_stream_raw(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_raw_callback_t sink,
+    void* user_data,
+    ac_chat_response_t* response
+);
+
+/**
+ * @brief Estimate the prompt tokens of a request (client-side)
+ *
+ * Messages and tools schema, with the estimator for the model's tokenizer
+ * family (see tokens.h). This is what the pre-flight check compares,
+ * together with max_tokens, against params.context_window: a request
+ * that cannot fit fails with ARC_ERR_CONTEXT_OVERFLOW without a round trip.
+ *
+ * @param llm       LLM handle
+ * @param messages  Message history (linked list)
+ * @param tools     JSON array of tool definitions (NULL for no tools)
+ * @return Estimated prompt tokens
+ */
+size_t ac_llm_estimate_tokens(const ac_llm_t* llm, const ac_message_t* messages,
+                              const char* tools);
+
 /**
  * @brief Update LLM parameters
  *
@@ -249,6 +550,286 @@ arc_err_t ac_llm_update_params(ac_llm_t* llm, const ac_llm_params_t* params);
  */
 uint32_t ac_llm_get_capabilities(ac_llm_t* llm);
 
+/**
+ * @brief Drop every in-memory response cache entry (disk store untouched)
+ */
+void ac_llm_cache_clear(void);
+
+/*============================================================================
+ * Latency Metrics
+ *============================================================================*/
+
+/** Histogram buckets: 0 is under 1 ms, i under 2^i ms, the last is longer */
+#define AC_LLM_LATENCY_BUCKETS     20
+
+/** Length of one rolling window; reads cover the current and previous one */
+#define AC_LLM_LATENCY_WINDOW_MS   60000
+
+/**
+ * @brief Recent latency of one model, across every ac_llm_t using it
+ *
+ * Each call's phases are also on its response (ac_chat_response_t.timing).
+ */
+typedef struct {
+    uint64_t calls;                  /**< Calls recorded */
+    uint64_t streamed;               /**< Of which streamed */
+    uint64_t output_tokens;          /**< Streamed output tokens ... */
+    uint64_t stream_ms;              /**< ... over this much streaming time */
+    uint64_t ttfb[AC_LLM_LATENCY_BUCKETS];        /**< First response byte */
+    uint64_t first_token[AC_LLM_LATENCY_BUCKETS]; /**< First text/thinking delta */
+    uint64_t gap[AC_LLM_LATENCY_BUCKETS];         /**< Every inter-delta gap */
+    uint64_t duration[AC_LLM_LATENCY_BUCKETS];    /**< Whole call, retries included */
+} ac_llm_latency_stats_t;
+
+/**
+ * @brief Read the rolling latency histograms of a model
+ *
+ * @param model  Model name as in ac_llm_params_t.model
+ * @param stats  Output
+ * @return ARC_OK, ARC_ERR_NOT_FOUND if no call to model was recorded
+ */
+arc_err_t ac_llm_latency_get(const char* model, ac_llm_latency_stats_t* stats);
+
+/**
+ * @brief Upper bound (ms) of the bucket holding percentile p (0..1) of a histogram
+ *
+ * @return 0 for an empty histogram, UINT32_MAX for the open last bucket
+ */
+uint32_t ac_llm_latency_percentile(const uint64_t* hist, double p);
+
+/*============================================================================
+ * Non-blocking Chat
+ *============================================================================*/
+
+/**
+ * @brief A chat request in flight on the shared HTTP engine
+ */
+typedef struct ac_llm_call ac_llm_call_t;
+
+/**
+ * @brief Called once the request of a call has completed
+ *
+ * Runs on the engine's I/O thread (the host loop's thread with
+ * ac_runtime.h), or inside ac_llm_chat_submit() when the answer needed
+ * no request. It should only wake whoever finishes the call and must not
+ * call ac_llm_call_finish() itself.
+ */
+typedef void (*ac_llm_call_done_fn)(ac_llm_call_t* call, void* user_data);
+
+/**
+ * @brief Send a chat request without waiting for the answer
+ *
+ * Same request as ac_llm_chat_with_tools(), queued on the HTTP pool's
+ * shared engine (arc/http_pool.h). No thread blocks on it: done fires
+ * when the response is in, and ac_llm_call_finish() parses it into
+ * response. messages and response must stay as they are until then.
+ *
+ * Calls that need the blocking path are refused with
+ * ARC_ERR_NOT_IMPLEMENTED, and the caller makes them with
+ * ac_llm_chat_with_tools() instead:
+ * - no pool, or a pool without its shared engine
+ * - a provider without a non-blocking request (custom providers,
+ *   routers, the Responses API), or a request it cannot build without
+ *   other requests first (Anthropic image uploads)
+ * - rate limiting, request coalescing or hedging turned on
+ *
+ * @param llm        LLM handle
+ * @param messages   Message history (linked list)
+ * @param tools      JSON array of tool definitions (NULL for no tools)
+ * @param response   Output response structure, initialized by the caller
+ * @param done       Completion callback
+ * @param user_data  Passed to done
+ * @param out        Call handle, finish it with ac_llm_call_finish()
+ * @return ARC_OK, ARC_ERR_NOT_IMPLEMENTED (see above), or an error that
+ *         ac_llm_chat_with_tools() would also fail with before sending
+ */
+arc_err_t ac_llm_chat_submit(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_chat_response_t* response,
+    ac_llm_call_done_fn done,
+    void* user_data,
+    ac_llm_call_t** out
+);
+
+/**
+ * @brief Parse a completed call into its response and free the call
+ *
+ * Call after done has fired. A failure that ac_llm_chat_with_tools()
+ * would retry is not retried here, since the backoff has to wait: retry
+ * is set, the response is reset, and the caller repeats the request with
+ * ac_llm_chat_with_tools() (off the event loop).
+ *
+ * @param call   Completed call
+ * @param retry  Set to 1 when the caller should retry (optional)
+ * @return ARC_OK or the request's error, as ac_llm_chat_with_tools()
+ */
+arc_err_t ac_llm_call_finish(ac_llm_call_t* call, int* retry);
+
+/**
+ * @brief Abort a call; done still fires and the call finishes with
+ *        ARC_ERR_CANCELLED
+ *
+ * Any thread, as long as the call has not been finished.
+ */
+void ac_llm_call_cancel(ac_llm_call_t* call);
+
+/*============================================================================
+ * Batch API
+ *============================================================================*/
+
+/**
+ * @brief Offline batch of independent requests
+ *
+ * Requests go through the provider's batch endpoint (OpenAI Batch API,
+ * Anthropic Message Batches): answered within the provider's completion
+ * window at batch prices and outside the interactive rate limits, so a
+ * large job needs no client threads. Each request body is streamed from
+ * the same builder as ac_llm_chat_with_tools() into a local spool file
+ * (JSONL for OpenAI) as it is added, and uploaded from there on submit.
+ * A batch larger than the provider accepts at once (OpenAI: 50,000
+ * requests or 200 MB, Anthropic: 100,000 requests or 256 MB) is split
+ * into several provider batches, submitted together and tracked as one.
+ *
+ * Typical use: create, add, submit, keep ac_llm_batch_id(); later (or in
+ * another process, via ac_llm_batch_open) poll until ENDED, then fetch.
+ */
+typedef struct ac_llm_batch ac_llm_batch_t;
+
+typedef enum {
+    AC_LLM_BATCH_OPEN = 0,          /**< Accepting requests (not submitted) */
+    AC_LLM_BATCH_RUNNING,           /**< Submitted, provider still working */
+    AC_LLM_BATCH_ENDED,             /**< Finished: results can be fetched */
+    AC_LLM_BATCH_FAILED             /**< Rejected by the provider (no results) */
+} ac_llm_batch_state_t;
+
+typedef struct {
+    ac_llm_batch_state_t state;
+    size_t total;                   /**< Requests in the batch */
+    size_t succeeded;               /**< Answered */
+    size_t failed;                  /**< Errored, expired or cancelled */
+} ac_llm_batch_status_t;
+
+/**
+ * @brief Receives one batch result
+ *
+ * @param custom_id  Identifier given to ac_llm_batch_add()
+ * @param err        ARC_OK, ARC_ERR_HTTP (response->http_status set) or
+ *                   ARC_ERR_BACKEND (errored, expired or cancelled)
+ * @param response   Parsed response (valid during the call only)
+ * @param user_data  User context
+ * @return 0 to continue, non-zero to stop fetching
+ */
+typedef int (*ac_llm_batch_result_fn)(
+    const char* custom_id,
+    arc_err_t err,
+    const ac_chat_response_t* response,
+    void* user_data
+);
+
+/**
+ * @brief Start a batch on llm's provider and parameters
+ *
+ * @param llm         LLM handle (provider must support batches; no routing)
+ * @param spool_path  File the request bodies are written to (NULL = temporary file)
+ * @param out         New batch (ac_llm_batch_destroy)
+ * @return ARC_OK, ARC_ERR_NOT_IMPLEMENTED, ARC_ERR_IO
+ */
+arc_err_t ac_llm_batch_create(ac_llm_t* llm, const char* spool_path, ac_llm_batch_t** out);
+
+/**
+ * @brief Add one request (messages and tools as for ac_llm_chat_with_tools)
+ *
+ * @param custom_id  Unique within the batch; results are matched by it
+ *                   (Anthropic: 1-64 of [A-Za-z0-9_-])
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_INVALID_STATE (submitted), ARC_ERR_IO
+ */
+arc_err_t ac_llm_batch_add(
+    ac_llm_batch_t* batch,
+    const char* custom_id,
+    const ac_message_t* messages,
+    const char* tools
+);
+
+/**
+ * @brief Upload the spooled requests and create the provider batch(es)
+ *
+ * On failure the parts already created keep running; ac_llm_batch_id()
+ * names them and submit can be called again for the rest.
+ */
+arc_err_t ac_llm_batch_submit(ac_llm_batch_t* batch);
+
+/**
+ * @brief Provider batch ID(s), comma-separated (NULL before submit)
+ */
+const char* ac_llm_batch_id(const ac_llm_batch_t* batch);
+
+/**
+ * @brief Attach to a submitted batch by its ac_llm_batch_id()
+ */
+arc_err_t ac_llm_batch_open(ac_llm_t* llm, const char* id, ac_llm_batch_t** out);
+
+/**
+ * @brief Refresh the batch status from the provider
+ */
+arc_err_t ac_llm_batch_poll(ac_llm_batch_t* batch, ac_llm_batch_status_t* status);
+
+/**
+ * @brief Stream the results of an ended batch, one callback per request
+ *
+ * Results arrive in the provider's order, not the order of adding.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_STATE (not ended), transport errors
+ */
+arc_err_t ac_llm_batch_fetch(
+    ac_llm_batch_t* batch,
+    ac_llm_batch_result_fn on_result,
+    void* user_data
+);
+
+/**
+ * @brief Free the batch handle (provider batches keep running)
+ *
+ * A temporary spool goes with it; a named spool_path is left in place.
+ */
+void ac_llm_batch_destroy(ac_llm_batch_t* batch);
+
+/*============================================================================
+ * Embeddings
+ *============================================================================*/
+
+/**
+ * @brief Vectors returned by ac_llm_embed()
+ */
+typedef struct {
+    float* vectors;          /**< count rows of dims floats, row i for input i */
+    size_t count;
+    size_t dims;
+} ac_embeddings_t;
+
+/**
+ * @brief Embed texts (OpenAI-compatible /embeddings)
+ *
+ * Blocks until every input has its vector. Failed provider requests are
+ * retried under params.retry; if one still fails, the call fails and out
+ * is left empty. Routed clients (params.routing) are not supported.
+ *
+ * @param llm     LLM handle (provider must support embeddings)
+ * @param inputs  Texts to embed (non-empty strings)
+ * @param count   Number of inputs
+ * @param out     Receives the vectors (ac_embeddings_free)
+ * @return ARC_OK, ARC_ERR_NOT_IMPLEMENTED if the provider has no
+ *         embeddings, or the request error
+ */
+arc_err_t ac_llm_embed(ac_llm_t* llm, const char* const* inputs, size_t count,
+                       ac_embeddings_t* out);
+
+/**
+ * @brief Free the vectors of ac_llm_embed()
+ */
+void ac_embeddings_free(ac_embeddings_t* embeddings);
+
 /**
  * @brief Cleanup LLM resources
  *
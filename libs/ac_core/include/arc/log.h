@@ -10,6 +10,7 @@
 #define ARC_LOG_H
 
 #include "platform.h"
+#include "error.h"
 #include <stdarg.h>
 
 #ifdef __cplusplus
@@ -75,6 +76,45 @@ ac_log_level_t ac_log_get_level(void);
  */
 void ac_log_set_handler(ac_log_handler_t handler);
 
+/*============================================================================
+ * Deferred Output
+ *
+ * In deferred mode a call formats its message into a per-thread ring (no
+ * lock) and returns; a background thread hands the records to the
+ * handler. Each thread's messages keep their order, but messages from
+ * different threads may be written in a different order than logged.
+ * A thread whose ring is full waits for the writer rather than drop.
+ *============================================================================*/
+
+/** Deferred messages longer than this (including NUL) are truncated */
+#define AC_LOG_ASYNC_MSG_MAX      256
+
+/** Records a thread can have waiting for the writer */
+#define AC_LOG_ASYNC_SLOTS        64
+
+/** Longest the writer sleeps between passes */
+#define AC_LOG_ASYNC_INTERVAL_MS  20
+
+/**
+ * @brief Start deferred output
+ *
+ * @return ARC_OK (also if already started), ARC_ERR_NOT_IMPLEMENTED
+ *         without thread support, ARC_ERR_BACKEND if the thread cannot start
+ */
+arc_err_t ac_log_async_start(void);
+
+/**
+ * @brief Write what is pending and return to synchronous output
+ */
+void ac_log_async_stop(void);
+
+/**
+ * @brief Wait until every message logged so far has been written
+ *
+ * No-op in synchronous mode.
+ */
+void ac_log_flush(void);
+
 /**
  * @brief Internal logging functions (do not call directly, use macros)
  */
@@ -83,11 +123,30 @@ void ac_log_warn(const char* file, int line, const char* func, const char* fmt,
 void ac_log_info(const char* file, int line, const char* func, const char* fmt, ...);
 void ac_log_debug(const char* file, int line, const char* func, const char* fmt, ...);
 
+/**
+ * @brief Compile-time level floor
+ *
+ * Calls above it compile to nothing. The build sets it to
+ * AC_LOG_LEVEL_INFO (3) for Release and MinSizeRel (see ARC_LOG_MIN_LEVEL
+ * in CMake).
+ */
+#ifndef AC_LOG_MIN_LEVEL
+#define AC_LOG_MIN_LEVEL 4
+#endif
+
+/**
+ * @brief Whether a message at level would be written (arguments unevaluated)
+ */
+#define AC_LOG_ENABLED(level) \
+    ((level) <= AC_LOG_MIN_LEVEL && (level) <= ac_log_get_level())
+
 /**
  * @brief Logging macros (unified interface for all platforms)
  *
  * These macros automatically capture file, line, and function information.
  * The implementation calls platform-specific handlers via ac_log_platform_default_handler.
+ * Arguments are evaluated only when the level is enabled, so they may be
+ * costly (strlen, serialization) without slowing filtered calls.
  *
  * Platform implementations:
  * - POSIX: File logging with colors (port/posix/log_posix.c)
@@ -100,10 +159,17 @@ void ac_log_debug(const char* file, int line, const char* func, const char* fmt,
  * AC_LOG_ERROR("HTTP request failed: status=%d", status_code);
  * @endcode
  */
-#define AC_LOG_ERROR(fmt, ...) ac_log_error(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define AC_LOG_WARN(fmt, ...)  ac_log_warn(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define AC_LOG_INFO(fmt, ...)  ac_log_info(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define AC_LOG_DEBUG(fmt, ...) ac_log_debug(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
+#define AC_LOG_AT_(level, fn, fmt, ...) \
+    do { \
+        if (AC_LOG_ENABLED(level)) { \
+            fn(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define AC_LOG_ERROR(fmt, ...) AC_LOG_AT_(AC_LOG_LEVEL_ERROR, ac_log_error, fmt, ##__VA_ARGS__)
+#define AC_LOG_WARN(fmt, ...)  AC_LOG_AT_(AC_LOG_LEVEL_WARN, ac_log_warn, fmt, ##__VA_ARGS__)
+#define AC_LOG_INFO(fmt, ...)  AC_LOG_AT_(AC_LOG_LEVEL_INFO, ac_log_info, fmt, ##__VA_ARGS__)
+#define AC_LOG_DEBUG(fmt, ...) AC_LOG_AT_(AC_LOG_LEVEL_DEBUG, ac_log_debug, fmt, ##__VA_ARGS__)
 
 #ifdef __cplusplus
 }
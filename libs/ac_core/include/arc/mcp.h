@@ -2,7 +2,8 @@
  * @file mcp.h
  * @brief Model Context Protocol (MCP) Client
  *
- * Client for connecting to MCP servers over HTTP/HTTPS and discovering tools.
+ * Client for connecting to MCP servers over HTTP/HTTPS or to a local server
+ * process over stdio, and discovering tools.
  * MCP tools can be added to an ac_tool_registry_t.
  *
  * The MCP client lifecycle is managed by the session.
@@ -28,6 +29,7 @@ extern "C" {
 typedef struct ac_mcp_client ac_mcp_client_t;
 typedef struct ac_session ac_session_t;
 typedef struct ac_tool_registry ac_tool_registry_t;
+typedef struct arena_ arena_t;
 
 /*============================================================================
  * MCP Configuration
@@ -36,10 +38,11 @@ typedef struct ac_tool_registry ac_tool_registry_t;
 /**
  * @brief MCP client configuration
  *
- * Configures connection to an MCP server over HTTP/HTTPS.
+ * Configures connection to an MCP server over HTTP/HTTPS, or with
+ * command set, to a server process spoken to over its stdin/stdout.
  */
 typedef struct {
-    const char *server_url;          /* MCP server URL (required, e.g., "http://localhost:3000/mcp") */
+    const char *server_url;          /* MCP server URL (e.g., "http://localhost:3000/mcp"), required without command */
     uint32_t timeout_ms;             /* Request timeout in ms (default: 30000) */
     const char *api_key;             /* Optional API key for authentication */
     int verify_ssl;                  /* Verify SSL certificate (default: 1) */
@@ -47,6 +50,24 @@ typedef struct {
     /* Client identification (sent in initialize) */
     const char *client_name;         /* Client name (default: "ArC") */
     const char *client_version;      /* Client version (default: "1.0.0") */
+
+    /* stdio transport: server executable (searched in PATH) and its
+     * arguments (NULL-terminated, may be NULL). Takes precedence over
+     * server_url; the process is started by ac_mcp_connect(). */
+    const char *command;
+    const char *const *args;
+
+    /* Directory for the on-disk tools/list cache, see
+     * ac_mcp_discover_tools_cached() (NULL = no cache) */
+    const char *tools_cache_dir;
+
+    /* SSE transport: a dropped event stream is reopened in the background
+     * with exponential backoff, resuming with Last-Event-ID and
+     * Mcp-Session-Id. Calls made meanwhile wait for it (within timeout_ms)
+     * unless reconnect_fail_fast is set. Reported through the
+     * on_mcp_connection hook / AC_TRACE_MCP_CONNECTION. */
+    uint32_t reconnect_max_backoff_ms; /* Backoff cap (default: 30000) */
+    int reconnect_fail_fast;         /* 1 = fail calls at once while reconnecting */
 } ac_mcp_config_t;
 
 /*============================================================================
@@ -62,6 +83,13 @@ typedef struct {
     const char *protocol_version;    /* MCP protocol version */
 } ac_mcp_server_info_t;
 
+/*============================================================================
+ * Tool Hints (from tools/list annotations)
+ *============================================================================*/
+
+#define AC_MCP_TOOL_READ_ONLY   0x1u   /* readOnlyHint: no side effects */
+#define AC_MCP_TOOL_IDEMPOTENT  0x2u   /* idempotentHint: repeats have no further effect */
+
 /*============================================================================
  * MCP Client Creation
  *============================================================================*/
@@ -152,6 +180,21 @@ void ac_mcp_disconnect(ac_mcp_client_t *client);
  */
 arc_err_t ac_mcp_discover_tools(ac_mcp_client_t *client);
 
+/**
+ * @brief Discover tools, answering from the on-disk cache when possible
+ *
+ * With tools_cache_dir set, a list stored for the same server URL, name
+ * and version (ac_mcp_server_info_t) is loaded without a tools/list
+ * round trip, and tools/list then runs in the background. If the server's
+ * list has changed, registries holding this client's tools swap in the
+ * new list at their next ac_tool_registry_sync_mcp(). Without a usable
+ * entry this is ac_mcp_discover_tools(), which refreshes the cache.
+ *
+ * @param client  MCP client
+ * @return ARC_OK on success
+ */
+arc_err_t ac_mcp_discover_tools_cached(ac_mcp_client_t *client);
+
 /**
  * @brief Get discovered tool count
  *
@@ -182,6 +225,74 @@ arc_err_t ac_mcp_call_tool(
     char **result
 );
 
+/**
+ * @brief One notifications/progress message for a running call
+ *
+ * message is NOT NUL-terminated and only valid during the callback.
+ */
+typedef struct {
+    double progress;                 /* Progress so far */
+    double total;                    /* Expected total (0 = unknown) */
+    const char *message;             /* Partial output / status (may be NULL) */
+    size_t message_len;
+} ac_mcp_progress_t;
+
+/**
+ * @brief Progress callback
+ *
+ * Runs on the transport's thread (SSE stream, stdio reader, or the
+ * calling thread for Streamable HTTP) while the call is in flight.
+ * Keep it short; it must not call back into the same client.
+ */
+typedef void (*ac_mcp_progress_fn)(const ac_mcp_progress_t *progress, void *user_data);
+
+/**
+ * @brief Options for ac_mcp_call_tool_ex()
+ *
+ * Without a sink the result is a malloc'd string as with
+ * ac_mcp_call_tool(). With arena set, the {"result": ...} JSON is built
+ * in that arena (not freed by the caller). With result_path set, the
+ * text content is written straight to that file instead and the result
+ * is {"result_file": path, "bytes": N}.
+ */
+typedef struct {
+    ac_mcp_progress_fn on_progress;  /* Requests progress from the server (optional) */
+    void *user_data;                 /* Passed to on_progress */
+    arena_t *arena;                  /* Result sink (optional, caller serializes) */
+    const char *result_path;         /* File sink (optional, wins over arena) */
+    const volatile int *cancel;      /* Abort once *cancel != 0 (optional) */
+    uint64_t deadline_ms;            /* Absolute, ac_platform_timestamp_ms (0 = none) */
+} ac_mcp_call_opts_t;
+
+/**
+ * @brief Call a tool with progress reporting and a result sink
+ *
+ * With on_progress set the request carries a progressToken, and the
+ * server's notifications/progress for it are delivered while the call
+ * runs; Streamable HTTP servers answering with an event stream are read
+ * incrementally.
+ *
+ * With cancel or deadline_ms set, the call is abandoned as soon as either
+ * hits, whether still queued behind other calls or in flight, and the
+ * server is sent notifications/cancelled for it. A call that went out in
+ * a batch with concurrent ones waits for the batch.
+ *
+ * @param client     MCP client
+ * @param name       Tool name
+ * @param args_json  JSON arguments
+ * @param opts       Options (NULL = same as ac_mcp_call_tool())
+ * @param result     Output result (see ac_mcp_call_opts_t for ownership)
+ * @return ARC_OK on success, ARC_ERR_IO if the result file cannot be written,
+ *         ARC_ERR_CANCELLED, ARC_ERR_TIMEOUT (deadline passed)
+ */
+arc_err_t ac_mcp_call_tool_ex(
+    ac_mcp_client_t *client,
+    const char *name,
+    const char *args_json,
+    const ac_mcp_call_opts_t *opts,
+    char **result
+);
+
 /*============================================================================
  * Error Handling
  *============================================================================*/
@@ -216,6 +327,25 @@ arc_err_t ac_mcp_get_tool_info(
     const char **parameters
 );
 
+/**
+ * @brief Get tool annotation hints by index (internal use)
+ *
+ * @param client  MCP client
+ * @param index   Tool index
+ * @return AC_MCP_TOOL_* flags, 0 if none or out of range
+ */
+unsigned ac_mcp_get_tool_hints(const ac_mcp_client_t *client, size_t index);
+
+/**
+ * @brief Install a revalidated tool list if one is waiting (internal use)
+ *
+ * Call on the thread that owns the registry holding the client's tools.
+ *
+ * @param client  MCP client
+ * @return Tool list generation: changes whenever the list was replaced
+ */
+unsigned ac_mcp_tools_refresh(ac_mcp_client_t *client);
+
 /**
  * @brief Cleanup MCP client (called by session)
  */
@@ -231,6 +361,14 @@ void ac_mcp_cleanup(ac_mcp_client_t *client);
  * File format:
  * @code{.json}
  * {
+ *   "connect_timeout_ms": 10000,
+ *   "tools_cache_dir": ".mcp-cache",
+ *   "lazy_tools": true,
+ *   "result_cache": {
+ *     "ttl_ms": 60000,
+ *     "annotations": true,
+ *     "tools": ["resolve-library-id"]
+ *   },
  *   "servers": [
  *     {
  *       "name": "context7",
@@ -242,7 +380,13 @@ void ac_mcp_cleanup(ac_mcp_client_t *client);
  *       "url": "http://localhost:3001/mcp",
  *       "api_key": "secret-key",
  *       "timeout_ms": 60000,
+ *       "reconnect_fail_fast": true,
  *       "enabled": true
+ *     },
+ *     {
+ *       "name": "git",
+ *       "command": "uvx",
+ *       "args": ["mcp-server-git", "--repository", "."]
  *     }
  *   ]
  * }
@@ -303,6 +447,16 @@ void ac_mcp_config_free(ac_mcp_servers_config_t *config);
  * 3. Discovers tools from each server
  * 4. Adds all tools to the registry
  *
+ * All servers connect concurrently, within an overall deadline
+ * ("connect_timeout_ms", default 30 s): a server that has not finished
+ * by then is skipped. Tools are registered in config order whatever the
+ * order of completion, and per-server timings are logged. With
+ * "tools_cache_dir" set, tools come from the cache as in
+ * ac_mcp_discover_tools_cached(). A "result_cache" object enables
+ * ac_tool_registry_cache_mcp() on the registry ("annotations": false
+ * caches only the listed "tools"), and "lazy_tools" enables
+ * ac_tool_registry_lazy_mcp().
+ *
  * Failed connections are logged but don't stop other servers.
  * All clients are managed by the session (auto-cleanup).
  *
@@ -2,9 +2,12 @@
  * @file memory.h
  * @brief ArC Memory Management
  *
- * Provides session memory (in-memory message history) and persistent memory (SQLite).
+ * Provides session memory (in-memory message history) and persistent memory.
  * Session memory: stores messages in memory, cleared when session ends.
- * Persistent memory: stores in filesystem using SQLite (reserved, not implemented yet).
+ * Persistent memory: appends each message as one record to a log file at
+ * db_path, so saving costs O(new messages) and loading is a single read.
+ * On devices without a file system the log can live on a raw flash
+ * partition instead (ac_memory_flash_t).
  */
 
 #ifndef ARC_MEMORY_H
@@ -13,6 +16,7 @@
 #include "platform.h"
 #include "error.h"
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +28,38 @@ extern "C" {
 
 struct ac_message;  /* Defined in llm.h */
 
+/*============================================================================
+ * Flash Storage
+ *============================================================================*/
+
+/**
+ * @brief A raw flash partition to keep the persistent log on
+ *
+ * Addresses are relative to the partition start. The partition is used
+ * as a ring of sectors written in turn, so every sector is erased
+ * equally often; when it is full the oldest sector is erased and the
+ * messages in it are no longer loaded. Programs are whole prog_size
+ * units at increasing addresses, and no unit is programmed twice between
+ * erases. A record torn by a power cut is skipped on load and never
+ * appended after.
+ *
+ * RAM use is the handle plus one cache of ARC_MEMORY_FLASH_CACHE bytes:
+ * records are streamed to and from flash, never read whole. A fixed-size
+ * file on a file system (LittleFS) can stand in for the partition.
+ */
+typedef struct {
+    /** Read len bytes at addr */
+    arc_err_t (*read)(void *ctx, uint32_t addr, void *buf, size_t len);
+    /** Program len bytes at addr (both multiples of prog_size, erased before) */
+    arc_err_t (*prog)(void *ctx, uint32_t addr, const void *buf, size_t len);
+    /** Erase one sector (every byte reads 0xFF afterwards) */
+    arc_err_t (*erase)(void *ctx, uint32_t sector);
+    void *ctx;
+    uint32_t sector_size;               /* Erase unit in bytes */
+    uint32_t sector_count;              /* Sectors in the partition (2 or more) */
+    uint32_t prog_size;                 /* Program unit, a power of two (1 for NOR) */
+} ac_memory_flash_t;
+
 /*============================================================================
  * Memory Configuration
  *============================================================================*/
@@ -31,10 +67,14 @@ struct ac_message;  /* Defined in llm.h */
 typedef struct {
     const char *session_id;             /* Session identifier (optional) */
     size_t max_messages;                /* Max messages to keep (0 = unlimited) */
-    size_t max_tokens;                  /* Max tokens to keep (0 = unlimited) */
-
-    /* Persistent storage (reserved for future) */
-    const char *db_path;                /* SQLite database path (optional) */
+    size_t max_tokens;                  /* Max tokens to keep (0 = unlimited; also capped by llm.context_window) */
+    size_t max_tool_bytes;              /* Max tool output bytes kept in history (0 = unlimited) */
+    const char *spill_dir;              /* Evicted tool output is saved here (optional) */
+    int dedup_tool_results;             /* Send a repeated tool result as a reference to the earlier one (agents, default: 0) */
+
+    /* Persistent storage */
+    const char *db_path;                /* Log file path (persistence without flash) */
+    const ac_memory_flash_t *flash;     /* Flash partition for the log instead of db_path (copied) */
     int enable_persistence;             /* Enable persistent storage (default: 0) */
 } ac_memory_config_t;
 
@@ -67,6 +107,8 @@ ac_memory_t *ac_memory_create(const ac_memory_config_t *config);
 /**
  * @brief Destroy a memory manager
  *
+ * Unsaved messages are saved first when persistence is enabled.
+ *
  * @param memory  Memory handle
  */
 void ac_memory_destroy(ac_memory_t *memory);
@@ -74,6 +116,9 @@ void ac_memory_destroy(ac_memory_t *memory);
 /**
  * @brief Add a message to memory
  *
+ * max_messages/max_tokens trim the in-memory list only; every added
+ * message is kept in the log.
+ *
  * @param memory   Memory handle
  * @param message  Message to add (copied internally)
  * @return ARC_OK on success, error code otherwise
@@ -99,6 +144,9 @@ size_t ac_memory_count(ac_memory_t *memory);
 /**
  * @brief Clear all messages from memory
  *
+ * With persistence enabled the log is emptied as well (on flash, by
+ * starting a new sector rather than erasing the partition).
+ *
  * @param memory  Memory handle
  */
 void ac_memory_clear(ac_memory_t *memory);
@@ -108,23 +156,33 @@ void ac_memory_clear(ac_memory_t *memory);
  *
  * @param memory  Memory handle
  * @param n       Number of messages to get
- * @return Linked list of messages (caller must free with ac_message_free)
+ * @return Linked list of messages (do not free, owned by memory)
  */
 struct ac_message *ac_memory_get_last_n(ac_memory_t *memory, size_t n);
 
 /**
- * @brief Save memory to persistent storage (reserved for future)
+ * @brief Save memory to persistent storage
+ *
+ * Appends the messages added since the last save to the log; earlier
+ * records are never rewritten.
  *
  * @param memory  Memory handle
- * @return ARC_OK on success, error code otherwise
+ * @return ARC_OK on success, ARC_ERR_INVALID_STATE without persistence,
+ *         ARC_ERR_IO if the log cannot be written (messages stay unsaved)
  */
 arc_err_t ac_memory_save(ac_memory_t *memory);
 
 /**
- * @brief Load memory from persistent storage (reserved for future)
+ * @brief Load memory from persistent storage
+ *
+ * Replaces the in-memory messages with the log contents (unsaved messages
+ * are saved first), then applies max_messages/max_tokens. A missing log
+ * loads as empty; a record torn by a crash is dropped from the file (on
+ * flash it is skipped).
  *
  * @param memory  Memory handle
- * @return ARC_OK on success, error code otherwise
+ * @return ARC_OK on success, ARC_ERR_INVALID_STATE without persistence,
+ *         ARC_ERR_PARSE if db_path is not a memory log, ARC_ERR_IO
  */
 arc_err_t ac_memory_load(ac_memory_t *memory);
 
@@ -5,6 +5,14 @@
  * Message structure for conversation history with content block support.
  * Supports thinking/reasoning blocks from models like Claude and GPT.
  * Messages are stored in agent's arena.
+ *
+ * The long strings (content, block text and input, tool call arguments)
+ * carry their length in a _len field next to the pointer, so serializers,
+ * token estimates and history accounting do not rescan them. A length of
+ * 0 means "not recorded": readers go through the accessors below
+ * (ac_message_content() and friends), which fall back to strlen(), so
+ * code that only sets the pointer keeps working. Code that replaces a
+ * pointer must set (or zero) its length.
  */
 
 #ifndef ARC_MESSAGE_H
@@ -42,8 +50,39 @@ typedef enum {
     AC_BLOCK_REASONING,         /**< Reasoning content (OpenAI) */
     AC_BLOCK_TOOL_USE,          /**< Tool/function call request */
     AC_BLOCK_TOOL_RESULT,       /**< Tool/function call result */
+    AC_BLOCK_IMAGE,             /**< Image attachment (see ac_attachment_t) */
 } ac_block_type_t;
 
+/*============================================================================
+ * Attachments
+ *============================================================================*/
+
+/**
+ * @brief Image sent with a message, read from a file or a caller buffer
+ *
+ * An attachment is never held encoded: its bytes are read and base64
+ * encoded while each request body is sent, a chunk at a time, so history
+ * holds this struct rather than the image. Where the provider has a
+ * files API (Anthropic), an image sent a second time is uploaded once and
+ * referenced by its file id from then on; uploaded files are not deleted.
+ */
+/** Longest provider file id kept for an attachment */
+#define AC_ATTACHMENT_FILE_ID_MAX 96
+
+typedef struct ac_attachment {
+    const char* path;           /**< File, read at send time (or data) */
+    const void* data;           /**< Bytes, referenced: must outlive the history */
+    size_t size;                /**< Bytes of data (set from the file for path) */
+    const char* media_type;     /**< "image/png", ... (NULL = from the content) */
+
+    /* Kept by the LLM layer */
+    int64_t mtime;              /**< File modification time when attached */
+    uint32_t sends;             /**< Request bodies that carried it */
+    int upload_failed;          /**< Not offered to the files API again */
+    char file_id[AC_ATTACHMENT_FILE_ID_MAX]; /**< Uploaded copy ("" = sent inline) */
+    const char* file_provider;  /**< Provider that issued file_id */
+} ac_attachment_t;
+
 /*============================================================================
  * Content Block Structure (v2)
  *============================================================================*/
@@ -58,7 +97,8 @@ typedef struct ac_content_block {
     ac_block_type_t type;       /**< Block type */
     
     /* Type-specific data (use based on type) */
-    char* text;                 /**< Text content (TEXT, THINKING) */
+    char* text;                 /**< Text content (TEXT, THINKING, TOOL_RESULT) */
+    size_t text_len;            /**< Bytes in text (0 = not recorded) */
     char* signature;            /**< Signature for THINKING blocks (must preserve) */
     char* data;                 /**< Encrypted data for REDACTED_THINKING */
     
@@ -66,7 +106,11 @@ typedef struct ac_content_block {
     char* id;                   /**< Tool call ID (TOOL_USE, TOOL_RESULT) */
     char* name;                 /**< Function name (TOOL_USE) */
     char* input;                /**< JSON arguments (TOOL_USE) */
+    size_t input_len;           /**< Bytes in input (0 = not recorded) */
     int is_error;               /**< Error flag (TOOL_RESULT) */
+
+    ac_attachment_t* attachment;  /**< Image source (IMAGE; text, name and data
+                                       also hold path, media type, "size:mtime") */
     
     struct ac_content_block* next;  /**< Linked list */
 } ac_content_block_t;
@@ -82,6 +126,7 @@ typedef struct ac_tool_call {
     char* id;                        /* Tool call ID (e.g., "call_abc123") */
     char* name;                      /* Function name */
     char* arguments;                 /* JSON arguments string */
+    size_t arguments_len;            /* Bytes in arguments (0 = not recorded) */
     struct ac_tool_call* next;       /* Linked list for multiple tool calls */
 } ac_tool_call_t;
 
@@ -92,6 +137,23 @@ typedef struct ac_tool_call {
 /**
  * @brief LLM chat completion response
  */
+/**
+ * @brief Where the time of one LLM call went (0 = not measured)
+ *
+ * The transport fields come from the HTTP layer; the stream fields are
+ * measured on the deltas as they arrive, from the start of the call.
+ */
+typedef struct {
+    uint32_t pool_wait_ms;           /**< Waiting for a pooled connection */
+    uint32_t connect_ms;             /**< DNS + TCP + TLS (about 0 on a reused connection) */
+    uint32_t ttfb_ms;                /**< First response byte (transport) */
+    uint32_t first_token_ms;         /**< First text/thinking delta (streaming) */
+    uint32_t stream_ms;              /**< First to last delta (streaming) */
+    uint32_t max_gap_ms;             /**< Longest pause between deltas (streaming) */
+    uint32_t deltas;                 /**< Deltas received (streaming) */
+    float tokens_per_sec;            /**< Output tokens over stream_ms (streaming) */
+} ac_llm_timing_t;
+
 typedef struct {
     /* Response ID (for stateful APIs like OpenAI Responses) */
     char* id;                        /**< Response ID */
@@ -102,6 +164,7 @@ typedef struct {
     
     /* Legacy fields (backward compatibility) */
     char* content;                   /**< Text response (may be NULL if tool_calls) */
+    size_t content_len;              /**< Bytes in content (0 = not recorded) */
     ac_tool_call_t* tool_calls;      /**< Tool calls list (may be NULL) */
     int tool_call_count;             /**< Number of tool calls */
 
@@ -121,17 +184,41 @@ typedef struct {
     /* Finish reason */
     char* finish_reason;             /**< "stop", "tool_calls", "length", etc. */
     char* stop_reason;               /**< Alias (Anthropic naming) */
+
+    /* Structured output (params.response_format) */
+    char* format_error;              /**< Why the answer fails the schema (NULL = it passed, or no format) */
+
+    /* Transport outcome (set by providers, also on failure) */
+    int http_status;                 /**< Provider HTTP status (0 = no response) */
+    uint32_t retry_after_ms;         /**< Server-requested delay before retrying (0 = none) */
+    uint32_t ratelimit_wait_ms;      /**< Time queued by the client rate limiter */
+    ac_llm_timing_t timing;          /**< Latency breakdown */
+
+    /* Storage */
+    arena_t* arena;                  /**< Contents live here (NULL = heap, freed by ac_chat_response_free) */
+    struct ac_intern* intern;        /**< Tool names/ids are interned here when it shares arena (optional) */
 } ac_chat_response_t;
 
 /*============================================================================
  * Message Structure
  *============================================================================*/
 
+/**
+ * @brief Number of wire dialects a message can cache its JSON for
+ *
+ * Messages are immutable once appended to history, so the LLM layer
+ * serializes each one once per dialect and reuses the fragment on every
+ * later request. Code that edits a message in place must clear json_cache
+ * and reset tokens to 0.
+ */
+#define AC_MESSAGE_JSON_SLOTS 2
+
 typedef struct ac_message {
     ac_role_t role;
     
     /* Simple mode (backward compatible) */
     char* content;                   /**< Message content (stored in arena) */
+    size_t content_len;              /**< Bytes in content (0 = not recorded) */
     
     /* Content block mode (v2) */
     ac_content_block_t* blocks;      /**< Content blocks (for thinking models) */
@@ -140,9 +227,50 @@ typedef struct ac_message {
     char* tool_call_id;              /**< For AC_ROLE_TOOL: which tool call this responds to */
     ac_tool_call_t* tool_calls;      /**< For AC_ROLE_ASSISTANT: tool calls (legacy) */
     
+    /* Serialized request fragments (internal, filled lazily by the LLM layer) */
+    const char* json_cache[AC_MESSAGE_JSON_SLOTS];  /**< Per wire dialect, arena-owned */
+
+    /* Token estimate (internal, filled lazily by ac_message_tokens) */
+    uint32_t tokens;                 /**< Cached estimate, 0 = not computed */
+    uint8_t tokens_family;           /**< ac_tokens_family_t it was computed for */
+
     struct ac_message* next;         /**< Linked list */
 } ac_message_t;
 
+/*============================================================================
+ * String Accessors
+ *============================================================================*/
+
+/**
+ * @brief A string field and its length field as ac_str_t
+ *
+ * Measures the string only when no length was recorded.
+ */
+static inline ac_str_t ac_str_field(const char* s, size_t len) {
+    ac_str_t str = { s, s ? (len ? len : strlen(s)) : 0 };
+    return str;
+}
+
+static inline ac_str_t ac_message_content(const ac_message_t* msg) {
+    return ac_str_field(msg->content, msg->content_len);
+}
+
+static inline ac_str_t ac_block_text(const ac_content_block_t* block) {
+    return ac_str_field(block->text, block->text_len);
+}
+
+static inline ac_str_t ac_block_input(const ac_content_block_t* block) {
+    return ac_str_field(block->input, block->input_len);
+}
+
+static inline ac_str_t ac_tool_call_arguments(const ac_tool_call_t* call) {
+    return ac_str_field(call->arguments, call->arguments_len);
+}
+
+static inline ac_str_t ac_response_content(const ac_chat_response_t* resp) {
+    return ac_str_field(resp->content, resp->content_len);
+}
+
 /*============================================================================
  * Message API
  *============================================================================*/
@@ -171,6 +299,26 @@ ac_message_t* ac_message_create_tool_result(
     const char* content
 );
 
+/**
+ * @brief Create a message from content of known length
+ *
+ * Same as ac_message_create(), without measuring content; it may contain
+ * NULs.
+ */
+ac_message_t* ac_message_create_str(arena_t* arena, ac_role_t role, ac_str_t content);
+
+/**
+ * @brief Create a tool result message from content of known length
+ *
+ * Same as ac_message_create_tool_result(), without measuring content; it
+ * may contain NULs (binary tool output).
+ */
+ac_message_t* ac_message_create_tool_result_str(
+    arena_t* arena,
+    const char* tool_call_id,
+    ac_str_t content
+);
+
 /**
  * @brief Append message to list
  *
@@ -278,6 +426,18 @@ ac_content_block_t* ac_block_create_tool_result(
     int is_error
 );
 
+/**
+ * @brief Create an image block in arena
+ *
+ * path and media_type are copied, data is referenced. A file is checked
+ * and sized here, and must not change while the block is in history. The
+ * media type is taken from the content (PNG, JPEG, GIF, WebP) when not
+ * given.
+ *
+ * @return Block, NULL if the file cannot be read or the type is unknown
+ */
+ac_content_block_t* ac_block_create_image(arena_t* arena, const ac_attachment_t* attachment);
+
 /**
  * @brief Append block to list
  */
@@ -302,6 +462,15 @@ void ac_block_free_list(ac_content_block_t* list);
  */
 void ac_chat_response_init(ac_chat_response_t* response);
 
+/**
+ * @brief Initialize a response whose contents are parsed into an arena
+ *
+ * Strings and lists then share the arena's lifetime: ac_chat_response_free()
+ * only clears the fields, and ac_message_from_response() on the same arena
+ * adopts them without copying. Streaming calls always fill heap responses.
+ */
+void ac_chat_response_init_arena(ac_chat_response_t* response, arena_t* arena);
+
 /**
  * @brief Free response contents (not the struct itself)
  */
@@ -365,7 +534,8 @@ static inline int ac_response_has_thinking(const ac_chat_response_t* resp) {
  * @brief Create message from response (for multi-turn conversations)
  *
  * Converts response to an assistant message, preserving all content blocks
- * including thinking/signature for proper multi-turn handling.
+ * including thinking/signature for proper multi-turn handling. A response
+ * parsed into the same arena is adopted in place instead of copied.
  *
  * @param arena  Arena for allocation
  * @param resp   Response structure
@@ -0,0 +1,171 @@
+/**
+ * @file metrics.h
+ * @brief ArC Metrics API - In-process counters, gauges and histograms
+ *
+ * A process-wide registry of metrics rendered in OpenMetrics text format
+ * for scraping. Every counter, gauge and histogram is striped: each
+ * thread updates its own cache line with a relaxed atomic add, and only
+ * reading sums the stripes, so recording never contends.
+ *
+ * The runtime records these on its own:
+ *
+ * | Metric                              | Type      | Labels   |
+ * |-------------------------------------|-----------|----------|
+ * | arc_llm_requests_total              | counter   | provider |
+ * | arc_llm_errors_total                | counter   | provider |
+ * | arc_llm_input_tokens_total          | counter   | provider |
+ * | arc_llm_output_tokens_total         | counter   | provider |
+ * | arc_llm_request_duration_seconds    | histogram | provider |
+ * | arc_llm_first_token_seconds         | histogram | provider |
+ * | arc_tool_calls_total                | counter   |          |
+ * | arc_tool_errors_total               | counter   |          |
+ * | arc_tool_duration_seconds           | histogram |          |
+ * | arc_mcp_calls_total                 | counter   |          |
+ * | arc_mcp_errors_total                | counter   |          |
+ * | arc_mcp_call_duration_seconds       | histogram |          |
+ * | arc_arena_bytes                     | gauge     |          |
+ *
+ * ac_hosted adds arc_http_pool_acquire_wait_seconds (histogram),
+ * arc_http_pool_acquire_timeouts_total, arc_sandbox_execs_total,
+ * arc_sandbox_exec_errors_total and arc_sandbox_exec_duration_seconds.
+ *
+ * Usage:
+ * @code
+ * ac_metric_t *hits = ac_metrics_counter("myapp_cache_hits", NULL, "Cache hits");
+ * ac_metric_add(hits, 1);
+ *
+ * char *text = NULL;
+ * if (ac_metrics_render(&text, NULL) == ARC_OK) {
+ *     serve(text);               // Content-Type: application/openmetrics-text
+ *     ARC_FREE(text);
+ * }
+ * @endcode
+ */
+
+#ifndef ARC_METRICS_H
+#define ARC_METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "arc/error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Series the registry holds; lookups past it return NULL */
+#define AC_METRICS_MAX_SERIES      256
+
+/** Stripes per metric (threads beyond this share them) */
+#define AC_METRICS_STRIPES         8
+
+/** Histogram sub-buckets per power of two, as bits (HDR-style, 2 = 25% wide) */
+#define AC_METRICS_HIST_SUB_BITS   2
+
+/** Largest histogram value tracked exactly is below 2^(this + 1); above it clamps */
+#define AC_METRICS_HIST_MAX_EXP    36
+
+/** Content type of ac_metrics_render() output */
+#define AC_METRICS_CONTENT_TYPE \
+    "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+typedef enum {
+    AC_METRIC_COUNTER,           /**< Monotonic; rendered as <name>_total */
+    AC_METRIC_GAUGE,             /**< Goes up and down */
+    AC_METRIC_HISTOGRAM          /**< Distribution of non-negative integers */
+} ac_metric_type_t;
+
+typedef struct ac_metric ac_metric_t;
+
+/*============================================================================
+ * Registration
+ *
+ * Each returns the series for (name, labels), creating it on first use;
+ * later calls with the same pair return the same handle, so call sites
+ * may look their series up on every use. Lookup takes no lock.
+ *
+ * name    Family name, [a-zA-Z_:][a-zA-Z0-9_:]* (counters without _total)
+ * labels  Label set in exposition syntax, e.g. "provider=\"openai\"",
+ *         or NULL; keep the number of distinct values small
+ * help    One-line description (first registration wins)
+ *
+ * Return NULL when the registry is full, the name is registered with
+ * another type, or on allocation failure. Every update function accepts
+ * NULL and does nothing, so callers need not check.
+ *============================================================================*/
+
+ac_metric_t *ac_metrics_counter(const char *name, const char *labels, const char *help);
+
+ac_metric_t *ac_metrics_gauge(const char *name, const char *labels, const char *help);
+
+/**
+ * @brief Histogram of integer observations
+ *
+ * @param unit  Scale from recorded integers to the exported unit,
+ *              e.g. 1e-6 to record microseconds into a _seconds metric
+ */
+ac_metric_t *ac_metrics_histogram(const char *name, const char *labels, const char *help,
+                                  double unit);
+
+/*============================================================================
+ * Recording
+ *============================================================================*/
+
+/**
+ * @brief Add to a counter (negative deltas are ignored) or gauge
+ */
+void ac_metric_add(ac_metric_t *metric, int64_t delta);
+
+/**
+ * @brief Set a gauge
+ *
+ * Not atomic against concurrent ac_metric_add(); meant for gauges with
+ * a single writer.
+ */
+void ac_metric_set(ac_metric_t *metric, int64_t value);
+
+/**
+ * @brief Record one observation in a histogram
+ */
+void ac_metric_observe(ac_metric_t *metric, uint64_t value);
+
+/*============================================================================
+ * Reading
+ *============================================================================*/
+
+/**
+ * @brief Current value of a counter or gauge, observation count of a histogram
+ */
+int64_t ac_metric_value(const ac_metric_t *metric);
+
+/**
+ * @brief Value at percentile p (0..1) of a histogram, in recorded units
+ *
+ * @return Highest value of the bucket holding the p-th observation
+ *         (within 25%), 0 if empty
+ */
+uint64_t ac_metric_percentile(const ac_metric_t *metric, double p);
+
+/**
+ * @brief Render every series in OpenMetrics text format
+ *
+ * Histograms are exposed with cumulative buckets at powers of two of the
+ * recorded unit (each counting the observations below it), up to the
+ * first one above every observation.
+ *
+ * @param out  Receives the text (free with ARC_FREE)
+ * @param len  Receives its length (optional)
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_MEMORY
+ */
+arc_err_t ac_metrics_render(char **out, size_t *len);
+
+/**
+ * @brief Zero every series (handles stay valid)
+ */
+void ac_metrics_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_METRICS_H */
@@ -85,6 +85,137 @@
         #endif
     #endif
 
+    /* Static buffers of the mongoose backend (port/freertos/http/http_mongoose.c) */
+    #ifndef ARC_HTTP_MAX_CLIENTS
+        #define ARC_HTTP_MAX_CLIENTS         3               /* Clients alive at once */
+    #endif
+    #ifndef ARC_HTTP_TX_BUFFER_SIZE
+        #define ARC_HTTP_TX_BUFFER_SIZE      (2 * 1024)      /* Request head, body pieces */
+    #endif
+    #ifndef ARC_HTTP_HEAD_BUFFER_SIZE
+        #define ARC_HTTP_HEAD_BUFFER_SIZE    (2 * 1024)      /* Response status and headers */
+    #endif
+    #ifndef ARC_HTTP_BODY_BUFFER_SIZE
+        #define ARC_HTTP_BODY_BUFFER_SIZE    (16 * 1024)     /* Non-streamed response body */
+    #endif
+
+    /* TLS session resumption with mbedTLS (see http_mongoose.c "TLS Session Cache") */
+    #ifndef ARC_HTTP_TLS_SESSIONS
+        #define ARC_HTTP_TLS_SESSIONS        2               /* Origins whose session is kept, 0 = off */
+    #endif
+    #ifndef ARC_HTTP_TLS_SESSION_SIZE
+        #define ARC_HTTP_TLS_SESSION_SIZE    1024            /* Serialized session, ticket included */
+    #endif
+    #ifndef ARC_HTTP_TLS_SESSION_ATTR
+        #define ARC_HTTP_TLS_SESSION_ATTR                    /* e.g. RTC_NOINIT_ATTR: keep across deep sleep */
+    #endif
+
+#endif
+
+/*============================================================================
+ * Feature Selection
+ *
+ * Kconfig-style switches, all on by default. The CMake options of the same
+ * names (libs/ac_core/CMakeLists.txt) leave a disabled feature's sources
+ * out of the build and define its switch to 0; other build systems do
+ * both themselves. What a disabled feature exports is not in the library:
+ * a call to it fails to link rather than at run time.
+ *
+ *   ARC_FEATURE_OPENAI             Chat Completions provider ("openai")
+ *   ARC_FEATURE_ANTHROPIC          Messages provider ("anthropic")
+ *   ARC_FEATURE_STATEFUL           Responses provider ("openai_responses")
+ *                                  and the agent's stored-response chains
+ *   ARC_FEATURE_THINKING           Thinking / reasoning requests, deltas
+ *                                  and history blocks
+ *   ARC_FEATURE_MCP                MCP client (mcp.h) and MCP tools
+ *   ARC_FEATURE_MCP_HTTP           - Streamable HTTP transport
+ *   ARC_FEATURE_MCP_SSE            - SSE transport
+ *   ARC_FEATURE_MCP_STDIO          - stdio transport (local server process)
+ *   ARC_FEATURE_HOOKS              Lifecycle hooks (agent_hooks.h)
+ *   ARC_FEATURE_TRACE              Trace export (trace.h), needs hooks
+ *   ARC_FEATURE_PROVIDER_REGISTRY  Providers added at run time
+ *                                  (AC_PROVIDER_REGISTER); off, the
+ *                                  built-in table is the whole set
+ *   ARC_FEATURE_CASSETTE           HTTP record/replay (cassette.h)
+ *   ARC_FEATURE_HTTP_FAULTS        HTTP fault and latency injection
+ *                                  (http_faults.h, ARC_HTTP_FAULTS)
+ *============================================================================*/
+
+#ifndef ARC_FEATURE_OPENAI
+    #define ARC_FEATURE_OPENAI               1
+#endif
+#ifndef ARC_FEATURE_ANTHROPIC
+    #define ARC_FEATURE_ANTHROPIC            1
+#endif
+#ifndef ARC_FEATURE_STATEFUL
+    #define ARC_FEATURE_STATEFUL             1
+#endif
+#ifndef ARC_FEATURE_THINKING
+    #define ARC_FEATURE_THINKING             1
+#endif
+#ifndef ARC_FEATURE_MCP
+    #define ARC_FEATURE_MCP                  1
+#endif
+#ifndef ARC_FEATURE_MCP_HTTP
+    #define ARC_FEATURE_MCP_HTTP             ARC_FEATURE_MCP
+#endif
+#ifndef ARC_FEATURE_MCP_SSE
+    #define ARC_FEATURE_MCP_SSE              ARC_FEATURE_MCP
+#endif
+#ifndef ARC_FEATURE_MCP_STDIO
+    #define ARC_FEATURE_MCP_STDIO            ARC_FEATURE_MCP
+#endif
+#ifndef ARC_FEATURE_HOOKS
+    #define ARC_FEATURE_HOOKS                1
+#endif
+#ifndef ARC_FEATURE_TRACE
+    #define ARC_FEATURE_TRACE                ARC_FEATURE_HOOKS
+#endif
+#ifndef ARC_FEATURE_PROVIDER_REGISTRY
+    #define ARC_FEATURE_PROVIDER_REGISTRY    1
+#endif
+#ifndef ARC_FEATURE_CASSETTE
+    #define ARC_FEATURE_CASSETTE             1
+#endif
+#ifndef ARC_FEATURE_HTTP_FAULTS
+    #define ARC_FEATURE_HTTP_FAULTS          1
+#endif
+
+#if (ARC_FEATURE_MCP_HTTP || ARC_FEATURE_MCP_SSE || ARC_FEATURE_MCP_STDIO) && !ARC_FEATURE_MCP
+    #error "ARC_FEATURE_MCP_* transports need ARC_FEATURE_MCP"
+#endif
+#if ARC_FEATURE_TRACE && !ARC_FEATURE_HOOKS
+    #error "ARC_FEATURE_TRACE records through hooks: it needs ARC_FEATURE_HOOKS"
+#endif
+
+/* Without the feature no hook call is compiled in (agent_hooks_internal.h) */
+#if !ARC_FEATURE_HOOKS && !defined(AC_DISABLE_HOOKS)
+    #define AC_DISABLE_HOOKS
+#endif
+
+/*============================================================================
+ * Static Memory Profile
+ *
+ * ARC_STATIC_MEMORY=1: the library never calls malloc. ARC_MALLOC & co.
+ * draw from a fixed process pool (static_pool.h) over ARC_STATIC_HEAP_SIZE
+ * bytes or the region given to ac_static_memory_init(), and fail with
+ * ARC_ERR_NO_MEMORY once it is exhausted. The arena block cache is off:
+ * the pool already recycles blocks.
+ *============================================================================*/
+
+#ifndef ARC_STATIC_MEMORY
+    #define ARC_STATIC_MEMORY 0
+#endif
+
+#if ARC_STATIC_MEMORY
+    #ifndef ARC_RUNTIME_ALLOCATOR
+        #define ARC_RUNTIME_ALLOCATOR        1
+    #elif !ARC_RUNTIME_ALLOCATOR
+        #error "ARC_STATIC_MEMORY routes ARC_MALLOC through ARC_RUNTIME_ALLOCATOR"
+    #endif
+    #ifndef ARC_ARENA_CACHE_SIZE
+        #define ARC_ARENA_CACHE_SIZE         0
+    #endif
 #endif
 
 /*============================================================================
@@ -114,6 +245,24 @@
     #ifndef ARC_ARENA_GROWTH_FACTOR
         #define ARC_ARENA_GROWTH_FACTOR      2
     #endif
+    #ifndef ARC_ARENA_CACHE_SIZE
+        #define ARC_ARENA_CACHE_SIZE         0               /* Freed blocks go back to the heap */
+    #endif
+    #ifndef ARC_ARENA_TELEMETRY
+        #define ARC_ARENA_TELEMETRY          0               /* No per-tag counters */
+    #endif
+    #ifndef ARC_RUNTIME_ALLOCATOR
+        #define ARC_RUNTIME_ALLOCATOR        0               /* ARC_MALLOC is plain malloc */
+    #endif
+    #ifndef ARC_SESSION_EXECUTOR_THREADS
+        #define ARC_SESSION_EXECUTOR_THREADS 1               /* Async run workers */
+    #endif
+    #ifndef ARC_JSON_INPLACE
+        #define ARC_JSON_INPLACE             1               /* Responses read in place, no cJSON tree */
+    #endif
+    #ifndef ARC_STACK_BUDGET
+        #define ARC_STACK_BUDGET             1               /* Large run-path temporaries off the stack */
+    #endif
 
 #else /* Desktop platforms (Linux/Windows/macOS) */
 
@@ -133,21 +282,128 @@
     #ifndef ARC_ARENA_GROWTH_FACTOR
         #define ARC_ARENA_GROWTH_FACTOR      2
     #endif
+    #ifndef ARC_ARENA_CACHE_SIZE
+        #define ARC_ARENA_CACHE_SIZE         (16 * 1024 * 1024)  /* Freed blocks kept for reuse */
+    #endif
+    #ifndef ARC_ARENA_TELEMETRY
+        #define ARC_ARENA_TELEMETRY          1                   /* Per-tag byte counters */
+    #endif
+    #ifndef ARC_RUNTIME_ALLOCATOR
+        #define ARC_RUNTIME_ALLOCATOR        1                   /* ac_allocator_set() */
+    #endif
+    #ifndef ARC_SESSION_EXECUTOR_THREADS
+        #define ARC_SESSION_EXECUTOR_THREADS 4                   /* Async run workers */
+    #endif
+    #ifndef ARC_JSON_INPLACE
+        #define ARC_JSON_INPLACE             0                   /* Responses parsed to a cJSON tree */
+    #endif
+    #ifndef ARC_STACK_BUDGET
+        #define ARC_STACK_BUDGET             0                   /* Stack buffers for speed */
+    #endif
 
 #endif /* Platform selection */
 
+#if defined(ARC_PLATFORM_FREERTOS)
+
+    /* Session executor task pool (port/freertos/executor_freertos.c) */
+    #ifndef ARC_EXECUTOR_TASKS
+        #define ARC_EXECUTOR_TASKS           ARC_SESSION_EXECUTOR_THREADS  /* Static tasks, all sessions */
+    #endif
+    #ifndef ARC_EXECUTOR_STACK_SIZE
+        #define ARC_EXECUTOR_STACK_SIZE      (8 * 1024)      /* Bytes per task: a whole agent run */
+    #endif
+    #ifndef ARC_EXECUTOR_TASK_PRIORITY
+        #define ARC_EXECUTOR_TASK_PRIORITY   (tskIDLE_PRIORITY + 2)
+    #endif
+    #ifndef ARC_EXECUTOR_QUEUE_DEPTH
+        #define ARC_EXECUTOR_QUEUE_DEPTH     8               /* Jobs waiting per executor */
+    #endif
+
+#endif
+
+/* Page cache of a flash-backed memory log (ac_memory_flash_t) */
+#ifndef ARC_MEMORY_FLASH_CACHE
+    #define ARC_MEMORY_FLASH_CACHE           256
+#endif
+
+#if ARC_STATIC_MEMORY && !defined(ARC_STATIC_HEAP_SIZE)
+    /* One session and two agents' first arena blocks, twice over for runs */
+    #define ARC_STATIC_HEAP_SIZE (2 * (ARC_SESSION_ARENA_SIZE + 2 * ARC_AGENT_ARENA_SIZE))
+#endif
+
+/*============================================================================
+ * Streaming Limits
+ *
+ * ARC_STREAM_DELTA_ONLY=1: streamed text, reasoning and thinking reach the
+ * stream callback one delta at a time and are not collected. The response
+ * carries no text (content stays NULL), so history and the run result hold
+ * only what the caller keeps from the deltas, and streams are not stored
+ * in the response cache. Tool calls are still collected: their arguments
+ * are capped at ARC_STREAM_TOOL_ARGS_MAX bytes.
+ *
+ * ARC_SSE_LINE_MAX > 0: every SSE parser (LLM streams and MCP alike) gets
+ * one line buffer of this size up front, and no line or event may exceed
+ * it. A longer one fails the stream with ARC_ERR_RESPONSE_TOO_LARGE.
+ * 0 lets the buffer grow as needed.
+ *
+ * With both on, a stream's peak memory is set by these limits rather than
+ * by the length of the response.
+ *============================================================================*/
+
+#ifndef ARC_STREAM_DELTA_ONLY
+    #define ARC_STREAM_DELTA_ONLY 0
+#endif
+
+#if ARC_STREAM_DELTA_ONLY
+    #ifndef ARC_SSE_LINE_MAX
+        #define ARC_SSE_LINE_MAX             (16 * 1024)
+    #endif
+    #ifndef ARC_STREAM_TOOL_ARGS_MAX
+        #define ARC_STREAM_TOOL_ARGS_MAX     (16 * 1024)
+    #endif
+#else
+    #ifndef ARC_SSE_LINE_MAX
+        #define ARC_SSE_LINE_MAX             0
+    #endif
+    #ifndef ARC_STREAM_TOOL_ARGS_MAX
+        #define ARC_STREAM_TOOL_ARGS_MAX     0               /* Unlimited */
+    #endif
+#endif
+
 /*============================================================================
  * Memory Allocation
  *
- * Allow custom allocators for embedded systems
+ * Allow custom allocators: at compile time by defining ARC_MALLOC & co.,
+ * or at run time through ac_allocator_set() (see allocator.h) when
+ * ARC_RUNTIME_ALLOCATOR is on. ARC_FREE_SIZED passes the size along when
+ * the caller knows it.
  *============================================================================*/
 
 #ifndef ARC_MALLOC
-    #include <stdlib.h>
-    #define ARC_MALLOC(size)       malloc(size)
-    #define ARC_REALLOC(ptr, size) realloc(ptr, size)
-    #define ARC_FREE(ptr)          free(ptr)
-    #define ARC_CALLOC(n, size)    calloc(n, size)
+    #if ARC_RUNTIME_ALLOCATOR
+        #include "allocator.h"
+        #define ARC_MALLOC(size)       ac_alloc(size)
+        #define ARC_REALLOC(ptr, size) ac_realloc(ptr, size)
+        #define ARC_FREE(ptr)          ac_free(ptr)
+        #define ARC_CALLOC(n, size)    ac_calloc(n, size)
+        #define ARC_FREE_SIZED(ptr, size) ac_free_sized(ptr, size)
+        #ifndef ARC_STRDUP
+            #define ARC_STRDUP(s)      ac_strdup(s)
+        #endif
+        #ifndef ARC_STRNDUP
+            #define ARC_STRNDUP(s, n)  ac_strndup(s, n)
+        #endif
+    #else
+        #include <stdlib.h>
+        #define ARC_MALLOC(size)       malloc(size)
+        #define ARC_REALLOC(ptr, size) realloc(ptr, size)
+        #define ARC_FREE(ptr)          free(ptr)
+        #define ARC_CALLOC(n, size)    calloc(n, size)
+    #endif
+#endif
+
+#ifndef ARC_FREE_SIZED
+    #define ARC_FREE_SIZED(ptr, size) ((void)(size), ARC_FREE(ptr))
 #endif
 
 /*============================================================================
@@ -170,7 +426,7 @@
         static inline char* arc_strndup_impl(const char* s, size_t n) {
             size_t len = 0;
             while (len < n && s[len]) len++;
-            char* result = (char*)malloc(len + 1);
+            char* result = (char*)ARC_MALLOC(len + 1);
             if (result) {
                 memcpy(result, s, len);
                 result[len] = '\0';
@@ -217,6 +473,41 @@
     #endif
 #endif
 
+/*============================================================================
+ * Function Attributes
+ *
+ * ARC_NOINLINE keeps a rarely taken helper's locals out of its caller's
+ * stack frame.
+ *============================================================================*/
+
+#ifndef ARC_NOINLINE
+    #if defined(__GNUC__)
+        #define ARC_NOINLINE __attribute__((noinline))
+    #elif defined(_MSC_VER)
+        #define ARC_NOINLINE __declspec(noinline)
+    #else
+        #define ARC_NOINLINE
+    #endif
+#endif
+
+/*============================================================================
+ * Thread-Local Storage
+ *
+ * Left undefined on embedded targets, where RTOS task switches do not
+ * necessarily swap TLS; define it in the build to opt in. Features that
+ * need it fall back to shared behavior when it is missing.
+ *============================================================================*/
+
+#if !defined(ARC_THREAD_LOCAL) && !defined(ARC_PLATFORM_EMBEDDED)
+    #if defined(_MSC_VER)
+        #define ARC_THREAD_LOCAL __declspec(thread)
+    #elif __STDC_VERSION__ >= 201112L
+        #define ARC_THREAD_LOCAL _Thread_local
+    #elif defined(__GNUC__)
+        #define ARC_THREAD_LOCAL __thread
+    #endif
+#endif
+
 /*============================================================================
  * Platform Time Functions
  *
@@ -237,4 +528,71 @@
  */
 uint64_t ac_platform_timestamp_ms(void);
 
+/**
+ * @brief Microseconds from a monotonic clock, for measuring intervals
+ *
+ * Unrelated to wall time and never goes backwards.
+ *
+ * Platform implementations:
+ * - POSIX: port/posix/time_posix.c (clock_gettime CLOCK_MONOTONIC)
+ * - Windows: port/windows/time_windows.c (QueryPerformanceCounter)
+ * - FreeRTOS: port/freertos/time_freertos.c (weak, tick resolution)
+ *
+ * @return Microseconds since an arbitrary start
+ */
+uint64_t ac_platform_monotonic_us(void);
+
+/**
+ * @brief Block the calling thread for at least ms milliseconds
+ *
+ * Platform implementations:
+ * - POSIX: port/posix/time_posix.c (nanosleep)
+ * - Windows: port/windows/time_windows.c (Sleep)
+ * - FreeRTOS: port/freertos/time_freertos.c (weak, override with vTaskDelay)
+ */
+void ac_platform_sleep_ms(uint32_t ms);
+
+/*============================================================================
+ * Platform CPU Placement
+ *
+ * Optional: a port without thread or NUMA control reports one node and
+ * refuses to pin, and threads then stay where the OS puts them.
+ *============================================================================*/
+
+#include <stddef.h>
+
+/**
+ * @brief Number of NUMA nodes (1 if not NUMA or unknown)
+ *
+ * Platform implementations:
+ * - POSIX: port/posix/cpu_posix.c (/sys/devices/system/node on Linux)
+ * - Windows: port/windows/cpu_windows.c (single node)
+ * - FreeRTOS: port/freertos/cpu_freertos.c (weak, single node)
+ */
+int ac_platform_numa_nodes(void);
+
+/**
+ * @brief CPUs of a NUMA node
+ *
+ * @param node  Node, 0 to ac_platform_numa_nodes() - 1
+ * @param cpus  Output CPU ids (may be NULL to get the count)
+ * @param max   Capacity of cpus
+ * @return CPUs of the node (may exceed max), 0 if unknown
+ */
+size_t ac_platform_node_cpus(int node, int *cpus, size_t max);
+
+/**
+ * @brief Restrict the calling thread to a set of CPUs
+ *
+ * @return 0 on success, -1 if unsupported or refused
+ */
+int ac_platform_pin_thread(const int *cpus, size_t count);
+
+/**
+ * @brief Place the not yet touched pages of [ptr, ptr + size) on node
+ *
+ * Best effort, whole pages inside the range only; a no-op with one node.
+ */
+void ac_platform_bind_memory(void *ptr, size_t size, int node);
+
 #endif /* ARC_PLATFORM_H */
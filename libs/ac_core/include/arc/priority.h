@@ -0,0 +1,83 @@
+/**
+ * @file priority.h
+ * @brief Request priority classes and their fair-share scheduler
+ *
+ * Agents (ac_agent_params_t.priority) and LLM clients
+ * (ac_llm_params_t.priority) tag their work with a class. Every queue
+ * shared between agents serves its waiters by class: the session
+ * executor, the rate limiter and the HTTP pool's acquire queue.
+ *
+ * Classes share a queue by weight (stride scheduling): while all three
+ * have waiters, INTERACTIVE is served 16 times for every BATCH turn and
+ * NORMAL 4 times. An idle class does not bank turns. A waiter queued for
+ * longer than AC_PRIORITY_MAX_WAIT_MS is served next whatever its class,
+ * so batch work slows down under interactive load but never stops.
+ */
+
+#ifndef ARC_PRIORITY_H
+#define ARC_PRIORITY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Classes
+ *============================================================================*/
+
+typedef enum {
+    AC_PRIORITY_NORMAL = 0,         /**< Default */
+    AC_PRIORITY_INTERACTIVE,        /**< A user is waiting: latency first */
+    AC_PRIORITY_BATCH,              /**< Background work: throughput only */
+    AC_PRIORITY_COUNT
+} ac_priority_t;
+
+/** Queue wait after which a waiter is served regardless of class (ms) */
+#define AC_PRIORITY_MAX_WAIT_MS  2000
+
+/*============================================================================
+ * Scheduler
+ *============================================================================*/
+
+/**
+ * @brief Fair-share state of one queue (zero-initialize)
+ *
+ * Not thread-safe: guard it with the queue's lock.
+ */
+typedef struct {
+    uint64_t pass[AC_PRIORITY_COUNT];  /**< Service received, in strides */
+    uint64_t vtime;                    /**< Pass of the last class served */
+} ac_priority_sched_t;
+
+/**
+ * @brief Class to serve next
+ *
+ * Does not change the state: call ac_priority_charge() once the class
+ * was actually served.
+ *
+ * @param sched   Queue state
+ * @param oldest  Enqueue time (ms, any clock) of each class's oldest
+ *                waiter, 0 = class has no waiter
+ * @param now     Current time on the same clock
+ * @return Class, -1 if no class has a waiter
+ */
+int ac_priority_next(const ac_priority_sched_t *sched,
+                     const uint64_t oldest[AC_PRIORITY_COUNT], uint64_t now);
+
+/**
+ * @brief Record that a waiter of priority was served
+ */
+void ac_priority_charge(ac_priority_sched_t *sched, ac_priority_t priority);
+
+/**
+ * @brief priority, or AC_PRIORITY_NORMAL if out of range
+ */
+ac_priority_t ac_priority_clamp(int priority);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_PRIORITY_H */
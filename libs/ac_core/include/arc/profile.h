@@ -0,0 +1,135 @@
+/**
+ * @file profile.h
+ * @brief ArC Profiler - Where the time of a ReACT iteration goes
+ *
+ * Opt-in per session. While an agent of a profiled session runs an
+ * iteration, its thread keeps a stack of phases; the time between two
+ * phase changes is charged to the phase on top, so the phases of an
+ * iteration are exclusive and add up to its wall time:
+ *
+ * | Phase     | Time spent                                           |
+ * |-----------|------------------------------------------------------|
+ * | agent     | The loop itself: history, messages, arena, anything  |
+ * |           | not covered below                                    |
+ * | hooks     | Hook subscribers (trace exporters included) and      |
+ * |           | stream callbacks                                     |
+ * | serialize | Building request bodies                              |
+ * | connect   | Connection pool wait, DNS, TCP and TLS               |
+ * | network   | Waiting on the server                                |
+ * | sse       | Parsing the event stream (provider handlers included)|
+ * | parse     | Parsing non-streamed response bodies                 |
+ * | tools     | Tool execution, whatever the tool does               |
+ *
+ * Each finished iteration is passed to on_iteration. Totals per stack
+ * accumulate in the session and render as folded stacks, one line per
+ * stack with its microseconds, e.g. "Analyst;network;sse 5120", the
+ * input of flamegraph.pl, inferno and speedscope.
+ *
+ * Work moved to other threads (parallel tools, the shared HTTP engine)
+ * shows up as the phase that waits for it.
+ *
+ * Usage:
+ * @code
+ * ac_profile_config_t prof = { .folded_path = "iterations.folded" };
+ * ac_session_profile(session, &prof);
+ * ...
+ * ac_session_close(session);   // writes iterations.folded
+ * // flamegraph.pl iterations.folded > iterations.svg
+ * @endcode
+ */
+
+#ifndef ARC_PROFILE_H
+#define ARC_PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "arc/error.h"
+#include "arc/session.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    AC_PROF_AGENT = 0,
+    AC_PROF_HOOKS,
+    AC_PROF_SERIALIZE,
+    AC_PROF_CONNECT,
+    AC_PROF_NETWORK,
+    AC_PROF_SSE,
+    AC_PROF_PARSE,
+    AC_PROF_TOOLS,
+    AC_PROF_PHASE_COUNT
+} ac_prof_phase_t;
+
+/**
+ * @brief Breakdown of one iteration
+ */
+typedef struct {
+    const char *agent_name;
+    int iteration;
+    uint64_t total_us;                          /**< Wall time */
+    uint64_t phase_us[AC_PROF_PHASE_COUNT];     /**< Exclusive, sums to total_us */
+} ac_prof_iteration_t;
+
+/**
+ * @brief Called on the agent's thread as each iteration ends
+ */
+typedef void (*ac_prof_callback_t)(void *ctx, const ac_prof_iteration_t *iteration);
+
+typedef struct {
+    ac_prof_callback_t on_iteration;   /**< Per-iteration breakdown (optional) */
+    void *ctx;                         /**< Passed to on_iteration */
+    const char *folded_path;           /**< Folded stacks written here when the
+                                            session closes (optional) */
+} ac_profile_config_t;
+
+/**
+ * @brief Profile the iterations of every agent of a session
+ *
+ * Takes effect from each agent's next iteration. Calling it again
+ * replaces the configuration and keeps the totals.
+ *
+ * @param session  Session handle
+ * @param config   Configuration (copied), NULL to stop profiling
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_INVALID_STATE (closed),
+ *         ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_session_profile(ac_session_t *session, const ac_profile_config_t *config);
+
+/**
+ * @brief Render the session's totals as folded stacks
+ *
+ * @param session  Session handle
+ * @param out      Receives the text (free with ARC_FREE)
+ * @param len      Receives its length (optional)
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_NOT_INITIALIZED (never
+ *         profiled), ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_session_profile_folded(ac_session_t *session, char **out, size_t *len);
+
+/**
+ * @brief Name of a phase as used in folded stacks
+ */
+const char *ac_prof_phase_name(ac_prof_phase_t phase);
+
+/**
+ * @brief Enter a phase on the calling thread
+ *
+ * For custom providers and transports; does nothing unless the thread
+ * is in a profiled iteration. A phase entered on top of itself, or
+ * anywhere under tools, is folded into the one already open. Every
+ * push needs its pop.
+ */
+void ac_prof_push(ac_prof_phase_t phase);
+
+/**
+ * @brief Leave the phase entered last
+ */
+void ac_prof_pop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_PROFILE_H */
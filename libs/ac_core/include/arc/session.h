@@ -35,7 +35,11 @@
 #ifndef ARC_SESSION_H
 #define ARC_SESSION_H
 
+#include "affinity.h"
+#include "allocator.h"
 #include "error.h"
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -62,6 +66,19 @@ typedef struct ac_session ac_session_t;
  */
 ac_session_t *ac_session_open(void);
 
+/**
+ * @brief Open a session whose memory comes from allocator
+ *
+ * The arenas of the session and of every agent created in it get their
+ * blocks from allocator (copied), which isolates a tenant's memory or
+ * counts it. Other heap allocations use the process-wide allocator
+ * (see allocator.h).
+ *
+ * @param allocator  Allocator (NULL = same as ac_session_open())
+ * @return Session handle, NULL on error
+ */
+ac_session_t *ac_session_open_with(const ac_allocator_t *allocator);
+
 /**
  * @brief Close session and destroy all resources
  *
@@ -72,6 +89,66 @@ ac_session_t *ac_session_open(void);
  */
 void ac_session_close(ac_session_t *session);
 
+/*============================================================================
+ * Session Executor
+ *
+ * Worker pool shared by async agent runs and parallel tool calls.
+ * Started lazily on first use. On FreeRTOS the workers are tasks
+ * borrowed from a static pool (ARC_EXECUTOR_TASKS); on other platforms
+ * without ARC_HAS_THREADS there are none and work runs inline.
+ *============================================================================*/
+
+/**
+ * @brief Executor statistics
+ */
+typedef struct {
+    size_t threads;                /**< Worker threads */
+    size_t active_workers;         /**< Workers currently running a job */
+    size_t queued_jobs;            /**< Jobs waiting to start */
+    uint64_t total_submitted;      /**< Total jobs submitted */
+    uint64_t total_completed;      /**< Total jobs finished */
+    uint64_t total_stolen;         /**< Jobs taken from a sibling's queue */
+    uint64_t busy_ms;              /**< Cumulative worker busy time */
+    uint64_t uptime_ms;            /**< Time since executor start */
+    double utilization;            /**< busy_ms / (uptime_ms * threads) */
+    size_t stack_size;             /**< Stack bytes per worker (0 = not fixed) */
+    size_t stack_peak;             /**< Deepest stack any job reached (0 = not measured) */
+} ac_session_executor_stats_t;
+
+/**
+ * @brief Set the executor size (default: ARC_SESSION_EXECUTOR_THREADS)
+ *
+ * @param session  Session handle
+ * @param threads  Worker count (0 = default)
+ * @return ARC_OK, ARC_ERR_INVALID_STATE if the executor already started
+ */
+arc_err_t ac_session_set_executor_threads(ac_session_t *session, size_t threads);
+
+/**
+ * @brief Pin the executor's workers (default: unpinned)
+ *
+ * Worker i is placed as thread i of affinity (arc/affinity.h), e.g.
+ * AC_AFFINITY_NUMA with local_memory to keep each worker and the arena
+ * blocks it allocates on one node.
+ *
+ * @param session   Session handle
+ * @param affinity  Placement (copied, NULL = unpinned)
+ * @return ARC_OK, ARC_ERR_INVALID_ARG (CPU list missing),
+ *         ARC_ERR_INVALID_STATE if the executor already started
+ */
+arc_err_t ac_session_set_executor_affinity(ac_session_t *session,
+                                           const ac_affinity_t *affinity);
+
+/**
+ * @brief Get executor statistics
+ *
+ * @param session  Session handle
+ * @param stats    Output statistics structure
+ * @return ARC_OK on success, ARC_ERR_NOT_INITIALIZED if not started yet
+ */
+arc_err_t ac_session_get_executor_stats(ac_session_t *session,
+                                        ac_session_executor_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
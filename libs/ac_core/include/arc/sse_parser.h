@@ -19,10 +19,18 @@ extern "C" {
  * SSE Event Structure
  *============================================================================*/
 
+/**
+ * Fields are (pointer, length) views, usually straight into the chunk
+ * being fed, and are NOT NUL-terminated. They are only valid during the
+ * callback; copy what must be kept.
+ */
 typedef struct {
     const char *event;  /**< Event type (e.g., "message", "endpoint") */
     const char *data;   /**< Event data (JSON string) */
-    const char *id;     /**< Event ID (optional) */
+    const char *id;     /**< Event ID (optional, NULL if absent) */
+    size_t event_len;
+    size_t data_len;
+    size_t id_len;
 } sse_event_t;
 
 /*============================================================================
@@ -41,18 +49,34 @@ typedef int (*sse_event_callback_t)(const sse_event_t *event, void *ctx);
  * SSE Parser Structure
  *============================================================================*/
 
+/**
+ * @brief Field of the event being assembled
+ *
+ * ptr views the line it came from; the value is copied into own only
+ * when it has to outlive that line (multi-line data, an event spanning
+ * chunks). own is kept across events.
+ */
+typedef struct {
+    const char *ptr;        /**< Value (NULL = not set) */
+    size_t len;
+    char *own;              /**< Accumulator */
+    size_t own_cap;
+} sse_field_t;
+
 typedef struct {
     char *buffer;           /**< Line buffer */
     size_t buffer_size;     /**< Buffer capacity */
     size_t buffer_len;      /**< Current buffer length */
 
-    char *event_type;       /**< Current event type */
-    char *data;             /**< Current data (accumulated) */
-    char *id;               /**< Current ID */
+    sse_field_t event_type; /**< Current event type */
+    sse_field_t data;       /**< Current data */
+    sse_field_t id;         /**< Current ID */
 
     sse_event_callback_t callback;
     void *ctx;
     int aborted;
+    int overflow;           /**< A line or event exceeded ARC_SSE_LINE_MAX */
+    int skip_lf;            /**< Chunk ended in CR: drop a leading LF */
 } sse_parser_t;
 
 /*============================================================================
@@ -79,6 +103,8 @@ void sse_parser_free(sse_parser_t *p);
  * @brief Feed data to parser
  *
  * Parses incoming data and invokes callback for each complete event.
+ * With ARC_SSE_LINE_MAX set, a line or event longer than that aborts the
+ * parser and sets p->overflow.
  *
  * @param p     Parser
  * @param data  Incoming data
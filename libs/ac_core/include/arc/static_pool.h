@@ -0,0 +1,124 @@
+/**
+ * @file static_pool.h
+ * @brief Fixed-region pool allocator (static memory profile)
+ *
+ * A pool hands out blocks from one caller-provided region and never
+ * touches the system heap. Requests are rounded to size classes (16-byte
+ * steps up to 128 bytes, then eight classes per power of two, so at most
+ * 12.5% rounding); a freed block goes back to its class and is reused
+ * as is. Blocks are never split or merged, so a pool's footprint is the
+ * sum of each class's peak and stops growing once a workload has been
+ * seen, however long the device runs. An exhausted pool fails the
+ * request (NULL, which the library reports as ARC_ERR_NO_MEMORY) instead
+ * of spilling anywhere else.
+ *
+ * A pool can back one session (ac_session_open_with()) or the whole
+ * process (ac_allocator_set()). Built with ARC_STATIC_MEMORY=1 the
+ * library allocates from a process pool by default - over
+ * ARC_STATIC_HEAP_SIZE bytes of .bss, or the region given to
+ * ac_static_memory_init() - and never calls malloc.
+ *
+ * Usage:
+ * @code
+ * static unsigned char region[256 * 1024];
+ * ac_static_pool_t *pool = ac_static_pool_create(region, sizeof(region));
+ * ac_allocator_t allocator;
+ * ac_static_pool_allocator(pool, &allocator);
+ * ac_session_t *session = ac_session_open_with(&allocator);
+ * @endcode
+ *
+ * tools/mem_budget reports what a session and its agents cost in a pool
+ * for the configuration the library was built with.
+ */
+
+#ifndef ARC_STATIC_POOL_H
+#define ARC_STATIC_POOL_H
+
+#include "allocator.h"
+#include "error.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_static_pool ac_static_pool_t;
+
+/**
+ * @brief Pool counters
+ */
+typedef struct {
+    size_t capacity;                   /**< Bytes available for blocks */
+    size_t carved;                     /**< Bytes ever cut from the region */
+    size_t in_use;                     /**< Bytes in live blocks (header and rounding included) */
+    size_t peak;                       /**< Highest in_use */
+    size_t live_blocks;                /**< Blocks allocated and not freed */
+    uint64_t allocations;              /**< Requests served */
+    uint64_t failures;                 /**< Requests refused: pool exhausted */
+} ac_static_pool_stats_t;
+
+/*============================================================================
+ * Pool API
+ *============================================================================*/
+
+/**
+ * @brief Make a pool of a region
+ *
+ * The pool's bookkeeping lives at the start of the region; nothing is
+ * allocated. The region must outlive every block taken from it.
+ *
+ * @param region  Memory to allocate from
+ * @param size    Its size in bytes
+ * @return Pool, NULL if the region is too small to hold the bookkeeping
+ */
+ac_static_pool_t *ac_static_pool_create(void *region, size_t size);
+
+/**
+ * @brief Fill an allocator vtable that allocates from the pool
+ */
+void ac_static_pool_allocator(ac_static_pool_t *pool, ac_allocator_t *out);
+
+/**
+ * @brief Snapshot the pool's counters (thread-safe)
+ */
+arc_err_t ac_static_pool_get_stats(ac_static_pool_t *pool, ac_static_pool_stats_t *stats);
+
+/**
+ * @brief Bytes a request of size occupies in a pool (header and rounding)
+ *
+ * @return Block size, 0 if no class is large enough
+ */
+size_t ac_static_pool_block_size(size_t size);
+
+/*============================================================================
+ * Process Pool (ARC_STATIC_MEMORY builds)
+ *============================================================================*/
+
+/**
+ * @brief Give the process pool its region
+ *
+ * Call before any other ArC function, e.g. to place the heap in external
+ * RAM. Without it the first allocation uses the built-in region of
+ * ARC_STATIC_HEAP_SIZE bytes.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_STATE (the process pool is already in
+ *         use), ARC_ERR_INVALID_ARG (region too small),
+ *         ARC_ERR_NOT_IMPLEMENTED (built without ARC_STATIC_MEMORY)
+ */
+arc_err_t ac_static_memory_init(void *region, size_t size);
+
+/**
+ * @brief The process pool (NULL before first use or without ARC_STATIC_MEMORY)
+ */
+ac_static_pool_t *ac_static_memory_pool(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_STATIC_POOL_H */
@@ -0,0 +1,91 @@
+/**
+ * @file tokens.h
+ * @brief Client-side token estimation
+ *
+ * Fast local estimate of the prompt tokens a text or message costs, for
+ * history budgeting and the pre-flight context check in the LLM layer
+ * (ac_llm_params_t.context_window). No vocabulary is shipped: the text is
+ * split the way byte-level BPE pre-tokenizers split it (letter runs with
+ * their leading space, digit groups, punctuation runs, whitespace) and
+ * each piece is charged per model family. Typical error is within ~15%
+ * on English prose and code; it is a budget, not a bill.
+ *
+ * Message estimates are cached on the message (ac_message_t.tokens), so
+ * re-estimating a long history every turn only walks the list.
+ */
+
+#ifndef ARC_TOKENS_H
+#define ARC_TOKENS_H
+
+#include "message.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Tokenizer Families
+ *============================================================================*/
+
+/**
+ * @brief Tokenizer family a model belongs to
+ *
+ * GENERIC is the conservative fallback (about 4 bytes per token) and
+ * over- rather than under-estimates for every family below.
+ */
+typedef enum {
+    AC_TOKENS_GENERIC = 0,      /**< Unknown model: byte heuristic */
+    AC_TOKENS_CL100K,           /**< GPT-4, GPT-3.5 */
+    AC_TOKENS_O200K,            /**< GPT-4o, GPT-4.1, GPT-5, o-series */
+    AC_TOKENS_CLAUDE,           /**< Anthropic Claude */
+    AC_TOKENS_LLAMA,            /**< Llama 3, Qwen, DeepSeek and other ~128k+ vocabularies */
+    AC_TOKENS_FAMILY_COUNT
+} ac_tokens_family_t;
+
+/** Per-message framing (role, separators) in tokens */
+#define AC_TOKENS_MESSAGE_OVERHEAD 4
+
+/** Per image block, whatever its size (about 1.15 megapixels) */
+#define AC_TOKENS_IMAGE 1600
+
+/**
+ * @brief Tokenizer family of a model name ("gpt-4o-mini", "claude-...")
+ *
+ * @return Matching family, AC_TOKENS_GENERIC if unknown or NULL
+ */
+ac_tokens_family_t ac_tokens_family(const char *model);
+
+/*============================================================================
+ * Estimation
+ *============================================================================*/
+
+/**
+ * @brief Estimate the tokens of len bytes of UTF-8 text
+ */
+size_t ac_tokens_estimate(const char *text, size_t len, ac_tokens_family_t family);
+
+/**
+ * @brief Estimate a NUL-terminated string (0 for NULL)
+ */
+size_t ac_tokens_estimate_str(const char *text, ac_tokens_family_t family);
+
+/**
+ * @brief Estimate the prompt tokens a message contributes
+ *
+ * Covers content, tool calls, content blocks and the per-message
+ * overhead. The result is cached on msg for the given family; code that
+ * edits a message in place must reset msg->tokens to 0.
+ */
+size_t ac_message_tokens(const ac_message_t *msg, ac_tokens_family_t family);
+
+/**
+ * @brief Sum of ac_message_tokens over a message list
+ */
+size_t ac_messages_tokens(const ac_message_t *messages, ac_tokens_family_t family);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_TOKENS_H */
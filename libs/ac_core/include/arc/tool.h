@@ -9,6 +9,12 @@
  *
  * Tools are registered to a registry, and the registry is passed to an agent.
  * The registry lifecycle is managed by the session.
+ *
+ * A registry may be shared by agents on any number of threads. Lookups,
+ * calls and schema reads never lock: they read an immutable snapshot of
+ * the catalog. Adding, attaching, updating and MCP syncing build the next
+ * snapshot under a writer lock and publish it at once; calls already
+ * running keep the version they started with.
  */
 
 #ifndef ARC_TOOL_H
@@ -17,6 +23,7 @@
 #include "arena.h"
 #include "error.h"
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -29,20 +36,82 @@ extern "C" {
 typedef struct ac_tool_registry ac_tool_registry_t;
 typedef struct ac_session ac_session_t;
 typedef struct ac_mcp_client ac_mcp_client_t;
+struct cJSON;
 
 /*============================================================================
  * Tool Execution Context
  *============================================================================*/
 
+/**
+ * @brief Whether a result came from a tool result cache
+ */
+typedef enum {
+    AC_TOOL_CACHE_NONE = 0,          /* Tool is not cached */
+    AC_TOOL_CACHE_MISS,              /* Cacheable, result was computed */
+    AC_TOOL_CACHE_HIT                /* Result served from the cache */
+} ac_tool_cache_status_t;
+
+/**
+ * @brief Resources used by the processes a tool call ran
+ *
+ * Filled through ac_tool_report_usage(); all zero if the tool ran none.
+ */
+typedef struct {
+    uint64_t processes;              /* Commands run */
+    uint64_t cpu_usec;               /* User + system CPU time */
+    uint64_t memory_peak;            /* Largest peak memory of one command, bytes */
+    uint64_t io_read_bytes;          /* Block IO */
+    uint64_t io_write_bytes;
+} ac_tool_usage_t;
+
+/**
+ * @brief Progress of a running tool (MCP notifications/progress)
+ *
+ * message is partial output or status text, NOT NUL-terminated and only
+ * valid during the callback.
+ */
+typedef struct {
+    const char *tool_name;
+    double progress;                 /* Progress so far */
+    double total;                    /* Expected total (0 = unknown) */
+    const char *message;             /* May be NULL */
+    size_t message_len;
+} ac_tool_progress_t;
+
+/**
+ * @brief Progress callback, may run on a transport thread
+ */
+typedef void (*ac_tool_progress_fn)(const ac_tool_progress_t *progress, void *user_data);
+
 /**
  * @brief Context passed to tool execution
+ *
+ * For tools registered with parse_args, args holds the arguments already
+ * parsed by the registry. It is only valid during the call: do not keep
+ * references into it or modify it.
  */
 typedef struct {
     const char *session_id;          /* Current session ID */
     const char *working_dir;         /* Working directory */
     void *user_data;                 /* User-provided context */
+    const struct cJSON *args;        /* Parsed args_json (parse_args tools, else NULL) */
+    ac_tool_cache_status_t *cache_status; /* Out: set by cached tools (may be NULL) */
+    ac_tool_usage_t *usage;          /* Out: added to while the call runs (may be NULL) */
+    const void *owner;               /* Who the call runs for, e.g. the agent (may be NULL) */
+    ac_tool_progress_fn on_progress; /* Progress of long-running tools (may be NULL) */
+    void *progress_user_data;        /* Passed to on_progress */
+    const volatile int *cancel;      /* Run cancelled once *cancel != 0 (may be NULL) */
+    uint64_t deadline_ms;            /* Run deadline, ac_platform_timestamp_ms (0 = none) */
 } ac_tool_ctx_t;
 
+/**
+ * @brief Whether the run behind ctx was cancelled or is past its deadline
+ *
+ * Long-running tools should poll this and return early; the result is
+ * discarded anyway. ctx may be NULL.
+ */
+int ac_tool_ctx_cancelled(const ac_tool_ctx_t *ctx);
+
 /*============================================================================
  * Tool Function Signature
  *============================================================================*/
@@ -63,6 +132,201 @@ typedef char* (*ac_tool_fn)(
     void *priv
 );
 
+/*============================================================================
+ * Decoded Arguments
+ *============================================================================*/
+
+typedef enum {
+    AC_TOOL_ARG_NULL = 0,
+    AC_TOOL_ARG_BOOL,
+    AC_TOOL_ARG_NUMBER,
+    AC_TOOL_ARG_STRING,
+    AC_TOOL_ARG_JSON                 /* Object or array, kept as JSON text */
+} ac_tool_arg_type_t;
+
+/**
+ * @brief One top-level argument
+ *
+ * key and str are NUL-terminated and unescaped (JSON: raw text).
+ */
+typedef struct {
+    const char *key;
+    ac_tool_arg_type_t type;
+    const char *str;                 /* STRING / JSON */
+    size_t len;                      /* Length of str */
+    double number;                   /* NUMBER */
+    int boolean;                     /* BOOL */
+} ac_tool_arg_t;
+
+/**
+ * @brief Arguments decoded once from the call's JSON object
+ *
+ * Only valid during the call: do not keep references into it.
+ */
+typedef struct {
+    const ac_tool_arg_t *items;      /* In document order */
+    size_t count;
+} ac_tool_args_t;
+
+/**
+ * @brief Tool function taking decoded arguments
+ *
+ * Same contract as ac_tool_fn, without parsing: the registry decodes
+ * args_json into args before the call.
+ */
+typedef char* (*ac_tool_args_fn)(
+    const ac_tool_ctx_t *ctx,
+    const ac_tool_args_t *args,
+    void *priv
+);
+
+/**
+ * @brief Argument by key (first match), NULL if absent
+ */
+const ac_tool_arg_t *ac_tool_args_get(const ac_tool_args_t *args, const char *key);
+
+/**
+ * @brief Decode args_json and call fn
+ *
+ * Small argument objects are decoded on the stack. For direct calls of
+ * an ac_tool_args_fn through the ac_tool_fn signature (MOC wrappers).
+ *
+ * @return fn's result, or an error JSON (heap) if args_json is not a
+ *         JSON object
+ */
+char *ac_tool_args_invoke(
+    ac_tool_args_fn fn,
+    const ac_tool_ctx_t *ctx,
+    const char *args_json,
+    void *priv
+);
+
+/*============================================================================
+ * Result Writer
+ *============================================================================*/
+
+/**
+ * @brief Destination of a tool's JSON result
+ *
+ * Values are serialized straight into the buffer the result is kept in
+ * (the agent's arena when the call runs on the agent thread): no cJSON
+ * tree, no intermediate string. Separators are inserted automatically;
+ * a value written after ac_tool_out_key() becomes that member's value.
+ * Errors are sticky; a result that is incomplete or hit an error counts
+ * as the tool returning NULL.
+ */
+typedef struct ac_tool_out ac_tool_out_t;
+
+/**
+ * @brief Tool function writing its result into out
+ *
+ * Same arguments as ac_tool_args_fn; the registry calls it in preference
+ * to execute_args and execute.
+ */
+typedef void (*ac_tool_write_fn)(
+    const ac_tool_ctx_t *ctx,
+    const ac_tool_args_t *args,
+    ac_tool_out_t *out,
+    void *priv
+);
+
+void ac_tool_out_object_begin(ac_tool_out_t *out);
+void ac_tool_out_object_end(ac_tool_out_t *out);
+void ac_tool_out_array_begin(ac_tool_out_t *out);
+void ac_tool_out_array_end(ac_tool_out_t *out);
+
+/** @brief Member key inside an object */
+void ac_tool_out_key(ac_tool_out_t *out, const char *key);
+
+/** @brief String value, escaped (NULL writes null) */
+void ac_tool_out_string(ac_tool_out_t *out, const char *s);
+
+void ac_tool_out_int(ac_tool_out_t *out, long long v);
+
+/** @brief Number value, formatted as cJSON does */
+void ac_tool_out_double(ac_tool_out_t *out, double v);
+
+void ac_tool_out_bool(ac_tool_out_t *out, int v);
+void ac_tool_out_null(ac_tool_out_t *out);
+
+/** @brief Pre-serialized value, copied verbatim (caller guarantees validity) */
+void ac_tool_out_raw(ac_tool_out_t *out, const char *json, size_t len);
+
+/**
+ * @brief Decode args_json, call fn and return what it wrote
+ *
+ * For direct calls of an ac_tool_write_fn through the ac_tool_fn
+ * signature (MOC wrappers).
+ *
+ * @return Result (heap, caller frees), an error JSON if args_json is not
+ *         a JSON object, NULL if fn wrote no complete value
+ */
+char *ac_tool_args_write(
+    ac_tool_write_fn fn,
+    const ac_tool_ctx_t *ctx,
+    const char *args_json,
+    void *priv
+);
+
+/*============================================================================
+ * Asynchronous Tools
+ *============================================================================*/
+
+/**
+ * @brief A started call of an asynchronous tool, completed exactly once
+ */
+typedef struct ac_tool_call ac_tool_call_t;
+
+/**
+ * @brief Tool function that starts its work and returns without waiting
+ *
+ * I/O-bound tools (HTTP fetches, database queries) start the operation
+ * and complete call from whichever thread finishes it, e.g. an HTTP
+ * engine's on_done callback, so no thread is blocked in the tool while
+ * it waits. ctx and args are only valid until fn returns: copy what the
+ * completion needs. Completing before returning is allowed, and is
+ * required on platforms without threads.
+ */
+typedef void (*ac_tool_async_fn)(
+    const ac_tool_ctx_t *ctx,
+    const ac_tool_args_t *args,
+    ac_tool_call_t *call,
+    void *priv
+);
+
+/**
+ * @brief Complete a call with its JSON result
+ *
+ * May be called from any thread; call is invalid afterwards.
+ *
+ * @param call    Call passed to the ac_tool_async_fn
+ * @param result  JSON result (heap, taken over); NULL counts as the tool
+ *                returning NULL
+ */
+void ac_tool_call_complete(ac_tool_call_t *call, char *result);
+
+/** @brief Complete a call with {"result": value}, as MOC tools return (NULL writes null) */
+void ac_tool_call_complete_string(ac_tool_call_t *call, const char *value);
+
+/** @brief Complete a call with {"error": message} */
+void ac_tool_call_fail(ac_tool_call_t *call, const char *message);
+
+/**
+ * @brief Decode args_json, start fn and wait for it to complete
+ *
+ * For direct calls of an ac_tool_async_fn through the ac_tool_fn
+ * signature (MOC wrappers). Blocks the calling thread.
+ *
+ * @return Result (heap, caller frees), an error JSON if args_json is not
+ *         a JSON object, NULL if the call completed with NULL
+ */
+char *ac_tool_args_await(
+    ac_tool_async_fn fn,
+    const ac_tool_ctx_t *ctx,
+    const char *args_json,
+    void *priv
+);
+
 /*============================================================================
  * Tool Definition
  *============================================================================*/
@@ -80,6 +344,30 @@ typedef char* (*ac_tool_fn)(
  *     .priv = NULL
  * };
  * @endcode
+ *
+ * Set parallel_safe when the tool may run concurrently with other
+ * parallel-safe tools (no shared mutable state, no ordering dependency).
+ * It only takes effect for agents created with tool_workers > 1.
+ *
+ * Arguments that are not valid JSON are rejected before execute is
+ * called. Set parse_args to also receive them parsed in ctx->args
+ * instead of parsing args_json again, or set execute_args to receive
+ * them decoded (the registry then calls it instead of execute). Set
+ * execute_write to also have the result written into an ac_tool_out_t
+ * instead of returned as a heap string.
+ *
+ * Set execute_async for a tool that completes later (ac_tool_async_fn).
+ * Agents start such tools from the agent thread and only wait for their
+ * completion, so a batch of parallel-safe async tools runs without
+ * occupying executor workers; other callers block until it completes.
+ *
+ * A deferred tool stays callable but is left out of the tools schema
+ * (lazy MCP stubs, see ac_tool_registry_lazy_mcp()).
+ *
+ * schema_openai / schema_anthropic optionally hold the tool's entry of
+ * the tools array, already serialized exactly as the registry would
+ * (compact, same key order). MOC emits them; the registry then copies
+ * the bytes instead of parsing and reprinting parameters.
  */
 typedef struct {
     const char *name;                /* Unique tool identifier */
@@ -87,8 +375,31 @@ typedef struct {
     const char *parameters;          /* JSON Schema string */
     ac_tool_fn execute;              /* Execution function */
     void *priv;                      /* Private data (for MCP, etc.) */
+    int parallel_safe;               /* May run concurrently with other tools */
+    int parse_args;                  /* Registry passes parsed args in ctx->args */
+    ac_tool_args_fn execute_args;    /* Decoded-arguments entry point (optional) */
+    int deferred;                    /* Not in the schema until loaded */
+    const char *schema_openai;       /* {"type":"function",...} (optional) */
+    const char *schema_anthropic;    /* {"name":...,"input_schema":...} (optional) */
+    ac_tool_write_fn execute_write;  /* Result-writer entry point (optional) */
+    ac_tool_async_fn execute_async;  /* Asynchronous entry point (optional) */
 } ac_tool_t;
 
+/**
+ * @brief Read-only table of tools with a perfect-hash lookup
+ *
+ * MOC generates one per tools header (ALL_TOOLS_TABLE): find() hashes
+ * the name twice and compares one candidate, with no probing. A registry
+ * holding only this table serves the whole-array schema literals as is.
+ */
+typedef struct {
+    const ac_tool_t *const *tools;   /* count tools */
+    size_t count;
+    const ac_tool_t *(*find)(const char *name);  /* NULL if not in the table */
+    const char *schema_openai;       /* Tools array, OpenAI format (optional) */
+    const char *schema_anthropic;    /* Tools array, Anthropic format (optional) */
+} ac_tool_table_t;
+
 /*============================================================================
  * Tool Registry Creation
  *============================================================================*/
@@ -128,9 +439,12 @@ ac_tool_registry_t *ac_tool_registry_create(ac_session_t *session);
 /**
  * @brief Add a single tool to registry
  *
+ * Tool names must be unique within a registry; lookups by name are
+ * O(1) through a hash index.
+ *
  * @param registry  Tool registry
  * @param tool      Tool definition (copied)
- * @return ARC_OK on success
+ * @return ARC_OK on success, ARC_ERR_EXISTS if the name is already taken
  */
 arc_err_t ac_tool_registry_add(
     ac_tool_registry_t *registry,
@@ -142,7 +456,8 @@ arc_err_t ac_tool_registry_add(
  *
  * @param registry  Tool registry
  * @param tools     NULL-terminated array of tool pointers
- * @return ARC_OK on success
+ * @return ARC_OK on success, ARC_ERR_EXISTS if some names were already
+ *         taken (the other tools are still added)
  *
  * Example:
  * @code
@@ -154,6 +469,45 @@ arc_err_t ac_tool_registry_add_array(
     const ac_tool_t **tools
 );
 
+/**
+ * @brief Attach a static tool table without copying it
+ *
+ * The registry keeps a pointer to table and looks names up through
+ * table->find() after its own tools, so attaching costs nothing per
+ * tool. The table and its tools must outlive the session and cannot be
+ * changed through the registry (ac_tool_registry_update_schema()).
+ *
+ * @param registry  Tool registry
+ * @param table     Table (e.g. MOC's ALL_TOOLS_TABLE)
+ * @return ARC_OK, ARC_ERR_EXISTS if a name is already registered (the
+ *         table is not attached), ARC_ERR_MEMORY
+ */
+arc_err_t ac_tool_registry_attach(
+    ac_tool_registry_t *registry,
+    const ac_tool_table_t *table
+);
+
+/**
+ * @brief Replace a registered tool's description and parameter schema
+ *
+ * For tools whose description tracks changing state (e.g. the skill
+ * tool listing available skills). The strings are copied and the cached
+ * schemas are rebuilt on the next request. Safe while tools from the
+ * registry run: they keep the entry they were found with.
+ *
+ * @param registry     Tool registry
+ * @param name         Registered tool name
+ * @param description  New description (NULL = none)
+ * @param parameters   New parameter schema JSON (NULL = none)
+ * @return ARC_OK, ARC_ERR_NOT_FOUND if there is no such tool
+ */
+arc_err_t ac_tool_registry_update_schema(
+    ac_tool_registry_t *registry,
+    const char *name,
+    const char *description,
+    const char *parameters
+);
+
 /*============================================================================
  * MCP Integration
  *============================================================================*/
@@ -173,6 +527,113 @@ arc_err_t ac_tool_registry_add_mcp(
     ac_mcp_client_t *client
 );
 
+/**
+ * @brief Swap in MCP tool lists that changed since they were added
+ *
+ * A client whose list was served from the tools/list cache revalidates
+ * it in the background; if the server's list differs, that client's
+ * entries are replaced here. ac_tool_registry_schema_cached() calls this,
+ * so an agent picks changes up at the start of its next request. Returns
+ * 0 at once if another thread is changing the registry.
+ *
+ * @param registry  Tool registry
+ * @return Number of clients whose tools were replaced
+ */
+size_t ac_tool_registry_sync_mcp(ac_tool_registry_t *registry);
+
+/**
+ * @brief Register MCP tools added from now on as lazy stubs
+ *
+ * For large catalogs. Each tool is registered deferred, with a one-line
+ * summary and no parameters, and a "load_tools" tool listing the
+ * unloaded stubs is added. The full description and schema of a tool
+ * enter the tools schema at the next request after the model loads it
+ * through load_tools or calls it. Call before ac_tool_registry_add_mcp()
+ * / ac_mcp_connect_all().
+ *
+ * @param registry  Tool registry
+ * @param enabled   1 = add stubs, 0 = add full tools (default)
+ * @return ARC_OK on success
+ */
+arc_err_t ac_tool_registry_lazy_mcp(ac_tool_registry_t *registry, int enabled);
+
+/**
+ * @brief MCP tool result cache configuration
+ *
+ * A tool is cached when its server annotates it readOnlyHint or
+ * idempotentHint (unless ignore_annotations is set), or when it is named
+ * in tools. Entries are keyed by server, tool and the arguments with
+ * object keys sorted and whitespace removed. Failed calls are not cached.
+ */
+typedef struct {
+    uint32_t ttl_ms;                 /* Entry lifetime (default: 300000) */
+    size_t max_entries;              /* Entries per server (default: 256) */
+    size_t max_bytes;                /* Result bytes per server (default: 4 MiB) */
+    int ignore_annotations;          /* Cache only the tools listed below */
+    const char *const *tools;        /* Tool names to cache (NULL-terminated, may be NULL) */
+} ac_mcp_result_cache_config_t;
+
+/**
+ * @brief Enable the result cache for MCP tools added from now on
+ *
+ * Opt-in; call before ac_tool_registry_add_mcp() / ac_mcp_connect_all().
+ * Hits and misses are reported through ac_tool_ctx_t.cache_status and the
+ * tool_end trace event.
+ *
+ * @param registry  Tool registry
+ * @param config    Cache settings (copied)
+ * @return ARC_OK on success
+ */
+arc_err_t ac_tool_registry_cache_mcp(
+    ac_tool_registry_t *registry,
+    const ac_mcp_result_cache_config_t *config
+);
+
+/**
+ * @brief Cumulative MCP result cache counters of a registry
+ *
+ * @param registry  Tool registry
+ * @param hits      Output: calls answered from the cache (may be NULL)
+ * @param misses    Output: cacheable calls sent to the server (may be NULL)
+ */
+void ac_tool_registry_mcp_cache_stats(
+    const ac_tool_registry_t *registry,
+    uint64_t *hits,
+    uint64_t *misses
+);
+
+/*============================================================================
+ * Large Results
+ *============================================================================*/
+
+/**
+ * @brief Spill settings for large tool results
+ */
+typedef struct {
+    const char *dir;                 /* Spill directory, created if missing (required) */
+    size_t threshold;                /* Results longer than this are spilled (default: 32 KiB) */
+    size_t excerpt_bytes;            /* Head and tail kept inline, each (default: 2 KiB) */
+} ac_tool_spill_config_t;
+
+/**
+ * @brief Spill large tool results to files
+ *
+ * A result over the threshold is written to a content-addressed file in
+ * dir and replaced by a JSON stand-in with its size, a handle and the
+ * head and tail of the output, so only the excerpt enters history. A
+ * read_spilled_output tool is added for the model to page through the
+ * rest by handle. Files are left in dir for the application to clean up.
+ *
+ * @param registry  Tool registry
+ * @param config    Spill settings (copied)
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_EXISTS (already enabled),
+ *         ARC_ERR_IO (dir unusable), ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_tool_registry_spill(
+    ac_tool_registry_t *registry,
+    const ac_tool_spill_config_t *config
+);
+
 /*============================================================================
  * Tool Query & Execution
  *============================================================================*/
@@ -194,6 +655,26 @@ const ac_tool_t *ac_tool_registry_find(
  */
 size_t ac_tool_registry_count(const ac_tool_registry_t *registry);
 
+/**
+ * @brief Add to the usage of the tool call running on this thread
+ *
+ * For code that runs processes on behalf of tools without seeing their
+ * ac_tool_ctx_t (ac_sandbox_exec_ex() calls it for every command).
+ * Counts add up; memory_peak keeps the largest. Does nothing outside
+ * ac_tool_registry_call() or when its ctx has no usage.
+ */
+void ac_tool_report_usage(const ac_tool_usage_t *usage);
+
+/**
+ * @brief Context of the tool call running on this thread
+ *
+ * Set for the duration of ac_tool_registry_call(), so code a tool calls
+ * into can find out whom it works for (see ac_tool_ctx_t.owner).
+ *
+ * @return The ctx passed to ac_tool_registry_call(), or NULL
+ */
+const ac_tool_ctx_t *ac_tool_current_ctx(void);
+
 /**
  * @brief Execute a tool by name
  *
@@ -201,7 +682,8 @@ size_t ac_tool_registry_count(const ac_tool_registry_t *registry);
  * @param name       Tool name
  * @param args_json  JSON arguments
  * @param ctx        Execution context (can be NULL)
- * @return Result JSON (caller must free), NULL on error
+ * @return Result JSON (caller must free), NULL on error; a spilled
+ *         stand-in for large results (see ac_tool_registry_spill())
  */
 char *ac_tool_registry_call(
     ac_tool_registry_t *registry,
@@ -220,6 +702,30 @@ char *ac_tool_registry_call(
  */
 char *ac_tool_registry_schema(const ac_tool_registry_t *registry);
 
+/**
+ * @brief Wire format of a serialized tools schema
+ */
+typedef enum {
+    AC_TOOL_SCHEMA_OPENAI = 0,       /* [{"type":"function","function":{...}}] */
+    AC_TOOL_SCHEMA_ANTHROPIC,        /* [{"name":...,"input_schema":{...}}] */
+    AC_TOOL_SCHEMA_FORMAT_COUNT
+} ac_tool_schema_format_t;
+
+/**
+ * @brief Get the serialized tools schema for a wire format (cached)
+ *
+ * Built on first use and kept until a tool is added to the registry,
+ * so providers can splice the bytes into request bodies without parsing.
+ *
+ * @param registry  Tool registry
+ * @param format    Wire format
+ * @return JSON array string (owned by registry, do not free), NULL if empty
+ */
+const char *ac_tool_registry_schema_cached(
+    ac_tool_registry_t *registry,
+    ac_tool_schema_format_t format
+);
+
 /*============================================================================
  * Tool Selection Macros (for MOC-generated tools)
  *============================================================================*/
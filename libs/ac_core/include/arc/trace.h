@@ -32,6 +32,9 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "arc/arena.h"
+#include "arc/error.h"
+#include "arc/message.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,7 +52,9 @@ typedef enum {
     AC_TRACE_LLM_REQUEST,        /**< LLM request sent */
     AC_TRACE_LLM_RESPONSE,       /**< LLM response received */
     AC_TRACE_TOOL_START,         /**< Tool execution started */
-    AC_TRACE_TOOL_END            /**< Tool execution completed */
+    AC_TRACE_TOOL_END,           /**< Tool execution completed */
+    AC_TRACE_MCP_CONNECTION,     /**< MCP stream lost / retried / restored */
+    AC_TRACE_ARENA               /**< Agent arena telemetry (just before agent_end) */
 } ac_trace_event_type_t;
 
 /*============================================================================
@@ -78,9 +83,13 @@ typedef struct {
 
 typedef struct {
     const char *model;
-    const char *messages_json;
+    const char *messages_json;   /**< NULL when history was not sampled */
     const char *tools_json;
     size_t message_count;
+    size_t message_offset;       /**< Index of the first message in messages_json */
+    int max_tokens;              /**< 0 = provider default */
+    int thinking_budget;         /**< 0 = thinking off */
+    int budget_reason;           /**< ac_budget_reason_t (0 = fixed) */
 } ac_trace_llm_request_t;
 
 typedef struct {
@@ -92,6 +101,10 @@ typedef struct {
     int total_tokens;
     const char *finish_reason;
     uint64_t duration_ms;
+    uint32_t ratelimit_wait_ms;
+    int draft;                   /**< ac_draft_decision_t (0 = not a draft call) */
+    int thinking_tokens;         /**< Reported or estimated (0 = none) */
+    ac_llm_timing_t timing;      /**< Connect, first byte/token, inter-token gaps */
 } ac_trace_llm_response_t;
 
 typedef struct {
@@ -106,8 +119,34 @@ typedef struct {
     const char *result;
     uint64_t duration_ms;
     int success;
+    int cache_status;            /**< ac_tool_cache_status_t (0 = not cached) */
+    uint64_t cache_hits;         /**< MCP result cache counters of the registry */
+    uint64_t cache_misses;
+    uint64_t processes;          /**< Commands run by the call (0 = none, no usage) */
+    uint64_t cpu_usec;           /**< ac_tool_usage_t of the call */
+    uint64_t memory_peak;
+    uint64_t io_read_bytes;
+    uint64_t io_write_bytes;
 } ac_trace_tool_end_t;
 
+typedef struct {
+    const char *server_url;
+    int event;                   /**< ac_mcp_conn_event_t */
+    int attempt;
+    uint32_t delay_ms;
+    uint64_t downtime_ms;
+    int resumed;
+    const char *error;
+} ac_trace_mcp_connection_t;
+
+typedef struct {
+    size_t total_capacity;
+    size_t total_allocated;
+    size_t peak_allocated;
+    size_t wasted_tail;
+    const arena_tag_stats_t *tags;  /**< ARENA_TAG_MAX entries, indexed by arena_tag_t */
+} ac_trace_arena_t;
+
 /*============================================================================
  * Trace Event Structure
  *============================================================================*/
@@ -118,6 +157,8 @@ typedef struct {
     const char *trace_id;
     const char *agent_name;
     int sequence;
+    uint32_t thread_id;          /**< Emitting thread, numbered from 1 in order of
+                                      first event (0 = unknown) */
 
     union {
         ac_trace_agent_start_t agent_start;
@@ -127,6 +168,8 @@ typedef struct {
         ac_trace_llm_response_t llm_response;
         ac_trace_tool_start_t tool_start;
         ac_trace_tool_end_t tool_end;
+        ac_trace_mcp_connection_t mcp_connection;
+        ac_trace_arena_t arena;
     } data;
 } ac_trace_event_t;
 
@@ -163,7 +206,8 @@ void ac_trace_enable(ac_trace_handler_t handler, void *user_data);
 /**
  * @brief Disable tracing
  *
- * Unregisters agent hooks and stops trace event generation.
+ * Unregisters agent hooks and stops trace event generation. With async
+ * delivery, queued events are handled before this returns.
  */
 void ac_trace_disable(void);
 
@@ -182,6 +226,95 @@ int ac_trace_is_enabled(void);
  */
 const char *ac_trace_event_name(ac_trace_event_type_t type);
 
+/*============================================================================
+ * Asynchronous Delivery
+ *
+ * With async delivery the hooks only copy each event (strings included)
+ * into a bounded lock-free ring; a background thread drains it and calls
+ * the handler, so exporter I/O stays off the agent's thread. An event
+ * that finds the ring full is dropped and counted, never waited for.
+ * Events from concurrent threads may reach the handler slightly out of
+ * sequence order.
+ *============================================================================*/
+
+typedef struct {
+    size_t capacity;             /**< Ring slots, rounded up to a power of two (0 = 1024) */
+} ac_trace_async_config_t;
+
+#define AC_TRACE_ASYNC_DEFAULT_CAPACITY 1024
+
+typedef struct {
+    uint64_t emitted;            /**< Events produced since tracing was enabled */
+    uint64_t delivered;          /**< Events passed to the handler */
+    uint64_t dropped;            /**< Events lost to a full ring (or out of memory) */
+    size_t queued;               /**< Events waiting in the ring now */
+    size_t high_water;           /**< Most events ever waiting at once */
+} ac_trace_stats_t;
+
+/**
+ * @brief Enable tracing with the handler called on a background thread
+ *
+ * Without thread support this is ac_trace_enable() (synchronous delivery).
+ *
+ * @param handler   Event handler, called from the exporter thread only
+ * @param user_data User data passed to handler
+ * @param config    Ring configuration (NULL = defaults)
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_NO_MEMORY, ARC_ERR_BACKEND
+ *         (thread could not be started)
+ */
+arc_err_t ac_trace_enable_async(
+    ac_trace_handler_t handler,
+    void *user_data,
+    const ac_trace_async_config_t *config
+);
+
+/**
+ * @brief Wait until every event emitted so far has been handled
+ *
+ * Immediate for synchronous delivery (and when called from the handler).
+ *
+ * @param timeout_ms  Longest wait (0 = no limit)
+ * @return ARC_OK, ARC_ERR_TIMEOUT
+ */
+arc_err_t ac_trace_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Delivery counters since tracing was last enabled
+ */
+void ac_trace_get_stats(ac_trace_stats_t *stats);
+
+/*============================================================================
+ * Sampling
+ *
+ * Recording the whole history on every LLM request costs quadratic time
+ * and space over a run. Sampling skips whole runs or the history of some
+ * requests; delta mode records only the messages added since the last
+ * recorded request (message_offset says where they start).
+ *============================================================================*/
+
+typedef enum {
+    AC_TRACE_HISTORY_FULL = 0,   /**< Whole history (default) */
+    AC_TRACE_HISTORY_DELTA,      /**< Messages added since the last recorded request */
+    AC_TRACE_HISTORY_OFF         /**< message_count only */
+} ac_trace_history_t;
+
+typedef struct {
+    uint32_t run_every;          /**< Trace one run in N (0, 1 = every run) */
+    uint32_t history_every;      /**< Record history on one request in N of a run
+                                      (0, 1 = every request) */
+    ac_trace_history_t history;
+} ac_trace_sampling_t;
+
+/**
+ * @brief Set sampling (kept across ac_trace_enable calls)
+ *
+ * Takes effect from the next run. Unsampled runs emit no events, except
+ * MCP connection events which belong to no run.
+ *
+ * @param sampling  Sampling options (NULL = trace everything)
+ */
+void ac_trace_set_sampling(const ac_trace_sampling_t *sampling);
+
 /*============================================================================
  * Utility Functions
  *============================================================================*/
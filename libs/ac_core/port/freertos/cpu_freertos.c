@@ -0,0 +1,35 @@
+/**
+ * @file cpu_freertos.c
+ * @brief FreeRTOS CPU placement
+ *
+ * One node, no pinning. On SMP ports override ac_platform_pin_thread(),
+ * e.g. with vTaskCoreAffinitySet().
+ */
+
+#include "arc/platform.h"
+
+__attribute__((weak)) int ac_platform_numa_nodes(void) {
+    return 1;
+}
+
+__attribute__((weak)) size_t ac_platform_node_cpus(int node, int *cpus, size_t max) {
+    if (node != 0) {
+        return 0;
+    }
+    if (cpus && max > 0) {
+        cpus[0] = 0;
+    }
+    return 1;
+}
+
+__attribute__((weak)) int ac_platform_pin_thread(const int *cpus, size_t count) {
+    (void)cpus;
+    (void)count;
+    return -1;
+}
+
+__attribute__((weak)) void ac_platform_bind_memory(void *ptr, size_t size, int node) {
+    (void)ptr;
+    (void)size;
+    (void)node;
+}
@@ -0,0 +1,491 @@
+/**
+ * @file executor_freertos.c
+ * @brief Session executor on a static FreeRTOS task pool
+ *
+ * Implements src/executor.h for FreeRTOS, where pthread_port.h offers no
+ * threads. ARC_EXECUTOR_TASKS tasks, each with a static TCB and a stack
+ * of ARC_EXECUTOR_STACK_SIZE bytes, are created on first use and never
+ * deleted. An executor borrows up to its thread count of them and gives
+ * them back when destroyed, so sessions opened one after another reuse
+ * the same tasks, and agents share a few bounded stacks instead of each
+ * blocking run needing its own.
+ *
+ * Jobs are fixed-size records in a FreeRTOS queue of
+ * ARC_EXECUTOR_QUEUE_DEPTH entries per executor: submitting allocates
+ * nothing. AC_PRIORITY_INTERACTIVE jobs go to the front of the queue,
+ * the other classes are served in order. A full queue fails the submit
+ * (callers then run the job inline). There is no stealing: every task
+ * serves the one queue.
+ *
+ * Stacks are painted with a fill byte and re-painted below the current
+ * stack pointer after every job, so each job's own depth is measured,
+ * not the task's lifetime high-water mark. It is logged at debug level,
+ * a job that comes within 10% of the stack is warned about, and the
+ * deepest one is reported as stack_peak in the executor stats.
+ */
+
+#include "executor.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include <stdint.h>
+#include <string.h>
+
+/*============================================================================
+ * Task Pool
+ *============================================================================*/
+
+#define STACK_WORDS   (ARC_EXECUTOR_STACK_SIZE / sizeof(StackType_t))
+#define STACK_FILL    0xA5             /* As FreeRTOS's tskSTACK_FILL_BYTE */
+#define STACK_GUARD   256              /* Left unpainted below the live frame (memset's own) */
+
+typedef struct {
+    ac_executor_fn run;                /* NULL = exit */
+    ac_executor_fn drop;
+    void *arg;
+} executor_job_t;
+
+typedef struct {
+    StaticTask_t tcb;
+    TaskHandle_t task;                 /* NULL until first used */
+    StaticSemaphore_t assign_buf;
+    SemaphoreHandle_t assign;          /* Given when ex is set */
+    struct ac_executor *ex;            /* Borrower, NULL = free */
+    size_t index;                      /* Worker index within ex */
+    StackType_t stack[STACK_WORDS];
+} task_slot_t;
+
+static task_slot_t s_slots[ARC_EXECUTOR_TASKS];
+static pthread_mutex_t s_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct ac_executor {
+    QueueHandle_t queue;
+    StaticQueue_t queue_buf;
+    uint8_t queue_storage[ARC_EXECUTOR_QUEUE_DEPTH * sizeof(executor_job_t)];
+    StaticSemaphore_t exited_buf;
+    SemaphoreHandle_t exited;          /* Given by each task handed back */
+    const ac_affinity_t *affinity;     /* Worker placement (NULL = unpinned) */
+
+    /* Stats, guarded by lock */
+    pthread_mutex_t lock;
+    size_t thread_count;
+    size_t active;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t busy_ms;
+    uint64_t start_ms;
+    size_t stack_peak;
+    int stack_warned;
+    int shutdown;
+};
+
+/*============================================================================
+ * Stack Measurement
+ *============================================================================*/
+
+/**
+ * @brief Bytes of the slot's stack written since it was last painted
+ */
+static size_t stack_used(const task_slot_t *slot) {
+    const uint8_t *p = (const uint8_t *)slot->stack;
+    size_t n = sizeof(slot->stack);
+    size_t untouched = 0;
+#if portSTACK_GROWTH < 0
+    while (untouched < n && p[untouched] == STACK_FILL) {
+        untouched++;
+    }
+#else
+    while (untouched < n && p[n - 1 - untouched] == STACK_FILL) {
+        untouched++;
+    }
+#endif
+    return n - untouched;
+}
+
+/**
+ * @brief Paint the part of the stack below the caller's frame
+ */
+static void stack_repaint(task_slot_t *slot) {
+    volatile uint8_t marker = 0;
+    uint8_t *p = (uint8_t *)slot->stack;
+    uint8_t *sp = (uint8_t *)&marker;
+#if portSTACK_GROWTH < 0
+    if (sp - p > STACK_GUARD) {
+        memset(p, STACK_FILL, (size_t)(sp - p) - STACK_GUARD);
+    }
+#else
+    uint8_t *end = p + sizeof(slot->stack);
+    if (end - sp > STACK_GUARD) {
+        memset(sp + STACK_GUARD, STACK_FILL, (size_t)(end - sp) - STACK_GUARD);
+    }
+#endif
+    (void)marker;
+}
+
+/*============================================================================
+ * Worker
+ *============================================================================*/
+
+static void record_stack(ac_executor_t *ex, task_slot_t *slot, size_t used) {
+    AC_LOG_DEBUG("Executor job used %zu of %zu stack bytes", used, sizeof(slot->stack));
+
+    pthread_mutex_lock(&ex->lock);
+    int warn = used * 10 > sizeof(slot->stack) * 9 && !ex->stack_warned;
+    if (warn) {
+        ex->stack_warned = 1;
+    }
+    if (used > ex->stack_peak) {
+        ex->stack_peak = used;
+    }
+    pthread_mutex_unlock(&ex->lock);
+
+    if (warn) {
+        AC_LOG_WARN("Executor job used %zu of %zu stack bytes: raise ARC_EXECUTOR_STACK_SIZE",
+                    used, sizeof(slot->stack));
+    }
+}
+
+/**
+ * @brief Serve ex's queue until the exit record
+ */
+static void worker_serve(ac_executor_t *ex, task_slot_t *slot) {
+    if (ex->affinity) {
+        ac_affinity_apply(ex->affinity, slot->index);
+    }
+
+    executor_job_t job;
+    for (;;) {
+        xQueueReceive(ex->queue, &job, portMAX_DELAY);
+        if (!job.run) {
+            break;
+        }
+
+        pthread_mutex_lock(&ex->lock);
+        int shutdown = ex->shutdown;
+        if (!shutdown) {
+            ex->active++;
+        }
+        pthread_mutex_unlock(&ex->lock);
+
+        if (shutdown) {
+            /* Queued before ac_executor_destroy(): dropped, not run */
+            if (job.drop) {
+                job.drop(job.arg);
+            }
+            continue;
+        }
+
+        uint64_t start_ms = ac_platform_timestamp_ms();
+        job.run(job.arg);
+        uint64_t elapsed_ms = ac_platform_timestamp_ms() - start_ms;
+
+        record_stack(ex, slot, stack_used(slot));
+        stack_repaint(slot);
+
+        pthread_mutex_lock(&ex->lock);
+        ex->active--;
+        ex->completed++;
+        ex->busy_ms += elapsed_ms;
+        pthread_mutex_unlock(&ex->lock);
+    }
+}
+
+static void worker_task(void *arg) {
+    task_slot_t *slot = (task_slot_t *)arg;
+
+    for (;;) {
+        xSemaphoreTake(slot->assign, portMAX_DELAY);
+        ac_executor_t *ex = slot->ex;
+
+        worker_serve(ex, slot);
+
+        /* Free again before ex learns it: ex may be gone right after */
+        pthread_mutex_lock(&s_pool_lock);
+        slot->ex = NULL;
+        pthread_mutex_unlock(&s_pool_lock);
+        xSemaphoreGive(ex->exited);
+    }
+}
+
+/**
+ * @brief Lend a free pool task to ex as worker index (pool lock held)
+ */
+static int slot_claim(task_slot_t *slot, ac_executor_t *ex, size_t index) {
+    if (!slot->task) {
+        memset(slot->stack, STACK_FILL, sizeof(slot->stack));
+        slot->assign = xSemaphoreCreateBinaryStatic(&slot->assign_buf);
+        slot->task = xTaskCreateStatic(worker_task, "arc_exec", STACK_WORDS, slot,
+                                       ARC_EXECUTOR_TASK_PRIORITY, slot->stack, &slot->tcb);
+        if (!slot->task) {
+            return 0;
+        }
+    }
+    slot->ex = ex;
+    slot->index = index;
+    xSemaphoreGive(slot->assign);
+    return 1;
+}
+
+/*============================================================================
+ * Public (internal) API
+ *============================================================================*/
+
+ac_executor_t *ac_executor_create(size_t threads, const ac_affinity_t *affinity) {
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    ac_executor_t *ex = (ac_executor_t *)ARC_CALLOC(1, sizeof(ac_executor_t));
+    if (!ex) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&ex->lock, NULL) != 0) {
+        ARC_FREE(ex);
+        return NULL;
+    }
+    ex->queue = xQueueCreateStatic(ARC_EXECUTOR_QUEUE_DEPTH, sizeof(executor_job_t),
+                                   ex->queue_storage, &ex->queue_buf);
+    ex->exited = xSemaphoreCreateCountingStatic(ARC_EXECUTOR_TASKS, 0, &ex->exited_buf);
+    ex->affinity = affinity && affinity->mode != AC_AFFINITY_NONE ? affinity : NULL;
+    ex->start_ms = ac_platform_timestamp_ms();
+
+    pthread_mutex_lock(&s_pool_lock);
+    for (size_t i = 0; i < ARC_EXECUTOR_TASKS && ex->thread_count < threads; i++) {
+        if (!s_slots[i].ex && slot_claim(&s_slots[i], ex, ex->thread_count)) {
+            ex->thread_count++;
+        }
+    }
+    pthread_mutex_unlock(&s_pool_lock);
+
+    if (ex->thread_count == 0) {
+        AC_LOG_WARN("Executor: all %d pool tasks in use (ARC_EXECUTOR_TASKS)",
+                    (int)ARC_EXECUTOR_TASKS);
+        vQueueDelete(ex->queue);
+        vSemaphoreDelete(ex->exited);
+        pthread_mutex_destroy(&ex->lock);
+        ARC_FREE(ex);
+        return NULL;
+    }
+    if (ex->thread_count < threads) {
+        AC_LOG_WARN("Executor: got %zu of %zu pool tasks", ex->thread_count, threads);
+    }
+
+    AC_LOG_DEBUG("Executor created (%zu tasks, %d stack bytes each)",
+                 ex->thread_count, (int)ARC_EXECUTOR_STACK_SIZE);
+    return ex;
+}
+
+arc_err_t ac_executor_submit(
+    ac_executor_t *ex,
+    ac_executor_fn run,
+    ac_executor_fn drop,
+    void *arg,
+    ac_priority_t priority
+) {
+    if (!ex || !run) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    int shutdown = ex->shutdown;
+    pthread_mutex_unlock(&ex->lock);
+    if (shutdown) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    executor_job_t job = { run, drop, arg };
+    BaseType_t queued = ac_priority_clamp((int)priority) == AC_PRIORITY_INTERACTIVE
+        ? xQueueSendToFront(ex->queue, &job, 0)
+        : xQueueSendToBack(ex->queue, &job, 0);
+    if (queued != pdTRUE) {
+        AC_LOG_DEBUG("Executor queue full (ARC_EXECUTOR_QUEUE_DEPTH)");
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    ex->submitted++;
+    pthread_mutex_unlock(&ex->lock);
+
+    return ARC_OK;
+}
+
+arc_err_t ac_executor_get_stats(ac_executor_t *ex, ac_session_executor_stats_t *stats) {
+    if (!ex || !stats) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    uint64_t now_ms = ac_platform_timestamp_ms();
+
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&ex->lock);
+    stats->threads = ex->thread_count;
+    stats->active_workers = ex->active;
+    stats->total_submitted = ex->submitted;
+    stats->total_completed = ex->completed;
+    stats->busy_ms = ex->busy_ms;
+    stats->uptime_ms = now_ms - ex->start_ms;
+    stats->stack_peak = ex->stack_peak;
+    pthread_mutex_unlock(&ex->lock);
+
+    stats->queued_jobs = (size_t)uxQueueMessagesWaiting(ex->queue);
+    stats->stack_size = sizeof(s_slots[0].stack);
+
+    uint64_t capacity_ms = stats->uptime_ms * stats->threads;
+    stats->utilization = capacity_ms > 0 ? (double)stats->busy_ms / (double)capacity_ms : 0.0;
+
+    return ARC_OK;
+}
+
+void ac_executor_destroy(ac_executor_t *ex) {
+    if (!ex) {
+        return;
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    ex->shutdown = 1;
+    pthread_mutex_unlock(&ex->lock);
+
+    /* Behind every queued job: tasks drop those, then hand themselves back */
+    executor_job_t exit_job = { NULL, NULL, NULL };
+    for (size_t i = 0; i < ex->thread_count; i++) {
+        xQueueSendToBack(ex->queue, &exit_job, portMAX_DELAY);
+    }
+    for (size_t i = 0; i < ex->thread_count; i++) {
+        xSemaphoreTake(ex->exited, portMAX_DELAY);
+    }
+
+    /* Sent behind the exit records by a submit that raced the shutdown */
+    executor_job_t job;
+    while (xQueueReceive(ex->queue, &job, 0) == pdTRUE) {
+        if (job.drop) {
+            job.drop(job.arg);
+        }
+    }
+
+    AC_LOG_DEBUG("Executor destroyed (%llu jobs completed, deepest stack %zu bytes)",
+                 (unsigned long long)ex->completed, ex->stack_peak);
+
+    vQueueDelete(ex->queue);
+    vSemaphoreDelete(ex->exited);
+    pthread_mutex_destroy(&ex->lock);
+    ARC_FREE(ex);
+}
+
+/*============================================================================
+ * Parallel For
+ *============================================================================*/
+
+typedef struct {
+    ac_executor_index_fn fn;
+    void *arg;
+    size_t count;
+
+    pthread_mutex_t lock;
+    StaticSemaphore_t finished_buf;
+    SemaphoreHandle_t finished;        /* Given when done == count */
+    size_t next;                       /* Next index to claim */
+    size_t done;
+    int refs;                          /* Caller + submitted helpers */
+} parallel_for_t;
+
+static void parallel_for_unref(parallel_for_t *pf) {
+    pthread_mutex_lock(&pf->lock);
+    int refs = --pf->refs;
+    pthread_mutex_unlock(&pf->lock);
+
+    if (refs == 0) {
+        vSemaphoreDelete(pf->finished);
+        pthread_mutex_destroy(&pf->lock);
+        ARC_FREE(pf);
+    }
+}
+
+static void parallel_for_drain(parallel_for_t *pf) {
+    for (;;) {
+        pthread_mutex_lock(&pf->lock);
+        size_t index = pf->next < pf->count ? pf->next++ : pf->count;
+        pthread_mutex_unlock(&pf->lock);
+
+        if (index >= pf->count) {
+            break;
+        }
+
+        pf->fn(pf->arg, index);
+
+        pthread_mutex_lock(&pf->lock);
+        if (++pf->done == pf->count) {
+            xSemaphoreGive(pf->finished);
+        }
+        pthread_mutex_unlock(&pf->lock);
+    }
+}
+
+static void parallel_for_helper(void *arg) {
+    parallel_for_t *pf = (parallel_for_t *)arg;
+    parallel_for_drain(pf);
+    parallel_for_unref(pf);
+}
+
+static void parallel_for_drop(void *arg) {
+    parallel_for_unref((parallel_for_t *)arg);
+}
+
+void ac_executor_parallel_for(
+    ac_executor_t *ex,
+    size_t count,
+    size_t max_workers,
+    ac_executor_index_fn fn,
+    void *arg,
+    ac_priority_t priority
+) {
+    if (!fn || count == 0) {
+        return;
+    }
+
+    size_t helpers = max_workers > count ? count : max_workers;
+    helpers = helpers > 1 ? helpers - 1 : 0;
+
+    parallel_for_t *pf = NULL;
+    if (ex && helpers > 0) {
+        pf = (parallel_for_t *)ARC_CALLOC(1, sizeof(parallel_for_t));
+        if (pf && pthread_mutex_init(&pf->lock, NULL) != 0) {
+            ARC_FREE(pf);
+            pf = NULL;
+        }
+    }
+
+    if (!pf) {
+        for (size_t i = 0; i < count; i++) {
+            fn(arg, i);
+        }
+        return;
+    }
+
+    pf->fn = fn;
+    pf->arg = arg;
+    pf->count = count;
+    pf->refs = 1;
+    pf->finished = xSemaphoreCreateBinaryStatic(&pf->finished_buf);
+
+    for (size_t i = 0; i < helpers; i++) {
+        pthread_mutex_lock(&pf->lock);
+        pf->refs++;
+        pthread_mutex_unlock(&pf->lock);
+
+        if (ac_executor_submit(ex, parallel_for_helper, parallel_for_drop, pf,
+                               priority) != ARC_OK) {
+            parallel_for_unref(pf);
+            break;
+        }
+    }
+
+    /* The caller drains too, so progress never depends on a free task */
+    parallel_for_drain(pf);
+    xSemaphoreTake(pf->finished, portMAX_DELAY);
+
+    parallel_for_unref(pf);
+}
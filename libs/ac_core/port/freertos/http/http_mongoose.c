@@ -0,0 +1,1432 @@
+/**
+ * @file http_mongoose.c
+ * @brief mongoose HTTP backend with static buffers (embedded)
+ *
+ * Implements port/http_client.h on mongoose (7.14 or later, built with
+ * MG_TLS = MG_TLS_MBEDTLS for https) for targets that need bounded,
+ * predictable memory, such as ESP32 gateways.
+ *
+ * Memory model: each client takes one of ARC_HTTP_MAX_CLIENTS static
+ * slots. A slot owns three fixed buffers:
+ * - tx   (ARC_HTTP_TX_BUFFER_SIZE): the request head, then the body in
+ *   pieces of at most this size
+ * - head (ARC_HTTP_HEAD_BUFFER_SIZE): response status line and headers;
+ *   captured headers are returned in place
+ * - body (ARC_HTTP_BODY_BUFFER_SIZE): the body of a non-streamed response
+ *   that names no sink
+ *
+ * Nothing is allocated per request. Streamed responses are handed from
+ * mongoose's receive buffer to the callback chunk by chunk, and that
+ * buffer is drained on every read so it never grows past MG_IO_SIZE; the
+ * send buffer is refilled only once empty. Response headers and a body
+ * in the slot are borrowed (headers_borrowed, body_borrowed) and stay
+ * valid until the client's next request. Only an arena sink allocates,
+ * from its arena.
+ *
+ * For a fully static footprint also build mongoose with
+ * MG_ENABLE_CUSTOM_CALLOC and mbedTLS with MBEDTLS_MEMORY_BUFFER_ALLOC_C,
+ * which put connection and TLS state in fixed pools.
+ *
+ * The connection stays open between requests to the same origin, so a
+ * device pays one TLS handshake per provider rather than per call. With
+ * mbedTLS (MG_TLS_MBEDTLS) the TLS session of each origin is also kept,
+ * so a new connection - after the server closed the idle one, or after
+ * deep sleep - resumes it instead of doing a full handshake; see
+ * "TLS Session Cache".
+ * Not supported: the asynchronous engine (arc_http_engine_create()
+ * returns ARC_ERR_NOT_IMPLEMENTED), compress_body (sent as is),
+ * ca_cert_path (pass the PEM in ca_cert_data), HTTP/2 and the WebSocket
+ * client of port/ws_client.h (arc_ws_connect() returns
+ * ARC_ERR_NOT_IMPLEMENTED).
+ */
+
+#include "arc/platform.h"
+#include "http_client.h"
+#include "ws_client.h"
+#include "arc/log.h"
+#include "profile.h"
+#if ARC_FEATURE_CASSETTE
+#include "http_cassette.h"
+#endif
+#if ARC_FEATURE_HTTP_FAULTS
+#include "http_fault_shim.h"
+#endif
+#include "mongoose.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*============================================================================
+ * Internal Structures
+ *============================================================================*/
+
+/* Response headers the library consumes (same set as http_curl.c) */
+static const char *const s_captured_headers[] = {
+    "Mcp-Session-Id",
+    "x-ratelimit-limit-requests",
+    "x-ratelimit-remaining-requests",
+    "x-ratelimit-reset-requests",
+    "x-ratelimit-limit-tokens",
+    "x-ratelimit-remaining-tokens",
+    "x-ratelimit-reset-tokens",
+    "anthropic-ratelimit-requests-limit",
+    "anthropic-ratelimit-requests-remaining",
+    "anthropic-ratelimit-requests-reset",
+    "anthropic-ratelimit-tokens-limit",
+    "anthropic-ratelimit-tokens-remaining",
+    "anthropic-ratelimit-tokens-reset",
+};
+
+#define CAPTURED_MAX (sizeof(s_captured_headers) / sizeof(s_captured_headers[0]))
+
+/** How often a waiting request looks at its cancel flag and deadline */
+#define POLL_MS 20
+
+/** Chunked upload framing: "%08zx\r\n" before, "\r\n" after each piece */
+#define CHUNK_PREFIX 10
+#define CHUNK_SUFFIX 2
+
+typedef enum {
+    SEND_HEAD,
+    SEND_BODY,
+    SEND_DONE,
+} send_state_t;
+
+typedef enum {
+    RECV_HEAD,                         /* Status line and headers */
+    RECV_LENGTH,                       /* Content-Length body */
+    RECV_CHUNK_SIZE,                   /* Chunk size line */
+    RECV_CHUNK_DATA,
+    RECV_CHUNK_CRLF,                   /* CRLF after chunk data */
+    RECV_TRAILER,                      /* Trailer lines after the last chunk */
+    RECV_CLOSE,                        /* Body delimited by connection close */
+    RECV_DONE,
+} recv_state_t;
+
+struct arc_http_header_set {
+    size_t len;
+    char lines[];                      /* "Name: value\r\n" for each header */
+};
+
+struct arc_http_client {
+    int in_use;
+    arc_http_client_config_t config;
+    struct mg_mgr mgr;
+    struct mg_connection *conn;        /* Kept alive between requests */
+    char origin[ARC_HTTP_ORIGIN_MAX];  /* scheme://host:port of conn */
+    int tls_done;                      /* conn finished its handshake */
+    int tls_stored;                    /* conn's session is in the cache */
+    int tls_offered;                   /* conn was offered a cached session */
+
+    /* Current request (NULL between requests) */
+    const arc_http_request_t *request;
+    arc_stream_callback_t on_data;
+    void *user_data;
+    arc_http_response_t *response;
+    uint64_t start_us;
+    int done;
+    arc_err_t result;
+
+    /* Sending */
+    send_state_t send_state;
+    size_t head_len;                   /* Formatted head in tx */
+    size_t body_len;                   /* 0 with chunked upload */
+    size_t body_sent;
+    int chunked_upload;
+
+    /* Receiving */
+    recv_state_t recv_state;
+    size_t head_used;
+    uint64_t remaining;                /* Left in the body or the current chunk */
+    size_t line_len;                   /* Chunk size / trailer line so far */
+    char line[24];
+    int keep_alive;
+    int aborted;                       /* Stream callback stopped the transfer */
+    size_t received;                   /* Body bytes delivered */
+
+    /* Non-streamed body */
+    char *body;
+    size_t body_size;
+    size_t body_cap;
+    int body_fixed;                    /* body/body_cap cannot grow */
+    arena_t *arena;
+
+    arc_http_header_t captured[CAPTURED_MAX];
+
+    char tx[ARC_HTTP_TX_BUFFER_SIZE];
+    char head[ARC_HTTP_HEAD_BUFFER_SIZE];
+    char body_buf[ARC_HTTP_BODY_BUFFER_SIZE];
+};
+
+static struct arc_http_client s_clients[ARC_HTTP_MAX_CLIENTS];
+static pthread_mutex_t s_clients_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*============================================================================
+ * Traffic Counters
+ *============================================================================*/
+
+static pthread_mutex_t s_io_lock = PTHREAD_MUTEX_INITIALIZER;
+static arc_http_io_stats_t s_io_stats;
+
+static void record_transfer(size_t body_bytes, size_t response_bytes) {
+    pthread_mutex_lock(&s_io_lock);
+    s_io_stats.requests++;
+    s_io_stats.body_bytes += body_bytes;
+    s_io_stats.body_wire_bytes += body_bytes;
+    s_io_stats.response_bytes += response_bytes;
+    s_io_stats.response_wire_bytes += response_bytes;
+    pthread_mutex_unlock(&s_io_lock);
+}
+
+void arc_http_get_io_stats(arc_http_io_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    pthread_mutex_lock(&s_io_lock);
+    *stats = s_io_stats;
+    pthread_mutex_unlock(&s_io_lock);
+}
+
+/*============================================================================
+ * TLS Session Cache
+ *============================================================================*/
+
+/*
+ * One entry per origin holds the serialized mbedTLS session (ticket
+ * included) of the last connection to it. A new connection offers it in
+ * its ClientHello; a server that accepts skips the certificate chain and
+ * the key exchange, which on a Cortex-M is most of the handshake's CPU
+ * time and round trips. A server that declines just does a full
+ * handshake, whose session then replaces the entry.
+ *
+ * ARC_HTTP_TLS_SESSION_ATTR can put the cache in RAM that survives deep
+ * sleep (RTC_NOINIT_ATTR on ESP32, a .noinit section elsewhere). Such
+ * memory holds garbage after power-on, so entries carry a checksum and
+ * anything that fails it is ignored. Entries contain the session's
+ * master secret: keep that memory as private as the rest of RAM.
+ */
+
+#if ARC_HTTP_TLS_SESSIONS > 0 && defined(MG_TLS) && defined(MG_TLS_MBEDTLS) && \
+    MG_TLS == MG_TLS_MBEDTLS
+#define TLS_SESSION_CACHE 1
+#else
+#define TLS_SESSION_CACHE 0
+#endif
+
+#if TLS_SESSION_CACHE
+
+#define TLS_SESSION_MAGIC 0xAC7150E5u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t checksum;                 /* FNV-1a of everything below */
+    uint32_t stamp;                    /* Store order, oldest is replaced */
+    uint32_t len;
+    char origin[ARC_HTTP_ORIGIN_MAX];
+    unsigned char data[ARC_HTTP_TLS_SESSION_SIZE];
+} tls_session_t;
+
+static ARC_HTTP_TLS_SESSION_ATTR tls_session_t s_tls_sessions[ARC_HTTP_TLS_SESSIONS];
+static pthread_mutex_t s_tls_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t tls_checksum(const tls_session_t *entry) {
+    const unsigned char *p = (const unsigned char *)&entry->stamp;
+    size_t n = offsetof(tls_session_t, data) - offsetof(tls_session_t, stamp);
+    if (entry->len <= sizeof(entry->data)) {
+        n += entry->len;
+    }
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static int tls_valid(const tls_session_t *entry) {
+    return entry->magic == TLS_SESSION_MAGIC && entry->len <= sizeof(entry->data) &&
+           entry->checksum == tls_checksum(entry);
+}
+
+/** Entry of origin (lock held), NULL if none */
+static tls_session_t *tls_find(const char *origin) {
+    for (size_t i = 0; i < ARC_HTTP_TLS_SESSIONS; i++) {
+        tls_session_t *entry = &s_tls_sessions[i];
+        if (tls_valid(entry) && strncmp(entry->origin, origin, sizeof(entry->origin)) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Offer origin's cached session to a connection before its handshake
+ */
+static void tls_session_offer(arc_http_client_t *client, struct mg_connection *c) {
+    struct mg_tls *tls = (struct mg_tls *)c->tls;
+    if (!tls) {
+        return;
+    }
+    pthread_mutex_lock(&s_tls_lock);
+    tls_session_t *entry = tls_find(client->origin);
+    if (entry) {
+        mbedtls_ssl_session session;
+        mbedtls_ssl_session_init(&session);
+        if (mbedtls_ssl_session_load(&session, entry->data, entry->len) == 0 &&
+            mbedtls_ssl_set_session(&tls->ssl, &session) == 0) {
+            client->tls_offered = 1;
+        } else {
+            /* Saved by another mbedTLS build or configuration */
+            entry->magic = 0;
+        }
+        mbedtls_ssl_session_free(&session);
+    }
+    pthread_mutex_unlock(&s_tls_lock);
+    AC_LOG_DEBUG("TLS %s: %s", client->origin,
+                 client->tls_offered ? "offering cached session" : "full handshake");
+}
+
+/**
+ * @brief Cache the session of a connection that finished its handshake
+ *
+ * Once per connection, after its first response: a TLS 1.3 server sends
+ * its ticket after the handshake, so the session is complete by then.
+ */
+static void tls_session_store(arc_http_client_t *client, struct mg_connection *c) {
+    if (!c || !c->tls || !client->tls_done || client->tls_stored) {
+        return;
+    }
+    client->tls_stored = 1;
+
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_get_session(&((struct mg_tls *)c->tls)->ssl, &session) != 0) {
+        mbedtls_ssl_session_free(&session);
+        return;
+    }
+
+    pthread_mutex_lock(&s_tls_lock);
+    uint32_t stamp = 0;
+    for (size_t i = 0; i < ARC_HTTP_TLS_SESSIONS; i++) {
+        if (tls_valid(&s_tls_sessions[i]) && s_tls_sessions[i].stamp >= stamp) {
+            stamp = s_tls_sessions[i].stamp + 1;
+        }
+    }
+    tls_session_t *entry = tls_find(client->origin);
+    if (!entry) {
+        /* A free entry, else the oldest */
+        entry = &s_tls_sessions[0];
+        for (size_t i = 1; i < ARC_HTTP_TLS_SESSIONS && tls_valid(entry); i++) {
+            tls_session_t *e = &s_tls_sessions[i];
+            if (!tls_valid(e) || e->stamp < entry->stamp) {
+                entry = e;
+            }
+        }
+    }
+
+    size_t len = 0;
+    entry->magic = 0;
+    if (mbedtls_ssl_session_save(&session, entry->data, sizeof(entry->data), &len) == 0) {
+        memset(entry->origin, 0, sizeof(entry->origin));
+        snprintf(entry->origin, sizeof(entry->origin), "%s", client->origin);
+        entry->stamp = stamp;
+        entry->len = (uint32_t)len;
+        entry->checksum = tls_checksum(entry);
+        entry->magic = TLS_SESSION_MAGIC;
+    } else {
+        AC_LOG_DEBUG("TLS session of %s exceeds ARC_HTTP_TLS_SESSION_SIZE, not cached",
+                     client->origin);
+    }
+    pthread_mutex_unlock(&s_tls_lock);
+    mbedtls_ssl_session_free(&session);
+}
+
+/**
+ * @brief Drop origin's session after a handshake that offered it failed
+ */
+static void tls_session_forget(const char *origin) {
+    pthread_mutex_lock(&s_tls_lock);
+    tls_session_t *entry = tls_find(origin);
+    if (entry) {
+        entry->magic = 0;
+    }
+    pthread_mutex_unlock(&s_tls_lock);
+}
+
+#else
+
+#define tls_session_offer(client, c)   ((void)(client), (void)(c))
+#define tls_session_store(client, c)   ((void)(client), (void)(c))
+#define tls_session_forget(origin)     ((void)(origin))
+
+#endif /* TLS_SESSION_CACHE */
+
+/*============================================================================
+ * Prepared Headers
+ *============================================================================*/
+
+arc_err_t arc_http_header_set_create(
+    const arc_http_header_t *headers,
+    arc_http_header_set_t **out
+) {
+    if (!out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    size_t len = 0;
+    for (const arc_http_header_t *h = headers; h; h = h->next) {
+        len += strlen(h->name) + strlen(h->value) + 4;  /* ": " and CRLF */
+    }
+
+    arc_http_header_set_t *set = ARC_MALLOC(sizeof(*set) + len + 1);
+    if (!set) {
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    set->len = 0;
+    for (const arc_http_header_t *h = headers; h; h = h->next) {
+        set->len += (size_t)snprintf(set->lines + set->len, len + 1 - set->len,
+                                     "%s: %s\r\n", h->name, h->value);
+    }
+
+    *out = set;
+    return ARC_OK;
+}
+
+void arc_http_header_set_destroy(arc_http_header_set_t *set) {
+    ARC_FREE(set);
+}
+
+/*============================================================================
+ * Client Create/Destroy
+ *============================================================================*/
+
+arc_err_t arc_http_client_create(
+    const arc_http_client_config_t *config,
+    arc_http_client_t **out
+) {
+    if (!out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    if (config && config->engine) {
+        return ARC_ERR_NOT_IMPLEMENTED;
+    }
+
+    arc_http_client_t *client = NULL;
+    pthread_mutex_lock(&s_clients_lock);
+    for (size_t i = 0; i < ARC_HTTP_MAX_CLIENTS; i++) {
+        if (!s_clients[i].in_use) {
+            client = &s_clients[i];
+            memset(client, 0, offsetof(struct arc_http_client, tx));
+            client->in_use = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_clients_lock);
+
+    if (!client) {
+        AC_LOG_ERROR("All %d HTTP clients in use (ARC_HTTP_MAX_CLIENTS)",
+                     (int)ARC_HTTP_MAX_CLIENTS);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    if (config) {
+        client->config = *config;
+    }
+    if (client->config.default_timeout_ms == 0) {
+        client->config.default_timeout_ms = 30000;
+    }
+    if (client->config.ca_cert_path && !client->config.ca_cert_data) {
+        AC_LOG_WARN("ca_cert_path is not supported by this backend, use ca_cert_data");
+    }
+
+    mg_mgr_init(&client->mgr);
+
+    *out = client;
+    return ARC_OK;
+}
+
+void arc_http_client_destroy(arc_http_client_t *client) {
+    if (!client) return;
+
+    /* Closes the kept-alive connection */
+    mg_mgr_free(&client->mgr);
+
+    pthread_mutex_lock(&s_clients_lock);
+    client->in_use = 0;
+    pthread_mutex_unlock(&s_clients_lock);
+}
+
+/*============================================================================
+ * Request Head
+ *============================================================================*/
+
+static const char *method_name(arc_http_method_t method) {
+    switch (method) {
+        case ARC_HTTP_POST:   return "POST";
+        case ARC_HTTP_PUT:    return "PUT";
+        case ARC_HTTP_DELETE: return "DELETE";
+        case ARC_HTTP_PATCH:  return "PATCH";
+        case ARC_HTTP_HEAD:   return "HEAD";
+        default:              return "GET";
+    }
+}
+
+static void origin_of(const char *url, char *out, size_t size) {
+    struct mg_str host = mg_url_host(url);
+    snprintf(out, size, "%s://%.*s:%u", mg_url_is_ssl(url) ? "https" : "http",
+             (int)host.len, host.buf, (unsigned)mg_url_port(url));
+}
+
+/**
+ * @brief Append to the head in tx
+ * @return 0 once the head no longer fits
+ */
+static int head_append(arc_http_client_t *client, const char *data, size_t len) {
+    if (client->head_len + len > sizeof(client->tx)) {
+        return 0;
+    }
+    memcpy(client->tx + client->head_len, data, len);
+    client->head_len += len;
+    return 1;
+}
+
+static int head_printf(arc_http_client_t *client, const char *fmt, ...) {
+    size_t room = sizeof(client->tx) - client->head_len;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(client->tx + client->head_len, room, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= room) {
+        return 0;
+    }
+    client->head_len += (size_t)n;
+    return 1;
+}
+
+static arc_err_t format_head(arc_http_client_t *client, const arc_http_request_t *request) {
+    struct mg_str host = mg_url_host(request->url);
+    unsigned port = mg_url_port(request->url);
+    unsigned default_port = mg_url_is_ssl(request->url) ? 443 : 80;
+
+    int ok = head_printf(client, "%s %s HTTP/1.1\r\nHost: %.*s",
+                         method_name(request->method), mg_url_uri(request->url),
+                         (int)host.len, host.buf);
+    if (ok && port != default_port) {
+        ok = head_printf(client, ":%u", port);
+    }
+    ok = ok && head_append(client, "\r\n", 2);
+
+    if (ok && request->header_set) {
+        ok = head_append(client, request->header_set->lines, request->header_set->len);
+    }
+    for (const arc_http_header_t *h = request->headers; h && ok; h = h->next) {
+        ok = head_printf(client, "%s: %s\r\n", h->name, h->value);
+    }
+
+    if (ok && client->chunked_upload) {
+        ok = head_printf(client, "Transfer-Encoding: chunked\r\n");
+    } else if (ok && (client->body_len > 0 || request->method == ARC_HTTP_POST ||
+                      request->method == ARC_HTTP_PUT || request->method == ARC_HTTP_PATCH)) {
+        ok = head_printf(client, "Content-Length: %zu\r\n", client->body_len);
+    }
+    ok = ok && head_append(client, "\r\n", 2);
+
+    if (!ok) {
+        AC_LOG_ERROR("Request head exceeds ARC_HTTP_TX_BUFFER_SIZE (%d)",
+                     (int)ARC_HTTP_TX_BUFFER_SIZE);
+        return ARC_ERR_INVALID_ARG;
+    }
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Sending
+ *============================================================================*/
+
+static void finish(arc_http_client_t *client, arc_err_t result) {
+    if (!client->done) {
+        client->done = 1;
+        client->result = result;
+    }
+}
+
+/**
+ * @brief Queue the next piece of the request once the last one is out
+ *
+ * Refilling only an empty send buffer keeps mongoose's copy of the
+ * request at one piece.
+ */
+static void pump_send(arc_http_client_t *client, struct mg_connection *c) {
+    const arc_http_request_t *request = client->request;
+    if (c->send.len > 0 || client->send_state == SEND_DONE) {
+        return;
+    }
+
+    if (client->send_state == SEND_HEAD) {
+        mg_send(c, client->tx, client->head_len);
+        client->send_state = client->body_len > 0 || client->chunked_upload ? SEND_BODY : SEND_DONE;
+        return;
+    }
+
+    if (!request->body_read) {
+        size_t n = client->body_len - client->body_sent;
+        if (n > sizeof(client->tx)) {
+            n = sizeof(client->tx);
+        }
+        mg_send(c, request->body + client->body_sent, n);
+        client->body_sent += n;
+        if (client->body_sent == client->body_len) {
+            client->send_state = SEND_DONE;
+        }
+        return;
+    }
+
+    size_t prefix = client->chunked_upload ? CHUNK_PREFIX : 0;
+    size_t room = sizeof(client->tx) - prefix - (client->chunked_upload ? CHUNK_SUFFIX : 0);
+    if (!client->chunked_upload && room > client->body_len - client->body_sent) {
+        room = client->body_len - client->body_sent;
+    }
+
+    size_t n = request->body_read(client->tx + prefix, room, request->body_user_data);
+    if (n == ARC_HTTP_BODY_ABORT) {
+        finish(client, ARC_ERR_CANCELLED);
+        return;
+    }
+    if (n > room) {
+        n = room;
+    }
+
+    if (client->chunked_upload) {
+        if (n == 0) {
+            mg_send(c, "0\r\n\r\n", 5);
+            client->send_state = SEND_DONE;
+            return;
+        }
+        char size_line[24];           /* n < tx size, so 8 hex digits fit CHUNK_PREFIX */
+        snprintf(size_line, sizeof(size_line), "%08zx\r\n", n);
+        memcpy(client->tx, size_line, CHUNK_PREFIX);
+        memcpy(client->tx + prefix + n, "\r\n", CHUNK_SUFFIX);
+        mg_send(c, client->tx, prefix + n + CHUNK_SUFFIX);
+        client->body_sent += n;
+        return;
+    }
+
+    if (n == 0) {
+        AC_LOG_ERROR("Request body ended after %zu of %zu bytes",
+                     client->body_sent, client->body_len);
+        finish(client, ARC_ERR_IO);
+        return;
+    }
+    mg_send(c, client->tx, n);
+    client->body_sent += n;
+    if (client->body_sent == client->body_len) {
+        client->send_state = SEND_DONE;
+    }
+}
+
+/*============================================================================
+ * Receiving
+ *============================================================================*/
+
+static uint32_t elapsed_us(const arc_http_client_t *client) {
+    uint64_t us = ac_platform_monotonic_us() - client->start_us;
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+/**
+ * @brief Hand body bytes to the stream callback or the body buffer
+ */
+static void deliver(arc_http_client_t *client, const char *data, size_t len) {
+    client->received += len;
+
+    if (client->on_data) {
+        if (client->on_data(data, len, client->user_data) != 0) {
+            client->aborted = 1;
+            client->keep_alive = 0;
+            finish(client, ARC_OK);
+        }
+        return;
+    }
+
+    size_t limit = client->config.max_response_size;
+    size_t need = client->body_size + len + 1;
+    if (limit && need - 1 > limit) {
+        AC_LOG_ERROR("Response exceeds limit: %zu > %zu", need - 1, limit);
+        finish(client, ARC_ERR_RESPONSE_TOO_LARGE);
+        return;
+    }
+    if (need > client->body_cap) {
+        if (client->body_fixed) {
+            AC_LOG_ERROR("Response exceeds buffer: %zu > %zu", need, client->body_cap);
+            finish(client, ARC_ERR_RESPONSE_TOO_LARGE);
+            return;
+        }
+        /* Arenas cannot grow in place; the old block is abandoned */
+        size_t cap = client->body_cap ? client->body_cap * 2 : 1024;
+        if (cap < need) {
+            cap = need;
+        }
+        char *grown = arena_alloc(client->arena, cap);
+        if (!grown) {
+            finish(client, ARC_ERR_NO_MEMORY);
+            return;
+        }
+        if (client->body_size > 0) {
+            memcpy(grown, client->body, client->body_size);
+        }
+        client->body = grown;
+        client->body_cap = cap;
+    }
+    memcpy(client->body + client->body_size, data, len);
+    client->body_size += len;
+}
+
+static void capture_header(arc_http_client_t *client, const char *name, const char *value) {
+    for (size_t i = 0; i < CAPTURED_MAX; i++) {
+        if (strcasecmp(name, s_captured_headers[i]) != 0) {
+            continue;
+        }
+        arc_http_header_t *h = &client->captured[i];
+        h->name = s_captured_headers[i];
+        h->value = value;
+        h->next = client->response->headers;
+        client->response->headers = h;
+        client->response->headers_borrowed = 1;
+        return;
+    }
+}
+
+/**
+ * @brief Parse the NUL-terminated head in place and pick the body framing
+ */
+static arc_err_t parse_head(arc_http_client_t *client) {
+    arc_http_response_t *response = client->response;
+    char *p = client->head;
+
+    if (strncmp(p, "HTTP/1.", 7) != 0) {
+        AC_LOG_ERROR("Malformed HTTP status line");
+        return ARC_ERR_PROTOCOL;
+    }
+    client->keep_alive = p[7] == '1';
+    char *space = strchr(p, ' ');
+    int status = space ? atoi(space + 1) : 0;
+    if (status < 100) {
+        AC_LOG_ERROR("Malformed HTTP status line");
+        return ARC_ERR_PROTOCOL;
+    }
+
+    /* 1xx: the real head follows */
+    if (status < 200) {
+        client->head_used = 0;
+        return ARC_OK;
+    }
+
+    int chunked = 0;
+    int has_length = 0;
+    uint64_t length = 0;
+    response->status_code = status;
+    response->headers = NULL;
+
+    /* The head ends in CRLF, so every line does */
+    char *end = strstr(p, "\r\n");
+    for (char *line = end + 2; end && *line; line = end + 2) {
+        end = strstr(line, "\r\n");
+        if (!end) {
+            break;
+        }
+        *end = '\0';
+        char *colon = strchr(line, ':');
+        if (colon) {
+            *colon = '\0';
+            char *value = colon + 1;
+            while (*value == ' ' || *value == '\t') {
+                value++;
+            }
+            for (char *t = value + strlen(value); t > value && (t[-1] == ' ' || t[-1] == '\t'); ) {
+                *--t = '\0';
+            }
+
+            if (strcasecmp(line, "Content-Length") == 0) {
+                has_length = 1;
+                length = strtoull(value, NULL, 10);
+            } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+                chunked = strstr(value, "chunked") != NULL;
+            } else if (strcasecmp(line, "Connection") == 0) {
+                if (strcasecmp(value, "close") == 0) {
+                    client->keep_alive = 0;
+                } else if (strcasecmp(value, "keep-alive") == 0) {
+                    client->keep_alive = 1;
+                }
+            } else if (strcasecmp(line, "Retry-After") == 0 && value[0] >= '0' && value[0] <= '9') {
+                unsigned long seconds = strtoul(value, NULL, 10);
+                response->retry_after_ms = seconds > UINT32_MAX / 1000
+                    ? UINT32_MAX : (uint32_t)seconds * 1000;
+            } else {
+                capture_header(client, line, value);
+            }
+        }
+    }
+
+    if (client->request->method == ARC_HTTP_HEAD || status == 204 || status == 304) {
+        client->recv_state = RECV_DONE;
+    } else if (chunked) {
+        client->recv_state = RECV_CHUNK_SIZE;
+        client->line_len = 0;
+    } else if (has_length) {
+        client->remaining = length;
+        client->recv_state = length > 0 ? RECV_LENGTH : RECV_DONE;
+    } else {
+        client->recv_state = RECV_CLOSE;
+        client->keep_alive = 0;
+    }
+    return ARC_OK;
+}
+
+/**
+ * @brief Collect head bytes; parse once the blank line has arrived
+ * @return Bytes of data that belong to the head
+ */
+static size_t feed_head(arc_http_client_t *client, const char *data, size_t len) {
+    size_t room = sizeof(client->head) - 1 - client->head_used;
+    size_t n = len < room ? len : room;
+    size_t from = client->head_used > 3 ? client->head_used - 3 : 0;
+
+    memcpy(client->head + client->head_used, data, n);
+    client->head_used += n;
+    client->head[client->head_used] = '\0';
+
+    char *end = strstr(client->head + from, "\r\n\r\n");
+    if (!end) {
+        if (n == room) {
+            AC_LOG_ERROR("Response head exceeds ARC_HTTP_HEAD_BUFFER_SIZE (%d)",
+                         (int)ARC_HTTP_HEAD_BUFFER_SIZE);
+            finish(client, ARC_ERR_PROTOCOL);
+        }
+        return n;
+    }
+
+    size_t head_len = (size_t)(end - client->head) + 4;
+    size_t used = head_len - (client->head_used - n);
+    /* Keep one CRLF so the last header line ends like the others */
+    end[2] = '\0';
+    client->head_used = head_len;
+
+    arc_err_t err = parse_head(client);
+    if (err != ARC_OK) {
+        finish(client, err);
+    }
+    return used;
+}
+
+/**
+ * @brief Consume one line ending in LF into client->line
+ * @return Bytes used; *complete is set once the LF was seen
+ */
+static size_t feed_line(arc_http_client_t *client, const char *data, size_t len, int *complete) {
+    *complete = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '\n') {
+            client->line[client->line_len < sizeof(client->line) ? client->line_len
+                                                                  : sizeof(client->line) - 1] = '\0';
+            *complete = 1;
+            return i + 1;
+        }
+        /* Chunk extensions beyond the buffer are dropped */
+        if (data[i] != '\r' && client->line_len < sizeof(client->line) - 1) {
+            client->line[client->line_len] = data[i];
+        }
+        if (data[i] != '\r') {
+            client->line_len++;
+        }
+    }
+    return len;
+}
+
+static void feed(arc_http_client_t *client, const char *data, size_t len) {
+    while (len > 0 && !client->done) {
+        size_t used = len;
+        int complete = 0;
+
+        switch (client->recv_state) {
+            case RECV_HEAD:
+                used = feed_head(client, data, len);
+                break;
+
+            case RECV_LENGTH:
+            case RECV_CHUNK_DATA:
+                used = len < client->remaining ? len : (size_t)client->remaining;
+                client->remaining -= used;
+                deliver(client, data, used);
+                if (client->remaining == 0) {
+                    if (client->recv_state == RECV_LENGTH) {
+                        client->recv_state = RECV_DONE;
+                    } else {
+                        client->recv_state = RECV_CHUNK_CRLF;
+                        client->remaining = 2;
+                    }
+                }
+                break;
+
+            case RECV_CHUNK_CRLF:
+                used = len < client->remaining ? len : (size_t)client->remaining;
+                client->remaining -= used;
+                if (client->remaining == 0) {
+                    client->recv_state = RECV_CHUNK_SIZE;
+                    client->line_len = 0;
+                }
+                break;
+
+            case RECV_CHUNK_SIZE:
+                used = feed_line(client, data, len, &complete);
+                if (complete) {
+                    char *end;
+                    client->remaining = strtoull(client->line, &end, 16);
+                    if (end == client->line) {
+                        AC_LOG_ERROR("Malformed chunk size");
+                        finish(client, ARC_ERR_PROTOCOL);
+                        break;
+                    }
+                    client->recv_state = client->remaining > 0 ? RECV_CHUNK_DATA : RECV_TRAILER;
+                    client->line_len = 0;
+                }
+                break;
+
+            case RECV_TRAILER:
+                used = feed_line(client, data, len, &complete);
+                if (complete) {
+                    if (client->line_len == 0) {
+                        client->recv_state = RECV_DONE;
+                    }
+                    client->line_len = 0;
+                }
+                break;
+
+            case RECV_CLOSE:
+                deliver(client, data, len);
+                break;
+
+            case RECV_DONE:
+                break;
+        }
+
+        if (client->recv_state == RECV_DONE) {
+            finish(client, ARC_OK);
+        }
+        data += used;
+        len -= used;
+    }
+
+    /* Bytes past the response: the connection is out of step */
+    if (len > 0) {
+        client->keep_alive = 0;
+    }
+}
+
+/*============================================================================
+ * Connection Events
+ *============================================================================*/
+
+static arc_err_t map_error(const char *message) {
+    if (!message) {
+        return ARC_ERR_NETWORK;
+    }
+    if (strncmp(message, "DNS", 3) == 0 || strstr(message, "resolve")) {
+        return ARC_ERR_DNS;
+    }
+    if (strstr(message, "TLS") || strstr(message, "tls") || strstr(message, "SSL")) {
+        return ARC_ERR_TLS;
+    }
+    return ARC_ERR_NETWORK;
+}
+
+static void on_event(struct mg_connection *c, int ev, void *ev_data) {
+    arc_http_client_t *client = (arc_http_client_t *)c->fn_data;
+    int active = client->conn == c && client->request && !client->done;
+
+    switch (ev) {
+        case MG_EV_CONNECT:
+            if (!active) {
+                break;
+            }
+            client->response->timing.connect_us = elapsed_us(client);
+            if (mg_url_is_ssl(client->request->url)) {
+                const arc_http_client_config_t *config = &client->config;
+                int verify = client->request->verify_ssl;
+                struct mg_tls_opts opts;
+                memset(&opts, 0, sizeof(opts));
+                if (config->ca_cert_data) {
+                    size_t ca_len = config->ca_cert_len ? config->ca_cert_len
+                                                        : strlen(config->ca_cert_data);
+                    opts.ca = mg_str_n(config->ca_cert_data, ca_len);
+                }
+                if (verify) {
+                    opts.name = mg_url_host(client->request->url);
+                } else {
+                    opts.skip_verification = 1;
+                }
+                /* Hold the ClientHello until the cached session is set:
+                 * mongoose starts the handshake from its poll loop instead */
+                unsigned connecting = c->is_connecting;
+                c->is_connecting = 1;
+                mg_tls_init(c, &opts);
+                c->is_connecting = connecting;
+                tls_session_offer(client, c);
+            }
+            pump_send(client, c);
+            break;
+
+        case MG_EV_TLS_HS:
+            if (client->conn == c) {
+                client->tls_done = 1;
+            }
+            if (active) {
+                client->response->timing.tls_us = elapsed_us(client);
+            }
+            break;
+
+        case MG_EV_POLL:
+        case MG_EV_WRITE:
+            if (active) {
+                pump_send(client, c);
+            }
+            break;
+
+        case MG_EV_READ:
+            if (active) {
+                if (!client->response->timing.ttfb_us) {
+                    client->response->timing.ttfb_us = elapsed_us(client);
+                }
+                feed(client, (const char *)c->recv.buf, c->recv.len);
+            }
+            /* Drained on every read: the buffer never grows */
+            c->recv.len = 0;
+            break;
+
+        case MG_EV_ERROR:
+            if (active) {
+                AC_LOG_ERROR("HTTP %s: %s", client->request->url, (const char *)ev_data);
+                arc_err_t err = map_error((const char *)ev_data);
+                if (err == ARC_ERR_TLS && client->tls_offered && !client->tls_done) {
+                    tls_session_forget(client->origin);
+                }
+                finish(client, err);
+            }
+            break;
+
+        case MG_EV_CLOSE:
+            if (client->conn != c) {
+                break;
+            }
+            /* Closed before perform() stored it (e.g. "Connection: close") */
+            tls_session_store(client, c);
+            client->conn = NULL;
+            if (active) {
+                finish(client, client->recv_state == RECV_CLOSE ? ARC_OK : ARC_ERR_NETWORK);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*============================================================================
+ * HTTP Request
+ *============================================================================*/
+
+static void close_connection(arc_http_client_t *client) {
+    if (client->conn) {
+        client->conn->is_closing = 1;
+        client->conn = NULL;
+        /* Let mongoose free it now rather than at the next request */
+        mg_mgr_poll(&client->mgr, 0);
+    }
+}
+
+static void reset_transfer(arc_http_client_t *client) {
+    arc_http_response_t *response = client->response;
+    const arc_http_sink_t *sink = client->request->sink;
+
+    memset(response, 0, sizeof(*response));
+    client->done = 0;
+    client->result = ARC_OK;
+    client->send_state = SEND_HEAD;
+    client->body_sent = 0;
+    client->recv_state = RECV_HEAD;
+    client->head_used = 0;
+    client->line_len = 0;
+    client->remaining = 0;
+    client->keep_alive = 0;
+    client->aborted = 0;
+    client->received = 0;
+    client->body_size = 0;
+    client->arena = NULL;
+
+    if (sink && sink->buffer && sink->capacity > 0) {
+        client->body = sink->buffer;
+        client->body_cap = sink->capacity;
+        client->body_fixed = 1;
+    } else if (sink && sink->arena) {
+        client->body = NULL;
+        client->body_cap = 0;
+        client->body_fixed = 0;
+        client->arena = sink->arena;
+    } else {
+        client->body = client->body_buf;
+        client->body_cap = sizeof(client->body_buf);
+        client->body_fixed = 1;
+    }
+}
+
+/**
+ * @brief Send request and collect the response on the calling thread
+ *
+ * A request on a reused connection that the server had already closed
+ * fails before any byte arrives; it is sent once more on a new one.
+ */
+static arc_err_t perform(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_stream_callback_t on_data,
+    void *user_data,
+    arc_http_response_t *response
+) {
+    if (request->compress_body) {
+        AC_LOG_DEBUG("compress_body ignored: no zlib on this backend");
+    }
+
+    client->request = request;
+    client->on_data = on_data;
+    client->user_data = user_data;
+    client->response = response;
+    client->chunked_upload = request->body_read && request->body_len == 0;
+    client->body_len = request->body_read ? request->body_len
+                     : request->body_len ? request->body_len
+                     : request->body ? strlen(request->body) : 0;
+    client->head_len = 0;
+    reset_transfer(client);
+
+    arc_err_t err = format_head(client, request);
+    if (err != ARC_OK) {
+        client->request = NULL;
+        return err;
+    }
+
+    char origin[ARC_HTTP_ORIGIN_MAX];
+    origin_of(request->url, origin, sizeof(origin));
+    uint32_t timeout_ms = request->timeout_ms ? request->timeout_ms
+                                              : client->config.default_timeout_ms;
+
+    for (int attempt = 0; ; attempt++) {
+        client->start_us = ac_platform_monotonic_us();
+        uint64_t deadline_us = client->start_us + (uint64_t)timeout_ms * 1000;
+
+        int reused = client->conn && strcmp(client->origin, origin) == 0;
+        if (reused) {
+            pump_send(client, client->conn);
+        } else {
+            close_connection(client);
+            snprintf(client->origin, sizeof(client->origin), "%s", origin);
+            client->tls_done = 0;
+            client->tls_stored = 0;
+            client->tls_offered = 0;
+            client->conn = mg_connect(&client->mgr, request->url, on_event, client);
+            if (!client->conn) {
+                AC_LOG_ERROR("HTTP connect failed: %s", request->url);
+                client->request = NULL;
+                return ARC_ERR_NETWORK;
+            }
+        }
+
+        while (!client->done) {
+            if (request->cancel && *request->cancel) {
+                finish(client, ARC_ERR_CANCELLED);
+                break;
+            }
+            if (ac_platform_monotonic_us() >= deadline_us) {
+                AC_LOG_ERROR("HTTP request timed out after %u ms", (unsigned)timeout_ms);
+                finish(client, ARC_ERR_TIMEOUT);
+                break;
+            }
+            mg_mgr_poll(&client->mgr, POLL_MS);
+        }
+
+        int resend = client->result == ARC_ERR_NETWORK && reused && attempt == 0 &&
+                     client->recv_state == RECV_HEAD && client->head_used == 0 &&
+                     (!request->body_read || request->body_rewind);
+        if (!resend) {
+            break;
+        }
+        AC_LOG_DEBUG("Kept-alive connection was closed, resending %s", request->url);
+        if (request->body_read) {
+            request->body_rewind(request->body_user_data);
+        }
+        close_connection(client);
+        reset_transfer(client);
+    }
+
+    if (client->result == ARC_OK) {
+        tls_session_store(client, client->conn);
+    }
+    if (client->result != ARC_OK || client->aborted || !client->keep_alive ||
+        client->send_state != SEND_DONE) {
+        close_connection(client);
+    }
+
+    response->timing.total_us = elapsed_us(client);
+    record_transfer(client->body_sent, client->received);
+    client->request = NULL;
+
+    if (client->result != ARC_OK) {
+        response->headers = NULL;
+        response->headers_borrowed = 0;
+        return client->result;
+    }
+
+    if (!on_data) {
+        /* Empty bodies still come back as "" */
+        if (!client->body) {
+            client->body = arena_alloc(client->arena, 1);
+            if (!client->body) {
+                return ARC_ERR_NO_MEMORY;
+            }
+        }
+        client->body[client->body_size] = '\0';
+        response->body = client->body;
+        response->body_len = client->body_size;
+        response->body_borrowed = 1;
+    }
+
+    AC_LOG_DEBUG("HTTP response: %d, %zu bytes", response->status_code, client->received);
+    return ARC_OK;
+}
+
+/**
+ * @brief Charge connection setup of a finished request to the connect phase
+ */
+static void prof_split_connect(const arc_http_response_t *response) {
+    uint64_t us = response->timing.tls_us ? response->timing.tls_us : response->timing.connect_us;
+    if (us) {
+        ac_prof_split(AC_PROF_CONNECT, us);
+    }
+}
+
+static arc_err_t perform_plain(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response
+) {
+    return perform(client, request, NULL, NULL, response);
+}
+
+static arc_err_t perform_stream(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response
+) {
+    return perform(client, &request->base, request->on_data, request->user_data, response);
+}
+
+/**
+ * @brief Perform the request, through the cassette when one is active
+ */
+static arc_err_t perform_recorded(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response
+) {
+#if ARC_FEATURE_CASSETTE
+    if (arc_cassette_active()) {
+        return arc_cassette_request(client, request, response, perform_plain);
+    }
+#endif
+    return perform_plain(client, request, response);
+}
+
+static arc_err_t perform_stream_recorded(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response
+) {
+#if ARC_FEATURE_CASSETTE
+    if (arc_cassette_active()) {
+        return arc_cassette_request_stream(client, request, response, perform_stream);
+    }
+#endif
+    return perform_stream(client, request, response);
+}
+
+arc_err_t arc_http_request(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response
+) {
+    if (!client || !request || !request->url || !response) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    ac_prof_push(AC_PROF_NETWORK);
+#if ARC_FEATURE_HTTP_FAULTS
+    arc_err_t err = arc_faults_active()
+                    ? arc_faults_request(client, request, response, perform_recorded)
+                    : perform_recorded(client, request, response);
+#else
+    arc_err_t err = perform_recorded(client, request, response);
+#endif
+    if (err == ARC_OK) {
+        prof_split_connect(response);
+    }
+    ac_prof_pop();
+    return err;
+}
+
+/** on_data for a tapped request: the tap, then the caller's on_data */
+static int tapped_on_data(const char *data, size_t len, void *user_data) {
+    const arc_http_stream_request_t *request = (const arc_http_stream_request_t *)user_data;
+    if (request->tap(data, len, request->tap_user_data) != 0) {
+        return 1;
+    }
+    return request->on_data(data, len, request->user_data);
+}
+
+arc_err_t arc_http_request_stream(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response
+) {
+    if (!client || !request || !request->base.url || !request->on_data || !response) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    arc_http_stream_request_t tapped;
+    if (request->tap) {
+        tapped = *request;
+        tapped.on_data = tapped_on_data;
+        tapped.user_data = (void *)request;
+        tapped.tap = NULL;
+        request = &tapped;
+    }
+
+    ac_prof_push(AC_PROF_NETWORK);
+#if ARC_FEATURE_HTTP_FAULTS
+    arc_err_t err = arc_faults_active()
+                    ? arc_faults_request_stream(client, request, response,
+                                                perform_stream_recorded)
+                    : perform_stream_recorded(client, request, response);
+#else
+    arc_err_t err = perform_stream_recorded(client, request, response);
+#endif
+    if (err == ARC_OK) {
+        prof_split_connect(response);
+    }
+    ac_prof_pop();
+    return err;
+}
+
+/*============================================================================
+ * Asynchronous Engine (not available on this backend)
+ *============================================================================*/
+
+arc_err_t arc_http_engine_create(
+    const arc_http_client_config_t *config,
+    arc_http_engine_t **out
+) {
+    if (out) {
+        *out = NULL;
+    }
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+void arc_http_engine_destroy(arc_http_engine_t *engine) {
+}
+
+arc_err_t arc_http_submit(
+    arc_http_engine_t *engine,
+    const arc_http_request_t *request,
+    arc_http_done_fn on_done,
+    void *user_data,
+    arc_http_transfer_t **out
+) {
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+arc_err_t arc_http_submit_stream(
+    arc_http_engine_t *engine,
+    const arc_http_stream_request_t *request,
+    arc_http_done_fn on_done,
+    void *user_data,
+    arc_http_transfer_t **out
+) {
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+int arc_http_transfer_poll(arc_http_transfer_t *transfer) {
+    return 1;
+}
+
+arc_err_t arc_http_transfer_wait(arc_http_transfer_t *transfer, arc_http_response_t *response) {
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+void arc_http_transfer_cancel(arc_http_transfer_t *transfer) {
+}
+
+void arc_http_transfer_release(arc_http_transfer_t *transfer) {
+}
+
+int arc_http_engine_fd(arc_http_engine_t *engine) {
+    return -1;
+}
+
+int arc_http_engine_timeout(arc_http_engine_t *engine) {
+    return -1;
+}
+
+arc_err_t arc_http_engine_process(arc_http_engine_t *engine, int timeout_ms) {
+    return ARC_ERR_INVALID_STATE;
+}
+
+size_t arc_http_engine_origin_stats(
+    arc_http_engine_t *engine,
+    arc_http_origin_stats_t *out,
+    size_t max
+) {
+    return 0;
+}
+
+/*============================================================================
+ * WebSocket Client (not available on this backend)
+ *============================================================================*/
+
+arc_err_t arc_ws_connect(const arc_ws_config_t *config, arc_ws_t **out, int *status_out) {
+    if (out) {
+        *out = NULL;
+    }
+    if (status_out) {
+        *status_out = 0;
+    }
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+arc_err_t arc_ws_send_text(arc_ws_t *ws, const char *data, size_t len) {
+    return ARC_ERR_NOT_CONNECTED;
+}
+
+arc_err_t arc_ws_recv(arc_ws_t *ws, char **data, size_t *len,
+                      uint32_t timeout_ms, const volatile int *cancel) {
+    return ARC_ERR_NOT_CONNECTED;
+}
+
+int arc_ws_is_open(const arc_ws_t *ws) {
+    return 0;
+}
+
+void arc_ws_close(arc_ws_t *ws) {
+}
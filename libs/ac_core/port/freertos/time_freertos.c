@@ -37,3 +37,28 @@ __attribute__((weak)) uint64_t platform_get_tick_ms(void) {
 uint64_t ac_platform_timestamp_ms(void) {
     return platform_boot_epoch_ms + platform_get_tick_ms();
 }
+
+/**
+ * @brief Monotonic microseconds at tick resolution
+ *
+ * Override with a hardware timer for finer profiles, e.g.:
+ *   uint64_t ac_platform_monotonic_us(void) {
+ *       return (uint64_t)esp_timer_get_time();
+ *   }
+ */
+__attribute__((weak)) uint64_t ac_platform_monotonic_us(void) {
+    return platform_get_tick_ms() * 1000;
+}
+
+/**
+ * @brief Sleep for ms milliseconds
+ *
+ * The default returns immediately (retry backoff then degrades to
+ * immediate retries). Override with the scheduler's delay:
+ *   void ac_platform_sleep_ms(uint32_t ms) {
+ *       vTaskDelay(pdMS_TO_TICKS(ms));
+ *   }
+ */
+__attribute__((weak)) void ac_platform_sleep_ms(uint32_t ms) {
+    (void)ms;
+}
@@ -0,0 +1,796 @@
+/**
+ * @file http_cassette.c
+ * @brief HTTP record/replay (see arc/cassette.h)
+ *
+ * Cassette file: a header line, then one record per request, appended
+ * as each request completes. Lines carry decimal fields; payloads follow
+ * their line verbatim, length given, and end with a newline:
+ *
+ *   arc-cassette 1
+ *   req <method> <key> <url key> <url len>\n<url>\n
+ *   res <err> <status> <retry after ms> <stream> <ttfb us> <total us>\n
+ *   hdr <name len> <value len>\n<name><value>\n      response headers
+ *   msg <len>\n<error message>\n                     transport errors
+ *   chunk <offset us> <len>\n<bytes>\n               body (one chunk unless
+ *                                                    streamed)
+ *   end\n
+ *
+ * Keys are fnv1a64 in hex: of method, URL and body, and of method and
+ * URL alone for the fallback match. A replay loads the whole file and
+ * indexes the records; the payloads are served from that buffer.
+ */
+
+#include "http_cassette.h"
+#include "arc/cassette.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include "strbuf.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CASSETTE_MAGIC       "arc-cassette 1\n"
+#define CASSETTE_LINE_MAX    96
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+typedef struct {
+    uint64_t key;
+    uint64_t url_key;
+    const char *payload;             /* "res" line onwards */
+    int used;
+} cassette_entry_t;
+
+static struct {
+    atomic_int mode;                 /* 0 = off, else ac_cassette_mode_t */
+    pthread_mutex_t lock;
+    int realtime;
+    int strict;
+    FILE *file;                      /* Record */
+    int write_failed;
+    char *data;                      /* Replay: the whole file */
+    size_t data_len;
+    cassette_entry_t *entries;
+    size_t entry_count;
+    ac_cassette_stats_t stats;
+} s_cassette = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+int arc_cassette_active(void) {
+    return atomic_load_explicit(&s_cassette.mode, memory_order_relaxed) != 0;
+}
+
+/*============================================================================
+ * Keys
+ *============================================================================*/
+
+#define FNV64_OFFSET 0xcbf29ce484222325ull
+#define FNV64_PRIME  0x100000001b3ull
+
+static uint64_t fnv1a64_update(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV64_PRIME;
+    }
+    return h;
+}
+
+static uint64_t url_key(const arc_http_request_t *request) {
+    uint64_t h = fnv1a64_update(FNV64_OFFSET, &(char){ (char)request->method }, 1);
+    return fnv1a64_update(h, request->url, strlen(request->url) + 1);
+}
+
+/**
+ * @brief Body hashed as it is pulled (a rewind starts over)
+ */
+typedef struct {
+    const arc_http_request_t *request;
+    uint64_t seed;
+    uint64_t hash;
+} body_hash_t;
+
+static size_t hashing_read(char *buf, size_t size, void *user_data) {
+    body_hash_t *bh = (body_hash_t *)user_data;
+    size_t n = bh->request->body_read(buf, size, bh->request->body_user_data);
+    if (n != ARC_HTTP_BODY_ABORT) {
+        bh->hash = fnv1a64_update(bh->hash, buf, n);
+    }
+    return n;
+}
+
+static void hashing_rewind(void *user_data) {
+    body_hash_t *bh = (body_hash_t *)user_data;
+    bh->hash = bh->seed;
+    if (bh->request->body_rewind) {
+        bh->request->body_rewind(bh->request->body_user_data);
+    }
+}
+
+/**
+ * @brief Key of a request with a contiguous body (or none)
+ */
+static uint64_t request_key(const arc_http_request_t *request, uint64_t ukey) {
+    uint64_t h = fnv1a64_update(FNV64_OFFSET, &ukey, sizeof(ukey));
+    if (request->body) {
+        size_t len = request->body_len ? request->body_len : strlen(request->body);
+        h = fnv1a64_update(h, request->body, len);
+    }
+    return h;
+}
+
+/**
+ * @brief Key of a request with a pulled body: read it all, then rewind
+ *
+ * Only in replay, where the body is not sent. Without body_rewind the
+ * body is consumed and a miss cannot go to the network.
+ */
+static uint64_t pulled_key(const arc_http_request_t *request, uint64_t ukey, int *consumed) {
+    uint64_t h = fnv1a64_update(FNV64_OFFSET, &ukey, sizeof(ukey));
+    char buf[512];
+    size_t n;
+    while ((n = request->body_read(buf, sizeof(buf), request->body_user_data)) != 0 &&
+           n != ARC_HTTP_BODY_ABORT) {
+        h = fnv1a64_update(h, buf, n);
+    }
+    if (request->body_rewind) {
+        request->body_rewind(request->body_user_data);
+        *consumed = 0;
+    } else {
+        *consumed = 1;
+    }
+    return h;
+}
+
+/*============================================================================
+ * Recording
+ *============================================================================*/
+
+typedef struct {
+    ac_strbuf_t chunks;              /* Body chunks, as they arrive */
+    uint64_t start_us;
+    uint64_t first_us;               /* First chunk (0 = none yet) */
+    int failed;
+    arc_stream_callback_t on_data;   /* Streaming: the caller's callback */
+    void *user_data;
+} recording_t;
+
+static void sb_add(ac_strbuf_t *sb, int *failed, const char *data, size_t len) {
+    if (ac_strbuf_append(sb, data, len) != ARC_OK) {
+        *failed = 1;
+    }
+}
+
+static void sb_line(ac_strbuf_t *sb, int *failed, const char *fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+static void sb_line(ac_strbuf_t *sb, int *failed, const char *fmt, ...) {
+    char line[CASSETTE_LINE_MAX];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    sb_add(sb, failed, line, (size_t)n);
+}
+
+static void sb_payload(ac_strbuf_t *sb, int *failed, const char *data, size_t len) {
+    sb_add(sb, failed, data, len);
+    sb_add(sb, failed, "\n", 1);
+}
+
+static void rec_chunk(recording_t *rec, const char *data, size_t len, uint64_t at_us) {
+    sb_line(&rec->chunks, &rec->failed, "chunk %llu %zu\n",
+            (unsigned long long)(at_us - rec->start_us), len);
+    sb_payload(&rec->chunks, &rec->failed, data, len);
+}
+
+static int recording_stream_cb(const char *data, size_t len, void *user_data) {
+    recording_t *rec = (recording_t *)user_data;
+    uint64_t now = ac_platform_monotonic_us();
+    if (!rec->first_us) {
+        rec->first_us = now;
+    }
+    rec_chunk(rec, data, len, now);
+    return rec->on_data(data, len, rec->user_data);
+}
+
+/**
+ * @brief Write the record of a completed request to the file
+ */
+static void rec_finish(recording_t *rec, const arc_http_request_t *request, uint64_t key,
+                       uint64_t ukey, arc_err_t err, const arc_http_response_t *response,
+                       int stream) {
+    uint64_t end = ac_platform_monotonic_us();
+    uint64_t ttfb = response->timing.ttfb_us ? response->timing.ttfb_us
+                    : rec->first_us ? rec->first_us - rec->start_us : end - rec->start_us;
+    uint64_t total = response->timing.total_us ? response->timing.total_us
+                                               : end - rec->start_us;
+    if (!stream && err == ARC_OK && response->body) {
+        rec_chunk(rec, response->body, response->body_len, rec->start_us + ttfb);
+    }
+
+    ac_strbuf_t out = AC_STRBUF_INIT;
+    int *failed = &rec->failed;
+    size_t url_len = strlen(request->url);
+    sb_line(&out, failed, "req %d %016llx %016llx %zu\n", (int)request->method,
+            (unsigned long long)key, (unsigned long long)ukey, url_len);
+    sb_payload(&out, failed, request->url, url_len);
+    sb_line(&out, failed, "res %d %d %u %d %llu %llu\n", (int)err, response->status_code,
+            response->retry_after_ms, stream, (unsigned long long)ttfb,
+            (unsigned long long)total);
+    for (const arc_http_header_t *h = response->headers; h; h = h->next) {
+        size_t nlen = strlen(h->name);
+        size_t vlen = strlen(h->value);
+        sb_line(&out, failed, "hdr %zu %zu\n", nlen, vlen);
+        sb_add(&out, failed, h->name, nlen);
+        sb_payload(&out, failed, h->value, vlen);
+    }
+    if (err != ARC_OK && response->error_msg) {
+        size_t len = strlen(response->error_msg);
+        sb_line(&out, failed, "msg %zu\n", len);
+        sb_payload(&out, failed, response->error_msg, len);
+    }
+    if (rec->chunks.data) {
+        sb_add(&out, failed, rec->chunks.data, rec->chunks.len);
+    }
+    sb_add(&out, failed, "end\n", 4);
+    ac_strbuf_reset(&rec->chunks);
+
+    pthread_mutex_lock(&s_cassette.lock);
+    if (rec->failed) {
+        s_cassette.write_failed = 1;
+    } else if (s_cassette.file) {
+        if (fwrite(out.data, 1, out.len, s_cassette.file) != out.len ||
+            fflush(s_cassette.file) != 0) {
+            s_cassette.write_failed = 1;
+        }
+        s_cassette.stats.recorded++;
+    }
+    pthread_mutex_unlock(&s_cassette.lock);
+
+    if (rec->failed) {
+        AC_LOG_WARN("Cassette: out of memory, %s not recorded", request->url);
+    }
+    ac_strbuf_reset(&out);
+}
+
+/*============================================================================
+ * Replay
+ *============================================================================*/
+
+/**
+ * @brief Take the record for a request: exact key first, then method + URL
+ */
+static const char *replay_take(uint64_t key, uint64_t ukey) {
+    const char *payload = NULL;
+    pthread_mutex_lock(&s_cassette.lock);
+    cassette_entry_t *fallback = NULL;
+    for (size_t i = 0; i < s_cassette.entry_count; i++) {
+        cassette_entry_t *e = &s_cassette.entries[i];
+        if (e->used) {
+            continue;
+        }
+        if (e->key == key) {
+            e->used = 1;
+            payload = e->payload;
+            break;
+        }
+        if (!fallback && e->url_key == ukey) {
+            fallback = e;
+        }
+    }
+    if (!payload && fallback) {
+        fallback->used = 1;
+        payload = fallback->payload;
+        s_cassette.stats.fallbacks++;
+    }
+    if (payload) {
+        s_cassette.stats.replayed++;
+    } else {
+        s_cassette.stats.misses++;
+    }
+    pthread_mutex_unlock(&s_cassette.lock);
+    return payload;
+}
+
+/**
+ * @brief Read "<word> <fields...>\n"; p moves past the line
+ *
+ * @return Number of fields read, -1 if the word does not match
+ */
+static int read_line(const char **p, const char *end, const char *word,
+                     unsigned long long *fields, int max) {
+    size_t wlen = strlen(word);
+    const char *nl = memchr(*p, '\n', (size_t)(end - *p));
+    if (!nl || (size_t)(nl - *p) < wlen || memcmp(*p, word, wlen) != 0 ||
+        (nl - *p > (long)wlen && (*p)[wlen] != ' ')) {
+        return -1;
+    }
+    const char *s = *p + wlen;
+    int n = 0;
+    while (n < max && s < nl) {
+        char *e;
+        fields[n++] = (unsigned long long)strtoll(s, &e, 10);
+        if (e == s) {
+            return -1;
+        }
+        s = e;
+    }
+    *p = nl + 1;
+    return n;
+}
+
+static uint64_t parse_hex(const char *s) {
+    return (uint64_t)strtoull(s, NULL, 16);
+}
+
+/** Payload of len bytes and its newline; NULL if the file is short */
+static const char *read_payload(const char **p, const char *end, size_t len) {
+    if ((size_t)(end - *p) < len + 1 || (*p)[len] != '\n') {
+        return NULL;
+    }
+    const char *data = *p;
+    *p += len + 1;
+    return data;
+}
+
+static void sleep_until_us(uint64_t t) {
+    uint64_t now = ac_platform_monotonic_us();
+    if (t > now + 1000) {
+        ac_platform_sleep_ms((uint32_t)((t - now) / 1000));
+    }
+}
+
+static arc_http_header_t *header_from(const char *name, size_t nlen, const char *value,
+                                      size_t vlen) {
+    arc_http_header_t *h = ARC_CALLOC(1, sizeof(*h));
+    char *n = ARC_MALLOC(nlen + 1);
+    char *v = ARC_MALLOC(vlen + 1);
+    if (!h || !n || !v) {
+        ARC_FREE(h);
+        ARC_FREE(n);
+        ARC_FREE(v);
+        return NULL;
+    }
+    memcpy(n, name, nlen);
+    n[nlen] = '\0';
+    memcpy(v, value, vlen);
+    v[vlen] = '\0';
+    h->name = n;
+    h->value = v;
+    return h;
+}
+
+/**
+ * @brief Place the body as the request's sink asks
+ */
+static arc_err_t replay_body(const arc_http_request_t *request, arc_http_response_t *response,
+                             const char *data, size_t len) {
+    const arc_http_sink_t *sink = request->sink;
+    char *body;
+    if (sink && sink->buffer) {
+        if (len + 1 > sink->capacity) {
+            response->error_msg = ARC_STRDUP("Response size exceeds limit");
+            return ARC_ERR_RESPONSE_TOO_LARGE;
+        }
+        body = sink->buffer;
+        response->body_borrowed = 1;
+    } else if (sink && sink->arena) {
+        body = arena_alloc(sink->arena, len + 1);
+        response->body_borrowed = 1;
+    } else {
+        body = ARC_MALLOC(len + 1);
+    }
+    if (!body) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    memcpy(body, data, len);
+    body[len] = '\0';
+    response->body = body;
+    response->body_len = len;
+    return ARC_OK;
+}
+
+/**
+ * @brief Answer a request from its record
+ *
+ * @param stream  Streaming request (NULL = plain: chunks form the body)
+ */
+static arc_err_t replay(const char *payload, const arc_http_request_t *request,
+                        const arc_http_stream_request_t *stream,
+                        arc_http_response_t *response) {
+    const char *p = payload;
+    const char *end = s_cassette.data + s_cassette.data_len;
+    uint64_t start = ac_platform_monotonic_us();
+    unsigned long long f[6];
+
+    memset(response, 0, sizeof(*response));
+    if (read_line(&p, end, "res", f, 6) != 6) {
+        return ARC_ERR_PARSE;
+    }
+    arc_err_t err = (arc_err_t)(long long)f[0];
+    response->status_code = (int)f[1];
+    response->retry_after_ms = (uint32_t)f[2];
+    if (s_cassette.realtime) {
+        response->timing.ttfb_us = (uint32_t)f[4];
+        response->timing.total_us = (uint32_t)f[5];
+    }
+    uint64_t total_us = f[5];
+
+    arc_http_header_t **tail = &response->headers;
+    while (read_line(&p, end, "hdr", f, 2) == 2) {
+        const char *name = read_payload(&p, end, (size_t)(f[0] + f[1]));
+        if (!name) {
+            return ARC_ERR_PARSE;
+        }
+        *tail = header_from(name, (size_t)f[0], name + f[0], (size_t)f[1]);
+        if (*tail) {
+            tail = &(*tail)->next;
+        }
+    }
+    if (read_line(&p, end, "msg", f, 1) == 1) {
+        const char *msg = read_payload(&p, end, (size_t)f[0]);
+        if (!msg) {
+            return ARC_ERR_PARSE;
+        }
+        response->error_msg = ARC_MALLOC((size_t)f[0] + 1);
+        if (response->error_msg) {
+            memcpy(response->error_msg, msg, (size_t)f[0]);
+            response->error_msg[f[0]] = '\0';
+        }
+    }
+
+    ac_strbuf_t body = AC_STRBUF_INIT;
+    const char *only = NULL;         /* The usual single body chunk, served in place */
+    size_t only_len = 0;
+    int chunks = 0;
+    arc_err_t result = err;
+    while (read_line(&p, end, "chunk", f, 2) == 2) {
+        const char *data = read_payload(&p, end, (size_t)f[1]);
+        if (!data) {
+            result = ARC_ERR_PARSE;
+            break;
+        }
+        if (request->cancel && *request->cancel) {
+            result = ARC_ERR_CANCELLED;
+            break;
+        }
+        if (s_cassette.realtime) {
+            sleep_until_us(start + f[0]);
+        }
+        if (stream) {
+            if (stream->on_data(data, (size_t)f[1], stream->user_data) != 0) {
+                break;               /* Caller stopped the stream */
+            }
+        } else if (chunks++ == 0) {
+            only = data;
+            only_len = (size_t)f[1];
+        } else {
+            if (chunks == 2 && ac_strbuf_append(&body, only, only_len) != ARC_OK) {
+                result = ARC_ERR_NO_MEMORY;
+            }
+            if (ac_strbuf_append(&body, data, (size_t)f[1]) != ARC_OK) {
+                result = ARC_ERR_NO_MEMORY;
+            }
+        }
+    }
+    if (s_cassette.realtime && result == err) {
+        sleep_until_us(start + total_us);
+    }
+    if (!s_cassette.realtime) {
+        response->timing.total_us = (uint32_t)(ac_platform_monotonic_us() - start);
+    }
+
+    if (result == ARC_OK && !stream && chunks > 0) {
+        result = chunks == 1 ? replay_body(request, response, only, only_len)
+                             : replay_body(request, response, body.data, body.len);
+    }
+    ac_strbuf_reset(&body);
+    return result;
+}
+
+/*============================================================================
+ * Request Hooks
+ *============================================================================*/
+
+/**
+ * @brief Look the request up; on a miss decide between network and failure
+ *
+ * @return Record payload, or NULL with *err set (ARC_OK = send it)
+ */
+static const char *replay_lookup(const arc_http_request_t *request, uint64_t ukey,
+                                 arc_http_response_t *response, arc_err_t *err) {
+    int consumed = 0;
+    uint64_t key = request->body_read ? pulled_key(request, ukey, &consumed)
+                                      : request_key(request, ukey);
+    const char *payload = replay_take(key, ukey);
+    *err = ARC_OK;
+    if (!payload && (s_cassette.strict || consumed)) {
+        memset(response, 0, sizeof(*response));
+        response->error_msg = ARC_STRDUP("Request not on the cassette");
+        *err = ARC_ERR_NOT_FOUND;
+    }
+    return payload;
+}
+
+/**
+ * @brief Route a pulled body through the hasher so it is keyed as it is sent
+ */
+static void hash_body(arc_http_request_t *hashed, body_hash_t *bh,
+                      const arc_http_request_t *request, uint64_t ukey) {
+    bh->request = request;
+    bh->seed = fnv1a64_update(FNV64_OFFSET, &ukey, sizeof(ukey));
+    bh->hash = bh->seed;
+    hashed->body_read = hashing_read;
+    hashed->body_rewind = request->body_rewind ? hashing_rewind : NULL;
+    hashed->body_user_data = bh;
+}
+
+arc_err_t arc_cassette_request(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response,
+    arc_http_perform_fn perform
+) {
+    if (!request || !request->url || !response) {
+        return perform(client, request, response);
+    }
+    uint64_t ukey = url_key(request);
+
+    if (atomic_load(&s_cassette.mode) == AC_CASSETTE_REPLAY) {
+        arc_err_t err;
+        const char *payload = replay_lookup(request, ukey, response, &err);
+        if (payload) {
+            return replay(payload, request, NULL, response);
+        }
+        return err != ARC_OK ? err : perform(client, request, response);
+    }
+
+    recording_t rec = { .chunks = AC_STRBUF_INIT, .start_us = ac_platform_monotonic_us() };
+    arc_http_request_t sent = *request;
+    body_hash_t bh;
+    if (request->body_read) {
+        hash_body(&sent, &bh, request, ukey);
+    }
+    arc_err_t err = perform(client, &sent, response);
+    uint64_t key = request->body_read ? bh.hash : request_key(request, ukey);
+    rec_finish(&rec, request, key, ukey, err, response, 0);
+    return err;
+}
+
+arc_err_t arc_cassette_request_stream(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response,
+    arc_http_perform_stream_fn perform
+) {
+    if (!request || !request->base.url || !request->on_data || !response) {
+        return perform(client, request, response);
+    }
+    const arc_http_request_t *base = &request->base;
+    uint64_t ukey = url_key(base);
+
+    if (atomic_load(&s_cassette.mode) == AC_CASSETTE_REPLAY) {
+        arc_err_t err;
+        const char *payload = replay_lookup(base, ukey, response, &err);
+        if (payload) {
+            return replay(payload, base, request, response);
+        }
+        return err != ARC_OK ? err : perform(client, request, response);
+    }
+
+    recording_t rec = {
+        .chunks = AC_STRBUF_INIT,
+        .start_us = ac_platform_monotonic_us(),
+        .on_data = request->on_data,
+        .user_data = request->user_data,
+    };
+    arc_http_stream_request_t sent = *request;
+    sent.on_data = recording_stream_cb;
+    sent.user_data = &rec;
+    body_hash_t bh;
+    if (base->body_read) {
+        hash_body(&sent.base, &bh, base, ukey);
+    }
+    arc_err_t err = perform(client, &sent, response);
+    uint64_t key = base->body_read ? bh.hash : request_key(base, ukey);
+    rec_finish(&rec, base, key, ukey, err, response, 1);
+    return err;
+}
+
+/*============================================================================
+ * Cassette API
+ *============================================================================*/
+
+/**
+ * @brief Index the records of a loaded cassette
+ */
+static arc_err_t index_cassette(void) {
+    const char *p = s_cassette.data;
+    const char *end = p + s_cassette.data_len;
+    size_t magic = sizeof(CASSETTE_MAGIC) - 1;
+    if (s_cassette.data_len < magic || memcmp(p, CASSETTE_MAGIC, magic) != 0) {
+        return ARC_ERR_PARSE;
+    }
+    p += magic;
+
+    size_t cap = 0;
+    while (p < end) {
+        /* req <method> <key> <url key> <url len> */
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl || nl - p < 4 || memcmp(p, "req ", 4) != 0) {
+            break;
+        }
+        char line[CASSETTE_LINE_MAX];
+        size_t ll = (size_t)(nl - p) < sizeof(line) - 1 ? (size_t)(nl - p) : sizeof(line) - 1;
+        memcpy(line, p, ll);
+        line[ll] = '\0';
+        int method;
+        char key[17], ukey[17];
+        size_t url_len;
+        if (sscanf(line, "req %d %16s %16s %zu", &method, key, ukey, &url_len) != 4) {
+            break;
+        }
+        p = nl + 1;
+        if (!read_payload(&p, end, url_len)) {
+            break;
+        }
+
+        if (s_cassette.entry_count == cap) {
+            size_t ncap = cap ? cap * 2 : 64;
+            cassette_entry_t *entries = ARC_REALLOC(s_cassette.entries, ncap * sizeof(*entries));
+            if (!entries) {
+                return ARC_ERR_NO_MEMORY;
+            }
+            s_cassette.entries = entries;
+            cap = ncap;
+        }
+        cassette_entry_t *e = &s_cassette.entries[s_cassette.entry_count];
+        e->key = parse_hex(key);
+        e->url_key = parse_hex(ukey);
+        e->payload = p;
+        e->used = 0;
+
+        /* Skip to the record's end: every payload is length-prefixed */
+        unsigned long long f[6];
+        if (read_line(&p, end, "res", f, 6) != 6) {
+            break;
+        }
+        int ok = 1;
+        while (ok && p < end && memcmp(p, "end\n", 4) != 0) {
+            if (read_line(&p, end, "hdr", f, 2) == 2) {
+                ok = read_payload(&p, end, (size_t)(f[0] + f[1])) != NULL;
+            } else if (read_line(&p, end, "msg", f, 1) == 1) {
+                ok = read_payload(&p, end, (size_t)f[0]) != NULL;
+            } else if (read_line(&p, end, "chunk", f, 2) == 2) {
+                ok = read_payload(&p, end, (size_t)f[1]) != NULL;
+            } else {
+                ok = 0;
+            }
+        }
+        if (!ok || (size_t)(end - p) < 4) {
+            break;                   /* Torn last record: the recording was cut off */
+        }
+        p += 4;
+        s_cassette.entry_count++;
+    }
+    if (p < end) {
+        AC_LOG_WARN("Cassette: ignoring %zu bytes after record %zu",
+                    (size_t)(end - p), s_cassette.entry_count);
+    }
+    return ARC_OK;
+}
+
+static arc_err_t load_cassette(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        AC_LOG_ERROR("Cassette: cannot open %s", path);
+        return ARC_ERR_IO;
+    }
+    ac_strbuf_t sb = AC_STRBUF_INIT;
+    char buf[16384];
+    size_t n;
+    arc_err_t err = ARC_OK;
+    while (err == ARC_OK && (n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        err = ac_strbuf_append(&sb, buf, n);
+    }
+    if (err == ARC_OK && ferror(f)) {
+        err = ARC_ERR_IO;
+    }
+    fclose(f);
+    if (err != ARC_OK) {
+        ac_strbuf_reset(&sb);
+        return err;
+    }
+    s_cassette.data_len = sb.len;
+    s_cassette.data = ac_strbuf_take(&sb);
+    if (!s_cassette.data) {
+        return ARC_ERR_PARSE;        /* Empty file */
+    }
+
+    err = index_cassette();
+    if (err != ARC_OK) {
+        AC_LOG_ERROR("Cassette: %s is not a cassette", path);
+        return err;
+    }
+    AC_LOG_INFO("Cassette: replaying %zu requests from %s", s_cassette.entry_count, path);
+    return ARC_OK;
+}
+
+static void release(void) {
+    ARC_FREE(s_cassette.entries);
+    ARC_FREE(s_cassette.data);
+    s_cassette.entries = NULL;
+    s_cassette.entry_count = 0;
+    s_cassette.data = NULL;
+    s_cassette.data_len = 0;
+}
+
+arc_err_t ac_cassette_start(const ac_cassette_config_t *config) {
+    if (!config || !config->path ||
+        (config->mode != AC_CASSETTE_RECORD && config->mode != AC_CASSETTE_REPLAY)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (arc_cassette_active()) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    memset(&s_cassette.stats, 0, sizeof(s_cassette.stats));
+    s_cassette.realtime = config->realtime;
+    s_cassette.strict = config->strict;
+    s_cassette.write_failed = 0;
+
+    if (config->mode == AC_CASSETTE_RECORD) {
+        s_cassette.file = fopen(config->path, "wb");
+        if (!s_cassette.file || fputs(CASSETTE_MAGIC, s_cassette.file) < 0) {
+            AC_LOG_ERROR("Cassette: cannot write %s", config->path);
+            if (s_cassette.file) {
+                fclose(s_cassette.file);
+                s_cassette.file = NULL;
+            }
+            return ARC_ERR_IO;
+        }
+        AC_LOG_INFO("Cassette: recording to %s", config->path);
+    } else {
+        arc_err_t err = load_cassette(config->path);
+        if (err != ARC_OK) {
+            release();
+            return err;
+        }
+    }
+    atomic_store(&s_cassette.mode, (int)config->mode);
+    return ARC_OK;
+}
+
+arc_err_t ac_cassette_stop(void) {
+    atomic_store(&s_cassette.mode, 0);
+
+    pthread_mutex_lock(&s_cassette.lock);
+    arc_err_t err = s_cassette.write_failed ? ARC_ERR_IO : ARC_OK;
+    if (s_cassette.file) {
+        if (fclose(s_cassette.file) != 0) {
+            err = ARC_ERR_IO;
+        }
+        s_cassette.file = NULL;
+    }
+    release();
+    pthread_mutex_unlock(&s_cassette.lock);
+    return err;
+}
+
+void ac_cassette_get_stats(ac_cassette_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    pthread_mutex_lock(&s_cassette.lock);
+    *stats = s_cassette.stats;
+    pthread_mutex_unlock(&s_cassette.lock);
+}
@@ -0,0 +1,48 @@
+/**
+ * @file http_cassette.h
+ * @brief HTTP record/replay at the arc_http boundary (internal)
+ *
+ * Each backend's arc_http_request() and arc_http_request_stream() hand
+ * their request to these when a cassette is active (arc/cassette.h),
+ * passing the function that performs it over the network.
+ */
+
+#ifndef ARC_HTTP_CASSETTE_H
+#define ARC_HTTP_CASSETTE_H
+
+#include "http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Whether requests go through the cassette (one relaxed load)
+ */
+int arc_cassette_active(void);
+
+/**
+ * @brief Record the request around perform, or answer it from the cassette
+ */
+arc_err_t arc_cassette_request(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response,
+    arc_http_perform_fn perform
+);
+
+/**
+ * @brief Streaming variant: chunks are recorded with their arrival time
+ */
+arc_err_t arc_cassette_request_stream(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response,
+    arc_http_perform_stream_fn perform
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HTTP_CASSETTE_H */
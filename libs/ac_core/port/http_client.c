@@ -81,8 +81,12 @@ void arc_http_header_free(arc_http_header_t *list) {
 void arc_http_response_free(arc_http_response_t *response) {
     if (!response) return;
 
-    arc_http_header_free(response->headers);
-    ARC_FREE(response->body);
+    if (!response->headers_borrowed) {
+        arc_http_header_free(response->headers);
+    }
+    if (!response->body_borrowed) {
+        ARC_FREE(response->body);
+    }
     ARC_FREE(response->error_msg);
 
     memset(response, 0, sizeof(*response));
@@ -6,7 +6,7 @@
  * Platform-specific implementations:
  * - POSIX: libcurl (port/posix/http/http_curl.c)
  * - Windows: WinHTTP (port/windows/http/http_winhttp.c)
- * - FreeRTOS: mongoose+mbedTLS (port/freertos/http/http_mongoose.c)
+ * - FreeRTOS: mongoose+mbedTLS (port/freertos/http/http_mongoose.c), static buffers
  *
  * Used by:
  * - LLM providers (openai.c, anthropic.c)
@@ -21,6 +21,8 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "arc/error.h"
+#include "arc/arena.h"
+#include "arc/affinity.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,6 +38,7 @@ typedef enum {
     ARC_HTTP_PUT,
     ARC_HTTP_DELETE,
     ARC_HTTP_PATCH,
+    ARC_HTTP_HEAD,                      /* Headers only (connection warm-up, probes) */
 } arc_http_method_t;
 
 /*============================================================================
@@ -48,6 +51,72 @@ typedef struct arc_http_header {
     struct arc_http_header *next;
 } arc_http_header_t;
 
+/*============================================================================
+ * Prepared Headers
+ *
+ * Headers that never change for a client (Authorization, Content-Type,
+ * API version) can be formatted once into an immutable set and attached
+ * to every request, instead of being rebuilt per call. A set may be
+ * shared by requests on any number of threads.
+ *============================================================================*/
+
+typedef struct arc_http_header_set arc_http_header_set_t;
+
+/**
+ * @brief Format a header list into a reusable set
+ *
+ * @param headers  Headers to copy (NULL/empty gives an empty set)
+ * @param out      Output set
+ * @return ARC_OK on success, ARC_ERR_NO_MEMORY otherwise
+ */
+arc_err_t arc_http_header_set_create(
+    const arc_http_header_t *headers,
+    arc_http_header_set_t **out
+);
+
+/**
+ * @brief Destroy a header set (no request may still be using it)
+ */
+void arc_http_header_set_destroy(arc_http_header_set_t *set);
+
+/*============================================================================
+ * Response Sink
+ *
+ * By default a response body is malloc'ed (sized from Content-Length when
+ * the server sends one) and owned by the response. A sink places it in
+ * caller memory instead, so it can be parsed where it landed:
+ * - buffer: written in place; a larger body fails with
+ *   ARC_ERR_RESPONSE_TOO_LARGE
+ * - arena:  allocated from the arena (must not be used by anyone else
+ *   until the request completes)
+ *============================================================================*/
+
+typedef struct {
+    char *buffer;                       /* Caller buffer (takes precedence) */
+    size_t capacity;                    /* Buffer size including the NUL */
+    arena_t *arena;                     /* Or: allocate the body here */
+} arc_http_sink_t;
+
+/*============================================================================
+ * Streamed Request Bodies
+ *
+ * Instead of one contiguous body a request can name a source that is
+ * pulled while the body is being sent, so a large body never has to be
+ * assembled in memory. For engine clients the callbacks run on the I/O
+ * thread.
+ *============================================================================*/
+
+/**
+ * @brief Fill up to size bytes of buf with the next part of the body
+ * @return Bytes written, 0 at the end, ARC_HTTP_BODY_ABORT to fail the request
+ */
+typedef size_t (*arc_http_body_read_fn)(char *buf, size_t size, void *user_data);
+
+/** Restart the body from its first byte (a resend after a retry or redirect) */
+typedef void (*arc_http_body_rewind_fn)(void *user_data);
+
+#define ARC_HTTP_BODY_ABORT ((size_t)-1)
+
 /*============================================================================
  * HTTP Request Configuration
  *============================================================================*/
@@ -55,23 +124,57 @@ typedef struct arc_http_header {
 typedef struct {
     const char *url;                    /* Full URL (https://api.openai.com/v1/...) */
     arc_http_method_t method;        /* HTTP method */
+    const arc_http_header_set_t *header_set; /* Prepared headers, sent first (optional) */
     arc_http_header_t *headers;      /* Request headers (linked list) */
     const char *body;                   /* Request body (NULL for GET) */
     size_t body_len;                    /* Body length (0 = strlen if body is string) */
     uint32_t timeout_ms;                /* Request timeout in milliseconds */
     int verify_ssl;                     /* 1 = verify SSL cert, 0 = skip (dev only) */
+    const arc_http_sink_t *sink;        /* Body destination (NULL = heap, owned by response) */
+    int compress_body;                  /* gzip the body (endpoint must accept Content-Encoding: gzip) */
+    const volatile int *cancel;         /* Abort with ARC_ERR_CANCELLED once *cancel != 0 (optional,
+                                           polled about once a second; must outlive the transfer) */
+    arc_http_body_read_fn body_read;    /* Streamed body instead of body (optional); body_len is
+                                           its size, 0 = unknown (chunked); no compress_body */
+    arc_http_body_rewind_fn body_rewind; /* Lets the body be resent (optional) */
+    void *body_user_data;               /* Passed to body_read/body_rewind; must outlive the transfer */
+    const char *const *capture_headers; /* More response headers to collect into response->headers
+                                           (NULL-terminated, optional; must outlive the transfer) */
+    uint32_t start_delay_ms;            /* Engine: start this long after submission, e.g. a
+                                           reconnect backoff (0 = at once; blocking calls ignore it) */
 } arc_http_request_t;
 
+/** Bodies smaller than this are sent as is even with compress_body */
+#define ARC_HTTP_COMPRESS_MIN_BYTES 1024
+
 /*============================================================================
  * HTTP Response
  *============================================================================*/
 
+/**
+ * Phases of one transfer, each measured from the start of the request
+ * (curl's CURLINFO_*_TIME_T); 0 = not reached or not measured. A reused
+ * connection reports near-zero dns/connect/tls.
+ */
+typedef struct {
+    uint32_t dns_us;                    /* Name resolved */
+    uint32_t connect_us;                /* TCP connected */
+    uint32_t tls_us;                    /* TLS handshake done (0 = plain HTTP) */
+    uint32_t ttfb_us;                   /* First response byte */
+    uint32_t total_us;                  /* Transfer done */
+} arc_http_timing_t;
+
 typedef struct {
     int status_code;                    /* HTTP status code (200, 404, etc.) */
-    arc_http_header_t *headers;      /* Response headers */
-    char *body;                         /* Response body (caller must free) */
+    arc_http_header_t *headers;      /* Response headers the library uses (Mcp-Session-Id, quota) */
+    char *body;                         /* Response body (caller must free), NUL-terminated */
     size_t body_len;                    /* Body length */
+    int body_borrowed;                  /* 1 = body is in the request's sink, not freed */
+    int headers_borrowed;               /* 1 = headers live in the client (static backends),
+                                           not freed; valid until its next request */
+    uint32_t retry_after_ms;            /* Retry-After from the server (0 = none) */
     char *error_msg;                    /* Error message if failed (caller must free) */
+    arc_http_timing_t timing;           /* Where the time went */
 } arc_http_response_t;
 
 /*============================================================================
@@ -95,6 +198,8 @@ typedef struct {
     arc_http_request_t base;         /* Base request config */
     arc_stream_callback_t on_data;   /* Callback for each chunk */
     void *user_data;                    /* User context passed to callback */
+    arc_stream_callback_t tap;       /* Sees each chunk first, unchanged (optional) */
+    void *tap_user_data;             /* User context passed to tap */
 } arc_http_stream_request_t;
 
 /*============================================================================
@@ -102,6 +207,7 @@ typedef struct {
  *============================================================================*/
 
 typedef struct arc_http_client arc_http_client_t;
+typedef struct arc_http_engine arc_http_engine_t;
 
 /*============================================================================
  * Client Configuration
@@ -113,6 +219,12 @@ typedef struct {
     size_t ca_cert_len;                 /* CA cert data length */
     uint32_t default_timeout_ms;        /* Default timeout (0 = 30000) */
     size_t max_response_size;           /* Max response body size (0 = 10MB) */
+    int http2;                          /* Negotiate HTTP/2 over TLS; engines multiplex streams */
+    int disable_decompression;          /* 1 = don't advertise Accept-Encoding */
+    size_t max_host_connections;        /* Engine: connections per origin (0 = unlimited) */
+    int external_loop;                  /* Engine: no I/O thread, driven by arc_http_engine_process() */
+    const ac_affinity_t *affinity;      /* Engine: I/O thread placed as thread 0 (must outlive it) */
+    arc_http_engine_t *engine;          /* Client: send requests through this engine (optional) */
 } arc_http_client_config_t;
 
 /*============================================================================
@@ -122,6 +234,16 @@ typedef struct {
 /**
  * @brief Create an HTTP client instance
  *
+ * The client keeps one handle configured with the CA, TLS and protocol
+ * options for its whole life; each request only sets URL, method, body,
+ * headers and timeout.
+ *
+ * With config->engine set the client owns no connection of its own:
+ * requests run on the engine (sharing its connections, multiplexed over
+ * HTTP/2 where negotiated) while the calling thread blocks as usual.
+ * Stream callbacks still run on the calling thread. The engine must
+ * outlive the client.
+ *
  * @param config  Client configuration (NULL for defaults)
  * @param out     Output client handle
  * @return ARC_OK on success, error code otherwise
@@ -158,7 +280,9 @@ arc_err_t arc_http_request(
  * @brief Perform a streaming HTTP request
  *
  * For SSE (Server-Sent Events) or chunked transfer.
- * Callback is invoked for each chunk received.
+ * Callback is invoked for each chunk received. A tap, if set, gets every
+ * chunk before on_data does, e.g. to relay the raw body elsewhere while
+ * on_data decodes it; either one returning non-zero aborts.
  *
  * @param client    Client handle
  * @param request   Streaming request configuration
@@ -178,6 +302,217 @@ arc_err_t arc_http_request_stream(
  */
 void arc_http_response_free(arc_http_response_t *response);
 
+/*============================================================================
+ * Request Layers
+ *
+ * Layers between the entry points above and a backend's transfer (the
+ * cassette, fault injection) are handed the function that performs the
+ * request.
+ *============================================================================*/
+
+typedef arc_err_t (*arc_http_perform_fn)(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response
+);
+
+typedef arc_err_t (*arc_http_perform_stream_fn)(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response
+);
+
+/*============================================================================
+ * Asynchronous Engine
+ *
+ * One I/O thread multiplexes many requests (libcurl multi interface on
+ * epoll/kqueue, or an I/O completion port on Windows). Submission never blocks; completion is reported through
+ * an optional callback and collected with arc_http_transfer_wait().
+ * Stream on_data callbacks and on_done run on the I/O thread and must
+ * not block.
+ *
+ * With config.external_loop there is no I/O thread: the host's event
+ * loop drives the engine through arc_http_engine_fd(),
+ * arc_http_engine_timeout() and arc_http_engine_process(), and callbacks
+ * run on the host's loop thread instead.
+ *
+ * Backends without an engine return ARC_ERR_NOT_IMPLEMENTED from
+ * arc_http_engine_create().
+ *============================================================================*/
+
+typedef struct arc_http_transfer arc_http_transfer_t;
+
+/**
+ * @brief Completion callback (I/O thread)
+ *
+ * The transfer is complete; arc_http_transfer_wait() returns at once.
+ */
+typedef void (*arc_http_done_fn)(arc_http_transfer_t *transfer, void *user_data);
+
+/**
+ * @brief Create an engine and start its I/O thread
+ *
+ * @param config  Defaults for timeouts, limits and CA (NULL for defaults)
+ * @param out     Output engine handle
+ * @return ARC_OK on success, error code otherwise
+ */
+arc_err_t arc_http_engine_create(
+    const arc_http_client_config_t *config,
+    arc_http_engine_t **out
+);
+
+/**
+ * @brief Stop the I/O thread and destroy the engine
+ *
+ * Transfers still in flight complete with ARC_ERR_CANCELLED. Handles
+ * stay valid until released. Must not be called from a callback.
+ */
+void arc_http_engine_destroy(arc_http_engine_t *engine);
+
+/**
+ * @brief Queue a request (non-blocking counterpart of arc_http_request)
+ *
+ * The request, its headers and body are copied; they need not outlive
+ * the call (a streamed body's body_user_data must outlive the transfer).
+ *
+ * @param engine     Engine handle
+ * @param request    Request configuration
+ * @param on_done    Completion callback (optional)
+ * @param user_data  Passed to on_done
+ * @param out        Transfer handle (release with arc_http_transfer_release)
+ * @return ARC_OK on success, error code otherwise
+ */
+arc_err_t arc_http_submit(
+    arc_http_engine_t *engine,
+    const arc_http_request_t *request,
+    arc_http_done_fn on_done,
+    void *user_data,
+    arc_http_transfer_t **out
+);
+
+/**
+ * @brief Queue a streaming request (counterpart of arc_http_request_stream)
+ *
+ * request->tap and request->on_data run on the I/O thread for every chunk.
+ */
+arc_err_t arc_http_submit_stream(
+    arc_http_engine_t *engine,
+    const arc_http_stream_request_t *request,
+    arc_http_done_fn on_done,
+    void *user_data,
+    arc_http_transfer_t **out
+);
+
+/**
+ * @brief Check whether a transfer has completed (non-blocking)
+ *
+ * @return 1 if complete, 0 otherwise
+ */
+int arc_http_transfer_poll(arc_http_transfer_t *transfer);
+
+/**
+ * @brief Block until a transfer completes and take its response
+ *
+ * @param transfer  Transfer handle
+ * @param response  Receives the response (moved out, free with
+ *                  arc_http_response_free); NULL to discard
+ * @return Same codes as the blocking calls, ARC_ERR_CANCELLED if cancelled
+ */
+arc_err_t arc_http_transfer_wait(
+    arc_http_transfer_t *transfer,
+    arc_http_response_t *response
+);
+
+/**
+ * @brief Abort a transfer; it completes with ARC_ERR_CANCELLED
+ */
+void arc_http_transfer_cancel(arc_http_transfer_t *transfer);
+
+/**
+ * @brief Release a transfer handle
+ *
+ * Does not cancel; an in-flight transfer still runs to completion.
+ */
+void arc_http_transfer_release(arc_http_transfer_t *transfer);
+
+/**
+ * @brief Descriptor that becomes readable when the engine has work
+ *
+ * For engines created with external_loop: add it to the host's epoll,
+ * kqueue or libuv loop and call arc_http_engine_process() when it is
+ * readable or arc_http_engine_timeout() expires. Submissions from any
+ * thread make it readable.
+ *
+ * @return fd, -1 where the engine cannot expose one (no epoll/kqueue;
+ *         on Windows arc_http_engine_process() waits on its completion
+ *         port instead)
+ */
+int arc_http_engine_fd(arc_http_engine_t *engine);
+
+/**
+ * @brief Milliseconds until the engine needs processing regardless of I/O
+ *
+ * @return Delay, 0 = process now, -1 = only when the fd is readable
+ */
+int arc_http_engine_timeout(arc_http_engine_t *engine);
+
+/**
+ * @brief Run one round of the engine's event loop on the calling thread
+ *
+ * Waits up to timeout_ms for I/O (0 = poll, -1 = until something
+ * happens), performs it, and runs stream and completion callbacks on
+ * this thread. Call from one thread at a time, and never block on a
+ * transfer from that thread: only this call makes it progress.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_STATE if the engine has its own thread
+ */
+arc_err_t arc_http_engine_process(arc_http_engine_t *engine, int timeout_ms);
+
+/**
+ * @brief Per-origin engine counters
+ */
+#define ARC_HTTP_ORIGIN_MAX 128
+
+typedef struct {
+    char origin[ARC_HTTP_ORIGIN_MAX];   /* scheme://host:port */
+    size_t active_streams;              /* Requests queued or in flight */
+    uint64_t total_requests;            /* Requests submitted */
+    uint64_t connections_opened;        /* New connections (others reused one) */
+    uint64_t http2_requests;            /* Completed over HTTP/2 */
+} arc_http_origin_stats_t;
+
+/**
+ * @brief Snapshot per-origin counters
+ *
+ * @param engine  Engine handle
+ * @param out     Output array (may be NULL to only count)
+ * @param max     Capacity of out
+ * @return Number of origins seen (may exceed max)
+ */
+size_t arc_http_engine_origin_stats(
+    arc_http_engine_t *engine,
+    arc_http_origin_stats_t *out,
+    size_t max
+);
+
+/*============================================================================
+ * Traffic Counters (process-wide)
+ *============================================================================*/
+
+typedef struct {
+    uint64_t requests;                  /* Requests started */
+    uint64_t compressed_requests;       /* Bodies sent gzip'ed */
+    uint64_t body_bytes;                /* Request bodies before compression */
+    uint64_t body_wire_bytes;           /* Request bodies as sent */
+    uint64_t response_bytes;            /* Response bodies after decompression */
+    uint64_t response_wire_bytes;       /* Response bodies as received */
+} arc_http_io_stats_t;
+
+/**
+ * @brief Snapshot traffic counters of all clients and engines
+ */
+void arc_http_get_io_stats(arc_http_io_stats_t *stats);
+
 /*============================================================================
  * Header Helper Functions
  *============================================================================*/
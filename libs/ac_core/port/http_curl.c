@@ -7,41 +7,81 @@
  */
 
 #include "arc/platform.h"
-#include "http_client.h"
+#include "http_curl_internal.h"
 #include "arc/log.h"
-#include <curl/curl.h>
+#include "profile.h"
+#if ARC_FEATURE_CASSETTE
+#include "http_cassette.h"
+#endif
+#if ARC_FEATURE_HTTP_FAULTS
+#include "http_fault_shim.h"
+#endif
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include <pthread.h>
 
+#ifdef ARC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 /*============================================================================
  * Internal Structures
  *============================================================================*/
 
 struct arc_http_client {
     CURL *curl;
+    CURLM *multi;                    /* Drives cancellable requests (created on first use) */
     arc_http_client_config_t config;
 };
 
-typedef struct {
-    char *data;
-    size_t size;
-    size_t cap;
-    size_t max_response_size;  /* 0 = unlimited */
-    int size_exceeded;         /* Set to 1 if response size limit exceeded */
-} write_buffer_t;
-
-typedef struct {
-    arc_stream_callback_t callback;
-    void *user_data;
-    int aborted;
-} stream_context_t;
+/** How often an idle cancellable request looks at its flag */
+#define CANCEL_POLL_MS 20
 
 /*============================================================================
  * CURL Callbacks
  *============================================================================*/
 
-static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+#define BUFFER_INITIAL_SIZE 4096
+
+/**
+ * @brief Make room for need bytes (including the NUL)
+ */
+static int buffer_reserve(write_buffer_t *buf, size_t need) {
+    if (need <= buf->cap) {
+        return 1;
+    }
+    if (buf->fixed) {
+        AC_LOG_ERROR("Response exceeds caller buffer: %zu > %zu", need, buf->cap);
+        buf->size_exceeded = 1;
+        return 0;
+    }
+
+    size_t new_cap = buf->cap ? buf->cap * 2 : BUFFER_INITIAL_SIZE;
+    if (new_cap < need) {
+        new_cap = need;
+    }
+
+    char *new_data;
+    if (buf->arena) {
+        /* Arenas cannot grow in place; the old block is abandoned */
+        new_data = arena_alloc(buf->arena, new_cap);
+        if (new_data && buf->size > 0) {
+            memcpy(new_data, buf->data, buf->size);
+        }
+    } else {
+        new_data = ARC_REALLOC(buf->data, new_cap);
+    }
+    if (!new_data) {
+        return 0;  /* Out of memory */
+    }
+
+    buf->data = new_data;
+    buf->cap = new_cap;
+    return 1;
+}
+
+size_t arc_curl_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
     write_buffer_t *buf = (write_buffer_t *)userp;
 
@@ -53,18 +93,19 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
         return 0;  /* Abort transfer */
     }
 
-    /* Grow buffer if needed */
-    if (buf->size + realsize + 1 > buf->cap) {
-        size_t new_cap = buf->cap * 2;
-        if (new_cap < buf->size + realsize + 1) {
-            new_cap = buf->size + realsize + 1;
-        }
-        char *new_data = ARC_REALLOC(buf->data, new_cap);
-        if (!new_data) {
-            return 0;  /* Out of memory */
+    /* Size the buffer once from Content-Length instead of doubling */
+    if (buf->size == 0 && buf->curl) {
+        curl_off_t length = -1;
+        if (curl_easy_getinfo(buf->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) == CURLE_OK &&
+            length > 0 &&
+            (buf->max_response_size == 0 || (size_t)length <= buf->max_response_size) &&
+            !buffer_reserve(buf, (size_t)length + 1)) {
+            return 0;
         }
-        buf->data = new_data;
-        buf->cap = new_cap;
+    }
+
+    if (!buffer_reserve(buf, buf->size + realsize + 1)) {
+        return 0;
     }
 
     memcpy(buf->data + buf->size, contents, realsize);
@@ -74,7 +115,51 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
     return realsize;
 }
 
-static size_t stream_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+void arc_curl_buffer_init(
+    write_buffer_t *buf,
+    CURL *curl,
+    size_t max_response_size,
+    const arc_http_sink_t *sink
+) {
+    memset(buf, 0, sizeof(*buf));
+    buf->curl = curl;
+    buf->max_response_size = max_response_size;
+
+    if (sink && sink->buffer && sink->capacity > 0) {
+        buf->data = sink->buffer;
+        buf->cap = sink->capacity;
+        buf->fixed = 1;
+        buf->data[0] = '\0';
+    } else if (sink && sink->arena) {
+        buf->arena = sink->arena;
+    }
+}
+
+arc_err_t arc_curl_buffer_finish(write_buffer_t *buf, arc_http_response_t *response) {
+    /* Empty bodies still come back as "" */
+    if (!buffer_reserve(buf, 1)) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    buf->data[buf->size] = '\0';
+
+    response->body = buf->data;
+    response->body_len = buf->size;
+    response->body_borrowed = buf->fixed || buf->arena;
+
+    buf->data = NULL;
+    buf->size = buf->cap = 0;
+    return ARC_OK;
+}
+
+void arc_curl_buffer_discard(write_buffer_t *buf) {
+    if (!buf->fixed && !buf->arena) {
+        ARC_FREE(buf->data);
+    }
+    buf->data = NULL;
+    buf->size = buf->cap = 0;
+}
+
+size_t arc_curl_stream_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
     stream_context_t *ctx = (stream_context_t *)userp;
 
@@ -82,6 +167,10 @@ static size_t stream_callback(void *contents, size_t size, size_t nmemb, void *u
         return 0;  /* Abort transfer */
     }
 
+    if (ctx->tap && ctx->tap((const char *)contents, realsize, ctx->tap_user_data) != 0) {
+        ctx->aborted = 1;
+        return 0;
+    }
     if (ctx->callback) {
         int ret = ctx->callback((const char *)contents, realsize, ctx->user_data);
         if (ret != 0) {
@@ -90,20 +179,125 @@ static size_t stream_callback(void *contents, size_t size, size_t nmemb, void *u
         }
     }
 
+    ctx->bytes += realsize;
     return realsize;
 }
 
+/*============================================================================
+ * Traffic Counters
+ *============================================================================*/
+
+static pthread_mutex_t s_io_lock = PTHREAD_MUTEX_INITIALIZER;
+static arc_http_io_stats_t s_io_stats;
+
+static void record_request(size_t body_bytes, size_t wire_bytes, int compressed) {
+    pthread_mutex_lock(&s_io_lock);
+    s_io_stats.requests++;
+    s_io_stats.compressed_requests += compressed ? 1 : 0;
+    s_io_stats.body_bytes += body_bytes;
+    s_io_stats.body_wire_bytes += wire_bytes;
+    pthread_mutex_unlock(&s_io_lock);
+}
+
+void arc_curl_record_response(CURL *curl, size_t decoded) {
+    /* SIZE_DOWNLOAD counts body bytes before content decoding */
+    curl_off_t wire = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wire);
+
+    pthread_mutex_lock(&s_io_lock);
+    s_io_stats.response_bytes += decoded;
+    s_io_stats.response_wire_bytes += wire > 0 ? (uint64_t)wire : 0;
+    pthread_mutex_unlock(&s_io_lock);
+}
+
+void arc_http_get_io_stats(arc_http_io_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    pthread_mutex_lock(&s_io_lock);
+    *stats = s_io_stats;
+    pthread_mutex_unlock(&s_io_lock);
+}
+
+/*============================================================================
+ * Global State
+ *
+ * Every client and engine holds a reference. While any exist, one CURLSH
+ * shares the DNS cache, TLS sessions and idle connections between all of
+ * their easy handles, so a new pool entry, engine or MCP transport
+ * resumes TLS with a host some other handle already talked to.
+ *============================================================================*/
+
 static int s_curl_refcount = 0;
 static pthread_mutex_t s_curl_mutex = PTHREAD_MUTEX_INITIALIZER;
+static CURLSH *s_curl_share = NULL;
+static pthread_mutex_t s_share_locks[CURL_LOCK_DATA_LAST];
+
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userp) {
+    (void)handle;
+    (void)access;
+    (void)userp;
+    pthread_mutex_lock(&s_share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userp) {
+    (void)handle;
+    (void)userp;
+    pthread_mutex_unlock(&s_share_locks[data]);
+}
+
+static void share_create(void) {
+    CURLSH *share = curl_share_init();
+    if (!share) {
+        AC_LOG_WARN("curl_share_init failed, handles will not share caches");
+        return;
+    }
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&s_share_locks[i], NULL);
+    }
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    s_curl_share = share;
+}
+
+static void share_destroy(void) {
+    if (!s_curl_share) {
+        return;
+    }
+
+    CURLSHcode rc = curl_share_cleanup(s_curl_share);
+    if (rc != CURLSHE_OK) {
+        /* A handle is still attached; leaking beats freeing under it */
+        AC_LOG_WARN("curl_share_cleanup failed: %s", curl_share_strerror(rc));
+    } else {
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&s_share_locks[i]);
+        }
+    }
+    s_curl_share = NULL;
+}
+
+void arc_curl_share_attach(CURL *curl) {
+    /* Only read while the caller holds a global reference */
+    if (s_curl_share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, s_curl_share);
+    }
+}
 
-static arc_err_t curl_global_init_once(void) {
+arc_err_t arc_curl_global_acquire(void) {
     pthread_mutex_lock(&s_curl_mutex);
     if (s_curl_refcount == 0) {
         CURLcode res = curl_global_init(CURL_GLOBAL_DEFAULT);
         if (res != CURLE_OK) {
             AC_LOG_ERROR("curl_global_init failed: %s", curl_easy_strerror(res));
+            pthread_mutex_unlock(&s_curl_mutex);
             return ARC_ERR_BACKEND;
         }
+        share_create();
         AC_LOG_DEBUG("CURL backend initialized");
     }
     s_curl_refcount++;
@@ -112,12 +306,13 @@ static arc_err_t curl_global_init_once(void) {
     return ARC_OK;
 }
 
-static void curl_global_cleanup_once(void) {
+void arc_curl_global_release(void) {
     pthread_mutex_lock(&s_curl_mutex);
     if (s_curl_refcount > 0) {
         s_curl_refcount--;
         AC_LOG_DEBUG("CURL refcount: %d", s_curl_refcount);
         if (s_curl_refcount == 0) {
+            share_destroy();
             curl_global_cleanup();
             AC_LOG_DEBUG("CURL backend cleaned up");
         }
@@ -125,6 +320,442 @@ static void curl_global_cleanup_once(void) {
     pthread_mutex_unlock(&s_curl_mutex);
 }
 
+/*============================================================================
+ * Request Setup
+ *============================================================================*/
+
+#define HEADER_LINE_STACK 256
+
+struct arc_http_header_set {
+    struct curl_slist *list;
+};
+
+/**
+ * @brief Append "name: value" to a curl list
+ * @return New list head, NULL on allocation failure (list left intact)
+ */
+static struct curl_slist *slist_append_header(
+    struct curl_slist *list,
+    const char *name,
+    const char *value
+) {
+    char stack_line[HEADER_LINE_STACK];
+    size_t name_len = strlen(name);
+    size_t value_len = strlen(value);
+    size_t len = name_len + value_len + 3;  /* ": " and \0 */
+    char *line = len <= sizeof(stack_line) ? stack_line : ARC_MALLOC(len);
+    if (!line) {
+        return NULL;
+    }
+
+    memcpy(line, name, name_len);
+    line[name_len] = ':';
+    line[name_len + 1] = ' ';
+    memcpy(line + name_len + 2, value, value_len + 1);
+    struct curl_slist *appended = curl_slist_append(list, line);
+
+    if (line != stack_line) {
+        ARC_FREE(line);
+    }
+    return appended;
+}
+
+static struct curl_slist *slist_copy(const struct curl_slist *src, struct curl_slist *list, int *failed) {
+    for (; src && !*failed; src = src->next) {
+        struct curl_slist *appended = curl_slist_append(list, src->data);
+        if (!appended) {
+            *failed = 1;
+            break;
+        }
+        list = appended;
+    }
+    return list;
+}
+
+arc_err_t arc_http_header_set_create(
+    const arc_http_header_t *headers,
+    arc_http_header_set_t **out
+) {
+    if (!out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    arc_http_header_set_t *set = ARC_CALLOC(1, sizeof(arc_http_header_set_t));
+    if (!set) {
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    for (const arc_http_header_t *h = headers; h; h = h->next) {
+        struct curl_slist *appended = slist_append_header(set->list, h->name, h->value);
+        if (!appended) {
+            arc_http_header_set_destroy(set);
+            return ARC_ERR_NO_MEMORY;
+        }
+        set->list = appended;
+    }
+
+    *out = set;
+    return ARC_OK;
+}
+
+const struct curl_slist *arc_curl_header_set_list(const arc_http_header_set_t *set) {
+    return set ? set->list : NULL;
+}
+
+void arc_http_header_set_destroy(arc_http_header_set_t *set) {
+    if (!set) {
+        return;
+    }
+    curl_slist_free_all(set->list);
+    ARC_FREE(set);
+}
+
+#ifdef ARC_HAVE_ZLIB
+/**
+ * @brief gzip a request body (caller frees)
+ */
+static char *gzip_body(const char *in, size_t len, size_t *out_len) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+
+    uLong bound = deflateBound(&zs, (uLong)len);
+    char *out = ARC_MALLOC(bound);
+    if (!out) {
+        deflateEnd(&zs);
+        return NULL;
+    }
+
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = (uInt)len;
+    zs.next_out = (Bytef *)out;
+    zs.avail_out = (uInt)bound;
+    int rc = deflate(&zs, Z_FINISH);
+    *out_len = zs.total_out;
+    deflateEnd(&zs);
+
+    if (rc != Z_STREAM_END) {
+        ARC_FREE(out);
+        return NULL;
+    }
+    return out;
+}
+#endif
+
+static size_t body_read_callback(char *buffer, size_t size, size_t nitems, void *userp) {
+    body_source_t *source = (body_source_t *)userp;
+    size_t n = source->read(buffer, size * nitems, source->user_data);
+    return n == ARC_HTTP_BODY_ABORT ? CURL_READFUNC_ABORT : n;
+}
+
+static int body_seek_callback(void *userp, curl_off_t offset, int origin) {
+    body_source_t *source = (body_source_t *)userp;
+    if (offset != 0 || origin != SEEK_SET || !source->rewind) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    source->rewind(source->user_data);
+    return CURL_SEEKFUNC_OK;
+}
+
+/**
+ * @brief Pull the body from request->body_read while sending
+ */
+static void set_body_source(CURL *curl, const arc_http_request_t *request,
+                            body_source_t *source) {
+    source->read = request->body_read;
+    source->rewind = request->body_rewind;
+    source->user_data = request->body_user_data;
+
+    /* No POSTFIELDS makes curl read; unknown size goes out chunked */
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, NULL);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     request->body_len > 0 ? (curl_off_t)request->body_len : (curl_off_t)-1);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, body_read_callback);
+    curl_easy_setopt(curl, CURLOPT_READDATA, source);
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, body_seek_callback);
+    curl_easy_setopt(curl, CURLOPT_SEEKDATA, source);
+}
+
+/**
+ * @return 1 if the body goes out gzip'ed
+ */
+static int set_body(CURL *curl, const arc_http_request_t *request, int copy,
+                    body_source_t *source, size_t *wire_len) {
+    if (request->body_read) {
+        set_body_source(curl, request, source);
+        *wire_len = request->body_len;
+        return 0;
+    }
+
+    /* A reused handle may still point at a streamed body's source */
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_SEEKDATA, NULL);
+
+    /* Never leave a previous request's body attached to a reused handle */
+    const char *body = request->body ? request->body : "";
+    size_t body_len = request->body_len > 0 ? request->body_len : strlen(body);
+
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    *wire_len = body_len;
+
+#ifdef ARC_HAVE_ZLIB
+    if (request->compress_body && body_len >= ARC_HTTP_COMPRESS_MIN_BYTES) {
+        size_t gz_len = 0;
+        char *gz = gzip_body(body, body_len, &gz_len);
+        int use = gz && gz_len < body_len;
+        if (use) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)gz_len);
+            curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, gz);
+            *wire_len = gz_len;
+        }
+        ARC_FREE(gz);
+        if (use) {
+            return 1;
+        }
+    }
+#endif
+
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
+    if (copy) {
+        curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, body);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+    }
+    return 0;
+}
+
+void arc_curl_apply_defaults(CURL *curl, const arc_http_client_config_t *config) {
+    arc_curl_share_attach(curl);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    /* Kernel keepalive probes keep idle pooled connections (and NAT
+     * mappings on the way) from being silently dropped */
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 15L);
+
+    /* "" = every encoding this libcurl can decode, decoded while streaming */
+    if (!config->disable_decompression) {
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    }
+
+    /* HTTP/2 via ALPN on https, HTTP/1.1 on plain http */
+    if (config->http2) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    }
+
+    if (config->ca_cert_path) {
+        curl_easy_setopt(curl, CURLOPT_CAINFO, config->ca_cert_path);
+    }
+}
+
+static int cancel_progress(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                           curl_off_t ultotal, curl_off_t ulnow) {
+    (void)dltotal;
+    (void)dlnow;
+    (void)ultotal;
+    (void)ulnow;
+    return *(const volatile int *)clientp != 0;
+}
+
+arc_err_t arc_curl_prepare(
+    CURL *curl,
+    const arc_http_client_config_t *config,
+    const arc_http_request_t *request,
+    int copy,
+    body_source_t *source,
+    struct curl_slist **headers_out
+) {
+    *headers_out = NULL;
+
+    /* Set URL */
+    curl_easy_setopt(curl, CURLOPT_URL, request->url);
+
+    /* Set method and body; HTTPGET also clears a previous POST */
+    size_t wire_len = 0;
+    int gzipped = 0;
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, NULL);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, request->method == ARC_HTTP_HEAD ? 1L : 0L);
+    switch (request->method) {
+        case ARC_HTTP_GET:
+            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+            break;
+        case ARC_HTTP_POST:
+            gzipped = set_body(curl, request, copy, source, &wire_len);
+            break;
+        case ARC_HTTP_PUT:
+            gzipped = set_body(curl, request, copy, source, &wire_len);
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+            break;
+        case ARC_HTTP_DELETE:
+            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+            break;
+        case ARC_HTTP_PATCH:
+            gzipped = set_body(curl, request, copy, source, &wire_len);
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
+            break;
+        case ARC_HTTP_HEAD:
+            break;
+    }
+
+    size_t body_len = 0;
+    if (request->method != ARC_HTTP_GET && request->method != ARC_HTTP_DELETE &&
+        request->method != ARC_HTTP_HEAD) {
+        if (request->body_read) {
+            body_len = request->body_len;
+        } else if (request->body) {
+            body_len = request->body_len > 0 ? request->body_len : strlen(request->body);
+        }
+    }
+    record_request(body_len, wire_len, gzipped);
+
+    /* Set headers: a prepared set alone is used in place */
+    const struct curl_slist *prepared = request->header_set ? request->header_set->list : NULL;
+    struct curl_slist *headers = NULL;
+
+    if (request->headers || (prepared && copy) || gzipped) {
+        int failed = 0;
+        headers = slist_copy(prepared, NULL, &failed);
+        for (const arc_http_header_t *h = request->headers; h && !failed; h = h->next) {
+            struct curl_slist *appended = slist_append_header(headers, h->name, h->value);
+            if (!appended) {
+                failed = 1;
+                break;
+            }
+            headers = appended;
+        }
+        if (gzipped && !failed) {
+            struct curl_slist *appended = curl_slist_append(headers, "Content-Encoding: gzip");
+            failed = !appended;
+            headers = appended ? appended : headers;
+        }
+        if (failed) {
+            curl_slist_free_all(headers);
+            return ARC_ERR_NO_MEMORY;
+        }
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    } else {
+        /* curl never modifies the list */
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, (struct curl_slist *)prepared);
+    }
+
+    /* Set timeout */
+    uint32_t timeout = request->timeout_ms > 0 ? request->timeout_ms : config->default_timeout_ms;
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)timeout);
+
+    /* SSL options */
+    if (request->verify_ssl == 0) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    }
+
+    /* Cancellation is polled from the progress callback */
+    if (request->cancel) {
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, cancel_progress);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *)(uintptr_t)request->cancel);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+    }
+
+    *headers_out = headers;
+    return ARC_OK;
+}
+
+/* Response headers the library consumes; others are not collected, so an
+ * ordinary response costs no header allocations. Quota headers feed the
+ * client rate limiter (src/llm/ratelimit.c). */
+static const char *const s_captured_headers[] = {
+    "Mcp-Session-Id",
+    "x-ratelimit-limit-requests",
+    "x-ratelimit-remaining-requests",
+    "x-ratelimit-reset-requests",
+    "x-ratelimit-limit-tokens",
+    "x-ratelimit-remaining-tokens",
+    "x-ratelimit-reset-tokens",
+    "anthropic-ratelimit-requests-limit",
+    "anthropic-ratelimit-requests-remaining",
+    "anthropic-ratelimit-requests-reset",
+    "anthropic-ratelimit-tokens-limit",
+    "anthropic-ratelimit-tokens-remaining",
+    "anthropic-ratelimit-tokens-reset",
+};
+
+#if LIBCURL_VERSION_NUM >= 0x073d00
+static uint32_t curl_time_us(CURL *curl, CURLINFO info) {
+    curl_off_t us = 0;
+    if (curl_easy_getinfo(curl, info, &us) != CURLE_OK || us <= 0) {
+        return 0;
+    }
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x075300
+static void capture_header(CURL *curl, const char *name, arc_http_response_t *response) {
+    struct curl_header *h = NULL;
+    if (curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &h) == CURLHE_OK) {
+        arc_http_header_append(&response->headers, arc_http_header_create(name, h->value));
+    }
+}
+#endif
+
+void arc_curl_read_status(CURL *curl, const char *const *capture, arc_http_response_t *response) {
+#if LIBCURL_VERSION_NUM >= 0x075300
+    for (size_t i = 0; i < sizeof(s_captured_headers) / sizeof(s_captured_headers[0]); i++) {
+        capture_header(curl, s_captured_headers[i], response);
+    }
+    for (size_t i = 0; capture && capture[i]; i++) {
+        capture_header(curl, capture[i], response);
+    }
+#else
+    (void)capture;
+#endif
+
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    response->status_code = (int)http_code;
+
+    response->retry_after_ms = 0;
+#if LIBCURL_VERSION_NUM >= 0x074200
+    /* Parsed from delta-seconds or an HTTP date */
+    curl_off_t retry_after = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK &&
+        retry_after > 0) {
+        response->retry_after_ms = retry_after > UINT32_MAX / 1000
+            ? UINT32_MAX : (uint32_t)retry_after * 1000;
+    }
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x073d00
+    response->timing.dns_us = curl_time_us(curl, CURLINFO_NAMELOOKUP_TIME_T);
+    response->timing.connect_us = curl_time_us(curl, CURLINFO_CONNECT_TIME_T);
+    response->timing.tls_us = curl_time_us(curl, CURLINFO_APPCONNECT_TIME_T);
+    response->timing.ttfb_us = curl_time_us(curl, CURLINFO_STARTTRANSFER_TIME_T);
+    response->timing.total_us = curl_time_us(curl, CURLINFO_TOTAL_TIME_T);
+#endif
+}
+
+arc_err_t arc_curl_map_error(CURLcode res) {
+    switch (res) {
+        case CURLE_OK:                   return ARC_OK;
+        case CURLE_OPERATION_TIMEDOUT:   return ARC_ERR_TIMEOUT;
+        case CURLE_ABORTED_BY_CALLBACK:  return ARC_ERR_CANCELLED;
+        case CURLE_COULDNT_RESOLVE_HOST: return ARC_ERR_DNS;
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_SSL_CERTPROBLEM:      return ARC_ERR_TLS;
+        default:                         return ARC_ERR_NETWORK;
+    }
+}
 
 /*============================================================================
  * Client Create/Destroy
@@ -139,22 +770,25 @@ arc_err_t arc_http_client_create(
     }
 
     /* Initialize curl globally if this is the first client */
-    arc_err_t err = curl_global_init_once();
+    arc_err_t err = arc_curl_global_acquire();
     if (err != ARC_OK) {
         return err;
     }
 
     arc_http_client_t *client = ARC_CALLOC(1, sizeof(arc_http_client_t));
     if (!client) {
-        curl_global_cleanup_once();  /* Decrement refcount on failure */
+        arc_curl_global_release();  /* Decrement refcount on failure */
         return ARC_ERR_NO_MEMORY;
     }
 
-    client->curl = curl_easy_init();
-    if (!client->curl) {
-        ARC_FREE(client);
-        curl_global_cleanup_once();  /* Decrement refcount on failure */
-        return ARC_ERR_BACKEND;
+    /* Engine-bound clients borrow the engine's handles */
+    if (!(config && config->engine)) {
+        client->curl = curl_easy_init();
+        if (!client->curl) {
+            ARC_FREE(client);
+            arc_curl_global_release();  /* Decrement refcount on failure */
+            return ARC_ERR_BACKEND;
+        }
     }
 
     /* Store config */
@@ -170,6 +804,11 @@ arc_err_t arc_http_client_create(
         client->config.max_response_size = 10 * 1024 * 1024;  /* 10MB */
     }
 
+    /* Per-handle options are set once; requests only change the rest */
+    if (client->curl) {
+        arc_curl_apply_defaults(client->curl, &client->config);
+    }
+
     *out = client;
     return ARC_OK;
 }
@@ -180,115 +819,108 @@ void arc_http_client_destroy(arc_http_client_t *client) {
     if (client->curl) {
         curl_easy_cleanup(client->curl);
     }
+    if (client->multi) {
+        curl_multi_cleanup(client->multi);
+    }
 
     ARC_FREE(client);
 
     /* Cleanup curl globally if this was the last client */
-    curl_global_cleanup_once();
+    arc_curl_global_release();
 }
 
 /*============================================================================
  * HTTP Request
  *============================================================================*/
 
-arc_err_t arc_http_request(
-    arc_http_client_t *client,
-    const arc_http_request_t *request,
-    arc_http_response_t *response
-) {
-    if (!client || !client->curl || !request || !request->url || !response) {
-        return ARC_ERR_INVALID_ARG;
+/**
+ * @brief Charge connection setup of a finished request to the connect phase
+ *
+ * Zero on a reused connection; APPCONNECT includes the TCP connect.
+ */
+static void prof_split_connect(const arc_http_response_t *response) {
+    uint64_t us = response->timing.tls_us ? response->timing.tls_us : response->timing.connect_us;
+    if (us) {
+        ac_prof_split(AC_PROF_CONNECT, us);
     }
+}
 
-    memset(response, 0, sizeof(*response));
-
+/**
+ * @brief curl_easy_perform() that notices cancel within CANCEL_POLL_MS
+ *
+ * An idle transfer calls the progress callback only about once a second.
+ * With a cancel flag the handle is driven from the client's own multi
+ * handle instead, which keeps the connections it opens for reuse.
+ */
+static CURLcode client_perform(arc_http_client_t *client, const volatile int *cancel) {
     CURL *curl = client->curl;
-    curl_easy_reset(curl);
-
-    /* Response buffer */
-    write_buffer_t buf = {0};
-    buf.data = ARC_MALLOC(4096);
-    buf.cap = 4096;
-    buf.size = 0;
-    buf.max_response_size = client->config.max_response_size;
-    if (!buf.data) {
-        return ARC_ERR_NO_MEMORY;
+    if (!cancel) {
+        return curl_easy_perform(curl);
+    }
+    if (!client->multi) {
+        client->multi = curl_multi_init();
+    }
+    if (!client->multi || curl_multi_add_handle(client->multi, curl) != CURLM_OK) {
+        return curl_easy_perform(curl);
     }
-    buf.data[0] = '\0';
-
-    /* Set URL */
-    curl_easy_setopt(curl, CURLOPT_URL, request->url);
 
-    /* Set method and body */
-    switch (request->method) {
-        case ARC_HTTP_GET:
-            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
-            break;
-        case ARC_HTTP_POST:
-            curl_easy_setopt(curl, CURLOPT_POST, 1L);
-            if (request->body) {
-                size_t body_len = request->body_len > 0 ? request->body_len : strlen(request->body);
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->body);
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
-            }
+    CURLcode res = CURLE_OK;
+    int running = 1;
+    while (running) {
+        if (*cancel) {
+            res = CURLE_ABORTED_BY_CALLBACK;
             break;
-        case ARC_HTTP_PUT:
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
-            if (request->body) {
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->body);
-            }
-            break;
-        case ARC_HTTP_DELETE:
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
-            break;
-        case ARC_HTTP_PATCH:
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
-            if (request->body) {
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->body);
-            }
+        }
+        if (curl_multi_perform(client->multi, &running) != CURLM_OK) {
+            res = CURLE_RECV_ERROR;
             break;
+        }
+        if (running) {
+            curl_multi_poll(client->multi, NULL, 0, CANCEL_POLL_MS, NULL);
+        }
     }
 
-    /* Set headers */
-    struct curl_slist *headers = NULL;
-
-    for (const arc_http_header_t *h = request->headers; h; h = h->next) {
-        size_t len = strlen(h->name) + strlen(h->value) + 3; /* +3 for ": " and \0 */
-        len = ((len / 1024 + 1) *1024); //keep 1024 align
-
-        char *header_line = ARC_MALLOC(len);
-        if (!header_line) {
-            curl_slist_free_all(headers);
-            return ARC_ERR_NO_MEMORY;
+    CURLMsg *msg;
+    int left;
+    while ((msg = curl_multi_info_read(client->multi, &left))) {
+        if (msg->msg == CURLMSG_DONE && msg->easy_handle == curl && res == CURLE_OK) {
+            res = msg->data.result;
         }
-        snprintf(header_line, len, "%s: %s", h->name, h->value);
-        headers = curl_slist_append(headers, header_line);
-        ARC_FREE(header_line);
     }
+    curl_multi_remove_handle(client->multi, curl);
+    return res;
+}
 
-    if (headers) {
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+static arc_err_t http_request_impl(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response
+) {
+    if (!client || !request || !request->url || !response) {
+        return ARC_ERR_INVALID_ARG;
     }
 
-    /* Set timeout */
-    uint32_t timeout = request->timeout_ms > 0 ? request->timeout_ms : client->config.default_timeout_ms;
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)timeout);
+    if (client->config.engine) {
+        return arc_curl_engine_request(client->config.engine, request, response);
+    }
 
-    /* SSL options */
-    if (request->verify_ssl == 0) {
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-    } else {
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    memset(response, 0, sizeof(*response));
 
-        if (client->config.ca_cert_path) {
-            curl_easy_setopt(curl, CURLOPT_CAINFO, client->config.ca_cert_path);
-        }
+    CURL *curl = client->curl;
+
+    /* Response buffer (allocated on the first chunk) */
+    write_buffer_t buf;
+    arc_curl_buffer_init(&buf, curl, client->config.max_response_size, request->sink);
+
+    struct curl_slist *headers = NULL;
+    body_source_t source;
+    arc_err_t err = arc_curl_prepare(curl, &client->config, request, 0, &source, &headers);
+    if (err != ARC_OK) {
+        return err;
     }
 
     /* Set callbacks */
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, arc_curl_write_callback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
 
     /* Perform request */
@@ -296,7 +928,8 @@ arc_err_t arc_http_request(
         request->method == ARC_HTTP_POST ? "POST" : "GET",
         request->url);
 
-    CURLcode res = curl_easy_perform(curl);
+    CURLcode res = client_perform(client, request->cancel);
+    arc_curl_record_response(curl, buf.size);
 
     /* Cleanup headers */
     if (headers) {
@@ -305,9 +938,13 @@ arc_err_t arc_http_request(
 
     if (res != CURLE_OK) {
         const char *err_msg = curl_easy_strerror(res);
-        AC_LOG_ERROR("CURL request failed: %s", err_msg);
+        if (res == CURLE_ABORTED_BY_CALLBACK) {
+            AC_LOG_DEBUG("CURL request cancelled");
+        } else {
+            AC_LOG_ERROR("CURL request failed: %s", err_msg);
+        }
 
-        ARC_FREE(buf.data);
+        arc_curl_buffer_discard(&buf);
 
         /* Check if aborted due to response size limit */
         if (buf.size_exceeded) {
@@ -316,48 +953,78 @@ arc_err_t arc_http_request(
         }
 
         response->error_msg = ARC_STRDUP(err_msg);
-
-        if (res == CURLE_OPERATION_TIMEDOUT) {
-            return ARC_ERR_TIMEOUT;
-        } else if (res == CURLE_COULDNT_RESOLVE_HOST) {
-            return ARC_ERR_DNS;
-        } else if (res == CURLE_SSL_CONNECT_ERROR || res == CURLE_SSL_CERTPROBLEM) {
-            return ARC_ERR_TLS;
-        }
-        return ARC_ERR_NETWORK;
+        return arc_curl_map_error(res);
     }
 
     /* Get response code */
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    response->status_code = (int)http_code;
+    arc_curl_read_status(curl, request->capture_headers, response);
 
     /* Set response body */
-    response->body = buf.data;
-    response->body_len = buf.size;
+    if (arc_curl_buffer_finish(&buf, response) != ARC_OK) {
+        return ARC_ERR_NO_MEMORY;
+    }
 
     AC_LOG_DEBUG("HTTP response: %d, %zu bytes", response->status_code, response->body_len);
 
     return ARC_OK;
 }
 
+/**
+ * @brief Perform the request, through the cassette when one is active
+ */
+static arc_err_t http_request_recorded(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response
+) {
+#if ARC_FEATURE_CASSETTE
+    if (arc_cassette_active()) {
+        return arc_cassette_request(client, request, response, http_request_impl);
+    }
+#endif
+    return http_request_impl(client, request, response);
+}
+
+arc_err_t arc_http_request(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response
+) {
+    ac_prof_push(AC_PROF_NETWORK);
+#if ARC_FEATURE_HTTP_FAULTS
+    arc_err_t err = arc_faults_active()
+                    ? arc_faults_request(client, request, response, http_request_recorded)
+                    : http_request_recorded(client, request, response);
+#else
+    arc_err_t err = http_request_recorded(client, request, response);
+#endif
+    if (err == ARC_OK) {
+        prof_split_connect(response);
+    }
+    ac_prof_pop();
+    return err;
+}
+
 /*============================================================================
  * Streaming HTTP Request
  *============================================================================*/
 
-arc_err_t arc_http_request_stream(
+static arc_err_t http_request_stream_impl(
     arc_http_client_t *client,
     const arc_http_stream_request_t *request,
     arc_http_response_t *response
 ) {
-    if (!client || !client->curl || !request || !request->base.url || !response) {
+    if (!client || !request || !request->base.url || !response) {
         return ARC_ERR_INVALID_ARG;
     }
 
+    if (client->config.engine) {
+        return arc_curl_engine_request_stream(client->config.engine, request, response);
+    }
+
     memset(response, 0, sizeof(*response));
 
     CURL *curl = client->curl;
-    curl_easy_reset(curl);
 
     /* Stream context */
     stream_context_t ctx = {
@@ -366,50 +1033,22 @@ arc_err_t arc_http_request_stream(
         .aborted = 0
     };
 
-    /* Set URL */
-    curl_easy_setopt(curl, CURLOPT_URL, request->base.url);
-
-    /* Set method and body */
-    if (request->base.method == ARC_HTTP_POST) {
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        if (request->base.body) {
-            size_t body_len = request->base.body_len > 0 ?
-                request->base.body_len : strlen(request->base.body);
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->base.body);
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
-        }
-    }
-
-    /* Set headers */
     struct curl_slist *headers = NULL;
-    for (const arc_http_header_t *h = request->base.headers; h; h = h->next) {
-        char header_line[1024];
-        snprintf(header_line, sizeof(header_line), "%s: %s", h->name, h->value);
-        headers = curl_slist_append(headers, header_line);
-    }
-    if (headers) {
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    }
-
-    /* Set timeout */
-    uint32_t timeout = request->base.timeout_ms > 0 ?
-        request->base.timeout_ms : client->config.default_timeout_ms;
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)timeout);
-
-    /* SSL */
-    if (request->base.verify_ssl == 0) {
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    body_source_t source;
+    arc_err_t err = arc_curl_prepare(curl, &client->config, &request->base, 0, &source, &headers);
+    if (err != ARC_OK) {
+        return err;
     }
 
     /* Streaming callback */
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, arc_curl_stream_callback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ctx);
 
     /* Perform request */
     AC_LOG_DEBUG("HTTP stream POST %s", request->base.url);
 
-    CURLcode res = curl_easy_perform(curl);
+    CURLcode res = client_perform(client, request->base.cancel);
+    arc_curl_record_response(curl, ctx.bytes);
 
     if (headers) {
         curl_slist_free_all(headers);
@@ -418,12 +1057,63 @@ arc_err_t arc_http_request_stream(
     if (res != CURLE_OK && !ctx.aborted) {
         const char *err_msg = curl_easy_strerror(res);
         response->error_msg = ARC_STRDUP(err_msg);
-        return ARC_ERR_NETWORK;
+        return arc_curl_map_error(res);
     }
 
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    response->status_code = (int)http_code;
+    arc_curl_read_status(curl, request->base.capture_headers, response);
 
     return ARC_OK;
 }
+
+static arc_err_t http_request_stream_recorded(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response
+) {
+#if ARC_FEATURE_CASSETTE
+    if (arc_cassette_active()) {
+        return arc_cassette_request_stream(client, request, response, http_request_stream_impl);
+    }
+#endif
+    return http_request_stream_impl(client, request, response);
+}
+
+/** on_data for a tapped request: the tap, then the caller's on_data */
+static int tapped_on_data(const char *data, size_t len, void *user_data) {
+    const arc_http_stream_request_t *request = (const arc_http_stream_request_t *)user_data;
+    if (request->tap(data, len, request->tap_user_data) != 0) {
+        return 1;
+    }
+    return request->on_data(data, len, request->user_data);
+}
+
+arc_err_t arc_http_request_stream(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response
+) {
+    /* Applied here, so recording, fault injection and the engine relay see one callback */
+    arc_http_stream_request_t tapped;
+    if (request && request->tap && request->on_data) {
+        tapped = *request;
+        tapped.on_data = tapped_on_data;
+        tapped.user_data = (void *)request;
+        tapped.tap = NULL;
+        request = &tapped;
+    }
+
+    ac_prof_push(AC_PROF_NETWORK);
+#if ARC_FEATURE_HTTP_FAULTS
+    arc_err_t err = arc_faults_active()
+                    ? arc_faults_request_stream(client, request, response,
+                                                http_request_stream_recorded)
+                    : http_request_stream_recorded(client, request, response);
+#else
+    arc_err_t err = http_request_stream_recorded(client, request, response);
+#endif
+    if (err == ARC_OK) {
+        prof_split_connect(response);
+    }
+    ac_prof_pop();
+    return err;
+}
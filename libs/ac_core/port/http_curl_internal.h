@@ -0,0 +1,178 @@
+/**
+ * @file http_curl_internal.h
+ * @brief Shared pieces of the libcurl backends (http_curl.c, http_curl_multi.c, ws_curl.c)
+ *
+ * NOTE: Internal to the port layer.
+ */
+
+#ifndef ARC_HTTP_CURL_INTERNAL_H
+#define ARC_HTTP_CURL_INTERNAL_H
+
+#include "http_client.h"
+#include <curl/curl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Transfer Buffers
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t size;
+    size_t cap;
+    size_t max_response_size;  /* 0 = unlimited */
+    int size_exceeded;         /* Set to 1 if response size limit exceeded */
+    CURL *curl;                /* For Content-Length on the first chunk */
+    arena_t *arena;            /* Grow in this arena instead of the heap */
+    int fixed;                 /* data/cap is a caller buffer: never grow */
+} write_buffer_t;
+
+typedef struct {
+    arc_stream_callback_t callback;
+    void *user_data;
+    arc_stream_callback_t tap;     /* Called before callback (optional) */
+    void *tap_user_data;
+    int aborted;
+    size_t bytes;              /* Delivered (decoded) bytes */
+} stream_context_t;
+
+/** Streamed request body (request->body_read); lives as long as the transfer */
+typedef struct {
+    arc_http_body_read_fn read;
+    arc_http_body_rewind_fn rewind;
+    void *user_data;
+} body_source_t;
+
+/** CURLOPT_WRITEFUNCTION collecting into a write_buffer_t */
+size_t arc_curl_write_callback(void *contents, size_t size, size_t nmemb, void *userp);
+
+/**
+ * @brief Set up a body buffer for the request's sink (nothing allocated yet)
+ */
+void arc_curl_buffer_init(
+    write_buffer_t *buf,
+    CURL *curl,
+    size_t max_response_size,
+    const arc_http_sink_t *sink
+);
+
+/**
+ * @brief Move the collected body into response (always NUL-terminated)
+ * @return ARC_OK, or ARC_ERR_NO_MEMORY for an empty body that could not
+ *         be given a terminator
+ */
+arc_err_t arc_curl_buffer_finish(write_buffer_t *buf, arc_http_response_t *response);
+
+/**
+ * @brief Drop a body that is not handed out (frees heap storage only)
+ */
+void arc_curl_buffer_discard(write_buffer_t *buf);
+
+/** CURLOPT_WRITEFUNCTION forwarding to a stream_context_t */
+size_t arc_curl_stream_callback(void *contents, size_t size, size_t nmemb, void *userp);
+
+/*============================================================================
+ * Shared Setup
+ *============================================================================*/
+
+/**
+ * @brief Reference-counted curl_global_init()/curl_global_cleanup()
+ */
+arc_err_t arc_curl_global_acquire(void);
+void arc_curl_global_release(void);
+
+/**
+ * @brief Attach the process-wide share (DNS, TLS sessions, connections)
+ *
+ * Done by arc_curl_apply_defaults(). Detach (CURLOPT_SHARE = NULL) before the
+ * handle's owner drops its global reference.
+ */
+void arc_curl_share_attach(CURL *curl);
+
+/**
+ * @brief "Name: value" lines of a prepared header set (NULL if empty)
+ */
+const struct curl_slist *arc_curl_header_set_list(const arc_http_header_set_t *set);
+
+/**
+ * @brief Apply per-handle options: share, protocol, CA (once per handle)
+ */
+void arc_curl_apply_defaults(CURL *curl, const arc_http_client_config_t *config);
+
+/**
+ * @brief Apply URL, method/body, headers, timeout and TLS verification
+ *
+ * Overwrites everything a previous request on the same handle set, so
+ * handles are reused without curl_easy_reset().
+ *
+ * @param curl         Easy handle (defaults applied)
+ * @param config       Client or engine defaults
+ * @param request      Request to apply
+ * @param copy         1 = copy body and prepared headers (request may not
+ *                     outlive the transfer), 0 = reference them
+ * @param source       Storage for a streamed body's callbacks (used when
+ *                     request->body_read is set)
+ * @param headers_out  Header list to free with curl_slist_free_all()
+ *                     after the transfer (NULL if none was built)
+ */
+arc_err_t arc_curl_prepare(
+    CURL *curl,
+    const arc_http_client_config_t *config,
+    const arc_http_request_t *request,
+    int copy,
+    body_source_t *source,
+    struct curl_slist **headers_out
+);
+
+/**
+ * @brief Add a finished transfer's response bytes to the traffic counters
+ *
+ * @param decoded  Body bytes delivered to the application
+ */
+void arc_curl_record_response(CURL *curl, size_t decoded);
+
+/**
+ * @brief Fill status_code, retry_after_ms and headers from a finished transfer
+ *
+ * @param capture  Headers the request asked for on top of the library's (may be NULL)
+ */
+void arc_curl_read_status(CURL *curl, const char *const *capture, arc_http_response_t *response);
+
+/**
+ * @brief Map a transfer result to an ArC error code
+ */
+arc_err_t arc_curl_map_error(CURLcode res);
+
+/*============================================================================
+ * Blocking Requests on an Engine
+ *============================================================================*/
+
+/**
+ * @brief arc_http_request() for clients bound to an engine
+ */
+arc_err_t arc_curl_engine_request(
+    arc_http_engine_t *engine,
+    const arc_http_request_t *request,
+    arc_http_response_t *response
+);
+
+/**
+ * @brief arc_http_request_stream() for clients bound to an engine
+ *
+ * Chunks are relayed to the calling thread, so request->on_data keeps
+ * the threading of the direct path and never stalls the I/O thread.
+ */
+arc_err_t arc_curl_engine_request_stream(
+    arc_http_engine_t *engine,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HTTP_CURL_INTERNAL_H */
@@ -0,0 +1,1445 @@
+/**
+ * @file http_curl_multi.c
+ * @brief Event-driven libcurl engine (curl_multi_socket_action)
+ *
+ * One I/O thread owns a CURLM handle and waits on epoll (Linux),
+ * kqueue (BSD/macOS) or an I/O completion port (Windows) for the sockets
+ * libcurl asks about, so hundreds of requests and SSE streams share a
+ * single thread. Other platforms fall back to curl_multi_poll().
+ *
+ * Threading:
+ * - Submit/cancel only touch the engine queue (engine->lock) and wake
+ *   the I/O thread; all CURLM calls happen on the I/O thread.
+ * - Each transfer has its own lock/cond so handles may outlive the engine.
+ * - Lock order: transfer->lock, then engine->lock. The I/O thread never
+ *   holds engine->lock while taking a transfer lock.
+ *
+ * With config.external_loop there is no I/O thread: the loop body below
+ * (engine_step) runs inside arc_http_engine_process() on the host's
+ * thread, and the epoll/kqueue descriptor is what the host waits on
+ * (on Windows the host calls arc_http_engine_process(), which waits on
+ * the completion port).
+ *
+ * A request with start_delay_ms waits in a list of delayed starts that
+ * the loop checks like a timer, so a reconnect backoff needs no thread.
+ *
+ * With config.http2 the multi handle multiplexes HTTP/2 streams and new
+ * transfers wait for an existing connection (CURLOPT_PIPEWAIT), so many
+ * concurrent requests to one origin share a few TLS connections, capped
+ * by config.max_host_connections.
+ */
+
+#include "arc/platform.h"
+#include "http_curl_internal.h"
+#include "arc/log.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__linux__)
+#define ENGINE_EPOLL 1
+#include <sys/epoll.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define ENGINE_KQUEUE 1
+#include <sys/event.h>
+#elif defined(_WIN32)
+#define ENGINE_IOCP 1
+#include <winsock2.h>
+#include <windows.h>
+#endif
+
+#if defined(ENGINE_EPOLL) || defined(ENGINE_KQUEUE)
+#define ENGINE_SOCKET_ACTION 1
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define ENGINE_MAX_EVENTS       64
+#define ENGINE_FALLBACK_WAIT_MS 1000
+#define ORIGIN_NONE             ((size_t)-1)
+
+/*============================================================================
+ * Internal Structures
+ *============================================================================*/
+
+typedef enum {
+    XFER_QUEUED = 0,                 /* Submitted, not yet on the multi handle */
+    XFER_ACTIVE,                     /* Added to the multi handle */
+    XFER_DONE
+} xfer_state_t;
+
+struct arc_http_transfer {
+    arc_http_engine_t *engine;       /* Valid until DONE */
+    CURL *easy;
+    struct curl_slist *headers;
+    int streaming;
+    write_buffer_t buf;
+    stream_context_t stream;
+    arc_http_done_fn on_done;
+    void *user_data;
+    arc_http_transfer_t *next;       /* Submit queue or active list */
+    size_t origin;                   /* Index into engine->origins */
+    long connects;                   /* New connections this transfer opened */
+    int http2;                       /* Completed over HTTP/2 */
+    body_source_t source;            /* Streamed request body */
+    const char *const *capture;      /* request->capture_headers */
+    uint64_t start_ms;               /* Delayed start (0 = at once) */
+
+    /* Guarded by lock */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    xfer_state_t state;
+    int cancel_requested;
+    int refs;                        /* Caller + engine */
+    arc_err_t result;
+    arc_http_response_t response;
+    int response_taken;
+};
+
+struct arc_http_engine {
+    CURLM *multi;
+    arc_http_client_config_t config;
+    pthread_t thread;                /* Unused with config.external_loop */
+
+    /* Guarded by lock */
+    pthread_mutex_t lock;
+    arc_http_transfer_t *submit_head;
+    arc_http_transfer_t *submit_tail;
+    int cancel_pending;
+    int shutdown;
+    arc_http_origin_stats_t *origins;
+    size_t origin_count;
+    size_t origin_cap;
+
+    /* Loop thread only (I/O thread or arc_http_engine_process caller) */
+    arc_http_transfer_t *active;
+    size_t active_count;
+    arc_http_transfer_t *delayed;    /* Submitted with a start delay, not due yet */
+
+#ifdef ENGINE_SOCKET_ACTION
+    int poll_fd;                     /* epoll or kqueue */
+    int wake_fd[2];                  /* Self-pipe */
+    long long deadline_ms;           /* libcurl timer, -1 = none */
+#endif
+#ifdef ENGINE_IOCP
+    HANDLE iocp;                     /* NULL = no socket notifications, polling */
+    volatile LONG wake_pending;      /* A wakeup packet is queued */
+    long long deadline_ms;           /* libcurl timer, -1 = none */
+#endif
+};
+
+/*============================================================================
+ * Origins
+ *============================================================================*/
+
+/**
+ * @brief Format scheme://host:port for a URL (port defaulted by scheme)
+ */
+static void origin_of(const char *url, char *out, size_t size) {
+    char *scheme = NULL, *host = NULL, *port = NULL;
+    CURLU *u = curl_url();
+
+    if (u && curl_url_set(u, CURLUPART_URL, url, 0) == CURLUE_OK) {
+        curl_url_get(u, CURLUPART_SCHEME, &scheme, 0);
+        curl_url_get(u, CURLUPART_HOST, &host, 0);
+        curl_url_get(u, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT);
+    }
+    snprintf(out, size, "%s://%s:%s",
+             scheme ? scheme : "?", host ? host : "?", port ? port : "?");
+
+    curl_free(scheme);
+    curl_free(host);
+    curl_free(port);
+    curl_url_cleanup(u);
+}
+
+/**
+ * @brief Find or add an origin slot (engine->lock held)
+ */
+static size_t origin_track(arc_http_engine_t *engine, const char *origin) {
+    for (size_t i = 0; i < engine->origin_count; i++) {
+        if (strcmp(engine->origins[i].origin, origin) == 0) {
+            return i;
+        }
+    }
+
+    if (engine->origin_count == engine->origin_cap) {
+        size_t cap = engine->origin_cap ? engine->origin_cap * 2 : 4;
+        arc_http_origin_stats_t *grown =
+            ARC_REALLOC(engine->origins, cap * sizeof(*grown));
+        if (!grown) {
+            return ORIGIN_NONE;
+        }
+        engine->origins = grown;
+        engine->origin_cap = cap;
+    }
+
+    arc_http_origin_stats_t *o = &engine->origins[engine->origin_count];
+    memset(o, 0, sizeof(*o));
+    snprintf(o->origin, sizeof(o->origin), "%s", origin);
+    return engine->origin_count++;
+}
+
+/*============================================================================
+ * Transfer Lifetime
+ *============================================================================*/
+
+static void transfer_unref(arc_http_transfer_t *t) {
+    pthread_mutex_lock(&t->lock);
+    int refs = --t->refs;
+    pthread_mutex_unlock(&t->lock);
+
+    if (refs > 0) {
+        return;
+    }
+
+    if (t->easy) {
+        curl_easy_cleanup(t->easy);
+    }
+    if (t->headers) {
+        curl_slist_free_all(t->headers);
+    }
+    arc_curl_buffer_discard(&t->buf);
+    if (!t->response_taken) {
+        arc_http_response_free(&t->response);
+    }
+    pthread_cond_destroy(&t->cond);
+    pthread_mutex_destroy(&t->lock);
+    ARC_FREE(t);
+}
+
+/**
+ * @brief Publish the result, fire on_done and drop the engine's reference
+ *
+ * I/O thread only; the easy handle is already off the multi handle.
+ */
+static void transfer_complete(arc_http_transfer_t *t, arc_err_t result) {
+    arc_http_engine_t *engine = t->engine;
+    if (engine && t->origin != ORIGIN_NONE) {
+        pthread_mutex_lock(&engine->lock);
+        arc_http_origin_stats_t *o = &engine->origins[t->origin];
+        o->active_streams--;
+        o->connections_opened += (uint64_t)t->connects;
+        o->http2_requests += t->http2 ? 1 : 0;
+        pthread_mutex_unlock(&engine->lock);
+    }
+
+    /* The handle may outlive the engine's global reference */
+    curl_easy_setopt(t->easy, CURLOPT_SHARE, NULL);
+
+    pthread_mutex_lock(&t->lock);
+    t->state = XFER_DONE;
+    t->result = result;
+    t->engine = NULL;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+
+    if (t->on_done) {
+        t->on_done(t, t->user_data);
+    }
+    transfer_unref(t);
+}
+
+/**
+ * @brief Translate a finished transfer into result + response
+ */
+static void transfer_finish(arc_http_transfer_t *t, CURLcode res) {
+    arc_http_response_t *response = &t->response;
+    arc_err_t result = ARC_OK;
+
+    arc_curl_record_response(t->easy, t->streaming ? t->stream.bytes : t->buf.size);
+
+    if (t->streaming) {
+        if (res != CURLE_OK && !t->stream.aborted) {
+            response->error_msg = ARC_STRDUP(curl_easy_strerror(res));
+            result = arc_curl_map_error(res);
+        }
+    } else if (res != CURLE_OK) {
+        if (res == CURLE_ABORTED_BY_CALLBACK) {
+            AC_LOG_DEBUG("CURL request cancelled");
+        } else {
+            AC_LOG_ERROR("CURL request failed: %s", curl_easy_strerror(res));
+        }
+        if (t->buf.size_exceeded) {
+            response->error_msg = ARC_STRDUP("Response size exceeds limit");
+            result = ARC_ERR_RESPONSE_TOO_LARGE;
+        } else {
+            response->error_msg = ARC_STRDUP(curl_easy_strerror(res));
+            result = arc_curl_map_error(res);
+        }
+    } else {
+        result = arc_curl_buffer_finish(&t->buf, response);
+    }
+
+    if (result == ARC_OK) {
+        arc_curl_read_status(t->easy, t->capture, response);
+    }
+
+    long version = 0;
+    curl_easy_getinfo(t->easy, CURLINFO_NUM_CONNECTS, &t->connects);
+    curl_easy_getinfo(t->easy, CURLINFO_HTTP_VERSION, &version);
+    t->http2 = version == CURL_HTTP_VERSION_2_0;
+
+    transfer_complete(t, result);
+}
+
+/*============================================================================
+ * Active List (I/O thread)
+ *============================================================================*/
+
+static void active_remove(arc_http_engine_t *engine, arc_http_transfer_t *t) {
+    for (arc_http_transfer_t **p = &engine->active; *p; p = &(*p)->next) {
+        if (*p == t) {
+            *p = t->next;
+            t->next = NULL;
+            engine->active_count--;
+            return;
+        }
+    }
+}
+
+static void engine_check_done(arc_http_engine_t *engine) {
+    CURLMsg *msg;
+    int left;
+
+    while ((msg = curl_multi_info_read(engine->multi, &left)) != NULL) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        arc_http_transfer_t *t = NULL;
+        CURLcode res = msg->data.result;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&t);
+        curl_multi_remove_handle(engine->multi, msg->easy_handle);
+
+        if (t) {
+            active_remove(engine, t);
+            transfer_finish(t, res);
+        }
+    }
+}
+
+/**
+ * @brief Cap a wait (ms, -1 = none) at the next delayed start
+ */
+static int engine_delayed_wait(arc_http_engine_t *engine, int wait_ms) {
+    if (!engine->delayed) {
+        return wait_ms;
+    }
+    uint64_t next = engine->delayed->start_ms;
+    for (arc_http_transfer_t *t = engine->delayed->next; t; t = t->next) {
+        if (t->start_ms < next) {
+            next = t->start_ms;
+        }
+    }
+    uint64_t now = ac_platform_timestamp_ms();
+    int left = next > now ? (int)(next - now) : 0;
+    return wait_ms < 0 || left < wait_ms ? left : wait_ms;
+}
+
+/**
+ * @brief Move submitted transfers onto the multi handle, apply cancels
+ * @return 1 if the engine is shutting down
+ */
+static int engine_drain(arc_http_engine_t *engine) {
+    pthread_mutex_lock(&engine->lock);
+    arc_http_transfer_t *list = engine->submit_head;
+    engine->submit_head = NULL;
+    engine->submit_tail = NULL;
+    int cancel = engine->cancel_pending;
+    int shutdown = engine->shutdown;
+    engine->cancel_pending = 0;
+    pthread_mutex_unlock(&engine->lock);
+
+    /* Delayed starts that are due (or cancelled) go with the submissions */
+    uint64_t now = ac_platform_timestamp_ms();
+    for (arc_http_transfer_t **p = &engine->delayed; *p;) {
+        arc_http_transfer_t *t = *p;
+        if (t->start_ms > now && !cancel && !shutdown) {
+            p = &t->next;
+            continue;
+        }
+        *p = t->next;
+        t->next = list;
+        list = t;
+    }
+
+    while (list) {
+        arc_http_transfer_t *t = list;
+        list = t->next;
+        t->next = NULL;
+
+        pthread_mutex_lock(&t->lock);
+        int cancelled = t->cancel_requested;
+        int waiting = !cancelled && !shutdown && t->start_ms > now;
+        if (!cancelled && !shutdown && !waiting) {
+            t->state = XFER_ACTIVE;
+        }
+        pthread_mutex_unlock(&t->lock);
+
+        if (cancelled || shutdown) {
+            transfer_complete(t, ARC_ERR_CANCELLED);
+            continue;
+        }
+        if (waiting) {
+            t->next = engine->delayed;
+            engine->delayed = t;
+            continue;
+        }
+
+        CURLMcode mc = curl_multi_add_handle(engine->multi, t->easy);
+        if (mc != CURLM_OK) {
+            AC_LOG_ERROR("curl_multi_add_handle failed: %s", curl_multi_strerror(mc));
+            t->response.error_msg = ARC_STRDUP(curl_multi_strerror(mc));
+            transfer_complete(t, ARC_ERR_BACKEND);
+            continue;
+        }
+
+        t->next = engine->active;
+        engine->active = t;
+        engine->active_count++;
+    }
+
+    if (cancel || shutdown) {
+        arc_http_transfer_t **p = &engine->active;
+        while (*p) {
+            arc_http_transfer_t *t = *p;
+
+            pthread_mutex_lock(&t->lock);
+            int cancelled = t->cancel_requested || shutdown;
+            pthread_mutex_unlock(&t->lock);
+
+            if (!cancelled) {
+                p = &t->next;
+                continue;
+            }
+
+            *p = t->next;
+            t->next = NULL;
+            engine->active_count--;
+            curl_multi_remove_handle(engine->multi, t->easy);
+            transfer_complete(t, ARC_ERR_CANCELLED);
+        }
+    }
+
+    return shutdown;
+}
+
+/*============================================================================
+ * Event Loop: epoll / kqueue
+ *============================================================================*/
+
+#ifdef ENGINE_SOCKET_ACTION
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int engine_timer_cb(CURLM *multi, long timeout_ms, void *userp) {
+    (void)multi;
+    arc_http_engine_t *engine = (arc_http_engine_t *)userp;
+    engine->deadline_ms = timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+    return 0;
+}
+
+static int engine_socket_cb(CURL *easy, curl_socket_t s, int what,
+                            void *userp, void *socketp) {
+    (void)easy;
+    arc_http_engine_t *engine = (arc_http_engine_t *)userp;
+
+#ifdef ENGINE_EPOLL
+    if (what == CURL_POLL_REMOVE) {
+        if (socketp) {
+            epoll_ctl(engine->poll_fd, EPOLL_CTL_DEL, s, NULL);
+            curl_multi_assign(engine->multi, s, NULL);
+        }
+        return 0;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = ((what & CURL_POLL_IN) ? EPOLLIN : 0) |
+                ((what & CURL_POLL_OUT) ? EPOLLOUT : 0);
+    ev.data.fd = s;
+
+    if (socketp) {
+        epoll_ctl(engine->poll_fd, EPOLL_CTL_MOD, s, &ev);
+    } else if (epoll_ctl(engine->poll_fd, EPOLL_CTL_ADD, s, &ev) == 0) {
+        /* Any non-NULL marker: the socket is registered */
+        curl_multi_assign(engine->multi, s, engine);
+    }
+#else
+    struct kevent ev;
+    int want_in = what != CURL_POLL_REMOVE && (what & CURL_POLL_IN);
+    int want_out = what != CURL_POLL_REMOVE && (what & CURL_POLL_OUT);
+    (void)socketp;
+
+    /* Deleting a filter that was never added fails harmlessly */
+    EV_SET(&ev, s, EVFILT_READ, want_in ? EV_ADD : EV_DELETE, 0, 0, NULL);
+    kevent(engine->poll_fd, &ev, 1, NULL, 0, NULL);
+    EV_SET(&ev, s, EVFILT_WRITE, want_out ? EV_ADD : EV_DELETE, 0, 0, NULL);
+    kevent(engine->poll_fd, &ev, 1, NULL, 0, NULL);
+#endif
+
+    return 0;
+}
+
+static void engine_wake(arc_http_engine_t *engine) {
+    char c = 1;
+    /* A full pipe already guarantees a wakeup */
+    if (write(engine->wake_fd[1], &c, 1) < 0 && errno != EAGAIN) {
+        AC_LOG_WARN("HTTP engine wakeup failed: %d", errno);
+    }
+}
+
+static void engine_drain_wake(arc_http_engine_t *engine) {
+    char buf[64];
+    while (read(engine->wake_fd[0], buf, sizeof(buf)) > 0) {
+    }
+}
+
+static void engine_action(arc_http_engine_t *engine, curl_socket_t s, int flags) {
+    int running = 0;
+    curl_multi_socket_action(engine->multi, s, flags, &running);
+}
+
+static arc_err_t engine_backend_init(arc_http_engine_t *engine) {
+    engine->deadline_ms = -1;
+    engine->wake_fd[0] = engine->wake_fd[1] = -1;
+
+#ifdef ENGINE_EPOLL
+    engine->poll_fd = epoll_create1(EPOLL_CLOEXEC);
+#else
+    engine->poll_fd = kqueue();
+#endif
+    if (engine->poll_fd < 0) {
+        AC_LOG_ERROR("HTTP engine: poll fd creation failed: %d", errno);
+        return ARC_ERR_BACKEND;
+    }
+
+    if (pipe(engine->wake_fd) != 0) {
+        AC_LOG_ERROR("HTTP engine: pipe failed: %d", errno);
+        close(engine->poll_fd);
+        return ARC_ERR_BACKEND;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(engine->wake_fd[i], F_SETFL, fcntl(engine->wake_fd[i], F_GETFL) | O_NONBLOCK);
+        fcntl(engine->wake_fd[i], F_SETFD, FD_CLOEXEC);
+    }
+
+#ifdef ENGINE_EPOLL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = engine->wake_fd[0];
+    int rc = epoll_ctl(engine->poll_fd, EPOLL_CTL_ADD, engine->wake_fd[0], &ev);
+#else
+    struct kevent ev;
+    EV_SET(&ev, engine->wake_fd[0], EVFILT_READ, EV_ADD, 0, 0, NULL);
+    int rc = kevent(engine->poll_fd, &ev, 1, NULL, 0, NULL);
+#endif
+    if (rc != 0) {
+        AC_LOG_ERROR("HTTP engine: cannot watch wake pipe: %d", errno);
+        close(engine->wake_fd[0]);
+        close(engine->wake_fd[1]);
+        close(engine->poll_fd);
+        return ARC_ERR_BACKEND;
+    }
+
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETFUNCTION, engine_socket_cb);
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETDATA, engine);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERFUNCTION, engine_timer_cb);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERDATA, engine);
+    return ARC_OK;
+}
+
+static void engine_backend_cleanup(arc_http_engine_t *engine) {
+    close(engine->wake_fd[0]);
+    close(engine->wake_fd[1]);
+    close(engine->poll_fd);
+}
+
+static int engine_timeout(arc_http_engine_t *engine) {
+    if (engine->deadline_ms < 0) {
+        return engine_delayed_wait(engine, -1);
+    }
+    long long left = engine->deadline_ms - now_ms();
+    return engine_delayed_wait(engine, left > 0 ? (int)left : 0);
+}
+
+/**
+ * @brief One loop round: wait (at most max_wait_ms, -1 = no cap), act
+ * @return 1 once the engine has shut down
+ */
+static int engine_step(arc_http_engine_t *engine, int max_wait_ms) {
+    int wait_ms = engine_timeout(engine);
+    if (max_wait_ms >= 0 && (wait_ms < 0 || wait_ms > max_wait_ms)) {
+        wait_ms = max_wait_ms;
+    }
+
+#ifdef ENGINE_EPOLL
+    struct epoll_event events[ENGINE_MAX_EVENTS];
+    int n = epoll_wait(engine->poll_fd, events, ENGINE_MAX_EVENTS, wait_ms);
+#else
+    struct kevent events[ENGINE_MAX_EVENTS];
+    struct timespec ts = { wait_ms / 1000, (long)(wait_ms % 1000) * 1000000L };
+    int n = kevent(engine->poll_fd, NULL, 0, events, ENGINE_MAX_EVENTS,
+                   wait_ms < 0 ? NULL : &ts);
+#endif
+    if (n < 0 && errno != EINTR) {
+        AC_LOG_ERROR("HTTP engine wait failed: %d", errno);
+        n = 0;
+    }
+
+    for (int i = 0; i < n; i++) {
+#ifdef ENGINE_EPOLL
+        int fd = events[i].data.fd;
+        int flags = ((events[i].events & EPOLLIN) ? CURL_CSELECT_IN : 0) |
+                    ((events[i].events & EPOLLOUT) ? CURL_CSELECT_OUT : 0) |
+                    ((events[i].events & (EPOLLERR | EPOLLHUP)) ? CURL_CSELECT_ERR : 0);
+#else
+        int fd = (int)events[i].ident;
+        int flags = (events[i].filter == EVFILT_READ ? CURL_CSELECT_IN : 0) |
+                    (events[i].filter == EVFILT_WRITE ? CURL_CSELECT_OUT : 0) |
+                    ((events[i].flags & EV_ERROR) ? CURL_CSELECT_ERR : 0);
+#endif
+        if (fd == engine->wake_fd[0]) {
+            engine_drain_wake(engine);
+        } else {
+            engine_action(engine, fd, flags);
+        }
+    }
+
+    if (engine->deadline_ms >= 0 && now_ms() >= engine->deadline_ms) {
+        engine->deadline_ms = -1;
+        engine_action(engine, CURL_SOCKET_TIMEOUT, 0);
+    }
+
+    engine_check_done(engine);
+    return engine_drain(engine);
+}
+
+static int engine_fd(arc_http_engine_t *engine) {
+    return engine->poll_fd;
+}
+
+#else /* !ENGINE_SOCKET_ACTION */
+
+/*============================================================================
+ * Event Loop: curl_multi_poll fallback
+ *============================================================================*/
+
+static void poll_wake(arc_http_engine_t *engine) {
+    curl_multi_wakeup(engine->multi);
+}
+
+static int poll_timeout(arc_http_engine_t *engine) {
+    long ms = -1;
+    curl_multi_timeout(engine->multi, &ms);
+    return engine_delayed_wait(engine, ms < 0 ? -1 : (int)ms);
+}
+
+static int poll_step(arc_http_engine_t *engine, int max_wait_ms) {
+    int running = 0;
+    curl_multi_perform(engine->multi, &running);
+    engine_check_done(engine);
+    if (engine_drain(engine)) {
+        return 1;
+    }
+    int wait_ms = max_wait_ms >= 0 && max_wait_ms < ENGINE_FALLBACK_WAIT_MS ?
+        max_wait_ms : ENGINE_FALLBACK_WAIT_MS;
+    wait_ms = engine_delayed_wait(engine, wait_ms);
+    curl_multi_poll(engine->multi, NULL, 0, wait_ms, NULL);
+    return 0;
+}
+
+#ifdef ENGINE_IOCP
+
+/*============================================================================
+ * Event Loop: I/O completion port (Windows)
+ *
+ * ProcessSocketNotifications() (Windows 11, Server 2022) queues socket
+ * readiness on a completion port, which makes it the Windows counterpart
+ * of epoll: one wait covers every socket libcurl asks about and the
+ * wakeups other threads post. It is looked up at run time; older systems
+ * keep the curl_multi_poll() loop.
+ *============================================================================*/
+
+#ifndef SOCK_NOTIFY_OP_ENABLE
+/* Declared by Windows SDK 10.0.22000 and later */
+typedef struct SOCK_NOTIFY_REGISTRATION {
+    SOCKET socket;
+    PVOID completionKey;
+    UINT16 eventFilter;
+    UINT8 operation;
+    UINT8 triggerFlags;
+    DWORD registrationResult;
+} SOCK_NOTIFY_REGISTRATION;
+
+#define SOCK_NOTIFY_REGISTER_EVENT_IN       0x01
+#define SOCK_NOTIFY_REGISTER_EVENT_OUT      0x02
+#define SOCK_NOTIFY_REGISTER_EVENT_HANGUP   0x04
+#define SOCK_NOTIFY_EVENT_IN                SOCK_NOTIFY_REGISTER_EVENT_IN
+#define SOCK_NOTIFY_EVENT_OUT               SOCK_NOTIFY_REGISTER_EVENT_OUT
+#define SOCK_NOTIFY_EVENT_HANGUP            SOCK_NOTIFY_REGISTER_EVENT_HANGUP
+#define SOCK_NOTIFY_EVENT_ERR               0x40
+#define SOCK_NOTIFY_EVENT_REMOVE            0x80
+#define SOCK_NOTIFY_OP_ENABLE               0x01
+#define SOCK_NOTIFY_OP_REMOVE               0x04
+#define SOCK_NOTIFY_TRIGGER_PERSISTENT      0x02
+#define SOCK_NOTIFY_TRIGGER_LEVEL           0x04
+#define SocketNotificationRetrieveEvents(entry) ((UINT32)(entry)->dwNumberOfBytesTransferred)
+#endif
+
+typedef DWORD (WSAAPI *process_notifications_fn)(
+    HANDLE port, UINT32 count, SOCK_NOTIFY_REGISTRATION *registrations,
+    UINT32 timeout_ms, ULONG max_entries, OVERLAPPED_ENTRY *entries, UINT32 *received);
+
+static pthread_once_t s_notify_once = PTHREAD_ONCE_INIT;
+static process_notifications_fn s_process_notifications;
+
+/** Completion key of wakeup packets: no socket has this value */
+#define ENGINE_WAKE_KEY ((ULONG_PTR)INVALID_SOCKET)
+
+static void notify_lookup(void) {
+    HMODULE ws2 = GetModuleHandleA("ws2_32.dll");
+    if (ws2) {
+        s_process_notifications = (process_notifications_fn)(void (*)(void))
+            GetProcAddress(ws2, "ProcessSocketNotifications");
+    }
+}
+
+static long long now_ms(void) {
+    return (long long)GetTickCount64();
+}
+
+static int engine_timer_cb(CURLM *multi, long timeout_ms, void *userp) {
+    (void)multi;
+    arc_http_engine_t *engine = (arc_http_engine_t *)userp;
+    engine->deadline_ms = timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+    return 0;
+}
+
+static int engine_socket_cb(CURL *easy, curl_socket_t s, int what,
+                            void *userp, void *socketp) {
+    (void)easy;
+    arc_http_engine_t *engine = (arc_http_engine_t *)userp;
+    SOCK_NOTIFY_REGISTRATION reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.socket = s;
+    reg.completionKey = (PVOID)(ULONG_PTR)s;
+
+    if (what == CURL_POLL_REMOVE) {
+        if (!socketp) {
+            return 0;
+        }
+        reg.operation = SOCK_NOTIFY_OP_REMOVE;
+        curl_multi_assign(engine->multi, s, NULL);
+    } else {
+        /* Enabling a registered socket replaces its filter */
+        reg.operation = SOCK_NOTIFY_OP_ENABLE;
+        reg.triggerFlags = SOCK_NOTIFY_TRIGGER_PERSISTENT | SOCK_NOTIFY_TRIGGER_LEVEL;
+        reg.eventFilter = SOCK_NOTIFY_REGISTER_EVENT_HANGUP |
+                          ((what & CURL_POLL_IN) ? SOCK_NOTIFY_REGISTER_EVENT_IN : 0) |
+                          ((what & CURL_POLL_OUT) ? SOCK_NOTIFY_REGISTER_EVENT_OUT : 0);
+    }
+
+    DWORD rc = s_process_notifications(engine->iocp, 1, &reg, 0, 0, NULL, NULL);
+    if (rc != ERROR_SUCCESS) {
+        AC_LOG_WARN("HTTP engine: socket notification update failed: %lu",
+                    (unsigned long)reg.registrationResult);
+    } else if (what != CURL_POLL_REMOVE && !socketp) {
+        /* Any non-NULL marker: the socket is registered */
+        curl_multi_assign(engine->multi, s, engine);
+    }
+    return 0;
+}
+
+static void engine_wake(arc_http_engine_t *engine) {
+    if (!engine->iocp) {
+        poll_wake(engine);
+        return;
+    }
+    /* One queued packet wakes the loop however many threads ask */
+    if (InterlockedExchange(&engine->wake_pending, 1) == 0 &&
+        !PostQueuedCompletionStatus(engine->iocp, 0, ENGINE_WAKE_KEY, NULL)) {
+        engine->wake_pending = 0;
+        AC_LOG_WARN("HTTP engine wakeup failed: %lu", (unsigned long)GetLastError());
+    }
+}
+
+static void engine_action(arc_http_engine_t *engine, curl_socket_t s, int flags) {
+    int running = 0;
+    curl_multi_socket_action(engine->multi, s, flags, &running);
+}
+
+static arc_err_t engine_backend_init(arc_http_engine_t *engine) {
+    engine->deadline_ms = -1;
+
+    pthread_once(&s_notify_once, notify_lookup);
+    if (s_process_notifications) {
+        engine->iocp = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+        if (!engine->iocp) {
+            AC_LOG_WARN("HTTP engine: completion port creation failed: %lu",
+                        (unsigned long)GetLastError());
+        }
+    }
+    if (!engine->iocp) {
+        AC_LOG_DEBUG("HTTP engine: no socket notifications, using curl_multi_poll");
+        return ARC_OK;
+    }
+
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETFUNCTION, engine_socket_cb);
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETDATA, engine);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERFUNCTION, engine_timer_cb);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERDATA, engine);
+    return ARC_OK;
+}
+
+static void engine_backend_cleanup(arc_http_engine_t *engine) {
+    if (engine->iocp) {
+        CloseHandle(engine->iocp);
+    }
+}
+
+static int engine_timeout(arc_http_engine_t *engine) {
+    if (!engine->iocp) {
+        return poll_timeout(engine);
+    }
+    if (engine->deadline_ms < 0) {
+        return engine_delayed_wait(engine, -1);
+    }
+    long long left = engine->deadline_ms - now_ms();
+    return engine_delayed_wait(engine, left > 0 ? (int)left : 0);
+}
+
+static int engine_step(arc_http_engine_t *engine, int max_wait_ms) {
+    if (!engine->iocp) {
+        return poll_step(engine, max_wait_ms);
+    }
+
+    int wait_ms = engine_timeout(engine);
+    if (max_wait_ms >= 0 && (wait_ms < 0 || wait_ms > max_wait_ms)) {
+        wait_ms = max_wait_ms;
+    }
+
+    OVERLAPPED_ENTRY entries[ENGINE_MAX_EVENTS];
+    UINT32 n = 0;
+    DWORD rc = s_process_notifications(engine->iocp, 0, NULL,
+                                       wait_ms < 0 ? INFINITE : (UINT32)wait_ms,
+                                       ENGINE_MAX_EVENTS, entries, &n);
+    if (rc != ERROR_SUCCESS && rc != WAIT_TIMEOUT) {
+        AC_LOG_ERROR("HTTP engine wait failed: %lu", (unsigned long)rc);
+        n = 0;
+    }
+
+    for (UINT32 i = 0; i < n; i++) {
+        if (entries[i].lpCompletionKey == ENGINE_WAKE_KEY) {
+            engine->wake_pending = 0;    /* engine_drain below sees what it was for */
+            continue;
+        }
+        UINT32 events = SocketNotificationRetrieveEvents(&entries[i]);
+        if (events & SOCK_NOTIFY_EVENT_REMOVE) {
+            continue;
+        }
+        /* A hang-up is read as end of stream, like EPOLLHUP with EPOLLIN */
+        int flags = ((events & (SOCK_NOTIFY_EVENT_IN | SOCK_NOTIFY_EVENT_HANGUP)) ? CURL_CSELECT_IN : 0) |
+                    ((events & SOCK_NOTIFY_EVENT_OUT) ? CURL_CSELECT_OUT : 0) |
+                    ((events & SOCK_NOTIFY_EVENT_ERR) ? CURL_CSELECT_ERR : 0);
+        engine_action(engine, (curl_socket_t)entries[i].lpCompletionKey, flags);
+    }
+
+    if (engine->deadline_ms >= 0 && now_ms() >= engine->deadline_ms) {
+        engine->deadline_ms = -1;
+        engine_action(engine, CURL_SOCKET_TIMEOUT, 0);
+    }
+
+    engine_check_done(engine);
+    return engine_drain(engine);
+}
+
+#else /* !ENGINE_IOCP */
+
+static void engine_wake(arc_http_engine_t *engine) {
+    poll_wake(engine);
+}
+
+static arc_err_t engine_backend_init(arc_http_engine_t *engine) {
+    (void)engine;
+    return ARC_OK;
+}
+
+static void engine_backend_cleanup(arc_http_engine_t *engine) {
+    (void)engine;
+}
+
+static int engine_timeout(arc_http_engine_t *engine) {
+    return poll_timeout(engine);
+}
+
+static int engine_step(arc_http_engine_t *engine, int max_wait_ms) {
+    return poll_step(engine, max_wait_ms);
+}
+
+#endif /* ENGINE_IOCP */
+
+/* No descriptor to hand out: a completion port is not one */
+static int engine_fd(arc_http_engine_t *engine) {
+    (void)engine;
+    return -1;
+}
+
+#endif /* ENGINE_SOCKET_ACTION */
+
+static void *engine_thread(void *arg) {
+    arc_http_engine_t *engine = (arc_http_engine_t *)arg;
+    if (engine->config.affinity) {
+        ac_affinity_apply(engine->config.affinity, 0);
+    }
+    while (!engine_step(engine, -1)) {
+    }
+    return NULL;
+}
+
+/*============================================================================
+ * Engine Create/Destroy
+ *============================================================================*/
+
+arc_err_t arc_http_engine_create(
+    const arc_http_client_config_t *config,
+    arc_http_engine_t **out
+) {
+    if (!out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    arc_err_t err = arc_curl_global_acquire();
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    arc_http_engine_t *engine = ARC_CALLOC(1, sizeof(arc_http_engine_t));
+    if (!engine) {
+        arc_curl_global_release();
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    if (config) {
+        engine->config = *config;
+    }
+    if (engine->config.default_timeout_ms == 0) {
+        engine->config.default_timeout_ms = 30000;
+    }
+    if (engine->config.max_response_size == 0) {
+        engine->config.max_response_size = 10 * 1024 * 1024;  /* 10MB */
+    }
+    engine->config.engine = NULL;
+
+    engine->multi = curl_multi_init();
+    if (!engine->multi) {
+        ARC_FREE(engine);
+        arc_curl_global_release();
+        return ARC_ERR_BACKEND;
+    }
+
+    if (engine->config.http2) {
+        curl_multi_setopt(engine->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    }
+    if (engine->config.max_host_connections > 0) {
+        curl_multi_setopt(engine->multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                          (long)engine->config.max_host_connections);
+    }
+
+    err = engine_backend_init(engine);
+    if (err != ARC_OK) {
+        curl_multi_cleanup(engine->multi);
+        ARC_FREE(engine);
+        arc_curl_global_release();
+        return err;
+    }
+
+    pthread_mutex_init(&engine->lock, NULL);
+
+    if (engine->config.external_loop) {
+        AC_LOG_DEBUG("HTTP engine started (external loop, fd=%d)", engine_fd(engine));
+        *out = engine;
+        return ARC_OK;
+    }
+
+    if (pthread_create(&engine->thread, NULL, engine_thread, engine) != 0) {
+        AC_LOG_ERROR("HTTP engine: failed to start I/O thread");
+        pthread_mutex_destroy(&engine->lock);
+        engine_backend_cleanup(engine);
+        curl_multi_cleanup(engine->multi);
+        ARC_FREE(engine);
+        arc_curl_global_release();
+        return ARC_ERR_BACKEND;
+    }
+
+    AC_LOG_DEBUG("HTTP engine started");
+    *out = engine;
+    return ARC_OK;
+}
+
+void arc_http_engine_destroy(arc_http_engine_t *engine) {
+    if (!engine) {
+        return;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    engine->shutdown = 1;
+    pthread_mutex_unlock(&engine->lock);
+    engine_wake(engine);
+
+    /* The loop cancels everything still queued or active */
+    if (engine->config.external_loop) {
+        while (!engine_step(engine, 0)) {
+        }
+    } else {
+        pthread_join(engine->thread, NULL);
+    }
+
+    engine_backend_cleanup(engine);
+    curl_multi_cleanup(engine->multi);
+    pthread_mutex_destroy(&engine->lock);
+    ARC_FREE(engine->origins);
+    ARC_FREE(engine);
+
+    arc_curl_global_release();
+    AC_LOG_DEBUG("HTTP engine stopped");
+}
+
+int arc_http_engine_fd(arc_http_engine_t *engine) {
+    return engine && engine->config.external_loop ? engine_fd(engine) : -1;
+}
+
+int arc_http_engine_timeout(arc_http_engine_t *engine) {
+    return engine && engine->config.external_loop ? engine_timeout(engine) : -1;
+}
+
+arc_err_t arc_http_engine_process(arc_http_engine_t *engine, int timeout_ms) {
+    if (!engine) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (!engine->config.external_loop) {
+        return ARC_ERR_INVALID_STATE;
+    }
+    engine_step(engine, timeout_ms);
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Submission
+ *============================================================================*/
+
+static arc_err_t engine_submit(
+    arc_http_engine_t *engine,
+    const arc_http_request_t *request,
+    const arc_http_stream_request_t *stream,
+    arc_http_done_fn on_done,
+    void *user_data,
+    arc_http_transfer_t **out
+) {
+    arc_http_transfer_t *t = ARC_CALLOC(1, sizeof(arc_http_transfer_t));
+    if (!t) {
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    t->easy = curl_easy_init();
+    if (!t->easy) {
+        ARC_FREE(t);
+        return ARC_ERR_BACKEND;
+    }
+
+    arc_curl_apply_defaults(t->easy, &engine->config);
+    arc_err_t err = arc_curl_prepare(t->easy, &engine->config, request, 1, &t->source, &t->headers);
+    if (err != ARC_OK) {
+        curl_easy_cleanup(t->easy);
+        ARC_FREE(t);
+        return err;
+    }
+
+    if (stream) {
+        t->streaming = 1;
+        t->stream.callback = stream->on_data;
+        t->stream.user_data = stream->user_data;
+        t->stream.tap = stream->tap;
+        t->stream.tap_user_data = stream->tap_user_data;
+        curl_easy_setopt(t->easy, CURLOPT_WRITEFUNCTION, arc_curl_stream_callback);
+        curl_easy_setopt(t->easy, CURLOPT_WRITEDATA, &t->stream);
+    } else {
+        arc_curl_buffer_init(&t->buf, t->easy, engine->config.max_response_size, request->sink);
+        curl_easy_setopt(t->easy, CURLOPT_WRITEFUNCTION, arc_curl_write_callback);
+        curl_easy_setopt(t->easy, CURLOPT_WRITEDATA, &t->buf);
+    }
+
+    curl_easy_setopt(t->easy, CURLOPT_PRIVATE, (char *)t);
+    /* Prefer a new stream on a live connection over a new connection.
+     * Only TLS origins can negotiate h2 here, and waiting on a cleartext
+     * HTTP/1.1 connection would queue behind its in-flight request. */
+    int tls = request->url && strncmp(request->url, "https://", 8) == 0;
+    curl_easy_setopt(t->easy, CURLOPT_PIPEWAIT, engine->config.http2 && tls ? 1L : 0L);
+
+    char origin[ARC_HTTP_ORIGIN_MAX];
+    origin_of(request->url, origin, sizeof(origin));
+    t->origin = ORIGIN_NONE;
+
+    t->engine = engine;
+    t->capture = request->capture_headers;
+    t->start_ms = request->start_delay_ms ?
+        ac_platform_timestamp_ms() + request->start_delay_ms : 0;
+    t->on_done = on_done;
+    t->user_data = user_data;
+    t->state = XFER_QUEUED;
+    t->refs = 2;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->cond, NULL);
+
+    pthread_mutex_lock(&engine->lock);
+    int shutdown = engine->shutdown;
+    if (!shutdown) {
+        t->origin = origin_track(engine, origin);
+        if (t->origin != ORIGIN_NONE) {
+            engine->origins[t->origin].active_streams++;
+            engine->origins[t->origin].total_requests++;
+        }
+        if (engine->submit_tail) {
+            engine->submit_tail->next = t;
+        } else {
+            engine->submit_head = t;
+        }
+        engine->submit_tail = t;
+    }
+    pthread_mutex_unlock(&engine->lock);
+
+    if (shutdown) {
+        t->refs = 1;
+        transfer_unref(t);
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    engine_wake(engine);
+
+    AC_LOG_DEBUG("HTTP %s queued: %s", stream ? "stream" : "request", request->url);
+    *out = t;
+    return ARC_OK;
+}
+
+arc_err_t arc_http_submit(
+    arc_http_engine_t *engine,
+    const arc_http_request_t *request,
+    arc_http_done_fn on_done,
+    void *user_data,
+    arc_http_transfer_t **out
+) {
+    if (!engine || !request || !request->url || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    return engine_submit(engine, request, NULL, on_done, user_data, out);
+}
+
+arc_err_t arc_http_submit_stream(
+    arc_http_engine_t *engine,
+    const arc_http_stream_request_t *request,
+    arc_http_done_fn on_done,
+    void *user_data,
+    arc_http_transfer_t **out
+) {
+    if (!engine || !request || !request->base.url || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    return engine_submit(engine, &request->base, request, on_done, user_data, out);
+}
+
+/*============================================================================
+ * Completion
+ *============================================================================*/
+
+int arc_http_transfer_poll(arc_http_transfer_t *transfer) {
+    if (!transfer) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&transfer->lock);
+    int done = transfer->state == XFER_DONE;
+    pthread_mutex_unlock(&transfer->lock);
+    return done;
+}
+
+arc_err_t arc_http_transfer_wait(
+    arc_http_transfer_t *transfer,
+    arc_http_response_t *response
+) {
+    if (!transfer) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&transfer->lock);
+    while (transfer->state != XFER_DONE) {
+        pthread_cond_wait(&transfer->cond, &transfer->lock);
+    }
+
+    arc_err_t result = transfer->result;
+    if (response) {
+        if (transfer->response_taken) {
+            memset(response, 0, sizeof(*response));
+        } else {
+            *response = transfer->response;
+            memset(&transfer->response, 0, sizeof(transfer->response));
+            transfer->response_taken = 1;
+        }
+    }
+    pthread_mutex_unlock(&transfer->lock);
+
+    return result;
+}
+
+void arc_http_transfer_cancel(arc_http_transfer_t *transfer) {
+    if (!transfer) {
+        return;
+    }
+
+    /* Holding the transfer lock keeps the engine alive until we are done */
+    pthread_mutex_lock(&transfer->lock);
+    arc_http_engine_t *engine = transfer->engine;
+    if (transfer->state != XFER_DONE && !transfer->cancel_requested && engine) {
+        transfer->cancel_requested = 1;
+
+        pthread_mutex_lock(&engine->lock);
+        engine->cancel_pending = 1;
+        pthread_mutex_unlock(&engine->lock);
+        engine_wake(engine);
+    }
+    pthread_mutex_unlock(&transfer->lock);
+}
+
+void arc_http_transfer_release(arc_http_transfer_t *transfer) {
+    if (transfer) {
+        transfer_unref(transfer);
+    }
+}
+
+/*============================================================================
+ * Statistics
+ *============================================================================*/
+
+size_t arc_http_engine_origin_stats(
+    arc_http_engine_t *engine,
+    arc_http_origin_stats_t *out,
+    size_t max
+) {
+    if (!engine) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    size_t count = engine->origin_count;
+    if (out) {
+        memcpy(out, engine->origins, (count < max ? count : max) * sizeof(*out));
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return count;
+}
+
+/*============================================================================
+ * Blocking Requests on an Engine
+ *============================================================================*/
+
+typedef struct relay_chunk {
+    struct relay_chunk *next;
+    size_t len;
+    char data[];
+} relay_chunk_t;
+
+/**
+ * @brief Hand-off between the I/O thread and a blocked caller
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    relay_chunk_t *head;
+    relay_chunk_t *tail;
+    int done;
+    int aborted;                     /* Caller's on_data asked to stop */
+} relay_t;
+
+static int relay_on_data(const char *data, size_t len, void *user_data) {
+    relay_t *relay = (relay_t *)user_data;
+
+    relay_chunk_t *chunk = ARC_MALLOC(sizeof(relay_chunk_t) + len);
+    if (!chunk) {
+        return 1;
+    }
+    chunk->next = NULL;
+    chunk->len = len;
+    memcpy(chunk->data, data, len);
+
+    pthread_mutex_lock(&relay->lock);
+    int aborted = relay->aborted;
+    if (!aborted) {
+        if (relay->tail) {
+            relay->tail->next = chunk;
+        } else {
+            relay->head = chunk;
+        }
+        relay->tail = chunk;
+        pthread_cond_signal(&relay->cond);
+    }
+    pthread_mutex_unlock(&relay->lock);
+
+    if (aborted) {
+        ARC_FREE(chunk);
+    }
+    return aborted;
+}
+
+/** How often blocking waits look at request->cancel */
+#define CANCEL_POLL_MS 20
+
+static void cond_wait_ms(pthread_cond_t *cond, pthread_mutex_t *lock, uint32_t ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t ns = (uint64_t)ts.tv_nsec + (uint64_t)ms * 1000000;
+    ts.tv_sec += ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    pthread_cond_timedwait(cond, lock, &ts);
+}
+
+/**
+ * @brief Wait for completion, forwarding *cancel to arc_http_transfer_cancel()
+ *
+ * The I/O thread only runs progress callbacks on socket activity, so an
+ * idle transfer would not notice the flag by itself.
+ */
+static void wait_cancellable(arc_http_transfer_t *t, const volatile int *cancel) {
+    pthread_mutex_lock(&t->lock);
+    while (t->state != XFER_DONE && !*cancel) {
+        cond_wait_ms(&t->cond, &t->lock, CANCEL_POLL_MS);
+    }
+    int pending = t->state != XFER_DONE;
+    pthread_mutex_unlock(&t->lock);
+
+    if (pending) {
+        arc_http_transfer_cancel(t);
+    }
+}
+
+static void relay_on_done(arc_http_transfer_t *transfer, void *user_data) {
+    (void)transfer;
+    relay_t *relay = (relay_t *)user_data;
+
+    pthread_mutex_lock(&relay->lock);
+    relay->done = 1;
+    pthread_cond_signal(&relay->cond);
+    pthread_mutex_unlock(&relay->lock);
+}
+
+arc_err_t arc_curl_engine_request(
+    arc_http_engine_t *engine,
+    const arc_http_request_t *request,
+    arc_http_response_t *response
+) {
+    memset(response, 0, sizeof(*response));
+
+    arc_http_transfer_t *t = NULL;
+    arc_err_t err = arc_http_submit(engine, request, NULL, NULL, &t);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    if (request->cancel) {
+        wait_cancellable(t, request->cancel);
+    }
+
+    err = arc_http_transfer_wait(t, response);
+    arc_http_transfer_release(t);
+    return err;
+}
+
+arc_err_t arc_curl_engine_request_stream(
+    arc_http_engine_t *engine,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response
+) {
+    memset(response, 0, sizeof(*response));
+
+    relay_t relay;
+    memset(&relay, 0, sizeof(relay));
+    pthread_mutex_init(&relay.lock, NULL);
+    pthread_cond_init(&relay.cond, NULL);
+
+    arc_http_stream_request_t inner = *request;
+    inner.on_data = relay_on_data;
+    inner.user_data = &relay;
+
+    arc_http_transfer_t *t = NULL;
+    arc_err_t err = arc_http_submit_stream(engine, &inner, relay_on_done, &relay, &t);
+    if (err != ARC_OK) {
+        pthread_cond_destroy(&relay.cond);
+        pthread_mutex_destroy(&relay.lock);
+        return err;
+    }
+
+    const volatile int *cancel = request->base.cancel;
+    int aborted = 0;
+    int cancel_sent = 0;
+    for (;;) {
+        pthread_mutex_lock(&relay.lock);
+        while (!relay.head && !relay.done) {
+            if (!cancel) {
+                pthread_cond_wait(&relay.cond, &relay.lock);
+            } else if (*cancel && !cancel_sent) {
+                pthread_mutex_unlock(&relay.lock);
+                arc_http_transfer_cancel(t);
+                cancel_sent = 1;
+                pthread_mutex_lock(&relay.lock);
+            } else {
+                cond_wait_ms(&relay.cond, &relay.lock, CANCEL_POLL_MS);
+            }
+        }
+        relay_chunk_t *chunks = relay.head;
+        relay.head = relay.tail = NULL;
+        int done = relay.done;
+        pthread_mutex_unlock(&relay.lock);
+
+        while (chunks) {
+            relay_chunk_t *chunk = chunks;
+            chunks = chunk->next;
+            if (!aborted && request->on_data &&
+                request->on_data(chunk->data, chunk->len, request->user_data) != 0) {
+                aborted = 1;
+                pthread_mutex_lock(&relay.lock);
+                relay.aborted = 1;
+                pthread_mutex_unlock(&relay.lock);
+                arc_http_transfer_cancel(t);
+            }
+            ARC_FREE(chunk);
+        }
+
+        if (done) {
+            break;
+        }
+    }
+
+    err = arc_http_transfer_wait(t, response);
+    arc_http_transfer_release(t);
+
+    pthread_cond_destroy(&relay.cond);
+    pthread_mutex_destroy(&relay.lock);
+
+    /* Same as the direct path: stopping from on_data is not an error */
+    if (aborted && (err == ARC_ERR_CANCELLED || err == ARC_OK)) {
+        return ARC_OK;
+    }
+    return err;
+}
@@ -0,0 +1,443 @@
+/**
+ * @file http_fault_shim.c
+ * @brief Network fault and latency injection (see arc/http_faults.h)
+ *
+ * Every matched request draws its faults up front from a per-request
+ * random sequence (seed and request number), then runs in this order:
+ * latency and jitter, an injected error answer (the request is not
+ * sent), the upload at the bandwidth cap, the transfer, and the
+ * download at the cap. Streamed bodies are paced piece by piece and cut
+ * where the draw says; non-streamed ones are paced after the transfer.
+ */
+
+#include "http_fault_shim.h"
+#include "arc/http_faults.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FAULTS_ENV               "ARC_HTTP_FAULTS"
+#define FAULTS_DISCONNECT_BYTES  4096
+#define FAULTS_ERROR_STATUS      503
+#define FAULTS_RETRY_AFTER_MS    1000
+
+enum {
+    FAULTS_UNCHECKED = 0,            /* ARC_HTTP_FAULTS not looked at yet */
+    FAULTS_OFF,
+    FAULTS_ON
+};
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+static struct {
+    atomic_int state;
+    pthread_mutex_t lock;
+    ac_http_faults_config_t config;
+    atomic_uint_least64_t sequence;  /* Requests matched, numbers the draws */
+    atomic_uint_least64_t errors;
+    atomic_uint_least64_t disconnects;
+    atomic_uint_least64_t delay_ms;
+} s_faults = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void faults_load_env(void) {
+    pthread_mutex_lock(&s_faults.lock);
+    if (atomic_load(&s_faults.state) == FAULTS_UNCHECKED) {
+        const char *spec = getenv(FAULTS_ENV);
+        int on = 0;
+        if (spec && *spec) {
+            memset(&s_faults.config, 0, sizeof(s_faults.config));
+            on = ac_http_faults_parse(spec, &s_faults.config) == ARC_OK;
+            if (on) {
+                AC_LOG_WARN("HTTP fault injection on (%s=%s)", FAULTS_ENV, spec);
+            } else {
+                AC_LOG_ERROR("Ignoring %s: cannot parse \"%s\"", FAULTS_ENV, spec);
+            }
+        }
+        atomic_store(&s_faults.state, on ? FAULTS_ON : FAULTS_OFF);
+    }
+    pthread_mutex_unlock(&s_faults.lock);
+}
+
+int arc_faults_active(void) {
+    int state = atomic_load_explicit(&s_faults.state, memory_order_relaxed);
+    if (state == FAULTS_UNCHECKED) {
+        faults_load_env();
+        state = atomic_load_explicit(&s_faults.state, memory_order_relaxed);
+    }
+    return state == FAULTS_ON;
+}
+
+/*============================================================================
+ * Draws
+ *============================================================================*/
+
+typedef struct {
+    ac_http_faults_config_t config;  /* Snapshot taken when the request starts */
+    uint64_t rng;
+    uint32_t delay_ms;               /* Latency + jitter */
+    int error;
+    size_t cut_at;                   /* Bytes delivered before the cut (0 = no cut) */
+    int drop;                        /* Non-streamed: drop the response */
+    uint64_t waited_ms;
+} fault_plan_t;
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static int roll_pct(fault_plan_t *plan, uint32_t pct) {
+    return pct > 0 && splitmix64(&plan->rng) % 100 < pct;
+}
+
+/**
+ * @brief Snapshot the configuration and draw the request's faults
+ *
+ * @return 0 when the URL does not match (no faults for this request)
+ */
+static int plan_request(const arc_http_request_t *request, int stream, fault_plan_t *plan) {
+    memset(plan, 0, sizeof(*plan));
+    pthread_mutex_lock(&s_faults.lock);
+    plan->config = s_faults.config;
+    pthread_mutex_unlock(&s_faults.lock);
+
+    const ac_http_faults_config_t *cfg = &plan->config;
+    if (cfg->url_match[0] && (!request->url || !strstr(request->url, cfg->url_match))) {
+        return 0;
+    }
+
+    uint64_t n = atomic_fetch_add_explicit(&s_faults.sequence, 1, memory_order_relaxed);
+    plan->rng = ((uint64_t)cfg->seed << 32) ^ n;
+    plan->delay_ms = cfg->latency_ms;
+    if (cfg->jitter_ms) {
+        plan->delay_ms += (uint32_t)(splitmix64(&plan->rng) % ((uint64_t)cfg->jitter_ms + 1));
+    }
+    plan->error = roll_pct(plan, cfg->error_pct);
+    if (!plan->error && roll_pct(plan, cfg->disconnect_pct)) {
+        if (stream) {
+            uint32_t window = cfg->disconnect_bytes ? cfg->disconnect_bytes
+                                                    : FAULTS_DISCONNECT_BYTES;
+            plan->cut_at = 1 + (size_t)(splitmix64(&plan->rng) % window);
+        } else {
+            plan->drop = 1;
+        }
+    }
+    return 1;
+}
+
+static void plan_wait(fault_plan_t *plan, uint64_t ms) {
+    if (ms > 0) {
+        ac_platform_sleep_ms((uint32_t)ms);
+        plan->waited_ms += ms;
+    }
+}
+
+/** Time bytes take at the bandwidth cap */
+static uint64_t transfer_ms(const fault_plan_t *plan, size_t bytes) {
+    return plan->config.bandwidth ? (uint64_t)bytes * 1000 / plan->config.bandwidth : 0;
+}
+
+static size_t request_body_len(const arc_http_request_t *request) {
+    if (!request->body) {
+        return 0;                    /* No body, or pulled from a source */
+    }
+    return request->body_len ? request->body_len : strlen(request->body);
+}
+
+static void plan_finish(const fault_plan_t *plan) {
+    atomic_fetch_add_explicit(&s_faults.delay_ms, plan->waited_ms, memory_order_relaxed);
+}
+
+/*============================================================================
+ * Injected Answers
+ *============================================================================*/
+
+static int error_body(const fault_plan_t *plan, char *buf, size_t size) {
+    uint32_t status = plan->config.error_status ? plan->config.error_status
+                                                : FAULTS_ERROR_STATUS;
+    return snprintf(buf, size,
+                    "{\"error\":{\"type\":\"injected_fault\",\"message\":\"Injected HTTP %u\"}}",
+                    (unsigned)status);
+}
+
+static void error_answer(const fault_plan_t *plan, const arc_http_request_t *request,
+                         arc_http_response_t *response) {
+    char body[128];
+    int len = error_body(plan, body, sizeof(body));
+
+    memset(response, 0, sizeof(*response));
+    response->status_code = plan->config.error_status ? (int)plan->config.error_status
+                                                      : FAULTS_ERROR_STATUS;
+    if (response->status_code == 429) {
+        response->retry_after_ms = plan->config.retry_after_ms ? plan->config.retry_after_ms
+                                                               : FAULTS_RETRY_AFTER_MS;
+    }
+
+    const arc_http_sink_t *sink = request->sink;
+    if (sink && sink->buffer && sink->capacity > 0) {
+        size_t n = (size_t)len < sink->capacity - 1 ? (size_t)len : sink->capacity - 1;
+        memcpy(sink->buffer, body, n);
+        sink->buffer[n] = '\0';
+        response->body = sink->buffer;
+        response->body_len = n;
+        response->body_borrowed = 1;
+    } else {
+        response->body = ARC_STRDUP(body);
+        response->body_len = response->body ? (size_t)len : 0;
+    }
+    atomic_fetch_add_explicit(&s_faults.errors, 1, memory_order_relaxed);
+}
+
+static arc_err_t disconnect(arc_http_response_t *response) {
+    arc_http_response_free(response);
+    response->error_msg = ARC_STRDUP("Injected disconnect");
+    atomic_fetch_add_explicit(&s_faults.disconnects, 1, memory_order_relaxed);
+    return ARC_ERR_NETWORK;
+}
+
+/*============================================================================
+ * Requests
+ *============================================================================*/
+
+arc_err_t arc_faults_request(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response,
+    arc_http_perform_fn perform
+) {
+    fault_plan_t plan;
+    if (!request || !response || !plan_request(request, 0, &plan)) {
+        return perform(client, request, response);
+    }
+
+    plan_wait(&plan, plan.delay_ms);
+    arc_err_t err = ARC_OK;
+    if (plan.error) {
+        error_answer(&plan, request, response);
+    } else {
+        plan_wait(&plan, transfer_ms(&plan, request_body_len(request)));
+        err = perform(client, request, response);
+        if (err == ARC_OK && plan.drop) {
+            err = disconnect(response);
+        } else if (err == ARC_OK) {
+            plan_wait(&plan, transfer_ms(&plan, response->body_len));
+        }
+    }
+    plan_finish(&plan);
+    return err;
+}
+
+typedef struct {
+    fault_plan_t *plan;
+    arc_stream_callback_t on_data;
+    void *user_data;
+    uint64_t start_ms;               /* Download pacing origin */
+    size_t delivered;
+    int cut;
+} fault_stream_t;
+
+static int fault_stream_cb(const char *data, size_t len, void *user_data) {
+    fault_stream_t *fs = (fault_stream_t *)user_data;
+    fault_plan_t *plan = fs->plan;
+    size_t piece = plan->config.drip_bytes ? plan->config.drip_bytes : len;
+
+    if (!fs->start_ms) {
+        fs->start_ms = ac_platform_timestamp_ms();
+    }
+    for (size_t off = 0; off < len; off += piece) {
+        size_t n = len - off < piece ? len - off : piece;
+        if (plan->cut_at && fs->delivered + n >= plan->cut_at) {
+            n = plan->cut_at - fs->delivered;
+            fs->cut = 1;
+        }
+        plan_wait(plan, plan->config.drip_ms);
+        if (plan->config.bandwidth) {
+            uint64_t due = fs->start_ms + transfer_ms(plan, fs->delivered + n);
+            uint64_t now = ac_platform_timestamp_ms();
+            plan_wait(plan, due > now ? due - now : 0);
+        }
+        if (n > 0) {
+            int rc = fs->on_data(data + off, n, fs->user_data);
+            fs->delivered += n;
+            if (rc != 0) {
+                return rc;
+            }
+        }
+        if (fs->cut) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+arc_err_t arc_faults_request_stream(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response,
+    arc_http_perform_stream_fn perform
+) {
+    fault_plan_t plan;
+    if (!request || !response || !request->on_data || !plan_request(&request->base, 1, &plan)) {
+        return perform(client, request, response);
+    }
+
+    plan_wait(&plan, plan.delay_ms);
+    arc_err_t err = ARC_OK;
+    if (plan.error) {
+        /* The error body arrives through the callback, as from a server */
+        char body[128];
+        int len = error_body(&plan, body, sizeof(body));
+        error_answer(&plan, &request->base, response);
+        request->on_data(body, (size_t)len, request->user_data);
+    } else {
+        plan_wait(&plan, transfer_ms(&plan, request_body_len(&request->base)));
+        fault_stream_t fs = {
+            .plan = &plan,
+            .on_data = request->on_data,
+            .user_data = request->user_data,
+        };
+        arc_http_stream_request_t shimmed = *request;
+        shimmed.on_data = fault_stream_cb;
+        shimmed.user_data = &fs;
+        err = perform(client, &shimmed, response);
+        if (fs.cut) {
+            err = disconnect(response);
+        }
+    }
+    plan_finish(&plan);
+    return err;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+static const struct {
+    const char *name;
+    size_t offset;
+} s_fields[] = {
+    { "latency_ms", offsetof(ac_http_faults_config_t, latency_ms) },
+    { "jitter_ms", offsetof(ac_http_faults_config_t, jitter_ms) },
+    { "bandwidth", offsetof(ac_http_faults_config_t, bandwidth) },
+    { "drip_bytes", offsetof(ac_http_faults_config_t, drip_bytes) },
+    { "drip_ms", offsetof(ac_http_faults_config_t, drip_ms) },
+    { "disconnect_pct", offsetof(ac_http_faults_config_t, disconnect_pct) },
+    { "disconnect_bytes", offsetof(ac_http_faults_config_t, disconnect_bytes) },
+    { "error_pct", offsetof(ac_http_faults_config_t, error_pct) },
+    { "error_status", offsetof(ac_http_faults_config_t, error_status) },
+    { "retry_after_ms", offsetof(ac_http_faults_config_t, retry_after_ms) },
+    { "seed", offsetof(ac_http_faults_config_t, seed) },
+};
+
+arc_err_t ac_http_faults_parse(const char *spec, ac_http_faults_config_t *config) {
+    if (!spec || !config) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    ac_http_faults_config_t out = *config;
+    const char *p = spec;
+    while (*p) {
+        while (*p == ',' || *p == ' ') {
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+        const char *eq = strchr(p, '=');
+        const char *end = strchr(p, ',');
+        if (!end) {
+            end = p + strlen(p);
+        }
+        if (!eq || eq > end) {
+            return ARC_ERR_PARSE;
+        }
+        size_t klen = (size_t)(eq - p);
+        const char *value = eq + 1;
+        size_t vlen = (size_t)(end - value);
+
+        if (klen == 9 && strncmp(p, "url_match", 9) == 0) {
+            if (vlen >= sizeof(out.url_match)) {
+                return ARC_ERR_PARSE;
+            }
+            memcpy(out.url_match, value, vlen);
+            out.url_match[vlen] = '\0';
+        } else {
+            size_t i = 0;
+            size_t count = sizeof(s_fields) / sizeof(s_fields[0]);
+            while (i < count && (strlen(s_fields[i].name) != klen ||
+                                 strncmp(p, s_fields[i].name, klen) != 0)) {
+                i++;
+            }
+            char *num_end;
+            unsigned long v = strtoul(value, &num_end, 10);
+            if (i == count || num_end != end || vlen == 0 || v > UINT32_MAX) {
+                return ARC_ERR_PARSE;
+            }
+            memcpy((char *)&out + s_fields[i].offset, &(uint32_t){ (uint32_t)v },
+                   sizeof(uint32_t));
+        }
+        p = end;
+    }
+    if (out.error_pct > 100 || out.disconnect_pct > 100) {
+        return ARC_ERR_PARSE;
+    }
+    *config = out;
+    return ARC_OK;
+}
+
+arc_err_t ac_http_faults_start(const ac_http_faults_config_t *config) {
+    ac_http_faults_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    if (config) {
+        cfg = *config;
+        cfg.url_match[sizeof(cfg.url_match) - 1] = '\0';
+    } else {
+        const char *spec = getenv(FAULTS_ENV);
+        if (!spec || !*spec) {
+            return ARC_ERR_NOT_FOUND;
+        }
+        arc_err_t err = ac_http_faults_parse(spec, &cfg);
+        if (err != ARC_OK) {
+            return err;
+        }
+    }
+    if (cfg.error_pct > 100 || cfg.disconnect_pct > 100) {
+        return ARC_ERR_PARSE;
+    }
+
+    pthread_mutex_lock(&s_faults.lock);
+    s_faults.config = cfg;
+    atomic_store(&s_faults.sequence, 0);
+    atomic_store(&s_faults.errors, 0);
+    atomic_store(&s_faults.disconnects, 0);
+    atomic_store(&s_faults.delay_ms, 0);
+    atomic_store(&s_faults.state, FAULTS_ON);
+    pthread_mutex_unlock(&s_faults.lock);
+    return ARC_OK;
+}
+
+void ac_http_faults_stop(void) {
+    pthread_mutex_lock(&s_faults.lock);
+    atomic_store(&s_faults.state, FAULTS_OFF);
+    pthread_mutex_unlock(&s_faults.lock);
+}
+
+void ac_http_faults_get_stats(ac_http_faults_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->requests = atomic_load(&s_faults.sequence);
+    stats->errors = atomic_load(&s_faults.errors);
+    stats->disconnects = atomic_load(&s_faults.disconnects);
+    stats->delay_ms = atomic_load(&s_faults.delay_ms);
+}
@@ -0,0 +1,52 @@
+/**
+ * @file http_fault_shim.h
+ * @brief Network fault injection at the arc_http boundary (internal)
+ *
+ * Each backend's arc_http_request() and arc_http_request_stream() hand
+ * their request to these when faults are active (arc/http_faults.h),
+ * passing the function that performs it (through the cassette, if one
+ * is active).
+ */
+
+#ifndef ARC_HTTP_FAULT_SHIM_H
+#define ARC_HTTP_FAULT_SHIM_H
+
+#include "http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Whether requests go through fault injection
+ *
+ * One relaxed load once ARC_HTTP_FAULTS has been looked at (on the first
+ * call of the process).
+ */
+int arc_faults_active(void);
+
+/**
+ * @brief Delay, fail or cut off the request around perform
+ */
+arc_err_t arc_faults_request(
+    arc_http_client_t *client,
+    const arc_http_request_t *request,
+    arc_http_response_t *response,
+    arc_http_perform_fn perform
+);
+
+/**
+ * @brief Streaming variant: chunks can also be dripped and cut off
+ */
+arc_err_t arc_faults_request_stream(
+    arc_http_client_t *client,
+    const arc_http_stream_request_t *request,
+    arc_http_response_t *response,
+    arc_http_perform_stream_fn perform
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HTTP_FAULT_SHIM_H */
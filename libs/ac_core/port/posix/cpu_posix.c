@@ -0,0 +1,174 @@
+/**
+ * @file cpu_posix.c
+ * @brief POSIX CPU placement (thread pinning, NUMA topology)
+ *
+ * Linux reads the topology from sysfs and pins with sched_setaffinity();
+ * pages are placed with the mbind system call, so no libnuma is needed.
+ * Other POSIX systems report one node and do not pin.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "arc/platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef __linux__
+
+#define NODE_SYSFS       "/sys/devices/system/node"
+#define MAX_NODES        1024
+#define MPOL_PREFERRED   1
+
+/**
+ * @brief Parse a sysfs CPU list ("0-3,8,10-11")
+ */
+static size_t parse_cpulist(const char *list, int *cpus, size_t max) {
+    size_t count = 0;
+    const char *p = list;
+    while (*p && *p != '\n') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (cpus && count < max) {
+                cpus[count] = (int)cpu;
+            }
+            count++;
+        }
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return count;
+}
+
+int ac_platform_numa_nodes(void) {
+    int nodes = 0;
+    char path[64];
+    for (int n = 0; n < MAX_NODES; n++) {
+        snprintf(path, sizeof(path), NODE_SYSFS "/node%d", n);
+        if (access(path, F_OK) != 0) {
+            break;
+        }
+        nodes++;
+    }
+    return nodes > 0 ? nodes : 1;
+}
+
+size_t ac_platform_node_cpus(int node, int *cpus, size_t max) {
+    char path[96];
+    snprintf(path, sizeof(path), NODE_SYSFS "/node%d/cpulist", node);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        /* No NUMA support compiled in: one node with every CPU */
+        if (node != 0) {
+            return 0;
+        }
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        size_t count = online > 0 ? (size_t)online : 0;
+        for (size_t i = 0; cpus && i < count && i < max; i++) {
+            cpus[i] = (int)i;
+        }
+        return count;
+    }
+    char list[4096];
+    size_t count = fgets(list, sizeof(list), f) ? parse_cpulist(list, cpus, max) : 0;
+    fclose(f);
+    return count;
+}
+
+int ac_platform_pin_thread(const int *cpus, size_t count) {
+    if (!cpus || count == 0) {
+        return -1;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < count; i++) {
+        if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) {
+            CPU_SET(cpus[i], &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        return -1;
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0 ? 0 : -1;
+}
+
+void ac_platform_bind_memory(void *ptr, size_t size, int node) {
+#ifdef SYS_mbind
+    static int nodes;
+    if (!nodes) {
+        nodes = ac_platform_numa_nodes();
+    }
+    if (!ptr || node < 0 || node >= nodes || nodes < 2) {
+        return;
+    }
+
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) {
+        return;
+    }
+    uintptr_t start = ((uintptr_t)ptr + (uintptr_t)page - 1) & ~((uintptr_t)page - 1);
+    uintptr_t end = ((uintptr_t)ptr + size) & ~((uintptr_t)page - 1);
+    if (end <= start) {
+        return;
+    }
+
+    unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))] = { 0 };
+    mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+    syscall(SYS_mbind, (void *)start, (unsigned long)(end - start), MPOL_PREFERRED,
+            mask, (unsigned long)MAX_NODES + 1, 0u);
+#else
+    (void)ptr;
+    (void)size;
+    (void)node;
+#endif
+}
+
+#else /* !__linux__ */
+
+int ac_platform_numa_nodes(void) {
+    return 1;
+}
+
+size_t ac_platform_node_cpus(int node, int *cpus, size_t max) {
+    if (node != 0) {
+        return 0;
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t count = online > 0 ? (size_t)online : 0;
+    for (size_t i = 0; cpus && i < count && i < max; i++) {
+        cpus[i] = (int)i;
+    }
+    return count;
+}
+
+int ac_platform_pin_thread(const int *cpus, size_t count) {
+    (void)cpus;
+    (void)count;
+    return -1;
+}
+
+void ac_platform_bind_memory(void *ptr, size_t size, int node) {
+    (void)ptr;
+    (void)size;
+    (void)node;
+}
+
+#endif /* __linux__ */
@@ -5,6 +5,8 @@
 
 #include "arc/platform.h"
 #include <sys/time.h>
+#include <errno.h>
+#include <time.h>
 
 /**
  * @brief Get current timestamp in milliseconds since Unix epoch
@@ -14,3 +16,21 @@ uint64_t ac_platform_timestamp_ms(void) {
     gettimeofday(&tv, NULL);
     return (uint64_t)tv.tv_sec * 1000 + (uint64_t)tv.tv_usec / 1000;
 }
+
+/**
+ * @brief Microseconds from CLOCK_MONOTONIC
+ */
+uint64_t ac_platform_monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Sleep for ms milliseconds (resumed after signals)
+ */
+void ac_platform_sleep_ms(uint32_t ms) {
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
@@ -7,6 +7,10 @@
  * - Windows: Native pthread (via pthreads-win32, install with vcpkg)
  * - FreeRTOS: Wrapper over FreeRTOS semaphores
  *
+ * ARC_HAS_THREADS is defined when pthread_create/pthread_join are usable.
+ * Without it only the mutex API is provided and callers must fall back
+ * to single-threaded execution.
+ *
  * Usage:
  *   #include "pthread_port.h"
  *   pthread_mutex_t lock;
@@ -32,6 +36,9 @@
 
 /* Native pthread - no wrapper needed */
 
+/* Thread creation (pthread_create/pthread_join) is available */
+#define ARC_HAS_THREADS 1
+
 /*============================================================================
  * FreeRTOS - pthread compatibility layer
  *============================================================================*/
@@ -0,0 +1,49 @@
+/**
+ * @file cpu_windows.c
+ * @brief Windows CPU placement
+ *
+ * Pins within the first processor group; reports a single node.
+ */
+
+#include "arc/platform.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+int ac_platform_numa_nodes(void) {
+    return 1;
+}
+
+size_t ac_platform_node_cpus(int node, int *cpus, size_t max) {
+    if (node != 0) {
+        return 0;
+    }
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t count = info.dwNumberOfProcessors;
+    for (size_t i = 0; cpus && i < count && i < max; i++) {
+        cpus[i] = (int)i;
+    }
+    return count;
+}
+
+int ac_platform_pin_thread(const int *cpus, size_t count) {
+    DWORD_PTR mask = 0;
+    for (size_t i = 0; cpus && i < count; i++) {
+        if (cpus[i] >= 0 && cpus[i] < (int)(8 * sizeof(DWORD_PTR))) {
+            mask |= (DWORD_PTR)1 << cpus[i];
+        }
+    }
+    if (!mask) {
+        return -1;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), mask) ? 0 : -1;
+}
+
+void ac_platform_bind_memory(void *ptr, size_t size, int node) {
+    (void)ptr;
+    (void)size;
+    (void)node;
+}
+
+#endif /* _WIN32 */
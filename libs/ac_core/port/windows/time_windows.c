@@ -22,9 +22,32 @@ uint64_t ac_platform_timestamp_ms(void) {
     return (uint64_t)((uli.QuadPart - 116444736000000000ULL) / 10000);
 }
 
+uint64_t ac_platform_monotonic_us(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000 +
+           (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000 / (uint64_t)freq.QuadPart;
+}
+
+void ac_platform_sleep_ms(uint32_t ms) {
+    Sleep(ms);
+}
+
 #else
 /* Non-Windows fallback (should not be compiled) */
 uint64_t ac_platform_timestamp_ms(void) {
     return 0;
 }
+
+uint64_t ac_platform_monotonic_us(void) {
+    return 0;
+}
+
+void ac_platform_sleep_ms(uint32_t ms) {
+    (void)ms;
+}
 #endif
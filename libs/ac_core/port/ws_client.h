@@ -0,0 +1,92 @@
+/**
+ * @file ws_client.h
+ * @brief ArC WebSocket client Platform Abstraction Layer
+ *
+ * One long-lived, bidirectional connection (RFC 6455, client side) for
+ * APIs that stream responses over a WebSocket instead of one HTTP
+ * request per call. Text messages only; pings are answered inside
+ * arc_ws_recv(). A connection is used by one thread at a time.
+ *
+ * Implementations:
+ * - libcurl (port/ws_curl.c): connect-only socket, framing done here, so
+ *   it does not depend on libcurl having been built with WebSocket support
+ * - mongoose (port/freertos/http/http_mongoose.c): not available yet
+ *
+ * NOTE: This is an internal port layer header, not part of public API.
+ */
+
+#ifndef ARC_WS_CLIENT_H
+#define ARC_WS_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arc/error.h"
+#include "http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct arc_ws arc_ws_t;
+
+/** Largest message arc_ws_recv() reassembles by default */
+#define ARC_WS_DEFAULT_MAX_MESSAGE (16u * 1024u * 1024u)
+
+typedef struct {
+    const char *url;                       /* ws://, wss://, http:// or https:// */
+    const arc_http_header_set_t *header_set;  /* Sent with the upgrade request (optional) */
+    const arc_http_header_t *headers;      /* More upgrade headers (optional) */
+    uint32_t timeout_ms;                   /* Connect + handshake, and each send (0 = 30000) */
+    int verify_ssl;                        /* 1 = verify SSL cert, 0 = skip (dev only) */
+    size_t max_message_size;               /* 0 = ARC_WS_DEFAULT_MAX_MESSAGE */
+} arc_ws_config_t;
+
+/**
+ * @brief Open a connection and complete the upgrade handshake
+ *
+ * @param config      Connection settings (copied)
+ * @param out         Output connection
+ * @param status_out  HTTP status of a refused upgrade (optional, 0 otherwise)
+ * @return ARC_OK, ARC_ERR_HTTP if the server answered without switching
+ *         protocols, ARC_ERR_PROTOCOL for a bad handshake, or the
+ *         transport error
+ */
+arc_err_t arc_ws_connect(const arc_ws_config_t *config, arc_ws_t **out, int *status_out);
+
+/**
+ * @brief Send one text message (blocks until it is written)
+ *
+ * @return ARC_OK, ARC_ERR_NOT_CONNECTED once the connection is gone
+ */
+arc_err_t arc_ws_send_text(arc_ws_t *ws, const char *data, size_t len);
+
+/**
+ * @brief Wait for the next complete text or binary message
+ *
+ * *data is NUL-terminated, owned by the connection and valid until the
+ * next arc_ws_recv() or arc_ws_close(); callers may modify it in place.
+ *
+ * @param timeout_ms  Give up after this long (0 = no limit)
+ * @param cancel      Abort with ARC_ERR_CANCELLED once *cancel != 0 (optional)
+ * @return ARC_OK, ARC_ERR_TIMEOUT, ARC_ERR_CANCELLED, ARC_ERR_NOT_CONNECTED
+ *         when the peer closed, ARC_ERR_RESPONSE_TOO_LARGE, ARC_ERR_PROTOCOL.
+ *         A timeout or cancel mid-message leaves the connection unusable.
+ */
+arc_err_t arc_ws_recv(arc_ws_t *ws, char **data, size_t *len,
+                      uint32_t timeout_ms, const volatile int *cancel);
+
+/**
+ * @brief Whether the connection can still send and receive
+ */
+int arc_ws_is_open(const arc_ws_t *ws);
+
+/**
+ * @brief Send a close frame (best effort) and free the connection
+ */
+void arc_ws_close(arc_ws_t *ws);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_WS_CLIENT_H */
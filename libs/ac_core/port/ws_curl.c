@@ -0,0 +1,765 @@
+/**
+ * @file ws_curl.c
+ * @brief WebSocket client over a libcurl connect-only socket
+ *
+ * libcurl resolves, connects and does TLS (CURLOPT_CONNECT_ONLY); the
+ * upgrade request and RFC 6455 framing are done here on top of
+ * curl_easy_send()/curl_easy_recv(). That works with any libcurl, not
+ * only builds with the experimental ws:// support enabled.
+ *
+ * Implements the interface defined in port/ws_client.h.
+ */
+
+#include "ws_client.h"
+#include "http_curl_internal.h"
+#include "arc/platform.h"
+#include "arc/log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define ws_poll WSAPoll
+#define strncasecmp _strnicmp
+#else
+#include <poll.h>
+#include <strings.h>
+#define ws_poll poll
+#endif
+
+/*============================================================================
+ * Internal Structures
+ *============================================================================*/
+
+#define WS_DEFAULT_TIMEOUT_MS 30000
+#define WS_RX_CHUNK           16384
+#define WS_HANDSHAKE_MAX      16384
+/** How often a wait looks at the cancel flag */
+#define WS_CANCEL_POLL_MS     20
+
+#define WS_OP_CONTINUATION 0x0
+#define WS_OP_TEXT         0x1
+#define WS_OP_BINARY       0x2
+#define WS_OP_CLOSE        0x8
+#define WS_OP_PING         0x9
+#define WS_OP_PONG         0xA
+
+struct arc_ws {
+    CURL *curl;
+    curl_socket_t sock;
+    uint32_t timeout_ms;
+    size_t max_message_size;
+    int open;
+    uint64_t mask_state;       /* xorshift64 for masking keys */
+
+    char *rx;                  /* Received, not yet parsed bytes */
+    size_t rx_len;
+    size_t rx_cap;
+
+    char *msg;                 /* Message being reassembled */
+    size_t msg_len;
+    size_t msg_cap;
+    int in_message;            /* A fragmented message is in progress */
+};
+
+/*============================================================================
+ * SHA-1 and Base64 (handshake only)
+ *============================================================================*/
+
+static uint32_t rol32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_block(uint32_t h[5], const unsigned char *p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 |
+               (uint32_t)p[i * 4 + 2] << 8 | (uint32_t)p[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t t = rol32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+static void sha1(const void *data, size_t len, unsigned char out[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    const unsigned char *p = data;
+    size_t left = len;
+    for (; left >= 64; left -= 64, p += 64) {
+        sha1_block(h, p);
+    }
+
+    unsigned char tail[128] = {0};
+    memcpy(tail, p, left);
+    tail[left] = 0x80;
+    size_t tail_len = left < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tail_len - 1 - i] = (unsigned char)(bits >> (i * 8));
+    }
+    sha1_block(h, tail);
+    if (tail_len == 128) {
+        sha1_block(h, tail + 64);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        out[i * 4] = (unsigned char)(h[i] >> 24);
+        out[i * 4 + 1] = (unsigned char)(h[i] >> 16);
+        out[i * 4 + 2] = (unsigned char)(h[i] >> 8);
+        out[i * 4 + 3] = (unsigned char)h[i];
+    }
+}
+
+/** out needs 4 * ((len + 2) / 3) + 1 bytes */
+static void base64_encode(const unsigned char *in, size_t len, char *out) {
+    static const char table[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)in[i + 1] << 8;
+        if (i + 2 < len) v |= in[i + 2];
+        out[o++] = table[(v >> 18) & 63];
+        out[o++] = table[(v >> 12) & 63];
+        out[o++] = i + 1 < len ? table[(v >> 6) & 63] : '=';
+        out[o++] = i + 2 < len ? table[v & 63] : '=';
+    }
+    out[o] = '\0';
+}
+
+/*============================================================================
+ * Socket I/O
+ *============================================================================*/
+
+static uint64_t ws_random(arc_ws_t *ws) {
+    uint64_t x = ws->mask_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    ws->mask_state = x;
+    return x;
+}
+
+static void ws_seed(arc_ws_t *ws) {
+    uint64_t seed = 0;
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (f) {
+        if (fread(&seed, sizeof(seed), 1, f) != 1) {
+            seed = 0;
+        }
+        fclose(f);
+    }
+    seed ^= ac_platform_timestamp_ms() ^ (uint64_t)(uintptr_t)ws;
+    ws->mask_state = seed ? seed : 0x9E3779B97F4A7C15ull;
+}
+
+/**
+ * @brief Wait for the socket (events = POLLIN or POLLOUT)
+ *
+ * @param deadline_ms  Absolute end (0 = none)
+ * @return ARC_OK when ready (or spuriously woken), else timeout/cancel
+ */
+static arc_err_t ws_wait(arc_ws_t *ws, short events, uint64_t deadline_ms,
+                         const volatile int *cancel) {
+    if (cancel && *cancel) {
+        return ARC_ERR_CANCELLED;
+    }
+    int wait_ms = -1;
+    if (deadline_ms) {
+        uint64_t now = ac_platform_timestamp_ms();
+        if (now >= deadline_ms) {
+            return ARC_ERR_TIMEOUT;
+        }
+        wait_ms = (int)(deadline_ms - now);
+    }
+    if (cancel && (wait_ms < 0 || wait_ms > WS_CANCEL_POLL_MS)) {
+        wait_ms = WS_CANCEL_POLL_MS;
+    }
+
+#ifdef _WIN32
+    WSAPOLLFD pfd = { .fd = ws->sock, .events = (SHORT)events };
+#else
+    struct pollfd pfd = { .fd = ws->sock, .events = events };
+#endif
+    if (ws_poll(&pfd, 1, wait_ms) < 0 && errno != EINTR) {
+        return ARC_ERR_NETWORK;
+    }
+    return ARC_OK;
+}
+
+static arc_err_t ws_send_all(arc_ws_t *ws, const char *data, size_t len) {
+    uint64_t deadline = ac_platform_timestamp_ms() + ws->timeout_ms;
+    while (len > 0) {
+        size_t sent = 0;
+        CURLcode res = curl_easy_send(ws->curl, data, len, &sent);
+        if (res == CURLE_AGAIN) {
+            arc_err_t err = ws_wait(ws, POLLOUT, deadline, NULL);
+            if (err != ARC_OK) {
+                return err;
+            }
+            continue;
+        }
+        if (res != CURLE_OK) {
+            AC_LOG_ERROR("WebSocket send failed: %s", curl_easy_strerror(res));
+            return arc_curl_map_error(res);
+        }
+        data += sent;
+        len -= sent;
+    }
+    return ARC_OK;
+}
+
+/**
+ * @brief Read whatever is available into rx (at least one byte)
+ *
+ * Always leaves room for a terminator after the data.
+ */
+static arc_err_t ws_fill(arc_ws_t *ws, uint64_t deadline_ms, const volatile int *cancel) {
+    if (ws->rx_cap - ws->rx_len < WS_RX_CHUNK) {
+        size_t cap = ws->rx_cap ? ws->rx_cap * 2 : WS_RX_CHUNK * 2;
+        char *rx = ARC_REALLOC(ws->rx, cap);
+        if (!rx) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        ws->rx = rx;
+        ws->rx_cap = cap;
+    }
+
+    for (;;) {
+        size_t n = 0;
+        CURLcode res = curl_easy_recv(ws->curl, ws->rx + ws->rx_len,
+                                      ws->rx_cap - ws->rx_len - 1, &n);
+        if (res == CURLE_OK) {
+            if (n == 0) {
+                return ARC_ERR_NOT_CONNECTED;
+            }
+            ws->rx_len += n;
+            return ARC_OK;
+        }
+        if (res != CURLE_AGAIN) {
+            AC_LOG_ERROR("WebSocket receive failed: %s", curl_easy_strerror(res));
+            return arc_curl_map_error(res);
+        }
+        arc_err_t err = ws_wait(ws, POLLIN, deadline_ms, cancel);
+        if (err != ARC_OK) {
+            return err;
+        }
+    }
+}
+
+static void ws_consume(arc_ws_t *ws, size_t n) {
+    memmove(ws->rx, ws->rx + n, ws->rx_len - n);
+    ws->rx_len -= n;
+}
+
+/**
+ * @brief Send one masked frame (client frames are always masked)
+ */
+static arc_err_t ws_send_frame(arc_ws_t *ws, int opcode, const char *payload, size_t len) {
+    if (!ws->open) {
+        return ARC_ERR_NOT_CONNECTED;
+    }
+
+    unsigned char head[14];
+    size_t head_len = 2;
+    head[0] = (unsigned char)(0x80 | opcode);
+    if (len < 126) {
+        head[1] = (unsigned char)(0x80 | len);
+    } else if (len <= 0xFFFF) {
+        head[1] = 0x80 | 126;
+        head[2] = (unsigned char)(len >> 8);
+        head[3] = (unsigned char)len;
+        head_len = 4;
+    } else {
+        head[1] = 0x80 | 127;
+        for (int i = 0; i < 8; i++) {
+            head[2 + i] = (unsigned char)((uint64_t)len >> (56 - 8 * i));
+        }
+        head_len = 10;
+    }
+    uint32_t key = (uint32_t)ws_random(ws);
+    memcpy(head + head_len, &key, 4);
+    const unsigned char *mask = head + head_len;
+    head_len += 4;
+
+    char *frame = ARC_MALLOC(head_len + len);
+    if (!frame) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    memcpy(frame, head, head_len);
+    for (size_t i = 0; i < len; i++) {
+        frame[head_len + i] = (char)(payload[i] ^ mask[i & 3]);
+    }
+
+    arc_err_t err = ws_send_all(ws, frame, head_len + len);
+    ARC_FREE(frame);
+    if (err != ARC_OK) {
+        ws->open = 0;
+    }
+    return err;
+}
+
+/*============================================================================
+ * Handshake
+ *============================================================================*/
+
+/**
+ * @brief Upgrade request for url; the key goes in Sec-WebSocket-Key
+ * @return Heap string, NULL on a bad URL or allocation failure
+ */
+static char *ws_upgrade_request(const arc_ws_config_t *config, const char *http_url,
+                                const char *key) {
+    CURLU *u = curl_url();
+    if (!u) {
+        return NULL;
+    }
+    char *host = NULL, *port = NULL, *path = NULL, *query = NULL;
+    char *request = NULL;
+    if (curl_url_set(u, CURLUPART_URL, http_url, 0) != CURLUE_OK ||
+        curl_url_get(u, CURLUPART_HOST, &host, 0) != CURLUE_OK ||
+        curl_url_get(u, CURLUPART_PATH, &path, 0) != CURLUE_OK) {
+        AC_LOG_ERROR("WebSocket: bad URL %s", config->url);
+        goto done;
+    }
+    curl_url_get(u, CURLUPART_PORT, &port, 0);      /* Only when explicit */
+    curl_url_get(u, CURLUPART_QUERY, &query, 0);
+
+    size_t size = 512 + strlen(host) + strlen(path) + (query ? strlen(query) : 0);
+    const struct curl_slist *set = arc_curl_header_set_list(config->header_set);
+    for (const struct curl_slist *l = set; l; l = l->next) {
+        size += strlen(l->data) + 2;
+    }
+    for (const arc_http_header_t *h = config->headers; h; h = h->next) {
+        size += strlen(h->name) + strlen(h->value) + 4;
+    }
+
+    request = ARC_MALLOC(size);
+    if (!request) {
+        goto done;
+    }
+    int n = snprintf(request, size,
+                     "GET %s%s%s HTTP/1.1\r\n"
+                     "Host: %s%s%s\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: %s\r\n"
+                     "Sec-WebSocket-Version: 13\r\n",
+                     path, query ? "?" : "", query ? query : "",
+                     host, port ? ":" : "", port ? port : "", key);
+    size_t used = (size_t)n;
+    for (const struct curl_slist *l = set; l; l = l->next) {
+        used += (size_t)snprintf(request + used, size - used, "%s\r\n", l->data);
+    }
+    for (const arc_http_header_t *h = config->headers; h; h = h->next) {
+        used += (size_t)snprintf(request + used, size - used, "%s: %s\r\n", h->name, h->value);
+    }
+    snprintf(request + used, size - used, "\r\n");
+
+done:
+    curl_free(host);
+    curl_free(port);
+    curl_free(path);
+    curl_free(query);
+    curl_url_cleanup(u);
+    return request;
+}
+
+/**
+ * @brief Value of header name in a response head (NULL if absent)
+ *
+ * @param len  Receives the value length, trailing blanks trimmed
+ */
+static const char *ws_find_header(const char *head, const char *name, size_t *len) {
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(head, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, name, name_len) != 0 || line[name_len] != ':') {
+            continue;
+        }
+        const char *value = line + name_len + 1;
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+        const char *end = strstr(value, "\r\n");
+        if (!end) {
+            return NULL;
+        }
+        while (end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+            end--;
+        }
+        *len = (size_t)(end - value);
+        return value;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Read the upgrade response and check it against key
+ *
+ * Bytes after the response head (early frames) stay in rx.
+ */
+static arc_err_t ws_finish_handshake(arc_ws_t *ws, const char *key, int *status_out) {
+    uint64_t deadline = ac_platform_timestamp_ms() + ws->timeout_ms;
+    char *end = NULL;
+    while (!end) {
+        arc_err_t err = ws_fill(ws, deadline, NULL);
+        if (err != ARC_OK) {
+            return err;
+        }
+        ws->rx[ws->rx_len] = '\0';
+        end = strstr(ws->rx, "\r\n\r\n");
+        if (!end && ws->rx_len > WS_HANDSHAKE_MAX) {
+            return ARC_ERR_PROTOCOL;
+        }
+    }
+    end[2] = '\0';                   /* Head keeps its last CRLF */
+    size_t head_len = (size_t)(end - ws->rx) + 4;
+
+    int status = 0;
+    if (sscanf(ws->rx, "HTTP/%*s %d", &status) != 1) {
+        return ARC_ERR_PROTOCOL;
+    }
+    if (status_out) {
+        *status_out = status;
+    }
+    if (status != 101) {
+        AC_LOG_ERROR("WebSocket upgrade refused: HTTP %d", status);
+        return ARC_ERR_HTTP;
+    }
+
+    char accept_src[64];
+    unsigned char digest[20];
+    char expected[32];
+    snprintf(accept_src, sizeof(accept_src), "%s258EAFA5-E914-47DA-95CA-C5AB0DC85B11", key);
+    sha1(accept_src, strlen(accept_src), digest);
+    base64_encode(digest, sizeof(digest), expected);
+
+    size_t accept_len = 0;
+    const char *accept = ws_find_header(ws->rx, "Sec-WebSocket-Accept", &accept_len);
+    if (!accept || accept_len != strlen(expected) || memcmp(accept, expected, accept_len) != 0) {
+        AC_LOG_ERROR("WebSocket upgrade: bad Sec-WebSocket-Accept");
+        return ARC_ERR_PROTOCOL;
+    }
+
+    if (status_out) {
+        *status_out = 0;
+    }
+    ws_consume(ws, head_len);
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t arc_ws_connect(const arc_ws_config_t *config, arc_ws_t **out, int *status_out) {
+    if (status_out) {
+        *status_out = 0;
+    }
+    if (!config || !config->url || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    /* libcurl connects to the http(s) equivalent of ws(s) */
+    const char *url = config->url;
+    const char *rest = NULL;
+    const char *scheme = NULL;
+    if (strncmp(url, "wss://", 6) == 0) {
+        scheme = "https://";
+        rest = url + 6;
+    } else if (strncmp(url, "ws://", 5) == 0) {
+        scheme = "http://";
+        rest = url + 5;
+    } else if (strncmp(url, "https://", 8) != 0 && strncmp(url, "http://", 7) != 0) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    char *http_url = NULL;
+    if (scheme) {
+        size_t size = strlen(scheme) + strlen(rest) + 1;
+        http_url = ARC_MALLOC(size);
+        if (!http_url) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        snprintf(http_url, size, "%s%s", scheme, rest);
+    }
+
+    arc_err_t err = arc_curl_global_acquire();
+    if (err != ARC_OK) {
+        ARC_FREE(http_url);
+        return err;
+    }
+
+    arc_ws_t *ws = ARC_CALLOC(1, sizeof(arc_ws_t));
+    if (!ws || !(ws->curl = curl_easy_init())) {
+        ARC_FREE(ws);
+        ARC_FREE(http_url);
+        arc_curl_global_release();
+        return ARC_ERR_NO_MEMORY;
+    }
+    ws->timeout_ms = config->timeout_ms ? config->timeout_ms : WS_DEFAULT_TIMEOUT_MS;
+    ws->max_message_size = config->max_message_size ? config->max_message_size
+                                                    : ARC_WS_DEFAULT_MAX_MESSAGE;
+    ws_seed(ws);
+
+    /* Not on the shared connection cache: this socket is never handed back */
+    CURL *curl = ws->curl;
+    curl_easy_setopt(curl, CURLOPT_URL, http_url ? http_url : url);
+    curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long)ws->timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 15L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, config->verify_ssl ? 1L : 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, config->verify_ssl ? 2L : 0L);
+
+    unsigned char nonce[16];
+    for (size_t i = 0; i < sizeof(nonce); i += 8) {
+        uint64_t r = ws_random(ws);
+        memcpy(nonce + i, &r, 8);
+    }
+    char key[25];
+    base64_encode(nonce, sizeof(nonce), key);
+
+    char *request = NULL;
+    CURLcode res = curl_easy_perform(curl);
+    if (res != CURLE_OK) {
+        AC_LOG_ERROR("WebSocket connect to %s failed: %s", url, curl_easy_strerror(res));
+        err = arc_curl_map_error(res);
+    } else if (curl_easy_getinfo(curl, CURLINFO_ACTIVESOCKET, &ws->sock) != CURLE_OK ||
+               ws->sock == CURL_SOCKET_BAD) {
+        err = ARC_ERR_NETWORK;
+    } else if (!(request = ws_upgrade_request(config, http_url ? http_url : url, key))) {
+        err = ARC_ERR_INVALID_ARG;
+    } else {
+        ws->open = 1;
+        err = ws_send_all(ws, request, strlen(request));
+        if (err == ARC_OK) {
+            err = ws_finish_handshake(ws, key, status_out);
+        }
+    }
+    ARC_FREE(request);
+    ARC_FREE(http_url);
+
+    if (err != ARC_OK) {
+        ws->open = 0;
+        arc_ws_close(ws);
+        return err;
+    }
+
+    AC_LOG_DEBUG("WebSocket connected: %s", url);
+    *out = ws;
+    return ARC_OK;
+}
+
+arc_err_t arc_ws_send_text(arc_ws_t *ws, const char *data, size_t len) {
+    if (!ws || (!data && len)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    return ws_send_frame(ws, WS_OP_TEXT, data, len);
+}
+
+static arc_err_t ws_append(arc_ws_t *ws, const char *data, size_t len) {
+    if (ws->msg_len + len > ws->max_message_size) {
+        AC_LOG_ERROR("WebSocket message exceeds %zu bytes", ws->max_message_size);
+        return ARC_ERR_RESPONSE_TOO_LARGE;
+    }
+    if (ws->msg_len + len + 1 > ws->msg_cap) {
+        size_t cap = ws->msg_cap ? ws->msg_cap : WS_RX_CHUNK;
+        while (cap < ws->msg_len + len + 1) {
+            cap *= 2;
+        }
+        char *msg = ARC_REALLOC(ws->msg, cap);
+        if (!msg) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        ws->msg = msg;
+        ws->msg_cap = cap;
+    }
+    memcpy(ws->msg + ws->msg_len, data, len);
+    ws->msg_len += len;
+    ws->msg[ws->msg_len] = '\0';
+    return ARC_OK;
+}
+
+/**
+ * @brief Handle one complete frame at the start of rx
+ *
+ * @param done  Set when a whole message is in msg
+ */
+static arc_err_t ws_handle_frame(arc_ws_t *ws, int fin, int opcode, char *payload,
+                                 size_t len, int *done) {
+    switch (opcode) {
+        case WS_OP_TEXT:
+        case WS_OP_BINARY:
+            if (ws->in_message) {
+                return ARC_ERR_PROTOCOL;
+            }
+            ws->msg_len = 0;
+            /* fall through */
+        case WS_OP_CONTINUATION: {
+            if (opcode == WS_OP_CONTINUATION && !ws->in_message) {
+                return ARC_ERR_PROTOCOL;
+            }
+            arc_err_t err = ws_append(ws, payload, len);
+            if (err != ARC_OK) {
+                return err;
+            }
+            ws->in_message = !fin;
+            *done = fin;
+            return ARC_OK;
+        }
+
+        case WS_OP_PING:
+            return ws_send_frame(ws, WS_OP_PONG, payload, len);
+
+        case WS_OP_PONG:
+            return ARC_OK;
+
+        case WS_OP_CLOSE:
+            /* Echo the status code, then the connection is done */
+            ws_send_frame(ws, WS_OP_CLOSE, payload, len >= 2 ? 2 : 0);
+            AC_LOG_DEBUG("WebSocket closed by peer (%d)",
+                         len >= 2 ? ((unsigned char)payload[0] << 8 | (unsigned char)payload[1]) : 0);
+            return ARC_ERR_NOT_CONNECTED;
+
+        default:
+            return ARC_ERR_PROTOCOL;
+    }
+}
+
+arc_err_t arc_ws_recv(arc_ws_t *ws, char **data, size_t *len,
+                      uint32_t timeout_ms, const volatile int *cancel) {
+    if (!ws || !data || !len) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *data = NULL;
+    *len = 0;
+    if (!ws->open) {
+        return ARC_ERR_NOT_CONNECTED;
+    }
+
+    uint64_t deadline = timeout_ms ? ac_platform_timestamp_ms() + timeout_ms : 0;
+    arc_err_t err = ARC_OK;
+    int done = 0;
+    while (!done) {
+        /* Parse a frame header once enough of it is in */
+        unsigned char *p = (unsigned char *)ws->rx;
+        size_t need = 2;
+        uint64_t payload_len = 0;
+        if (ws->rx_len >= 2) {
+            int masked = p[1] & 0x80;
+            payload_len = p[1] & 0x7F;
+            size_t ext = payload_len == 126 ? 2 : payload_len == 127 ? 8 : 0;
+            need = 2 + ext + (masked ? 4 : 0);
+            if (ws->rx_len >= need) {
+                if (ext) {
+                    payload_len = 0;
+                    for (size_t i = 0; i < ext; i++) {
+                        payload_len = payload_len << 8 | p[2 + i];
+                    }
+                }
+                if (payload_len > ws->max_message_size) {
+                    AC_LOG_ERROR("WebSocket frame exceeds %zu bytes", ws->max_message_size);
+                    err = ARC_ERR_RESPONSE_TOO_LARGE;
+                    break;
+                }
+                need += (size_t)payload_len;
+            }
+        }
+
+        if (ws->rx_len < need) {
+            /* Make room for the whole frame, then read */
+            if (need + WS_RX_CHUNK > ws->rx_cap) {
+                char *rx = ARC_REALLOC(ws->rx, need + WS_RX_CHUNK);
+                if (!rx) {
+                    err = ARC_ERR_NO_MEMORY;
+                    break;
+                }
+                ws->rx = rx;
+                ws->rx_cap = need + WS_RX_CHUNK;
+            }
+            err = ws_fill(ws, deadline, cancel);
+            if (err != ARC_OK) {
+                break;
+            }
+            continue;
+        }
+
+        int fin = p[0] & 0x80;
+        int opcode = p[0] & 0x0F;
+        size_t payload_at = need - (size_t)payload_len;
+        char *payload = ws->rx + payload_at;
+        if (p[1] & 0x80) {               /* Servers should not mask; undo it if they do */
+            const unsigned char *mask = p + payload_at - 4;
+            for (size_t i = 0; i < (size_t)payload_len; i++) {
+                payload[i] = (char)(payload[i] ^ mask[i & 3]);
+            }
+        }
+        err = ws_handle_frame(ws, fin, opcode, payload, (size_t)payload_len, &done);
+        ws_consume(ws, need);
+        if (err != ARC_OK) {
+            break;
+        }
+    }
+
+    if (err != ARC_OK) {
+        /* A partial frame or message cannot be resumed */
+        ws->open = 0;
+        return err;
+    }
+    *data = ws->msg;
+    *len = ws->msg_len;
+    return ARC_OK;
+}
+
+int arc_ws_is_open(const arc_ws_t *ws) {
+    return ws && ws->open;
+}
+
+void arc_ws_close(arc_ws_t *ws) {
+    if (!ws) {
+        return;
+    }
+    if (ws->open) {
+        static const char normal[2] = { 0x03, (char)0xE8 };   /* 1000 */
+        ws->timeout_ms = 1000;
+        ws_send_frame(ws, WS_OP_CLOSE, normal, sizeof(normal));
+    }
+    curl_easy_cleanup(ws->curl);
+    arc_curl_global_release();
+    ARC_FREE(ws->rx);
+    ARC_FREE(ws->msg);
+    ARC_FREE(ws);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file affinity.c
+ * @brief Thread placement over CPUs and NUMA nodes
+ */
+
+#include "arc/affinity.h"
+#include "arc/error.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include <string.h>
+
+#ifdef ARC_THREAD_LOCAL
+static ARC_THREAD_LOCAL int t_memory_node = -1;
+#endif
+
+/**
+ * @brief Node of a CPU, -1 if no node lists it
+ */
+static int cpu_node(int cpu) {
+    int nodes = ac_platform_numa_nodes();
+    for (int node = 0; node < nodes; node++) {
+        size_t count = ac_platform_node_cpus(node, NULL, 0);
+        if (count == 0) {
+            continue;
+        }
+        int *cpus = (int *)ARC_MALLOC(count * sizeof(int));
+        if (!cpus) {
+            return -1;
+        }
+        count = ac_platform_node_cpus(node, cpus, count);
+        int found = 0;
+        for (size_t i = 0; i < count && !found; i++) {
+            found = cpus[i] == cpu;
+        }
+        ARC_FREE(cpus);
+        if (found) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+int ac_affinity_node_of(const ac_affinity_t *affinity, size_t index) {
+    if (!affinity) {
+        return -1;
+    }
+    switch (affinity->mode) {
+    case AC_AFFINITY_CPUS:
+        if (!affinity->cpus || affinity->cpu_count == 0) {
+            return -1;
+        }
+        return cpu_node(affinity->cpus[index % affinity->cpu_count]);
+    case AC_AFFINITY_NUMA:
+        return (int)(index % (size_t)ac_platform_numa_nodes());
+    default:
+        return -1;
+    }
+}
+
+int ac_affinity_apply(const ac_affinity_t *affinity, size_t index) {
+    if (!affinity || affinity->mode == AC_AFFINITY_NONE) {
+        return -1;
+    }
+
+    int node = ac_affinity_node_of(affinity, index);
+    int pinned = -1;
+    if (affinity->mode == AC_AFFINITY_CPUS && affinity->cpus && affinity->cpu_count) {
+        pinned = ac_platform_pin_thread(&affinity->cpus[index % affinity->cpu_count], 1);
+    } else if (affinity->mode == AC_AFFINITY_NUMA && node >= 0) {
+        size_t count = ac_platform_node_cpus(node, NULL, 0);
+        int *cpus = count ? (int *)ARC_MALLOC(count * sizeof(int)) : NULL;
+        if (cpus) {
+            count = ac_platform_node_cpus(node, cpus, count);
+            pinned = ac_platform_pin_thread(cpus, count);
+            ARC_FREE(cpus);
+        }
+    }
+
+    if (pinned != 0) {
+        AC_LOG_DEBUG("Affinity: thread %zu left unpinned", index);
+        return -1;
+    }
+#ifdef ARC_THREAD_LOCAL
+    t_memory_node = affinity->local_memory ? node : -1;
+#endif
+    return node;
+}
+
+int ac_affinity_memory_node(void) {
+#ifdef ARC_THREAD_LOCAL
+    return t_memory_node;
+#else
+    return -1;
+#endif
+}
+
+/*============================================================================
+ * Internal: owned copies for long-lived configuration
+ *============================================================================*/
+
+arc_err_t ac_affinity_copy(ac_affinity_t *dst, const ac_affinity_t *src) {
+    memset(dst, 0, sizeof(*dst));
+    if (!src) {
+        return ARC_OK;
+    }
+    *dst = *src;
+    dst->cpus = NULL;
+    if (src->mode == AC_AFFINITY_CPUS) {
+        if (!src->cpus || src->cpu_count == 0) {
+            return ARC_ERR_INVALID_ARG;
+        }
+        int *cpus = (int *)ARC_MALLOC(src->cpu_count * sizeof(int));
+        if (!cpus) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        memcpy(cpus, src->cpus, src->cpu_count * sizeof(int));
+        dst->cpus = cpus;
+    }
+    return ARC_OK;
+}
+
+void ac_affinity_free(ac_affinity_t *affinity) {
+    if (affinity) {
+        ARC_FREE((void *)affinity->cpus);
+        memset(affinity, 0, sizeof(*affinity));
+    }
+}
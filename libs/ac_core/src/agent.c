@@ -8,15 +8,27 @@
 #include "arc/llm.h"
 #include "arc/tool.h"
 #include "arc/message.h"
+#include "arc/tokens.h"
 #include "arc/log.h"
 #include "arc/platform.h"
+#include "arc/metrics.h"
 #include "agent_hooks_internal.h"
+#include "profile.h"
+#include "pthread_port.h"
+#include "executor.h"
+#include "memory/history.h"
+#include "memory/snapshot.h"
+#include "memory/segment.h"
+#include "intern.h"
+#include "json_scan.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 /* Use platform-specific default from platform.h */
 #define DEFAULT_ARENA_SIZE ARC_AGENT_ARENA_SIZE
+#define FORK_ARENA_SIZE    (DEFAULT_ARENA_SIZE / 8)  /* History lives in the shared segment */
+#define AGENT_SCRATCH_SIZE ARC_ARENA_MIN_BLOCK_SIZE
 
 /*============================================================================
  * Forward Declarations
@@ -24,39 +36,140 @@
 
 /* Session internal API */
 arc_err_t ac_session_add_agent(struct ac_session *session, ac_agent_t *agent);
+void ac_session_remove_agent(struct ac_session *session, ac_agent_t *agent);
+void ac_agent_free(ac_agent_t *agent);
+ac_executor_t *ac_session_get_executor(struct ac_session *session);
+const ac_allocator_t *ac_session_get_allocator(struct ac_session *session);
+ac_profiler_t *ac_session_get_profiler(struct ac_session *session);
+ac_hook_chain_t *ac_session_get_hooks(struct ac_session *session);
+
+/* LLM internal API */
+int ac_llm_tools_format(const ac_llm_t *llm);
+int ac_llm_chains_responses(const ac_llm_t *llm);
+const ac_llm_params_t *ac_llm_get_params(const ac_llm_t *llm);
+void ac_llm_set_limits(ac_llm_t *llm, const volatile int *cancel, uint64_t deadline_ms);
+void ac_llm_set_budget(ac_llm_t *llm, int max_tokens, int thinking_budget);
+arc_err_t ac_llm_chat_chained(ac_llm_t *llm, const ac_message_t *messages,
+                              const char *previous_id, const char *tools,
+                              ac_chat_response_t *response);
 
 /*============================================================================
  * Agent Private Data
  *============================================================================*/
 
+/** Budget controller state (see ac_agent_budget_t, agent_budget_pick) */
+typedef struct {
+    int enabled;
+    int thinking;                 /* Full thinking budget, 0 = thinking off */
+    int min_thinking;
+    int max_tokens;               /* Configured max_tokens */
+    int room;                     /* Configured max_tokens beyond the thinking budget */
+    int ceiling;                  /* max_tokens of escalated turns */
+    uint32_t slo_ms;              /* 0 = no latency target */
+
+    /* Observed on the last successful call */
+    int given;                    /* Thinking budget it had */
+    int used;                     /* Thinking tokens it used */
+    int answer;                   /* Other output tokens */
+    int truncated;                /* Finished on length */
+    uint32_t overhead_ms;         /* Average time to the first byte */
+    uint32_t ms_per_ktok;         /* Average time per 1000 output tokens, 0 = no sample yet */
+} agent_budget_t;
+
 typedef struct {
     arena_t *arena;
+    arena_t *scratch;             /* Per-iteration transients, rewound each turn */
     ac_llm_t *llm;
     ac_tool_registry_t *tools;
     struct ac_session *session;
 
+    /* Subscribers of this agent; hook_scope adds the session's */
+    ac_hook_chain_t hooks;
+    ac_hook_scope_t hook_scope;
+
     /* Message history (stored in arena) */
-    ac_message_t *messages;
-    ac_message_t *messages_tail;  /* Tail pointer for O(1) append */
-    size_t message_count;
+    ac_history_t history;
+    size_t max_history_messages;  /* 0 = unlimited */
+    size_t max_history_tokens;    /* 0 = unlimited */
+    size_t context_tokens;        /* Context window less max_tokens, 0 = not set */
+    size_t max_tool_bytes;        /* Tool output cap, 0 = unlimited */
+    const char *spill_dir;        /* Evicted tool output goes here (optional) */
+    struct agent_snapshot *snapshots;  /* Mappings restored messages point into */
+    struct agent_segment *segments;    /* Shared segments messages point into */
+    ac_history_segment_t *base;   /* Segment the history starts with, NULL = none */
+    size_t base_edits;            /* history.edits when base was set */
+    ac_intern_t *intern;          /* Tool names/ids, shared across messages */
+
+    /* Stored response chain (stateful providers, see agent_llm_chat) */
+    const char *chain_id;         /* Last stored response, NULL = no chain */
+    ac_message_t *chain_tail;     /* History message that response became */
+    size_t chain_length;          /* History length up to and including it */
 
     const char *name;
     const char *instructions;
     int max_iterations;
+    int tool_workers;             /* Max concurrent tool calls (<= 1: sequential) */
+    int eager_tools;              /* Dispatch tools while streaming */
+
+    /* Tools schema format spliced by the provider */
+    ac_tool_schema_format_t tools_format;
 
-    /* Cached tools schema (built once at creation) */
-    char *cached_tools_schema;
+    /* Draft model for tool-routing iterations (see agent_draft) */
+    ac_llm_t *draft;              /* NULL = off */
+    const char *draft_model;
+    ac_tool_schema_format_t draft_tools_format;
+    int draft_max_tool_calls;     /* 0 = no limit */
+
+    /* Per-iteration thinking budget and max_tokens */
+    agent_budget_t budget;
 
     /* Streaming callbacks */
     ac_stream_callback_t stream_callback;
     void *callback_user_data;
+    pthread_mutex_t stream_lock;  /* Serializes events from tool threads (agent_stream_emit) */
 
     /* Statistics for hooks */
     uint64_t run_start_time_ms;
     int total_prompt_tokens;
     int total_completion_tokens;
+
+    /* Run state (one conversation at a time) */
+    pthread_mutex_t run_lock;
+    int busy;                     /* A sync or async run is in progress */
+    volatile int cancel_requested;  /* Checked at each ReACT iteration */
+    const volatile int *user_cancel;  /* params.llm.cancel, NULL = none */
+    const volatile int *cancel;   /* What in-flight calls and tools watch */
+    uint64_t deadline_ms;         /* Absolute end of a run, 0 = none */
+    ac_priority_t priority;       /* Executor class of runs and tool jobs */
+    struct agent_stepper *stepper;  /* Stepped run in progress (ac_agent_step) */
+    const ac_attachment_t *attach;  /* Images for the next user message */
+    size_t attach_count;
+
+    /* Messages sent during a run (ac_agent_send), guarded by run_lock */
+    struct agent_input *input;
+    struct agent_input **input_tail;
+    int input_open;               /* A run takes sends (until it has answered) */
 } agent_priv_t;
 
+/** A queued message (heap; text follows the node) */
+typedef struct agent_input {
+    struct agent_input *next;
+    size_t len;
+    char text[];
+} agent_input_t;
+
+/** Snapshot mappings stay until destroy: results may still reference them */
+typedef struct agent_snapshot {
+    ac_snapshot_t *snapshot;
+    struct agent_snapshot *next;
+} agent_snapshot_t;
+
+/** Segment references, held until destroy like snapshot mappings */
+typedef struct agent_segment {
+    ac_history_segment_t *segment;
+    struct agent_segment *next;
+} agent_segment_t;
+
 /*============================================================================
  * Agent Structure
  *============================================================================*/
@@ -66,486 +179,1071 @@ struct ac_agent {
 };
 
 /*============================================================================
- * Message Append Helper (O(1) with tail pointer)
+ * History Helpers
  *============================================================================*/
 
 static void agent_append_message(agent_priv_t *priv, ac_message_t *message) {
     if (!priv || !message) {
         return;
     }
+    if (ac_history_append(&priv->history, message) != ARC_OK) {
+        AC_LOG_ERROR("Failed to grow message history");
+    }
+}
 
-    message->next = NULL;
+/**
+ * @brief Append a tool result message whose large results point into owned
+ *
+ * owned (may be NULL) is handed to the history, or freed if that fails.
+ */
+static void agent_append_owned(agent_priv_t *priv, ac_message_t *message, char *owned) {
+    if (!message) {
+        ARC_FREE(owned);
+        return;
+    }
+    if (ac_history_append_owned(&priv->history, message, owned) != ARC_OK) {
+        AC_LOG_ERROR("Failed to grow message history");
+        ARC_FREE(owned);
+    }
+}
 
-    if (!priv->messages) {
-        priv->messages = message;
-        priv->messages_tail = message;
-    } else {
-        priv->messages_tail->next = message;
-        priv->messages_tail = message;
+/**
+ * @brief Whether a tool result should stay on the heap, owned by history
+ *
+ * Only with a tool output cap: then evicting the result frees it instead
+ * of leaving a dead copy in the arena.
+ */
+static int agent_keeps_on_heap(const agent_priv_t *priv, const char *result) {
+    return priv->max_tool_bytes > 0 && result &&
+           strlen(result) >= AC_HISTORY_ELIDE_MIN_BYTES;
+}
+
+/**
+ * @brief Marker for a tool result that repeats one still in history
+ *
+ * @return 1 if result is a repeat (memory.dedup_tool_results)
+ */
+static int agent_find_repeat(const agent_priv_t *priv, const char *result, char *marker) {
+    return priv->history.dedup && result &&
+           ac_history_find_repeat(&priv->history, result, strlen(result), marker);
+}
+
+/**
+ * @brief History token budget: the configured one, capped by what fits
+ *
+ * With a context window, history gets what the window leaves after the
+ * tools schema and max_tokens, so a long conversation is trimmed here
+ * instead of failing the LLM pre-flight check.
+ */
+static size_t agent_token_budget(agent_priv_t *priv, const char *tools_schema) {
+    if (priv->context_tokens == 0) {
+        return priv->max_history_tokens;
+    }
+
+    size_t tools = ac_tokens_estimate_str(tools_schema, priv->history.family);
+    size_t fits = priv->context_tokens > tools ? priv->context_tokens - tools : 1;
+    if (priv->max_history_tokens > 0 && priv->max_history_tokens < fits) {
+        return priv->max_history_tokens;
+    }
+    return fits;
+}
+
+/**
+ * @brief Trim history to the configured budget before an LLM call
+ */
+static void agent_enforce_history(agent_priv_t *priv, const char *tools_schema) {
+    if (priv->max_tool_bytes > 0) {
+        ac_history_evict(&priv->history, priv->arena,
+                         priv->max_tool_bytes, priv->spill_dir);
+    }
+    size_t max_tokens = agent_token_budget(priv, tools_schema);
+    if (priv->max_history_messages == 0 && max_tokens == 0) {
+        return;
+    }
+    ac_history_enforce(&priv->history, priv->arena,
+                       priv->max_history_messages, max_tokens);
+}
+
+/*============================================================================
+ * Response Chain
+ *
+ * With a stateful provider (responses stored server-side), each request
+ * after the first names the previous response and carries only the
+ * messages appended since: the tool results of the last iteration, or the
+ * new user message. The chain holds while the history up to its tail is
+ * unchanged in length; a turn drop or reset shifts the tail off its index
+ * and the next request starts over with the full history.
+ *============================================================================*/
+
+static void agent_chain_reset(agent_priv_t *priv) {
+    priv->chain_id = NULL;
+    priv->chain_tail = NULL;
+    priv->chain_length = 0;
+}
+
+/**
+ * @brief Messages the next request must carry, and the response it continues
+ */
+static const ac_message_t *agent_chain_delta(agent_priv_t *priv, const char **previous_id) {
+    *previous_id = NULL;
+    if (priv->chain_id && priv->chain_length > 0 &&
+        priv->chain_length <= priv->history.count &&
+        ac_history_at(&priv->history, priv->chain_length - 1) == priv->chain_tail &&
+        priv->chain_tail->next) {
+        *previous_id = priv->chain_id;
+        return priv->chain_tail->next;
+    }
+    return priv->history.head;
+}
+
+/**
+ * @brief Extend the chain by a response that was appended as asst_msg
+ */
+static void agent_chain_advance(agent_priv_t *priv, const ac_chat_response_t *response,
+                                ac_message_t *asst_msg) {
+    if (!ARC_FEATURE_STATEFUL || !ac_llm_chains_responses(priv->llm)) {
+        return;
+    }
+    if (!response->id || !asst_msg || priv->history.tail != asst_msg) {
+        agent_chain_reset(priv);
+        return;
+    }
+    priv->chain_id = arena_strdup(priv->arena, response->id);
+    priv->chain_tail = asst_msg;
+    priv->chain_length = priv->history.count;
+}
+
+/**
+ * @brief Call the LLM, sending only the chain delta when there is a chain
+ *
+ * A chained request the server rejects (expired or unknown response id)
+ * is repeated once with the full history.
+ */
+static arc_err_t agent_llm_chat(agent_priv_t *priv, const char *tools_schema,
+                                ac_chat_response_t *response) {
+    if (!ARC_FEATURE_STATEFUL || !ac_llm_chains_responses(priv->llm)) {
+        return ac_llm_chat_with_tools(priv->llm, priv->history.head, tools_schema, response);
+    }
+
+    const char *previous_id = NULL;
+    const ac_message_t *delta = agent_chain_delta(priv, &previous_id);
+    arc_err_t err = ac_llm_chat_chained(priv->llm, delta, previous_id, tools_schema, response);
+
+    if (err == ARC_ERR_HTTP && previous_id &&
+        (response->http_status == 400 || response->http_status == 404)) {
+        AC_LOG_WARN("Response chain rejected (HTTP %d), resending full history",
+                    response->http_status);
+        agent_chain_reset(priv);
+        ac_chat_response_free(response);
+        err = ac_llm_chat_chained(priv->llm, priv->history.head, NULL, tools_schema, response);
     }
-    priv->message_count++;
+    return err;
 }
 
 /*============================================================================
- * Tool Schema Builder
+ * Tool Schema
  *============================================================================*/
 
-static char *build_tools_schema(agent_priv_t *priv) {
+/**
+ * @brief Serialized tools schema for this agent's provider
+ *
+ * Owned and cached by the registry, rebuilt only after tools are added.
+ */
+static const char *agent_tools_schema(agent_priv_t *priv) {
     if (!priv->tools) {
         return NULL;
     }
-    return ac_tool_registry_schema(priv->tools);
+    return ac_tool_registry_schema_cached(priv->tools, priv->tools_format);
 }
 
 /*============================================================================
- * Tool Execution
+ * Adaptive Budget
+ *
+ * Each iteration's thinking budget and max_tokens are picked from the
+ * kind of turn and what the previous call used (see ac_agent_budget_t).
  *============================================================================*/
 
-static char *execute_tool_call(agent_priv_t *priv, const ac_tool_call_t *call) {
-    if (!call || !call->name) {
-        return ARC_STRDUP("{\"error\":\"Invalid tool call\"}");
+#define AGENT_BUDGET_MIN_THINKING 1024  /* Anthropic's minimum */
+#define AGENT_BUDGET_MIN_SAMPLE   32    /* Output tokens a rate sample needs */
+
+static int response_truncated(const ac_chat_response_t *response) {
+    const char *finish = response->finish_reason ? response->finish_reason : response->stop_reason;
+    return finish && (strcmp(finish, "length") == 0 || strcmp(finish, "max_tokens") == 0);
+}
+
+/**
+ * @brief Thinking tokens of a response: reported, or estimated from its blocks
+ */
+static int response_thinking_tokens(const agent_priv_t *priv, const ac_chat_response_t *response) {
+    if (response->thinking_tokens > 0) {
+        return response->thinking_tokens;
     }
+    if (response->reasoning_tokens > 0) {
+        return response->reasoning_tokens;
+    }
+    size_t tokens = 0;
+    for (const ac_content_block_t *b = response->blocks; b; b = b->next) {
+        if (b->type == AC_BLOCK_THINKING && b->text) {
+            tokens += ac_tokens_estimate(b->text, b->text_len ? b->text_len : strlen(b->text),
+                                         priv->history.family);
+        }
+    }
+    return (int)tokens;
+}
 
-    if (!priv->tools) {
-        AC_LOG_WARN("No tool registry configured");
-        return ARC_STRDUP("{\"error\":\"No tools available\"}");
+/**
+ * @brief Whether the history ends with tool results
+ */
+static int agent_after_tools(const agent_priv_t *priv) {
+    const ac_message_t *tail = priv->history.tail;
+    if (!tail) {
+        return 0;
     }
+    if (tail->role == AC_ROLE_TOOL) {
+        return 1;
+    }
+    return tail->role == AC_ROLE_USER && tail->blocks && tail->blocks->type == AC_BLOCK_TOOL_RESULT;
+}
 
-    ac_tool_ctx_t ctx = {
-        .session_id = NULL,
-        .working_dir = NULL,
-        .user_data = NULL
-    };
+static void agent_budget_init(agent_priv_t *priv, const ac_agent_budget_t *config) {
+    agent_budget_t *b = &priv->budget;
+    const ac_llm_params_t *llm = ac_llm_get_params(priv->llm);
+
+    memset(b, 0, sizeof(*b));
+    b->enabled = config->enabled;
+    b->max_tokens = llm->max_tokens;
+    b->thinking = llm->thinking.enabled ? llm->thinking.budget_tokens : 0;
+    b->min_thinking = config->min_thinking > 0 ? config->min_thinking : AGENT_BUDGET_MIN_THINKING;
+    if (b->min_thinking > b->thinking) {
+        b->min_thinking = b->thinking;
+    }
+    b->room = b->max_tokens > b->thinking ? b->max_tokens - b->thinking : 0;
+    b->ceiling = config->max_tokens > 0 ? config->max_tokens : b->max_tokens;
+    b->slo_ms = config->latency_slo_ms;
+}
 
-    AC_LOG_INFO("Executing tool: %s(%s)", call->name,
-                call->arguments ? call->arguments : "{}");
+/**
+ * @brief Set the next call's thinking budget and max_tokens
+ *
+ * @return ac_budget_reason_t of the choice
+ */
+static ac_budget_reason_t agent_budget_pick(agent_priv_t *priv, int *max_tokens,
+                                            int *thinking) {
+    agent_budget_t *b = &priv->budget;
+    *max_tokens = b->max_tokens;
+    *thinking = b->thinking;
+    if (!b->enabled) {
+        return AC_BUDGET_FIXED;
+    }
 
-    /* Hook: tool start */
-    uint64_t tool_start_ms = ac_platform_timestamp_ms();
-    {
-        ac_hook_tool_start_t hook_info = {
-            .agent_name = priv->name,
-            .id = call->id,
-            .name = call->name,
-            .arguments = call->arguments
-        };
-        AC_HOOK_CALL(ac_hook_call_tool_start, &hook_info);
+    ac_budget_reason_t reason = AC_BUDGET_OPEN;
+    if (b->truncated || (b->given > 0 && b->used * 10 >= b->given * 9)) {
+        *max_tokens = b->ceiling;
+        reason = AC_BUDGET_ESCALATED;
+    } else if (agent_after_tools(priv)) {
+        reason = AC_BUDGET_TOOL_RESULT;
+        if (b->thinking > 0) {
+            int want = b->used * 2;
+            *thinking = want < b->min_thinking ? b->min_thinking :
+                        want > b->thinking ? b->thinking : want;
+        }
     }
 
-    /* Execute */
-    char *result = ac_tool_registry_call(
-        priv->tools,
-        call->name,
-        call->arguments ? call->arguments : "{}",
-        &ctx
-    );
+    /* What the observed output rate produces within the SLO, past the
+     * usual answer; escalated turns keep what they need */
+    if (reason != AC_BUDGET_ESCALATED && b->thinking > 0 && b->slo_ms > b->overhead_ms &&
+        b->ms_per_ktok > 0) {
+        int64_t fits = (int64_t)(b->slo_ms - b->overhead_ms) * 1000 / b->ms_per_ktok - b->answer;
+        if (fits < b->min_thinking) {
+            fits = b->min_thinking;
+        }
+        if (fits < *thinking) {
+            *thinking = (int)fits;
+            reason = AC_BUDGET_SLO;
+        }
+    }
 
-    AC_LOG_DEBUG("Tool %s returned: %s", call->name, result ? result : "NULL");
+    if (reason != AC_BUDGET_ESCALATED && b->thinking > 0 && b->room > 0) {
+        *max_tokens = *thinking + b->room;
+    }
+    b->given = *thinking;
+    ac_llm_set_budget(priv->llm, *max_tokens, *thinking);
+    return reason;
+}
 
-    /* Hook: tool end */
-    uint64_t tool_end_ms = ac_platform_timestamp_ms();
-    {
-        ac_hook_tool_end_t hook_info = {
-            .agent_name = priv->name,
-            .id = call->id,
-            .name = call->name,
-            .result = result,
-            .duration_ms = tool_end_ms - tool_start_ms,
-            .success = (result != NULL && strstr(result, "\"error\"") == NULL) ? 1 : 0
-        };
-        AC_HOOK_CALL(ac_hook_call_tool_end, &hook_info);
+/**
+ * @brief Record what a successful call used, for the next pick
+ */
+static void agent_budget_observe(agent_priv_t *priv, const ac_chat_response_t *response,
+                                 int thinking_tokens, uint64_t duration_ms) {
+    agent_budget_t *b = &priv->budget;
+    if (!b->enabled) {
+        return;
     }
 
-    return result ? result : ARC_STRDUP("{\"error\":\"Tool returned NULL\"}");
+    int output = response->output_tokens > 0 ? response->output_tokens : response->completion_tokens;
+    b->used = thinking_tokens;
+    b->answer = output > thinking_tokens ? output - thinking_tokens : 0;
+    b->truncated = response_truncated(response);
+
+    /* Output rate past the first byte, averaged over the last few calls */
+    uint32_t before = response->timing.ttfb_ms;
+    if (output >= AGENT_BUDGET_MIN_SAMPLE && duration_ms > before) {
+        uint32_t sample = (uint32_t)((duration_ms - before) * 1000 / (uint64_t)output);
+        if (sample > 0) {
+            b->ms_per_ktok = b->ms_per_ktok ? (b->ms_per_ktok * 3 + sample) / 4 : sample;
+            b->overhead_ms = b->overhead_ms ? (b->overhead_ms * 3 + before) / 4 : before;
+        }
+    }
 }
 
 /*============================================================================
- * Copy Tool Calls to Arena
+ * Draft Model
+ *
+ * A fast model proposes the tool calls of an iteration; the agent's llm
+ * only sees iterations the draft declines or gets wrong (see
+ * ac_agent_draft_t).
  *============================================================================*/
 
-static ac_tool_call_t *copy_tool_calls_to_arena(arena_t *arena, ac_tool_call_t *calls) {
-    if (!arena || !calls) {
-        return NULL;
+/**
+ * @brief Whether the draft's tool calls can be executed as proposed
+ */
+static ac_draft_decision_t agent_draft_check(agent_priv_t *priv,
+                                             const ac_chat_response_t *response) {
+    if (!ac_chat_response_has_tool_calls(response)) {
+        return AC_DRAFT_DECLINED;
+    }
+    if (response_truncated(response)) {
+        return AC_DRAFT_REJECTED;
+    }
+    if (priv->draft_max_tool_calls > 0 &&
+        response->tool_call_count > priv->draft_max_tool_calls) {
+        return AC_DRAFT_REJECTED;
     }
 
-    ac_tool_call_t *first = NULL;
-    ac_tool_call_t *last = NULL;
-
-    for (ac_tool_call_t *call = calls; call; call = call->next) {
-        ac_tool_call_t *copy = ac_tool_call_create(
-            arena, call->id, call->name, call->arguments
-        );
-        if (copy) {
-            if (!first) first = copy;
-            if (last) last->next = copy;
-            last = copy;
+    for (const ac_tool_call_t *call = response->tool_calls; call; call = call->next) {
+        if (!call->name || !ac_tool_registry_find(priv->tools, call->name)) {
+            return AC_DRAFT_REJECTED;
+        }
+        ac_str_t args = ac_tool_call_arguments(call);
+        if (args.len > 0) {
+            if (!ac_json_scan_valid(args.ptr, args.len) ||
+                ac_json_scan_root(args.ptr, args.len).kind != AC_JSON_OBJECT) {
+                return AC_DRAFT_REJECTED;
+            }
         }
     }
-
-    return first;
+    return AC_DRAFT_ACCEPTED;
 }
 
-/*============================================================================
- * Agent Run Implementation
- *============================================================================*/
+/**
+ * @brief Ask the draft model for this iteration's tool calls
+ *
+ * @return 1 if the draft was accepted (*response filled, arena-backed),
+ *         0 to ask the agent's llm
+ */
+static int agent_draft(agent_priv_t *priv, ac_chat_response_t *response) {
+    const char *tools_schema =
+        ac_tool_registry_schema_cached(priv->tools, priv->draft_tools_format);
+    if (!tools_schema) {
+        return 0;
+    }
 
-static ac_agent_result_t *agent_run_impl(agent_priv_t *priv, const char *message) {
-    if (!priv || !priv->arena || !priv->llm) {
-        return NULL;
+    {
+        ac_hook_llm_request_t hook_info = {
+            .agent_name = priv->name,
+            .model = priv->draft_model,
+            .messages = priv->history.head,
+            .tools_schema = tools_schema,
+            .message_count = priv->history.count
+        };
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_llm_request, &hook_info);
     }
 
-    /* Initialize run statistics */
-    priv->run_start_time_ms = ac_platform_timestamp_ms();
-    priv->total_prompt_tokens = 0;
-    priv->total_completion_tokens = 0;
+    uint64_t start_ms = ac_platform_timestamp_ms();
+    ac_chat_response_init_arena(response, priv->arena);
+    response->intern = priv->intern;
 
-    size_t tool_count = priv->tools ? ac_tool_registry_count(priv->tools) : 0;
+    arena_set_tag(priv->arena, ARENA_TAG_LLM);
+    arc_err_t err = ac_llm_chat_with_tools(priv->draft, priv->history.head,
+                                           tools_schema, response);
+    arena_set_tag(priv->arena, ARENA_TAG_HISTORY);
+
+    ac_draft_decision_t decision =
+        err == ARC_OK ? agent_draft_check(priv, response) : AC_DRAFT_FAILED;
 
-    /* Hook: run start */
     {
-        ac_hook_run_start_t hook_info = {
+        ac_hook_llm_response_t hook_info = {
             .agent_name = priv->name,
-            .message = message,
-            .instructions = priv->instructions,
-            .max_iterations = priv->max_iterations,
-            .tool_count = tool_count
+            .content = response->content,
+            .tool_calls = response->tool_calls,
+            .tool_call_count = response->tool_call_count,
+            .prompt_tokens = response->prompt_tokens,
+            .completion_tokens = response->completion_tokens,
+            .total_tokens = response->total_tokens,
+            .finish_reason = response->finish_reason,
+            .duration_ms = ac_platform_timestamp_ms() - start_ms,
+            .ratelimit_wait_ms = response->ratelimit_wait_ms,
+            .draft = decision,
+            .timing = response->timing
         };
-        AC_HOOK_CALL(ac_hook_call_run_start, &hook_info);
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_llm_response, &hook_info);
     }
 
-    /* Add system message if this is the first message */
-    if (!priv->messages && priv->instructions) {
-        ac_message_t *sys_msg = ac_message_create(
-            priv->arena, AC_ROLE_SYSTEM, priv->instructions
-        );
-        if (sys_msg) {
-            agent_append_message(priv, sys_msg);
-        }
-    }
+    priv->total_prompt_tokens += response->prompt_tokens;
+    priv->total_completion_tokens += response->completion_tokens;
 
-    /* Add user message to history */
-    ac_message_t *user_msg = ac_message_create(priv->arena, AC_ROLE_USER, message);
-    if (!user_msg) {
-        AC_LOG_ERROR("Failed to create user message");
-        return NULL;
+    if (decision == AC_DRAFT_ACCEPTED) {
+        AC_LOG_DEBUG("Draft accepted: %d tool call(s)", response->tool_call_count);
+        return 1;
     }
-    agent_append_message(priv, user_msg);
+    AC_LOG_DEBUG("Draft escalated (%s)",
+                 decision == AC_DRAFT_DECLINED ? "declined" :
+                 decision == AC_DRAFT_REJECTED ? "rejected" : "failed");
+    ac_chat_response_free(response);
+    return 0;
+}
 
-    AC_LOG_DEBUG("Added user message, total messages: %zu", priv->message_count);
+/*============================================================================
+ * Tool Execution
+ *
+ * Tool calls of one turn are collected into a job array and executed in
+ * call order. When tool_workers > 1, consecutive tools marked parallel_safe
+ * form a batch that runs concurrently; any other tool is a barrier and runs
+ * alone. Hooks always fire on the calling thread, so hook implementations
+ * need no locking: tool_start for every job of a batch before it runs,
+ * tool_end for every job (in call order) after the batch joins. Batch
+ * concurrency is also bounded by the session executor size. Asynchronous
+ * tools in a batch are started on the calling thread and only waited
+ * for, so they take no worker.
+ *============================================================================*/
 
-    /* Use cached tools schema */
-    char *tools_schema = priv->cached_tools_schema;
+typedef struct {
+    const char *id;
+    const char *name;
+    const char *arguments;
+    int parallel_safe;
+    int async;                       /* Tool has execute_async */
+    char *result;                    /* Heap result (caller frees) */
+    int result_in_arena;             /* result is in priv->arena instead */
+    ac_tool_cache_status_t cache_status;
+    ac_tool_usage_t usage;           /* Processes the tool ran */
+    uint64_t start_ms;
+    uint64_t end_ms;
+} tool_job_t;
 
-    /* ReACT loop */
-    char *final_content = NULL;
-    int iteration = 0;
+typedef struct {
+    agent_priv_t *priv;
+    tool_job_t *jobs;
+    int async_started;               /* Async jobs were started up front */
+#ifdef ARC_HAS_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t cond;             /* Signalled when an async job completes */
+    size_t pending;                  /* Async jobs started, not completed */
+#endif
+} tool_batch_t;
 
-    while (iteration < priv->max_iterations) {
-        iteration++;
-        AC_LOG_DEBUG("ReACT iteration %d/%d", iteration, priv->max_iterations);
+typedef struct {
+    agent_priv_t *priv;
+    const tool_job_t *job;
+} tool_progress_relay_t;
 
-        /* Hook: iteration start */
-        {
-            ac_hook_iter_t hook_info = {
-                .agent_name = priv->name,
-                .iteration = iteration,
-                .max_iterations = priv->max_iterations
-            };
-            AC_HOOK_CALL(ac_hook_call_iter_start, &hook_info);
-        }
+/**
+ * @brief Deliver a stream event raised off the streaming thread
+ *
+ * Tool workers report progress concurrently with each other and, with
+ * eager tools, with the LLM stream itself.
+ */
+static int agent_stream_emit(agent_priv_t *priv, const ac_stream_event_t *event) {
+    pthread_mutex_lock(&priv->stream_lock);
+    int rc = priv->stream_callback(event, priv->callback_user_data);
+    pthread_mutex_unlock(&priv->stream_lock);
+    return rc;
+}
 
-        uint64_t llm_start_ms = ac_platform_timestamp_ms();
+/**
+ * @brief Tool progress as AC_STREAM_TOOL_PROGRESS (partial output in delta)
+ */
+static void tool_job_progress(const ac_tool_progress_t *progress, void *user_data) {
+    const tool_progress_relay_t *relay = (const tool_progress_relay_t *)user_data;
+    ac_stream_event_t event = {
+        .type = AC_STREAM_TOOL_PROGRESS,
+        .delta_type = AC_DELTA_TEXT,
+        .delta = progress->message,
+        .delta_len = progress->message_len,
+        .tool_id = relay->job->id,
+        .tool_name = relay->job->name,
+        .progress = progress->progress,
+        .progress_total = progress->total
+    };
+    agent_stream_emit(relay->priv, &event);
+}
 
-        /* Hook: LLM request - pass raw pointers, no JSON serialization here */
-        {
-            ac_hook_llm_request_t hook_info = {
-                .agent_name = priv->name,
-                .model = NULL,
-                .messages = priv->messages,
-                .tools_schema = tools_schema,
-                .message_count = priv->message_count
-            };
-            AC_HOOK_CALL(ac_hook_call_llm_request, &hook_info);
-        }
+/* Internal - result placed in the caller's arena (tool.c) */
+extern char *ac_tool_registry_call_into(ac_tool_registry_t *registry, const char *name,
+                                        const char *args_json, const ac_tool_ctx_t *ctx,
+                                        arena_t *arena);
 
-        /* Call LLM */
-        ac_chat_response_t response;
-        ac_chat_response_init(&response);
+/* Internal - start without waiting, done gets the heap result (tool.c) */
+extern void ac_tool_registry_call_async(ac_tool_registry_t *registry, const char *name,
+                                        const char *args_json, const ac_tool_ctx_t *ctx,
+                                        void (*done)(char *result, void *arg), void *arg);
 
-        arc_err_t err = ac_llm_chat_with_tools(
-            priv->llm,
-            priv->messages,
-            tools_schema,
-            &response
-        );
+/**
+ * @brief Arena a tool run on the agent thread writes its result into
+ *
+ * NULL with a tool output cap, so large results can stay on the heap.
+ */
+static arena_t *agent_result_arena(const agent_priv_t *priv) {
+    return priv->max_tool_bytes > 0 ? NULL : priv->arena;
+}
 
-        uint64_t llm_end_ms = ac_platform_timestamp_ms();
+/**
+ * @brief Whether the run should stop: cancelled, token set or deadline passed
+ *
+ * Folds the token and the deadline into cancel_requested, so the checks
+ * after the loop treat all three alike.
+ */
+static int agent_stopping(agent_priv_t *priv) {
+    if (!priv->cancel_requested &&
+        ((priv->user_cancel && *priv->user_cancel) ||
+         (priv->deadline_ms && ac_platform_timestamp_ms() >= priv->deadline_ms))) {
+        priv->cancel_requested = 1;
+    }
+    return priv->cancel_requested;
+}
 
-        /* Hook: LLM response - pass raw pointer, no JSON serialization here */
-        {
-            ac_hook_llm_response_t hook_info = {
-                .agent_name = priv->name,
-                .content = response.content,
-                .tool_calls = response.tool_calls,
-                .tool_call_count = response.tool_call_count,
-                .prompt_tokens = response.prompt_tokens,
-                .completion_tokens = response.completion_tokens,
-                .total_tokens = response.total_tokens,
-                .finish_reason = response.finish_reason,
-                .duration_ms = llm_end_ms - llm_start_ms
-            };
-            AC_HOOK_CALL(ac_hook_call_llm_response, &hook_info);
-        }
+/**
+ * @brief Point the models at this run's cancel flag and deadline
+ */
+static void agent_run_limits(agent_priv_t *priv) {
+    ac_llm_set_limits(priv->llm, priv->cancel, priv->deadline_ms);
+    if (priv->draft) {
+        ac_llm_set_limits(priv->draft, priv->cancel, priv->deadline_ms);
+    }
+}
 
-        /* Accumulate token usage */
-        priv->total_prompt_tokens += response.prompt_tokens;
-        priv->total_completion_tokens += response.completion_tokens;
+static void tool_job_init(agent_priv_t *priv, tool_job_t *job,
+                          const char *id, const char *name, const char *arguments) {
+    memset(job, 0, sizeof(*job));
+    job->id = id;
+    job->name = name;
+    job->arguments = arguments;
+
+    if (priv->tools && name) {
+        const ac_tool_t *tool = ac_tool_registry_find(priv->tools, name);
+        job->parallel_safe = tool ? tool->parallel_safe : 0;
+        job->async = tool && tool->execute_async;
+    }
+}
 
-        if (err != ARC_OK) {
-            AC_LOG_ERROR("LLM chat failed: %d", err);
-            ac_chat_response_free(&response);
-            return NULL;
-        }
+static void tool_job_ctx(agent_priv_t *priv, tool_job_t *job,
+                         tool_progress_relay_t *relay, ac_tool_ctx_t *ctx) {
+    relay->priv = priv;
+    relay->job = job;
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->cache_status = &job->cache_status;
+    ctx->usage = &job->usage;
+    ctx->owner = priv;
+    ctx->on_progress = priv->stream_callback ? tool_job_progress : NULL;
+    ctx->progress_user_data = relay;
+    ctx->cancel = priv->cancel;
+    ctx->deadline_ms = priv->deadline_ms;
+}
 
-        /* Check if there are tool calls */
-        if (ac_chat_response_has_tool_calls(&response)) {
-            AC_LOG_INFO("LLM requested %d tool call(s)", response.tool_call_count);
+/**
+ * @brief Execute one job (may run on a worker thread, no hooks here)
+ *
+ * @param arena  Where the result goes, priv->arena on the agent thread
+ *               only (NULL = heap)
+ */
+static void tool_job_execute(agent_priv_t *priv, tool_job_t *job, arena_t *arena) {
+    job->start_ms = ac_platform_timestamp_ms();
 
-            /* Copy tool calls to arena and add assistant message */
-            ac_tool_call_t *arena_calls = copy_tool_calls_to_arena(
-                priv->arena, response.tool_calls
+    if (!job->name) {
+        job->result = ARC_STRDUP("{\"error\":\"Invalid tool call\"}");
+    } else if (!priv->tools) {
+        AC_LOG_WARN("No tool registry configured");
+        job->result = ARC_STRDUP("{\"error\":\"No tools available\"}");
+    } else if (agent_stopping(priv)) {
+        /* Still queued when the run was stopped */
+        job->result = ARC_STRDUP("{\"error\":\"Cancelled\"}");
+    } else {
+        tool_progress_relay_t relay;
+        ac_tool_ctx_t ctx;
+        tool_job_ctx(priv, job, &relay, &ctx);
+
+        AC_LOG_INFO("Executing tool: %s(%s)", job->name,
+                    job->arguments ? job->arguments : "{}");
+
+        if (arena) {
+            int tag = arena_set_tag(arena, ARENA_TAG_TOOLS);
+            job->result = ac_tool_registry_call_into(
+                priv->tools,
+                job->name,
+                job->arguments ? job->arguments : "{}",
+                &ctx,
+                arena
             );
-
-            ac_message_t *asst_msg = ac_message_create_with_tool_calls(
-                priv->arena, response.content, arena_calls
+            arena_set_tag(arena, tag);
+            job->result_in_arena = job->result != NULL;
+        } else {
+            job->result = ac_tool_registry_call(
+                priv->tools,
+                job->name,
+                job->arguments ? job->arguments : "{}",
+                &ctx
             );
+        }
 
-            if (asst_msg) {
-                agent_append_message(priv, asst_msg);
-            }
+        AC_LOG_DEBUG("Tool %s returned: %s", job->name,
+                     job->result ? job->result : "NULL");
 
-            /* Execute each tool call and add results */
-            for (ac_tool_call_t *call = response.tool_calls; call; call = call->next) {
-                char *result = execute_tool_call(priv, call);
+        if (!job->result) {
+            job->result = ARC_STRDUP("{\"error\":\"Tool returned NULL\"}");
+        }
+    }
 
-                ac_message_t *tool_msg = ac_message_create_tool_result(
-                    priv->arena,
-                    call->id,
-                    result ? result : "{\"error\":\"Tool execution failed\"}"
-                );
+    job->end_ms = ac_platform_timestamp_ms();
+}
 
-                if (tool_msg) {
-                    agent_append_message(priv, tool_msg);
-                }
+#ifdef ARC_HAS_THREADS
 
-                if (result) ARC_FREE(result);
-            }
+/**
+ * @brief Store the result of a job started with tool_job_start()
+ */
+static void tool_job_complete(tool_job_t *job, char *result) {
+    AC_LOG_DEBUG("Tool %s returned: %s", job->name, result ? result : "NULL");
+    job->result = result ? result : ARC_STRDUP("{\"error\":\"Tool returned NULL\"}");
+    job->end_ms = ac_platform_timestamp_ms();
+}
 
-            /* Hook: iteration end */
-            {
-                ac_hook_iter_t hook_info = {
-                    .agent_name = priv->name,
-                    .iteration = iteration,
-                    .max_iterations = priv->max_iterations
-                };
-                AC_HOOK_CALL(ac_hook_call_iter_end, &hook_info);
-            }
+/**
+ * @brief Start an async job (job->async, priv->tools set) without waiting
+ *
+ * done runs exactly once, on whichever thread completes the tool (maybe
+ * this one, before returning), and must call tool_job_complete(). The
+ * progress callback is only relayed while the tool is being started.
+ */
+static void tool_job_start(agent_priv_t *priv, tool_job_t *job,
+                           void (*done)(char *result, void *arg), void *arg) {
+    if (agent_stopping(priv)) {
+        job->start_ms = ac_platform_timestamp_ms();
+        done(ARC_STRDUP("{\"error\":\"Cancelled\"}"), arg);
+        return;
+    }
 
-            ac_chat_response_free(&response);
-            continue;
-        }
+    tool_progress_relay_t relay;
+    ac_tool_ctx_t ctx;
+    tool_job_ctx(priv, job, &relay, &ctx);
 
-        /* No tool calls - we have the final response */
-        if (response.content) {
-            final_content = arena_strdup(priv->arena, response.content);
+    AC_LOG_INFO("Starting tool: %s(%s)", job->name,
+                job->arguments ? job->arguments : "{}");
 
-            ac_message_t *asst_msg = ac_message_create(
-                priv->arena, AC_ROLE_ASSISTANT, response.content
-            );
-            if (asst_msg) {
-                agent_append_message(priv, asst_msg);
-            }
-        }
+    job->start_ms = ac_platform_timestamp_ms();
+    ac_tool_registry_call_async(
+        priv->tools,
+        job->name,
+        job->arguments ? job->arguments : "{}",
+        &ctx,
+        done,
+        arg
+    );
+}
 
-        /* Hook: iteration end */
-        {
-            ac_hook_iter_t hook_info = {
-                .agent_name = priv->name,
-                .iteration = iteration,
-                .max_iterations = priv->max_iterations
-            };
-            AC_HOOK_CALL(ac_hook_call_iter_end, &hook_info);
-        }
+#endif /* ARC_HAS_THREADS */
 
-        ac_chat_response_free(&response);
-        break;
+static void tool_job_hook_start(agent_priv_t *priv, const tool_job_t *job) {
+    ac_hook_tool_start_t hook_info = {
+        .agent_name = priv->name,
+        .id = job->id,
+        .name = job->name,
+        .arguments = job->arguments
+    };
+    AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_tool_start, &hook_info);
+}
+
+static void tool_job_hook_end(agent_priv_t *priv, const tool_job_t *job) {
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+#if ARC_FEATURE_MCP
+    /* Only MCP tools have a result cache */
+    if (job->cache_status != AC_TOOL_CACHE_NONE) {
+        ac_tool_registry_mcp_cache_stats(priv->tools, &cache_hits, &cache_misses);
     }
+#endif
+
+    ac_hook_tool_end_t hook_info = {
+        .agent_name = priv->name,
+        .id = job->id,
+        .name = job->name,
+        .result = job->result,
+        .duration_ms = job->end_ms - job->start_ms,
+        .success = (job->result != NULL && strstr(job->result, "\"error\"") == NULL) ? 1 : 0,
+        .cache_status = job->cache_status,
+        .cache_hits = cache_hits,
+        .cache_misses = cache_misses,
+        .processes = job->usage.processes,
+        .cpu_usec = job->usage.cpu_usec,
+        .memory_peak = job->usage.memory_peak,
+        .io_read_bytes = job->usage.io_read_bytes,
+        .io_write_bytes = job->usage.io_write_bytes
+    };
+    AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_tool_end, &hook_info);
 
-    if (iteration >= priv->max_iterations && !final_content) {
-        AC_LOG_WARN("ReACT loop reached max iterations (%d)", priv->max_iterations);
+    ac_metric_add(ac_metrics_counter("arc_tool_calls", NULL, "Tool calls run by agents"), 1);
+    if (!hook_info.success) {
+        ac_metric_add(ac_metrics_counter("arc_tool_errors", NULL, "Tool calls that returned an error"), 1);
     }
+    ac_metric_observe(ac_metrics_histogram("arc_tool_duration_seconds", NULL,
+                                           "Tool call time", 1e-6),
+                      hook_info.duration_ms * 1000);
+}
 
-    /* Hook: run end */
-    uint64_t run_end_ms = ac_platform_timestamp_ms();
-    {
-        ac_hook_run_end_t hook_info = {
-            .agent_name = priv->name,
-            .content = final_content,
-            .iterations = iteration,
-            .total_prompt_tokens = priv->total_prompt_tokens,
-            .total_completion_tokens = priv->total_completion_tokens,
-            .duration_ms = run_end_ms - priv->run_start_time_ms
-        };
-        AC_HOOK_CALL(ac_hook_call_run_end, &hook_info);
+static void tool_batch_job(void *arg, size_t index) {
+    tool_batch_t *batch = (tool_batch_t *)arg;
+    tool_job_t *job = &batch->jobs[index];
+    if (batch->async_started && job->async && job->name) {
+        return;
     }
+    tool_job_execute(batch->priv, job, NULL);
+}
 
-    /* Allocate result from agent's arena */
-    ac_agent_result_t *result = (ac_agent_result_t *)arena_alloc(
-        priv->arena, sizeof(ac_agent_result_t)
-    );
+#ifdef ARC_HAS_THREADS
 
-    if (!result) {
-        AC_LOG_ERROR("Failed to allocate result from arena");
-        return NULL;
-    }
+typedef struct {
+    tool_batch_t *batch;
+    tool_job_t *job;
+} tool_batch_async_t;
 
-    result->content = final_content;
+static void tool_batch_async_done(char *result, void *arg) {
+    tool_batch_async_t *ref = (tool_batch_async_t *)arg;
+    tool_batch_t *batch = ref->batch;
 
-    AC_LOG_DEBUG("Agent run completed after %d iterations, total messages: %zu",
-                 iteration, priv->message_count);
-    return result;
-}
+    tool_job_complete(ref->job, result);
 
-/*============================================================================
- * Agent Run Implementation (Streaming Mode)
- *============================================================================*/
+    pthread_mutex_lock(&batch->lock);
+    batch->pending--;
+    pthread_cond_broadcast(&batch->cond);
+    pthread_mutex_unlock(&batch->lock);
+}
 
 /**
- * @brief Check if response has tool use blocks
+ * @brief Start the batch's async jobs; the rest run in parallel meanwhile
+ *
+ * Sets async_started (then tool_batch_job() skips those jobs and
+ * tool_batch_wait() must be called); otherwise async jobs run like the
+ * others.
  */
-static int response_has_tool_use(const ac_chat_response_t* response) {
-    if (!response) return 0;
-    for (ac_content_block_t* b = response->blocks; b; b = b->next) {
-        if (b->type == AC_BLOCK_TOOL_USE) {
-            return 1;
+static void tool_batch_start_async(tool_batch_t *batch, size_t count) {
+    size_t async = 0;
+    for (size_t i = 0; i < count; i++) {
+        async += batch->jobs[i].async && batch->jobs[i].name;
+    }
+    if (async == 0) {
+        return;
+    }
+
+    tool_batch_async_t *refs = (tool_batch_async_t *)arena_alloc(
+        batch->priv->scratch, async * sizeof(tool_batch_async_t));
+    if (!refs) {
+        return;
+    }
+    if (pthread_mutex_init(&batch->lock, NULL) != 0) {
+        return;
+    }
+    if (pthread_cond_init(&batch->cond, NULL) != 0) {
+        pthread_mutex_destroy(&batch->lock);
+        return;
+    }
+
+    /* Counted up front: a tool may complete before tool_job_start() returns */
+    batch->pending = async;
+    batch->async_started = 1;
+
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        tool_job_t *job = &batch->jobs[i];
+        if (!job->async || !job->name) {
+            continue;
         }
+        refs[n].batch = batch;
+        refs[n].job = job;
+        tool_job_start(batch->priv, job, tool_batch_async_done, &refs[n]);
+        n++;
     }
-    return 0;
 }
 
-/**
- * @brief Execute tool from content block and return result
- */
-static char *execute_tool_block(agent_priv_t *priv, const ac_content_block_t *block) {
-    if (!block || !block->name) {
-        return ARC_STRDUP("{\"error\":\"Invalid tool block\"}");
+static void tool_batch_wait(tool_batch_t *batch) {
+    pthread_mutex_lock(&batch->lock);
+    while (batch->pending > 0) {
+        pthread_cond_wait(&batch->cond, &batch->lock);
     }
+    pthread_mutex_unlock(&batch->lock);
 
-    if (!priv->tools) {
-        AC_LOG_WARN("No tool registry configured");
-        return ARC_STRDUP("{\"error\":\"No tools available\"}");
-    }
+    pthread_cond_destroy(&batch->cond);
+    pthread_mutex_destroy(&batch->lock);
+}
+
+#endif /* ARC_HAS_THREADS */
 
-    ac_tool_ctx_t ctx = {
-        .session_id = NULL,
-        .working_dir = NULL,
-        .user_data = NULL
+/**
+ * @brief Run a batch of jobs with up to priv->tool_workers at once
+ *
+ * Helpers come from the session executor and the calling thread takes
+ * part, so a busy or missing executor only reduces concurrency.
+ */
+static void tool_batch_run(agent_priv_t *priv, tool_job_t *jobs, size_t count) {
+    tool_batch_t batch = {
+        .priv = priv,
+        .jobs = jobs
     };
 
-    AC_LOG_INFO("Executing tool: %s(%s)", block->name,
-                block->input ? block->input : "{}");
+#ifdef ARC_HAS_THREADS
+    tool_batch_start_async(&batch, count);
+#endif
+
+    ac_executor_parallel_for(
+        ac_session_get_executor(priv->session),
+        count,
+        (size_t)priv->tool_workers,
+        tool_batch_job,
+        &batch,
+        priv->priority
+    );
 
-    /* Hook: tool start */
-    uint64_t tool_start_ms = ac_platform_timestamp_ms();
-    {
-        ac_hook_tool_start_t hook_info = {
-            .agent_name = priv->name,
-            .id = block->id,
-            .name = block->name,
-            .arguments = block->input
-        };
-        AC_HOOK_CALL(ac_hook_call_tool_start, &hook_info);
+#ifdef ARC_HAS_THREADS
+    if (batch.async_started) {
+        tool_batch_wait(&batch);
     }
+#endif
+}
 
-    /* Execute */
-    char *result = ac_tool_registry_call(
-        priv->tools,
-        block->name,
-        block->input ? block->input : "{}",
-        &ctx
-    );
+/**
+ * @brief Execute all jobs of a turn, firing hooks and preserving order
+ */
+static void execute_tool_jobs(agent_priv_t *priv, tool_job_t *jobs, size_t count) {
+    size_t i = 0;
+
+    while (i < count) {
+        /* Extend the batch over consecutive parallel-safe tools */
+        size_t end = i + 1;
+        if (priv->tool_workers > 1 && jobs[i].parallel_safe) {
+            while (end < count && jobs[end].parallel_safe) {
+                end++;
+            }
+        }
 
-    AC_LOG_DEBUG("Tool %s returned: %s", block->name, result ? result : "NULL");
+        for (size_t j = i; j < end; j++) {
+            tool_job_hook_start(priv, &jobs[j]);
+        }
 
-    /* Hook: tool end */
-    uint64_t tool_end_ms = ac_platform_timestamp_ms();
-    {
-        ac_hook_tool_end_t hook_info = {
-            .agent_name = priv->name,
-            .id = block->id,
-            .name = block->name,
-            .result = result,
-            .duration_ms = tool_end_ms - tool_start_ms,
-            .success = (result != NULL && strstr(result, "\"error\"") == NULL) ? 1 : 0
-        };
-        AC_HOOK_CALL(ac_hook_call_tool_end, &hook_info);
+        if (end - i > 1) {
+            AC_LOG_DEBUG("Running %zu tool calls in parallel", end - i);
+            tool_batch_run(priv, &jobs[i], end - i);
+        } else {
+            tool_job_execute(priv, &jobs[i], agent_result_arena(priv));
+        }
+
+        for (size_t j = i; j < end; j++) {
+            tool_job_hook_end(priv, &jobs[j]);
+        }
+
+        i = end;
     }
+}
 
-    return result ? result : ARC_STRDUP("{\"error\":\"Tool returned NULL\"}");
+/**
+ * @brief Allocate a turn's job array from the scratch arena
+ */
+static tool_job_t *alloc_tool_jobs(agent_priv_t *priv, size_t count) {
+    return (tool_job_t *)arena_alloc(priv->scratch, count * sizeof(tool_job_t));
 }
 
 /**
- * @brief Create tool result message from response blocks
+ * @brief Free tool results (the array itself lives in scratch)
  */
-static ac_message_t* create_tool_results_message(agent_priv_t *priv, const ac_chat_response_t* response) {
-    if (!response || !response->blocks) return NULL;
+static void free_tool_jobs(tool_job_t *jobs, size_t count) {
+    if (!jobs) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (jobs[i].result && !jobs[i].result_in_arena) ARC_FREE(jobs[i].result);
+    }
+}
 
-    /* Create tool result message (user role for Anthropic API) */
-    ac_message_t* result_msg = (ac_message_t*)arena_alloc(priv->arena, sizeof(ac_message_t));
-    if (!result_msg) return NULL;
-    memset(result_msg, 0, sizeof(ac_message_t));
-    result_msg->role = AC_ROLE_USER;
+/*============================================================================
+ * Agent Run Implementation
+ *============================================================================*/
 
-    ac_content_block_t* last_block = NULL;
+/**
+ * @brief ReACT loop state carried between phases
+ *
+ * An iteration is react_iter_begin(), react_llm_call(), react_llm_done()
+ * and, when the model asked for tools, react_tools_run() and
+ * react_tools_done(). agent_run_impl() runs them back to back; a stepped
+ * run (ac_agent_step) runs the rest on the caller's thread and the two
+ * blocking ones elsewhere: the model call on the HTTP pool's engine when
+ * it can (react_llm_begin(), ac_llm_chat_submit(), react_llm_end()),
+ * otherwise on the session executor like the tools.
+ */
+typedef struct {
+    int iteration;
+    int drafted;                  /* response came from the draft model */
+    int failed;                   /* Run ends without a result */
+    const char *tools_schema;
+    ac_chat_response_t response;
+    arc_err_t llm_err;
+    uint64_t llm_start_ms;
+    tool_job_t *jobs;             /* This turn's tool calls (scratch) */
+    size_t job_count;
+    char *final_content;
+    arena_mark_t iter_mark;
+    ac_profiler_t *prof;          /* NULL = iterations not profiled */
+} agent_react_t;
 
-    for (ac_content_block_t* b = response->blocks; b; b = b->next) {
-        if (b->type != AC_BLOCK_TOOL_USE) continue;
-        if (!b->id || !b->name) continue;
+/*============================================================================
+ * Input Queue
+ *
+ * Messages sent while a run is in progress are queued and joined into a
+ * single user message at the next iteration boundary: after the tool
+ * results, or after the answer, in which case the loop goes on instead
+ * of ending. Once a run has answered with the queue empty, sends are
+ * refused, so the caller starts a new run. Anything the run could no
+ * longer take (it failed, was cancelled or ran out of iterations) opens
+ * the next run, ahead of its own message.
+ *============================================================================*/
 
-        /* Execute the tool */
-        char* tool_result = execute_tool_block(priv, b);
-        int is_error = (tool_result && strstr(tool_result, "\"error\"") != NULL);
+/**
+ * @brief Accept sends from now on (the run is starting)
+ */
+static void agent_input_open(agent_priv_t *priv) {
+    pthread_mutex_lock(&priv->run_lock);
+    priv->input_open = 1;
+    pthread_mutex_unlock(&priv->run_lock);
+}
 
-        /* Create tool_result content block */
-        ac_content_block_t* result_block = (ac_content_block_t*)arena_alloc(priv->arena, sizeof(ac_content_block_t));
-        if (!result_block) {
-            if (tool_result) ARC_FREE(tool_result);
-            continue;
-        }
-        memset(result_block, 0, sizeof(ac_content_block_t));
-        result_block->type = AC_BLOCK_TOOL_RESULT;
-        result_block->id = arena_strdup(priv->arena, b->id);
-        result_block->text = arena_strdup(priv->arena, tool_result ? tool_result : "{}");
-        result_block->is_error = is_error;
+/**
+ * @brief Take the queued messages, joined with blank lines, into the arena
+ *
+ * @param last  The run ends unless something is queued: close the queue
+ * @return Joined text, NULL if nothing was queued
+ */
+static char *agent_input_take(agent_priv_t *priv, int last, size_t *count) {
+    pthread_mutex_lock(&priv->run_lock);
+    agent_input_t *input = priv->input;
+    priv->input = NULL;
+    priv->input_tail = &priv->input;
+    if (!input && last) {
+        priv->input_open = 0;
+    }
+    pthread_mutex_unlock(&priv->run_lock);
 
-        if (tool_result) ARC_FREE(tool_result);
+    size_t len = 0;
+    *count = 0;
+    for (agent_input_t *in = input; in; in = in->next) {
+        len += in->len + (in != input ? 2 : 0);
+        (*count)++;
+    }
 
-        /* Append to result message */
-        if (!result_msg->blocks) {
-            result_msg->blocks = result_block;
-        } else {
-            last_block->next = result_block;
+    char *text = input ? (char *)arena_alloc(priv->arena, len + 1) : NULL;
+    char *p = text;
+    while (input) {
+        agent_input_t *next = input->next;
+        if (p) {
+            if (p != text) {
+                memcpy(p, "\n\n", 2);
+                p += 2;
+            }
+            memcpy(p, input->text, input->len);
+            p += input->len;
         }
-        last_block = result_block;
+        ARC_FREE(input);
+        input = next;
+    }
+    if (p) {
+        *p = '\0';
+    } else if (*count > 0) {
+        AC_LOG_ERROR("Failed to allocate %zu queued message(s)", *count);
+    }
+    return text;
+}
+
+/**
+ * @brief Append what was sent during the run as one user message
+ *
+ * @return 1 if a message was added
+ */
+static int agent_input_append(agent_priv_t *priv, int last) {
+    size_t count;
+    char *text = agent_input_take(priv, last, &count);
+    if (!text) {
+        return 0;
     }
 
-    return result_msg->blocks ? result_msg : NULL;
+    ac_message_t *user_msg = ac_message_create(priv->arena, AC_ROLE_USER, text);
+    if (!user_msg) {
+        AC_LOG_ERROR("Failed to create user message");
+        return 0;
+    }
+    agent_append_message(priv, user_msg);
+    AC_LOG_INFO("Added %zu message(s) sent during the run", count);
+    return 1;
 }
 
-static ac_agent_result_t *agent_run_stream_impl(agent_priv_t *priv, const char *message) {
-    if (!priv || !priv->arena || !priv->llm) {
+/**
+ * @brief After an answer: continue with what was sent meanwhile, if the run can
+ */
+static int agent_input_continue(agent_priv_t *priv, int iteration, int failed) {
+    if (failed || agent_stopping(priv) || iteration >= priv->max_iterations) {
+        return 0;
+    }
+    return agent_input_append(priv, 1);
+}
+
+/**
+ * @brief The run's user message, with the images of ac_agent_run_attached()
+ *
+ * Messages left queued by the previous run come first, in the same turn.
+ */
+static ac_message_t *agent_user_message(agent_priv_t *priv, const char *message) {
+    size_t count;
+    char *queued = agent_input_take(priv, 0, &count);
+    if (queued) {
+        size_t len = strlen(queued) + 2 + strlen(message);
+        char *joined = (char *)arena_alloc(priv->arena, len + 1);
+        if (!joined) {
+            AC_LOG_ERROR("Failed to create user message");
+            return NULL;
+        }
+        snprintf(joined, len + 1, "%s\n\n%s", queued, message);
+        message = joined;
+    }
+
+    ac_message_t *user_msg = ac_message_create(priv->arena, AC_ROLE_USER, message);
+    if (!user_msg) {
+        AC_LOG_ERROR("Failed to create user message");
         return NULL;
     }
+    for (size_t i = 0; i < priv->attach_count; i++) {
+        ac_content_block_t *image = ac_block_create_image(priv->arena, &priv->attach[i]);
+        if (!image) {
+            return NULL;
+        }
+        ac_block_append(&user_msg->blocks, image);
+    }
+    return user_msg;
+}
+
+/**
+ * @brief Fire run_start and append the system and user messages
+ *
+ * message NULL continues the history as it stands.
+ *
+ * @return 0 if the user message could not be added
+ */
+static int react_begin(agent_priv_t *priv, agent_react_t *r, const char *message) {
+    agent_run_limits(priv);
 
     /* Initialize run statistics */
     priv->run_start_time_ms = ac_platform_timestamp_ms();
@@ -558,16 +1256,18 @@ static ac_agent_result_t *agent_run_stream_impl(agent_priv_t *priv, const char *
     {
         ac_hook_run_start_t hook_info = {
             .agent_name = priv->name,
-            .message = message,
+            .message = message ? message : "",
             .instructions = priv->instructions,
             .max_iterations = priv->max_iterations,
             .tool_count = tool_count
         };
-        AC_HOOK_CALL(ac_hook_call_run_start, &hook_info);
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_run_start, &hook_info);
     }
 
+    arena_set_tag(priv->arena, ARENA_TAG_HISTORY);
+
     /* Add system message if this is the first message */
-    if (!priv->messages && priv->instructions) {
+    if (!priv->history.head && priv->instructions) {
         ac_message_t *sys_msg = ac_message_create(
             priv->arena, AC_ROLE_SYSTEM, priv->instructions
         );
@@ -577,159 +1277,323 @@ static ac_agent_result_t *agent_run_stream_impl(agent_priv_t *priv, const char *
     }
 
     /* Add user message to history */
-    ac_message_t *user_msg = ac_message_create(priv->arena, AC_ROLE_USER, message);
-    if (!user_msg) {
-        AC_LOG_ERROR("Failed to create user message");
-        return NULL;
+    if (message) {
+        ac_message_t *user_msg = agent_user_message(priv, message);
+        if (!user_msg) {
+            return 0;
+        }
+        agent_append_message(priv, user_msg);
     }
-    agent_append_message(priv, user_msg);
 
-    AC_LOG_DEBUG("Added user message, total messages: %zu", priv->message_count);
+    AC_LOG_DEBUG("Added user message, total messages: %zu", priv->history.count);
 
-    /* Use cached tools schema */
-    char *tools_schema = priv->cached_tools_schema;
+    r->iter_mark = arena_mark(priv->scratch);
+    return 1;
+}
 
-    /* ReACT loop with streaming */
-    char *final_content = NULL;
-    int iteration = 0;
+/**
+ * @brief Start the next iteration: hooks, schema, history budget
+ *
+ * @return 0 once the loop is over (max iterations or cancelled)
+ */
+static int react_iter_begin(agent_priv_t *priv, agent_react_t *r) {
+    arena_rewind(priv->scratch, r->iter_mark);
 
-    while (iteration < priv->max_iterations) {
-        iteration++;
-        AC_LOG_DEBUG("ReACT streaming iteration %d/%d", iteration, priv->max_iterations);
+    if (r->iteration >= priv->max_iterations) {
+        return 0;
+    }
+    if (agent_stopping(priv)) {
+        AC_LOG_INFO("Agent run cancelled before iteration %d", r->iteration + 1);
+        return 0;
+    }
 
-        /* Hook: iteration start */
-        {
-            ac_hook_iter_t hook_info = {
-                .agent_name = priv->name,
-                .iteration = iteration,
-                .max_iterations = priv->max_iterations
-            };
-            AC_HOOK_CALL(ac_hook_call_iter_start, &hook_info);
-        }
+    agent_input_append(priv, 0);
 
-        uint64_t llm_start_ms = ac_platform_timestamp_ms();
+    r->iteration++;
+    AC_LOG_DEBUG("ReACT iteration %d/%d", r->iteration, priv->max_iterations);
+    ac_profiler_iter_begin(r->prof, priv->name, r->iteration);
 
-        /* Hook: LLM request */
-        {
-            ac_hook_llm_request_t hook_info = {
-                .agent_name = priv->name,
-                .model = NULL,
-                .messages = priv->messages,
-                .tools_schema = tools_schema,
-                .message_count = priv->message_count
-            };
-            AC_HOOK_CALL(ac_hook_call_llm_request, &hook_info);
-        }
+    /* Hook: iteration start */
+    {
+        ac_hook_iter_t hook_info = {
+            .agent_name = priv->name,
+            .iteration = r->iteration,
+            .max_iterations = priv->max_iterations
+        };
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_iter_start, &hook_info);
+    }
 
-        /* Call LLM with streaming */
-        ac_chat_response_t response = {0};
-        arc_err_t err = ac_llm_chat_stream(
-            priv->llm,
-            priv->messages,
-            tools_schema,
-            priv->stream_callback,
-            priv->callback_user_data,
-            &response
-        );
+    r->tools_schema = agent_tools_schema(priv);
+    agent_enforce_history(priv, r->tools_schema);
+    r->drafted = 0;
+    r->llm_err = ARC_OK;
+    return 1;
+}
 
-        uint64_t llm_end_ms = ac_platform_timestamp_ms();
+/**
+ * @brief Set up a model call: budget, request hook, empty response
+ */
+static void react_llm_begin(agent_priv_t *priv, agent_react_t *r) {
+    int max_tokens, thinking_budget;
+    ac_budget_reason_t budget_reason = agent_budget_pick(priv, &max_tokens, &thinking_budget);
 
-        /* Hook: LLM response */
-        {
-            ac_hook_llm_response_t hook_info = {
-                .agent_name = priv->name,
-                .content = response.content,
-                .tool_calls = NULL,
-                .tool_call_count = 0,
-                .prompt_tokens = response.input_tokens,
-                .completion_tokens = response.output_tokens,
-                .total_tokens = response.input_tokens + response.output_tokens,
-                .finish_reason = response.stop_reason,
-                .duration_ms = llm_end_ms - llm_start_ms
-            };
-            AC_HOOK_CALL(ac_hook_call_llm_response, &hook_info);
-        }
+    r->llm_start_ms = ac_platform_timestamp_ms();
 
-        /* Accumulate token usage */
-        priv->total_prompt_tokens += response.input_tokens;
-        priv->total_completion_tokens += response.output_tokens;
+    /* Hook: LLM request - pass raw pointers, no JSON serialization here */
+    {
+        ac_hook_llm_request_t hook_info = {
+            .agent_name = priv->name,
+            .model = NULL,
+            .messages = priv->history.head,
+            .tools_schema = r->tools_schema,
+            .message_count = priv->history.count,
+            .max_tokens = max_tokens,
+            .thinking_budget = thinking_budget,
+            .budget_reason = budget_reason
+        };
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_llm_request, &hook_info);
+    }
 
-        if (err != ARC_OK) {
-            AC_LOG_ERROR("LLM streaming chat failed: %d", err);
-            ac_chat_response_free(&response);
-            return NULL;
-        }
+    /* Parsed straight into the arena the history lives in */
+    ac_chat_response_init_arena(&r->response, priv->arena);
+    r->response.intern = priv->intern;
+}
 
-        /* Check if there are tool use blocks */
-        if (response_has_tool_use(&response)) {
-            AC_LOG_INFO("LLM requested tool calls (streaming mode)");
+/**
+ * @brief Call the main model (blocks)
+ */
+static void react_llm_request(agent_priv_t *priv, agent_react_t *r) {
+    arena_set_tag(priv->arena, ARENA_TAG_LLM);
+    r->llm_err = agent_llm_chat(priv, r->tools_schema, &r->response);
+    arena_set_tag(priv->arena, ARENA_TAG_HISTORY);
+}
 
-            /* Add assistant response to history */
-            ac_message_t *asst_msg = ac_message_from_response(priv->arena, &response);
-            if (asst_msg) {
-                agent_append_message(priv, asst_msg);
-            }
+/**
+ * @brief Account for a finished model call: budget, response hook, tokens
+ */
+static void react_llm_end(agent_priv_t *priv, agent_react_t *r) {
+    uint64_t llm_end_ms = ac_platform_timestamp_ms();
+    int thinking_tokens = response_thinking_tokens(priv, &r->response);
+    if (r->llm_err == ARC_OK) {
+        agent_budget_observe(priv, &r->response, thinking_tokens, llm_end_ms - r->llm_start_ms);
+    }
 
-            /* Execute tools and create result message */
-            ac_message_t *tool_result_msg = create_tool_results_message(priv, &response);
-            if (tool_result_msg) {
-                agent_append_message(priv, tool_result_msg);
-            }
+    /* Hook: LLM response - pass raw pointer, no JSON serialization here */
+    {
+        ac_hook_llm_response_t hook_info = {
+            .agent_name = priv->name,
+            .content = r->response.content,
+            .tool_calls = r->response.tool_calls,
+            .tool_call_count = r->response.tool_call_count,
+            .prompt_tokens = r->response.prompt_tokens,
+            .completion_tokens = r->response.completion_tokens,
+            .total_tokens = r->response.total_tokens,
+            .finish_reason = r->response.finish_reason,
+            .duration_ms = llm_end_ms - r->llm_start_ms,
+            .ratelimit_wait_ms = r->response.ratelimit_wait_ms,
+            .thinking_tokens = thinking_tokens,
+            .timing = r->response.timing
+        };
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_llm_response, &hook_info);
+    }
 
-            /* Hook: iteration end */
-            {
-                ac_hook_iter_t hook_info = {
-                    .agent_name = priv->name,
-                    .iteration = iteration,
-                    .max_iterations = priv->max_iterations
-                };
-                AC_HOOK_CALL(ac_hook_call_iter_end, &hook_info);
-            }
+    /* Accumulate token usage */
+    priv->total_prompt_tokens += r->response.prompt_tokens;
+    priv->total_completion_tokens += r->response.completion_tokens;
+}
 
-            ac_chat_response_free(&response);
-            continue;
+/**
+ * @brief Get this iteration's response from the draft or the main model (blocks)
+ */
+static void react_llm_call(agent_priv_t *priv, agent_react_t *r) {
+    /* A draft model may settle tool-routing iterations on its own */
+    r->drafted = priv->draft && r->tools_schema && agent_draft(priv, &r->response);
+    if (r->drafted) {
+        return;
+    }
+
+    react_llm_begin(priv, r);
+    react_llm_request(priv, r);
+    react_llm_end(priv, r);
+}
+
+static void react_iter_end(agent_priv_t *priv, agent_react_t *r) {
+    /* Hook: iteration end */
+    {
+        ac_hook_iter_t hook_info = {
+            .agent_name = priv->name,
+            .iteration = r->iteration,
+            .max_iterations = priv->max_iterations
+        };
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_iter_end, &hook_info);
+    }
+    ac_profiler_iter_end();
+
+    ac_chat_response_free(&r->response);
+}
+
+/**
+ * @brief Record the response: queue its tool calls or take the final answer
+ *
+ * @return AC_STEP_AWAIT_TOOLS with r->jobs ready, AC_STEP_DONE otherwise
+ *         (r->failed set on error)
+ */
+static ac_step_state_t react_llm_done(agent_priv_t *priv, agent_react_t *r) {
+    ac_chat_response_t *response = &r->response;
+
+    if (r->llm_err != ARC_OK) {
+        ac_chat_response_free(response);
+        ac_profiler_iter_end();
+        if (agent_stopping(priv)) {
+            /* Ends like a cancel between iterations: no content */
+            AC_LOG_INFO("Agent run cancelled during LLM call");
+        } else {
+            AC_LOG_ERROR("LLM chat failed: %d", r->llm_err);
+            r->failed = 1;
         }
+        return AC_STEP_DONE;
+    }
 
-        /* No tool calls - we have the final response */
-        if (response.content) {
-            final_content = arena_strdup(priv->arena, response.content);
+    /* Check if there are tool calls */
+    if (ac_chat_response_has_tool_calls(response)) {
+        AC_LOG_INFO("LLM requested %d tool call(s)", response->tool_call_count);
 
-            ac_message_t *asst_msg = ac_message_from_response(priv->arena, &response);
-            if (asst_msg) {
-                agent_append_message(priv, asst_msg);
-            }
+        /* Adopted in place unless the response came back heap-owned */
+        ac_message_t *asst_msg = ac_message_from_response(priv->arena, response);
+
+        if (asst_msg) {
+            agent_append_message(priv, asst_msg);
+        }
+        if (r->drafted) {
+            agent_chain_reset(priv);   /* The draft's response is not in llm's chain */
+        } else {
+            agent_chain_advance(priv, response, asst_msg);
         }
 
-        /* Hook: iteration end */
-        {
-            ac_hook_iter_t hook_info = {
-                .agent_name = priv->name,
-                .iteration = iteration,
-                .max_iterations = priv->max_iterations
-            };
-            AC_HOOK_CALL(ac_hook_call_iter_end, &hook_info);
+        /* Execute tool calls (in parallel when enabled) */
+        size_t job_count = 0;
+        for (ac_tool_call_t *call = response->tool_calls; call; call = call->next) {
+            job_count++;
         }
 
-        ac_chat_response_free(&response);
-        break;
+        r->jobs = alloc_tool_jobs(priv, job_count);
+        if (!r->jobs) {
+            AC_LOG_ERROR("Failed to allocate tool jobs");
+            ac_chat_response_free(response);
+            ac_profiler_iter_end();
+            r->failed = 1;
+            return AC_STEP_DONE;
+        }
+
+        size_t n = 0;
+        for (ac_tool_call_t *call = response->tool_calls; call; call = call->next) {
+            tool_job_init(priv, &r->jobs[n++], call->id, call->name, call->arguments);
+        }
+        r->job_count = job_count;
+        return AC_STEP_AWAIT_TOOLS;
+    }
+
+    /* No tool calls - we have the final response */
+    if (response->content) {
+        /* The result shares the history copy of the content */
+        ac_message_t *asst_msg = ac_message_from_response(priv->arena, response);
+        if (asst_msg && asst_msg->content) {
+            agent_append_message(priv, asst_msg);
+            r->final_content = asst_msg->content;
+        } else {
+            r->final_content = arena_strdup(priv->arena, response->content);
+            asst_msg = NULL;
+        }
+        agent_chain_advance(priv, response, asst_msg);
+    }
+
+    react_iter_end(priv, r);
+    return AC_STEP_DONE;
+}
+
+/**
+ * @brief Execute the queued tool calls (blocks)
+ */
+static void react_tools_run(agent_priv_t *priv, agent_react_t *r) {
+    ac_prof_push(AC_PROF_TOOLS);
+    execute_tool_jobs(priv, r->jobs, r->job_count);
+    ac_prof_pop();
+}
+
+/**
+ * @brief Append the tool results and end the iteration
+ */
+static void react_tools_done(agent_priv_t *priv, agent_react_t *r) {
+    tool_job_t *jobs = r->jobs;
+
+    /* Add results in original call order */
+    arena_set_tag(priv->arena, ARENA_TAG_TOOLS);
+    for (size_t i = 0; i < r->job_count; i++) {
+        /* A repeat of a result still in history goes in as a reference */
+        char marker[AC_HISTORY_MARKER_MAX];
+        int repeat = agent_find_repeat(priv, jobs[i].result, marker);
+
+        /* Large results are adopted rather than copied (see max_tool_bytes) */
+        char *owned = NULL;
+        if (!repeat && !jobs[i].result_in_arena && agent_keeps_on_heap(priv, jobs[i].result)) {
+            owned = jobs[i].result;
+            jobs[i].result = NULL;
+        }
+
+        ac_message_t *tool_msg = ac_message_create_tool_result(
+            priv->arena,
+            jobs[i].id,
+            repeat ? marker :
+            owned || jobs[i].result_in_arena ? "" :
+            jobs[i].result ? jobs[i].result : "{\"error\":\"Tool execution failed\"}"
+        );
+
+        if (tool_msg && owned) {
+            tool_msg->content = owned;
+        } else if (tool_msg && jobs[i].result_in_arena && !repeat) {
+            tool_msg->content = jobs[i].result;   /* Written in place */
+        }
+        agent_append_owned(priv, tool_msg, owned);
+    }
+
+    arena_set_tag(priv->arena, ARENA_TAG_HISTORY);
+    free_tool_jobs(jobs, r->job_count);
+    r->jobs = NULL;
+    r->job_count = 0;
+
+    react_iter_end(priv, r);
+}
+
+/**
+ * @brief Fire run_end and build the result
+ *
+ * @return Result, NULL if the run failed
+ */
+static ac_agent_result_t *react_finish(agent_priv_t *priv, agent_react_t *r) {
+    if (r->failed) {
+        return NULL;
     }
 
-    if (iteration >= priv->max_iterations && !final_content) {
+    if (r->iteration >= priv->max_iterations && !r->final_content && !priv->cancel_requested) {
         AC_LOG_WARN("ReACT loop reached max iterations (%d)", priv->max_iterations);
     }
 
+    arena_set_tag(priv->arena, ARENA_TAG_OTHER);
+
     /* Hook: run end */
     uint64_t run_end_ms = ac_platform_timestamp_ms();
     {
+        arena_telemetry_t telemetry;
         ac_hook_run_end_t hook_info = {
             .agent_name = priv->name,
-            .content = final_content,
-            .iterations = iteration,
+            .content = r->final_content,
+            .iterations = r->iteration,
             .total_prompt_tokens = priv->total_prompt_tokens,
             .total_completion_tokens = priv->total_completion_tokens,
-            .duration_ms = run_end_ms - priv->run_start_time_ms
+            .duration_ms = run_end_ms - priv->run_start_time_ms,
+            .arena = arena_get_telemetry(priv->arena, &telemetry) ? &telemetry : NULL
         };
-        AC_HOOK_CALL(ac_hook_call_run_end, &hook_info);
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_run_end, &hook_info);
     }
 
     /* Allocate result from agent's arena */
@@ -742,144 +1606,1942 @@ static ac_agent_result_t *agent_run_stream_impl(agent_priv_t *priv, const char *
         return NULL;
     }
 
-    result->content = final_content;
+    result->content = r->final_content;
 
-    AC_LOG_DEBUG("Agent streaming run completed after %d iterations, total messages: %zu",
-                 iteration, priv->message_count);
+    AC_LOG_DEBUG("Agent run completed after %d iterations, total messages: %zu",
+                 r->iteration, priv->history.count);
     return result;
 }
 
-/*============================================================================
- * Public API
- *============================================================================*/
-
-ac_agent_t *ac_agent_create(ac_session_t *session, const ac_agent_params_t *params) {
-    if (!session || !params) {
-        AC_LOG_ERROR("Invalid arguments to ac_agent_create");
+static ac_agent_result_t *agent_run_impl(agent_priv_t *priv, const char *message) {
+    if (!priv || !priv->arena || !priv->llm) {
         return NULL;
     }
 
-    ac_agent_t *agent = (ac_agent_t *)ARC_CALLOC(1, sizeof(ac_agent_t));
-    if (!agent) {
-        AC_LOG_ERROR("Failed to allocate agent");
+    agent_react_t react;
+    memset(&react, 0, sizeof(react));
+    react.prof = ac_session_get_profiler(priv->session);
+
+    if (!react_begin(priv, &react, message)) {
         return NULL;
     }
 
-    agent_priv_t *priv = (agent_priv_t *)ARC_CALLOC(1, sizeof(agent_priv_t));
-    if (!priv) {
-        AC_LOG_ERROR("Failed to allocate agent private data");
-        ARC_FREE(agent);
-        return NULL;
+    /* ReACT loop */
+    while (react_iter_begin(priv, &react)) {
+        react_llm_call(priv, &react);
+        if (react_llm_done(priv, &react) != AC_STEP_AWAIT_TOOLS) {
+            if (agent_input_continue(priv, react.iteration, react.failed)) {
+                react.final_content = NULL;
+                continue;
+            }
+            break;
+        }
+        react_tools_run(priv, &react);
+        react_tools_done(priv, &react);
     }
 
-    priv->arena = arena_create(DEFAULT_ARENA_SIZE);
-    if (!priv->arena) {
-        AC_LOG_ERROR("Failed to create arena");
-        ARC_FREE(priv);
-        ARC_FREE(agent);
-        return NULL;
+    return react_finish(priv, &react);
+}
+
+/*============================================================================
+ * Agent Run Implementation (Streaming Mode)
+ *============================================================================*/
+
+/**
+ * @brief Check if response has tool use blocks
+ */
+static int response_has_tool_use(const ac_chat_response_t* response) {
+    if (!response) return 0;
+    for (ac_content_block_t* b = response->blocks; b; b = b->next) {
+        if (b->type == AC_BLOCK_TOOL_USE) {
+            return 1;
+        }
     }
+    return 0;
+}
 
-    priv->session = session;
-    priv->messages = NULL;
-    priv->messages_tail = NULL;
-    priv->message_count = 0;
-    priv->cached_tools_schema = NULL;
+/*============================================================================
+ * Eager Tool Dispatch (Streaming Mode)
+ *
+ * With eager_tools, each tool_use block is handed to the session executor
+ * on its CONTENT_BLOCK_STOP event while the model keeps generating. Only
+ * a leading run of parallel-safe tools is dispatched (the first other tool
+ * is a barrier, as in execute_tool_jobs), at most max(tool_workers, 1) per
+ * turn. Asynchronous tools are started directly instead of submitted.
+ * Stream callbacks run on the agent thread, so tool_start hooks still
+ * fire there; results and tool_end hooks are collected in call order after
+ * the stream ends.
+ *============================================================================*/
 
-    if (params->name) {
-        priv->name = arena_strdup(priv->arena, params->name);
+typedef struct eager_tools eager_tools_t;
+
+typedef struct {
+    eager_tools_t *owner;
+    tool_job_t job;
+    char *id;                        /* Scratch copies (job points here) */
+    char *name;
+    char *arguments;
+    int done;
+    int dropped;                     /* Not run by the executor */
+    int collected;
+} eager_job_t;
+
+struct eager_tools {
+    agent_priv_t *priv;
+    ac_executor_t *executor;
+    eager_job_t jobs[AC_AGENT_MAX_TOOL_WORKERS];
+    size_t count;
+    size_t limit;
+    int closed;                      /* Barrier reached, no more dispatch */
+#ifdef ARC_HAS_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t cond;             /* Signalled when a job finishes */
+#endif
+};
+
+#ifdef ARC_HAS_THREADS
+
+static void eager_job_finish(eager_job_t *ej, int dropped) {
+    eager_tools_t *eager = ej->owner;
+
+    pthread_mutex_lock(&eager->lock);
+    ej->done = 1;
+    ej->dropped = dropped;
+    pthread_cond_broadcast(&eager->cond);
+    pthread_mutex_unlock(&eager->lock);
+}
+
+static void eager_job_run(void *arg) {
+    eager_job_t *ej = (eager_job_t *)arg;
+    tool_job_execute(ej->owner->priv, &ej->job, NULL);
+    eager_job_finish(ej, 0);
+}
+
+static void eager_job_drop(void *arg) {
+    eager_job_finish((eager_job_t *)arg, 1);
+}
+
+static void eager_job_async_done(char *result, void *arg) {
+    eager_job_t *ej = (eager_job_t *)arg;
+    tool_job_complete(&ej->job, result);
+    eager_job_finish(ej, 0);
+}
+
+/**
+ * @brief Wait for a dispatched job; run it here if the executor dropped it
+ */
+static void eager_job_wait(eager_job_t *ej) {
+    eager_tools_t *eager = ej->owner;
+
+    pthread_mutex_lock(&eager->lock);
+    while (!ej->done) {
+        pthread_cond_wait(&eager->cond, &eager->lock);
     }
+    int dropped = ej->dropped;
+    pthread_mutex_unlock(&eager->lock);
 
-    if (params->instructions) {
-        priv->instructions = arena_strdup(priv->arena, params->instructions);
+    if (dropped) {
+        tool_job_execute(eager->priv, &ej->job, NULL);
     }
+}
 
-    priv->max_iterations = params->max_iterations > 0 ?
-        params->max_iterations : AC_AGENT_DEFAULT_MAX_ITERATIONS;
+/**
+ * @brief Prepare eager dispatch for one streaming turn
+ * @return 1 if enabled (use eager_stream_callback), 0 otherwise
+ */
+static int eager_tools_init(eager_tools_t *eager, agent_priv_t *priv) {
+    if (!priv->eager_tools || !priv->tools) {
+        return 0;
+    }
 
-    priv->llm = ac_llm_create(priv->arena, &params->llm);
-    if (!priv->llm) {
-        AC_LOG_ERROR("Failed to create LLM");
-        arena_destroy(priv->arena);
-        ARC_FREE(priv);
-        ARC_FREE(agent);
-        return NULL;
+    ac_executor_t *executor = ac_session_get_executor(priv->session);
+    if (!executor) {
+        return 0;
     }
 
-    priv->tools = params->tools;
+    memset(eager, 0, sizeof(*eager));
+    eager->priv = priv;
+    eager->executor = executor;
+    eager->limit = priv->tool_workers > 1 ? (size_t)priv->tool_workers : 1;
 
-    if (priv->tools) {
-        size_t tool_count = ac_tool_registry_count(priv->tools);
-        AC_LOG_DEBUG("Agent configured with %zu tools", tool_count);
+    if (pthread_mutex_init(&eager->lock, NULL) != 0) {
+        return 0;
+    }
+    if (pthread_cond_init(&eager->cond, NULL) != 0) {
+        pthread_mutex_destroy(&eager->lock);
+        return 0;
+    }
+    return 1;
+}
 
-        /* Build and cache tools schema once at creation */
-        priv->cached_tools_schema = build_tools_schema(priv);
-        if (priv->cached_tools_schema) {
-            AC_LOG_DEBUG("Cached tools schema (%zu bytes)",
-                         strlen(priv->cached_tools_schema));
-        }
+static void eager_dispatch(eager_tools_t *eager, const ac_stream_event_t *event) {
+    if (eager->closed) {
+        return;
     }
 
-    /* Store streaming callbacks */
-    priv->stream_callback = params->callbacks.on_stream;
-    priv->callback_user_data = params->callbacks.user_data;
+    agent_priv_t *priv = eager->priv;
+    const ac_tool_t *tool = ac_tool_registry_find(priv->tools, event->tool_name);
 
-    agent->priv = priv;
+    if (!tool || !tool->parallel_safe || eager->count >= eager->limit) {
+        /* Barrier: this and later tools run after the stream ends */
+        eager->closed = 1;
+        return;
+    }
 
-    if (ac_session_add_agent(session, agent) != ARC_OK) {
-        AC_LOG_ERROR("Failed to add agent to session");
-        arena_destroy(priv->arena);
-        ARC_FREE(priv);
-        ARC_FREE(agent);
-        return NULL;
+    eager_job_t *ej = &eager->jobs[eager->count];
+    ej->owner = eager;
+    ej->id = arena_strdup(priv->scratch, event->tool_id);
+    ej->name = arena_strdup(priv->scratch, event->tool_name);
+    ej->arguments = event->tool_input ? arena_strdup(priv->scratch, event->tool_input) : NULL;
+    if (!ej->id || !ej->name || (event->tool_input && !ej->arguments)) {
+        memset(ej, 0, sizeof(*ej));
+        eager->closed = 1;
+        return;
     }
 
-    AC_LOG_INFO("Agent created: %s (arena=%zuKB, max_iter=%d, stream=%s)",
-                priv->name ? priv->name : "unnamed",
-                DEFAULT_ARENA_SIZE / 1024,
-                priv->max_iterations,
-                priv->stream_callback ? "yes" : "no");
+    tool_job_init(priv, &ej->job, ej->id, ej->name, ej->arguments);
+    eager->count++;
 
-    return agent;
-}
+    tool_job_hook_start(priv, &ej->job);
+    AC_LOG_DEBUG("Dispatching tool %s while streaming", ej->name);
 
-ac_agent_result_t *ac_agent_run(ac_agent_t *agent, const char *message) {
-    if (!agent || !agent->priv || !message) {
-        AC_LOG_ERROR("Invalid arguments to ac_agent_run");
-        return NULL;
+    if (ej->job.async) {
+        /* Started here, completes without a worker */
+        tool_job_start(priv, &ej->job, eager_job_async_done, ej);
+        return;
     }
 
-    /* Use streaming mode if callback is configured */
-    if (agent->priv->stream_callback) {
-        return agent_run_stream_impl(agent->priv, message);
+    if (ac_executor_submit(eager->executor, eager_job_run, eager_job_drop, ej,
+                           priv->priority) != ARC_OK) {
+        /* Run it when results are collected */
+        ej->done = 1;
+        ej->dropped = 1;
     }
-
-    return agent_run_impl(agent->priv, message);
 }
 
-void ac_agent_destroy(ac_agent_t *agent) {
-    if (!agent) {
-        return;
+static int eager_stream_callback(const ac_stream_event_t *event, void *user_data) {
+    eager_tools_t *eager = (eager_tools_t *)user_data;
+    agent_priv_t *priv = eager->priv;
+
+    if (event->type == AC_STREAM_CONTENT_BLOCK_STOP &&
+        event->block_type == AC_BLOCK_TOOL_USE &&
+        event->tool_id && event->tool_name) {
+        eager_dispatch(eager, event);
     }
 
-    agent_priv_t *priv = agent->priv;
-    if (priv) {
-        if (priv->llm) {
-            ac_llm_cleanup(priv->llm);
-        }
+    return agent_stream_emit(priv, event);
+}
 
-        /* Free cached tools schema */
-        if (priv->cached_tools_schema) {
-            ARC_FREE(priv->cached_tools_schema);
-            priv->cached_tools_schema = NULL;
+/**
+ * @brief Move results of dispatched jobs into the turn's job array
+ *
+ * Fires tool_end for each collected job.
+ * @return Number of leading jobs already executed
+ */
+static size_t eager_tools_collect(eager_tools_t *eager, tool_job_t *jobs, size_t count) {
+    size_t n = 0;
+
+    while (n < count && n < eager->count) {
+        eager_job_t *ej = &eager->jobs[n];
+        if (!jobs[n].id || strcmp(jobs[n].id, ej->id) != 0) {
+            break;
         }
 
-        if (priv->arena) {
-            AC_LOG_DEBUG("Destroying agent arena");
-            arena_destroy(priv->arena);
+        eager_job_wait(ej);
+        ej->collected = 1;
+
+        jobs[n].result = ej->job.result;
+        jobs[n].start_ms = ej->job.start_ms;
+        jobs[n].end_ms = ej->job.end_ms;
+        ej->job.result = NULL;
+
+        tool_job_hook_end(eager->priv, &jobs[n]);
+        n++;
+    }
+
+    return n;
+}
+
+/**
+ * @brief Wait for anything still in flight and release the turn state
+ */
+static void eager_tools_finish(eager_tools_t *eager) {
+    for (size_t i = 0; i < eager->count; i++) {
+        eager_job_t *ej = &eager->jobs[i];
+
+        if (!ej->collected) {
+            /* Started but never matched a response block */
+            pthread_mutex_lock(&eager->lock);
+            while (!ej->done) {
+                pthread_cond_wait(&eager->cond, &eager->lock);
+            }
+            pthread_mutex_unlock(&eager->lock);
+            tool_job_hook_end(eager->priv, &ej->job);
         }
-        ARC_FREE(priv);
+
+        if (ej->job.result) ARC_FREE(ej->job.result);
     }
 
-    ARC_FREE(agent);
+    pthread_cond_destroy(&eager->cond);
+    pthread_mutex_destroy(&eager->lock);
+}
+
+#else /* !ARC_HAS_THREADS */
+
+static int eager_tools_init(eager_tools_t *eager, agent_priv_t *priv) {
+    (void)eager;
+    (void)priv;
+    return 0;
+}
+
+static int eager_stream_callback(const ac_stream_event_t *event, void *user_data) {
+    agent_priv_t *priv = ((eager_tools_t *)user_data)->priv;
+    return priv->stream_callback(event, priv->callback_user_data);
 }
+
+static size_t eager_tools_collect(eager_tools_t *eager, tool_job_t *jobs, size_t count) {
+    (void)eager;
+    (void)jobs;
+    (void)count;
+    return 0;
+}
+
+static void eager_tools_finish(eager_tools_t *eager) {
+    (void)eager;
+}
+
+#endif /* ARC_HAS_THREADS */
+
+/**
+ * @brief Create tool result message from response blocks
+ *
+ * With a tool output cap, large results are gathered into one heap buffer
+ * returned in *owned, for the history to take over.
+ */
+static ac_message_t* create_tool_results_message(agent_priv_t *priv,
+                                                 const ac_chat_response_t* response,
+                                                 eager_tools_t *eager,
+                                                 char **owned) {
+    *owned = NULL;
+    if (!response || !response->blocks) return NULL;
+
+    size_t job_count = 0;
+    for (ac_content_block_t* b = response->blocks; b; b = b->next) {
+        if (b->type == AC_BLOCK_TOOL_USE && b->id && b->name) job_count++;
+    }
+    if (job_count == 0) return NULL;
+
+    /* Create tool result message (user role for Anthropic API) */
+    ac_message_t* result_msg = (ac_message_t*)arena_alloc(priv->arena, sizeof(ac_message_t));
+    if (!result_msg) return NULL;
+    memset(result_msg, 0, sizeof(ac_message_t));
+    result_msg->role = AC_ROLE_USER;
+
+    tool_job_t* jobs = alloc_tool_jobs(priv, job_count);
+    if (!jobs) return NULL;
+
+    size_t n = 0;
+    for (ac_content_block_t* b = response->blocks; b; b = b->next) {
+        if (b->type != AC_BLOCK_TOOL_USE) continue;
+        if (!b->id || !b->name) continue;
+        tool_job_init(priv, &jobs[n++], b->id, b->name, b->input);
+    }
+
+    /* Collect tools started while streaming, then execute the rest */
+    size_t done = eager ? eager_tools_collect(eager, jobs, job_count) : 0;
+    execute_tool_jobs(priv, jobs + done, job_count - done);
+
+    /* Repeats of results still in history go in as references */
+    char (*markers)[AC_HISTORY_MARKER_MAX] = NULL;
+    if (priv->history.dedup) {
+        markers = (char (*)[AC_HISTORY_MARKER_MAX])arena_alloc(priv->scratch,
+                                                               job_count * sizeof(*markers));
+    }
+
+    size_t heap_bytes = 0;
+    for (size_t i = 0; i < job_count; i++) {
+        if (markers && agent_find_repeat(priv, jobs[i].result, markers[i])) {
+            continue;
+        }
+        if (markers) {
+            markers[i][0] = '\0';
+        }
+        if (agent_keeps_on_heap(priv, jobs[i].result)) {
+            heap_bytes += strlen(jobs[i].result) + 1;
+        }
+    }
+    char *heap = heap_bytes ? (char *)ARC_MALLOC(heap_bytes) : NULL;
+    size_t heap_used = 0;
+
+    ac_content_block_t* last_block = NULL;
+
+    for (size_t i = 0; i < job_count; i++) {
+        const char* tool_result = jobs[i].result;
+        int is_error = (tool_result && strstr(tool_result, "\"error\"") != NULL);
+
+        /* Create tool_result content block */
+        ac_content_block_t* result_block = (ac_content_block_t*)arena_alloc(priv->arena, sizeof(ac_content_block_t));
+        if (!result_block) continue;
+        memset(result_block, 0, sizeof(ac_content_block_t));
+        result_block->type = AC_BLOCK_TOOL_RESULT;
+        result_block->id = (char *)ac_intern(priv->intern, jobs[i].id);
+        if (markers && markers[i][0]) {
+            result_block->text = arena_strdup(priv->arena, markers[i]);
+        } else if (jobs[i].result_in_arena) {
+            result_block->text = jobs[i].result;   /* Written in place */
+        } else if (heap && agent_keeps_on_heap(priv, tool_result)) {
+            size_t len = strlen(tool_result) + 1;
+            result_block->text = memcpy(heap + heap_used, tool_result, len);
+            result_block->text_len = len - 1;
+            heap_used += len;
+        } else {
+            result_block->text = arena_strdup(priv->arena, tool_result ? tool_result : "{}");
+        }
+        result_block->is_error = is_error;
+
+        /* Append to result message */
+        if (!result_msg->blocks) {
+            result_msg->blocks = result_block;
+        } else {
+            last_block->next = result_block;
+        }
+        last_block = result_block;
+    }
+
+    free_tool_jobs(jobs, job_count);
+
+    if (!result_msg->blocks) {
+        ARC_FREE(heap);
+        return NULL;
+    }
+    *owned = heap;
+    return result_msg;
+}
+
+static ac_agent_result_t *agent_run_stream_impl(agent_priv_t *priv, const char *message) {
+    if (!priv || !priv->arena || !priv->llm) {
+        return NULL;
+    }
+
+    agent_run_limits(priv);
+
+    /* Initialize run statistics */
+    priv->run_start_time_ms = ac_platform_timestamp_ms();
+    priv->total_prompt_tokens = 0;
+    priv->total_completion_tokens = 0;
+
+    size_t tool_count = priv->tools ? ac_tool_registry_count(priv->tools) : 0;
+
+    /* Hook: run start */
+    {
+        ac_hook_run_start_t hook_info = {
+            .agent_name = priv->name,
+            .message = message,
+            .instructions = priv->instructions,
+            .max_iterations = priv->max_iterations,
+            .tool_count = tool_count
+        };
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_run_start, &hook_info);
+    }
+
+    arena_set_tag(priv->arena, ARENA_TAG_HISTORY);
+
+    /* Add system message if this is the first message */
+    if (!priv->history.head && priv->instructions) {
+        ac_message_t *sys_msg = ac_message_create(
+            priv->arena, AC_ROLE_SYSTEM, priv->instructions
+        );
+        if (sys_msg) {
+            agent_append_message(priv, sys_msg);
+        }
+    }
+
+    /* Add user message to history */
+    ac_message_t *user_msg = agent_user_message(priv, message);
+    if (!user_msg) {
+        return NULL;
+    }
+    agent_append_message(priv, user_msg);
+
+    AC_LOG_DEBUG("Added user message, total messages: %zu", priv->history.count);
+
+    /* ReACT loop with streaming */
+    char *final_content = NULL;
+    int iteration = 0;
+    arena_mark_t iter_mark = arena_mark(priv->scratch);
+    ac_profiler_t *prof = ac_session_get_profiler(priv->session);
+
+    while (iteration < priv->max_iterations) {
+        arena_rewind(priv->scratch, iter_mark);
+
+        if (agent_stopping(priv)) {
+            AC_LOG_INFO("Agent run cancelled before iteration %d", iteration + 1);
+            break;
+        }
+
+        agent_input_append(priv, 0);
+
+        iteration++;
+        AC_LOG_DEBUG("ReACT streaming iteration %d/%d", iteration, priv->max_iterations);
+        ac_profiler_iter_begin(prof, priv->name, iteration);
+
+        /* Hook: iteration start */
+        {
+            ac_hook_iter_t hook_info = {
+                .agent_name = priv->name,
+                .iteration = iteration,
+                .max_iterations = priv->max_iterations
+            };
+            AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_iter_start, &hook_info);
+        }
+
+        const char *tools_schema = agent_tools_schema(priv);
+        agent_enforce_history(priv, tools_schema);
+
+        int max_tokens, thinking_budget;
+        ac_budget_reason_t budget_reason = agent_budget_pick(priv, &max_tokens, &thinking_budget);
+
+        uint64_t llm_start_ms = ac_platform_timestamp_ms();
+
+        /* Hook: LLM request */
+        {
+            ac_hook_llm_request_t hook_info = {
+                .agent_name = priv->name,
+                .model = NULL,
+                .messages = priv->history.head,
+                .tools_schema = tools_schema,
+                .message_count = priv->history.count,
+                .max_tokens = max_tokens,
+                .thinking_budget = thinking_budget,
+                .budget_reason = budget_reason
+            };
+            AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_llm_request, &hook_info);
+        }
+
+        /* Call LLM with streaming (tools may start before it returns) */
+#if ARC_STACK_BUDGET
+        /* The tracker holds AC_AGENT_MAX_TOOL_WORKERS jobs: keep it off the stack */
+        eager_tools_t *eager = priv->eager_tools && priv->tools
+            ? (eager_tools_t *)arena_alloc(priv->scratch, sizeof(eager_tools_t)) : NULL;
+        int use_eager = eager && eager_tools_init(eager, priv);
+#else
+        eager_tools_t eager_local;
+        eager_tools_t *eager = &eager_local;
+        int use_eager = eager_tools_init(eager, priv);
+#endif
+
+        ac_chat_response_t response = {0};
+        arena_set_tag(priv->arena, ARENA_TAG_LLM);
+        arc_err_t err = ac_llm_chat_stream(
+            priv->llm,
+            priv->history.head,
+            tools_schema,
+            use_eager ? eager_stream_callback : priv->stream_callback,
+            use_eager ? (void *)eager : priv->callback_user_data,
+            &response
+        );
+        arena_set_tag(priv->arena, ARENA_TAG_HISTORY);
+
+        uint64_t llm_end_ms = ac_platform_timestamp_ms();
+        int thinking_tokens = response_thinking_tokens(priv, &response);
+        if (err == ARC_OK) {
+            agent_budget_observe(priv, &response, thinking_tokens, llm_end_ms - llm_start_ms);
+        }
+
+        /* Hook: LLM response */
+        {
+            ac_hook_llm_response_t hook_info = {
+                .agent_name = priv->name,
+                .content = response.content,
+                .tool_calls = NULL,
+                .tool_call_count = 0,
+                .prompt_tokens = response.input_tokens,
+                .completion_tokens = response.output_tokens,
+                .total_tokens = response.input_tokens + response.output_tokens,
+                .finish_reason = response.stop_reason,
+                .duration_ms = llm_end_ms - llm_start_ms,
+                .ratelimit_wait_ms = response.ratelimit_wait_ms,
+                .thinking_tokens = thinking_tokens,
+                .timing = response.timing
+            };
+            AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_llm_response, &hook_info);
+        }
+
+        /* Accumulate token usage */
+        priv->total_prompt_tokens += response.input_tokens;
+        priv->total_completion_tokens += response.output_tokens;
+
+        if (err != ARC_OK) {
+            if (use_eager) {
+                eager_tools_finish(eager);
+            }
+            ac_chat_response_free(&response);
+            ac_profiler_iter_end();
+            if (agent_stopping(priv)) {
+                AC_LOG_INFO("Agent run cancelled during LLM call");
+                break;
+            }
+            AC_LOG_ERROR("LLM streaming chat failed: %d", err);
+            return NULL;
+        }
+
+        /* Streamed into the heap: the copy into history interns ids */
+        response.intern = priv->intern;
+
+        /* Check if there are tool use blocks */
+        if (response_has_tool_use(&response)) {
+            AC_LOG_INFO("LLM requested tool calls (streaming mode)");
+
+            /* Add assistant response to history */
+            ac_message_t *asst_msg = ac_message_from_response(priv->arena, &response);
+            if (asst_msg) {
+                agent_append_message(priv, asst_msg);
+            }
+
+            /* Execute tools and create result message */
+            arena_set_tag(priv->arena, ARENA_TAG_TOOLS);
+            char *owned;
+            ac_prof_push(AC_PROF_TOOLS);
+            ac_message_t *tool_result_msg = create_tool_results_message(
+                priv, &response, use_eager ? eager : NULL, &owned
+            );
+            ac_prof_pop();
+            arena_set_tag(priv->arena, ARENA_TAG_HISTORY);
+            if (use_eager) {
+                eager_tools_finish(eager);
+            }
+            agent_append_owned(priv, tool_result_msg, owned);
+
+            /* Hook: iteration end */
+            {
+                ac_hook_iter_t hook_info = {
+                    .agent_name = priv->name,
+                    .iteration = iteration,
+                    .max_iterations = priv->max_iterations
+                };
+                AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_iter_end, &hook_info);
+            }
+            ac_profiler_iter_end();
+
+            ac_chat_response_free(&response);
+            continue;
+        }
+
+        if (use_eager) {
+            eager_tools_finish(eager);
+        }
+
+        /* No tool calls - we have the final response */
+        if (response.content) {
+            /* The result shares the history copy of the content */
+            ac_message_t *asst_msg = ac_message_from_response(priv->arena, &response);
+            if (asst_msg) {
+                agent_append_message(priv, asst_msg);
+            }
+            final_content = asst_msg && asst_msg->content ?
+                asst_msg->content : arena_strdup(priv->arena, response.content);
+        }
+
+        /* Hook: iteration end */
+        {
+            ac_hook_iter_t hook_info = {
+                .agent_name = priv->name,
+                .iteration = iteration,
+                .max_iterations = priv->max_iterations
+            };
+            AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_iter_end, &hook_info);
+        }
+        ac_profiler_iter_end();
+
+        ac_chat_response_free(&response);
+        if (agent_input_continue(priv, iteration, 0)) {
+            final_content = NULL;
+            continue;
+        }
+        break;
+    }
+
+    if (iteration >= priv->max_iterations && !final_content && !priv->cancel_requested) {
+        AC_LOG_WARN("ReACT loop reached max iterations (%d)", priv->max_iterations);
+    }
+
+    arena_set_tag(priv->arena, ARENA_TAG_OTHER);
+
+    /* Hook: run end */
+    uint64_t run_end_ms = ac_platform_timestamp_ms();
+    {
+        arena_telemetry_t telemetry;
+        ac_hook_run_end_t hook_info = {
+            .agent_name = priv->name,
+            .content = final_content,
+            .iterations = iteration,
+            .total_prompt_tokens = priv->total_prompt_tokens,
+            .total_completion_tokens = priv->total_completion_tokens,
+            .duration_ms = run_end_ms - priv->run_start_time_ms,
+            .arena = arena_get_telemetry(priv->arena, &telemetry) ? &telemetry : NULL
+        };
+        AC_HOOK_CALL(&priv->hook_scope, ac_hook_call_run_end, &hook_info);
+    }
+
+    /* Allocate result from agent's arena */
+    ac_agent_result_t *result = (ac_agent_result_t *)arena_alloc(
+        priv->arena, sizeof(ac_agent_result_t)
+    );
+
+    if (!result) {
+        AC_LOG_ERROR("Failed to allocate result from arena");
+        return NULL;
+    }
+
+    result->content = final_content;
+
+    AC_LOG_DEBUG("Agent streaming run completed after %d iterations, total messages: %zu",
+                 iteration, priv->history.count);
+    return result;
+}
+
+/*============================================================================
+ * Run Dispatch
+ *============================================================================*/
+
+static ac_agent_result_t *agent_run_dispatch(agent_priv_t *priv, const char *message) {
+    /* Scratch is empty between runs, whichever way the loop exits */
+    arena_scratch_t scratch = arena_scratch_begin(priv->scratch);
+    ac_agent_result_t *result;
+    agent_input_open(priv);
+
+    /* Use streaming mode if callback is configured */
+    if (priv->stream_callback) {
+        result = agent_run_stream_impl(priv, message);
+    } else {
+        result = agent_run_impl(priv, message);
+    }
+
+    arena_scratch_end(&scratch);
+    return result;
+}
+
+/**
+ * @brief Mark the agent busy; fails if a run is already in progress
+ */
+static int agent_run_claim(agent_priv_t *priv) {
+    pthread_mutex_lock(&priv->run_lock);
+    int ok = !priv->busy;
+    if (ok) {
+        priv->busy = 1;
+        priv->cancel_requested = 0;
+    }
+    pthread_mutex_unlock(&priv->run_lock);
+    return ok;
+}
+
+static void agent_run_unclaim(agent_priv_t *priv) {
+    pthread_mutex_lock(&priv->run_lock);
+    priv->busy = 0;
+    priv->input_open = 0;
+    pthread_mutex_unlock(&priv->run_lock);
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+static ac_agent_t *agent_create(ac_session_t *session, const ac_agent_params_t *params,
+                                size_t arena_size) {
+    if (!session || !params) {
+        AC_LOG_ERROR("Invalid arguments to ac_agent_create");
+        return NULL;
+    }
+
+    ac_agent_t *agent = (ac_agent_t *)ARC_CALLOC(1, sizeof(ac_agent_t));
+    if (!agent) {
+        AC_LOG_ERROR("Failed to allocate agent");
+        return NULL;
+    }
+
+    agent_priv_t *priv = (agent_priv_t *)ARC_CALLOC(1, sizeof(agent_priv_t));
+    if (!priv) {
+        AC_LOG_ERROR("Failed to allocate agent private data");
+        ARC_FREE(agent);
+        return NULL;
+    }
+
+    priv->arena = arena_create_with(arena_size, ac_session_get_allocator(session));
+    if (!priv->arena) {
+        AC_LOG_ERROR("Failed to create arena");
+        ARC_FREE(priv);
+        ARC_FREE(agent);
+        return NULL;
+    }
+
+    priv->scratch = arena_create_with(AGENT_SCRATCH_SIZE, ac_session_get_allocator(session));
+    if (!priv->scratch) {
+        AC_LOG_ERROR("Failed to create scratch arena");
+        arena_destroy(priv->arena);
+        ARC_FREE(priv);
+        ARC_FREE(agent);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&priv->run_lock, NULL) != 0) {
+        AC_LOG_ERROR("Failed to initialize agent run lock");
+        arena_destroy(priv->scratch);
+        arena_destroy(priv->arena);
+        ARC_FREE(priv);
+        ARC_FREE(agent);
+        return NULL;
+    }
+    if (pthread_mutex_init(&priv->stream_lock, NULL) != 0) {
+        AC_LOG_ERROR("Failed to initialize agent stream lock");
+        pthread_mutex_destroy(&priv->run_lock);
+        arena_destroy(priv->scratch);
+        arena_destroy(priv->arena);
+        ARC_FREE(priv);
+        ARC_FREE(agent);
+        return NULL;
+    }
+    priv->input_tail = &priv->input;
+
+    priv->intern = ac_intern_create(priv->arena);
+    if (!priv->intern) {
+        AC_LOG_ERROR("Failed to create intern table");
+        pthread_mutex_destroy(&priv->run_lock);
+        pthread_mutex_destroy(&priv->stream_lock);
+        arena_destroy(priv->scratch);
+        arena_destroy(priv->arena);
+        ARC_FREE(priv);
+        ARC_FREE(agent);
+        return NULL;
+    }
+
+    priv->session = session;
+    memset(&priv->history, 0, sizeof(priv->history));
+    priv->max_history_messages = params->memory.max_messages;
+    priv->max_history_tokens = params->memory.max_tokens;
+    priv->history.family = ac_tokens_family(params->llm.model);
+    if (params->llm.context_window > 0) {
+        int reserve = params->llm.max_tokens > 0 ? params->llm.max_tokens : 0;
+        if (params->budget.enabled && params->budget.max_tokens > reserve) {
+            reserve = params->budget.max_tokens;
+        }
+        priv->context_tokens = params->llm.context_window > reserve ?
+            (size_t)(params->llm.context_window - reserve) : 1;
+    }
+    priv->max_tool_bytes = params->memory.max_tool_bytes;
+    priv->history.dedup = params->memory.dedup_tool_results;
+    if (params->memory.spill_dir) {
+        priv->spill_dir = arena_strdup(priv->arena, params->memory.spill_dir);
+    }
+
+    if (params->name) {
+        priv->name = arena_strdup(priv->arena, params->name);
+    }
+
+    if (params->instructions) {
+        priv->instructions = arena_strdup(priv->arena, params->instructions);
+    }
+
+    priv->max_iterations = params->max_iterations > 0 ?
+        params->max_iterations : AC_AGENT_DEFAULT_MAX_ITERATIONS;
+
+    priv->tool_workers = params->tool_workers > AC_AGENT_MAX_TOOL_WORKERS ?
+        AC_AGENT_MAX_TOOL_WORKERS : params->tool_workers;
+    priv->eager_tools = params->eager_tools;
+
+    /* The agent's class carries down to its requests unless llm sets one */
+    priv->priority = ac_priority_clamp((int)params->priority);
+    ac_llm_params_t llm_params = params->llm;
+    if (llm_params.priority == AC_PRIORITY_NORMAL) {
+        llm_params.priority = priv->priority;
+    }
+
+    priv->llm = ac_llm_create(priv->arena, &llm_params);
+    if (!priv->llm) {
+        AC_LOG_ERROR("Failed to create LLM");
+        ac_intern_destroy(priv->intern);
+        pthread_mutex_destroy(&priv->run_lock);
+        pthread_mutex_destroy(&priv->stream_lock);
+        arena_destroy(priv->scratch);
+        arena_destroy(priv->arena);
+        ARC_FREE(priv);
+        ARC_FREE(agent);
+        return NULL;
+    }
+
+    priv->tools = params->tools;
+    priv->tools_format = (ac_tool_schema_format_t)ac_llm_tools_format(priv->llm);
+    agent_budget_init(priv, &params->budget);
+
+    /* A caller's token stays what in-flight work watches */
+    priv->user_cancel = params->llm.cancel;
+    priv->cancel = priv->user_cancel ? priv->user_cancel : &priv->cancel_requested;
+
+    if (params->draft.llm.provider && priv->tools) {
+        llm_params = params->draft.llm;
+        if (llm_params.priority == AC_PRIORITY_NORMAL) {
+            llm_params.priority = priv->priority;
+        }
+        priv->draft = ac_llm_create(priv->arena, &llm_params);
+        if (!priv->draft) {
+            AC_LOG_ERROR("Failed to create draft LLM");
+            ac_llm_cleanup(priv->llm);
+            ac_intern_destroy(priv->intern);
+            pthread_mutex_destroy(&priv->run_lock);
+            pthread_mutex_destroy(&priv->stream_lock);
+            arena_destroy(priv->scratch);
+            arena_destroy(priv->arena);
+            ARC_FREE(priv);
+            ARC_FREE(agent);
+            return NULL;
+        }
+        priv->draft_model = params->draft.llm.model ?
+            arena_strdup(priv->arena, params->draft.llm.model) : NULL;
+        priv->draft_tools_format = (ac_tool_schema_format_t)ac_llm_tools_format(priv->draft);
+        priv->draft_max_tool_calls = params->draft.max_tool_calls;
+    }
+
+    if (priv->tools) {
+        size_t tool_count = ac_tool_registry_count(priv->tools);
+        AC_LOG_DEBUG("Agent configured with %zu tools", tool_count);
+
+        /* Warm the registry's schema cache for this provider */
+        const char *schema = agent_tools_schema(priv);
+        if (schema) {
+            AC_LOG_DEBUG("Cached tools schema (%zu bytes)", strlen(schema));
+        }
+    }
+
+    /* Store streaming callbacks */
+    priv->stream_callback = params->callbacks.on_stream;
+    priv->callback_user_data = params->callbacks.user_data;
+
+    agent->priv = priv;
+
+    ac_hook_chain_init(&priv->hooks);
+    priv->hook_scope.session = ac_session_get_hooks(session);
+    priv->hook_scope.agent = &priv->hooks;
+
+    if (ac_session_add_agent(session, agent) != ARC_OK) {
+        AC_LOG_ERROR("Failed to add agent to session");
+        ac_hook_chain_destroy(&priv->hooks);
+        if (priv->draft) {
+            ac_llm_cleanup(priv->draft);
+        }
+        ac_llm_cleanup(priv->llm);
+        ac_intern_destroy(priv->intern);
+        pthread_mutex_destroy(&priv->run_lock);
+        pthread_mutex_destroy(&priv->stream_lock);
+        arena_destroy(priv->scratch);
+        arena_destroy(priv->arena);
+        ARC_FREE(priv);
+        ARC_FREE(agent);
+        return NULL;
+    }
+
+    AC_LOG_INFO("Agent created: %s (arena=%zuKB, max_iter=%d, tool_workers=%d, stream=%s)",
+                priv->name ? priv->name : "unnamed",
+                arena_size / 1024,
+                priv->max_iterations,
+                priv->tool_workers > 1 ? priv->tool_workers : 1,
+                priv->stream_callback ? "yes" : "no");
+
+    return agent;
+}
+
+ac_agent_t *ac_agent_create(ac_session_t *session, const ac_agent_params_t *params) {
+    return agent_create(session, params, DEFAULT_ARENA_SIZE);
+}
+
+ac_agent_result_t *ac_agent_run(ac_agent_t *agent, const char *message) {
+    if (!agent || !agent->priv || !message) {
+        AC_LOG_ERROR("Invalid arguments to ac_agent_run");
+        return NULL;
+    }
+
+    if (!agent_run_claim(agent->priv)) {
+        AC_LOG_ERROR("Agent is already running");
+        return NULL;
+    }
+
+    ac_agent_result_t *result = agent_run_dispatch(agent->priv, message);
+    agent_run_unclaim(agent->priv);
+    return result;
+}
+
+ac_agent_result_t *ac_agent_run_attached(ac_agent_t *agent, const char *message,
+                                         const ac_attachment_t *images, size_t count) {
+    if (!agent || !agent->priv || !message || (count > 0 && !images)) {
+        AC_LOG_ERROR("Invalid arguments to ac_agent_run_attached");
+        return NULL;
+    }
+
+    if (!agent_run_claim(agent->priv)) {
+        AC_LOG_ERROR("Agent is already running");
+        return NULL;
+    }
+
+    agent->priv->attach = images;
+    agent->priv->attach_count = count;
+    ac_agent_result_t *result = agent_run_dispatch(agent->priv, message);
+    agent->priv->attach = NULL;
+    agent->priv->attach_count = 0;
+    agent_run_unclaim(agent->priv);
+    return result;
+}
+
+arc_err_t ac_agent_send(ac_agent_t *agent, const char *message) {
+    if (!agent || !agent->priv || !message) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    size_t len = strlen(message);
+    agent_input_t *input = (agent_input_t *)ARC_MALLOC(sizeof(agent_input_t) + len + 1);
+    if (!input) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    input->next = NULL;
+    input->len = len;
+    memcpy(input->text, message, len + 1);
+
+    agent_priv_t *priv = agent->priv;
+    pthread_mutex_lock(&priv->run_lock);
+    int open = priv->input_open;
+    if (open) {
+        *priv->input_tail = input;
+        priv->input_tail = &input->next;
+    }
+    pthread_mutex_unlock(&priv->run_lock);
+
+    if (!open) {
+        ARC_FREE(input);
+        return ARC_ERR_INVALID_STATE;
+    }
+    return ARC_OK;
+}
+
+void ac_agent_cancel(ac_agent_t *agent) {
+    if (!agent || !agent->priv) {
+        return;
+    }
+
+    agent_priv_t *priv = agent->priv;
+    pthread_mutex_lock(&priv->run_lock);
+    if (priv->busy) {
+        priv->cancel_requested = 1;
+    }
+    pthread_mutex_unlock(&priv->run_lock);
+}
+
+void ac_agent_set_deadline(ac_agent_t *agent, uint64_t deadline_ms) {
+    if (!agent || !agent->priv) {
+        return;
+    }
+
+    pthread_mutex_lock(&agent->priv->run_lock);
+    agent->priv->deadline_ms = deadline_ms;
+    pthread_mutex_unlock(&agent->priv->run_lock);
+}
+
+/*============================================================================
+ * Async Run API
+ *============================================================================*/
+
+struct ac_agent_run {
+    ac_agent_t *agent;
+    char *message;                   /* Heap copy, freed after the run */
+    ac_agent_done_fn on_done;
+    void *user_data;
+
+    ac_agent_result_t *result;
+    ac_run_status_t status;
+    int cancelled;
+    int finished;                    /* Agent released, cancel is a no-op */
+    int refs;                        /* Caller handle + queued job */
+
+    pthread_mutex_t lock;
+#ifdef ARC_HAS_THREADS
+    pthread_cond_t cond;             /* Signalled on completion */
+#elif defined(ARC_PLATFORM_FREERTOS)
+    SemaphoreHandle_t done;          /* Given on completion (task pool runs) */
+#endif
+};
+
+static void agent_run_unref(ac_agent_run_t *run) {
+    pthread_mutex_lock(&run->lock);
+    int refs = --run->refs;
+    pthread_mutex_unlock(&run->lock);
+
+    if (refs > 0) {
+        return;
+    }
+
+#ifdef ARC_HAS_THREADS
+    pthread_cond_destroy(&run->cond);
+#elif defined(ARC_PLATFORM_FREERTOS)
+    vSemaphoreDelete(run->done);
+#endif
+    pthread_mutex_destroy(&run->lock);
+    ARC_FREE(run->message);
+    ARC_FREE(run);
+}
+
+/**
+ * @brief Publish the final state, notify and drop the job reference
+ *
+ * The agent is released before on_done so the callback may start
+ * another run on it.
+ */
+static void agent_run_complete(ac_agent_run_t *run, ac_agent_result_t *result,
+                               ac_run_status_t status) {
+    /* Stop cancel from reaching the agent once it may be reused */
+    pthread_mutex_lock(&run->lock);
+    run->finished = 1;
+    pthread_mutex_unlock(&run->lock);
+
+    agent_run_unclaim(run->agent->priv);
+
+    ARC_FREE(run->message);
+    run->message = NULL;
+
+    if (run->on_done) {
+        run->on_done(run->agent, result, run->user_data);
+    }
+
+    pthread_mutex_lock(&run->lock);
+    run->result = result;
+    run->status = status;
+#ifdef ARC_HAS_THREADS
+    pthread_cond_broadcast(&run->cond);
+#elif defined(ARC_PLATFORM_FREERTOS)
+    xSemaphoreGive(run->done);
+#endif
+    pthread_mutex_unlock(&run->lock);
+
+    agent_run_unref(run);
+}
+
+static void agent_run_job(void *arg) {
+    ac_agent_run_t *run = (ac_agent_run_t *)arg;
+    agent_priv_t *priv = run->agent->priv;
+
+    pthread_mutex_lock(&run->lock);
+    int cancelled = run->cancelled;
+    if (!cancelled) {
+        run->status = AC_RUN_RUNNING;
+    }
+    pthread_mutex_unlock(&run->lock);
+
+    if (cancelled) {
+        agent_run_complete(run, NULL, AC_RUN_CANCELLED);
+        return;
+    }
+
+    ac_agent_result_t *result = agent_run_dispatch(priv, run->message);
+
+    ac_run_status_t status = AC_RUN_DONE;
+    if (!result) {
+        status = AC_RUN_FAILED;
+    } else if (!result->content && priv->cancel_requested) {
+        result = NULL;
+        status = AC_RUN_CANCELLED;
+    }
+
+    agent_run_complete(run, result, status);
+}
+
+static void agent_run_drop(void *arg) {
+    AC_LOG_DEBUG("Queued agent run dropped");
+    agent_run_complete((ac_agent_run_t *)arg, NULL, AC_RUN_CANCELLED);
+}
+
+ac_agent_run_t *ac_agent_run_async(
+    ac_agent_t *agent,
+    const char *message,
+    ac_agent_done_fn on_done,
+    void *user_data
+) {
+    if (!agent || !agent->priv || !message) {
+        AC_LOG_ERROR("Invalid arguments to ac_agent_run_async");
+        return NULL;
+    }
+
+    agent_priv_t *priv = agent->priv;
+
+    ac_agent_run_t *run = (ac_agent_run_t *)ARC_CALLOC(1, sizeof(ac_agent_run_t));
+    if (!run) {
+        AC_LOG_ERROR("Failed to allocate agent run");
+        return NULL;
+    }
+
+    run->message = ARC_STRDUP(message);
+    if (!run->message || pthread_mutex_init(&run->lock, NULL) != 0) {
+        AC_LOG_ERROR("Failed to initialize agent run");
+        ARC_FREE(run->message);
+        ARC_FREE(run);
+        return NULL;
+    }
+#ifdef ARC_HAS_THREADS
+    if (pthread_cond_init(&run->cond, NULL) != 0) {
+        AC_LOG_ERROR("Failed to initialize agent run");
+        pthread_mutex_destroy(&run->lock);
+        ARC_FREE(run->message);
+        ARC_FREE(run);
+        return NULL;
+    }
+#elif defined(ARC_PLATFORM_FREERTOS)
+    run->done = xSemaphoreCreateBinary();
+    if (!run->done) {
+        AC_LOG_ERROR("Failed to initialize agent run");
+        pthread_mutex_destroy(&run->lock);
+        ARC_FREE(run->message);
+        ARC_FREE(run);
+        return NULL;
+    }
+#endif
+
+    run->agent = agent;
+    run->on_done = on_done;
+    run->user_data = user_data;
+    run->status = AC_RUN_PENDING;
+    run->refs = 2;
+
+    if (!agent_run_claim(priv)) {
+        AC_LOG_ERROR("Agent is already running");
+        run->refs = 1;
+        agent_run_unref(run);
+        return NULL;
+    }
+
+    ac_executor_t *executor = ac_session_get_executor(priv->session);
+    if (!executor || ac_executor_submit(executor, agent_run_job, agent_run_drop, run,
+                                        priv->priority) != ARC_OK) {
+        /* No worker threads on this platform (or session closing): run inline */
+        AC_LOG_DEBUG("Agent run executing inline");
+        agent_run_job(run);
+    }
+
+    return run;
+}
+
+ac_run_status_t ac_agent_run_poll(ac_agent_run_t *run) {
+    if (!run) {
+        return AC_RUN_FAILED;
+    }
+
+    pthread_mutex_lock(&run->lock);
+    ac_run_status_t status = run->status;
+    pthread_mutex_unlock(&run->lock);
+    return status;
+}
+
+ac_agent_result_t *ac_agent_run_wait(ac_agent_run_t *run) {
+    if (!run) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&run->lock);
+#ifdef ARC_HAS_THREADS
+    while (run->status == AC_RUN_PENDING || run->status == AC_RUN_RUNNING) {
+        pthread_cond_wait(&run->cond, &run->lock);
+    }
+#elif defined(ARC_PLATFORM_FREERTOS)
+    while (run->status == AC_RUN_PENDING || run->status == AC_RUN_RUNNING) {
+        pthread_mutex_unlock(&run->lock);
+        xSemaphoreTake(run->done, portMAX_DELAY);
+        /* Hand it on so every waiter wakes */
+        xSemaphoreGive(run->done);
+        pthread_mutex_lock(&run->lock);
+    }
+#endif
+    ac_agent_result_t *result = run->result;
+    pthread_mutex_unlock(&run->lock);
+    return result;
+}
+
+void ac_agent_run_cancel(ac_agent_run_t *run) {
+    if (!run) {
+        return;
+    }
+
+    agent_priv_t *priv = run->agent->priv;
+
+    pthread_mutex_lock(&run->lock);
+    run->cancelled = 1;
+    if (run->status == AC_RUN_RUNNING && !run->finished) {
+        pthread_mutex_lock(&priv->run_lock);
+        priv->cancel_requested = 1;
+        pthread_mutex_unlock(&priv->run_lock);
+    }
+    pthread_mutex_unlock(&run->lock);
+}
+
+void ac_agent_run_release(ac_agent_run_t *run) {
+    if (run) {
+        agent_run_unref(run);
+    }
+}
+
+/*============================================================================
+ * Stepped Run API
+ *============================================================================*/
+
+typedef struct agent_stepper {
+    ac_agent_t *agent;
+    agent_react_t react;
+    ac_step_state_t state;
+    int pending;                     /* Phase job not finished yet (run_lock) */
+    int llm_begun;                   /* react_llm_begin() done for this iteration */
+    ac_llm_call_t *call;             /* Model call on the HTTP engine (run_lock) */
+    arena_scratch_t scratch;
+    ac_agent_wake_fn wake;
+    void *user_data;
+} agent_stepper_t;
+
+/**
+ * @brief Mark the phase finished and wake the stepping thread
+ */
+static void stepper_settle(agent_stepper_t *st) {
+    /* The stepping thread may free st as soon as pending drops */
+    ac_agent_t *agent = st->agent;
+    ac_agent_wake_fn wake = st->wake;
+    void *user_data = st->user_data;
+
+    pthread_mutex_lock(&agent->priv->run_lock);
+    st->pending = 0;
+    pthread_mutex_unlock(&agent->priv->run_lock);
+
+    if (wake) {
+        wake(agent, user_data);
+    }
+}
+
+static void stepper_job(void *arg) {
+    agent_stepper_t *st = (agent_stepper_t *)arg;
+    agent_priv_t *priv = st->agent->priv;
+
+    if (st->state != AC_STEP_AWAIT_LLM) {
+        react_tools_run(priv, &st->react);
+    } else if (st->llm_begun) {
+        react_llm_request(priv, &st->react);
+        react_llm_end(priv, &st->react);
+    } else {
+        react_llm_call(priv, &st->react);
+    }
+
+    stepper_settle(st);
+}
+
+static void stepper_drop(void *arg) {
+    agent_stepper_t *st = (agent_stepper_t *)arg;
+
+    AC_LOG_DEBUG("Queued agent step dropped");
+    if (st->state == AC_STEP_AWAIT_LLM) {
+        /* Tool jobs left without a result report a failure on their own */
+        ac_chat_response_init_arena(&st->react.response, st->agent->priv->arena);
+        st->react.llm_err = ARC_ERR_CANCELLED;
+    }
+
+    pthread_mutex_lock(&st->agent->priv->run_lock);
+    st->agent->priv->cancel_requested = 1;
+    st->pending = 0;
+    pthread_mutex_unlock(&st->agent->priv->run_lock);
+}
+
+/**
+ * @brief Engine completion (I/O thread): the step collects the response
+ */
+static void stepper_llm_done(ac_llm_call_t *call, void *user_data) {
+    (void)call;
+    stepper_settle((agent_stepper_t *)user_data);
+}
+
+/**
+ * @brief Send the model call through the HTTP pool's engine
+ *
+ * Draft routing and chained responses decide between calls and stay
+ * on the executor, as does anything ac_llm_chat_submit() refuses.
+ *
+ * @return 1 if the phase is under way (or already failed), 0 to run it
+ *         on the executor
+ */
+static int stepper_llm_submit(agent_stepper_t *st) {
+    agent_priv_t *priv = st->agent->priv;
+    agent_react_t *r = &st->react;
+
+    if ((priv->draft && r->tools_schema) ||
+        (ARC_FEATURE_STATEFUL && ac_llm_chains_responses(priv->llm))) {
+        return 0;
+    }
+
+    react_llm_begin(priv, r);
+    st->llm_begun = 1;
+
+    ac_llm_call_t *call = NULL;
+    arena_set_tag(priv->arena, ARENA_TAG_LLM);
+    arc_err_t err = ac_llm_chat_submit(priv->llm, priv->history.head, r->tools_schema,
+                                       &r->response, stepper_llm_done, st, &call);
+    arena_set_tag(priv->arena, ARENA_TAG_HISTORY);
+    if (err == ARC_ERR_NOT_IMPLEMENTED) {
+        return 0;
+    }
+    if (err != ARC_OK) {
+        r->llm_err = err;
+        react_llm_end(priv, r);
+        stepper_settle(st);
+        return 1;
+    }
+
+    /* Completion may already have fired; only this thread finishes it */
+    pthread_mutex_lock(&priv->run_lock);
+    st->call = call;
+    pthread_mutex_unlock(&priv->run_lock);
+    return 1;
+}
+
+/**
+ * @brief Run the phase for state on the executor (inline without one)
+ */
+static void stepper_submit(agent_stepper_t *st, ac_step_state_t state) {
+    agent_priv_t *priv = st->agent->priv;
+
+    st->state = state;
+    pthread_mutex_lock(&priv->run_lock);
+    st->pending = 1;
+    pthread_mutex_unlock(&priv->run_lock);
+
+    if (state == AC_STEP_AWAIT_LLM && !st->llm_begun && stepper_llm_submit(st)) {
+        return;
+    }
+
+    ac_executor_t *executor = ac_session_get_executor(priv->session);
+    if (!executor || ac_executor_submit(executor, stepper_job, stepper_drop, st,
+                                        priv->priority) != ARC_OK) {
+        stepper_job(st);
+    }
+}
+
+/**
+ * @brief Collect the engine's response on the stepping thread
+ *
+ * @return 0 if the call is being retried (the phase is pending again)
+ */
+static int stepper_llm_collect(agent_stepper_t *st) {
+    agent_priv_t *priv = st->agent->priv;
+    agent_react_t *r = &st->react;
+
+    pthread_mutex_lock(&priv->run_lock);
+    ac_llm_call_t *call = st->call;
+    st->call = NULL;
+    pthread_mutex_unlock(&priv->run_lock);
+
+    int retry = 0;
+    arena_set_tag(priv->arena, ARENA_TAG_LLM);
+    r->llm_err = ac_llm_call_finish(call, &retry);
+    arena_set_tag(priv->arena, ARENA_TAG_HISTORY);
+
+    if (retry && !agent_stopping(priv)) {
+        /* Backoff sleeps: the blocking path on the executor owns those */
+        stepper_submit(st, AC_STEP_AWAIT_LLM);
+        return 0;
+    }
+    react_llm_end(priv, r);
+    return 1;
+}
+
+/**
+ * @brief Start the next iteration's model call, or finish the run
+ */
+static void stepper_next_iteration(agent_stepper_t *st) {
+    agent_priv_t *priv = st->agent->priv;
+
+    st->llm_begun = 0;
+    if (react_iter_begin(priv, &st->react)) {
+        stepper_submit(st, AC_STEP_AWAIT_LLM);
+    } else {
+        st->state = AC_STEP_DONE;
+    }
+}
+
+static void stepper_free(agent_stepper_t *st) {
+    agent_priv_t *priv = st->agent->priv;
+
+    /* Only a run abandoned mid-iteration still holds these */
+    if (st->call) {
+        /* Session close drains the executor, not the engine */
+        pthread_mutex_lock(&priv->run_lock);
+        ac_llm_call_cancel(st->call);
+        while (st->pending) {
+            pthread_mutex_unlock(&priv->run_lock);
+            ac_platform_sleep_ms(1);
+            pthread_mutex_lock(&priv->run_lock);
+        }
+        pthread_mutex_unlock(&priv->run_lock);
+        ac_llm_call_finish(st->call, NULL);
+    }
+    if (st->state != AC_STEP_DONE) {
+        free_tool_jobs(st->react.jobs, st->react.job_count);
+        ac_chat_response_free(&st->react.response);
+    }
+    arena_scratch_end(&st->scratch);
+    priv->stepper = NULL;
+    ARC_FREE(st);
+}
+
+arc_err_t ac_agent_start(
+    ac_agent_t *agent,
+    const char *message,
+    ac_agent_wake_fn wake,
+    void *user_data
+) {
+    if (!agent || !agent->priv) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    agent_priv_t *priv = agent->priv;
+    if (!priv->arena || !priv->llm) {
+        return ARC_ERR_INVALID_STATE;
+    }
+    if (!agent_run_claim(priv)) {
+        AC_LOG_ERROR("Agent is already running");
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    /* Resuming needs a history that is waiting for the model */
+    const ac_message_t *tail = priv->history.tail;
+    if (!message && (!tail || (tail->role != AC_ROLE_USER && tail->role != AC_ROLE_TOOL))) {
+        agent_run_unclaim(priv);
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    agent_stepper_t *st = (agent_stepper_t *)ARC_CALLOC(1, sizeof(agent_stepper_t));
+    if (!st) {
+        agent_run_unclaim(priv);
+        return ARC_ERR_NO_MEMORY;
+    }
+    st->agent = agent;
+    st->wake = wake;
+    st->user_data = user_data;
+    st->scratch = arena_scratch_begin(priv->scratch);
+    st->state = AC_STEP_DONE;
+    priv->stepper = st;
+    agent_input_open(priv);
+
+    if (!react_begin(priv, &st->react, message)) {
+        stepper_free(st);
+        agent_run_unclaim(priv);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    stepper_next_iteration(st);
+    return ARC_OK;
+}
+
+ac_step_state_t ac_agent_step(ac_agent_t *agent, ac_agent_result_t **result) {
+    if (result) {
+        *result = NULL;
+    }
+    if (!agent || !agent->priv || !agent->priv->stepper) {
+        return AC_STEP_DONE;
+    }
+
+    agent_priv_t *priv = agent->priv;
+    agent_stepper_t *st = priv->stepper;
+
+    pthread_mutex_lock(&priv->run_lock);
+    int pending = st->pending;
+    if (pending && st->call && agent_stopping(priv)) {
+        ac_llm_call_cancel(st->call);
+    }
+    pthread_mutex_unlock(&priv->run_lock);
+    if (pending) {
+        return st->state;
+    }
+
+    if (st->state == AC_STEP_AWAIT_LLM && st->call && !stepper_llm_collect(st)) {
+        return st->state;
+    }
+
+    if (st->state == AC_STEP_AWAIT_LLM) {
+        if (react_llm_done(priv, &st->react) == AC_STEP_AWAIT_TOOLS) {
+            stepper_submit(st, AC_STEP_AWAIT_TOOLS);
+        } else if (agent_input_continue(priv, st->react.iteration, st->react.failed)) {
+            st->react.final_content = NULL;
+            stepper_next_iteration(st);
+        } else {
+            st->state = AC_STEP_DONE;
+        }
+    } else if (st->state == AC_STEP_AWAIT_TOOLS) {
+        react_tools_done(priv, &st->react);
+        stepper_next_iteration(st);
+    }
+
+    if (st->state != AC_STEP_DONE) {
+        return st->state;
+    }
+
+    ac_agent_result_t *res = react_finish(priv, &st->react);
+    stepper_free(st);
+    agent_run_unclaim(priv);
+    if (result) {
+        *result = res;
+    }
+    return AC_STEP_DONE;
+}
+
+void ac_agent_step_cancel(ac_agent_t *agent) {
+    if (!agent || !agent->priv) {
+        return;
+    }
+
+    agent_priv_t *priv = agent->priv;
+    pthread_mutex_lock(&priv->run_lock);
+    if (priv->stepper) {
+        priv->cancel_requested = 1;
+        if (priv->stepper->call) {
+            ac_llm_call_cancel(priv->stepper->call);
+        }
+    }
+    pthread_mutex_unlock(&priv->run_lock);
+}
+
+arc_err_t ac_agent_snapshot_save(ac_agent_t *agent, const char *path) {
+    if (!agent || !agent->priv || !path) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    agent_priv_t *priv = agent->priv;
+
+    /* Between steps only the stepping thread changes the history */
+    int claimed = agent_run_claim(priv);
+    if (!claimed && !priv->stepper) {
+        AC_LOG_ERROR("Agent is busy with another run");
+        return ARC_ERR_INVALID_STATE;
+    }
+    arc_err_t err = ac_snapshot_write(&priv->history, path);
+    if (claimed) {
+        agent_run_unclaim(priv);
+    }
+    return err;
+}
+
+arc_err_t ac_agent_snapshot_restore(ac_agent_t *agent, const char *path) {
+    if (!agent || !agent->priv || !path) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    agent_priv_t *priv = agent->priv;
+    if (!agent_run_claim(priv)) {
+        AC_LOG_ERROR("Agent is busy with another run");
+        return ARC_ERR_INVALID_STATE;
+    }
+    agent_snapshot_t *node = (agent_snapshot_t *)arena_alloc(priv->arena, sizeof(*node));
+    if (!node) {
+        agent_run_unclaim(priv);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    /* Restore into a fresh list so a failure leaves the history intact */
+    ac_history_t restored;
+    memset(&restored, 0, sizeof(restored));
+    restored.family = priv->history.family;
+    arc_err_t err = ac_snapshot_restore(&restored, priv->arena, path, &node->snapshot);
+    if (err == ARC_OK) {
+        ac_history_reset(&priv->history);
+        priv->history = restored;
+        priv->base = NULL;
+        agent_chain_reset(priv);
+        node->next = priv->snapshots;
+        priv->snapshots = node;
+        AC_LOG_INFO("Agent %s restored %zu messages from %s",
+                    priv->name ? priv->name : "unnamed", priv->history.count, path);
+    } else {
+        ac_history_reset(&restored);
+    }
+
+    agent_run_unclaim(priv);
+    return err;
+}
+
+/**
+ * @brief Segment the history still starts with verbatim, NULL if none
+ *
+ * The history only grows by appends until something is trimmed or
+ * evicted, which bumps history.edits.
+ */
+static ac_history_segment_t *agent_history_base(const agent_priv_t *priv) {
+    if (priv->base && priv->history.edits == priv->base_edits &&
+        priv->history.count >= ac_history_segment_count(priv->base)) {
+        return priv->base;
+    }
+    return NULL;
+}
+
+static void agent_hold_segment(agent_priv_t *priv, agent_segment_t *node,
+                               ac_history_segment_t *segment) {
+    node->segment = ac_history_segment_retain(segment);
+    node->next = priv->segments;
+    priv->segments = node;
+    priv->base = segment;
+    priv->base_edits = priv->history.edits;
+}
+
+/**
+ * @brief Freeze the history (run claimed): a delta on top of the base if intact
+ */
+static arc_err_t agent_history_share(agent_priv_t *priv, ac_history_segment_t **out) {
+    ac_history_segment_t *base = agent_history_base(priv);
+    ac_history_segment_t *segment = NULL;
+    arc_err_t err = ac_segment_freeze(base, &priv->history,
+                                      ac_history_segment_count(base), &segment);
+    if (err != ARC_OK) {
+        return err;
+    }
+    if (segment != base) {
+        /* The agent's history now starts with segment: next share is a delta */
+        agent_segment_t *node = (agent_segment_t *)arena_alloc(priv->arena, sizeof(*node));
+        if (node) {
+            agent_hold_segment(priv, node, segment);
+        }
+    }
+    *out = segment;
+    return ARC_OK;
+}
+
+arc_err_t ac_agent_history_share(ac_agent_t *agent, ac_history_segment_t **out) {
+    if (!agent || !agent->priv || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    agent_priv_t *priv = agent->priv;
+    if (!agent_run_claim(priv)) {
+        AC_LOG_ERROR("Agent is busy with another run");
+        return ARC_ERR_INVALID_STATE;
+    }
+    arc_err_t err = agent_history_share(priv, out);
+    agent_run_unclaim(priv);
+    return err;
+}
+
+arc_err_t ac_agent_history_attach(ac_agent_t *agent, ac_history_segment_t *segment) {
+    if (!agent || !agent->priv || !segment) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    agent_priv_t *priv = agent->priv;
+    if (!agent_run_claim(priv)) {
+        AC_LOG_ERROR("Agent is busy with another run");
+        return ARC_ERR_INVALID_STATE;
+    }
+    agent_segment_t *node = (agent_segment_t *)arena_alloc(priv->arena, sizeof(*node));
+    if (!node) {
+        agent_run_unclaim(priv);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    /* Attach into a fresh list so a failure leaves the history intact */
+    ac_history_t attached;
+    memset(&attached, 0, sizeof(attached));
+    attached.family = priv->history.family;
+    arc_err_t err = ARC_OK;
+
+    /* Own instructions replace a different leading system prompt */
+    size_t skip = 0;
+    int own_system = 0;
+    const ac_message_t *first = ac_segment_at(segment, 0);
+    if (priv->instructions &&
+        (!first || first->role != AC_ROLE_SYSTEM || !first->content ||
+         strcmp(first->content, priv->instructions) != 0)) {
+        const ac_message_t *m;
+        while ((m = ac_segment_at(segment, skip)) && m->role == AC_ROLE_SYSTEM) {
+            skip++;
+        }
+        ac_message_t *sys_msg = ac_message_create(priv->arena, AC_ROLE_SYSTEM,
+                                                  priv->instructions);
+        err = sys_msg ? ac_history_append(&attached, sys_msg) : ARC_ERR_NO_MEMORY;
+        own_system = 1;
+    }
+    if (err == ARC_OK) {
+        err = ac_segment_attach(segment, &attached, priv->arena, skip);
+    }
+
+    if (err == ARC_OK) {
+        ac_history_reset(&priv->history);
+        priv->history = attached;
+        agent_chain_reset(priv);
+        agent_hold_segment(priv, node, segment);
+        if (own_system) {
+            /* Not a verbatim prefix: the next share copies everything */
+            priv->base = NULL;
+        }
+        AC_LOG_DEBUG("Agent %s attached %zu shared messages",
+                     priv->name ? priv->name : "unnamed", priv->history.count);
+    } else {
+        ac_history_reset(&attached);
+    }
+
+    agent_run_unclaim(priv);
+    return err;
+}
+
+ac_agent_t *ac_agent_fork(ac_agent_t *agent) {
+    if (!agent || !agent->priv) {
+        AC_LOG_ERROR("Invalid arguments to ac_agent_fork");
+        return NULL;
+    }
+
+    agent_priv_t *priv = agent->priv;
+    if (!agent_run_claim(priv)) {
+        AC_LOG_ERROR("Agent is busy with another run");
+        return NULL;
+    }
+
+    ac_history_segment_t *segment = NULL;
+    if (agent_history_share(priv, &segment) != ARC_OK) {
+        AC_LOG_ERROR("Failed to share history for fork");
+        agent_run_unclaim(priv);
+        return NULL;
+    }
+
+    /* Same configuration; strings are copied into the child's arena */
+    ac_agent_params_t params = {
+        .name = priv->name,
+        .instructions = priv->instructions,
+        .llm = *ac_llm_get_params(priv->llm),
+        .tools = priv->tools,
+        .max_iterations = priv->max_iterations,
+        .tool_workers = priv->tool_workers,
+        .eager_tools = priv->eager_tools,
+        .priority = priv->priority,
+        .memory = {
+            .max_messages = priv->max_history_messages,
+            .max_tokens = priv->max_history_tokens,
+            .max_tool_bytes = priv->max_tool_bytes,
+            .spill_dir = priv->spill_dir,
+            .dedup_tool_results = priv->history.dedup,
+        },
+        .callbacks = {
+            .on_stream = priv->stream_callback,
+            .user_data = priv->callback_user_data,
+        },
+    };
+    params.llm.cancel = priv->user_cancel;
+    params.llm.deadline_ms = 0;
+    if (priv->budget.enabled) {
+        /* The llm holds the last pick: hand down what was configured */
+        params.llm.max_tokens = priv->budget.max_tokens;
+        params.llm.thinking.budget_tokens = priv->budget.thinking;
+        params.budget = (ac_agent_budget_t){
+            .enabled = 1,
+            .min_thinking = priv->budget.min_thinking,
+            .max_tokens = priv->budget.ceiling,
+            .latency_slo_ms = priv->budget.slo_ms,
+        };
+    }
+    if (priv->draft) {
+        params.draft.llm = *ac_llm_get_params(priv->draft);
+        params.draft.llm.cancel = priv->user_cancel;
+        params.draft.llm.deadline_ms = 0;
+        params.draft.max_tool_calls = priv->draft_max_tool_calls;
+    }
+
+    ac_agent_t *child = agent_create(priv->session, &params, FORK_ARENA_SIZE);
+    if (child && ac_agent_history_attach(child, segment) != ARC_OK) {
+        /* Registered already: the session frees it on close */
+        AC_LOG_ERROR("Failed to attach history to fork");
+        child = NULL;
+    }
+
+    /* Same messages up to the stored response: keep continuing it */
+    const char *previous_id = NULL;
+    if (child && agent_chain_delta(priv, &previous_id) && previous_id) {
+        agent_priv_t *cp = child->priv;
+        cp->chain_id = arena_strdup(cp->arena, previous_id);
+        cp->chain_length = priv->chain_length;
+        cp->chain_tail = ac_history_at(&cp->history, priv->chain_length - 1);
+    }
+
+    ac_history_segment_release(segment);
+    agent_run_unclaim(priv);
+    if (child) {
+        AC_LOG_DEBUG("Agent %s forked at %zu messages",
+                     priv->name ? priv->name : "unnamed", priv->history.count);
+    }
+    return child;
+}
+
+void ac_agent_destroy(ac_agent_t *agent) {
+    if (!agent) {
+        return;
+    }
+    if (agent->priv) {
+        ac_session_remove_agent(agent->priv->session, agent);
+    }
+    ac_agent_free(agent);
+}
+
+/**
+ * @brief Free an agent its session no longer lists (session.c at close)
+ */
+void ac_agent_free(ac_agent_t *agent) {
+    agent_priv_t *priv = agent->priv;
+    if (priv) {
+        if (priv->stepper) {
+            stepper_free(priv->stepper);
+        }
+        if (priv->llm) {
+            ac_llm_cleanup(priv->llm);
+        }
+        if (priv->draft) {
+            ac_llm_cleanup(priv->draft);
+        }
+
+        /* Nodes live in the arena: unmap before it goes */
+        for (agent_snapshot_t *s = priv->snapshots; s; s = s->next) {
+            ac_snapshot_unmap(s->snapshot);
+        }
+        for (agent_segment_t *s = priv->segments; s; s = s->next) {
+            ac_history_segment_release(s->segment);
+        }
+
+        while (priv->input) {
+            agent_input_t *next = priv->input->next;
+            ARC_FREE(priv->input);
+            priv->input = next;
+        }
+
+        ac_intern_destroy(priv->intern);
+        ac_history_reset(&priv->history);
+
+        if (priv->arena) {
+            AC_LOG_DEBUG("Destroying agent arena");
+            arena_destroy(priv->arena);
+        }
+        if (priv->scratch) {
+            arena_destroy(priv->scratch);
+        }
+        ac_hook_chain_destroy(&priv->hooks);
+        pthread_mutex_destroy(&priv->run_lock);
+        pthread_mutex_destroy(&priv->stream_lock);
+        ARC_FREE(priv);
+    }
+
+    ARC_FREE(agent);
+}
+
+#if ARC_FEATURE_HOOKS
+
+arc_err_t ac_agent_add_hooks(ac_agent_t *agent, const ac_agent_hooks_t *hooks) {
+    if (!agent || !agent->priv) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    return ac_hook_chain_add(&agent->priv->hooks, hooks);
+}
+
+arc_err_t ac_agent_remove_hooks(ac_agent_t *agent, const ac_agent_hooks_t *hooks) {
+    if (!agent || !agent->priv) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    return ac_hook_chain_remove(&agent->priv->hooks, hooks);
+}
+
+#endif /* ARC_FEATURE_HOOKS */
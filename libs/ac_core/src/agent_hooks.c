@@ -3,82 +3,229 @@
  * @brief Agent hooks implementation
  */
 
-#include "arc/agent_hooks.h"
+#include "agent_hooks_internal.h"
+#include "arc/platform.h"
+#include "arc/profile.h"
 #include <string.h>
 
 /*============================================================================
- * Static State
+ * Subscriber Lists
  *============================================================================*/
 
-static ac_agent_hooks_t s_hooks = {0};
-static int s_hooks_set = 0;
+typedef struct {
+    const ac_agent_hooks_t *key;     /* Caller's structure, identifies it on remove */
+    ac_agent_hooks_t hooks;          /* Copy taken on add */
+} hook_entry_t;
 
-/*============================================================================
- * Public API
- *============================================================================*/
+struct ac_hook_list {
+    ac_hook_list_t *retired;         /* Next replaced list */
+    size_t count;
+    hook_entry_t items[];
+};
 
-void ac_agent_set_hooks(const ac_agent_hooks_t *hooks) {
-    if (hooks) {
-        memcpy(&s_hooks, hooks, sizeof(ac_agent_hooks_t));
-        s_hooks_set = 1;
-    } else {
-        memset(&s_hooks, 0, sizeof(ac_agent_hooks_t));
-        s_hooks_set = 0;
+ac_hook_chain_t ac_hook_global = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static ac_hook_list_t *list_alloc(size_t count) {
+    ac_hook_list_t *list = (ac_hook_list_t *)ARC_MALLOC(
+        sizeof(ac_hook_list_t) + count * sizeof(hook_entry_t));
+    if (list) {
+        list->retired = NULL;
+        list->count = count;
     }
+    return list;
 }
 
-const ac_agent_hooks_t *ac_agent_get_hooks(void) {
-    return s_hooks_set ? &s_hooks : NULL;
+static void list_free_retired(ac_hook_list_t *list) {
+    while (list) {
+        ac_hook_list_t *next = list->retired;
+        ARC_FREE(list);
+        list = next;
+    }
 }
 
-/*============================================================================
- * Internal Hook Invocation (used by agent.c)
- *============================================================================*/
-
-void ac_hook_call_run_start(const ac_hook_run_start_t *info) {
-    if (s_hooks_set && s_hooks.on_run_start) {
-        s_hooks.on_run_start(s_hooks.ctx, info);
+/**
+ * @brief Swap in next (NULL = empty), caller holds chain->lock
+ *
+ * The reader count is checked after the swap: a dispatch that enters
+ * later already sees next, so retired lists can go when it reads zero.
+ */
+static void chain_publish(ac_hook_chain_t *chain, ac_hook_list_t *next) {
+    ac_hook_list_t *prev = atomic_exchange(&chain->list, next);
+    if (prev) {
+        prev->retired = chain->retired;
+        chain->retired = prev;
+    }
+    if (atomic_load(&chain->readers) == 0) {
+        list_free_retired(chain->retired);
+        chain->retired = NULL;
     }
 }
 
-void ac_hook_call_run_end(const ac_hook_run_end_t *info) {
-    if (s_hooks_set && s_hooks.on_run_end) {
-        s_hooks.on_run_end(s_hooks.ctx, info);
+static ac_hook_list_t *chain_enter(ac_hook_chain_t *chain) {
+    if (!ac_hook_chain_busy(chain)) {
+        return NULL;
     }
+    atomic_fetch_add(&chain->readers, 1);
+    ac_hook_list_t *list = atomic_load(&chain->list);
+    if (!list) {
+        atomic_fetch_sub(&chain->readers, 1);
+    }
+    return list;
 }
 
-void ac_hook_call_iter_start(const ac_hook_iter_t *info) {
-    if (s_hooks_set && s_hooks.on_iter_start) {
-        s_hooks.on_iter_start(s_hooks.ctx, info);
-    }
+static void chain_leave(ac_hook_chain_t *chain) {
+    atomic_fetch_sub_explicit(&chain->readers, 1, memory_order_release);
 }
 
-void ac_hook_call_iter_end(const ac_hook_iter_t *info) {
-    if (s_hooks_set && s_hooks.on_iter_end) {
-        s_hooks.on_iter_end(s_hooks.ctx, info);
+static size_t list_find(const ac_hook_list_t *list, const ac_agent_hooks_t *key) {
+    size_t count = list ? list->count : 0;
+    for (size_t i = 0; i < count; i++) {
+        if (list->items[i].key == key) {
+            return i;
+        }
     }
+    return count;
 }
 
-void ac_hook_call_llm_request(const ac_hook_llm_request_t *info) {
-    if (s_hooks_set && s_hooks.on_llm_request) {
-        s_hooks.on_llm_request(s_hooks.ctx, info);
-    }
+/*============================================================================
+ * Chain API (internal)
+ *============================================================================*/
+
+void ac_hook_chain_init(ac_hook_chain_t *chain) {
+    atomic_init(&chain->list, NULL);
+    atomic_init(&chain->readers, 0);
+    chain->retired = NULL;
+    pthread_mutex_init(&chain->lock, NULL);
+}
+
+void ac_hook_chain_destroy(ac_hook_chain_t *chain) {
+    ARC_FREE(atomic_load(&chain->list));
+    atomic_store(&chain->list, NULL);
+    list_free_retired(chain->retired);
+    chain->retired = NULL;
+    pthread_mutex_destroy(&chain->lock);
 }
 
-void ac_hook_call_llm_response(const ac_hook_llm_response_t *info) {
-    if (s_hooks_set && s_hooks.on_llm_response) {
-        s_hooks.on_llm_response(s_hooks.ctx, info);
+arc_err_t ac_hook_chain_add(ac_hook_chain_t *chain, const ac_agent_hooks_t *hooks) {
+    if (!chain || !hooks) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&chain->lock);
+    ac_hook_list_t *cur = atomic_load(&chain->list);
+    size_t count = cur ? cur->count : 0;
+    if (list_find(cur, hooks) < count) {
+        pthread_mutex_unlock(&chain->lock);
+        return ARC_ERR_EXISTS;
+    }
+
+    ac_hook_list_t *next = list_alloc(count + 1);
+    if (!next) {
+        pthread_mutex_unlock(&chain->lock);
+        return ARC_ERR_MEMORY;
+    }
+    if (count > 0) {
+        memcpy(next->items, cur->items, count * sizeof(hook_entry_t));
     }
+    next->items[count].key = hooks;
+    next->items[count].hooks = *hooks;
+
+    chain_publish(chain, next);
+    pthread_mutex_unlock(&chain->lock);
+    return ARC_OK;
 }
 
-void ac_hook_call_tool_start(const ac_hook_tool_start_t *info) {
-    if (s_hooks_set && s_hooks.on_tool_start) {
-        s_hooks.on_tool_start(s_hooks.ctx, info);
+arc_err_t ac_hook_chain_remove(ac_hook_chain_t *chain, const ac_agent_hooks_t *hooks) {
+    if (!chain || !hooks) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&chain->lock);
+    ac_hook_list_t *cur = atomic_load(&chain->list);
+    size_t count = cur ? cur->count : 0;
+    size_t index = list_find(cur, hooks);
+    if (index == count) {
+        pthread_mutex_unlock(&chain->lock);
+        return ARC_ERR_NOT_FOUND;
+    }
+
+    ac_hook_list_t *next = NULL;
+    if (count > 1) {
+        next = list_alloc(count - 1);
+        if (!next) {
+            pthread_mutex_unlock(&chain->lock);
+            return ARC_ERR_MEMORY;
+        }
+        memcpy(next->items, cur->items, index * sizeof(hook_entry_t));
+        memcpy(next->items + index, cur->items + index + 1,
+               (count - index - 1) * sizeof(hook_entry_t));
     }
+
+    chain_publish(chain, next);
+    pthread_mutex_unlock(&chain->lock);
+    return ARC_OK;
 }
 
-void ac_hook_call_tool_end(const ac_hook_tool_end_t *info) {
-    if (s_hooks_set && s_hooks.on_tool_end) {
-        s_hooks.on_tool_end(s_hooks.ctx, info);
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+void ac_agent_set_hooks(const ac_agent_hooks_t *hooks) {
+    ac_hook_list_t *next = NULL;
+    if (hooks) {
+        next = list_alloc(1);
+        if (!next) {
+            return;
+        }
+        next->items[0].key = hooks;
+        next->items[0].hooks = *hooks;
     }
+
+    pthread_mutex_lock(&ac_hook_global.lock);
+    chain_publish(&ac_hook_global, next);
+    pthread_mutex_unlock(&ac_hook_global.lock);
 }
+
+const ac_agent_hooks_t *ac_agent_get_hooks(void) {
+    ac_hook_list_t *list = atomic_load(&ac_hook_global.list);
+    return list ? &list->items[0].hooks : NULL;
+}
+
+/*============================================================================
+ * Internal Hook Invocation (used by agent.c)
+ *============================================================================*/
+
+#define CHAIN_CALL(chain, field, info) \
+    do { \
+        ac_hook_list_t *list_ = chain_enter(chain); \
+        if (list_) { \
+            for (size_t i_ = 0; i_ < list_->count; i_++) { \
+                const ac_agent_hooks_t *h_ = &list_->items[i_].hooks; \
+                if (h_->field) { \
+                    h_->field(h_->ctx, info); \
+                } \
+            } \
+            chain_leave(chain); \
+        } \
+    } while (0)
+
+#define DEFINE_HOOK_CALL(name, field, info_type) \
+    void ac_hook_call_##name(const ac_hook_scope_t *scope, const info_type *info) { \
+        ac_prof_push(AC_PROF_HOOKS); \
+        CHAIN_CALL(&ac_hook_global, field, info); \
+        if (scope) { \
+            CHAIN_CALL(scope->session, field, info); \
+            CHAIN_CALL(scope->agent, field, info); \
+        } \
+        ac_prof_pop(); \
+    }
+
+DEFINE_HOOK_CALL(run_start, on_run_start, ac_hook_run_start_t)
+DEFINE_HOOK_CALL(run_end, on_run_end, ac_hook_run_end_t)
+DEFINE_HOOK_CALL(iter_start, on_iter_start, ac_hook_iter_t)
+DEFINE_HOOK_CALL(iter_end, on_iter_end, ac_hook_iter_t)
+DEFINE_HOOK_CALL(llm_request, on_llm_request, ac_hook_llm_request_t)
+DEFINE_HOOK_CALL(llm_response, on_llm_response, ac_hook_llm_response_t)
+DEFINE_HOOK_CALL(tool_start, on_tool_start, ac_hook_tool_start_t)
+DEFINE_HOOK_CALL(tool_end, on_tool_end, ac_hook_tool_end_t)
+DEFINE_HOOK_CALL(mcp_connection, on_mcp_connection, ac_hook_mcp_connection_t)
@@ -3,46 +3,129 @@
  * @brief Internal hook invocation functions and macros
  *
  * This header provides:
+ * - Subscriber chains (global, per session, per agent)
  * - Hook invocation functions (used by agent.c)
  * - AC_HOOK_CALL macro for compile-time and runtime control
  *
  * Compile-time control:
  * - Define AC_DISABLE_HOOKS to completely disable hooks (zero overhead)
+ * - ARC_FEATURE_HOOKS=0 also leaves the chains and the subscription API
+ *   out: the chains below become empty stand-ins
  */
 
 #ifndef ARC_AGENT_HOOKS_INTERNAL_H
 #define ARC_AGENT_HOOKS_INTERNAL_H
 
 #include "arc/agent_hooks.h"
+#include "arc/error.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include <stdatomic.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*============================================================================
+ * Subscriber Chains
+ *
+ * A chain publishes an immutable list of subscribers through one atomic
+ * pointer; add/remove build a new list under the lock. A replaced list is
+ * freed once no dispatch is inside the chain, so callbacks may run on any
+ * thread while subscribers come and go.
+ *============================================================================*/
+
+#if ARC_FEATURE_HOOKS
+
+typedef struct ac_hook_list ac_hook_list_t;
+
+typedef struct {
+    _Atomic(ac_hook_list_t *) list;   /* NULL = no subscribers */
+    atomic_size_t readers;            /* Dispatches inside the chain */
+    ac_hook_list_t *retired;          /* Replaced lists not yet freed */
+    pthread_mutex_t lock;             /* Writers */
+} ac_hook_chain_t;
+
+/**
+ * @brief Chains one agent's events go to (besides the global one)
+ */
+typedef struct {
+    ac_hook_chain_t *session;    /**< May be NULL */
+    ac_hook_chain_t *agent;      /**< May be NULL */
+} ac_hook_scope_t;
+
+/** Chain filled by ac_agent_set_hooks() */
+extern ac_hook_chain_t ac_hook_global;
+
+void ac_hook_chain_init(ac_hook_chain_t *chain);
+void ac_hook_chain_destroy(ac_hook_chain_t *chain);
+
+/**
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_MEMORY,
+ *         ARC_ERR_EXISTS (hooks already subscribed)
+ */
+arc_err_t ac_hook_chain_add(ac_hook_chain_t *chain, const ac_agent_hooks_t *hooks);
+
+/**
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_NOT_FOUND
+ */
+arc_err_t ac_hook_chain_remove(ac_hook_chain_t *chain, const ac_agent_hooks_t *hooks);
+
+static inline int ac_hook_chain_busy(ac_hook_chain_t *chain) {
+    return chain && atomic_load_explicit(&chain->list, memory_order_relaxed) != NULL;
+}
+
+/**
+ * @brief Any subscriber for this scope? (one relaxed load per chain)
+ */
+static inline int ac_hooks_active(const ac_hook_scope_t *scope) {
+    return ac_hook_chain_busy(&ac_hook_global) ||
+           (scope && (ac_hook_chain_busy(scope->session) ||
+                      ac_hook_chain_busy(scope->agent)));
+}
+
+#else /* !ARC_FEATURE_HOOKS */
+
+/* Sessions and agents keep their members; nothing is ever subscribed */
+typedef struct {
+    char unused;
+} ac_hook_chain_t;
+
+typedef struct {
+    ac_hook_chain_t *session;
+    ac_hook_chain_t *agent;
+} ac_hook_scope_t;
+
+static inline void ac_hook_chain_init(ac_hook_chain_t *chain) { (void)chain; }
+static inline void ac_hook_chain_destroy(ac_hook_chain_t *chain) { (void)chain; }
+
+#endif /* ARC_FEATURE_HOOKS */
+
 /*============================================================================
  * Compile-time Hook Control
  *============================================================================*/
 
 #ifdef AC_DISABLE_HOOKS
 
-/* Completely disable hooks - zero overhead */
-#define AC_HOOK_CALL(func, info_ptr) ((void)0)
+/* Completely disable hooks - zero overhead (the info is only referenced) */
+#define AC_HOOK_CALL(scope, func, info_ptr) ((void)(scope), (void)(info_ptr))
 
 #else
 
 /**
- * @brief Call a hook function if hooks are registered
+ * @brief Call a hook function if any chain of the scope has subscribers
  *
- * This macro provides runtime check - only calls the hook if
- * ac_agent_get_hooks() returns non-NULL.
+ * The info structure is only built into the call when somebody listens;
+ * agents without subscribers pay a few relaxed loads.
  *
+ * @param scope Agent scope (const ac_hook_scope_t *, NULL = global only)
  * @param func The hook call function (e.g., ac_hook_call_run_start)
  * @param info_ptr Pointer to the hook info structure
  */
-#define AC_HOOK_CALL(func, info_ptr) \
+#define AC_HOOK_CALL(scope, func, info_ptr) \
     do { \
-        if (ac_agent_get_hooks()) { \
-            func(info_ptr); \
+        if (ac_hooks_active(scope)) { \
+            func(scope, info_ptr); \
         } \
     } while(0)
 
@@ -51,20 +134,22 @@ extern "C" {
 /*============================================================================
  * Internal Hook Invocation Functions
  *
- * These functions check if the specific hook callback is set and call it.
+ * These functions call the callback of every subscriber that sets it:
+ * global chain first, then the session's, then the agent's.
  * They are used by AC_HOOK_CALL macro.
  *============================================================================*/
 
 #ifndef AC_DISABLE_HOOKS
 
-void ac_hook_call_run_start(const ac_hook_run_start_t *info);
-void ac_hook_call_run_end(const ac_hook_run_end_t *info);
-void ac_hook_call_iter_start(const ac_hook_iter_t *info);
-void ac_hook_call_iter_end(const ac_hook_iter_t *info);
-void ac_hook_call_llm_request(const ac_hook_llm_request_t *info);
-void ac_hook_call_llm_response(const ac_hook_llm_response_t *info);
-void ac_hook_call_tool_start(const ac_hook_tool_start_t *info);
-void ac_hook_call_tool_end(const ac_hook_tool_end_t *info);
+void ac_hook_call_run_start(const ac_hook_scope_t *scope, const ac_hook_run_start_t *info);
+void ac_hook_call_run_end(const ac_hook_scope_t *scope, const ac_hook_run_end_t *info);
+void ac_hook_call_iter_start(const ac_hook_scope_t *scope, const ac_hook_iter_t *info);
+void ac_hook_call_iter_end(const ac_hook_scope_t *scope, const ac_hook_iter_t *info);
+void ac_hook_call_llm_request(const ac_hook_scope_t *scope, const ac_hook_llm_request_t *info);
+void ac_hook_call_llm_response(const ac_hook_scope_t *scope, const ac_hook_llm_response_t *info);
+void ac_hook_call_tool_start(const ac_hook_scope_t *scope, const ac_hook_tool_start_t *info);
+void ac_hook_call_tool_end(const ac_hook_scope_t *scope, const ac_hook_tool_end_t *info);
+void ac_hook_call_mcp_connection(const ac_hook_scope_t *scope, const ac_hook_mcp_connection_t *info);
 
 #endif /* AC_DISABLE_HOOKS */
 
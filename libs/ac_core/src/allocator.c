@@ -0,0 +1,299 @@
+/**
+ * @file allocator.c
+ * @brief Process-wide runtime allocator
+ *
+ * Until an allocator is installed every call goes straight to libc,
+ * behind one well-predicted branch - or, in ARC_STATIC_MEMORY builds,
+ * to the process static pool (static_pool.c), never to malloc.
+ *
+ * Allocation counting installs itself as the custom allocator and
+ * forwards to the one it replaced.
+ */
+
+#include "arc/allocator.h"
+#include "arc/arena.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "cjson_arena.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Default Allocator
+ *============================================================================*/
+
+#if ARC_STATIC_MEMORY
+/* Declared in static_pool.c */
+extern void *ac_static_memory_alloc(size_t size);
+extern void *ac_static_memory_realloc(void *ptr, size_t size);
+extern void ac_static_memory_free(void *ptr);
+
+#define DEFAULT_MALLOC(size)       ac_static_memory_alloc(size)
+#define DEFAULT_REALLOC(ptr, size) ac_static_memory_realloc(ptr, size)
+#define DEFAULT_FREE(ptr)          ac_static_memory_free(ptr)
+
+static void *default_calloc(size_t n, size_t size) {
+    if (size && n > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *ptr = ac_static_memory_alloc(n * size);
+    if (ptr) {
+        memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+#define DEFAULT_CALLOC(n, size)    default_calloc(n, size)
+#else
+#define DEFAULT_MALLOC(size)       malloc(size)
+#define DEFAULT_REALLOC(ptr, size) realloc(ptr, size)
+#define DEFAULT_FREE(ptr)          free(ptr)
+#define DEFAULT_CALLOC(n, size)    calloc(n, size)
+#endif
+
+static void *libc_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return DEFAULT_MALLOC(size);
+}
+
+static void *libc_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return DEFAULT_REALLOC(ptr, new_size);
+}
+
+static void libc_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    DEFAULT_FREE(ptr);
+}
+
+static const ac_allocator_t s_libc = { libc_alloc, libc_realloc, libc_free, NULL };
+
+static ac_allocator_t s_custom;
+static int s_installed = 0;
+
+/*============================================================================
+ * Process-wide Allocator
+ *============================================================================*/
+
+arc_err_t ac_allocator_set(const ac_allocator_t *allocator) {
+#if ARC_RUNTIME_ALLOCATOR
+    if (allocator && (!allocator->alloc || !allocator->realloc || !allocator->free)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    /* Cached blocks belong to the outgoing allocator */
+    arena_cache_trim();
+
+    if (allocator) {
+        s_custom = *allocator;
+        s_installed = 1;
+    } else {
+        s_installed = 0;
+    }
+
+    /* cJSON output is freed with ARC_FREE: route its allocations too */
+    ac_cjson_install_hooks();
+
+    AC_LOG_DEBUG("Allocator: %s", allocator ? "custom" : "libc");
+    return ARC_OK;
+#else
+    (void)allocator;
+    return ARC_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+const ac_allocator_t *ac_allocator_get(void) {
+    return s_installed ? &s_custom : &s_libc;
+}
+
+/*============================================================================
+ * Allocation Counting
+ *============================================================================*/
+
+#if ARC_RUNTIME_ALLOCATOR
+static ac_allocator_t s_counted;     /* Allocator under the counter */
+static int s_counting;
+
+static struct {
+    atomic_uint_least64_t allocs;
+    atomic_uint_least64_t reallocs;
+    atomic_uint_least64_t frees;
+    atomic_uint_least64_t bytes;
+} s_counts;
+
+#ifdef ARC_THREAD_LOCAL
+static ARC_THREAD_LOCAL ac_alloc_counts_t t_counts;
+#endif
+
+static void count(atomic_uint_least64_t *total, uint64_t *local, size_t bytes) {
+    atomic_fetch_add_explicit(total, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s_counts.bytes, bytes, memory_order_relaxed);
+#ifdef ARC_THREAD_LOCAL
+    (*local)++;
+    t_counts.bytes += bytes;
+#else
+    (void)local;
+#endif
+}
+
+#ifdef ARC_THREAD_LOCAL
+#define LOCAL(field) (&t_counts.field)
+#else
+#define LOCAL(field) NULL
+#endif
+
+static void *counting_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    count(&s_counts.allocs, LOCAL(allocs), size);
+    return s_counted.alloc(s_counted.ctx, size);
+}
+
+static void *counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    if (ptr) {
+        count(&s_counts.reallocs, LOCAL(reallocs), new_size);
+    } else {
+        count(&s_counts.allocs, LOCAL(allocs), new_size);
+    }
+    return s_counted.realloc(s_counted.ctx, ptr, old_size, new_size);
+}
+
+static void counting_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    if (ptr) {
+        count(&s_counts.frees, LOCAL(frees), 0);
+    }
+    s_counted.free(s_counted.ctx, ptr, size);
+}
+#endif /* ARC_RUNTIME_ALLOCATOR */
+
+arc_err_t ac_alloc_count_start(void) {
+#if ARC_RUNTIME_ALLOCATOR
+    if (s_counting) {
+        return ARC_ERR_INVALID_STATE;
+    }
+    s_counted = *ac_allocator_get();
+    atomic_store(&s_counts.allocs, 0);
+    atomic_store(&s_counts.reallocs, 0);
+    atomic_store(&s_counts.frees, 0);
+    atomic_store(&s_counts.bytes, 0);
+    s_counting = 1;
+    return ac_allocator_set(&(ac_allocator_t){
+        counting_alloc, counting_realloc, counting_free, NULL });
+#else
+    return ARC_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+void ac_alloc_count_stop(void) {
+#if ARC_RUNTIME_ALLOCATOR
+    if (!s_counting) {
+        return;
+    }
+    s_counting = 0;
+    ac_allocator_set(s_counted.alloc == libc_alloc ? NULL : &s_counted);
+#endif
+}
+
+void ac_alloc_count_thread(ac_alloc_counts_t *counts) {
+#if ARC_RUNTIME_ALLOCATOR && defined(ARC_THREAD_LOCAL)
+    if (counts) {
+        *counts = t_counts;
+    }
+#else
+    ac_alloc_count_total(counts);
+#endif
+}
+
+void ac_alloc_count_total(ac_alloc_counts_t *counts) {
+    if (!counts) {
+        return;
+    }
+#if ARC_RUNTIME_ALLOCATOR
+    counts->allocs = atomic_load_explicit(&s_counts.allocs, memory_order_relaxed);
+    counts->reallocs = atomic_load_explicit(&s_counts.reallocs, memory_order_relaxed);
+    counts->frees = atomic_load_explicit(&s_counts.frees, memory_order_relaxed);
+    counts->bytes = atomic_load_explicit(&s_counts.bytes, memory_order_relaxed);
+#else
+    memset(counts, 0, sizeof(*counts));
+#endif
+}
+
+/*============================================================================
+ * Allocation Functions
+ *============================================================================*/
+
+void *ac_alloc(size_t size) {
+    if (!s_installed) {
+        return DEFAULT_MALLOC(size);
+    }
+    return s_custom.alloc(s_custom.ctx, size);
+}
+
+void *ac_calloc(size_t n, size_t size) {
+    if (!s_installed) {
+        return DEFAULT_CALLOC(n, size);
+    }
+    if (size && n > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *ptr = s_custom.alloc(s_custom.ctx, n * size);
+    if (ptr) {
+        memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+
+void *ac_realloc(void *ptr, size_t size) {
+    if (!s_installed) {
+        return DEFAULT_REALLOC(ptr, size);
+    }
+    return s_custom.realloc(s_custom.ctx, ptr, 0, size);
+}
+
+void ac_free(void *ptr) {
+    if (!s_installed) {
+        DEFAULT_FREE(ptr);
+        return;
+    }
+    s_custom.free(s_custom.ctx, ptr, 0);
+}
+
+void ac_free_sized(void *ptr, size_t size) {
+    if (!s_installed) {
+        DEFAULT_FREE(ptr);
+        return;
+    }
+    s_custom.free(s_custom.ctx, ptr, ptr ? size : 0);
+}
+
+char *ac_strdup(const char *s) {
+    if (!s) {
+        return NULL;
+    }
+    size_t len = strlen(s) + 1;
+    char *copy = (char *)ac_alloc(len);
+    if (copy) {
+        memcpy(copy, s, len);
+    }
+    return copy;
+}
+
+char *ac_strndup(const char *s, size_t n) {
+    if (!s) {
+        return NULL;
+    }
+    size_t len = 0;
+    while (len < n && s[len]) {
+        len++;
+    }
+    char *copy = (char *)ac_alloc(len + 1);
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
@@ -37,6 +37,9 @@ const char *ac_strerror(arc_err_t err) {
         case ARC_ERR_PARSE:           return "Parse error";
         case ARC_ERR_RESPONSE_TOO_LARGE: return "Response size exceeds limit";
         case ARC_ERR_INVALID_STATE:   return "Invalid state for operation";
+        case ARC_ERR_EXISTS:          return "Resource already exists";
+        case ARC_ERR_CANCELLED:       return "Operation cancelled";
+        case ARC_ERR_CONTEXT_OVERFLOW: return "Request exceeds the model context window";
         default:                         return "Unknown error";
     }
 }
@@ -6,20 +6,61 @@
  * block is exhausted, a new block is automatically allocated and chained.
  * All blocks are freed together when the arena is destroyed.
  *
+ * Block cache:
+ * - Blocks of a power-of-two multiple of the minimum block size are
+ *   recycled through a process-wide cache when their arena is destroyed,
+ *   bounded by ARC_ARENA_CACHE_SIZE bytes. Requests up to the largest
+ *   class are rounded up to a class so they can be recycled.
+ * - A cached block's pages are already faulted in, so short-lived arenas
+ *   (one per agent) avoid both malloc/mmap and first-touch page faults.
+ * - Threads placed with local_memory (arc/affinity.h) bind new blocks to
+ *   their NUMA node, and the cache keeps one free list per node so such
+ *   a thread is handed back memory of its own node.
+ *
+ * Allocator:
+ * - Blocks come from ARC_MALLOC unless the arena was created with its own
+ *   allocator (arena_create_with()); such arenas bypass the block cache,
+ *   since their blocks must go back to the allocator they came from.
+ *
+ * Telemetry:
+ * - With ARC_ARENA_TELEMETRY, each allocation adds its size to a counter
+ *   for the arena's current tag (two relaxed adds in thread-safe mode).
+ * - The high-water mark is not tracked on the allocation path: reset and
+ *   rewind fold total_allocated into it before lowering it, and queries
+ *   take the max with the live value. Wasted tail bytes are summed over
+ *   the filled blocks at query time.
+ *
  * Thread safety:
- * - Define ARC_ARENA_THREAD_SAFE to enable mutex protection
+ * - Define ARC_ARENA_THREAD_SAFE to allow concurrent arena_alloc() calls.
+ *   Allocation is a lock-free bump: a CAS on the current block's used
+ *   count. The mutex is only taken to switch blocks when one fills up,
+ *   and the thread that switches allocates from the new block before
+ *   publishing it, so every slow path makes progress.
+ * - reset, mark and rewind take the mutex but must not race with
+ *   allocations that are meant to survive them (they move the bump
+ *   pointer back).
  * - Without it, the arena is NOT thread-safe (typical use: one arena per agent)
  */
 
 #include "arc/arena.h"
+#include "arc/affinity.h"
 #include "arc/platform.h"
 #include "arc/log.h"
+#include "arc/metrics.h"
+#include <stddef.h>
 #include <string.h>
 
-#ifdef ARC_ARENA_THREAD_SAFE
+#if defined(ARC_ARENA_THREAD_SAFE) || ARC_ARENA_CACHE_SIZE > 0
 #include "pthread_port.h"
 #endif
 
+#ifdef ARC_ARENA_THREAD_SAFE
+#include <stdatomic.h>
+#define ARENA_ATOMIC(type) _Atomic(type)
+#else
+#define ARENA_ATOMIC(type) type
+#endif
+
 /*============================================================================
  * Constants (from platform.h, can be overridden at compile time)
  *============================================================================*/
@@ -28,6 +69,8 @@
 #define ARENA_MIN_BLOCK_SIZE    ARC_ARENA_MIN_BLOCK_SIZE
 #define ARENA_ALIGNMENT         8           /* Memory alignment */
 #define ARENA_ALIGN(size)       (((size) + (ARENA_ALIGNMENT - 1)) & ~(ARENA_ALIGNMENT - 1))
+#define ARENA_CACHE_CLASSES     12          /* Min block size << 0..11 (4KB..8MB) */
+#define ARENA_CACHE_NODES       8           /* Free lists by NUMA node (node % 8) */
 
 /*============================================================================
  * Forward Declarations
@@ -42,57 +85,265 @@ static size_t arena_block_count(const arena_t *arena);
 typedef struct arena_block {
     struct arena_block *next;   /* Next block in chain */
     size_t capacity;            /* Block capacity (excluding header) */
-    size_t used;                /* Bytes used in this block */
-    char data[];                /* Flexible array member */
+    ARENA_ATOMIC(size_t) used;  /* Bytes used in this block */
+    int node;                   /* NUMA node it was bound to, -1 = none */
+    _Alignas(ARENA_ALIGNMENT) char data[];  /* Payload: allocations are offsets into it */
 } arena_block_t;
 
+/* Sizes are rounded with ARENA_ALIGN, so the payload start must be aligned too */
+ARC_STATIC_ASSERT(offsetof(arena_block_t, data) % ARENA_ALIGNMENT == 0,
+                  "arena block payload must be ARENA_ALIGNMENT aligned");
+
 /*============================================================================
  * Arena Main Structure
  *============================================================================*/
 
 struct arena_ {
+    const ac_allocator_t *allocator;  /* NULL = ARC_MALLOC and the block cache */
     arena_block_t *head;        /* First block */
-    arena_block_t *current;     /* Current allocation block */
+    ARENA_ATOMIC(arena_block_t *) current;  /* Current allocation block */
     size_t default_block_size;  /* Default size for new blocks */
     size_t total_capacity;      /* Sum of all block capacities */
-    size_t total_allocated;     /* Sum of all allocations */
+    ARENA_ATOMIC(size_t) total_allocated;  /* Sum of all allocations */
+    size_t cache_hits;          /* Blocks reused from the block cache */
+    size_t cache_misses;        /* Blocks that had to be malloc'd */
+    size_t peak_allocated;      /* total_allocated before the last drop */
+
+#if ARC_ARENA_TELEMETRY
+    ARENA_ATOMIC(int) tag;      /* Tag charged by arena_alloc() */
+    ARENA_ATOMIC(size_t) tag_bytes[ARENA_TAG_MAX];
+    ARENA_ATOMIC(size_t) tag_count[ARENA_TAG_MAX];
+#endif
 
 #ifdef ARC_ARENA_THREAD_SAFE
     pthread_mutex_t lock;
 #endif
 };
 
+/*============================================================================
+ * Block Cache
+ *============================================================================*/
+
+#if ARC_ARENA_CACHE_SIZE > 0
+
+static struct {
+    pthread_mutex_t lock;
+    arena_block_t *free[ARENA_CACHE_NODES][ARENA_CACHE_CLASSES];  /* Linked through next */
+    size_t bytes;                              /* Capacity held, <= ARC_ARENA_CACHE_SIZE */
+} s_cache = { PTHREAD_MUTEX_INITIALIZER, { { NULL } }, 0 };
+
+static int cache_node(int node) {
+    return node < 0 ? 0 : node % ARENA_CACHE_NODES;
+}
+
+/**
+ * @brief Size class holding blocks of exactly capacity bytes, -1 if none
+ */
+static int cache_class(size_t capacity) {
+    for (int c = 0; c < ARENA_CACHE_CLASSES; c++) {
+        if (capacity == ((size_t)ARENA_MIN_BLOCK_SIZE << c)) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Round capacity up to its size class (unchanged past the largest)
+ */
+static size_t cache_round(size_t capacity) {
+    for (int c = 0; c < ARENA_CACHE_CLASSES; c++) {
+        size_t size = (size_t)ARENA_MIN_BLOCK_SIZE << c;
+        if (capacity <= size) {
+            return size;
+        }
+    }
+    return capacity;
+}
+
+static arena_block_t *cache_take(size_t capacity, int node) {
+    int c = cache_class(capacity);
+    if (c < 0) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&s_cache.lock);
+    arena_block_t **list = &s_cache.free[cache_node(node)][c];
+    arena_block_t *block = *list;
+    if (block) {
+        *list = block->next;
+        s_cache.bytes -= block->capacity;
+    }
+    pthread_mutex_unlock(&s_cache.lock);
+    return block;
+}
+
+/**
+ * @brief Keep block for reuse; 0 if it does not fit (caller frees it)
+ */
+static int cache_put(arena_block_t *block) {
+    int c = cache_class(block->capacity);
+    if (c < 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&s_cache.lock);
+    int kept = s_cache.bytes + block->capacity <= ARC_ARENA_CACHE_SIZE;
+    if (kept) {
+        arena_block_t **list = &s_cache.free[cache_node(block->node)][c];
+        block->next = *list;
+        *list = block;
+        s_cache.bytes += block->capacity;
+    }
+    pthread_mutex_unlock(&s_cache.lock);
+    return kept;
+}
+
+size_t arena_cache_trim(void) {
+    arena_block_t *lists[ARENA_CACHE_NODES][ARENA_CACHE_CLASSES];
+
+    pthread_mutex_lock(&s_cache.lock);
+    memcpy(lists, s_cache.free, sizeof(lists));
+    memset(s_cache.free, 0, sizeof(s_cache.free));
+    size_t bytes = s_cache.bytes;
+    s_cache.bytes = 0;
+    pthread_mutex_unlock(&s_cache.lock);
+
+    for (int n = 0; n < ARENA_CACHE_NODES; n++) {
+        for (int c = 0; c < ARENA_CACHE_CLASSES; c++) {
+            arena_block_t *block = lists[n][c];
+            while (block) {
+                arena_block_t *next = block->next;
+                ARC_FREE_SIZED(block, sizeof(arena_block_t) + block->capacity);
+                block = next;
+            }
+        }
+    }
+    return bytes;
+}
+
+#else /* ARC_ARENA_CACHE_SIZE == 0 */
+
+#define cache_round(capacity) (capacity)
+#define cache_take(capacity, node)  ((arena_block_t *)NULL)
+#define cache_put(block)      0
+
+size_t arena_cache_trim(void) {
+    return 0;
+}
+
+#endif /* ARC_ARENA_CACHE_SIZE */
+
 /*============================================================================
  * Internal: Create a new block
  *============================================================================*/
 
-static arena_block_t *arena_block_create(size_t capacity) {
+static ac_metric_t *arena_bytes_metric(void) {
+    return ac_metrics_gauge("arc_arena_bytes", NULL, "Bytes in blocks held by arenas");
+}
+
+static arena_block_t *arena_block_create(arena_t *arena, size_t capacity) {
     /* Enforce minimum size */
     if (capacity < ARENA_MIN_BLOCK_SIZE) {
         capacity = ARENA_MIN_BLOCK_SIZE;
     }
-
-    arena_block_t *block = (arena_block_t *)ARC_MALLOC(sizeof(arena_block_t) + capacity);
-    if (!block) {
-        return NULL;
+    capacity = cache_round(capacity);
+    int node = ac_affinity_memory_node();
+
+    arena_block_t *block = arena->allocator ? NULL : cache_take(capacity, node);
+    if (block) {
+        arena->cache_hits++;
+    } else {
+        size_t bytes = sizeof(arena_block_t) + capacity;
+        block = (arena_block_t *)(arena->allocator ?
+            arena->allocator->alloc(arena->allocator->ctx, bytes) : ARC_MALLOC(bytes));
+        if (!block) {
+            return NULL;
+        }
+        if (node >= 0) {
+            /* Before the header write faults the first page in */
+            ac_platform_bind_memory(block, bytes, node);
+        }
+        block->node = node;
+        arena->cache_misses++;
     }
 
     block->next = NULL;
     block->capacity = capacity;
     block->used = 0;
 
+    ac_metric_add(arena_bytes_metric(), (int64_t)capacity);
     return block;
 }
 
+static void arena_block_release(arena_t *arena, arena_block_t *block) {
+    size_t bytes = sizeof(arena_block_t) + block->capacity;
+    ac_metric_add(arena_bytes_metric(), -(int64_t)block->capacity);
+    if (arena->allocator) {
+        arena->allocator->free(arena->allocator->ctx, block, bytes);
+    } else if (!cache_put(block)) {
+        ARC_FREE_SIZED(block, bytes);
+    }
+}
+
+/**
+ * @brief Free the arena structure itself
+ */
+static void arena_free_struct(arena_t *arena) {
+    if (arena->allocator) {
+        arena->allocator->free(arena->allocator->ctx, arena, sizeof(arena_t));
+    } else {
+        ARC_FREE_SIZED(arena, sizeof(arena_t));
+    }
+}
+
+/*============================================================================
+ * Internal: Telemetry
+ *============================================================================*/
+
+#if ARC_ARENA_TELEMETRY
+#ifdef ARC_ARENA_THREAD_SAFE
+static inline void arena_account(arena_t *arena, size_t size) {
+    int tag = atomic_load_explicit(&arena->tag, memory_order_relaxed);
+    atomic_fetch_add_explicit(&arena->tag_bytes[tag], size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&arena->tag_count[tag], 1, memory_order_relaxed);
+}
+#else
+static inline void arena_account(arena_t *arena, size_t size) {
+    arena->tag_bytes[arena->tag] += size;
+    arena->tag_count[arena->tag]++;
+}
+#endif
+#else
+#define arena_account(arena, size) ((void)0)
+#endif
+
+/**
+ * @brief Fold the live total into the high-water mark (caller holds the lock)
+ */
+static void arena_note_peak(arena_t *arena) {
+    size_t allocated = arena->total_allocated;
+    if (allocated > arena->peak_allocated) {
+        arena->peak_allocated = allocated;
+    }
+}
+
 /*============================================================================
  * Arena API Implementation
  *============================================================================*/
 
 arena_t *arena_create(size_t capacity) {
-    arena_t *arena = (arena_t *)ARC_CALLOC(1, sizeof(arena_t));
+    return arena_create_with(capacity, NULL);
+}
+
+arena_t *arena_create_with(size_t capacity, const ac_allocator_t *allocator) {
+    arena_t *arena = (arena_t *)(allocator ?
+        allocator->alloc(allocator->ctx, sizeof(arena_t)) : ARC_MALLOC(sizeof(arena_t)));
     if (!arena) {
         return NULL;
     }
+    memset(arena, 0, sizeof(arena_t));
+    arena->allocator = allocator;
 
     /* Enforce minimum capacity */
     if (capacity < ARENA_MIN_BLOCK_SIZE) {
@@ -100,21 +351,21 @@ arena_t *arena_create(size_t capacity) {
     }
 
     /* Create initial block */
-    arena->head = arena_block_create(capacity);
+    arena->head = arena_block_create(arena, capacity);
     if (!arena->head) {
-        ARC_FREE(arena);
+        arena_free_struct(arena);
         return NULL;
     }
 
     arena->current = arena->head;
     arena->default_block_size = capacity;
-    arena->total_capacity = capacity;
+    arena->total_capacity = arena->head->capacity;
     arena->total_allocated = 0;
 
 #ifdef ARC_ARENA_THREAD_SAFE
     if (pthread_mutex_init(&arena->lock, NULL) != 0) {
-        ARC_FREE(arena->head);
-        ARC_FREE(arena);
+        arena_block_release(arena, arena->head);
+        arena_free_struct(arena);
         return NULL;
     }
 #endif
@@ -123,6 +374,50 @@ arena_t *arena_create(size_t capacity) {
     return arena;
 }
 
+/**
+ * @brief Empty block after current with room for size (caller holds the lock)
+ *
+ * Only moves forward from the current block. Blocks after current are
+ * always empty, which keeps allocation order LIFO-compatible so
+ * arena_rewind() can release everything past a mark. The block is not
+ * made current here.
+ */
+static arena_block_t *arena_next_block(arena_t *arena, arena_block_t *block, size_t size) {
+    for (arena_block_t *search = block->next; search; search = search->next) {
+        if (size <= search->capacity) {
+            /* Reuse a block released by reset/rewind */
+            return search;
+        }
+    }
+
+    /* Need to allocate a new block */
+    size_t new_cap = arena->default_block_size;
+
+    /* For large allocations, create a block big enough */
+    if (size > new_cap) {
+        new_cap = size;
+    }
+
+    arena_block_t *new_block = arena_block_create(arena, new_cap);
+    if (!new_block) {
+        AC_LOG_ERROR("Arena expansion failed: requested %zu bytes", size);
+        return NULL;
+    }
+
+    /* Insert after current so empty blocks stay available */
+    new_block->next = block->next;
+    block->next = new_block;
+    arena->total_capacity += new_block->capacity;
+
+    AC_LOG_DEBUG("Arena expanded: +%zuKB (total=%zuKB, blocks=%zu)",
+                 new_block->capacity / 1024,
+                 arena->total_capacity / 1024,
+                 arena_block_count(arena));
+    return new_block;
+}
+
+#ifdef ARC_ARENA_THREAD_SAFE
+
 char *arena_alloc(arena_t *arena, size_t size) {
     if (!arena || size == 0) {
         return NULL;
@@ -131,78 +426,75 @@ char *arena_alloc(arena_t *arena, size_t size) {
     /* Align size to 8 bytes */
     size = ARENA_ALIGN(size);
 
-#ifdef ARC_ARENA_THREAD_SAFE
-    pthread_mutex_lock(&arena->lock);
-#endif
+    for (;;) {
+        arena_block_t *block = atomic_load_explicit(&arena->current, memory_order_acquire);
+
+        /* Fast path: bump the current block */
+        size_t used = atomic_load_explicit(&block->used, memory_order_relaxed);
+        while (used + size <= block->capacity) {
+            if (atomic_compare_exchange_weak_explicit(&block->used, &used, used + size,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                atomic_fetch_add_explicit(&arena->total_allocated, size, memory_order_relaxed);
+                arena_account(arena, size);
+                return block->data + used;
+            }
+        }
 
-    arena_block_t *block = arena->current;
+        /* Slow path: switch blocks unless another thread already did */
+        pthread_mutex_lock(&arena->lock);
+        if (atomic_load_explicit(&arena->current, memory_order_relaxed) != block) {
+            pthread_mutex_unlock(&arena->lock);
+            continue;
+        }
 
-    /* Check if current block has space */
-    if (block->used + size > block->capacity) {
-        /* Try to find a block with enough space in the chain */
-        arena_block_t *search = arena->head;
-        arena_block_t *found = NULL;
-
-        while (search) {
-            if (search->used + size <= search->capacity) {
-                found = search;
-                break;
-            }
-            search = search->next;
+        arena_block_t *next = arena_next_block(arena, block, size);
+        if (!next) {
+            pthread_mutex_unlock(&arena->lock);
+            return NULL;
         }
 
-        if (found) {
-            /* Use existing block with space */
-            block = found;
-            arena->current = found;
-        } else {
-            /* Need to allocate a new block */
-            size_t new_cap = arena->default_block_size;
-
-            /* For large allocations, create a block big enough */
-            if (size > new_cap) {
-                new_cap = size;
-            }
+        /* Claim our bytes before other threads can see the block */
+        atomic_store_explicit(&next->used, size, memory_order_relaxed);
+        atomic_store_explicit(&arena->current, next, memory_order_release);
+        atomic_fetch_add_explicit(&arena->total_allocated, size, memory_order_relaxed);
+        pthread_mutex_unlock(&arena->lock);
+        arena_account(arena, size);
+        return next->data;
+    }
+}
 
-            arena_block_t *new_block = arena_block_create(new_cap);
-            if (!new_block) {
-                AC_LOG_ERROR("Arena expansion failed: requested %zu bytes", size);
-#ifdef ARC_ARENA_THREAD_SAFE
-                pthread_mutex_unlock(&arena->lock);
-#endif
-                return NULL;
-            }
+#else /* !ARC_ARENA_THREAD_SAFE */
 
-            /* Append to chain */
-            arena_block_t *tail = arena->head;
-            while (tail->next) {
-                tail = tail->next;
-            }
-            tail->next = new_block;
+char *arena_alloc(arena_t *arena, size_t size) {
+    if (!arena || size == 0) {
+        return NULL;
+    }
 
-            arena->current = new_block;
-            arena->total_capacity += new_cap;
-            block = new_block;
+    /* Align size to 8 bytes */
+    size = ARENA_ALIGN(size);
+
+    arena_block_t *block = arena->current;
 
-            AC_LOG_DEBUG("Arena expanded: +%zuKB (total=%zuKB, blocks=%zu)",
-                         new_cap / 1024,
-                         arena->total_capacity / 1024,
-                         arena_block_count(arena));
+    if (block->used + size > block->capacity) {
+        block = arena_next_block(arena, block, size);
+        if (!block) {
+            return NULL;
         }
+        arena->current = block;
     }
 
     /* Allocate from current block */
     char *ptr = block->data + block->used;
     block->used += size;
     arena->total_allocated += size;
-
-#ifdef ARC_ARENA_THREAD_SAFE
-    pthread_mutex_unlock(&arena->lock);
-#endif
+    arena_account(arena, size);
 
     return ptr;
 }
 
+#endif /* ARC_ARENA_THREAD_SAFE */
+
 char *arena_strdup(arena_t *arena, const char *str) {
     if (!arena || !str) {
         return NULL;
@@ -218,6 +510,21 @@ char *arena_strdup(arena_t *arena, const char *str) {
     return copy;
 }
 
+char *arena_strndup(arena_t *arena, const char *str, size_t len) {
+    if (!arena || !str) {
+        return NULL;
+    }
+
+    char *copy = arena_alloc(arena, len + 1);
+
+    if (copy) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+
+    return copy;
+}
+
 int arena_reset(arena_t *arena) {
     if (!arena) {
         return 0;
@@ -227,6 +534,8 @@ int arena_reset(arena_t *arena) {
     pthread_mutex_lock(&arena->lock);
 #endif
 
+    arena_note_peak(arena);
+
     /* Reset all blocks */
     for (arena_block_t *block = arena->head; block; block = block->next) {
         block->used = 0;
@@ -243,6 +552,87 @@ int arena_reset(arena_t *arena) {
     return 1;
 }
 
+arena_mark_t arena_mark(arena_t *arena) {
+    arena_mark_t mark = {0};
+    if (!arena) {
+        return mark;
+    }
+
+#ifdef ARC_ARENA_THREAD_SAFE
+    pthread_mutex_lock(&arena->lock);
+#endif
+
+    mark.block = arena->current;
+    mark.used = arena->current->used;
+    mark.allocated = arena->total_allocated;
+
+#ifdef ARC_ARENA_THREAD_SAFE
+    pthread_mutex_unlock(&arena->lock);
+#endif
+
+    return mark;
+}
+
+int arena_rewind(arena_t *arena, arena_mark_t mark) {
+    if (!arena || !mark.block) {
+        return 0;
+    }
+
+#ifdef ARC_ARENA_THREAD_SAFE
+    pthread_mutex_lock(&arena->lock);
+#endif
+
+    /* The mark must refer to a block at or before current */
+    arena_block_t *block = arena->head;
+    while (block && block != (arena_block_t *)mark.block) {
+        if (block == arena->current) {
+            block = NULL;
+            break;
+        }
+        block = block->next;
+    }
+
+    if (!block || mark.used > block->used) {
+#ifdef ARC_ARENA_THREAD_SAFE
+        pthread_mutex_unlock(&arena->lock);
+#endif
+        AC_LOG_ERROR("Arena rewind: stale or foreign mark");
+        return 0;
+    }
+
+    /* Skipped blocks may sit between mark and current: clear up to current */
+    for (arena_block_t *b = block; b != arena->current; ) {
+        b = b->next;
+        b->used = 0;
+    }
+    block->used = mark.used;
+
+    arena_note_peak(arena);
+    arena->current = block;
+    arena->total_allocated = mark.allocated;
+
+#ifdef ARC_ARENA_THREAD_SAFE
+    pthread_mutex_unlock(&arena->lock);
+#endif
+
+    return 1;
+}
+
+arena_scratch_t arena_scratch_begin(arena_t *arena) {
+    arena_scratch_t scratch;
+    scratch.arena = arena;
+    scratch.mark = arena_mark(arena);
+    return scratch;
+}
+
+void arena_scratch_end(arena_scratch_t *scratch) {
+    if (!scratch || !scratch->arena) {
+        return;
+    }
+    arena_rewind(scratch->arena, scratch->mark);
+    scratch->arena = NULL;
+}
+
 int arena_destroy(arena_t *arena) {
     if (!arena) {
         return 0;
@@ -258,17 +648,39 @@ int arena_destroy(arena_t *arena) {
 
     while (block) {
         arena_block_t *next = block->next;
-        ARC_FREE(block);
+        arena_block_release(arena, block);
         block = next;
         block_count++;
     }
 
     AC_LOG_DEBUG("Arena destroyed: freed %zu blocks", block_count);
 
-    ARC_FREE(arena);
+    arena_free_struct(arena);
     return 1;
 }
 
+int arena_contains(const arena_t *arena, const void *ptr) {
+    if (!arena || !ptr) {
+        return 0;
+    }
+
+#ifdef ARC_ARENA_THREAD_SAFE
+    pthread_mutex_lock((pthread_mutex_t *)&((arena_t *)arena)->lock);
+#endif
+
+    const char *p = (const char *)ptr;
+    int found = 0;
+    for (arena_block_t *block = arena->head; block && !found; block = block->next) {
+        found = p >= block->data && p < block->data + block->capacity;
+    }
+
+#ifdef ARC_ARENA_THREAD_SAFE
+    pthread_mutex_unlock((pthread_mutex_t *)&((arena_t *)arena)->lock);
+#endif
+
+    return found;
+}
+
 int arena_get_stats(const arena_t *arena, arena_stats_t *stats) {
     if (!arena || !stats) {
         return 0;
@@ -282,6 +694,8 @@ int arena_get_stats(const arena_t *arena, arena_stats_t *stats) {
     stats->total_allocated = arena->total_allocated;
     stats->block_count = 0;
     stats->largest_block = 0;
+    stats->cache_hits = arena->cache_hits;
+    stats->cache_misses = arena->cache_misses;
 
     for (arena_block_t *block = arena->head; block; block = block->next) {
         stats->block_count++;
@@ -297,6 +711,79 @@ int arena_get_stats(const arena_t *arena, arena_stats_t *stats) {
     return 1;
 }
 
+#if ARC_ARENA_TELEMETRY
+
+int arena_set_tag(arena_t *arena, int tag) {
+    if (!arena) {
+        return ARENA_TAG_OTHER;
+    }
+    if (tag < 0 || tag >= ARENA_TAG_MAX) {
+        tag = ARENA_TAG_OTHER;
+    }
+
+    int prev = arena->tag;
+    arena->tag = tag;
+    return prev;
+}
+
+#else /* !ARC_ARENA_TELEMETRY */
+
+int arena_set_tag(arena_t *arena, int tag) {
+    (void)arena;
+    (void)tag;
+    return ARENA_TAG_OTHER;
+}
+
+#endif /* ARC_ARENA_TELEMETRY */
+
+int arena_get_telemetry(const arena_t *arena, arena_telemetry_t *telemetry) {
+    if (!arena || !telemetry) {
+        return 0;
+    }
+
+    memset(telemetry, 0, sizeof(*telemetry));
+
+#ifdef ARC_ARENA_THREAD_SAFE
+    pthread_mutex_lock((pthread_mutex_t *)&((arena_t *)arena)->lock);
+#endif
+
+    telemetry->total_capacity = arena->total_capacity;
+    telemetry->total_allocated = arena->total_allocated;
+    telemetry->peak_allocated = arena->peak_allocated;
+    if (telemetry->total_allocated > telemetry->peak_allocated) {
+        telemetry->peak_allocated = telemetry->total_allocated;
+    }
+
+    /* Blocks before current were abandoned with whatever did not fit */
+    for (arena_block_t *block = arena->head; block != arena->current; block = block->next) {
+        telemetry->wasted_tail += block->capacity - block->used;
+    }
+
+#if ARC_ARENA_TELEMETRY
+    for (int t = 0; t < ARENA_TAG_MAX; t++) {
+        telemetry->tags[t].bytes = arena->tag_bytes[t];
+        telemetry->tags[t].count = arena->tag_count[t];
+    }
+#endif
+
+#ifdef ARC_ARENA_THREAD_SAFE
+    pthread_mutex_unlock((pthread_mutex_t *)&((arena_t *)arena)->lock);
+#endif
+
+    return 1;
+}
+
+const char *arena_tag_name(int tag) {
+    static const char *names[] = {
+        "other", "history", "llm", "tools", "mcp", "memory"
+    };
+
+    if (tag >= 0 && tag < (int)(sizeof(names) / sizeof(names[0]))) {
+        return names[tag];
+    }
+    return tag >= ARENA_TAG_USER && tag < ARENA_TAG_MAX ? "user" : "other";
+}
+
 /*============================================================================
  * Internal helper (used in debug log)
  *============================================================================*/
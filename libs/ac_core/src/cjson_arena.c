@@ -0,0 +1,144 @@
+/**
+ * @file cjson_arena.c
+ * @brief Arena-backed cJSON parsing
+ */
+
+#include "cjson_arena.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include <string.h>
+
+/** Private arena size: room for a tree of roughly this many times the input */
+#define CJSON_ARENA_SIZE_FACTOR 2
+#define CJSON_ARENA_SIZE_SLACK  4096
+
+#ifdef ARC_THREAD_LOCAL
+
+/*============================================================================
+ * Hooks
+ *============================================================================*/
+
+static ARC_THREAD_LOCAL ac_cjson_scope_t *t_scope;      /* Innermost scope */
+static ARC_THREAD_LOCAL ac_cjson_scope_t *t_parsing;    /* Scope inside parse */
+
+static void *cjson_hook_malloc(size_t size) {
+    ac_cjson_scope_t *scope = t_parsing;
+    if (scope) {
+        return arena_alloc(scope->arena, size);
+    }
+    return ARC_MALLOC(size);
+}
+
+static void cjson_hook_free(void *ptr) {
+    for (ac_cjson_scope_t *scope = t_scope; scope; scope = scope->prev) {
+        if (scope->arena && arena_contains(scope->arena, ptr)) {
+            return;                  /* Released when the scope ends */
+        }
+    }
+    ARC_FREE(ptr);
+}
+
+static pthread_mutex_t s_hooks_lock = PTHREAD_MUTEX_INITIALIZER;
+static int s_hooks_installed = 0;
+
+void ac_cjson_install_hooks(void) {
+    pthread_mutex_lock(&s_hooks_lock);
+    if (!s_hooks_installed) {
+        cJSON_Hooks hooks = { cjson_hook_malloc, cjson_hook_free };
+        cJSON_InitHooks(&hooks);
+        s_hooks_installed = 1;
+    }
+    pthread_mutex_unlock(&s_hooks_lock);
+}
+
+/*============================================================================
+ * Scope
+ *============================================================================*/
+
+void ac_cjson_scope_begin(ac_cjson_scope_t *scope, arena_t *arena) {
+    if (!scope) {
+        return;
+    }
+    memset(scope, 0, sizeof(*scope));
+
+    ac_cjson_install_hooks();
+
+    if (arena) {
+        scope->arena = arena;
+        scope->mark = arena_mark(arena);
+    }
+    scope->prev = t_scope;
+    scope->active = 1;
+    t_scope = scope;
+}
+
+cJSON *ac_cjson_scope_parse(ac_cjson_scope_t *scope, const char *json, size_t len) {
+    if (!json) {
+        return NULL;
+    }
+    if (!scope || !scope->active || scope != t_scope) {
+        return cJSON_ParseWithLength(json, len);
+    }
+
+    if (!scope->arena) {
+        scope->arena = arena_create(len * CJSON_ARENA_SIZE_FACTOR + CJSON_ARENA_SIZE_SLACK);
+        if (!scope->arena) {
+            return cJSON_ParseWithLength(json, len);
+        }
+        scope->owns_arena = 1;
+    }
+
+    t_parsing = scope;
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    t_parsing = NULL;
+    return root;
+}
+
+void ac_cjson_scope_end(ac_cjson_scope_t *scope) {
+    if (!scope || !scope->active) {
+        return;
+    }
+
+    t_scope = scope->prev;
+    scope->active = 0;
+
+    if (scope->owns_arena) {
+        arena_destroy(scope->arena);
+    } else if (scope->arena) {
+        arena_rewind(scope->arena, scope->mark);
+    }
+    scope->arena = NULL;
+}
+
+#else /* !ARC_THREAD_LOCAL */
+
+static void *cjson_hook_malloc(size_t size) {
+    return ARC_MALLOC(size);
+}
+
+static void cjson_hook_free(void *ptr) {
+    ARC_FREE(ptr);
+}
+
+void ac_cjson_install_hooks(void) {
+    cJSON_Hooks hooks = { cjson_hook_malloc, cjson_hook_free };
+    cJSON_InitHooks(&hooks);
+}
+
+void ac_cjson_scope_begin(ac_cjson_scope_t *scope, arena_t *arena) {
+    (void)arena;
+    if (scope) {
+        memset(scope, 0, sizeof(*scope));
+    }
+}
+
+cJSON *ac_cjson_scope_parse(ac_cjson_scope_t *scope, const char *json, size_t len) {
+    (void)scope;
+    return json ? cJSON_ParseWithLength(json, len) : NULL;
+}
+
+void ac_cjson_scope_end(ac_cjson_scope_t *scope) {
+    (void)scope;
+}
+
+#endif /* ARC_THREAD_LOCAL */
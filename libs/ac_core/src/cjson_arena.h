@@ -0,0 +1,76 @@
+/**
+ * @file cjson_arena.h
+ * @brief Arena-backed cJSON parsing for parse-then-discard work (internal)
+ *
+ * A scope routes the allocations of ac_cjson_scope_parse() to an arena, so
+ * a response tree costs a few block allocations instead of one malloc per
+ * node and string, and is released all at once when the scope ends.
+ *
+ * cJSON's hooks are process-wide; they are installed on first use and
+ * dispatch on a thread-local scope stack. Outside a parse every cJSON
+ * allocation goes to the heap as before, and cJSON_free() recognizes
+ * arena memory and ignores it, so trees may freely mix arena nodes with
+ * nodes added later, and cJSON_Delete() stays correct in either mode.
+ *
+ * Rules:
+ * - A tree parsed in a scope must not be used after the scope ends.
+ * - Scopes nest and must end in reverse order, on the thread that began
+ *   them.
+ * - Strings printed from such a tree are heap strings (safe to keep).
+ *
+ * Without ARC_THREAD_LOCAL the scope is a no-op and parsing uses the heap.
+ */
+
+#ifndef ARC_CJSON_ARENA_H
+#define ARC_CJSON_ARENA_H
+
+#include "arc/arena.h"
+#include "cJSON.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ac_cjson_scope {
+    arena_t *arena;                  /* NULL until the first parse */
+    arena_mark_t mark;               /* Caller arena: position at begin */
+    int owns_arena;                  /* Created by the scope, destroyed at end */
+    int active;                      /* Registered on this thread */
+    struct ac_cjson_scope *prev;
+} ac_cjson_scope_t;
+
+/**
+ * @brief Route cJSON's allocations through ARC_MALLOC/ARC_FREE
+ *
+ * Done by the first scope; ac_allocator_set() calls it so cJSON output
+ * is allocated by the allocator that will free it.
+ */
+void ac_cjson_install_hooks(void);
+
+/**
+ * @brief Begin a scope
+ *
+ * @param scope Scope (typically on the stack)
+ * @param arena Arena to parse into, rewound at end; nothing else may
+ *              allocate from it meanwhile (NULL = a private arena sized
+ *              from the first document, destroyed at end)
+ */
+void ac_cjson_scope_begin(ac_cjson_scope_t *scope, arena_t *arena);
+
+/**
+ * @brief Parse a document into the scope's arena
+ *
+ * @return Tree (valid until ac_cjson_scope_end), NULL on parse error
+ */
+cJSON *ac_cjson_scope_parse(ac_cjson_scope_t *scope, const char *json, size_t len);
+
+/**
+ * @brief End a scope, releasing every tree parsed in it
+ */
+void ac_cjson_scope_end(ac_cjson_scope_t *scope);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_CJSON_ARENA_H */
@@ -0,0 +1,673 @@
+/**
+ * @file executor.c
+ * @brief Internal work-stealing executor implementation
+ *
+ * Each worker owns a deque. Jobs submitted from a worker go to the tail of
+ * its own deque and are popped LIFO (cache-warm nested work such as tool
+ * calls of a running agent). Jobs from other threads go to a shared
+ * injection queue with one FIFO per priority class, served by the
+ * arc/priority.h scheduler. An idle worker drains its deque, then the
+ * injection queue, then steals FIFO from the head of a sibling: first
+ * from siblings placed on its NUMA node, then from the rest.
+ */
+
+#include "executor.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include <string.h>
+
+#ifdef ARC_HAS_THREADS
+
+/*============================================================================
+ * Executor Structure
+ *============================================================================*/
+
+typedef struct executor_job {
+    ac_executor_fn run;
+    ac_executor_fn drop;
+    void *arg;
+    ac_priority_t priority;
+    uint64_t since_ms;               /* Queued at */
+    struct executor_job *prev;
+    struct executor_job *next;
+} executor_job_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    executor_job_t *head;            /* Oldest (stolen first) */
+    executor_job_t *tail;            /* Newest (owner pops here) */
+} job_deque_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    executor_job_t *head[AC_PRIORITY_COUNT];  /* FIFO per class */
+    executor_job_t *tail[AC_PRIORITY_COUNT];
+    ac_priority_sched_t sched;
+} job_inject_t;
+
+typedef struct {
+    struct ac_executor *ex;
+    size_t index;
+    int node;                        /* Planned NUMA node, -1 = unplaced */
+    pthread_t thread;
+    job_deque_t deque;
+} executor_worker_t;
+
+struct ac_executor {
+    executor_worker_t *workers;
+    size_t worker_slots;             /* Deques allocated (immutable) */
+    size_t thread_count;             /* Workers actually started */
+    job_inject_t inject;             /* Submissions from non-worker threads */
+    pthread_key_t self_key;          /* Current executor_worker_t, if any */
+    const ac_affinity_t *affinity;   /* Worker placement (NULL = unpinned) */
+
+    /* Sleep/wake and stats, guarded by lock */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;             /* Signalled on new job / shutdown */
+    long pending;                    /* Queued jobs not yet taken */
+    size_t active;                   /* Workers running a job */
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t stolen;
+    uint64_t busy_ms;
+    uint64_t start_ms;
+    int shutdown;
+};
+
+/*============================================================================
+ * Deque Operations
+ *============================================================================*/
+
+static int deque_init(job_deque_t *dq) {
+    dq->head = NULL;
+    dq->tail = NULL;
+    return pthread_mutex_init(&dq->lock, NULL);
+}
+
+static void deque_push_tail(job_deque_t *dq, executor_job_t *job) {
+    pthread_mutex_lock(&dq->lock);
+    job->next = NULL;
+    job->prev = dq->tail;
+    if (dq->tail) {
+        dq->tail->next = job;
+    } else {
+        dq->head = job;
+    }
+    dq->tail = job;
+    pthread_mutex_unlock(&dq->lock);
+}
+
+static executor_job_t *deque_pop_head(job_deque_t *dq) {
+    pthread_mutex_lock(&dq->lock);
+    executor_job_t *job = dq->head;
+    if (job) {
+        dq->head = job->next;
+        if (dq->head) {
+            dq->head->prev = NULL;
+        } else {
+            dq->tail = NULL;
+        }
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return job;
+}
+
+static executor_job_t *deque_pop_tail(job_deque_t *dq) {
+    pthread_mutex_lock(&dq->lock);
+    executor_job_t *job = dq->tail;
+    if (job) {
+        dq->tail = job->prev;
+        if (dq->tail) {
+            dq->tail->next = NULL;
+        } else {
+            dq->head = NULL;
+        }
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return job;
+}
+
+/**
+ * @brief Drop every job left in a deque (after workers have exited)
+ */
+static size_t deque_drop_all(job_deque_t *dq) {
+    size_t dropped = 0;
+    executor_job_t *job;
+    while ((job = deque_pop_head(dq)) != NULL) {
+        if (job->drop) {
+            job->drop(job->arg);
+        }
+        ARC_FREE(job);
+        dropped++;
+    }
+    return dropped;
+}
+
+/*============================================================================
+ * Injection Queue
+ *============================================================================*/
+
+static int inject_init(job_inject_t *iq) {
+    memset(iq->head, 0, sizeof(iq->head));
+    memset(iq->tail, 0, sizeof(iq->tail));
+    memset(&iq->sched, 0, sizeof(iq->sched));
+    return pthread_mutex_init(&iq->lock, NULL);
+}
+
+static void inject_push(job_inject_t *iq, executor_job_t *job) {
+    int c = (int)job->priority;
+    pthread_mutex_lock(&iq->lock);
+    job->next = NULL;
+    job->prev = iq->tail[c];
+    if (iq->tail[c]) {
+        iq->tail[c]->next = job;
+    } else {
+        iq->head[c] = job;
+    }
+    iq->tail[c] = job;
+    pthread_mutex_unlock(&iq->lock);
+}
+
+/**
+ * @brief Oldest job of the class the scheduler picks
+ */
+static executor_job_t *inject_pop(job_inject_t *iq) {
+    uint64_t now_ms = ac_platform_timestamp_ms();
+
+    pthread_mutex_lock(&iq->lock);
+    uint64_t oldest[AC_PRIORITY_COUNT];
+    for (int c = 0; c < AC_PRIORITY_COUNT; c++) {
+        oldest[c] = iq->head[c] ? iq->head[c]->since_ms : 0;
+    }
+    int c = ac_priority_next(&iq->sched, oldest, now_ms);
+    executor_job_t *job = c >= 0 ? iq->head[c] : NULL;
+    if (job) {
+        iq->head[c] = job->next;
+        if (iq->head[c]) {
+            iq->head[c]->prev = NULL;
+        } else {
+            iq->tail[c] = NULL;
+        }
+        ac_priority_charge(&iq->sched, job->priority);
+    }
+    pthread_mutex_unlock(&iq->lock);
+    return job;
+}
+
+static size_t inject_drop_all(job_inject_t *iq) {
+    size_t dropped = 0;
+    for (int c = 0; c < AC_PRIORITY_COUNT; c++) {
+        executor_job_t *job = iq->head[c];
+        while (job) {
+            executor_job_t *next = job->next;
+            if (job->drop) {
+                job->drop(job->arg);
+            }
+            ARC_FREE(job);
+            dropped++;
+            job = next;
+        }
+        iq->head[c] = NULL;
+        iq->tail[c] = NULL;
+    }
+    return dropped;
+}
+
+/*============================================================================
+ * Worker
+ *============================================================================*/
+
+/**
+ * @brief Find a job: own deque (LIFO), injection queue, then steal (FIFO)
+ */
+static executor_job_t *worker_take(executor_worker_t *self, int *stolen) {
+    ac_executor_t *ex = self->ex;
+
+    *stolen = 0;
+
+    executor_job_t *job = deque_pop_tail(&self->deque);
+    if (job) {
+        return job;
+    }
+
+    job = inject_pop(&ex->inject);
+    if (job) {
+        return job;
+    }
+
+    /* Same node first: its jobs' memory is local to this worker */
+    for (int pass = self->node >= 0 ? 0 : 1; pass < 2; pass++) {
+        for (size_t i = 1; i < ex->worker_slots; i++) {
+            executor_worker_t *victim = &ex->workers[(self->index + i) % ex->worker_slots];
+            if (self->node >= 0 && (victim->node == self->node) != (pass == 0)) {
+                continue;
+            }
+            job = deque_pop_head(&victim->deque);
+            if (job) {
+                *stolen = 1;
+                return job;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void *executor_worker(void *arg) {
+    executor_worker_t *self = (executor_worker_t *)arg;
+    ac_executor_t *ex = self->ex;
+
+    pthread_setspecific(ex->self_key, self);
+    if (ex->affinity) {
+        ac_affinity_apply(ex->affinity, self->index);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&ex->lock);
+        while (ex->pending <= 0 && !ex->shutdown) {
+            pthread_cond_wait(&ex->cond, &ex->lock);
+        }
+        if (ex->shutdown) {
+            /* Queued jobs are dropped by ac_executor_destroy() */
+            pthread_mutex_unlock(&ex->lock);
+            break;
+        }
+        pthread_mutex_unlock(&ex->lock);
+
+        int stolen = 0;
+        executor_job_t *job = worker_take(self, &stolen);
+        if (!job) {
+            /* Counted but not yet linked, or taken by a sibling */
+            continue;
+        }
+
+        pthread_mutex_lock(&ex->lock);
+        ex->pending--;
+        ex->active++;
+        if (stolen) {
+            ex->stolen++;
+        }
+        pthread_mutex_unlock(&ex->lock);
+
+        uint64_t start_ms = ac_platform_timestamp_ms();
+        job->run(job->arg);
+        uint64_t elapsed_ms = ac_platform_timestamp_ms() - start_ms;
+        ARC_FREE(job);
+
+        pthread_mutex_lock(&ex->lock);
+        ex->active--;
+        ex->completed++;
+        ex->busy_ms += elapsed_ms;
+        pthread_mutex_unlock(&ex->lock);
+    }
+
+    return NULL;
+}
+
+/*============================================================================
+ * Public (internal) API
+ *============================================================================*/
+
+ac_executor_t *ac_executor_create(size_t threads, const ac_affinity_t *affinity) {
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    ac_executor_t *ex = (ac_executor_t *)ARC_CALLOC(1, sizeof(ac_executor_t));
+    if (!ex) {
+        return NULL;
+    }
+
+    ex->workers = (executor_worker_t *)ARC_CALLOC(threads, sizeof(executor_worker_t));
+    if (!ex->workers) {
+        ARC_FREE(ex);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&ex->lock, NULL) != 0) {
+        ARC_FREE(ex->workers);
+        ARC_FREE(ex);
+        return NULL;
+    }
+
+    if (pthread_cond_init(&ex->cond, NULL) != 0) {
+        pthread_mutex_destroy(&ex->lock);
+        ARC_FREE(ex->workers);
+        ARC_FREE(ex);
+        return NULL;
+    }
+
+    if (pthread_key_create(&ex->self_key, NULL) != 0) {
+        pthread_cond_destroy(&ex->cond);
+        pthread_mutex_destroy(&ex->lock);
+        ARC_FREE(ex->workers);
+        ARC_FREE(ex);
+        return NULL;
+    }
+
+    inject_init(&ex->inject);
+    ex->worker_slots = threads;
+    ex->affinity = affinity && affinity->mode != AC_AFFINITY_NONE ? affinity : NULL;
+    for (size_t i = 0; i < threads; i++) {
+        ex->workers[i].ex = ex;
+        ex->workers[i].index = i;
+        ex->workers[i].node = ex->affinity ? ac_affinity_node_of(ex->affinity, i) : -1;
+        deque_init(&ex->workers[i].deque);
+    }
+
+    ex->start_ms = ac_platform_timestamp_ms();
+
+    /* All deques exist before any worker starts, so stealing may scan
+     * every slot even if some threads fail to start */
+    for (size_t i = 0; i < threads; i++) {
+        if (pthread_create(&ex->workers[i].thread, NULL,
+                           executor_worker, &ex->workers[i]) != 0) {
+            AC_LOG_WARN("Executor: started %zu of %zu workers", i, threads);
+            break;
+        }
+        pthread_mutex_lock(&ex->lock);
+        ex->thread_count++;
+        pthread_mutex_unlock(&ex->lock);
+    }
+
+    if (ex->thread_count == 0) {
+        AC_LOG_ERROR("Executor: failed to start any worker");
+        for (size_t i = 0; i < threads; i++) {
+            pthread_mutex_destroy(&ex->workers[i].deque.lock);
+        }
+        pthread_mutex_destroy(&ex->inject.lock);
+        pthread_key_delete(ex->self_key);
+        pthread_cond_destroy(&ex->cond);
+        pthread_mutex_destroy(&ex->lock);
+        ARC_FREE(ex->workers);
+        ARC_FREE(ex);
+        return NULL;
+    }
+
+    AC_LOG_DEBUG("Executor created (%zu workers)", ex->thread_count);
+    return ex;
+}
+
+arc_err_t ac_executor_submit(
+    ac_executor_t *ex,
+    ac_executor_fn run,
+    ac_executor_fn drop,
+    void *arg,
+    ac_priority_t priority
+) {
+    if (!ex || !run) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    int shutdown = ex->shutdown;
+    pthread_mutex_unlock(&ex->lock);
+    if (shutdown) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    executor_job_t *job = (executor_job_t *)ARC_MALLOC(sizeof(executor_job_t));
+    if (!job) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    job->run = run;
+    job->drop = drop;
+    job->arg = arg;
+    job->priority = ac_priority_clamp((int)priority);
+    job->since_ms = ac_platform_timestamp_ms();
+
+    executor_worker_t *self = (executor_worker_t *)pthread_getspecific(ex->self_key);
+    if (self) {
+        deque_push_tail(&self->deque, job);
+    } else {
+        inject_push(&ex->inject, job);
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    ex->pending++;
+    ex->submitted++;
+    pthread_cond_signal(&ex->cond);
+    pthread_mutex_unlock(&ex->lock);
+
+    return ARC_OK;
+}
+
+arc_err_t ac_executor_get_stats(ac_executor_t *ex, ac_session_executor_stats_t *stats) {
+    if (!ex || !stats) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    uint64_t now_ms = ac_platform_timestamp_ms();
+
+    pthread_mutex_lock(&ex->lock);
+    stats->threads = ex->thread_count;
+    stats->active_workers = ex->active;
+    stats->queued_jobs = ex->pending > 0 ? (size_t)ex->pending : 0;
+    stats->total_submitted = ex->submitted;
+    stats->total_completed = ex->completed;
+    stats->total_stolen = ex->stolen;
+    stats->busy_ms = ex->busy_ms;
+    stats->uptime_ms = now_ms - ex->start_ms;
+    pthread_mutex_unlock(&ex->lock);
+
+    stats->stack_size = 0;
+    stats->stack_peak = 0;
+
+    uint64_t capacity_ms = stats->uptime_ms * stats->threads;
+    stats->utilization = capacity_ms > 0 ? (double)stats->busy_ms / (double)capacity_ms : 0.0;
+
+    return ARC_OK;
+}
+
+void ac_executor_destroy(ac_executor_t *ex) {
+    if (!ex) {
+        return;
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    ex->shutdown = 1;
+    pthread_cond_broadcast(&ex->cond);
+    pthread_mutex_unlock(&ex->lock);
+
+    /* Running jobs finish; workers exit without taking new ones */
+    for (size_t i = 0; i < ex->thread_count; i++) {
+        pthread_join(ex->workers[i].thread, NULL);
+    }
+
+    size_t dropped = inject_drop_all(&ex->inject);
+    for (size_t i = 0; i < ex->worker_slots; i++) {
+        dropped += deque_drop_all(&ex->workers[i].deque);
+        pthread_mutex_destroy(&ex->workers[i].deque.lock);
+    }
+    pthread_mutex_destroy(&ex->inject.lock);
+
+    AC_LOG_DEBUG("Executor destroyed (%llu jobs completed, %zu queued jobs dropped)",
+                 (unsigned long long)ex->completed, dropped);
+
+    pthread_key_delete(ex->self_key);
+    pthread_cond_destroy(&ex->cond);
+    pthread_mutex_destroy(&ex->lock);
+    ARC_FREE(ex->workers);
+    ARC_FREE(ex);
+}
+
+/*============================================================================
+ * Parallel For
+ *============================================================================*/
+
+typedef struct {
+    ac_executor_index_fn fn;
+    void *arg;
+    size_t count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;             /* Signalled when done == count */
+    size_t next;                     /* Next index to claim */
+    size_t done;
+    int refs;                        /* Caller + submitted helpers */
+} parallel_for_t;
+
+static void parallel_for_unref(parallel_for_t *pf) {
+    pthread_mutex_lock(&pf->lock);
+    int refs = --pf->refs;
+    pthread_mutex_unlock(&pf->lock);
+
+    if (refs == 0) {
+        pthread_cond_destroy(&pf->cond);
+        pthread_mutex_destroy(&pf->lock);
+        ARC_FREE(pf);
+    }
+}
+
+static void parallel_for_drain(parallel_for_t *pf) {
+    for (;;) {
+        pthread_mutex_lock(&pf->lock);
+        size_t index = pf->next < pf->count ? pf->next++ : pf->count;
+        pthread_mutex_unlock(&pf->lock);
+
+        if (index >= pf->count) {
+            break;
+        }
+
+        pf->fn(pf->arg, index);
+
+        pthread_mutex_lock(&pf->lock);
+        if (++pf->done == pf->count) {
+            pthread_cond_broadcast(&pf->cond);
+        }
+        pthread_mutex_unlock(&pf->lock);
+    }
+}
+
+static void parallel_for_helper(void *arg) {
+    parallel_for_t *pf = (parallel_for_t *)arg;
+    parallel_for_drain(pf);
+    parallel_for_unref(pf);
+}
+
+static void parallel_for_drop(void *arg) {
+    parallel_for_unref((parallel_for_t *)arg);
+}
+
+void ac_executor_parallel_for(
+    ac_executor_t *ex,
+    size_t count,
+    size_t max_workers,
+    ac_executor_index_fn fn,
+    void *arg,
+    ac_priority_t priority
+) {
+    if (!fn || count == 0) {
+        return;
+    }
+
+    size_t helpers = max_workers > count ? count : max_workers;
+    helpers = helpers > 1 ? helpers - 1 : 0;
+
+    parallel_for_t *pf = NULL;
+    if (ex && helpers > 0) {
+        pf = (parallel_for_t *)ARC_CALLOC(1, sizeof(parallel_for_t));
+        if (pf && pthread_mutex_init(&pf->lock, NULL) != 0) {
+            ARC_FREE(pf);
+            pf = NULL;
+        } else if (pf && pthread_cond_init(&pf->cond, NULL) != 0) {
+            pthread_mutex_destroy(&pf->lock);
+            ARC_FREE(pf);
+            pf = NULL;
+        }
+    }
+
+    if (!pf) {
+        for (size_t i = 0; i < count; i++) {
+            fn(arg, i);
+        }
+        return;
+    }
+
+    pf->fn = fn;
+    pf->arg = arg;
+    pf->count = count;
+    pf->refs = 1;
+
+    for (size_t i = 0; i < helpers; i++) {
+        pthread_mutex_lock(&pf->lock);
+        pf->refs++;
+        pthread_mutex_unlock(&pf->lock);
+
+        if (ac_executor_submit(ex, parallel_for_helper, parallel_for_drop, pf,
+                               priority) != ARC_OK) {
+            parallel_for_unref(pf);
+            break;
+        }
+    }
+
+    /* The caller drains too, so progress never depends on a free worker */
+    parallel_for_drain(pf);
+
+    pthread_mutex_lock(&pf->lock);
+    while (pf->done < pf->count) {
+        pthread_cond_wait(&pf->cond, &pf->lock);
+    }
+    pthread_mutex_unlock(&pf->lock);
+
+    parallel_for_unref(pf);
+}
+
+#else /* !ARC_HAS_THREADS */
+
+/*============================================================================
+ * Single-threaded platforms: no executor
+ *============================================================================*/
+
+ac_executor_t *ac_executor_create(size_t threads, const ac_affinity_t *affinity) {
+    (void)threads;
+    (void)affinity;
+    return NULL;
+}
+
+arc_err_t ac_executor_submit(
+    ac_executor_t *ex,
+    ac_executor_fn run,
+    ac_executor_fn drop,
+    void *arg,
+    ac_priority_t priority
+) {
+    (void)ex;
+    (void)run;
+    (void)drop;
+    (void)arg;
+    (void)priority;
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+arc_err_t ac_executor_get_stats(ac_executor_t *ex, ac_session_executor_stats_t *stats) {
+    (void)ex;
+    (void)stats;
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+void ac_executor_destroy(ac_executor_t *ex) {
+    (void)ex;
+}
+
+void ac_executor_parallel_for(
+    ac_executor_t *ex,
+    size_t count,
+    size_t max_workers,
+    ac_executor_index_fn fn,
+    void *arg,
+    ac_priority_t priority
+) {
+    (void)ex;
+    (void)max_workers;
+    (void)priority;
+    if (!fn) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        fn(arg, i);
+    }
+}
+
+#endif /* ARC_HAS_THREADS */
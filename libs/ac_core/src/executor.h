@@ -0,0 +1,103 @@
+/**
+ * @file executor.h
+ * @brief Internal work-stealing executor
+ *
+ * A fixed set of worker threads shared by everything in a session:
+ * asynchronous agent runs and parallel tool calls.
+ * Jobs submitted from a worker stay on that worker's deque; idle
+ * workers steal from siblings. Jobs from other threads are taken by
+ * priority class (arc/priority.h). Workers may be pinned
+ * (arc/affinity.h); a placed worker steals from its own node first.
+ *
+ * Without thread support (ARC_HAS_THREADS undefined) ac_executor_create()
+ * returns NULL and callers fall back to running jobs inline.
+ */
+
+#ifndef ARC_EXECUTOR_H
+#define ARC_EXECUTOR_H
+
+#include "arc/error.h"
+#include "arc/session.h"
+#include "arc/priority.h"
+#include "arc/affinity.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ac_executor ac_executor_t;
+
+/**
+ * @brief Job function
+ */
+typedef void (*ac_executor_fn)(void *arg);
+
+/**
+ * @brief Indexed job function for ac_executor_parallel_for()
+ */
+typedef void (*ac_executor_index_fn)(void *arg, size_t index);
+
+/**
+ * @brief Create an executor with a fixed number of worker threads
+ *
+ * @param threads   Worker count (0 = 1)
+ * @param affinity  Placement of worker i as thread i (NULL = unpinned;
+ *                  must outlive the executor)
+ * @return Executor, NULL on error or if threads are unavailable
+ */
+ac_executor_t *ac_executor_create(size_t threads, const ac_affinity_t *affinity);
+
+/**
+ * @brief Queue a job
+ *
+ * @param ex        Executor
+ * @param run       Called on a worker thread
+ * @param drop      Called instead of run if the executor shuts down before
+ *                  the job starts (may be NULL)
+ * @param arg       Passed to run/drop
+ * @param priority  Class among jobs queued from non-worker threads
+ * @return ARC_OK, ARC_ERR_INVALID_STATE after shutdown
+ */
+arc_err_t ac_executor_submit(
+    ac_executor_t *ex,
+    ac_executor_fn run,
+    ac_executor_fn drop,
+    void *arg,
+    ac_priority_t priority
+);
+
+/**
+ * @brief Run fn(arg, i) for every i in [0, count) and wait for all
+ *
+ * Up to max_workers indices run at once; the calling thread takes part,
+ * so this never deadlocks when called from a worker and degrades to a
+ * sequential loop if ex is NULL or the executor is shutting down.
+ * Helper jobs are submitted with priority.
+ */
+void ac_executor_parallel_for(
+    ac_executor_t *ex,
+    size_t count,
+    size_t max_workers,
+    ac_executor_index_fn fn,
+    void *arg,
+    ac_priority_t priority
+);
+
+/**
+ * @brief Snapshot queue depth and worker utilization
+ */
+arc_err_t ac_executor_get_stats(ac_executor_t *ex, ac_session_executor_stats_t *stats);
+
+/**
+ * @brief Shut down: wait for running jobs, drop queued ones, free
+ *
+ * Must not be called from a worker thread.
+ */
+void ac_executor_destroy(ac_executor_t *ex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_EXECUTOR_H */
@@ -0,0 +1,137 @@
+/**
+ * @file intern.c
+ * @brief String interning (open addressing, linear probing)
+ */
+
+#include "intern.h"
+#include "arc/platform.h"
+#include <stdint.h>
+#include <string.h>
+
+#define INTERN_MIN_SLOTS 64          /* Power of two */
+
+typedef struct {
+    const char *str;                 /* NULL = empty slot */
+    size_t len;
+    uint64_t hash;
+} intern_slot_t;
+
+struct ac_intern {
+    arena_t *arena;
+    intern_slot_t *slots;
+    size_t cap;                      /* Power of two */
+    size_t count;
+};
+
+static uint64_t intern_hash(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+ac_intern_t *ac_intern_create(arena_t *arena) {
+    if (!arena) {
+        return NULL;
+    }
+
+    ac_intern_t *table = (ac_intern_t *)ARC_CALLOC(1, sizeof(ac_intern_t));
+    if (!table) {
+        return NULL;
+    }
+    table->slots = (intern_slot_t *)ARC_CALLOC(INTERN_MIN_SLOTS, sizeof(intern_slot_t));
+    if (!table->slots) {
+        ARC_FREE(table);
+        return NULL;
+    }
+    table->arena = arena;
+    table->cap = INTERN_MIN_SLOTS;
+    return table;
+}
+
+void ac_intern_destroy(ac_intern_t *table) {
+    if (table) {
+        ARC_FREE(table->slots);
+        ARC_FREE(table);
+    }
+}
+
+arena_t *ac_intern_arena(const ac_intern_t *table) {
+    return table ? table->arena : NULL;
+}
+
+size_t ac_intern_count(const ac_intern_t *table) {
+    return table ? table->count : 0;
+}
+
+/**
+ * @brief Double the slot array (load factor kept under 3/4)
+ */
+static int intern_grow(ac_intern_t *table) {
+    size_t cap = table->cap * 2;
+    intern_slot_t *slots = (intern_slot_t *)ARC_CALLOC(cap, sizeof(intern_slot_t));
+    if (!slots) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < table->cap; i++) {
+        const intern_slot_t *old = &table->slots[i];
+        if (!old->str) {
+            continue;
+        }
+        size_t j = (size_t)old->hash & (cap - 1);
+        while (slots[j].str) {
+            j = (j + 1) & (cap - 1);
+        }
+        slots[j] = *old;
+    }
+
+    ARC_FREE(table->slots);
+    table->slots = slots;
+    table->cap = cap;
+    return 1;
+}
+
+const char *ac_intern_n(ac_intern_t *table, const char *s, size_t len) {
+    if (!table || !s) {
+        return NULL;
+    }
+
+    uint64_t hash = intern_hash(s, len);
+    size_t i = (size_t)hash & (table->cap - 1);
+    for (; table->slots[i].str; i = (i + 1) & (table->cap - 1)) {
+        const intern_slot_t *slot = &table->slots[i];
+        if (slot->hash == hash && slot->len == len && memcmp(slot->str, s, len) == 0) {
+            return slot->str;
+        }
+    }
+
+    /* Keep one slot empty so probing always terminates */
+    if (table->count + 1 >= table->cap) {
+        return NULL;
+    }
+
+    char *copy = arena_alloc(table->arena, len + 1);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+
+    table->slots[i].str = copy;
+    table->slots[i].len = len;
+    table->slots[i].hash = hash;
+    table->count++;
+
+    /* A failed grow only costs probe length until the next insert */
+    if (table->count * 4 >= table->cap * 3) {
+        intern_grow(table);
+    }
+    return copy;
+}
+
+const char *ac_intern(ac_intern_t *table, const char *s) {
+    return s ? ac_intern_n(table, s, strlen(s)) : NULL;
+}
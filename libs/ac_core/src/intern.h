@@ -0,0 +1,63 @@
+/**
+ * @file intern.h
+ * @brief String interning for repeated identifiers (internal)
+ *
+ * Tool names and tool call ids recur across a long conversation: the
+ * same few dozen names appear in every tool_use block, call list and
+ * tool_result. An intern table stores each distinct string once in an
+ * arena and hands out the same pointer for equal strings, so copies cost
+ * a hash lookup and equality can be tested by pointer.
+ *
+ * The table is not synchronized; an agent uses its own from the run
+ * thread only. Interned strings share the arena's lifetime.
+ */
+
+#ifndef ARC_INTERN_H
+#define ARC_INTERN_H
+
+#include "arc/arena.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ac_intern ac_intern_t;
+
+/**
+ * @brief Create a table whose strings are allocated from arena
+ *
+ * The slot array is heap memory so growth does not strand arena space.
+ */
+ac_intern_t *ac_intern_create(arena_t *arena);
+
+/**
+ * @brief Destroy the table (the strings stay in the arena)
+ */
+void ac_intern_destroy(ac_intern_t *table);
+
+/**
+ * @brief Arena the table allocates from
+ */
+arena_t *ac_intern_arena(const ac_intern_t *table);
+
+/**
+ * @brief Canonical copy of s (NULL for NULL or out of memory)
+ */
+const char *ac_intern(ac_intern_t *table, const char *s);
+
+/**
+ * @brief Canonical copy of the first len bytes of s
+ */
+const char *ac_intern_n(ac_intern_t *table, const char *s, size_t len);
+
+/**
+ * @brief Number of distinct strings held
+ */
+size_t ac_intern_count(const ac_intern_t *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_INTERN_H */
@@ -0,0 +1,620 @@
+/**
+ * @file json_scan.c
+ * @brief Allocation-free JSON reader for known paths
+ */
+
+#include "json_scan.h"
+#include "arc/platform.h"
+#include <limits.h>
+#include <string.h>
+
+static const ac_json_span_t s_none = { NULL, NULL, AC_JSON_NONE };
+
+/*============================================================================
+ * Tokenizer
+ *============================================================================*/
+
+static const char *skip_ws(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief End of the string starting at the quote p (one past the closing quote)
+ */
+static const char *string_end(const char *p, const char *end) {
+    const char *q = p + 1;
+    for (;;) {
+        q = memchr(q, '"', (size_t)(end - q));
+        if (!q) {
+            return NULL;
+        }
+        /* Escaped if preceded by an odd number of backslashes */
+        size_t slashes = 0;
+        while (q - slashes > p + 1 && q[-1 - (ptrdiff_t)slashes] == '\\') {
+            slashes++;
+        }
+        if ((slashes & 1) == 0) {
+            return q + 1;
+        }
+        q++;
+    }
+}
+
+static const char *literal_end(const char *p, const char *end, const char *lit, size_t len) {
+    return (size_t)(end - p) >= len && memcmp(p, lit, len) == 0 ? p + len : NULL;
+}
+
+static int hex4(const char *p, const char *end, unsigned *out) {
+    if (end - p < 4) {
+        return 0;
+    }
+    unsigned v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') {
+            v |= (unsigned)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            v |= (unsigned)(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            v |= (unsigned)(c - 'A' + 10);
+        } else {
+            return 0;
+        }
+    }
+    *out = v;
+    return 1;
+}
+
+/**
+ * @brief Span of the value starting at p (whitespace already skipped)
+ */
+static ac_json_span_t scan_value(const char *p, const char *end) {
+    ac_json_span_t v = { p, NULL, AC_JSON_NONE };
+    if (p >= end) {
+        return s_none;
+    }
+
+    switch (*p) {
+        case '"':
+            v.kind = AC_JSON_STRING;
+            v.end = string_end(p, end);
+            break;
+        case '{':
+        case '[': {
+            v.kind = *p == '{' ? AC_JSON_OBJECT : AC_JSON_ARRAY;
+            int depth = 1;
+            for (const char *q = p + 1; q < end; q++) {
+                char c = *q;
+                if (c == '"') {
+                    q = string_end(q, end);
+                    if (!q) {
+                        break;
+                    }
+                    q--;
+                } else if (c == '{' || c == '[') {
+                    depth++;
+                } else if ((c == '}' || c == ']') && --depth == 0) {
+                    v.end = q + 1;
+                    break;
+                }
+            }
+            break;
+        }
+        case 't':
+            v.kind = AC_JSON_TRUE;
+            v.end = literal_end(p, end, "true", 4);
+            break;
+        case 'f':
+            v.kind = AC_JSON_FALSE;
+            v.end = literal_end(p, end, "false", 5);
+            break;
+        case 'n':
+            v.kind = AC_JSON_NULL;
+            v.end = literal_end(p, end, "null", 4);
+            break;
+        default:
+            if (*p == '-' || (*p >= '0' && *p <= '9')) {
+                const char *q = p + 1;
+                while (q < end && ((*q >= '0' && *q <= '9') || *q == '.' ||
+                                   *q == 'e' || *q == 'E' || *q == '+' || *q == '-')) {
+                    q++;
+                }
+                v.kind = AC_JSON_NUMBER;
+                v.end = q;
+            }
+            break;
+    }
+
+    return v.end ? v : s_none;
+}
+
+/*============================================================================
+ * Validation
+ *============================================================================*/
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char *valid_string(const char *p, const char *end) {
+    for (p++; p < end; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"') {
+            return p + 1;
+        }
+        if (c < 0x20) {
+            return NULL;
+        }
+        if (c == '\\') {
+            if (++p >= end) {
+                return NULL;
+            }
+            unsigned cp;
+            if (*p == 'u') {
+                if (!hex4(p + 1, end, &cp)) {
+                    return NULL;
+                }
+                p += 4;
+            } else if (*p == '\0' || !strchr("\"\\/bfnrt", *p)) {
+                return NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+static const char *valid_number(const char *p, const char *end) {
+    if (p < end && *p == '-') {
+        p++;
+    }
+    if (p >= end || !is_digit(*p)) {
+        return NULL;
+    }
+    if (*p == '0') {
+        p++;
+    } else {
+        while (p < end && is_digit(*p)) p++;
+    }
+    if (p < end && *p == '.') {
+        if (++p >= end || !is_digit(*p)) {
+            return NULL;
+        }
+        while (p < end && is_digit(*p)) p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) {
+            p++;
+        }
+        if (p >= end || !is_digit(*p)) {
+            return NULL;
+        }
+        while (p < end && is_digit(*p)) p++;
+    }
+    return p;
+}
+
+/**
+ * @brief End of the valid value starting at p, NULL if malformed
+ */
+static const char *valid_value(const char *p, const char *end, int depth) {
+    p = skip_ws(p, end);
+    if (p >= end) {
+        return NULL;
+    }
+
+    switch (*p) {
+        case '"':
+            return valid_string(p, end);
+        case 't':
+            return literal_end(p, end, "true", 4);
+        case 'f':
+            return literal_end(p, end, "false", 5);
+        case 'n':
+            return literal_end(p, end, "null", 4);
+        case '{':
+        case '[': {
+            char close = *p == '{' ? '}' : ']';
+            int object = *p == '{';
+            if (depth >= AC_JSON_SCAN_MAX_DEPTH) {
+                return NULL;
+            }
+            p = skip_ws(p + 1, end);
+            if (p < end && *p == close) {
+                return p + 1;
+            }
+            for (;;) {
+                if (object) {
+                    p = skip_ws(p, end);
+                    if (p >= end || *p != '"' || !(p = valid_string(p, end))) {
+                        return NULL;
+                    }
+                    p = skip_ws(p, end);
+                    if (p >= end || *p++ != ':') {
+                        return NULL;
+                    }
+                }
+                p = valid_value(p, end, depth + 1);
+                if (!p) {
+                    return NULL;
+                }
+                p = skip_ws(p, end);
+                if (p >= end) {
+                    return NULL;
+                }
+                if (*p == close) {
+                    return p + 1;
+                }
+                if (*p++ != ',') {
+                    return NULL;
+                }
+            }
+        }
+        default:
+            return valid_number(p, end);
+    }
+}
+
+int ac_json_scan_valid(const char *json, size_t len) {
+    if (!json) {
+        return 0;
+    }
+    const char *end = json + len;
+    const char *p = valid_value(json, end, 0);
+    return p && skip_ws(p, end) == end;
+}
+
+/*============================================================================
+ * Lookup
+ *============================================================================*/
+
+ac_json_span_t ac_json_scan_root(const char *json, size_t len) {
+    if (!json) {
+        return s_none;
+    }
+    const char *end = json + len;
+    return scan_value(skip_ws(json, end), end);
+}
+
+ac_json_span_t ac_json_scan_get(ac_json_span_t obj, const char *key) {
+    if (obj.kind != AC_JSON_OBJECT || !key) {
+        return s_none;
+    }
+
+    size_t key_len = strlen(key);
+    const char *end = obj.end - 1;   /* At the closing brace */
+    const char *p = skip_ws(obj.start + 1, end);
+
+    while (p < end && *p == '"') {
+        const char *key_end = string_end(p, end);
+        if (!key_end) {
+            return s_none;
+        }
+        int match = (size_t)(key_end - p - 2) == key_len && memcmp(p + 1, key, key_len) == 0;
+
+        p = skip_ws(key_end, end);
+        if (p >= end || *p != ':') {
+            return s_none;
+        }
+        ac_json_span_t v = scan_value(skip_ws(p + 1, end), end);
+        if (v.kind == AC_JSON_NONE || match) {
+            return v;
+        }
+
+        p = skip_ws(v.end, end);
+        if (p >= end || *p != ',') {
+            return s_none;
+        }
+        p = skip_ws(p + 1, end);
+    }
+    return s_none;
+}
+
+ac_json_span_t ac_json_scan_index(ac_json_span_t arr, size_t index) {
+    if (arr.kind != AC_JSON_ARRAY) {
+        return s_none;
+    }
+
+    const char *end = arr.end - 1;   /* At the closing bracket */
+    const char *p = skip_ws(arr.start + 1, end);
+
+    for (size_t i = 0; p < end; i++) {
+        ac_json_span_t v = scan_value(p, end);
+        if (v.kind == AC_JSON_NONE || i == index) {
+            return v;
+        }
+        p = skip_ws(v.end, end);
+        if (p >= end || *p != ',') {
+            return s_none;
+        }
+        p = skip_ws(p + 1, end);
+    }
+    return s_none;
+}
+
+ac_json_iter_t ac_json_scan_members(ac_json_span_t obj) {
+    ac_json_iter_t it = { NULL, NULL };
+    if (obj.kind == AC_JSON_OBJECT) {
+        it.end = obj.end - 1;        /* At the closing brace */
+        it.p = skip_ws(obj.start + 1, it.end);
+    }
+    return it;
+}
+
+int ac_json_scan_next_member(ac_json_iter_t *it, ac_json_span_t *key, ac_json_span_t *value) {
+    if (!it || !it->p || it->p >= it->end || *it->p != '"') {
+        return 0;
+    }
+
+    const char *end = it->end;
+    const char *key_end = string_end(it->p, end);
+    const char *p = key_end ? skip_ws(key_end, end) : NULL;
+    if (!p || p >= end || *p != ':') {
+        it->p = NULL;
+        return 0;
+    }
+    ac_json_span_t v = scan_value(skip_ws(p + 1, end), end);
+    if (v.kind == AC_JSON_NONE) {
+        it->p = NULL;
+        return 0;
+    }
+
+    if (key) {
+        key->start = it->p;
+        key->end = key_end;
+        key->kind = AC_JSON_STRING;
+    }
+    if (value) {
+        *value = v;
+    }
+
+    p = skip_ws(v.end, end);
+    if (p < end && *p == ',') {
+        p = skip_ws(p + 1, end);
+    } else if (p < end) {
+        p = NULL;                    /* Malformed: stop after this member */
+    }
+    it->p = p;
+    return 1;
+}
+
+ac_json_iter_t ac_json_scan_elements(ac_json_span_t arr) {
+    ac_json_iter_t it = { NULL, NULL };
+    if (arr.kind == AC_JSON_ARRAY) {
+        it.end = arr.end - 1;        /* At the closing bracket */
+        it.p = skip_ws(arr.start + 1, it.end);
+    }
+    return it;
+}
+
+int ac_json_scan_next_element(ac_json_iter_t *it, ac_json_span_t *value) {
+    if (!it || !it->p || it->p >= it->end) {
+        return 0;
+    }
+
+    const char *end = it->end;
+    ac_json_span_t v = scan_value(it->p, end);
+    if (v.kind == AC_JSON_NONE) {
+        it->p = NULL;
+        return 0;
+    }
+    if (value) {
+        *value = v;
+    }
+
+    const char *p = skip_ws(v.end, end);
+    if (p < end && *p == ',') {
+        p = skip_ws(p + 1, end);
+    } else if (p < end) {
+        p = NULL;                    /* Malformed: stop after this element */
+    }
+    it->p = p;
+    return 1;
+}
+
+ac_json_span_t ac_json_scan_path(ac_json_span_t value, const char *path) {
+    char key[64];
+
+    while (path && *path && value.kind != AC_JSON_NONE) {
+        const char *dot = strchr(path, '.');
+        size_t len = dot ? (size_t)(dot - path) : strlen(path);
+        if (len >= sizeof(key)) {
+            return s_none;
+        }
+
+        int numeric = len > 0;
+        size_t index = 0;
+        for (size_t i = 0; i < len; i++) {
+            if (path[i] < '0' || path[i] > '9') {
+                numeric = 0;
+                break;
+            }
+            index = index * 10 + (size_t)(path[i] - '0');
+        }
+
+        if (numeric) {
+            value = ac_json_scan_index(value, index);
+        } else {
+            memcpy(key, path, len);
+            key[len] = '\0';
+            value = ac_json_scan_get(value, key);
+        }
+        path = dot ? dot + 1 : NULL;
+    }
+    return value;
+}
+
+/*============================================================================
+ * Values
+ *============================================================================*/
+
+int ac_json_scan_str_eq(ac_json_span_t value, const char *lit) {
+    if (value.kind != AC_JSON_STRING || !lit) {
+        return 0;
+    }
+    size_t len = strlen(lit);
+    return (size_t)(value.end - value.start - 2) == len && memcmp(value.start + 1, lit, len) == 0;
+}
+
+int ac_json_scan_int(ac_json_span_t value, int *out) {
+    if (value.kind != AC_JSON_NUMBER || !out) {
+        return 0;
+    }
+
+    const char *p = value.start;
+    int negative = *p == '-';
+    if (negative) {
+        p++;
+    }
+
+    long long n = 0;
+    for (; p < value.end && *p >= '0' && *p <= '9'; p++) {
+        if (n <= INT_MAX) {
+            n = n * 10 + (*p - '0');
+        }
+    }
+    if (negative) {
+        n = -n;
+    }
+
+    /* Saturate like cJSON */
+    *out = n > INT_MAX ? INT_MAX : n < INT_MIN ? INT_MIN : (int)n;
+    return 1;
+}
+
+static size_t utf8_encode(unsigned cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/**
+ * @brief Decode the escape at bs (a backslash before end) into out
+ *
+ * @return Bytes written (at most 4); *next is set past the escape
+ */
+static size_t decode_escape(const char *bs, const char *end, char *out, const char **next) {
+    const char *p = bs + 2;
+    size_t n = 1;
+    switch (bs[1]) {
+        case 'b': out[0] = '\b'; break;
+        case 'f': out[0] = '\f'; break;
+        case 'n': out[0] = '\n'; break;
+        case 'r': out[0] = '\r'; break;
+        case 't': out[0] = '\t'; break;
+        case 'u': {
+            unsigned cp;
+            if (!hex4(p, end, &cp)) {
+                out[0] = 'u';
+                break;
+            }
+            p += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                /* Surrogate pair */
+                unsigned lo;
+                if (end - p >= 6 && p[0] == '\\' && p[1] == 'u' && hex4(p + 2, end, &lo) &&
+                    lo >= 0xDC00 && lo <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    p += 6;
+                } else {
+                    cp = 0xFFFD;
+                }
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                cp = 0xFFFD;
+            }
+            n = utf8_encode(cp, out);
+            break;
+        }
+        default:
+            /* \" \\ \/ and anything unknown stand for themselves */
+            out[0] = bs[1];
+            break;
+    }
+    *next = p;
+    return n;
+}
+
+arc_err_t ac_json_scan_append(ac_json_span_t value, ac_strbuf_t *sb) {
+    if (value.kind != AC_JSON_STRING || !sb) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    const char *p = value.start + 1;
+    const char *end = value.end - 1;  /* At the closing quote */
+
+    while (p < end) {
+        const char *bs = memchr(p, '\\', (size_t)(end - p));
+        const char *run_end = bs ? bs : end;
+        if (run_end > p && ac_strbuf_append(sb, p, (size_t)(run_end - p)) != ARC_OK) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        if (!bs || bs + 1 >= end) {
+            break;
+        }
+
+        char out[8];
+        size_t n = decode_escape(bs, end, out, &p);
+        if (ac_strbuf_append(sb, out, n) != ARC_OK) {
+            return ARC_ERR_NO_MEMORY;
+        }
+    }
+    return ARC_OK;
+}
+
+size_t ac_json_scan_unescape(ac_json_span_t value, char *out) {
+    if (value.kind != AC_JSON_STRING || !out) {
+        return 0;
+    }
+
+    const char *p = value.start + 1;
+    const char *end = value.end - 1;  /* At the closing quote */
+    char *w = out;
+
+    while (p < end) {
+        const char *bs = memchr(p, '\\', (size_t)(end - p));
+        const char *run_end = bs ? bs : end;
+        memcpy(w, p, (size_t)(run_end - p));
+        w += run_end - p;
+        if (!bs || bs + 1 >= end) {
+            break;
+        }
+        /* An escape is never shorter than what it decodes to */
+        w += decode_escape(bs, end, w, &p);
+    }
+    *w = '\0';
+    return (size_t)(w - out);
+}
+
+char *ac_json_scan_strdup(ac_json_span_t value) {
+    if (value.kind != AC_JSON_STRING) {
+        return NULL;
+    }
+    ac_strbuf_t sb = AC_STRBUF_INIT;
+    if (ac_json_scan_append(value, &sb) != ARC_OK) {
+        ac_strbuf_reset(&sb);
+        return NULL;
+    }
+    char *s = ac_strbuf_take(&sb);
+    return s ? s : ARC_STRDUP("");
+}
@@ -0,0 +1,156 @@
+/**
+ * @file json_scan.h
+ * @brief Allocation-free JSON reader for known paths (internal)
+ *
+ * Looks values up directly in the serialized bytes instead of building a
+ * cJSON tree: a value is a span of the input, and only what the caller
+ * pulls out is decoded. Meant for small, hot documents such as stream
+ * deltas, where the tree costs more than the event itself.
+ *
+ * Input need not be NUL-terminated. Lookups never read outside the
+ * input; malformed JSON makes them return AC_JSON_NONE rather than fail
+ * loudly, so this is not a validator.
+ */
+
+#ifndef ARC_JSON_SCAN_H
+#define ARC_JSON_SCAN_H
+
+#include "strbuf.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Deepest nesting ac_json_scan_valid() accepts (as cJSON) */
+#define AC_JSON_SCAN_MAX_DEPTH 1000
+
+typedef enum {
+    AC_JSON_NONE = 0,                /* Missing or malformed */
+    AC_JSON_NULL,
+    AC_JSON_FALSE,
+    AC_JSON_TRUE,
+    AC_JSON_NUMBER,
+    AC_JSON_STRING,
+    AC_JSON_ARRAY,
+    AC_JSON_OBJECT
+} ac_json_kind_t;
+
+typedef struct {
+    const char *start;               /* First byte (quote, bracket, digit...) */
+    const char *end;                 /* One past the last byte */
+    ac_json_kind_t kind;
+} ac_json_span_t;
+
+/** Cursor over the members of an object or the elements of an array */
+typedef struct {
+    const char *p;                   /* Next member (NULL = done) */
+    const char *end;                 /* At the closing brace */
+} ac_json_iter_t;
+
+/**
+ * @brief Span of the top-level value of a document
+ */
+ac_json_span_t ac_json_scan_root(const char *json, size_t len);
+
+/**
+ * @brief Check that the input is exactly one well-formed JSON value
+ *
+ * Strict RFC 8259 grammar (surrounding whitespace allowed), nesting
+ * limited to AC_JSON_SCAN_MAX_DEPTH. Use before splicing foreign text
+ * into a document verbatim.
+ *
+ * @return 1 if valid, 0 otherwise
+ */
+int ac_json_scan_valid(const char *json, size_t len);
+
+/**
+ * @brief Member of an object by key (first match, key compared raw)
+ */
+ac_json_span_t ac_json_scan_get(ac_json_span_t obj, const char *key);
+
+/**
+ * @brief Element of an array
+ */
+ac_json_span_t ac_json_scan_index(ac_json_span_t arr, size_t index);
+
+/**
+ * @brief Start iterating the members of an object (empty for non-objects)
+ */
+ac_json_iter_t ac_json_scan_members(ac_json_span_t obj);
+
+/**
+ * @brief Next member, in document order
+ *
+ * @param key   Key span (quoted, escapes not decoded), may be NULL
+ * @param value Value span, may be NULL
+ * @return 1 if a member was produced, 0 at the end or on malformed input
+ */
+int ac_json_scan_next_member(ac_json_iter_t *it, ac_json_span_t *key, ac_json_span_t *value);
+
+/**
+ * @brief Start iterating the elements of an array (empty for non-arrays)
+ *
+ * Walks the array once, where repeated ac_json_scan_index() calls would
+ * rescan it from the start each time.
+ */
+ac_json_iter_t ac_json_scan_elements(ac_json_span_t arr);
+
+/**
+ * @brief Next element, in document order
+ *
+ * @return 1 if an element was produced, 0 at the end or on malformed input
+ */
+int ac_json_scan_next_element(ac_json_iter_t *it, ac_json_span_t *value);
+
+/**
+ * @brief Walk a dotted path, e.g. "choices.0.delta.content"
+ *
+ * All-digit components index arrays, anything else looks up a key.
+ */
+ac_json_span_t ac_json_scan_path(ac_json_span_t value, const char *path);
+
+/**
+ * @brief Check for a string equal to lit (escape-free strings only)
+ */
+int ac_json_scan_str_eq(ac_json_span_t value, const char *lit);
+
+/**
+ * @brief Read a number as int (fraction/exponent truncated like cJSON's valueint)
+ *
+ * @return 1 if value is a number, 0 otherwise (*out unchanged)
+ */
+int ac_json_scan_int(ac_json_span_t value, int *out);
+
+/**
+ * @brief Append a string value, unescaped, to sb
+ *
+ * Runs without escapes are copied in bulk.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG if value is not a string,
+ *         ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_json_scan_append(ac_json_span_t value, ac_strbuf_t *sb);
+
+/**
+ * @brief Unescape a string value into out, NUL-terminated
+ *
+ * The result is never longer than the quoted source, so out needs at
+ * most (value.end - value.start) bytes.
+ *
+ * @return Length written (0 if value is not a string)
+ */
+size_t ac_json_scan_unescape(ac_json_span_t value, char *out);
+
+/**
+ * @brief Unescaped heap copy of a string value (ARC_FREE)
+ *
+ * @return String, NULL if value is not a string or out of memory
+ */
+char *ac_json_scan_strdup(ac_json_span_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_JSON_SCAN_H */
@@ -0,0 +1,338 @@
+/**
+ * @file json_schema.c
+ * @brief JSON Schema check of structured answers
+ */
+
+#include "json_schema.h"
+#include "cJSON.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const cJSON *root;               /* Schema root, for $ref */
+    char *err;
+    size_t err_size;
+    int quiet;                       /* Inside an anyOf/oneOf branch: keep err */
+    char path[256];                  /* "$.items[2].name" of the current value */
+    size_t path_len;
+} check_ctx_t;
+
+static int fail(check_ctx_t *ctx, const char *fmt, ...) {
+    if (ctx->quiet || !ctx->err || ctx->err_size == 0) {
+        return 0;
+    }
+    int n = snprintf(ctx->err, ctx->err_size, "%s: ", ctx->path);
+    if (n >= 0 && (size_t)n < ctx->err_size) {
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(ctx->err + n, ctx->err_size - (size_t)n, fmt, ap);
+        va_end(ap);
+    }
+    return 0;
+}
+
+/** Extend the path by a segment; returns the length to restore */
+static size_t path_push(check_ctx_t *ctx, const char *fmt, ...) {
+    size_t saved = ctx->path_len;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(ctx->path + saved, sizeof(ctx->path) - saved, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        ctx->path_len = saved + (size_t)n < sizeof(ctx->path) ? saved + (size_t)n
+                                                              : sizeof(ctx->path) - 1;
+    }
+    return saved;
+}
+
+static void path_pop(check_ctx_t *ctx, size_t saved) {
+    ctx->path_len = saved;
+    ctx->path[saved] = '\0';
+}
+
+static int type_matches(const char *type, const cJSON *v) {
+    if (strcmp(type, "object") == 0) return cJSON_IsObject(v);
+    if (strcmp(type, "array") == 0) return cJSON_IsArray(v);
+    if (strcmp(type, "string") == 0) return cJSON_IsString(v);
+    if (strcmp(type, "number") == 0) return cJSON_IsNumber(v);
+    if (strcmp(type, "integer") == 0) {
+        return cJSON_IsNumber(v) && v->valuedouble == floor(v->valuedouble);
+    }
+    if (strcmp(type, "boolean") == 0) return cJSON_IsBool(v);
+    if (strcmp(type, "null") == 0) return cJSON_IsNull(v);
+    return 1;                        /* Unknown type names are not checked */
+}
+
+static size_t utf8_length(const char *s) {
+    size_t n = 0;
+    for (; *s; s++) {
+        n += ((unsigned char)*s & 0xC0) != 0x80;
+    }
+    return n;
+}
+
+/**
+ * @brief Target of a local $ref ("#", "#/a/b", with ~0 and ~1 decoded)
+ */
+static const cJSON *resolve_ref(const cJSON *root, const char *ref) {
+    if (ref[0] != '#') {
+        return NULL;                 /* Remote references are not fetched */
+    }
+    const cJSON *node = root;
+    const char *p = ref + 1;
+    while (node && *p == '/') {
+        char name[128];
+        size_t n = 0;
+        for (p++; *p && *p != '/' && n < sizeof(name) - 1; p++) {
+            if (p[0] == '~' && (p[1] == '0' || p[1] == '1')) {
+                name[n++] = p[1] == '0' ? '~' : '/';
+                p++;
+            } else {
+                name[n++] = *p;
+            }
+        }
+        name[n] = '\0';
+        node = cJSON_GetObjectItemCaseSensitive(node, name);
+    }
+    return *p ? NULL : node;
+}
+
+static int check(check_ctx_t *ctx, const cJSON *schema, const cJSON *v, int depth);
+
+static int check_type(check_ctx_t *ctx, const cJSON *type, const cJSON *v) {
+    if (cJSON_IsString(type)) {
+        return type_matches(type->valuestring, v) ||
+               fail(ctx, "expected %s", type->valuestring);
+    }
+    if (cJSON_IsArray(type)) {
+        const cJSON *t;
+        cJSON_ArrayForEach(t, type) {
+            if (cJSON_IsString(t) && type_matches(t->valuestring, v)) {
+                return 1;
+            }
+        }
+        return fail(ctx, "type not allowed");
+    }
+    return 1;
+}
+
+static int check_number(check_ctx_t *ctx, const cJSON *schema, double x) {
+    const cJSON *k;
+    if ((k = cJSON_GetObjectItemCaseSensitive(schema, "minimum")) && cJSON_IsNumber(k) &&
+        x < k->valuedouble) {
+        return fail(ctx, "below minimum %g", k->valuedouble);
+    }
+    if ((k = cJSON_GetObjectItemCaseSensitive(schema, "maximum")) && cJSON_IsNumber(k) &&
+        x > k->valuedouble) {
+        return fail(ctx, "above maximum %g", k->valuedouble);
+    }
+    if ((k = cJSON_GetObjectItemCaseSensitive(schema, "exclusiveMinimum")) && cJSON_IsNumber(k) &&
+        x <= k->valuedouble) {
+        return fail(ctx, "not above %g", k->valuedouble);
+    }
+    if ((k = cJSON_GetObjectItemCaseSensitive(schema, "exclusiveMaximum")) && cJSON_IsNumber(k) &&
+        x >= k->valuedouble) {
+        return fail(ctx, "not below %g", k->valuedouble);
+    }
+    return 1;
+}
+
+/** Whether count is within schema's min/max keywords of that name */
+static int check_count(check_ctx_t *ctx, const cJSON *schema, size_t count,
+                       const char *min_key, const char *max_key, const char *what) {
+    const cJSON *k;
+    if ((k = cJSON_GetObjectItemCaseSensitive(schema, min_key)) && cJSON_IsNumber(k) &&
+        (double)count < k->valuedouble) {
+        return fail(ctx, "fewer than %d %s", k->valueint, what);
+    }
+    if ((k = cJSON_GetObjectItemCaseSensitive(schema, max_key)) && cJSON_IsNumber(k) &&
+        (double)count > k->valuedouble) {
+        return fail(ctx, "more than %d %s", k->valueint, what);
+    }
+    return 1;
+}
+
+static int check_array(check_ctx_t *ctx, const cJSON *schema, const cJSON *v, int depth) {
+    if (!check_count(ctx, schema, (size_t)cJSON_GetArraySize(v), "minItems", "maxItems",
+                     "items")) {
+        return 0;
+    }
+    const cJSON *items = cJSON_GetObjectItemCaseSensitive(schema, "items");
+    if (!items || !(cJSON_IsObject(items) || cJSON_IsBool(items))) {
+        return 1;
+    }
+    int i = 0;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, v) {
+        size_t saved = path_push(ctx, "[%d]", i++);
+        int ok = check(ctx, items, item, depth + 1);
+        path_pop(ctx, saved);
+        if (!ok) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int check_object(check_ctx_t *ctx, const cJSON *schema, const cJSON *v, int depth) {
+    const cJSON *required = cJSON_GetObjectItemCaseSensitive(schema, "required");
+    const cJSON *name;
+    if (!cJSON_IsArray(required)) {
+        required = NULL;
+    }
+    cJSON_ArrayForEach(name, required) {
+        if (cJSON_IsString(name) && !cJSON_GetObjectItemCaseSensitive(v, name->valuestring)) {
+            return fail(ctx, "missing property \"%s\"", name->valuestring);
+        }
+    }
+
+    const cJSON *properties = cJSON_GetObjectItemCaseSensitive(schema, "properties");
+    const cJSON *additional = cJSON_GetObjectItemCaseSensitive(schema, "additionalProperties");
+    const cJSON *member;
+    cJSON_ArrayForEach(member, v) {
+        const cJSON *sub = cJSON_IsObject(properties)
+                         ? cJSON_GetObjectItemCaseSensitive(properties, member->string) : NULL;
+        if (!sub) {
+            if (cJSON_IsFalse(additional)) {
+                return fail(ctx, "unexpected property \"%s\"", member->string);
+            }
+            if (!cJSON_IsObject(additional)) {
+                continue;
+            }
+            sub = additional;
+        }
+        size_t saved = path_push(ctx, ".%s", member->string);
+        int ok = check(ctx, sub, member, depth + 1);
+        path_pop(ctx, saved);
+        if (!ok) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** allOf, anyOf and oneOf */
+static int check_combinators(check_ctx_t *ctx, const cJSON *schema, const cJSON *v, int depth) {
+    const cJSON *all = cJSON_GetObjectItemCaseSensitive(schema, "allOf");
+    const cJSON *sub;
+    if (!cJSON_IsArray(all)) {
+        all = NULL;
+    }
+    cJSON_ArrayForEach(sub, all) {
+        if (!check(ctx, sub, v, depth + 1)) {
+            return 0;
+        }
+    }
+
+    static const char *const KEYS[] = { "anyOf", "oneOf" };
+    for (int k = 0; k < 2; k++) {
+        const cJSON *list = cJSON_GetObjectItemCaseSensitive(schema, KEYS[k]);
+        if (!cJSON_IsArray(list)) {
+            continue;
+        }
+        int matched = 0;
+        ctx->quiet++;
+        cJSON_ArrayForEach(sub, list) {
+            matched += check(ctx, sub, v, depth + 1);
+        }
+        ctx->quiet--;
+        if (matched == 0) {
+            return fail(ctx, "matches none of %s", KEYS[k]);
+        }
+        if (k == 1 && matched > 1) {
+            return fail(ctx, "matches %d of oneOf", matched);
+        }
+    }
+    return 1;
+}
+
+static int check(check_ctx_t *ctx, const cJSON *schema, const cJSON *v, int depth) {
+    if (cJSON_IsBool(schema)) {
+        return cJSON_IsTrue(schema) || fail(ctx, "not allowed");
+    }
+    if (!cJSON_IsObject(schema) || depth > AC_JSON_SCHEMA_MAX_DEPTH) {
+        return 1;
+    }
+
+    const cJSON *ref = cJSON_GetObjectItemCaseSensitive(schema, "$ref");
+    if (cJSON_IsString(ref)) {
+        const cJSON *target = resolve_ref(ctx->root, ref->valuestring);
+        if (target && !check(ctx, target, v, depth + 1)) {
+            return 0;
+        }
+    }
+
+    const cJSON *type = cJSON_GetObjectItemCaseSensitive(schema, "type");
+    if (type && !check_type(ctx, type, v)) {
+        return 0;
+    }
+
+    const cJSON *list = cJSON_GetObjectItemCaseSensitive(schema, "enum");
+    if (cJSON_IsArray(list)) {
+        const cJSON *e;
+        int found = 0;
+        cJSON_ArrayForEach(e, list) {
+            if (cJSON_Compare(e, v, 1)) {
+                found = 1;
+                break;
+            }
+        }
+        if (!found) {
+            return fail(ctx, "not one of the enum values");
+        }
+    }
+    const cJSON *constant = cJSON_GetObjectItemCaseSensitive(schema, "const");
+    if (constant && !cJSON_Compare(constant, v, 1)) {
+        return fail(ctx, "not the const value");
+    }
+
+    int ok = 1;
+    if (cJSON_IsNumber(v)) {
+        ok = check_number(ctx, schema, v->valuedouble);
+    } else if (cJSON_IsString(v)) {
+        ok = check_count(ctx, schema, utf8_length(v->valuestring), "minLength", "maxLength",
+                         "characters");
+    } else if (cJSON_IsArray(v)) {
+        ok = check_array(ctx, schema, v, depth);
+    } else if (cJSON_IsObject(v)) {
+        ok = check_object(ctx, schema, v, depth);
+    }
+    return ok && check_combinators(ctx, schema, v, depth);
+}
+
+int ac_json_schema_check(const char *schema, const char *doc, size_t doc_len,
+                         char *err, size_t err_size) {
+    if (err && err_size > 0) {
+        err[0] = '\0';
+    }
+    cJSON *root = schema ? cJSON_Parse(schema) : NULL;
+    if (!root) {
+        return 1;
+    }
+    /* One value, whitespace around it (cJSON stops quietly at trailing text) */
+    const char *end = NULL;
+    cJSON *value = cJSON_ParseWithLengthOpts(doc, doc_len, &end, 0);
+    while (value && end < doc + doc_len && (*end == ' ' || *end == '\t' ||
+                                            *end == '\n' || *end == '\r')) {
+        end++;
+    }
+    if (value && end < doc + doc_len) {
+        cJSON_Delete(value);
+        value = NULL;
+    }
+    if (!value) {
+        cJSON_Delete(root);
+        if (err && err_size > 0) {
+            snprintf(err, err_size, "not valid JSON");
+        }
+        return 0;
+    }
+
+    check_ctx_t ctx = { root, err, err_size, 0, "$", 1 };
+    int ok = check(&ctx, root, value, 0);
+    cJSON_Delete(value);
+    cJSON_Delete(root);
+    return ok;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file json_schema.h
+ * @brief JSON Schema check of structured answers (internal)
+ *
+ * Covers what answer schemas use in practice: type (one or a list,
+ * "integer" included), enum, const, properties, required,
+ * additionalProperties, items, minItems/maxItems, minLength/maxLength
+ * (code points), minimum/maximum and their exclusive forms, allOf,
+ * anyOf, oneOf and local $ref ("#/$defs/...", "#/definitions/...").
+ * Other keywords are accepted without checking, so a document this
+ * passes may still fail a full validator, never the other way round.
+ */
+
+#ifndef ARC_JSON_SCHEMA_H
+#define ARC_JSON_SCHEMA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Deepest schema nesting followed ($ref chains included) */
+#define AC_JSON_SCHEMA_MAX_DEPTH 64
+
+/**
+ * @brief Check a document against a schema
+ *
+ * A schema that does not parse checks nothing: it is the caller's
+ * configuration, not the document, that is wrong.
+ *
+ * @param schema    Schema JSON (NUL-terminated)
+ * @param doc       Document
+ * @param doc_len   Bytes in doc
+ * @param err       Receives the first mismatch, e.g. "$.items[2].name: expected string"
+ * @param err_size  Size of err
+ * @return 1 if doc matches, 0 if not
+ */
+int ac_json_schema_check(const char *schema, const char *doc, size_t doc_len,
+                         char *err, size_t err_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_JSON_SCHEMA_H */
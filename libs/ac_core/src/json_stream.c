@@ -0,0 +1,323 @@
+/**
+ * @file json_stream.c
+ * @brief Incremental JSON validator
+ */
+
+#include "json_stream.h"
+#include <string.h>
+
+enum {
+    S_VALUE,                         /* Any value */
+    S_ARRAY_FIRST,                   /* Value or ']' */
+    S_KEY_FIRST,                     /* Key or '}' */
+    S_KEY,                           /* Key */
+    S_COLON,
+    S_AFTER,                         /* ',' or the container's close */
+    S_STRING,
+    S_ESCAPE,
+    S_HEX,
+    S_LITERAL,
+    S_NUM_SIGN,                      /* After '-': digit */
+    S_NUM_ZERO,                      /* Leading 0: no more int digits */
+    S_NUM_INT,
+    S_NUM_DOT,                       /* After '.': digit */
+    S_NUM_FRAC,
+    S_NUM_E,                         /* After e/E: sign or digit */
+    S_NUM_ESIGN,                     /* After exponent sign: digit */
+    S_NUM_EXP,
+    S_DONE,
+    S_ERROR
+};
+
+void ac_json_stream_init(ac_json_stream_t *js) {
+    if (js) {
+        memset(js, 0, sizeof(*js));
+        js->state = S_VALUE;
+    }
+}
+
+ac_json_stream_status_t ac_json_stream_status(const ac_json_stream_t *js) {
+    if (!js || js->state == S_ERROR) {
+        return AC_JSON_STREAM_ERROR;
+    }
+    return js->state == S_DONE ? AC_JSON_STREAM_COMPLETE : AC_JSON_STREAM_PARTIAL;
+}
+
+static int is_ws(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int is_hex(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static int top_is_object(const ac_json_stream_t *js) {
+    unsigned i = js->depth - 1;
+    return (js->containers[i / 8] >> (i % 8)) & 1;
+}
+
+static int push(ac_json_stream_t *js, int object) {
+    if (js->depth >= AC_JSON_STREAM_MAX_DEPTH) {
+        return 0;
+    }
+    unsigned i = js->depth++;
+    uint8_t bit = (uint8_t)(1u << (i % 8));
+    if (object) {
+        js->containers[i / 8] |= bit;
+    } else {
+        js->containers[i / 8] &= (uint8_t)~bit;
+    }
+    return 1;
+}
+
+/**
+ * @brief A value just ended
+ */
+static void value_done(ac_json_stream_t *js) {
+    js->state = js->depth == 0 ? S_DONE : S_AFTER;
+}
+
+/**
+ * @brief Start of a value; 0 if c cannot begin one
+ */
+static int value_begin(ac_json_stream_t *js, unsigned char c) {
+    switch (c) {
+        case '{':
+            js->state = S_KEY_FIRST;
+            return push(js, 1);
+        case '[':
+            js->state = S_ARRAY_FIRST;
+            return push(js, 0);
+        case '"':
+            js->in_key = 0;
+            js->state = S_STRING;
+            return 1;
+        case 't': js->literal = "rue";  js->state = S_LITERAL; return 1;
+        case 'f': js->literal = "alse"; js->state = S_LITERAL; return 1;
+        case 'n': js->literal = "ull";  js->state = S_LITERAL; return 1;
+        case '-': js->state = S_NUM_SIGN; return 1;
+        case '0': js->state = S_NUM_ZERO; return 1;
+        default:
+            if (c >= '1' && c <= '9') {
+                js->state = S_NUM_INT;
+                return 1;
+            }
+            return 0;
+    }
+}
+
+/**
+ * @brief One byte; 0 if it makes the document invalid
+ */
+static int step(ac_json_stream_t *js, unsigned char c) {
+    for (;;) {
+        switch (js->state) {
+            case S_VALUE:
+                return is_ws(c) || value_begin(js, c);
+
+            case S_ARRAY_FIRST:
+                if (c == ']') {
+                    js->depth--;
+                    value_done(js);
+                    return 1;
+                }
+                return is_ws(c) || value_begin(js, c);
+
+            case S_KEY_FIRST:
+                if (c == '}') {
+                    js->depth--;
+                    value_done(js);
+                    return 1;
+                }
+                /* fall through */
+            case S_KEY:
+                if (c == '"') {
+                    js->in_key = 1;
+                    js->state = S_STRING;
+                    return 1;
+                }
+                return is_ws(c);
+
+            case S_COLON:
+                if (c == ':') {
+                    js->state = S_VALUE;
+                    return 1;
+                }
+                return is_ws(c);
+
+            case S_AFTER:
+                if (c == ',') {
+                    js->state = top_is_object(js) ? S_KEY : S_VALUE;
+                    return 1;
+                }
+                if (c == (top_is_object(js) ? '}' : ']')) {
+                    js->depth--;
+                    value_done(js);
+                    return 1;
+                }
+                return is_ws(c);
+
+            case S_STRING:
+                if (c == '"') {
+                    if (js->in_key) {
+                        js->state = S_COLON;
+                    } else {
+                        value_done(js);
+                    }
+                    return 1;
+                }
+                if (c == '\\') {
+                    js->state = S_ESCAPE;
+                    return 1;
+                }
+                return c >= 0x20;
+
+            case S_ESCAPE:
+                if (c == 'u') {
+                    js->hex_left = 4;
+                    js->state = S_HEX;
+                    return 1;
+                }
+                js->state = S_STRING;
+                return c != '\0' && strchr("\"\\/bfnrt", c) != NULL;
+
+            case S_HEX:
+                if (!is_hex(c)) {
+                    return 0;
+                }
+                if (--js->hex_left == 0) {
+                    js->state = S_STRING;
+                }
+                return 1;
+
+            case S_LITERAL:
+                if (c != (unsigned char)*js->literal) {
+                    return 0;
+                }
+                if (*++js->literal == '\0') {
+                    value_done(js);
+                }
+                return 1;
+
+            case S_NUM_SIGN:
+                if (c == '0') {
+                    js->state = S_NUM_ZERO;
+                    return 1;
+                }
+                if (c >= '1' && c <= '9') {
+                    js->state = S_NUM_INT;
+                    return 1;
+                }
+                return 0;
+
+            case S_NUM_INT:
+                if (c >= '0' && c <= '9') {
+                    return 1;
+                }
+                /* fall through */
+            case S_NUM_ZERO:
+                if (c == '.') {
+                    js->state = S_NUM_DOT;
+                    return 1;
+                }
+                /* fall through */
+            case S_NUM_FRAC:
+                if (js->state == S_NUM_FRAC && c >= '0' && c <= '9') {
+                    return 1;
+                }
+                if (c == 'e' || c == 'E') {
+                    js->state = S_NUM_E;
+                    return 1;
+                }
+                /* Number ended: c belongs to what follows */
+                value_done(js);
+                continue;
+
+            case S_NUM_DOT:
+                if (c >= '0' && c <= '9') {
+                    js->state = S_NUM_FRAC;
+                    return 1;
+                }
+                return 0;
+
+            case S_NUM_E:
+                if (c == '+' || c == '-') {
+                    js->state = S_NUM_ESIGN;
+                    return 1;
+                }
+                /* fall through */
+            case S_NUM_ESIGN:
+                if (c >= '0' && c <= '9') {
+                    js->state = S_NUM_EXP;
+                    return 1;
+                }
+                return 0;
+
+            case S_NUM_EXP:
+                if (c >= '0' && c <= '9') {
+                    return 1;
+                }
+                value_done(js);
+                continue;
+
+            case S_DONE:
+                return is_ws(c);
+
+            default:
+                return 0;
+        }
+    }
+}
+
+ac_json_stream_status_t ac_json_stream_feed(ac_json_stream_t *js, const char *data, size_t len) {
+    if (!js || (!data && len > 0)) {
+        return AC_JSON_STREAM_ERROR;
+    }
+
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + len;
+    while (p < end && js->state != S_ERROR) {
+        /* Plain string bytes are the bulk of arguments: take them in a run */
+        if (js->state == S_STRING) {
+            const unsigned char *run = p;
+            while (p < end && *p >= 0x20 && *p != '"' && *p != '\\') {
+                p++;
+            }
+            js->offset += (size_t)(p - run);
+            if (p == end) {
+                break;
+            }
+        }
+
+        if (!step(js, *p)) {
+            js->state = S_ERROR;
+            break;
+        }
+        js->offset++;
+        p++;
+    }
+
+    return ac_json_stream_status(js);
+}
+
+ac_json_stream_status_t ac_json_stream_finish(ac_json_stream_t *js) {
+    if (!js) {
+        return AC_JSON_STREAM_ERROR;
+    }
+    switch (js->state) {
+        case S_NUM_ZERO:
+        case S_NUM_INT:
+        case S_NUM_FRAC:
+        case S_NUM_EXP:
+            if (js->depth == 0) {
+                js->state = S_DONE;
+            }
+            break;
+        default:
+            break;
+    }
+    if (js->state != S_DONE) {
+        js->state = S_ERROR;
+    }
+    return ac_json_stream_status(js);
+}
@@ -0,0 +1,64 @@
+/**
+ * @file json_stream.h
+ * @brief Incremental JSON validator for streamed fragments (internal)
+ *
+ * Checks a document piece by piece as it arrives, e.g. tool arguments
+ * delivered as input_json deltas, without buffering or re-scanning: each
+ * byte is looked at once. The caller learns as soon as the text can no
+ * longer be valid, and when the top-level value has closed.
+ *
+ * Grammar is the same strict RFC 8259 subset as ac_json_scan_valid():
+ * one value, surrounding whitespace allowed.
+ */
+
+#ifndef ARC_JSON_STREAM_H
+#define ARC_JSON_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Deepest object/array nesting tracked (deeper input is an error) */
+#define AC_JSON_STREAM_MAX_DEPTH 256
+
+typedef enum {
+    AC_JSON_STREAM_PARTIAL = 0,      /* Valid so far, value still open */
+    AC_JSON_STREAM_COMPLETE,         /* Top-level value closed (whitespace may follow) */
+    AC_JSON_STREAM_ERROR             /* Cannot become valid */
+} ac_json_stream_status_t;
+
+typedef struct {
+    uint8_t containers[AC_JSON_STREAM_MAX_DEPTH / 8];   /* Bit set: object */
+    unsigned depth;
+    uint8_t state;
+    uint8_t in_key;                  /* Current string is a member key */
+    uint8_t hex_left;                /* \uXXXX digits still expected */
+    const char *literal;             /* Rest of true/false/null */
+    size_t offset;                   /* Bytes accepted (error: offset of bad byte) */
+} ac_json_stream_t;
+
+void ac_json_stream_init(ac_json_stream_t *js);
+
+/**
+ * @brief Feed the next fragment
+ *
+ * Once ERROR is returned, further input is ignored.
+ */
+ac_json_stream_status_t ac_json_stream_feed(ac_json_stream_t *js, const char *data, size_t len);
+
+/**
+ * @brief End of input: a top-level number completes, anything open is an error
+ */
+ac_json_stream_status_t ac_json_stream_finish(ac_json_stream_t *js);
+
+/** @brief Current status without feeding */
+ac_json_stream_status_t ac_json_stream_status(const ac_json_stream_t *js);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_JSON_STREAM_H */
@@ -0,0 +1,305 @@
+/**
+ * @file json_writer.c
+ * @brief Append-only JSON writer
+ */
+
+#include "json_writer.h"
+#include "arc/platform.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Buffer
+ *============================================================================*/
+
+void ac_json_writer_init(ac_json_writer_t *w, arena_t *arena) {
+    if (!w) {
+        return;
+    }
+    memset(w, 0, sizeof(*w));
+    ac_strbuf_init_arena(&w->buf, arena);
+}
+
+void ac_json_writer_clear(ac_json_writer_t *w) {
+    if (!w) {
+        return;
+    }
+    ac_strbuf_clear(&w->buf);
+    w->has_members = 0;
+    w->depth = 0;
+    w->after_key = 0;
+    w->err = ARC_OK;
+}
+
+char *ac_json_writer_take(ac_json_writer_t *w) {
+    if (!w) {
+        return NULL;
+    }
+    if (w->err != ARC_OK || w->depth != 0 || w->after_key || w->buf.len == 0) {
+        ac_json_writer_reset(w);
+        return NULL;
+    }
+    char *json = ac_strbuf_take(&w->buf);
+    ac_json_writer_clear(w);
+    return json;
+}
+
+void ac_json_writer_reset(ac_json_writer_t *w) {
+    if (!w) {
+        return;
+    }
+    ac_strbuf_reset(&w->buf);
+    ac_json_writer_clear(w);
+}
+
+arc_err_t ac_json_writer_error(const ac_json_writer_t *w) {
+    return w ? w->err : ARC_ERR_INVALID_ARG;
+}
+
+const char *ac_json_writer_data(const ac_json_writer_t *w) {
+    return w ? ac_strbuf_tail(&w->buf, 0) : "";
+}
+
+size_t ac_json_writer_len(const ac_json_writer_t *w) {
+    return w ? w->buf.len : 0;
+}
+
+static void put(ac_json_writer_t *w, const char *s, size_t len) {
+    if (w->err == ARC_OK) {
+        w->err = ac_strbuf_append(&w->buf, s, len);
+    }
+}
+
+/**
+ * @brief Separator before a value (or a key) at the current level
+ */
+static int begin_value(ac_json_writer_t *w) {
+    if (!w || w->err != ARC_OK) {
+        return 0;
+    }
+    if (w->after_key) {
+        w->after_key = 0;
+        return 1;
+    }
+    if (w->depth > 0) {
+        uint64_t bit = (uint64_t)1 << (w->depth - 1);
+        if (w->has_members & bit) {
+            put(w, ",", 1);
+        }
+        w->has_members |= bit;
+    }
+    return w->err == ARC_OK;
+}
+
+/*============================================================================
+ * Containers
+ *============================================================================*/
+
+static void container_begin(ac_json_writer_t *w, char open) {
+    if (!begin_value(w)) {
+        return;
+    }
+    if (w->depth >= AC_JSON_WRITER_MAX_DEPTH) {
+        w->err = ARC_ERR_INVALID_ARG;
+        return;
+    }
+    put(w, &open, 1);
+    w->depth++;
+    w->has_members &= ~((uint64_t)1 << (w->depth - 1));
+}
+
+static void container_end(ac_json_writer_t *w, char close) {
+    if (!w || w->err != ARC_OK) {
+        return;
+    }
+    if (w->depth == 0 || w->after_key) {
+        w->err = ARC_ERR_INVALID_ARG;
+        return;
+    }
+    w->depth--;
+    put(w, &close, 1);
+}
+
+void ac_json_write_object_begin(ac_json_writer_t *w) {
+    container_begin(w, '{');
+}
+
+void ac_json_write_object_end(ac_json_writer_t *w) {
+    container_end(w, '}');
+}
+
+void ac_json_write_array_begin(ac_json_writer_t *w) {
+    container_begin(w, '[');
+}
+
+void ac_json_write_array_end(ac_json_writer_t *w) {
+    container_end(w, ']');
+}
+
+/*============================================================================
+ * Scalars
+ *============================================================================*/
+
+/**
+ * @brief Quoted, escaped string (cJSON's escape set)
+ */
+static void put_string(ac_json_writer_t *w, const char *s, size_t len) {
+    put(w, "\"", 1);
+
+    const char *run = s;
+    const char *end = s + len;
+    for (const char *p = s; p < end; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        /* Flush the plain run, then the escape */
+        put(w, run, (size_t)(p - run));
+        char esc[8] = { '\\', 0 };
+        size_t n = 2;
+        switch (c) {
+            case '"':  esc[1] = '"';  break;
+            case '\\': esc[1] = '\\'; break;
+            case '\b': esc[1] = 'b';  break;
+            case '\f': esc[1] = 'f';  break;
+            case '\n': esc[1] = 'n';  break;
+            case '\r': esc[1] = 'r';  break;
+            case '\t': esc[1] = 't';  break;
+            default:
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                n = 6;
+                break;
+        }
+        put(w, esc, n);
+        run = p + 1;
+    }
+    put(w, run, (size_t)(end - run));
+
+    put(w, "\"", 1);
+}
+
+void ac_json_write_key(ac_json_writer_t *w, const char *key) {
+    if (w && w->err == ARC_OK && (w->after_key || w->depth == 0)) {
+        w->err = ARC_ERR_INVALID_ARG;
+        return;
+    }
+    if (w && !key) {
+        w->err = ARC_ERR_INVALID_ARG;
+    }
+    if (!begin_value(w)) {
+        return;
+    }
+    put_string(w, key, strlen(key));
+    put(w, ":", 1);
+    w->after_key = 1;
+}
+
+void ac_json_write_string(ac_json_writer_t *w, const char *s) {
+    if (!s) {
+        ac_json_write_null(w);
+        return;
+    }
+    ac_json_write_string_len(w, s, strlen(s));
+}
+
+void ac_json_write_string_len(ac_json_writer_t *w, const char *s, size_t len) {
+    if (begin_value(w)) {
+        put_string(w, s ? s : "", s ? len : 0);
+    }
+}
+
+void ac_json_write_int(ac_json_writer_t *w, long long v) {
+    if (begin_value(w)) {
+        char num[24];
+        int n = snprintf(num, sizeof(num), "%lld", v);
+        put(w, num, (size_t)n);
+    }
+}
+
+/**
+ * @brief Equal within one ulp of the larger magnitude (cJSON's compare_double)
+ */
+static int close_enough(double a, double b) {
+    double fa = a < 0 ? -a : a;
+    double fb = b < 0 ? -b : b;
+    double diff = a - b < 0 ? b - a : a - b;
+    return diff <= (fa > fb ? fa : fb) * DBL_EPSILON;
+}
+
+void ac_json_write_double(ac_json_writer_t *w, double v) {
+    if (!begin_value(w)) {
+        return;
+    }
+
+    char num[32];
+    int n;
+    if (isnan(v) || isinf(v)) {
+        n = snprintf(num, sizeof(num), "null");
+    } else if (v >= -2147483648.0 && v <= 2147483647.0 && v == (double)(int)v) {
+        n = snprintf(num, sizeof(num), "%d", (int)v);
+    } else {
+        /* 15 digits unless they do not read back (17 always do) */
+        n = snprintf(num, sizeof(num), "%1.15g", v);
+        if (!close_enough(strtod(num, NULL), v)) {
+            n = snprintf(num, sizeof(num), "%1.17g", v);
+        }
+    }
+    put(w, num, (size_t)n);
+}
+
+void ac_json_write_bool(ac_json_writer_t *w, int v) {
+    if (begin_value(w)) {
+        put(w, v ? "true" : "false", v ? 4 : 5);
+    }
+}
+
+void ac_json_write_null(ac_json_writer_t *w) {
+    if (begin_value(w)) {
+        put(w, "null", 4);
+    }
+}
+
+void ac_json_write_raw(ac_json_writer_t *w, const char *json, size_t len) {
+    if (begin_value(w)) {
+        put(w, json, len);
+    }
+}
+
+/*============================================================================
+ * Members
+ *============================================================================*/
+
+void ac_json_write_member_string(ac_json_writer_t *w, const char *key, const char *s) {
+    if (!s) {
+        return;
+    }
+    ac_json_write_key(w, key);
+    ac_json_write_string(w, s);
+}
+
+void ac_json_write_member_str(ac_json_writer_t *w, const char *key, ac_str_t s) {
+    if (!s.ptr) {
+        return;
+    }
+    ac_json_write_key(w, key);
+    ac_json_write_string_len(w, s.ptr, s.len);
+}
+
+void ac_json_write_member_int(ac_json_writer_t *w, const char *key, long long v) {
+    ac_json_write_key(w, key);
+    ac_json_write_int(w, v);
+}
+
+void ac_json_write_member_double(ac_json_writer_t *w, const char *key, double v) {
+    ac_json_write_key(w, key);
+    ac_json_write_double(w, v);
+}
+
+void ac_json_write_member_bool(ac_json_writer_t *w, const char *key, int v) {
+    ac_json_write_key(w, key);
+    ac_json_write_bool(w, v);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file json_writer.h
+ * @brief Append-only JSON writer (internal)
+ *
+ * Serializes straight into a growable buffer instead of building a cJSON
+ * tree and printing it: no node per value, and the output is the only
+ * copy. Separators are inserted automatically; values written after
+ * ac_json_write_key() become that member's value.
+ *
+ * Errors are sticky: after the first failure (out of memory, nesting too
+ * deep, unbalanced end) every call is a no-op and ac_json_writer_take()
+ * returns NULL, so callers check once at the end.
+ *
+ * Output matches cJSON_PrintUnformatted() byte for byte for the same
+ * document.
+ */
+
+#ifndef ARC_JSON_WRITER_H
+#define ARC_JSON_WRITER_H
+
+#include "strbuf.h"
+#include "arc/arena.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Deepest object/array nesting the writer tracks */
+#define AC_JSON_WRITER_MAX_DEPTH 64
+
+typedef struct {
+    ac_strbuf_t buf;
+    uint64_t has_members;            /* Bit d: level d already has a value */
+    unsigned depth;
+    int after_key;                   /* Next value completes a member */
+    arc_err_t err;                   /* First error, sticky */
+} ac_json_writer_t;
+
+#define AC_JSON_WRITER_INIT { AC_STRBUF_INIT, 0, 0, 0, ARC_OK }
+
+/**
+ * @brief Initialize a writer
+ *
+ * @param arena Arena to grow the buffer in (NULL = heap, see strbuf.h)
+ */
+void ac_json_writer_init(ac_json_writer_t *w, arena_t *arena);
+
+/**
+ * @brief Start a new document, keeping the buffer for reuse
+ */
+void ac_json_writer_clear(ac_json_writer_t *w);
+
+/**
+ * @brief Detach the document and reset the writer
+ *
+ * @return Document (ARC_FREE unless arena-backed), NULL on any earlier
+ *         error or if the document is incomplete
+ */
+char *ac_json_writer_take(ac_json_writer_t *w);
+
+/**
+ * @brief Drop the contents (frees heap storage)
+ */
+void ac_json_writer_reset(ac_json_writer_t *w);
+
+/** @brief First error so far (ARC_OK if none) */
+arc_err_t ac_json_writer_error(const ac_json_writer_t *w);
+
+/** @brief Current document (valid until the next write) */
+const char *ac_json_writer_data(const ac_json_writer_t *w);
+
+/** @brief Current document length */
+size_t ac_json_writer_len(const ac_json_writer_t *w);
+
+/*============================================================================
+ * Values
+ *============================================================================*/
+
+void ac_json_write_object_begin(ac_json_writer_t *w);
+void ac_json_write_object_end(ac_json_writer_t *w);
+void ac_json_write_array_begin(ac_json_writer_t *w);
+void ac_json_write_array_end(ac_json_writer_t *w);
+
+/**
+ * @brief Member key inside an object
+ */
+void ac_json_write_key(ac_json_writer_t *w, const char *key);
+
+/**
+ * @brief String value, escaped (NULL writes null)
+ */
+void ac_json_write_string(ac_json_writer_t *w, const char *s);
+
+/**
+ * @brief String value of len bytes (need not be NUL-terminated)
+ */
+void ac_json_write_string_len(ac_json_writer_t *w, const char *s, size_t len);
+
+void ac_json_write_int(ac_json_writer_t *w, long long v);
+
+/**
+ * @brief Number value, formatted as cJSON does (NaN/infinity write null)
+ */
+void ac_json_write_double(ac_json_writer_t *w, double v);
+
+void ac_json_write_bool(ac_json_writer_t *w, int v);
+void ac_json_write_null(ac_json_writer_t *w);
+
+/**
+ * @brief Pre-serialized value, copied verbatim (caller guarantees validity)
+ */
+void ac_json_write_raw(ac_json_writer_t *w, const char *json, size_t len);
+
+/*============================================================================
+ * Members (key + value)
+ *============================================================================*/
+
+/**
+ * @brief String member; omitted entirely when s is NULL (as cJSON_AddStringToObject)
+ */
+void ac_json_write_member_string(ac_json_writer_t *w, const char *key, const char *s);
+
+/**
+ * @brief String member of known length (may contain NULs); omitted when s.ptr is NULL
+ */
+void ac_json_write_member_str(ac_json_writer_t *w, const char *key, ac_str_t s);
+
+void ac_json_write_member_int(ac_json_writer_t *w, const char *key, long long v);
+void ac_json_write_member_double(ac_json_writer_t *w, const char *key, double v);
+void ac_json_write_member_bool(ac_json_writer_t *w, const char *key, int v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_JSON_WRITER_H */
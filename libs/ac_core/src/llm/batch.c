@@ -0,0 +1,573 @@
+/**
+ * @file batch.c
+ * @brief Offline request batches over the providers' batch endpoints
+ *
+ * Requests are spooled to one file as they are added, cut into parts
+ * that respect the provider's per-batch limits. Each part becomes one
+ * provider batch on submit; its byte range of the spool is uploaded as
+ * is. Poll and fetch walk the parts, so a caller sees a single batch.
+ */
+
+#include "llm_internal.h"
+#include "batch.h"
+#include "message/message_json.h"
+#include "json_writer.h"
+#include "strbuf.h"
+#include "http_client.h"
+#include "arc/log.h"
+#include <string.h>
+
+/** Copy buffer between a body source and the spool */
+#define BATCH_COPY_CHUNK 65536
+
+typedef struct {
+    long offset;                 /* Part start in the spool */
+    size_t length;               /* Bytes, part_head and (once closed) part_tail included */
+    size_t count;                /* Requests */
+    int closed;                  /* part_tail written */
+    char* id;                    /* Provider batch, NULL until submitted */
+    char* results;               /* What fetch downloads, once ended */
+    ac_llm_batch_status_t status;
+} batch_part_t;
+
+struct ac_llm_batch {
+    ac_llm_t* llm;
+    const ac_llm_batch_ops_t* ops;
+    FILE* spool;                 /* NULL for an opened batch */
+    batch_part_t* parts;
+    size_t part_count;
+    size_t part_cap;
+    int sealed;                  /* Submitted (or opened): no more requests */
+    char* id;                    /* Part IDs, comma-separated */
+};
+
+/*============================================================================
+ * Upload Body
+ *============================================================================*/
+
+size_t ac_llm_batch_body_length(const ac_llm_batch_body_t* body) {
+    return (body->head ? strlen(body->head) : 0) + body->length +
+           (body->tail ? strlen(body->tail) : 0);
+}
+
+/** Copy from a string section of the body, advancing *pos */
+static size_t body_copy(const char* s, size_t start, size_t pos, char* buf, size_t size) {
+    size_t len = s ? strlen(s) : 0;
+    if (pos < start || pos >= start + len) {
+        return 0;
+    }
+    size_t n = start + len - pos;
+    if (n > size) {
+        n = size;
+    }
+    memcpy(buf, s + (pos - start), n);
+    return n;
+}
+
+size_t ac_llm_batch_body_read(char* buf, size_t size, void* user_data) {
+    ac_llm_batch_body_t* body = (ac_llm_batch_body_t*)user_data;
+    size_t head_len = body->head ? strlen(body->head) : 0;
+    size_t done = 0;
+
+    done += body_copy(body->head, 0, body->pos, buf, size);
+    body->pos += done;
+
+    if (done < size && body->pos >= head_len && body->pos < head_len + body->length) {
+        size_t at = body->pos - head_len;
+        size_t n = body->length - at;
+        if (n > size - done) {
+            n = size - done;
+        }
+        if (fseek(body->fp, body->offset + (long)at, SEEK_SET) != 0 ||
+            fread(buf + done, 1, n, body->fp) != n) {
+            return ARC_HTTP_BODY_ABORT;
+        }
+        done += n;
+        body->pos += n;
+    }
+
+    if (done < size) {
+        size_t n = body_copy(body->tail, head_len + body->length, body->pos,
+                             buf + done, size - done);
+        done += n;
+        body->pos += n;
+    }
+    return done;
+}
+
+void ac_llm_batch_body_rewind(void* user_data) {
+    ((ac_llm_batch_body_t*)user_data)->pos = 0;
+}
+
+/*============================================================================
+ * Create / Destroy
+ *============================================================================*/
+
+static arc_err_t batch_alloc(ac_llm_t* llm, ac_llm_batch_t** out) {
+    if (!llm || !llm->provider || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+    if (!llm->provider->batch) {
+        AC_LOG_ERROR("Provider %s has no batch support", llm->provider->name);
+        return ARC_ERR_NOT_IMPLEMENTED;
+    }
+
+    ac_llm_batch_t* batch = (ac_llm_batch_t*)ARC_CALLOC(1, sizeof(*batch));
+    if (!batch) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    batch->llm = llm;
+    batch->ops = llm->provider->batch;
+    *out = batch;
+    return ARC_OK;
+}
+
+static batch_part_t* part_append(ac_llm_batch_t* batch) {
+    if (batch->part_count == batch->part_cap) {
+        size_t cap = batch->part_cap ? batch->part_cap * 2 : 4;
+        batch_part_t* grown = (batch_part_t*)ARC_REALLOC(batch->parts, cap * sizeof(*grown));
+        if (!grown) {
+            return NULL;
+        }
+        batch->parts = grown;
+        batch->part_cap = cap;
+    }
+    batch_part_t* part = &batch->parts[batch->part_count++];
+    memset(part, 0, sizeof(*part));
+    return part;
+}
+
+arc_err_t ac_llm_batch_create(ac_llm_t* llm, const char* spool_path, ac_llm_batch_t** out) {
+    arc_err_t err = batch_alloc(llm, out);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    ac_llm_batch_t* batch = *out;
+    batch->spool = spool_path ? fopen(spool_path, "w+b") : tmpfile();
+    if (!batch->spool) {
+        AC_LOG_ERROR("Batch: cannot create spool %s", spool_path ? spool_path : "(temporary)");
+        ac_llm_batch_destroy(batch);
+        *out = NULL;
+        return ARC_ERR_IO;
+    }
+    return ARC_OK;
+}
+
+arc_err_t ac_llm_batch_open(ac_llm_t* llm, const char* id, ac_llm_batch_t** out) {
+    if (!id || !id[0]) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    arc_err_t err = batch_alloc(llm, out);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    ac_llm_batch_t* batch = *out;
+    batch->sealed = 1;
+    for (const char* p = id; *p;) {
+        const char* comma = strchr(p, ',');
+        size_t len = comma ? (size_t)(comma - p) : strlen(p);
+        if (len > 0) {
+            batch_part_t* part = part_append(batch);
+            if (!part || !(part->id = ARC_STRNDUP(p, len))) {
+                ac_llm_batch_destroy(batch);
+                *out = NULL;
+                return ARC_ERR_NO_MEMORY;
+            }
+            part->closed = 1;
+            part->status.state = AC_LLM_BATCH_RUNNING;
+        }
+        p += len + (comma ? 1 : 0);
+    }
+    batch->id = ARC_STRDUP(id);
+    return ARC_OK;
+}
+
+void ac_llm_batch_destroy(ac_llm_batch_t* batch) {
+    if (!batch) {
+        return;
+    }
+    if (batch->spool) {
+        fclose(batch->spool);
+    }
+    for (size_t i = 0; i < batch->part_count; i++) {
+        ARC_FREE(batch->parts[i].id);
+        ARC_FREE(batch->parts[i].results);
+    }
+    ARC_FREE(batch->parts);
+    ARC_FREE(batch->id);
+    ARC_FREE(batch);
+}
+
+const char* ac_llm_batch_id(const ac_llm_batch_t* batch) {
+    return batch ? batch->id : NULL;
+}
+
+/*============================================================================
+ * Spooling
+ *============================================================================*/
+
+static int valid_strict_id(const char* id) {
+    size_t len = 0;
+    for (const char* p = id; *p; p++, len++) {
+        char c = *p;
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '_' || c == '-')) {
+            return 0;
+        }
+    }
+    return len >= 1 && len <= 64;
+}
+
+static int spool_write(ac_llm_batch_t* batch, const char* data, size_t len) {
+    return len == 0 || fwrite(data, 1, len, batch->spool) == len;
+}
+
+static arc_err_t part_close(ac_llm_batch_t* batch, batch_part_t* part) {
+    const char* tail = batch->ops->part_tail;
+    if (!spool_write(batch, tail, strlen(tail))) {
+        return ARC_ERR_IO;
+    }
+    part->length += strlen(tail);
+    part->closed = 1;
+    return ARC_OK;
+}
+
+/**
+ * @brief Part the next item of item_len bytes goes to, opening one if needed
+ */
+static arc_err_t part_for(ac_llm_batch_t* batch, size_t item_len, batch_part_t** out) {
+    const ac_llm_batch_ops_t* ops = batch->ops;
+    size_t fixed = strlen(ops->part_head) + strlen(ops->part_tail);
+    if (fixed + item_len > ops->max_bytes) {
+        AC_LOG_ERROR("Batch: request of %zu bytes exceeds the %zu byte batch limit",
+                     item_len, ops->max_bytes);
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    batch_part_t* part = batch->part_count ? &batch->parts[batch->part_count - 1] : NULL;
+    if (part && part->count < ops->max_requests &&
+        part->length + strlen(ops->item_sep) + item_len + strlen(ops->part_tail) <= ops->max_bytes) {
+        *out = part;
+        return ARC_OK;
+    }
+
+    if (part) {
+        arc_err_t err = part_close(batch, part);
+        if (err != ARC_OK) {
+            return err;
+        }
+    }
+    part = part_append(batch);
+    if (!part) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    part->offset = ftell(batch->spool);
+    if (part->offset < 0 || !spool_write(batch, ops->part_head, strlen(ops->part_head))) {
+        return ARC_ERR_IO;
+    }
+    part->length = strlen(ops->part_head);
+    *out = part;
+    return ARC_OK;
+}
+
+arc_err_t ac_llm_batch_add(
+    ac_llm_batch_t* batch,
+    const char* custom_id,
+    const ac_message_t* messages,
+    const char* tools
+) {
+    if (!batch || !custom_id || !custom_id[0] || !messages) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (batch->sealed || !batch->spool) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    const ac_llm_batch_ops_t* ops = batch->ops;
+    if (ops->strict_ids && !valid_strict_id(custom_id)) {
+        AC_LOG_ERROR("Batch: custom_id '%s' must be 1-64 of [A-Za-z0-9_-]", custom_id);
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    const ac_llm_t* llm = batch->llm;
+    ac_llm_batch_item_t item = {0};
+    arc_err_t err = ops->item(&llm->params, messages, tools, &item);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    /* {"custom_id":<id>,<item_key><body>} */
+    ac_json_writer_t w = AC_JSON_WRITER_INIT;
+    ac_json_write_string(&w, custom_id);
+    ac_json_body_source_t* source = ac_json_body_source_create(
+        item.fields, messages, (ac_json_dialect_t)llm->provider->json_dialect,
+        item.tools, item.cache);
+    char* chunk = (char*)ARC_MALLOC(BATCH_COPY_CHUNK);
+
+    if (!source || !chunk || ac_json_writer_error(&w) != ARC_OK) {
+        err = ARC_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    size_t id_len = ac_json_writer_len(&w);
+    size_t item_len = 13 + id_len + 1 + strlen(ops->item_key) +
+                      ac_json_body_source_length(source) + 1;
+
+    batch_part_t* part = NULL;
+    err = part_for(batch, item_len, &part);
+    if (err != ARC_OK) {
+        goto done;
+    }
+
+    /* A failed write is overwritten by the next item: parts are byte ranges */
+    long mark = ftell(batch->spool);
+    const char* sep = part->count > 0 ? ops->item_sep : "";
+    int ok = mark >= 0 && spool_write(batch, sep, strlen(sep)) &&
+             spool_write(batch, "{\"custom_id\":", 13) &&
+             spool_write(batch, ac_json_writer_data(&w), id_len) &&
+             spool_write(batch, ",", 1) &&
+             spool_write(batch, ops->item_key, strlen(ops->item_key));
+    size_t n;
+    while (ok && (n = ac_json_body_source_read(chunk, BATCH_COPY_CHUNK, source)) > 0) {
+        ok = n != ARC_HTTP_BODY_ABORT && spool_write(batch, chunk, n);
+    }
+    ok = ok && spool_write(batch, "}", 1);
+    if (!ok) {
+        AC_LOG_ERROR("Batch: failed to write the spool");
+        if (mark >= 0) {
+            fseek(batch->spool, mark, SEEK_SET);
+        }
+        err = ARC_ERR_IO;
+        goto done;
+    }
+
+    part->length += strlen(sep) + item_len;
+    part->count++;
+    part->status.total = part->count;
+
+done:
+    ARC_FREE(chunk);
+    ac_json_body_source_free(source);
+    ac_json_writer_reset(&w);
+    ARC_FREE(item.fields);
+    ARC_FREE(item.tools_owned);
+    return err;
+}
+
+/*============================================================================
+ * Submit / Poll
+ *============================================================================*/
+
+/** Rebuild the comma-separated ID from the submitted parts */
+static void batch_join_ids(ac_llm_batch_t* batch) {
+    ac_strbuf_t sb = AC_STRBUF_INIT;
+    for (size_t i = 0; i < batch->part_count; i++) {
+        const char* id = batch->parts[i].id;
+        if (id) {
+            if (sb.len > 0) {
+                ac_strbuf_append(&sb, ",", 1);
+            }
+            ac_strbuf_append(&sb, id, strlen(id));
+        }
+    }
+    ARC_FREE(batch->id);
+    batch->id = ac_strbuf_take(&sb);
+}
+
+arc_err_t ac_llm_batch_submit(ac_llm_batch_t* batch) {
+    if (!batch) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (!batch->spool || batch->part_count == 0) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    ac_llm_t* llm = batch->llm;
+    batch_part_t* last = &batch->parts[batch->part_count - 1];
+    if (!last->closed) {
+        arc_err_t err = part_close(batch, last);
+        if (err != ARC_OK) {
+            return err;
+        }
+    }
+    batch->sealed = 1;
+    if (fflush(batch->spool) != 0) {
+        return ARC_ERR_IO;
+    }
+
+    arc_err_t err = ARC_OK;
+    for (size_t i = 0; i < batch->part_count && err == ARC_OK; i++) {
+        batch_part_t* part = &batch->parts[i];
+        if (part->id) {
+            continue;
+        }
+        ac_llm_batch_body_t body = {
+            .fp = batch->spool,
+            .offset = part->offset,
+            .length = part->length,
+        };
+        err = batch->ops->submit(llm->priv, &llm->params, &body, &part->id);
+        if (err == ARC_OK) {
+            part->status.state = AC_LLM_BATCH_RUNNING;
+            AC_LOG_INFO("Batch: submitted %s (%zu requests)", part->id, part->count);
+        } else {
+            AC_LOG_ERROR("Batch: submitting part %zu of %zu failed: %d",
+                         i + 1, batch->part_count, err);
+        }
+    }
+
+    batch_join_ids(batch);
+    return err;
+}
+
+arc_err_t ac_llm_batch_poll(ac_llm_batch_t* batch, ac_llm_batch_status_t* status) {
+    if (!batch || !status) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    memset(status, 0, sizeof(*status));
+
+    ac_llm_t* llm = batch->llm;
+    size_t running = 0;
+    size_t failed_parts = 0;
+    size_t submitted = 0;
+
+    for (size_t i = 0; i < batch->part_count; i++) {
+        batch_part_t* part = &batch->parts[i];
+        if (part->id && part->status.state == AC_LLM_BATCH_RUNNING) {
+            ac_llm_batch_status_t st = {0};
+            char* results = NULL;
+            arc_err_t err = batch->ops->poll(llm->priv, &llm->params, part->id, &st, &results);
+            if (err != ARC_OK) {
+                return err;
+            }
+            part->status = st;
+            ARC_FREE(part->results);
+            part->results = results;
+        }
+
+        status->total += part->status.total;
+        status->succeeded += part->status.succeeded;
+        status->failed += part->status.failed;
+        if (part->id) {
+            submitted++;
+            running += part->status.state == AC_LLM_BATCH_RUNNING;
+            failed_parts += part->status.state == AC_LLM_BATCH_FAILED;
+        }
+    }
+
+    if (submitted == 0 || submitted < batch->part_count) {
+        status->state = submitted == 0 ? AC_LLM_BATCH_OPEN : AC_LLM_BATCH_RUNNING;
+    } else if (running > 0) {
+        status->state = AC_LLM_BATCH_RUNNING;
+    } else {
+        status->state = failed_parts == submitted ? AC_LLM_BATCH_FAILED : AC_LLM_BATCH_ENDED;
+    }
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Fetch
+ *============================================================================*/
+
+typedef struct {
+    const ac_llm_t* llm;
+    const ac_llm_batch_ops_t* ops;
+    ac_llm_batch_result_fn on_result;
+    void* user_data;
+    ac_strbuf_t pending;         /* Line split across chunks */
+    int stopped;                 /* on_result asked to stop */
+} fetch_ctx_t;
+
+static void fetch_line(fetch_ctx_t* ctx, const char* line, size_t len) {
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ')) {
+        len--;
+    }
+    if (len == 0 || ctx->stopped) {
+        return;
+    }
+
+    ac_chat_response_t response;
+    ac_chat_response_init(&response);
+    char* custom_id = NULL;
+    arc_err_t err = ctx->ops->parse(line, len, &custom_id, &response);
+    if (err == ARC_OK) {
+        ac_llm_format_finish(ctx->llm, &response, NULL);
+    }
+    if (custom_id) {
+        if (ctx->on_result(custom_id, err, &response, ctx->user_data) != 0) {
+            ctx->stopped = 1;
+        }
+    } else {
+        AC_LOG_WARN("Batch: skipping unreadable result line (%zu bytes)", len);
+    }
+    ARC_FREE(custom_id);
+    ac_chat_response_free(&response);
+}
+
+static int fetch_data(const char* data, size_t len, void* user_data) {
+    fetch_ctx_t* ctx = (fetch_ctx_t*)user_data;
+    const char* end = data + len;
+
+    while (data < end && !ctx->stopped) {
+        const char* nl = (const char*)memchr(data, '\n', (size_t)(end - data));
+        if (!nl) {
+            if (ac_strbuf_append(&ctx->pending, data, (size_t)(end - data)) != ARC_OK) {
+                return 1;
+            }
+            break;
+        }
+        if (ctx->pending.len > 0) {
+            if (ac_strbuf_append(&ctx->pending, data, (size_t)(nl - data)) != ARC_OK) {
+                return 1;
+            }
+            fetch_line(ctx, ctx->pending.data, ctx->pending.len);
+            ac_strbuf_clear(&ctx->pending);
+        } else {
+            fetch_line(ctx, data, (size_t)(nl - data));
+        }
+        data = nl + 1;
+    }
+    return ctx->stopped;
+}
+
+arc_err_t ac_llm_batch_fetch(
+    ac_llm_batch_t* batch,
+    ac_llm_batch_result_fn on_result,
+    void* user_data
+) {
+    if (!batch || !on_result) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < batch->part_count; i++) {
+        ac_llm_batch_state_t state = batch->parts[i].status.state;
+        if (state != AC_LLM_BATCH_ENDED && state != AC_LLM_BATCH_FAILED) {
+            return ARC_ERR_INVALID_STATE;
+        }
+    }
+
+    ac_llm_t* llm = batch->llm;
+    fetch_ctx_t ctx = { batch->llm, batch->ops, on_result, user_data, AC_STRBUF_INIT, 0 };
+    arc_err_t err = ARC_OK;
+
+    for (size_t i = 0; i < batch->part_count && !ctx.stopped; i++) {
+        const batch_part_t* part = &batch->parts[i];
+        if (!part->results) {
+            continue;
+        }
+        err = batch->ops->fetch(llm->priv, &llm->params, part->results, fetch_data, &ctx);
+        if (ctx.pending.len > 0) {
+            fetch_line(&ctx, ctx.pending.data, ctx.pending.len);
+            ac_strbuf_clear(&ctx.pending);
+        }
+        if (err != ARC_OK && !ctx.stopped) {
+            break;
+        }
+        err = ARC_OK;
+    }
+
+    ac_strbuf_reset(&ctx.pending);
+    return err;
+}
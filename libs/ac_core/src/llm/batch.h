@@ -0,0 +1,95 @@
+/**
+ * @file batch.h
+ * @brief Provider batch interface (internal)
+ *
+ * batch.c owns the spool and the bookkeeping: it writes each request as
+ * part_head, items separated by item_sep, part_tail, with every item
+ * framed as {"custom_id":<id>,<item_key><body>}. Providers describe the
+ * body of one request and speak their batch endpoints.
+ */
+
+#ifndef ARC_LLM_BATCH_H
+#define ARC_LLM_BATCH_H
+
+#include "arc/llm.h"
+#include "http_client.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Body pieces of one request, as for the provider's chat call
+ */
+typedef struct {
+    char* fields;                /**< Top-level fields object, no "stream" (ARC_FREE) */
+    const char* tools;           /**< Tools array to splice (NULL = none) */
+    char* tools_owned;           /**< Converted tools backing .tools (ARC_FREE) */
+    unsigned cache;              /**< AC_JSON_CACHE_* breakpoints */
+} ac_llm_batch_item_t;
+
+/**
+ * @brief One spooled part as an upload body: head, file range, tail
+ *
+ * Read with ac_llm_batch_body_read/_rewind as arc_http_request_t.body_read.
+ */
+typedef struct {
+    FILE* fp;
+    long offset;                 /**< Part start in the spool */
+    size_t length;               /**< Part bytes */
+    const char* head;            /**< Sent first (e.g. multipart framing, may be NULL) */
+    const char* tail;            /**< Sent last (may be NULL) */
+    size_t pos;                  /**< Bytes read so far */
+} ac_llm_batch_body_t;
+
+size_t ac_llm_batch_body_length(const ac_llm_batch_body_t* body);
+size_t ac_llm_batch_body_read(char* buf, size_t size, void* body);
+void ac_llm_batch_body_rewind(void* body);
+
+/**
+ * @brief Batch support of a provider (ac_llm_ops_t.batch)
+ */
+typedef struct ac_llm_batch_ops {
+    size_t max_requests;         /**< Requests per provider batch */
+    size_t max_bytes;            /**< Spooled bytes per provider batch */
+    int strict_ids;              /**< custom_id must be 1-64 of [A-Za-z0-9_-] */
+    const char* part_head;       /**< Before the first item */
+    const char* item_sep;        /**< Between items */
+    const char* part_tail;       /**< After the last item */
+    const char* item_key;        /**< Members between custom_id and the body */
+
+    /** Body pieces of one request (ac_llm_batch_item_t freed by the caller) */
+    arc_err_t (*item)(const ac_llm_params_t* params, const ac_message_t* messages,
+                      const char* tools, ac_llm_batch_item_t* out);
+
+    /** Upload one part and create its provider batch (*id: ARC_FREE) */
+    arc_err_t (*submit)(void* priv, const ac_llm_params_t* params,
+                        ac_llm_batch_body_t* body, char** id);
+
+    /**
+     * Status of one provider batch; once ended, *results names what
+     * fetch downloads (ARC_FREE, NULL if there is nothing)
+     */
+    arc_err_t (*poll)(void* priv, const ac_llm_params_t* params, const char* id,
+                      ac_llm_batch_status_t* status, char** results);
+
+    /** Download results (as named by poll), passing the raw bytes on */
+    arc_err_t (*fetch)(void* priv, const ac_llm_params_t* params, const char* results,
+                       arc_stream_callback_t on_data, void* user_data);
+
+    /**
+     * Parse one results line
+     *
+     * @return The request's outcome (ARC_OK, ARC_ERR_HTTP, ARC_ERR_BACKEND),
+     *         ARC_ERR_PARSE if the line is not a result (*custom_id NULL)
+     */
+    arc_err_t (*parse)(const char* line, size_t len, char** custom_id,
+                       ac_chat_response_t* response);
+} ac_llm_batch_ops_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_LLM_BATCH_H */
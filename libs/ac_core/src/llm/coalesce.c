@@ -0,0 +1,411 @@
+/**
+ * @file coalesce.c
+ * @brief Single-flight coalescing of identical concurrent LLM calls
+ *
+ * A flight is one upstream call, keyed like the response cache
+ * (ac_llm_request_key). The first caller leads: it makes the call and
+ * publishes what it gets. Callers arriving with the same key while the
+ * call runs follow: they are handed the leader's stream events as they
+ * arrive (a late follower catches up from the start) and, once the call
+ * completes, a copy of its response or its error. The flight leaves the
+ * table when the call completes, so the next identical request goes
+ * upstream again.
+ */
+
+#include "llm_internal.h"
+#include "message/message_json.h"
+#include "json_writer.h"
+#include "arc/log.h"
+#include "pthread_port.h"
+#include <string.h>
+
+#ifdef ARC_HAS_THREADS
+#include <time.h>
+#endif
+
+/** Longest wait between checks of a follower's cancel flag */
+#define FLIGHT_SLICE_MS 50
+
+#ifdef ARC_HAS_THREADS
+
+/*============================================================================
+ * Flights
+ *============================================================================*/
+
+struct ac_llm_flight {
+    ac_llm_cache_key_t key;
+    int streaming;               /* Leader streams: events are published live */
+    int refs;                    /* Leader + attached followers */
+    int followers;               /* Followers still taking events */
+    int done;
+    int cut;                     /* Leader aborted alone: stream stopped short */
+
+    /* Stream events, copied with their strings (one allocation each) */
+    ac_stream_event_t** events;
+    size_t event_count;
+    size_t event_cap;
+
+    /* Result, valid once done */
+    arc_err_t err;
+    int http_status;
+    uint32_t retry_after_ms;
+    char* record;                /* ac_chat_response_to_record(), NULL on error */
+    size_t record_len;
+
+    pthread_cond_t cond;         /* Signalled on each event and on completion */
+    struct ac_llm_flight* next;
+};
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static ac_llm_flight_t* s_flights = NULL;
+
+static void flight_unlink(ac_llm_flight_t* f) {
+    for (ac_llm_flight_t** link = &s_flights; *link; link = &(*link)->next) {
+        if (*link == f) {
+            *link = f->next;
+            f->next = NULL;
+            return;
+        }
+    }
+}
+
+static void flight_free(ac_llm_flight_t* f) {
+    for (size_t i = 0; i < f->event_count; i++) {
+        ARC_FREE(f->events[i]);
+    }
+    ARC_FREE(f->events);
+    ARC_FREE(f->record);
+    pthread_cond_destroy(&f->cond);
+    ARC_FREE(f);
+}
+
+/** Drop one reference (lock held); the last one frees */
+static void flight_release(ac_llm_flight_t* f) {
+    if (--f->refs == 0) {
+        flight_free(f);
+    }
+}
+
+static void timespec_after(struct timespec* ts, uint32_t ms) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t ns = (uint64_t)now.tv_nsec + (uint64_t)ms * 1000000;
+    ts->tv_sec = now.tv_sec + ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
+/*============================================================================
+ * Event Log
+ *============================================================================*/
+
+static size_t opt_len(const char* s) {
+    return s ? strlen(s) + 1 : 0;
+}
+
+static const char* opt_copy(char** cursor, const char* s, size_t len) {
+    if (!s) {
+        return NULL;
+    }
+    char* out = *cursor;
+    memcpy(out, s, len);
+    *cursor += len;
+    return out;
+}
+
+/**
+ * @brief Copy an event and its strings into one heap block
+ */
+static ac_stream_event_t* event_copy(const ac_stream_event_t* ev) {
+    size_t delta_len = ev->delta ? ev->delta_len : 0;
+    size_t sizes[6] = {
+        opt_len(ev->tool_id), opt_len(ev->tool_name), opt_len(ev->tool_input),
+        opt_len(ev->stop_reason), opt_len(ev->error_type), opt_len(ev->error_msg)
+    };
+    size_t total = sizeof(ac_stream_event_t) + (ev->delta ? delta_len + 1 : 0);
+    for (int i = 0; i < 6; i++) {
+        total += sizes[i];
+    }
+
+    ac_stream_event_t* copy = (ac_stream_event_t*)ARC_MALLOC(total);
+    if (!copy) {
+        return NULL;
+    }
+    *copy = *ev;
+
+    char* cursor = (char*)(copy + 1);
+    if (ev->delta) {
+        memcpy(cursor, ev->delta, delta_len);
+        cursor[delta_len] = '\0';
+        copy->delta = cursor;
+        cursor += delta_len + 1;
+    }
+    copy->tool_id = opt_copy(&cursor, ev->tool_id, sizes[0]);
+    copy->tool_name = opt_copy(&cursor, ev->tool_name, sizes[1]);
+    copy->tool_input = opt_copy(&cursor, ev->tool_input, sizes[2]);
+    copy->stop_reason = opt_copy(&cursor, ev->stop_reason, sizes[3]);
+    copy->error_type = opt_copy(&cursor, ev->error_type, sizes[4]);
+    copy->error_msg = opt_copy(&cursor, ev->error_msg, sizes[5]);
+    return copy;
+}
+
+/** Append an event for the followers (lock held); a copy failure cuts them off */
+static int flight_publish(ac_llm_flight_t* f, const ac_stream_event_t* ev) {
+    if (f->event_count == f->event_cap) {
+        size_t cap = f->event_cap ? f->event_cap * 2 : 64;
+        ac_stream_event_t** grown = (ac_stream_event_t**)ARC_REALLOC(
+            f->events, cap * sizeof(*grown));
+        if (!grown) {
+            return 0;
+        }
+        f->events = grown;
+        f->event_cap = cap;
+    }
+    ac_stream_event_t* copy = event_copy(ev);
+    if (!copy) {
+        return 0;
+    }
+    f->events[f->event_count++] = copy;
+    pthread_cond_broadcast(&f->cond);
+    return 1;
+}
+
+/*============================================================================
+ * Leader
+ *============================================================================*/
+
+int ac_llm_flight_tap(const ac_stream_event_t* event, void* user_data) {
+    ac_llm_flight_tap_t* tap = (ac_llm_flight_tap_t*)user_data;
+    ac_llm_flight_t* f = tap->flight;
+
+    if (!tap->detached && tap->callback(event, tap->user_data) != 0) {
+        tap->detached = 1;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    int ok = flight_publish(f, event);
+    if (!ok) {
+        /* Followers cannot get a complete stream any more: let them rerun */
+        AC_LOG_WARN("LLM coalescing: out of memory, detaching followers");
+        f->cut = 1;
+        flight_unlink(f);
+        pthread_cond_broadcast(&f->cond);
+    }
+
+    /* A leader that stopped listening keeps the call going for followers */
+    int stop = 0;
+    if (tap->detached && (f->followers == 0 || f->cut)) {
+        f->cut = 1;
+        flight_unlink(f);
+        stop = 1;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return stop;
+}
+
+void ac_llm_flight_finish(ac_llm_flight_t* flight, arc_err_t err,
+                          const ac_chat_response_t* response) {
+    if (!flight) {
+        return;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    flight_unlink(flight);
+    int waiting = flight->refs > 1;
+    pthread_mutex_unlock(&s_lock);
+
+    /* No new follower can join now; serialize only for the ones attached */
+    char* record = NULL;
+    size_t len = 0;
+    if (waiting && err == ARC_OK && response) {
+        ac_json_writer_t w = AC_JSON_WRITER_INIT;
+        if (ac_chat_response_to_record(&w, response) == ARC_OK) {
+            len = ac_json_writer_len(&w);
+            record = ac_json_writer_take(&w);
+        } else {
+            ac_json_writer_reset(&w);
+        }
+    }
+
+    pthread_mutex_lock(&s_lock);
+    flight->err = err;
+    flight->http_status = response ? response->http_status : 0;
+    flight->retry_after_ms = response ? response->retry_after_ms : 0;
+    flight->record = record;
+    flight->record_len = len;
+    flight->done = 1;
+    pthread_cond_broadcast(&flight->cond);
+    flight_release(flight);
+    pthread_mutex_unlock(&s_lock);
+}
+
+/*============================================================================
+ * Followers
+ *============================================================================*/
+
+/**
+ * @brief Take events and the result of f (lock held on entry and exit)
+ *
+ * @return 1 when served; 0 when the caller should make its own call
+ */
+static int flight_follow(ac_llm_flight_t* f, const volatile int* cancel,
+                         ac_stream_callback_t callback, void* user_data,
+                         ac_chat_response_t* response, arc_err_t* err) {
+    size_t next = 0;
+    int delivered = 0;
+    int listening = callback != NULL && f->streaming;
+
+    for (;;) {
+        while (listening && next < f->event_count) {
+            const ac_stream_event_t* ev = f->events[next++];
+            pthread_mutex_unlock(&s_lock);
+            delivered = 1;
+            int rc = callback(ev, user_data);
+            pthread_mutex_lock(&s_lock);
+            if (rc != 0) {
+                /* Aborted like a stream of its own: partial, but OK */
+                f->followers--;
+                *err = ARC_OK;
+                return 1;
+            }
+        }
+        if (f->done || f->cut) {
+            break;
+        }
+        if (cancel && *cancel) {
+            f->followers--;
+            *err = ARC_ERR_CANCELLED;
+            return 1;
+        }
+        struct timespec deadline;
+        timespec_after(&deadline, FLIGHT_SLICE_MS);
+        pthread_cond_timedwait(&f->cond, &s_lock, &deadline);
+    }
+    f->followers--;
+
+    /* The leader gave up or lost the events before this caller saw any: rerun */
+    if (!delivered && (f->cut || f->err == ARC_ERR_CANCELLED ||
+                       (f->err == ARC_OK && !f->record))) {
+        return 0;
+    }
+    if (f->cut) {
+        *err = ARC_ERR_CANCELLED;
+        return 1;
+    }
+
+    *err = f->err;
+    if (f->err != ARC_OK) {
+        if (response) {
+            response->http_status = f->http_status;
+            response->retry_after_ms = f->retry_after_ms;
+        }
+        return 1;
+    }
+
+    /* Parsing and replay run unlocked: the record lives until the last release */
+    pthread_mutex_unlock(&s_lock);
+    ac_chat_response_t local;
+    ac_chat_response_t* out = response;
+    if (!out) {
+        ac_chat_response_init(&local);
+        out = &local;
+    }
+    *err = ac_chat_response_parse_record(f->record, f->record_len, out);
+    if (*err == ARC_OK && callback && !f->streaming) {
+        *err = ac_llm_cache_replay(out, callback, user_data);
+    }
+    if (out == &local) {
+        ac_chat_response_free(&local);
+    }
+    pthread_mutex_lock(&s_lock);
+    return 1;
+}
+
+int ac_llm_flight_enter(
+    const ac_llm_cache_key_t* key,
+    int streaming,
+    const volatile int* cancel,
+    ac_stream_callback_t callback,
+    void* user_data,
+    ac_chat_response_t* response,
+    ac_llm_flight_t** flight,
+    arc_err_t* err
+) {
+    *flight = NULL;
+
+    pthread_mutex_lock(&s_lock);
+    for (;;) {
+        ac_llm_flight_t* f = s_flights;
+        while (f && !(f->key.h1 == key->h1 && f->key.h2 == key->h2)) {
+            f = f->next;
+        }
+
+        if (!f) {
+            f = (ac_llm_flight_t*)ARC_CALLOC(1, sizeof(*f));
+            if (!f || pthread_cond_init(&f->cond, NULL) != 0) {
+                ARC_FREE(f);
+                break;
+            }
+            f->key = *key;
+            f->streaming = streaming;
+            f->refs = 1;
+            f->next = s_flights;
+            s_flights = f;
+            *flight = f;
+            break;
+        }
+
+        AC_LOG_DEBUG("LLM coalescing: joining in-flight request %016llx",
+                     (unsigned long long)key->h1);
+        f->refs++;
+        f->followers++;
+        int served = flight_follow(f, cancel, callback, user_data, response, err);
+        flight_release(f);
+        if (served) {
+            pthread_mutex_unlock(&s_lock);
+            return 1;
+        }
+        /* Try again: join whoever reran first, or lead */
+    }
+    pthread_mutex_unlock(&s_lock);
+    return 0;
+}
+
+#else /* !ARC_HAS_THREADS */
+
+/* One call at a time: nothing to coalesce */
+
+int ac_llm_flight_tap(const ac_stream_event_t* event, void* user_data) {
+    ac_llm_flight_tap_t* tap = (ac_llm_flight_tap_t*)user_data;
+    return tap->callback(event, tap->user_data);
+}
+
+void ac_llm_flight_finish(ac_llm_flight_t* flight, arc_err_t err,
+                          const ac_chat_response_t* response) {
+    (void)flight;
+    (void)err;
+    (void)response;
+}
+
+int ac_llm_flight_enter(
+    const ac_llm_cache_key_t* key,
+    int streaming,
+    const volatile int* cancel,
+    ac_stream_callback_t callback,
+    void* user_data,
+    ac_chat_response_t* response,
+    ac_llm_flight_t** flight,
+    arc_err_t* err
+) {
+    (void)key;
+    (void)streaming;
+    (void)cancel;
+    (void)callback;
+    (void)user_data;
+    (void)response;
+    (void)err;
+    *flight = NULL;
+    return 0;
+}
+
+#endif /* ARC_HAS_THREADS */
@@ -0,0 +1,285 @@
+/**
+ * @file embed.c
+ * @brief Embeddings with requests shared across concurrent callers
+ *
+ * Each ac_llm_embed() call queues a job on its client. A caller that
+ * finds unsent inputs and a free request slot becomes a sender: it takes
+ * up to max_batch unsent inputs across the queued jobs, oldest first,
+ * makes the provider request without the lock and copies the vectors
+ * back into the jobs they came from. The others sleep until their own
+ * inputs are settled, so a burst of small calls from many threads goes
+ * out as a few full requests.
+ */
+
+#include "llm_internal.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include <string.h>
+
+#ifdef ARC_HAS_THREADS
+#include <time.h>
+#endif
+
+/** Input bytes per request: well under the providers' token limits */
+#define EMBED_MAX_BATCH_BYTES (1024 * 1024)
+
+typedef struct ac_llm_embed_job {
+    const char* const* inputs;
+    size_t count;
+    size_t taken;                /* Inputs handed to a sender */
+    size_t settled;              /* Inputs whose request ended (or that an error dropped) */
+    float* vectors;              /* count rows, allocated when the first ones arrive */
+    size_t dims;
+    arc_err_t err;
+    struct ac_llm_embed_job* next;
+} embed_job_t;
+
+/** The inputs of one job in a request */
+typedef struct {
+    embed_job_t* job;
+    size_t first;
+    size_t n;
+} embed_slice_t;
+
+#ifdef ARC_HAS_THREADS
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+/*============================================================================
+ * Queue (lock held)
+ *============================================================================*/
+
+static size_t embed_unsent(const ac_llm_t* llm) {
+    size_t n = 0;
+    for (const embed_job_t* job = llm->embed_jobs; job; job = job->next) {
+        n += job->count - job->taken;
+    }
+    return n;
+}
+
+/**
+ * @brief Take the next request's inputs, oldest jobs first
+ *
+ * @param batch   Receives up to max_batch inputs
+ * @param slices  Receives where they came from (max_batch entries)
+ * @return Inputs taken
+ */
+static size_t embed_take(ac_llm_t* llm, size_t max_batch, const char** batch,
+                         embed_slice_t* slices, size_t* slice_count) {
+    size_t n = 0;
+    size_t bytes = 0;
+    *slice_count = 0;
+
+    for (embed_job_t* job = llm->embed_jobs; job && n < max_batch; job = job->next) {
+        embed_slice_t* slice = NULL;
+        while (job->taken < job->count && n < max_batch) {
+            size_t len = strlen(job->inputs[job->taken]);
+            if (n > 0 && bytes + len > EMBED_MAX_BATCH_BYTES) {
+                return n;
+            }
+            if (!slice) {
+                slice = &slices[(*slice_count)++];
+                slice->job = job;
+                slice->first = job->taken;
+                slice->n = 0;
+            }
+            batch[n++] = job->inputs[job->taken++];
+            slice->n++;
+            bytes += len;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Hand a finished request's vectors (or error) to its jobs
+ */
+static void embed_settle(const embed_slice_t* slices, size_t slice_count, arc_err_t err,
+                         const ac_llm_embed_result_t* result) {
+    size_t row = 0;
+    for (size_t i = 0; i < slice_count; i++) {
+        embed_job_t* job = slices[i].job;
+        size_t n = slices[i].n;
+
+        if (err != ARC_OK) {
+            if (job->err == ARC_OK) {
+                job->err = err;
+            }
+        } else if (job->err == ARC_OK) {
+            if (!job->vectors) {
+                job->dims = result->dims;
+                job->vectors = ARC_MALLOC(job->count * job->dims * sizeof(float));
+                if (!job->vectors) {
+                    job->err = ARC_ERR_NO_MEMORY;
+                }
+            } else if (job->dims != result->dims) {
+                AC_LOG_ERROR("Embeddings changed size within a call: %zu, then %zu",
+                             job->dims, result->dims);
+                job->err = ARC_ERR_PROTOCOL;
+            }
+            if (job->err == ARC_OK) {
+                memcpy(job->vectors + slices[i].first * job->dims,
+                       result->vectors + row * result->dims, n * result->dims * sizeof(float));
+            }
+        }
+        row += n;
+        job->settled += n;
+
+        /* A failed job sends nothing more */
+        if (job->err != ARC_OK) {
+            job->settled += job->count - job->taken;
+            job->taken = job->count;
+        }
+    }
+}
+
+static void embed_unlink(ac_llm_t* llm, embed_job_t* job) {
+    for (embed_job_t** link = &llm->embed_jobs; *link; link = &(*link)->next) {
+        if (*link == job) {
+            *link = job->next;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Take, send and settle one request (called and returns with the lock held)
+ */
+static void embed_send(ac_llm_t* llm, size_t max_batch, const char** batch,
+                       embed_slice_t* slices) {
+    size_t slice_count = 0;
+    size_t n = embed_take(llm, max_batch, batch, slices, &slice_count);
+    if (n == 0) {
+        return;
+    }
+
+#ifdef ARC_HAS_THREADS
+    pthread_cond_broadcast(&s_cond);     /* Others may take what is left */
+    pthread_mutex_unlock(&s_lock);
+#endif
+    ac_llm_embed_result_t result = {0};
+    arc_err_t err = ac_llm_retry_embed(llm, batch, n, &result);
+#ifdef ARC_HAS_THREADS
+    pthread_mutex_lock(&s_lock);
+#endif
+
+    embed_settle(slices, slice_count, err, &result);
+    ARC_FREE(result.vectors);
+}
+
+#ifdef ARC_HAS_THREADS
+static void timespec_after(struct timespec* ts, uint32_t ms) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t ns = (uint64_t)now.tv_nsec + (uint64_t)ms * 1000000;
+    ts->tv_sec = now.tv_sec + ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+#endif
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t ac_llm_embed(ac_llm_t* llm, const char* const* inputs, size_t count,
+                       ac_embeddings_t* out) {
+    if (!llm || !out || (count > 0 && !inputs)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+    if (!llm->provider->embed) {
+        AC_LOG_ERROR("Provider %s has no embeddings", llm->provider->name);
+        return ARC_ERR_NOT_IMPLEMENTED;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!inputs[i] || !inputs[i][0]) {
+            AC_LOG_ERROR("Embedding input %zu is empty", i);
+            return ARC_ERR_INVALID_ARG;
+        }
+    }
+    if (count == 0) {
+        return ARC_OK;
+    }
+
+    size_t max_batch = llm->params.embed.max_batch > 0 ? (size_t)llm->params.embed.max_batch
+                                                       : AC_LLM_EMBED_DEFAULT_BATCH;
+    const char** batch = ARC_MALLOC(max_batch * sizeof(*batch));
+    embed_slice_t* slices = ARC_MALLOC(max_batch * sizeof(*slices));
+    if (!batch || !slices) {
+        ARC_FREE(batch);
+        ARC_FREE(slices);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    embed_job_t job = { .inputs = inputs, .count = count };
+
+#ifdef ARC_HAS_THREADS
+    int max_senders = llm->provider->reentrant && llm->provider->reentrant(llm->priv)
+        ? AC_LLM_EMBED_MAX_INFLIGHT : 1;
+    uint32_t linger_ms = llm->params.embed.linger_ms;
+
+    pthread_mutex_lock(&s_lock);
+    embed_job_t** tail = &llm->embed_jobs;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = &job;
+    pthread_cond_broadcast(&s_cond);     /* A lingering sender may now fill up */
+
+    while (job.settled < job.count) {
+        if (llm->embed_lingering || llm->embed_senders >= max_senders ||
+            embed_unsent(llm) == 0) {
+            pthread_cond_wait(&s_cond, &s_lock);
+            continue;
+        }
+
+        llm->embed_senders++;
+        if (linger_ms > 0 && embed_unsent(llm) < max_batch) {
+            struct timespec until;
+            timespec_after(&until, linger_ms);
+            llm->embed_lingering = 1;
+            while (embed_unsent(llm) < max_batch) {
+                if (pthread_cond_timedwait(&s_cond, &s_lock, &until) != 0) {
+                    break;
+                }
+            }
+            llm->embed_lingering = 0;
+        }
+        embed_send(llm, max_batch, batch, slices);
+        llm->embed_senders--;
+        pthread_cond_broadcast(&s_cond);
+    }
+
+    embed_unlink(llm, &job);
+    pthread_mutex_unlock(&s_lock);
+#else
+    llm->embed_jobs = &job;
+    while (job.settled < job.count) {
+        embed_send(llm, max_batch, batch, slices);
+    }
+    embed_unlink(llm, &job);
+#endif
+
+    ARC_FREE(batch);
+    ARC_FREE(slices);
+
+    if (job.err != ARC_OK) {
+        ARC_FREE(job.vectors);
+        return job.err;
+    }
+    out->vectors = job.vectors;
+    out->count = count;
+    out->dims = job.dims;
+    return ARC_OK;
+}
+
+void ac_embeddings_free(ac_embeddings_t* embeddings) {
+    if (!embeddings) {
+        return;
+    }
+    ARC_FREE(embeddings->vectors);
+    memset(embeddings, 0, sizeof(*embeddings));
+}
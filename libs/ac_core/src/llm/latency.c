@@ -0,0 +1,168 @@
+/**
+ * @file latency.c
+ * @brief Rolling per-model latency histograms
+ *
+ * Each model keeps two windows of AC_LLM_LATENCY_WINDOW_MS: the one being
+ * filled and the one before it. A read sums both, so it always covers
+ * between one and two windows of recent calls and old outliers age out.
+ */
+
+#include "latency.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include <string.h>
+
+/** Distinct models tracked; calls to further models are not recorded */
+#define LATENCY_MAX_MODELS   32
+
+/** Longest model name kept */
+#define LATENCY_MODEL_MAX    64
+
+typedef struct {
+    char model[LATENCY_MODEL_MAX];
+    uint64_t window_start;           /* Start of cur (ms) */
+    ac_llm_latency_stats_t cur;
+    ac_llm_latency_stats_t prev;
+} latency_entry_t;
+
+static latency_entry_t s_entries[LATENCY_MAX_MODELS];
+static int s_entry_count = 0;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int ac_llm_latency_bucket(uint32_t ms) {
+    int b = 0;
+    while (ms > 0 && b < AC_LLM_LATENCY_BUCKETS - 1) {
+        ms >>= 1;
+        b++;
+    }
+    return b;
+}
+
+/**
+ * @brief Entry of model (created if create), with windows rotated to now; lock held
+ */
+static latency_entry_t* entry_get(const char* model, int create, uint64_t now) {
+    latency_entry_t* e = NULL;
+    for (int i = 0; i < s_entry_count; i++) {
+        if (strncmp(s_entries[i].model, model, LATENCY_MODEL_MAX - 1) == 0) {
+            e = &s_entries[i];
+            break;
+        }
+    }
+    if (!e) {
+        if (!create || s_entry_count >= LATENCY_MAX_MODELS) {
+            return NULL;
+        }
+        e = &s_entries[s_entry_count++];
+        memset(e, 0, sizeof(*e));
+        strncpy(e->model, model, LATENCY_MODEL_MAX - 1);
+        e->window_start = now;
+    }
+
+    uint64_t elapsed = now - e->window_start;
+    if (elapsed >= 2 * (uint64_t)AC_LLM_LATENCY_WINDOW_MS) {
+        memset(&e->prev, 0, sizeof(e->prev));
+        memset(&e->cur, 0, sizeof(e->cur));
+        e->window_start = now;
+    } else if (elapsed >= AC_LLM_LATENCY_WINDOW_MS) {
+        e->prev = e->cur;
+        memset(&e->cur, 0, sizeof(e->cur));
+        e->window_start += AC_LLM_LATENCY_WINDOW_MS;
+    }
+    return e;
+}
+
+void ac_llm_latency_record(
+    const char* model,
+    const ac_llm_timing_t* timing,
+    uint32_t duration_ms,
+    int output_tokens,
+    const uint64_t* gaps
+) {
+    if (!model || !model[0] || !timing) {
+        return;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    latency_entry_t* e = entry_get(model, 1, ac_platform_timestamp_ms());
+    if (e) {
+        ac_llm_latency_stats_t* s = &e->cur;
+        s->calls++;
+        s->duration[ac_llm_latency_bucket(duration_ms)]++;
+        if (timing->ttfb_ms) {
+            s->ttfb[ac_llm_latency_bucket(timing->ttfb_ms)]++;
+        }
+        if (gaps) {
+            s->streamed++;
+            if (timing->deltas) {
+                s->first_token[ac_llm_latency_bucket(timing->first_token_ms)]++;
+            }
+            for (int i = 0; i < AC_LLM_LATENCY_BUCKETS; i++) {
+                s->gap[i] += gaps[i];
+            }
+            if (output_tokens > 0 && timing->stream_ms) {
+                s->output_tokens += (uint64_t)output_tokens;
+                s->stream_ms += timing->stream_ms;
+            }
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+arc_err_t ac_llm_latency_get(const char* model, ac_llm_latency_stats_t* stats) {
+    if (!model || !stats) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    pthread_mutex_lock(&s_lock);
+    latency_entry_t* e = entry_get(model, 0, ac_platform_timestamp_ms());
+    if (!e) {
+        pthread_mutex_unlock(&s_lock);
+        return ARC_ERR_NOT_FOUND;
+    }
+    const ac_llm_latency_stats_t* w[2] = { &e->prev, &e->cur };
+    for (int k = 0; k < 2; k++) {
+        stats->calls += w[k]->calls;
+        stats->streamed += w[k]->streamed;
+        stats->output_tokens += w[k]->output_tokens;
+        stats->stream_ms += w[k]->stream_ms;
+        for (int i = 0; i < AC_LLM_LATENCY_BUCKETS; i++) {
+            stats->ttfb[i] += w[k]->ttfb[i];
+            stats->first_token[i] += w[k]->first_token[i];
+            stats->gap[i] += w[k]->gap[i];
+            stats->duration[i] += w[k]->duration[i];
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ARC_OK;
+}
+
+uint32_t ac_llm_latency_percentile(const uint64_t* hist, double p) {
+    if (!hist) {
+        return 0;
+    }
+    uint64_t total = 0;
+    for (int i = 0; i < AC_LLM_LATENCY_BUCKETS; i++) {
+        total += hist[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    if (p < 0.0) p = 0.0;
+    if (p > 1.0) p = 1.0;
+
+    /* Smallest bucket holding the p-th sample; report its upper bound */
+    uint64_t rank = (uint64_t)(p * (double)total + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < AC_LLM_LATENCY_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen >= rank) {
+            return i == 0 ? 1 : (i == AC_LLM_LATENCY_BUCKETS - 1 ? UINT32_MAX : (1u << i));
+        }
+    }
+    return UINT32_MAX;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file latency.h
+ * @brief Per-model latency histograms (internal)
+ */
+
+#ifndef ARC_LLM_LATENCY_H
+#define ARC_LLM_LATENCY_H
+
+#include "arc/llm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Histogram bucket of a duration (0: < 1 ms, i: < 2^i ms, last: longer)
+ */
+int ac_llm_latency_bucket(uint32_t ms);
+
+/**
+ * @brief Add one finished call to its model's window
+ *
+ * @param model        Model name (NULL or "" is ignored)
+ * @param timing       Phases of the call
+ * @param duration_ms  Whole provider call, retries included
+ * @param output_tokens Output tokens of the response
+ * @param gaps         Inter-delta gap histogram of the call (NULL if not streamed)
+ */
+void ac_llm_latency_record(
+    const char* model,
+    const ac_llm_timing_t* timing,
+    uint32_t duration_ms,
+    int output_tokens,
+    const uint64_t* gaps
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_LLM_LATENCY_H */
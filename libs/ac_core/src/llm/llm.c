@@ -5,10 +5,17 @@
 
 #include "arc/llm.h"
 #include "arc/message.h"
+#include "arc/tool.h"
+#include "arc/tokens.h"
 #include "arc/log.h"
+#include "arc/platform.h"
+#include "arc/metrics.h"
+#include "arc/profile.h"
 #include "llm_internal.h"
 #include "llm_provider.h"
+#include "latency.h"
 #include "message/message_json.h"
+#include "json_scan.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -35,7 +42,12 @@ ac_llm_t* ac_llm_create(arena_t* arena, const ac_llm_params_t* params) {
         return NULL;
     }
 
+    memset(llm, 0, sizeof(*llm));
     llm->arena = arena;
+    llm->jitter_state = (uint32_t)ac_platform_timestamp_ms() ^ (uint32_t)(uintptr_t)llm;
+    if (llm->jitter_state == 0) {
+        llm->jitter_state = 1;
+    }
 
     // Copy params strings to arena
     llm->params.provider = params->provider ? arena_strdup(arena, params->provider) : NULL;
@@ -48,10 +60,14 @@ ac_llm_t* ac_llm_create(arena_t* arena, const ac_llm_params_t* params) {
     llm->params.temperature = params->temperature;
     llm->params.top_p = params->top_p;
     llm->params.max_tokens = params->max_tokens;
+    llm->params.context_window = params->context_window;
     llm->params.timeout_ms = params->timeout_ms;
     
     // Copy thinking config (v2)
-    llm->params.thinking.enabled = params->thinking.enabled;
+    if (params->thinking.enabled && !ARC_FEATURE_THINKING) {
+        AC_LOG_WARN("Thinking not built (ARC_FEATURE_THINKING), ignored");
+    }
+    llm->params.thinking.enabled = ARC_FEATURE_THINKING && params->thinking.enabled;
     llm->params.thinking.budget_tokens = params->thinking.budget_tokens;
     
     // Copy stateful config (v2)
@@ -63,11 +79,62 @@ ac_llm_t* ac_llm_create(arena_t* arena, const ac_llm_params_t* params) {
     // Copy stream flag (v2)
     llm->params.stream = params->stream;
 
+    // Copy structured output config (providers can rely on the name when schema is set)
+    if (params->response_format.schema) {
+        /* The schema is spliced into request bodies verbatim */
+        if (!ac_json_scan_valid(params->response_format.schema,
+                                strlen(params->response_format.schema))) {
+            AC_LOG_ERROR("response_format.schema is not valid JSON");
+            return NULL;
+        }
+        llm->params.response_format.schema = arena_strdup(arena, params->response_format.schema);
+        llm->params.response_format.name = arena_strdup(arena, params->response_format.name ?
+            params->response_format.name : AC_RESPONSE_FORMAT_DEFAULT_NAME);
+        llm->params.response_format.strict = params->response_format.strict;
+    }
+
+    // Copy embeddings config
+    llm->params.embed = params->embed;
+    llm->params.embed.model = params->embed.model ? arena_strdup(arena, params->embed.model) : NULL;
+
+    // Copy transport options
+    llm->params.compress_requests = params->compress_requests;
+    llm->params.websocket = params->websocket;
+    llm->params.retry = params->retry;
+    llm->params.cancel = params->cancel;
+    llm->params.deadline_ms = params->deadline_ms;
+    llm->params.priority = ac_priority_clamp((int)params->priority);
+    llm->params.rate_limit = params->rate_limit;
+    if (params->routing.endpoint_count > 0 && params->routing.endpoints) {
+        int count = params->routing.endpoint_count;
+        ac_llm_endpoint_t* endpoints = (ac_llm_endpoint_t*)arena_alloc(
+            arena, (size_t)count * sizeof(ac_llm_endpoint_t));
+        if (!endpoints) {
+            AC_LOG_ERROR("Failed to copy routing endpoints");
+            return NULL;
+        }
+        for (int i = 0; i < count; i++) {
+            const ac_llm_endpoint_t* src = &params->routing.endpoints[i];
+            endpoints[i].api_base = src->api_base ? arena_strdup(arena, src->api_base) : NULL;
+            endpoints[i].api_key = src->api_key ? arena_strdup(arena, src->api_key) : NULL;
+            endpoints[i].weight = src->weight;
+        }
+        llm->params.routing = params->routing;
+        llm->params.routing.endpoints = endpoints;
+    }
+    llm->params.prompt_cache = params->prompt_cache;
+    llm->params.response_cache.max_entries = params->response_cache.max_entries;
+    llm->params.response_cache.dir = params->response_cache.dir ?
+        arena_strdup(arena, params->response_cache.dir) : NULL;
+    llm->params.coalesce = params->coalesce;
+
     if (!llm->params.model || !llm->params.api_key) {
         AC_LOG_ERROR("Failed to copy strings to arena");
         return NULL;
     }
 
+    llm->token_family = ac_tokens_family(llm->params.model);
+
     // Find provider based on params
     llm->provider = ac_llm_find_provider(&llm->params);
     if (!llm->provider) {
@@ -75,9 +142,15 @@ ac_llm_t* ac_llm_create(arena_t* arena, const ac_llm_params_t* params) {
         return NULL;
     }
 
-    // Create provider private data
+    // Several endpoints: the router creates one provider instance per endpoint
     llm->priv = NULL;
-    if (llm->provider->create) {
+    if (llm->params.routing.endpoint_count > 0) {
+        llm->provider = ac_llm_router_create(llm->provider, &llm->params, &llm->priv);
+        if (!llm->provider) {
+            AC_LOG_ERROR("Failed to create endpoint router");
+            return NULL;
+        }
+    } else if (llm->provider->create) {
         llm->priv = llm->provider->create(&llm->params);
         if (!llm->priv) {
             AC_LOG_ERROR("Provider %s failed to create private data", llm->provider->name);
@@ -102,6 +175,110 @@ void ac_llm_cleanup(ac_llm_t* llm) {
     }
 }
 
+/*============================================================================
+ * Pre-flight Check
+ *============================================================================*/
+
+size_t ac_llm_estimate_tokens(const ac_llm_t* llm, const ac_message_t* messages,
+                              const char* tools) {
+    if (!llm) {
+        return 0;
+    }
+    ac_tokens_family_t family = (ac_tokens_family_t)llm->token_family;
+    return ac_messages_tokens(messages, family) + ac_tokens_estimate_str(tools, family);
+}
+
+/**
+ * @brief Refuse a request that cannot fit params.context_window
+ *
+ * A chained request (stored previous response) only carries the new
+ * messages, so its size says nothing about the context: not checked.
+ */
+static arc_err_t llm_preflight(const ac_llm_t* llm, const ac_message_t* messages,
+                               const char* tools) {
+    if (llm->params.context_window <= 0 || llm->params.stateful.response_id) {
+        return ARC_OK;
+    }
+
+    size_t prompt = ac_llm_estimate_tokens(llm, messages, tools);
+    size_t output = llm->params.max_tokens > 0 ? (size_t)llm->params.max_tokens : 0;
+    if (prompt + output > (size_t)llm->params.context_window) {
+        AC_LOG_ERROR("Request needs ~%zu prompt + %zu output tokens, context is %d",
+                     prompt, output, llm->params.context_window);
+        return ARC_ERR_CONTEXT_OVERFLOW;
+    }
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Chat API
+ *============================================================================*/
+
+/**
+ * @brief Count a provider call in the runtime metrics
+ */
+static void llm_metrics(const ac_llm_t* llm, arc_err_t err, const ac_chat_response_t* response,
+                        int output_tokens, const ac_llm_timing_t* timing, uint32_t duration_ms) {
+    char labels[64];
+    snprintf(labels, sizeof(labels), "provider=\"%s\"", llm->provider->name);
+
+    ac_metric_add(ac_metrics_counter("arc_llm_requests", labels, "LLM provider calls"), 1);
+    if (err != ARC_OK) {
+        ac_metric_add(ac_metrics_counter("arc_llm_errors", labels,
+                                         "LLM provider calls that failed"), 1);
+        return;
+    }
+    if (response) {
+        ac_metric_add(ac_metrics_counter("arc_llm_input_tokens", labels,
+                                         "Prompt tokens sent"), response->input_tokens);
+    }
+    ac_metric_add(ac_metrics_counter("arc_llm_output_tokens", labels,
+                                     "Output tokens received"), output_tokens);
+    ac_metric_observe(ac_metrics_histogram("arc_llm_request_duration_seconds", labels,
+                                           "LLM provider call time, retries included", 1e-6),
+                      (uint64_t)duration_ms * 1000);
+    if (timing->deltas) {
+        ac_metric_observe(ac_metrics_histogram("arc_llm_first_token_seconds", labels,
+                                               "Time to the first streamed text or thinking",
+                                               1e-6),
+                          (uint64_t)timing->first_token_ms * 1000);
+    }
+}
+
+/**
+ * @brief Metrics, latency and cache store after a provider call
+ *
+ * @param key  Cache key of a cacheable request, NULL otherwise
+ */
+static arc_err_t llm_chat_complete(ac_llm_t* llm, arc_err_t err, ac_chat_response_t* response,
+                                   uint64_t started, const ac_llm_cache_key_t* key) {
+    uint32_t duration_ms = (uint32_t)(ac_platform_timestamp_ms() - started);
+    llm_metrics(llm, err, response, response->output_tokens, &response->timing, duration_ms);
+
+    if (err == ARC_ERR_CANCELLED) {
+        AC_LOG_DEBUG("Provider chat cancelled");
+        return err;
+    }
+    if (err != ARC_OK) {
+        AC_LOG_ERROR("Provider chat failed: %d", err);
+        return err;
+    }
+
+    ac_llm_latency_record(llm->params.model, &response->timing, duration_ms,
+                          response->output_tokens, NULL);
+
+    /* An answer off the schema would only come back the same way */
+    if (key && !response->format_error) {
+        ac_llm_cache_store(llm, key, response);
+    }
+
+    AC_LOG_DEBUG("LLM chat completed: content=%s, tool_calls=%d",
+                 response->content ? "yes" : "no",
+                 response->tool_call_count);
+
+    return ARC_OK;
+}
+
 arc_err_t ac_llm_chat_with_tools(
     ac_llm_t* llm,
     const ac_message_t* messages,
@@ -119,24 +296,210 @@ arc_err_t ac_llm_chat_with_tools(
         return ARC_ERR_INVALID_ARG;
     }
 
-    arc_err_t err = llm->provider->chat(
-        llm->priv,
-        &llm->params,
-        messages,
-        tools,
-        response
-    );
+    arc_err_t err = llm_preflight(llm, messages, tools);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    if (llm->provider->json_dialect) {
+        ac_prof_push(AC_PROF_SERIALIZE);
+        ac_messages_json_prepare(llm->arena, messages,
+                                 (ac_json_dialect_t)llm->provider->json_dialect);
+        ac_prof_pop();
+    }
+
+    ac_llm_cache_key_t key;
+    int cacheable = ac_llm_cache_key(llm, messages, tools, &key);
+    if (cacheable && ac_llm_cache_lookup(llm, &key, response)) {
+        return ARC_OK;
+    }
+
+    ac_llm_flight_t* flight = NULL;
+    if (llm->params.coalesce) {
+        if (!cacheable) {
+            ac_llm_request_key(llm, messages, tools, &key);
+        }
+        if (ac_llm_flight_enter(&key, 0, llm->params.cancel, NULL, NULL, response,
+                                &flight, &err)) {
+            return err;
+        }
+    }
+
+    uint64_t started = ac_platform_timestamp_ms();
+    err = ac_llm_retry_chat(llm, messages, tools, response);
+    if (err == ARC_OK) {
+        ac_llm_format_finish(llm, response, NULL);
+    }
+    ac_llm_flight_finish(flight, err, response);
+    return llm_chat_complete(llm, err, response, started, cacheable ? &key : NULL);
+}
+
+/*============================================================================
+ * Non-blocking Chat API
+ *
+ * One attempt of provider->chat, split at the network wait: the request
+ * built by chat_prepare goes to the pool's shared engine, and chat_parse
+ * runs in ac_llm_call_finish() on the caller's thread.
+ *============================================================================*/
+
+/* Resolved at link time if ac_hosted is linked */
+__attribute__((weak)) arc_http_engine_t *ac_http_pool_engine(void);
+
+struct ac_llm_call {
+    ac_llm_t* llm;
+    ac_chat_response_t* response;
+    ac_llm_prepared_t prepared;
+    arc_http_transfer_t* transfer;   /* NULL = answered from the cache */
+    ac_llm_call_done_fn done;
+    void* user_data;
+    uint64_t started;
+    int cacheable;
+    ac_llm_cache_key_t key;
+};
+
+void ac_llm_prepared_free(ac_llm_prepared_t* prepared) {
+    if (!prepared) {
+        return;
+    }
+    ARC_FREE(prepared->body);
+    ac_json_body_source_free(prepared->source);
+    ARC_FREE(prepared->fields);
+    if (prepared->extra && prepared->extra_free) {
+        prepared->extra_free(prepared->extra);
+    }
+    memset(prepared, 0, sizeof(*prepared));
+}
+
+static void llm_call_done(arc_http_transfer_t* transfer, void* user_data) {
+    (void)transfer;
+    ac_llm_call_t* call = (ac_llm_call_t*)user_data;
+    call->done(call, call->user_data);
+}
+
+arc_err_t ac_llm_chat_submit(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_chat_response_t* response,
+    ac_llm_call_done_fn done,
+    void* user_data,
+    ac_llm_call_t** out
+) {
+    if (!llm || !llm->provider || !response || !done || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    const ac_llm_params_t* p = &llm->params;
+    arc_http_engine_t* engine = ac_http_pool_engine ? ac_http_pool_engine() : NULL;
+    if (!engine || !llm->provider->chat_prepare || !llm->provider->chat_parse ||
+        p->rate_limit.enabled || p->coalesce || p->retry.hedge_after_ms != 0) {
+        return ARC_ERR_NOT_IMPLEMENTED;
+    }
 
+    arc_err_t err = llm_preflight(llm, messages, tools);
     if (err != ARC_OK) {
-        AC_LOG_ERROR("Provider chat failed: %d", err);
         return err;
     }
 
-    AC_LOG_DEBUG("LLM chat completed: content=%s, tool_calls=%d",
-                 response->content ? "yes" : "no",
-                 response->tool_call_count);
+    ac_llm_params_t params;
+    if (!ac_llm_attempt_params(llm, &params)) {
+        return ARC_ERR_TIMEOUT;
+    }
 
-    return ARC_OK;
+    ac_llm_call_t* call = (ac_llm_call_t*)ARC_CALLOC(1, sizeof(ac_llm_call_t));
+    if (!call) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    call->llm = llm;
+    call->response = response;
+    call->done = done;
+    call->user_data = user_data;
+    call->started = ac_platform_timestamp_ms();
+
+    if (llm->provider->json_dialect) {
+        ac_prof_push(AC_PROF_SERIALIZE);
+        ac_messages_json_prepare(llm->arena, messages,
+                                 (ac_json_dialect_t)llm->provider->json_dialect);
+        ac_prof_pop();
+    }
+
+    call->cacheable = ac_llm_cache_key(llm, messages, tools, &call->key);
+    if (call->cacheable && ac_llm_cache_lookup(llm, &call->key, response)) {
+        *out = call;
+        done(call, user_data);
+        return ARC_OK;
+    }
+
+    err = llm->provider->chat_prepare(llm->priv, &params, messages, tools, &call->prepared);
+    if (err == ARC_OK) {
+        *out = call;
+        err = arc_http_submit(engine, &call->prepared.request, llm_call_done, call,
+                              &call->transfer);
+    }
+    if (err != ARC_OK) {
+        *out = NULL;
+        ac_llm_prepared_free(&call->prepared);
+        ARC_FREE(call);
+    }
+    return err;
+}
+
+arc_err_t ac_llm_call_finish(ac_llm_call_t* call, int* retry) {
+    if (retry) {
+        *retry = 0;
+    }
+    if (!call) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    ac_llm_t* llm = call->llm;
+    ac_chat_response_t* response = call->response;
+    if (!call->transfer) {
+        ARC_FREE(call);
+        return ARC_OK;                       /* Cache hit */
+    }
+
+    arc_http_response_t http_resp = {0};
+    arc_err_t err = arc_http_transfer_wait(call->transfer, &http_resp);
+    arc_http_transfer_release(call->transfer);
+    ac_llm_prepared_free(&call->prepared);
+
+    if (err == ARC_OK) {
+        err = llm->provider->chat_parse(llm->priv, &http_resp, response);
+        if (http_resp.status_code == 200) {
+            ac_llm_timing_from_http(&response->timing, &http_resp, 0);
+        }
+    }
+    arc_http_response_free(&http_resp);
+
+    if (err != ARC_OK && retry && llm->params.retry.max_retries > 0 &&
+        ac_llm_is_transient(err, response->http_status) &&
+        !(llm->params.cancel && *llm->params.cancel)) {
+        AC_LOG_WARN("LLM call failed (%d, HTTP %d), retrying", err, response->http_status);
+        arena_t* arena = response->arena;
+        struct ac_intern* intern = response->intern;
+        ac_chat_response_free(response);
+        ac_chat_response_init_arena(response, arena);
+        response->intern = intern;
+        *retry = 1;
+        ARC_FREE(call);
+        return err;
+    }
+
+    if (err == ARC_OK) {
+        ac_llm_format_finish(llm, response, NULL);
+    }
+    err = llm_chat_complete(llm, err, response, call->started,
+                            call->cacheable ? &call->key : NULL);
+    ARC_FREE(call);
+    return err;
+}
+
+void ac_llm_call_cancel(ac_llm_call_t* call) {
+    if (call && call->transfer) {
+        arc_http_transfer_cancel(call->transfer);
+    }
 }
 
 char* ac_llm_chat(ac_llm_t* llm, const ac_message_t* messages) {
@@ -145,21 +508,22 @@ char* ac_llm_chat(ac_llm_t* llm, const ac_message_t* messages) {
         return NULL;
     }
 
+    // Parse into the arena so the content lives with the agent
     ac_chat_response_t response;
-    ac_chat_response_init(&response);
+    ac_chat_response_init_arena(&response, llm->arena);
 
     arc_err_t err = ac_llm_chat_with_tools(llm, messages, NULL, &response);
     if (err != ARC_OK) {
+        ac_chat_response_free(&response);
         return NULL;
     }
 
-    // Copy content to arena so it lives with the agent
-    char* result = NULL;
-    if (response.content) {
-        result = arena_strdup(llm->arena, response.content);
+    // A hedged call may still hand back a heap response
+    char* result = response.content;
+    if (result && !response.arena) {
+        result = arena_strdup(llm->arena, result);
     }
 
-    // Free response (content was copied to arena)
     ac_chat_response_free(&response);
 
     return result;
@@ -169,6 +533,91 @@ char* ac_llm_chat(ac_llm_t* llm, const ac_message_t* messages) {
  * Streaming API (v2)
  *============================================================================*/
 
+/**
+ * @brief Pass-through callback noting how a stream ended (response cache)
+ */
+typedef struct {
+    ac_stream_callback_t callback;
+    void* user_data;
+    int complete;            /* MESSAGE_STOP delivered */
+    int aborted;             /* Callback asked to stop */
+} stream_tap_t;
+
+static int stream_tap(const ac_stream_event_t* event, void* user_data) {
+    stream_tap_t* tap = (stream_tap_t*)user_data;
+    int rc = tap->callback(event, tap->user_data);
+    if (rc != 0) {
+        tap->aborted = 1;
+    }
+    if (event->type == AC_STREAM_MESSAGE_STOP) {
+        tap->complete = 1;
+    }
+    return rc;
+}
+
+/**
+ * @brief Pass-through callback timing the deltas (sees every attempt)
+ */
+typedef struct {
+    ac_stream_callback_t callback;
+    void* user_data;
+    uint64_t started;        /* Call start (ms) */
+    uint64_t first_token;    /* First text/thinking delta (ms), 0 = none yet */
+    uint64_t first_delta;    /* 0 = none yet */
+    uint64_t last_delta;
+    uint32_t deltas;
+    uint32_t max_gap;
+    int output_tokens;       /* From MESSAGE_DELTA/STOP, if the caller has no response */
+    uint64_t gaps[AC_LLM_LATENCY_BUCKETS];
+} timing_tap_t;
+
+static int timing_tap(const ac_stream_event_t* event, void* user_data) {
+    timing_tap_t* tap = (timing_tap_t*)user_data;
+    if (event->type == AC_STREAM_DELTA) {
+        uint64_t now = ac_platform_timestamp_ms();
+        if (!tap->first_token && event->delta_type != AC_DELTA_INPUT_JSON &&
+            event->delta_type != AC_DELTA_SIGNATURE) {
+            tap->first_token = now;
+        }
+        if (tap->deltas++ == 0) {
+            tap->first_delta = now;
+        } else {
+            uint32_t gap = (uint32_t)(now - tap->last_delta);
+            tap->gaps[ac_llm_latency_bucket(gap)]++;
+            if (gap > tap->max_gap) {
+                tap->max_gap = gap;
+            }
+        }
+        tap->last_delta = now;
+    } else if ((event->type == AC_STREAM_MESSAGE_DELTA ||
+                event->type == AC_STREAM_MESSAGE_STOP) && event->output_tokens > 0) {
+        tap->output_tokens = event->output_tokens;
+    }
+    ac_prof_push(AC_PROF_HOOKS);
+    int rc = tap->callback(event, tap->user_data);
+    ac_prof_pop();
+    return rc;
+}
+
+/**
+ * @brief Stream phases of a finished call (the provider filled the transport ones)
+ */
+static void timing_tap_finish(const timing_tap_t* tap, int output_tokens,
+                              ac_llm_timing_t* timing) {
+    if (tap->first_token) {
+        timing->first_token_ms = (uint32_t)(tap->first_token - tap->started);
+    }
+    timing->deltas = tap->deltas;
+    timing->max_gap_ms = tap->max_gap;
+    timing->stream_ms = tap->deltas ? (uint32_t)(tap->last_delta - tap->first_delta) : 0;
+    if (output_tokens <= 0) {
+        output_tokens = tap->output_tokens;
+    }
+    if (timing->stream_ms && output_tokens > 0) {
+        timing->tokens_per_sec = (float)output_tokens * 1000.0f / (float)timing->stream_ms;
+    }
+}
+
 arc_err_t ac_llm_chat_stream(
     ac_llm_t* llm,
     const ac_message_t* messages,
@@ -193,25 +642,169 @@ arc_err_t ac_llm_chat_stream(
         ac_chat_response_init(response);
     }
 
-    arc_err_t err = llm->provider->chat_stream(
-        llm->priv,
-        &llm->params,
-        messages,
-        tools,
-        callback,
-        user_data,
-        response
-    );
+    arc_err_t err = llm_preflight(llm, messages, tools);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    if (llm->provider->json_dialect) {
+        ac_prof_push(AC_PROF_SERIALIZE);
+        ac_messages_json_prepare(llm->arena, messages,
+                                 (ac_json_dialect_t)llm->provider->json_dialect);
+        ac_prof_pop();
+    }
+
+    /* A hit is replayed as events; without a caller response, into a local one */
+    ac_llm_cache_key_t key;
+    int cacheable = ac_llm_cache_key(llm, messages, tools, &key);
+    if (cacheable) {
+        ac_chat_response_t local;
+        ac_chat_response_init(&local);
+        if (ac_llm_cache_lookup(llm, &key, response ? response : &local)) {
+            err = ac_llm_cache_replay(response ? response : &local, callback, user_data);
+            ac_chat_response_free(&local);
+            return err;
+        }
+    }
+
+    ac_llm_flight_t* flight = NULL;
+    if (llm->params.coalesce) {
+        if (!cacheable) {
+            ac_llm_request_key(llm, messages, tools, &key);
+        }
+        if (ac_llm_flight_enter(&key, 1, llm->params.cancel, callback, user_data, response,
+                                &flight, &err)) {
+            return err;
+        }
+    }
+
+    /* Only a stream that ran to MESSAGE_STOP unaborted is worth keeping */
+    stream_tap_t tap = { callback, user_data, 0, 0 };
+    if (cacheable && response) {
+        callback = stream_tap;
+        user_data = &tap;
+    }
+
+    /* Followers get the leader's events, and its response even if the caller passed none */
+    ac_llm_flight_tap_t flight_tap = { flight, callback, user_data, 0 };
+    ac_chat_response_t local;
+    if (flight) {
+        callback = ac_llm_flight_tap;
+        user_data = &flight_tap;
+        if (!response) {
+            ac_chat_response_init(&local);
+        }
+    }
+    ac_chat_response_t* out = flight && !response ? &local : response;
+
+    timing_tap_t timing = { callback, user_data, ac_platform_timestamp_ms(), 0, 0, 0, 0, 0, 0, {0} };
+    callback = timing_tap;
+    user_data = &timing;
+
+    /* Structured answers are checked (and unwrapped) before anyone sees them */
+    ac_llm_format_tap_t format;
+    int formatted = llm->params.response_format.schema != NULL;
+    if (formatted) {
+        ac_llm_format_tap_init(&format, llm, callback, user_data);
+        callback = ac_llm_format_tap;
+        user_data = &format;
+    }
 
+    err = ac_llm_retry_stream(llm, messages, tools, callback, user_data, out);
+    ac_llm_timing_t local_timing = {0};
+    ac_llm_timing_t* t = out ? &out->timing : &local_timing;
+    uint32_t duration_ms = (uint32_t)(ac_platform_timestamp_ms() - timing.started);
+    int output_tokens = out && out->output_tokens > 0 ? out->output_tokens : timing.output_tokens;
+    if (err == ARC_OK) {
+        timing_tap_finish(&timing, output_tokens, t);
+        ac_llm_latency_record(llm->params.model, t, duration_ms, output_tokens, timing.gaps);
+    }
+    llm_metrics(llm, err, out, output_tokens, t, duration_ms);
+    if (err == ARC_OK && formatted) {
+        ac_llm_format_finish(llm, out, &format);
+    }
+    ac_llm_flight_finish(flight, err, out);
+    if (out == &local) {
+        ac_chat_response_free(&local);
+    }
+
+    if (err == ARC_ERR_CANCELLED) {
+        AC_LOG_DEBUG("Provider stream chat cancelled");
+        return err;
+    }
     if (err != ARC_OK) {
         AC_LOG_ERROR("Provider stream chat failed: %d", err);
         return err;
     }
 
+    /* A delta-only response holds no text to replay */
+    if (tap.complete && !tap.aborted && !ARC_STREAM_DELTA_ONLY && !response->format_error) {
+        ac_llm_cache_store(llm, &key, response);
+    }
+
     AC_LOG_DEBUG("LLM stream chat completed");
     return ARC_OK;
 }
 
+arc_err_t ac_llm_chat_stream_raw(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_raw_callback_t sink,
+    void* user_data,
+    ac_chat_response_t* response
+) {
+    if (!llm || !llm->provider || !sink) {
+        AC_LOG_ERROR("Invalid arguments to ac_llm_chat_stream_raw");
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (!llm->provider->chat_stream_raw) {
+        AC_LOG_ERROR("Provider %s does not support raw streaming", llm->provider->name);
+        return ARC_ERR_NOT_IMPLEMENTED;
+    }
+
+    if (response) {
+        ac_chat_response_init(response);
+    }
+
+    arc_err_t err = llm_preflight(llm, messages, tools);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    if (llm->provider->json_dialect) {
+        ac_prof_push(AC_PROF_SERIALIZE);
+        ac_messages_json_prepare(llm->arena, messages,
+                                 (ac_json_dialect_t)llm->provider->json_dialect);
+        ac_prof_pop();
+    }
+
+    ac_llm_raw_tap_t raw = { .sink = sink, .user_data = user_data, .decode = response != NULL };
+    uint64_t started = ac_platform_timestamp_ms();
+    err = ac_llm_retry_stream_raw(llm, messages, tools, &raw, response);
+
+    ac_llm_timing_t local_timing = {0};
+    llm_metrics(llm, err, response, response ? response->output_tokens : 0,
+                response ? &response->timing : &local_timing,
+                (uint32_t)(ac_platform_timestamp_ms() - started));
+    /* A delta-only response holds no text to check */
+    if (err == ARC_OK && response && !ARC_STREAM_DELTA_ONLY) {
+        ac_llm_format_finish(llm, response, NULL);
+    }
+
+    if (err == ARC_ERR_CANCELLED) {
+        AC_LOG_DEBUG("Provider raw stream cancelled");
+        return err;
+    }
+    if (err != ARC_OK) {
+        AC_LOG_ERROR("Provider raw stream failed: %d", err);
+        return err;
+    }
+
+    AC_LOG_DEBUG("LLM raw stream completed");
+    return ARC_OK;
+}
+
 /*============================================================================
  * Parameter Update API (v2)
  *============================================================================*/
@@ -229,7 +822,7 @@ arc_err_t ac_llm_update_params(ac_llm_t* llm, const ac_llm_params_t* params) {
     llm->params.stateful.include_encrypted = params->stateful.include_encrypted;
 
     // Update thinking config
-    if (params->thinking.enabled) {
+    if (ARC_FEATURE_THINKING && params->thinking.enabled) {
         llm->params.thinking.enabled = params->thinking.enabled;
         llm->params.thinking.budget_tokens = params->thinking.budget_tokens;
     }
@@ -250,3 +843,93 @@ uint32_t ac_llm_get_capabilities(ac_llm_t* llm) {
     }
     return llm->provider->capabilities;
 }
+
+/*============================================================================
+ * Internal API (for agent.c)
+ *============================================================================*/
+
+/**
+ * @brief Tools schema format the provider splices directly
+ *
+ * @return ac_tool_schema_format_t value (OpenAI unless the provider's
+ *         wire dialect is Anthropic)
+ */
+int ac_llm_tools_format(const ac_llm_t* llm) {
+    if (llm && llm->provider &&
+        llm->provider->json_dialect == AC_JSON_DIALECT_ANTHROPIC) {
+        return AC_TOOL_SCHEMA_ANTHROPIC;
+    }
+    return AC_TOOL_SCHEMA_OPENAI;
+}
+
+/**
+ * @brief Parameters the LLM was created with (strings in its arena)
+ */
+const ac_llm_params_t* ac_llm_get_params(const ac_llm_t* llm) {
+    return llm ? &llm->params : NULL;
+}
+
+/**
+ * @brief Cancel flag and deadline for later calls
+ *
+ * The agent points these at its run state; not safe while a call on llm
+ * is in flight.
+ */
+void ac_llm_set_limits(ac_llm_t* llm, const volatile int* cancel, uint64_t deadline_ms) {
+    if (llm) {
+        llm->params.cancel = cancel;
+        llm->params.deadline_ms = deadline_ms;
+    }
+}
+
+/**
+ * @brief max_tokens and thinking budget of later calls
+ *
+ * The agent's budget controller sets these per iteration; the thinking
+ * budget only applies when thinking is on. Not safe while a call on llm
+ * is in flight.
+ */
+void ac_llm_set_budget(ac_llm_t* llm, int max_tokens, int thinking_budget) {
+    if (llm) {
+        llm->params.max_tokens = max_tokens;
+        if (llm->params.thinking.enabled) {
+            llm->params.thinking.budget_tokens = thinking_budget;
+        }
+    }
+}
+
+/**
+ * @brief Whether responses are kept server-side and can be chained
+ *
+ * Stored ones always; unstored ones on a WebSocket connection (a lost
+ * connection makes the chained request fail and the caller resend).
+ */
+int ac_llm_chains_responses(const ac_llm_t* llm) {
+    return ARC_FEATURE_STATEFUL && llm && llm->provider &&
+           (llm->provider->capabilities & AC_LLM_CAP_STATEFUL) &&
+           (llm->params.stateful.store || llm->params.websocket);
+}
+
+/**
+ * @brief ac_llm_chat_with_tools continuing a stored response
+ *
+ * @param previous_id Response the request continues (NULL = none); messages
+ *                    are then only those appended after it
+ */
+arc_err_t ac_llm_chat_chained(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* previous_id,
+    const char* tools,
+    ac_chat_response_t* response
+) {
+    if (!llm) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    const char* saved = llm->params.stateful.response_id;
+    llm->params.stateful.response_id = previous_id;
+    arc_err_t err = ac_llm_chat_with_tools(llm, messages, tools, response);
+    llm->params.stateful.response_id = saved;
+    return err;
+}
@@ -8,6 +8,7 @@
 
 #include "arc/llm.h"
 #include "llm_provider.h"
+#include "json_stream.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,6 +18,12 @@ extern "C" {
  * Internal Structure Definition
  *============================================================================*/
 
+/** Successful call latencies kept for adaptive hedging */
+#define AC_LLM_LATENCY_SAMPLES    32
+
+/** Samples needed before AC_LLM_HEDGE_P95 starts hedging */
+#define AC_LLM_HEDGE_MIN_SAMPLES  8
+
 /**
  * @brief Internal LLM client structure
  */
@@ -25,8 +32,261 @@ struct ac_llm {
     const ac_llm_ops_t* provider;
     void* priv;              /* Provider private data (malloc'd) */
     arena_t* arena;
+    int token_family;        /* ac_tokens_family_t of params.model */
+
+    /* Retry state (retry.c) */
+    uint32_t latency_ms[AC_LLM_LATENCY_SAMPLES];  /* Ring of recent successes */
+    size_t latency_count;
+    uint32_t jitter_state;   /* Backoff jitter PRNG */
+
+    /* Shared embedding requests (embed.c, under its lock) */
+    struct ac_llm_embed_job* embed_jobs;  /* Calls with inputs still to send or settle */
+    int embed_senders;       /* Provider requests in flight */
+    int embed_lingering;     /* A sender waits for more inputs */
 };
 
+/*============================================================================
+ * Retry Policy (retry.c)
+ *============================================================================*/
+
+/**
+ * @brief provider->chat under params.retry (backoff, Retry-After, hedging)
+ */
+arc_err_t ac_llm_retry_chat(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_chat_response_t* response
+);
+
+/**
+ * @brief provider->chat_stream under params.retry
+ *
+ * Retries only while no event has been delivered; never hedged.
+ */
+arc_err_t ac_llm_retry_stream(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_stream_callback_t callback,
+    void* user_data,
+    ac_chat_response_t* response
+);
+
+/**
+ * @brief provider->chat_stream_raw under params.retry
+ *
+ * Retries only while no byte has reached raw->sink; never hedged.
+ */
+arc_err_t ac_llm_retry_stream_raw(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_raw_tap_t* raw,
+    ac_chat_response_t* response
+);
+
+/**
+ * @brief provider->embed under params.retry (no hedging)
+ */
+arc_err_t ac_llm_retry_embed(
+    ac_llm_t* llm,
+    const char* const* inputs,
+    size_t count,
+    ac_llm_embed_result_t* result
+);
+
+/**
+ * @brief llm->params for one attempt, timeout cut to what is left of the deadline
+ * @return 0 if the deadline has passed
+ */
+int ac_llm_attempt_params(const ac_llm_t* llm, ac_llm_params_t* params);
+
+/**
+ * @brief Whether a failed call may succeed if repeated
+ *
+ * Timeouts, network errors and HTTP 408/429/5xx (except 501).
+ */
+int ac_llm_is_transient(arc_err_t err, int http_status);
+
+/*============================================================================
+ * Endpoint Routing (router.c)
+ *============================================================================*/
+
+/**
+ * @brief Wrap inner in a router over params->routing.endpoints
+ *
+ * Creates one inner instance per endpoint. The returned ops mirror the
+ * inner provider's capabilities and JSON dialect; they live in *priv and
+ * stay valid until ops->cleanup(*priv).
+ *
+ * @return Router ops, NULL on error
+ */
+const ac_llm_ops_t* ac_llm_router_create(
+    const ac_llm_ops_t* inner,
+    const ac_llm_params_t* params,
+    void** priv
+);
+
+/*============================================================================
+ * Response Cache (response_cache.c)
+ *============================================================================*/
+
+/** Request identity: two independent 64-bit hashes */
+typedef struct {
+    uint64_t h1;             /* FNV-1a, also names the disk file */
+    uint64_t h2;             /* Multiply-rotate, checked on load */
+} ac_llm_cache_key_t;
+
+/**
+ * @brief Key a request (provider, endpoint, model, parameters, tools, messages)
+ */
+void ac_llm_request_key(
+    const ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_cache_key_t* key
+);
+
+/**
+ * @brief ac_llm_request_key, only when params.response_cache is enabled
+ * @return 1 if the key was filled, 0 otherwise
+ */
+int ac_llm_cache_key(
+    const ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_cache_key_t* key
+);
+
+/**
+ * @brief Fill response from the memory LRU or the disk store
+ * @return 1 on a hit, 0 on a miss (response left untouched)
+ */
+int ac_llm_cache_lookup(
+    const ac_llm_t* llm,
+    const ac_llm_cache_key_t* key,
+    ac_chat_response_t* response
+);
+
+/** @brief Record a successful response under key */
+void ac_llm_cache_store(
+    const ac_llm_t* llm,
+    const ac_llm_cache_key_t* key,
+    const ac_chat_response_t* response
+);
+
+/**
+ * @brief Deliver a cached response as a stream event sequence
+ *
+ * MESSAGE_START, then START/DELTA/STOP per block (each block's content in
+ * one delta), MESSAGE_DELTA with the stop reason, MESSAGE_STOP. Stops
+ * early when the callback returns non-zero.
+ */
+arc_err_t ac_llm_cache_replay(
+    const ac_chat_response_t* response,
+    ac_stream_callback_t callback,
+    void* user_data
+);
+
+/*============================================================================
+ * Request Coalescing (coalesce.c)
+ *============================================================================*/
+
+/** One upstream call shared by identical concurrent requests */
+typedef struct ac_llm_flight ac_llm_flight_t;
+
+/**
+ * @brief Follow an identical in-flight call, or start one
+ *
+ * A follower blocks until the leader's call completes, receiving its
+ * stream events as they arrive when callback is set (or a replay, when
+ * the leader did not stream), then a copy of its response or its error.
+ * If the leader gave up before the follower saw anything, the follower
+ * is told to make the call itself.
+ *
+ * @param key       Request key (ac_llm_request_key)
+ * @param streaming Whether the caller streams (events published live)
+ * @param cancel    Follower cancel flag (optional)
+ * @param callback  Follower stream callback (NULL for chat)
+ * @param user_data Callback context
+ * @param response  Follower response (may be NULL when streaming)
+ * @param flight    Set when the caller leads: pass to ac_llm_flight_finish
+ * @param err       Result when served
+ * @return 1 if served by another caller's call, 0 if the caller must call
+ */
+int ac_llm_flight_enter(
+    const ac_llm_cache_key_t* key,
+    int streaming,
+    const volatile int* cancel,
+    ac_stream_callback_t callback,
+    void* user_data,
+    ac_chat_response_t* response,
+    ac_llm_flight_t** flight,
+    arc_err_t* err
+);
+
+/**
+ * @brief Leader stream tap: forwards to the caller, publishes to followers
+ *
+ * When the caller's callback aborts while followers remain, the caller
+ * stops receiving events but the stream runs on for them.
+ */
+typedef struct {
+    ac_llm_flight_t* flight;
+    ac_stream_callback_t callback;
+    void* user_data;
+    int detached;            /* Caller's callback aborted */
+} ac_llm_flight_tap_t;
+
+int ac_llm_flight_tap(const ac_stream_event_t* event, void* user_data);
+
+/**
+ * @brief Publish the leader's result and release the flight (NULL-safe)
+ */
+void ac_llm_flight_finish(
+    ac_llm_flight_t* flight,
+    arc_err_t err,
+    const ac_chat_response_t* response
+);
+
+/*============================================================================
+ * Structured Output (response_format.c)
+ *============================================================================*/
+
+/**
+ * @brief Stream tap of a call with params.response_format (innermost)
+ *
+ * Checks the answer's JSON syntax as it arrives and stops the stream at
+ * the first bad byte. When the answer comes as a tool call (Anthropic),
+ * its events are rewritten into text ones.
+ */
+typedef struct {
+    ac_stream_callback_t callback;
+    void* user_data;
+    const char* tool;        /* Answer tool name, NULL when the answer is text */
+    int answer_block;        /* Block index of the answer tool call, -1 = not seen */
+    ac_json_stream_t check;  /* Syntax of the answer so far */
+    size_t fed;              /* Answer bytes seen */
+    int failed;              /* Stopped at a byte that cannot continue the JSON */
+} ac_llm_format_tap_t;
+
+void ac_llm_format_tap_init(ac_llm_format_tap_t* tap, const ac_llm_t* llm,
+                            ac_stream_callback_t callback, void* user_data);
+
+int ac_llm_format_tap(const ac_stream_event_t* event, void* user_data);
+
+/**
+ * @brief Adopt the answer tool call as text and check the answer
+ *
+ * Sets response->format_error when the answer is missing, malformed or
+ * does not match the schema. No-op without params.response_format.
+ *
+ * @param tap  Tap of a streamed call (NULL otherwise)
+ */
+void ac_llm_format_finish(const ac_llm_t* llm, ac_chat_response_t* response,
+                          const ac_llm_format_tap_t* tap);
+
 #ifdef __cplusplus
 }
 #endif
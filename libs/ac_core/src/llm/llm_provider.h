@@ -13,11 +13,67 @@
 
 #include "arc/llm.h"
 #include "arc/message.h"
+#include "arc/platform.h"
+#include "http_client.h"
+#include <string.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct ac_llm_batch_ops;
+struct ac_json_body_source;
+
+/**
+ * @brief A chat request built by chat_prepare, not yet sent
+ *
+ * request points into the fields below and the provider's private data.
+ * Free with ac_llm_prepared_free() once the transfer is over: a streamed
+ * body is read from source until then.
+ */
+typedef struct {
+    arc_http_request_t request;
+    char* fields;                        /**< Body fields (ARC_MALLOC) */
+    char* body;                          /**< Flattened body, NULL = streamed from source */
+    struct ac_json_body_source* source;  /**< Body source (request.body_user_data) */
+    void* extra;                         /**< Provider data the body refers to */
+    void (*extra_free)(void* extra);
+} ac_llm_prepared_t;
+
+/** Free what a chat_prepare filled in (safe on a zeroed one) */
+void ac_llm_prepared_free(ac_llm_prepared_t* prepared);
+
+/**
+ * @brief Outcome of one provider embeddings request
+ */
+typedef struct {
+    float* vectors;           /**< count rows of dims floats (ARC_MALLOC) */
+    size_t dims;
+    int http_status;          /**< Status of a failed request (0 = none) */
+    uint32_t retry_after_ms;  /**< Retry-After of a failed request */
+} ac_llm_embed_result_t;
+
+/**
+ * @brief Passthrough state of one ac_llm_chat_stream_raw() call
+ *
+ * A provider sets ac_llm_raw_tap() as the tap of its stream request and
+ * resets state before each attempt. Its on_data decodes the body as
+ * usual when decode is set, and is ac_llm_raw_skip() otherwise.
+ */
+typedef struct {
+    ac_llm_raw_callback_t sink;
+    void* user_data;
+    int decode;               /**< The caller wants the response */
+    int delivered;            /**< Bytes reached sink: no retry or failover */
+    int state;                /**< This attempt: 0 = no bytes yet, 1 = relaying, -1 = error body */
+} ac_llm_raw_tap_t;
+
+/** arc_http_stream_request_t.tap: relays an event stream, holds back an error body */
+int ac_llm_raw_tap(const char* data, size_t len, void* user_data);
+
+/** arc_http_stream_request_t.on_data when nothing is decoded */
+int ac_llm_raw_skip(const char* data, size_t len, void* user_data);
+
 /**
  * @brief Provider operations
  *
@@ -28,6 +84,15 @@ typedef struct ac_llm_ops {
     const char* name;         /**< Provider name (for logging) */
     uint32_t capabilities;    /**< Capability bitmask (AC_LLM_CAP_*) */
 
+    /**
+     * @brief Message JSON dialect (ac_json_dialect_t, 0 = none)
+     *
+     * When set, ac_llm_* serializes new history messages into the agent
+     * arena before each request, and the provider streams its body from
+     * the cached fragments via ac_json_body_source_create().
+     */
+    int json_dialect;
+
     /**
      * @brief Create provider private data
      *
@@ -57,6 +122,44 @@ typedef struct ac_llm_ops {
         ac_chat_response_t* response
     );
 
+    /**
+     * @brief Build the chat request without sending it (optional)
+     *
+     * With chat_parse, lets ac_llm_chat_submit() send the request on the
+     * shared HTTP engine instead of blocking in chat. Rate limiting and
+     * the HTTP client are the caller's business.
+     *
+     * @param priv Provider private data (returned by create)
+     * @param params LLM parameters
+     * @param messages Message history (linked list)
+     * @param tools JSON array of tool definitions (NULL if no tools)
+     * @param out Request to send, then free with ac_llm_prepared_free()
+     * @return ARC_OK, ARC_ERR_NOT_IMPLEMENTED if this request can only
+     *         go through chat
+     */
+    arc_err_t (*chat_prepare)(
+        void* priv,
+        const ac_llm_params_t* params,
+        const ac_message_t* messages,
+        const char* tools,
+        ac_llm_prepared_t* out
+    );
+
+    /**
+     * @brief Turn the HTTP response to a chat_prepare request into response
+     *
+     * @param priv Provider private data (returned by create)
+     * @param http Completed response (any status)
+     * @param response Structured response output
+     * @return ARC_OK, ARC_ERR_HTTP (status and Retry-After set in
+     *         response), or the parse error
+     */
+    arc_err_t (*chat_parse)(
+        void* priv,
+        const arc_http_response_t* http,
+        ac_chat_response_t* response
+    );
+
     /**
      * @brief Perform streaming chat completion (optional, v2)
      *
@@ -81,6 +184,62 @@ typedef struct ac_llm_ops {
         ac_chat_response_t* response
     );
 
+    /**
+     * @brief Streaming chat passing the raw body through (optional)
+     *
+     * Same request as chat_stream; the body goes to raw (see
+     * ac_llm_raw_tap_t) instead of being turned into stream events.
+     * If NULL, ac_llm_chat_stream_raw() is not supported.
+     *
+     * @param raw Passthrough state
+     * @param response Accumulated response output (decoded if raw->decode)
+     */
+    arc_err_t (*chat_stream_raw)(
+        void* priv,
+        const ac_llm_params_t* params,
+        const ac_message_t* messages,
+        const char* tools,
+        ac_llm_raw_tap_t* raw,
+        ac_chat_response_t* response
+    );
+
+    /**
+     * @brief Batch endpoint support (optional, see batch.h)
+     *
+     * NULL means ac_llm_batch_create() fails with ARC_ERR_NOT_IMPLEMENTED.
+     */
+    const struct ac_llm_batch_ops* batch;
+
+    /**
+     * @brief Embed inputs in one request (optional)
+     *
+     * NULL means ac_llm_embed() fails with ARC_ERR_NOT_IMPLEMENTED. Runs
+     * on several threads at once only if reentrant() says chat may.
+     *
+     * @param priv Provider private data (returned by create)
+     * @param params LLM parameters (params->embed names the model)
+     * @param inputs Texts, count of them
+     * @param result Vectors in input order, or the failure's status
+     * @return ARC_OK on success
+     */
+    arc_err_t (*embed)(
+        void* priv,
+        const ac_llm_params_t* params,
+        const char* const* inputs,
+        size_t count,
+        ac_llm_embed_result_t* result
+    );
+
+    /**
+     * @brief Whether chat may run on two threads at once (optional)
+     *
+     * Required for hedged requests; NULL means never.
+     *
+     * @param priv Provider private data (returned by create)
+     * @return Non-zero if concurrent calls on priv are safe
+     */
+    int (*reentrant)(void* priv);
+
     /**
      * @brief Cleanup provider private data
      *
@@ -92,9 +251,11 @@ typedef struct ac_llm_ops {
 } ac_llm_ops_t;
 
 /**
- * @brief Register a provider (called by provider modules)
+ * @brief Register a custom provider (called by provider modules)
  *
- * Providers use AC_PROVIDER_REGISTER macro to auto-register at startup.
+ * Built-in providers are a static table (provider.c) and need no
+ * registration. Custom ones use the AC_PROVIDER_REGISTER macro to register
+ * at startup; without ARC_FEATURE_PROVIDER_REGISTRY there is no registry.
  *
  * @param name Provider name (e.g., "openai", "anthropic")
  * @param ops Provider operations
@@ -123,15 +284,19 @@ const ac_llm_ops_t* ac_llm_find_provider_by_name(const char *name);
 const ac_llm_ops_t* ac_llm_find_provider(const ac_llm_params_t* params);
 
 /**
- * @brief Auto-registration macro (constructor pattern)
+ * @brief Auto-registration macro for custom providers (constructor pattern)
  *
  * Usage in provider file:
  * @code
- * static const ac_llm_ops_t openai_ops = { ... };
- * AC_PROVIDER_REGISTER(openai, &openai_ops);
+ * static const ac_llm_ops_t my_ops = { ... };
+ * AC_PROVIDER_REGISTER(my_provider, &my_ops);
  * @endcode
  */
-#if defined(_MSC_VER)
+#if !ARC_FEATURE_PROVIDER_REGISTRY
+    // Fixed feature set: the built-in table is all there is
+    #define AC_PROVIDER_REGISTER(name, ops) \
+        _Static_assert(0, "AC_PROVIDER_REGISTER(" #name ") needs ARC_FEATURE_PROVIDER_REGISTRY")
+#elif defined(_MSC_VER)
     // MSVC: Use .CRT$XCU section for automatic initialization
     #define AC_PROVIDER_REGISTER(name, ops) \
         static void __cdecl ac_register_provider_##name##_impl(void) { \
@@ -150,6 +315,38 @@ const ac_llm_ops_t* ac_llm_find_provider(const ac_llm_params_t* params);
         extern int ac_provider_##name##_dummy
 #endif
 
+/**
+ * @brief Copy the transport phases of a provider's HTTP response
+ *
+ * Call after parsing, which resets the response. pool_wait_ms is the
+ * provider's wait in ac_http_pool_acquire() (0 for an owned client).
+ */
+static inline void ac_llm_timing_from_http(ac_llm_timing_t* timing,
+                                           const arc_http_response_t* http,
+                                           uint32_t pool_wait_ms) {
+    timing->pool_wait_ms = pool_wait_ms;
+    uint32_t connected_us = http->timing.tls_us ? http->timing.tls_us : http->timing.connect_us;
+    timing->connect_ms = connected_us / 1000;
+    timing->ttfb_ms = http->timing.ttfb_us / 1000;
+}
+
+/**
+ * @brief Heap copy of base followed by path
+ *
+ * Providers build their request URLs once at create time, so no request
+ * formats one into a stack buffer.
+ */
+static inline char* ac_llm_provider_url(const char* base, const char* path) {
+    size_t base_len = strlen(base);
+    size_t path_len = strlen(path);
+    char* url = (char*)ARC_MALLOC(base_len + path_len + 1);
+    if (url) {
+        memcpy(url, base, base_len);
+        memcpy(url + base_len, path, path_len + 1);
+    }
+    return url;
+}
+
 #ifdef __cplusplus
 }
 #endif
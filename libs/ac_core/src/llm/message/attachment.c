@@ -0,0 +1,357 @@
+/**
+ * @file attachment.c
+ * @brief Image blocks read from files or buffers, encoded as they are sent
+ */
+
+#include "attachment.h"
+#include "http_client.h"
+#include "arc/log.h"
+#include <string.h>
+#include <sys/stat.h>
+
+/*============================================================================
+ * Creation
+ *============================================================================*/
+
+/**
+ * @brief Media type from the first bytes, NULL if not a known image
+ */
+static const char* sniff_media_type(const unsigned char* p, size_t n) {
+    if (n >= 8 && memcmp(p, "\x89PNG\r\n\x1a\n", 8) == 0) {
+        return "image/png";
+    }
+    if (n >= 3 && p[0] == 0xFF && p[1] == 0xD8 && p[2] == 0xFF) {
+        return "image/jpeg";
+    }
+    if (n >= 6 && (memcmp(p, "GIF87a", 6) == 0 || memcmp(p, "GIF89a", 6) == 0)) {
+        return "image/gif";
+    }
+    if (n >= 12 && memcmp(p, "RIFF", 4) == 0 && memcmp(p + 8, "WEBP", 4) == 0) {
+        return "image/webp";
+    }
+    return NULL;
+}
+
+/**
+ * @brief type/subtype of [a-z0-9.+-]: spliced into bodies unescaped
+ */
+static int media_type_valid(const char* s) {
+    int slash = 0;
+    for (const char* p = s; *p; p++) {
+        if (*p == '/') {
+            slash++;
+        } else if (!((*p >= 'a' && *p <= 'z') || (*p >= '0' && *p <= '9') ||
+                     *p == '.' || *p == '+' || *p == '-')) {
+            return 0;
+        }
+    }
+    return slash == 1 && s[0] != '/';
+}
+
+ac_attachment_t* ac_attachment_copy(arena_t* arena, const ac_attachment_t* src) {
+    ac_attachment_t* att = (ac_attachment_t*)arena_alloc(arena, sizeof(*att));
+    if (!att) {
+        return NULL;
+    }
+    *att = *src;
+    att->path = src->path ? arena_strdup(arena, src->path) : NULL;
+    att->media_type = src->media_type ? arena_strdup(arena, src->media_type) : NULL;
+    if ((src->path && !att->path) || (src->media_type && !att->media_type)) {
+        return NULL;
+    }
+    return att;
+}
+
+ac_content_block_t* ac_block_create_image(arena_t* arena, const ac_attachment_t* attachment) {
+    if (!arena || !attachment || (!attachment->path && !attachment->data)) {
+        AC_LOG_ERROR("Invalid arguments to ac_block_create_image");
+        return NULL;
+    }
+
+    ac_attachment_t att = {
+        .path = attachment->path,
+        .data = attachment->path ? NULL : attachment->data,
+        .size = attachment->size,
+        .media_type = attachment->media_type,
+    };
+
+    unsigned char head[12];
+    size_t head_len = 0;
+    if (att.path) {
+        struct stat st;
+        FILE* fp = stat(att.path, &st) == 0 ? fopen(att.path, "rb") : NULL;
+        if (!fp) {
+            AC_LOG_ERROR("Attachment %s cannot be read", att.path);
+            return NULL;
+        }
+        head_len = fread(head, 1, sizeof(head), fp);
+        fclose(fp);
+        att.size = (size_t)st.st_size;
+        att.mtime = (int64_t)st.st_mtime;
+    } else {
+        head_len = att.size < sizeof(head) ? att.size : sizeof(head);
+        memcpy(head, att.data, head_len);
+    }
+
+    if (!att.media_type) {
+        att.media_type = sniff_media_type(head, head_len);
+    }
+    if (!att.media_type || !media_type_valid(att.media_type) || att.size == 0) {
+        AC_LOG_ERROR("Attachment %s is not an image of a known type",
+                     att.path ? att.path : "(buffer)");
+        return NULL;
+    }
+
+    ac_content_block_t* block = (ac_content_block_t*)arena_alloc(arena, sizeof(ac_content_block_t));
+    if (!block) {
+        AC_LOG_ERROR("Failed to allocate content block from arena");
+        return NULL;
+    }
+    memset(block, 0, sizeof(ac_content_block_t));
+    block->type = AC_BLOCK_IMAGE;
+    block->attachment = ac_attachment_copy(arena, &att);
+    if (!block->attachment) {
+        return NULL;
+    }
+
+    /* Plain fields too, so the block persists and keys like any other */
+    char stamp[48];
+    snprintf(stamp, sizeof(stamp), "%zu:%lld", att.size, (long long)att.mtime);
+    block->text = (char*)block->attachment->path;
+    block->text_len = block->text ? strlen(block->text) : 0;
+    block->name = (char*)block->attachment->media_type;
+    block->data = arena_strdup(arena, stamp);
+    return block->data ? block : NULL;
+}
+
+arc_err_t ac_attachment_restore(arena_t* arena, ac_content_block_t* block) {
+    if (block->type != AC_BLOCK_IMAGE || block->attachment) {
+        return ARC_OK;
+    }
+
+    size_t size = 0;
+    long long mtime = 0;
+    if (!block->name || !block->data ||
+        sscanf(block->data, "%zu:%lld", &size, &mtime) != 2) {
+        return ARC_ERR_PARSE;
+    }
+
+    /* A buffer's bytes are not stored: such blocks fail when sent */
+    ac_attachment_t* att = (ac_attachment_t*)arena_alloc(arena, sizeof(*att));
+    if (!att) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    memset(att, 0, sizeof(*att));
+    att->path = block->text;
+    att->size = size;
+    att->mtime = (int64_t)mtime;
+    att->media_type = block->name;
+    block->attachment = att;
+    return ARC_OK;
+}
+
+arc_err_t ac_attachment_check(const ac_attachment_t* att) {
+    if (att->path) {
+        struct stat st;
+        if (stat(att->path, &st) != 0 || (size_t)st.st_size != att->size ||
+            (int64_t)st.st_mtime != att->mtime) {
+            AC_LOG_ERROR("Attachment %s changed or was removed", att->path);
+            return ARC_ERR_NOT_FOUND;
+        }
+        return ARC_OK;
+    }
+    if (!att->data) {
+        AC_LOG_ERROR("Attachment has no source (restored from a buffer)");
+        return ARC_ERR_NOT_FOUND;
+    }
+    return ARC_OK;
+}
+
+size_t ac_message_attachments(const ac_message_t* msg) {
+    size_t n = 0;
+    for (const ac_content_block_t* b = msg->blocks; b; b = b->next) {
+        n += b->type == AC_BLOCK_IMAGE && b->attachment;
+    }
+    return n;
+}
+
+/*============================================================================
+ * Reading
+ *============================================================================*/
+
+void ac_attachment_reader_reset(ac_attachment_reader_t* r, const ac_attachment_t* att) {
+    ac_attachment_reader_close(r);
+    r->att = att;
+    r->pos = 0;
+}
+
+size_t ac_attachment_reader_read(ac_attachment_reader_t* r, char* buf, size_t size) {
+    const ac_attachment_t* att = r->att;
+    size_t n = att->size - r->pos;
+    if (n > size) {
+        n = size;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    if (!att->path) {
+        memcpy(buf, (const char*)att->data + r->pos, n);
+    } else {
+        if (!r->fp) {
+            r->fp = fopen(att->path, "rb");
+            if (!r->fp || fseek(r->fp, (long)r->pos, SEEK_SET) != 0) {
+                AC_LOG_ERROR("Attachment %s cannot be read", att->path);
+                return (size_t)-1;
+            }
+        }
+        if (fread(buf, 1, n, r->fp) != n) {
+            AC_LOG_ERROR("Attachment %s is shorter than when attached", att->path);
+            return (size_t)-1;
+        }
+    }
+    r->pos += n;
+    return n;
+}
+
+void ac_attachment_reader_close(ac_attachment_reader_t* r) {
+    if (r->fp) {
+        fclose(r->fp);
+        r->fp = NULL;
+    }
+}
+
+static const char s_b64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static size_t b64_encode(const unsigned char* in, size_t n, char* out) {
+    char* o = out;
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 | in[i + 2];
+        *o++ = s_b64[v >> 18];
+        *o++ = s_b64[(v >> 12) & 63];
+        *o++ = s_b64[(v >> 6) & 63];
+        *o++ = s_b64[v & 63];
+    }
+    if (i < n) {
+        uint32_t v = (uint32_t)in[i] << 16 | (i + 1 < n ? (uint32_t)in[i + 1] << 8 : 0);
+        *o++ = s_b64[v >> 18];
+        *o++ = s_b64[(v >> 12) & 63];
+        *o++ = i + 1 < n ? s_b64[(v >> 6) & 63] : '=';
+        *o++ = '=';
+    }
+    return (size_t)(o - out);
+}
+
+void ac_attachment_b64_reset(ac_attachment_b64_t* e, const ac_attachment_t* att) {
+    ac_attachment_reader_reset(&e->in, att);
+    e->out_len = 0;
+    e->out_pos = 0;
+}
+
+size_t ac_attachment_b64_read(ac_attachment_b64_t* e, char* buf, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        if (e->out_pos == e->out_len) {
+            /* Whole chunks keep the padding at the very end */
+            unsigned char raw[AC_ATTACHMENT_CHUNK];
+            size_t n = ac_attachment_reader_read(&e->in, (char*)raw, sizeof(raw));
+            if (n == (size_t)-1) {
+                return (size_t)-1;
+            }
+            if (n == 0) {
+                break;
+            }
+            e->out_len = b64_encode(raw, n, e->out);
+            e->out_pos = 0;
+        }
+        size_t n = e->out_len - e->out_pos;
+        if (n > size - done) {
+            n = size - done;
+        }
+        memcpy(buf + done, e->out + e->out_pos, n);
+        e->out_pos += n;
+        done += n;
+    }
+    return done;
+}
+
+arc_err_t ac_attachment_write_data_url(ac_json_writer_t* w, const ac_attachment_t* att) {
+    arc_err_t err = ac_attachment_check(att);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    size_t prefix = strlen("data:;base64,") + strlen(att->media_type);
+    size_t len = prefix + ac_attachment_b64_len(att);
+    char* url = (char*)ARC_MALLOC(len + 1);
+    ac_attachment_b64_t* e = (ac_attachment_b64_t*)ARC_CALLOC(1, sizeof(*e));
+    if (!url || !e) {
+        ARC_FREE(url);
+        ARC_FREE(e);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    snprintf(url, prefix + 1, "data:%s;base64,", att->media_type);
+    ac_attachment_b64_reset(e, att);
+    size_t n = ac_attachment_b64_read(e, url + prefix, len - prefix);
+    ac_attachment_reader_close(&e->in);
+    ARC_FREE(e);
+    if (n != len - prefix) {
+        ARC_FREE(url);
+        return ARC_ERR_NOT_FOUND;
+    }
+
+    /* Base64 needs no escaping */
+    ac_json_write_raw(w, "\"", 1);
+    ac_json_write_raw(w, url, len);
+    ac_json_write_raw(w, "\"", 1);
+    ARC_FREE(url);
+    return ac_json_writer_error(w);
+}
+
+/*============================================================================
+ * Upload Body
+ *============================================================================*/
+
+size_t ac_attachment_upload_length(const ac_attachment_upload_t* body) {
+    return strlen(body->head) + body->in.att->size + strlen(body->tail);
+}
+
+size_t ac_attachment_upload_read(char* buf, size_t size, void* user_data) {
+    ac_attachment_upload_t* body = (ac_attachment_upload_t*)user_data;
+    size_t head_len = strlen(body->head);
+    size_t tail_start = head_len + body->in.att->size;
+    size_t done = 0;
+
+    while (done < size) {
+        size_t n;
+        if (body->pos < head_len) {
+            n = head_len - body->pos;
+            n = n < size - done ? n : size - done;
+            memcpy(buf + done, body->head + body->pos, n);
+        } else if (body->pos < tail_start) {
+            n = ac_attachment_reader_read(&body->in, buf + done, size - done);
+            if (n == (size_t)-1 || n == 0) {
+                return ARC_HTTP_BODY_ABORT;
+            }
+        } else {
+            n = tail_start + strlen(body->tail) - body->pos;
+            if (n == 0) {
+                break;
+            }
+            n = n < size - done ? n : size - done;
+            memcpy(buf + done, body->tail + (body->pos - tail_start), n);
+        }
+        body->pos += n;
+        done += n;
+    }
+    return done;
+}
+
+void ac_attachment_upload_rewind(void* user_data) {
+    ac_attachment_upload_t* body = (ac_attachment_upload_t*)user_data;
+    ac_attachment_reader_reset(&body->in, body->in.att);
+    body->pos = 0;
+}
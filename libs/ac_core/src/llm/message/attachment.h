@@ -0,0 +1,127 @@
+/**
+ * @file attachment.h
+ * @brief Attachment bytes for request bodies and uploads (internal)
+ *
+ * A request fragment holds AC_ATTACHMENT_MARKER where an image's source
+ * object goes; the body source (message_json.c) replaces each marker,
+ * in block order, with the source for its dialect and streams the bytes
+ * through an ac_attachment_b64_t. The marker is a control character, so
+ * the JSON writer never produces it anywhere else.
+ */
+
+#ifndef ARC_ATTACHMENT_H
+#define ARC_ATTACHMENT_H
+
+#include "arc/message.h"
+#include "arc/arena.h"
+#include "json_writer.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AC_ATTACHMENT_MARKER     '\x01'
+#define AC_ATTACHMENT_MARKER_STR "\x01"
+
+/** Raw bytes read per refill of the encoder (a multiple of 3) */
+#define AC_ATTACHMENT_CHUNK 3072
+
+/**
+ * @brief Copy an attachment into arena (strings copied, data referenced)
+ */
+ac_attachment_t* ac_attachment_copy(arena_t* arena, const ac_attachment_t* src);
+
+/**
+ * @brief Rebuild a loaded image block's attachment from its plain fields
+ *
+ * Image blocks also carry text = path, name = media type and
+ * data = "size:mtime", which is what the memory log and snapshots store.
+ * No-op for other blocks and blocks that still have their attachment.
+ */
+arc_err_t ac_attachment_restore(arena_t* arena, ac_content_block_t* block);
+
+/**
+ * @brief Whether the bytes can still be read as attached
+ * @return ARC_OK, ARC_ERR_NOT_FOUND (file gone, changed or no source)
+ */
+arc_err_t ac_attachment_check(const ac_attachment_t* att);
+
+/** @brief Base64 length of the attachment */
+static inline size_t ac_attachment_b64_len(const ac_attachment_t* att) {
+    return (att->size + 2) / 3 * 4;
+}
+
+/** @brief Number of image blocks of a message */
+size_t ac_message_attachments(const ac_message_t* msg);
+
+/*============================================================================
+ * Reading
+ *============================================================================*/
+
+/**
+ * @brief Sequential reader over the raw bytes
+ */
+typedef struct {
+    const ac_attachment_t* att;
+    FILE* fp;                    /**< Open file (path attachments) */
+    size_t pos;                  /**< Bytes read so far */
+} ac_attachment_reader_t;
+
+/** @brief Start (again) from the first byte */
+void ac_attachment_reader_reset(ac_attachment_reader_t* r, const ac_attachment_t* att);
+
+/**
+ * @brief Read the next bytes
+ * @return Bytes read (0 at the end), (size_t)-1 if the file is gone or shorter
+ */
+size_t ac_attachment_reader_read(ac_attachment_reader_t* r, char* buf, size_t size);
+
+void ac_attachment_reader_close(ac_attachment_reader_t* r);
+
+/**
+ * @brief Base64 encoder over a reader, refilled a chunk at a time
+ */
+typedef struct {
+    ac_attachment_reader_t in;
+    char out[AC_ATTACHMENT_CHUNK / 3 * 4];
+    size_t out_len;
+    size_t out_pos;
+} ac_attachment_b64_t;
+
+void ac_attachment_b64_reset(ac_attachment_b64_t* e, const ac_attachment_t* att);
+
+/**
+ * @brief Copy the next encoded bytes
+ * @return Bytes copied (0 at the end), (size_t)-1 on a read failure
+ */
+size_t ac_attachment_b64_read(ac_attachment_b64_t* e, char* buf, size_t size);
+
+/**
+ * @brief Write a data: URL string of the whole attachment (not streamed)
+ */
+arc_err_t ac_attachment_write_data_url(ac_json_writer_t* w, const ac_attachment_t* att);
+
+/*============================================================================
+ * Upload Body
+ *============================================================================*/
+
+/**
+ * @brief head, the raw bytes and tail as an arc_http_request_t body
+ */
+typedef struct {
+    ac_attachment_reader_t in;
+    const char* head;
+    const char* tail;
+    size_t pos;
+} ac_attachment_upload_t;
+
+size_t ac_attachment_upload_length(const ac_attachment_upload_t* body);
+size_t ac_attachment_upload_read(char* buf, size_t size, void* body);
+void ac_attachment_upload_rewind(void* body);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_ATTACHMENT_H */
@@ -4,8 +4,14 @@
  */
 
 #include "message_json.h"
+#include "attachment.h"
+#include "http_client.h"
+#include "json_scan.h"
+#include "cjson_arena.h"
+#include "intern.h"
 #include "arc/log.h"
 #include "arc/platform.h"
+#include "arc/profile.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -13,68 +19,126 @@
  * Message to JSON
  *============================================================================*/
 
-cJSON* ac_tool_call_to_json(const ac_tool_call_t* call) {
-    if (!call) {
-        return NULL;
-    }
+/** Arguments of a call, "{}" when it has none */
+static ac_str_t call_arguments(const ac_tool_call_t* call) {
+    return call->arguments ? ac_tool_call_arguments(call) : ac_str("{}");
+}
 
-    cJSON* obj = cJSON_CreateObject();
-    if (!obj) {
-        return NULL;
+arc_err_t ac_tool_call_to_json(ac_json_writer_t* w, const ac_tool_call_t* call) {
+    if (!w || !call) {
+        return ARC_ERR_INVALID_ARG;
     }
 
-    cJSON_AddStringToObject(obj, "id", call->id);
-    cJSON_AddStringToObject(obj, "type", "function");
+    ac_json_write_object_begin(w);
+    ac_json_write_member_string(w, "id", call->id);
+    ac_json_write_member_string(w, "type", "function");
 
-    cJSON* func = cJSON_CreateObject();
-    cJSON_AddStringToObject(func, "name", call->name);
-    cJSON_AddStringToObject(func, "arguments", call->arguments ? call->arguments : "{}");
-    cJSON_AddItemToObject(obj, "function", func);
+    ac_json_write_key(w, "function");
+    ac_json_write_object_begin(w);
+    ac_json_write_member_string(w, "name", call->name);
+    ac_json_write_member_str(w, "arguments", call_arguments(call));
+    ac_json_write_object_end(w);
 
-    return obj;
+    ac_json_write_object_end(w);
+    return ac_json_writer_error(w);
 }
 
-cJSON* ac_message_to_json(const ac_message_t* msg) {
-    if (!msg) {
-        return NULL;
+/**
+ * @brief Where an attachment goes: the marker in request fragments, a
+ * description of it anywhere else (traces, logs)
+ */
+static void write_attachment(ac_json_writer_t* w, const ac_attachment_t* att, int marker) {
+    if (marker) {
+        ac_json_write_raw(w, AC_ATTACHMENT_MARKER_STR, 1);
+        return;
     }
+    ac_json_write_object_begin(w);
+    ac_json_write_member_string(w, "type", "attachment");
+    ac_json_write_member_string(w, "media_type", att->media_type);
+    ac_json_write_member_int(w, "size", (int64_t)att->size);
+    ac_json_write_member_string(w, "path", att->path);
+    ac_json_write_member_string(w, "file_id", att->file_id[0] ? att->file_id : NULL);
+    ac_json_write_object_end(w);
+}
 
-    cJSON* obj = cJSON_CreateObject();
-    if (!obj) {
-        return NULL;
+/**
+ * @brief Whether every block is an image: the text is in content
+ */
+static int blocks_are_attachments(const ac_message_t* msg) {
+    if (!msg->blocks) {
+        return 0;
+    }
+    for (const ac_content_block_t* b = msg->blocks; b; b = b->next) {
+        if (b->type != AC_BLOCK_IMAGE || !b->attachment) {
+            return 0;
+        }
     }
+    return 1;
+}
+
+/**
+ * @brief OpenAI message; marker: attachments as AC_ATTACHMENT_MARKER
+ */
+static arc_err_t message_to_json(ac_json_writer_t* w, const ac_message_t* msg, int marker) {
+    ac_json_write_object_begin(w);
 
     /* Role */
-    cJSON_AddStringToObject(obj, "role", ac_role_to_string(msg->role));
+    ac_json_write_member_string(w, "role", ac_role_to_string(msg->role));
 
     /* Content - can be NULL for assistant messages with tool_calls */
-    if (msg->content) {
-        cJSON_AddStringToObject(obj, "content", msg->content);
+    if (blocks_are_attachments(msg)) {
+        /* Images first, then the text */
+        ac_json_write_key(w, "content");
+        ac_json_write_array_begin(w);
+        for (const ac_content_block_t* b = msg->blocks; b; b = b->next) {
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "image_url");
+            ac_json_write_key(w, "image_url");
+            ac_json_write_object_begin(w);
+            ac_json_write_key(w, "url");
+            write_attachment(w, b->attachment, marker);
+            ac_json_write_object_end(w);
+            ac_json_write_object_end(w);
+        }
+        if (msg->content && msg->content[0]) {
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "text");
+            ac_json_write_member_str(w, "text", ac_message_content(msg));
+            ac_json_write_object_end(w);
+        }
+        ac_json_write_array_end(w);
+    } else if (msg->content) {
+        ac_json_write_member_str(w, "content", ac_message_content(msg));
     } else if (msg->role == AC_ROLE_ASSISTANT && msg->tool_calls) {
         /* OpenAI requires content field even if null */
-        cJSON_AddNullToObject(obj, "content");
+        ac_json_write_key(w, "content");
+        ac_json_write_null(w);
     }
 
     /* Tool call ID (for tool result messages) */
     if (msg->role == AC_ROLE_TOOL && msg->tool_call_id) {
-        cJSON_AddStringToObject(obj, "tool_call_id", msg->tool_call_id);
+        ac_json_write_member_string(w, "tool_call_id", msg->tool_call_id);
     }
 
     /* Tool calls (for assistant messages) */
     if (msg->role == AC_ROLE_ASSISTANT && msg->tool_calls) {
-        cJSON* tool_calls_arr = cJSON_CreateArray();
-
+        ac_json_write_key(w, "tool_calls");
+        ac_json_write_array_begin(w);
         for (ac_tool_call_t* call = msg->tool_calls; call; call = call->next) {
-            cJSON* call_obj = ac_tool_call_to_json(call);
-            if (call_obj) {
-                cJSON_AddItemToArray(tool_calls_arr, call_obj);
-            }
+            ac_tool_call_to_json(w, call);
         }
-
-        cJSON_AddItemToObject(obj, "tool_calls", tool_calls_arr);
+        ac_json_write_array_end(w);
     }
 
-    return obj;
+    ac_json_write_object_end(w);
+    return ac_json_writer_error(w);
+}
+
+arc_err_t ac_message_to_json(ac_json_writer_t* w, const ac_message_t* msg) {
+    if (!w || !msg) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    return message_to_json(w, msg, 0);
 }
 
 /*============================================================================
@@ -86,22 +150,14 @@ char* ac_messages_to_json_string(const ac_message_t* messages) {
         return NULL;
     }
 
-    cJSON* arr = cJSON_CreateArray();
-    if (!arr) {
-        return NULL;
-    }
-
+    ac_json_writer_t w = AC_JSON_WRITER_INIT;
+    ac_json_write_array_begin(&w);
     for (const ac_message_t* msg = messages; msg; msg = msg->next) {
-        cJSON* msg_json = ac_message_to_json(msg);
-        if (msg_json) {
-            cJSON_AddItemToArray(arr, msg_json);
-        }
+        ac_message_to_json(&w, msg);
     }
+    ac_json_write_array_end(&w);
 
-    char* json_str = cJSON_PrintUnformatted(arr);
-    cJSON_Delete(arr);
-
-    return json_str;
+    return ac_json_writer_take(&w);
 }
 
 char* ac_tool_calls_to_json_string(const ac_tool_call_t* calls) {
@@ -109,22 +165,14 @@ char* ac_tool_calls_to_json_string(const ac_tool_call_t* calls) {
         return NULL;
     }
 
-    cJSON* arr = cJSON_CreateArray();
-    if (!arr) {
-        return NULL;
-    }
-
+    ac_json_writer_t w = AC_JSON_WRITER_INIT;
+    ac_json_write_array_begin(&w);
     for (const ac_tool_call_t* call = calls; call; call = call->next) {
-        cJSON* call_json = ac_tool_call_to_json(call);
-        if (call_json) {
-            cJSON_AddItemToArray(arr, call_json);
-        }
+        ac_tool_call_to_json(&w, call);
     }
+    ac_json_write_array_end(&w);
 
-    char* json_str = cJSON_PrintUnformatted(arr);
-    cJSON_Delete(arr);
-
-    return json_str;
+    return ac_json_writer_take(&w);
 }
 
 /*============================================================================
@@ -136,9 +184,30 @@ void ac_chat_response_init(ac_chat_response_t* response) {
     memset(response, 0, sizeof(ac_chat_response_t));
 }
 
+void ac_chat_response_init_arena(ac_chat_response_t* response, arena_t* arena) {
+    if (!response) return;
+    memset(response, 0, sizeof(ac_chat_response_t));
+    response->arena = arena;
+}
+
+/**
+ * @brief Clear the contents of an arena-backed response (storage stays)
+ */
+static void response_clear(ac_chat_response_t* response) {
+    arena_t* arena = response->arena;
+    struct ac_intern* intern = response->intern;
+    ac_chat_response_init_arena(response, arena);
+    response->intern = intern;
+}
+
 void ac_chat_response_free(ac_chat_response_t* response) {
     if (!response) return;
 
+    if (response->arena) {
+        response_clear(response);
+        return;
+    }
+
     /* Free response ID */
     if (response->id) {
         ARC_FREE(response->id);
@@ -189,13 +258,146 @@ void ac_chat_response_free(ac_chat_response_t* response) {
         ARC_FREE(response->stop_reason);
         response->stop_reason = NULL;
     }
+    if (response->format_error) {
+        ARC_FREE(response->format_error);
+        response->format_error = NULL;
+    }
 }
 
 /*============================================================================
  * JSON to Response
  *============================================================================*/
 
-static ac_tool_call_t* parse_tool_call(const cJSON* call_json) {
+/* Response storage: the response's arena when it has one, else the heap */
+
+static void* resp_calloc(ac_chat_response_t* response, size_t size) {
+    if (response->arena) {
+        void* p = arena_alloc(response->arena, size);
+        if (p) memset(p, 0, size);
+        return p;
+    }
+    return ARC_CALLOC(1, size);
+}
+
+static char* resp_strdup(ac_chat_response_t* response, const char* s) {
+    if (!s) return NULL;
+    return response->arena ? arena_strdup(response->arena, s) : ARC_STRDUP(s);
+}
+
+static char* resp_strndup(ac_chat_response_t* response, const char* s, size_t len) {
+    if (!response->arena) {
+        char* p = ARC_MALLOC(len + 1);
+        if (p) {
+            memcpy(p, s, len);
+            p[len] = '\0';
+        }
+        return p;
+    }
+    return arena_strndup(response->arena, s, len);
+}
+
+/**
+ * @brief resp_strdup() that records the length
+ */
+static char* resp_strdup_len(ac_chat_response_t* response, const char* s, size_t* len) {
+    if (!s) return NULL;
+    *len = strlen(s);
+    return resp_strndup(response, s, *len);
+}
+
+/**
+ * @brief Second reference to a parsed string (arena strings are shared)
+ */
+/**
+ * @brief Copy a tool name or id, through the intern table when it applies
+ */
+static char* resp_ident(ac_chat_response_t* response, const char* s) {
+    if (s && response->intern && response->arena &&
+        ac_intern_arena(response->intern) == response->arena) {
+        return (char*)ac_intern(response->intern, s);
+    }
+    return resp_strdup(response, s);
+}
+
+static char* resp_share(ac_chat_response_t* response, char* s) {
+    if (!s) return NULL;
+    return response->arena ? s : ARC_STRDUP(s);
+}
+
+/**
+ * @brief resp_share() of a string with its length (len 0 = not recorded)
+ */
+static char* resp_share_str(ac_chat_response_t* response, char* s, size_t* len) {
+    ac_str_t str = ac_str_field(s, *len);
+    *len = str.len;
+    if (!s) return NULL;
+    return response->arena ? s : resp_strndup(response, s, str.len);
+}
+
+/**
+ * @brief Reset for parsing, keeping the response's storage choice
+ */
+static void resp_begin(ac_chat_response_t* response) {
+    response_clear(response);
+}
+
+/**
+ * @brief Unescaped copy of a string span (NULL for any other kind)
+ *
+ * Unescaping never lengthens a string, so the quoted span's size is
+ * enough for the copy and its terminator.
+ */
+static char* resp_span_strdup(ac_chat_response_t* response, ac_json_span_t v) {
+    if (v.kind != AC_JSON_STRING) return NULL;
+    if (!response->arena) {
+        return ac_json_scan_strdup(v);
+    }
+    char* p = arena_alloc(response->arena, (size_t)(v.end - v.start));
+    if (p) {
+        ac_json_scan_unescape(v, p);
+    }
+    return p;
+}
+
+/**
+ * @brief resp_span_strdup() that records the length
+ */
+static char* resp_span_strdup_len(ac_chat_response_t* response, ac_json_span_t v, size_t* len) {
+    if (v.kind != AC_JSON_STRING) return NULL;
+    size_t size = (size_t)(v.end - v.start);
+    char* p = response->arena ? arena_alloc(response->arena, size) : ARC_MALLOC(size);
+    if (p) {
+        *len = ac_json_scan_unescape(v, p);
+    }
+    return p;
+}
+
+/**
+ * @brief resp_ident() for a string span: escape-free names are interned
+ *        straight from the input
+ */
+static char* resp_span_ident(ac_chat_response_t* response, ac_json_span_t v) {
+    if (v.kind != AC_JSON_STRING) return NULL;
+    const char* s = v.start + 1;
+    size_t len = (size_t)(v.end - v.start) - 2;
+    if (response->intern && response->arena &&
+        ac_intern_arena(response->intern) == response->arena && !memchr(s, '\\', len)) {
+        return (char*)ac_intern_n(response->intern, s, len);
+    }
+    return resp_span_strdup(response, v);
+}
+
+/**
+ * @brief Log an API error message without decoding it (escapes shown raw)
+ */
+static void log_api_error(const char* what, ac_json_span_t error) {
+    ac_json_span_t msg = ac_json_scan_get(error, "message");
+    if (msg.kind == AC_JSON_STRING) {
+        AC_LOG_ERROR("%s: %.*s", what, (int)(msg.end - msg.start - 2), msg.start + 1);
+    }
+}
+
+static ac_tool_call_t* parse_tool_call(ac_chat_response_t* response, const cJSON* call_json) {
     if (!call_json) {
         return NULL;
     }
@@ -214,31 +416,35 @@ static ac_tool_call_t* parse_tool_call(const cJSON* call_json) {
         return NULL;
     }
 
-    ac_tool_call_t* call = (ac_tool_call_t*)ARC_CALLOC(1, sizeof(ac_tool_call_t));
+    ac_tool_call_t* call = (ac_tool_call_t*)resp_calloc(response, sizeof(ac_tool_call_t));
     if (!call) {
         return NULL;
     }
 
-    call->id = ARC_STRDUP(cJSON_GetStringValue(id));
-    call->name = ARC_STRDUP(cJSON_GetStringValue(name));
+    call->id = resp_ident(response, cJSON_GetStringValue(id));
+    call->name = resp_ident(response, cJSON_GetStringValue(name));
     call->arguments = args && cJSON_IsString(args) ?
-                      ARC_STRDUP(cJSON_GetStringValue(args)) : NULL;
+                      resp_strdup_len(response, cJSON_GetStringValue(args), &call->arguments_len)
+                      : NULL;
     call->next = NULL;
 
     return call;
 }
 
-arc_err_t ac_chat_response_parse(const char* json_str, ac_chat_response_t* response) {
+static arc_err_t chat_response_parse_impl(const char* json_str, ac_chat_response_t* response) {
     if (!json_str || !response) {
         return ARC_ERR_INVALID_ARG;
     }
 
     /* Initialize response */
-    ac_chat_response_init(response);
+    resp_begin(response);
 
-    /* Parse JSON */
-    cJSON* root = cJSON_Parse(json_str);
+    /* Parse JSON: tree lives in a scratch arena, only extracted strings are kept */
+    ac_cjson_scope_t scope;
+    ac_cjson_scope_begin(&scope, NULL);
+    cJSON* root = ac_cjson_scope_parse(&scope, json_str, strlen(json_str));
     if (!root) {
+        ac_cjson_scope_end(&scope);
         AC_LOG_ERROR("Failed to parse response JSON");
         return ARC_ERR_HTTP;
     }
@@ -251,6 +457,7 @@ arc_err_t ac_chat_response_parse(const char* json_str, ac_chat_response_t* respo
             AC_LOG_ERROR("API error: %s", cJSON_GetStringValue(msg));
         }
         cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
         return ARC_ERR_HTTP;
     }
 
@@ -259,6 +466,7 @@ arc_err_t ac_chat_response_parse(const char* json_str, ac_chat_response_t* respo
     if (!choices || !cJSON_IsArray(choices) || cJSON_GetArraySize(choices) == 0) {
         AC_LOG_ERROR("No choices in response");
         cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
         return ARC_ERR_HTTP;
     }
 
@@ -269,19 +477,21 @@ arc_err_t ac_chat_response_parse(const char* json_str, ac_chat_response_t* respo
     if (!message) {
         AC_LOG_ERROR("No message in choice");
         cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
         return ARC_ERR_HTTP;
     }
 
     /* Extract content */
     cJSON* content = cJSON_GetObjectItem(message, "content");
     if (content && cJSON_IsString(content)) {
-        response->content = ARC_STRDUP(cJSON_GetStringValue(content));
+        response->content = resp_strdup_len(response, cJSON_GetStringValue(content),
+                                            &response->content_len);
     }
 
     /* Extract finish reason */
     cJSON* finish_reason = cJSON_GetObjectItem(choice, "finish_reason");
     if (finish_reason && cJSON_IsString(finish_reason)) {
-        response->finish_reason = ARC_STRDUP(cJSON_GetStringValue(finish_reason));
+        response->finish_reason = resp_strdup(response, cJSON_GetStringValue(finish_reason));
     }
 
     /* Extract tool calls */
@@ -292,7 +502,7 @@ arc_err_t ac_chat_response_parse(const char* json_str, ac_chat_response_t* respo
 
         for (int i = 0; i < count; i++) {
             cJSON* call_json = cJSON_GetArrayItem(tool_calls, i);
-            ac_tool_call_t* call = parse_tool_call(call_json);
+            ac_tool_call_t* call = parse_tool_call(response, call_json);
 
             if (call) {
                 if (!response->tool_calls) {
@@ -319,6 +529,7 @@ arc_err_t ac_chat_response_parse(const char* json_str, ac_chat_response_t* respo
     }
 
     cJSON_Delete(root);
+    ac_cjson_scope_end(&scope);
 
     /* Sync v2 fields from legacy */
     response->input_tokens = response->prompt_tokens;
@@ -332,14 +543,123 @@ arc_err_t ac_chat_response_parse(const char* json_str, ac_chat_response_t* respo
     return ARC_OK;
 }
 
+/*
+ * In-place variant (ARC_JSON_INPLACE): the same fields, read as spans of
+ * json_str. No tree is built; only the strings the response keeps are
+ * copied out.
+ */
+
+static ac_tool_call_t* parse_tool_call_span(ac_chat_response_t* response, ac_json_span_t call_span) {
+    ac_json_span_t id = ac_json_scan_get(call_span, "id");
+    ac_json_span_t func = ac_json_scan_get(call_span, "function");
+    ac_json_span_t name = ac_json_scan_get(func, "name");
+
+    if (id.kind != AC_JSON_STRING || name.kind != AC_JSON_STRING) {
+        return NULL;
+    }
+
+    ac_tool_call_t* call = (ac_tool_call_t*)resp_calloc(response, sizeof(ac_tool_call_t));
+    if (!call) {
+        return NULL;
+    }
+
+    call->id = resp_span_ident(response, id);
+    call->name = resp_span_ident(response, name);
+    call->arguments = resp_span_strdup_len(response, ac_json_scan_get(func, "arguments"),
+                                           &call->arguments_len);
+    call->next = NULL;
+
+    return call;
+}
+
+static arc_err_t chat_response_parse_inplace(const char* json_str, ac_chat_response_t* response) {
+    if (!json_str || !response) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    resp_begin(response);
+
+    ac_json_span_t root = ac_json_scan_root(json_str, strlen(json_str));
+    if (root.kind != AC_JSON_OBJECT) {
+        AC_LOG_ERROR("Failed to parse response JSON");
+        return ARC_ERR_HTTP;
+    }
+
+    ac_json_span_t error = ac_json_scan_get(root, "error");
+    if (error.kind != AC_JSON_NONE) {
+        log_api_error("API error", error);
+        return ARC_ERR_HTTP;
+    }
+
+    ac_json_span_t choice = ac_json_scan_path(root, "choices.0");
+    if (choice.kind == AC_JSON_NONE) {
+        AC_LOG_ERROR("No choices in response");
+        return ARC_ERR_HTTP;
+    }
+
+    ac_json_span_t message = ac_json_scan_get(choice, "message");
+    if (message.kind == AC_JSON_NONE) {
+        AC_LOG_ERROR("No message in choice");
+        return ARC_ERR_HTTP;
+    }
+
+    response->content = resp_span_strdup_len(response, ac_json_scan_get(message, "content"),
+                                             &response->content_len);
+    response->finish_reason = resp_span_strdup(response, ac_json_scan_get(choice, "finish_reason"));
+
+    ac_json_span_t tool_calls = ac_json_scan_get(message, "tool_calls");
+    ac_tool_call_t* last_call = NULL;
+    ac_json_span_t call_span;
+    for (size_t i = 0; (call_span = ac_json_scan_index(tool_calls, i)).kind != AC_JSON_NONE; i++) {
+        ac_tool_call_t* call = parse_tool_call_span(response, call_span);
+        if (call) {
+            if (!response->tool_calls) {
+                response->tool_calls = call;
+            } else {
+                last_call->next = call;
+            }
+            last_call = call;
+            response->tool_call_count++;
+        }
+    }
+
+    ac_json_span_t usage = ac_json_scan_get(root, "usage");
+    ac_json_scan_int(ac_json_scan_get(usage, "prompt_tokens"), &response->prompt_tokens);
+    ac_json_scan_int(ac_json_scan_get(usage, "completion_tokens"), &response->completion_tokens);
+    ac_json_scan_int(ac_json_scan_get(usage, "total_tokens"), &response->total_tokens);
+
+    response->input_tokens = response->prompt_tokens;
+    response->output_tokens = response->completion_tokens;
+
+    AC_LOG_DEBUG("Parsed response: content=%s, tool_calls=%d, finish=%s",
+                 response->content ? "yes" : "no",
+                 response->tool_call_count,
+                 response->finish_reason ? response->finish_reason : "none");
+
+    return ARC_OK;
+}
+
+arc_err_t ac_chat_response_parse(const char* json_str, ac_chat_response_t* response) {
+    ac_prof_push(AC_PROF_PARSE);
+    arc_err_t err = ARC_JSON_INPLACE ? chat_response_parse_inplace(json_str, response)
+                                     : chat_response_parse_impl(json_str, response);
+    ac_prof_pop();
+    return err;
+}
+
 /*============================================================================
  * Anthropic Format Parsing
  *============================================================================*/
 
 /**
  * @brief Parse a content block from Anthropic response
+ *
+ * @param block_span  Same block as raw text: tool input is copied verbatim
+ *                    rather than re-printed from the tree
  */
-static ac_content_block_t* parse_anthropic_content_block(const cJSON* block_json) {
+static ac_content_block_t* parse_anthropic_content_block(ac_chat_response_t* response,
+                                                         const cJSON* block_json,
+                                                         ac_json_span_t block_span) {
     if (!block_json) return NULL;
 
     cJSON* type_obj = cJSON_GetObjectItem(block_json, "type");
@@ -348,67 +668,80 @@ static ac_content_block_t* parse_anthropic_content_block(const cJSON* block_json
     const char* type_str = cJSON_GetStringValue(type_obj);
     if (!type_str) return NULL;
 
-    ac_content_block_t* block = (ac_content_block_t*)ARC_CALLOC(1, sizeof(ac_content_block_t));
+    ac_block_type_t type;
+    if (strcmp(type_str, "text") == 0) {
+        type = AC_BLOCK_TEXT;
+    } else if (ARC_FEATURE_THINKING && strcmp(type_str, "thinking") == 0) {
+        type = AC_BLOCK_THINKING;
+    } else if (ARC_FEATURE_THINKING && strcmp(type_str, "redacted_thinking") == 0) {
+        type = AC_BLOCK_REDACTED_THINKING;
+    } else if (strcmp(type_str, "tool_use") == 0) {
+        type = AC_BLOCK_TOOL_USE;
+    } else {
+        /* Unknown block type, skip */
+        return NULL;
+    }
+
+    ac_content_block_t* block = (ac_content_block_t*)resp_calloc(response, sizeof(ac_content_block_t));
     if (!block) return NULL;
+    block->type = type;
 
-    if (strcmp(type_str, "text") == 0) {
-        block->type = AC_BLOCK_TEXT;
+    if (type == AC_BLOCK_TEXT) {
         cJSON* text = cJSON_GetObjectItem(block_json, "text");
         if (text && cJSON_IsString(text)) {
-            block->text = ARC_STRDUP(cJSON_GetStringValue(text));
+            block->text = resp_strdup_len(response, cJSON_GetStringValue(text), &block->text_len);
         }
-    } else if (strcmp(type_str, "thinking") == 0) {
-        block->type = AC_BLOCK_THINKING;
+    } else if (type == AC_BLOCK_THINKING) {
         cJSON* thinking = cJSON_GetObjectItem(block_json, "thinking");
         cJSON* signature = cJSON_GetObjectItem(block_json, "signature");
         if (thinking && cJSON_IsString(thinking)) {
-            block->text = ARC_STRDUP(cJSON_GetStringValue(thinking));
+            block->text = resp_strdup_len(response, cJSON_GetStringValue(thinking),
+                                          &block->text_len);
         }
         if (signature && cJSON_IsString(signature)) {
-            block->signature = ARC_STRDUP(cJSON_GetStringValue(signature));
+            block->signature = resp_strdup(response, cJSON_GetStringValue(signature));
         }
-    } else if (strcmp(type_str, "redacted_thinking") == 0) {
-        block->type = AC_BLOCK_REDACTED_THINKING;
+    } else if (type == AC_BLOCK_REDACTED_THINKING) {
         cJSON* data = cJSON_GetObjectItem(block_json, "data");
         if (data && cJSON_IsString(data)) {
-            block->data = ARC_STRDUP(cJSON_GetStringValue(data));
+            block->data = resp_strdup(response, cJSON_GetStringValue(data));
         }
-    } else if (strcmp(type_str, "tool_use") == 0) {
-        block->type = AC_BLOCK_TOOL_USE;
+    } else {
         cJSON* id = cJSON_GetObjectItem(block_json, "id");
         cJSON* name = cJSON_GetObjectItem(block_json, "name");
-        cJSON* input = cJSON_GetObjectItem(block_json, "input");
 
         if (id && cJSON_IsString(id)) {
-            block->id = ARC_STRDUP(cJSON_GetStringValue(id));
+            block->id = resp_ident(response, cJSON_GetStringValue(id));
         }
         if (name && cJSON_IsString(name)) {
-            block->name = ARC_STRDUP(cJSON_GetStringValue(name));
+            block->name = resp_ident(response, cJSON_GetStringValue(name));
         }
-        if (input) {
-            char* input_str = cJSON_PrintUnformatted(input);
-            if (input_str) {
-                block->input = input_str;
-            }
+
+        ac_json_span_t input = ac_json_scan_get(block_span, "input");
+        if (input.kind != AC_JSON_NONE) {
+            block->input_len = (size_t)(input.end - input.start);
+            block->input = resp_strndup(response, input.start, block->input_len);
         }
-    } else {
-        /* Unknown block type, skip */
-        ARC_FREE(block);
-        return NULL;
     }
 
     return block;
 }
 
-arc_err_t ac_chat_response_parse_anthropic(const char* json_str, ac_chat_response_t* response) {
+static arc_err_t chat_response_parse_anthropic_impl(const char* json_str,
+                                                    ac_chat_response_t* response) {
     if (!json_str || !response) {
         return ARC_ERR_INVALID_ARG;
     }
 
-    ac_chat_response_init(response);
+    resp_begin(response);
 
-    cJSON* root = cJSON_Parse(json_str);
+    /* Parse JSON: tree lives in a scratch arena, only extracted strings are kept */
+    size_t json_len = strlen(json_str);
+    ac_cjson_scope_t scope;
+    ac_cjson_scope_begin(&scope, NULL);
+    cJSON* root = ac_cjson_scope_parse(&scope, json_str, json_len);
     if (!root) {
+        ac_cjson_scope_end(&scope);
         AC_LOG_ERROR("Failed to parse Anthropic response JSON");
         return ARC_ERR_HTTP;
     }
@@ -421,31 +754,35 @@ arc_err_t ac_chat_response_parse_anthropic(const char* json_str, ac_chat_respons
             AC_LOG_ERROR("Anthropic API error: %s", cJSON_GetStringValue(msg));
         }
         cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
         return ARC_ERR_HTTP;
     }
 
     /* Extract response ID */
     cJSON* id = cJSON_GetObjectItem(root, "id");
     if (id && cJSON_IsString(id)) {
-        response->id = ARC_STRDUP(cJSON_GetStringValue(id));
+        response->id = resp_strdup(response, cJSON_GetStringValue(id));
     }
 
     /* Extract stop reason */
     cJSON* stop_reason = cJSON_GetObjectItem(root, "stop_reason");
     if (stop_reason && cJSON_IsString(stop_reason)) {
-        response->stop_reason = ARC_STRDUP(cJSON_GetStringValue(stop_reason));
-        response->finish_reason = ARC_STRDUP(cJSON_GetStringValue(stop_reason));
+        response->stop_reason = resp_strdup(response, cJSON_GetStringValue(stop_reason));
+        response->finish_reason = resp_share(response, response->stop_reason);
     }
 
     /* Parse content array */
     cJSON* content = cJSON_GetObjectItem(root, "content");
     if (content && cJSON_IsArray(content)) {
-        int count = cJSON_GetArraySize(content);
+        ac_json_span_t content_span = ac_json_scan_get(ac_json_scan_root(json_str, json_len),
+                                                       "content");
         ac_content_block_t* last_block = NULL;
+        ac_tool_call_t* last_call = NULL;
+        size_t i = 0;
 
-        for (int i = 0; i < count; i++) {
-            cJSON* block_json = cJSON_GetArrayItem(content, i);
-            ac_content_block_t* block = parse_anthropic_content_block(block_json);
+        for (cJSON* block_json = content->child; block_json; block_json = block_json->next, i++) {
+            ac_content_block_t* block = parse_anthropic_content_block(
+                response, block_json, ac_json_scan_index(content_span, i));
 
             if (block) {
                 if (!response->blocks) {
@@ -458,23 +795,26 @@ arc_err_t ac_chat_response_parse_anthropic(const char* json_str, ac_chat_respons
 
                 /* Also populate legacy fields for compatibility */
                 if (block->type == AC_BLOCK_TEXT && block->text && !response->content) {
-                    response->content = ARC_STRDUP(block->text);
+                    response->content_len = block->text_len;
+                    response->content = resp_share_str(response, block->text,
+                                                       &response->content_len);
                 } else if (block->type == AC_BLOCK_TOOL_USE) {
                     /* Add to legacy tool_calls list */
-                    ac_tool_call_t* call = (ac_tool_call_t*)ARC_CALLOC(1, sizeof(ac_tool_call_t));
+                    ac_tool_call_t* call = (ac_tool_call_t*)resp_calloc(response, sizeof(ac_tool_call_t));
                     if (call) {
-                        call->id = block->id ? ARC_STRDUP(block->id) : NULL;
-                        call->name = block->name ? ARC_STRDUP(block->name) : NULL;
-                        call->arguments = block->input ? ARC_STRDUP(block->input) : NULL;
+                        call->id = resp_share(response, block->id);
+                        call->name = resp_share(response, block->name);
+                        call->arguments_len = block->input_len;
+                        call->arguments = resp_share_str(response, block->input,
+                                                         &call->arguments_len);
                         call->next = NULL;
 
                         if (!response->tool_calls) {
                             response->tool_calls = call;
                         } else {
-                            ac_tool_call_t* last = response->tool_calls;
-                            while (last->next) last = last->next;
-                            last->next = call;
+                            last_call->next = call;
                         }
+                        last_call = call;
                         response->tool_call_count++;
                     }
                 }
@@ -510,6 +850,7 @@ arc_err_t ac_chat_response_parse_anthropic(const char* json_str, ac_chat_respons
     }
 
     cJSON_Delete(root);
+    ac_cjson_scope_end(&scope);
 
     AC_LOG_DEBUG("Parsed Anthropic response: blocks=%d, content=%s, tool_calls=%d, stop=%s",
                  response->block_count,
@@ -520,25 +861,163 @@ arc_err_t ac_chat_response_parse_anthropic(const char* json_str, ac_chat_respons
     return ARC_OK;
 }
 
-/*============================================================================
- * Content Block to JSON (Anthropic format)
- *============================================================================*/
+static ac_content_block_t* parse_anthropic_block_span(ac_chat_response_t* response,
+                                                      ac_json_span_t block_span) {
+    ac_json_span_t type_span = ac_json_scan_get(block_span, "type");
+
+    ac_block_type_t type;
+    if (ac_json_scan_str_eq(type_span, "text")) {
+        type = AC_BLOCK_TEXT;
+    } else if (ARC_FEATURE_THINKING && ac_json_scan_str_eq(type_span, "thinking")) {
+        type = AC_BLOCK_THINKING;
+    } else if (ARC_FEATURE_THINKING && ac_json_scan_str_eq(type_span, "redacted_thinking")) {
+        type = AC_BLOCK_REDACTED_THINKING;
+    } else if (ac_json_scan_str_eq(type_span, "tool_use")) {
+        type = AC_BLOCK_TOOL_USE;
+    } else {
+        return NULL;
+    }
 
-cJSON* ac_content_block_to_json(const ac_content_block_t* block) {
+    ac_content_block_t* block = (ac_content_block_t*)resp_calloc(response, sizeof(ac_content_block_t));
     if (!block) return NULL;
+    block->type = type;
+
+    if (type == AC_BLOCK_TEXT) {
+        block->text = resp_span_strdup_len(response, ac_json_scan_get(block_span, "text"),
+                                           &block->text_len);
+    } else if (type == AC_BLOCK_THINKING) {
+        block->text = resp_span_strdup_len(response, ac_json_scan_get(block_span, "thinking"),
+                                           &block->text_len);
+        block->signature = resp_span_strdup(response, ac_json_scan_get(block_span, "signature"));
+    } else if (type == AC_BLOCK_REDACTED_THINKING) {
+        block->data = resp_span_strdup(response, ac_json_scan_get(block_span, "data"));
+    } else {
+        block->id = resp_span_ident(response, ac_json_scan_get(block_span, "id"));
+        block->name = resp_span_ident(response, ac_json_scan_get(block_span, "name"));
+
+        ac_json_span_t input = ac_json_scan_get(block_span, "input");
+        if (input.kind != AC_JSON_NONE) {
+            block->input_len = (size_t)(input.end - input.start);
+            block->input = resp_strndup(response, input.start, block->input_len);
+        }
+    }
+
+    return block;
+}
+
+static arc_err_t chat_response_parse_anthropic_inplace(const char* json_str,
+                                                       ac_chat_response_t* response) {
+    if (!json_str || !response) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    resp_begin(response);
+
+    ac_json_span_t root = ac_json_scan_root(json_str, strlen(json_str));
+    if (root.kind != AC_JSON_OBJECT) {
+        AC_LOG_ERROR("Failed to parse Anthropic response JSON");
+        return ARC_ERR_HTTP;
+    }
+
+    ac_json_span_t error = ac_json_scan_get(root, "error");
+    if (error.kind != AC_JSON_NONE) {
+        log_api_error("Anthropic API error", error);
+        return ARC_ERR_HTTP;
+    }
+
+    response->id = resp_span_strdup(response, ac_json_scan_get(root, "id"));
+    response->stop_reason = resp_span_strdup(response, ac_json_scan_get(root, "stop_reason"));
+    response->finish_reason = resp_share(response, response->stop_reason);
+
+    ac_json_span_t content = ac_json_scan_get(root, "content");
+    ac_content_block_t* last_block = NULL;
+    ac_tool_call_t* last_call = NULL;
+    ac_json_span_t block_span;
+    for (size_t i = 0; (block_span = ac_json_scan_index(content, i)).kind != AC_JSON_NONE; i++) {
+        ac_content_block_t* block = parse_anthropic_block_span(response, block_span);
+        if (!block) {
+            continue;
+        }
+        if (!response->blocks) {
+            response->blocks = block;
+        } else {
+            last_block->next = block;
+        }
+        last_block = block;
+        response->block_count++;
+
+        /* Legacy fields, as in the tree parser */
+        if (block->type == AC_BLOCK_TEXT && block->text && !response->content) {
+            response->content_len = block->text_len;
+            response->content = resp_share_str(response, block->text, &response->content_len);
+        } else if (block->type == AC_BLOCK_TOOL_USE) {
+            ac_tool_call_t* call = (ac_tool_call_t*)resp_calloc(response, sizeof(ac_tool_call_t));
+            if (call) {
+                call->id = resp_share(response, block->id);
+                call->name = resp_share(response, block->name);
+                call->arguments_len = block->input_len;
+                call->arguments = resp_share_str(response, block->input, &call->arguments_len);
+                call->next = NULL;
+
+                if (!response->tool_calls) {
+                    response->tool_calls = call;
+                } else {
+                    last_call->next = call;
+                }
+                last_call = call;
+                response->tool_call_count++;
+            }
+        }
+    }
+
+    ac_json_span_t usage = ac_json_scan_get(root, "usage");
+    if (usage.kind == AC_JSON_OBJECT) {
+        if (ac_json_scan_int(ac_json_scan_get(usage, "input_tokens"), &response->input_tokens)) {
+            response->prompt_tokens = response->input_tokens;
+        }
+        if (ac_json_scan_int(ac_json_scan_get(usage, "output_tokens"), &response->output_tokens)) {
+            response->completion_tokens = response->output_tokens;
+        }
+        response->total_tokens = response->input_tokens + response->output_tokens;
+        ac_json_scan_int(ac_json_scan_get(usage, "cache_creation_input_tokens"),
+                         &response->cache_creation_tokens);
+        ac_json_scan_int(ac_json_scan_get(usage, "cache_read_input_tokens"),
+                         &response->cache_read_tokens);
+    }
+
+    AC_LOG_DEBUG("Parsed Anthropic response: blocks=%d, content=%s, tool_calls=%d, stop=%s",
+                 response->block_count,
+                 response->content ? "yes" : "no",
+                 response->tool_call_count,
+                 response->stop_reason ? response->stop_reason : "none");
+
+    return ARC_OK;
+}
+
+arc_err_t ac_chat_response_parse_anthropic(const char* json_str, ac_chat_response_t* response) {
+    ac_prof_push(AC_PROF_PARSE);
+    arc_err_t err = ARC_JSON_INPLACE ? chat_response_parse_anthropic_inplace(json_str, response)
+                                     : chat_response_parse_anthropic_impl(json_str, response);
+    ac_prof_pop();
+    return err;
+}
 
-    cJSON* obj = cJSON_CreateObject();
-    if (!obj) return NULL;
+/*============================================================================
+ * Content Block to JSON (Anthropic format)
+ *============================================================================*/
 
+static arc_err_t content_block_to_json(ac_json_writer_t* w, const ac_content_block_t* block,
+                                       int marker) {
     switch (block->type) {
         case AC_BLOCK_TEXT:
             /* Skip empty text blocks */
-            if (!block->text || strlen(block->text) == 0) {
-                cJSON_Delete(obj);
-                return NULL;
+            if (ac_block_text(block).len == 0) {
+                break;
             }
-            cJSON_AddStringToObject(obj, "type", "text");
-            cJSON_AddStringToObject(obj, "text", block->text);
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "text");
+            ac_json_write_member_str(w, "text", ac_block_text(block));
+            ac_json_write_object_end(w);
             break;
 
         case AC_BLOCK_THINKING:
@@ -550,99 +1029,1114 @@ cJSON* ac_content_block_to_json(const ac_content_block_t* block) {
              * in history for non-Anthropic endpoints.
              */
             if (!block->signature) {
-                /* Skip thinking block without signature */
-                cJSON_Delete(obj);
-                return NULL;
+                break;
             }
-            cJSON_AddStringToObject(obj, "type", "thinking");
-            if (block->text) {
-                cJSON_AddStringToObject(obj, "thinking", block->text);
-            }
-            cJSON_AddStringToObject(obj, "signature", block->signature);
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "thinking");
+            ac_json_write_member_str(w, "thinking", ac_block_text(block));
+            ac_json_write_member_string(w, "signature", block->signature);
+            ac_json_write_object_end(w);
             break;
 
         case AC_BLOCK_REDACTED_THINKING:
-            cJSON_AddStringToObject(obj, "type", "redacted_thinking");
-            if (block->data) {
-                cJSON_AddStringToObject(obj, "data", block->data);
-            }
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "redacted_thinking");
+            ac_json_write_member_string(w, "data", block->data);
+            ac_json_write_object_end(w);
             break;
 
         case AC_BLOCK_TOOL_USE:
-            cJSON_AddStringToObject(obj, "type", "tool_use");
-            if (block->id) {
-                cJSON_AddStringToObject(obj, "id", block->id);
-            }
-            if (block->name) {
-                cJSON_AddStringToObject(obj, "name", block->name);
-            }
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "tool_use");
+            ac_json_write_member_string(w, "id", block->id);
+            ac_json_write_member_string(w, "name", block->name);
             if (block->input) {
-                cJSON* input = cJSON_Parse(block->input);
-                if (input) {
-                    cJSON_AddItemToObject(obj, "input", input);
+                /* Well-formed arguments are spliced as-is, anything else
+                 * is sent as a string */
+                ac_str_t input = ac_block_input(block);
+                ac_json_write_key(w, "input");
+                if (ac_json_scan_valid(input.ptr, input.len)) {
+                    ac_json_write_raw(w, input.ptr, input.len);
                 } else {
-                    cJSON_AddStringToObject(obj, "input", block->input);
+                    ac_json_write_string_len(w, input.ptr, input.len);
                 }
             }
+            ac_json_write_object_end(w);
             break;
 
         case AC_BLOCK_TOOL_RESULT:
-            cJSON_AddStringToObject(obj, "type", "tool_result");
-            if (block->id) {
-                cJSON_AddStringToObject(obj, "tool_use_id", block->id);
-            }
-            if (block->text) {
-                cJSON_AddStringToObject(obj, "content", block->text);
-            }
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "tool_result");
+            ac_json_write_member_string(w, "tool_use_id", block->id);
+            ac_json_write_member_str(w, "content", ac_block_text(block));
             if (block->is_error) {
-                cJSON_AddBoolToObject(obj, "is_error", 1);
+                ac_json_write_member_bool(w, "is_error", 1);
             }
+            ac_json_write_object_end(w);
+            break;
+
+        case AC_BLOCK_IMAGE:
+            if (!block->attachment) {
+                break;
+            }
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "image");
+            ac_json_write_key(w, "source");
+            write_attachment(w, block->attachment, marker);
+            ac_json_write_object_end(w);
             break;
 
         default:
-            cJSON_Delete(obj);
-            return NULL;
+            break;
     }
 
-    return obj;
+    return ac_json_writer_error(w);
+}
+
+arc_err_t ac_content_block_to_json(ac_json_writer_t* w, const ac_content_block_t* block) {
+    if (!w || !block) return ARC_ERR_INVALID_ARG;
+    return content_block_to_json(w, block, 0);
 }
 
-cJSON* ac_message_to_json_anthropic(const ac_message_t* msg) {
-    if (!msg) return NULL;
+/**
+ * @brief Anthropic message, optionally without its thinking blocks
+ */
+static arc_err_t message_to_json_anthropic(ac_json_writer_t* w, const ac_message_t* msg,
+                                           int thinking, int marker) {
 
-    cJSON* obj = cJSON_CreateObject();
-    if (!obj) return NULL;
+    ac_json_write_object_begin(w);
 
     /* Role */
-    cJSON_AddStringToObject(obj, "role", ac_role_to_string(msg->role));
+    ac_json_write_member_string(w, "role", ac_role_to_string(msg->role));
 
     /* Content array */
-    cJSON* content_arr = cJSON_CreateArray();
+    ac_json_write_key(w, "content");
+    ac_json_write_array_begin(w);
 
     /* If blocks present, use them */
     if (msg->blocks) {
         for (ac_content_block_t* block = msg->blocks; block; block = block->next) {
-            cJSON* block_json = ac_content_block_to_json(block);
-            if (block_json) {
-                cJSON_AddItemToArray(content_arr, block_json);
+            if (!thinking && (block->type == AC_BLOCK_THINKING ||
+                              block->type == AC_BLOCK_REDACTED_THINKING)) {
+                continue;
             }
+            content_block_to_json(w, block, marker);
+        }
+        if (blocks_are_attachments(msg) && msg->content && msg->content[0]) {
+            /* Images first, then the text */
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "text");
+            ac_json_write_member_str(w, "text", ac_message_content(msg));
+            ac_json_write_object_end(w);
         }
     } else if (msg->role == AC_ROLE_TOOL && msg->tool_call_id && msg->content) {
         /* Tool result message */
-        cJSON* result_obj = cJSON_CreateObject();
-        cJSON_AddStringToObject(result_obj, "type", "tool_result");
-        cJSON_AddStringToObject(result_obj, "tool_use_id", msg->tool_call_id);
-        cJSON_AddStringToObject(result_obj, "content", msg->content);
-        cJSON_AddItemToArray(content_arr, result_obj);
+        ac_json_write_object_begin(w);
+        ac_json_write_member_string(w, "type", "tool_result");
+        ac_json_write_member_string(w, "tool_use_id", msg->tool_call_id);
+        ac_json_write_member_str(w, "content", ac_message_content(msg));
+        ac_json_write_object_end(w);
     } else if (msg->content) {
         /* Simple text content */
-        cJSON* text_obj = cJSON_CreateObject();
-        cJSON_AddStringToObject(text_obj, "type", "text");
-        cJSON_AddStringToObject(text_obj, "text", msg->content);
-        cJSON_AddItemToArray(content_arr, text_obj);
+        ac_json_write_object_begin(w);
+        ac_json_write_member_string(w, "type", "text");
+        ac_json_write_member_str(w, "text", ac_message_content(msg));
+        ac_json_write_object_end(w);
     }
 
-    cJSON_AddItemToObject(obj, "content", content_arr);
+    ac_json_write_array_end(w);
+    ac_json_write_object_end(w);
+    return ac_json_writer_error(w);
+}
+
+arc_err_t ac_message_to_json_anthropic(ac_json_writer_t* w, const ac_message_t* msg) {
+    if (!w || !msg) return ARC_ERR_INVALID_ARG;
+    return message_to_json_anthropic(w, msg, 1, 0);
+}
+
+/*============================================================================
+ * OpenAI Responses Format
+ *============================================================================*/
+
+arc_err_t ac_message_to_responses_items(ac_json_writer_t* w, const ac_message_t* msg) {
+    if (!w || !msg) return ARC_ERR_INVALID_ARG;
+
+    if (msg->role == AC_ROLE_TOOL) {
+        ac_json_write_object_begin(w);
+        ac_json_write_member_string(w, "type", "function_call_output");
+        ac_json_write_member_string(w, "call_id", msg->tool_call_id ? msg->tool_call_id : "");
+        ac_json_write_member_str(w, "output", msg->content ? ac_message_content(msg) : ac_str(""));
+        ac_json_write_object_end(w);
+        return ac_json_writer_error(w);
+    }
+
+    if (blocks_are_attachments(msg)) {
+        /* Inline data URLs: the Responses body is built in one piece */
+        ac_json_write_object_begin(w);
+        ac_json_write_member_string(w, "role", ac_role_to_string(msg->role));
+        ac_json_write_key(w, "content");
+        ac_json_write_array_begin(w);
+        for (const ac_content_block_t* b = msg->blocks; b; b = b->next) {
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "input_image");
+            ac_json_write_key(w, "image_url");
+            arc_err_t err = ac_attachment_write_data_url(w, b->attachment);
+            if (err != ARC_OK) {
+                return err;
+            }
+            ac_json_write_object_end(w);
+        }
+        if (msg->content && msg->content[0]) {
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "input_text");
+            ac_json_write_member_str(w, "text", ac_message_content(msg));
+            ac_json_write_object_end(w);
+        }
+        ac_json_write_array_end(w);
+        ac_json_write_object_end(w);
+    } else if (msg->content && (msg->content[0] || msg->role != AC_ROLE_ASSISTANT)) {
+        /* Assistant turns that only call tools carry no text item */
+        ac_json_write_object_begin(w);
+        ac_json_write_member_string(w, "role", ac_role_to_string(msg->role));
+        ac_json_write_member_str(w, "content", ac_message_content(msg));
+        ac_json_write_object_end(w);
+    }
+
+    if (msg->role == AC_ROLE_ASSISTANT) {
+        for (ac_tool_call_t* call = msg->tool_calls; call; call = call->next) {
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", "function_call");
+            ac_json_write_member_string(w, "call_id", call->id);
+            ac_json_write_member_string(w, "name", call->name);
+            ac_json_write_member_str(w, "arguments", call_arguments(call));
+            ac_json_write_object_end(w);
+        }
+    }
+
+    return ac_json_writer_error(w);
+}
+
+/**
+ * @brief Text of a "message" output item (output_text parts joined)
+ */
+static char* parse_responses_text(ac_chat_response_t* response, const cJSON* item,
+                                  size_t* len_out) {
+    cJSON* content = cJSON_GetObjectItem(item, "content");
+    if (!content || !cJSON_IsArray(content)) {
+        return NULL;
+    }
+
+    size_t total = 0;
+    for (cJSON* part = content->child; part; part = part->next) {
+        cJSON* text = cJSON_GetObjectItem(part, "text");
+        if (text && cJSON_IsString(text)) {
+            total += strlen(cJSON_GetStringValue(text));
+        }
+    }
+    if (total == 0) {
+        return NULL;
+    }
+
+    char* out = (char*)resp_calloc(response, total + 1);
+    if (!out) {
+        return NULL;
+    }
+    size_t off = 0;
+    for (cJSON* part = content->child; part; part = part->next) {
+        cJSON* text = cJSON_GetObjectItem(part, "text");
+        if (text && cJSON_IsString(text)) {
+            size_t len = strlen(cJSON_GetStringValue(text));
+            memcpy(out + off, cJSON_GetStringValue(text), len);
+            off += len;
+        }
+    }
+    *len_out = off;
+    return out;
+}
+
+static arc_err_t chat_response_parse_responses_impl(const char* json_str,
+                                                    ac_chat_response_t* response) {
+    if (!json_str || !response) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    resp_begin(response);
+
+    ac_cjson_scope_t scope;
+    ac_cjson_scope_begin(&scope, NULL);
+    cJSON* root = ac_cjson_scope_parse(&scope, json_str, strlen(json_str));
+    if (!root) {
+        ac_cjson_scope_end(&scope);
+        AC_LOG_ERROR("Failed to parse Responses JSON");
+        return ARC_ERR_HTTP;
+    }
+
+    /* "error" is present but null on success */
+    cJSON* error = cJSON_GetObjectItem(root, "error");
+    if (error && cJSON_IsObject(error)) {
+        cJSON* msg = cJSON_GetObjectItem(error, "message");
+        if (msg && cJSON_IsString(msg)) {
+            AC_LOG_ERROR("Responses API error: %s", cJSON_GetStringValue(msg));
+        }
+        cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
+        return ARC_ERR_HTTP;
+    }
+
+    cJSON* id = cJSON_GetObjectItem(root, "id");
+    if (id && cJSON_IsString(id)) {
+        response->id = resp_strdup(response, cJSON_GetStringValue(id));
+    }
+
+    cJSON* output = cJSON_GetObjectItem(root, "output");
+    if (output && cJSON_IsArray(output)) {
+        ac_tool_call_t* last_call = NULL;
+
+        for (cJSON* item = output->child; item; item = item->next) {
+            cJSON* type = cJSON_GetObjectItem(item, "type");
+            if (!type || !cJSON_IsString(type)) {
+                continue;
+            }
+            const char* type_str = cJSON_GetStringValue(type);
+
+            if (strcmp(type_str, "message") == 0) {
+                if (!response->content) {
+                    response->content = parse_responses_text(response, item,
+                                                              &response->content_len);
+                }
+            } else if (strcmp(type_str, "function_call") == 0) {
+                cJSON* call_id = cJSON_GetObjectItem(item, "call_id");
+                cJSON* name = cJSON_GetObjectItem(item, "name");
+                cJSON* args = cJSON_GetObjectItem(item, "arguments");
+                if (!call_id || !cJSON_IsString(call_id) || !name || !cJSON_IsString(name)) {
+                    continue;
+                }
+
+                ac_tool_call_t* call = (ac_tool_call_t*)resp_calloc(response, sizeof(ac_tool_call_t));
+                if (!call) {
+                    continue;
+                }
+                call->id = resp_ident(response, cJSON_GetStringValue(call_id));
+                call->name = resp_ident(response, cJSON_GetStringValue(name));
+                call->arguments = args && cJSON_IsString(args) ?
+                                  resp_strdup_len(response, cJSON_GetStringValue(args),
+                                                  &call->arguments_len) : NULL;
+
+                if (!response->tool_calls) {
+                    response->tool_calls = call;
+                } else {
+                    last_call->next = call;
+                }
+                last_call = call;
+                response->tool_call_count++;
+            }
+            /* Reasoning items stay on the server (store: true) */
+        }
+    }
+
+    cJSON* status = cJSON_GetObjectItem(root, "status");
+    const char* finish = "stop";
+    if (response->tool_call_count > 0) {
+        finish = "tool_calls";
+    } else if (status && cJSON_IsString(status) &&
+               strcmp(cJSON_GetStringValue(status), "incomplete") == 0) {
+        finish = "length";
+    }
+    response->finish_reason = resp_strdup(response, finish);
+
+    cJSON* usage = cJSON_GetObjectItem(root, "usage");
+    if (usage) {
+        cJSON* it = cJSON_GetObjectItem(usage, "input_tokens");
+        cJSON* ot = cJSON_GetObjectItem(usage, "output_tokens");
+        cJSON* tt = cJSON_GetObjectItem(usage, "total_tokens");
+        cJSON* in_details = cJSON_GetObjectItem(usage, "input_tokens_details");
+        cJSON* out_details = cJSON_GetObjectItem(usage, "output_tokens_details");
+
+        if (it && cJSON_IsNumber(it)) response->prompt_tokens = it->valueint;
+        if (ot && cJSON_IsNumber(ot)) response->completion_tokens = ot->valueint;
+        if (tt && cJSON_IsNumber(tt)) response->total_tokens = tt->valueint;
+
+        cJSON* cached = in_details ? cJSON_GetObjectItem(in_details, "cached_tokens") : NULL;
+        cJSON* reasoning = out_details ? cJSON_GetObjectItem(out_details, "reasoning_tokens") : NULL;
+        if (cached && cJSON_IsNumber(cached)) response->cache_read_tokens = cached->valueint;
+        if (reasoning && cJSON_IsNumber(reasoning)) response->reasoning_tokens = reasoning->valueint;
+    }
+
+    cJSON_Delete(root);
+    ac_cjson_scope_end(&scope);
+
+    response->input_tokens = response->prompt_tokens;
+    response->output_tokens = response->completion_tokens;
+
+    AC_LOG_DEBUG("Parsed Responses response: content=%s, tool_calls=%d, finish=%s",
+                 response->content ? "yes" : "no",
+                 response->tool_call_count,
+                 response->finish_reason);
+
+    return ARC_OK;
+}
+
+arc_err_t ac_chat_response_parse_responses(const char* json_str, ac_chat_response_t* response) {
+    ac_prof_push(AC_PROF_PARSE);
+    arc_err_t err = chat_response_parse_responses_impl(json_str, response);
+    ac_prof_pop();
+    return err;
+}
+
+/*============================================================================
+ * Response Record (response cache)
+ *============================================================================*/
+
+static const char* const s_block_names[] = {
+    [AC_BLOCK_TEXT] = "text",
+    [AC_BLOCK_THINKING] = "thinking",
+    [AC_BLOCK_REDACTED_THINKING] = "redacted_thinking",
+    [AC_BLOCK_REASONING] = "reasoning",
+    [AC_BLOCK_TOOL_USE] = "tool_use",
+    [AC_BLOCK_TOOL_RESULT] = "tool_result",
+    [AC_BLOCK_IMAGE] = "image",
+};
+
+static void write_member_opt(ac_json_writer_t* w, const char* key, const char* s) {
+    if (s) {
+        ac_json_write_member_string(w, key, s);
+    }
+}
+
+static void write_member_str(ac_json_writer_t* w, const char* key, const char* s, size_t len) {
+    ac_json_write_member_str(w, key, ac_str_field(s, len));
+}
+
+arc_err_t ac_chat_response_to_record(ac_json_writer_t* w, const ac_chat_response_t* response) {
+    if (!w || !response) return ARC_ERR_INVALID_ARG;
+
+    ac_json_write_object_begin(w);
+    write_member_opt(w, "id", response->id);
+    write_member_str(w, "content", response->content, response->content_len);
+    write_member_opt(w, "finish_reason", response->finish_reason);
+    write_member_opt(w, "stop_reason", response->stop_reason);
+    write_member_opt(w, "format_error", response->format_error);
+
+    if (response->blocks) {
+        ac_json_write_key(w, "blocks");
+        ac_json_write_array_begin(w);
+        for (const ac_content_block_t* b = response->blocks; b; b = b->next) {
+            ac_json_write_object_begin(w);
+            ac_json_write_member_string(w, "type", s_block_names[b->type]);
+            write_member_str(w, "text", b->text, b->text_len);
+            write_member_opt(w, "signature", b->signature);
+            write_member_opt(w, "data", b->data);
+            write_member_opt(w, "id", b->id);
+            write_member_opt(w, "name", b->name);
+            write_member_str(w, "input", b->input, b->input_len);
+            if (b->is_error) {
+                ac_json_write_member_bool(w, "is_error", 1);
+            }
+            ac_json_write_object_end(w);
+        }
+        ac_json_write_array_end(w);
+    }
+
+    if (response->tool_calls) {
+        ac_json_write_key(w, "tool_calls");
+        ac_json_write_array_begin(w);
+        for (const ac_tool_call_t* c = response->tool_calls; c; c = c->next) {
+            ac_json_write_object_begin(w);
+            write_member_opt(w, "id", c->id);
+            write_member_opt(w, "name", c->name);
+            write_member_str(w, "arguments", c->arguments, c->arguments_len);
+            ac_json_write_object_end(w);
+        }
+        ac_json_write_array_end(w);
+    }
+
+    ac_json_write_object_end(w);
+    return ac_json_writer_error(w);
+}
+
+static char* record_string(ac_chat_response_t* response, const cJSON* obj, const char* key) {
+    cJSON* item = cJSON_GetObjectItem(obj, key);
+    return item && cJSON_IsString(item) ? resp_strdup(response, cJSON_GetStringValue(item)) : NULL;
+}
+
+static char* record_string_len(ac_chat_response_t* response, const cJSON* obj, const char* key,
+                               size_t* len) {
+    cJSON* item = cJSON_GetObjectItem(obj, key);
+    return item && cJSON_IsString(item) ? resp_strdup_len(response, cJSON_GetStringValue(item), len)
+                                        : NULL;
+}
+
+static char* record_ident(ac_chat_response_t* response, const cJSON* obj, const char* key) {
+    cJSON* item = cJSON_GetObjectItem(obj, key);
+    return item && cJSON_IsString(item) ? resp_ident(response, cJSON_GetStringValue(item)) : NULL;
+}
+
+static ac_content_block_t* record_add_block(ac_chat_response_t* response,
+                                            ac_content_block_t** last,
+                                            ac_block_type_t type) {
+    ac_content_block_t* block = (ac_content_block_t*)resp_calloc(response, sizeof(*block));
+    if (block) {
+        block->type = type;
+        if (*last) {
+            (*last)->next = block;
+        } else {
+            response->blocks = block;
+        }
+        *last = block;
+        response->block_count++;
+    }
+    return block;
+}
+
+/**
+ * @brief Fill whichever view (blocks or legacy fields) a record lacks
+ *
+ * Streaming providers only build blocks, non-streaming OpenAI only the
+ * legacy fields: a record from either call style then serves both.
+ */
+static void record_fill_views(ac_chat_response_t* response) {
+    if (!response->blocks) {
+        ac_content_block_t* last = NULL;
+        if (response->content) {
+            ac_content_block_t* block = record_add_block(response, &last, AC_BLOCK_TEXT);
+            if (block) {
+                block->text_len = response->content_len;
+                block->text = resp_share_str(response, response->content, &block->text_len);
+            }
+        }
+        for (ac_tool_call_t* c = response->tool_calls; c; c = c->next) {
+            ac_content_block_t* block = record_add_block(response, &last, AC_BLOCK_TOOL_USE);
+            if (block) {
+                block->id = resp_share(response, c->id);
+                block->name = resp_share(response, c->name);
+                block->input_len = c->arguments_len;
+                block->input = resp_share_str(response, c->arguments, &block->input_len);
+            }
+        }
+        return;
+    }
+
+    int need_calls = response->tool_calls == NULL;
+    ac_tool_call_t* last_call = NULL;
+    for (ac_content_block_t* b = response->blocks; b; b = b->next) {
+        if (b->type == AC_BLOCK_TEXT && b->text && !response->content) {
+            response->content_len = b->text_len;
+            response->content = resp_share_str(response, b->text, &response->content_len);
+        } else if (b->type == AC_BLOCK_TOOL_USE && need_calls && b->id && b->name) {
+            ac_tool_call_t* call = (ac_tool_call_t*)resp_calloc(response, sizeof(*call));
+            if (!call) {
+                continue;
+            }
+            call->id = resp_share(response, b->id);
+            call->name = resp_share(response, b->name);
+            call->arguments_len = b->input_len;
+            call->arguments = resp_share_str(response, b->input, &call->arguments_len);
+            if (last_call) {
+                last_call->next = call;
+            } else {
+                response->tool_calls = call;
+            }
+            last_call = call;
+            response->tool_call_count++;
+        }
+    }
+}
+
+arc_err_t ac_chat_response_parse_record(const char* json_str, size_t len,
+                                        ac_chat_response_t* response) {
+    if (!json_str || !response) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    resp_begin(response);
+
+    ac_cjson_scope_t scope;
+    ac_cjson_scope_begin(&scope, NULL);
+    cJSON* root = ac_cjson_scope_parse(&scope, json_str, len);
+    if (!root || !cJSON_IsObject(root)) {
+        if (root) cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
+        return ARC_ERR_PARSE;
+    }
+
+    response->id = record_string(response, root, "id");
+    response->content = record_string_len(response, root, "content", &response->content_len);
+    response->finish_reason = record_string(response, root, "finish_reason");
+    response->stop_reason = record_string(response, root, "stop_reason");
+    response->format_error = record_string(response, root, "format_error");
+
+    ac_content_block_t* last_block = NULL;
+    cJSON* item = NULL;
+    cJSON_ArrayForEach(item, cJSON_GetObjectItem(root, "blocks")) {
+        cJSON* type = cJSON_GetObjectItem(item, "type");
+        const char* type_str = type && cJSON_IsString(type) ? cJSON_GetStringValue(type) : "";
+        int t = -1;
+        for (size_t i = 0; i < sizeof(s_block_names) / sizeof(s_block_names[0]); i++) {
+            if (strcmp(type_str, s_block_names[i]) == 0) {
+                t = (int)i;
+                break;
+            }
+        }
+        if (t < 0) {
+            continue;
+        }
+
+        ac_content_block_t* block = (ac_content_block_t*)resp_calloc(response, sizeof(*block));
+        if (!block) {
+            continue;
+        }
+        block->type = (ac_block_type_t)t;
+        block->text = record_string_len(response, item, "text", &block->text_len);
+        block->signature = record_string(response, item, "signature");
+        block->data = record_string(response, item, "data");
+        block->id = record_ident(response, item, "id");
+        block->name = record_ident(response, item, "name");
+        block->input = record_string_len(response, item, "input", &block->input_len);
+        block->is_error = cJSON_IsTrue(cJSON_GetObjectItem(item, "is_error"));
+
+        if (last_block) {
+            last_block->next = block;
+        } else {
+            response->blocks = block;
+        }
+        last_block = block;
+        response->block_count++;
+    }
+
+    ac_tool_call_t* last_call = NULL;
+    cJSON_ArrayForEach(item, cJSON_GetObjectItem(root, "tool_calls")) {
+        ac_tool_call_t* call = (ac_tool_call_t*)resp_calloc(response, sizeof(*call));
+        if (!call) {
+            continue;
+        }
+        call->id = record_ident(response, item, "id");
+        call->name = record_ident(response, item, "name");
+        call->arguments = record_string_len(response, item, "arguments", &call->arguments_len);
+
+        if (last_call) {
+            last_call->next = call;
+        } else {
+            response->tool_calls = call;
+        }
+        last_call = call;
+        response->tool_call_count++;
+    }
+
+    cJSON_Delete(root);
+    ac_cjson_scope_end(&scope);
+
+    record_fill_views(response);
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Request Fragment Cache
+ *============================================================================*/
+
+ARC_STATIC_ASSERT(AC_JSON_DIALECT_COUNT - 1 == AC_MESSAGE_JSON_SLOTS,
+                  "json_cache slots must match dialect count");
+
+/* Sentinel fragment: message is not part of the messages array */
+static const char s_fragment_skip[] = "";
+
+/*
+ * Thinking history: Anthropic needs the thinking blocks of the assistant
+ * messages in the active tool-use turn (everything after the last user
+ * message) sent back unmodified, signature and all. Thinking of earlier
+ * turns is dropped from context by the API, so it is not sent: it is
+ * often most of the bytes of an assistant message. A stub cannot take its
+ * place (the signature covers the text), so those messages go without.
+ *
+ * An active-turn message with thinking is encoded per request; once a
+ * later user message closes its turn, the thinking-free encoding is the
+ * one cached.
+ */
+
+/**
+ * @brief Whether a message carries thinking next to other content
+ *
+ * A message of thinking alone keeps it: an empty content array is invalid.
+ */
+static int has_strippable_thinking(const ac_message_t* msg) {
+    int thinking = 0;
+    int other = 0;
+    for (const ac_content_block_t* b = msg->blocks; b; b = b->next) {
+        if (b->type == AC_BLOCK_THINKING || b->type == AC_BLOCK_REDACTED_THINKING) {
+            thinking = 1;
+        } else if (b->type != AC_BLOCK_TEXT || (b->text && b->text[0])) {
+            other = 1;
+        }
+    }
+    return thinking && other;
+}
+
+/**
+ * @brief First message of the active turn (after the last user message)
+ */
+static const ac_message_t* active_turn(const ac_message_t* messages) {
+    const ac_message_t* start = messages;
+    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
+        if (msg->role == AC_ROLE_USER) {
+            start = msg->next;
+        }
+    }
+    return start;
+}
+
+/**
+ * @brief Encode one message for a dialect into a cleared writer
+ *
+ * @param active  Message is in the active turn (keeps its thinking)
+ */
+static arc_err_t encode_message(ac_json_writer_t* w, const ac_message_t* msg,
+                                ac_json_dialect_t dialect, int active) {
+    ac_json_writer_clear(w);
+    if (dialect == AC_JSON_DIALECT_ANTHROPIC) {
+        return message_to_json_anthropic(w, msg, active || !has_strippable_thinking(msg), 1);
+    }
+    return message_to_json(w, msg, 1);
+}
+
+/**
+ * @brief Whether a message's encoding changes once its turn is closed
+ */
+static int encoding_is_provisional(const ac_message_t* msg, ac_json_dialect_t dialect,
+                                   int active) {
+    return active && dialect == AC_JSON_DIALECT_ANTHROPIC && has_strippable_thinking(msg);
+}
+
+static int skip_message(const ac_message_t* msg, ac_json_dialect_t dialect) {
+    /* Anthropic carries the system prompt in a separate top-level field */
+    return dialect == AC_JSON_DIALECT_ANTHROPIC && msg->role == AC_ROLE_SYSTEM;
+}
+
+void ac_messages_json_prepare(
+    arena_t* arena,
+    const ac_message_t* messages,
+    ac_json_dialect_t dialect
+) {
+    if (!arena || dialect <= AC_JSON_DIALECT_NONE || dialect >= AC_JSON_DIALECT_COUNT) {
+        return;
+    }
+
+    size_t slot = (size_t)dialect - 1;
+    size_t encoded = 0;
+
+    /* One scratch buffer for every new message; only the fragment is kept */
+    ac_json_writer_t w = AC_JSON_WRITER_INIT;
+    const ac_message_t* active = active_turn(messages);
+    int in_active = 0;
+
+    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
+        in_active |= msg == active;
+        if (msg->json_cache[slot] || encoding_is_provisional(msg, dialect, in_active)) {
+            continue;
+        }
+
+        /* The cache is a memo, not message state */
+        ac_message_t* m = (ac_message_t*)msg;
+
+        if (skip_message(msg, dialect)) {
+            m->json_cache[slot] = s_fragment_skip;
+            continue;
+        }
+
+        if (encode_message(&w, msg, dialect, in_active) != ARC_OK) {
+            continue;
+        }
+
+        size_t len = ac_json_writer_len(&w);
+        char* frag = arena_alloc(arena, len + 1);
+        if (frag) {
+            memcpy(frag, ac_json_writer_data(&w), len + 1);
+            m->json_cache[slot] = frag;
+            encoded++;
+        }
+    }
+    ac_json_writer_reset(&w);
+
+    if (encoded > 0) {
+        AC_LOG_DEBUG("Encoded %zu new message fragment(s)", encoded);
+    }
+}
+
+/*============================================================================
+ * Request Body Source
+ *============================================================================*/
+
+typedef struct {
+    const char* data;
+    size_t len;
+    const ac_attachment_t* attachment; /* Set: the segment is its base64 */
+} body_segment_t;
+
+struct ac_json_body_source {
+    char** owned;                    /* Fragments encoded for this body only */
+    size_t owned_count;
+    body_segment_t* segments;
+    size_t segment_count;
+    size_t length;
+    size_t cursor;                   /* Current segment */
+    size_t offset;                   /* Bytes of it already read */
+    ac_attachment_b64_t* encoder;    /* Attachment being read (NULL: none in the body) */
+    int encoding;                    /* encoder was reset for the current segment */
+    size_t files;                    /* Attachments sent as provider file ids */
+};
+
+static void add_segment(ac_json_body_source_t* src, const char* data, size_t len) {
+    if (len > 0) {
+        src->segments[src->segment_count].data = data;
+        src->segments[src->segment_count].len = len;
+        src->segment_count++;
+        src->length += len;
+    }
+}
+
+/**
+ * @brief Whether the attachment goes out as a file id rather than its bytes
+ */
+static int sent_as_file(const ac_attachment_t* att, ac_json_dialect_t dialect) {
+    return dialect == AC_JSON_DIALECT_ANTHROPIC && att->file_id[0] && att->file_provider &&
+           strcmp(att->file_provider, "anthropic") == 0;
+}
+
+/**
+ * @brief Add the source of an attachment in place of its marker
+ */
+static void add_attachment(ac_json_body_source_t* src, const ac_attachment_t* att,
+                           ac_json_dialect_t dialect) {
+    if (dialect == AC_JSON_DIALECT_ANTHROPIC) {
+        if (sent_as_file(att, dialect)) {
+            add_segment(src, "{\"type\":\"file\",\"file_id\":\"", 26);
+            add_segment(src, att->file_id, strlen(att->file_id));
+            add_segment(src, "\"}", 2);
+            src->files++;
+            return;
+        }
+        add_segment(src, "{\"type\":\"base64\",\"media_type\":\"", 31);
+        add_segment(src, att->media_type, strlen(att->media_type));
+        add_segment(src, "\",\"data\":\"", 10);
+    } else {
+        add_segment(src, "\"data:", 6);
+        add_segment(src, att->media_type, strlen(att->media_type));
+        add_segment(src, ";base64,", 8);
+    }
+
+    src->segments[src->segment_count].attachment = att;
+    src->segments[src->segment_count].len = ac_attachment_b64_len(att);
+    src->segment_count++;
+    src->length += ac_attachment_b64_len(att);
+
+    if (dialect == AC_JSON_DIALECT_ANTHROPIC) {
+        add_segment(src, "\"}", 2);
+    } else {
+        add_segment(src, "\"", 1);
+    }
+}
+
+/**
+ * @brief Add a fragment, expanding its markers with @p msg's attachments
+ */
+static void add_fragment(ac_json_body_source_t* src, const char* data, size_t len,
+                         const ac_message_t* msg, ac_json_dialect_t dialect) {
+    const ac_content_block_t* block = msg->blocks;
+    const char* marker;
+    while ((marker = memchr(data, AC_ATTACHMENT_MARKER, len)) != NULL) {
+        while (block && (block->type != AC_BLOCK_IMAGE || !block->attachment)) {
+            block = block->next;
+        }
+        add_segment(src, data, (size_t)(marker - data));
+        if (block) {
+            add_attachment(src, block->attachment, dialect);
+            block = block->next;
+        }
+        len -= (size_t)(marker - data) + 1;
+        data = marker + 1;
+    }
+    add_segment(src, data, len);
+}
+
+/**
+ * @brief Add a fragment with the cache marker inserted before its last @p tail bytes
+ */
+static void add_marked_fragment(ac_json_body_source_t* src, const char* data, size_t len,
+                                size_t tail, const ac_message_t* msg,
+                                ac_json_dialect_t dialect) {
+    add_fragment(src, data, len - tail, msg, dialect);
+    add_segment(src, AC_JSON_CACHE_CONTROL, sizeof(AC_JSON_CACHE_CONTROL) - 1);
+    add_segment(src, data + len - tail, tail);
+}
+
+/**
+ * @brief Bytes after the last element's closing brace of a JSON array
+ *
+ * Matches "...}]" (tools) and "...}]}" (message content), trailing
+ * whitespace allowed. Returns 0 when there is no object to mark.
+ */
+static size_t marker_tail(const char* data, size_t len, int in_object) {
+    size_t i = len;
+    while (i > 0 && (data[i - 1] == ' ' || data[i - 1] == '\n' ||
+                     data[i - 1] == '\r' || data[i - 1] == '\t')) {
+        i--;
+    }
+    if (in_object) {
+        if (i == 0 || data[i - 1] != '}') return 0;
+        i--;
+    }
+    if (i == 0 || data[i - 1] != ']') return 0;
+    i--;
+    if (i == 0 || data[i - 1] != '}') return 0;
+    return len - (i - 1);
+}
+
+ac_json_body_source_t* ac_json_body_source_create(
+    const char* fields,
+    const ac_message_t* messages,
+    ac_json_dialect_t dialect,
+    const char* tools_json,
+    unsigned cache
+) {
+    if (!fields || fields[0] != '{' || dialect <= AC_JSON_DIALECT_NONE || dialect >= AC_JSON_DIALECT_COUNT) {
+        return NULL;
+    }
+
+    size_t slot = (size_t)dialect - 1;
+
+    ac_json_body_source_t* src = (ac_json_body_source_t*)ARC_CALLOC(1, sizeof(*src));
+    if (!src) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    size_t attachments = 0;
+    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
+        count++;
+        for (const ac_content_block_t* b = msg->blocks; b; b = b->next) {
+            if (b->type != AC_BLOCK_IMAGE || !b->attachment) {
+                continue;
+            }
+            /* Fail now rather than midway through the upload */
+            if (!sent_as_file(b->attachment, dialect) &&
+                ac_attachment_check(b->attachment) != ARC_OK) {
+                ac_json_body_source_free(src);
+                return NULL;
+            }
+            attachments++;
+        }
+    }
+
+    /* prefix, (separator + fragment) per message, "]", tools key + array,
+     * fields, plus two extra segments per cache marker and six per attachment */
+    src->segments = (body_segment_t*)ARC_CALLOC(2 * count + 10 + 6 * attachments,
+                                                sizeof(body_segment_t));
+    src->owned = count > 0 ? (char**)ARC_CALLOC(count, sizeof(char*)) : NULL;
+    src->encoder = attachments > 0 ? (ac_attachment_b64_t*)ARC_CALLOC(1, sizeof(ac_attachment_b64_t)) : NULL;
+    if (!src->segments || (count > 0 && !src->owned) || (attachments > 0 && !src->encoder)) {
+        ac_json_body_source_free(src);
+        return NULL;
+    }
+
+    add_segment(src, "{\"messages\":[", 13);
+
+    ac_json_writer_t w = AC_JSON_WRITER_INIT;
+    int first = 1;
+    const char* newest = NULL;       /* Held back until the end for the marker */
+    const ac_message_t* newest_msg = NULL;
+    const ac_message_t* active = active_turn(messages);
+    int in_active = 0;
+    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
+        in_active |= msg == active;
+        const char* frag = msg->json_cache[slot];
+        if (!frag) {
+            if (skip_message(msg, dialect)) {
+                continue;
+            }
+            /* Not cached: encoded now and kept only for this body */
+            encode_message(&w, msg, dialect, in_active);
+            char* json = ac_json_writer_take(&w);
+            if (!json) {
+                continue;
+            }
+            src->owned[src->owned_count++] = json;
+            frag = json;
+        }
+        if (frag[0]) {
+            if (newest) {
+                add_fragment(src, newest, strlen(newest), newest_msg, dialect);
+            }
+            if (!first) {
+                add_segment(src, ",", 1);
+            }
+            first = 0;
+            newest = frag;
+            newest_msg = msg;
+        }
+    }
+    if (newest) {
+        size_t len = strlen(newest);
+        size_t tail = (cache & AC_JSON_CACHE_MESSAGES) ? marker_tail(newest, len, 1) : 0;
+        if (tail) {
+            add_marked_fragment(src, newest, len, tail, newest_msg, dialect);
+        } else {
+            add_fragment(src, newest, len, newest_msg, dialect);
+        }
+    }
+    add_segment(src, "]", 1);
+
+    /* Pre-serialized tools array, sent verbatim */
+    if (tools_json && tools_json[0]) {
+        size_t len = strlen(tools_json);
+        size_t tail = (cache & AC_JSON_CACHE_TOOLS) ? marker_tail(tools_json, len, 0) : 0;
+        add_segment(src, ",\"tools\":", 9);
+        if (tail) {
+            add_segment(src, tools_json, len - tail);
+            add_segment(src, AC_JSON_CACHE_CONTROL, sizeof(AC_JSON_CACHE_CONTROL) - 1);
+            add_segment(src, tools_json + len - tail, tail);
+        } else {
+            add_segment(src, tools_json, len);
+        }
+    }
+
+    /* Remaining top-level fields: "{...}" */
+    size_t fields_len = strlen(fields);
+    if (fields_len > 2) {
+        add_segment(src, ",", 1);
+        add_segment(src, fields + 1, fields_len - 1);
+    } else {
+        add_segment(src, "}", 1);
+    }
+
+    for (const ac_message_t* msg = messages; msg && attachments > 0; msg = msg->next) {
+        for (ac_content_block_t* b = msg->blocks; b; b = b->next) {
+            if (b->type == AC_BLOCK_IMAGE && b->attachment) {
+                b->attachment->sends++;
+            }
+        }
+    }
+
+    return src;
+}
+
+size_t ac_json_body_source_length(const ac_json_body_source_t* src) {
+    return src ? src->length : 0;
+}
+
+size_t ac_json_body_source_files(const ac_json_body_source_t* src) {
+    return src ? src->files : 0;
+}
+
+size_t ac_json_body_source_read(char* buf, size_t size, void* source) {
+    ac_json_body_source_t* src = (ac_json_body_source_t*)source;
+    size_t done = 0;
+
+    while (done < size && src->cursor < src->segment_count) {
+        const body_segment_t* seg = &src->segments[src->cursor];
+        size_t n = seg->len - src->offset;
+        if (n > size - done) {
+            n = size - done;
+        }
+        if (seg->attachment) {
+            if (!src->encoding) {
+                ac_attachment_b64_reset(src->encoder, seg->attachment);
+                src->encoding = 1;
+            }
+            if (ac_attachment_b64_read(src->encoder, buf + done, n) != n) {
+                return ARC_HTTP_BODY_ABORT;
+            }
+        } else {
+            memcpy(buf + done, seg->data + src->offset, n);
+        }
+        done += n;
+        src->offset += n;
+        if (src->offset == seg->len) {
+            if (src->encoding) {
+                ac_attachment_reader_close(&src->encoder->in);
+                src->encoding = 0;
+            }
+            src->cursor++;
+            src->offset = 0;
+        }
+    }
+    return done;
+}
+
+void ac_json_body_source_rewind(void* source) {
+    ac_json_body_source_t* src = (ac_json_body_source_t*)source;
+    if (src) {
+        src->cursor = 0;
+        src->offset = 0;
+        if (src->encoding) {
+            ac_attachment_reader_close(&src->encoder->in);
+            src->encoding = 0;
+        }
+    }
+}
+
+char* ac_json_body_source_flatten(ac_json_body_source_t* src) {
+    if (!src) {
+        return NULL;
+    }
+    char* body = (char*)ARC_MALLOC(src->length + 1);
+    if (body) {
+        ac_json_body_source_rewind(src);
+        size_t n = ac_json_body_source_read(body, src->length, src);
+        ac_json_body_source_rewind(src);
+        if (n == ARC_HTTP_BODY_ABORT) {
+            ARC_FREE(body);
+            return NULL;
+        }
+        body[n] = '\0';
+    }
+    return body;
+}
+
+void ac_json_body_source_free(ac_json_body_source_t* src) {
+    if (!src) {
+        return;
+    }
+    for (size_t i = 0; i < src->owned_count; i++) {
+        ARC_FREE(src->owned[i]);
+    }
+    ARC_FREE(src->owned);
+    ARC_FREE(src->segments);
+    if (src->encoder) {
+        ac_attachment_reader_close(&src->encoder->in);
+        ARC_FREE(src->encoder);
+    }
+    ARC_FREE(src);
+}
+
+char* ac_json_body_with_messages(
+    const char* fields,
+    const ac_message_t* messages,
+    ac_json_dialect_t dialect,
+    const char* tools_json,
+    unsigned cache
+) {
+    ac_json_body_source_t* src = ac_json_body_source_create(fields, messages, dialect, tools_json, cache);
+    char* body = ac_json_body_source_flatten(src);
+    ac_json_body_source_free(src);
+    return body;
+}
+
+static const char* skip_json_ws(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+        p++;
+    }
+    return p;
+}
+
+int ac_tools_json_is_anthropic(const char* tools_json) {
+    if (!tools_json) {
+        return 0;
+    }
 
-    return obj;
+    /* Registry output in Anthropic format opens each element with "name";
+     * anything else takes the converting path */
+    const char* p = skip_json_ws(tools_json);
+    if (*p++ != '[') return 0;
+    p = skip_json_ws(p);
+    if (*p++ != '{') return 0;
+    p = skip_json_ws(p);
+    return strncmp(p, "\"name\"", 6) == 0;
 }
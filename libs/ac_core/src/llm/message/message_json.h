@@ -3,13 +3,17 @@
  * @brief Message JSON serialization/deserialization
  *
  * Handles conversion between ac_message_t and JSON format for LLM APIs.
+ * Requests are written directly with ac_json_writer_t; responses are
+ * parsed with cJSON.
  */
 
 #ifndef ARC_MESSAGE_JSON_H
 #define ARC_MESSAGE_JSON_H
 
 #include "arc/message.h"
+#include "arc/arena.h"
 #include "cJSON.h"
+#include "json_writer.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,26 +24,28 @@ extern "C" {
  *============================================================================*/
 
 /**
- * @brief Convert message to JSON object
+ * @brief Write message as a JSON object
  *
- * Creates a JSON object suitable for OpenAI-compatible API:
+ * Writes a JSON object suitable for OpenAI-compatible API:
  * - role: "system" | "user" | "assistant" | "tool"
  * - content: message text
  * - tool_call_id: (for tool messages) which call this responds to
  * - tool_calls: (for assistant messages) array of tool calls
  *
- * @param msg Message to convert
- * @return cJSON object (caller owns), NULL on error
+ * @param w   Writer, positioned where a value may go
+ * @param msg Message to write
+ * @return ARC_OK, or the writer's error
  */
-cJSON* ac_message_to_json(const ac_message_t* msg);
+arc_err_t ac_message_to_json(ac_json_writer_t* w, const ac_message_t* msg);
 
 /**
- * @brief Convert tool call to JSON object
+ * @brief Write tool call as a JSON object
  *
- * @param call Tool call to convert
- * @return cJSON object (caller owns), NULL on error
+ * @param w    Writer, positioned where a value may go
+ * @param call Tool call to write
+ * @return ARC_OK, or the writer's error
  */
-cJSON* ac_tool_call_to_json(const ac_tool_call_t* call);
+arc_err_t ac_tool_call_to_json(ac_json_writer_t* w, const ac_tool_call_t* call);
 
 /*============================================================================
  * Message List Serialization
@@ -118,24 +124,230 @@ arc_err_t ac_chat_response_parse_anthropic(const char* json_str, ac_chat_respons
  *============================================================================*/
 
 /**
- * @brief Convert content block to JSON object (Anthropic format)
+ * @brief Write content block as a JSON object (Anthropic format)
  *
+ * Blocks the API would reject (empty text, unsigned thinking) write
+ * nothing. Tool input that is well-formed JSON is spliced verbatim.
+ *
+ * @param w     Writer, positioned where a value may go
  * @param block Content block
- * @return cJSON object (caller owns), NULL on error
+ * @return ARC_OK, or the writer's error
  */
-cJSON* ac_content_block_to_json(const ac_content_block_t* block);
+arc_err_t ac_content_block_to_json(ac_json_writer_t* w, const ac_content_block_t* block);
 
 /**
- * @brief Convert message to JSON object (Anthropic format)
+ * @brief Write message as a JSON object (Anthropic format)
  *
- * Creates a JSON object suitable for Anthropic API with content array:
+ * Writes a JSON object suitable for Anthropic API with content array:
  * - role: "user" | "assistant"
  * - content: array of content blocks
  *
- * @param msg Message to convert
- * @return cJSON object (caller owns), NULL on error
+ * @param w   Writer, positioned where a value may go
+ * @param msg Message to write
+ * @return ARC_OK, or the writer's error
+ */
+arc_err_t ac_message_to_json_anthropic(ac_json_writer_t* w, const ac_message_t* msg);
+
+/*============================================================================
+ * OpenAI Responses Format
+ *============================================================================*/
+
+/**
+ * @brief Write a message as Responses API input items
+ *
+ * A message maps to zero or more items of the "input" array:
+ * - system/user/assistant text: {"role": ..., "content": "..."}
+ * - assistant tool calls: one {"type": "function_call", ...} per call
+ * - tool result: {"type": "function_call_output", "call_id": ..., "output": ...}
+ *
+ * @param w   Writer, positioned inside an array
+ * @param msg Message to write
+ * @return ARC_OK, or the writer's error
+ */
+arc_err_t ac_message_to_responses_items(ac_json_writer_t* w, const ac_message_t* msg);
+
+/**
+ * @brief Parse OpenAI Responses API response JSON into ac_chat_response_t
+ *
+ * Handles the "output" item list:
+ * {
+ *   "id": "resp_...",
+ *   "status": "completed" | "incomplete",
+ *   "output": [
+ *     { "type": "message", "content": [{ "type": "output_text", "text": "..." }] },
+ *     { "type": "function_call", "call_id": "...", "name": "...", "arguments": "..." }
+ *   ],
+ *   "usage": { "input_tokens": N, "output_tokens": N, ... }
+ * }
+ *
+ * finish_reason is synthesized: "tool_calls", "length" (incomplete) or "stop".
+ *
+ * @param json_str Raw JSON response string
+ * @param response Output structure (caller must init and free)
+ * @return ARC_OK on success
+ */
+arc_err_t ac_chat_response_parse_responses(const char* json_str, ac_chat_response_t* response);
+
+/*============================================================================
+ * Response Record (response cache)
+ *============================================================================*/
+
+/**
+ * @brief Write a parsed response as a provider-neutral JSON record
+ *
+ * Keeps every content block (including signatures) and the legacy
+ * content/tool_calls fields; usage and transport fields are left out.
+ * Parsing fills whichever of the two views the record lacks.
+ *
+ * @param w        Writer, positioned where a value may go
+ * @param response Response to write
+ * @return ARC_OK, or the writer's error
+ */
+arc_err_t ac_chat_response_to_record(ac_json_writer_t* w, const ac_chat_response_t* response);
+
+/**
+ * @brief Rebuild a response from ac_chat_response_to_record() output
+ *
+ * @param json_str Record bytes
+ * @param len      Record length
+ * @param response Output structure (caller must init and free)
+ * @return ARC_OK, ARC_ERR_PARSE if the record is malformed
+ */
+arc_err_t ac_chat_response_parse_record(const char* json_str, size_t len,
+                                        ac_chat_response_t* response);
+
+/*============================================================================
+ * Request Fragment Cache
+ *============================================================================*/
+
+/**
+ * @brief Wire dialect of a serialized message
+ */
+typedef enum {
+    AC_JSON_DIALECT_NONE = 0,        /**< Provider builds its own body */
+    AC_JSON_DIALECT_OPENAI,          /**< ac_message_to_json() */
+    AC_JSON_DIALECT_ANTHROPIC,       /**< ac_message_to_json_anthropic(), no system */
+    AC_JSON_DIALECT_COUNT
+} ac_json_dialect_t;
+
+/**
+ * @brief Serialize messages that have no cached fragment yet
+ *
+ * Called by the LLM layer before each request. Fragments are stored in
+ * msg->json_cache and allocated from @p arena, so per-turn serialization
+ * cost is proportional to the newly appended messages only.
+ *
+ * Anthropic: thinking blocks are sent for the active tool-use turn only
+ * (after the last user message). Its assistant messages that carry
+ * thinking stay uncached until a user message closes the turn.
+ *
+ * @param arena    Arena owning the messages (agent arena)
+ * @param messages Head of message list
+ * @param dialect  Wire dialect
+ */
+void ac_messages_json_prepare(
+    arena_t* arena,
+    const ac_message_t* messages,
+    ac_json_dialect_t dialect
+);
+
+/**
+ * @name Cache breakpoints
+ *
+ * A cache_control marker is inserted into the last element (last tool,
+ * last content block of the newest message) while the body is assembled,
+ * so the cached fragments themselves never change.
+ * @{
+ */
+#define AC_JSON_CACHE_TOOLS     0x1u     /**< Marker on the last tool */
+#define AC_JSON_CACHE_MESSAGES  0x2u     /**< Marker on the newest message */
+/** @} */
+
+/** Marker members, appended inside the marked object */
+#define AC_JSON_CACHE_CONTROL   ",\"cache_control\":{\"type\":\"ephemeral\"}"
+
+/**
+ * @brief Build request body from top-level fields plus message fragments
+ *
+ * Produces {"messages":[...],"tools":...,<members of fields>}. Cached
+ * fragments and @p tools_json are copied verbatim; messages without a
+ * fragment are encoded on the fly (not cached). @p fields must not contain
+ * "messages" or "tools" members.
+ *
+ * @param fields     Top-level request fields, a serialized JSON object
+ * @param messages   Head of message list
+ * @param dialect    Wire dialect
+ * @param tools_json Serialized tools array in the dialect's format (NULL = none)
+ * @param cache      AC_JSON_CACHE_* breakpoints to splice in (Anthropic only)
+ * @return Body string (caller must ARC_FREE), NULL on error
+ */
+char* ac_json_body_with_messages(
+    const char* fields,
+    const ac_message_t* messages,
+    ac_json_dialect_t dialect,
+    const char* tools_json,
+    unsigned cache
+);
+
+/**
+ * @brief Request body produced piecewise from message fragments
+ *
+ * Same bytes as ac_json_body_with_messages(), read out segment by segment
+ * (cached fragments, tools_json and the top-level fields are referenced,
+ * not copied), so a large context is never held twice. The messages,
+ * @p fields and @p tools_json must outlive the source.
+ */
+typedef struct ac_json_body_source ac_json_body_source_t;
+
+/**
+ * @brief Create a body source (arguments as for ac_json_body_with_messages)
+ * @return Source (free with ac_json_body_source_free), NULL on error
+ */
+ac_json_body_source_t* ac_json_body_source_create(
+    const char* fields,
+    const ac_message_t* messages,
+    ac_json_dialect_t dialect,
+    const char* tools_json,
+    unsigned cache
+);
+
+/** @brief Total body length in bytes */
+size_t ac_json_body_source_length(const ac_json_body_source_t* src);
+
+/** @brief Number of attachments the body references by provider file id */
+size_t ac_json_body_source_files(const ac_json_body_source_t* src);
+
+/**
+ * @brief Copy the next bytes of the body (arc_http_body_read_fn)
+ *
+ * Image attachments are base64-encoded here, a chunk at a time.
+ *
+ * @return Bytes copied, 0 at the end, ARC_HTTP_BODY_ABORT if an attached
+ *         file can no longer be read
+ */
+size_t ac_json_body_source_read(char* buf, size_t size, void* source);
+
+/** @brief Start reading from the beginning again (arc_http_body_rewind_fn) */
+void ac_json_body_source_rewind(void* source);
+
+/**
+ * @brief Whole body as one string (read position is left at the start)
+ * @return Body (caller must ARC_FREE), NULL on error
+ */
+char* ac_json_body_source_flatten(ac_json_body_source_t* src);
+
+void ac_json_body_source_free(ac_json_body_source_t* src);
+
+/**
+ * @brief Check whether a tools string is already in Anthropic format
+ *
+ * Cheap prefix test (first key of the first element is "name"), used to
+ * splice registry output directly instead of converting OpenAI format.
+ *
+ * @param tools_json Tools JSON array string
+ * @return 1 if the bytes can be sent as-is, 0 otherwise
  */
-cJSON* ac_message_to_json_anthropic(const ac_message_t* msg);
+int ac_tools_json_is_anthropic(const char* tools_json);
 
 #ifdef __cplusplus
 }
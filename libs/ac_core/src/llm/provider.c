@@ -5,60 +5,64 @@
 
 #include "llm_provider.h"
 #include "arc/log.h"
+#include "arc/platform.h"
 #include <string.h>
 
 /*============================================================================
- * Provider Registry
+ * Built-in Providers
+ *
+ * Fixed by the ARC_FEATURE_* switches: a const table, nothing registered
+ * at startup and nothing to race on at first use.
  *============================================================================*/
 
-#define MAX_PROVIDERS 32
-
 typedef struct {
     const char* name;
     const ac_llm_ops_t* ops;
 } provider_entry_t;
 
-static provider_entry_t s_providers[MAX_PROVIDERS];
-static int s_provider_count = 0;
-static int s_providers_initialized = 0;
-
-/*============================================================================
- * Built-in Provider Forward Declarations
- *============================================================================*/
-
 /* These are defined in provider implementation files */
+#if ARC_FEATURE_OPENAI
 extern const ac_llm_ops_t openai_ops;
+#endif
+#if ARC_FEATURE_ANTHROPIC
 extern const ac_llm_ops_t anthropic_ops;
+#endif
+#if ARC_FEATURE_STATEFUL
+extern const ac_llm_ops_t openai_responses_ops;
+#endif
+
+static const provider_entry_t s_builtin_providers[] = {
+#if ARC_FEATURE_OPENAI
+    { "openai", &openai_ops },
+#endif
+#if ARC_FEATURE_ANTHROPIC
+    { "anthropic", &anthropic_ops },
+#endif
+#if ARC_FEATURE_STATEFUL
+    { "openai_responses", &openai_responses_ops },
+#endif
+    { NULL, NULL }              /* Keeps the table valid with every provider off */
+};
+
+static const ac_llm_ops_t* find_builtin(const char *name) {
+    for (const provider_entry_t* e = s_builtin_providers; e->name; e++) {
+        if (strcmp(e->name, name) == 0) {
+            return e->ops;
+        }
+    }
+    return NULL;
+}
 
 /*============================================================================
- * Provider Initialization
+ * Provider Registry (custom providers, ARC_FEATURE_PROVIDER_REGISTRY)
  *============================================================================*/
 
-/**
- * @brief Initialize built-in providers
- *
- * This is called lazily on first use to ensure built-in providers
- * are registered even in static library builds where constructors
- * may not execute automatically.
- */
-static void ac_llm_init_builtin_providers(void) {
-    if (s_providers_initialized) {
-        return;
-    }
+#if ARC_FEATURE_PROVIDER_REGISTRY
 
-    /* Register built-in providers manually */
-    /* Note: AC_PROVIDER_REGISTER macro uses constructor attribute which may not
-     * work reliably in static library builds, so we manually register here */
-    ac_llm_register_provider("openai", &openai_ops);
-    ac_llm_register_provider("anthropic", &anthropic_ops);
-
-    s_providers_initialized = 1;
-    AC_LOG_DEBUG("Built-in providers initialized (openai, anthropic)");
-}
+#define MAX_PROVIDERS 32
 
-/*============================================================================
- * Provider Registration
- *============================================================================*/
+static provider_entry_t s_providers[MAX_PROVIDERS];
+static int s_provider_count = 0;
 
 void ac_llm_register_provider(const char *name, const ac_llm_ops_t *ops) {
     if (!name || !ops) {
@@ -72,6 +76,10 @@ void ac_llm_register_provider(const char *name, const ac_llm_ops_t *ops) {
     }
 
     // Check for duplicates
+    if (find_builtin(name)) {
+        AC_LOG_WARN("Provider '%s' is built in, skipping", name);
+        return;
+    }
     for (int i = 0; i < s_provider_count; i++) {
         if (strcmp(s_providers[i].name, name) == 0) {
             AC_LOG_WARN("Provider '%s' already registered, skipping", name);
@@ -86,6 +94,8 @@ void ac_llm_register_provider(const char *name, const ac_llm_ops_t *ops) {
     AC_LOG_DEBUG("Provider registered: %s", name);
 }
 
+#endif /* ARC_FEATURE_PROVIDER_REGISTRY */
+
 /*============================================================================
  * Provider Lookup
  *============================================================================*/
@@ -95,11 +105,18 @@ const ac_llm_ops_t* ac_llm_find_provider_by_name(const char *name) {
         return NULL;
     }
 
+    const ac_llm_ops_t* ops = find_builtin(name);
+    if (ops) {
+        return ops;
+    }
+
+#if ARC_FEATURE_PROVIDER_REGISTRY
     for (int i = 0; i < s_provider_count; i++) {
         if (strcmp(s_providers[i].name, name) == 0) {
             return s_providers[i].ops;
         }
     }
+#endif
 
     return NULL;
 }
@@ -109,10 +126,6 @@ const ac_llm_ops_t* ac_llm_find_provider(const ac_llm_params_t* params) {
         return NULL;
     }
 
-    /* Ensure built-in providers are registered */
-    /* TODO: need fix this , provide a reliab way to regiser providers*/
-    ac_llm_init_builtin_providers();
-
     if (params->provider == NULL) {
         AC_LOG_ERROR("Please set llm provider");
     }
@@ -13,10 +13,18 @@
  */
 
 #include "../llm_provider.h"
+#include "../ratelimit.h"
+#include "../batch.h"
 #include "../message/message_json.h"
+#include "../message/attachment.h"
+#include "strbuf.h"
+#include "json_scan.h"
+#include "json_stream.h"
+#include "json_writer.h"
 #include "arc/sse_parser.h"
 #include "arc/message.h"
 #include "arc/platform.h"
+#include "arc/profile.h"
 #include "arc/log.h"
 #include "http_client.h"
 #include "cJSON.h"
@@ -25,6 +33,8 @@
 
 #define ANTHROPIC_API_VERSION "2023-06-01"
 #define ANTHROPIC_THINKING_MIN_BUDGET 1024
+#define ANTHROPIC_FILES_BETA "files-api-2025-04-14"
+#define ANTHROPIC_UPLOAD_BOUNDARY "arc-attachment-9f3b1c7e5d2a4068"
 
 /*============================================================================
  * HTTP Pool Integration (weak symbols for optional linking)
@@ -33,6 +43,8 @@
 /* Weak declarations - resolved at link time if ac_hosted is linked */
 __attribute__((weak)) int ac_http_pool_is_initialized(void);
 __attribute__((weak)) arc_http_client_t *ac_http_pool_acquire(uint32_t timeout_ms);
+__attribute__((weak)) arc_http_client_t *ac_http_pool_acquire_priority(
+    uint32_t timeout_ms, ac_priority_t priority);
 __attribute__((weak)) void ac_http_pool_release(arc_http_client_t *client);
 
 /**
@@ -49,8 +61,183 @@ static int http_pool_available(void) {
 typedef struct {
     arc_http_client_t *http;  /**< Owned HTTP client (NULL if using pool) */
     int owns_http;               /**< 1 if we created the client, 0 if from pool */
+    arc_http_header_set_t *headers; /**< Static request headers, built once */
+    char *messages_url;             /**< api_base + /v1/messages, built once */
 } anthropic_priv_t;
 
+static const char* anthropic_api_base(const ac_llm_params_t* params) {
+    return params->api_base ? params->api_base : "https://api.anthropic.com";
+}
+
+/**
+ * @brief Format the per-provider headers (key and version never change)
+ */
+static arc_http_header_set_t* anthropic_headers_create(const ac_llm_params_t* params) {
+    arc_http_header_t content_type = {
+        .name = "Content-Type", .value = "application/json; charset=utf-8" };
+    arc_http_header_t api_key = {
+        .name = "x-api-key", .value = params->api_key ? params->api_key : "" };
+    arc_http_header_t version = {
+        .name = "anthropic-version", .value = ANTHROPIC_API_VERSION };
+    content_type.next = &api_key;
+    api_key.next = &version;
+
+    arc_http_header_set_t* set = NULL;
+    arc_http_header_set_create(&content_type, &set);
+    return set;
+}
+
+/*============================================================================
+ * Attachment Upload
+ *
+ * An image is inlined the first time it is sent. Sent again (the usual
+ * case: it stays in history), it is first uploaded to the files API and
+ * referenced by id, so later bodies carry a few bytes instead of the
+ * base64. A failed upload leaves the image inline for good.
+ *============================================================================*/
+
+/** Header that the files API, and messages referencing a file, need */
+static arc_http_header_t s_files_beta = { .name = "anthropic-beta", .value = ANTHROPIC_FILES_BETA };
+
+static int file_id_valid(const char* id, size_t len) {
+    if (len == 0 || len >= AC_ATTACHMENT_FILE_ID_MAX) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        char c = id[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '_' || c == '-')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static arc_err_t upload_attachment(arc_http_client_t* http, const ac_llm_params_t* params,
+                                   ac_attachment_t* att) {
+    /* Base name, reduced to characters that need no quoting */
+    char filename[64];
+    const char* base = att->path ? att->path : "image";
+    for (const char* p = base; *p; p++) {
+        if (*p == '/' || *p == '\\') {
+            base = p + 1;
+        }
+    }
+    size_t n = 0;
+    for (; base[n] && n + 1 < sizeof(filename); n++) {
+        char c = base[n];
+        int plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    (c >= '0' && c <= '9') || c == '.' || c == '_' || c == '-';
+        filename[n] = plain ? c : '_';
+    }
+    filename[n] = '\0';
+
+    char head[256];
+    snprintf(head, sizeof(head),
+             "--" ANTHROPIC_UPLOAD_BOUNDARY "\r\n"
+             "Content-Disposition: form-data; name=\"file\"; filename=\"%s\"\r\n"
+             "Content-Type: %s\r\n\r\n",
+             filename[0] ? filename : "image", att->media_type);
+    ac_attachment_upload_t upload = {
+        .head = head,
+        .tail = "\r\n--" ANTHROPIC_UPLOAD_BOUNDARY "--\r\n",
+    };
+    ac_attachment_reader_reset(&upload.in, att);
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/v1/files", anthropic_api_base(params));
+    arc_http_header_t content_type = {
+        .name = "Content-Type", .value = "multipart/form-data; boundary=" ANTHROPIC_UPLOAD_BOUNDARY };
+    arc_http_header_t api_key = {
+        .name = "x-api-key", .value = params->api_key ? params->api_key : "" };
+    arc_http_header_t version = {
+        .name = "anthropic-version", .value = ANTHROPIC_API_VERSION };
+    arc_http_header_t beta = s_files_beta;
+    content_type.next = &api_key;
+    api_key.next = &version;
+    version.next = &beta;
+
+    arc_http_request_t req = {
+        .url = url,
+        .method = ARC_HTTP_POST,
+        .headers = &content_type,
+        .body_len = ac_attachment_upload_length(&upload),
+        .timeout_ms = params->timeout_ms > 0 ? params->timeout_ms : 60000,
+        .verify_ssl = 1,
+        .cancel = params->cancel,
+        .body_read = ac_attachment_upload_read,
+        .body_rewind = ac_attachment_upload_rewind,
+        .body_user_data = &upload,
+    };
+
+    arc_http_response_t http_resp = {0};
+    arc_err_t err = arc_http_request(http, &req, &http_resp);
+    ac_attachment_reader_close(&upload.in);
+
+    if (err == ARC_OK && http_resp.status_code != 200) {
+        AC_LOG_WARN("Anthropic file upload HTTP %d: %s", http_resp.status_code,
+            http_resp.body ? http_resp.body : "");
+        err = ARC_ERR_HTTP;
+    }
+    if (err == ARC_OK) {
+        const char* body = http_resp.body ? http_resp.body : "";
+        ac_json_span_t id = ac_json_scan_get(ac_json_scan_root(body, strlen(body)), "id");
+        size_t id_len = id.kind == AC_JSON_STRING ? (size_t)(id.end - id.start) - 2 : 0;
+        if (id_len > 0 && file_id_valid(id.start + 1, id_len)) {
+            memcpy(att->file_id, id.start + 1, id_len);
+            att->file_id[id_len] = '\0';
+            att->file_provider = "anthropic";
+        } else {
+            err = ARC_ERR_PARSE;
+        }
+    }
+    arc_http_response_free(&http_resp);
+    return err;
+}
+
+/**
+ * @brief Whether an image is about to be sent a second time (or more) inline
+ */
+static int attachment_needs_upload(ac_attachment_t* att) {
+    return att && att->sends > 0 && !att->file_id[0] && !att->upload_failed &&
+           ac_attachment_check(att) == ARC_OK;
+}
+
+/**
+ * @brief Upload the images about to be sent a second time (or more)
+ */
+static void upload_attachments(arc_http_client_t* http, const ac_llm_params_t* params,
+                               const ac_message_t* messages) {
+    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
+        for (ac_content_block_t* b = msg->blocks; b; b = b->next) {
+            ac_attachment_t* att = b->type == AC_BLOCK_IMAGE ? b->attachment : NULL;
+            if (!attachment_needs_upload(att)) {
+                continue;
+            }
+            arc_err_t err = upload_attachment(http, params, att);
+            if (err != ARC_OK) {
+                AC_LOG_WARN("Anthropic: upload of %s failed (%d), sending it inline",
+                            att->path ? att->path : "image", err);
+                att->upload_failed = 1;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Whether upload_attachments() has work to do before the request
+ */
+static int uploads_pending(const ac_message_t* messages) {
+    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
+        for (ac_content_block_t* b = msg->blocks; b; b = b->next) {
+            if (b->type == AC_BLOCK_IMAGE && attachment_needs_upload(b->attachment)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 /*============================================================================
  * Provider Implementation
  *============================================================================*/
@@ -127,6 +314,137 @@ static cJSON* convert_tools_to_anthropic(const char* tools_json) {
     return output;
 }
 
+/**
+ * @brief Write the "system" field from the first system message
+ *
+ * With prompt caching on, the prompt is sent as a text block carrying a
+ * cache breakpoint, so it is cached independently of the history.
+ */
+static void write_system(ac_json_writer_t* jw, const ac_llm_params_t* params,
+                         const ac_message_t* messages) {
+    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
+        if (msg->role != AC_ROLE_SYSTEM || !msg->content) {
+            continue;
+        }
+        if (params->prompt_cache == AC_PROMPT_CACHE_OFF) {
+            ac_json_write_member_str(jw, "system", ac_message_content(msg));
+        } else {
+            ac_json_write_key(jw, "system");
+            ac_json_write_array_begin(jw);
+            ac_json_write_object_begin(jw);
+            ac_json_write_member_string(jw, "type", "text");
+            ac_json_write_member_str(jw, "text", ac_message_content(msg));
+            ac_json_write_key(jw, "cache_control");
+            ac_json_write_object_begin(jw);
+            ac_json_write_member_string(jw, "type", "ephemeral");
+            ac_json_write_object_end(jw);
+            ac_json_write_object_end(jw);
+            ac_json_write_array_end(jw);
+        }
+        break;  /* Use first system message only */
+    }
+}
+
+/**
+ * @brief Breakpoints spliced into the body for the cache policy
+ */
+static unsigned cache_breakpoints(const ac_llm_params_t* params) {
+    switch (params->prompt_cache) {
+        case AC_PROMPT_CACHE_AUTO:
+            return AC_JSON_CACHE_TOOLS | AC_JSON_CACHE_MESSAGES;
+        case AC_PROMPT_CACHE_STATIC:
+            return AC_JSON_CACHE_TOOLS;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Top-level body fields; messages and tools are spliced in by the body source
+ *
+ * @return Fields object (ARC_FREE), NULL on error
+ */
+static char* anthropic_request_fields(const ac_llm_params_t* params,
+                                      const ac_message_t* messages, int stream) {
+    ac_json_writer_t jw = AC_JSON_WRITER_INIT;
+    ac_json_write_object_begin(&jw);
+
+    ac_json_write_member_string(&jw, "model", params->model);
+    ac_json_write_member_int(&jw, "max_tokens", params->max_tokens > 0 ? params->max_tokens : 4096);
+    if (stream) {
+        ac_json_write_member_bool(&jw, "stream", 1);  /* Enable streaming */
+    }
+
+    /* Anthropic uses separate system field - extract from message history */
+    write_system(&jw, params, messages);
+
+    /* Thinking configuration */
+    if (ARC_FEATURE_THINKING && params->thinking.enabled) {
+        int budget = params->thinking.budget_tokens;
+        if (budget < ANTHROPIC_THINKING_MIN_BUDGET) {
+            budget = ANTHROPIC_THINKING_MIN_BUDGET;
+        }
+        ac_json_write_key(&jw, "thinking");
+        ac_json_write_object_begin(&jw);
+        ac_json_write_member_string(&jw, "type", "enabled");
+        ac_json_write_member_int(&jw, "budget_tokens", budget);
+        ac_json_write_object_end(&jw);
+    }
+
+    /* Structured output: the answer tool must be called (forcing is not
+     * allowed with thinking, where it is only offered) */
+    if (params->response_format.schema && !(ARC_FEATURE_THINKING && params->thinking.enabled)) {
+        ac_json_write_key(&jw, "tool_choice");
+        ac_json_write_object_begin(&jw);
+        ac_json_write_member_string(&jw, "type", "any");
+        ac_json_write_object_end(&jw);
+    }
+
+    /* Messages are spliced in from cached fragments (system messages
+     * are skipped - they go in system field) */
+
+    ac_json_write_object_end(&jw);
+    return ac_json_writer_take(&jw);
+}
+
+/**
+ * @brief Tools array to splice into the body
+ *
+ * Anthropic-format schemas are spliced verbatim, anything else is
+ * converted from OpenAI format into *converted (cJSON_free). With a
+ * response_format, the answer tool is appended (also into *converted).
+ *
+ * @return Tools JSON, NULL for none
+ */
+static const char* anthropic_tools(const ac_llm_params_t* params, const char* tools,
+                                   char** converted) {
+    const ac_response_format_t* format = &params->response_format;
+    *converted = NULL;
+    if (tools && tools[0] == '\0') {
+        tools = NULL;
+    }
+    if (!format->schema && (!tools || ac_tools_json_is_anthropic(tools))) {
+        return tools;
+    }
+
+    cJSON* tools_arr = !tools ? cJSON_CreateArray()
+                     : ac_tools_json_is_anthropic(tools) ? cJSON_Parse(tools)
+                     : convert_tools_to_anthropic(tools);
+    if (tools_arr && format->schema) {
+        cJSON* answer = cJSON_CreateObject();
+        cJSON_AddStringToObject(answer, "name", format->name);
+        cJSON_AddStringToObject(answer, "description",
+                                "Give your final answer by calling this tool.");
+        cJSON_AddItemToObject(answer, "input_schema", cJSON_Parse(format->schema));
+        cJSON_AddItemToArray(tools_arr, answer);
+    }
+    if (tools_arr) {
+        *converted = cJSON_PrintUnformatted(tools_arr);
+        cJSON_Delete(tools_arr);
+    }
+    return *converted;
+}
+
 static void* anthropic_create(const ac_llm_params_t* params) {
     if (!params) {
         return NULL;
@@ -137,6 +455,19 @@ static void* anthropic_create(const ac_llm_params_t* params) {
         return NULL;
     }
 
+    priv->headers = anthropic_headers_create(params);
+    if (!priv->headers) {
+        ARC_FREE(priv);
+        return NULL;
+    }
+
+    priv->messages_url = ac_llm_provider_url(anthropic_api_base(params), "/v1/messages");
+    if (!priv->messages_url) {
+        arc_http_header_set_destroy(priv->headers);
+        ARC_FREE(priv);
+        return NULL;
+    }
+
     /* Check if HTTP pool is available */
     if (http_pool_available()) {
         /* Will acquire from pool on each request */
@@ -151,6 +482,8 @@ static void* anthropic_create(const ac_llm_params_t* params) {
 
         arc_err_t err = arc_http_client_create(&config, &priv->http);
         if (err != ARC_OK) {
+            arc_http_header_set_destroy(priv->headers);
+            ARC_FREE(priv->messages_url);
             ARC_FREE(priv);
             return NULL;
         }
@@ -161,6 +494,107 @@ static void* anthropic_create(const ac_llm_params_t* params) {
     return priv;
 }
 
+static void converted_tools_free(void* tools) {
+    cJSON_free(tools);
+}
+
+/**
+ * @brief Build the Messages API request
+ *
+ * Images that should be uploaded first need the blocking path.
+ */
+static arc_err_t anthropic_chat_prepare(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_prepared_t* out
+) {
+    if (!priv_data || !params || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    anthropic_priv_t* priv = (anthropic_priv_t*)priv_data;
+    memset(out, 0, sizeof(*out));
+    if (uploads_pending(messages)) {
+        return ARC_ERR_NOT_IMPLEMENTED;
+    }
+
+    /* Build request JSON: messages and tools are spliced in by the body source */
+    ac_prof_push(AC_PROF_SERIALIZE);
+    char* converted_tools = NULL;
+    tools = anthropic_tools(params, tools, &converted_tools);
+    out->extra = converted_tools;
+    out->extra_free = converted_tools_free;
+    out->fields = anthropic_request_fields(params, messages, 0);
+    out->source = ac_json_body_source_create(out->fields, messages, AC_JSON_DIALECT_ANTHROPIC,
+                                             tools, cache_breakpoints(params));
+    ac_prof_pop();
+
+    if (!out->source) {
+        ac_llm_prepared_free(out);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    /* Streamed from the fragments unless gzip (or the debug dump) needs it whole */
+    if (params->compress_requests || ac_log_get_level() >= AC_LOG_LEVEL_DEBUG) {
+        ac_prof_push(AC_PROF_SERIALIZE);
+        out->body = ac_json_body_source_flatten(out->source);
+        ac_prof_pop();
+    }
+
+    AC_LOG_DEBUG("Anthropic request to %s: %s", priv->messages_url,
+                 out->body ? out->body : "(streamed)");
+
+    out->request = (arc_http_request_t){
+        .url = priv->messages_url,
+        .method = ARC_HTTP_POST,
+        .header_set = priv->headers,
+        .headers = ac_json_body_source_files(out->source) ? &s_files_beta : NULL,
+        .body = out->body,
+        .body_len = ac_json_body_source_length(out->source),
+        .timeout_ms = params->timeout_ms > 0 ? params->timeout_ms : 60000,
+        .verify_ssl = 1,
+        .compress_body = params->compress_requests,
+        .cancel = params->cancel,
+        .body_read = out->body ? NULL : ac_json_body_source_read,
+        .body_rewind = ac_json_body_source_rewind,
+        .body_user_data = out->source,
+    };
+    return ARC_OK;
+}
+
+/**
+ * @brief Parse the Messages API response
+ */
+static arc_err_t anthropic_chat_parse(
+    void* priv_data,
+    const arc_http_response_t* http_resp,
+    ac_chat_response_t* response
+) {
+    (void)priv_data;
+
+    if (http_resp->status_code != 200) {
+        AC_LOG_ERROR("Anthropic HTTP %d: %s", http_resp->status_code,
+            http_resp->body ? http_resp->body : "");
+        response->http_status = http_resp->status_code;
+        response->retry_after_ms = http_resp->retry_after_ms;
+        return ARC_ERR_HTTP;
+    }
+
+    AC_LOG_DEBUG("Anthropic response: %s", http_resp->body);
+    arc_err_t err = ac_chat_response_parse_anthropic(http_resp->body, response);
+    if (err != ARC_OK) {
+        AC_LOG_ERROR("Failed to parse Anthropic response");
+        return err;
+    }
+
+    AC_LOG_DEBUG("Anthropic chat completed: blocks=%d, content=%s",
+                 response->block_count,
+                 response->content ? "yes" : "no");
+    return ARC_OK;
+}
+
 static arc_err_t anthropic_chat(
     void* priv_data,
     const ac_llm_params_t* params,
@@ -172,15 +606,27 @@ static arc_err_t anthropic_chat(
         return ARC_ERR_INVALID_ARG;
     }
 
+    /* Queue on the key's quota before holding a connection */
+    uint32_t queued_ms = 0;
+    arc_err_t err = ac_ratelimit_acquire("anthropic", params, messages, tools, &queued_ms);
+    response->ratelimit_wait_ms = queued_ms;
+    if (err != ARC_OK) {
+        return err;
+    }
+
     anthropic_priv_t* priv = (anthropic_priv_t*)priv_data;
     arc_http_client_t* http = NULL;
     int from_pool = 0;
+    uint32_t pool_wait_ms = 0;
 
     /* Get HTTP client: from pool or owned */
     if (priv->owns_http) {
         http = priv->http;
     } else if (http_pool_available()) {
-        http = ac_http_pool_acquire(params->timeout_ms > 0 ? params->timeout_ms : 60000);
+        uint64_t pool_start_ms = ac_platform_timestamp_ms();
+        http = ac_http_pool_acquire_priority(params->timeout_ms > 0 ? params->timeout_ms : 60000,
+                                             params->priority);
+        pool_wait_ms = (uint32_t)(ac_platform_timestamp_ms() - pool_start_ms);
         if (!http) {
             AC_LOG_ERROR("Anthropic: failed to acquire HTTP client from pool");
             return ARC_ERR_TIMEOUT;
@@ -191,136 +637,41 @@ static arc_err_t anthropic_chat(
         return ARC_ERR_NOT_INITIALIZED;
     }
 
-    /* Build URL */
-    const char* api_base = params->api_base ? params->api_base : "https://api.anthropic.com";
-    char url[512];
-    snprintf(url, sizeof(url), "%s/v1/messages", api_base);
-
-    /* Build request JSON */
-    cJSON* root = cJSON_CreateObject();
-    if (!root) {
-        if (from_pool) ac_http_pool_release(http);
-        return ARC_ERR_NO_MEMORY;
-    }
-
-    cJSON_AddStringToObject(root, "model", params->model);
-    cJSON_AddNumberToObject(root, "max_tokens", params->max_tokens > 0 ? params->max_tokens : 4096);
+    upload_attachments(http, params, messages);
 
-    /* Anthropic uses separate system field - extract from message history */
-    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
-        if (msg->role == AC_ROLE_SYSTEM && msg->content) {
-            cJSON_AddStringToObject(root, "system", msg->content);
-            break;  /* Use first system message only */
-        }
-    }
-
-    /* Thinking configuration */
-    if (params->thinking.enabled) {
-        cJSON* thinking = cJSON_CreateObject();
-        cJSON_AddStringToObject(thinking, "type", "enabled");
-        int budget = params->thinking.budget_tokens;
-        if (budget < ANTHROPIC_THINKING_MIN_BUDGET) {
-            budget = ANTHROPIC_THINKING_MIN_BUDGET;
-        }
-        cJSON_AddNumberToObject(thinking, "budget_tokens", budget);
-        cJSON_AddItemToObject(root, "thinking", thinking);
-    }
-
-    /* Messages array (skip system messages - they go in system field) */
-    cJSON* msgs_arr = cJSON_AddArrayToObject(root, "messages");
-
-    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
-        /* Skip system messages (handled in system field above) */
-        if (msg->role == AC_ROLE_SYSTEM) {
-            continue;
-        }
-
-        /* Use Anthropic-specific format for messages with content blocks */
-        cJSON* msg_obj = ac_message_to_json_anthropic(msg);
-        if (msg_obj) {
-            cJSON_AddItemToArray(msgs_arr, msg_obj);
-        }
-    }
-
-    /* Tools - convert from OpenAI format to Anthropic format */
-    if (tools && strlen(tools) > 0) {
-        cJSON* tools_arr = convert_tools_to_anthropic(tools);
-        if (tools_arr) {
-            cJSON_AddItemToObject(root, "tools", tools_arr);
-        }
-    }
-
-    char* body = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    if (!body) {
+    ac_llm_prepared_t prepared;
+    err = anthropic_chat_prepare(priv, params, messages, tools, &prepared);
+    if (err != ARC_OK) {
         if (from_pool) ac_http_pool_release(http);
-        return ARC_ERR_NO_MEMORY;
+        return err;
     }
 
-    AC_LOG_DEBUG("Anthropic request to %s: %s", url, body);
-
-    /* Build headers */
-    arc_http_header_t* headers = NULL;
-    arc_http_header_append(&headers,
-        arc_http_header_create("Content-Type", "application/json; charset=utf-8"));
-    arc_http_header_append(&headers,
-        arc_http_header_create("x-api-key", params->api_key));
-    arc_http_header_append(&headers,
-        arc_http_header_create("anthropic-version", ANTHROPIC_API_VERSION));
-
-    /* Make HTTP request */
-    arc_http_request_t req = {
-        .url = url,
-        .method = ARC_HTTP_POST,
-        .headers = headers,
-        .body = body,
-        .body_len = strlen(body),
-        .timeout_ms = params->timeout_ms > 0 ? params->timeout_ms : 60000,
-        .verify_ssl = 1,
-    };
-
     arc_http_response_t http_resp = {0};
-    arc_err_t err = arc_http_request(http, &req, &http_resp);
+    err = arc_http_request(http, &prepared.request, &http_resp);
+    ac_ratelimit_observe("anthropic", params, &http_resp);
+    ac_llm_prepared_free(&prepared);
 
-    /* Cleanup */
-    arc_http_header_free(headers);
-    cJSON_free(body);
+    /* Release HTTP client back to pool */
+    if (from_pool) ac_http_pool_release(http);
 
     if (err != ARC_OK) {
         AC_LOG_ERROR("Anthropic HTTP request failed: %d", err);
         arc_http_response_free(&http_resp);
-        if (from_pool) ac_http_pool_release(http);
         return err;
     }
 
-    if (http_resp.status_code != 200) {
-        AC_LOG_ERROR("Anthropic HTTP %d: %s", http_resp.status_code,
-            http_resp.body ? http_resp.body : "");
-        arc_http_response_free(&http_resp);
-        if (from_pool) ac_http_pool_release(http);
-        return ARC_ERR_HTTP;
+    err = anthropic_chat_parse(priv, &http_resp, response);
+    response->ratelimit_wait_ms = queued_ms;   /* Parsing resets the response */
+    if (http_resp.status_code == 200) {
+        ac_llm_timing_from_http(&response->timing, &http_resp, pool_wait_ms);
     }
-
-    /* Parse response using Anthropic-specific parser */
-    AC_LOG_DEBUG("Anthropic response: %s", http_resp.body);
-
-    err = ac_chat_response_parse_anthropic(http_resp.body, response);
-
     arc_http_response_free(&http_resp);
+    return err;
+}
 
-    /* Release HTTP client back to pool */
-    if (from_pool) ac_http_pool_release(http);
-
-    if (err != ARC_OK) {
-        AC_LOG_ERROR("Failed to parse Anthropic response");
-        return err;
-    }
-
-    AC_LOG_DEBUG("Anthropic chat completed: blocks=%d, content=%s",
-                 response->block_count,
-                 response->content ? "yes" : "no");
-    return ARC_OK;
+static int anthropic_reentrant(void* priv_data) {
+    /* Pooled requests each acquire their own client */
+    return priv_data && !((anthropic_priv_t*)priv_data)->owns_http;
 }
 
 static void anthropic_cleanup(void* priv_data) {
@@ -335,6 +686,8 @@ static void anthropic_cleanup(void* priv_data) {
         arc_http_client_destroy(priv->http);
     }
 
+    arc_http_header_set_destroy(priv->headers);
+    ARC_FREE(priv->messages_url);
     ARC_FREE(priv);
 
     AC_LOG_DEBUG("Anthropic provider cleaned up");
@@ -357,38 +710,42 @@ typedef struct {
     char* current_tool_name;
     
     /* Accumulated content for response */
-    char* accumulated_text;
-    char* accumulated_thinking;
-    char* accumulated_signature;
-    char* accumulated_tool_input;
+    ac_strbuf_t accumulated_text;
+    ac_strbuf_t accumulated_thinking;
+    ac_strbuf_t accumulated_signature;
+    ac_strbuf_t accumulated_tool_input;
+    ac_json_stream_t tool_input_check;  /**< Tool input validated as it arrives */
     
     int aborted;
+    int too_large;                      /**< Tool input over ARC_STREAM_TOOL_ARGS_MAX */
 } stream_context_t;
 
 static void stream_ctx_free(stream_context_t* ctx) {
     if (ctx->current_tool_id) ARC_FREE(ctx->current_tool_id);
     if (ctx->current_tool_name) ARC_FREE(ctx->current_tool_name);
-    if (ctx->accumulated_text) ARC_FREE(ctx->accumulated_text);
-    if (ctx->accumulated_thinking) ARC_FREE(ctx->accumulated_thinking);
-    if (ctx->accumulated_signature) ARC_FREE(ctx->accumulated_signature);
-    if (ctx->accumulated_tool_input) ARC_FREE(ctx->accumulated_tool_input);
+    ac_strbuf_reset(&ctx->accumulated_text);
+    ac_strbuf_reset(&ctx->accumulated_thinking);
+    ac_strbuf_reset(&ctx->accumulated_signature);
+    ac_strbuf_reset(&ctx->accumulated_tool_input);
     sse_parser_free(&ctx->sse);
 }
 
-static void append_string(char** dst, const char* src, size_t len) {
-    if (!src || len == 0) return;
-    
-    if (*dst) {
-        size_t old_len = strlen(*dst);
-        char* new_str = ARC_REALLOC(*dst, old_len + len + 1);
-        if (new_str) {
-            memcpy(new_str + old_len, src, len);
-            new_str[old_len + len] = '\0';
-            *dst = new_str;
-        }
-    } else {
-        *dst = ARC_STRNDUP(src, len);
+/**
+ * @brief Offset the next decoded delta starts at
+ *
+ * Tool input is always collected. Text, thinking and signatures are not
+ * in ARC_STREAM_DELTA_ONLY builds: the buffer keeps only the delta being
+ * decoded.
+ */
+static size_t delta_begin(stream_context_t* ctx, ac_strbuf_t* acc) {
+#if ARC_STREAM_DELTA_ONLY
+    if (acc != &ctx->accumulated_tool_input) {
+        ac_strbuf_clear(acc);
     }
+#else
+    (void)ctx;
+#endif
+    return acc->len;
 }
 
 static int handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
@@ -398,28 +755,23 @@ static int handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
         return ctx->aborted ? -1 : 0;
     }
     
-    /* Parse JSON data */
-    cJSON* data = cJSON_Parse(event->data);
-    if (!data) {
-        AC_LOG_ERROR("Failed to parse SSE data: %s", event->data);
+    /* Fields are read straight from the bytes: no tree per delta */
+    ac_json_span_t data = ac_json_scan_root(event->data, event->data_len);
+    if (data.kind != AC_JSON_OBJECT) {
+        AC_LOG_ERROR("Failed to parse SSE data: %.*s", (int)event->data_len, event->data);
         return 0;
     }
     
-    cJSON* type = cJSON_GetObjectItem(data, "type");
-    const char* type_str = type && cJSON_IsString(type) ? cJSON_GetStringValue(type) : "";
+    ac_json_span_t type = ac_json_scan_get(data, "type");
     
     ac_stream_event_t stream_event = {0};
     
-    if (strcmp(type_str, "message_start") == 0) {
+    if (ac_json_scan_str_eq(type, "message_start")) {
         stream_event.type = AC_STREAM_MESSAGE_START;
         
         /* Extract message ID */
-        cJSON* message = cJSON_GetObjectItem(data, "message");
-        if (message && ctx->response) {
-            cJSON* id = cJSON_GetObjectItem(message, "id");
-            if (id && cJSON_IsString(id)) {
-                ctx->response->id = ARC_STRDUP(cJSON_GetStringValue(id));
-            }
+        if (ctx->response) {
+            ctx->response->id = ac_json_scan_strdup(ac_json_scan_path(data, "message.id"));
         }
         
         if (ctx->user_callback) {
@@ -428,34 +780,28 @@ static int handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
             }
         }
     }
-    else if (strcmp(type_str, "content_block_start") == 0) {
-        cJSON* index = cJSON_GetObjectItem(data, "index");
-        cJSON* content_block = cJSON_GetObjectItem(data, "content_block");
+    else if (ac_json_scan_str_eq(type, "content_block_start")) {
+        ac_json_span_t content_block = ac_json_scan_get(data, "content_block");
         
-        ctx->current_block_index = index ? index->valueint : 0;
+        ctx->current_block_index = 0;
+        ac_json_scan_int(ac_json_scan_get(data, "index"), &ctx->current_block_index);
         
-        if (content_block) {
-            cJSON* block_type = cJSON_GetObjectItem(content_block, "type");
-            const char* bt = block_type && cJSON_IsString(block_type) ? 
-                             cJSON_GetStringValue(block_type) : "";
+        if (content_block.kind == AC_JSON_OBJECT) {
+            ac_json_span_t bt = ac_json_scan_get(content_block, "type");
             
-            if (strcmp(bt, "thinking") == 0) {
+            if (ac_json_scan_str_eq(bt, "thinking")) {
                 ctx->current_block_type = AC_BLOCK_THINKING;
-            } else if (strcmp(bt, "text") == 0) {
+            } else if (ac_json_scan_str_eq(bt, "text")) {
                 ctx->current_block_type = AC_BLOCK_TEXT;
-            } else if (strcmp(bt, "tool_use") == 0) {
+            } else if (ac_json_scan_str_eq(bt, "tool_use")) {
                 ctx->current_block_type = AC_BLOCK_TOOL_USE;
                 
-                cJSON* id = cJSON_GetObjectItem(content_block, "id");
-                cJSON* name = cJSON_GetObjectItem(content_block, "name");
-                
                 if (ctx->current_tool_id) ARC_FREE(ctx->current_tool_id);
                 if (ctx->current_tool_name) ARC_FREE(ctx->current_tool_name);
                 
-                ctx->current_tool_id = id && cJSON_IsString(id) ? 
-                    ARC_STRDUP(cJSON_GetStringValue(id)) : NULL;
-                ctx->current_tool_name = name && cJSON_IsString(name) ? 
-                    ARC_STRDUP(cJSON_GetStringValue(name)) : NULL;
+                ctx->current_tool_id = ac_json_scan_strdup(ac_json_scan_get(content_block, "id"));
+                ctx->current_tool_name = ac_json_scan_strdup(ac_json_scan_get(content_block, "name"));
+                ac_json_stream_init(&ctx->tool_input_check);
             }
         }
         
@@ -471,60 +817,66 @@ static int handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
             }
         }
     }
-    else if (strcmp(type_str, "content_block_delta") == 0) {
-        cJSON* delta = cJSON_GetObjectItem(data, "delta");
-        if (delta) {
-            cJSON* delta_type = cJSON_GetObjectItem(delta, "type");
-            const char* dt = delta_type && cJSON_IsString(delta_type) ? 
-                             cJSON_GetStringValue(delta_type) : "";
+    else if (ac_json_scan_str_eq(type, "content_block_delta")) {
+        ac_json_span_t delta = ac_json_scan_get(data, "delta");
+        if (delta.kind == AC_JSON_OBJECT) {
+            ac_json_span_t dt = ac_json_scan_get(delta, "type");
             
             stream_event.type = AC_STREAM_DELTA;
             stream_event.block_index = ctx->current_block_index;
             stream_event.block_type = ctx->current_block_type;
             
-            if (strcmp(dt, "thinking_delta") == 0) {
-                cJSON* thinking = cJSON_GetObjectItem(delta, "thinking");
-                if (thinking && cJSON_IsString(thinking)) {
-                    const char* text = cJSON_GetStringValue(thinking);
-                    stream_event.delta_type = AC_DELTA_THINKING;
-                    stream_event.delta = text;
-                    stream_event.delta_len = strlen(text);
-                    
-                    append_string(&ctx->accumulated_thinking, text, stream_event.delta_len);
-                }
+            /* Decoded into the matching accumulator; the delta is its new tail */
+            ac_strbuf_t* acc = NULL;
+            ac_json_span_t text = {0};
+            if (ARC_FEATURE_THINKING && ac_json_scan_str_eq(dt, "thinking_delta")) {
+                text = ac_json_scan_get(delta, "thinking");
+                acc = &ctx->accumulated_thinking;
+                stream_event.delta_type = AC_DELTA_THINKING;
             }
-            else if (strcmp(dt, "text_delta") == 0) {
-                cJSON* text_obj = cJSON_GetObjectItem(delta, "text");
-                if (text_obj && cJSON_IsString(text_obj)) {
-                    const char* text = cJSON_GetStringValue(text_obj);
-                    stream_event.delta_type = AC_DELTA_TEXT;
-                    stream_event.delta = text;
-                    stream_event.delta_len = strlen(text);
-                    
-                    append_string(&ctx->accumulated_text, text, stream_event.delta_len);
-                }
+            else if (ac_json_scan_str_eq(dt, "text_delta")) {
+                text = ac_json_scan_get(delta, "text");
+                acc = &ctx->accumulated_text;
+                stream_event.delta_type = AC_DELTA_TEXT;
             }
-            else if (strcmp(dt, "input_json_delta") == 0) {
-                cJSON* partial_json = cJSON_GetObjectItem(delta, "partial_json");
-                if (partial_json && cJSON_IsString(partial_json)) {
-                    const char* text = cJSON_GetStringValue(partial_json);
-                    stream_event.delta_type = AC_DELTA_INPUT_JSON;
-                    stream_event.delta = text;
-                    stream_event.delta_len = strlen(text);
-                    
-                    append_string(&ctx->accumulated_tool_input, text, stream_event.delta_len);
-                }
+            else if (ac_json_scan_str_eq(dt, "input_json_delta")) {
+                text = ac_json_scan_get(delta, "partial_json");
+                acc = &ctx->accumulated_tool_input;
+                stream_event.delta_type = AC_DELTA_INPUT_JSON;
             }
-            else if (strcmp(dt, "signature_delta") == 0) {
-                cJSON* sig = cJSON_GetObjectItem(delta, "signature");
-                if (sig && cJSON_IsString(sig)) {
-                    const char* text = cJSON_GetStringValue(sig);
-                    stream_event.delta_type = AC_DELTA_SIGNATURE;
-                    stream_event.delta = text;
-                    stream_event.delta_len = strlen(text);
-                    
-                    append_string(&ctx->accumulated_signature, text, stream_event.delta_len);
-                }
+            else if (ARC_FEATURE_THINKING && ac_json_scan_str_eq(dt, "signature_delta")) {
+                text = ac_json_scan_get(delta, "signature");
+                acc = &ctx->accumulated_signature;
+                stream_event.delta_type = AC_DELTA_SIGNATURE;
+            }
+            
+            if (acc && text.kind == AC_JSON_STRING) {
+                size_t old_len = delta_begin(ctx, acc);
+                ac_json_scan_append(text, acc);
+                stream_event.delta = ac_strbuf_tail(acc, old_len);
+                stream_event.delta_len = acc->len - old_len;
+            }
+            
+#if ARC_STREAM_TOOL_ARGS_MAX > 0
+            if (acc == &ctx->accumulated_tool_input &&
+                acc->len > ARC_STREAM_TOOL_ARGS_MAX) {
+                AC_LOG_ERROR("Anthropic: input for tool %s exceeds %zu bytes",
+                             ctx->current_tool_name ? ctx->current_tool_name : "?",
+                             (size_t)ARC_STREAM_TOOL_ARGS_MAX);
+                ctx->too_large = 1;
+                ctx->aborted = 1;
+                return -1;
+            }
+#endif
+            
+            /* Report malformed tool input at the first bad byte, not at execution */
+            if (acc == &ctx->accumulated_tool_input && stream_event.delta &&
+                ac_json_stream_status(&ctx->tool_input_check) != AC_JSON_STREAM_ERROR &&
+                ac_json_stream_feed(&ctx->tool_input_check, stream_event.delta,
+                                    stream_event.delta_len) == AC_JSON_STREAM_ERROR) {
+                AC_LOG_WARN("Anthropic: malformed input for tool %s at byte %zu",
+                            ctx->current_tool_name ? ctx->current_tool_name : "?",
+                            ctx->tool_input_check.offset);
             }
             
             if (ctx->user_callback && stream_event.delta) {
@@ -534,34 +886,43 @@ static int handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
             }
         }
     }
-    else if (strcmp(type_str, "content_block_stop") == 0) {
+    else if (ac_json_scan_str_eq(type, "content_block_stop")) {
         stream_event.type = AC_STREAM_CONTENT_BLOCK_STOP;
         stream_event.block_index = ctx->current_block_index;
         stream_event.block_type = ctx->current_block_type;
         
-        /* Build content block for response */
-        if (ctx->response) {
+        /* Build content block for response (delta-only: tool calls alone) */
+        if (ctx->response &&
+            (!ARC_STREAM_DELTA_ONLY || ctx->current_block_type == AC_BLOCK_TOOL_USE)) {
             ac_content_block_t* block = ARC_CALLOC(1, sizeof(ac_content_block_t));
             if (block) {
                 block->type = ctx->current_block_type;
                 
                 if (ctx->current_block_type == AC_BLOCK_THINKING) {
-                    block->text = ctx->accumulated_thinking;
-                    block->signature = ctx->accumulated_signature;
-                    ctx->accumulated_thinking = NULL;
-                    ctx->accumulated_signature = NULL;
+                    block->text_len = ctx->accumulated_thinking.len;
+                    block->text = ac_strbuf_take(&ctx->accumulated_thinking);
+                    block->signature = ac_strbuf_take(&ctx->accumulated_signature);
                 }
                 else if (ctx->current_block_type == AC_BLOCK_TEXT) {
-                    block->text = ctx->accumulated_text;
-                    ctx->accumulated_text = NULL;
+                    block->text_len = ctx->accumulated_text.len;
+                    block->text = ac_strbuf_take(&ctx->accumulated_text);
                 }
                 else if (ctx->current_block_type == AC_BLOCK_TOOL_USE) {
+                    /* No deltas means no arguments; otherwise the value must have closed */
+                    if (ctx->accumulated_tool_input.len > 0 &&
+                        ac_json_stream_status(&ctx->tool_input_check) == AC_JSON_STREAM_PARTIAL) {
+                        AC_LOG_WARN("Anthropic: input for tool %s ended incomplete",
+                                    ctx->current_tool_name ? ctx->current_tool_name : "?");
+                    }
                     block->id = ctx->current_tool_id;
                     block->name = ctx->current_tool_name;
-                    block->input = ctx->accumulated_tool_input;
+                    block->input_len = ctx->accumulated_tool_input.len;
+                    block->input = ac_strbuf_take(&ctx->accumulated_tool_input);
+                    stream_event.tool_id = block->id;
+                    stream_event.tool_name = block->name;
+                    stream_event.tool_input = block->input;
                     ctx->current_tool_id = NULL;
                     ctx->current_tool_name = NULL;
-                    ctx->accumulated_tool_input = NULL;
                 }
                 
                 /* Append to response blocks */
@@ -582,23 +943,17 @@ static int handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
             }
         }
     }
-    else if (strcmp(type_str, "message_delta") == 0) {
-        cJSON* delta = cJSON_GetObjectItem(data, "delta");
-        if (delta) {
-            cJSON* stop_reason = cJSON_GetObjectItem(delta, "stop_reason");
-            if (stop_reason && cJSON_IsString(stop_reason) && ctx->response) {
-                ctx->response->stop_reason = ARC_STRDUP(cJSON_GetStringValue(stop_reason));
-                ctx->response->finish_reason = ARC_STRDUP(cJSON_GetStringValue(stop_reason));
-            }
+    else if (ac_json_scan_str_eq(type, "message_delta")) {
+        ac_json_span_t stop_reason = ac_json_scan_path(data, "delta.stop_reason");
+        if (stop_reason.kind == AC_JSON_STRING && ctx->response) {
+            ctx->response->stop_reason = ac_json_scan_strdup(stop_reason);
+            ctx->response->finish_reason = ac_json_scan_strdup(stop_reason);
         }
         
-        cJSON* usage = cJSON_GetObjectItem(data, "usage");
-        if (usage && ctx->response) {
-            cJSON* ot = cJSON_GetObjectItem(usage, "output_tokens");
-            if (ot && cJSON_IsNumber(ot)) {
-                ctx->response->output_tokens = ot->valueint;
-                ctx->response->completion_tokens = ot->valueint;
-            }
+        int ot;
+        if (ctx->response && ac_json_scan_int(ac_json_scan_path(data, "usage.output_tokens"), &ot)) {
+            ctx->response->output_tokens = ot;
+            ctx->response->completion_tokens = ot;
         }
         
         stream_event.type = AC_STREAM_MESSAGE_DELTA;
@@ -611,29 +966,28 @@ static int handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
             }
         }
     }
-    else if (strcmp(type_str, "message_stop") == 0) {
+    else if (ac_json_scan_str_eq(type, "message_stop")) {
         stream_event.type = AC_STREAM_MESSAGE_STOP;
         
         if (ctx->user_callback) {
             ctx->user_callback(&stream_event, ctx->user_data);
         }
     }
-    else if (strcmp(type_str, "error") == 0) {
-        cJSON* error = cJSON_GetObjectItem(data, "error");
-        if (error) {
-            cJSON* msg = cJSON_GetObjectItem(error, "message");
+    else if (ac_json_scan_str_eq(type, "error")) {
+        ac_json_span_t error = ac_json_scan_get(data, "error");
+        if (error.kind == AC_JSON_OBJECT) {
+            char* msg = ac_json_scan_strdup(ac_json_scan_get(error, "message"));
             stream_event.type = AC_STREAM_ERROR;
-            stream_event.error_msg = msg && cJSON_IsString(msg) ? 
-                cJSON_GetStringValue(msg) : "Unknown error";
+            stream_event.error_msg = msg ? msg : "Unknown error";
             
             if (ctx->user_callback) {
                 ctx->user_callback(&stream_event, ctx->user_data);
             }
+            if (msg) ARC_FREE(msg);
         }
         ctx->aborted = 1;
     }
     
-    cJSON_Delete(data);
     return ctx->aborted ? -1 : 0;
 }
 
@@ -642,28 +996,46 @@ static int http_stream_callback(const char* data, size_t len, void* user_data) {
     return sse_parser_feed(&ctx->sse, data, len);
 }
 
-static arc_err_t anthropic_chat_stream(
+/**
+ * @param raw  Pass the body through instead of emitting events (callback NULL)
+ */
+static arc_err_t anthropic_stream(
     void* priv_data,
     const ac_llm_params_t* params,
     const ac_message_t* messages,
     const char* tools,
     ac_stream_callback_t callback,
     void* user_data,
+    ac_llm_raw_tap_t* raw,
     ac_chat_response_t* response
 ) {
-    if (!priv_data || !params || !callback) {
+    if (!priv_data || !params || (!callback && !raw)) {
         return ARC_ERR_INVALID_ARG;
     }
 
+    /* Queue on the key's quota before holding a connection */
+    uint32_t queued_ms = 0;
+    arc_err_t err = ac_ratelimit_acquire("anthropic", params, messages, tools, &queued_ms);
+    if (err != ARC_OK) {
+        if (response) {
+            response->ratelimit_wait_ms = queued_ms;
+        }
+        return err;
+    }
+
     anthropic_priv_t* priv = (anthropic_priv_t*)priv_data;
     arc_http_client_t* http = NULL;
     int from_pool = 0;
+    uint32_t pool_wait_ms = 0;
 
     /* Get HTTP client */
     if (priv->owns_http) {
         http = priv->http;
     } else if (http_pool_available()) {
-        http = ac_http_pool_acquire(params->timeout_ms > 0 ? params->timeout_ms : 120000);
+        uint64_t pool_start_ms = ac_platform_timestamp_ms();
+        http = ac_http_pool_acquire_priority(params->timeout_ms > 0 ? params->timeout_ms : 120000,
+                                             params->priority);
+        pool_wait_ms = (uint32_t)(ac_platform_timestamp_ms() - pool_start_ms);
         if (!http) {
             AC_LOG_ERROR("Anthropic: failed to acquire HTTP client from pool");
             return ARC_ERR_TIMEOUT;
@@ -674,79 +1046,37 @@ static arc_err_t anthropic_chat_stream(
         return ARC_ERR_NOT_INITIALIZED;
     }
 
-    /* Build URL */
-    const char* api_base = params->api_base ? params->api_base : "https://api.anthropic.com";
-    char url[512];
-    snprintf(url, sizeof(url), "%s/v1/messages", api_base);
+    const char* url = priv->messages_url;
+    upload_attachments(http, params, messages);
 
-    /* Build request JSON */
-    cJSON* root = cJSON_CreateObject();
-    if (!root) {
-        if (from_pool) ac_http_pool_release(http);
-        return ARC_ERR_NO_MEMORY;
-    }
+    /* Build request JSON: messages and tools are spliced in by the body source */
+    ac_prof_push(AC_PROF_SERIALIZE);
+    char* converted_tools = NULL;
+    tools = anthropic_tools(params, tools, &converted_tools);
+    char* fields = anthropic_request_fields(params, messages, 1);
 
-    cJSON_AddStringToObject(root, "model", params->model);
-    cJSON_AddNumberToObject(root, "max_tokens", params->max_tokens > 0 ? params->max_tokens : 4096);
-    cJSON_AddBoolToObject(root, "stream", 1);  /* Enable streaming */
+    ac_json_body_source_t* source =
+        ac_json_body_source_create(fields, messages, AC_JSON_DIALECT_ANTHROPIC, tools,
+                                   cache_breakpoints(params));
+    ac_prof_pop();
 
-    /* Anthropic uses separate system field - extract from message history */
-    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
-        if (msg->role == AC_ROLE_SYSTEM && msg->content) {
-            cJSON_AddStringToObject(root, "system", msg->content);
-            break;  /* Use first system message only */
-        }
-    }
-
-    /* Thinking configuration */
-    if (params->thinking.enabled) {
-        cJSON* thinking = cJSON_CreateObject();
-        cJSON_AddStringToObject(thinking, "type", "enabled");
-        int budget = params->thinking.budget_tokens;
-        if (budget < ANTHROPIC_THINKING_MIN_BUDGET) {
-            budget = ANTHROPIC_THINKING_MIN_BUDGET;
-        }
-        cJSON_AddNumberToObject(thinking, "budget_tokens", budget);
-        cJSON_AddItemToObject(root, "thinking", thinking);
-    }
-
-    /* Messages array (skip system messages - they go in system field) */
-    cJSON* msgs_arr = cJSON_AddArrayToObject(root, "messages");
-    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
-        if (msg->role == AC_ROLE_SYSTEM) continue;
-        cJSON* msg_obj = ac_message_to_json_anthropic(msg);
-        if (msg_obj) {
-            cJSON_AddItemToArray(msgs_arr, msg_obj);
-        }
-    }
-
-    /* Tools - convert from OpenAI format to Anthropic format */
-    if (tools && strlen(tools) > 0) {
-        cJSON* tools_arr = convert_tools_to_anthropic(tools);
-        if (tools_arr) {
-            cJSON_AddItemToObject(root, "tools", tools_arr);
-        }
-    }
-
-    char* body = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    if (!body) {
+    if (!source) {
+        ARC_FREE(fields);
+        if (converted_tools) cJSON_free(converted_tools);
         if (from_pool) ac_http_pool_release(http);
         return ARC_ERR_NO_MEMORY;
     }
 
-    AC_LOG_DEBUG("Anthropic stream request to %s", url);
-    AC_LOG_DEBUG("Anthropic stream body: %s", body);
+    /* Streamed from the fragments unless gzip (or the debug dump) needs it whole */
+    char* body = NULL;
+    if (params->compress_requests || ac_log_get_level() >= AC_LOG_LEVEL_DEBUG) {
+        ac_prof_push(AC_PROF_SERIALIZE);
+        body = ac_json_body_source_flatten(source);
+        ac_prof_pop();
+    }
 
-    /* Build headers */
-    arc_http_header_t* headers = NULL;
-    arc_http_header_append(&headers,
-        arc_http_header_create("Content-Type", "application/json; charset=utf-8"));
-    arc_http_header_append(&headers,
-        arc_http_header_create("x-api-key", params->api_key));
-    arc_http_header_append(&headers,
-        arc_http_header_create("anthropic-version", ANTHROPIC_API_VERSION));
+    AC_LOG_DEBUG("Anthropic stream request to %s", url);
+    AC_LOG_DEBUG("Anthropic stream body: %s", body ? body : "(streamed)");
 
     /* Initialize stream context */
     stream_context_t ctx = {0};
@@ -758,6 +1088,7 @@ static arc_err_t anthropic_chat_stream(
 
     if (response) {
         ac_chat_response_init(response);
+        response->ratelimit_wait_ms = queued_ms;
     }
 
     /* Make streaming HTTP request */
@@ -765,41 +1096,77 @@ static arc_err_t anthropic_chat_stream(
         .base = {
             .url = url,
             .method = ARC_HTTP_POST,
-            .headers = headers,
+            .header_set = priv->headers,
+            .headers = ac_json_body_source_files(source) ? &s_files_beta : NULL,
             .body = body,
-            .body_len = strlen(body),
+            .body_len = ac_json_body_source_length(source),
             .timeout_ms = params->timeout_ms > 0 ? params->timeout_ms : 120000,
             .verify_ssl = 1,
+            .compress_body = params->compress_requests,
+            .cancel = params->cancel,
+            .body_read = body ? NULL : ac_json_body_source_read,
+            .body_rewind = ac_json_body_source_rewind,
+            .body_user_data = source,
         },
-        .on_data = http_stream_callback,
+        .on_data = raw && !raw->decode ? ac_llm_raw_skip : http_stream_callback,
         .user_data = &ctx,
+        .tap = raw ? ac_llm_raw_tap : NULL,
+        .tap_user_data = raw,
     };
+    if (raw) {
+        raw->state = 0;
+    }
 
     arc_http_response_t http_resp = {0};
-    arc_err_t err = arc_http_request_stream(http, &req, &http_resp);
+    err = arc_http_request_stream(http, &req, &http_resp);
+    ac_ratelimit_observe("anthropic", params, &http_resp);
 
     /* Cleanup */
-    arc_http_header_free(headers);
-    cJSON_free(body);
+    int too_large = ctx.too_large || ctx.sse.overflow;
+    ARC_FREE(body);
+    ac_json_body_source_free(source);
+    ARC_FREE(fields);
+    if (converted_tools) cJSON_free(converted_tools);
     stream_ctx_free(&ctx);
 
     if (from_pool) ac_http_pool_release(http);
 
+    /* Over a streaming limit: the parts seen so far are not a response */
+    if (too_large) {
+        arc_http_response_free(&http_resp);
+        return ARC_ERR_RESPONSE_TOO_LARGE;
+    }
+
     if (err != ARC_OK && !ctx.aborted) {
         AC_LOG_ERROR("Anthropic stream request failed: %d", err);
+        arc_http_response_free(&http_resp);
         return err;
     }
 
     if (http_resp.status_code != 200 && http_resp.status_code != 0) {
         AC_LOG_ERROR("Anthropic HTTP %d", http_resp.status_code);
+        if (response) {
+            response->http_status = http_resp.status_code;
+            response->retry_after_ms = http_resp.retry_after_ms;
+        }
+        arc_http_response_free(&http_resp);
         return ARC_ERR_HTTP;
     }
+    if (response) {
+        ac_llm_timing_from_http(&response->timing, &http_resp, pool_wait_ms);
+    }
+    arc_http_response_free(&http_resp);
 
     /* Set legacy content field from accumulated text */
     if (response && response->blocks) {
         for (ac_content_block_t* b = response->blocks; b; b = b->next) {
             if (b->type == AC_BLOCK_TEXT && b->text && !response->content) {
-                response->content = ARC_STRDUP(b->text);
+                ac_str_t text = ac_block_text(b);
+                response->content = ARC_MALLOC(text.len + 1);
+                if (response->content) {
+                    memcpy(response->content, text.ptr, text.len + 1);
+                    response->content_len = text.len;
+                }
                 break;
             }
         }
@@ -810,17 +1177,241 @@ static arc_err_t anthropic_chat_stream(
     return ARC_OK;
 }
 
+static arc_err_t anthropic_chat_stream(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_stream_callback_t callback,
+    void* user_data,
+    ac_chat_response_t* response
+) {
+    return anthropic_stream(priv_data, params, messages, tools, callback, user_data, NULL, response);
+}
+
+static arc_err_t anthropic_chat_stream_raw(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_raw_tap_t* raw,
+    ac_chat_response_t* response
+) {
+    return anthropic_stream(priv_data, params, messages, tools, NULL, NULL, raw, response);
+}
+
+/*============================================================================
+ * Message Batches
+ *
+ * A part is posted as {"requests":[...]} to /v1/messages/batches; once
+ * processing has ended, results are streamed from results_url as JSONL.
+ *============================================================================*/
+
+/** Part uploads and result downloads are large; params->timeout_ms bounds chat calls */
+#define ANTHROPIC_BATCH_TIMEOUT_MS 600000
+
+/**
+ * @brief Send one batch endpoint request
+ *
+ * @param body  200 response body (ARC_FREE), or NULL to stream it to stream->on_data
+ */
+static arc_err_t anthropic_batch_call(anthropic_priv_t* priv, arc_http_stream_request_t* stream,
+                                      char** body) {
+    arc_http_client_t* http = priv->http;
+    int from_pool = 0;
+    if (!priv->owns_http) {
+        http = http_pool_available() ? ac_http_pool_acquire(60000) : NULL;
+        from_pool = http != NULL;
+    }
+    if (!http) {
+        AC_LOG_ERROR("Anthropic: no HTTP client available");
+        return ARC_ERR_NOT_INITIALIZED;
+    }
+
+    stream->base.header_set = priv->headers;
+    stream->base.timeout_ms = ANTHROPIC_BATCH_TIMEOUT_MS;
+    stream->base.verify_ssl = 1;
+
+    arc_http_response_t http_resp = {0};
+    arc_err_t err = body ? arc_http_request(http, &stream->base, &http_resp)
+                         : arc_http_request_stream(http, stream, &http_resp);
+    if (from_pool) ac_http_pool_release(http);
+
+    if (err == ARC_OK && http_resp.status_code != 200) {
+        AC_LOG_ERROR("Anthropic batch HTTP %d: %s", http_resp.status_code,
+            http_resp.body ? http_resp.body : "");
+        err = ARC_ERR_HTTP;
+    }
+    if (err == ARC_OK && body) {
+        *body = http_resp.body;
+        http_resp.body = NULL;
+        if (!*body) {
+            err = ARC_ERR_PARSE;
+        }
+    }
+    arc_http_response_free(&http_resp);
+    return err;
+}
+
+static arc_err_t anthropic_batch_item(const ac_llm_params_t* params,
+                                      const ac_message_t* messages, const char* tools,
+                                      ac_llm_batch_item_t* out) {
+    char* converted = NULL;
+    tools = anthropic_tools(params, tools, &converted);
+    if (converted) {
+        /* The item is released with ARC_FREE */
+        out->tools_owned = ARC_STRDUP(converted);
+        cJSON_free(converted);
+        if (!out->tools_owned) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        tools = out->tools_owned;
+    }
+    out->tools = tools;
+    out->cache = cache_breakpoints(params);
+    out->fields = anthropic_request_fields(params, messages, 0);
+    return out->fields ? ARC_OK : ARC_ERR_NO_MEMORY;
+}
+
+static arc_err_t anthropic_batch_submit(void* priv_data, const ac_llm_params_t* params,
+                                        ac_llm_batch_body_t* body, char** id) {
+    char url[512];
+    snprintf(url, sizeof(url), "%s/v1/messages/batches", anthropic_api_base(params));
+    arc_http_stream_request_t req = {
+        .base = {
+            .url = url,
+            .method = ARC_HTTP_POST,
+            .headers = &s_files_beta,     /* Items may reference uploaded images */
+            .body_len = ac_llm_batch_body_length(body),
+            .cancel = params->cancel,
+            .body_read = ac_llm_batch_body_read,
+            .body_rewind = ac_llm_batch_body_rewind,
+            .body_user_data = body,
+        },
+    };
+
+    char* resp = NULL;
+    arc_err_t err = anthropic_batch_call((anthropic_priv_t*)priv_data, &req, &resp);
+    if (err != ARC_OK) {
+        return err;
+    }
+    *id = ac_json_scan_strdup(ac_json_scan_get(ac_json_scan_root(resp, strlen(resp)), "id"));
+    ARC_FREE(resp);
+    return *id ? ARC_OK : ARC_ERR_PARSE;
+}
+
+static arc_err_t anthropic_batch_poll(void* priv_data, const ac_llm_params_t* params,
+                                      const char* id, ac_llm_batch_status_t* status,
+                                      char** results) {
+    char url[512];
+    snprintf(url, sizeof(url), "%s/v1/messages/batches/%s", anthropic_api_base(params), id);
+    arc_http_stream_request_t req = {
+        .base = { .url = url, .method = ARC_HTTP_GET, .cancel = params->cancel },
+    };
+
+    char* resp = NULL;
+    arc_err_t err = anthropic_batch_call((anthropic_priv_t*)priv_data, &req, &resp);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    ac_json_span_t root = ac_json_scan_root(resp, strlen(resp));
+    ac_json_span_t state = ac_json_scan_get(root, "processing_status");
+    if (state.kind != AC_JSON_STRING) {
+        ARC_FREE(resp);
+        return ARC_ERR_PARSE;
+    }
+
+    int processing = 0, succeeded = 0, errored = 0, canceled = 0, expired = 0;
+    ac_json_span_t counts = ac_json_scan_get(root, "request_counts");
+    ac_json_scan_int(ac_json_scan_get(counts, "processing"), &processing);
+    ac_json_scan_int(ac_json_scan_get(counts, "succeeded"), &succeeded);
+    ac_json_scan_int(ac_json_scan_get(counts, "errored"), &errored);
+    ac_json_scan_int(ac_json_scan_get(counts, "canceled"), &canceled);
+    ac_json_scan_int(ac_json_scan_get(counts, "expired"), &expired);
+    status->succeeded = (size_t)succeeded;
+    status->failed = (size_t)errored + (size_t)canceled + (size_t)expired;
+    status->total = (size_t)processing + status->succeeded + status->failed;
+
+    if (ac_json_scan_str_eq(state, "ended")) {
+        status->state = AC_LLM_BATCH_ENDED;
+        *results = ac_json_scan_strdup(ac_json_scan_get(root, "results_url"));
+    } else {
+        status->state = AC_LLM_BATCH_RUNNING;
+    }
+
+    ARC_FREE(resp);
+    return ARC_OK;
+}
+
+static arc_err_t anthropic_batch_fetch(void* priv_data, const ac_llm_params_t* params,
+                                       const char* results, arc_stream_callback_t on_data,
+                                       void* user_data) {
+    arc_http_stream_request_t req = {
+        .base = { .url = results, .method = ARC_HTTP_GET, .cancel = params->cancel },
+        .on_data = on_data,
+        .user_data = user_data,
+    };
+    return anthropic_batch_call((anthropic_priv_t*)priv_data, &req, NULL);
+}
+
+static arc_err_t anthropic_batch_parse(const char* line, size_t len, char** custom_id,
+                                       ac_chat_response_t* response) {
+    ac_json_span_t root = ac_json_scan_root(line, len);
+    *custom_id = ac_json_scan_strdup(ac_json_scan_get(root, "custom_id"));
+    if (!*custom_id) {
+        return ARC_ERR_PARSE;
+    }
+
+    /* errored, canceled and expired requests carry no message */
+    ac_json_span_t result = ac_json_scan_get(root, "result");
+    if (!ac_json_scan_str_eq(ac_json_scan_get(result, "type"), "succeeded")) {
+        return ARC_ERR_BACKEND;
+    }
+
+    ac_json_span_t message = ac_json_scan_get(result, "message");
+    if (message.kind != AC_JSON_OBJECT) {
+        return ARC_ERR_PARSE;
+    }
+    char* json = ARC_STRNDUP(message.start, (size_t)(message.end - message.start));
+    if (!json) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    arc_err_t err = ac_chat_response_parse_anthropic(json, response);
+    ARC_FREE(json);
+    return err;
+}
+
+static const ac_llm_batch_ops_t anthropic_batch_ops = {
+    .max_requests = 100000,
+    .max_bytes = 256u * 1024 * 1024,
+    .strict_ids = 1,
+    .part_head = "{\"requests\":[",
+    .item_sep = ",",
+    .part_tail = "]}",
+    .item_key = "\"params\":",
+    .item = anthropic_batch_item,
+    .submit = anthropic_batch_submit,
+    .poll = anthropic_batch_poll,
+    .fetch = anthropic_batch_fetch,
+    .parse = anthropic_batch_parse,
+};
+
 /*============================================================================
  * Provider Registration
  *============================================================================*/
 
 const ac_llm_ops_t anthropic_ops = {
     .name = "anthropic",
-    .capabilities = AC_LLM_CAP_THINKING | AC_LLM_CAP_TOOLS | AC_LLM_CAP_STREAMING,
+    .capabilities = AC_LLM_CAP_THINKING | AC_LLM_CAP_TOOLS | AC_LLM_CAP_STREAMING | AC_LLM_CAP_VISION,
+    .json_dialect = AC_JSON_DIALECT_ANTHROPIC,
     .create = anthropic_create,
     .chat = anthropic_chat,
+    .chat_prepare = anthropic_chat_prepare,
+    .chat_parse = anthropic_chat_parse,
     .chat_stream = anthropic_chat_stream,
+    .chat_stream_raw = anthropic_chat_stream_raw,
+    .batch = &anthropic_batch_ops,
+    .reentrant = anthropic_reentrant,
     .cleanup = anthropic_cleanup,
 };
-
-AC_PROVIDER_REGISTER(anthropic, &anthropic_ops);
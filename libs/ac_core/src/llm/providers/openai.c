@@ -13,12 +13,20 @@
 
 #include "arc/log.h"
 #include "arc/platform.h"
+#include "arc/profile.h"
 #include "arc/sse_parser.h"
 #include "http_client.h"
 #include "../llm_provider.h"
 #include "../llm_internal.h"
+#include "../ratelimit.h"
+#include "../batch.h"
 #include "../message/message_json.h"
+#include "strbuf.h"
+#include "json_scan.h"
+#include "json_stream.h"
+#include "json_writer.h"
 #include "cJSON.h"
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -29,6 +37,8 @@
 /* Weak declarations - resolved at link time if ac_hosted is linked */
 __attribute__((weak)) int ac_http_pool_is_initialized(void);
 __attribute__((weak)) arc_http_client_t *ac_http_pool_acquire(uint32_t timeout_ms);
+__attribute__((weak)) arc_http_client_t *ac_http_pool_acquire_priority(
+    uint32_t timeout_ms, ac_priority_t priority);
 __attribute__((weak)) void ac_http_pool_release(arc_http_client_t *client);
 
 /**
@@ -44,8 +54,102 @@ static int http_pool_available(void) {
 typedef struct {
     arc_http_client_t *http;  /**< Owned HTTP client (NULL if using pool) */
     int owns_http;               /**< 1 if we created the client, 0 if from pool */
+    arc_http_header_set_t *headers; /**< Static request headers, built once */
+    char *chat_url;                 /**< api_base + /chat/completions, built once */
+    char *embed_url;                /**< api_base + /embeddings, built once */
 } openai_priv_t;
 
+/**
+ * @brief Format the per-provider headers (the key never changes)
+ */
+static arc_http_header_set_t* openai_headers_create(const ac_llm_params_t* params) {
+    char auth_header[512];
+    snprintf(auth_header, sizeof(auth_header), "Bearer %s",
+             params->api_key ? params->api_key : "");
+
+    arc_http_header_t auth = { .name = "Authorization", .value = auth_header };
+    arc_http_header_t content_type = {
+        .name = "Content-Type", .value = "application/json; charset=utf-8", .next = &auth };
+
+    arc_http_header_set_t* set = NULL;
+    arc_http_header_set_create(&content_type, &set);
+    return set;
+}
+
+/** How the body asks for the response */
+typedef enum {
+    OPENAI_BODY_CHAT,        /* "stream": false */
+    OPENAI_BODY_STREAM,      /* SSE with a final usage chunk */
+    OPENAI_BODY_BATCH        /* No "stream" member (batch input lines) */
+} openai_body_mode_t;
+
+/**
+ * @brief Top-level body fields; messages and tools are spliced in by the body source
+ *
+ * @return Fields object (ARC_FREE), NULL on error
+ */
+static char* openai_request_fields(const ac_llm_params_t* params, const char* tools,
+                                   openai_body_mode_t mode) {
+    ac_json_writer_t jw = AC_JSON_WRITER_INIT;
+    ac_json_write_object_begin(&jw);
+
+    ac_json_write_member_string(&jw, "model", params->model);
+    if (mode == OPENAI_BODY_STREAM) {
+        ac_json_write_member_bool(&jw, "stream", 1);
+
+        /* Add stream_options for usage stats (OpenAI compatible) */
+        ac_json_write_key(&jw, "stream_options");
+        ac_json_write_object_begin(&jw);
+        ac_json_write_member_bool(&jw, "include_usage", 1);
+        ac_json_write_object_end(&jw);
+    }
+
+    /* Messages are spliced in from cached fragments (system included) */
+
+    /* Temperature */
+    if (params->temperature > 0.0f) {
+        ac_json_write_member_double(&jw, "temperature", (double)params->temperature);
+    }
+
+    /* Max tokens */
+    if (params->max_tokens > 0) {
+        ac_json_write_member_int(&jw, "max_tokens", params->max_tokens);
+    }
+
+    /* Top-p */
+    if (params->top_p > 0.0f) {
+        ac_json_write_member_double(&jw, "top_p", (double)params->top_p);
+    }
+
+    if (mode == OPENAI_BODY_CHAT) {
+        ac_json_write_member_bool(&jw, "stream", 0);
+    }
+
+    /* Tools - serialized array is spliced into the body verbatim */
+    if (tools) {
+        ac_json_write_member_string(&jw, "tool_choice", "auto");
+    }
+
+    /* Structured output */
+    const ac_response_format_t* format = &params->response_format;
+    if (format->schema) {
+        ac_json_write_key(&jw, "response_format");
+        ac_json_write_object_begin(&jw);
+        ac_json_write_member_string(&jw, "type", "json_schema");
+        ac_json_write_key(&jw, "json_schema");
+        ac_json_write_object_begin(&jw);
+        ac_json_write_member_string(&jw, "name", format->name);
+        ac_json_write_key(&jw, "schema");
+        ac_json_write_raw(&jw, format->schema, strlen(format->schema));
+        ac_json_write_member_bool(&jw, "strict", format->strict);
+        ac_json_write_object_end(&jw);
+        ac_json_write_object_end(&jw);
+    }
+
+    ac_json_write_object_end(&jw);
+    return ac_json_writer_take(&jw);
+}
+
 /**
  * @brief Create OpenAI provider private data
  */
@@ -59,6 +163,24 @@ static void* openai_create(const ac_llm_params_t* params) {
         return NULL;
     }
 
+    priv->headers = openai_headers_create(params);
+    if (!priv->headers) {
+        ARC_FREE(priv);
+        return NULL;
+    }
+
+    priv->chat_url = ac_llm_provider_url(params->api_base ? params->api_base : "",
+                                         "/chat/completions");
+    priv->embed_url = ac_llm_provider_url(params->api_base ? params->api_base : "",
+                                          "/embeddings");
+    if (!priv->chat_url || !priv->embed_url) {
+        arc_http_header_set_destroy(priv->headers);
+        ARC_FREE(priv->chat_url);
+        ARC_FREE(priv->embed_url);
+        ARC_FREE(priv);
+        return NULL;
+    }
+
     /* Check if HTTP pool is available */
     if (http_pool_available()) {
         /* Will acquire from pool on each request */
@@ -73,6 +195,9 @@ static void* openai_create(const ac_llm_params_t* params) {
 
         arc_err_t err = arc_http_client_create(&config, &priv->http);
         if (err != ARC_OK) {
+            arc_http_header_set_destroy(priv->headers);
+            ARC_FREE(priv->chat_url);
+            ARC_FREE(priv->embed_url);
             ARC_FREE(priv);
             return NULL;
         }
@@ -83,6 +208,86 @@ static void* openai_create(const ac_llm_params_t* params) {
     return priv;
 }
 
+/**
+ * @brief Build the chat completion request
+ */
+static arc_err_t openai_chat_prepare(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_prepared_t* out
+) {
+    if (!priv_data || !params || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    openai_priv_t* priv = (openai_priv_t*)priv_data;
+    memset(out, 0, sizeof(*out));
+
+    /* Build request body: messages and tools are spliced in by the body source */
+    if (tools && tools[0] == '\0') {
+        tools = NULL;
+    }
+    ac_prof_push(AC_PROF_SERIALIZE);
+    out->fields = openai_request_fields(params, tools, OPENAI_BODY_CHAT);
+    out->source = ac_json_body_source_create(out->fields, messages, AC_JSON_DIALECT_OPENAI,
+                                             tools, 0);
+    ac_prof_pop();
+
+    if (!out->source) {
+        ac_llm_prepared_free(out);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    /* Streamed from the fragments unless gzip (or the debug dump) needs it whole */
+    if (params->compress_requests || ac_log_get_level() >= AC_LOG_LEVEL_DEBUG) {
+        ac_prof_push(AC_PROF_SERIALIZE);
+        out->body = ac_json_body_source_flatten(out->source);
+        ac_prof_pop();
+    }
+
+    AC_LOG_DEBUG("OpenAI request: %s", out->body ? out->body : "(streamed)");
+
+    out->request = (arc_http_request_t){
+        .url = priv->chat_url,
+        .method = ARC_HTTP_POST,
+        .header_set = priv->headers,
+        .body = out->body,
+        .body_len = ac_json_body_source_length(out->source),
+        .timeout_ms = params->timeout_ms,
+        .verify_ssl = 1,
+        .compress_body = params->compress_requests,
+        .cancel = params->cancel,
+        .body_read = out->body ? NULL : ac_json_body_source_read,
+        .body_rewind = ac_json_body_source_rewind,
+        .body_user_data = out->source,
+    };
+    return ARC_OK;
+}
+
+/**
+ * @brief Parse the chat completion response
+ */
+static arc_err_t openai_chat_parse(
+    void* priv_data,
+    const arc_http_response_t* http_resp,
+    ac_chat_response_t* response
+) {
+    (void)priv_data;
+
+    if (http_resp->status_code != 200) {
+        AC_LOG_ERROR("OpenAI HTTP %d: %s", http_resp->status_code,
+            http_resp->body ? http_resp->body : "");
+        response->http_status = http_resp->status_code;
+        response->retry_after_ms = http_resp->retry_after_ms;
+        return ARC_ERR_HTTP;
+    }
+
+    AC_LOG_DEBUG("OpenAI response: %s", http_resp->body);
+    return ac_chat_response_parse(http_resp->body, response);
+}
+
 /**
  * @brief Perform chat completion
  */
@@ -93,19 +298,31 @@ static arc_err_t openai_chat(
     const char* tools,
     ac_chat_response_t* response
 ) {
-    if (!priv_data || !params) {
+    if (!priv_data || !params || !response) {
         return ARC_ERR_INVALID_ARG;
     }
 
+    /* Queue on the key's quota before holding a connection */
+    uint32_t queued_ms = 0;
+    arc_err_t err = ac_ratelimit_acquire("openai", params, messages, tools, &queued_ms);
+    response->ratelimit_wait_ms = queued_ms;
+    if (err != ARC_OK) {
+        return err;
+    }
+
     openai_priv_t* priv = (openai_priv_t*)priv_data;
     arc_http_client_t* http = NULL;
     int from_pool = 0;
+    uint32_t pool_wait_ms = 0;
 
     /* Get HTTP client: from pool or owned */
     if (priv->owns_http) {
         http = priv->http;
     } else if (http_pool_available()) {
-        http = ac_http_pool_acquire(params->timeout_ms > 0 ? params->timeout_ms : 30000);
+        uint64_t pool_start_ms = ac_platform_timestamp_ms();
+        http = ac_http_pool_acquire_priority(params->timeout_ms > 0 ? params->timeout_ms : 30000,
+                                             params->priority);
+        pool_wait_ms = (uint32_t)(ac_platform_timestamp_ms() - pool_start_ms);
         if (!http) {
             AC_LOG_ERROR("OpenAI: failed to acquire HTTP client from pool");
             return ARC_ERR_TIMEOUT;
@@ -116,122 +333,39 @@ static arc_err_t openai_chat(
         return ARC_ERR_NOT_INITIALIZED;
     }
 
-    /* Build URL */
-    char url[512];
-    snprintf(url, sizeof(url), "%s/chat/completions", params->api_base);
-
-    /* Build request body (need to pass params for building JSON) */
-    /* Note: build_chat_request_json expects ac_llm_t*, but we only have params */
-    /* We'll need to refactor build_chat_request_json to accept params directly */
-    cJSON* root = cJSON_CreateObject();
-    if (!root) {
-        return ARC_ERR_NO_MEMORY;
-    }
-
-    /* Model */
-    cJSON_AddStringToObject(root, "model", params->model);
-
-    /* Messages array - system messages from history are included directly */
-    cJSON* msgs_arr = cJSON_AddArrayToObject(root, "messages");
-
-    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
-        cJSON* msg_obj = ac_message_to_json(msg);
-        if (msg_obj) {
-            cJSON_AddItemToArray(msgs_arr, msg_obj);
-        }
-    }
-
-    /* Temperature */
-    if (params->temperature > 0.0f) {
-        cJSON_AddNumberToObject(root, "temperature", (double)params->temperature);
-    }
-
-    /* Max tokens */
-    if (params->max_tokens > 0) {
-        cJSON_AddNumberToObject(root, "max_tokens", params->max_tokens);
-    }
-
-    /* Top-p */
-    if (params->top_p > 0.0f) {
-        cJSON_AddNumberToObject(root, "top_p", (double)params->top_p);
-    }
-
-    /* Stream */
-    cJSON_AddBoolToObject(root, "stream", 0);
-
-    /* Tools */
-    if (tools && strlen(tools) > 0) {
-        cJSON* tools_arr = cJSON_Parse(tools);
-        if (tools_arr) {
-            cJSON_AddItemToObject(root, "tools", tools_arr);
-            cJSON_AddStringToObject(root, "tool_choice", "auto");
-        }
-    }
-
-    char* body = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    if (!body) {
-        if (from_pool) ac_http_pool_release(http);
-        return ARC_ERR_NO_MEMORY;
-    }
-
-    AC_LOG_DEBUG("OpenAI request: %s", body);
-
-    /* Build headers */
-    char auth_header[512];
-    snprintf(auth_header, sizeof(auth_header), "Bearer %s", params->api_key);
-
-    arc_http_header_t* headers = NULL;
-    arc_http_header_append(&headers,
-        arc_http_header_create("Content-Type", "application/json; charset=utf-8"));
-    arc_http_header_append(&headers,
-        arc_http_header_create("Authorization", auth_header));
-
-    /* Make request */
-    arc_http_request_t req = {
-        .url = url,
-        .method = ARC_HTTP_POST,
-        .headers = headers,
-        .body = body,
-        .body_len = strlen(body),
-        .timeout_ms = params->timeout_ms,
-        .verify_ssl = 1,
-    };
-
-    arc_http_response_t http_resp = {0};
-    arc_err_t err = arc_http_request(http, &req, &http_resp);
-
-    /* Cleanup */
-    arc_http_header_free(headers);
-    cJSON_free(body);
-
+    ac_llm_prepared_t prepared;
+    err = openai_chat_prepare(priv, params, messages, tools, &prepared);
     if (err != ARC_OK) {
-        arc_http_response_free(&http_resp);
         if (from_pool) ac_http_pool_release(http);
         return err;
     }
 
-    if (http_resp.status_code != 200) {
-        AC_LOG_ERROR("OpenAI HTTP %d: %s", http_resp.status_code,
-            http_resp.body ? http_resp.body : "");
-        arc_http_response_free(&http_resp);
-        if (from_pool) ac_http_pool_release(http);
-        return ARC_ERR_HTTP;
-    }
-
-    /* Parse response */
-    AC_LOG_DEBUG("OpenAI response: %s", http_resp.body);
-    err = ac_chat_response_parse(http_resp.body, response);
-
-    arc_http_response_free(&http_resp);
+    arc_http_response_t http_resp = {0};
+    err = arc_http_request(http, &prepared.request, &http_resp);
+    ac_ratelimit_observe("openai", params, &http_resp);
+    ac_llm_prepared_free(&prepared);
 
     /* Release HTTP client back to pool */
     if (from_pool) ac_http_pool_release(http);
 
+    if (err == ARC_OK) {
+        err = openai_chat_parse(priv, &http_resp, response);
+        response->ratelimit_wait_ms = queued_ms;   /* Parsing resets the response */
+        if (http_resp.status_code == 200) {
+            ac_llm_timing_from_http(&response->timing, &http_resp, pool_wait_ms);
+        }
+    }
+    arc_http_response_free(&http_resp);
     return err;
 }
 
+/**
+ * @brief Pooled requests each acquire their own client
+ */
+static int openai_reentrant(void* priv_data) {
+    return priv_data && !((openai_priv_t*)priv_data)->owns_http;
+}
+
 /**
  * @brief Cleanup OpenAI provider private data
  */
@@ -247,6 +381,9 @@ static void openai_cleanup(void* priv_data) {
         arc_http_client_destroy(priv->http);
     }
 
+    arc_http_header_set_destroy(priv->headers);
+    ARC_FREE(priv->chat_url);
+    ARC_FREE(priv->embed_url);
     ARC_FREE(priv);
 
     AC_LOG_DEBUG("OpenAI provider cleaned up");
@@ -275,37 +412,90 @@ typedef struct {
     int current_tool_index;
     char* current_tool_id;
     char* current_tool_name;
-    char* accumulated_tool_args;
+    ac_strbuf_t accumulated_tool_args;
+    ac_json_stream_t tool_args_check;  /**< Arguments validated as they arrive */
     
     /* Accumulated content */
-    char* accumulated_text;
-    char* accumulated_reasoning;
+    ac_strbuf_t accumulated_text;
+    ac_strbuf_t accumulated_reasoning;
     
     int aborted;
+    int too_large;               /**< Tool arguments over ARC_STREAM_TOOL_ARGS_MAX */
 } openai_stream_ctx_t;
 
 static void openai_stream_ctx_free(openai_stream_ctx_t* ctx) {
     if (ctx->current_tool_id) ARC_FREE(ctx->current_tool_id);
     if (ctx->current_tool_name) ARC_FREE(ctx->current_tool_name);
-    if (ctx->accumulated_tool_args) ARC_FREE(ctx->accumulated_tool_args);
-    if (ctx->accumulated_text) ARC_FREE(ctx->accumulated_text);
-    if (ctx->accumulated_reasoning) ARC_FREE(ctx->accumulated_reasoning);
+    ac_strbuf_reset(&ctx->accumulated_tool_args);
+    ac_strbuf_reset(&ctx->accumulated_text);
+    ac_strbuf_reset(&ctx->accumulated_reasoning);
     sse_parser_free(&ctx->sse);
 }
 
-static void openai_append_string(char** dst, const char* src, size_t len) {
-    if (!src || len == 0) return;
-    
-    if (*dst) {
-        size_t old_len = strlen(*dst);
-        char* new_str = ARC_REALLOC(*dst, old_len + len + 1);
-        if (new_str) {
-            memcpy(new_str + old_len, src, len);
-            new_str[old_len + len] = '\0';
-            *dst = new_str;
+/**
+ * @brief Offset the next decoded delta starts at
+ *
+ * ARC_STREAM_DELTA_ONLY builds keep only the delta being decoded, never
+ * the text so far.
+ */
+static size_t openai_delta_begin(ac_strbuf_t* acc) {
+#if ARC_STREAM_DELTA_ONLY
+    ac_strbuf_clear(acc);
+#endif
+    return acc->len;
+}
+
+/**
+ * @brief Close the current tool call: add its block and emit BLOCK_STOP
+ *
+ * Called when the next tool call starts and at finish_reason, so each
+ * call is reported as soon as its arguments are complete.
+ */
+static void openai_finish_tool_call(openai_stream_ctx_t* ctx) {
+    if (!ctx->in_tool_call) {
+        return;
+    }
+    ctx->in_tool_call = 0;
+
+    ac_stream_event_t stream_event = {0};
+    stream_event.type = AC_STREAM_CONTENT_BLOCK_STOP;
+    stream_event.block_type = AC_BLOCK_TOOL_USE;
+    stream_event.block_index = ctx->current_tool_index;
+
+    /* Add tool call to response */
+    if (ctx->response && ctx->current_tool_id && ctx->current_tool_name) {
+        ac_content_block_t* block = ARC_CALLOC(1, sizeof(ac_content_block_t));
+        if (block) {
+            block->type = AC_BLOCK_TOOL_USE;
+            block->id = ctx->current_tool_id;
+            block->name = ctx->current_tool_name;
+            block->input_len = ctx->accumulated_tool_args.len;
+            block->input = ac_strbuf_take(&ctx->accumulated_tool_args);
+            ctx->current_tool_id = NULL;
+            ctx->current_tool_name = NULL;
+
+            if (!ctx->response->blocks) {
+                ctx->response->blocks = block;
+            } else {
+                ac_content_block_t* last = ctx->response->blocks;
+                while (last->next) last = last->next;
+                last->next = block;
+            }
+            ctx->response->block_count++;
+
+            stream_event.tool_id = block->id;
+            stream_event.tool_name = block->name;
+            stream_event.tool_input = block->input;
+        }
+    }
+
+    /* Arguments not handed to a block must not leak into the next call */
+    ac_strbuf_reset(&ctx->accumulated_tool_args);
+
+    if (ctx->user_callback) {
+        if (ctx->user_callback(&stream_event, ctx->user_data) != 0) {
+            ctx->aborted = 1;
         }
-    } else {
-        *dst = ARC_STRNDUP(src, len);
     }
 }
 
@@ -328,16 +518,16 @@ static int openai_handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
     }
     
     /* Check for stream end */
-    if (strcmp(event->data, "[DONE]") == 0) {
-        /* Build final blocks from accumulated content */
-        if (ctx->response) {
+    if (event->data_len == 6 && memcmp(event->data, "[DONE]", 6) == 0) {
+        /* Build final blocks from accumulated content (none when delta-only) */
+        if (ctx->response && !ARC_STREAM_DELTA_ONLY) {
             /* Add reasoning block if present */
-            if (ctx->accumulated_reasoning && strlen(ctx->accumulated_reasoning) > 0) {
+            if (ctx->accumulated_reasoning.len > 0) {
                 ac_content_block_t* block = ARC_CALLOC(1, sizeof(ac_content_block_t));
                 if (block) {
                     block->type = AC_BLOCK_REASONING;
-                    block->text = ctx->accumulated_reasoning;
-                    ctx->accumulated_reasoning = NULL;
+                    block->text_len = ctx->accumulated_reasoning.len;
+                    block->text = ac_strbuf_take(&ctx->accumulated_reasoning);
                     
                     if (!ctx->response->blocks) {
                         ctx->response->blocks = block;
@@ -351,12 +541,12 @@ static int openai_handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
             }
             
             /* Add text block if present */
-            if (ctx->accumulated_text && strlen(ctx->accumulated_text) > 0) {
+            if (ctx->accumulated_text.len > 0) {
                 ac_content_block_t* block = ARC_CALLOC(1, sizeof(ac_content_block_t));
                 if (block) {
                     block->type = AC_BLOCK_TEXT;
-                    block->text = ctx->accumulated_text;
-                    ctx->accumulated_text = NULL;
+                    block->text_len = ctx->accumulated_text.len;
+                    block->text = ac_strbuf_take(&ctx->accumulated_text);
                     
                     if (!ctx->response->blocks) {
                         ctx->response->blocks = block;
@@ -368,7 +558,11 @@ static int openai_handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
                     ctx->response->block_count++;
                     
                     /* Also set legacy content field */
-                    ctx->response->content = ARC_STRDUP(block->text);
+                    ctx->response->content = ARC_MALLOC(block->text_len + 1);
+                    if (ctx->response->content) {
+                        memcpy(ctx->response->content, block->text, block->text_len + 1);
+                        ctx->response->content_len = block->text_len;
+                    }
                 }
             }
         }
@@ -382,10 +576,10 @@ static int openai_handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
         return 0;
     }
     
-    /* Parse JSON data */
-    cJSON* data = cJSON_Parse(event->data);
-    if (!data) {
-        AC_LOG_ERROR("Failed to parse OpenAI SSE data: %s", event->data);
+    /* Fields are read straight from the bytes: no tree per delta */
+    ac_json_span_t data = ac_json_scan_root(event->data, event->data_len);
+    if (data.kind != AC_JSON_OBJECT) {
+        AC_LOG_ERROR("Failed to parse OpenAI SSE data: %.*s", (int)event->data_len, event->data);
         return 0;
     }
     
@@ -397,253 +591,228 @@ static int openai_handle_sse_event(const sse_event_t* event, void* ctx_ptr) {
         stream_event.type = AC_STREAM_MESSAGE_START;
         
         /* Extract ID */
-        cJSON* id = cJSON_GetObjectItem(data, "id");
-        if (id && cJSON_IsString(id) && ctx->response) {
-            ctx->response->id = ARC_STRDUP(cJSON_GetStringValue(id));
+        if (ctx->response) {
+            ctx->response->id = ac_json_scan_strdup(ac_json_scan_get(data, "id"));
         }
         
         if (ctx->user_callback) {
             if (ctx->user_callback(&stream_event, ctx->user_data) != 0) {
                 ctx->aborted = 1;
-                cJSON_Delete(data);
                 return -1;
             }
         }
     }
     
     /* Process choices array */
-    cJSON* choices = cJSON_GetObjectItem(data, "choices");
-    if (choices && cJSON_IsArray(choices)) {
-        cJSON* choice = cJSON_GetArrayItem(choices, 0);
-        if (choice) {
-            cJSON* delta = cJSON_GetObjectItem(choice, "delta");
-            cJSON* finish_reason = cJSON_GetObjectItem(choice, "finish_reason");
-            
-            if (delta) {
-                /* Check for reasoning_content (Kimi K2.5 thinking) */
-                cJSON* reasoning_content = cJSON_GetObjectItem(delta, "reasoning_content");
-                if (reasoning_content && cJSON_IsString(reasoning_content)) {
-                    const char* text = cJSON_GetStringValue(reasoning_content);
-                    size_t text_len = strlen(text);
-                    
-                    /* Emit block start if first reasoning chunk */
-                    if (!ctx->in_reasoning) {
-                        ctx->in_reasoning = 1;
-                        stream_event.type = AC_STREAM_CONTENT_BLOCK_START;
-                        stream_event.block_type = AC_BLOCK_REASONING;
-                        stream_event.block_index = 0;
-                        if (ctx->user_callback) {
-                            ctx->user_callback(&stream_event, ctx->user_data);
-                        }
-                    }
-                    
-                    /* Emit delta */
-                    stream_event.type = AC_STREAM_DELTA;
-                    stream_event.delta_type = AC_DELTA_REASONING;
+    ac_json_span_t choice = ac_json_scan_path(data, "choices.0");
+    if (choice.kind == AC_JSON_OBJECT) {
+        ac_json_span_t delta = ac_json_scan_get(choice, "delta");
+        ac_json_span_t finish_reason = ac_json_scan_get(choice, "finish_reason");
+        
+        if (delta.kind == AC_JSON_OBJECT) {
+            /* Check for reasoning_content (Kimi K2.5 thinking) */
+            ac_json_span_t reasoning_content = ac_json_scan_get(delta, "reasoning_content");
+            if (ARC_FEATURE_THINKING && reasoning_content.kind == AC_JSON_STRING) {
+                /* Decoded into the accumulator; the delta is its new tail */
+                size_t old_len = openai_delta_begin(&ctx->accumulated_reasoning);
+                ac_json_scan_append(reasoning_content, &ctx->accumulated_reasoning);
+                
+                /* Emit block start if first reasoning chunk */
+                if (!ctx->in_reasoning) {
+                    ctx->in_reasoning = 1;
+                    stream_event.type = AC_STREAM_CONTENT_BLOCK_START;
                     stream_event.block_type = AC_BLOCK_REASONING;
-                    stream_event.delta = text;
-                    stream_event.delta_len = text_len;
-                    
-                    openai_append_string(&ctx->accumulated_reasoning, text, text_len);
-                    
+                    stream_event.block_index = 0;
                     if (ctx->user_callback) {
-                        if (ctx->user_callback(&stream_event, ctx->user_data) != 0) {
-                            ctx->aborted = 1;
-                            cJSON_Delete(data);
-                            return -1;
-                        }
+                        ctx->user_callback(&stream_event, ctx->user_data);
                     }
                 }
                 
-                /* Check for content */
-                cJSON* content = cJSON_GetObjectItem(delta, "content");
-                if (content && cJSON_IsString(content)) {
-                    const char* text = cJSON_GetStringValue(content);
-                    size_t text_len = strlen(text);
-                    
-                    /* Close reasoning block if transitioning to content */
-                    if (ctx->in_reasoning && !ctx->in_content) {
-                        stream_event.type = AC_STREAM_CONTENT_BLOCK_STOP;
-                        stream_event.block_type = AC_BLOCK_REASONING;
-                        stream_event.block_index = 0;
-                        if (ctx->user_callback) {
-                            ctx->user_callback(&stream_event, ctx->user_data);
-                        }
+                /* Emit delta */
+                stream_event.type = AC_STREAM_DELTA;
+                stream_event.delta_type = AC_DELTA_REASONING;
+                stream_event.block_type = AC_BLOCK_REASONING;
+                stream_event.delta = ac_strbuf_tail(&ctx->accumulated_reasoning, old_len);
+                stream_event.delta_len = ctx->accumulated_reasoning.len - old_len;
+                
+                if (ctx->user_callback) {
+                    if (ctx->user_callback(&stream_event, ctx->user_data) != 0) {
+                        ctx->aborted = 1;
+                        return -1;
                     }
-                    
-                    /* Emit block start if first content chunk */
-                    if (!ctx->in_content) {
-                        ctx->in_content = 1;
-                        stream_event.type = AC_STREAM_CONTENT_BLOCK_START;
-                        stream_event.block_type = AC_BLOCK_TEXT;
-                        stream_event.block_index = ctx->in_reasoning ? 1 : 0;
-                        if (ctx->user_callback) {
-                            ctx->user_callback(&stream_event, ctx->user_data);
-                        }
+                }
+            }
+            
+            /* Check for content */
+            ac_json_span_t content = ac_json_scan_get(delta, "content");
+            if (content.kind == AC_JSON_STRING) {
+                size_t old_len = openai_delta_begin(&ctx->accumulated_text);
+                ac_json_scan_append(content, &ctx->accumulated_text);
+                
+                /* Close reasoning block if transitioning to content */
+                if (ctx->in_reasoning && !ctx->in_content) {
+                    stream_event.type = AC_STREAM_CONTENT_BLOCK_STOP;
+                    stream_event.block_type = AC_BLOCK_REASONING;
+                    stream_event.block_index = 0;
+                    if (ctx->user_callback) {
+                        ctx->user_callback(&stream_event, ctx->user_data);
                     }
-                    
-                    /* Emit delta */
-                    stream_event.type = AC_STREAM_DELTA;
-                    stream_event.delta_type = AC_DELTA_TEXT;
+                }
+                
+                /* Emit block start if first content chunk */
+                if (!ctx->in_content) {
+                    ctx->in_content = 1;
+                    stream_event.type = AC_STREAM_CONTENT_BLOCK_START;
                     stream_event.block_type = AC_BLOCK_TEXT;
-                    stream_event.delta = text;
-                    stream_event.delta_len = text_len;
-                    
-                    openai_append_string(&ctx->accumulated_text, text, text_len);
-                    
+                    stream_event.block_index = ctx->in_reasoning ? 1 : 0;
                     if (ctx->user_callback) {
-                        if (ctx->user_callback(&stream_event, ctx->user_data) != 0) {
-                            ctx->aborted = 1;
-                            cJSON_Delete(data);
-                            return -1;
-                        }
+                        ctx->user_callback(&stream_event, ctx->user_data);
                     }
                 }
                 
-                /* Check for tool_calls */
-                cJSON* tool_calls = cJSON_GetObjectItem(delta, "tool_calls");
-                if (tool_calls && cJSON_IsArray(tool_calls)) {
-                    cJSON* tc = cJSON_GetArrayItem(tool_calls, 0);
-                    if (tc) {
-                        cJSON* index = cJSON_GetObjectItem(tc, "index");
-                        int tc_index = index ? index->valueint : 0;
-                        
-                        /* Check if this is a new tool call */
-                        cJSON* id = cJSON_GetObjectItem(tc, "id");
-                        if (id && cJSON_IsString(id)) {
-                            /* New tool call starting */
-                            ctx->in_tool_call = 1;
-                            ctx->current_tool_index = tc_index;
-                            
-                            if (ctx->current_tool_id) ARC_FREE(ctx->current_tool_id);
-                            ctx->current_tool_id = ARC_STRDUP(cJSON_GetStringValue(id));
-                            
-                            cJSON* func = cJSON_GetObjectItem(tc, "function");
-                            if (func) {
-                                cJSON* name = cJSON_GetObjectItem(func, "name");
-                                if (name && cJSON_IsString(name)) {
-                                    if (ctx->current_tool_name) ARC_FREE(ctx->current_tool_name);
-                                    ctx->current_tool_name = ARC_STRDUP(cJSON_GetStringValue(name));
-                                }
-                            }
-                            
-                            /* Emit tool block start */
-                            stream_event.type = AC_STREAM_CONTENT_BLOCK_START;
-                            stream_event.block_type = AC_BLOCK_TOOL_USE;
-                            stream_event.block_index = tc_index;
-                            stream_event.tool_id = ctx->current_tool_id;
-                            stream_event.tool_name = ctx->current_tool_name;
-                            if (ctx->user_callback) {
-                                ctx->user_callback(&stream_event, ctx->user_data);
-                            }
-                        }
-                        
-                        /* Handle function arguments delta */
-                        cJSON* func = cJSON_GetObjectItem(tc, "function");
-                        if (func) {
-                            cJSON* args = cJSON_GetObjectItem(func, "arguments");
-                            if (args && cJSON_IsString(args)) {
-                                const char* arg_text = cJSON_GetStringValue(args);
-                                size_t arg_len = strlen(arg_text);
-                                
-                                stream_event.type = AC_STREAM_DELTA;
-                                stream_event.delta_type = AC_DELTA_INPUT_JSON;
-                                stream_event.block_type = AC_BLOCK_TOOL_USE;
-                                stream_event.delta = arg_text;
-                                stream_event.delta_len = arg_len;
-                                
-                                openai_append_string(&ctx->accumulated_tool_args, arg_text, arg_len);
-                                
-                                if (ctx->user_callback) {
-                                    ctx->user_callback(&stream_event, ctx->user_data);
-                                }
-                            }
-                        }
+                /* Emit delta */
+                stream_event.type = AC_STREAM_DELTA;
+                stream_event.delta_type = AC_DELTA_TEXT;
+                stream_event.block_type = AC_BLOCK_TEXT;
+                stream_event.delta = ac_strbuf_tail(&ctx->accumulated_text, old_len);
+                stream_event.delta_len = ctx->accumulated_text.len - old_len;
+                
+                if (ctx->user_callback) {
+                    if (ctx->user_callback(&stream_event, ctx->user_data) != 0) {
+                        ctx->aborted = 1;
+                        return -1;
                     }
                 }
             }
             
-            /* Handle finish_reason */
-            if (finish_reason && !cJSON_IsNull(finish_reason) && cJSON_IsString(finish_reason)) {
-                const char* reason = cJSON_GetStringValue(finish_reason);
+            /* Check for tool_calls */
+            ac_json_span_t tc = ac_json_scan_path(delta, "tool_calls.0");
+            if (tc.kind == AC_JSON_OBJECT) {
+                int tc_index = 0;
+                ac_json_scan_int(ac_json_scan_get(tc, "index"), &tc_index);
+                ac_json_span_t func = ac_json_scan_get(tc, "function");
                 
-                /* Close any open blocks */
-                if (ctx->in_content) {
-                    stream_event.type = AC_STREAM_CONTENT_BLOCK_STOP;
-                    stream_event.block_type = AC_BLOCK_TEXT;
+                /* Check if this is a new tool call */
+                ac_json_span_t id = ac_json_scan_get(tc, "id");
+                if (id.kind == AC_JSON_STRING) {
+                    /* New tool call starting: the previous one is complete */
+                    openai_finish_tool_call(ctx);
+                    ctx->in_tool_call = 1;
+                    ctx->current_tool_index = tc_index;
+                    
+                    if (ctx->current_tool_id) ARC_FREE(ctx->current_tool_id);
+                    ctx->current_tool_id = ac_json_scan_strdup(id);
+                    ac_json_stream_init(&ctx->tool_args_check);
+                    
+                    ac_json_span_t name = ac_json_scan_get(func, "name");
+                    if (name.kind == AC_JSON_STRING) {
+                        if (ctx->current_tool_name) ARC_FREE(ctx->current_tool_name);
+                        ctx->current_tool_name = ac_json_scan_strdup(name);
+                    }
+                    
+                    /* Emit tool block start */
+                    stream_event.type = AC_STREAM_CONTENT_BLOCK_START;
+                    stream_event.block_type = AC_BLOCK_TOOL_USE;
+                    stream_event.block_index = tc_index;
+                    stream_event.tool_id = ctx->current_tool_id;
+                    stream_event.tool_name = ctx->current_tool_name;
                     if (ctx->user_callback) {
                         ctx->user_callback(&stream_event, ctx->user_data);
                     }
                 }
                 
-                if (ctx->in_tool_call) {
-                    stream_event.type = AC_STREAM_CONTENT_BLOCK_STOP;
+                /* Handle function arguments delta (none belong to a closed call) */
+                ac_json_span_t args = ac_json_scan_get(func, "arguments");
+                if (args.kind == AC_JSON_STRING && ctx->in_tool_call) {
+                    size_t old_len = ctx->accumulated_tool_args.len;
+                    ac_json_scan_append(args, &ctx->accumulated_tool_args);
+#if ARC_STREAM_TOOL_ARGS_MAX > 0
+                    if (ctx->accumulated_tool_args.len > ARC_STREAM_TOOL_ARGS_MAX) {
+                        AC_LOG_ERROR("OpenAI: arguments for tool %s exceed %zu bytes",
+                                     ctx->current_tool_name ? ctx->current_tool_name : "?",
+                                     (size_t)ARC_STREAM_TOOL_ARGS_MAX);
+                        ctx->too_large = 1;
+                        ctx->aborted = 1;
+                        return -1;
+                    }
+#endif
+                    
+                    stream_event.type = AC_STREAM_DELTA;
+                    stream_event.delta_type = AC_DELTA_INPUT_JSON;
                     stream_event.block_type = AC_BLOCK_TOOL_USE;
+                    stream_event.delta = ac_strbuf_tail(&ctx->accumulated_tool_args, old_len);
+                    stream_event.delta_len = ctx->accumulated_tool_args.len - old_len;
+                    
                     if (ctx->user_callback) {
                         ctx->user_callback(&stream_event, ctx->user_data);
                     }
                     
-                    /* Add tool call to response */
-                    if (ctx->response && ctx->current_tool_id && ctx->current_tool_name) {
-                        ac_content_block_t* block = ARC_CALLOC(1, sizeof(ac_content_block_t));
-                        if (block) {
-                            block->type = AC_BLOCK_TOOL_USE;
-                            block->id = ctx->current_tool_id;
-                            block->name = ctx->current_tool_name;
-                            block->input = ctx->accumulated_tool_args;
-                            ctx->current_tool_id = NULL;
-                            ctx->current_tool_name = NULL;
-                            ctx->accumulated_tool_args = NULL;
-                            
-                            if (!ctx->response->blocks) {
-                                ctx->response->blocks = block;
-                            } else {
-                                ac_content_block_t* last = ctx->response->blocks;
-                                while (last->next) last = last->next;
-                                last->next = block;
-                            }
-                            ctx->response->block_count++;
+                    /* The call is over once its arguments object closes */
+                    ac_json_stream_status_t st = ac_json_stream_status(&ctx->tool_args_check);
+                    if (st == AC_JSON_STREAM_PARTIAL) {
+                        st = ac_json_stream_feed(&ctx->tool_args_check, stream_event.delta,
+                                                 stream_event.delta_len);
+                        if (st == AC_JSON_STREAM_ERROR) {
+                            AC_LOG_WARN("OpenAI: malformed arguments for tool %s at byte %zu",
+                                        ctx->current_tool_name ? ctx->current_tool_name : "?",
+                                        ctx->tool_args_check.offset);
+                        } else if (st == AC_JSON_STREAM_COMPLETE) {
+                            openai_finish_tool_call(ctx);
                         }
                     }
                 }
-                
-                /* Store finish reason */
-                if (ctx->response) {
-                    ctx->response->finish_reason = ARC_STRDUP(reason);
-                    ctx->response->stop_reason = ARC_STRDUP(reason);
-                }
-                
-                /* Emit message delta */
-                stream_event.type = AC_STREAM_MESSAGE_DELTA;
-                stream_event.stop_reason = reason;
+            }
+        }
+        
+        /* Handle finish_reason */
+        if (finish_reason.kind == AC_JSON_STRING) {
+            char* reason = ac_json_scan_strdup(finish_reason);
+            
+            /* Close any open blocks */
+            if (ctx->in_content) {
+                stream_event.type = AC_STREAM_CONTENT_BLOCK_STOP;
+                stream_event.block_type = AC_BLOCK_TEXT;
                 if (ctx->user_callback) {
                     ctx->user_callback(&stream_event, ctx->user_data);
                 }
             }
+            
+            openai_finish_tool_call(ctx);
+            
+            /* Emit message delta */
+            stream_event.type = AC_STREAM_MESSAGE_DELTA;
+            stream_event.stop_reason = reason;
+            if (ctx->user_callback) {
+                ctx->user_callback(&stream_event, ctx->user_data);
+            }
+            
+            /* Store finish reason */
+            if (ctx->response && reason) {
+                ctx->response->finish_reason = reason;
+                ctx->response->stop_reason = ARC_STRDUP(reason);
+            } else if (reason) {
+                ARC_FREE(reason);
+            }
         }
     }
     
     /* Handle usage info */
-    cJSON* usage = cJSON_GetObjectItem(data, "usage");
-    if (usage && ctx->response) {
-        cJSON* pt = cJSON_GetObjectItem(usage, "prompt_tokens");
-        cJSON* ct = cJSON_GetObjectItem(usage, "completion_tokens");
-        cJSON* tt = cJSON_GetObjectItem(usage, "total_tokens");
-        
-        if (pt && cJSON_IsNumber(pt)) {
-            ctx->response->input_tokens = pt->valueint;
-            ctx->response->prompt_tokens = pt->valueint;
+    ac_json_span_t usage = ac_json_scan_get(data, "usage");
+    if (usage.kind == AC_JSON_OBJECT && ctx->response) {
+        int tokens;
+        if (ac_json_scan_int(ac_json_scan_get(usage, "prompt_tokens"), &tokens)) {
+            ctx->response->input_tokens = tokens;
+            ctx->response->prompt_tokens = tokens;
         }
-        if (ct && cJSON_IsNumber(ct)) {
-            ctx->response->output_tokens = ct->valueint;
-            ctx->response->completion_tokens = ct->valueint;
+        if (ac_json_scan_int(ac_json_scan_get(usage, "completion_tokens"), &tokens)) {
+            ctx->response->output_tokens = tokens;
+            ctx->response->completion_tokens = tokens;
         }
-        if (tt && cJSON_IsNumber(tt)) {
-            ctx->response->total_tokens = tt->valueint;
+        if (ac_json_scan_int(ac_json_scan_get(usage, "total_tokens"), &tokens)) {
+            ctx->response->total_tokens = tokens;
         }
     }
     
-    cJSON_Delete(data);
     return ctx->aborted ? -1 : 0;
 }
 
@@ -654,29 +823,46 @@ static int openai_http_stream_callback(const char* data, size_t len, void* user_
 
 /**
  * @brief Perform streaming chat completion
+ *
+ * @param raw  Pass the body through instead of emitting events (callback NULL)
  */
-static arc_err_t openai_chat_stream(
+static arc_err_t openai_stream(
     void* priv_data,
     const ac_llm_params_t* params,
     const ac_message_t* messages,
     const char* tools,
     ac_stream_callback_t callback,
     void* user_data,
+    ac_llm_raw_tap_t* raw,
     ac_chat_response_t* response
 ) {
-    if (!priv_data || !params || !callback) {
+    if (!priv_data || !params || (!callback && !raw)) {
         return ARC_ERR_INVALID_ARG;
     }
 
+    /* Queue on the key's quota before holding a connection */
+    uint32_t queued_ms = 0;
+    arc_err_t err = ac_ratelimit_acquire("openai", params, messages, tools, &queued_ms);
+    if (err != ARC_OK) {
+        if (response) {
+            response->ratelimit_wait_ms = queued_ms;
+        }
+        return err;
+    }
+
     openai_priv_t* priv = (openai_priv_t*)priv_data;
     arc_http_client_t* http = NULL;
     int from_pool = 0;
+    uint32_t pool_wait_ms = 0;
 
     /* Get HTTP client */
     if (priv->owns_http) {
         http = priv->http;
     } else if (http_pool_available()) {
-        http = ac_http_pool_acquire(params->timeout_ms > 0 ? params->timeout_ms : 120000);
+        uint64_t pool_start_ms = ac_platform_timestamp_ms();
+        http = ac_http_pool_acquire_priority(params->timeout_ms > 0 ? params->timeout_ms : 120000,
+                                             params->priority);
+        pool_wait_ms = (uint32_t)(ac_platform_timestamp_ms() - pool_start_ms);
         if (!http) {
             AC_LOG_ERROR("OpenAI: failed to acquire HTTP client from pool");
             return ARC_ERR_TIMEOUT;
@@ -687,79 +873,35 @@ static arc_err_t openai_chat_stream(
         return ARC_ERR_NOT_INITIALIZED;
     }
 
-    /* Build URL */
-    char url[512];
-    snprintf(url, sizeof(url), "%s/chat/completions", params->api_base);
-
-    /* Build request JSON */
-    cJSON* root = cJSON_CreateObject();
-    if (!root) {
-        if (from_pool) ac_http_pool_release(http);
-        return ARC_ERR_NO_MEMORY;
-    }
-
-    cJSON_AddStringToObject(root, "model", params->model);
-    cJSON_AddBoolToObject(root, "stream", 1);  /* Enable streaming */
-    
-    /* Add stream_options for usage stats (OpenAI compatible) */
-    cJSON* stream_opts = cJSON_CreateObject();
-    cJSON_AddBoolToObject(stream_opts, "include_usage", 1);
-    cJSON_AddItemToObject(root, "stream_options", stream_opts);
-
-    /* Messages array - system messages from history are included directly */
-    cJSON* msgs_arr = cJSON_AddArrayToObject(root, "messages");
-
-    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
-        cJSON* msg_obj = ac_message_to_json(msg);
-        if (msg_obj) {
-            cJSON_AddItemToArray(msgs_arr, msg_obj);
-        }
-    }
-
-    /* Temperature */
-    if (params->temperature > 0.0f) {
-        cJSON_AddNumberToObject(root, "temperature", (double)params->temperature);
-    }
+    const char* url = priv->chat_url;
 
-    /* Max tokens */
-    if (params->max_tokens > 0) {
-        cJSON_AddNumberToObject(root, "max_tokens", params->max_tokens);
+    /* Build request JSON: messages and tools are spliced in by the body source */
+    if (tools && tools[0] == '\0') {
+        tools = NULL;
     }
+    ac_prof_push(AC_PROF_SERIALIZE);
+    char* fields = openai_request_fields(params, tools, OPENAI_BODY_STREAM);
 
-    /* Top-p */
-    if (params->top_p > 0.0f) {
-        cJSON_AddNumberToObject(root, "top_p", (double)params->top_p);
-    }
-
-    /* Tools */
-    if (tools && strlen(tools) > 0) {
-        cJSON* tools_arr = cJSON_Parse(tools);
-        if (tools_arr) {
-            cJSON_AddItemToObject(root, "tools", tools_arr);
-            cJSON_AddStringToObject(root, "tool_choice", "auto");
-        }
-    }
+    ac_json_body_source_t* source =
+        ac_json_body_source_create(fields, messages, AC_JSON_DIALECT_OPENAI, tools, 0);
+    ac_prof_pop();
 
-    char* body = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    if (!body) {
+    if (!source) {
+        ARC_FREE(fields);
         if (from_pool) ac_http_pool_release(http);
         return ARC_ERR_NO_MEMORY;
     }
 
-    AC_LOG_DEBUG("OpenAI stream request to %s", url);
-    AC_LOG_DEBUG("OpenAI stream body: %s", body);
-
-    /* Build headers */
-    char auth_header[512];
-    snprintf(auth_header, sizeof(auth_header), "Bearer %s", params->api_key);
+    /* Streamed from the fragments unless gzip (or the debug dump) needs it whole */
+    char* body = NULL;
+    if (params->compress_requests || ac_log_get_level() >= AC_LOG_LEVEL_DEBUG) {
+        ac_prof_push(AC_PROF_SERIALIZE);
+        body = ac_json_body_source_flatten(source);
+        ac_prof_pop();
+    }
 
-    arc_http_header_t* headers = NULL;
-    arc_http_header_append(&headers,
-        arc_http_header_create("Content-Type", "application/json; charset=utf-8"));
-    arc_http_header_append(&headers,
-        arc_http_header_create("Authorization", auth_header));
+    AC_LOG_DEBUG("OpenAI stream request to %s", url);
+    AC_LOG_DEBUG("OpenAI stream body: %s", body ? body : "(streamed)");
 
     /* Initialize stream context */
     openai_stream_ctx_t ctx = {0};
@@ -771,6 +913,7 @@ static arc_err_t openai_chat_stream(
 
     if (response) {
         ac_chat_response_init(response);
+        response->ratelimit_wait_ms = queued_ms;
     }
 
     /* Make streaming HTTP request */
@@ -778,38 +921,65 @@ static arc_err_t openai_chat_stream(
         .base = {
             .url = url,
             .method = ARC_HTTP_POST,
-            .headers = headers,
+            .header_set = priv->headers,
             .body = body,
-            .body_len = strlen(body),
+            .body_len = ac_json_body_source_length(source),
             .timeout_ms = params->timeout_ms > 0 ? params->timeout_ms : 120000,
             .verify_ssl = 1,
+            .compress_body = params->compress_requests,
+            .cancel = params->cancel,
+            .body_read = body ? NULL : ac_json_body_source_read,
+            .body_rewind = ac_json_body_source_rewind,
+            .body_user_data = source,
         },
-        .on_data = openai_http_stream_callback,
+        .on_data = raw && !raw->decode ? ac_llm_raw_skip : openai_http_stream_callback,
         .user_data = &ctx,
+        .tap = raw ? ac_llm_raw_tap : NULL,
+        .tap_user_data = raw,
     };
+    if (raw) {
+        raw->state = 0;
+    }
 
     arc_http_response_t http_resp = {0};
-    arc_err_t err = arc_http_request_stream(http, &req, &http_resp);
+    err = arc_http_request_stream(http, &req, &http_resp);
+    ac_ratelimit_observe("openai", params, &http_resp);
 
     /* Cleanup */
-    arc_http_header_free(headers);
-    cJSON_free(body);
+    int too_large = ctx.too_large || ctx.sse.overflow;
+    ARC_FREE(body);
+    ac_json_body_source_free(source);
+    ARC_FREE(fields);
     openai_stream_ctx_free(&ctx);
 
     if (from_pool) ac_http_pool_release(http);
 
+    /* Over a streaming limit: the parts seen so far are not a response */
+    if (too_large) {
+        arc_http_response_free(&http_resp);
+        return ARC_ERR_RESPONSE_TOO_LARGE;
+    }
+
     if (err != ARC_OK && !ctx.aborted) {
         AC_LOG_ERROR("OpenAI stream request failed: %d", err);
+        arc_http_response_free(&http_resp);
         return err;
     }
 
     if (http_resp.status_code != 200 && http_resp.status_code != 0) {
         AC_LOG_ERROR("OpenAI HTTP %d: %s", http_resp.status_code,
             http_resp.body ? http_resp.body : "");
+        if (response) {
+            response->http_status = http_resp.status_code;
+            response->retry_after_ms = http_resp.retry_after_ms;
+        }
         arc_http_response_free(&http_resp);
         return ARC_ERR_HTTP;
     }
 
+    if (response) {
+        ac_llm_timing_from_http(&response->timing, &http_resp, pool_wait_ms);
+    }
     arc_http_response_free(&http_resp);
 
     AC_LOG_DEBUG("OpenAI stream completed: blocks=%d", 
@@ -817,21 +987,501 @@ static arc_err_t openai_chat_stream(
     return ARC_OK;
 }
 
+static arc_err_t openai_chat_stream(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_stream_callback_t callback,
+    void* user_data,
+    ac_chat_response_t* response
+) {
+    return openai_stream(priv_data, params, messages, tools, callback, user_data, NULL, response);
+}
+
+static arc_err_t openai_chat_stream_raw(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_raw_tap_t* raw,
+    ac_chat_response_t* response
+) {
+    return openai_stream(priv_data, params, messages, tools, NULL, NULL, raw, response);
+}
+
+/*============================================================================
+ * Batch API
+ *
+ * A part is uploaded as a JSONL file (purpose "batch") and run as one
+ * batch against /v1/chat/completions. Each result line carries the
+ * response body the chat call would have returned.
+ *============================================================================*/
+
+/** Uploads and result downloads are large; params->timeout_ms bounds chat calls */
+#define OPENAI_BATCH_TIMEOUT_MS 600000
+
+#define OPENAI_BATCH_BOUNDARY "arc-batch-3c9e1f7a5d2b4086"
+
+static arc_http_client_t* openai_batch_client(openai_priv_t* priv, int* from_pool) {
+    *from_pool = 0;
+    if (priv->owns_http) {
+        return priv->http;
+    }
+    if (http_pool_available()) {
+        arc_http_client_t* http = ac_http_pool_acquire(30000);
+        *from_pool = http != NULL;
+        return http;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Send one batch endpoint request
+ *
+ * @param body  200 response body (ARC_FREE), or NULL to stream it to stream->on_data
+ */
+static arc_err_t openai_batch_call(openai_priv_t* priv, arc_http_stream_request_t* stream,
+                                   char** body) {
+    int from_pool = 0;
+    arc_http_client_t* http = openai_batch_client(priv, &from_pool);
+    if (!http) {
+        AC_LOG_ERROR("OpenAI: no HTTP client available");
+        return ARC_ERR_NOT_INITIALIZED;
+    }
+
+    stream->base.timeout_ms = OPENAI_BATCH_TIMEOUT_MS;
+    stream->base.verify_ssl = 1;
+
+    arc_http_response_t http_resp = {0};
+    arc_err_t err = body ? arc_http_request(http, &stream->base, &http_resp)
+                         : arc_http_request_stream(http, stream, &http_resp);
+    if (from_pool) ac_http_pool_release(http);
+
+    if (err == ARC_OK && http_resp.status_code != 200) {
+        AC_LOG_ERROR("OpenAI batch HTTP %d: %s", http_resp.status_code,
+            http_resp.body ? http_resp.body : "");
+        err = ARC_ERR_HTTP;
+    }
+    if (err == ARC_OK && body) {
+        *body = http_resp.body;
+        http_resp.body = NULL;
+        if (!*body) {
+            err = ARC_ERR_PARSE;
+        }
+    }
+    arc_http_response_free(&http_resp);
+    return err;
+}
+
+static arc_err_t openai_batch_item(const ac_llm_params_t* params, const ac_message_t* messages,
+                                   const char* tools, ac_llm_batch_item_t* out) {
+    (void)messages;
+    if (tools && tools[0] == '\0') {
+        tools = NULL;
+    }
+    out->fields = openai_request_fields(params, tools, OPENAI_BODY_BATCH);
+    out->tools = tools;
+    return out->fields ? ARC_OK : ARC_ERR_NO_MEMORY;
+}
+
+static arc_err_t openai_batch_submit(void* priv_data, const ac_llm_params_t* params,
+                                     ac_llm_batch_body_t* body, char** id) {
+    openai_priv_t* priv = (openai_priv_t*)priv_data;
+    char url[512];
+    char auth[512];
+    snprintf(auth, sizeof(auth), "Bearer %s", params->api_key ? params->api_key : "");
+
+    /* 1. Upload the part as a multipart file */
+    body->head =
+        "--" OPENAI_BATCH_BOUNDARY "\r\n"
+        "Content-Disposition: form-data; name=\"purpose\"\r\n\r\n"
+        "batch\r\n"
+        "--" OPENAI_BATCH_BOUNDARY "\r\n"
+        "Content-Disposition: form-data; name=\"file\"; filename=\"batch.jsonl\"\r\n"
+        "Content-Type: application/jsonl\r\n\r\n";
+    body->tail = "\r\n--" OPENAI_BATCH_BOUNDARY "--\r\n";
+
+    arc_http_header_t auth_header = { .name = "Authorization", .value = auth };
+    arc_http_header_t multipart = {
+        .name = "Content-Type",
+        .value = "multipart/form-data; boundary=" OPENAI_BATCH_BOUNDARY,
+        .next = &auth_header };
+
+    snprintf(url, sizeof(url), "%s/files", params->api_base);
+    arc_http_stream_request_t upload = {
+        .base = {
+            .url = url,
+            .method = ARC_HTTP_POST,
+            .headers = &multipart,
+            .body_len = ac_llm_batch_body_length(body),
+            .cancel = params->cancel,
+            .body_read = ac_llm_batch_body_read,
+            .body_rewind = ac_llm_batch_body_rewind,
+            .body_user_data = body,
+        },
+    };
+
+    char* resp = NULL;
+    arc_err_t err = openai_batch_call(priv, &upload, &resp);
+    if (err != ARC_OK) {
+        return err;
+    }
+    char* file_id = ac_json_scan_strdup(
+        ac_json_scan_get(ac_json_scan_root(resp, strlen(resp)), "id"));
+    ARC_FREE(resp);
+    if (!file_id) {
+        AC_LOG_ERROR("OpenAI: file upload returned no id");
+        return ARC_ERR_PARSE;
+    }
+
+    /* 2. Create the batch over the uploaded file */
+    ac_json_writer_t jw = AC_JSON_WRITER_INIT;
+    ac_json_write_object_begin(&jw);
+    ac_json_write_member_string(&jw, "input_file_id", file_id);
+    ac_json_write_member_string(&jw, "endpoint", "/v1/chat/completions");
+    ac_json_write_member_string(&jw, "completion_window", "24h");
+    ac_json_write_object_end(&jw);
+    char* request = ac_json_writer_take(&jw);
+    ARC_FREE(file_id);
+    if (!request) {
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    snprintf(url, sizeof(url), "%s/batches", params->api_base);
+    arc_http_stream_request_t create = {
+        .base = {
+            .url = url,
+            .method = ARC_HTTP_POST,
+            .header_set = priv->headers,
+            .body = request,
+            .body_len = strlen(request),
+            .cancel = params->cancel,
+        },
+    };
+    err = openai_batch_call(priv, &create, &resp);
+    ARC_FREE(request);
+    if (err != ARC_OK) {
+        return err;
+    }
+    *id = ac_json_scan_strdup(ac_json_scan_get(ac_json_scan_root(resp, strlen(resp)), "id"));
+    ARC_FREE(resp);
+    return *id ? ARC_OK : ARC_ERR_PARSE;
+}
+
+static arc_err_t openai_batch_poll(void* priv_data, const ac_llm_params_t* params,
+                                   const char* id, ac_llm_batch_status_t* status,
+                                   char** results) {
+    openai_priv_t* priv = (openai_priv_t*)priv_data;
+    char url[512];
+    snprintf(url, sizeof(url), "%s/batches/%s", params->api_base, id);
+    arc_http_stream_request_t req = {
+        .base = {
+            .url = url,
+            .method = ARC_HTTP_GET,
+            .header_set = priv->headers,
+            .cancel = params->cancel,
+        },
+    };
+
+    char* resp = NULL;
+    arc_err_t err = openai_batch_call(priv, &req, &resp);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    ac_json_span_t root = ac_json_scan_root(resp, strlen(resp));
+    ac_json_span_t state = ac_json_scan_get(root, "status");
+    if (state.kind != AC_JSON_STRING) {
+        ARC_FREE(resp);
+        return ARC_ERR_PARSE;
+    }
+
+    int total = 0, completed = 0, failed = 0;
+    ac_json_span_t counts = ac_json_scan_get(root, "request_counts");
+    ac_json_scan_int(ac_json_scan_get(counts, "total"), &total);
+    ac_json_scan_int(ac_json_scan_get(counts, "completed"), &completed);
+    ac_json_scan_int(ac_json_scan_get(counts, "failed"), &failed);
+    status->total = (size_t)total;
+    status->succeeded = (size_t)completed;
+    status->failed = (size_t)failed;
+
+    if (ac_json_scan_str_eq(state, "failed")) {
+        status->state = AC_LLM_BATCH_FAILED;
+    } else if (ac_json_scan_str_eq(state, "completed") ||
+               ac_json_scan_str_eq(state, "expired") ||
+               ac_json_scan_str_eq(state, "cancelled")) {
+        status->state = AC_LLM_BATCH_ENDED;
+        /* Requests an expired or cancelled batch never ran count as failed */
+        if (status->total > status->succeeded + status->failed) {
+            status->failed = status->total - status->succeeded;
+        }
+    } else {
+        status->state = AC_LLM_BATCH_RUNNING;
+    }
+
+    /* Results: output file, error file, comma separated */
+    if (status->state != AC_LLM_BATCH_RUNNING) {
+        char* output = ac_json_scan_strdup(ac_json_scan_get(root, "output_file_id"));
+        char* errors = ac_json_scan_strdup(ac_json_scan_get(root, "error_file_id"));
+        if (output && errors) {
+            size_t len = strlen(output) + 1 + strlen(errors) + 1;
+            *results = (char*)ARC_MALLOC(len);
+            if (*results) {
+                snprintf(*results, len, "%s,%s", output, errors);
+            }
+        } else {
+            *results = output ? output : errors;
+            output = errors = NULL;
+        }
+        ARC_FREE(output);
+        ARC_FREE(errors);
+    }
+
+    ARC_FREE(resp);
+    return ARC_OK;
+}
+
+static arc_err_t openai_batch_fetch(void* priv_data, const ac_llm_params_t* params,
+                                    const char* results, arc_stream_callback_t on_data,
+                                    void* user_data) {
+    openai_priv_t* priv = (openai_priv_t*)priv_data;
+    arc_err_t err = ARC_OK;
+
+    while (*results && err == ARC_OK) {
+        size_t len = strcspn(results, ",");
+        char url[512];
+        snprintf(url, sizeof(url), "%s/files/%.*s/content",
+                 params->api_base, (int)len, results);
+        arc_http_stream_request_t req = {
+            .base = {
+                .url = url,
+                .method = ARC_HTTP_GET,
+                .header_set = priv->headers,
+                .cancel = params->cancel,
+            },
+            .on_data = on_data,
+            .user_data = user_data,
+        };
+        err = openai_batch_call(priv, &req, NULL);
+        results += len + (results[len] == ',');
+    }
+    return err;
+}
+
+static arc_err_t openai_batch_parse(const char* line, size_t len, char** custom_id,
+                                    ac_chat_response_t* response) {
+    ac_json_span_t root = ac_json_scan_root(line, len);
+    *custom_id = ac_json_scan_strdup(ac_json_scan_get(root, "custom_id"));
+    if (!*custom_id) {
+        return ARC_ERR_PARSE;
+    }
+
+    ac_json_span_t error = ac_json_scan_get(root, "error");
+    if (error.kind != AC_JSON_NONE && error.kind != AC_JSON_NULL) {
+        return ARC_ERR_BACKEND;
+    }
+
+    ac_json_span_t resp = ac_json_scan_get(root, "response");
+    int status_code = 0;
+    ac_json_scan_int(ac_json_scan_get(resp, "status_code"), &status_code);
+    if (status_code != 200) {
+        response->http_status = status_code;
+        return ARC_ERR_HTTP;
+    }
+
+    ac_json_span_t body = ac_json_scan_get(resp, "body");
+    if (body.kind != AC_JSON_OBJECT) {
+        return ARC_ERR_PARSE;
+    }
+    char* json = ARC_STRNDUP(body.start, (size_t)(body.end - body.start));
+    if (!json) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    arc_err_t err = ac_chat_response_parse(json, response);
+    ARC_FREE(json);
+    return err;
+}
+
+static const ac_llm_batch_ops_t openai_batch_ops = {
+    .max_requests = 50000,
+    .max_bytes = 200u * 1024 * 1024,
+    .part_head = "",
+    .item_sep = "\n",
+    .part_tail = "\n",
+    .item_key = "\"method\":\"POST\",\"url\":\"/v1/chat/completions\",\"body\":",
+    .item = openai_batch_item,
+    .submit = openai_batch_submit,
+    .poll = openai_batch_poll,
+    .fetch = openai_batch_fetch,
+    .parse = openai_batch_parse,
+};
+
+/*============================================================================
+ * Embeddings
+ *
+ * POST {api_base}/embeddings with every input of the batch at once.
+ * Vectors come back as JSON numbers (encoding_format "float", which
+ * every compatible server speaks) and are read with json_scan, without
+ * a tree of thousands of number nodes.
+ *============================================================================*/
+
+/**
+ * @brief Read one "embedding" array into row (dims floats)
+ * @return Elements read
+ */
+static size_t openai_embed_row(ac_json_span_t embedding, float* row, size_t dims) {
+    ac_json_iter_t it = ac_json_scan_elements(embedding);
+    ac_json_span_t v;
+    size_t n = 0;
+    while (ac_json_scan_next_element(&it, &v)) {
+        if (v.kind != AC_JSON_NUMBER || n == dims) {
+            return dims + 1;
+        }
+        row[n++] = strtof(v.start, NULL);
+    }
+    return n;
+}
+
+/**
+ * @brief Parse an embeddings response into result (rows by "index")
+ */
+static arc_err_t openai_embed_parse(const char* body, size_t len, size_t count,
+                                    ac_llm_embed_result_t* result) {
+    ac_json_span_t data = ac_json_scan_get(ac_json_scan_root(body, len), "data");
+    ac_json_iter_t it = ac_json_scan_elements(data);
+    ac_json_span_t item;
+    size_t filled = 0;
+
+    while (ac_json_scan_next_element(&it, &item)) {
+        ac_json_span_t embedding = ac_json_scan_get(item, "embedding");
+        int index = -1;
+        if (!ac_json_scan_int(ac_json_scan_get(item, "index"), &index) ||
+            index < 0 || (size_t)index >= count || embedding.kind != AC_JSON_ARRAY) {
+            return ARC_ERR_PARSE;
+        }
+
+        /* The first vector fixes the dimension */
+        if (!result->vectors) {
+            ac_json_iter_t probe = ac_json_scan_elements(embedding);
+            while (ac_json_scan_next_element(&probe, NULL)) {
+                result->dims++;
+            }
+            if (result->dims == 0) {
+                return ARC_ERR_PARSE;
+            }
+            result->vectors = ARC_CALLOC(count * result->dims, sizeof(float));
+            if (!result->vectors) {
+                return ARC_ERR_NO_MEMORY;
+            }
+        }
+        if (openai_embed_row(embedding, result->vectors + (size_t)index * result->dims,
+                             result->dims) != result->dims) {
+            return ARC_ERR_PARSE;
+        }
+        filled++;
+    }
+    return filled == count ? ARC_OK : ARC_ERR_PARSE;
+}
+
+static arc_err_t openai_embed(void* priv_data, const ac_llm_params_t* params,
+                              const char* const* inputs, size_t count,
+                              ac_llm_embed_result_t* result) {
+    openai_priv_t* priv = (openai_priv_t*)priv_data;
+    arc_http_client_t* http = NULL;
+    int from_pool = 0;
+
+    if (priv->owns_http) {
+        http = priv->http;
+    } else if (http_pool_available()) {
+        http = ac_http_pool_acquire_priority(params->timeout_ms > 0 ? params->timeout_ms : 30000,
+                                             params->priority);
+        if (!http) {
+            AC_LOG_ERROR("OpenAI: failed to acquire HTTP client from pool");
+            return ARC_ERR_TIMEOUT;
+        }
+        from_pool = 1;
+    } else {
+        AC_LOG_ERROR("OpenAI: no HTTP client available");
+        return ARC_ERR_NOT_INITIALIZED;
+    }
+
+    ac_json_writer_t jw = AC_JSON_WRITER_INIT;
+    ac_json_write_object_begin(&jw);
+    ac_json_write_member_string(&jw, "model", params->embed.model ? params->embed.model
+                                                                  : params->model);
+    ac_json_write_key(&jw, "input");
+    ac_json_write_array_begin(&jw);
+    for (size_t i = 0; i < count; i++) {
+        ac_json_write_string(&jw, inputs[i]);
+    }
+    ac_json_write_array_end(&jw);
+    ac_json_write_member_string(&jw, "encoding_format", "float");
+    if (params->embed.dimensions > 0) {
+        ac_json_write_member_int(&jw, "dimensions", params->embed.dimensions);
+    }
+    ac_json_write_object_end(&jw);
+    char* body = ac_json_writer_take(&jw);
+    if (!body) {
+        if (from_pool) ac_http_pool_release(http);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    arc_http_request_t req = {
+        .url = priv->embed_url,
+        .method = ARC_HTTP_POST,
+        .header_set = priv->headers,
+        .body = body,
+        .body_len = strlen(body),
+        .timeout_ms = params->timeout_ms,
+        .verify_ssl = 1,
+        .compress_body = params->compress_requests,
+        .cancel = params->cancel,
+    };
+
+    arc_http_response_t http_resp = {0};
+    arc_err_t err = arc_http_request(http, &req, &http_resp);
+    ARC_FREE(body);
+    if (from_pool) ac_http_pool_release(http);
+
+    if (err == ARC_OK && http_resp.status_code != 200) {
+        AC_LOG_ERROR("OpenAI embeddings HTTP %d: %s", http_resp.status_code,
+            http_resp.body ? http_resp.body : "");
+        result->http_status = http_resp.status_code;
+        result->retry_after_ms = http_resp.retry_after_ms;
+        err = ARC_ERR_HTTP;
+    } else if (err == ARC_OK) {
+        err = http_resp.body ? openai_embed_parse(http_resp.body, http_resp.body_len, count, result)
+                             : ARC_ERR_PARSE;
+        if (err != ARC_OK) {
+            AC_LOG_ERROR("OpenAI embeddings: malformed response");
+            ARC_FREE(result->vectors);
+            result->vectors = NULL;
+            result->dims = 0;
+        }
+    }
+    arc_http_response_free(&http_resp);
+    return err;
+}
+
 /**
  * @brief OpenAI provider definition
  *
- * Exported (non-static) so llm.c can register it during lazy initialization.
- * The AC_PROVIDER_REGISTER macro provides automatic registration for custom
- * providers loaded dynamically or in shared libraries.
+ * Exported (non-static) for the built-in provider table in provider.c.
  */
 const ac_llm_ops_t openai_ops = {
     .name = "openai",
-    .capabilities = AC_LLM_CAP_TOOLS | AC_LLM_CAP_STREAMING | AC_LLM_CAP_REASONING,
+    .capabilities = AC_LLM_CAP_TOOLS | AC_LLM_CAP_STREAMING | AC_LLM_CAP_REASONING |
+                    AC_LLM_CAP_VISION,
+    .json_dialect = AC_JSON_DIALECT_OPENAI,
     .create = openai_create,
     .chat = openai_chat,
+    .chat_prepare = openai_chat_prepare,
+    .chat_parse = openai_chat_parse,
     .chat_stream = openai_chat_stream,
+    .chat_stream_raw = openai_chat_stream_raw,
+    .batch = &openai_batch_ops,
+    .embed = openai_embed,
+    .reentrant = openai_reentrant,
     .cleanup = openai_cleanup,
 };
-
-/* Auto-register provider at program startup (for dynamic/shared library builds) */
-AC_PROVIDER_REGISTER(openai, &openai_ops);
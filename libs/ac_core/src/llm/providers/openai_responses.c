@@ -0,0 +1,578 @@
+/**
+ * @file openai_responses.c
+ * @brief OpenAI Responses API provider (stateful mode)
+ *
+ * POST {api_base}/responses. With params->stateful.store the server keeps
+ * each response, and a request carrying previous_response_id sends only
+ * the messages appended since that response: per-turn request size is
+ * proportional to the new messages, not to the history. The agent tracks
+ * the chain (see agent_llm_chat in agent.c).
+ *
+ * With params->websocket, calls go as response.create events over one
+ * WebSocket kept open for the life of the provider instead of one POST
+ * each. The server keeps the last response of a connection even without
+ * store, so chaining works unstored there; if the connection is lost, the
+ * server rejects the chained request and the agent resends the history.
+ * An endpoint that refuses the upgrade is used over HTTP from then on.
+ *
+ * Non-streaming only.
+ */
+
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "arc/profile.h"
+#include "http_client.h"
+#include "ws_client.h"
+#include "../llm_provider.h"
+#include "../ratelimit.h"
+#include "../message/message_json.h"
+#include "json_writer.h"
+#include "json_scan.h"
+#include "cJSON.h"
+#include <string.h>
+#include <stdio.h>
+
+/*============================================================================
+ * HTTP Pool Integration (weak symbols for optional linking)
+ *============================================================================*/
+
+__attribute__((weak)) int ac_http_pool_is_initialized(void);
+__attribute__((weak)) arc_http_client_t *ac_http_pool_acquire_priority(
+    uint32_t timeout_ms, ac_priority_t priority);
+__attribute__((weak)) void ac_http_pool_release(arc_http_client_t *client);
+
+static int http_pool_available(void) {
+    return ac_http_pool_is_initialized && ac_http_pool_is_initialized();
+}
+
+#define RESPONSES_DEFAULT_BASE  "https://api.openai.com/v1"
+
+/**
+ * @brief Responses provider private data
+ */
+typedef struct {
+    arc_http_client_t *http;        /**< Owned HTTP client (NULL if using pool) */
+    int owns_http;                  /**< 1 if we created the client, 0 if from pool */
+    arc_http_header_set_t *headers; /**< Static request headers, built once */
+    char *url;                      /**< api_base + /responses, built once */
+    int websocket;                  /**< params->websocket */
+    arc_ws_t *ws;                   /**< Open connection, NULL until the first call */
+    int ws_refused;                 /**< The endpoint refused the upgrade: HTTP from now on */
+} responses_priv_t;
+
+static arc_http_header_set_t* responses_headers_create(const ac_llm_params_t* params) {
+    char auth_header[512];
+    snprintf(auth_header, sizeof(auth_header), "Bearer %s",
+             params->api_key ? params->api_key : "");
+
+    arc_http_header_t auth = { .name = "Authorization", .value = auth_header };
+    arc_http_header_t content_type = {
+        .name = "Content-Type", .value = "application/json; charset=utf-8", .next = &auth };
+
+    arc_http_header_set_t* set = NULL;
+    arc_http_header_set_create(&content_type, &set);
+    return set;
+}
+
+/**
+ * @brief Convert Chat Completions tools to the Responses layout
+ *
+ * Chat:      [{"type": "function", "function": {"name": ..., "parameters": ...}}]
+ * Responses: [{"type": "function", "name": ..., "parameters": ...}]
+ *
+ * @return Serialized array (cJSON_free), NULL if there is nothing to send
+ */
+static char* convert_tools(const char* tools_json) {
+    cJSON* input = cJSON_Parse(tools_json);
+    if (!input || !cJSON_IsArray(input)) {
+        if (input) cJSON_Delete(input);
+        return NULL;
+    }
+
+    cJSON* output = cJSON_CreateArray();
+    cJSON* tool = NULL;
+    cJSON_ArrayForEach(tool, input) {
+        cJSON* func = cJSON_GetObjectItem(tool, "function");
+        if (!func) {
+            func = tool;  /* Already flat */
+        }
+
+        cJSON* name = cJSON_GetObjectItem(func, "name");
+        if (!name || !cJSON_IsString(name)) {
+            continue;
+        }
+
+        cJSON* out = cJSON_CreateObject();
+        if (!out) {
+            continue;
+        }
+        cJSON* desc = cJSON_GetObjectItem(func, "description");
+        cJSON* params = cJSON_GetObjectItem(func, "parameters");
+
+        cJSON_AddStringToObject(out, "type", "function");
+        cJSON_AddStringToObject(out, "name", cJSON_GetStringValue(name));
+        if (desc && cJSON_IsString(desc)) {
+            cJSON_AddStringToObject(out, "description", cJSON_GetStringValue(desc));
+        }
+        if (params) {
+            cJSON_AddItemToObject(out, "parameters", cJSON_Duplicate(params, 1));
+        }
+        cJSON_AddItemToArray(output, out);
+    }
+    cJSON_Delete(input);
+
+    char* json = cJSON_GetArraySize(output) > 0 ? cJSON_PrintUnformatted(output) : NULL;
+    cJSON_Delete(output);
+    return json;
+}
+
+static void* responses_create(const ac_llm_params_t* params) {
+    if (!params) {
+        return NULL;
+    }
+
+    responses_priv_t* priv = ARC_CALLOC(1, sizeof(responses_priv_t));
+    if (!priv) {
+        return NULL;
+    }
+
+    priv->headers = responses_headers_create(params);
+    if (!priv->headers) {
+        ARC_FREE(priv);
+        return NULL;
+    }
+
+    priv->websocket = params->websocket;
+    priv->url = ac_llm_provider_url(params->api_base ? params->api_base : RESPONSES_DEFAULT_BASE,
+                                    "/responses");
+    if (!priv->url) {
+        arc_http_header_set_destroy(priv->headers);
+        ARC_FREE(priv);
+        return NULL;
+    }
+
+    if (http_pool_available()) {
+        priv->http = NULL;
+        priv->owns_http = 0;
+        AC_LOG_DEBUG("Responses provider initialized (using HTTP pool)");
+    } else {
+        arc_http_client_config_t config = {
+            .default_timeout_ms = params->timeout_ms,
+        };
+
+        arc_err_t err = arc_http_client_create(&config, &priv->http);
+        if (err != ARC_OK) {
+            arc_http_header_set_destroy(priv->headers);
+            ARC_FREE(priv->url);
+            ARC_FREE(priv);
+            return NULL;
+        }
+        priv->owns_http = 1;
+        AC_LOG_DEBUG("Responses provider initialized (using own HTTP client)");
+    }
+
+    return priv;
+}
+
+/**
+ * @brief Serialize the request body
+ *
+ * messages are sent as input items as given: when chaining, the caller
+ * passes only the messages after the previous response.
+ *
+ * @param websocket  Body of a response.create event on the connection
+ */
+static char* build_request(const ac_llm_params_t* params, const ac_message_t* messages,
+                           const char* tools, int websocket) {
+    ac_json_writer_t jw = AC_JSON_WRITER_INIT;
+    ac_json_write_object_begin(&jw);
+
+    if (websocket) {
+        ac_json_write_member_string(&jw, "type", "response.create");
+    }
+
+    ac_json_write_member_string(&jw, "model", params->model);
+
+    ac_json_write_key(&jw, "input");
+    ac_json_write_array_begin(&jw);
+    for (const ac_message_t* msg = messages; msg; msg = msg->next) {
+        /* Fails when an attached image can no longer be read */
+        if (ac_message_to_responses_items(&jw, msg) != ARC_OK) {
+            ac_json_writer_reset(&jw);
+            return NULL;
+        }
+    }
+    ac_json_write_array_end(&jw);
+
+    /* Stored responses can be chained; unstored ones only on the same connection */
+    ac_json_write_member_bool(&jw, "store", params->stateful.store);
+    if ((params->stateful.store || websocket) && params->stateful.response_id) {
+        ac_json_write_member_string(&jw, "previous_response_id", params->stateful.response_id);
+    }
+    if (params->stateful.include_encrypted) {
+        ac_json_write_key(&jw, "include");
+        ac_json_write_array_begin(&jw);
+        ac_json_write_string(&jw, "reasoning.encrypted_content");
+        ac_json_write_array_end(&jw);
+    }
+
+    if (params->temperature > 0.0f) {
+        ac_json_write_member_double(&jw, "temperature", (double)params->temperature);
+    }
+    if (params->top_p > 0.0f) {
+        ac_json_write_member_double(&jw, "top_p", (double)params->top_p);
+    }
+    if (params->max_tokens > 0) {
+        ac_json_write_member_int(&jw, "max_output_tokens", params->max_tokens);
+    }
+
+    if (tools) {
+        ac_json_write_key(&jw, "tools");
+        ac_json_write_raw(&jw, tools, strlen(tools));
+        ac_json_write_member_string(&jw, "tool_choice", "auto");
+    }
+
+    /* Structured output goes in text.format, flattened */
+    const ac_response_format_t* format = &params->response_format;
+    if (format->schema) {
+        ac_json_write_key(&jw, "text");
+        ac_json_write_object_begin(&jw);
+        ac_json_write_key(&jw, "format");
+        ac_json_write_object_begin(&jw);
+        ac_json_write_member_string(&jw, "type", "json_schema");
+        ac_json_write_member_string(&jw, "name", format->name);
+        ac_json_write_key(&jw, "schema");
+        ac_json_write_raw(&jw, format->schema, strlen(format->schema));
+        ac_json_write_member_bool(&jw, "strict", format->strict);
+        ac_json_write_object_end(&jw);
+        ac_json_write_object_end(&jw);
+    }
+
+    ac_json_write_object_end(&jw);
+    return ac_json_writer_take(&jw);
+}
+
+/*============================================================================
+ * WebSocket Transport
+ *============================================================================*/
+
+/**
+ * @brief Open the connection unless it is still up
+ *
+ * Sets priv->ws_refused when the endpoint does not do WebSockets at all
+ * (as opposed to failing this once: auth, limits, network).
+ */
+static arc_err_t ws_open(responses_priv_t* priv, const ac_llm_params_t* params,
+                         ac_chat_response_t* response, uint32_t* connect_ms) {
+    if (arc_ws_is_open(priv->ws)) {
+        return ARC_OK;
+    }
+    arc_ws_close(priv->ws);
+    priv->ws = NULL;
+
+    arc_ws_config_t config = {
+        .url = priv->url,
+        .header_set = priv->headers,
+        .timeout_ms = params->timeout_ms,
+        .verify_ssl = 1,
+    };
+    int status = 0;
+    uint64_t start_ms = ac_platform_timestamp_ms();
+    arc_err_t err = arc_ws_connect(&config, &priv->ws, &status);
+    if (err == ARC_OK) {
+        *connect_ms = (uint32_t)(ac_platform_timestamp_ms() - start_ms);
+        return ARC_OK;
+    }
+
+    int transient = err == ARC_ERR_HTTP &&
+        (status == 401 || status == 403 || status == 408 || status == 429 || status >= 500);
+    if (err == ARC_ERR_NOT_IMPLEMENTED || err == ARC_ERR_PROTOCOL ||
+        (err == ARC_ERR_HTTP && !transient)) {
+        AC_LOG_WARN("Responses: %s refused the WebSocket upgrade (HTTP %d), using HTTP",
+                    priv->url, status);
+        priv->ws_refused = 1;
+    } else if (err == ARC_ERR_HTTP) {
+        response->http_status = status;
+    }
+    return err;
+}
+
+/**
+ * @brief Turn a terminal event into the call's result
+ *
+ * @param event  Event text; modified in place
+ * @return 1 if the event ends the call (*err set), 0 to keep reading
+ */
+static int ws_handle_event(char* event, size_t len, ac_chat_response_t* response,
+                           arc_err_t* err) {
+    ac_json_span_t root = ac_json_scan_root(event, len);
+    ac_json_span_t type = ac_json_scan_get(root, "type");
+
+    if (ac_json_scan_str_eq(type, "response.completed") ||
+        ac_json_scan_str_eq(type, "response.incomplete")) {
+        ac_json_span_t body = ac_json_scan_get(root, "response");
+        if (body.kind != AC_JSON_OBJECT) {
+            *err = ARC_ERR_PARSE;
+            return 1;
+        }
+        *(char*)body.end = '\0';   /* Parsed on its own, in place */
+        AC_LOG_DEBUG("Responses response: %s", body.start);
+        *err = ac_chat_response_parse_responses(body.start, response);
+        return 1;
+    }
+
+    /* error carries the status HTTP would have had; a failed response is the server's fault */
+    int failed = ac_json_scan_str_eq(type, "response.failed");
+    if (failed || ac_json_scan_str_eq(type, "error")) {
+        int status = 0;
+        if (!ac_json_scan_int(ac_json_scan_get(root, "status"), &status) || status < 400) {
+            status = failed ? 500 : 400;
+        }
+        AC_LOG_ERROR("Responses WebSocket %d: %.*s", status, (int)len, event);
+        response->http_status = status;
+        *err = ARC_ERR_HTTP;
+        return 1;
+    }
+    return 0;
+}
+
+/** Time left until deadline_ms for arc_ws_recv() (0 = no deadline) */
+static uint32_t ws_remaining_ms(uint64_t deadline_ms) {
+    if (!deadline_ms) {
+        return 0;
+    }
+    uint64_t now_ms = ac_platform_timestamp_ms();
+    return now_ms < deadline_ms ? (uint32_t)(deadline_ms - now_ms) : 1;
+}
+
+/**
+ * @brief One call as a response.create event on the provider's connection
+ *
+ * @return ARC_ERR_NOT_IMPLEMENTED (nothing sent) when the endpoint refused
+ *         the upgrade, so the caller can use HTTP instead
+ */
+static arc_err_t responses_chat_ws(responses_priv_t* priv, const ac_llm_params_t* params,
+                                   const char* body, ac_chat_response_t* response) {
+    size_t body_len = strlen(body);
+    uint64_t deadline_ms = params->timeout_ms
+        ? ac_platform_timestamp_ms() + params->timeout_ms : 0;
+    uint32_t connect_ms = 0;
+    uint32_t ttfb_ms = 0;
+    arc_err_t err;
+
+    char* event = NULL;
+    size_t event_len = 0;
+    uint64_t sent_ms = 0;
+
+    /* A kept connection may have been closed by the server while idle:
+     * open a new one once if it fails before the first event */
+    for (int attempt = 0;; attempt++) {
+        int reused = arc_ws_is_open(priv->ws);
+        err = ws_open(priv, params, response, &connect_ms);
+        if (err != ARC_OK) {
+            return priv->ws_refused ? ARC_ERR_NOT_IMPLEMENTED : err;
+        }
+
+        sent_ms = ac_platform_timestamp_ms();
+        err = arc_ws_send_text(priv->ws, body, body_len);
+        if (err == ARC_OK) {
+            err = arc_ws_recv(priv->ws, &event, &event_len, ws_remaining_ms(deadline_ms),
+                              params->cancel);
+        }
+        if (err == ARC_OK || !reused || attempt > 0 ||
+            (err != ARC_ERR_NOT_CONNECTED && err != ARC_ERR_NETWORK)) {
+            break;
+        }
+        AC_LOG_DEBUG("Responses: WebSocket dropped, reconnecting");
+    }
+    if (err == ARC_OK) {
+        ttfb_ms = (uint32_t)(ac_platform_timestamp_ms() - sent_ms);
+    }
+
+    /* Progress events are skipped: the terminal one carries the whole response */
+    while (err == ARC_OK && !ws_handle_event(event, event_len, response, &err)) {
+        err = arc_ws_recv(priv->ws, &event, &event_len, ws_remaining_ms(deadline_ms),
+                          params->cancel);
+    }
+
+    /* Parsing resets the response */
+    response->timing.connect_ms = connect_ms;
+    response->timing.ttfb_ms = ttfb_ms;
+
+    /* The rest of an abandoned response would arrive as the next call's events */
+    if (err == ARC_ERR_TIMEOUT || err == ARC_ERR_CANCELLED) {
+        arc_ws_close(priv->ws);
+        priv->ws = NULL;
+    }
+    return err;
+}
+
+static arc_err_t responses_chat(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_chat_response_t* response
+) {
+    if (!priv_data || !params || !response) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    /* Queue on the key's quota before holding a connection */
+    uint32_t queued_ms = 0;
+    arc_err_t err = ac_ratelimit_acquire("openai_responses", params, messages, tools, &queued_ms);
+    response->ratelimit_wait_ms = queued_ms;
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    responses_priv_t* priv = (responses_priv_t*)priv_data;
+    char* converted_tools = tools && tools[0] ? convert_tools(tools) : NULL;
+
+    if (params->websocket && !priv->ws_refused) {
+        ac_prof_push(AC_PROF_SERIALIZE);
+        char* body = build_request(params, messages, converted_tools, 1);
+        ac_prof_pop();
+        if (!body) {
+            if (converted_tools) cJSON_free(converted_tools);
+            return ARC_ERR_NO_MEMORY;
+        }
+        AC_LOG_DEBUG("Responses event: %s", body);
+        err = responses_chat_ws(priv, params, body, response);
+        ARC_FREE(body);
+        if (err != ARC_ERR_NOT_IMPLEMENTED) {
+            if (converted_tools) cJSON_free(converted_tools);
+            response->ratelimit_wait_ms = queued_ms;   /* Parsing resets the response */
+            return err;
+        }
+    }
+
+    /* Chained on a connection's unstored response, which HTTP cannot
+     * reach: fail like the server would, so the history is resent */
+    if (params->websocket && !params->stateful.store && params->stateful.response_id) {
+        if (converted_tools) cJSON_free(converted_tools);
+        response->http_status = 404;
+        return ARC_ERR_HTTP;
+    }
+
+    arc_http_client_t* http = NULL;
+    int from_pool = 0;
+    uint32_t pool_wait_ms = 0;
+
+    if (priv->owns_http) {
+        http = priv->http;
+    } else if (http_pool_available()) {
+        uint64_t pool_start_ms = ac_platform_timestamp_ms();
+        http = ac_http_pool_acquire_priority(params->timeout_ms > 0 ? params->timeout_ms : 30000,
+                                             params->priority);
+        pool_wait_ms = (uint32_t)(ac_platform_timestamp_ms() - pool_start_ms);
+        if (!http) {
+            AC_LOG_ERROR("Responses: failed to acquire HTTP client from pool");
+            if (converted_tools) cJSON_free(converted_tools);
+            return ARC_ERR_TIMEOUT;
+        }
+        from_pool = 1;
+    } else {
+        AC_LOG_ERROR("Responses: no HTTP client available");
+        if (converted_tools) cJSON_free(converted_tools);
+        return ARC_ERR_NOT_INITIALIZED;
+    }
+
+    const char* url = priv->url;
+
+    ac_prof_push(AC_PROF_SERIALIZE);
+    char* body = build_request(params, messages, converted_tools, 0);
+    ac_prof_pop();
+    if (converted_tools) cJSON_free(converted_tools);
+
+    if (!body) {
+        if (from_pool) ac_http_pool_release(http);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    AC_LOG_DEBUG("Responses request: %s", body);
+
+    arc_http_request_t req = {
+        .url = url,
+        .method = ARC_HTTP_POST,
+        .header_set = priv->headers,
+        .body = body,
+        .body_len = strlen(body),
+        .timeout_ms = params->timeout_ms,
+        .verify_ssl = 1,
+        .compress_body = params->compress_requests,
+        .cancel = params->cancel,
+    };
+
+    arc_http_response_t http_resp = {0};
+    err = arc_http_request(http, &req, &http_resp);
+    ac_ratelimit_observe("openai_responses", params, &http_resp);
+    ARC_FREE(body);
+
+    if (err != ARC_OK) {
+        arc_http_response_free(&http_resp);
+        if (from_pool) ac_http_pool_release(http);
+        return err;
+    }
+
+    if (http_resp.status_code != 200) {
+        AC_LOG_ERROR("Responses HTTP %d: %s", http_resp.status_code,
+            http_resp.body ? http_resp.body : "");
+        response->http_status = http_resp.status_code;
+        response->retry_after_ms = http_resp.retry_after_ms;
+        arc_http_response_free(&http_resp);
+        if (from_pool) ac_http_pool_release(http);
+        return ARC_ERR_HTTP;
+    }
+
+    AC_LOG_DEBUG("Responses response: %s", http_resp.body);
+    err = ac_chat_response_parse_responses(http_resp.body, response);
+    response->ratelimit_wait_ms = queued_ms;   /* Parsing resets the response */
+    ac_llm_timing_from_http(&response->timing, &http_resp, pool_wait_ms);
+
+    arc_http_response_free(&http_resp);
+    if (from_pool) ac_http_pool_release(http);
+
+    return err;
+}
+
+static int responses_reentrant(void* priv_data) {
+    responses_priv_t* priv = (responses_priv_t*)priv_data;
+    /* The WebSocket is one connection, whatever carries the HTTP calls */
+    return priv && !priv->owns_http && (!priv->websocket || priv->ws_refused);
+}
+
+static void responses_cleanup(void* priv_data) {
+    if (!priv_data) {
+        return;
+    }
+
+    responses_priv_t* priv = (responses_priv_t*)priv_data;
+    if (priv->owns_http && priv->http) {
+        arc_http_client_destroy(priv->http);
+    }
+    arc_ws_close(priv->ws);
+    arc_http_header_set_destroy(priv->headers);
+    ARC_FREE(priv->url);
+    ARC_FREE(priv);
+
+    AC_LOG_DEBUG("Responses provider cleaned up");
+}
+
+/**
+ * @brief OpenAI Responses provider definition
+ *
+ * Builds its own body (no cached dialect): a chained request only
+ * serializes the few new messages anyway.
+ */
+const ac_llm_ops_t openai_responses_ops = {
+    .name = "openai_responses",
+    .capabilities = AC_LLM_CAP_TOOLS | AC_LLM_CAP_REASONING | AC_LLM_CAP_STATEFUL |
+                    AC_LLM_CAP_VISION,
+    .json_dialect = AC_JSON_DIALECT_NONE,
+    .create = responses_create,
+    .chat = responses_chat,
+    .chat_stream = NULL,
+    .reentrant = responses_reentrant,
+    .cleanup = responses_cleanup,
+};
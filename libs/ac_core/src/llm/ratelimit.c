@@ -0,0 +1,423 @@
+/**
+ * @file ratelimit.c
+ * @brief Client-side rate limiter honoring provider quota headers
+ *
+ * One entry per (provider, api_key), each with a requests/min and a
+ * tokens/min bucket refilled continuously. Bucket levels are kept in
+ * thousandths of a unit so refill needs no floating point. A limit of 0
+ * is unknown and not enforced; the first response with quota headers
+ * sets it. Waiters queue per entry and priority class; only the waiter
+ * arc/priority.h picks may take from the buckets, which keeps admission
+ * in arrival order within a class.
+ */
+
+#include "ratelimit.h"
+#include "arc/tokens.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Distinct (provider, api_key) pairs tracked */
+#define RATELIMIT_MAX_KEYS   32
+
+/** Longest sleep between queue checks (cancellation, quota updates) */
+#define RATELIMIT_SLICE_MS   50
+
+/** Pause after a 429 without Retry-After or reset header */
+#define RATELIMIT_429_PAUSE_MS 1000
+
+typedef struct {
+    int64_t level;           /* Available, in 1/1000 units (may go negative) */
+    int64_t limit;           /* Units per minute, 0 = unknown */
+    uint64_t updated;        /* Last refill (ms) */
+} rl_bucket_t;
+
+typedef struct rl_waiter {
+    uint64_t since;          /* Queued at (ms) */
+    ac_priority_t priority;
+    struct rl_waiter* next;
+} rl_waiter_t;
+
+typedef struct {
+    const char* provider;    /* Provider ops name (static) */
+    uint64_t key_hash;       /* FNV-1a of the API key; the key itself is not kept */
+    rl_bucket_t requests;
+    rl_bucket_t tokens;
+    uint64_t paused_until;   /* After a 429: nothing is admitted before this */
+    rl_waiter_t* head[AC_PRIORITY_COUNT];  /* FIFO of queued requests per class */
+    rl_waiter_t* tail[AC_PRIORITY_COUNT];
+    ac_priority_sched_t sched;
+} rl_entry_t;
+
+static rl_entry_t s_entries[RATELIMIT_MAX_KEYS];
+static int s_entry_count = 0;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*============================================================================
+ * Buckets
+ *============================================================================*/
+
+static void bucket_refill(rl_bucket_t* b, uint64_t now) {
+    if (b->limit > 0 && now > b->updated) {
+        /* limit per 60000 ms, in 1/1000 units: limit / 60 per ms */
+        b->level += (int64_t)(now - b->updated) * b->limit / 60;
+        if (b->level > b->limit * 1000) {
+            b->level = b->limit * 1000;
+        }
+    }
+    b->updated = now;
+}
+
+/**
+ * @brief ms until b holds cost units (0 = now); never asks for more than a full bucket
+ */
+static uint64_t bucket_wait(const rl_bucket_t* b, int64_t cost) {
+    if (b->limit <= 0) {
+        return 0;
+    }
+    int64_t need = (cost < b->limit ? cost : b->limit) * 1000;
+    if (b->level >= need) {
+        return 0;
+    }
+    return (uint64_t)((need - b->level) * 60 / b->limit) + 1;
+}
+
+static void bucket_set(rl_bucket_t* b, int64_t limit, int64_t remaining, uint64_t now) {
+    if (limit > 0) {
+        b->limit = limit;
+    }
+    if (remaining >= 0 && b->limit > 0) {
+        b->level = remaining * 1000;
+    }
+    b->updated = now;
+}
+
+static void bucket_init(rl_bucket_t* b, int limit, uint64_t now) {
+    b->limit = limit > 0 ? limit : 0;
+    b->level = b->limit * 1000;
+    b->updated = now;
+}
+
+/*============================================================================
+ * Entries
+ *============================================================================*/
+
+static uint64_t key_hash(const char* key) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const unsigned char* p = (const unsigned char*)(key ? key : ""); *p; p++) {
+        h ^= *p;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Entry for (provider, api_key), created on first use (lock held)
+ * @return NULL when the table is full (the key is then not limited)
+ */
+static rl_entry_t* entry_find(const char* provider, const ac_llm_params_t* params,
+                              uint64_t now) {
+    uint64_t hash = key_hash(params->api_key);
+    for (int i = 0; i < s_entry_count; i++) {
+        if (s_entries[i].key_hash == hash && strcmp(s_entries[i].provider, provider) == 0) {
+            return &s_entries[i];
+        }
+    }
+    if (s_entry_count >= RATELIMIT_MAX_KEYS) {
+        AC_LOG_WARN("Rate limiter: more than %d keys, %s key not limited",
+                    RATELIMIT_MAX_KEYS, provider);
+        return NULL;
+    }
+
+    rl_entry_t* e = &s_entries[s_entry_count++];
+    memset(e, 0, sizeof(*e));
+    e->provider = provider;
+    e->key_hash = hash;
+    bucket_init(&e->requests, params->rate_limit.requests_per_min, now);
+    bucket_init(&e->tokens, params->rate_limit.tokens_per_min, now);
+    return e;
+}
+
+static void waiter_add(rl_entry_t* e, rl_waiter_t* w) {
+    int c = (int)w->priority;
+    if (e->tail[c]) {
+        e->tail[c]->next = w;
+    } else {
+        e->head[c] = w;
+    }
+    e->tail[c] = w;
+}
+
+static void waiter_remove(rl_entry_t* e, rl_waiter_t* w) {
+    int c = (int)w->priority;
+    rl_waiter_t** link = &e->head[c];
+    rl_waiter_t* prev = NULL;
+    while (*link && *link != w) {
+        prev = *link;
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = w->next;
+        if (e->tail[c] == w) {
+            e->tail[c] = prev;
+        }
+    }
+}
+
+/**
+ * @brief Waiter allowed to take next, NULL if none is queued (lock held)
+ */
+static rl_waiter_t* waiter_front(rl_entry_t* e, uint64_t now) {
+    uint64_t oldest[AC_PRIORITY_COUNT];
+    for (int c = 0; c < AC_PRIORITY_COUNT; c++) {
+        oldest[c] = e->head[c] ? e->head[c]->since : 0;
+    }
+    int c = ac_priority_next(&e->sched, oldest, now);
+    return c >= 0 ? e->head[c] : NULL;
+}
+
+/**
+ * @brief ms until e admits a request of cost tokens (0 = now, lock held)
+ */
+static uint64_t entry_wait(rl_entry_t* e, int64_t cost, uint64_t now) {
+    bucket_refill(&e->requests, now);
+    bucket_refill(&e->tokens, now);
+
+    uint64_t wait = e->paused_until > now ? e->paused_until - now : 0;
+    uint64_t w = bucket_wait(&e->requests, 1);
+    if (w > wait) {
+        wait = w;
+    }
+    w = bucket_wait(&e->tokens, cost);
+    return w > wait ? w : wait;
+}
+
+/*============================================================================
+ * Acquire
+ *============================================================================*/
+
+arc_err_t ac_ratelimit_acquire(
+    const char* provider,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    uint32_t* waited_ms
+) {
+    if (waited_ms) {
+        *waited_ms = 0;
+    }
+    if (!provider || !params || !params->rate_limit.enabled) {
+        return ARC_OK;
+    }
+
+    ac_tokens_family_t family = ac_tokens_family(params->model);
+    int64_t cost = (int64_t)(ac_messages_tokens(messages, family) +
+                             ac_tokens_estimate_str(tools, family));
+    if (params->max_tokens > 0) {
+        cost += params->max_tokens;
+    }
+
+    uint64_t start = ac_platform_timestamp_ms();
+    rl_waiter_t self = { start, ac_priority_clamp((int)params->priority), NULL };
+    int queued = 0;
+    arc_err_t err = ARC_OK;
+
+    pthread_mutex_lock(&s_lock);
+    for (;;) {
+        uint64_t now = ac_platform_timestamp_ms();
+        rl_entry_t* e = entry_find(provider, params, now);
+        if (!e) {
+            break;
+        }
+
+        /* Only the front of the queue (or an arrival at an empty one) takes */
+        uint64_t wait = 0;
+        rl_waiter_t* front = waiter_front(e, now);
+        if (!front || front == &self) {
+            wait = entry_wait(e, cost, now);
+            if (wait == 0) {
+                e->requests.level -= 1000;
+                e->tokens.level -= cost * 1000;
+                if (queued) {
+                    waiter_remove(e, &self);
+                    ac_priority_charge(&e->sched, self.priority);
+                }
+                break;
+            }
+        }
+
+        if (!queued) {
+            waiter_add(e, &self);
+            queued = 1;
+        }
+
+        int max_wait = params->rate_limit.max_wait_ms;
+        if (params->cancel && *params->cancel) {
+            err = ARC_ERR_CANCELLED;
+        } else if (params->deadline_ms && now >= params->deadline_ms) {
+            err = ARC_ERR_TIMEOUT;
+        } else if (max_wait > 0 && now - start >= (uint64_t)max_wait) {
+            AC_LOG_WARN("Rate limiter: %s request queued over %d ms, giving up",
+                        provider, max_wait);
+            err = ARC_ERR_TIMEOUT;
+        }
+        if (err != ARC_OK) {
+            waiter_remove(e, &self);
+            break;
+        }
+
+        pthread_mutex_unlock(&s_lock);
+        ac_platform_sleep_ms(wait > 0 && wait < RATELIMIT_SLICE_MS ? (uint32_t)wait
+                                                                    : RATELIMIT_SLICE_MS);
+        pthread_mutex_lock(&s_lock);
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    uint64_t waited = ac_platform_timestamp_ms() - start;
+    if (queued && err == ARC_OK) {
+        AC_LOG_DEBUG("Rate limiter: %s request admitted after %llu ms",
+                     provider, (unsigned long long)waited);
+    }
+    if (waited_ms) {
+        *waited_ms = waited > UINT32_MAX ? UINT32_MAX : (uint32_t)waited;
+    }
+    return err;
+}
+
+/*============================================================================
+ * Quota Headers
+ *============================================================================*/
+
+static const char* header_value(const arc_http_header_t* headers, const char* name) {
+    for (const arc_http_header_t* h = headers; h; h = h->next) {
+        if (h->name && strcmp(h->name, name) == 0) {
+            return h->value;
+        }
+    }
+    return NULL;
+}
+
+static int64_t header_int(const arc_http_header_t* headers, const char* name) {
+    const char* v = header_value(headers, name);
+    if (!v) {
+        return -1;
+    }
+    char* end = NULL;
+    long long n = strtoll(v, &end, 10);
+    return end != v && n >= 0 ? (int64_t)n : -1;
+}
+
+/**
+ * @brief Days since 1970-01-01 of a proleptic Gregorian date
+ */
+static int64_t days_from_civil(int64_t y, int64_t m, int64_t d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/**
+ * @brief ms until a reset header value: "6m0s", "1.5s", "20ms" (OpenAI)
+ *        or an RFC 3339 time "2025-01-01T00:00:30Z" (Anthropic)
+ * @return ms from now, 0 if absent or unparsable
+ */
+static uint64_t reset_ms(const char* v, uint64_t now) {
+    if (!v) {
+        return 0;
+    }
+
+    int y, mo, d, h, mi, sec;
+    if (strchr(v, 'T') && sscanf(v, "%d-%d-%dT%d:%d:%d", &y, &mo, &d, &h, &mi, &sec) == 6) {
+        int64_t at = (days_from_civil(y, mo, d) * 86400 + h * 3600 + mi * 60 + sec) * 1000;
+        return at > (int64_t)now ? (uint64_t)at - now : 0;
+    }
+
+    double total = 0.0;
+    const char* p = v;
+    while (*p) {
+        char* end = NULL;
+        double n = strtod(p, &end);
+        if (end == p) {
+            break;
+        }
+        p = end;
+        if (p[0] == 'm' && p[1] == 's') {
+            total += n;
+            p += 2;
+        } else if (*p == 'h') {
+            total += n * 3600000.0;
+            p++;
+        } else if (*p == 'm') {
+            total += n * 60000.0;
+            p++;
+        } else if (*p == 's') {
+            total += n * 1000.0;
+            p++;
+        } else {
+            total += n * 1000.0;  /* Bare number: seconds */
+            break;
+        }
+    }
+    return total > 0.0 ? (uint64_t)total : 0;
+}
+
+void ac_ratelimit_observe(
+    const char* provider,
+    const ac_llm_params_t* params,
+    const arc_http_response_t* response
+) {
+    if (!provider || !params || !params->rate_limit.enabled || !response ||
+        response->status_code == 0) {
+        return;
+    }
+
+    const arc_http_header_t* hd = response->headers;
+    uint64_t now = ac_platform_timestamp_ms();
+
+    /* OpenAI names first, Anthropic's as fallback */
+    int64_t req_limit = header_int(hd, "x-ratelimit-limit-requests");
+    int64_t req_left = header_int(hd, "x-ratelimit-remaining-requests");
+    int64_t tok_limit = header_int(hd, "x-ratelimit-limit-tokens");
+    int64_t tok_left = header_int(hd, "x-ratelimit-remaining-tokens");
+    uint64_t req_reset = reset_ms(header_value(hd, "x-ratelimit-reset-requests"), now);
+    uint64_t tok_reset = reset_ms(header_value(hd, "x-ratelimit-reset-tokens"), now);
+    if (req_limit < 0 && req_left < 0) {
+        req_limit = header_int(hd, "anthropic-ratelimit-requests-limit");
+        req_left = header_int(hd, "anthropic-ratelimit-requests-remaining");
+        req_reset = reset_ms(header_value(hd, "anthropic-ratelimit-requests-reset"), now);
+    }
+    if (tok_limit < 0 && tok_left < 0) {
+        tok_limit = header_int(hd, "anthropic-ratelimit-tokens-limit");
+        tok_left = header_int(hd, "anthropic-ratelimit-tokens-remaining");
+        tok_reset = reset_ms(header_value(hd, "anthropic-ratelimit-tokens-reset"), now);
+    }
+
+    pthread_mutex_lock(&s_lock);
+    rl_entry_t* e = entry_find(provider, params, now);
+    if (e) {
+        bucket_set(&e->requests, req_limit, req_left, now);
+        bucket_set(&e->tokens, tok_limit, tok_left, now);
+
+        if (response->status_code == 429) {
+            uint64_t pause = response->retry_after_ms;
+            if (pause == 0) {
+                pause = req_left == 0 ? req_reset : tok_left == 0 ? tok_reset : 0;
+            }
+            if (pause == 0) {
+                pause = RATELIMIT_429_PAUSE_MS;
+            }
+            if (now + pause > e->paused_until) {
+                e->paused_until = now + pause;
+            }
+            AC_LOG_WARN("Rate limiter: %s returned 429, pausing key for %llu ms",
+                        provider, (unsigned long long)pause);
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+}
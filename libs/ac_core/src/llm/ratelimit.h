@@ -0,0 +1,52 @@
+/**
+ * @file ratelimit.h
+ * @brief Client-side rate limiter shared by providers (internal)
+ *
+ * Providers bracket each HTTP request with the two calls below. Both are
+ * no-ops unless params->rate_limit.enabled.
+ */
+
+#ifndef ARC_LLM_RATELIMIT_H
+#define ARC_LLM_RATELIMIT_H
+
+#include "arc/llm.h"
+#include "http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Wait until the (provider, api_key) quota admits one more request
+ *
+ * Call before taking an HTTP client, so queued requests hold no connection.
+ *
+ * @param provider   Provider name (ops name)
+ * @param params     Request parameters (rate_limit, api_key, model, max_tokens)
+ * @param messages   Messages sent (charged by their token estimate)
+ * @param tools      Tools schema sent (may be NULL)
+ * @param waited_ms  Time spent queued (optional)
+ * @return ARC_OK, ARC_ERR_TIMEOUT (max_wait_ms exceeded), ARC_ERR_CANCELLED
+ */
+arc_err_t ac_ratelimit_acquire(
+    const char* provider,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    uint32_t* waited_ms
+);
+
+/**
+ * @brief Update the quota from a response (headers, 429 + Retry-After)
+ */
+void ac_ratelimit_observe(
+    const char* provider,
+    const ac_llm_params_t* params,
+    const arc_http_response_t* response
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_LLM_RATELIMIT_H */
@@ -0,0 +1,510 @@
+/**
+ * @file response_cache.c
+ * @brief Exact-match LLM response cache
+ *
+ * Requests are keyed by two independent 64-bit hashes over the fields
+ * that shape the answer (see ac_llm_request_key), so a false hit needs a
+ * 128-bit collision. Values are provider-neutral response records
+ * (ac_chat_response_to_record).
+ *
+ * Memory: a process-wide LRU list, most recent first. Disk (optional):
+ * <dir>/llm-<h1>.json holding {"check":"<h2>","response":{...}}, written
+ * to a temporary name and renamed into place.
+ */
+
+#include "llm_internal.h"
+#include "message/message_json.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "json_scan.h"
+#include "json_writer.h"
+#include "pthread_port.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir_p(path) _mkdir(path)
+#else
+#define mkdir_p(path) mkdir(path, 0755)
+#endif
+
+#define CACHE_PATH_MAX  1024
+#define CACHE_FILE_MAX  (64 * 1024 * 1024)
+
+/*============================================================================
+ * Request Key
+ *============================================================================*/
+
+static void key_feed(ac_llm_cache_key_t *key, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t h1 = key->h1;
+    uint64_t h2 = key->h2;
+    for (size_t i = 0; i < len; i++) {
+        h1 = (h1 ^ p[i]) * 1099511628211ull;                        /* FNV-1a */
+        h2 = ((h2 << 5) | (h2 >> 59)) ^ p[i];
+        h2 *= 0x9e3779b97f4a7c15ull;
+    }
+    key->h1 = h1;
+    key->h2 = h2;
+}
+
+/**
+ * @brief Length-prefixed, so adjacent fields cannot run into each other
+ */
+static void key_bytes(ac_llm_cache_key_t *key, ac_str_t s) {
+    uint64_t len = s.ptr ? (uint64_t)s.len : UINT64_MAX;
+    key_feed(key, &len, sizeof(len));
+    if (s.ptr) {
+        key_feed(key, s.ptr, s.len);
+    }
+}
+
+static void key_str(ac_llm_cache_key_t *key, const char *s) {
+    key_bytes(key, ac_str(s));
+}
+
+static void key_int(ac_llm_cache_key_t *key, int64_t v) {
+    key_feed(key, &v, sizeof(v));
+}
+
+static void key_message(ac_llm_cache_key_t *key, const ac_message_t *msg) {
+    key_int(key, msg->role);
+    key_bytes(key, ac_message_content(msg));
+    key_str(key, msg->tool_call_id);
+    for (const ac_tool_call_t *c = msg->tool_calls; c; c = c->next) {
+        key_str(key, c->id);
+        key_str(key, c->name);
+        key_bytes(key, ac_tool_call_arguments(c));
+    }
+    key_int(key, -1);
+    for (const ac_content_block_t *b = msg->blocks; b; b = b->next) {
+        key_int(key, b->type);
+        key_bytes(key, ac_block_text(b));
+        key_str(key, b->signature);
+        key_str(key, b->data);
+        key_str(key, b->id);
+        key_str(key, b->name);
+        key_bytes(key, ac_block_input(b));
+        key_int(key, b->is_error);
+        if (b->attachment && !b->attachment->path && b->attachment->data) {
+            /* Path images are keyed by path, size and mtime (text, data) */
+            ac_str_t bytes = { (const char *)b->attachment->data, b->attachment->size };
+            key_bytes(key, bytes);
+        }
+    }
+    key_int(key, -1);
+}
+
+void ac_llm_request_key(
+    const ac_llm_t *llm,
+    const ac_message_t *messages,
+    const char *tools,
+    ac_llm_cache_key_t *key
+) {
+    const ac_llm_params_t *p = &llm->params;
+
+    key->h1 = 14695981039346656037ull;
+    key->h2 = 0x6a09e667f3bcc908ull;
+
+    key_str(key, llm->provider->name);
+    key_str(key, p->api_base);
+    key_str(key, p->model);
+
+    /* Parameters compared as bit patterns: "same request" means same bytes */
+    int32_t bits[2];
+    memcpy(&bits[0], &p->temperature, sizeof(bits[0]));
+    memcpy(&bits[1], &p->top_p, sizeof(bits[1]));
+    key_feed(key, bits, sizeof(bits));
+    key_int(key, p->max_tokens);
+    key_int(key, p->thinking.enabled ? p->thinking.budget_tokens : -1);
+    key_int(key, p->stateful.store);
+    key_str(key, p->stateful.response_id);
+    key_int(key, p->stateful.include_encrypted);
+    key_str(key, p->response_format.schema);
+    key_str(key, p->response_format.name);
+    key_int(key, p->response_format.strict);
+
+    key_str(key, tools);
+    for (const ac_message_t *msg = messages; msg; msg = msg->next) {
+        key_message(key, msg);
+    }
+}
+
+int ac_llm_cache_key(
+    const ac_llm_t *llm,
+    const ac_message_t *messages,
+    const char *tools,
+    ac_llm_cache_key_t *key
+) {
+    const ac_llm_cache_config_t *cfg = &llm->params.response_cache;
+    if (cfg->max_entries <= 0 && !cfg->dir) {
+        return 0;
+    }
+    ac_llm_request_key(llm, messages, tools, key);
+    return 1;
+}
+
+/*============================================================================
+ * In-memory LRU
+ *============================================================================*/
+
+typedef struct cache_entry {
+    ac_llm_cache_key_t key;
+    char *record;
+    size_t len;
+    struct cache_entry *prev;
+    struct cache_entry *next;
+} cache_entry_t;
+
+static struct {
+    pthread_mutex_t lock;
+    cache_entry_t *head;            /* Most recently used */
+    cache_entry_t *tail;
+    size_t count;
+} s_lru = { PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0 };
+
+static void lru_unlink(cache_entry_t *e) {
+    if (e->prev) e->prev->next = e->next; else s_lru.head = e->next;
+    if (e->next) e->next->prev = e->prev; else s_lru.tail = e->prev;
+    e->prev = e->next = NULL;
+    s_lru.count--;
+}
+
+static void lru_push_front(cache_entry_t *e) {
+    e->prev = NULL;
+    e->next = s_lru.head;
+    if (s_lru.head) s_lru.head->prev = e; else s_lru.tail = e;
+    s_lru.head = e;
+    s_lru.count++;
+}
+
+static cache_entry_t *lru_find(const ac_llm_cache_key_t *key) {
+    for (cache_entry_t *e = s_lru.head; e; e = e->next) {
+        if (e->key.h1 == key->h1 && e->key.h2 == key->h2) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void entry_free(cache_entry_t *e) {
+    ARC_FREE(e->record);
+    ARC_FREE(e);
+}
+
+/**
+ * @brief Insert (or refresh) a record, trimming the list to max_entries
+ *
+ * Takes ownership of record.
+ */
+static void lru_insert(const ac_llm_cache_key_t *key, char *record, size_t len,
+                       int max_entries) {
+    if (max_entries <= 0) {
+        ARC_FREE(record);
+        return;
+    }
+
+    cache_entry_t *fresh = (cache_entry_t *)ARC_CALLOC(1, sizeof(*fresh));
+    if (!fresh) {
+        ARC_FREE(record);
+        return;
+    }
+    fresh->key = *key;
+    fresh->record = record;
+    fresh->len = len;
+
+    cache_entry_t *dropped = NULL;
+    pthread_mutex_lock(&s_lru.lock);
+    cache_entry_t *old = lru_find(key);
+    if (old) {
+        lru_unlink(old);
+        old->next = dropped;
+        dropped = old;
+    }
+    lru_push_front(fresh);
+    while (s_lru.count > (size_t)max_entries) {
+        cache_entry_t *victim = s_lru.tail;
+        lru_unlink(victim);
+        victim->next = dropped;
+        dropped = victim;
+    }
+    pthread_mutex_unlock(&s_lru.lock);
+
+    while (dropped) {
+        cache_entry_t *next = dropped->next;
+        entry_free(dropped);
+        dropped = next;
+    }
+}
+
+void ac_llm_cache_clear(void) {
+    pthread_mutex_lock(&s_lru.lock);
+    cache_entry_t *e = s_lru.head;
+    s_lru.head = s_lru.tail = NULL;
+    s_lru.count = 0;
+    pthread_mutex_unlock(&s_lru.lock);
+
+    while (e) {
+        cache_entry_t *next = e->next;
+        entry_free(e);
+        e = next;
+    }
+}
+
+/*============================================================================
+ * Disk Store
+ *============================================================================*/
+
+static int disk_path(char *out, size_t size, const char *dir,
+                     const ac_llm_cache_key_t *key, const char *suffix) {
+    int n = snprintf(out, size, "%s/llm-%016llx.json%s",
+                     dir, (unsigned long long)key->h1, suffix);
+    return n > 0 && (size_t)n < size;
+}
+
+static int ensure_dir(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        return S_ISDIR(st.st_mode) ? 0 : -1;
+    }
+    if (mkdir_p(path) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Record stored for key, as a heap copy (ARC_FREE), or NULL
+ */
+static char *disk_load(const char *dir, const ac_llm_cache_key_t *key, size_t *len) {
+    char path[CACHE_PATH_MAX];
+    if (!disk_path(path, sizeof(path), dir, key, "")) {
+        return NULL;
+    }
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size <= 0 || size > CACHE_FILE_MAX) {
+        fclose(fp);
+        return NULL;
+    }
+    char *data = (char *)ARC_MALLOC((size_t)size + 1);
+    size_t n = data ? fread(data, 1, (size_t)size, fp) : 0;
+    fclose(fp);
+    if (!data) {
+        return NULL;
+    }
+    data[n] = '\0';
+
+    /* Half-written files and h1-only collisions are a miss */
+    char check[17];
+    snprintf(check, sizeof(check), "%016llx", (unsigned long long)key->h2);
+
+    char *record = NULL;
+    if (ac_json_scan_valid(data, n)) {
+        ac_json_span_t root = ac_json_scan_root(data, n);
+        char *stored = ac_json_scan_strdup(ac_json_scan_get(root, "check"));
+        ac_json_span_t value = ac_json_scan_get(root, "response");
+        if (stored && strcmp(stored, check) == 0 && value.kind == AC_JSON_OBJECT) {
+            *len = (size_t)(value.end - value.start);
+            record = ARC_STRNDUP(value.start, *len);
+        }
+        ARC_FREE(stored);
+    }
+    ARC_FREE(data);
+    return record;
+}
+
+static void disk_store(const char *dir, const ac_llm_cache_key_t *key,
+                       const char *record, size_t len) {
+    char path[CACHE_PATH_MAX];
+    char tmp[CACHE_PATH_MAX];
+    if (ensure_dir(dir) != 0 ||
+        !disk_path(path, sizeof(path), dir, key, "") ||
+        !disk_path(tmp, sizeof(tmp), dir, key, ".tmp")) {
+        AC_LOG_WARN("LLM cache: cannot use directory %s", dir);
+        return;
+    }
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        AC_LOG_WARN("LLM cache: cannot write %s", tmp);
+        return;
+    }
+    int ok = fprintf(fp, "{\"check\":\"%016llx\",\"response\":",
+                     (unsigned long long)key->h2) > 0 &&
+             fwrite(record, 1, len, fp) == len &&
+             fputc('}', fp) != EOF;
+    ok = (fclose(fp) == 0) && ok;
+
+    if (!ok || rename(tmp, path) != 0) {
+        AC_LOG_WARN("LLM cache: failed to store %s", path);
+        remove(tmp);
+    }
+}
+
+/*============================================================================
+ * Lookup / Store
+ *============================================================================*/
+
+int ac_llm_cache_lookup(
+    const ac_llm_t *llm,
+    const ac_llm_cache_key_t *key,
+    ac_chat_response_t *response
+) {
+    const ac_llm_cache_config_t *cfg = &llm->params.response_cache;
+    int hit = 0;
+
+    pthread_mutex_lock(&s_lru.lock);
+    cache_entry_t *e = lru_find(key);
+    if (e) {
+        lru_unlink(e);
+        lru_push_front(e);
+        hit = ac_chat_response_parse_record(e->record, e->len, response) == ARC_OK;
+    }
+    pthread_mutex_unlock(&s_lru.lock);
+
+    if (!hit && cfg->dir) {
+        size_t len = 0;
+        char *record = disk_load(cfg->dir, key, &len);
+        if (record && ac_chat_response_parse_record(record, len, response) == ARC_OK) {
+            hit = 1;
+            lru_insert(key, record, len, cfg->max_entries);
+        } else {
+            ARC_FREE(record);
+        }
+    }
+
+    if (hit) {
+        AC_LOG_DEBUG("LLM cache hit: %016llx", (unsigned long long)key->h1);
+    }
+    return hit;
+}
+
+void ac_llm_cache_store(
+    const ac_llm_t *llm,
+    const ac_llm_cache_key_t *key,
+    const ac_chat_response_t *response
+) {
+    const ac_llm_cache_config_t *cfg = &llm->params.response_cache;
+
+    ac_json_writer_t w = AC_JSON_WRITER_INIT;
+    if (ac_chat_response_to_record(&w, response) != ARC_OK) {
+        ac_json_writer_reset(&w);
+        return;
+    }
+    size_t len = ac_json_writer_len(&w);
+    char *record = ac_json_writer_take(&w);
+    if (!record) {
+        return;
+    }
+
+    if (cfg->dir) {
+        disk_store(cfg->dir, key, record, len);
+    }
+    lru_insert(key, record, len, cfg->max_entries);
+}
+
+/*============================================================================
+ * Stream Replay
+ *============================================================================*/
+
+static int emit(ac_stream_callback_t callback, void *user_data, ac_stream_event_t *event) {
+    return callback(event, user_data) == 0;
+}
+
+static int emit_delta(ac_stream_callback_t callback, void *user_data, int index,
+                      ac_block_type_t block_type, ac_delta_type_t type, ac_str_t text) {
+    if (text.len == 0) {
+        return 1;
+    }
+    ac_stream_event_t ev = {0};
+    ev.type = AC_STREAM_DELTA;
+    ev.block_index = index;
+    ev.block_type = block_type;
+    ev.delta_type = type;
+    ev.delta = text.ptr;
+    ev.delta_len = text.len;
+    return emit(callback, user_data, &ev);
+}
+
+arc_err_t ac_llm_cache_replay(
+    const ac_chat_response_t *response,
+    ac_stream_callback_t callback,
+    void *user_data
+) {
+    ac_stream_event_t ev = {0};
+    ev.type = AC_STREAM_MESSAGE_START;
+    if (!emit(callback, user_data, &ev)) {
+        return ARC_OK;
+    }
+
+    /* Each block arrives whole: one delta per block */
+    int index = 0;
+    for (const ac_content_block_t *b = response->blocks; b; b = b->next, index++) {
+        memset(&ev, 0, sizeof(ev));
+        ev.type = AC_STREAM_CONTENT_BLOCK_START;
+        ev.block_index = index;
+        ev.block_type = b->type;
+        ev.tool_id = b->id;
+        ev.tool_name = b->name;
+        if (!emit(callback, user_data, &ev)) {
+            return ARC_OK;
+        }
+
+        int ok = 1;
+        switch (b->type) {
+            case AC_BLOCK_TEXT:
+                ok = emit_delta(callback, user_data, index, b->type, AC_DELTA_TEXT, ac_block_text(b));
+                break;
+            case AC_BLOCK_THINKING:
+                ok = emit_delta(callback, user_data, index, b->type, AC_DELTA_THINKING, ac_block_text(b)) &&
+                     emit_delta(callback, user_data, index, b->type, AC_DELTA_SIGNATURE, ac_str(b->signature));
+                break;
+            case AC_BLOCK_REASONING:
+                ok = emit_delta(callback, user_data, index, b->type, AC_DELTA_REASONING, ac_block_text(b));
+                break;
+            case AC_BLOCK_TOOL_USE:
+                ok = emit_delta(callback, user_data, index, b->type, AC_DELTA_INPUT_JSON, ac_block_input(b));
+                break;
+            default:
+                break;
+        }
+        if (!ok) {
+            return ARC_OK;
+        }
+
+        memset(&ev, 0, sizeof(ev));
+        ev.type = AC_STREAM_CONTENT_BLOCK_STOP;
+        ev.block_index = index;
+        ev.block_type = b->type;
+        if (b->type == AC_BLOCK_TOOL_USE) {
+            ev.tool_id = b->id;
+            ev.tool_name = b->name;
+            ev.tool_input = b->input;
+        }
+        if (!emit(callback, user_data, &ev)) {
+            return ARC_OK;
+        }
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = AC_STREAM_MESSAGE_DELTA;
+    ev.stop_reason = response->stop_reason ? response->stop_reason : response->finish_reason;
+    if (!emit(callback, user_data, &ev)) {
+        return ARC_OK;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = AC_STREAM_MESSAGE_STOP;
+    emit(callback, user_data, &ev);
+    return ARC_OK;
+}
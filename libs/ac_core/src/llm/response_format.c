@@ -0,0 +1,239 @@
+/**
+ * @file response_format.c
+ * @brief Structured output: answer-tool unwrapping and schema checks
+ *
+ * Providers that take the schema natively (OpenAI dialects) answer in
+ * text. The Anthropic dialect answers with a call to the answer tool;
+ * the tap and ac_llm_format_finish turn that call into a text block, so
+ * callers and the agent see the same shape from every provider.
+ */
+
+#include "llm_internal.h"
+#include "json_schema.h"
+#include "message/message_json.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include <stdio.h>
+#include <string.h>
+
+/** Whether the provider answers through the answer tool */
+static int format_uses_tool(const ac_llm_t* llm) {
+    return llm->provider->json_dialect == AC_JSON_DIALECT_ANTHROPIC;
+}
+
+/*============================================================================
+ * Stream Tap
+ *============================================================================*/
+
+static void tap_reset(ac_llm_format_tap_t* tap) {
+    tap->answer_block = -1;
+    tap->failed = 0;
+    tap->fed = 0;
+    ac_json_stream_init(&tap->check);
+}
+
+void ac_llm_format_tap_init(ac_llm_format_tap_t* tap, const ac_llm_t* llm,
+                            ac_stream_callback_t callback, void* user_data) {
+    tap->callback = callback;
+    tap->user_data = user_data;
+    tap->tool = format_uses_tool(llm) ? llm->params.response_format.name : NULL;
+    tap_reset(tap);
+}
+
+int ac_llm_format_tap(const ac_stream_event_t* event, void* user_data) {
+    ac_llm_format_tap_t* tap = (ac_llm_format_tap_t*)user_data;
+    ac_stream_event_t rewritten;
+
+    switch (event->type) {
+        case AC_STREAM_MESSAGE_START:
+            tap_reset(tap);      /* A retried attempt starts over */
+            break;
+
+        case AC_STREAM_CONTENT_BLOCK_START:
+        case AC_STREAM_CONTENT_BLOCK_STOP:
+            if (event->type == AC_STREAM_CONTENT_BLOCK_START && tap->tool &&
+                tap->answer_block < 0 && event->block_type == AC_BLOCK_TOOL_USE &&
+                event->tool_name && strcmp(event->tool_name, tap->tool) == 0) {
+                tap->answer_block = event->block_index;
+            }
+            if (tap->tool && event->block_index == tap->answer_block) {
+                /* No tool_id: nothing dispatches the answer as a tool */
+                rewritten = *event;
+                rewritten.block_type = AC_BLOCK_TEXT;
+                rewritten.tool_id = NULL;
+                rewritten.tool_name = NULL;
+                rewritten.tool_input = NULL;
+                event = &rewritten;
+            }
+            break;
+
+        case AC_STREAM_DELTA: {
+            int answer = tap->tool
+                ? event->block_index == tap->answer_block && event->delta_type == AC_DELTA_INPUT_JSON
+                : event->delta_type == AC_DELTA_TEXT;
+            if (!answer) {
+                break;
+            }
+            if (tap->tool) {
+                rewritten = *event;
+                rewritten.block_type = AC_BLOCK_TEXT;
+                rewritten.delta_type = AC_DELTA_TEXT;
+                event = &rewritten;
+            }
+            if (!tap->failed && event->delta &&
+                ac_json_stream_feed(&tap->check, event->delta, event->delta_len) ==
+                    AC_JSON_STREAM_ERROR) {
+                AC_LOG_WARN("Structured answer is not JSON at byte %zu, stopping the stream",
+                            tap->check.offset);
+                tap->failed = 1;
+            }
+            tap->fed += event->delta_len;
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    int rc = tap->callback(event, tap->user_data);
+    return tap->failed ? -1 : rc;
+}
+
+/*============================================================================
+ * Finished Responses
+ *============================================================================*/
+
+static char* format_strndup(ac_chat_response_t* response, const char* s, size_t len) {
+    if (response->arena) {
+        return arena_strndup(response->arena, s, len);
+    }
+    char* copy = ARC_MALLOC(len + 1);
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+static void format_set(ac_chat_response_t* response, char** field, const char* s) {
+    if (!response->arena && *field) {
+        ARC_FREE(*field);
+    }
+    *field = format_strndup(response, s, strlen(s));
+}
+
+/**
+ * @brief Turn calls to the answer tool into text blocks and the content
+ */
+static void format_adopt_answer(ac_chat_response_t* response, const char* name) {
+    int heap = !response->arena;
+    int adopted = 0;
+    int other_tools = 0;
+
+    for (ac_content_block_t* b = response->blocks; b; b = b->next) {
+        if (b->type != AC_BLOCK_TOOL_USE) {
+            continue;
+        }
+        if (!b->name || strcmp(b->name, name) != 0) {
+            other_tools = 1;
+            continue;
+        }
+        if (heap) {
+            if (b->id) ARC_FREE(b->id);
+            if (b->name) ARC_FREE(b->name);
+        }
+        b->type = AC_BLOCK_TEXT;
+        b->id = NULL;
+        b->name = NULL;
+        b->text = b->input ? b->input : format_strndup(response, "{}", 2);
+        b->text_len = b->input ? b->input_len : 2;
+        b->input = NULL;
+        b->input_len = 0;
+
+        /* The (first) answer is the content, whatever text came before it */
+        if (!adopted++ && b->text) {
+            ac_str_t text = ac_block_text(b);
+            if (heap && response->content) {
+                ARC_FREE(response->content);
+            }
+            response->content = heap ? format_strndup(response, text.ptr, text.len) : b->text;
+            response->content_len = text.len;
+        }
+    }
+    if (!adopted) {
+        return;
+    }
+
+    for (ac_tool_call_t** link = &response->tool_calls; *link;) {
+        ac_tool_call_t* call = *link;
+        if (!call->name || strcmp(call->name, name) != 0) {
+            link = &call->next;
+            continue;
+        }
+        *link = call->next;
+        response->tool_call_count--;
+        if (heap) {
+            if (call->id) ARC_FREE(call->id);
+            if (call->name) ARC_FREE(call->name);
+            if (call->arguments) ARC_FREE(call->arguments);
+            ARC_FREE(call);
+        }
+    }
+
+    /* Answering ends the turn */
+    if (!other_tools) {
+        if (response->stop_reason) {
+            format_set(response, &response->stop_reason, "end_turn");
+        }
+        if (response->finish_reason) {
+            format_set(response, &response->finish_reason, "end_turn");
+        }
+    }
+}
+
+static int response_calls_tools(const ac_chat_response_t* response) {
+    if (response->tool_calls) {
+        return 1;
+    }
+    for (const ac_content_block_t* b = response->blocks; b; b = b->next) {
+        if (b->type == AC_BLOCK_TOOL_USE) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void ac_llm_format_finish(const ac_llm_t* llm, ac_chat_response_t* response,
+                          const ac_llm_format_tap_t* tap) {
+    const ac_response_format_t* format = &llm->params.response_format;
+    if (!format->schema || !response) {
+        return;
+    }
+    if (format_uses_tool(llm)) {
+        format_adopt_answer(response, format->name);
+    }
+
+    char error[256];
+    ac_str_t answer = ac_response_content(response);
+    if (tap && tap->failed) {
+        snprintf(error, sizeof(error), "not valid JSON at byte %zu", tap->check.offset);
+    } else if (answer.ptr) {
+        if (ac_json_schema_check(format->schema, answer.ptr, answer.len, error, sizeof(error))) {
+            return;
+        }
+    } else if (response_calls_tools(response)) {
+        return;                  /* A tool turn, the answer comes later */
+    } else if (ARC_STREAM_DELTA_ONLY && tap && tap->fed > 0) {
+        /* Streamed text is not kept: the syntax check is all there is */
+        ac_json_stream_t check = tap->check;
+        if (ac_json_stream_finish(&check) == AC_JSON_STREAM_COMPLETE) {
+            return;
+        }
+        snprintf(error, sizeof(error), "incomplete JSON");
+    } else {
+        snprintf(error, sizeof(error), "no answer");
+    }
+
+    AC_LOG_WARN("Answer does not match response_format \"%s\": %s", format->name, error);
+    response->format_error = format_strndup(response, error, strlen(error));
+}
@@ -0,0 +1,546 @@
+/**
+ * @file retry.c
+ * @brief Retry, backoff and hedged requests around provider calls
+ */
+
+#include "llm_internal.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include <string.h>
+
+#ifdef ARC_HAS_THREADS
+#include <errno.h>
+#include <time.h>
+#endif
+
+/** Backoff sleeps are split so cancellation is noticed */
+#define RETRY_SLICE_MS 100
+
+/*============================================================================
+ * Backoff
+ *============================================================================*/
+
+int ac_llm_is_transient(arc_err_t err, int http_status) {
+    switch (err) {
+        case ARC_ERR_TIMEOUT:
+        case ARC_ERR_NETWORK:
+            return 1;
+        case ARC_ERR_HTTP:
+            return http_status == 408 || http_status == 429 ||
+                   (http_status >= 500 && http_status != 501);
+        default:
+            return 0;
+    }
+}
+
+static int cancelled(const ac_llm_params_t* params) {
+    return params->cancel && *params->cancel;
+}
+
+int ac_llm_attempt_params(const ac_llm_t* llm, ac_llm_params_t* params) {
+    *params = llm->params;
+    if (params->deadline_ms == 0) {
+        return 1;
+    }
+    uint64_t now = ac_platform_timestamp_ms();
+    if (now >= params->deadline_ms) {
+        return 0;
+    }
+    uint64_t left = params->deadline_ms - now;
+    if (params->timeout_ms <= 0 || left < (uint64_t)params->timeout_ms) {
+        params->timeout_ms = (int)left;
+    }
+    return 1;
+}
+
+static uint32_t next_random(ac_llm_t* llm) {
+    /* xorshift32, seeded in ac_llm_create() */
+    uint32_t x = llm->jitter_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    llm->jitter_state = x;
+    return x;
+}
+
+/**
+ * @brief Delay before retry n (0-based)
+ * @return Delay in ms, or -1 if the server asks for more than max_delay_ms
+ */
+static int64_t retry_delay_ms(ac_llm_t* llm, int n, uint32_t retry_after_ms) {
+    const ac_llm_retry_config_t* rc = &llm->params.retry;
+    uint64_t base = rc->base_delay_ms > 0 ? (uint64_t)rc->base_delay_ms : AC_LLM_RETRY_DEFAULT_BASE_MS;
+    uint64_t cap = rc->max_delay_ms > 0 ? (uint64_t)rc->max_delay_ms : AC_LLM_RETRY_DEFAULT_MAX_MS;
+
+    if (retry_after_ms > cap) {
+        return -1;
+    }
+
+    /* Full jitter over [0, min(cap, base * 2^n)] */
+    uint64_t ceiling = n < 20 ? base << n : cap;
+    if (ceiling > cap) {
+        ceiling = cap;
+    }
+    uint64_t delay = next_random(llm) % (ceiling + 1);
+
+    return (int64_t)(delay > retry_after_ms ? delay : retry_after_ms);
+}
+
+/**
+ * @return 0 if cancelled while waiting, or the wait would end past the deadline
+ */
+static int retry_wait(const ac_llm_params_t* params, uint64_t ms) {
+    /* Waking up past the deadline would only time out */
+    if (params->deadline_ms && ac_platform_timestamp_ms() + ms >= params->deadline_ms) {
+        return 0;
+    }
+    while (ms > 0 && !cancelled(params)) {
+        uint32_t step = ms < RETRY_SLICE_MS ? (uint32_t)ms : RETRY_SLICE_MS;
+        ac_platform_sleep_ms(step);
+        ms -= step;
+    }
+    return !cancelled(params);
+}
+
+/**
+ * @brief Decide whether a failed attempt is retried, and wait if so
+ * @return 1 to retry, 0 to give up with err
+ */
+static int should_retry(
+    ac_llm_t* llm,
+    int attempt,
+    arc_err_t err,
+    int http_status,
+    uint32_t retry_after_ms
+) {
+    if (attempt >= llm->params.retry.max_retries ||
+        !ac_llm_is_transient(err, http_status) || cancelled(&llm->params)) {
+        return 0;
+    }
+
+    int64_t delay = retry_delay_ms(llm, attempt, retry_after_ms);
+    if (delay < 0) {
+        AC_LOG_WARN("LLM call failed (%d, HTTP %d): Retry-After %u ms exceeds max delay",
+                    err, http_status, retry_after_ms);
+        return 0;
+    }
+
+    AC_LOG_WARN("LLM call failed (%d, HTTP %d), retry %d/%d in %lld ms",
+                err, http_status, attempt + 1, llm->params.retry.max_retries,
+                (long long)delay);
+    return retry_wait(&llm->params, (uint64_t)delay);
+}
+
+/*============================================================================
+ * Latency Tracking
+ *============================================================================*/
+
+static void latency_record(ac_llm_t* llm, uint64_t ms) {
+    llm->latency_ms[llm->latency_count % AC_LLM_LATENCY_SAMPLES] =
+        ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+    llm->latency_count++;
+}
+
+#ifdef ARC_HAS_THREADS
+/**
+ * @return Hedge delay for the next call, 0 = do not hedge
+ */
+static uint32_t hedge_delay_ms(const ac_llm_t* llm) {
+    int hedge = llm->params.retry.hedge_after_ms;
+    if (hedge > 0) {
+        return (uint32_t)hedge;
+    }
+    if (hedge != AC_LLM_HEDGE_P95 || llm->latency_count < AC_LLM_HEDGE_MIN_SAMPLES) {
+        return 0;
+    }
+
+    size_t n = llm->latency_count < AC_LLM_LATENCY_SAMPLES
+        ? llm->latency_count : AC_LLM_LATENCY_SAMPLES;
+    uint32_t sorted[AC_LLM_LATENCY_SAMPLES];
+    memcpy(sorted, llm->latency_ms, n * sizeof(sorted[0]));
+
+    for (size_t i = 1; i < n; i++) {
+        uint32_t v = sorted[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    uint32_t p95 = sorted[(n * 95 + 99) / 100 - 1];
+    return p95 > 0 ? p95 : 1;
+}
+#endif
+
+/*============================================================================
+ * Hedged Requests
+ *============================================================================*/
+
+#ifdef ARC_HAS_THREADS
+
+typedef struct hedge hedge_t;
+
+typedef struct {
+    hedge_t* hedge;
+    ac_llm_params_t params;          /* llm->params with the attempt's cancel flag */
+    volatile int cancel;
+    ac_chat_response_t response;
+    arc_err_t err;
+    int started;
+    int finished;                    /* Guarded by hedge->lock */
+    pthread_t thread;
+} hedge_attempt_t;
+
+struct hedge {
+    ac_llm_t* llm;
+    const ac_message_t* messages;
+    const char* tools;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    hedge_attempt_t attempts[2];
+};
+
+static void timespec_after(struct timespec* ts, uint32_t ms) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t ns = (uint64_t)now.tv_nsec + (uint64_t)ms * 1000000;
+    ts->tv_sec = now.tv_sec + ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
+static void* hedge_run(void* arg) {
+    hedge_attempt_t* a = (hedge_attempt_t*)arg;
+    hedge_t* h = a->hedge;
+
+    arc_err_t err = h->llm->provider->chat(h->llm->priv, &a->params, h->messages,
+                                           h->tools, &a->response);
+
+    pthread_mutex_lock(&h->lock);
+    a->err = err;
+    a->finished = 1;
+    pthread_cond_broadcast(&h->cond);
+    pthread_mutex_unlock(&h->lock);
+    return NULL;
+}
+
+static int hedge_start(hedge_attempt_t* a) {
+    a->started = pthread_create(&a->thread, NULL, hedge_run, a) == 0;
+    return a->started;
+}
+
+/**
+ * @brief Run one attempt, duplicated after delay_ms if still pending
+ *
+ * Both requests run on helper threads so the caller can keep time; the
+ * loser is cancelled and joined before returning, since it still reads
+ * the message list. Not inlined: the two attempts' state would otherwise
+ * sit in every retry frame.
+ */
+static ARC_NOINLINE arc_err_t chat_hedged(
+    ac_llm_t* llm,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_chat_response_t* response,
+    uint32_t delay_ms
+) {
+    hedge_t h;
+    memset(&h, 0, sizeof(h));
+    h.llm = llm;
+    h.messages = messages;
+    h.tools = tools;
+    pthread_mutex_init(&h.lock, NULL);
+    pthread_cond_init(&h.cond, NULL);
+
+    for (int i = 0; i < 2; i++) {
+        hedge_attempt_t* a = &h.attempts[i];
+        a->hedge = &h;
+        a->params = *params;
+        a->params.cancel = &a->cancel;
+        ac_chat_response_init(&a->response);
+    }
+
+    hedge_attempt_t* first = &h.attempts[0];
+    hedge_attempt_t* second = &h.attempts[1];
+
+    if (!hedge_start(first)) {
+        pthread_cond_destroy(&h.cond);
+        pthread_mutex_destroy(&h.lock);
+        return llm->provider->chat(llm->priv, params, messages, tools, response);
+    }
+
+    uint64_t fire_at = ac_platform_timestamp_ms() + delay_ms;
+    hedge_attempt_t* winner = NULL;
+    hedge_attempt_t* last = NULL;
+
+    pthread_mutex_lock(&h.lock);
+    for (;;) {
+        int running = 0;
+        for (int i = 0; i < 2; i++) {
+            hedge_attempt_t* a = &h.attempts[i];
+            if (!a->started) {
+                continue;
+            }
+            if (!a->finished) {
+                running++;
+            } else if (a->err == ARC_OK && !winner) {
+                winner = a;
+            } else if (a->err != ARC_OK) {
+                last = a;
+            }
+        }
+
+        /* A failure before the hedge fired goes to the retry policy */
+        if (winner || running == 0) {
+            break;
+        }
+
+        if (cancelled(&llm->params)) {
+            first->cancel = 1;
+            second->cancel = 1;
+        }
+
+        uint64_t now = ac_platform_timestamp_ms();
+        if (!second->started && now >= fire_at) {
+            pthread_mutex_unlock(&h.lock);
+            AC_LOG_INFO("LLM call pending after %u ms, sending hedged request", delay_ms);
+            hedge_start(second);
+            pthread_mutex_lock(&h.lock);
+            continue;
+        }
+
+        uint64_t wait = RETRY_SLICE_MS;
+        if (!second->started && fire_at - now < wait) {
+            wait = fire_at - now;
+        }
+        struct timespec deadline;
+        timespec_after(&deadline, (uint32_t)wait);
+        pthread_cond_timedwait(&h.cond, &h.lock, &deadline);
+    }
+    pthread_mutex_unlock(&h.lock);
+
+    /* Cancel and join the loser */
+    for (int i = 0; i < 2; i++) {
+        hedge_attempt_t* a = &h.attempts[i];
+        if (a->started && a != winner) {
+            a->cancel = 1;
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        if (h.attempts[i].started) {
+            pthread_join(h.attempts[i].thread, NULL);
+        }
+    }
+
+    hedge_attempt_t* result = winner ? winner : last;
+    arc_err_t err = result->err;
+    *response = result->response;
+    for (int i = 0; i < 2; i++) {
+        if (&h.attempts[i] != result) {
+            ac_chat_response_free(&h.attempts[i].response);
+        }
+    }
+
+    if (winner && second->started) {
+        AC_LOG_INFO("Hedged LLM call won by the %s request",
+                    winner == first ? "original" : "hedged");
+    }
+
+    pthread_cond_destroy(&h.cond);
+    pthread_mutex_destroy(&h.lock);
+    return err;
+}
+
+#endif /* ARC_HAS_THREADS */
+
+/*============================================================================
+ * Raw Passthrough
+ *============================================================================*/
+
+int ac_llm_raw_tap(const char* data, size_t len, void* user_data) {
+    ac_llm_raw_tap_t* raw = (ac_llm_raw_tap_t*)user_data;
+
+    /* Errors come back as a JSON document, an event stream never starts like one */
+    if (raw->state == 0) {
+        size_t i = 0;
+        while (i < len && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n')) {
+            i++;
+        }
+        if (i == len) {
+            return 0;            /* Blank lines before the first event mean nothing */
+        }
+        raw->state = data[i] == '{' || data[i] == '[' ? -1 : 1;
+    }
+    if (raw->state < 0 || len == 0) {
+        return 0;
+    }
+    raw->delivered = 1;
+    return raw->sink(data, len, raw->user_data);
+}
+
+int ac_llm_raw_skip(const char* data, size_t len, void* user_data) {
+    (void)data;
+    (void)len;
+    (void)user_data;
+    return 0;
+}
+
+/*============================================================================
+ * Policy Entry Points
+ *============================================================================*/
+
+arc_err_t ac_llm_retry_chat(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_chat_response_t* response
+) {
+    /* Hedged attempts fill heap responses; plain retries keep the caller's arena */
+    arena_t* arena = response->arena;
+
+    for (int attempt = 0;; attempt++) {
+        uint32_t hedge = 0;
+#ifdef ARC_HAS_THREADS
+        if (llm->provider->reentrant && llm->provider->reentrant(llm->priv)) {
+            hedge = hedge_delay_ms(llm);
+        }
+#endif
+
+        ac_llm_params_t params;
+        if (!ac_llm_attempt_params(llm, &params)) {
+            return ARC_ERR_TIMEOUT;
+        }
+
+        uint64_t start = ac_platform_timestamp_ms();
+        arc_err_t err;
+#ifdef ARC_HAS_THREADS
+        if (hedge > 0) {
+            err = chat_hedged(llm, &params, messages, tools, response, hedge);
+        } else
+#endif
+        {
+            err = llm->provider->chat(llm->priv, &params, messages, tools, response);
+        }
+
+        if (err == ARC_OK) {
+            latency_record(llm, ac_platform_timestamp_ms() - start);
+            return ARC_OK;
+        }
+
+        if (!should_retry(llm, attempt, err, response->http_status, response->retry_after_ms)) {
+            return err;
+        }
+        struct ac_intern* intern = response->intern;
+        ac_chat_response_free(response);
+        ac_chat_response_init_arena(response, arena);
+        response->intern = intern;
+    }
+}
+
+typedef struct {
+    ac_stream_callback_t callback;
+    void* user_data;
+    int delivered;                   /* An event reached the caller: no retry */
+} stream_guard_t;
+
+static int guarded_callback(const ac_stream_event_t* event, void* user_data) {
+    stream_guard_t* guard = (stream_guard_t*)user_data;
+    guard->delivered = 1;
+    return guard->callback(event, guard->user_data);
+}
+
+arc_err_t ac_llm_retry_stream(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_stream_callback_t callback,
+    void* user_data,
+    ac_chat_response_t* response
+) {
+    stream_guard_t guard = { .callback = callback, .user_data = user_data };
+
+    /* Status and Retry-After come back through the response */
+    ac_chat_response_t scratch;
+    ac_chat_response_t* out = response ? response : &scratch;
+    ac_chat_response_init(out);
+
+    for (int attempt = 0;; attempt++) {
+        ac_llm_params_t params;
+        if (!ac_llm_attempt_params(llm, &params)) {
+            if (out == &scratch) {
+                ac_chat_response_free(&scratch);
+            }
+            return ARC_ERR_TIMEOUT;
+        }
+        arc_err_t err = llm->provider->chat_stream(llm->priv, &params, messages, tools,
+                                                   guarded_callback, &guard, out);
+
+        if (err == ARC_OK || guard.delivered ||
+            !should_retry(llm, attempt, err, out->http_status, out->retry_after_ms)) {
+            if (out == &scratch) {
+                ac_chat_response_free(&scratch);
+            }
+            return err;
+        }
+        ac_chat_response_free(out);
+        ac_chat_response_init(out);
+    }
+}
+
+arc_err_t ac_llm_retry_stream_raw(
+    ac_llm_t* llm,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_raw_tap_t* raw,
+    ac_chat_response_t* response
+) {
+    ac_chat_response_t scratch;
+    ac_chat_response_t* out = response ? response : &scratch;
+    ac_chat_response_init(out);
+
+    for (int attempt = 0;; attempt++) {
+        ac_llm_params_t params;
+        if (!ac_llm_attempt_params(llm, &params)) {
+            if (out == &scratch) {
+                ac_chat_response_free(&scratch);
+            }
+            return ARC_ERR_TIMEOUT;
+        }
+        arc_err_t err = llm->provider->chat_stream_raw(llm->priv, &params, messages, tools,
+                                                       raw, out);
+
+        if (err == ARC_OK || raw->delivered ||
+            !should_retry(llm, attempt, err, out->http_status, out->retry_after_ms)) {
+            if (out == &scratch) {
+                ac_chat_response_free(&scratch);
+            }
+            return err;
+        }
+        ac_chat_response_free(out);
+        ac_chat_response_init(out);
+    }
+}
+
+arc_err_t ac_llm_retry_embed(
+    ac_llm_t* llm,
+    const char* const* inputs,
+    size_t count,
+    ac_llm_embed_result_t* result
+) {
+    for (int attempt = 0;; attempt++) {
+        ac_llm_params_t params;
+        if (!ac_llm_attempt_params(llm, &params)) {
+            return ARC_ERR_TIMEOUT;
+        }
+        memset(result, 0, sizeof(*result));
+        arc_err_t err = llm->provider->embed(llm->priv, &params, inputs, count, result);
+        if (err == ARC_OK ||
+            !should_retry(llm, attempt, err, result->http_status, result->retry_after_ms)) {
+            return err;
+        }
+    }
+}
@@ -0,0 +1,513 @@
+/**
+ * @file router.c
+ * @brief Multi-endpoint routing and failover for one logical LLM
+ *
+ * A meta-provider over ac_llm_ops_t: every endpoint of params.routing
+ * gets its own instance of the real provider (created with that
+ * endpoint's api_base and api_key), and each call is routed to one of
+ * them. Selection, health tracking and failover live here; retry with
+ * backoff and hedging stay in retry.c, one level up, so a hedged request
+ * naturally lands on a second endpoint.
+ */
+
+#include "llm_internal.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include <string.h>
+
+/** EWMA weight of a new sample: 1 / 2^ROUTER_EWMA_SHIFT */
+#define ROUTER_EWMA_SHIFT   3
+
+/** Fixed-point scale of the error rate EWMA */
+#define ROUTER_ERROR_SCALE  1024
+
+typedef enum {
+    ROUTE_OK,                /* Success: latency sample, health restored */
+    ROUTE_FAILED,            /* Transient failure: counts against the endpoint */
+    ROUTE_NEUTRAL            /* Not the endpoint's fault (bad request, cancelled) */
+} route_outcome_t;
+
+typedef struct {
+    const char* api_base;    /* Points into llm->params.routing (arena) */
+    const char* api_key;     /* Endpoint key, or NULL for params.api_key */
+    uint32_t weight;
+    void* priv;              /* Inner provider instance */
+
+    /* Health, guarded by router_t.lock */
+    int inflight;
+    uint32_t latency_ms;     /* Latency EWMA, 0 = no sample yet */
+    uint32_t error_rate;     /* Failure EWMA, 0..ROUTER_ERROR_SCALE */
+    int failures;            /* Consecutive */
+    uint64_t ejected_until;  /* Timestamp (ms), 0 = in rotation */
+    int probing;             /* The one request admitted after ejection is out */
+} router_endpoint_t;
+
+typedef struct {
+    ac_llm_ops_t ops;        /* What llm->provider points to */
+    const ac_llm_ops_t* inner;
+    router_endpoint_t* endpoints;
+    int count;
+    ac_llm_route_policy_t policy;
+    int eject_errors;
+    uint32_t eject_ms;
+    pthread_mutex_t lock;
+    uint32_t random_state;   /* xorshift32 for weighted picks */
+    int sticky;              /* Endpoint of the last success (response chains) */
+} router_t;
+
+/*============================================================================
+ * Selection
+ *============================================================================*/
+
+static uint32_t router_random(router_t* r) {
+    uint32_t x = r->random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    r->random_state = x;
+    return x;
+}
+
+/**
+ * @brief In rotation, or ejected long enough for its probe to go out
+ */
+static int endpoint_available(const router_endpoint_t* ep, uint64_t now) {
+    return ep->ejected_until == 0 || (now >= ep->ejected_until && !ep->probing);
+}
+
+static int pick_weighted(router_t* r, uint64_t tried, uint64_t now) {
+    uint64_t total = 0;
+    uint64_t share[AC_LLM_ROUTE_MAX_ENDPOINTS];
+
+    for (int i = 0; i < r->count; i++) {
+        const router_endpoint_t* ep = &r->endpoints[i];
+        share[i] = 0;
+        if ((tried >> i) & 1 || !endpoint_available(ep, now)) {
+            continue;
+        }
+        /* An endpoint failing half its calls gets half its weight */
+        share[i] = (uint64_t)ep->weight * (ROUTER_ERROR_SCALE - ep->error_rate) /
+                   ROUTER_ERROR_SCALE;
+        if (share[i] == 0) {
+            share[i] = 1;
+        }
+        total += share[i];
+    }
+    if (total == 0) {
+        return -1;
+    }
+
+    uint64_t ticket = router_random(r) % total;
+    for (int i = 0; i < r->count; i++) {
+        if (ticket < share[i]) {
+            return i;
+        }
+        ticket -= share[i];
+    }
+    return -1;
+}
+
+static int pick_least_outstanding(router_t* r, uint64_t tried, uint64_t now) {
+    int best = -1;
+    uint64_t best_score = 0;
+
+    for (int i = 0; i < r->count; i++) {
+        const router_endpoint_t* ep = &r->endpoints[i];
+        if ((tried >> i) & 1 || !endpoint_available(ep, now)) {
+            continue;
+        }
+        /* Expected wait: queue depth times latency, inflated by errors.
+         * Unmeasured endpoints count as 1 ms so they get tried early. */
+        uint64_t latency = ep->latency_ms > 0 ? ep->latency_ms : 1;
+        uint64_t score = (uint64_t)(ep->inflight + 1) * latency *
+                         (ROUTER_ERROR_SCALE + 4 * (uint64_t)ep->error_rate);
+        if (best < 0 || score < best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Nothing available: the untried endpoint that comes back first
+ */
+static int pick_soonest(router_t* r, uint64_t tried) {
+    int best = -1;
+    for (int i = 0; i < r->count; i++) {
+        if ((tried >> i) & 1) {
+            continue;
+        }
+        if (best < 0 || r->endpoints[i].ejected_until < r->endpoints[best].ejected_until) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Choose an endpoint not in tried and mark a request in flight on it
+ *
+ * @param chained Request continues a stored response: prefer the
+ *                endpoint that produced the last one
+ * @return Endpoint index, -1 once every endpoint has been tried
+ */
+static int router_pick(router_t* r, uint64_t tried, int chained) {
+    uint64_t now = ac_platform_timestamp_ms();
+
+    pthread_mutex_lock(&r->lock);
+    int pick = -1;
+    if (chained && r->sticky >= 0 && !((tried >> r->sticky) & 1) &&
+        endpoint_available(&r->endpoints[r->sticky], now)) {
+        pick = r->sticky;
+    }
+    if (pick < 0) {
+        pick = r->policy == AC_LLM_ROUTE_LEAST_OUTSTANDING
+            ? pick_least_outstanding(r, tried, now)
+            : pick_weighted(r, tried, now);
+    }
+    if (pick < 0) {
+        pick = pick_soonest(r, tried);
+    }
+    if (pick >= 0) {
+        router_endpoint_t* ep = &r->endpoints[pick];
+        ep->inflight++;
+        if (ep->ejected_until != 0) {
+            ep->probing = 1;
+        }
+    }
+    pthread_mutex_unlock(&r->lock);
+    return pick;
+}
+
+/*============================================================================
+ * Health Tracking
+ *============================================================================*/
+
+static void router_report(router_t* r, int i, route_outcome_t outcome, uint64_t elapsed_ms) {
+    router_endpoint_t* ep = &r->endpoints[i];
+    uint32_t ms = elapsed_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed_ms;
+
+    pthread_mutex_lock(&r->lock);
+    ep->inflight--;
+    ep->probing = 0;
+
+    if (outcome == ROUTE_OK) {
+        if (ep->ejected_until != 0) {
+            AC_LOG_INFO("Router: %s is back in rotation", ep->api_base);
+        }
+        ep->failures = 0;
+        ep->ejected_until = 0;
+        ep->error_rate -= ep->error_rate >> ROUTER_EWMA_SHIFT;
+        if (ep->latency_ms == 0) {
+            ep->latency_ms = ms > 0 ? ms : 1;
+        } else {
+            int64_t delta = (int64_t)ms - (int64_t)ep->latency_ms;
+            ep->latency_ms = (uint32_t)((int64_t)ep->latency_ms + delta / (1 << ROUTER_EWMA_SHIFT));
+            if (ep->latency_ms == 0) {
+                ep->latency_ms = 1;
+            }
+        }
+        r->sticky = i;
+    } else if (outcome == ROUTE_FAILED) {
+        ep->failures++;
+        ep->error_rate += (ROUTER_ERROR_SCALE - ep->error_rate) >> ROUTER_EWMA_SHIFT;
+        if (ep->failures >= r->eject_errors) {
+            if (ep->ejected_until == 0) {
+                AC_LOG_WARN("Router: ejecting %s for %u ms after %d failures",
+                            ep->api_base, r->eject_ms, ep->failures);
+            }
+            ep->ejected_until = ac_platform_timestamp_ms() + r->eject_ms;
+        }
+    }
+    pthread_mutex_unlock(&r->lock);
+}
+
+static route_outcome_t classify(const ac_llm_params_t* params, arc_err_t err, int http_status) {
+    if (err == ARC_OK) {
+        return ROUTE_OK;
+    }
+    if ((params->cancel && *params->cancel) || !ac_llm_is_transient(err, http_status)) {
+        return ROUTE_NEUTRAL;
+    }
+    return ROUTE_FAILED;
+}
+
+static int all_tried(const router_t* r, uint64_t tried) {
+    return tried == (r->count == 64 ? UINT64_MAX : ((uint64_t)1 << r->count) - 1);
+}
+
+/**
+ * @brief params as seen by endpoint i's provider instance
+ */
+static void endpoint_params(const router_t* r, int i, const ac_llm_params_t* params,
+                            ac_llm_params_t* out) {
+    const router_endpoint_t* ep = &r->endpoints[i];
+    *out = *params;
+    out->api_base = ep->api_base;
+    if (ep->api_key) {
+        out->api_key = ep->api_key;
+    }
+    memset(&out->routing, 0, sizeof(out->routing));
+}
+
+/*============================================================================
+ * Provider Operations
+ *============================================================================*/
+
+static arc_err_t router_chat(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_chat_response_t* response
+) {
+    router_t* r = (router_t*)priv_data;
+    arena_t* arena = response->arena;
+    struct ac_intern* intern = response->intern;
+    int chained = params->stateful.response_id != NULL;
+    uint64_t tried = 0;
+    arc_err_t err = ARC_ERR_NETWORK;
+
+    for (;;) {
+        int i = router_pick(r, tried, chained);
+        if (i < 0) {
+            return err;
+        }
+        tried |= (uint64_t)1 << i;
+
+        ac_llm_params_t p;
+        endpoint_params(r, i, params, &p);
+
+        uint64_t start = ac_platform_timestamp_ms();
+        err = r->inner->chat(r->endpoints[i].priv, &p, messages, tools, response);
+        route_outcome_t outcome = classify(params, err, response->http_status);
+        router_report(r, i, outcome, ac_platform_timestamp_ms() - start);
+
+        /* The last failure keeps its status for the retry policy */
+        if (outcome != ROUTE_FAILED || all_tried(r, tried)) {
+            return err;
+        }
+
+        AC_LOG_WARN("Router: %s failed (%d, HTTP %d), failing over",
+                    r->endpoints[i].api_base, err, response->http_status);
+        ac_chat_response_free(response);
+        ac_chat_response_init_arena(response, arena);
+        response->intern = intern;
+    }
+}
+
+typedef struct {
+    ac_stream_callback_t callback;
+    void* user_data;
+    int delivered;           /* An event reached the caller: no failover */
+} router_guard_t;
+
+static int router_guarded(const ac_stream_event_t* event, void* user_data) {
+    router_guard_t* guard = (router_guard_t*)user_data;
+    guard->delivered = 1;
+    return guard->callback(event, guard->user_data);
+}
+
+static arc_err_t router_chat_stream(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_stream_callback_t callback,
+    void* user_data,
+    ac_chat_response_t* response
+) {
+    router_t* r = (router_t*)priv_data;
+    router_guard_t guard = { .callback = callback, .user_data = user_data };
+    int chained = params->stateful.response_id != NULL;
+    uint64_t tried = 0;
+    arc_err_t err = ARC_ERR_NETWORK;
+
+    for (;;) {
+        int i = router_pick(r, tried, chained);
+        if (i < 0) {
+            return err;
+        }
+        tried |= (uint64_t)1 << i;
+
+        ac_llm_params_t p;
+        endpoint_params(r, i, params, &p);
+
+        uint64_t start = ac_platform_timestamp_ms();
+        err = r->inner->chat_stream(r->endpoints[i].priv, &p, messages, tools,
+                                    router_guarded, &guard, response);
+        int status = response ? response->http_status : 0;
+        route_outcome_t outcome = classify(params, err, status);
+        router_report(r, i, outcome, ac_platform_timestamp_ms() - start);
+
+        if (outcome != ROUTE_FAILED || guard.delivered || all_tried(r, tried)) {
+            return err;
+        }
+
+        AC_LOG_WARN("Router: %s failed (%d, HTTP %d), failing over",
+                    r->endpoints[i].api_base, err, status);
+        if (response) {
+            ac_chat_response_free(response);
+            ac_chat_response_init(response);
+        }
+    }
+}
+
+static arc_err_t router_chat_stream_raw(
+    void* priv_data,
+    const ac_llm_params_t* params,
+    const ac_message_t* messages,
+    const char* tools,
+    ac_llm_raw_tap_t* raw,
+    ac_chat_response_t* response
+) {
+    router_t* r = (router_t*)priv_data;
+    int chained = params->stateful.response_id != NULL;
+    uint64_t tried = 0;
+    arc_err_t err = ARC_ERR_NETWORK;
+
+    for (;;) {
+        int i = router_pick(r, tried, chained);
+        if (i < 0) {
+            return err;
+        }
+        tried |= (uint64_t)1 << i;
+
+        ac_llm_params_t p;
+        endpoint_params(r, i, params, &p);
+
+        uint64_t start = ac_platform_timestamp_ms();
+        err = r->inner->chat_stream_raw(r->endpoints[i].priv, &p, messages, tools, raw, response);
+        int status = response ? response->http_status : 0;
+        route_outcome_t outcome = classify(params, err, status);
+        router_report(r, i, outcome, ac_platform_timestamp_ms() - start);
+
+        if (outcome != ROUTE_FAILED || raw->delivered || all_tried(r, tried)) {
+            return err;
+        }
+
+        AC_LOG_WARN("Router: %s failed (%d, HTTP %d), failing over",
+                    r->endpoints[i].api_base, err, status);
+        if (response) {
+            ac_chat_response_free(response);
+            ac_chat_response_init(response);
+        }
+    }
+}
+
+/**
+ * @brief Reentrant only if every endpoint's instance is
+ */
+static int router_reentrant(void* priv_data) {
+    router_t* r = (router_t*)priv_data;
+    if (!r->inner->reentrant) {
+        return 0;
+    }
+    for (int i = 0; i < r->count; i++) {
+        if (!r->inner->reentrant(r->endpoints[i].priv)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void router_cleanup(void* priv_data) {
+    router_t* r = (router_t*)priv_data;
+    if (!r) {
+        return;
+    }
+
+    for (int i = 0; i < r->count; i++) {
+        if (r->inner->cleanup && r->endpoints[i].priv) {
+            r->inner->cleanup(r->endpoints[i].priv);
+        }
+    }
+    pthread_mutex_destroy(&r->lock);
+    ARC_FREE(r->endpoints);
+    ARC_FREE(r);
+
+    AC_LOG_DEBUG("Router cleaned up");
+}
+
+/*============================================================================
+ * Creation
+ *============================================================================*/
+
+const ac_llm_ops_t* ac_llm_router_create(
+    const ac_llm_ops_t* inner,
+    const ac_llm_params_t* params,
+    void** priv
+) {
+    const ac_llm_routing_config_t* cfg = &params->routing;
+    if (!inner || !priv || cfg->endpoint_count <= 0 ||
+        cfg->endpoint_count > AC_LLM_ROUTE_MAX_ENDPOINTS || !cfg->endpoints) {
+        AC_LOG_ERROR("Router: need 1..%d endpoints", AC_LLM_ROUTE_MAX_ENDPOINTS);
+        return NULL;
+    }
+    for (int i = 0; i < cfg->endpoint_count; i++) {
+        if (!cfg->endpoints[i].api_base) {
+            AC_LOG_ERROR("Router: endpoint %d has no api_base", i);
+            return NULL;
+        }
+    }
+
+    router_t* r = (router_t*)ARC_CALLOC(1, sizeof(router_t));
+    if (!r) {
+        return NULL;
+    }
+    r->endpoints = (router_endpoint_t*)ARC_CALLOC((size_t)cfg->endpoint_count,
+                                                  sizeof(router_endpoint_t));
+    if (!r->endpoints) {
+        ARC_FREE(r);
+        return NULL;
+    }
+
+    r->inner = inner;
+    r->policy = cfg->policy;
+    r->eject_errors = cfg->eject_errors > 0 ? cfg->eject_errors : AC_LLM_ROUTE_DEFAULT_EJECT_ERRORS;
+    r->eject_ms = cfg->eject_ms > 0 ? (uint32_t)cfg->eject_ms : AC_LLM_ROUTE_DEFAULT_EJECT_MS;
+    r->sticky = -1;
+    r->random_state = (uint32_t)ac_platform_timestamp_ms() ^ (uint32_t)(uintptr_t)r;
+    if (r->random_state == 0) {
+        r->random_state = 1;
+    }
+    pthread_mutex_init(&r->lock, NULL);
+
+    /* One inner instance per endpoint; a failure unwinds the ones made so far */
+    for (int i = 0; i < cfg->endpoint_count; i++) {
+        router_endpoint_t* ep = &r->endpoints[i];
+        ep->api_base = cfg->endpoints[i].api_base;
+        ep->api_key = cfg->endpoints[i].api_key;
+        ep->weight = cfg->endpoints[i].weight > 0 ? (uint32_t)cfg->endpoints[i].weight : 1;
+        r->count = i + 1;
+
+        if (inner->create) {
+            ac_llm_params_t p;
+            endpoint_params(r, i, params, &p);
+            ep->priv = inner->create(&p);
+            if (!ep->priv) {
+                AC_LOG_ERROR("Router: provider %s failed for %s", inner->name, ep->api_base);
+                r->count = i;
+                router_cleanup(r);
+                return NULL;
+            }
+        }
+    }
+
+    r->ops.name = "router";
+    r->ops.capabilities = inner->capabilities;
+    r->ops.json_dialect = inner->json_dialect;
+    r->ops.create = NULL;
+    r->ops.chat = inner->chat ? router_chat : NULL;
+    r->ops.chat_stream = inner->chat_stream ? router_chat_stream : NULL;
+    r->ops.chat_stream_raw = inner->chat_stream_raw ? router_chat_stream_raw : NULL;
+    r->ops.reentrant = router_reentrant;
+    r->ops.cleanup = router_cleanup;
+
+    AC_LOG_DEBUG("Router: %d %s endpoints, %s", r->count, inner->name,
+                 r->policy == AC_LLM_ROUTE_LEAST_OUTSTANDING ? "least outstanding" : "weighted");
+    *priv = r;
+    return &r->ops;
+}
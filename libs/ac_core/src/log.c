@@ -7,6 +7,8 @@
  *
  * Thread Safety:
  * - All log output is protected by a mutex to prevent interleaved output
+ * - In deferred mode each thread formats into its own single-producer
+ *   ring; only the writer thread takes the mutex to output
  */
 
 #include "arc/log.h"
@@ -14,6 +16,11 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#ifdef ARC_HAS_THREADS
+#include <stdatomic.h>
+#include <time.h>
+#endif
+
 /* Global log level */
 static ac_log_level_t g_log_level = AC_LOG_LEVEL_INFO;
 
@@ -45,6 +52,284 @@ void ac_log_set_handler(ac_log_handler_t handler) {
     g_log_handler = handler;
 }
 
+/**
+ * @brief Hand one message to the handler (g_log_mutex held)
+ */
+static void log_output(
+    ac_log_level_t level,
+    const char* file,
+    int line,
+    const char* func,
+    const char* fmt,
+    va_list args
+) {
+    // Use custom handler if set, otherwise use platform default
+    if (g_log_handler) {
+        g_log_handler(level, file, line, func, fmt, args);
+    } else {
+        ac_log_platform_default_handler(level, file, line, func, fmt, args);
+    }
+}
+
+/*============================================================================
+ * Deferred Output
+ *============================================================================*/
+
+#ifdef ARC_HAS_THREADS
+
+typedef struct {
+    ac_log_level_t level;
+    const char* file;                /* __FILE__ / __func__: static storage */
+    int line;
+    const char* func;
+    char msg[AC_LOG_ASYNC_MSG_MAX];
+} log_record_t;
+
+typedef struct log_ring {
+    struct log_ring* next;           /* Ring list; only the writer unlinks */
+    _Atomic uint32_t head;           /* Next record the writer takes */
+    _Atomic uint32_t tail;           /* Next record the owner fills */
+    atomic_int orphaned;             /* Owner thread exited */
+    log_record_t slots[AC_LOG_ASYNC_SLOTS];
+} log_ring_t;
+
+static _Atomic(log_ring_t*) s_rings;
+static pthread_key_t s_ring_key;
+static pthread_once_t s_key_once = PTHREAD_ONCE_INIT;
+static int s_key_ok;
+
+static atomic_int s_async;           /* Deferred mode on */
+static pthread_mutex_t s_async_lock = PTHREAD_MUTEX_INITIALIZER;   /* start/stop */
+static pthread_mutex_t s_wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_wake = PTHREAD_COND_INITIALIZER;           /* Writer: work */
+static pthread_cond_t s_drained = PTHREAD_COND_INITIALIZER;        /* Flushers: a pass ended */
+static int s_writer_stop;
+static pthread_t s_writer;
+
+static void ring_orphan(void* ring) {
+    atomic_store_explicit(&((log_ring_t*)ring)->orphaned, 1, memory_order_release);
+}
+
+static void ring_key_create(void) {
+    s_key_ok = pthread_key_create(&s_ring_key, ring_orphan) == 0;
+}
+
+/**
+ * @brief The calling thread's ring, created and listed on first use
+ */
+static log_ring_t* ring_of_thread(void) {
+    pthread_once(&s_key_once, ring_key_create);
+    if (!s_key_ok) {
+        return NULL;
+    }
+    log_ring_t* ring = (log_ring_t*)pthread_getspecific(s_ring_key);
+    if (ring) {
+        return ring;
+    }
+    ring = (log_ring_t*)ARC_CALLOC(1, sizeof(log_ring_t));
+    if (!ring) {
+        return NULL;
+    }
+    if (pthread_setspecific(s_ring_key, ring) != 0) {
+        ARC_FREE(ring);
+        return NULL;
+    }
+    log_ring_t* first = atomic_load_explicit(&s_rings, memory_order_relaxed);
+    do {
+        ring->next = first;
+    } while (!atomic_compare_exchange_weak_explicit(&s_rings, &first, ring,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+    return ring;
+}
+
+static void wake_writer(void) {
+    pthread_mutex_lock(&s_wake_lock);
+    pthread_cond_signal(&s_wake);
+    pthread_mutex_unlock(&s_wake_lock);
+}
+
+/**
+ * @brief Queue a message on the calling thread's ring
+ *
+ * @return 1 if queued, 0 to write it synchronously (args untouched)
+ */
+static int async_push(
+    ac_log_level_t level,
+    const char* file,
+    int line,
+    const char* func,
+    const char* fmt,
+    va_list args
+) {
+    log_ring_t* ring = ring_of_thread();
+    if (!ring) {
+        return 0;
+    }
+
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    while (tail - head >= AC_LOG_ASYNC_SLOTS) {
+        /* Full: wait for the writer rather than drop or reorder */
+        if (!atomic_load_explicit(&s_async, memory_order_relaxed)) {
+            return 0;
+        }
+        wake_writer();
+        ac_platform_sleep_ms(1);
+        head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    }
+
+    log_record_t* rec = &ring->slots[tail % AC_LOG_ASYNC_SLOTS];
+    rec->level = level;
+    rec->file = file;
+    rec->line = line;
+    rec->func = func;
+    vsnprintf(rec->msg, sizeof(rec->msg), fmt, args);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    if (tail + 1 - head >= AC_LOG_ASYNC_SLOTS / 2) {
+        wake_writer();
+    }
+    return 1;
+}
+
+static void record_output(const log_record_t* rec, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_output(rec->level, rec->file, rec->line, rec->func, fmt, args);
+    va_end(args);
+}
+
+/**
+ * @brief Write every queued record; free drained rings of exited threads
+ *
+ * Called by the writer, or by ac_log_async_stop() once it has joined.
+ */
+static void drain_rings(void) {
+    pthread_mutex_lock(&g_log_mutex);
+    log_ring_t* prev = NULL;
+    log_ring_t* ring = atomic_load_explicit(&s_rings, memory_order_acquire);
+    while (ring) {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        for (; head != tail; head++) {
+            record_output(&ring->slots[head % AC_LOG_ASYNC_SLOTS], "%s",
+                          ring->slots[head % AC_LOG_ASYNC_SLOTS].msg);
+            atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+        }
+
+        log_ring_t* next = ring->next;
+        /* New rings are pushed at the list head, so only later nodes are unlinked */
+        if (prev && atomic_load_explicit(&ring->orphaned, memory_order_acquire) &&
+            atomic_load_explicit(&ring->tail, memory_order_acquire) == head) {
+            prev->next = next;
+            ARC_FREE(ring);
+        } else {
+            prev = ring;
+        }
+        ring = next;
+    }
+    pthread_mutex_unlock(&g_log_mutex);
+}
+
+static int rings_empty(void) {
+    for (log_ring_t* ring = atomic_load_explicit(&s_rings, memory_order_acquire);
+         ring; ring = ring->next) {
+        if (atomic_load_explicit(&ring->head, memory_order_acquire) !=
+            atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void deadline_in(struct timespec* ts, uint32_t ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    uint64_t ns = (uint64_t)ts->tv_nsec + (uint64_t)ms * 1000000;
+    ts->tv_sec += (time_t)(ns / 1000000000);
+    ts->tv_nsec = (long)(ns % 1000000000);
+}
+
+static void* writer_main(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&s_wake_lock);
+    while (!s_writer_stop) {
+        pthread_mutex_unlock(&s_wake_lock);
+        drain_rings();
+        pthread_mutex_lock(&s_wake_lock);
+        pthread_cond_broadcast(&s_drained);
+        if (!s_writer_stop) {
+            struct timespec deadline;
+            deadline_in(&deadline, AC_LOG_ASYNC_INTERVAL_MS);
+            pthread_cond_timedwait(&s_wake, &s_wake_lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&s_wake_lock);
+    return NULL;
+}
+
+arc_err_t ac_log_async_start(void) {
+    pthread_mutex_lock(&s_async_lock);
+    if (atomic_load(&s_async)) {
+        pthread_mutex_unlock(&s_async_lock);
+        return ARC_OK;
+    }
+    s_writer_stop = 0;
+    if (pthread_create(&s_writer, NULL, writer_main, NULL) != 0) {
+        pthread_mutex_unlock(&s_async_lock);
+        return ARC_ERR_BACKEND;
+    }
+    atomic_store(&s_async, 1);
+    pthread_mutex_unlock(&s_async_lock);
+    return ARC_OK;
+}
+
+void ac_log_async_stop(void) {
+    pthread_mutex_lock(&s_async_lock);
+    if (!atomic_load(&s_async)) {
+        pthread_mutex_unlock(&s_async_lock);
+        return;
+    }
+    atomic_store(&s_async, 0);
+
+    pthread_mutex_lock(&s_wake_lock);
+    s_writer_stop = 1;
+    pthread_cond_signal(&s_wake);
+    pthread_mutex_unlock(&s_wake_lock);
+    pthread_join(s_writer, NULL);
+
+    drain_rings();
+    pthread_mutex_unlock(&s_async_lock);
+}
+
+void ac_log_flush(void) {
+    if (!atomic_load_explicit(&s_async, memory_order_acquire)) {
+        return;
+    }
+    pthread_mutex_lock(&s_wake_lock);
+    while (!s_writer_stop && !rings_empty()) {
+        pthread_cond_signal(&s_wake);
+        struct timespec deadline;
+        deadline_in(&deadline, AC_LOG_ASYNC_INTERVAL_MS);
+        pthread_cond_timedwait(&s_drained, &s_wake_lock, &deadline);
+    }
+    pthread_mutex_unlock(&s_wake_lock);
+}
+
+#else /* !ARC_HAS_THREADS */
+
+arc_err_t ac_log_async_start(void) {
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+void ac_log_async_stop(void) {
+}
+
+void ac_log_flush(void) {
+}
+
+#endif /* ARC_HAS_THREADS */
+
 /**
  * @brief Internal log function (thread-safe)
  */
@@ -61,16 +346,16 @@ static void ac_log_internal(
         return;
     }
 
-    // Lock to prevent interleaved output from multiple threads
-    pthread_mutex_lock(&g_log_mutex);
-
-    // Use custom handler if set, otherwise use platform default
-    if (g_log_handler) {
-        g_log_handler(level, file, line, func, fmt, args);
-    } else {
-        ac_log_platform_default_handler(level, file, line, func, fmt, args);
+#ifdef ARC_HAS_THREADS
+    if (atomic_load_explicit(&s_async, memory_order_relaxed) &&
+        async_push(level, file, line, func, fmt, args)) {
+        return;
     }
+#endif
 
+    // Lock to prevent interleaved output from multiple threads
+    pthread_mutex_lock(&g_log_mutex);
+    log_output(level, file, line, func, fmt, args);
     pthread_mutex_unlock(&g_log_mutex);
 }
 
@@ -3,12 +3,20 @@
  * @brief MCP Client Implementation - Public API
  *
  * This file contains the public MCP client API and common protocol logic.
- * Transport-specific implementations are in mcp_http.c and mcp_sse.c.
+ * Transport-specific implementations are in mcp_http.c, mcp_sse.c and
+ * mcp_stdio.c.
  *
  * Protocol Reference: https://modelcontextprotocol.io/
  */
 
 #include "mcp_internal.h"
+#include "arc/tool.h"
+#include "arc/metrics.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include "cjson_arena.h"
+#include "json_scan.h"
+#include "json_writer.h"
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -20,6 +28,8 @@
 __attribute__((weak)) int ac_http_pool_is_initialized(void);
 __attribute__((weak)) arc_http_client_t *ac_http_pool_acquire(uint32_t timeout_ms);
 __attribute__((weak)) void ac_http_pool_release(arc_http_client_t *client);
+__attribute__((weak)) arc_err_t ac_http_pool_add_warm_url(const char *url);
+__attribute__((weak)) arc_http_engine_t *ac_http_pool_engine(void);
 
 /**
  * @brief Check if HTTP pool is available and initialized
@@ -28,26 +38,67 @@ static int http_pool_available(void) {
     return ac_http_pool_is_initialized && ac_http_pool_is_initialized();
 }
 
+arc_http_client_t *mcp_http_borrow(mcp_transport_t *t, arc_http_client_t *own) {
+    if (!t->pooled) {
+        return own;
+    }
+    arc_http_client_t *http = ac_http_pool_acquire(t->timeout_ms);
+    if (!http) {
+        AC_LOG_WARN("MCP: no pooled HTTP client within %ums", t->timeout_ms);
+    }
+    return http;
+}
+
+void mcp_http_return(mcp_transport_t *t, arc_http_client_t *http) {
+    if (t->pooled && http) {
+        ac_http_pool_release(http);
+    }
+}
+
+arc_http_engine_t *mcp_http_engine(mcp_transport_t *t) {
+    if (!t->pooled || !ac_http_pool_engine) {
+        return NULL;
+    }
+    return ac_http_pool_engine();
+}
+
 /*============================================================================
  * Session API (External)
  *============================================================================*/
 
 extern arena_t *ac_session_get_arena(ac_session_t *session);
 extern arc_err_t ac_session_add_mcp(ac_session_t *session, ac_mcp_client_t *client);
+extern void ac_session_arena_lock(ac_session_t *session);
+extern void ac_session_arena_unlock(ac_session_t *session);
 
 /*============================================================================
- * Tool Info Structure
+ * MCP Client Structure
  *============================================================================*/
 
-typedef struct {
-    char *name;
-    char *description;
-    char *parameters;  /* JSON Schema string */
-} mcp_tool_info_t;
+/**
+ * @brief One RPC waiting to be sent or answered (lives on the caller's stack)
+ */
+typedef struct mcp_call {
+    char *request_json;
+    int request_id;
+    char *response_json;             /* Set when done */
+    arc_err_t err;
+    int done;
+    pthread_cond_t cond;             /* Done, or this caller should send */
+    struct mcp_call *next;           /* Send queue */
+    const volatile int *cancel;      /* Caller gives up once *cancel != 0 (may be NULL) */
+    uint64_t deadline_ms;            /* Absolute, 0 = none */
+} mcp_call_t;
 
-/*============================================================================
- * MCP Client Structure
- *============================================================================*/
+/**
+ * @brief A call that asked for progress (lives on the caller's stack)
+ */
+typedef struct mcp_progress {
+    int token;                       /* progressToken sent with the call */
+    ac_mcp_progress_fn fn;
+    void *user_data;
+    struct mcp_progress *next;
+} mcp_progress_t;
 
 struct ac_mcp_client {
     ac_session_t *session;
@@ -62,6 +113,22 @@ struct ac_mcp_client {
     /* Request ID counter */
     int request_id;
 
+    /* Guards request_id and the send queue. Calls from parallel tool
+     * workers queue up while a batch is in flight and go out together
+     * in the next one, one transport exchange for all of them. */
+    pthread_mutex_t rpc_lock;
+    mcp_call_t *send_head;
+    mcp_call_t **send_tail;
+    int sending;                     /* A caller is sending a batch */
+    int batch_refused;               /* Server rejected a batch: send singly */
+
+    /* Calls waiting for notifications/progress. Notifications arrive on
+     * transport threads; the callback runs under progress_lock so its
+     * call cannot return (and unregister) meanwhile. */
+    pthread_mutex_t progress_lock;
+    mcp_progress_t *progress;
+    int progress_token;
+
     /* Client info */
     char *client_name;
     char *client_version;
@@ -69,10 +136,22 @@ struct ac_mcp_client {
     /* Server info (from initialize) */
     ac_mcp_server_info_t server_info;
 
-    /* Tool cache */
+    /* Tool list (session arena; old lists stay there) */
     mcp_tool_info_t *tools;
     size_t tool_count;
-    size_t tool_capacity;
+    unsigned tools_generation;       /* Bumped when the list is replaced */
+    char *tools_cache_dir;           /* On-disk tools/list cache (NULL = off) */
+
+    /* Background revalidation of a cached list. A changed list waits here
+     * (under rpc_lock) until ac_mcp_tools_refresh() installs it, so the
+     * registry only changes under its write lock. */
+    mcp_tool_info_t *pending_tools;
+    size_t pending_count;
+    int has_pending;
+#ifdef ARC_HAS_THREADS
+    pthread_t revalidate_thread;
+    int revalidating;                /* revalidate_thread must be joined */
+#endif
 };
 
 /*============================================================================
@@ -125,13 +204,21 @@ static char *mcp_build_request(ac_mcp_client_t *client, const char *method, cJSO
  * JSON-RPC: Build Notification (no id field, no response expected)
  *============================================================================*/
 
-static char *mcp_build_notification(const char *method) {
+/**
+ * @param params  Taken over (NULL = omitted, as for initialized)
+ */
+static char *mcp_build_notification(const char *method, cJSON *params) {
     cJSON *notification = cJSON_CreateObject();
-    if (!notification) return NULL;
+    if (!notification) {
+        if (params) cJSON_Delete(params);
+        return NULL;
+    }
 
     cJSON_AddStringToObject(notification, "jsonrpc", "2.0");
     cJSON_AddStringToObject(notification, "method", method);
-    /* Notifications have no id field and no params for initialized */
+    if (params) {
+        cJSON_AddItemToObject(notification, "params", params);
+    }
 
     char *json = cJSON_PrintUnformatted(notification);
     cJSON_Delete(notification);
@@ -143,12 +230,16 @@ static char *mcp_build_notification(const char *method) {
  * JSON-RPC: Parse Response
  *============================================================================*/
 
+/**
+ * @brief Parse a response, into @p scope's arena when given
+ */
 static arc_err_t mcp_parse_response(
     ac_mcp_client_t *client,
     const char *response_json,
+    ac_cjson_scope_t *scope,
     cJSON **result_out
 ) {
-    cJSON *json = cJSON_Parse(response_json);
+    cJSON *json = ac_cjson_scope_parse(scope, response_json, strlen(response_json));
     if (!json) {
         AC_LOG_ERROR("MCP: Failed to parse response JSON");
         return ARC_ERR_PROTOCOL;
@@ -179,43 +270,317 @@ static arc_err_t mcp_parse_response(
     return ARC_OK;
 }
 
+/*============================================================================
+ * Server Notifications
+ *============================================================================*/
+
+/**
+ * @brief Read a number span as double
+ */
+static int mcp_scan_double(ac_json_span_t value, double *out) {
+    if (value.kind != AC_JSON_NUMBER) {
+        return 0;
+    }
+    *out = strtod(value.start, NULL);
+    return 1;
+}
+
+/**
+ * @brief Transport callback: route notifications/progress to its call
+ */
+static void mcp_on_notify(void *ctx, const char *json, size_t len) {
+    ac_mcp_client_t *client = (ac_mcp_client_t *)ctx;
+
+    ac_json_span_t root = ac_json_scan_root(json, len);
+    if (!ac_json_scan_str_eq(ac_json_scan_get(root, "method"), "notifications/progress")) {
+        AC_LOG_DEBUG("MCP: notification ignored: %.*s", (int)(len > 80 ? 80 : len), json);
+        return;
+    }
+
+    ac_json_span_t params = ac_json_scan_get(root, "params");
+    int token = 0;
+    if (!ac_json_scan_int(ac_json_scan_get(params, "progressToken"), &token)) {
+        return;
+    }
+
+    ac_mcp_progress_t progress = { 0 };
+    mcp_scan_double(ac_json_scan_get(params, "progress"), &progress.progress);
+    mcp_scan_double(ac_json_scan_get(params, "total"), &progress.total);
+    char *message = ac_json_scan_strdup(ac_json_scan_get(params, "message"));
+    if (message) {
+        progress.message = message;
+        progress.message_len = strlen(message);
+    }
+
+    pthread_mutex_lock(&client->progress_lock);
+    mcp_progress_t *p = client->progress;
+    while (p && p->token != token) {
+        p = p->next;
+    }
+    if (p) {
+        p->fn(&progress, p->user_data);
+    }
+    pthread_mutex_unlock(&client->progress_lock);
+
+    if (!p) {
+        AC_LOG_DEBUG("MCP: progress for finished call (token=%d) dropped", token);
+    }
+    if (message) ARC_FREE(message);
+}
+
+/**
+ * @brief Register a call for progress, returning its token
+ */
+static int mcp_progress_begin(ac_mcp_client_t *client, mcp_progress_t *p) {
+    pthread_mutex_lock(&client->progress_lock);
+    p->token = ++client->progress_token;
+    p->next = client->progress;
+    client->progress = p;
+    client->transport->progress_calls++;
+    pthread_mutex_unlock(&client->progress_lock);
+    return p->token;
+}
+
+static void mcp_progress_end(ac_mcp_client_t *client, mcp_progress_t *p) {
+    pthread_mutex_lock(&client->progress_lock);
+    mcp_progress_t **link = &client->progress;
+    while (*link && *link != p) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = p->next;
+    }
+    client->transport->progress_calls--;
+    pthread_mutex_unlock(&client->progress_lock);
+}
+
 /*============================================================================
  * MCP RPC Call (Uses Transport)
  *============================================================================*/
 
-static arc_err_t mcp_rpc_call(
+/**
+ * @brief ARC_ERR_CANCELLED / ARC_ERR_TIMEOUT once the caller gave up, else ARC_OK
+ */
+static arc_err_t mcp_call_limit(const mcp_call_t *call) {
+    if (call->cancel && *call->cancel) {
+        return ARC_ERR_CANCELLED;
+    }
+    if (call->deadline_ms && ac_platform_timestamp_ms() >= call->deadline_ms) {
+        return ARC_ERR_TIMEOUT;
+    }
+    return ARC_OK;
+}
+
+/**
+ * @brief Tell the server to stop working on an abandoned request
+ *
+ * Best effort with a short budget: the caller is already giving up.
+ */
+static void mcp_notify_cancelled(mcp_transport_t *t, int request_id, arc_err_t reason) {
+    cJSON *params = cJSON_CreateObject();
+    if (!params) {
+        return;
+    }
+    cJSON_AddNumberToObject(params, "requestId", request_id);
+    cJSON_AddStringToObject(params, "reason",
+                            reason == ARC_ERR_CANCELLED ? "Cancelled by client" : "Timed out");
+    char *json = mcp_build_notification("notifications/cancelled", params);
+    if (!json) {
+        return;
+    }
+
+    t->deadline_ms = ac_platform_timestamp_ms() + MCP_CANCEL_NOTIFY_MS;
+    char *response = NULL;
+    t->ops->request(t, json, 0, &response);
+    t->deadline_ms = 0;
+    ARC_FREE(response);
+    ARC_FREE(json);
+}
+
+/**
+ * @brief Exchange a batch of calls over the transport (rpc_lock not held)
+ *
+ * Calls sent singly honour their cancel flag and deadline in flight; a
+ * batch runs under the transport timeout only.
+ */
+static void mcp_send_calls(ac_mcp_client_t *client, mcp_call_t **calls, size_t count) {
+    mcp_transport_t *t = client->transport;
+
+    if (count > 1 && t->ops->request_batch && !client->batch_refused) {
+        const char *requests[MCP_MAX_BATCH];
+        int ids[MCP_MAX_BATCH];
+        char *responses[MCP_MAX_BATCH];
+        for (size_t i = 0; i < count; i++) {
+            requests[i] = calls[i]->request_json;
+            ids[i] = calls[i]->request_id;
+            responses[i] = NULL;
+        }
+
+        AC_LOG_DEBUG("MCP: sending %zu requests as one batch", count);
+        arc_err_t err = t->ops->request_batch(t, requests, ids, count, responses);
+        if (err != ARC_ERR_NOT_IMPLEMENTED) {
+            for (size_t i = 0; i < count; i++) {
+                calls[i]->err = err;
+                calls[i]->response_json = responses[i];
+            }
+            return;
+        }
+
+        AC_LOG_INFO("MCP: server does not accept batches, sending requests singly");
+        client->batch_refused = 1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        mcp_call_t *call = calls[i];
+        call->err = mcp_call_limit(call);
+        if (call->err != ARC_OK) {
+            continue;
+        }
+
+        t->cancel = call->cancel;
+        t->deadline_ms = call->deadline_ms;
+        call->err = t->ops->request(t, call->request_json, call->request_id,
+                                    &call->response_json);
+        t->cancel = NULL;
+        t->deadline_ms = 0;
+
+        arc_err_t limit = mcp_call_limit(call);
+        if (call->err != ARC_OK && limit != ARC_OK) {
+            call->err = limit;
+            mcp_notify_cancelled(t, call->request_id, limit);
+        }
+    }
+}
+
+/**
+ * @brief Take a call that is still queued off the send queue
+ *
+ * @return 0 if it is not queued (being sent, or sent)
+ */
+static int mcp_unqueue(ac_mcp_client_t *client, mcp_call_t *call) {
+    for (mcp_call_t **link = &client->send_head; *link; link = &(*link)->next) {
+        if (*link == call) {
+            *link = call->next;
+            if (!*link) {
+                client->send_tail = link;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Queue a call and wait for its response
+ *
+ * Whoever finds no batch in flight sends everything queued so far; the
+ * others wait and are either answered by that batch or handed the next
+ * turn. Caller holds rpc_lock.
+ */
+static void mcp_dispatch(ac_mcp_client_t *client, mcp_call_t *call) {
+    *client->send_tail = call;
+    client->send_tail = &call->next;
+
+    while (!call->done) {
+        if (client->sending && !call->cancel && !call->deadline_ms) {
+            pthread_cond_wait(&call->cond, &client->rpc_lock);
+            continue;
+        }
+        if (client->sending) {
+            /* Limited: leave the queue if the caller gives up first */
+            arc_err_t limit = mcp_call_limit(call);
+            if (limit != ARC_OK && mcp_unqueue(client, call)) {
+                call->err = limit;
+                return;
+            }
+            struct timespec tick;
+            clock_gettime(CLOCK_REALTIME, &tick);
+            tick.tv_nsec += MCP_CANCEL_POLL_MS * 1000000L;
+            if (tick.tv_nsec >= 1000000000L) {
+                tick.tv_sec++;
+                tick.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&call->cond, &client->rpc_lock, &tick);
+            continue;
+        }
+
+        /* Take up to MCP_MAX_BATCH queued calls */
+        mcp_call_t *batch[MCP_MAX_BATCH];
+        size_t count = 0;
+        while (client->send_head && count < MCP_MAX_BATCH) {
+            batch[count++] = client->send_head;
+            client->send_head = client->send_head->next;
+        }
+        if (!client->send_head) {
+            client->send_tail = &client->send_head;
+        }
+        client->sending = 1;
+
+        pthread_mutex_unlock(&client->rpc_lock);
+        mcp_send_calls(client, batch, count);
+        pthread_mutex_lock(&client->rpc_lock);
+
+        client->sending = 0;
+        for (size_t i = 0; i < count; i++) {
+            batch[i]->done = 1;
+            pthread_cond_signal(&batch[i]->cond);
+        }
+        /* Hand the next turn to the first caller still queued */
+        if (client->send_head) {
+            pthread_cond_signal(&client->send_head->cond);
+        }
+    }
+}
+
+/**
+ * @brief Send a request and parse the result (scope: see mcp_parse_response)
+ *
+ * @param cancel       Give up once *cancel != 0 (NULL = never)
+ * @param deadline_ms  Give up at this time (0 = transport timeout only)
+ */
+static arc_err_t mcp_rpc_call_limited(
     ac_mcp_client_t *client,
     const char *method,
     cJSON *params,
-    cJSON **result_out
+    ac_cjson_scope_t *scope,
+    cJSON **result_out,
+    const volatile int *cancel,
+    uint64_t deadline_ms
 ) {
     if (!client || !client->transport || !method) {
         if (params) cJSON_Delete(params);
         return ARC_ERR_INVALID_ARG;
     }
 
+    pthread_mutex_lock(&client->rpc_lock);
+
     /* Build request */
-    char *request_json = mcp_build_request(client, method, params);
-    if (!request_json) {
+    mcp_call_t call = { 0 };
+    call.cancel = cancel;
+    call.deadline_ms = deadline_ms;
+    call.request_json = mcp_build_request(client, method, params);
+    if (!call.request_json) {
+        pthread_mutex_unlock(&client->rpc_lock);
         AC_LOG_ERROR("MCP: Failed to build request");
         return ARC_ERR_MEMORY;
     }
+    call.request_id = client->request_id;
+    AC_LOG_DEBUG("MCP request: %s (id=%d) -> %s", method, call.request_id, call.request_json);
 
-    AC_LOG_DEBUG("MCP request: %s (id=%d) -> %s", method, client->request_id, request_json);
+    /* Send via transport, possibly batched with concurrent calls */
+    pthread_cond_init(&call.cond, NULL);
+    mcp_dispatch(client, &call);
+    pthread_mutex_unlock(&client->rpc_lock);
+    pthread_cond_destroy(&call.cond);
 
-    /* Send via transport */
-    char *response_json = NULL;
-    arc_err_t err = client->transport->ops->request(
-        client->transport,
-        request_json,
-        client->request_id,
-        &response_json
-    );
+    ARC_FREE(call.request_json);
 
-    ARC_FREE(request_json);
+    arc_err_t err = call.err;
+    char *response_json = call.response_json;
 
     if (err != ARC_OK) {
         AC_LOG_ERROR("MCP: Transport error: %s", client->transport->error_msg);
+        if (response_json) ARC_FREE(response_json);
         return err;
     }
 
@@ -228,12 +593,22 @@ static arc_err_t mcp_rpc_call(
                  response_json, strlen(response_json) > 500 ? "..." : "");
 
     /* Parse response */
-    err = mcp_parse_response(client, response_json, result_out);
+    err = mcp_parse_response(client, response_json, scope, result_out);
     ARC_FREE(response_json);
 
     return err;
 }
 
+static arc_err_t mcp_rpc_call(
+    ac_mcp_client_t *client,
+    const char *method,
+    cJSON *params,
+    ac_cjson_scope_t *scope,
+    cJSON **result_out
+) {
+    return mcp_rpc_call_limited(client, method, params, scope, result_out, NULL, 0);
+}
+
 /*============================================================================
  * Client Creation
  *============================================================================*/
@@ -242,7 +617,7 @@ ac_mcp_client_t *ac_mcp_create(
     ac_session_t *session,
     const ac_mcp_config_t *config
 ) {
-    if (!session || !config || !config->server_url) {
+    if (!session || !config || (!config->server_url && !config->command)) {
         AC_LOG_ERROR("Invalid MCP configuration");
         return NULL;
     }
@@ -262,22 +637,82 @@ ac_mcp_client_t *ac_mcp_create(
 
     memset(client, 0, sizeof(*client));
 
+    if (pthread_mutex_init(&client->rpc_lock, NULL) != 0) {
+        AC_LOG_ERROR("Failed to initialize MCP client lock");
+        return NULL;
+    }
+    if (pthread_mutex_init(&client->progress_lock, NULL) != 0) {
+        AC_LOG_ERROR("Failed to initialize MCP client lock");
+        pthread_mutex_destroy(&client->rpc_lock);
+        return NULL;
+    }
+    client->send_tail = &client->send_head;
+
     client->session = session;
     client->arena = arena;
     client->client_name = arena_strdup(arena, config->client_name ? config->client_name : "ArC");
     client->client_version = arena_strdup(arena, config->client_version ? config->client_version : "1.0.0");
+    client->tools_cache_dir = config->tools_cache_dir ?
+        arena_strdup(arena, config->tools_cache_dir) : NULL;
+
+    /* Local server process: no HTTP client involved */
+    if (config->command) {
+#if ARC_FEATURE_MCP_STDIO
+        client->transport = mcp_stdio_create(arena, config);
+#else
+        AC_LOG_ERROR("MCP stdio transport not built (ARC_FEATURE_MCP_STDIO)");
+#endif
+        if (!client->transport) {
+            AC_LOG_ERROR("Failed to create transport");
+            return NULL;
+        }
+        client->transport->on_notify = mcp_on_notify;
+        client->transport->notify_ctx = client;
 
-    /* Get HTTP client: from pool or create new */
+        if (ac_session_add_mcp(session, client) != ARC_OK) {
+            AC_LOG_ERROR("Failed to register MCP client with session");
+            client->transport->ops->destroy(client->transport);
+            return NULL;
+        }
+
+        AC_LOG_INFO("MCP client created: %s (transport: stdio)",
+                    client->transport->server_url);
+        return client;
+    }
+
+    /*
+     * Get HTTP client: from pool or create new.
+     *
+     * With the pool, Streamable HTTP holds no client at all: every POST
+     * borrows one, so many servers behind one gateway share the pool's
+     * warm connections instead of pinning a slot each. SSE runs its
+     * long-lived event stream on the pool's engine, and only pins a
+     * client for it when the pool has no engine; its POSTs borrow too.
+     */
     arc_http_client_t *http = NULL;
+    int use_sse = is_sse_url(config->server_url);
+    int pooled = http_pool_available();
 
-    if (http_pool_available()) {
-        /* Acquire from pool */
-        http = ac_http_pool_acquire(config->timeout_ms ? config->timeout_ms : MCP_DEFAULT_TIMEOUT_MS);
-        if (!http) {
-            AC_LOG_ERROR("Failed to acquire HTTP client from pool");
-            return NULL;
+    if (use_sse ? !ARC_FEATURE_MCP_SSE : !ARC_FEATURE_MCP_HTTP) {
+        AC_LOG_ERROR("MCP %s transport not built (ARC_FEATURE_MCP_%s)",
+                     use_sse ? "SSE" : "HTTP", use_sse ? "SSE" : "HTTP");
+        return NULL;
+    }
+
+    if (pooled) {
+        if (use_sse && !(ac_http_pool_engine && ac_http_pool_engine())) {
+            http = ac_http_pool_acquire(config->timeout_ms ? config->timeout_ms : MCP_DEFAULT_TIMEOUT_MS);
+            if (!http) {
+                AC_LOG_ERROR("Failed to acquire HTTP client from pool");
+                return NULL;
+            }
         }
         client->owns_http = 0;
+
+        /* Same keepalive / pre-warm policy as the LLM endpoints */
+        if (ac_http_pool_add_warm_url) {
+            ac_http_pool_add_warm_url(config->server_url);
+        }
         AC_LOG_DEBUG("MCP client using HTTP pool");
     } else {
         /* Create own HTTP client */
@@ -295,42 +730,36 @@ ac_mcp_client_t *ac_mcp_create(
     }
 
     /* Create transport based on URL */
-    int use_sse = is_sse_url(config->server_url);
+#if ARC_FEATURE_MCP_SSE
     if (use_sse) {
-        client->transport = mcp_sse_create(arena, http, config);
-    } else {
-        client->transport = mcp_http_create(arena, http, config);
+        client->transport = mcp_sse_create(arena, http, pooled, config);
+    }
+#endif
+#if ARC_FEATURE_MCP_HTTP
+    if (!use_sse) {
+        client->transport = mcp_http_create(arena, http, pooled, config);
     }
+#endif
 
     if (!client->transport) {
         AC_LOG_ERROR("Failed to create transport");
         if (client->owns_http) {
             arc_http_client_destroy(http);
-        } else {
-            ac_http_pool_release(http);
-        }
-        return NULL;
-    }
-
-    /* Allocate tool array */
-    client->tool_capacity = MCP_INITIAL_TOOL_CAP;
-    client->tools = (mcp_tool_info_t *)arena_alloc(arena, sizeof(mcp_tool_info_t) * client->tool_capacity);
-    if (!client->tools) {
-        AC_LOG_ERROR("Failed to allocate tool array");
-        if (client->owns_http) {
-            arc_http_client_destroy(http);
-        } else {
+        } else if (http) {
             ac_http_pool_release(http);
         }
         return NULL;
     }
+    client->transport->on_notify = mcp_on_notify;
+    client->transport->notify_ctx = client;
 
     /* Register with session */
     if (ac_session_add_mcp(session, client) != ARC_OK) {
         AC_LOG_ERROR("Failed to register MCP client with session");
+        client->transport->ops->destroy(client->transport);
         if (client->owns_http) {
             arc_http_client_destroy(http);
-        } else {
+        } else if (http) {
             ac_http_pool_release(http);
         }
         return NULL;
@@ -376,15 +805,17 @@ arc_err_t ac_mcp_connect(ac_mcp_client_t *client) {
     cJSON_AddItemToObject(params, "clientInfo", client_info);
 
     cJSON *result = NULL;
-    err = mcp_rpc_call(client, "initialize", params, &result);
+    err = mcp_rpc_call(client, "initialize", params, NULL, &result);
 
     if (err != ARC_OK) {
         client->transport->ops->disconnect(client->transport);
         return err;
     }
 
-    /* Parse server info */
+    /* Parse server info (session arena: connect may run on a worker) */
     if (result) {
+        ac_session_arena_lock(client->session);
+
         cJSON *protocol = cJSON_GetObjectItem(result, "protocolVersion");
         if (protocol && cJSON_IsString(protocol)) {
             client->server_info.protocol_version = arena_strdup(
@@ -404,13 +835,15 @@ arc_err_t ac_mcp_connect(ac_mcp_client_t *client) {
                 client->server_info.version = arena_strdup(client->arena, cJSON_GetStringValue(version));
             }
         }
+
+        ac_session_arena_unlock(client->session);
         cJSON_Delete(result);
     }
 
     /* Send initialized notification (no id, no response expected)
      * Per MCP spec, this notification is REQUIRED after initialize succeeds.
      * Some servers (like 12306-mcp) may reject subsequent requests without it. */
-    char *notif_json = mcp_build_notification("notifications/initialized");
+    char *notif_json = mcp_build_notification("notifications/initialized", NULL);
     if (notif_json) {
         AC_LOG_DEBUG("MCP sending: notifications/initialized -> %s", notif_json);
         char *response = NULL;
@@ -458,53 +891,52 @@ void ac_mcp_disconnect(ac_mcp_client_t *client) {
  * Tool Discovery
  *============================================================================*/
 
-arc_err_t ac_mcp_discover_tools(ac_mcp_client_t *client) {
-    if (!client) {
-        return ARC_ERR_INVALID_ARG;
-    }
-
-    if (!ac_mcp_is_connected(client)) {
-        AC_LOG_ERROR("MCP: Not connected");
-        return ARC_ERR_NOT_CONNECTED;
-    }
-
-    AC_LOG_INFO("MCP discovering tools...");
-
+/**
+ * @brief Run tools/list into a fresh list in the session arena
+ */
+static arc_err_t mcp_fetch_tools(ac_mcp_client_t *client,
+                                 mcp_tool_info_t **tools_out, size_t *count_out) {
+    /* Result tree is parse-then-discard: keep it in a scratch arena */
     cJSON *result = NULL;
-    arc_err_t err = mcp_rpc_call(client, "tools/list", NULL, &result);
+    ac_cjson_scope_t scope;
+    ac_cjson_scope_begin(&scope, NULL);
+    arc_err_t err = mcp_rpc_call(client, "tools/list", NULL, &scope, &result);
 
     if (err != ARC_OK) {
+        ac_cjson_scope_end(&scope);
         return err;
     }
 
-    /* Clear existing */
-    client->tool_count = 0;
+    *tools_out = NULL;
+    *count_out = 0;
 
     /* Parse tools array */
     cJSON *tools = cJSON_GetObjectItem(result, "tools");
     if (!tools || !cJSON_IsArray(tools)) {
         AC_LOG_WARN("No tools array in response");
         cJSON_Delete(result);
+        ac_cjson_scope_end(&scope);
         return ARC_OK;
     }
 
     int array_size = cJSON_GetArraySize(tools);
 
-    /* Grow if needed */
-    if ((size_t)array_size > client->tool_capacity) {
-        size_t new_cap = array_size + MCP_INITIAL_TOOL_CAP;
-        mcp_tool_info_t *new_tools = (mcp_tool_info_t *)arena_alloc(
-            client->arena, sizeof(mcp_tool_info_t) * new_cap
-        );
-        if (!new_tools) {
-            AC_LOG_ERROR("Failed to allocate tool array");
-            cJSON_Delete(result);
-            return ARC_ERR_MEMORY;
-        }
-        client->tools = new_tools;
-        client->tool_capacity = new_cap;
+    /* Session arena: discovery may run on a worker */
+    ac_session_arena_lock(client->session);
+
+    mcp_tool_info_t *list = (mcp_tool_info_t *)arena_alloc(
+        client->arena, sizeof(mcp_tool_info_t) * (array_size > 0 ? (size_t)array_size : 1)
+    );
+    if (!list) {
+        AC_LOG_ERROR("Failed to allocate tool array");
+        ac_session_arena_unlock(client->session);
+        cJSON_Delete(result);
+        ac_cjson_scope_end(&scope);
+        return ARC_ERR_MEMORY;
     }
 
+    size_t count = 0;
+
     /* Parse each tool */
     cJSON *tool_json;
     cJSON_ArrayForEach(tool_json, tools) {
@@ -513,17 +945,29 @@ arc_err_t ac_mcp_discover_tools(ac_mcp_client_t *client) {
         cJSON *name = cJSON_GetObjectItem(tool_json, "name");
         cJSON *description = cJSON_GetObjectItem(tool_json, "description");
         cJSON *input_schema = cJSON_GetObjectItem(tool_json, "inputSchema");
+        cJSON *annotations = cJSON_GetObjectItem(tool_json, "annotations");
 
         if (!name || !cJSON_IsString(name)) {
             AC_LOG_WARN("Tool missing name, skipping");
             continue;
         }
 
-        mcp_tool_info_t *tool = &client->tools[client->tool_count];
+        mcp_tool_info_t *tool = &list[count];
 
         tool->name = arena_strdup(client->arena, cJSON_GetStringValue(name));
         tool->description = description && cJSON_IsString(description) ?
             arena_strdup(client->arena, cJSON_GetStringValue(description)) : NULL;
+        tool->parameters = NULL;
+        tool->hints = 0;
+
+        if (annotations && cJSON_IsObject(annotations)) {
+            if (cJSON_IsTrue(cJSON_GetObjectItem(annotations, "readOnlyHint"))) {
+                tool->hints |= AC_MCP_TOOL_READ_ONLY;
+            }
+            if (cJSON_IsTrue(cJSON_GetObjectItem(annotations, "idempotentHint"))) {
+                tool->hints |= AC_MCP_TOOL_IDEMPOTENT;
+            }
+        }
 
         if (input_schema) {
             char *schema_str = cJSON_PrintUnformatted(input_schema);
@@ -537,16 +981,201 @@ arc_err_t ac_mcp_discover_tools(ac_mcp_client_t *client) {
 
         if (!tool->name) continue;
 
-        client->tool_count++;
+        count++;
         AC_LOG_DEBUG("Discovered tool: %s", tool->name);
     }
 
+    ac_session_arena_unlock(client->session);
     cJSON_Delete(result);
+    ac_cjson_scope_end(&scope);
 
-    AC_LOG_INFO("MCP discovered %zu tools", client->tool_count);
+    *tools_out = list;
+    *count_out = count;
     return ARC_OK;
 }
 
+static int mcp_str_equal(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static int mcp_tools_equal(const mcp_tool_info_t *a, size_t a_count,
+                           const mcp_tool_info_t *b, size_t b_count) {
+    if (a_count != b_count) {
+        return 0;
+    }
+    for (size_t i = 0; i < a_count; i++) {
+        if (!mcp_str_equal(a[i].name, b[i].name) ||
+            !mcp_str_equal(a[i].description, b[i].description) ||
+            !mcp_str_equal(a[i].parameters, b[i].parameters) ||
+            a[i].hints != b[i].hints) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void mcp_cache_save(ac_mcp_client_t *client,
+                           const mcp_tool_info_t *tools, size_t count) {
+    if (client->tools_cache_dir) {
+        mcp_cache_store(client->tools_cache_dir, client->transport->server_url,
+                        &client->server_info, tools, count);
+    }
+}
+
+arc_err_t ac_mcp_discover_tools(ac_mcp_client_t *client) {
+    if (!client) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    if (!ac_mcp_is_connected(client)) {
+        AC_LOG_ERROR("MCP: Not connected");
+        return ARC_ERR_NOT_CONNECTED;
+    }
+
+    AC_LOG_INFO("MCP discovering tools...");
+
+    mcp_tool_info_t *tools = NULL;
+    size_t count = 0;
+    arc_err_t err = mcp_fetch_tools(client, &tools, &count);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    pthread_mutex_lock(&client->rpc_lock);
+    client->tools = tools;
+    client->tool_count = count;
+    client->tools_generation++;
+    pthread_mutex_unlock(&client->rpc_lock);
+
+    mcp_cache_save(client, tools, count);
+
+    AC_LOG_INFO("MCP discovered %zu tools", count);
+    return ARC_OK;
+}
+
+/**
+ * @brief Use the on-disk list if it matches this server
+ *
+ * @return 1 if the tools came from the cache
+ */
+static int mcp_load_cached_tools(ac_mcp_client_t *client) {
+    if (!client->tools_cache_dir || !ac_mcp_is_connected(client)) {
+        return 0;
+    }
+
+    mcp_tool_info_t *tools = NULL;
+    size_t count = 0;
+
+    ac_session_arena_lock(client->session);
+    arc_err_t err = mcp_cache_load(client->tools_cache_dir, client->transport->server_url,
+                                   &client->server_info, client->arena, &tools, &count);
+    ac_session_arena_unlock(client->session);
+
+    if (err != ARC_OK) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&client->rpc_lock);
+    client->tools = tools;
+    client->tool_count = count;
+    client->tools_generation++;
+    pthread_mutex_unlock(&client->rpc_lock);
+
+    AC_LOG_INFO("MCP %s: %zu tools from cache", client->transport->server_url, count);
+    return 1;
+}
+
+/**
+ * @brief Compare the cached list with tools/list; stage it if it changed
+ */
+static void mcp_revalidate(ac_mcp_client_t *client) {
+    uint64_t start = ac_platform_timestamp_ms();
+
+    mcp_tool_info_t *tools = NULL;
+    size_t count = 0;
+    arc_err_t err = mcp_fetch_tools(client, &tools, &count);
+    if (err != ARC_OK) {
+        AC_LOG_WARN("MCP %s: revalidating cached tools failed: %s (keeping cached list)",
+                    client->transport->server_url, ac_strerror(err));
+        return;
+    }
+
+    /* Nothing else replaces client->tools while a revalidation runs */
+    if (mcp_tools_equal(client->tools, client->tool_count, tools, count)) {
+        AC_LOG_DEBUG("MCP %s: cached tools are current (%u ms)",
+                     client->transport->server_url,
+                     (unsigned)(ac_platform_timestamp_ms() - start));
+        return;
+    }
+
+    pthread_mutex_lock(&client->rpc_lock);
+    client->pending_tools = tools;
+    client->pending_count = count;
+    client->has_pending = 1;
+    pthread_mutex_unlock(&client->rpc_lock);
+
+    mcp_cache_save(client, tools, count);
+
+    AC_LOG_INFO("MCP %s: tool list changed (%zu -> %zu tools, %u ms)",
+                client->transport->server_url, client->tool_count, count,
+                (unsigned)(ac_platform_timestamp_ms() - start));
+}
+
+#ifdef ARC_HAS_THREADS
+static void *mcp_revalidate_thread(void *arg) {
+    mcp_revalidate((ac_mcp_client_t *)arg);
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Revalidate a cached list in the background (inline without threads)
+ */
+static void mcp_revalidate_start(ac_mcp_client_t *client) {
+#ifdef ARC_HAS_THREADS
+    if (!client->revalidating) {
+        client->revalidating = pthread_create(&client->revalidate_thread, NULL,
+                                              mcp_revalidate_thread, client) == 0;
+        if (client->revalidating) {
+            return;
+        }
+    }
+#endif
+    mcp_revalidate(client);
+}
+
+arc_err_t ac_mcp_discover_tools_cached(ac_mcp_client_t *client) {
+    if (!client) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    if (mcp_load_cached_tools(client)) {
+        mcp_revalidate_start(client);
+        return ARC_OK;
+    }
+    return ac_mcp_discover_tools(client);
+}
+
+unsigned ac_mcp_tools_refresh(ac_mcp_client_t *client) {
+    if (!client) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&client->rpc_lock);
+    if (client->has_pending) {
+        client->tools = client->pending_tools;
+        client->tool_count = client->pending_count;
+        client->tools_generation++;
+        client->pending_tools = NULL;
+        client->pending_count = 0;
+        client->has_pending = 0;
+    }
+    unsigned generation = client->tools_generation;
+    pthread_mutex_unlock(&client->rpc_lock);
+
+    return generation;
+}
+
 size_t ac_mcp_tool_count(const ac_mcp_client_t *client) {
     return client ? client->tool_count : 0;
 }
@@ -555,20 +1184,145 @@ size_t ac_mcp_tool_count(const ac_mcp_client_t *client) {
  * Tool Execution
  *============================================================================*/
 
+/**
+ * @brief Result string in the caller's sink (arena, else heap)
+ */
+static char *mcp_result_dup(const ac_mcp_call_opts_t *opts, const char *json) {
+    return opts->arena ? arena_strdup(opts->arena, json) : ARC_STRDUP(json);
+}
+
+static int mcp_is_text_item(const cJSON *item) {
+    cJSON *type = cJSON_GetObjectItem(item, "type");
+    cJSON *text = cJSON_GetObjectItem(item, "text");
+    return type && cJSON_IsString(type) &&
+           strcmp(cJSON_GetStringValue(type), "text") == 0 &&
+           text && cJSON_IsString(text);
+}
+
+/**
+ * @brief Write the text items to opts->result_path, newline separated
+ */
+static arc_err_t mcp_result_to_file(
+    const cJSON *content,
+    const ac_mcp_call_opts_t *opts,
+    char **result_out
+) {
+    FILE *f = fopen(opts->result_path, "wb");
+    if (!f) {
+        AC_LOG_ERROR("MCP: cannot open result file %s", opts->result_path);
+        return ARC_ERR_IO;
+    }
+
+    size_t bytes = 0;
+    int ok = 1;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, content) {
+        if (!mcp_is_text_item(item)) {
+            continue;
+        }
+        const char *text = cJSON_GetStringValue(cJSON_GetObjectItem(item, "text"));
+        size_t len = strlen(text);
+        if (bytes > 0) {
+            ok = ok && fputc('\n', f) != EOF;
+            bytes++;
+        }
+        ok = ok && fwrite(text, 1, len, f) == len;
+        bytes += len;
+    }
+    if (fclose(f) != 0 || !ok) {
+        AC_LOG_ERROR("MCP: failed to write result file %s", opts->result_path);
+        return ARC_ERR_IO;
+    }
+
+    ac_json_writer_t w;
+    ac_json_writer_init(&w, opts->arena);
+    ac_json_write_object_begin(&w);
+    ac_json_write_member_string(&w, "result_file", opts->result_path);
+    ac_json_write_member_int(&w, "bytes", (long long)bytes);
+    ac_json_write_object_end(&w);
+    *result_out = ac_json_writer_take(&w);
+    return *result_out ? ARC_OK : ARC_ERR_MEMORY;
+}
+
+/**
+ * @brief Build {"result": "<text items, newline separated>"} in the sink
+ *
+ * A single item (the usual case) is escaped straight from the parsed
+ * response; several are joined first.
+ */
+static arc_err_t mcp_result_to_json(
+    const cJSON *content,
+    size_t text_items,
+    const ac_mcp_call_opts_t *opts,
+    char **result_out
+) {
+    ac_strbuf_t joined = AC_STRBUF_INIT;
+    const char *text = NULL;
+    size_t text_len = 0;
+
+    const cJSON *item;
+    cJSON_ArrayForEach(item, content) {
+        if (!mcp_is_text_item(item)) {
+            continue;
+        }
+        const char *t = cJSON_GetStringValue(cJSON_GetObjectItem(item, "text"));
+        if (text_items == 1) {
+            text = t;
+            text_len = strlen(t);
+            break;
+        }
+        if ((joined.len > 0 && ac_strbuf_append(&joined, "\n", 1) != ARC_OK) ||
+            ac_strbuf_append(&joined, t, strlen(t)) != ARC_OK) {
+            ac_strbuf_reset(&joined);
+            return ARC_ERR_MEMORY;
+        }
+    }
+    if (text_items > 1) {
+        text = joined.data;
+        text_len = joined.len;
+    }
+
+    ac_json_writer_t w;
+    ac_json_writer_init(&w, opts->arena);
+    ac_json_write_object_begin(&w);
+    ac_json_write_key(&w, "result");
+    ac_json_write_string_len(&w, text, text_len);
+    ac_json_write_object_end(&w);
+    *result_out = ac_json_writer_take(&w);
+
+    ac_strbuf_reset(&joined);
+    return *result_out ? ARC_OK : ARC_ERR_MEMORY;
+}
+
 arc_err_t ac_mcp_call_tool(
     ac_mcp_client_t *client,
     const char *name,
     const char *args_json,
     char **result_out
 ) {
+    return ac_mcp_call_tool_ex(client, name, args_json, NULL, result_out);
+}
+
+arc_err_t ac_mcp_call_tool_ex(
+    ac_mcp_client_t *client,
+    const char *name,
+    const char *args_json,
+    const ac_mcp_call_opts_t *opts,
+    char **result_out
+) {
+    static const ac_mcp_call_opts_t no_opts = { 0 };
+
     if (!client || !name || !result_out) {
         return ARC_ERR_INVALID_ARG;
     }
+    if (!opts) {
+        opts = &no_opts;
+    }
 
     *result_out = NULL;
 
     if (!ac_mcp_is_connected(client)) {
-        *result_out = ARC_STRDUP("{\"error\":\"MCP not connected\"}");
+        *result_out = mcp_result_dup(opts, "{\"error\":\"MCP not connected\"}");
         return ARC_ERR_NOT_CONNECTED;
     }
 
@@ -590,80 +1344,79 @@ arc_err_t ac_mcp_call_tool(
     }
     cJSON_AddItemToObject(params, "arguments", arguments);
 
+    /* Ask for progress: the server reports against our token */
+    mcp_progress_t progress = { 0 };
+    if (opts->on_progress) {
+        progress.fn = opts->on_progress;
+        progress.user_data = opts->user_data;
+        cJSON *meta = cJSON_AddObjectToObject(params, "_meta");
+        cJSON_AddNumberToObject(meta, "progressToken", mcp_progress_begin(client, &progress));
+    }
+
+    /* Result tree is parse-then-discard: keep it in a scratch arena */
     cJSON *result = NULL;
-    arc_err_t err = mcp_rpc_call(client, "tools/call", params, &result);
+    ac_cjson_scope_t scope;
+    ac_cjson_scope_begin(&scope, NULL);
+    uint64_t started = ac_platform_timestamp_ms();
+    arc_err_t err = mcp_rpc_call_limited(client, "tools/call", params, &scope, &result,
+                                         opts->cancel, opts->deadline_ms);
+
+    ac_metric_add(ac_metrics_counter("arc_mcp_calls", NULL, "MCP tools/call requests"), 1);
+    if (err != ARC_OK) {
+        ac_metric_add(ac_metrics_counter("arc_mcp_errors", NULL, "MCP tools/call requests that failed"), 1);
+    }
+    ac_metric_observe(ac_metrics_histogram("arc_mcp_call_duration_seconds", NULL,
+                                           "MCP tools/call round trip", 1e-6),
+                      (ac_platform_timestamp_ms() - started) * 1000);
+
+    if (opts->on_progress) {
+        mcp_progress_end(client, &progress);
+    }
 
     if (err != ARC_OK) {
+        ac_cjson_scope_end(&scope);
         char buf[256];
         snprintf(buf, sizeof(buf), "{\"error\":\"Tool call failed: %s\"}", ac_strerror(err));
-        *result_out = ARC_STRDUP(buf);
+        *result_out = mcp_result_dup(opts, buf);
         return err;
     }
 
     /* Parse content */
     cJSON *content = cJSON_GetObjectItem(result, "content");
-    if (!content || !cJSON_IsArray(content)) {
-        *result_out = ARC_STRDUP("{\"result\":null}");
-        cJSON_Delete(result);
-        return ARC_OK;
-    }
-
-    /* Concatenate text content */
-    size_t total_len = 0;
-    cJSON *item;
-    cJSON_ArrayForEach(item, content) {
-        cJSON *type = cJSON_GetObjectItem(item, "type");
-        cJSON *text = cJSON_GetObjectItem(item, "text");
-
-        if (type && cJSON_IsString(type) &&
-            strcmp(cJSON_GetStringValue(type), "text") == 0 &&
-            text && cJSON_IsString(text)) {
-            total_len += strlen(cJSON_GetStringValue(text)) + 1;
+    size_t text_items = 0;
+    if (content && cJSON_IsArray(content)) {
+        cJSON *item;
+        cJSON_ArrayForEach(item, content) {
+            text_items += mcp_is_text_item(item);
         }
     }
 
-    if (total_len == 0) {
-        *result_out = cJSON_PrintUnformatted(result);
-        cJSON_Delete(result);
-        return ARC_OK;
-    }
-
-    char *text_result = (char *)ARC_MALLOC(total_len + 64);
-    if (!text_result) {
-        cJSON_Delete(result);
-        return ARC_ERR_MEMORY;
-    }
-
-    char *p = text_result;
-    int first = 1;
-
-    cJSON_ArrayForEach(item, content) {
-        cJSON *type = cJSON_GetObjectItem(item, "type");
-        cJSON *text = cJSON_GetObjectItem(item, "text");
-
-        if (type && cJSON_IsString(type) &&
-            strcmp(cJSON_GetStringValue(type), "text") == 0 &&
-            text && cJSON_IsString(text)) {
-            if (!first) *p++ = '\n';
-            first = 0;
-            const char *txt = cJSON_GetStringValue(text);
-            strcpy(p, txt);
-            p += strlen(txt);
+    if (!content || !cJSON_IsArray(content)) {
+        *result_out = mcp_result_dup(opts, "{\"result\":null}");
+    } else if (text_items == 0) {
+        char *json = cJSON_PrintUnformatted(result);
+        if (json && opts->arena) {
+            *result_out = arena_strdup(opts->arena, json);
+            ARC_FREE(json);
+        } else {
+            *result_out = json;
         }
+    } else if (opts->result_path) {
+        err = mcp_result_to_file(content, opts, result_out);
+    } else {
+        err = mcp_result_to_json(content, text_items, opts, result_out);
     }
-    *p = '\0';
 
     cJSON_Delete(result);
+    ac_cjson_scope_end(&scope);
 
-    /* Wrap in JSON */
-    cJSON *json_result = cJSON_CreateObject();
-    cJSON_AddStringToObject(json_result, "result", text_result);
-    ARC_FREE(text_result);
-
-    *result_out = cJSON_PrintUnformatted(json_result);
-    cJSON_Delete(json_result);
-
-    return ARC_OK;
+    if (err == ARC_OK && !*result_out) {
+        err = ARC_ERR_MEMORY;
+    }
+    if (err == ARC_ERR_IO) {
+        *result_out = mcp_result_dup(opts, "{\"error\":\"Cannot write tool result file\"}");
+    }
+    return err;
 }
 
 /*============================================================================
@@ -698,6 +1451,13 @@ arc_err_t ac_mcp_get_tool_info(
     return ARC_OK;
 }
 
+unsigned ac_mcp_get_tool_hints(const ac_mcp_client_t *client, size_t index) {
+    if (!client || index >= client->tool_count) {
+        return 0;
+    }
+    return client->tools[index].hints;
+}
+
 /*============================================================================
  * Cleanup
  *============================================================================*/
@@ -705,6 +1465,14 @@ arc_err_t ac_mcp_get_tool_info(
 void ac_mcp_cleanup(ac_mcp_client_t *client) {
     if (!client) return;
 
+#ifdef ARC_HAS_THREADS
+    /* Bounded by the request timeout */
+    if (client->revalidating) {
+        pthread_join(client->revalidate_thread, NULL);
+        client->revalidating = 0;
+    }
+#endif
+
     if (client->transport) {
         if (client->transport->connected) {
             client->transport->ops->disconnect(client->transport);
@@ -722,6 +1490,9 @@ void ac_mcp_cleanup(ac_mcp_client_t *client) {
         client->transport->ops->destroy(client->transport);
     }
 
+    pthread_mutex_destroy(&client->rpc_lock);
+    pthread_mutex_destroy(&client->progress_lock);
+
     AC_LOG_DEBUG("MCP client cleaned up");
 }
 
@@ -732,18 +1503,66 @@ void ac_mcp_cleanup(ac_mcp_client_t *client) {
 #define MCP_DEFAULT_CONFIG_FILE ".mcp.json"
 #define MCP_MAX_SERVERS 32
 
+/* Overall budget for ac_mcp_connect_all() unless "connect_timeout_ms" is set */
+#define MCP_CONNECT_ALL_TIMEOUT_MS MCP_DEFAULT_TIMEOUT_MS
+
 typedef struct {
     char *name;
     char *url;
+    char *command;                   /* stdio server (instead of url) */
+    char **args;                     /* NULL-terminated, NULL = none */
     char *api_key;
     uint32_t timeout_ms;
+    int reconnect_fail_fast;
     int enabled;
 } mcp_server_entry_t;
 
+static const char *mcp_entry_label(const mcp_server_entry_t *entry) {
+    return entry->name ? entry->name : entry->url ? entry->url : entry->command;
+}
+
+static void mcp_free_args(char **args) {
+    if (!args) return;
+    for (char **arg = args; *arg; arg++) {
+        ARC_FREE(*arg);
+    }
+    ARC_FREE(args);
+}
+
+/**
+ * @brief Copy a JSON array of strings into a NULL-terminated vector
+ */
+static char **mcp_dup_args(cJSON *array) {
+    int n = cJSON_GetArraySize(array);
+    char **args = (char **)ARC_CALLOC((size_t)n + 1, sizeof(char *));
+    if (!args) return NULL;
+
+    int i = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, array) {
+        if (!cJSON_IsString(item)) continue;
+        args[i] = ARC_STRDUP(cJSON_GetStringValue(item));
+        if (!args[i]) {
+            mcp_free_args(args);
+            return NULL;
+        }
+        i++;
+    }
+    return args;
+}
+
 struct ac_mcp_servers_config {
     mcp_server_entry_t *servers;
     size_t count;
     size_t enabled_count;
+    uint32_t connect_timeout_ms;     /* Deadline for connect_all (0 = default) */
+    char *tools_cache_dir;           /* tools/list cache for every server (NULL = off) */
+
+    /* "result_cache": applied to the registry by connect_all */
+    int has_result_cache;
+    ac_mcp_result_cache_config_t result_cache;
+    char **result_cache_tools;       /* Backs result_cache.tools */
+    int lazy_tools;                  /* "lazy_tools": register stubs (connect_all) */
 };
 
 ac_mcp_servers_config_t *ac_mcp_load_config(const char *path) {
@@ -775,10 +1594,13 @@ ac_mcp_servers_config_t *ac_mcp_load_config(const char *path) {
     fclose(fp);
     content[read_size] = '\0';
 
-    cJSON *root = cJSON_Parse(content);
+    ac_cjson_scope_t scope;
+    ac_cjson_scope_begin(&scope, NULL);
+    cJSON *root = ac_cjson_scope_parse(&scope, content, read_size);
     ARC_FREE(content);
 
     if (!root) {
+        ac_cjson_scope_end(&scope);
         AC_LOG_ERROR("Failed to parse MCP config: %s", config_path);
         return NULL;
     }
@@ -787,6 +1609,7 @@ ac_mcp_servers_config_t *ac_mcp_load_config(const char *path) {
     if (!servers || !cJSON_IsArray(servers)) {
         AC_LOG_ERROR("MCP config missing 'servers' array");
         cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
         return NULL;
     }
 
@@ -794,6 +1617,7 @@ ac_mcp_servers_config_t *ac_mcp_load_config(const char *path) {
     if (array_size <= 0) {
         AC_LOG_WARN("MCP config has no servers");
         cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
         return NULL;
     }
 
@@ -808,6 +1632,7 @@ ac_mcp_servers_config_t *ac_mcp_load_config(const char *path) {
     );
     if (!config) {
         cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
         return NULL;
     }
 
@@ -815,24 +1640,81 @@ ac_mcp_servers_config_t *ac_mcp_load_config(const char *path) {
     if (!config->servers) {
         ARC_FREE(config);
         cJSON_Delete(root);
+        ac_cjson_scope_end(&scope);
         return NULL;
     }
 
+    cJSON *connect_timeout = cJSON_GetObjectItem(root, "connect_timeout_ms");
+    if (connect_timeout && cJSON_IsNumber(connect_timeout) &&
+        cJSON_GetNumberValue(connect_timeout) > 0) {
+        config->connect_timeout_ms = (uint32_t)cJSON_GetNumberValue(connect_timeout);
+    }
+
+    cJSON *cache_dir = cJSON_GetObjectItem(root, "tools_cache_dir");
+    if (cache_dir && cJSON_IsString(cache_dir)) {
+        config->tools_cache_dir = ARC_STRDUP(cJSON_GetStringValue(cache_dir));
+    }
+
+    config->lazy_tools = cJSON_IsTrue(cJSON_GetObjectItem(root, "lazy_tools"));
+
+    cJSON *result_cache = cJSON_GetObjectItem(root, "result_cache");
+    if (result_cache && cJSON_IsObject(result_cache)) {
+        cJSON *ttl = cJSON_GetObjectItem(result_cache, "ttl_ms");
+        cJSON *max_entries = cJSON_GetObjectItem(result_cache, "max_entries");
+        cJSON *max_bytes = cJSON_GetObjectItem(result_cache, "max_bytes");
+        cJSON *annotations = cJSON_GetObjectItem(result_cache, "annotations");
+        cJSON *tools = cJSON_GetObjectItem(result_cache, "tools");
+
+        config->has_result_cache = 1;
+        if (ttl && cJSON_IsNumber(ttl) && cJSON_GetNumberValue(ttl) > 0) {
+            config->result_cache.ttl_ms = (uint32_t)cJSON_GetNumberValue(ttl);
+        }
+        if (max_entries && cJSON_IsNumber(max_entries) && cJSON_GetNumberValue(max_entries) > 0) {
+            config->result_cache.max_entries = (size_t)cJSON_GetNumberValue(max_entries);
+        }
+        if (max_bytes && cJSON_IsNumber(max_bytes) && cJSON_GetNumberValue(max_bytes) > 0) {
+            config->result_cache.max_bytes = (size_t)cJSON_GetNumberValue(max_bytes);
+        }
+        config->result_cache.ignore_annotations = cJSON_IsFalse(annotations);
+        if (tools && cJSON_IsArray(tools)) {
+            config->result_cache_tools = mcp_dup_args(tools);
+            config->result_cache.tools = (const char *const *)config->result_cache_tools;
+        }
+    }
+
     cJSON *server_json;
     int index = 0;
     cJSON_ArrayForEach(server_json, servers) {
         if (index >= array_size) break;
 
         cJSON *url = cJSON_GetObjectItem(server_json, "url");
-        if (!url || !cJSON_IsString(url)) {
-            AC_LOG_WARN("MCP server entry missing 'url', skipping");
+        cJSON *command = cJSON_GetObjectItem(server_json, "command");
+        int has_url = url && cJSON_IsString(url);
+        int has_command = command && cJSON_IsString(command);
+        if (!has_url && !has_command) {
+            AC_LOG_WARN("MCP server entry missing 'url' or 'command', skipping");
             continue;
         }
 
         mcp_server_entry_t *entry = &config->servers[config->count];
 
-        entry->url = ARC_STRDUP(cJSON_GetStringValue(url));
-        if (!entry->url) continue;
+        if (has_command) {
+            entry->command = ARC_STRDUP(cJSON_GetStringValue(command));
+            if (!entry->command) continue;
+
+            cJSON *args = cJSON_GetObjectItem(server_json, "args");
+            if (args && cJSON_IsArray(args)) {
+                entry->args = mcp_dup_args(args);
+                if (!entry->args) {
+                    ARC_FREE(entry->command);
+                    entry->command = NULL;
+                    continue;
+                }
+            }
+        } else {
+            entry->url = ARC_STRDUP(cJSON_GetStringValue(url));
+            if (!entry->url) continue;
+        }
 
         cJSON *name = cJSON_GetObjectItem(server_json, "name");
         if (name && cJSON_IsString(name)) {
@@ -849,6 +1731,9 @@ ac_mcp_servers_config_t *ac_mcp_load_config(const char *path) {
             entry->timeout_ms = (uint32_t)cJSON_GetNumberValue(timeout);
         }
 
+        entry->reconnect_fail_fast =
+            cJSON_IsTrue(cJSON_GetObjectItem(server_json, "reconnect_fail_fast"));
+
         cJSON *enabled = cJSON_GetObjectItem(server_json, "enabled");
         if (enabled && cJSON_IsBool(enabled)) {
             entry->enabled = cJSON_IsTrue(enabled) ? 1 : 0;
@@ -865,11 +1750,12 @@ ac_mcp_servers_config_t *ac_mcp_load_config(const char *path) {
 
         AC_LOG_DEBUG("MCP config: %s (%s) - %s",
                      entry->name ? entry->name : "unnamed",
-                     entry->url,
+                     entry->url ? entry->url : entry->command,
                      entry->enabled ? "enabled" : "disabled");
     }
 
     cJSON_Delete(root);
+    ac_cjson_scope_end(&scope);
 
     AC_LOG_INFO("Loaded MCP config: %zu servers (%zu enabled)",
                 config->count, config->enabled_count);
@@ -893,19 +1779,88 @@ void ac_mcp_config_free(ac_mcp_servers_config_t *config) {
             mcp_server_entry_t *entry = &config->servers[i];
             if (entry->name) ARC_FREE(entry->name);
             if (entry->url) ARC_FREE(entry->url);
+            if (entry->command) ARC_FREE(entry->command);
+            mcp_free_args(entry->args);
             if (entry->api_key) ARC_FREE(entry->api_key);
         }
         ARC_FREE(config->servers);
     }
 
+    if (config->tools_cache_dir) ARC_FREE(config->tools_cache_dir);
+    mcp_free_args(config->result_cache_tools);
     ARC_FREE(config);
 }
 
-/* Forward declaration */
-arc_err_t ac_tool_registry_add_mcp(
-    ac_tool_registry_t *registry,
-    ac_mcp_client_t *mcp
-);
+/**
+ * @brief Per-server state for ac_mcp_connect_all()
+ */
+typedef struct {
+    const mcp_server_entry_t *entry;
+    ac_mcp_client_t *client;
+    uint32_t timeout_ms;             /* Server's own request timeout */
+    uint64_t deadline_ms;            /* Shared deadline (platform timestamp) */
+    arc_err_t connect_err;
+    arc_err_t discover_err;
+    uint32_t connect_ms;             /* initialize handshake */
+    uint32_t discover_ms;            /* tools/list */
+    int cached;                      /* Tools came from the on-disk cache */
+#ifdef ARC_HAS_THREADS
+    pthread_t thread;
+    int started;
+#endif
+} mcp_connect_slot_t;
+
+/**
+ * @brief Cap the transport timeout at what is left of the deadline
+ *
+ * @return 0 if the deadline has passed
+ */
+static int mcp_slot_arm_timeout(mcp_connect_slot_t *slot) {
+    uint64_t now = ac_platform_timestamp_ms();
+    if (now >= slot->deadline_ms) {
+        return 0;
+    }
+    uint64_t left = slot->deadline_ms - now;
+    slot->client->transport->timeout_ms =
+        left < slot->timeout_ms ? (uint32_t)left : slot->timeout_ms;
+    return 1;
+}
+
+/**
+ * @brief Connect and discover one server
+ */
+static void mcp_connect_slot(mcp_connect_slot_t *slot) {
+    uint64_t start = ac_platform_timestamp_ms();
+
+    slot->connect_err = mcp_slot_arm_timeout(slot) ?
+        ac_mcp_connect(slot->client) : ARC_ERR_TIMEOUT;
+    uint64_t connected = ac_platform_timestamp_ms();
+    slot->connect_ms = (uint32_t)(connected - start);
+
+    if (slot->connect_err == ARC_OK) {
+        slot->cached = mcp_load_cached_tools(slot->client);
+        if (!slot->cached) {
+            slot->discover_err = mcp_slot_arm_timeout(slot) ?
+                ac_mcp_discover_tools(slot->client) : ARC_ERR_TIMEOUT;
+        }
+        slot->discover_ms = (uint32_t)(ac_platform_timestamp_ms() - connected);
+    }
+
+    /* Tool calls later get the server's full timeout again */
+    slot->client->transport->timeout_ms = slot->timeout_ms;
+
+    /* Outside the deadline: the cached tools are usable meanwhile */
+    if (slot->cached) {
+        mcp_revalidate_start(slot->client);
+    }
+}
+
+#ifdef ARC_HAS_THREADS
+static void *mcp_connect_thread(void *arg) {
+    mcp_connect_slot((mcp_connect_slot_t *)arg);
+    return NULL;
+}
+#endif
 
 size_t ac_mcp_connect_all(
     ac_session_t *session,
@@ -916,25 +1871,42 @@ size_t ac_mcp_connect_all(
         return 0;
     }
 
-    size_t connected = 0;
+    mcp_connect_slot_t *slots = (mcp_connect_slot_t *)ARC_CALLOC(
+        config->count ? config->count : 1, sizeof(mcp_connect_slot_t));
+    if (!slots) {
+        AC_LOG_ERROR("MCP connect_all: out of memory");
+        return 0;
+    }
+
+    uint32_t budget_ms = config->connect_timeout_ms ?
+        config->connect_timeout_ms : MCP_CONNECT_ALL_TIMEOUT_MS;
+    uint64_t start_ms = ac_platform_timestamp_ms();
+    uint64_t deadline_ms = start_ms + budget_ms;
+
+    /* Create clients on the calling thread (session arena) */
+    size_t slot_count = 0;
 
     for (size_t i = 0; i < config->count; i++) {
         const mcp_server_entry_t *entry = &config->servers[i];
 
         if (!entry->enabled) {
-            AC_LOG_DEBUG("Skipping disabled MCP server: %s",
-                         entry->name ? entry->name : entry->url);
+            AC_LOG_DEBUG("Skipping disabled MCP server: %s", mcp_entry_label(entry));
             continue;
         }
 
-        const char *server_name = entry->name ? entry->name : entry->url;
+        const char *server_name = mcp_entry_label(entry);
         AC_LOG_INFO("Connecting to MCP server: %s", server_name);
 
+        uint32_t timeout_ms = entry->timeout_ms ? entry->timeout_ms : MCP_DEFAULT_TIMEOUT_MS;
         ac_mcp_client_t *client = ac_mcp_create(session, &(ac_mcp_config_t){
             .server_url = entry->url,
+            .command = entry->command,
+            .args = (const char *const *)entry->args,
             .api_key = entry->api_key,
-            .timeout_ms = entry->timeout_ms ? entry->timeout_ms : MCP_DEFAULT_TIMEOUT_MS,
-            .verify_ssl = 1
+            .timeout_ms = timeout_ms,
+            .verify_ssl = 1,
+            .tools_cache_dir = config->tools_cache_dir,
+            .reconnect_fail_fast = entry->reconnect_fail_fast
         });
 
         if (!client) {
@@ -942,23 +1914,65 @@ size_t ac_mcp_connect_all(
             continue;
         }
 
-        arc_err_t err = ac_mcp_connect(client);
-        if (err != ARC_OK) {
-            AC_LOG_WARN("Failed to connect to MCP server %s: %s",
-                        server_name, ac_strerror(err));
+        slots[slot_count].entry = entry;
+        slots[slot_count].client = client;
+        slots[slot_count].timeout_ms = timeout_ms;
+        slots[slot_count].deadline_ms = deadline_ms;
+        slot_count++;
+    }
+
+    /*
+     * Handshakes are network-bound and a dead server blocks until its
+     * timeout, so each gets its own thread rather than an executor worker:
+     * every server starts at once and the deadline bounds the whole step.
+     */
+#ifdef ARC_HAS_THREADS
+    for (size_t i = 0; i < slot_count; i++) {
+        slots[i].started = pthread_create(&slots[i].thread, NULL,
+                                          mcp_connect_thread, &slots[i]) == 0;
+    }
+    for (size_t i = 0; i < slot_count; i++) {
+        if (slots[i].started) {
+            pthread_join(slots[i].thread, NULL);
+        } else {
+            mcp_connect_slot(&slots[i]);
+        }
+    }
+#else
+    for (size_t i = 0; i < slot_count; i++) {
+        mcp_connect_slot(&slots[i]);
+    }
+#endif
+
+    /* Register tools in config order */
+    size_t connected = 0;
+
+    if (config->has_result_cache) {
+        ac_tool_registry_cache_mcp(registry, &config->result_cache);
+    }
+    if (config->lazy_tools) {
+        ac_tool_registry_lazy_mcp(registry, 1);
+    }
+
+    for (size_t i = 0; i < slot_count; i++) {
+        mcp_connect_slot_t *slot = &slots[i];
+        const char *server_name = mcp_entry_label(slot->entry);
+
+        if (slot->connect_err != ARC_OK) {
+            AC_LOG_WARN("Failed to connect to MCP server %s after %u ms: %s",
+                        server_name, slot->connect_ms, ac_strerror(slot->connect_err));
             continue;
         }
 
-        err = ac_mcp_discover_tools(client);
-        if (err != ARC_OK) {
-            AC_LOG_WARN("Failed to discover tools from %s: %s",
-                        server_name, ac_strerror(err));
+        if (slot->discover_err != ARC_OK) {
+            AC_LOG_WARN("Failed to discover tools from %s after %u ms: %s",
+                        server_name, slot->discover_ms, ac_strerror(slot->discover_err));
             continue;
         }
 
-        size_t tool_count = ac_mcp_tool_count(client);
+        size_t tool_count = ac_mcp_tool_count(slot->client);
 
-        err = ac_tool_registry_add_mcp(registry, client);
+        arc_err_t err = ac_tool_registry_add_mcp(registry, slot->client);
         if (err != ARC_OK) {
             AC_LOG_WARN("Failed to add tools from %s: %s",
                         server_name, ac_strerror(err));
@@ -966,12 +1980,17 @@ size_t ac_mcp_connect_all(
         }
 
         connected++;
-        AC_LOG_INFO("MCP server %s: connected, %zu tools added",
-                    server_name, tool_count);
+        AC_LOG_INFO("MCP server %s: connected, %zu tools added "
+                    "(initialize %u ms, tools/list %u ms%s)",
+                    server_name, tool_count, slot->connect_ms, slot->discover_ms,
+                    slot->cached ? " from cache" : "");
     }
 
-    AC_LOG_INFO("MCP connect_all: %zu/%zu servers connected",
-                connected, config->enabled_count);
+    ARC_FREE(slots);
+
+    AC_LOG_INFO("MCP connect_all: %zu/%zu servers connected in %u ms",
+                connected, config->enabled_count,
+                (unsigned)(ac_platform_timestamp_ms() - start_ms));
 
     return connected;
 }
@@ -0,0 +1,300 @@
+/**
+ * @file mcp_cache.c
+ * @brief On-disk tools/list cache
+ *
+ * One file per server, named by a hash of its URL, holding the tool list
+ * as last discovered together with the server name and version. A stored
+ * list is only used when all three match, so an upgraded server is asked
+ * again. Files are written to a temporary name and renamed into place.
+ *
+ * Format:
+ * @code{.json}
+ * {"url":"...","server":"...","version":"...",
+ *  "tools":{"<name>":{"description":"...","inputSchema":{...},"hints":1}, ...}}
+ * @endcode
+ *
+ * Loading reads spans with json_scan and copies each schema verbatim, so
+ * even a large catalog costs one validation pass and no tree.
+ */
+
+#include "mcp_internal.h"
+#include "json_scan.h"
+#include "json_writer.h"
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir_p(path) _mkdir(path)
+#else
+#define mkdir_p(path) mkdir(path, 0755)
+#endif
+
+#define MCP_CACHE_PATH_MAX 1024
+#define MCP_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+/**
+ * @brief Cache file of a server: <dir>/mcp-<fnv1a64(url)>.json
+ */
+static int cache_path(char *out, size_t size, const char *dir, const char *url,
+                      const char *suffix) {
+    uint64_t h = 14695981039346656037ull;
+    for (const unsigned char *p = (const unsigned char *)url; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ull;
+    }
+    int n = snprintf(out, size, "%s/mcp-%016llx.json%s",
+                     dir, (unsigned long long)h, suffix);
+    return n > 0 && (size_t)n < size;
+}
+
+static int ensure_dir(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        return S_ISDIR(st.st_mode) ? 0 : -1;
+    }
+    if (mkdir_p(path) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Whole file into a heap buffer (ARC_FREE), NULL if unreadable
+ */
+static char *read_file(const char *path, size_t *len) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (size <= 0 || size > MCP_CACHE_MAX_SIZE) {
+        fclose(fp);
+        return NULL;
+    }
+
+    char *data = (char *)ARC_MALLOC((size_t)size + 1);
+    if (data) {
+        *len = fread(data, 1, (size_t)size, fp);
+        data[*len] = '\0';
+    }
+    fclose(fp);
+    return data;
+}
+
+/**
+ * @brief String member equal to s (a NULL s matches a missing member)
+ */
+static int member_equals(ac_json_span_t obj, const char *key, const char *s) {
+    ac_json_span_t value = ac_json_scan_get(obj, key);
+    if (!s) {
+        return value.kind == AC_JSON_NONE;
+    }
+    char *decoded = ac_json_scan_strdup(value);
+    int equal = decoded && strcmp(decoded, s) == 0;
+    ARC_FREE(decoded);
+    return equal;
+}
+
+/**
+ * @brief Unescaped arena copy of a string span
+ */
+static char *span_strdup(arena_t *arena, ac_json_span_t value) {
+    char *out = (char *)arena_alloc(arena, (size_t)(value.end - value.start));
+    if (out) {
+        ac_json_scan_unescape(value, out);
+    }
+    return out;
+}
+
+/**
+ * @brief Verbatim arena copy of a span
+ */
+static char *span_copy(arena_t *arena, ac_json_span_t value) {
+    size_t len = (size_t)(value.end - value.start);
+    char *out = (char *)arena_alloc(arena, len + 1);
+    if (out) {
+        memcpy(out, value.start, len);
+        out[len] = '\0';
+    }
+    return out;
+}
+
+/*============================================================================
+ * Load
+ *============================================================================*/
+
+arc_err_t mcp_cache_load(
+    const char *dir,
+    const char *url,
+    const ac_mcp_server_info_t *info,
+    arena_t *arena,
+    mcp_tool_info_t **tools,
+    size_t *count
+) {
+    if (!dir || !url || !info || !arena || !tools || !count) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    char path[MCP_CACHE_PATH_MAX];
+    if (!cache_path(path, sizeof(path), dir, url, "")) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    size_t len = 0;
+    char *data = read_file(path, &len);
+    if (!data) {
+        return ARC_ERR_NOT_FOUND;
+    }
+
+    /* Half-written or hand-edited files are simply a miss */
+    if (!ac_json_scan_valid(data, len)) {
+        AC_LOG_WARN("MCP cache: ignoring malformed %s", path);
+        ARC_FREE(data);
+        return ARC_ERR_NOT_FOUND;
+    }
+
+    ac_json_span_t root = ac_json_scan_root(data, len);
+    ac_json_span_t list = ac_json_scan_get(root, "tools");
+
+    if (list.kind != AC_JSON_OBJECT ||
+        !member_equals(root, "url", url) ||
+        !member_equals(root, "server", info->name) ||
+        !member_equals(root, "version", info->version)) {
+        AC_LOG_DEBUG("MCP cache: no entry for %s", url);
+        ARC_FREE(data);
+        return ARC_ERR_NOT_FOUND;
+    }
+
+    size_t n = 0;
+    ac_json_iter_t it = ac_json_scan_members(list);
+    while (ac_json_scan_next_member(&it, NULL, NULL)) {
+        n++;
+    }
+
+    mcp_tool_info_t *out = (mcp_tool_info_t *)arena_alloc(
+        arena, sizeof(mcp_tool_info_t) * (n ? n : 1));
+    if (!out) {
+        ARC_FREE(data);
+        return ARC_ERR_MEMORY;
+    }
+
+    size_t filled = 0;
+    ac_json_span_t key, value;
+    it = ac_json_scan_members(list);
+    while (filled < n && ac_json_scan_next_member(&it, &key, &value)) {
+        ac_json_span_t description = ac_json_scan_get(value, "description");
+        ac_json_span_t schema = ac_json_scan_get(value, "inputSchema");
+        int hints = 0;
+        ac_json_scan_int(ac_json_scan_get(value, "hints"), &hints);
+
+        mcp_tool_info_t *tool = &out[filled];
+        tool->name = span_strdup(arena, key);
+        tool->description = description.kind == AC_JSON_STRING ?
+            span_strdup(arena, description) : NULL;
+        tool->parameters = schema.kind == AC_JSON_OBJECT ?
+            span_copy(arena, schema) :
+            arena_strdup(arena, "{\"type\":\"object\",\"properties\":{}}");
+        tool->hints = (unsigned)hints;
+
+        if (tool->name && tool->parameters) {
+            filled++;
+        }
+    }
+
+    ARC_FREE(data);
+
+    *tools = out;
+    *count = filled;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Store
+ *============================================================================*/
+
+arc_err_t mcp_cache_store(
+    const char *dir,
+    const char *url,
+    const ac_mcp_server_info_t *info,
+    const mcp_tool_info_t *tools,
+    size_t count
+) {
+    if (!dir || !url || !info || (!tools && count > 0)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    char path[MCP_CACHE_PATH_MAX];
+    char tmp_path[MCP_CACHE_PATH_MAX];
+    if (!cache_path(path, sizeof(path), dir, url, "") ||
+        !cache_path(tmp_path, sizeof(tmp_path), dir, url, ".tmp")) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    ac_json_writer_t w;
+    ac_json_writer_init(&w, NULL);
+
+    ac_json_write_object_begin(&w);
+    ac_json_write_member_string(&w, "url", url);
+    ac_json_write_member_string(&w, "server", info->name);
+    ac_json_write_member_string(&w, "version", info->version);
+    ac_json_write_key(&w, "tools");
+    ac_json_write_object_begin(&w);
+    for (size_t i = 0; i < count; i++) {
+        const char *schema = tools[i].parameters ?
+            tools[i].parameters : "{\"type\":\"object\",\"properties\":{}}";
+
+        ac_json_write_key(&w, tools[i].name);
+        ac_json_write_object_begin(&w);
+        ac_json_write_member_string(&w, "description", tools[i].description);
+        ac_json_write_key(&w, "inputSchema");
+        ac_json_write_raw(&w, schema, strlen(schema));
+        if (tools[i].hints) {
+            ac_json_write_member_int(&w, "hints", tools[i].hints);
+        }
+        ac_json_write_object_end(&w);
+    }
+    ac_json_write_object_end(&w);
+    ac_json_write_object_end(&w);
+
+    size_t len = ac_json_writer_len(&w);
+    char *json = ac_json_writer_take(&w);
+    if (!json) {
+        return ARC_ERR_MEMORY;
+    }
+
+    if (ensure_dir(dir) != 0) {
+        AC_LOG_WARN("MCP cache: cannot create directory %s", dir);
+        ARC_FREE(json);
+        return ARC_ERR_IO;
+    }
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        AC_LOG_WARN("MCP cache: cannot write %s", tmp_path);
+        ARC_FREE(json);
+        return ARC_ERR_IO;
+    }
+
+    int ok = fwrite(json, 1, len, fp) == len;
+    ok = (fclose(fp) == 0) && ok;
+    ARC_FREE(json);
+
+    if (!ok || rename(tmp_path, path) != 0) {
+        AC_LOG_WARN("MCP cache: failed to store %s", path);
+        remove(tmp_path);
+        return ARC_ERR_IO;
+    }
+
+    AC_LOG_DEBUG("MCP cache: stored %zu tools for %s", count, url);
+    return ARC_OK;
+}
@@ -3,10 +3,15 @@
  * @brief MCP Streamable HTTP Transport Implementation
  *
  * Simple HTTP POST-based transport where responses are returned directly
- * in the HTTP response body.
+ * in the HTTP response body, either as JSON or as an event stream that
+ * carries notifications ahead of the response.
  */
 
 #include "mcp_internal.h"
+#include "arc/sse_parser.h"
+#include "json_scan.h"
+#include "strbuf.h"
+#include <ctype.h>
 #include <stdlib.h>
 
 /*============================================================================
@@ -15,9 +20,107 @@
 
 typedef struct {
     mcp_transport_t base;
-    /* No additional state needed for HTTP transport */
+    arc_http_header_set_t *headers;  /* Content-Type/Accept/Authorization, built once */
 } mcp_http_transport_t;
 
+/*============================================================================
+ * Event Stream Responses
+ *============================================================================*/
+
+/**
+ * @brief One response body, read as it arrives
+ *
+ * The body is sniffed: JSON is collected as is, an event stream is parsed
+ * on the fly so notifications reach the client while the call runs.
+ */
+typedef struct {
+    mcp_transport_t *t;
+    int request_id;
+    int is_stream;                   /* -1 = not known yet, 0 = JSON, 1 = event stream */
+    ac_strbuf_t body;                /* JSON body */
+    sse_parser_t parser;
+    char *response;                  /* Response message from the event stream */
+} http_body_t;
+
+static int http_body_on_event(const sse_event_t *event, void *user_data) {
+    http_body_t *b = (http_body_t *)user_data;
+    if (!event->data || b->response) {
+        return 0;
+    }
+
+    ac_json_span_t root = ac_json_scan_root(event->data, event->data_len);
+    if (ac_json_scan_get(root, "method").kind != AC_JSON_NONE) {
+        if (ac_json_scan_get(root, "id").kind == AC_JSON_NONE) {
+            mcp_transport_notify(b->t, event->data, event->data_len);
+        }
+        return 0;
+    }
+
+    int id = 0;
+    if (!ac_json_scan_int(ac_json_scan_get(root, "id"), &id) || id != b->request_id) {
+        return 0;
+    }
+    b->response = ARC_STRNDUP(event->data, event->data_len);
+
+    /* Got it: no need to wait for the server to close the stream */
+    return 1;
+}
+
+static void http_body_init(http_body_t *b, mcp_transport_t *t, int request_id) {
+    memset(b, 0, sizeof(*b));
+    b->t = t;
+    b->request_id = request_id;
+    b->is_stream = -1;
+    sse_parser_init(&b->parser, http_body_on_event, b);
+}
+
+static void http_body_free(http_body_t *b) {
+    sse_parser_free(&b->parser);
+    ac_strbuf_reset(&b->body);
+    if (b->response) {
+        ARC_FREE(b->response);
+        b->response = NULL;
+    }
+}
+
+/**
+ * @brief Feed body bytes
+ * @return 0 to continue, 1 when done (response seen) or out of memory
+ */
+static int http_body_feed(const char *data, size_t len, void *user_data) {
+    http_body_t *b = (http_body_t *)user_data;
+
+    if (b->is_stream < 0) {
+        while (len > 0 && isspace((unsigned char)*data)) {
+            data++;
+            len--;
+        }
+        if (len == 0) {
+            return 0;
+        }
+        b->is_stream = (*data != '{' && *data != '[');
+    }
+
+    if (b->is_stream) {
+        return sse_parser_feed(&b->parser, data, len) != 0;
+    }
+    return ac_strbuf_append(&b->body, data, len) != ARC_OK;
+}
+
+/**
+ * @brief Take the response message out of a fed body (NULL if none)
+ */
+static char *http_body_take(http_body_t *b) {
+    char *json;
+    if (b->is_stream == 1) {
+        json = b->response;
+        b->response = NULL;
+    } else {
+        json = b->body.len > 0 ? ac_strbuf_take(&b->body) : NULL;
+    }
+    return json;
+}
+
 /*============================================================================
  * Transport Operations
  *============================================================================*/
@@ -29,6 +132,77 @@ static arc_err_t http_connect(mcp_transport_t *t) {
     return ARC_OK;
 }
 
+/**
+ * @brief POST a request and read the response as it arrives
+ *
+ * Used while a call waits for progress, so an event stream answer
+ * delivers its notifications live instead of after the last byte.
+ */
+static arc_err_t http_request_streamed(
+    mcp_transport_t *t,
+    const char *request_json,
+    int request_id,
+    char **response_json
+) {
+    mcp_http_transport_t *ht = (mcp_http_transport_t *)t;
+
+    http_body_t body;
+    http_body_init(&body, t, request_id);
+
+    arc_http_stream_request_t req = {
+        .base = {
+            .url = t->server_url,
+            .method = ARC_HTTP_POST,
+            .header_set = ht->headers,
+            .body = request_json,
+            .body_len = strlen(request_json),
+            .timeout_ms = mcp_transport_timeout(t),
+            .verify_ssl = t->verify_ssl,
+            .cancel = t->cancel
+        },
+        .on_data = http_body_feed,
+        .user_data = &body
+    };
+
+    arc_http_response_t resp = {0};
+
+    AC_LOG_DEBUG("HTTP request (streamed): POST %s", t->server_url);
+
+    arc_http_client_t *http = mcp_http_borrow(t, t->http);
+    if (!http) {
+        http_body_free(&body);
+        mcp_transport_set_error(t, "No HTTP client available");
+        return ARC_ERR_TIMEOUT;
+    }
+    arc_err_t err = arc_http_request_stream(http, &req, &resp);
+    mcp_http_return(t, http);
+
+    /* Stopping the stream once the response is in shows up as an error */
+    if (body.response) {
+        err = ARC_OK;
+    }
+
+    if (err != ARC_OK) {
+        mcp_transport_set_error(t, "HTTP request failed: %s",
+                                 resp.error_msg ? resp.error_msg : ac_strerror(err));
+    } else if (resp.status_code < 200 || resp.status_code >= 300) {
+        mcp_transport_set_error(t, "HTTP error %d: %.*s", resp.status_code,
+                                 (int)body.body.len, body.body.data ? body.body.data : "");
+        err = ARC_ERR_HTTP;
+    } else {
+        *response_json = http_body_take(&body);
+        if (!*response_json && request_id != 0) {
+            mcp_transport_set_error(t, body.is_stream == 1 ?
+                                    "Event stream ended without a response" : "Empty response");
+            err = ARC_ERR_PROTOCOL;
+        }
+    }
+
+    http_body_free(&body);
+    arc_http_response_free(&resp);
+    return err;
+}
+
 static arc_err_t http_request(
     mcp_transport_t *t,
     const char *request_json,
@@ -40,22 +214,22 @@ static arc_err_t http_request(
         return ARC_ERR_NOT_CONNECTED;
     }
 
-    /* Build headers */
-    arc_http_header_t *headers = mcp_build_headers(
-        t,
-        "application/json",
-        "application/json, text/event-stream"
-    );
+    if (request_id != 0 && t->progress_calls > 0) {
+        return http_request_streamed(t, request_json, request_id, response_json);
+    }
+
+    mcp_http_transport_t *ht = (mcp_http_transport_t *)t;
 
     /* Build request */
     arc_http_request_t req = {
         .url = t->server_url,
         .method = ARC_HTTP_POST,
-        .headers = headers,
+        .header_set = ht->headers,
         .body = request_json,
         .body_len = strlen(request_json),
-        .timeout_ms = t->timeout_ms,
-        .verify_ssl = t->verify_ssl
+        .timeout_ms = mcp_transport_timeout(t),
+        .verify_ssl = t->verify_ssl,
+        .cancel = t->cancel
     };
 
     arc_http_response_t resp = {0};
@@ -63,9 +237,13 @@ static arc_err_t http_request(
     AC_LOG_DEBUG("HTTP request: POST %s", t->server_url);
 
     /* Send request */
-    arc_err_t err = arc_http_request(t->http, &req, &resp);
-
-    arc_http_header_free(headers);
+    arc_http_client_t *http = mcp_http_borrow(t, t->http);
+    if (!http) {
+        mcp_transport_set_error(t, "No HTTP client available");
+        return ARC_ERR_TIMEOUT;
+    }
+    arc_err_t err = arc_http_request(http, &req, &resp);
+    mcp_http_return(t, http);
 
     if (err != ARC_OK) {
         mcp_transport_set_error(t, "HTTP request failed: %s",
@@ -100,14 +278,133 @@ static arc_err_t http_request(
 
     AC_LOG_DEBUG("HTTP response: %d, %zu bytes", resp.status_code, resp.body_len);
 
-    /* Return response (caller frees) */
-    *response_json = ARC_STRDUP(resp.body);
+    if (resp.body[strspn(resp.body, " \t\r\n")] == '{') {
+        /* Hand the heap body over as the response (caller frees) */
+        *response_json = resp.body;
+        resp.body = NULL;
+        arc_http_response_free(&resp);
+        return ARC_OK;
+    }
+
+    /* Answered with an event stream: pick the response out of it */
+    http_body_t body;
+    http_body_init(&body, t, request_id);
+    http_body_feed(resp.body, resp.body_len, &body);
+    *response_json = http_body_take(&body);
+    http_body_free(&body);
     arc_http_response_free(&resp);
 
     if (!*response_json) {
-        return ARC_ERR_MEMORY;
+        mcp_transport_set_error(t, "Event stream ended without a response");
+        return ARC_ERR_PROTOCOL;
+    }
+    return ARC_OK;
+}
+
+/**
+ * @brief POST the requests as one JSON-RPC batch array
+ *
+ * A server without batch support answers 4xx or a single error object
+ * instead of an array; that is reported as ARC_ERR_NOT_IMPLEMENTED.
+ */
+static arc_err_t http_request_batch(
+    mcp_transport_t *t,
+    const char *const *requests_json,
+    const int *request_ids,
+    size_t count,
+    char **responses_json
+) {
+    if (!t->connected) {
+        mcp_transport_set_error(t, "Not connected");
+        return ARC_ERR_NOT_CONNECTED;
+    }
+
+    mcp_http_transport_t *ht = (mcp_http_transport_t *)t;
+
+    ac_strbuf_t body = AC_STRBUF_INIT;
+    arc_err_t err = ac_strbuf_append(&body, "[", 1);
+    for (size_t i = 0; i < count && err == ARC_OK; i++) {
+        if (i > 0) {
+            err = ac_strbuf_append(&body, ",", 1);
+        }
+        if (err == ARC_OK) {
+            err = ac_strbuf_append(&body, requests_json[i], strlen(requests_json[i]));
+        }
+    }
+    if (err == ARC_OK) {
+        err = ac_strbuf_append(&body, "]", 1);
+    }
+    if (err != ARC_OK) {
+        ac_strbuf_reset(&body);
+        return err;
+    }
+
+    arc_http_request_t req = {
+        .url = t->server_url,
+        .method = ARC_HTTP_POST,
+        .header_set = ht->headers,
+        .body = body.data,
+        .body_len = body.len,
+        .timeout_ms = t->timeout_ms,
+        .verify_ssl = t->verify_ssl
+    };
+
+    arc_http_response_t resp = {0};
+
+    AC_LOG_DEBUG("HTTP batch request: POST %s (%zu requests)", t->server_url, count);
+
+    arc_http_client_t *http = mcp_http_borrow(t, t->http);
+    if (!http) {
+        ac_strbuf_reset(&body);
+        mcp_transport_set_error(t, "No HTTP client available");
+        return ARC_ERR_TIMEOUT;
+    }
+    err = arc_http_request(http, &req, &resp);
+    mcp_http_return(t, http);
+    ac_strbuf_reset(&body);
+
+    if (err != ARC_OK) {
+        mcp_transport_set_error(t, "HTTP request failed: %s",
+                                 resp.error_msg ? resp.error_msg : ac_strerror(err));
+        arc_http_response_free(&resp);
+        return err;
     }
 
+    ac_json_span_t array = ac_json_scan_root(resp.body, resp.body ? resp.body_len : 0);
+
+    if (resp.status_code >= 400 && resp.status_code < 500) {
+        arc_http_response_free(&resp);
+        return ARC_ERR_NOT_IMPLEMENTED;
+    }
+    if (resp.status_code < 200 || resp.status_code >= 300) {
+        mcp_transport_set_error(t, "HTTP error %d: %s",
+                                 resp.status_code,
+                                 resp.body ? resp.body : "No body");
+        arc_http_response_free(&resp);
+        return ARC_ERR_HTTP;
+    }
+    if (array.kind != AC_JSON_ARRAY) {
+        arc_http_response_free(&resp);
+        return ARC_ERR_NOT_IMPLEMENTED;
+    }
+
+    /* Responses may come in any order: match them to requests by id */
+    ac_json_span_t item;
+    for (size_t n = 0; (item = ac_json_scan_index(array, n)).kind != AC_JSON_NONE; n++) {
+        int id = 0;
+        if (!ac_json_scan_int(ac_json_scan_get(item, "id"), &id)) {
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (request_ids[i] == id && !responses_json[i]) {
+                responses_json[i] = ARC_STRNDUP(item.start, (size_t)(item.end - item.start));
+                break;
+            }
+        }
+    }
+
+    AC_LOG_DEBUG("HTTP batch response: %d, %zu bytes", resp.status_code, resp.body_len);
+    arc_http_response_free(&resp);
     return ARC_OK;
 }
 
@@ -117,7 +414,11 @@ static void http_disconnect(mcp_transport_t *t) {
 }
 
 static void http_destroy(mcp_transport_t *t) {
+    mcp_http_transport_t *ht = (mcp_http_transport_t *)t;
+
     /* Base transport resources are managed by arena */
+    arc_http_header_set_destroy(ht->headers);
+    ht->headers = NULL;
     AC_LOG_DEBUG("HTTP transport: destroyed");
 }
 
@@ -128,6 +429,7 @@ static void http_destroy(mcp_transport_t *t) {
 static const mcp_transport_ops_t http_ops = {
     .connect = http_connect,
     .request = http_request,
+    .request_batch = http_request_batch,
     .disconnect = http_disconnect,
     .destroy = http_destroy
 };
@@ -139,6 +441,7 @@ static const mcp_transport_ops_t http_ops = {
 mcp_transport_t *mcp_http_create(
     arena_t *arena,
     arc_http_client_t *http,
+    int pooled,
     const ac_mcp_config_t *config
 ) {
     mcp_http_transport_t *t = (mcp_http_transport_t *)arena_alloc(
@@ -152,6 +455,7 @@ mcp_transport_t *mcp_http_create(
     t->base.ops = &http_ops;
     t->base.http = http;
     t->base.arena = arena;
+    t->base.pooled = pooled;
     t->base.server_url = arena_strdup(arena, config->server_url);
     t->base.api_key = config->api_key ? arena_strdup(arena, config->api_key) : NULL;
     t->base.timeout_ms = config->timeout_ms ? config->timeout_ms : MCP_DEFAULT_TIMEOUT_MS;
@@ -161,6 +465,17 @@ mcp_transport_t *mcp_http_create(
         return NULL;
     }
 
+    arc_http_header_t *headers = mcp_build_headers(
+        &t->base,
+        "application/json",
+        "application/json, text/event-stream"
+    );
+    arc_err_t err = arc_http_header_set_create(headers, &t->headers);
+    arc_http_header_free(headers);
+    if (err != ARC_OK) {
+        return NULL;
+    }
+
     AC_LOG_DEBUG("HTTP transport created for: %s", config->server_url);
     return &t->base;
 }
@@ -3,7 +3,8 @@
  * @brief MCP Internal Transport Interface
  *
  * Defines the abstract transport layer for MCP protocol.
- * Concrete implementations: mcp_http.c (Streamable HTTP), mcp_sse.c (SSE)
+ * Concrete implementations: mcp_http.c (Streamable HTTP), mcp_sse.c (SSE),
+ * mcp_stdio.c (local server process)
  */
 
 #ifndef MCP_INTERNAL_H
@@ -14,12 +15,15 @@
 #include "arc/log.h"
 #include "arc/platform.h"
 #include "http_client.h"
+#include "pthread_port.h"
 #include "cJSON.h"
 
+#include <errno.h>
 #include <stdint.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 /*============================================================================
  * Constants
@@ -27,8 +31,10 @@
 
 #define MCP_PROTOCOL_VERSION    "2024-11-05"
 #define MCP_DEFAULT_TIMEOUT_MS  30000
-#define MCP_INITIAL_TOOL_CAP    16
 #define MCP_ERROR_MSG_SIZE      256
+#define MCP_MAX_BATCH           32       /* Requests sent together at most */
+#define MCP_CANCEL_POLL_MS      20       /* Wake-up interval of waits a call can cancel */
+#define MCP_CANCEL_NOTIFY_MS    250      /* Budget for notifications/cancelled */
 
 /*============================================================================
  * Transport Interface
@@ -64,6 +70,29 @@ typedef struct {
         char **response_json
     );
 
+    /**
+     * @brief Send several requests at once and wait for all responses (optional)
+     *
+     * Responses are matched to requests by id; a request the server did
+     * not answer gets a NULL response.
+     *
+     * @param t              Transport handle
+     * @param requests_json  JSON-RPC requests
+     * @param request_ids    Their ids
+     * @param count          Number of requests
+     * @param responses_json Output: one response per request (caller frees)
+     * @return ARC_OK if the exchange happened (individual responses may
+     *         still be NULL), ARC_ERR_NOT_IMPLEMENTED if the server refused
+     *         a batch (nothing was processed: send the requests singly)
+     */
+    arc_err_t (*request_batch)(
+        mcp_transport_t *t,
+        const char *const *requests_json,
+        const int *request_ids,
+        size_t count,
+        char **responses_json
+    );
+
     /**
      * @brief Disconnect transport
      */
@@ -82,8 +111,9 @@ typedef struct {
  */
 struct mcp_transport {
     const mcp_transport_ops_t *ops;
-    arc_http_client_t *http;
+    arc_http_client_t *http;         /* Own client (SSE: the stream's), may be NULL */
     arena_t *arena;
+    int pooled;                      /* Requests borrow from the shared HTTP pool */
 
     /* Configuration */
     char *server_url;
@@ -94,30 +124,134 @@ struct mcp_transport {
     /* State */
     int connected;
     char error_msg[MCP_ERROR_MSG_SIZE];
+
+    /* Server notifications (e.g. notifications/progress), set by the client */
+    void (*on_notify)(void *ctx, const char *json, size_t len);
+    void *notify_ctx;
+    volatile int progress_calls;     /* Calls awaiting progress: read responses as a stream */
+
+    /* Limits of the lone request being sent (set by the sender, else NULL/0) */
+    const volatile int *cancel;      /* Abort once *cancel != 0 */
+    uint64_t deadline_ms;            /* Absolute, ac_platform_timestamp_ms */
 };
 
+/*============================================================================
+ * Tool Info
+ *============================================================================*/
+
+typedef struct {
+    char *name;
+    char *description;
+    char *parameters;  /* JSON Schema string */
+    unsigned hints;    /* AC_MCP_TOOL_* from annotations */
+} mcp_tool_info_t;
+
+/*============================================================================
+ * Tool List Cache (mcp_cache.c)
+ *============================================================================*/
+
+/**
+ * @brief Load the cached tool list of a server
+ *
+ * Only a list stored for the same URL, server name and version is used.
+ *
+ * @param dir    Cache directory
+ * @param url    Server URL
+ * @param info   Server info from initialize
+ * @param arena  Arena for the list and its strings (caller serializes)
+ * @param tools  Output: tool array
+ * @param count  Output: tool count
+ * @return ARC_OK, ARC_ERR_NOT_FOUND if there is no usable entry
+ */
+arc_err_t mcp_cache_load(
+    const char *dir,
+    const char *url,
+    const ac_mcp_server_info_t *info,
+    arena_t *arena,
+    mcp_tool_info_t **tools,
+    size_t *count
+);
+
+/**
+ * @brief Store a server's tool list, replacing any previous entry
+ *
+ * The directory is created if missing; the file is replaced atomically.
+ */
+arc_err_t mcp_cache_store(
+    const char *dir,
+    const char *url,
+    const ac_mcp_server_info_t *info,
+    const mcp_tool_info_t *tools,
+    size_t count
+);
+
 /*============================================================================
  * Transport Constructors
  *============================================================================*/
 
 /**
  * @brief Create HTTP (Streamable HTTP) transport
+ *
+ * @param http    Client for requests (NULL when pooled)
+ * @param pooled  Borrow a pooled client per request instead
  */
 mcp_transport_t *mcp_http_create(
     arena_t *arena,
     arc_http_client_t *http,
+    int pooled,
     const ac_mcp_config_t *config
 );
 
 /**
  * @brief Create SSE transport
+ *
+ * @param http    Client for the event stream
+ * @param pooled  POSTs borrow a pooled client (else the transport makes one)
  */
 mcp_transport_t *mcp_sse_create(
     arena_t *arena,
     arc_http_client_t *http,
+    int pooled,
+    const ac_mcp_config_t *config
+);
+
+/**
+ * @brief Create stdio transport (spawns config->command on connect)
+ *
+ * server_url is set to "stdio:<command line>".
+ */
+mcp_transport_t *mcp_stdio_create(
+    arena_t *arena,
     const ac_mcp_config_t *config
 );
 
+/*============================================================================
+ * Shared HTTP Pool (mcp.c)
+ *============================================================================*/
+
+/**
+ * @brief HTTP client for one request
+ *
+ * A pooled transport borrows from the shared pool (ac_hosted), so MCP
+ * servers behind one gateway share its warm connections; otherwise own
+ * is returned.
+ *
+ * @return Client, NULL if the pool had none within the transport timeout
+ */
+arc_http_client_t *mcp_http_borrow(mcp_transport_t *t, arc_http_client_t *own);
+
+/**
+ * @brief Give back a client from mcp_http_borrow()
+ */
+void mcp_http_return(mcp_transport_t *t, arc_http_client_t *http);
+
+/**
+ * @brief The shared pool's engine, for requests that must not hold a thread
+ *
+ * @return Engine, NULL if the transport is not pooled or the pool has none
+ */
+arc_http_engine_t *mcp_http_engine(mcp_transport_t *t);
+
 /*============================================================================
  * Helper: Set Transport Error
  *============================================================================*/
@@ -130,6 +264,75 @@ static inline void mcp_transport_set_error(mcp_transport_t *t, const char *fmt,
     AC_LOG_ERROR("MCP transport: %s", t->error_msg);
 }
 
+/*============================================================================
+ * Helper: Cancellation and Deadline
+ *============================================================================*/
+
+static inline int mcp_transport_cancelled(const mcp_transport_t *t) {
+    return t->cancel && *t->cancel;
+}
+
+/**
+ * @brief Request timeout, cut to what is left before the deadline
+ */
+static inline uint32_t mcp_transport_timeout(const mcp_transport_t *t) {
+    if (t->deadline_ms == 0) {
+        return t->timeout_ms;
+    }
+    uint64_t now = ac_platform_timestamp_ms();
+    uint64_t left = now < t->deadline_ms ? t->deadline_ms - now : 1;
+    return left < t->timeout_ms ? (uint32_t)left : t->timeout_ms;
+}
+
+/**
+ * @brief pthread_cond_timedwait() that also watches the cancel flag
+ *
+ * With a flag set, wakes every MCP_CANCEL_POLL_MS to look at it; callers
+ * loop on their condition anyway.
+ *
+ * @return 0, ETIMEDOUT once deadline (CLOCK_REALTIME) passed, ECANCELED
+ */
+static inline int mcp_transport_wait(
+    const mcp_transport_t *t,
+    pthread_cond_t *cond,
+    pthread_mutex_t *mutex,
+    const struct timespec *deadline
+) {
+    if (mcp_transport_cancelled(t)) {
+        return ECANCELED;
+    }
+    if (!t->cancel) {
+        return pthread_cond_timedwait(cond, mutex, deadline);
+    }
+
+    struct timespec tick;
+    clock_gettime(CLOCK_REALTIME, &tick);
+    tick.tv_nsec += MCP_CANCEL_POLL_MS * 1000000L;
+    if (tick.tv_nsec >= 1000000000L) {
+        tick.tv_sec++;
+        tick.tv_nsec -= 1000000000L;
+    }
+    if (tick.tv_sec > deadline->tv_sec ||
+        (tick.tv_sec == deadline->tv_sec && tick.tv_nsec >= deadline->tv_nsec)) {
+        return pthread_cond_timedwait(cond, mutex, deadline);
+    }
+    int rc = pthread_cond_timedwait(cond, mutex, &tick);
+    return rc == ETIMEDOUT ? 0 : rc;
+}
+
+/*============================================================================
+ * Helper: Forward Server Notification
+ *============================================================================*/
+
+/**
+ * @brief Hand a server notification (a message with "method") to the client
+ */
+static inline void mcp_transport_notify(mcp_transport_t *t, const char *json, size_t len) {
+    if (t->on_notify) {
+        t->on_notify(t->notify_ctx, json, len);
+    }
+}
+
 /*============================================================================
  * Helper: Build HTTP Headers
  *============================================================================*/
@@ -8,13 +8,27 @@
  * 3. POST JSON-RPC requests to endpoint (returns 202 Accepted)
  * 4. Receive responses via the ORIGINAL SSE stream
  *
- * This implementation uses a background thread to maintain the SSE connection.
+ * With the shared HTTP pool the stream runs on the pool's engine like any
+ * other request: chunks are parsed on the engine's I/O thread (the host
+ * loop with an external_loop pool), and when the stream ends its
+ * completion submits the next one with the backoff as a start delay.
+ * Without an engine a background thread holds the stream on the
+ * transport's own client instead.
+ *
+ * Either way the reader reopens a dropped stream with exponential backoff,
+ * sending Last-Event-ID and Mcp-Session-Id so the server can resume the
+ * session. Requests still waiting then keep waiting if the stream carried
+ * event ids and the session was resumed; otherwise they fail at once
+ * instead of running into their timeout.
  */
 
 #include "mcp_internal.h"
 #include "arc/sse_parser.h"
+#include "json_scan.h"
+#include "agent_hooks_internal.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <time.h>
@@ -23,12 +37,27 @@
  * SSE Transport Structure
  *============================================================================*/
 
-#define SSE_MAX_PENDING_RESPONSES 16
+/* Pending requests: chained hash on the JSON-RPC id (power of two) */
+#define SSE_WAITER_BUCKETS 16
 
-typedef struct {
+/* Reconnect backoff: doubles from the base up to the cap, +-25% jitter */
+#define SSE_RECONNECT_BASE_MS 250
+#define SSE_RECONNECT_MAX_MS  30000
+
+/**
+ * @brief A request waiting for its response on the SSE stream
+ *
+ * Lives on the requester's stack; registered before the POST so a fast
+ * response cannot slip past it.
+ */
+typedef struct sse_waiter {
     int id;
-    char *json;
-} sse_pending_response_t;
+    char *json;                      /* Response, set by the reader */
+    int done;
+    int lost;                        /* Stream dropped, response will not come */
+    pthread_cond_t cond;
+    struct sse_waiter *next;         /* Bucket chain */
+} sse_waiter_t;
 
 typedef struct {
     mcp_transport_t base;
@@ -36,65 +65,341 @@ typedef struct {
     char *endpoint;
     char *base_url;
 
-    /* Background SSE thread */
+    /* Stream reader: on the pool's engine, or a background thread */
+    arc_http_engine_t *engine;       /* NULL = thread on base.http */
+    arc_http_transfer_t *stream;     /* Engine: open stream or pending reconnect (mutex) */
+    int stream_busy;                 /* Engine: a stream is still submitted (mutex) */
+    sse_parser_t parser;             /* Engine: parser of the current stream */
     pthread_t sse_thread;
     volatile int sse_running;
-    volatile int sse_connected;  /* 0=waiting, 1=connected, -1=error */
+    volatile int sse_connected;  /* 0=waiting/reconnecting, 1=connected, -1=error */
+    volatile int sse_stop;       /* Cancels the thread's stream request at shutdown */
 
-    /* HTTP client for POST requests (separate from SSE stream) */
+    /* HTTP client for POST requests (separate from SSE stream, NULL when
+     * POSTs borrow from the shared pool) */
     arc_http_client_t *post_http;
 
-    /* Response queue (protected by mutex) */
+    /* Pending requests and connection state changes (protected by mutex) */
     pthread_mutex_t mutex;
-    sse_pending_response_t responses[SSE_MAX_PENDING_RESPONSES];
-    volatile int response_count;
+    pthread_cond_t state_cond;       /* Signalled when sse_connected changes */
+    sse_waiter_t *waiters[SSE_WAITER_BUCKETS];
 
-    /* Error from SSE thread */
+    /* Error from the reader */
     char sse_error[256];
+
+    /* Reconnect state (reader only, except where noted) */
+    int ever_connected;              /* Endpoint received once: drops reconnect */
+    int reconnecting;                /* Stream lost, no endpoint yet (mutex) */
+    int stream_has_ids;              /* Current stream carries event ids */
+    int attempt;                     /* Failed reconnects since the loss */
+    uint64_t lost_at_ms;
+    unsigned jitter_seed;
+    char last_event_id[128];
+    char session_id[128];            /* Mcp-Session-Id from the server (mutex) */
+
+    /* Reconnect policy */
+    uint32_t max_backoff_ms;
+    int fail_fast;                   /* Fail calls while reconnecting */
 } mcp_sse_transport_t;
 
 /*============================================================================
- * SSE Event Handler (called from background thread)
+ * Pending Requests (caller holds mutex)
+ *============================================================================*/
+
+static sse_waiter_t **waiter_bucket(mcp_sse_transport_t *sse, int id) {
+    return &sse->waiters[(unsigned)id & (SSE_WAITER_BUCKETS - 1)];
+}
+
+static void waiter_add(mcp_sse_transport_t *sse, sse_waiter_t *w) {
+    sse_waiter_t **bucket = waiter_bucket(sse, w->id);
+    w->next = *bucket;
+    *bucket = w;
+}
+
+/**
+ * @brief Unlink the waiter for id, NULL if nobody waits for it
+ */
+static sse_waiter_t *waiter_take(mcp_sse_transport_t *sse, int id) {
+    for (sse_waiter_t **link = waiter_bucket(sse, id); *link; link = &(*link)->next) {
+        sse_waiter_t *w = *link;
+        if (w->id == id) {
+            *link = w->next;
+            w->next = NULL;
+            return w;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Record a connection state change and wake everyone waiting
+ */
+static void sse_set_state(mcp_sse_transport_t *sse, int state) {
+    pthread_mutex_lock(&sse->mutex);
+    sse->sse_connected = state;
+    pthread_cond_broadcast(&sse->state_cond);
+    for (size_t i = 0; i < SSE_WAITER_BUCKETS; i++) {
+        for (sse_waiter_t *w = sse->waiters[i]; w; w = w->next) {
+            pthread_cond_signal(&w->cond);
+        }
+    }
+    pthread_mutex_unlock(&sse->mutex);
+}
+
+/**
+ * @brief Fail every pending request (caller holds mutex)
+ */
+static void waiters_mark_lost(mcp_sse_transport_t *sse) {
+    for (size_t i = 0; i < SSE_WAITER_BUCKETS; i++) {
+        for (sse_waiter_t *w = sse->waiters[i]; w; w = w->next) {
+            w->lost = 1;
+        }
+    }
+}
+
+static void timespec_after(struct timespec *ts, uint32_t ms) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t ns = (uint64_t)now.tv_nsec + (uint64_t)ms * 1000000;
+    ts->tv_sec = now.tv_sec + ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
+/*============================================================================
+ * Session Headers
+ *============================================================================*/
+
+/**
+ * @brief Remember the Mcp-Session-Id a response carried
+ */
+static void sse_note_session(mcp_sse_transport_t *sse, const arc_http_header_t *headers) {
+    const arc_http_header_t *sid = arc_http_header_find(headers, "Mcp-Session-Id");
+    if (!sid || !sid->value) {
+        return;
+    }
+    pthread_mutex_lock(&sse->mutex);
+    snprintf(sse->session_id, sizeof(sse->session_id), "%s", sid->value);
+    pthread_mutex_unlock(&sse->mutex);
+}
+
+/**
+ * @brief Request headers, with the session id and (stream only) resume point
+ */
+static arc_http_header_t *sse_build_headers(
+    mcp_sse_transport_t *sse,
+    const char *content_type,
+    int stream
+) {
+    arc_http_header_t *headers = mcp_build_headers(&sse->base, content_type, "text/event-stream");
+
+    pthread_mutex_lock(&sse->mutex);
+    if (sse->session_id[0]) {
+        arc_http_header_append(&headers, arc_http_header_create("Mcp-Session-Id", sse->session_id));
+    }
+    pthread_mutex_unlock(&sse->mutex);
+
+    if (stream && sse->last_event_id[0]) {
+        arc_http_header_append(&headers, arc_http_header_create("Last-Event-ID", sse->last_event_id));
+    }
+    return headers;
+}
+
+/*============================================================================
+ * Reconnect
+ *============================================================================*/
+
+/**
+ * @brief Report a connection event to the log and the hooks
+ */
+static void sse_report(mcp_sse_transport_t *sse, ac_mcp_conn_event_t event,
+                       uint32_t delay_ms, int resumed) {
+    ac_hook_mcp_connection_t info = {
+        .server_url = sse->base.server_url,
+        .event = event,
+        .attempt = sse->attempt,
+        .delay_ms = delay_ms,
+        .resumed = resumed,
+    };
+
+    switch (event) {
+        case AC_MCP_CONN_LOST:
+            info.error = sse->sse_error;
+            AC_LOG_WARN("SSE: %s, reconnecting in %ums", sse->sse_error, delay_ms);
+            break;
+        case AC_MCP_CONN_RETRY:
+            info.error = sse->sse_error;
+            AC_LOG_DEBUG("SSE: reconnect attempt %d failed (%s), next in %ums",
+                         sse->attempt, sse->sse_error, delay_ms);
+            break;
+        case AC_MCP_CONN_RESTORED:
+            info.downtime_ms = ac_platform_timestamp_ms() - sse->lost_at_ms;
+            AC_LOG_INFO("SSE: stream restored after %llums (%s)",
+                        (unsigned long long)info.downtime_ms,
+                        resumed ? "session resumed" : "new session");
+            break;
+    }
+
+    AC_HOOK_CALL(NULL, ac_hook_call_mcp_connection, &info);
+}
+
+/**
+ * @brief Delay before reconnect attempt n (0 = right after the loss)
+ */
+static uint32_t sse_backoff_ms(mcp_sse_transport_t *sse, int attempt) {
+    uint64_t delay = (uint64_t)SSE_RECONNECT_BASE_MS << (attempt < 16 ? attempt : 16);
+    if (delay > sse->max_backoff_ms) {
+        delay = sse->max_backoff_ms;
+    }
+    /* Jitter, so clients of a restarted gateway do not return in lockstep */
+    uint64_t span = delay / 2;
+    if (span > 0) {
+        delay = delay - delay / 4 + (uint64_t)rand_r(&sse->jitter_seed) % (span + 1);
+    }
+    return (uint32_t)delay;
+}
+
+/**
+ * @brief Sleep for the backoff, returning early at shutdown
+ */
+static void sse_backoff_wait(mcp_sse_transport_t *sse, uint32_t ms) {
+    struct timespec deadline;
+    timespec_after(&deadline, ms);
+
+    pthread_mutex_lock(&sse->mutex);
+    while (sse->sse_running) {
+        if (pthread_cond_timedwait(&sse->state_cond, &sse->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sse->mutex);
+}
+
+/**
+ * @brief The stream of an established connection ended
+ *
+ * Pending requests can only still be answered if the server numbers its
+ * events (and so can replay them); otherwise they fail now.
+ */
+static void sse_stream_lost(mcp_sse_transport_t *sse) {
+    pthread_mutex_lock(&sse->mutex);
+    sse->reconnecting = 1;
+    if (!sse->stream_has_ids) {
+        waiters_mark_lost(sse);
+    }
+    pthread_mutex_unlock(&sse->mutex);
+
+    sse->attempt = 0;
+    sse->lost_at_ms = ac_platform_timestamp_ms();
+    sse_set_state(sse, 0);
+}
+
+/**
+ * @brief Record why a stream ended and pick the delay before the next one
+ */
+static uint32_t sse_stream_ended(mcp_sse_transport_t *sse, arc_err_t err,
+                                 const arc_http_response_t *resp) {
+    if (err != ARC_OK) {
+        snprintf(sse->sse_error, sizeof(sse->sse_error),
+                 "SSE connection failed: %s",
+                 resp->error_msg ? resp->error_msg : ac_strerror(err));
+    } else {
+        snprintf(sse->sse_error, sizeof(sse->sse_error),
+                 "SSE stream closed by server (status %d)", resp->status_code);
+    }
+
+    uint32_t delay_ms;
+    if (!sse->ever_connected) {
+        /* Still connecting: sse_connect() gives up on the error */
+        AC_LOG_WARN("SSE: %s", sse->sse_error);
+        sse_set_state(sse, -1);
+        delay_ms = sse_backoff_ms(sse, 2);
+    } else if (sse->sse_connected == 1) {
+        sse_stream_lost(sse);
+        delay_ms = sse_backoff_ms(sse, 0);
+        sse_report(sse, AC_MCP_CONN_LOST, delay_ms, 0);
+    } else {
+        sse->attempt++;
+        delay_ms = sse_backoff_ms(sse, sse->attempt);
+        sse_report(sse, AC_MCP_CONN_RETRY, delay_ms, 0);
+    }
+    return delay_ms;
+}
+
+/*============================================================================
+ * SSE Event Handler (called from the reader)
  *============================================================================*/
 
 static int sse_on_event(const sse_event_t *event, void *user_data) {
     mcp_sse_transport_t *sse = (mcp_sse_transport_t *)user_data;
 
-    AC_LOG_DEBUG("SSE event: type=%s, data=%.60s%s",
-                 event->event ? event->event : "(none)",
-                 event->data ? event->data : "(none)",
-                 (event->data && strlen(event->data) > 60) ? "..." : "");
+    AC_LOG_DEBUG("SSE event: type=%.*s, data=%.*s%s",
+                 (int)event->event_len, event->event,
+                 (int)(event->data_len > 60 ? 60 : event->data_len), event->data,
+                 event->data_len > 60 ? "..." : "");
+
+    /* Resume point for a reconnect */
+    if (event->id && event->id_len > 0 && event->id_len < sizeof(sse->last_event_id)) {
+        memcpy(sse->last_event_id, event->id, event->id_len);
+        sse->last_event_id[event->id_len] = '\0';
+        sse->stream_has_ids = 1;
+    }
 
     /* endpoint event */
-    if (event->event && strcmp(event->event, "endpoint") == 0 && event->data) {
+    if (event->event_len == 8 && memcmp(event->event, "endpoint", 8) == 0) {
         pthread_mutex_lock(&sse->mutex);
+        int restored = sse->reconnecting;
+        int resumed = restored && sse->last_event_id[0] && sse->endpoint &&
+                      strlen(sse->endpoint) == event->data_len &&
+                      memcmp(sse->endpoint, event->data, event->data_len) == 0;
+        if (restored && !resumed) {
+            /* New session: responses owed by the old one will not come */
+            waiters_mark_lost(sse);
+        }
         if (sse->endpoint) ARC_FREE(sse->endpoint);
-        sse->endpoint = ARC_STRDUP(event->data);
-        sse->sse_connected = 1;
+        sse->endpoint = ARC_STRNDUP(event->data, event->data_len);
+        sse->reconnecting = 0;
         pthread_mutex_unlock(&sse->mutex);
+
+        sse->ever_connected = 1;
+        sse_set_state(sse, 1);
         AC_LOG_INFO("SSE: endpoint = %s", sse->endpoint);
+        if (restored) {
+            sse_report(sse, AC_MCP_CONN_RESTORED, 0, resumed);
+            sse->attempt = 0;
+        }
         return 0;
     }
 
-    /* message event - JSON-RPC response */
+    /* message event - JSON-RPC response, handed to whoever waits for its id */
     if (event->data) {
-        cJSON *json = cJSON_Parse(event->data);
-        if (json) {
-            cJSON *jsonrpc = cJSON_GetObjectItem(json, "jsonrpc");
-            if (jsonrpc) {
-                cJSON *id_json = cJSON_GetObjectItem(json, "id");
-                int resp_id = id_json ? (int)cJSON_GetNumberValue(id_json) : 0;
-
-                pthread_mutex_lock(&sse->mutex);
-                if (sse->response_count < SSE_MAX_PENDING_RESPONSES) {
-                    sse->responses[sse->response_count].id = resp_id;
-                    sse->responses[sse->response_count].json = ARC_STRDUP(event->data);
-                    sse->response_count++;
-                    AC_LOG_DEBUG("SSE: queued response id=%d", resp_id);
-                }
-                pthread_mutex_unlock(&sse->mutex);
+        ac_json_span_t root = ac_json_scan_root(event->data, event->data_len);
+        if (ac_json_scan_get(root, "method").kind != AC_JSON_NONE) {
+            /* From the server: notifications go to the client, requests
+             * must not be taken for a response with the same id */
+            if (ac_json_scan_get(root, "id").kind == AC_JSON_NONE) {
+                mcp_transport_notify(&sse->base, event->data, event->data_len);
+            } else {
+                AC_LOG_DEBUG("SSE: server request ignored");
+            }
+        } else if (ac_json_scan_get(root, "jsonrpc").kind != AC_JSON_NONE) {
+            int resp_id = 0;
+            ac_json_scan_int(ac_json_scan_get(root, "id"), &resp_id);
+
+            pthread_mutex_lock(&sse->mutex);
+            sse_waiter_t *w = waiter_take(sse, resp_id);
+            if (w) {
+                w->json = ARC_STRNDUP(event->data, event->data_len);
+                w->done = 1;
+                pthread_cond_signal(&w->cond);
+            }
+            pthread_mutex_unlock(&sse->mutex);
+
+            if (w) {
+                AC_LOG_DEBUG("SSE: delivered response id=%d", resp_id);
+            } else {
+                AC_LOG_DEBUG("SSE: no pending request for id=%d, dropped", resp_id);
             }
-            cJSON_Delete(json);
         }
     }
 
@@ -131,9 +436,10 @@ static void *sse_thread_func(void *arg) {
         sse_thread_ctx_t ctx = {0};
         ctx.sse = sse;
         sse_parser_init(&ctx.parser, sse_on_event, sse);
+        sse->stream_has_ids = 0;
 
-        /* Build headers */
-        arc_http_header_t *headers = mcp_build_headers(&sse->base, NULL, "text/event-stream");
+        /* Build headers (resume point and session on reconnects) */
+        arc_http_header_t *headers = sse_build_headers(sse, NULL, 1);
 
         arc_http_stream_request_t req = {
             .base = {
@@ -141,7 +447,8 @@ static void *sse_thread_func(void *arg) {
                 .method = ARC_HTTP_GET,
                 .headers = headers,
                 .timeout_ms = 0,  /* No timeout - keep connection open */
-                .verify_ssl = sse->base.verify_ssl
+                .verify_ssl = sse->base.verify_ssl,
+                .cancel = &sse->sse_stop
             },
             .on_data = sse_stream_callback,
             .user_data = &ctx
@@ -155,42 +462,153 @@ static void *sse_thread_func(void *arg) {
 
         arc_http_header_free(headers);
         sse_parser_free(&ctx.parser);
-
-        arc_http_response_free(&resp);
+        sse_note_session(sse, resp.headers);
 
         /* If we're shutting down, exit cleanly */
         if (!sse->sse_running) {
+            arc_http_response_free(&resp);
             break;
         }
 
-        if (err != ARC_OK) {
-            snprintf(sse->sse_error, sizeof(sse->sse_error),
-                     "SSE connection failed: %s",
-                     resp.error_msg ? resp.error_msg : ac_strerror(err));
-
-            /* Timeout during idle is normal for long-running connections.
-             * Log as DEBUG since we will automatically reconnect. */
-            if (err == ARC_ERR_TIMEOUT) {
-                AC_LOG_DEBUG("SSE: connection timeout, will reconnect");
-            } else {
-                AC_LOG_WARN("SSE: %s (will reconnect)", sse->sse_error);
-            }
-
-            /* Signal temporary error but keep running for reconnect */
-            sse->sse_connected = -1;
-        }
+        uint32_t delay_ms = sse_stream_ended(sse, err, &resp);
+        arc_http_response_free(&resp);
 
-        /* Reconnect delay if still running */
-        if (sse->sse_running) {
-            AC_LOG_DEBUG("SSE thread: reconnecting in 1s...");
-            sleep(1);
-        }
+        sse_backoff_wait(sse, delay_ms);
     }
 
+    /* Wake requests still waiting: nothing will arrive for them now */
+    sse_set_state(sse, sse->sse_connected);
+
     AC_LOG_DEBUG("SSE thread exiting");
     return NULL;
 }
 
+/*============================================================================
+ * SSE Stream on the Engine
+ *============================================================================*/
+
+static int sse_engine_data(const char *data, size_t len, void *user_data) {
+    mcp_sse_transport_t *sse = (mcp_sse_transport_t *)user_data;
+    sse_parser_feed(&sse->parser, data, len);
+    return sse->sse_running ? 0 : 1;
+}
+
+static void sse_engine_done(arc_http_transfer_t *transfer, void *user_data);
+
+/**
+ * @brief Submit the stream request, to start after delay_ms
+ *
+ * @return 0 if the engine took no request (it is shutting down)
+ */
+static int sse_engine_open(mcp_sse_transport_t *sse, uint32_t delay_ms) {
+    sse_parser_init(&sse->parser, sse_on_event, sse);
+    sse->stream_has_ids = 0;
+
+    /* Build headers (resume point and session on reconnects) */
+    arc_http_header_t *headers = sse_build_headers(sse, NULL, 1);
+
+    arc_http_stream_request_t req = {
+        .base = {
+            .url = sse->base.server_url,
+            .method = ARC_HTTP_GET,
+            .headers = headers,
+            .timeout_ms = 0,  /* No timeout - keep connection open */
+            .verify_ssl = sse->base.verify_ssl,
+            .start_delay_ms = delay_ms
+        },
+        .on_data = sse_engine_data,
+        .user_data = sse
+    };
+
+    AC_LOG_DEBUG("SSE: connecting to %s in %ums", sse->base.server_url, delay_ms);
+
+    /* Held across the submit so the completion cannot run before we know
+     * the transfer; a stop in the meantime cancels it right here */
+    pthread_mutex_lock(&sse->mutex);
+    arc_err_t err = arc_http_submit_stream(sse->engine, &req, sse_engine_done, sse,
+                                           &sse->stream);
+    if (err == ARC_OK && !sse->sse_running) {
+        arc_http_transfer_cancel(sse->stream);
+    }
+    pthread_mutex_unlock(&sse->mutex);
+    arc_http_header_free(headers);
+
+    if (err != ARC_OK) {
+        sse_parser_free(&sse->parser);
+        snprintf(sse->sse_error, sizeof(sse->sse_error),
+                 "SSE connection failed: %s", ac_strerror(err));
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief A stream (or the wait before it) ended: reconnect or wind down
+ *
+ * Runs on the engine's I/O thread, so it never waits: the backoff is the
+ * next request's start delay.
+ */
+static void sse_engine_done(arc_http_transfer_t *transfer, void *user_data) {
+    mcp_sse_transport_t *sse = (mcp_sse_transport_t *)user_data;
+
+    arc_http_response_t resp = {0};
+    arc_err_t err = arc_http_transfer_wait(transfer, &resp);
+
+    pthread_mutex_lock(&sse->mutex);
+    sse->stream = NULL;
+    pthread_mutex_unlock(&sse->mutex);
+    arc_http_transfer_release(transfer);
+
+    sse_parser_free(&sse->parser);
+    sse_note_session(sse, resp.headers);
+
+    int again = sse->sse_running;
+    if (again) {
+        again = sse_engine_open(sse, sse_stream_ended(sse, err, &resp));
+    }
+    arc_http_response_free(&resp);
+    if (again) {
+        return;
+    }
+
+    /* Wake requests still waiting: nothing will arrive for them now */
+    pthread_mutex_lock(&sse->mutex);
+    sse->sse_running = 0;
+    pthread_mutex_unlock(&sse->mutex);
+    sse_set_state(sse, sse->sse_connected);
+
+    /* sse_stop_reader() may free the transport once this drops */
+    pthread_mutex_lock(&sse->mutex);
+    sse->stream_busy = 0;
+    pthread_cond_broadcast(&sse->state_cond);
+    pthread_mutex_unlock(&sse->mutex);
+}
+
+/**
+ * @brief Stop the reader, interrupting a backoff or an idle stream
+ *
+ * On the engine this waits for the stream's completion, so with an
+ * external_loop pool it must not be called from the loop thread.
+ */
+static void sse_stop_reader(mcp_sse_transport_t *sse) {
+    pthread_mutex_lock(&sse->mutex);
+    sse->sse_running = 0;
+    sse->sse_stop = 1;
+    pthread_cond_broadcast(&sse->state_cond);
+    if (!sse->engine) {
+        pthread_mutex_unlock(&sse->mutex);
+        pthread_join(sse->sse_thread, NULL);
+        return;
+    }
+    if (sse->stream) {
+        arc_http_transfer_cancel(sse->stream);
+    }
+    while (sse->stream_busy) {
+        pthread_cond_wait(&sse->state_cond, &sse->mutex);
+    }
+    pthread_mutex_unlock(&sse->mutex);
+}
+
 /*============================================================================
  * Helper: Extract Base URL
  *============================================================================*/
@@ -229,37 +647,57 @@ static arc_err_t sse_connect(mcp_transport_t *t) {
 
     /* Initialize synchronization */
     pthread_mutex_init(&sse->mutex, NULL);
+    pthread_cond_init(&sse->state_cond, NULL);
+    memset(sse->waiters, 0, sizeof(sse->waiters));
 
-    /* Start background thread */
+    /* Start the reader */
     sse->sse_running = 1;
     sse->sse_connected = 0;
-
-    if (pthread_create(&sse->sse_thread, NULL, sse_thread_func, sse) != 0) {
+    sse->sse_stop = 0;
+    sse->ever_connected = 0;
+    sse->reconnecting = 0;
+
+    sse->engine = mcp_http_engine(t);
+    if (sse->engine) {
+        sse->stream_busy = 1;
+        if (!sse_engine_open(sse, 0)) {
+            mcp_transport_set_error(t, "%s", sse->sse_error);
+            sse->stream_busy = 0;
+            sse->sse_running = 0;
+            return ARC_ERR_NOT_CONNECTED;
+        }
+    } else if (!t->http) {
+        mcp_transport_set_error(t, "No HTTP client for the SSE stream");
+        sse->sse_running = 0;
+        return ARC_ERR_NOT_CONNECTED;
+    } else if (pthread_create(&sse->sse_thread, NULL, sse_thread_func, sse) != 0) {
         mcp_transport_set_error(t, "Failed to create SSE thread");
         sse->sse_running = 0;
         return ARC_ERR_MEMORY;
     }
 
-    /* Wait for endpoint (polling) */
-    uint32_t elapsed = 0;
-    uint32_t poll_interval = 50;  /* 50ms */
+    /* Wait for the endpoint event (or a connection error) */
+    struct timespec deadline;
+    timespec_after(&deadline, t->timeout_ms);
 
-    while (sse->sse_connected == 0 && elapsed < t->timeout_ms) {
-        usleep(poll_interval * 1000);
-        elapsed += poll_interval;
+    pthread_mutex_lock(&sse->mutex);
+    while (sse->sse_connected == 0) {
+        if (pthread_cond_timedwait(&sse->state_cond, &sse->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
     }
+    int state = sse->sse_connected;
+    pthread_mutex_unlock(&sse->mutex);
 
-    if (sse->sse_connected == 0) {
+    if (state == 0) {
         mcp_transport_set_error(t, "Timeout waiting for SSE endpoint");
-        sse->sse_running = 0;
-        pthread_join(sse->sse_thread, NULL);
+        sse_stop_reader(sse);
         return ARC_ERR_TIMEOUT;
     }
 
-    if (sse->sse_connected < 0) {
+    if (state < 0) {
         mcp_transport_set_error(t, "%s", sse->sse_error);
-        sse->sse_running = 0;
-        pthread_join(sse->sse_thread, NULL);
+        sse_stop_reader(sse);
         return ARC_ERR_HTTP;
     }
 
@@ -269,35 +707,50 @@ static arc_err_t sse_connect(mcp_transport_t *t) {
     return ARC_OK;
 }
 
-static arc_err_t sse_request(
-    mcp_transport_t *t,
-    const char *request_json,
-    int request_id,
-    char **response_json
-) {
-    mcp_sse_transport_t *sse = (mcp_sse_transport_t *)t;
-
-    if (!t->connected || !sse->endpoint) {
-        mcp_transport_set_error(t, "Not connected");
-        return ARC_ERR_NOT_CONNECTED;
+/**
+ * @brief Unregister a waiter (if still pending) and release its condition
+ *
+ * Afterwards the reader can no longer deliver to it; a response that
+ * arrived in the meantime is left in w->json.
+ */
+static void sse_waiter_finish(mcp_sse_transport_t *sse, sse_waiter_t *w) {
+    pthread_mutex_lock(&sse->mutex);
+    if (!w->done) {
+        waiter_take(sse, w->id);
     }
+    pthread_mutex_unlock(&sse->mutex);
+    pthread_cond_destroy(&w->cond);
+}
 
-    /* Build full endpoint URL */
+/**
+ * @brief POST one message to the endpoint
+ *
+ * @param direct  Output: JSON-RPC response returned in the POST body, if
+ *                the server answers that way (caller frees)
+ */
+static arc_err_t sse_post(mcp_sse_transport_t *sse, const char *request_json, char **direct) {
+    mcp_transport_t *t = &sse->base;
+    *direct = NULL;
+
+    /* Build full endpoint URL (a reconnect may replace the endpoint) */
     char *full_url;
-    if (sse->endpoint[0] == '/') {
+    pthread_mutex_lock(&sse->mutex);
+    if (!sse->endpoint) {
+        full_url = NULL;
+    } else if (sse->endpoint[0] == '/') {
         size_t len = strlen(sse->base_url) + strlen(sse->endpoint) + 1;
         full_url = (char *)ARC_MALLOC(len);
-        if (!full_url) return ARC_ERR_MEMORY;
-        snprintf(full_url, len, "%s%s", sse->base_url, sse->endpoint);
+        if (full_url) snprintf(full_url, len, "%s%s", sse->base_url, sse->endpoint);
     } else {
         full_url = ARC_STRDUP(sse->endpoint);
-        if (!full_url) return ARC_ERR_MEMORY;
     }
+    pthread_mutex_unlock(&sse->mutex);
+    if (!full_url) return ARC_ERR_MEMORY;
 
-    AC_LOG_DEBUG("SSE POST: %s (id=%d)", full_url, request_id);
+    AC_LOG_DEBUG("SSE POST: %s", full_url);
 
     /* Build headers */
-    arc_http_header_t *headers = mcp_build_headers(t, "application/json", "text/event-stream");
+    arc_http_header_t *headers = sse_build_headers(sse, "application/json", 0);
 
     /* POST request */
     arc_http_request_t req = {
@@ -306,12 +759,18 @@ static arc_err_t sse_request(
         .headers = headers,
         .body = request_json,
         .body_len = strlen(request_json),
-        .timeout_ms = t->timeout_ms,
-        .verify_ssl = t->verify_ssl
+        .timeout_ms = mcp_transport_timeout(t),
+        .verify_ssl = t->verify_ssl,
+        .cancel = t->cancel
     };
 
     arc_http_response_t resp = {0};
-    arc_err_t err = arc_http_request(sse->post_http, &req, &resp);
+    arc_err_t err = ARC_ERR_TIMEOUT;
+    arc_http_client_t *http = mcp_http_borrow(t, sse->post_http);
+    if (http) {
+        err = arc_http_request(http, &req, &resp);
+        mcp_http_return(t, http);
+    }
 
     arc_http_header_free(headers);
     ARC_FREE(full_url);
@@ -324,91 +783,216 @@ static arc_err_t sse_request(
     }
 
     AC_LOG_DEBUG("SSE POST response: status=%d", resp.status_code);
+    sse_note_session(sse, resp.headers);
 
     /* Some servers return response directly in POST body */
-    if (resp.body && resp.body_len > 0) {
-        cJSON *json = cJSON_Parse(resp.body);
-        if (json) {
-            cJSON *jsonrpc = cJSON_GetObjectItem(json, "jsonrpc");
-            if (jsonrpc) {
-                AC_LOG_DEBUG("SSE: Got direct JSON response in POST body");
-                *response_json = ARC_STRDUP(resp.body);
-                cJSON_Delete(json);
-                arc_http_response_free(&resp);
-                return *response_json ? ARC_OK : ARC_ERR_MEMORY;
-            }
-            cJSON_Delete(json);
-        }
+    if (resp.body && resp.body_len > 0 &&
+        ac_json_scan_get(ac_json_scan_root(resp.body, resp.body_len), "jsonrpc").kind != AC_JSON_NONE) {
+        AC_LOG_DEBUG("SSE: Got direct JSON response in POST body");
+        *direct = resp.body;
+        resp.body = NULL;
     }
 
     arc_http_response_free(&resp);
+    return ARC_OK;
+}
 
-    /* For notifications (request_id == 0), no response is expected */
-    if (request_id == 0) {
-        AC_LOG_DEBUG("SSE: Notification sent (no response expected)");
-        *response_json = NULL;
+/**
+ * @brief Wait until the stream is up, queueing behind a reconnect
+ *
+ * Gives up after the request timeout, or at once with fail_fast.
+ */
+static arc_err_t sse_wait_stream(mcp_sse_transport_t *sse) {
+    mcp_transport_t *t = &sse->base;
+
+    if (!t->connected) {
+        mcp_transport_set_error(t, "Not connected");
+        return ARC_ERR_NOT_CONNECTED;
+    }
+
+    struct timespec deadline;
+    timespec_after(&deadline, mcp_transport_timeout(t));
+
+    pthread_mutex_lock(&sse->mutex);
+    int rc = 0;
+    while (sse->sse_connected != 1 && sse->sse_running && !sse->fail_fast && rc == 0) {
+        rc = mcp_transport_wait(t, &sse->state_cond, &sse->mutex, &deadline);
+    }
+    int up = sse->sse_connected == 1 && sse->sse_running;
+    pthread_mutex_unlock(&sse->mutex);
+
+    if (up) {
         return ARC_OK;
     }
+    if (rc == ECANCELED) {
+        mcp_transport_set_error(t, "Request cancelled");
+        return ARC_ERR_CANCELLED;
+    }
+    if (rc == ETIMEDOUT) {
+        mcp_transport_set_error(t, "Timeout waiting for SSE reconnect");
+        return ARC_ERR_TIMEOUT;
+    }
+    mcp_transport_set_error(t, "SSE stream reconnecting");
+    return ARC_ERR_NOT_CONNECTED;
+}
 
-    /* Wait for response via SSE stream (polling) */
-    AC_LOG_DEBUG("SSE: Waiting for response id=%d via SSE stream...", request_id);
+/**
+ * @brief POST requests back to back, then wait for all their responses
+ *
+ * Waiters are registered before the first POST, so responses may arrive
+ * in any order and while later requests are still being sent.
+ */
+static arc_err_t sse_exchange(
+    mcp_transport_t *t,
+    const char *const *requests_json,
+    const int *request_ids,
+    size_t count,
+    char **responses_json
+) {
+    mcp_sse_transport_t *sse = (mcp_sse_transport_t *)t;
 
-    uint32_t elapsed = 0;
-    uint32_t poll_interval = 50;  /* 50ms */
+    sse_waiter_t waiters[MCP_MAX_BATCH];
+    if (count > MCP_MAX_BATCH) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    arc_err_t err = sse_wait_stream(sse);
+    if (err != ARC_OK) {
+        for (size_t i = 0; i < count; i++) {
+            responses_json[i] = NULL;
+        }
+        return err;
+    }
+
+    /* Register before sending: a response may beat its POST's return */
+    pthread_mutex_lock(&sse->mutex);
+    for (size_t i = 0; i < count; i++) {
+        memset(&waiters[i], 0, sizeof(waiters[i]));
+        waiters[i].id = request_ids[i];
+        pthread_cond_init(&waiters[i].cond, NULL);
+        waiter_add(sse, &waiters[i]);
+    }
+    pthread_mutex_unlock(&sse->mutex);
+
+    for (size_t i = 0; i < count && err == ARC_OK; i++) {
+        char *direct = NULL;
+        err = sse_post(sse, requests_json[i], &direct);
+        if (direct) {
+            pthread_mutex_lock(&sse->mutex);
+            if (!waiters[i].done) {
+                waiter_take(sse, waiters[i].id);
+                waiters[i].json = direct;
+                waiters[i].done = 1;
+                direct = NULL;
+            }
+            pthread_mutex_unlock(&sse->mutex);
+            if (direct) ARC_FREE(direct);
+        }
+    }
+
+    /* Wait for the reader to deliver the responses */
+    int lost = 0;
+    int cancelled = 0;
+    if (err == ARC_OK) {
+        AC_LOG_DEBUG("SSE: Waiting for %zu response(s) via SSE stream...", count);
+
+        struct timespec deadline;
+        timespec_after(&deadline, mcp_transport_timeout(t));
 
-    while (elapsed < t->timeout_ms) {
-        /* Check for matching response */
         pthread_mutex_lock(&sse->mutex);
-        for (int i = 0; i < sse->response_count; i++) {
-            if (sse->responses[i].id == request_id) {
-                *response_json = sse->responses[i].json;
-                sse->responses[i].json = NULL;
-
-                /* Remove from queue */
-                for (int j = i; j < sse->response_count - 1; j++) {
-                    sse->responses[j] = sse->responses[j + 1];
+        for (size_t i = 0; i < count && !lost && !cancelled; i++) {
+            int timed_out = 0;
+            while (!waiters[i].done && !timed_out) {
+                if (!sse->sse_running || waiters[i].lost) {
+                    lost = 1;
+                    break;
+                }
+                int rc = mcp_transport_wait(t, &waiters[i].cond, &sse->mutex, &deadline);
+                timed_out = rc == ETIMEDOUT;
+                if (rc == ECANCELED) {
+                    cancelled = 1;
+                    break;
                 }
-                sse->response_count--;
-
-                pthread_mutex_unlock(&sse->mutex);
-                AC_LOG_DEBUG("SSE: Got response id=%d", request_id);
-                return ARC_OK;
+            }
+            if (timed_out) {
+                break;
             }
         }
         pthread_mutex_unlock(&sse->mutex);
+    }
 
-        /* Check if SSE thread died */
-        if (!sse->sse_running || sse->sse_connected < 0) {
-            mcp_transport_set_error(t, "SSE connection lost");
-            return ARC_ERR_NOT_CONNECTED;
+    int missing = 0;
+    for (size_t i = 0; i < count; i++) {
+        sse_waiter_finish(sse, &waiters[i]);
+        responses_json[i] = waiters[i].json;
+        if (!waiters[i].json) {
+            missing++;
         }
+    }
 
-        usleep(poll_interval * 1000);
-        elapsed += poll_interval;
+    if (err != ARC_OK) {
+        return err;
+    }
+    if (missing == 0) {
+        return ARC_OK;
+    }
+
+    if (lost) {
+        mcp_transport_set_error(t, "SSE connection lost");
+        err = ARC_ERR_NOT_CONNECTED;
+    } else if (cancelled) {
+        mcp_transport_set_error(t, "Request cancelled");
+        err = ARC_ERR_CANCELLED;
+    } else {
+        mcp_transport_set_error(t, "Timeout waiting for %d of %zu response(s)", missing, count);
+        err = ARC_ERR_TIMEOUT;
     }
 
-    mcp_transport_set_error(t, "Timeout waiting for response id=%d", request_id);
-    return ARC_ERR_TIMEOUT;
+    /* A lone request reports its failure; a batch keeps what arrived */
+    if (count == 1) {
+        return err;
+    }
+    return ARC_OK;
 }
 
-static void sse_disconnect(mcp_transport_t *t) {
+static arc_err_t sse_request(
+    mcp_transport_t *t,
+    const char *request_json,
+    int request_id,
+    char **response_json
+) {
     mcp_sse_transport_t *sse = (mcp_sse_transport_t *)t;
 
-    if (sse->sse_running) {
-        sse->sse_running = 0;
-        pthread_join(sse->sse_thread, NULL);
+    /* For notifications (request_id == 0), no response is expected */
+    if (request_id == 0) {
+        *response_json = NULL;
+        arc_err_t err = sse_wait_stream(sse);
+        if (err != ARC_OK) {
+            return err;
+        }
+        char *direct = NULL;
+        err = sse_post(sse, request_json, &direct);
+        if (direct) ARC_FREE(direct);
+        AC_LOG_DEBUG("SSE: Notification sent (no response expected)");
+        return err;
     }
 
-    /* Cleanup responses */
+    return sse_exchange(t, &request_json, &request_id, 1, response_json);
+}
+
+static void sse_disconnect(mcp_transport_t *t) {
+    mcp_sse_transport_t *sse = (mcp_sse_transport_t *)t;
+
+    /* An engine reader that wound down on its own may still be finishing */
     pthread_mutex_lock(&sse->mutex);
-    for (int i = 0; i < sse->response_count; i++) {
-        if (sse->responses[i].json) {
-            ARC_FREE(sse->responses[i].json);
-        }
-    }
-    sse->response_count = 0;
+    int stop = sse->sse_running || sse->stream_busy;
     pthread_mutex_unlock(&sse->mutex);
+    if (stop) {
+        sse_stop_reader(sse);
+    }
 
+    /* Requests are serialized by the client and never outlive a disconnect */
+    pthread_cond_destroy(&sse->state_cond);
     pthread_mutex_destroy(&sse->mutex);
 
     t->connected = 0;
@@ -438,6 +1022,7 @@ static void sse_destroy(mcp_transport_t *t) {
 static const mcp_transport_ops_t sse_ops = {
     .connect = sse_connect,
     .request = sse_request,
+    .request_batch = sse_exchange,
     .disconnect = sse_disconnect,
     .destroy = sse_destroy
 };
@@ -449,6 +1034,7 @@ static const mcp_transport_ops_t sse_ops = {
 mcp_transport_t *mcp_sse_create(
     arena_t *arena,
     arc_http_client_t *http,
+    int pooled,
     const ac_mcp_config_t *config
 ) {
     mcp_sse_transport_t *t = (mcp_sse_transport_t *)arena_alloc(
@@ -462,21 +1048,28 @@ mcp_transport_t *mcp_sse_create(
     t->base.ops = &sse_ops;
     t->base.http = http;
     t->base.arena = arena;
+    t->base.pooled = pooled;
     t->base.server_url = arena_strdup(arena, config->server_url);
     t->base.api_key = config->api_key ? arena_strdup(arena, config->api_key) : NULL;
     t->base.timeout_ms = config->timeout_ms ? config->timeout_ms : MCP_DEFAULT_TIMEOUT_MS;
     t->base.verify_ssl = config->verify_ssl;
+    t->max_backoff_ms = config->reconnect_max_backoff_ms ?
+        config->reconnect_max_backoff_ms : SSE_RECONNECT_MAX_MS;
+    t->fail_fast = config->reconnect_fail_fast;
+    t->jitter_seed = (unsigned)ac_platform_timestamp_ms() ^ (unsigned)(uintptr_t)t;
 
     /* Extract base URL */
     t->base_url = extract_base_url(arena, config->server_url);
 
-    /* Create separate HTTP client for POST requests */
-    arc_http_client_config_t http_cfg = {
-        .default_timeout_ms = t->base.timeout_ms
-    };
-    if (arc_http_client_create(&http_cfg, &t->post_http) != ARC_OK) {
-        AC_LOG_ERROR("Failed to create POST HTTP client");
-        return NULL;
+    /* Create separate HTTP client for POST requests, unless pooled */
+    if (!pooled) {
+        arc_http_client_config_t http_cfg = {
+            .default_timeout_ms = t->base.timeout_ms
+        };
+        if (arc_http_client_create(&http_cfg, &t->post_http) != ARC_OK) {
+            AC_LOG_ERROR("Failed to create POST HTTP client");
+            return NULL;
+        }
     }
 
     if (!t->base.server_url || !t->base_url) {
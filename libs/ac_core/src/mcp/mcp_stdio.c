@@ -0,0 +1,703 @@
+/**
+ * @file mcp_stdio.c
+ * @brief MCP stdio Transport Implementation
+ *
+ * Local MCP servers run as a child process:
+ * 1. Spawn the server with its stdin/stdout connected to pipes
+ * 2. Write each JSON-RPC message as one line to its stdin
+ * 3. A background thread reads newline-delimited responses from its
+ *    stdout and hands each to the request waiting for its id
+ *
+ * The server's stderr is inherited (its log output). No HTTP framing, so a
+ * round trip costs two pipe writes and a thread wakeup.
+ */
+
+#include "mcp_internal.h"
+#include "json_scan.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+
+/*============================================================================
+ * stdio Transport Structure
+ *============================================================================*/
+
+/* Pending requests: chained hash on the JSON-RPC id (power of two) */
+#define STDIO_WAITER_BUCKETS 16
+
+#define STDIO_READ_CHUNK     4096
+#define STDIO_EXIT_GRACE_MS  1000     /* After closing stdin, before SIGKILL */
+
+/**
+ * @brief A request waiting for its response line
+ *
+ * Lives on the requester's stack; registered before the write so a fast
+ * response cannot slip past it.
+ */
+typedef struct stdio_waiter {
+    int id;
+    char *json;                      /* Response, set by the reader thread */
+    int done;
+    pthread_cond_t cond;
+    struct stdio_waiter *next;       /* Bucket chain */
+} stdio_waiter_t;
+
+typedef struct {
+    mcp_transport_t base;
+
+    /* Server command line (arena, argv[0] = command, NULL-terminated) */
+    char **argv;
+
+    /* Child process and our ends of its pipes (-1 = closed) */
+    pid_t pid;
+    int in_fd;                       /* Child's stdin */
+    int out_fd;                      /* Child's stdout (non-blocking) */
+    int wake_fd[2];                  /* Self-pipe to stop the reader */
+
+    /* Background reader */
+    pthread_t reader_thread;
+    volatile int running;
+    volatile int alive;              /* 0 once the child's stdout closed */
+
+    /* Pending requests (protected by mutex) */
+    pthread_mutex_t mutex;
+    stdio_waiter_t *waiters[STDIO_WAITER_BUCKETS];
+
+    /* Lines are written whole: requests and the reader's replies to pings */
+    pthread_mutex_t write_mutex;
+} mcp_stdio_transport_t;
+
+/*============================================================================
+ * Pending Requests (caller holds mutex)
+ *============================================================================*/
+
+static stdio_waiter_t **waiter_bucket(mcp_stdio_transport_t *st, int id) {
+    return &st->waiters[(unsigned)id & (STDIO_WAITER_BUCKETS - 1)];
+}
+
+static void waiter_add(mcp_stdio_transport_t *st, stdio_waiter_t *w) {
+    stdio_waiter_t **bucket = waiter_bucket(st, w->id);
+    w->next = *bucket;
+    *bucket = w;
+}
+
+/**
+ * @brief Unlink the waiter for id, NULL if nobody waits for it
+ */
+static stdio_waiter_t *waiter_take(mcp_stdio_transport_t *st, int id) {
+    for (stdio_waiter_t **link = waiter_bucket(st, id); *link; link = &(*link)->next) {
+        stdio_waiter_t *w = *link;
+        if (w->id == id) {
+            *link = w->next;
+            w->next = NULL;
+            return w;
+        }
+    }
+    return NULL;
+}
+
+static void timespec_after(struct timespec *ts, uint32_t ms) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t ns = (uint64_t)now.tv_nsec + (uint64_t)ms * 1000000;
+    ts->tv_sec = now.tv_sec + ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
+/*============================================================================
+ * Writing
+ *============================================================================*/
+
+/**
+ * @brief Write all of buf, without SIGPIPE if the child has gone
+ *
+ * SIGPIPE is blocked for this thread during the write; one raised by it
+ * is consumed before unblocking, so the process disposition is untouched.
+ */
+static int write_all(int fd, const char *buf, size_t len) {
+    sigset_t pipe_set, old_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+    int ok = 1;
+    int broken = 0;
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            broken = errno == EPIPE;
+            ok = 0;
+            break;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    if (broken && !sigismember(&old_set, SIGPIPE)) {
+        struct timespec zero = { 0, 0 };
+        sigtimedwait(&pipe_set, NULL, &zero);
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    return ok;
+}
+
+/**
+ * @brief Send one message as a line
+ */
+static arc_err_t stdio_send_line(mcp_stdio_transport_t *st, const char *json, size_t len) {
+    pthread_mutex_lock(&st->write_mutex);
+    int ok = st->in_fd >= 0 &&
+             write_all(st->in_fd, json, len) &&
+             write_all(st->in_fd, "\n", 1);
+    pthread_mutex_unlock(&st->write_mutex);
+
+    if (!ok) {
+        mcp_transport_set_error(&st->base, "Write to server failed: %s", strerror(errno));
+        return ARC_ERR_NOT_CONNECTED;
+    }
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Reader Thread
+ *============================================================================*/
+
+/**
+ * @brief Answer a request from the server
+ *
+ * Only ping is supported; anything else gets "method not found".
+ */
+static void stdio_reply(mcp_stdio_transport_t *st, ac_json_span_t root, ac_json_span_t id) {
+    char reply[256];
+    int n;
+    size_t id_len = (size_t)(id.end - id.start);
+
+    if (id_len > 64) {
+        return;
+    }
+    if (ac_json_scan_str_eq(ac_json_scan_get(root, "method"), "ping")) {
+        n = snprintf(reply, sizeof(reply),
+                     "{\"jsonrpc\":\"2.0\",\"id\":%.*s,\"result\":{}}",
+                     (int)id_len, id.start);
+    } else {
+        n = snprintf(reply, sizeof(reply),
+                     "{\"jsonrpc\":\"2.0\",\"id\":%.*s,\"error\":"
+                     "{\"code\":-32601,\"message\":\"Method not found\"}}",
+                     (int)id_len, id.start);
+    }
+    stdio_send_line(st, reply, (size_t)n);
+}
+
+/**
+ * @brief Dispatch one line from the server's stdout
+ */
+static void stdio_on_line(mcp_stdio_transport_t *st, const char *line, size_t len) {
+    ac_json_span_t root = ac_json_scan_root(line, len);
+    if (root.kind != AC_JSON_OBJECT ||
+        ac_json_scan_get(root, "jsonrpc").kind == AC_JSON_NONE) {
+        /* Servers sometimes print banners on stdout */
+        AC_LOG_DEBUG("stdio: ignoring non-JSON-RPC line: %.*s",
+                     (int)(len > 60 ? 60 : len), line);
+        return;
+    }
+
+    ac_json_span_t id = ac_json_scan_get(root, "id");
+
+    /* Request or notification from the server */
+    if (ac_json_scan_get(root, "method").kind != AC_JSON_NONE) {
+        if (id.kind != AC_JSON_NONE) {
+            stdio_reply(st, root, id);
+        } else {
+            mcp_transport_notify(&st->base, line, len);
+        }
+        return;
+    }
+
+    int resp_id = 0;
+    ac_json_scan_int(id, &resp_id);
+
+    pthread_mutex_lock(&st->mutex);
+    stdio_waiter_t *w = waiter_take(st, resp_id);
+    if (w) {
+        w->json = ARC_STRNDUP(line, len);
+        w->done = 1;
+        pthread_cond_signal(&w->cond);
+    }
+    pthread_mutex_unlock(&st->mutex);
+
+    if (w) {
+        AC_LOG_DEBUG("stdio: delivered response id=%d", resp_id);
+    } else {
+        AC_LOG_DEBUG("stdio: no pending request for id=%d, dropped", resp_id);
+    }
+}
+
+/**
+ * @brief Mark the server gone and wake every waiter
+ */
+static void stdio_set_dead(mcp_stdio_transport_t *st) {
+    pthread_mutex_lock(&st->mutex);
+    st->alive = 0;
+    for (size_t i = 0; i < STDIO_WAITER_BUCKETS; i++) {
+        for (stdio_waiter_t *w = st->waiters[i]; w; w = w->next) {
+            pthread_cond_signal(&w->cond);
+        }
+    }
+    pthread_mutex_unlock(&st->mutex);
+}
+
+static void *stdio_reader_func(void *arg) {
+    mcp_stdio_transport_t *st = (mcp_stdio_transport_t *)arg;
+
+    AC_LOG_DEBUG("stdio reader started");
+
+    char *buf = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+
+    struct pollfd fds[2] = {
+        { .fd = st->out_fd, .events = POLLIN },
+        { .fd = st->wake_fd[0], .events = POLLIN }
+    };
+
+    while (st->running) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        if (!fds[0].revents) {
+            continue;
+        }
+
+        /* Drain what is there; lines are complete once '\n' arrives */
+        int eof = 0;
+        for (;;) {
+            if (cap - len < STDIO_READ_CHUNK) {
+                size_t new_cap = cap ? cap * 2 : STDIO_READ_CHUNK * 4;
+                char *grown = (char *)ARC_REALLOC(buf, new_cap);
+                if (!grown) {
+                    AC_LOG_ERROR("stdio: out of memory reading server output");
+                    eof = 1;
+                    break;
+                }
+                buf = grown;
+                cap = new_cap;
+            }
+
+            ssize_t n = read(st->out_fd, buf + len, cap - len);
+            if (n > 0) {
+                len += (size_t)n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            eof = 1;
+            break;
+        }
+
+        size_t start = 0;
+        for (;;) {
+            char *nl = (char *)memchr(buf + start, '\n', len - start);
+            if (!nl) break;
+
+            size_t line_len = (size_t)(nl - (buf + start));
+            if (line_len > 0 && buf[start + line_len - 1] == '\r') {
+                line_len--;
+            }
+            if (line_len > 0) {
+                stdio_on_line(st, buf + start, line_len);
+            }
+            start = (size_t)(nl - buf) + 1;
+        }
+        if (start > 0) {
+            memmove(buf, buf + start, len - start);
+            len -= start;
+        }
+
+        if (eof) {
+            if (st->running) {
+                AC_LOG_WARN("stdio: server %s closed its output", st->argv[0]);
+            }
+            break;
+        }
+    }
+
+    ARC_FREE(buf);
+    stdio_set_dead(st);
+
+    AC_LOG_DEBUG("stdio reader exiting");
+    return NULL;
+}
+
+/*============================================================================
+ * Process Management
+ *============================================================================*/
+
+static void close_fd(int *fd) {
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+static int make_pipe(int fds[2]) {
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+}
+
+/**
+ * @brief Reap the child, killing it if it outlives the grace period
+ */
+static void stdio_reap(mcp_stdio_transport_t *st) {
+    if (st->pid <= 0) {
+        return;
+    }
+
+    for (int waited = 0; waited < STDIO_EXIT_GRACE_MS; waited += 10) {
+        if (waitpid(st->pid, NULL, WNOHANG) == st->pid) {
+            st->pid = -1;
+            return;
+        }
+        usleep(10 * 1000);
+    }
+
+    AC_LOG_WARN("stdio: server %s did not exit, killing it", st->argv[0]);
+    kill(st->pid, SIGKILL);
+    waitpid(st->pid, NULL, 0);
+    st->pid = -1;
+}
+
+/*============================================================================
+ * Transport Operations
+ *============================================================================*/
+
+static arc_err_t stdio_connect(mcp_transport_t *t) {
+    mcp_stdio_transport_t *st = (mcp_stdio_transport_t *)t;
+
+    if (st->running) {
+        return ARC_OK;
+    }
+
+    AC_LOG_INFO("stdio: starting %s", st->argv[0]);
+
+    int in_pipe[2] = { -1, -1 };
+    int out_pipe[2] = { -1, -1 };
+    if (make_pipe(in_pipe) != 0 || make_pipe(out_pipe) != 0 ||
+        make_pipe(st->wake_fd) != 0) {
+        mcp_transport_set_error(t, "pipe() failed: %s", strerror(errno));
+        close_fd(&in_pipe[0]);
+        close_fd(&in_pipe[1]);
+        close_fd(&out_pipe[0]);
+        close_fd(&out_pipe[1]);
+        close_fd(&st->wake_fd[0]);
+        close_fd(&st->wake_fd[1]);
+        return ARC_ERR_IO;
+    }
+
+    /* dup2 clears FD_CLOEXEC on the child's stdin/stdout */
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in_pipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+
+    int rc = posix_spawnp(&st->pid, st->argv[0], &actions, NULL, st->argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close_fd(&in_pipe[0]);
+    close_fd(&out_pipe[1]);
+
+    if (rc != 0) {
+        mcp_transport_set_error(t, "Failed to start %s: %s", st->argv[0], strerror(rc));
+        st->pid = -1;
+        close_fd(&in_pipe[1]);
+        close_fd(&out_pipe[0]);
+        close_fd(&st->wake_fd[0]);
+        close_fd(&st->wake_fd[1]);
+        return ARC_ERR_IO;
+    }
+
+    st->in_fd = in_pipe[1];
+    st->out_fd = out_pipe[0];
+    fcntl(st->out_fd, F_SETFL, fcntl(st->out_fd, F_GETFL) | O_NONBLOCK);
+
+    memset(st->waiters, 0, sizeof(st->waiters));
+    st->running = 1;
+    st->alive = 1;
+
+    if (pthread_create(&st->reader_thread, NULL, stdio_reader_func, st) != 0) {
+        mcp_transport_set_error(t, "Failed to create stdio reader thread");
+        st->running = 0;
+        st->alive = 0;
+        close_fd(&st->in_fd);
+        close_fd(&st->out_fd);
+        close_fd(&st->wake_fd[0]);
+        close_fd(&st->wake_fd[1]);
+        stdio_reap(st);
+        return ARC_ERR_MEMORY;
+    }
+
+    t->connected = 1;
+    AC_LOG_INFO("stdio: %s running (pid %d)", st->argv[0], (int)st->pid);
+
+    return ARC_OK;
+}
+
+/**
+ * @brief Write requests back to back, then wait for all their responses
+ *
+ * Waiters are registered before the first write, so responses may arrive
+ * in any order and while later requests are still being written.
+ */
+static arc_err_t stdio_exchange(
+    mcp_transport_t *t,
+    const char *const *requests_json,
+    const int *request_ids,
+    size_t count,
+    char **responses_json
+) {
+    mcp_stdio_transport_t *st = (mcp_stdio_transport_t *)t;
+
+    if (!t->connected || !st->alive) {
+        mcp_transport_set_error(t, "Not connected");
+        return ARC_ERR_NOT_CONNECTED;
+    }
+
+    stdio_waiter_t waiters[MCP_MAX_BATCH];
+    if (count > MCP_MAX_BATCH) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&st->mutex);
+    for (size_t i = 0; i < count; i++) {
+        memset(&waiters[i], 0, sizeof(waiters[i]));
+        waiters[i].id = request_ids[i];
+        pthread_cond_init(&waiters[i].cond, NULL);
+        waiter_add(st, &waiters[i]);
+    }
+    pthread_mutex_unlock(&st->mutex);
+
+    arc_err_t err = ARC_OK;
+    for (size_t i = 0; i < count && err == ARC_OK; i++) {
+        err = stdio_send_line(st, requests_json[i], strlen(requests_json[i]));
+    }
+
+    int lost = 0;
+    int cancelled = 0;
+    if (err == ARC_OK) {
+        struct timespec deadline;
+        timespec_after(&deadline, mcp_transport_timeout(t));
+
+        pthread_mutex_lock(&st->mutex);
+        for (size_t i = 0; i < count && !lost && !cancelled; i++) {
+            int timed_out = 0;
+            while (!waiters[i].done && !timed_out) {
+                if (!st->alive) {
+                    lost = 1;
+                    break;
+                }
+                int rc = mcp_transport_wait(t, &waiters[i].cond, &st->mutex, &deadline);
+                timed_out = rc == ETIMEDOUT;
+                if (rc == ECANCELED) {
+                    cancelled = 1;
+                    break;
+                }
+            }
+            if (timed_out) {
+                break;
+            }
+        }
+        pthread_mutex_unlock(&st->mutex);
+    }
+
+    int missing = 0;
+    pthread_mutex_lock(&st->mutex);
+    for (size_t i = 0; i < count; i++) {
+        if (!waiters[i].done) {
+            waiter_take(st, waiters[i].id);
+        }
+        responses_json[i] = waiters[i].json;
+        if (!waiters[i].json) {
+            missing++;
+        }
+    }
+    pthread_mutex_unlock(&st->mutex);
+    for (size_t i = 0; i < count; i++) {
+        pthread_cond_destroy(&waiters[i].cond);
+    }
+
+    if (err != ARC_OK) {
+        return err;
+    }
+    if (missing == 0) {
+        return ARC_OK;
+    }
+
+    if (lost) {
+        mcp_transport_set_error(t, "Server %s exited", st->argv[0]);
+        err = ARC_ERR_NOT_CONNECTED;
+    } else if (cancelled) {
+        mcp_transport_set_error(t, "Request cancelled");
+        err = ARC_ERR_CANCELLED;
+    } else {
+        mcp_transport_set_error(t, "Timeout waiting for %d of %zu response(s)", missing, count);
+        err = ARC_ERR_TIMEOUT;
+    }
+
+    /* A lone request reports its failure; a batch keeps what arrived */
+    if (count == 1) {
+        return err;
+    }
+    return ARC_OK;
+}
+
+static arc_err_t stdio_request(
+    mcp_transport_t *t,
+    const char *request_json,
+    int request_id,
+    char **response_json
+) {
+    mcp_stdio_transport_t *st = (mcp_stdio_transport_t *)t;
+
+    /* For notifications (request_id == 0), no response is expected */
+    if (request_id == 0) {
+        *response_json = NULL;
+        if (!t->connected || !st->alive) {
+            mcp_transport_set_error(t, "Not connected");
+            return ARC_ERR_NOT_CONNECTED;
+        }
+        return stdio_send_line(st, request_json, strlen(request_json));
+    }
+
+    return stdio_exchange(t, &request_json, &request_id, 1, response_json);
+}
+
+static void stdio_disconnect(mcp_transport_t *t) {
+    mcp_stdio_transport_t *st = (mcp_stdio_transport_t *)t;
+
+    if (st->running) {
+        /* EOF on stdin is the protocol's shutdown request */
+        pthread_mutex_lock(&st->write_mutex);
+        close_fd(&st->in_fd);
+        pthread_mutex_unlock(&st->write_mutex);
+
+        st->running = 0;
+        (void)!write(st->wake_fd[1], "x", 1);
+        pthread_join(st->reader_thread, NULL);
+
+        close_fd(&st->out_fd);
+        close_fd(&st->wake_fd[0]);
+        close_fd(&st->wake_fd[1]);
+        stdio_reap(st);
+    }
+
+    t->connected = 0;
+    AC_LOG_DEBUG("stdio transport: disconnected");
+}
+
+static void stdio_destroy(mcp_transport_t *t) {
+    mcp_stdio_transport_t *st = (mcp_stdio_transport_t *)t;
+
+    /* Requests are serialized by the client and never outlive a destroy */
+    pthread_mutex_destroy(&st->write_mutex);
+    pthread_mutex_destroy(&st->mutex);
+
+    AC_LOG_DEBUG("stdio transport: destroyed");
+}
+
+/*============================================================================
+ * Operations Table
+ *============================================================================*/
+
+static const mcp_transport_ops_t stdio_ops = {
+    .connect = stdio_connect,
+    .request = stdio_request,
+    .request_batch = stdio_exchange,
+    .disconnect = stdio_disconnect,
+    .destroy = stdio_destroy
+};
+
+/*============================================================================
+ * Constructor
+ *============================================================================*/
+
+mcp_transport_t *mcp_stdio_create(
+    arena_t *arena,
+    const ac_mcp_config_t *config
+) {
+    if (!config->command) {
+        return NULL;
+    }
+
+    mcp_stdio_transport_t *t = (mcp_stdio_transport_t *)arena_alloc(
+        arena, sizeof(mcp_stdio_transport_t)
+    );
+    if (!t) return NULL;
+
+    memset(t, 0, sizeof(*t));
+
+    size_t argc = 0;
+    while (config->args && config->args[argc]) {
+        argc++;
+    }
+
+    t->argv = (char **)arena_alloc(arena, sizeof(char *) * (argc + 2));
+    if (!t->argv) return NULL;
+
+    /* "stdio:" + the command line names the server (logs, tools cache) */
+    size_t url_len = strlen("stdio:") + strlen(config->command) + 1;
+    t->argv[0] = arena_strdup(arena, config->command);
+    for (size_t i = 0; i < argc; i++) {
+        t->argv[i + 1] = arena_strdup(arena, config->args[i]);
+        if (!t->argv[i + 1]) return NULL;
+        url_len += strlen(config->args[i]) + 1;
+    }
+    t->argv[argc + 1] = NULL;
+    if (!t->argv[0]) return NULL;
+
+    char *url = (char *)arena_alloc(arena, url_len);
+    if (!url) return NULL;
+    char *p = url + sprintf(url, "stdio:%s", config->command);
+    for (size_t i = 0; i < argc; i++) {
+        p += sprintf(p, " %s", config->args[i]);
+    }
+
+    /* Initialize base */
+    t->base.ops = &stdio_ops;
+    t->base.http = NULL;
+    t->base.arena = arena;
+    t->base.server_url = url;
+    t->base.api_key = NULL;
+    t->base.timeout_ms = config->timeout_ms ? config->timeout_ms : MCP_DEFAULT_TIMEOUT_MS;
+
+    t->pid = -1;
+    t->in_fd = -1;
+    t->out_fd = -1;
+    t->wake_fd[0] = -1;
+    t->wake_fd[1] = -1;
+
+    pthread_mutex_init(&t->mutex, NULL);
+    pthread_mutex_init(&t->write_mutex, NULL);
+
+    AC_LOG_DEBUG("stdio transport created for: %s", url);
+
+    return &t->base;
+}
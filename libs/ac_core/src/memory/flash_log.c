@@ -0,0 +1,685 @@
+/**
+ * @file flash_log.c
+ * @brief Record log on a raw flash partition
+ *
+ * The partition is a ring of erase sectors. Sector number seq lives at
+ * physical sector seq % sector_count and sectors are filled in seq
+ * order, so every sector is erased once per trip round the ring. Each
+ * sector starts with a header; the log bytes run on from one sector's
+ * end into the next sector's data, so a record may span sectors.
+ *
+ * Layout (all integers little-endian):
+ * @code
+ * sector  := header, pad, log bytes
+ * header  := u32 magic, u32 seq, u32 base, u32 first, u32 fnv1a32(first 16 bytes)
+ * record  := u32 payload_len, u32 fnv1a32(payload), payload, pad
+ * @endcode
+ *
+ * Padding (erased bytes) aligns every record and the first log byte of a
+ * sector to max(prog_size, 8), so a record header never straddles two
+ * sectors and no program unit is shared by two appends.
+ *
+ * first is the offset of the first record that starts in the sector
+ * (LOG_FIRST_NONE when a long record covers all of it), which is where
+ * reading resumes once the sector before it has been erased. base is the
+ * seq the log starts at: clearing opens a sector whose base is its own
+ * seq instead of erasing the partition.
+ *
+ * Crash safety: programs are whole prog_size units at increasing
+ * addresses, and a record is appended only after a clean tail (a blank
+ * header followed by blank flash). A record torn by a power cut fails
+ * its checksum; the reader skips to the first record of the next sector,
+ * and the writer, finding the tail not clean, starts a new sector.
+ *
+ * RAM: the handle and one cache of ARC_MEMORY_FLASH_CACHE bytes, which
+ * gathers programs while appending and is the read window otherwise.
+ */
+
+#include "flash_log.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include <stdint.h>
+#include <string.h>
+
+#define LOG_MAGIC           0x474C4341u     /* "ACLG" */
+#define LOG_HEADER          20
+#define LOG_RECORD_HDR      8
+#define LOG_FIRST_NONE      0xFFFFFFFFu
+#define LOG_BLANK           0xFFFFFFFFu
+
+typedef struct {
+    uint32_t seq;
+    uint32_t off;                    /* Bytes from the sector start */
+} log_pos_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t base;
+    uint32_t first;
+} log_header_t;
+
+struct ac_flash_log {
+    ac_memory_flash_t dev;
+    uint32_t align;                  /* Record alignment: max(prog_size, 8) */
+    uint32_t data_start;             /* Header rounded up to align */
+
+    int empty;                       /* No sector written yet */
+    uint32_t head;                   /* Newest sector */
+    uint32_t base;                   /* Oldest sector still in the log */
+    log_pos_t tail;                  /* Where the next record goes */
+    int fresh;                       /* Tail not clean: next append opens a sector */
+
+    log_pos_t cursor;                /* Reader */
+    int in_record;                   /* Cursor is inside a record's payload */
+    size_t record_left;              /* Payload bytes of it not read yet */
+
+    uint32_t cache_addr;
+    uint32_t cache_len;
+    int cache_dirty;                 /* Holds bytes not programmed yet */
+    uint32_t cache_size;
+    unsigned char *cache;
+};
+
+/*============================================================================
+ * Encoding
+ *============================================================================*/
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+           (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+#define FNV_INIT 2166136261u
+
+static uint32_t fnv1a32_update(uint32_t h, const unsigned char *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t align_up(uint32_t v, uint32_t align) {
+    return (v + align - 1) & ~(align - 1);
+}
+
+static uint32_t sector_addr(const ac_flash_log_t *log, uint32_t seq) {
+    return (seq % log->dev.sector_count) * log->dev.sector_size;
+}
+
+static uint32_t pos_addr(const ac_flash_log_t *log, log_pos_t p) {
+    return sector_addr(log, p.seq) + p.off;
+}
+
+/*============================================================================
+ * Cache
+ *============================================================================*/
+
+static arc_err_t cache_flush(ac_flash_log_t *log) {
+    if (!log->cache_dirty) {
+        return ARC_OK;
+    }
+    /* Pad the last unit (record ends are aligned, so only in theory) */
+    uint32_t len = align_up(log->cache_len, log->dev.prog_size);
+    memset(log->cache + log->cache_len, 0xFF, len - log->cache_len);
+
+    arc_err_t err = log->dev.prog(log->dev.ctx, log->cache_addr, log->cache, len);
+    log->cache_dirty = 0;
+    log->cache_len = 0;
+    return err;
+}
+
+/**
+ * @brief Readable bytes at addr, at most up to the end of its sector
+ *
+ * @return Pointer into the cache, NULL on read error
+ */
+static const unsigned char *cache_view(ac_flash_log_t *log, uint32_t addr, uint32_t *avail) {
+    if (!log->cache_dirty && log->cache_len > 0 &&
+        addr >= log->cache_addr && addr < log->cache_addr + log->cache_len) {
+        *avail = log->cache_addr + log->cache_len - addr;
+        return log->cache + (addr - log->cache_addr);
+    }
+    if (cache_flush(log) != ARC_OK) {
+        return NULL;
+    }
+
+    uint32_t sector_end = (addr / log->dev.sector_size + 1) * log->dev.sector_size;
+    uint32_t len = sector_end - addr < log->cache_size ? sector_end - addr : log->cache_size;
+    if (log->dev.read(log->dev.ctx, addr, log->cache, len) != ARC_OK) {
+        log->cache_len = 0;
+        return NULL;
+    }
+    log->cache_addr = addr;
+    log->cache_len = len;
+    *avail = len;
+    return log->cache;
+}
+
+/**
+ * @brief Gather len bytes (NULL: erased filler) for programming at addr
+ *
+ * Writes are sequential and never cross a sector, so the cache only ever
+ * holds one run of bytes ending at the tail.
+ */
+static arc_err_t cache_write(ac_flash_log_t *log, uint32_t addr, const unsigned char *src,
+                             uint32_t len) {
+    if (!log->cache_dirty) {
+        log->cache_len = 0;
+    }
+    while (len > 0) {
+        if (log->cache_len == 0) {
+            log->cache_addr = addr;
+        }
+        uint32_t n = log->cache_size - log->cache_len;
+        if (n > len) {
+            n = len;
+        }
+        if (src) {
+            memcpy(log->cache + log->cache_len, src, n);
+            src += n;
+        } else {
+            memset(log->cache + log->cache_len, 0xFF, n);
+        }
+        log->cache_len += n;
+        log->cache_dirty = 1;
+        addr += n;
+        len -= n;
+
+        if (log->cache_len == log->cache_size) {
+            arc_err_t err = cache_flush(log);
+            if (err != ARC_OK) {
+                return err;
+            }
+        }
+    }
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Sectors
+ *============================================================================*/
+
+static int header_read(ac_flash_log_t *log, uint32_t seq, log_header_t *out) {
+    unsigned char b[LOG_HEADER];
+    if (log->dev.read(log->dev.ctx, sector_addr(log, seq), b, sizeof(b)) != ARC_OK) {
+        return 0;
+    }
+    if (get_u32(b) != LOG_MAGIC || get_u32(b + 16) != fnv1a32_update(FNV_INIT, b, 16)) {
+        return 0;
+    }
+    out->seq = get_u32(b + 4);
+    out->base = get_u32(b + 8);
+    out->first = get_u32(b + 12);
+    return 1;
+}
+
+/**
+ * @brief Is sector seq part of the log (written, and not overwritten since)
+ */
+static int sector_live(ac_flash_log_t *log, uint32_t seq, log_header_t *out) {
+    if (log->empty || seq > log->head || seq < log->base ||
+        log->head - seq >= log->dev.sector_count) {
+        return 0;
+    }
+    return header_read(log, seq, out) && out->seq == seq;
+}
+
+/**
+ * @brief Erase the next sector and write its header; the tail moves there
+ *
+ * @param first      Offset of the first record starting in it
+ * @param new_base   Start the log here (clear)
+ */
+static arc_err_t sector_open(ac_flash_log_t *log, uint32_t first, int new_base) {
+    arc_err_t err = cache_flush(log);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    uint32_t seq = log->empty ? 0 : log->head + 1;
+    uint32_t base = log->empty || new_base ? seq : log->base;
+
+    err = log->dev.erase(log->dev.ctx, seq % log->dev.sector_count);
+    if (err != ARC_OK) {
+        AC_LOG_ERROR("Flash log: erase of sector %u failed",
+                     (unsigned)(seq % log->dev.sector_count));
+        return err;
+    }
+
+    unsigned char b[LOG_HEADER];
+    put_u32(b, LOG_MAGIC);
+    put_u32(b + 4, seq);
+    put_u32(b + 8, base);
+    put_u32(b + 12, first);
+    put_u32(b + 16, fnv1a32_update(FNV_INIT, b, 16));
+
+    err = cache_write(log, sector_addr(log, seq), b, sizeof(b));
+    if (err == ARC_OK) {
+        err = cache_write(log, sector_addr(log, seq) + LOG_HEADER, NULL,
+                          log->data_start - LOG_HEADER);
+    }
+    if (err == ARC_OK) {
+        err = cache_flush(log);
+    }
+    if (err != ARC_OK) {
+        AC_LOG_ERROR("Flash log: header of sector %u failed", (unsigned)seq);
+        return err;
+    }
+
+    /* The sector is in the log from here on, even if the header is all it holds */
+    log->empty = 0;
+    log->head = seq;
+    log->base = base;
+    log->tail.seq = seq;
+    log->tail.off = log->data_start;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Reading
+ *============================================================================*/
+
+/**
+ * @brief Read (dst) or checksum (dst NULL) len log bytes from *p on
+ *
+ * Crosses into following sectors as long as they are live.
+ *
+ * @return ARC_OK, ARC_ERR_NOT_FOUND (runs past the log), ARC_ERR_IO
+ */
+static arc_err_t span_read(ac_flash_log_t *log, log_pos_t *p, unsigned char *dst, size_t len,
+                           uint32_t *hash) {
+    while (len > 0) {
+        if (p->off >= log->dev.sector_size) {
+            log_header_t h;
+            if (!sector_live(log, p->seq + 1, &h)) {
+                return ARC_ERR_NOT_FOUND;
+            }
+            p->seq++;
+            p->off = log->data_start;
+        }
+
+        uint32_t avail;
+        const unsigned char *src = cache_view(log, pos_addr(log, *p), &avail);
+        if (!src) {
+            return ARC_ERR_IO;
+        }
+        uint32_t n = avail < len ? avail : (uint32_t)len;
+        if (dst) {
+            memcpy(dst, src, n);
+            dst += n;
+        }
+        if (hash) {
+            *hash = fnv1a32_update(*hash, src, n);
+        }
+        p->off += n;
+        len -= n;
+    }
+    return ARC_OK;
+}
+
+/**
+ * @brief Is everything from p to the end of its sector still erased
+ */
+static int blank_to_end(ac_flash_log_t *log, log_pos_t p) {
+    while (p.off < log->dev.sector_size) {
+        uint32_t avail;
+        const unsigned char *src = cache_view(log, pos_addr(log, p), &avail);
+        if (!src) {
+            return 0;
+        }
+        for (uint32_t i = 0; i < avail; i++) {
+            if (src[i] != 0xFF) {
+                return 0;
+            }
+        }
+        p.off += avail;
+    }
+    return 1;
+}
+
+/**
+ * @brief Move p to the first record starting after sector p->seq
+ *
+ * @return 1, 0 if no later live sector has a record start
+ */
+static int skip_sector(ac_flash_log_t *log, log_pos_t *p) {
+    for (uint32_t seq = p->seq + 1; !log->empty && seq <= log->head; seq++) {
+        log_header_t h;
+        if (sector_live(log, seq, &h) && h.first != LOG_FIRST_NONE) {
+            p->seq = seq;
+            p->off = h.first;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void ac_flash_log_rewind(ac_flash_log_t *log) {
+    log->in_record = 0;
+    log->record_left = 0;
+    log->cursor.seq = log->head;
+    log->cursor.off = log->dev.sector_size;          /* Nothing to read */
+    if (log->empty) {
+        return;
+    }
+
+    /* Oldest live sector: the ring may have erased the ones before it */
+    uint32_t seq = log->head;
+    log_header_t h;
+    while (seq > log->base && sector_live(log, seq - 1, &h)) {
+        seq--;
+    }
+    if (sector_live(log, seq, &h) && h.first != LOG_FIRST_NONE) {
+        log->cursor.seq = seq;
+        log->cursor.off = h.first;
+    } else {
+        log->cursor.seq = seq;
+        if (!skip_sector(log, &log->cursor)) {
+            log->cursor.seq = log->head;
+            log->cursor.off = log->dev.sector_size;
+        }
+    }
+}
+
+/**
+ * @brief Find the next intact record from the cursor on
+ *
+ * @param end    Where the log stops (set on ARC_ERR_NOT_FOUND)
+ * @param clean  The log stops at a blank header with blank flash after it
+ */
+static arc_err_t record_next(ac_flash_log_t *log, size_t *len, log_pos_t *end, int *clean) {
+    if (log->in_record) {
+        /* Skip whatever the caller left unread of the previous record */
+        arc_err_t err = span_read(log, &log->cursor, NULL, log->record_left, NULL);
+        if (err == ARC_ERR_IO) {
+            return err;
+        }
+        log->cursor.off = align_up(log->cursor.off, log->align);
+        log->in_record = 0;
+        log->record_left = 0;
+    }
+
+    uint32_t limit = (log->dev.sector_size - log->data_start) * log->dev.sector_count;
+    for (;;) {
+        log_pos_t p = log->cursor;
+        int bad = 0;
+
+        if (log->empty) {
+            *end = p;
+            *clean = 1;
+            return ARC_ERR_NOT_FOUND;
+        }
+        if (p.off >= log->dev.sector_size) {
+            /* Sector used up: go on in the next one */
+            log_header_t h;
+            if (p.seq == log->head) {
+                *end = p;
+                *clean = 1;
+                return ARC_ERR_NOT_FOUND;
+            }
+            if (sector_live(log, p.seq + 1, &h)) {
+                p.seq++;
+                p.off = log->data_start;
+                log->cursor = p;
+            } else {
+                bad = 1;
+            }
+        }
+
+        unsigned char hdr[LOG_RECORD_HDR];
+        uint32_t payload = 0;
+        uint32_t sum = 0;
+        if (!bad) {
+            arc_err_t err = span_read(log, &p, hdr, sizeof(hdr), NULL);
+            if (err == ARC_ERR_IO) {
+                return err;
+            }
+            payload = get_u32(hdr);
+            sum = get_u32(hdr + 4);
+            bad = err != ARC_OK;
+        }
+
+        if (!bad && payload == LOG_BLANK && sum == LOG_BLANK) {
+            /* Blank header: the end of the log if nothing follows it */
+            if (log->cursor.seq == log->head) {
+                *end = log->cursor;
+                *clean = blank_to_end(log, log->cursor);
+                return ARC_ERR_NOT_FOUND;
+            }
+            bad = 1;
+        }
+
+        log_pos_t start = p;
+        if (!bad && payload > limit) {
+            bad = 1;
+        }
+        if (!bad) {
+            uint32_t hash = FNV_INIT;
+            arc_err_t err = span_read(log, &p, NULL, payload, &hash);
+            if (err == ARC_ERR_IO) {
+                return err;
+            }
+            bad = err != ARC_OK || hash != sum;
+        }
+
+        if (bad) {
+            /* Torn record, or the remains of a sector the writer gave up on */
+            log_pos_t torn = log->cursor;
+            if (!skip_sector(log, &log->cursor)) {
+                *end = torn;
+                *clean = 0;
+                return ARC_ERR_NOT_FOUND;
+            }
+            AC_LOG_WARN("Flash log: skipping a damaged record in sector %u", (unsigned)torn.seq);
+            continue;
+        }
+
+        log->cursor = start;
+        log->in_record = 1;
+        log->record_left = payload;
+        *len = payload;
+        return ARC_OK;
+    }
+}
+
+arc_err_t ac_flash_log_next(ac_flash_log_t *log, size_t *len) {
+    if (!log || !len) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    log_pos_t end;
+    int clean;
+    return record_next(log, len, &end, &clean);
+}
+
+arc_err_t ac_flash_log_read(ac_flash_log_t *log, void *dst, size_t len) {
+    if (!log || (!dst && len > 0)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (!log->in_record || len > log->record_left) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    arc_err_t err = span_read(log, &log->cursor, (unsigned char *)dst, len, NULL);
+    if (err != ARC_OK) {
+        return ARC_ERR_IO;
+    }
+    log->record_left -= len;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Writing
+ *============================================================================*/
+
+arc_err_t ac_flash_log_append(ac_flash_log_t *log, const void *record, size_t len) {
+    const unsigned char *src = (const unsigned char *)record;
+    if (!log || !src || len < LOG_RECORD_HDR ||
+        get_u32(src) != len - LOG_RECORD_HDR || len > UINT32_MAX - log->align) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    uint32_t data = log->dev.sector_size - log->data_start;
+    uint32_t total = align_up((uint32_t)len, log->align);
+    if ((uint64_t)total > (uint64_t)data * (log->dev.sector_count - 1)) {
+        AC_LOG_ERROR("Flash log: %zu byte record does not fit the partition", len);
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    arc_err_t err = ARC_OK;
+    if (log->empty || log->fresh || log->tail.off >= log->dev.sector_size) {
+        err = sector_open(log, log->data_start, 0);
+    }
+
+    uint32_t left = total;
+    while (err == ARC_OK && left > 0) {
+        if (log->tail.off >= log->dev.sector_size) {
+            /* The record runs on: the next one starts after what is left of it */
+            uint32_t first = left < data ? log->data_start + left : LOG_FIRST_NONE;
+            err = sector_open(log, first, 0);
+            if (err != ARC_OK) {
+                break;
+            }
+        }
+
+        uint32_t room = log->dev.sector_size - log->tail.off;
+        uint32_t n = left < room ? left : room;
+        uint32_t done = total - left;
+        uint32_t real = done < len ? (uint32_t)len - done : 0;  /* Record bytes, rest is padding */
+        if (real > n) {
+            real = n;
+        }
+
+        uint32_t addr = pos_addr(log, log->tail);
+        err = cache_write(log, addr, src + done, real);
+        if (err == ARC_OK && real < n) {
+            err = cache_write(log, addr + real, NULL, n - real);
+        }
+        log->tail.off += n;
+        left -= n;
+    }
+    if (err == ARC_OK) {
+        err = cache_flush(log);
+    }
+
+    if (err != ARC_OK) {
+        /* Part of it may be on flash: never write after it */
+        AC_LOG_ERROR("Flash log: append failed (%d)", err);
+        log->cache_dirty = 0;
+        log->cache_len = 0;
+        log->fresh = 1;
+        return ARC_ERR_IO;
+    }
+    return ARC_OK;
+}
+
+arc_err_t ac_flash_log_clear(ac_flash_log_t *log) {
+    if (!log) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (log->empty) {
+        return ARC_OK;
+    }
+    arc_err_t err = sector_open(log, log->data_start, 1);
+    if (err != ARC_OK) {
+        log->fresh = 1;
+        return ARC_ERR_IO;
+    }
+    log->fresh = 0;
+    ac_flash_log_rewind(log);
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Open / Close
+ *============================================================================*/
+
+ac_flash_log_t *ac_flash_log_open(const ac_memory_flash_t *flash) {
+    if (!flash || !flash->read || !flash->prog || !flash->erase) {
+        return NULL;
+    }
+
+    uint32_t prog = flash->prog_size ? flash->prog_size : 1;
+    uint32_t align = prog > LOG_RECORD_HDR ? prog : LOG_RECORD_HDR;
+    uint32_t data_start = align_up(LOG_HEADER, align);
+    if ((prog & (prog - 1)) != 0 || flash->sector_count < 2 ||
+        flash->sector_size % align != 0 || flash->sector_size < data_start + 2 * align ||
+        (uint64_t)flash->sector_size * flash->sector_count > UINT32_MAX) {
+        AC_LOG_ERROR("Flash log: unusable geometry (%u x %u bytes, prog %u)",
+                     (unsigned)flash->sector_count, (unsigned)flash->sector_size, (unsigned)prog);
+        return NULL;
+    }
+
+    uint32_t cache_size = align_up(ARC_MEMORY_FLASH_CACHE, align);
+    if (cache_size > flash->sector_size) {
+        cache_size = flash->sector_size;
+    }
+
+    ac_flash_log_t *log = (ac_flash_log_t *)ARC_CALLOC(1, sizeof(ac_flash_log_t));
+    unsigned char *cache = (unsigned char *)ARC_MALLOC(cache_size);
+    if (!log || !cache) {
+        ARC_FREE(log);
+        ARC_FREE(cache);
+        return NULL;
+    }
+    log->dev = *flash;
+    log->dev.prog_size = prog;
+    log->align = align;
+    log->data_start = data_start;
+    log->cache = cache;
+    log->cache_size = cache_size;
+
+    /* The newest valid header is the head; it knows where the log starts */
+    log->empty = 1;
+    for (uint32_t i = 0; i < flash->sector_count; i++) {
+        log_header_t h;
+        if (header_read(log, i, &h) && h.seq % flash->sector_count == i &&
+            (log->empty || h.seq > log->head)) {
+            log->empty = 0;
+            log->head = h.seq;
+            log->base = h.base;
+        }
+    }
+
+    /* Walk to the end: appends continue there only if it is clean */
+    ac_flash_log_rewind(log);
+    log_pos_t end = log->cursor;
+    int clean = 1;
+    size_t len;
+    arc_err_t err;
+    size_t records = 0;
+    while ((err = record_next(log, &len, &end, &clean)) == ARC_OK) {
+        records++;
+    }
+    if (err != ARC_ERR_NOT_FOUND) {
+        AC_LOG_ERROR("Flash log: read failed while opening");
+        ac_flash_log_close(log);
+        return NULL;
+    }
+
+    log->tail = end;
+    log->fresh = !clean;
+    if (!clean) {
+        AC_LOG_WARN("Flash log: unclean tail in sector %u, next append starts a new sector",
+                    (unsigned)end.seq);
+    }
+    ac_flash_log_rewind(log);
+
+    AC_LOG_DEBUG("Flash log: %zu records, sectors %u..%u", records,
+                 (unsigned)log->base, (unsigned)log->head);
+    return log;
+}
+
+void ac_flash_log_close(ac_flash_log_t *log) {
+    if (!log) {
+        return;
+    }
+    ARC_FREE(log->cache);
+    ARC_FREE(log);
+}
@@ -0,0 +1,84 @@
+/**
+ * @file flash_log.h
+ * @brief Record log on a raw flash partition (internal)
+ *
+ * Backs ac_memory persistence on devices without a file system. Records
+ * are framed as in the memory log file (u32 payload length, u32
+ * fnv1a32 of the payload, payload); the log adds sector headers and
+ * alignment around them and hands back only records whose checksum
+ * holds. See flash_log.c for the on-flash layout.
+ */
+
+#ifndef ARC_FLASH_LOG_H
+#define ARC_FLASH_LOG_H
+
+#include "arc/memory.h"
+#include "arc/error.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ac_flash_log ac_flash_log_t;
+
+/**
+ * @brief Check the partition geometry and find the end of the log
+ *
+ * Reads every sector header and walks the records once; nothing is
+ * written until the first append.
+ *
+ * @return Log handle, NULL on bad geometry, I/O error or no memory
+ */
+ac_flash_log_t *ac_flash_log_open(const ac_memory_flash_t *flash);
+
+/**
+ * @brief Free the handle (the partition is left as it is)
+ */
+void ac_flash_log_close(ac_flash_log_t *log);
+
+/**
+ * @brief Append one framed record; durable once this returns ARC_OK
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG (not a framed record),
+ *         ARC_ERR_IO (the record may be torn; the next append starts a
+ *         new sector so it is never read back)
+ */
+arc_err_t ac_flash_log_append(ac_flash_log_t *log, const void *record, size_t len);
+
+/**
+ * @brief Forget every record (one sector is erased)
+ *
+ * @return ARC_OK, ARC_ERR_IO
+ */
+arc_err_t ac_flash_log_clear(ac_flash_log_t *log);
+
+/**
+ * @brief Position the reader before the oldest record
+ */
+void ac_flash_log_rewind(ac_flash_log_t *log);
+
+/**
+ * @brief Move to the next intact record
+ *
+ * The payload is checksummed before this returns, so a torn record is
+ * never handed out. Read it with ac_flash_log_read().
+ *
+ * @param len  Payload length
+ * @return ARC_OK, ARC_ERR_NOT_FOUND (no more records), ARC_ERR_IO
+ */
+arc_err_t ac_flash_log_next(ac_flash_log_t *log, size_t *len);
+
+/**
+ * @brief Read the next len payload bytes of the current record
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG (past the end of the payload),
+ *         ARC_ERR_IO
+ */
+arc_err_t ac_flash_log_read(ac_flash_log_t *log, void *dst, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_FLASH_LOG_H */
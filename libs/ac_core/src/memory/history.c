@@ -0,0 +1,712 @@
+/**
+ * @file history.c
+ * @brief Conversation history with token budget enforcement
+ */
+
+#include "history.h"
+#include "llm/message/attachment.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include <stdio.h>
+#include <string.h>
+
+/*============================================================================
+ * Tool Output Accounting
+ *============================================================================*/
+
+/**
+ * @brief Bytes of tool results carried by a message
+ */
+static size_t tool_output_bytes(const ac_message_t *msg) {
+    size_t bytes = msg->role == AC_ROLE_TOOL ? ac_message_content(msg).len : 0;
+    for (const ac_content_block_t *b = msg->blocks; b; b = b->next) {
+        if (b->type == AC_BLOCK_TOOL_RESULT) {
+            bytes += ac_block_text(b).len;
+        }
+    }
+    return bytes;
+}
+
+/*============================================================================
+ * Content Store
+ *============================================================================*/
+
+#define RESULTS_MIN_CAPACITY 16
+
+static uint64_t result_hash(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037ull;    /* FNV-1a */
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/**
+ * @brief Append serial of the message at index
+ *
+ * Only a range right after the system prefix is ever dropped, so past
+ * it the entries are the latest appends in order.
+ */
+static size_t entry_serial(const ac_history_t *history, size_t index, size_t count) {
+    return history->appended - (count - index);
+}
+
+static const ac_history_result_t *find_result(const ac_history_t *history,
+                                              const char *text, size_t len) {
+    uint64_t hash = result_hash(text, len);
+    for (size_t i = 0; i < history->result_count; i++) {
+        const ac_history_result_t *r = &history->results[i];
+        if (r->hash == hash && r->len == len && r->text && memcmp(r->text, text, len) == 0) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Marker standing for a repeat of (id, len)
+ * @return 0 if it does not fit
+ */
+static int repeat_marker(const char *id, size_t len, char *marker) {
+    int n = snprintf(marker, AC_HISTORY_MARKER_MAX,
+                     "[repeated: same %zu bytes as the result of tool call %s]", len, id);
+    return n > 0 && n < AC_HISTORY_MARKER_MAX;
+}
+
+/**
+ * @brief Add one result to the store (best effort: a failed grow skips it)
+ */
+static void store_result(ac_history_t *history, const char *id, ac_str_t text,
+                         size_t serial) {
+    if (!id || text.len < AC_HISTORY_ELIDE_MIN_BYTES || find_result(history, text.ptr, text.len)) {
+        return;
+    }
+    if (history->result_count == history->result_capacity) {
+        size_t cap = history->result_capacity ? history->result_capacity * 2
+                                              : RESULTS_MIN_CAPACITY;
+        ac_history_result_t *results = (ac_history_result_t *)ARC_REALLOC(
+            history->results, cap * sizeof(ac_history_result_t));
+        if (!results) {
+            return;
+        }
+        history->results = results;
+        history->result_capacity = cap;
+    }
+    ac_history_result_t *r = &history->results[history->result_count++];
+    r->hash = result_hash(text.ptr, text.len);
+    r->len = text.len;
+    r->serial = serial;
+    r->id = id;
+    r->text = text.ptr;
+}
+
+static void store_results(ac_history_t *history, const ac_message_t *msg, size_t serial) {
+    if (msg->role == AC_ROLE_TOOL) {
+        store_result(history, msg->tool_call_id, ac_message_content(msg), serial);
+    }
+    for (const ac_content_block_t *b = msg->blocks; b; b = b->next) {
+        if (b->type == AC_BLOCK_TOOL_RESULT) {
+            store_result(history, b->id, ac_block_text(b), serial);
+        }
+    }
+}
+
+int ac_history_find_repeat(const ac_history_t *history, const char *text, size_t len,
+                           char *marker) {
+    if (!history || !history->dedup || !text || len < AC_HISTORY_ELIDE_MIN_BYTES) {
+        return 0;
+    }
+    const ac_history_result_t *r = find_result(history, text, len);
+    return r && repeat_marker(r->id, len, marker);
+}
+
+/*============================================================================
+ * Entry Array
+ *============================================================================*/
+
+/**
+ * @brief A turn starts at a user message that is not a tool result carrier
+ */
+static int is_turn_start(const ac_message_t *msg) {
+    if (msg->role != AC_ROLE_USER) {
+        return 0;
+    }
+    for (const ac_content_block_t *b = msg->blocks; b; b = b->next) {
+        if (b->type == AC_BLOCK_TOOL_RESULT) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static unsigned entry_flags(const ac_message_t *msg) {
+    if (msg->role == AC_ROLE_SYSTEM) {
+        return AC_HISTORY_SYSTEM;
+    }
+    if (msg->role == AC_ROLE_TOOL) {
+        return AC_HISTORY_TOOL_OUTPUT;
+    }
+    return is_turn_start(msg) ? AC_HISTORY_TURN_START :
+           msg->role == AC_ROLE_USER ? AC_HISTORY_TOOL_OUTPUT : 0;
+}
+
+arc_err_t ac_history_reserve(ac_history_t *history, size_t n) {
+    if (!history) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (history->capacity - history->count >= n) {
+        return ARC_OK;
+    }
+
+    size_t cap = history->capacity ? history->capacity : AC_HISTORY_MIN_CAPACITY;
+    while (cap - history->count < n) {
+        cap *= 2;
+    }
+    ac_history_entry_t *entries = (ac_history_entry_t *)ARC_REALLOC(
+        history->entries, cap * sizeof(ac_history_entry_t));
+    if (!entries) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    history->entries = entries;
+    history->capacity = cap;
+    return ARC_OK;
+}
+
+arc_err_t ac_history_append_estimated(ac_history_t *history, ac_message_t *msg,
+                                      size_t tokens) {
+    if (!history || !msg) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    arc_err_t err = ac_history_reserve(history, 1);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    msg->next = NULL;
+
+    if (!history->head) {
+        history->head = msg;
+    } else {
+        history->tail->next = msg;
+    }
+    history->tail = msg;
+
+    unsigned flags = entry_flags(msg);
+    if (history->dedup && (flags & AC_HISTORY_TOOL_OUTPUT)) {
+        store_results(history, msg, history->appended);
+    }
+    history->appended++;
+
+    ac_history_entry_t *e = &history->entries[history->count++];
+    e->msg = msg;
+    e->tokens = tokens;
+    e->flags = flags;
+    e->bytes = (e->flags & AC_HISTORY_TOOL_OUTPUT) ? tool_output_bytes(msg) : 0;
+    e->owned = NULL;
+    history->tokens += tokens;
+    history->bytes += e->bytes;
+    return ARC_OK;
+}
+
+arc_err_t ac_history_append_owned(ac_history_t *history, ac_message_t *msg,
+                                  char *owned) {
+    arc_err_t err = ac_history_append(history, msg);
+    if (err == ARC_OK) {
+        history->entries[history->count - 1].owned = owned;
+    }
+    return err;
+}
+
+arc_err_t ac_history_append(ac_history_t *history, ac_message_t *msg) {
+    if (!msg) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    return ac_history_append_estimated(history, msg,
+                                       ac_message_tokens(msg, history->family));
+}
+
+ac_message_t *ac_history_copy_message(arena_t *arena, const ac_message_t *src) {
+    ac_message_t *msg = (ac_message_t *)arena_alloc(arena, sizeof(ac_message_t));
+    if (!msg) {
+        return NULL;
+    }
+    memset(msg, 0, sizeof(*msg));
+    msg->role = src->role;
+
+#define COPY_STR(dst, s) \
+    do { if ((s) && !((dst) = arena_strdup(arena, (s)))) return NULL; } while (0)
+#define COPY_LEN(dst, dst_len, str) \
+    do { \
+        ac_str_t s_ = (str); \
+        if (s_.ptr && !((dst) = arena_strndup(arena, s_.ptr, s_.len))) return NULL; \
+        (dst_len) = s_.len; \
+    } while (0)
+
+    COPY_LEN(msg->content, msg->content_len, ac_message_content(src));
+    COPY_STR(msg->tool_call_id, src->tool_call_id);
+
+    ac_tool_call_t **call_tail = &msg->tool_calls;
+    for (const ac_tool_call_t *s = src->tool_calls; s; s = s->next) {
+        ac_tool_call_t *c = (ac_tool_call_t *)arena_alloc(arena, sizeof(ac_tool_call_t));
+        if (!c) {
+            return NULL;
+        }
+        memset(c, 0, sizeof(*c));
+        COPY_STR(c->id, s->id);
+        COPY_STR(c->name, s->name);
+        COPY_LEN(c->arguments, c->arguments_len, ac_tool_call_arguments(s));
+        *call_tail = c;
+        call_tail = &c->next;
+    }
+
+    ac_content_block_t **block_tail = &msg->blocks;
+    for (const ac_content_block_t *s = src->blocks; s; s = s->next) {
+        ac_content_block_t *b = (ac_content_block_t *)arena_alloc(arena, sizeof(ac_content_block_t));
+        if (!b) {
+            return NULL;
+        }
+        memset(b, 0, sizeof(*b));
+        b->type = s->type;
+        b->is_error = s->is_error;
+        COPY_LEN(b->text, b->text_len, ac_block_text(s));
+        COPY_STR(b->signature, s->signature);
+        COPY_STR(b->data, s->data);
+        COPY_STR(b->id, s->id);
+        COPY_STR(b->name, s->name);
+        COPY_LEN(b->input, b->input_len, ac_block_input(s));
+        if (s->attachment && !(b->attachment = ac_attachment_copy(arena, s->attachment))) {
+            return NULL;
+        }
+        *block_tail = b;
+        block_tail = &b->next;
+    }
+
+#undef COPY_STR
+#undef COPY_LEN
+
+    return msg;
+}
+
+ac_message_t *ac_history_at(const ac_history_t *history, size_t index) {
+    return history && index < history->count ? history->entries[index].msg : NULL;
+}
+
+void ac_history_reset(ac_history_t *history) {
+    if (history) {
+        for (size_t i = 0; i < history->count; i++) {
+            ARC_FREE(history->entries[i].owned);
+        }
+        ARC_FREE(history->entries);
+        ARC_FREE(history->results);
+        ac_tokens_family_t family = history->family;
+        size_t edits = history->edits + 1;
+        int dedup = history->dedup;
+        memset(history, 0, sizeof(*history));
+        history->family = family;
+        history->edits = edits;
+        history->dedup = dedup;
+    }
+}
+
+/*============================================================================
+ * Turn Boundaries
+ *============================================================================*/
+
+/**
+ * @brief Index of the current (last) turn start, count if there is none
+ */
+static size_t current_turn(const ac_history_t *history) {
+    for (size_t i = history->count; i > 0; i--) {
+        if (history->entries[i - 1].flags & AC_HISTORY_TURN_START) {
+            return i - 1;
+        }
+    }
+    return history->count;
+}
+
+static int over_budget(const ac_history_t *history, size_t max_messages, size_t max_tokens) {
+    return (max_messages > 0 && history->count > max_messages) ||
+           (max_tokens > 0 && history->tokens > max_tokens);
+}
+
+/*============================================================================
+ * Compaction
+ *============================================================================*/
+
+static char *elide_marker(arena_t *arena, size_t bytes) {
+    char buf[80];
+    snprintf(buf, sizeof(buf), "[elided: %zu bytes of earlier tool output]", bytes);
+    return arena_strdup(arena, buf);
+}
+
+/**
+ * @brief Write one tool result to <dir>/<id>.out
+ *
+ * The id is sanitized to [A-Za-z0-9_-]. Returns the path (arena) or NULL.
+ */
+static char *spill_result(arena_t *arena, const char *dir, const char *id,
+                          const char *text, size_t len) {
+    char name[96];
+    size_t n = 0;
+    for (const char *c = id ? id : "tool"; *c && n < sizeof(name) - 1; c++) {
+        int ok = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+                 (*c >= '0' && *c <= '9') || *c == '_' || *c == '-';
+        name[n++] = ok ? *c : '_';
+    }
+    name[n] = '\0';
+
+    size_t path_len = strlen(dir) + n + 6;
+    char *path = arena_alloc(arena, path_len);
+    if (!path) {
+        return NULL;
+    }
+    snprintf(path, path_len, "%s/%s.out", dir, name);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        AC_LOG_WARN("Tool output spill: cannot create %s", path);
+        return NULL;
+    }
+    int ok = fwrite(text, 1, len, f) == len;
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        AC_LOG_WARN("Tool output spill: write to %s failed", path);
+        remove(path);
+        return NULL;
+    }
+    return path;
+}
+
+static char *evict_marker(arena_t *arena, size_t bytes, const char *path) {
+    char buf[80];
+    if (!path) {
+        snprintf(buf, sizeof(buf), "[evicted: %zu bytes of earlier tool output]", bytes);
+        return arena_strdup(arena, buf);
+    }
+
+    size_t len = strlen(path) + 80;
+    char *marker = arena_alloc(arena, len);
+    if (marker) {
+        snprintf(marker, len, "[evicted: %zu bytes of earlier tool output, saved to %s]",
+                 bytes, path);
+    }
+    return marker;
+}
+
+/**
+ * @brief Replace one tool result by its marker
+ * @return 1 if replaced
+ */
+static int replace_result(char **text, size_t *text_len, const char *id, arena_t *arena,
+                          size_t min_bytes, int evict, const char *spill_dir) {
+    size_t len = ac_str_field(*text, *text_len).len;
+    if (len == 0 || len < min_bytes) {
+        return 0;
+    }
+
+    char *marker;
+    if (evict) {
+        const char *path = spill_dir ? spill_result(arena, spill_dir, id, *text, len) : NULL;
+        marker = evict_marker(arena, len, path);
+    } else {
+        marker = elide_marker(arena, len);
+    }
+    if (!marker) {
+        return 0;
+    }
+    *text = marker;
+    *text_len = strlen(marker);
+    return 1;
+}
+
+/**
+ * @brief Account for a message edited in place
+ */
+static void entry_edited(ac_history_t *history, ac_history_entry_t *e) {
+    ac_message_t *msg = e->msg;
+
+    /* Drop serialized fragments, refresh accounting */
+    memset(msg->json_cache, 0, sizeof(msg->json_cache));
+    msg->tokens = 0;
+    history->edits++;
+
+    size_t tokens = ac_message_tokens(msg, history->family);
+    size_t bytes = tool_output_bytes(msg);
+    history->tokens = history->tokens - e->tokens + tokens;
+    history->bytes = history->bytes - e->bytes + bytes;
+    e->tokens = tokens;
+    e->bytes = bytes;
+}
+
+/**
+ * @brief Replace the tool results of an entry by markers
+ *
+ * Results backed by the entry's owned buffer are always replaced, so the
+ * buffer can be freed afterwards; others only from AC_HISTORY_ELIDE_MIN_BYTES.
+ *
+ * @return 1 if the message changed
+ */
+static int replace_tool_results(ac_history_t *history, ac_history_entry_t *e,
+                                arena_t *arena, int evict, const char *spill_dir) {
+    ac_message_t *msg = e->msg;
+    size_t min_bytes = e->owned ? 1 : AC_HISTORY_ELIDE_MIN_BYTES;
+    int changed = 0;
+    int complete = 1;
+
+    if (msg->role == AC_ROLE_TOOL) {
+        if (replace_result(&msg->content, &msg->content_len, msg->tool_call_id, arena,
+                           min_bytes, evict, spill_dir)) {
+            changed = 1;
+        } else if (ac_message_content(msg).len >= min_bytes) {
+            complete = 0;
+        }
+    }
+
+    for (ac_content_block_t *b = msg->blocks; b; b = b->next) {
+        if (b->type != AC_BLOCK_TOOL_RESULT) {
+            continue;
+        }
+        if (replace_result(&b->text, &b->text_len, b->id, arena,
+                           min_bytes, evict, spill_dir)) {
+            changed = 1;
+        } else if (ac_block_text(b).len >= min_bytes) {
+            complete = 0;
+        }
+    }
+
+    if (!changed) {
+        return 0;
+    }
+    entry_edited(history, e);
+
+    /* Repeats of these results now point at a marker (see history.h) */
+    size_t serial = entry_serial(history, (size_t)(e - history->entries), history->count);
+    for (size_t i = 0; i < history->result_count; i++) {
+        if (history->results[i].serial == serial) {
+            history->results[i].text = NULL;
+        }
+    }
+
+    /* A marker allocation failure leaves a result in the buffer: keep it */
+    if (complete && e->owned) {
+        ARC_FREE(e->owned);
+        e->owned = NULL;
+    }
+    return 1;
+}
+
+/**
+ * @brief Give one repeat of r its content back
+ *
+ * The content is copied into arena once (*copy) and shared by all
+ * repeats; without it (r elided or evicted, or out of memory) the repeat
+ * becomes an elide marker.
+ *
+ * @return 1 if text was a repeat of r
+ */
+static int restore_repeat(char **text, size_t *text_len, const ac_history_result_t *r,
+                          const char *marker, arena_t *arena, char **copy) {
+    ac_str_t current = ac_str_field(*text, *text_len);
+    if (!current.ptr || strlen(marker) != current.len ||
+        memcmp(current.ptr, marker, current.len) != 0) {
+        return 0;
+    }
+    if (r->text && !*copy) {
+        *copy = arena_strndup(arena, r->text, r->len);
+    }
+    char *restored = *copy ? *copy : elide_marker(arena, r->len);
+    if (restored) {
+        *text = restored;
+        *text_len = *copy ? r->len : strlen(restored);
+    }
+    return 1;
+}
+
+/**
+ * @brief Drop the stored results of messages about to be dropped
+ *
+ * Entries [first, end) of the total before the drop are going; their
+ * owned buffers are still allocated. A dropped result whose repeats stay
+ * behind hands them its content, and the first of them takes its place
+ * in the store.
+ */
+static void forget_results(ac_history_t *history, arena_t *arena, size_t end, size_t total) {
+    size_t kept_from = entry_serial(history, end, total);
+    size_t n = 0;
+    for (size_t i = 0; i < history->result_count; i++) {
+        ac_history_result_t r = history->results[i];
+        if (r.serial >= kept_from) {
+            history->results[n++] = r;
+            continue;
+        }
+
+        char marker[AC_HISTORY_MARKER_MAX];
+        if (!repeat_marker(r.id, r.len, marker)) {
+            continue;
+        }
+        char *copy = NULL;
+        int restored = 0;
+        for (size_t k = end; k < total; k++) {
+            ac_history_entry_t *e = &history->entries[k];
+            ac_message_t *msg = e->msg;
+            const char *id = NULL;
+            if (msg->role == AC_ROLE_TOOL &&
+                restore_repeat(&msg->content, &msg->content_len, &r, marker, arena, &copy)) {
+                id = msg->tool_call_id;
+            }
+            for (ac_content_block_t *b = msg->blocks; b; b = b->next) {
+                if (b->type == AC_BLOCK_TOOL_RESULT &&
+                    restore_repeat(&b->text, &b->text_len, &r, marker, arena, &copy)) {
+                    id = b->id;
+                }
+            }
+            if (!id) {
+                continue;
+            }
+            entry_edited(history, e);
+            if (copy && !restored) {
+                r.serial = entry_serial(history, k, total);
+                r.id = id;
+                r.text = copy;
+                history->results[n++] = r;
+                restored = 1;
+            }
+        }
+    }
+    history->result_count = n;
+}
+
+size_t ac_history_enforce(
+    ac_history_t *history,
+    arena_t *arena,
+    size_t max_messages,
+    size_t max_tokens
+) {
+    if (!history || !arena || !over_budget(history, max_messages, max_tokens)) {
+        return 0;
+    }
+
+    size_t before_count = history->count;
+    size_t before_tokens = history->tokens;
+    size_t elided = 0;
+    size_t dropped = 0;
+
+    /* Pass 1: elide old tool results, oldest first (each message once) */
+    size_t turn = current_turn(history);
+    for (size_t i = 0;
+         i < turn && max_tokens > 0 && history->tokens > max_tokens; i++) {
+        ac_history_entry_t *e = &history->entries[i];
+        if (!(e->flags & AC_HISTORY_TOOL_OUTPUT)) {
+            continue;
+        }
+        e->flags &= ~AC_HISTORY_TOOL_OUTPUT;
+        if (replace_tool_results(history, e, arena, 0, NULL)) {
+            elided++;
+        }
+    }
+
+    /* Pass 2: drop whole turns after the system prefix, in one splice */
+    size_t first = 0;
+    while (first < history->count &&
+           (history->entries[first].flags & AC_HISTORY_SYSTEM)) {
+        first++;
+    }
+
+    size_t total = history->count;
+    size_t end = first;
+    while (end < total && over_budget(history, max_messages, max_tokens)) {
+        size_t next = end + 1;
+        while (next < total &&
+               !(history->entries[next].flags & AC_HISTORY_TURN_START)) {
+            next++;
+        }
+        if (next >= total) {
+            /* Only the current turn is left */
+            break;
+        }
+        for (size_t i = end; i < next; i++) {
+            history->tokens -= history->entries[i].tokens;
+            history->bytes -= history->entries[i].bytes;
+        }
+        history->count -= next - end;
+        end = next;
+    }
+
+    if (end > first) {
+        dropped = end - first;
+        history->edits++;
+        if (history->result_count > 0) {
+            forget_results(history, arena, end, total);
+        }
+        for (size_t i = first; i < end; i++) {
+            ARC_FREE(history->entries[i].owned);
+        }
+        ac_message_t *next = history->entries[end].msg;
+        if (first > 0) {
+            history->entries[first - 1].msg->next = next;
+        } else {
+            history->head = next;
+        }
+        memmove(&history->entries[first], &history->entries[end],
+                (total - end) * sizeof(ac_history_entry_t));
+    }
+
+    if (elided || dropped) {
+        AC_LOG_INFO("History compacted: %zu->%zu messages, ~%zu->%zu tokens "
+                    "(%zu tool results elided, %zu messages dropped)",
+                    before_count, history->count, before_tokens, history->tokens,
+                    elided, dropped);
+    } else {
+        AC_LOG_DEBUG("History over budget but nothing left to compact "
+                     "(%zu messages, ~%zu tokens)", history->count, history->tokens);
+    }
+
+    return elided + dropped;
+}
+
+/*============================================================================
+ * Tool Output Cap
+ *============================================================================*/
+
+size_t ac_history_evict(
+    ac_history_t *history,
+    arena_t *arena,
+    size_t max_bytes,
+    const char *spill_dir
+) {
+    if (!history || !arena || max_bytes == 0 || history->bytes <= max_bytes) {
+        return 0;
+    }
+
+    size_t before_bytes = history->bytes;
+    size_t evicted = 0;
+
+    while (history->bytes > max_bytes) {
+        /* Largest candidate; the latest message is still unseen */
+        ac_history_entry_t *victim = NULL;
+        for (size_t i = 0; i + 1 < history->count; i++) {
+            ac_history_entry_t *e = &history->entries[i];
+            if (!(e->flags & AC_HISTORY_EVICTED) && e->bytes > 0 &&
+                (!victim || e->bytes > victim->bytes)) {
+                victim = e;
+            }
+        }
+        if (!victim) {
+            break;
+        }
+
+        /* Each message is considered once, evicted or not */
+        victim->flags |= AC_HISTORY_EVICTED;
+        victim->flags &= ~AC_HISTORY_TOOL_OUTPUT;
+        if (replace_tool_results(history, victim, arena, 1, spill_dir)) {
+            evicted++;
+        }
+    }
+
+    if (evicted) {
+        AC_LOG_INFO("Tool output evicted: %zu messages, %zu->%zu bytes (cap %zu)",
+                    evicted, before_bytes, history->bytes, max_bytes);
+    }
+    return evicted;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file history.h
+ * @brief Conversation history with token budget enforcement (internal)
+ *
+ * Keeps the agent's message list together with a running token estimate
+ * (ac_message_tokens() for the family in ac_history_t.family)
+ * and trims it to ac_memory_config_t limits before each LLM call:
+ *
+ * 1. Old tool results (before the current turn) are replaced by a short
+ *    marker, oldest first.
+ * 2. If still over budget, whole turns are dropped from the front. A turn
+ *    starts at a plain user message, so tool_use/tool_result pairs and
+ *    assistant thinking blocks (with signatures) are never split.
+ *
+ * Leading system messages and the current turn are always kept.
+ *
+ * Independently, ac_history_evict() caps the bytes of tool output held in
+ * history: the largest results are replaced by a stub (optionally after
+ * being spilled to a file) until the total fits. Results can be handed
+ * over as a heap buffer with ac_history_append_owned(), so evicting or
+ * dropping them returns the memory instead of stranding it in the arena.
+ *
+ * With dedup set, the history also keeps a content store: a hash of each
+ * tool result of AC_HISTORY_ELIDE_MIN_BYTES or more still in it. A new
+ * result equal to one of them goes in as a marker naming the earlier
+ * tool call (ac_history_find_repeat()), so it costs neither arena space
+ * nor request bytes. The earlier result is never edited for this, which
+ * keeps the cached prompt prefix intact. If it is dropped later, its
+ * repeats get the content back (one arena copy they share). If it is
+ * elided or evicted, they point at its marker, which says as much.
+ *
+ * Besides the linked list (the view providers and serializers walk), the
+ * history keeps a contiguous entry array: one slot per message with its
+ * token estimate and turn flag. Counting, random access and budget
+ * enforcement run over the array and touch a message only to edit it.
+ */
+
+#ifndef ARC_HISTORY_H
+#define ARC_HISTORY_H
+
+#include "arc/message.h"
+#include "arc/arena.h"
+#include "arc/tokens.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Tool results shorter than this are not worth eliding (bytes) */
+#define AC_HISTORY_ELIDE_MIN_BYTES  256
+
+/** Initial entry array capacity */
+#define AC_HISTORY_MIN_CAPACITY     32
+
+/** Buffer size for ac_history_find_repeat() markers */
+#define AC_HISTORY_MARKER_MAX       160
+
+/** ac_history_entry_t flags */
+#define AC_HISTORY_TURN_START       0x1   /* Plain user message: a turn begins here */
+#define AC_HISTORY_SYSTEM           0x2   /* System message (kept as prefix) */
+#define AC_HISTORY_TOOL_OUTPUT      0x4   /* Carries tool results not yet considered for eliding */
+#define AC_HISTORY_EVICTED          0x8   /* Tool results already considered for eviction */
+
+typedef struct {
+    ac_message_t *msg;
+    size_t tokens;                   /* Estimate, refreshed when the message is edited */
+    size_t bytes;                    /* Tool output bytes carried by the message */
+    char *owned;                     /* Heap buffer its tool output points into, or NULL */
+    unsigned flags;
+} ac_history_entry_t;
+
+/** A tool result in the content store */
+typedef struct {
+    uint64_t hash;
+    size_t len;
+    size_t serial;                   /* Append serial of the message carrying it */
+    const char *id;                  /* Its tool_call_id */
+    const char *text;                /* NULL once elided or evicted */
+} ac_history_result_t;
+
+typedef struct {
+    ac_message_t *head;
+    ac_message_t *tail;              /* O(1) append */
+    size_t count;
+    size_t tokens;                   /* Estimated, sum over messages */
+    size_t bytes;                    /* Tool output bytes, sum over messages */
+    ac_history_entry_t *entries;     /* entries[i].msg is the i-th list node (heap) */
+    size_t capacity;
+    ac_tokens_family_t family;       /* Estimator for appended messages (kept by reset) */
+    size_t edits;                    /* Bumped when a message is edited or dropped, and by reset */
+    size_t appended;                 /* Messages ever appended: serial of the next one */
+    int dedup;                       /* Keep the content store (kept by reset) */
+    ac_history_result_t *results;    /* Content store (heap) */
+    size_t result_count;
+    size_t result_capacity;
+} ac_history_t;
+
+/**
+ * @brief Append a message and account for its tokens
+ *
+ * @return ARC_OK, ARC_ERR_NO_MEMORY (history unchanged)
+ */
+arc_err_t ac_history_append(ac_history_t *history, ac_message_t *msg);
+
+/**
+ * @brief Append with a token estimate the caller already has
+ *
+ * Lets a restore skip re-reading every string.
+ */
+arc_err_t ac_history_append_estimated(ac_history_t *history, ac_message_t *msg,
+                                      size_t tokens);
+
+/**
+ * @brief Append a message whose large tool results point into owned
+ *
+ * On success the history owns the heap buffer and frees it once those
+ * results are elided, evicted or dropped; on error the caller keeps it.
+ */
+arc_err_t ac_history_append_owned(ac_history_t *history, ac_message_t *msg,
+                                  char *owned);
+
+/**
+ * @brief Deep copy of msg into arena
+ *
+ * Strings, tool calls and blocks are copied; json_cache and the token
+ * estimate are not carried over.
+ *
+ * @return Copy, NULL if arena is out of memory
+ */
+ac_message_t *ac_history_copy_message(arena_t *arena, const ac_message_t *src);
+
+/**
+ * @brief Make room for n more messages
+ */
+arc_err_t ac_history_reserve(ac_history_t *history, size_t n);
+
+/**
+ * @brief Message at index (0 = oldest), NULL if out of range
+ */
+ac_message_t *ac_history_at(const ac_history_t *history, size_t index);
+
+/**
+ * @brief Forget all messages and free the entry array
+ *
+ * The messages themselves belong to their arena and are not touched;
+ * owned tool output buffers are freed. family, edits and dedup are kept.
+ */
+void ac_history_reset(ac_history_t *history);
+
+/**
+ * @brief Stand-in for a tool result that repeats one still in history
+ *
+ * Looks text up in the content store (only kept with dedup set). Short
+ * results are never repeats.
+ *
+ * @param marker  Receives the marker, AC_HISTORY_MARKER_MAX bytes
+ * @return 1 if text is a repeat and marker was written, 0 if not
+ */
+int ac_history_find_repeat(const ac_history_t *history, const char *text, size_t len,
+                           char *marker);
+
+/**
+ * @brief Trim history to the given limits (0 = unlimited)
+ *
+ * Replacement markers are allocated from arena.
+ *
+ * @return Number of messages elided or dropped
+ */
+size_t ac_history_enforce(
+    ac_history_t *history,
+    arena_t *arena,
+    size_t max_messages,
+    size_t max_tokens
+);
+
+/**
+ * @brief Cap the tool output held in history at max_bytes (0 = unlimited)
+ *
+ * Evicts the largest tool results first, replacing each by a stub that
+ * keeps its tool_use_id so call/result pairing stays valid. The latest
+ * message is never evicted: the model has not seen it yet. With
+ * spill_dir set, results are written to <spill_dir>/<tool_call_id>.out
+ * first and the stub names the file. Stubs are allocated from arena.
+ *
+ * @return Number of messages whose tool output was evicted
+ */
+size_t ac_history_evict(
+    ac_history_t *history,
+    arena_t *arena,
+    size_t max_bytes,
+    const char *spill_dir
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HISTORY_H */
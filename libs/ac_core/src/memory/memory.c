@@ -0,0 +1,688 @@
+/**
+ * @file memory.c
+ * @brief Session memory with an append-only persistent log
+ *
+ * Messages live in an arena-backed ac_history_t, trimmed to the configured
+ * limits after every add. With persistence enabled each added message is
+ * also encoded once into a pending buffer; ac_memory_save() appends that
+ * buffer to the log file and clears it, so a save costs O(new messages)
+ * no matter how long the conversation is.
+ *
+ * Log format (all integers little-endian):
+ * @code
+ * file    := magic record*
+ * magic   := "ACMEMLG1"
+ * record  := u32 payload_len, u32 fnv1a32(payload), payload
+ * payload := u8 role, str content, str tool_call_id,
+ *            u32 n_calls, (str id, str name, str arguments)*,
+ *            u32 n_blocks, (u8 type, u8 is_error, str text, str signature,
+ *                           str data, str id, str name, str input)*
+ * str     := u32 len (0xFFFFFFFF = NULL), bytes
+ * @endcode
+ *
+ * The log keeps the full conversation; limits only apply to what is held
+ * in memory (and are re-applied on load). A record torn by a crash fails
+ * its length or checksum test; load keeps everything before it and
+ * rewrites the file without the torn tail, so later appends stay readable.
+ *
+ * With a flash partition configured the same records go to a flash log
+ * (flash_log.c) instead of the file. It is read back one record at a
+ * time through the log's page cache, so loading needs no buffer for the
+ * whole log.
+ */
+
+#include "arc/memory.h"
+#include "arc/message.h"
+#include "arc/arena.h"
+#include "arc/log.h"
+#include "flash_log.h"
+#include "history.h"
+#include "llm/message/attachment.h"
+#include "strbuf.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MEMORY_ARENA_SIZE   (64 * 1024)
+#define MEMORY_MAGIC        "ACMEMLG1"
+#define MEMORY_MAGIC_LEN    8
+#define MEMORY_RECORD_HDR   8
+#define MEMORY_STR_NULL     0xFFFFFFFFu
+#define MEMORY_PATH_MAX     1024
+
+struct ac_memory {
+    arena_t *arena;                  /* Messages and config strings */
+    ac_history_t history;
+    size_t max_messages;
+    size_t max_tokens;
+    char *session_id;
+    char *db_path;                   /* Log file, NULL unless persistence is enabled */
+    ac_flash_log_t *flash;           /* Or the flash log */
+    ac_strbuf_t pending;             /* Encoded records not yet saved */
+};
+
+static int persistent(const ac_memory_t *memory) {
+    return memory->db_path || memory->flash;
+}
+
+/*============================================================================
+ * Encoding
+ *============================================================================*/
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+           (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t fnv1a32(const unsigned char *p, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static arc_err_t enc_u32(ac_strbuf_t *sb, uint32_t v) {
+    unsigned char b[4];
+    put_u32(b, v);
+    return ac_strbuf_append(sb, (const char *)b, sizeof(b));
+}
+
+static arc_err_t enc_u8(ac_strbuf_t *sb, unsigned v) {
+    char b = (char)(unsigned char)v;
+    return ac_strbuf_append(sb, &b, 1);
+}
+
+static arc_err_t enc_bytes(ac_strbuf_t *sb, ac_str_t s) {
+    if (!s.ptr) {
+        return enc_u32(sb, MEMORY_STR_NULL);
+    }
+    arc_err_t err = enc_u32(sb, (uint32_t)s.len);
+    return err ? err : ac_strbuf_append(sb, s.ptr, s.len);
+}
+
+static arc_err_t enc_str(ac_strbuf_t *sb, const char *s) {
+    return enc_bytes(sb, ac_str(s));
+}
+
+/**
+ * @brief Append one record for msg to sb (sb is unchanged on failure)
+ */
+static arc_err_t encode_message(ac_strbuf_t *sb, const ac_message_t *msg) {
+    size_t start = sb->len;
+    uint32_t n_calls = 0, n_blocks = 0;
+    arc_err_t err;
+
+    for (const ac_tool_call_t *c = msg->tool_calls; c; c = c->next) n_calls++;
+    for (const ac_content_block_t *b = msg->blocks; b; b = b->next) n_blocks++;
+
+    /* Header is patched once the payload length is known */
+    err = enc_u32(sb, 0);
+    if (!err) err = enc_u32(sb, 0);
+    if (!err) err = enc_u8(sb, (unsigned)msg->role);
+    if (!err) err = enc_bytes(sb, ac_message_content(msg));
+    if (!err) err = enc_str(sb, msg->tool_call_id);
+    if (!err) err = enc_u32(sb, n_calls);
+    for (const ac_tool_call_t *c = msg->tool_calls; c && !err; c = c->next) {
+        err = enc_str(sb, c->id);
+        if (!err) err = enc_str(sb, c->name);
+        if (!err) err = enc_bytes(sb, ac_tool_call_arguments(c));
+    }
+    if (!err) err = enc_u32(sb, n_blocks);
+    for (const ac_content_block_t *b = msg->blocks; b && !err; b = b->next) {
+        err = enc_u8(sb, (unsigned)b->type);
+        if (!err) err = enc_u8(sb, b->is_error ? 1u : 0u);
+        if (!err) err = enc_bytes(sb, ac_block_text(b));
+        if (!err) err = enc_str(sb, b->signature);
+        if (!err) err = enc_str(sb, b->data);
+        if (!err) err = enc_str(sb, b->id);
+        if (!err) err = enc_str(sb, b->name);
+        if (!err) err = enc_bytes(sb, ac_block_input(b));
+    }
+
+    if (err) {
+        sb->len = start;
+        if (sb->data) {
+            sb->data[start] = '\0';
+        }
+        return err;
+    }
+
+    unsigned char *hdr = (unsigned char *)sb->data + start;
+    size_t payload = sb->len - start - MEMORY_RECORD_HDR;
+    put_u32(hdr, (uint32_t)payload);
+    put_u32(hdr + 4, fnv1a32(hdr + MEMORY_RECORD_HDR, payload));
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Decoding
+ *============================================================================*/
+
+typedef struct {
+    const unsigned char *p;          /* Payload in memory (log file) */
+    const unsigned char *end;
+    ac_flash_log_t *flash;           /* Or streamed from the flash log */
+    size_t left;                     /* Flash payload bytes not read yet */
+    arena_t *arena;
+    int bad;
+} reader_t;
+
+static size_t rd_left(const reader_t *r) {
+    return r->flash ? r->left : (size_t)(r->end - r->p);
+}
+
+static int rd_bytes(reader_t *r, void *dst, size_t len) {
+    if (r->bad || rd_left(r) < len) {
+        r->bad = 1;
+        return 0;
+    }
+    if (r->flash) {
+        if (ac_flash_log_read(r->flash, dst, len) != ARC_OK) {
+            r->bad = 1;
+            return 0;
+        }
+        r->left -= len;
+    } else {
+        memcpy(dst, r->p, len);
+        r->p += len;
+    }
+    return 1;
+}
+
+static uint32_t rd_u32(reader_t *r) {
+    unsigned char b[4];
+    return rd_bytes(r, b, sizeof(b)) ? get_u32(b) : 0;
+}
+
+static unsigned rd_u8(reader_t *r) {
+    unsigned char b;
+    return rd_bytes(r, &b, 1) ? b : 0;
+}
+
+/** A string; its length goes to len (may be NULL) */
+static char *rd_str_len(reader_t *r, size_t *len_out) {
+    uint32_t len = rd_u32(r);
+    if (r->bad || len == MEMORY_STR_NULL) {
+        return NULL;
+    }
+    if (rd_left(r) < len) {
+        r->bad = 1;
+        return NULL;
+    }
+    char *s = arena_alloc(r->arena, (size_t)len + 1);
+    if (!s) {
+        r->bad = 1;
+        return NULL;
+    }
+    if (!rd_bytes(r, s, len)) {
+        return NULL;
+    }
+    s[len] = '\0';
+    if (len_out) {
+        *len_out = len;
+    }
+    return s;
+}
+
+static char *rd_str(reader_t *r) {
+    return rd_str_len(r, NULL);
+}
+
+/**
+ * @brief Decode one record payload into an arena message
+ */
+static ac_message_t *decode_reader(reader_t *r) {
+    arena_t *arena = r->arena;
+
+    ac_message_t *msg = (ac_message_t *)arena_alloc(arena, sizeof(ac_message_t));
+    if (!msg) {
+        return NULL;
+    }
+    memset(msg, 0, sizeof(*msg));
+
+    msg->role = (ac_role_t)rd_u8(r);
+    msg->content = rd_str_len(r, &msg->content_len);
+    msg->tool_call_id = rd_str(r);
+
+    ac_tool_call_t **call_tail = &msg->tool_calls;
+    for (uint32_t n = rd_u32(r); n > 0 && !r->bad; n--) {
+        ac_tool_call_t *c = (ac_tool_call_t *)arena_alloc(arena, sizeof(ac_tool_call_t));
+        if (!c) {
+            return NULL;
+        }
+        memset(c, 0, sizeof(*c));
+        c->id = rd_str(r);
+        c->name = rd_str(r);
+        c->arguments = rd_str_len(r, &c->arguments_len);
+        *call_tail = c;
+        call_tail = &c->next;
+    }
+
+    ac_content_block_t **block_tail = &msg->blocks;
+    for (uint32_t n = rd_u32(r); n > 0 && !r->bad; n--) {
+        ac_content_block_t *b = (ac_content_block_t *)arena_alloc(arena, sizeof(ac_content_block_t));
+        if (!b) {
+            return NULL;
+        }
+        memset(b, 0, sizeof(*b));
+        b->type = (ac_block_type_t)rd_u8(r);
+        b->is_error = (int)rd_u8(r);
+        b->text = rd_str_len(r, &b->text_len);
+        b->signature = rd_str(r);
+        b->data = rd_str(r);
+        b->id = rd_str(r);
+        b->name = rd_str(r);
+        b->input = rd_str_len(r, &b->input_len);
+        if (!r->bad && ac_attachment_restore(arena, b) != ARC_OK) {
+            r->bad = 1;
+        }
+        *block_tail = b;
+        block_tail = &b->next;
+    }
+
+    return r->bad || rd_left(r) != 0 ? NULL : msg;
+}
+
+static ac_message_t *decode_message(arena_t *arena, const unsigned char *p, size_t len) {
+    reader_t r = { .p = p, .end = p + len, .arena = arena };
+    return decode_reader(&r);
+}
+
+/*============================================================================
+ * Log File
+ *============================================================================*/
+
+/**
+ * @brief Whole file into a heap buffer (ARC_FREE); *len = 0 if missing
+ */
+static arc_err_t read_log(const char *path, unsigned char **out, size_t *len) {
+    *out = NULL;
+    *len = 0;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return ARC_OK;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(fp);
+        return ARC_ERR_IO;
+    }
+    if (size == 0) {
+        fclose(fp);
+        return ARC_OK;
+    }
+
+    unsigned char *buf = (unsigned char *)ARC_MALLOC((size_t)size);
+    if (!buf) {
+        fclose(fp);
+        return ARC_ERR_NO_MEMORY;
+    }
+    size_t got = fread(buf, 1, (size_t)size, fp);
+    fclose(fp);
+    if (got != (size_t)size) {
+        ARC_FREE(buf);
+        return ARC_ERR_IO;
+    }
+
+    *out = buf;
+    *len = got;
+    return ARC_OK;
+}
+
+/**
+ * @brief Replace the log with its first len bytes (drops a torn tail)
+ */
+static arc_err_t rewrite_log(const char *path, const unsigned char *data, size_t len) {
+    char tmp[MEMORY_PATH_MAX];
+    int n = snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (n <= 0 || (size_t)n >= sizeof(tmp)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        return ARC_ERR_IO;
+    }
+    int ok = fwrite(data, 1, len, fp) == len;
+    ok = fclose(fp) == 0 && ok;
+    if (!ok) {
+        remove(tmp);
+        return ARC_ERR_IO;
+    }
+
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (rename(tmp, path) != 0) {
+        remove(tmp);
+        return ARC_ERR_IO;
+    }
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Memory API
+ *============================================================================*/
+
+ac_memory_t *ac_memory_create(const ac_memory_config_t *config) {
+    arena_t *arena = arena_create(MEMORY_ARENA_SIZE);
+    if (!arena) {
+        AC_LOG_ERROR("Failed to create memory arena");
+        return NULL;
+    }
+
+    ac_memory_t *memory = (ac_memory_t *)arena_alloc(arena, sizeof(ac_memory_t));
+    if (!memory) {
+        arena_destroy(arena);
+        return NULL;
+    }
+    memset(memory, 0, sizeof(*memory));
+    memory->arena = arena;
+    memory->pending = (ac_strbuf_t)AC_STRBUF_INIT;
+
+    if (config) {
+        memory->max_messages = config->max_messages;
+        memory->max_tokens = config->max_tokens;
+        if (config->session_id) {
+            memory->session_id = arena_strdup(arena, config->session_id);
+        }
+        if (config->enable_persistence && config->flash) {
+            memory->flash = ac_flash_log_open(config->flash);
+            if (!memory->flash) {
+                AC_LOG_ERROR("Memory: cannot open the flash log");
+                arena_destroy(arena);
+                return NULL;
+            }
+        } else if (config->enable_persistence) {
+            if (!config->db_path || !config->db_path[0]) {
+                AC_LOG_ERROR("Memory persistence requires db_path or flash");
+                arena_destroy(arena);
+                return NULL;
+            }
+            memory->db_path = arena_strdup(arena, config->db_path);
+            if (!memory->db_path) {
+                arena_destroy(arena);
+                return NULL;
+            }
+        }
+    }
+
+    return memory;
+}
+
+void ac_memory_destroy(ac_memory_t *memory) {
+    if (!memory) {
+        return;
+    }
+
+    if (memory->pending.len > 0 && ac_memory_save(memory) != ARC_OK) {
+        AC_LOG_WARN("Memory: %zu unsaved bytes lost", memory->pending.len);
+    }
+
+    ac_strbuf_reset(&memory->pending);
+    ac_history_reset(&memory->history);
+    ac_flash_log_close(memory->flash);
+    arena_destroy(memory->arena);
+}
+
+static void enforce_limits(ac_memory_t *memory) {
+    if (memory->max_messages || memory->max_tokens) {
+        ac_history_enforce(&memory->history, memory->arena,
+                           memory->max_messages, memory->max_tokens);
+    }
+}
+
+arc_err_t ac_memory_add(ac_memory_t *memory, const struct ac_message *message) {
+    if (!memory || !message) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    /* Encode first: trimming may later elide the in-memory copy */
+    size_t mark = memory->pending.len;
+    if (persistent(memory)) {
+        arc_err_t err = encode_message(&memory->pending, message);
+        if (err != ARC_OK) {
+            return err;
+        }
+    }
+
+    ac_message_t *copy = ac_history_copy_message(memory->arena, message);
+    if (!copy) {
+        if (persistent(memory)) {
+            memory->pending.len = mark;
+            memory->pending.data[mark] = '\0';
+        }
+        AC_LOG_ERROR("Failed to copy message into memory");
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    arc_err_t err = ac_history_append(&memory->history, copy);
+    if (err != ARC_OK) {
+        if (persistent(memory)) {
+            memory->pending.len = mark;
+            memory->pending.data[mark] = '\0';
+        }
+        return err;
+    }
+    enforce_limits(memory);
+    return ARC_OK;
+}
+
+const struct ac_message *ac_memory_get_messages(ac_memory_t *memory) {
+    return memory ? memory->history.head : NULL;
+}
+
+size_t ac_memory_count(ac_memory_t *memory) {
+    return memory ? memory->history.count : 0;
+}
+
+void ac_memory_clear(ac_memory_t *memory) {
+    if (!memory) {
+        return;
+    }
+
+    ac_history_reset(&memory->history);
+    ac_strbuf_clear(&memory->pending);
+
+    if (memory->flash) {
+        if (ac_flash_log_clear(memory->flash) != ARC_OK) {
+            AC_LOG_WARN("Memory: cannot clear the flash log");
+        }
+    } else if (memory->db_path) {
+        FILE *fp = fopen(memory->db_path, "wb");
+        if (fp) {
+            fclose(fp);
+        } else {
+            AC_LOG_WARN("Memory: cannot truncate %s", memory->db_path);
+        }
+    }
+}
+
+struct ac_message *ac_memory_get_last_n(ac_memory_t *memory, size_t n) {
+    if (!memory || n == 0) {
+        return NULL;
+    }
+
+    /* The list is NULL-terminated, so any suffix is itself a list */
+    ac_message_t *msg = memory->history.head;
+    for (size_t skip = memory->history.count > n ? memory->history.count - n : 0;
+         skip > 0 && msg; skip--) {
+        msg = msg->next;
+    }
+    return msg;
+}
+
+/**
+ * @brief Append the pending records to the flash log
+ *
+ * Each append is durable on return, so the records already written are
+ * dropped from pending even if a later one fails.
+ */
+static arc_err_t save_flash(ac_memory_t *memory) {
+    const unsigned char *data = (const unsigned char *)memory->pending.data;
+    size_t len = memory->pending.len;
+    size_t off = 0;
+    arc_err_t err = ARC_OK;
+
+    while (off < len) {
+        size_t rec = MEMORY_RECORD_HDR + get_u32(data + off);
+        err = ac_flash_log_append(memory->flash, data + off, rec);
+        if (err != ARC_OK) {
+            AC_LOG_ERROR("Memory: write to the flash log failed");
+            break;
+        }
+        off += rec;
+    }
+
+    memmove(memory->pending.data, memory->pending.data + off, len - off);
+    memory->pending.len = len - off;
+    memory->pending.data[memory->pending.len] = '\0';
+    return err == ARC_OK ? ARC_OK : ARC_ERR_IO;
+}
+
+/**
+ * @brief Replace the in-memory messages with the flash log's records
+ */
+static arc_err_t load_flash(ac_memory_t *memory) {
+    ac_history_reset(&memory->history);
+    ac_flash_log_rewind(memory->flash);
+
+    size_t len;
+    arc_err_t err;
+    while ((err = ac_flash_log_next(memory->flash, &len)) == ARC_OK) {
+        reader_t r = { .flash = memory->flash, .left = len, .arena = memory->arena };
+        ac_message_t *msg = decode_reader(&r);
+        if (!msg || ac_history_append(&memory->history, msg) != ARC_OK) {
+            /* Checksum matched, so the record is intact: out of memory */
+            AC_LOG_ERROR("Memory: cannot decode a flash log record");
+            return ARC_ERR_NO_MEMORY;
+        }
+    }
+    if (err != ARC_ERR_NOT_FOUND) {
+        AC_LOG_ERROR("Memory: cannot read the flash log");
+        return ARC_ERR_IO;
+    }
+
+    enforce_limits(memory);
+    AC_LOG_DEBUG("Memory: loaded %zu messages from flash", memory->history.count);
+    return ARC_OK;
+}
+
+arc_err_t ac_memory_save(ac_memory_t *memory) {
+    if (!memory) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (!persistent(memory)) {
+        return ARC_ERR_INVALID_STATE;
+    }
+    if (memory->pending.len == 0) {
+        return ARC_OK;
+    }
+    if (memory->flash) {
+        return save_flash(memory);
+    }
+
+    FILE *fp = fopen(memory->db_path, "ab");
+    if (!fp) {
+        AC_LOG_ERROR("Memory: cannot open %s", memory->db_path);
+        return ARC_ERR_IO;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    int ok = 1;
+    if (ftell(fp) == 0) {
+        ok = fwrite(MEMORY_MAGIC, 1, MEMORY_MAGIC_LEN, fp) == MEMORY_MAGIC_LEN;
+    }
+    ok = ok && fwrite(memory->pending.data, 1, memory->pending.len, fp) == memory->pending.len;
+    ok = fclose(fp) == 0 && ok;
+
+    if (!ok) {
+        /* Keep the records pending; a partial tail is dropped on load */
+        AC_LOG_ERROR("Memory: write to %s failed", memory->db_path);
+        return ARC_ERR_IO;
+    }
+
+    ac_strbuf_clear(&memory->pending);
+    return ARC_OK;
+}
+
+arc_err_t ac_memory_load(ac_memory_t *memory) {
+    if (!memory) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (!persistent(memory)) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    /* Unsaved adds go to the log first so the reload includes them */
+    arc_err_t err = ac_memory_save(memory);
+    if (err != ARC_OK) {
+        return err;
+    }
+    if (memory->flash) {
+        return load_flash(memory);
+    }
+
+    unsigned char *buf;
+    size_t len;
+    err = read_log(memory->db_path, &buf, &len);
+    if (err != ARC_OK) {
+        AC_LOG_ERROR("Memory: cannot read %s", memory->db_path);
+        return err;
+    }
+    if (len > 0 && (len < MEMORY_MAGIC_LEN ||
+                    memcmp(buf, MEMORY_MAGIC, MEMORY_MAGIC_LEN) != 0)) {
+        AC_LOG_ERROR("Memory: %s is not a memory log", memory->db_path);
+        ARC_FREE(buf);
+        return ARC_ERR_PARSE;
+    }
+
+    /* Loaded messages replace the in-memory ones */
+    ac_history_reset(&memory->history);
+
+    size_t off = len > 0 ? MEMORY_MAGIC_LEN : 0;
+    while (len - off >= MEMORY_RECORD_HDR) {
+        uint32_t payload = get_u32(buf + off);
+        uint32_t sum = get_u32(buf + off + 4);
+        const unsigned char *p = buf + off + MEMORY_RECORD_HDR;
+        if (payload > len - off - MEMORY_RECORD_HDR || fnv1a32(p, payload) != sum) {
+            break;
+        }
+
+        ac_message_t *msg = decode_message(memory->arena, p, payload);
+        if (!msg || ac_history_append(&memory->history, msg) != ARC_OK) {
+            /* Checksum matched, so the log is intact: out of memory */
+            AC_LOG_ERROR("Memory: cannot decode record at offset %zu", off);
+            ARC_FREE(buf);
+            return ARC_ERR_NO_MEMORY;
+        }
+        off += MEMORY_RECORD_HDR + payload;
+    }
+
+    if (off < len) {
+        AC_LOG_WARN("Memory: dropping %zu torn bytes at end of %s",
+                    len - off, memory->db_path);
+        if (rewrite_log(memory->db_path, buf, off) != ARC_OK) {
+            AC_LOG_WARN("Memory: cannot rewrite %s", memory->db_path);
+        }
+    }
+    ARC_FREE(buf);
+
+    enforce_limits(memory);
+    AC_LOG_DEBUG("Memory: loaded %zu messages from %s",
+                 memory->history.count, memory->db_path);
+    return ARC_OK;
+}
@@ -5,6 +5,7 @@
 
 #include "arc/message.h"
 #include "arc/log.h"
+#include "intern.h"
 #include <string.h>
 
 /*============================================================================
@@ -25,8 +26,8 @@ const char* ac_role_to_string(ac_role_t role) {
  * Message Creation
  *============================================================================*/
 
-ac_message_t* ac_message_create(arena_t* arena, ac_role_t role, const char* content) {
-    if (!arena || !content) {
+ac_message_t* ac_message_create_str(arena_t* arena, ac_role_t role, ac_str_t content) {
+    if (!arena || !content.ptr) {
         AC_LOG_ERROR("Invalid arguments to ac_message_create");
         return NULL;
     }
@@ -38,10 +39,14 @@ ac_message_t* ac_message_create(arena_t* arena, ac_role_t role, const char* cont
     }
 
     msg->role = role;
-    msg->content = arena_strdup(arena, content);
+    msg->content = arena_strndup(arena, content.ptr, content.len);
+    msg->content_len = content.len;
     msg->blocks = NULL;
     msg->tool_call_id = NULL;
     msg->tool_calls = NULL;
+    memset(msg->json_cache, 0, sizeof(msg->json_cache));
+    msg->tokens = 0;
+    msg->tokens_family = 0;
     msg->next = NULL;
 
     if (!msg->content) {
@@ -52,12 +57,16 @@ ac_message_t* ac_message_create(arena_t* arena, ac_role_t role, const char* cont
     return msg;
 }
 
-ac_message_t* ac_message_create_tool_result(
+ac_message_t* ac_message_create(arena_t* arena, ac_role_t role, const char* content) {
+    return ac_message_create_str(arena, role, ac_str(content));
+}
+
+ac_message_t* ac_message_create_tool_result_str(
     arena_t* arena,
     const char* tool_call_id,
-    const char* content
+    ac_str_t content
 ) {
-    if (!arena || !tool_call_id || !content) {
+    if (!arena || !tool_call_id || !content.ptr) {
         AC_LOG_ERROR("Invalid arguments to ac_message_create_tool_result");
         return NULL;
     }
@@ -69,10 +78,14 @@ ac_message_t* ac_message_create_tool_result(
     }
 
     msg->role = AC_ROLE_TOOL;
-    msg->content = arena_strdup(arena, content);
+    msg->content = arena_strndup(arena, content.ptr, content.len);
+    msg->content_len = content.len;
     msg->blocks = NULL;
     msg->tool_call_id = arena_strdup(arena, tool_call_id);
     msg->tool_calls = NULL;
+    memset(msg->json_cache, 0, sizeof(msg->json_cache));
+    msg->tokens = 0;
+    msg->tokens_family = 0;
     msg->next = NULL;
 
     if (!msg->content || !msg->tool_call_id) {
@@ -83,6 +96,14 @@ ac_message_t* ac_message_create_tool_result(
     return msg;
 }
 
+ac_message_t* ac_message_create_tool_result(
+    arena_t* arena,
+    const char* tool_call_id,
+    const char* content
+) {
+    return ac_message_create_tool_result_str(arena, tool_call_id, ac_str(content));
+}
+
 /*============================================================================
  * Message List Operations
  *============================================================================*/
@@ -139,7 +160,8 @@ ac_tool_call_t* ac_tool_call_create(
 
     call->id = arena_strdup(arena, id);
     call->name = arena_strdup(arena, name);
-    call->arguments = arguments ? arena_strdup(arena, arguments) : NULL;
+    call->arguments_len = arguments ? strlen(arguments) : 0;
+    call->arguments = arguments ? arena_strndup(arena, arguments, call->arguments_len) : NULL;
     call->next = NULL;
 
     if (!call->id || !call->name) {
@@ -184,10 +206,14 @@ ac_message_t* ac_message_create_with_tool_calls(
     }
 
     msg->role = AC_ROLE_ASSISTANT;
-    msg->content = content ? arena_strdup(arena, content) : NULL;
+    msg->content_len = content ? strlen(content) : 0;
+    msg->content = content ? arena_strndup(arena, content, msg->content_len) : NULL;
     msg->tool_call_id = NULL;
     msg->tool_calls = tool_calls;
     msg->blocks = NULL;
+    memset(msg->json_cache, 0, sizeof(msg->json_cache));
+    msg->tokens = 0;
+    msg->tokens_family = 0;
     msg->next = NULL;
 
     return msg;
@@ -205,6 +231,7 @@ const char* ac_block_type_to_string(ac_block_type_t type) {
         case AC_BLOCK_REASONING:         return "reasoning";
         case AC_BLOCK_TOOL_USE:          return "tool_use";
         case AC_BLOCK_TOOL_RESULT:       return "tool_result";
+        case AC_BLOCK_IMAGE:             return "image";
         default:                         return "unknown";
     }
 }
@@ -223,7 +250,8 @@ ac_content_block_t* ac_block_create_text(arena_t* arena, const char* text) {
 
     memset(block, 0, sizeof(ac_content_block_t));
     block->type = AC_BLOCK_TEXT;
-    block->text = arena_strdup(arena, text);
+    block->text_len = strlen(text);
+    block->text = arena_strndup(arena, text, block->text_len);
 
     if (!block->text) {
         AC_LOG_ERROR("Failed to duplicate text content");
@@ -251,7 +279,8 @@ ac_content_block_t* ac_block_create_thinking(
 
     memset(block, 0, sizeof(ac_content_block_t));
     block->type = AC_BLOCK_THINKING;
-    block->text = arena_strdup(arena, thinking);
+    block->text_len = strlen(thinking);
+    block->text = arena_strndup(arena, thinking, block->text_len);
     block->signature = signature ? arena_strdup(arena, signature) : NULL;
 
     if (!block->text) {
@@ -307,7 +336,8 @@ ac_content_block_t* ac_block_create_tool_use(
     block->type = AC_BLOCK_TOOL_USE;
     block->id = arena_strdup(arena, id);
     block->name = arena_strdup(arena, name);
-    block->input = input ? arena_strdup(arena, input) : NULL;
+    block->input_len = input ? strlen(input) : 0;
+    block->input = input ? arena_strndup(arena, input, block->input_len) : NULL;
 
     if (!block->id || !block->name) {
         AC_LOG_ERROR("Failed to duplicate tool use strings");
@@ -337,7 +367,8 @@ ac_content_block_t* ac_block_create_tool_result(
     memset(block, 0, sizeof(ac_content_block_t));
     block->type = AC_BLOCK_TOOL_RESULT;
     block->id = arena_strdup(arena, tool_use_id);
-    block->text = arena_strdup(arena, content);
+    block->text_len = strlen(content);
+    block->text = arena_strndup(arena, content, block->text_len);
     block->is_error = is_error;
 
     if (!block->id || !block->text) {
@@ -413,6 +444,16 @@ const char* ac_response_thinking(const ac_chat_response_t* resp) {
     return NULL;
 }
 
+/**
+ * @brief Copy a tool name or id, shared through resp->intern when it uses arena
+ */
+static char* copy_ident(arena_t* arena, const ac_chat_response_t* resp, const char* s) {
+    if (resp->intern && ac_intern_arena(resp->intern) == arena) {
+        return (char*)ac_intern(resp->intern, s);
+    }
+    return arena_strdup(arena, s);
+}
+
 ac_message_t* ac_message_from_response(arena_t* arena, const ac_chat_response_t* resp) {
     if (!arena || !resp) {
         AC_LOG_ERROR("Invalid arguments to ac_message_from_response");
@@ -428,6 +469,19 @@ ac_message_t* ac_message_from_response(arena_t* arena, const ac_chat_response_t*
     memset(msg, 0, sizeof(ac_message_t));
     msg->role = AC_ROLE_ASSISTANT;
 
+    /* Parsed into this arena already: share the storage */
+    if (resp->arena == arena) {
+        msg->blocks = resp->blocks;
+        if (resp->content) {
+            msg->content = resp->content;
+            msg->content_len = resp->content_len;
+        } else {
+            msg->content = (char*)ac_response_text(resp);
+        }
+        msg->tool_calls = resp->tool_calls;
+        return msg;
+    }
+
     /* Copy content blocks if present (preserve order for thinking models) */
     if (resp->blocks) {
         ac_content_block_t* last_block = NULL;
@@ -443,12 +497,20 @@ ac_message_t* ac_message_from_response(arena_t* arena, const ac_chat_response_t*
             dst->type = src->type;
             
             /* Copy type-specific fields */
-            if (src->text) dst->text = arena_strdup(arena, src->text);
+            if (src->text) {
+                ac_str_t text = ac_block_text(src);
+                dst->text = arena_strndup(arena, text.ptr, text.len);
+                dst->text_len = text.len;
+            }
             if (src->signature) dst->signature = arena_strdup(arena, src->signature);
             if (src->data) dst->data = arena_strdup(arena, src->data);
-            if (src->id) dst->id = arena_strdup(arena, src->id);
-            if (src->name) dst->name = arena_strdup(arena, src->name);
-            if (src->input) dst->input = arena_strdup(arena, src->input);
+            if (src->id) dst->id = copy_ident(arena, resp, src->id);
+            if (src->name) dst->name = copy_ident(arena, resp, src->name);
+            if (src->input) {
+                ac_str_t input = ac_block_input(src);
+                dst->input = arena_strndup(arena, input.ptr, input.len);
+                dst->input_len = input.len;
+            }
             dst->is_error = src->is_error;
             
             if (!msg->blocks) {
@@ -462,7 +524,9 @@ ac_message_t* ac_message_from_response(arena_t* arena, const ac_chat_response_t*
     
     /* Also set legacy content field for backward compatibility */
     if (resp->content) {
-        msg->content = arena_strdup(arena, resp->content);
+        ac_str_t content = ac_response_content(resp);
+        msg->content = arena_strndup(arena, content.ptr, content.len);
+        msg->content_len = content.len;
     } else {
         /* Try to extract text from blocks */
         const char* text = ac_response_text(resp);
@@ -476,11 +540,19 @@ ac_message_t* ac_message_from_response(arena_t* arena, const ac_chat_response_t*
         ac_tool_call_t* last_call = NULL;
         
         for (ac_tool_call_t* src = resp->tool_calls; src; src = src->next) {
-            ac_tool_call_t* dst = ac_tool_call_create(arena, src->id, src->name, src->arguments);
+            ac_tool_call_t* dst = src->id && src->name ?
+                (ac_tool_call_t*)arena_alloc(arena, sizeof(ac_tool_call_t)) : NULL;
             if (!dst) {
                 AC_LOG_ERROR("Failed to copy tool call");
                 return NULL;
             }
+            dst->id = src->id ? copy_ident(arena, resp, src->id) : NULL;
+            dst->name = src->name ? copy_ident(arena, resp, src->name) : NULL;
+            ac_str_t arguments = ac_tool_call_arguments(src);
+            dst->arguments = src->arguments ? arena_strndup(arena, arguments.ptr, arguments.len)
+                                            : NULL;
+            dst->arguments_len = arguments.len;
+            dst->next = NULL;
             
             if (!msg->tool_calls) {
                 msg->tool_calls = dst;
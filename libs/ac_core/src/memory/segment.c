@@ -0,0 +1,228 @@
+/**
+ * @file segment.c
+ * @brief Shared, immutable history segments
+ *
+ * Freezing deep-copies the messages once, together with their token
+ * estimate and serialized fragments, so every agent that attaches the
+ * segment sends the shared prefix without re-serializing it. After that
+ * the segment is read-only; only the reference count changes.
+ */
+
+#include "segment.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include <string.h>
+
+#define SEGMENT_ARENA_SIZE  (16 * 1024)
+
+struct ac_history_segment {
+    pthread_mutex_t lock;            /* Guards refs */
+    size_t refs;
+    ac_history_segment_t *parent;    /* Prefix (referenced), NULL = root */
+    arena_t *arena;                  /* Messages of this segment */
+    ac_message_t **messages;         /* This segment's own, oldest first */
+    size_t count;
+    size_t total;                    /* Messages across the chain */
+};
+
+/*============================================================================
+ * Freezing
+ *============================================================================*/
+
+/**
+ * @brief Deep copy that also keeps the estimate and serialized fragments
+ */
+static ac_message_t *freeze_message(arena_t *arena, const ac_message_t *src) {
+    ac_message_t *msg = ac_history_copy_message(arena, src);
+    if (!msg) {
+        return NULL;
+    }
+    msg->tokens = src->tokens;
+    msg->tokens_family = src->tokens_family;
+    for (int i = 0; i < AC_MESSAGE_JSON_SLOTS; i++) {
+        if (src->json_cache[i]) {
+            /* A lost fragment is only re-serialized later */
+            msg->json_cache[i] = arena_strdup(arena, src->json_cache[i]);
+        }
+    }
+    return msg;
+}
+
+arc_err_t ac_segment_freeze(
+    ac_history_segment_t *parent,
+    const ac_history_t *history,
+    size_t from,
+    ac_history_segment_t **out
+) {
+    if (!history || !out || from > history->count ||
+        (parent ? parent->total != from : from != 0)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    /* Nothing new: the prefix already is the history */
+    if (parent && from == history->count) {
+        *out = ac_history_segment_retain(parent);
+        return ARC_OK;
+    }
+
+    ac_history_segment_t *segment =
+        (ac_history_segment_t *)ARC_CALLOC(1, sizeof(ac_history_segment_t));
+    if (!segment) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    segment->arena = arena_create(SEGMENT_ARENA_SIZE);
+    size_t count = history->count - from;
+    if (segment->arena && count > 0) {
+        segment->messages = (ac_message_t **)arena_alloc(
+            segment->arena, count * sizeof(ac_message_t *));
+    }
+    if (!segment->arena || (count > 0 && !segment->messages)) {
+        arena_destroy(segment->arena);
+        ARC_FREE(segment);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        segment->messages[i] = freeze_message(segment->arena,
+                                              ac_history_at(history, from + i));
+        if (!segment->messages[i]) {
+            arena_destroy(segment->arena);
+            ARC_FREE(segment);
+            return ARC_ERR_NO_MEMORY;
+        }
+    }
+
+    pthread_mutex_init(&segment->lock, NULL);
+    segment->refs = 1;
+    segment->parent = parent ? ac_history_segment_retain(parent) : NULL;
+    segment->count = count;
+    segment->total = from + count;
+    *out = segment;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Attaching
+ *============================================================================*/
+
+/**
+ * @brief List node for src: shares its strings, owns its block nodes
+ *
+ * History edits replace block text in place, so each attacher needs
+ * its own block list; tool calls are never edited and stay shared.
+ */
+static int attach_node(arena_t *arena, ac_message_t *node, const ac_message_t *src) {
+    *node = *src;
+    node->next = NULL;
+
+    ac_content_block_t **tail = &node->blocks;
+    for (const ac_content_block_t *b = src->blocks; b; b = b->next) {
+        ac_content_block_t *copy =
+            (ac_content_block_t *)arena_alloc(arena, sizeof(ac_content_block_t));
+        if (!copy) {
+            return 0;
+        }
+        *copy = *b;
+        copy->next = NULL;
+        *tail = copy;
+        tail = &copy->next;
+    }
+    return 1;
+}
+
+arc_err_t ac_segment_attach(
+    const ac_history_segment_t *segment,
+    ac_history_t *history,
+    arena_t *arena,
+    size_t skip
+) {
+    if (!segment || !history || !arena) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (skip >= segment->total) {
+        return ARC_OK;
+    }
+
+    /* Chain root first; walked once instead of per message */
+    size_t depth = 0;
+    for (const ac_history_segment_t *s = segment; s; s = s->parent) {
+        depth++;
+    }
+    const ac_history_segment_t **chain =
+        (const ac_history_segment_t **)ARC_MALLOC(depth * sizeof(*chain));
+    size_t n = segment->total - skip;
+    ac_message_t *nodes = (ac_message_t *)arena_alloc(arena, n * sizeof(ac_message_t));
+    if (!chain || !nodes || ac_history_reserve(history, n) != ARC_OK) {
+        ARC_FREE(chain);
+        return ARC_ERR_NO_MEMORY;
+    }
+    size_t d = depth;
+    for (const ac_history_segment_t *s = segment; s; s = s->parent) {
+        chain[--d] = s;
+    }
+
+    arc_err_t err = ARC_OK;
+    size_t index = 0;
+    ac_message_t *node = nodes;
+    for (d = 0; d < depth && err == ARC_OK; d++) {
+        for (size_t i = 0; i < chain[d]->count && err == ARC_OK; i++, index++) {
+            if (index < skip) {
+                continue;
+            }
+            if (!attach_node(arena, node, chain[d]->messages[i]) ||
+                ac_history_append(history, node) != ARC_OK) {
+                err = ARC_ERR_NO_MEMORY;
+            }
+            node++;
+        }
+    }
+
+    ARC_FREE(chain);
+    return err;
+}
+
+const ac_message_t *ac_segment_at(const ac_history_segment_t *segment, size_t index) {
+    if (!segment || index >= segment->total) {
+        return NULL;
+    }
+    while (index < segment->total - segment->count) {
+        segment = segment->parent;
+    }
+    return segment->messages[index - (segment->total - segment->count)];
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+ac_history_segment_t *ac_history_segment_retain(ac_history_segment_t *segment) {
+    if (segment) {
+        pthread_mutex_lock(&segment->lock);
+        segment->refs++;
+        pthread_mutex_unlock(&segment->lock);
+    }
+    return segment;
+}
+
+void ac_history_segment_release(ac_history_segment_t *segment) {
+    /* Iterative: a long handoff chain must not recurse per link */
+    while (segment) {
+        pthread_mutex_lock(&segment->lock);
+        size_t refs = --segment->refs;
+        pthread_mutex_unlock(&segment->lock);
+        if (refs > 0) {
+            return;
+        }
+
+        ac_history_segment_t *parent = segment->parent;
+        arena_destroy(segment->arena);
+        pthread_mutex_destroy(&segment->lock);
+        ARC_FREE(segment);
+        segment = parent;
+    }
+}
+
+size_t ac_history_segment_count(const ac_history_segment_t *segment) {
+    return segment ? segment->total : 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file segment.h
+ * @brief Shared, immutable history segments (internal)
+ *
+ * A segment is a frozen run of messages in its own arena, reference
+ * counted so any number of agents can start from it. Segments chain: a
+ * segment frozen from a history that already starts with another one
+ * holds a reference to that prefix and copies only the messages after it,
+ * so a handoff chain costs O(new messages) per step.
+ *
+ * Attaching a segment to a history allocates fresh list nodes (and block
+ * nodes) that point at the segment's strings, tool calls and serialized
+ * fragments. History edits only ever swap pointers in those nodes, so
+ * the segment stays untouched: copy-on-write for the per-agent parts,
+ * shared for everything else.
+ */
+
+#ifndef ARC_SEGMENT_H
+#define ARC_SEGMENT_H
+
+#include "history.h"
+#include "arc/agent.h"
+#include "arc/arena.h"
+#include "arc/error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Freeze history[from, count) on top of parent
+ *
+ * parent (may be NULL when from is 0) must hold exactly the first from
+ * messages; the new segment keeps a reference to it.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_segment_freeze(
+    ac_history_segment_t *parent,
+    const ac_history_t *history,
+    size_t from,
+    ac_history_segment_t **out
+);
+
+/**
+ * @brief Append node copies of every message of segment (oldest first)
+ *
+ * skip leading messages are left out. Nodes are allocated from arena;
+ * the segment must outlive them.
+ *
+ * @return ARC_OK, ARC_ERR_NO_MEMORY (history may hold a partial prefix)
+ */
+arc_err_t ac_segment_attach(
+    const ac_history_segment_t *segment,
+    ac_history_t *history,
+    arena_t *arena,
+    size_t skip
+);
+
+/**
+ * @brief Message at index across the chain (0 = oldest), NULL if out of range
+ */
+const ac_message_t *ac_segment_at(const ac_history_segment_t *segment, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_SEGMENT_H */
@@ -0,0 +1,470 @@
+/**
+ * @file snapshot.c
+ * @brief Read-in-place binary snapshots of a conversation history
+ *
+ * Layout (native byte order, checked on restore; records 8-byte aligned):
+ * @code
+ * snap_header_t
+ * snap_msg_t   [n_messages]     blocks/calls: index range into the arrays below
+ * snap_block_t [n_blocks]
+ * snap_call_t  [n_calls]
+ * char         strings[strings_len]   NUL-terminated, referenced by offset
+ * @endcode
+ *
+ * Restore never touches the string pool beyond its last byte: records
+ * carry their token estimate, offsets are range-checked and the pool must
+ * end in NUL, so every reference is a terminated string inside the map.
+ */
+
+#include "snapshot.h"
+#include "llm/message/attachment.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(ARC_PLATFORM_EMBEDDED)
+#define SNAPSHOT_HAS_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define SNAP_MAGIC      "ACSNAP01"
+#define SNAP_BYTE_ORDER 0x01020304u
+#define SNAP_NULL       UINT64_MAX
+#define SNAP_PATH_MAX   1024
+
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t reserved;
+    uint64_t n_messages;
+    uint64_t n_blocks;
+    uint64_t n_calls;
+    uint64_t reserved2;
+    uint64_t strings_len;
+    uint64_t file_size;
+} snap_header_t;
+
+typedef struct {
+    uint32_t role;
+    uint32_t n_blocks;
+    uint32_t n_calls;
+    uint32_t tokens;                 /* History estimate at save time */
+    uint64_t content;
+    uint64_t tool_call_id;
+    uint64_t first_block;
+    uint64_t first_call;
+} snap_msg_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t is_error;
+    uint64_t text;
+    uint64_t signature;
+    uint64_t data;
+    uint64_t id;
+    uint64_t name;
+    uint64_t input;
+} snap_block_t;
+
+typedef struct {
+    uint64_t id;
+    uint64_t name;
+    uint64_t arguments;
+} snap_call_t;
+
+struct ac_snapshot {
+    void *addr;
+    size_t len;
+    int mapped;                      /* 0: addr is arena memory */
+};
+
+/*============================================================================
+ * Write
+ *============================================================================*/
+
+typedef struct {
+    FILE *fp;
+    uint64_t strings_len;
+    int ok;
+} snap_writer_t;
+
+/**
+ * @brief Reserve s in the pool; returns its offset (strings written later)
+ */
+/* Pool strings are read back NUL-terminated: one with NULs inside ends at the first */
+static uint64_t pool_ref(snap_writer_t *w, ac_str_t s) {
+    if (!s.ptr) {
+        return SNAP_NULL;
+    }
+    uint64_t off = w->strings_len;
+    w->strings_len += s.len + 1;
+    return off;
+}
+
+static void pool_put(snap_writer_t *w, ac_str_t s) {
+    if (s.ptr && w->ok) {
+        w->ok = fwrite(s.ptr, 1, s.len + 1, w->fp) == s.len + 1;
+    }
+}
+
+static void put_record(snap_writer_t *w, const void *rec, size_t size) {
+    if (w->ok) {
+        w->ok = fwrite(rec, 1, size, w->fp) == size;
+    }
+}
+
+arc_err_t ac_snapshot_write(const ac_history_t *history, const char *path) {
+    if (!history || !path) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    char tmp[SNAP_PATH_MAX];
+    int n = snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (n <= 0 || (size_t)n >= sizeof(tmp)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    snap_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+    hdr.byte_order = SNAP_BYTE_ORDER;
+    for (const ac_message_t *m = history->head; m; m = m->next) {
+        hdr.n_messages++;
+        for (const ac_content_block_t *b = m->blocks; b; b = b->next) hdr.n_blocks++;
+        for (const ac_tool_call_t *c = m->tool_calls; c; c = c->next) hdr.n_calls++;
+    }
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        AC_LOG_ERROR("Snapshot: cannot create %s", tmp);
+        return ARC_ERR_IO;
+    }
+
+    /* Header is rewritten once the pool size is known */
+    snap_writer_t w = { fp, 0, 1 };
+    put_record(&w, &hdr, sizeof(hdr));
+
+    /* Records in three passes so each array is contiguous */
+    uint64_t next_block = 0, next_call = 0;
+    size_t index = 0;
+    for (const ac_message_t *m = history->head; m; m = m->next, index++) {
+        snap_msg_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.role = (uint32_t)m->role;
+        rec.tokens = (uint32_t)history->entries[index].tokens;
+        rec.content = pool_ref(&w, ac_message_content(m));
+        rec.tool_call_id = pool_ref(&w, ac_str(m->tool_call_id));
+        rec.first_block = next_block;
+        rec.first_call = next_call;
+        for (const ac_content_block_t *b = m->blocks; b; b = b->next) rec.n_blocks++;
+        for (const ac_tool_call_t *c = m->tool_calls; c; c = c->next) rec.n_calls++;
+        next_block += rec.n_blocks;
+        next_call += rec.n_calls;
+        put_record(&w, &rec, sizeof(rec));
+    }
+    for (const ac_message_t *m = history->head; m; m = m->next) {
+        for (const ac_content_block_t *b = m->blocks; b; b = b->next) {
+            snap_block_t rec;
+            rec.type = (uint32_t)b->type;
+            rec.is_error = (uint32_t)b->is_error;
+            rec.text = pool_ref(&w, ac_block_text(b));
+            rec.signature = pool_ref(&w, ac_str(b->signature));
+            rec.data = pool_ref(&w, ac_str(b->data));
+            rec.id = pool_ref(&w, ac_str(b->id));
+            rec.name = pool_ref(&w, ac_str(b->name));
+            rec.input = pool_ref(&w, ac_block_input(b));
+            put_record(&w, &rec, sizeof(rec));
+        }
+    }
+    for (const ac_message_t *m = history->head; m; m = m->next) {
+        for (const ac_tool_call_t *c = m->tool_calls; c; c = c->next) {
+            snap_call_t rec;
+            rec.id = pool_ref(&w, ac_str(c->id));
+            rec.name = pool_ref(&w, ac_str(c->name));
+            rec.arguments = pool_ref(&w, ac_tool_call_arguments(c));
+            put_record(&w, &rec, sizeof(rec));
+        }
+    }
+
+    /* Pool, in the order the references were handed out */
+    for (const ac_message_t *m = history->head; m; m = m->next) {
+        pool_put(&w, ac_message_content(m));
+        pool_put(&w, ac_str(m->tool_call_id));
+    }
+    for (const ac_message_t *m = history->head; m; m = m->next) {
+        for (const ac_content_block_t *b = m->blocks; b; b = b->next) {
+            pool_put(&w, ac_block_text(b));
+            pool_put(&w, ac_str(b->signature));
+            pool_put(&w, ac_str(b->data));
+            pool_put(&w, ac_str(b->id));
+            pool_put(&w, ac_str(b->name));
+            pool_put(&w, ac_block_input(b));
+        }
+    }
+    for (const ac_message_t *m = history->head; m; m = m->next) {
+        for (const ac_tool_call_t *c = m->tool_calls; c; c = c->next) {
+            pool_put(&w, ac_str(c->id));
+            pool_put(&w, ac_str(c->name));
+            pool_put(&w, ac_tool_call_arguments(c));
+        }
+    }
+
+    /* Restore requires a NUL-terminated pool, even an empty one */
+    if (w.strings_len == 0) {
+        put_record(&w, "", 1);
+        w.strings_len = 1;
+    }
+
+    hdr.strings_len = w.strings_len;
+    hdr.file_size = sizeof(hdr) + hdr.n_messages * sizeof(snap_msg_t) +
+                    hdr.n_blocks * sizeof(snap_block_t) +
+                    hdr.n_calls * sizeof(snap_call_t) + hdr.strings_len;
+    if (w.ok) {
+        w.ok = fseek(fp, 0, SEEK_SET) == 0;
+    }
+    put_record(&w, &hdr, sizeof(hdr));
+
+    int ok = fclose(fp) == 0 && w.ok;
+#ifdef _WIN32
+    if (ok) {
+        remove(path);
+    }
+#endif
+    if (!ok || rename(tmp, path) != 0) {
+        AC_LOG_ERROR("Snapshot: write to %s failed", path);
+        remove(tmp);
+        return ARC_ERR_IO;
+    }
+
+    AC_LOG_DEBUG("Snapshot: wrote %llu messages to %s",
+                 (unsigned long long)hdr.n_messages, path);
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Restore
+ *============================================================================*/
+
+static arc_err_t snapshot_open(const char *path, arena_t *arena, ac_snapshot_t *snap) {
+#ifdef SNAPSHOT_HAS_MMAP
+    (void)arena;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ARC_ERR_NOT_FOUND;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(snap_header_t)) {
+        close(fd);
+        return ARC_ERR_PARSE;
+    }
+    void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return ARC_ERR_IO;
+    }
+    snap->addr = addr;
+    snap->len = (size_t)st.st_size;
+    snap->mapped = 1;
+    return ARC_OK;
+#else
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return ARC_ERR_NOT_FOUND;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size < (long)sizeof(snap_header_t)) {
+        fclose(fp);
+        return ARC_ERR_PARSE;
+    }
+    char *buf = arena_alloc(arena, (size_t)size);
+    if (!buf) {
+        fclose(fp);
+        return ARC_ERR_NO_MEMORY;
+    }
+    size_t got = fread(buf, 1, (size_t)size, fp);
+    fclose(fp);
+    if (got != (size_t)size) {
+        return ARC_ERR_IO;
+    }
+    snap->addr = buf;
+    snap->len = (size_t)size;
+    snap->mapped = 0;
+    return ARC_OK;
+#endif
+}
+
+static void snapshot_close(ac_snapshot_t *snap) {
+#ifdef SNAPSHOT_HAS_MMAP
+    if (snap->mapped) {
+        munmap(snap->addr, snap->len);
+    }
+#endif
+    snap->addr = NULL;
+}
+
+/**
+ * @brief String at off in the pool (NULL ref allowed); *bad on range error
+ */
+static char *pool_at(char *pool, uint64_t len, uint64_t off, int *bad) {
+    if (off == SNAP_NULL) {
+        return NULL;
+    }
+    if (off >= len) {
+        *bad = 1;
+        return NULL;
+    }
+    return pool + off;
+}
+
+/**
+ * @brief Check header sizes against the file; 0 if inconsistent
+ */
+static int header_valid(const snap_header_t *h, size_t file_len) {
+    if (memcmp(h->magic, SNAP_MAGIC, sizeof(h->magic)) != 0 ||
+        h->byte_order != SNAP_BYTE_ORDER || h->file_size != file_len ||
+        h->strings_len == 0) {
+        return 0;
+    }
+    /* Each count is bounded by the file, so the sums below cannot wrap */
+    uint64_t room = file_len - sizeof(*h);
+    if (h->n_messages > room / sizeof(snap_msg_t) ||
+        h->n_blocks > room / sizeof(snap_block_t) ||
+        h->n_calls > room / sizeof(snap_call_t) || h->strings_len > room) {
+        return 0;
+    }
+    return sizeof(*h) + h->n_messages * sizeof(snap_msg_t) +
+           h->n_blocks * sizeof(snap_block_t) +
+           h->n_calls * sizeof(snap_call_t) + h->strings_len == file_len;
+}
+
+arc_err_t ac_snapshot_restore(
+    ac_history_t *history,
+    arena_t *arena,
+    const char *path,
+    ac_snapshot_t **out
+) {
+    if (!history || !arena || !path || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    ac_snapshot_t snap;
+    arc_err_t err = snapshot_open(path, arena, &snap);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    const snap_header_t *hdr = (const snap_header_t *)snap.addr;
+    if (!header_valid(hdr, snap.len)) {
+        AC_LOG_ERROR("Snapshot: %s is not a valid snapshot", path);
+        snapshot_close(&snap);
+        return ARC_ERR_PARSE;
+    }
+
+    const snap_msg_t *msgs = (const snap_msg_t *)(hdr + 1);
+    const snap_block_t *blocks = (const snap_block_t *)(msgs + hdr->n_messages);
+    const snap_call_t *calls = (const snap_call_t *)(blocks + hdr->n_blocks);
+    char *pool = (char *)(calls + hdr->n_calls);
+    uint64_t pool_len = hdr->strings_len;
+    if (pool[pool_len - 1] != '\0') {
+        snapshot_close(&snap);
+        return ARC_ERR_PARSE;
+    }
+
+    /* All nodes in one allocation each; strings stay in the mapping */
+    ac_snapshot_t *handle = (ac_snapshot_t *)ARC_MALLOC(sizeof(*handle));
+    ac_message_t *m_out = hdr->n_messages ?
+        (ac_message_t *)arena_alloc(arena, hdr->n_messages * sizeof(ac_message_t)) : NULL;
+    ac_content_block_t *b_out = hdr->n_blocks ?
+        (ac_content_block_t *)arena_alloc(arena, hdr->n_blocks * sizeof(ac_content_block_t)) : NULL;
+    ac_tool_call_t *c_out = hdr->n_calls ?
+        (ac_tool_call_t *)arena_alloc(arena, hdr->n_calls * sizeof(ac_tool_call_t)) : NULL;
+    if (!handle || (hdr->n_messages && !m_out) || (hdr->n_blocks && !b_out) ||
+        (hdr->n_calls && !c_out) ||
+        ac_history_reserve(history, (size_t)hdr->n_messages) != ARC_OK) {
+        ARC_FREE(handle);
+        snapshot_close(&snap);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    int bad = 0;
+    for (uint64_t i = 0; i < hdr->n_blocks && !bad; i++) {
+        const snap_block_t *r = &blocks[i];
+        ac_content_block_t *b = &b_out[i];
+        memset(b, 0, sizeof(*b));
+        b->type = (ac_block_type_t)r->type;
+        b->is_error = (int)r->is_error;
+        b->text = pool_at(pool, pool_len, r->text, &bad);
+        b->signature = pool_at(pool, pool_len, r->signature, &bad);
+        b->data = pool_at(pool, pool_len, r->data, &bad);
+        b->id = pool_at(pool, pool_len, r->id, &bad);
+        b->name = pool_at(pool, pool_len, r->name, &bad);
+        b->input = pool_at(pool, pool_len, r->input, &bad);
+        if (!bad && ac_attachment_restore(arena, b) != ARC_OK) {
+            bad = 1;
+        }
+    }
+    for (uint64_t i = 0; i < hdr->n_calls && !bad; i++) {
+        const snap_call_t *r = &calls[i];
+        ac_tool_call_t *c = &c_out[i];
+        c->id = pool_at(pool, pool_len, r->id, &bad);
+        c->name = pool_at(pool, pool_len, r->name, &bad);
+        c->arguments = pool_at(pool, pool_len, r->arguments, &bad);
+        c->next = NULL;
+    }
+    for (uint64_t i = 0; i < hdr->n_messages && !bad; i++) {
+        const snap_msg_t *r = &msgs[i];
+        ac_message_t *m = &m_out[i];
+        memset(m, 0, sizeof(*m));
+        if (r->first_block > hdr->n_blocks || r->n_blocks > hdr->n_blocks - r->first_block ||
+            r->first_call > hdr->n_calls || r->n_calls > hdr->n_calls - r->first_call) {
+            bad = 1;
+            break;
+        }
+        m->role = (ac_role_t)r->role;
+        m->content = pool_at(pool, pool_len, r->content, &bad);
+        m->tool_call_id = pool_at(pool, pool_len, r->tool_call_id, &bad);
+        for (uint32_t k = 0; k < r->n_blocks; k++) {
+            ac_content_block_t *b = &b_out[r->first_block + k];
+            b->next = k + 1 < r->n_blocks ? b + 1 : NULL;
+        }
+        for (uint32_t k = 0; k < r->n_calls; k++) {
+            ac_tool_call_t *c = &c_out[r->first_call + k];
+            c->next = k + 1 < r->n_calls ? c + 1 : NULL;
+        }
+        m->blocks = r->n_blocks ? &b_out[r->first_block] : NULL;
+        m->tool_calls = r->n_calls ? &c_out[r->first_call] : NULL;
+    }
+    if (bad) {
+        AC_LOG_ERROR("Snapshot: %s has out-of-range references", path);
+        ARC_FREE(handle);
+        snapshot_close(&snap);
+        return ARC_ERR_PARSE;
+    }
+
+    /* Room was reserved and the estimates are stored: cannot fail */
+    for (uint64_t i = 0; i < hdr->n_messages; i++) {
+        ac_history_append_estimated(history, &m_out[i], msgs[i].tokens);
+    }
+
+    *handle = snap;
+    *out = handle;
+    AC_LOG_DEBUG("Snapshot: restored %llu messages from %s",
+                 (unsigned long long)hdr->n_messages, path);
+    return ARC_OK;
+}
+
+void ac_snapshot_unmap(ac_snapshot_t *snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    snapshot_close(snapshot);
+    ARC_FREE(snapshot);
+}
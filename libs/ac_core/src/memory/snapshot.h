@@ -0,0 +1,61 @@
+/**
+ * @file snapshot.h
+ * @brief Read-in-place binary snapshots of a conversation history (internal)
+ *
+ * A snapshot is a flat image: a header, fixed-size message, block and
+ * tool call records that refer to each other and to strings by offset,
+ * and a pool of NUL-terminated strings. Restoring maps the file and
+ * allocates only the linked-list nodes; every string points into the
+ * mapping, so a large conversation costs one mmap and one arena_alloc.
+ *
+ * Where mmap is unavailable the file is read into the arena instead.
+ */
+
+#ifndef ARC_SNAPSHOT_H
+#define ARC_SNAPSHOT_H
+
+#include "history.h"
+#include "arc/arena.h"
+#include "arc/error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A mapped snapshot; strings of restored messages live here */
+typedef struct ac_snapshot ac_snapshot_t;
+
+/**
+ * @brief Write history to path (temporary file + rename)
+ *
+ * @return ARC_OK, ARC_ERR_IO, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_snapshot_write(const ac_history_t *history, const char *path);
+
+/**
+ * @brief Map path and rebuild its messages into history
+ *
+ * Nodes are allocated from arena and appended to history (which the
+ * caller normally empties first). The returned mapping must outlive the
+ * messages; release it with ac_snapshot_unmap().
+ *
+ * @return ARC_OK, ARC_ERR_NOT_FOUND, ARC_ERR_PARSE (not a snapshot or
+ *         corrupt), ARC_ERR_IO, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_snapshot_restore(
+    ac_history_t *history,
+    arena_t *arena,
+    const char *path,
+    ac_snapshot_t **out
+);
+
+/**
+ * @brief Release a mapping (NULL-safe)
+ */
+void ac_snapshot_unmap(ac_snapshot_t *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_SNAPSHOT_H */
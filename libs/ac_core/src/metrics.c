@@ -0,0 +1,461 @@
+/**
+ * @file metrics.c
+ * @brief Striped metrics registry with OpenMetrics rendering
+ *
+ * Series are published into a fixed array whose count is stored with
+ * release order, so lookups scan it without a lock; only creating a
+ * series takes the mutex. Values live in AC_METRICS_STRIPES cells, one
+ * cache line apart; a thread picks its stripe once and adds to it with
+ * relaxed atomics. Histograms keep a row of log-linear buckets (HDR
+ * style: AC_METRICS_HIST_SUB_BITS of precision per power of two) and
+ * a sum per stripe.
+ */
+
+#include "arc/metrics.h"
+#include "arc/platform.h"
+#include "pthread_port.h"
+#include "strbuf.h"
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CACHE_LINE   64
+
+#define HIST_SUB     (1u << AC_METRICS_HIST_SUB_BITS)
+#define HIST_BUCKETS ((AC_METRICS_HIST_MAX_EXP - AC_METRICS_HIST_SUB_BITS + 2) * HIST_SUB)
+
+/** One stripe of a histogram: buckets then sum, padded to whole cache lines */
+#define HIST_ROW     ((((HIST_BUCKETS + 1) * 8 + CACHE_LINE - 1) / CACHE_LINE) * (CACHE_LINE / 8))
+
+typedef struct {
+    _Atomic int64_t v;
+    char pad[CACHE_LINE - sizeof(int64_t)];
+} metric_cell_t;
+
+struct ac_metric {
+    ac_metric_type_t type;
+    uint64_t hash;
+    char *name;
+    char *labels;                    /* NULL = none */
+    char *help;
+    double unit;
+    metric_cell_t cells[AC_METRICS_STRIPES];    /* Counter, gauge */
+    _Atomic uint64_t *hist;                     /* Histogram: AC_METRICS_STRIPES rows */
+};
+
+static ac_metric_t *s_series[AC_METRICS_MAX_SERIES];
+static atomic_size_t s_count;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*============================================================================
+ * Stripes
+ *============================================================================*/
+
+#ifdef ARC_THREAD_LOCAL
+static ARC_THREAD_LOCAL int t_stripe = -1;
+static atomic_uint s_next_stripe;
+
+static int thread_stripe(void) {
+    if (t_stripe < 0) {
+        t_stripe = (int)(atomic_fetch_add_explicit(&s_next_stripe, 1, memory_order_relaxed) %
+                         AC_METRICS_STRIPES);
+    }
+    return t_stripe;
+}
+#else
+static int thread_stripe(void) {
+    return 0;
+}
+#endif
+
+/*============================================================================
+ * Histogram Buckets
+ *============================================================================*/
+
+static size_t hist_index(uint64_t v) {
+    if (v < HIST_SUB) {
+        return (size_t)v;
+    }
+    int e = 63;
+    while (!(v >> e)) {
+        e--;
+    }
+    if (e > AC_METRICS_HIST_MAX_EXP) {
+        return HIST_BUCKETS - 1;
+    }
+    int shift = e - AC_METRICS_HIST_SUB_BITS;
+    return (size_t)(e - AC_METRICS_HIST_SUB_BITS + 1) * HIST_SUB +
+           (size_t)((v >> shift) & (HIST_SUB - 1));
+}
+
+/** Highest value counted in bucket idx */
+static uint64_t hist_bucket_max(size_t idx) {
+    if (idx < HIST_SUB) {
+        return idx;
+    }
+    if (idx == HIST_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    int e = (int)(idx / HIST_SUB) + AC_METRICS_HIST_SUB_BITS - 1;
+    int shift = e - AC_METRICS_HIST_SUB_BITS;
+    uint64_t lower = (uint64_t)(HIST_SUB + idx % HIST_SUB) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+/** Merge the stripes of a histogram; returns the count */
+static uint64_t hist_merge(const ac_metric_t *m, uint64_t *buckets, uint64_t *sum) {
+    uint64_t count = 0;
+    memset(buckets, 0, HIST_BUCKETS * sizeof(uint64_t));
+    *sum = 0;
+    for (int s = 0; s < AC_METRICS_STRIPES; s++) {
+        const _Atomic uint64_t *row = m->hist + (size_t)s * HIST_ROW;
+        for (size_t i = 0; i < HIST_BUCKETS; i++) {
+            uint64_t n = atomic_load_explicit(&row[i], memory_order_relaxed);
+            buckets[i] += n;
+            count += n;
+        }
+        *sum += atomic_load_explicit(&row[HIST_BUCKETS], memory_order_relaxed);
+    }
+    return count;
+}
+
+/*============================================================================
+ * Registry
+ *============================================================================*/
+
+static uint64_t series_hash(const char *name, const char *labels) {
+    uint64_t h = 1469598103934665603ULL;
+    for (const char *p = name; *p; p++) {
+        h = (h ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    h = (h ^ 0xff) * 1099511628211ULL;
+    for (const char *p = labels ? labels : ""; *p; p++) {
+        h = (h ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static int series_is(const ac_metric_t *m, uint64_t hash, const char *name, const char *labels) {
+    return m->hash == hash && strcmp(m->name, name) == 0 &&
+           strcmp(m->labels ? m->labels : "", labels ? labels : "") == 0;
+}
+
+/** Find (name, labels) among the first n series; *clash set if name has another type */
+static ac_metric_t *series_find(size_t n, ac_metric_type_t type, uint64_t hash,
+                                const char *name, const char *labels, int *clash) {
+    for (size_t i = 0; i < n; i++) {
+        ac_metric_t *m = s_series[i];
+        if (strcmp(m->name, name) != 0) {
+            continue;
+        }
+        if (m->type != type) {
+            *clash = 1;
+            return NULL;
+        }
+        if (series_is(m, hash, name, labels)) {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+static void series_free(ac_metric_t *m) {
+    ARC_FREE(m->name);
+    ARC_FREE(m->labels);
+    ARC_FREE(m->help);
+    ARC_FREE((void *)m->hist);
+    ARC_FREE(m);
+}
+
+static ac_metric_t *series_get(ac_metric_type_t type, const char *name, const char *labels,
+                               const char *help, double unit) {
+    if (!name || !name[0]) {
+        return NULL;
+    }
+    if (labels && !labels[0]) {
+        labels = NULL;
+    }
+    uint64_t hash = series_hash(name, labels);
+    int clash = 0;
+
+    ac_metric_t *m = series_find(atomic_load_explicit(&s_count, memory_order_acquire),
+                                 type, hash, name, labels, &clash);
+    if (m || clash) {
+        return m;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    size_t n = atomic_load_explicit(&s_count, memory_order_relaxed);
+    m = series_find(n, type, hash, name, labels, &clash);
+    if (m || clash || n >= AC_METRICS_MAX_SERIES) {
+        pthread_mutex_unlock(&s_lock);
+        return m;
+    }
+
+    m = (ac_metric_t *)ARC_CALLOC(1, sizeof(ac_metric_t));
+    if (m) {
+        m->type = type;
+        m->hash = hash;
+        m->unit = unit;
+        m->name = ARC_STRDUP(name);
+        m->labels = labels ? ARC_STRDUP(labels) : NULL;
+        m->help = ARC_STRDUP(help ? help : "");
+        if (type == AC_METRIC_HISTOGRAM) {
+            m->hist = (_Atomic uint64_t *)ARC_CALLOC((size_t)AC_METRICS_STRIPES * HIST_ROW,
+                                                     sizeof(uint64_t));
+        }
+        if (!m->name || !m->help || (labels && !m->labels) ||
+            (type == AC_METRIC_HISTOGRAM && !m->hist)) {
+            series_free(m);
+            m = NULL;
+        }
+    }
+    if (m) {
+        s_series[n] = m;
+        atomic_store_explicit(&s_count, n + 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return m;
+}
+
+ac_metric_t *ac_metrics_counter(const char *name, const char *labels, const char *help) {
+    return series_get(AC_METRIC_COUNTER, name, labels, help, 1.0);
+}
+
+ac_metric_t *ac_metrics_gauge(const char *name, const char *labels, const char *help) {
+    return series_get(AC_METRIC_GAUGE, name, labels, help, 1.0);
+}
+
+ac_metric_t *ac_metrics_histogram(const char *name, const char *labels, const char *help,
+                                  double unit) {
+    return series_get(AC_METRIC_HISTOGRAM, name, labels, help, unit > 0.0 ? unit : 1.0);
+}
+
+/*============================================================================
+ * Recording
+ *============================================================================*/
+
+void ac_metric_add(ac_metric_t *metric, int64_t delta) {
+    if (!metric || metric->type == AC_METRIC_HISTOGRAM ||
+        (metric->type == AC_METRIC_COUNTER && delta < 0)) {
+        return;
+    }
+    atomic_fetch_add_explicit(&metric->cells[thread_stripe()].v, delta, memory_order_relaxed);
+}
+
+void ac_metric_set(ac_metric_t *metric, int64_t value) {
+    if (!metric || metric->type != AC_METRIC_GAUGE) {
+        return;
+    }
+    for (int s = 1; s < AC_METRICS_STRIPES; s++) {
+        atomic_store_explicit(&metric->cells[s].v, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&metric->cells[0].v, value, memory_order_relaxed);
+}
+
+void ac_metric_observe(ac_metric_t *metric, uint64_t value) {
+    if (!metric || metric->type != AC_METRIC_HISTOGRAM) {
+        return;
+    }
+    _Atomic uint64_t *row = metric->hist + (size_t)thread_stripe() * HIST_ROW;
+    atomic_fetch_add_explicit(&row[hist_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&row[HIST_BUCKETS], value, memory_order_relaxed);
+}
+
+/*============================================================================
+ * Reading
+ *============================================================================*/
+
+int64_t ac_metric_value(const ac_metric_t *metric) {
+    if (!metric) {
+        return 0;
+    }
+    if (metric->type == AC_METRIC_HISTOGRAM) {
+        uint64_t buckets[HIST_BUCKETS];
+        uint64_t sum;
+        return (int64_t)hist_merge(metric, buckets, &sum);
+    }
+    int64_t v = 0;
+    for (int s = 0; s < AC_METRICS_STRIPES; s++) {
+        v += atomic_load_explicit(&metric->cells[s].v, memory_order_relaxed);
+    }
+    return v;
+}
+
+uint64_t ac_metric_percentile(const ac_metric_t *metric, double p) {
+    if (!metric || metric->type != AC_METRIC_HISTOGRAM) {
+        return 0;
+    }
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t sum;
+    uint64_t count = hist_merge(metric, buckets, &sum);
+    if (count == 0) {
+        return 0;
+    }
+    if (p < 0.0) p = 0.0;
+    if (p > 1.0) p = 1.0;
+
+    uint64_t rank = (uint64_t)(p * (double)count + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HIST_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return hist_bucket_max(i);
+        }
+    }
+    return hist_bucket_max(HIST_BUCKETS - 1);
+}
+
+void ac_metrics_reset(void) {
+    size_t n = atomic_load_explicit(&s_count, memory_order_acquire);
+    for (size_t i = 0; i < n; i++) {
+        ac_metric_t *m = s_series[i];
+        for (int s = 0; s < AC_METRICS_STRIPES; s++) {
+            atomic_store_explicit(&m->cells[s].v, 0, memory_order_relaxed);
+        }
+        if (m->hist) {
+            for (size_t k = 0; k < (size_t)AC_METRICS_STRIPES * HIST_ROW; k++) {
+                atomic_store_explicit(&m->hist[k], 0, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+/*============================================================================
+ * OpenMetrics Rendering
+ *============================================================================*/
+
+static void put(ac_strbuf_t *sb, int *failed, const char *fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+static void put(ac_strbuf_t *sb, int *failed, const char *fmt, ...) {
+    char line[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n >= sizeof(line)) {
+        n = (int)sizeof(line) - 1;
+    }
+    if (ac_strbuf_append(sb, line, (size_t)n) != ARC_OK) {
+        *failed = 1;
+    }
+}
+
+/** HELP text with backslash and newline escaped */
+static void put_help(ac_strbuf_t *sb, int *failed, const char *name, const char *help) {
+    char text[256];
+    size_t j = 0;
+    for (const char *p = help; *p && j + 2 < sizeof(text); p++) {
+        if (*p == '\\' || *p == '\n') {
+            text[j++] = '\\';
+            text[j++] = *p == '\n' ? 'n' : '\\';
+        } else {
+            text[j++] = *p;
+        }
+    }
+    text[j] = '\0';
+    put(sb, failed, "# HELP %s %s\n", name, text);
+}
+
+static void render_histogram(ac_strbuf_t *sb, int *failed, const ac_metric_t *m) {
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t sum;
+    uint64_t count = hist_merge(m, buckets, &sum);
+    const char *labels = m->labels ? m->labels : "";
+    const char *sep = m->labels ? "," : "";
+
+    /* Cumulative counts below each power of two, through the highest in use */
+    size_t top = 0;
+    for (size_t i = 0; i < HIST_BUCKETS; i++) {
+        if (buckets[i]) {
+            top = i;
+        }
+    }
+    if (count > 0) {
+        size_t next = 0;
+        uint64_t cumulative = 0;
+        for (int k = 0; k <= AC_METRICS_HIST_MAX_EXP; k++) {
+            size_t edge = hist_index((uint64_t)1 << k);
+            while (next < edge) {
+                cumulative += buckets[next++];
+            }
+            put(sb, failed, "%s_bucket{%s%sle=\"%.6g\"} %llu\n", m->name, labels, sep,
+                (double)((uint64_t)1 << k) * m->unit, (unsigned long long)cumulative);
+            if (edge > top) {
+                break;
+            }
+        }
+    }
+    put(sb, failed, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", m->name, labels, sep,
+        (unsigned long long)count);
+    put(sb, failed, "%s_count%s%s%s %llu\n", m->name, m->labels ? "{" : "", labels,
+        m->labels ? "}" : "", (unsigned long long)count);
+    put(sb, failed, "%s_sum%s%s%s %.9g\n", m->name, m->labels ? "{" : "", labels,
+        m->labels ? "}" : "", (double)sum * m->unit);
+}
+
+arc_err_t ac_metrics_render(char **out, size_t *len) {
+    static const char *const type_names[] = { "counter", "gauge", "histogram" };
+
+    if (!out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    ac_strbuf_t sb = AC_STRBUF_INIT;
+    int failed = 0;
+    size_t n = atomic_load_explicit(&s_count, memory_order_acquire);
+
+    for (size_t i = 0; i < n; i++) {
+        const ac_metric_t *first = s_series[i];
+
+        /* A family's series are rendered together, at its first one */
+        size_t seen = 0;
+        while (seen < i && strcmp(s_series[seen]->name, first->name) != 0) {
+            seen++;
+        }
+        if (seen < i) {
+            continue;
+        }
+
+        put(&sb, &failed, "# TYPE %s %s\n", first->name, type_names[first->type]);
+        put_help(&sb, &failed, first->name, first->help);
+
+        for (size_t j = i; j < n; j++) {
+            const ac_metric_t *m = s_series[j];
+            if (strcmp(m->name, first->name) != 0) {
+                continue;
+            }
+            if (m->type == AC_METRIC_HISTOGRAM) {
+                render_histogram(&sb, &failed, m);
+            } else {
+                put(&sb, &failed, "%s%s%s%s%s %lld\n", m->name,
+                    m->type == AC_METRIC_COUNTER ? "_total" : "",
+                    m->labels ? "{" : "", m->labels ? m->labels : "", m->labels ? "}" : "",
+                    (long long)ac_metric_value(m));
+            }
+        }
+    }
+    put(&sb, &failed, "# EOF\n");
+
+    if (failed) {
+        ac_strbuf_reset(&sb);
+        return ARC_ERR_MEMORY;
+    }
+    if (len) {
+        *len = sb.len;
+    }
+    *out = ac_strbuf_take(&sb);
+    return ARC_OK;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file priority.c
+ * @brief Stride scheduling over request priority classes
+ *
+ * Each class advances its pass by STRIDE / weight per turn; the waiting
+ * class with the lowest pass goes next. A class that had no waiters is
+ * brought up to the current virtual time before it competes, so sitting
+ * idle earns no burst.
+ */
+
+#include "arc/priority.h"
+
+#define PRIORITY_STRIDE  (1u << 16)
+
+static const uint32_t s_weight[AC_PRIORITY_COUNT] = {
+    [AC_PRIORITY_NORMAL] = 4,
+    [AC_PRIORITY_INTERACTIVE] = 16,
+    [AC_PRIORITY_BATCH] = 1,
+};
+
+/* Tie-break order: most urgent first */
+static const ac_priority_t s_rank[AC_PRIORITY_COUNT] = {
+    AC_PRIORITY_INTERACTIVE, AC_PRIORITY_NORMAL, AC_PRIORITY_BATCH,
+};
+
+static uint64_t effective_pass(const ac_priority_sched_t *sched, int c) {
+    return sched->pass[c] > sched->vtime ? sched->pass[c] : sched->vtime;
+}
+
+int ac_priority_next(const ac_priority_sched_t *sched,
+                     const uint64_t oldest[AC_PRIORITY_COUNT], uint64_t now) {
+    if (!sched || !oldest) {
+        return -1;
+    }
+
+    /* Starvation guard: the longest-waiting overdue waiter first */
+    int overdue = -1;
+    for (int c = 0; c < AC_PRIORITY_COUNT; c++) {
+        if (oldest[c] && now >= oldest[c] + AC_PRIORITY_MAX_WAIT_MS &&
+            (overdue < 0 || oldest[c] < oldest[overdue])) {
+            overdue = c;
+        }
+    }
+    if (overdue >= 0) {
+        return overdue;
+    }
+
+    int best = -1;
+    for (int i = 0; i < AC_PRIORITY_COUNT; i++) {
+        int c = (int)s_rank[i];
+        if (oldest[c] &&
+            (best < 0 || effective_pass(sched, c) < effective_pass(sched, best))) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+void ac_priority_charge(ac_priority_sched_t *sched, ac_priority_t priority) {
+    if (!sched) {
+        return;
+    }
+    int c = (int)ac_priority_clamp((int)priority);
+    uint64_t pass = effective_pass(sched, c);
+    sched->vtime = pass;
+    sched->pass[c] = pass + PRIORITY_STRIDE / s_weight[c];
+}
+
+ac_priority_t ac_priority_clamp(int priority) {
+    return priority >= 0 && priority < AC_PRIORITY_COUNT ? (ac_priority_t)priority
+                                                        : AC_PRIORITY_NORMAL;
+}
@@ -0,0 +1,398 @@
+/**
+ * @file profile.c
+ * @brief Per-iteration phase profiler with folded-stack totals
+ *
+ * The thread in an iteration keeps its phase stack as a key, one nibble
+ * (phase + 1) per level with the innermost in the low bits, so a stack
+ * is a single integer and its parent is key >> 4. Every push, pop and
+ * split first charges the time since the previous one to the current
+ * key in a small per-thread table; at the end of the iteration that
+ * table is merged into the profiler's totals under its mutex, which is
+ * the only lock taken. Without thread-local storage the push/pop calls
+ * compile to nothing and iterations are not timed.
+ */
+
+#include "profile.h"
+#include "arc/platform.h"
+#include "arc/log.h"
+#include "pthread_port.h"
+#include "strbuf.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROF_MAX_DEPTH      7       /* Nibbles of a 32-bit key, minus headroom */
+#define PROF_THREAD_STACKS  32      /* Distinct stacks within one iteration */
+#define PROF_MAX_ENTRIES    512     /* Distinct (agent, stack) totals */
+#define PROF_AGENT_NAME     64
+
+typedef struct {
+    char agent[PROF_AGENT_NAME];
+    uint32_t key;
+    uint64_t us;
+} prof_entry_t;
+
+struct ac_profiler {
+    pthread_mutex_t lock;
+    atomic_int enabled;
+    ac_prof_callback_t on_iteration;
+    void *ctx;
+    char *folded_path;
+
+    prof_entry_t *entries;
+    size_t count;
+    size_t dropped;                  /* Stack samples with no room left */
+};
+
+static const char *phase_names[AC_PROF_PHASE_COUNT] = {
+    "agent", "hooks", "serialize", "connect", "network", "sse", "parse", "tools",
+};
+
+const char *ac_prof_phase_name(ac_prof_phase_t phase) {
+    if ((unsigned)phase >= AC_PROF_PHASE_COUNT) {
+        return "unknown";
+    }
+    return phase_names[phase];
+}
+
+/** Phase of the innermost frame of a stack key */
+static ac_prof_phase_t key_phase(uint32_t key) {
+    return key ? (ac_prof_phase_t)((key & 0xF) - 1) : AC_PROF_AGENT;
+}
+
+/*============================================================================
+ * Profiler
+ *============================================================================*/
+
+ac_profiler_t *ac_profiler_create(void) {
+    ac_profiler_t *prof = (ac_profiler_t *)ARC_CALLOC(1, sizeof(ac_profiler_t));
+    if (!prof) {
+        return NULL;
+    }
+    prof->entries = (prof_entry_t *)ARC_CALLOC(PROF_MAX_ENTRIES, sizeof(prof_entry_t));
+    if (!prof->entries) {
+        ARC_FREE(prof);
+        return NULL;
+    }
+    pthread_mutex_init(&prof->lock, NULL);
+    return prof;
+}
+
+arc_err_t ac_profiler_configure(ac_profiler_t *prof, const ac_profile_config_t *config) {
+    if (!prof) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    char *path = NULL;
+    if (config && config->folded_path) {
+        path = ARC_STRDUP(config->folded_path);
+        if (!path) {
+            return ARC_ERR_MEMORY;
+        }
+    }
+
+    pthread_mutex_lock(&prof->lock);
+    if (config) {
+        ARC_FREE(prof->folded_path);
+        prof->folded_path = path;
+        prof->on_iteration = config->on_iteration;
+        prof->ctx = config->ctx;
+    } else {
+        /* Stopped: the totals so far are still written at close */
+        prof->on_iteration = NULL;
+        prof->ctx = NULL;
+    }
+    atomic_store(&prof->enabled, config != NULL);
+    pthread_mutex_unlock(&prof->lock);
+    return ARC_OK;
+}
+
+/** Append "agent;phase;phase" for a stack key */
+static arc_err_t append_stack(ac_strbuf_t *sb, const char *agent, uint32_t key) {
+    arc_err_t err = ac_strbuf_append(sb, agent, strlen(agent));
+    for (int shift = (PROF_MAX_DEPTH - 1) * 4; shift >= 0 && err == ARC_OK; shift -= 4) {
+        uint32_t nibble = (key >> shift) & 0xF;
+        if (nibble) {
+            const char *name = phase_names[nibble - 1];
+            err = ac_strbuf_append(sb, ";", 1);
+            if (err == ARC_OK) {
+                err = ac_strbuf_append(sb, name, strlen(name));
+            }
+        }
+    }
+    return err;
+}
+
+arc_err_t ac_profiler_render(ac_profiler_t *prof, char **out, size_t *len) {
+    if (!prof || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    ac_strbuf_t sb = AC_STRBUF_INIT;
+    arc_err_t err = ARC_OK;
+
+    pthread_mutex_lock(&prof->lock);
+    for (size_t i = 0; i < prof->count && err == ARC_OK; i++) {
+        const prof_entry_t *e = &prof->entries[i];
+        char us[24];
+        int n = snprintf(us, sizeof(us), " %llu\n", (unsigned long long)e->us);
+
+        err = append_stack(&sb, e->agent, e->key);
+        if (err == ARC_OK) {
+            err = ac_strbuf_append(&sb, us, (size_t)n);
+        }
+    }
+    pthread_mutex_unlock(&prof->lock);
+
+    if (err != ARC_OK) {
+        ac_strbuf_reset(&sb);
+        return err;
+    }
+    /* Nothing profiled yet: an empty string, not NULL */
+    *out = sb.data ? ac_strbuf_take(&sb) : ARC_STRDUP("");
+    if (!*out) {
+        return ARC_ERR_MEMORY;
+    }
+    if (len) {
+        *len = strlen(*out);
+    }
+    return ARC_OK;
+}
+
+void ac_profiler_destroy(ac_profiler_t *prof) {
+    if (!prof) {
+        return;
+    }
+
+    if (prof->folded_path) {
+        char *text = NULL;
+        size_t len = 0;
+        FILE *f = NULL;
+        if (ac_profiler_render(prof, &text, &len) == ARC_OK &&
+            (f = fopen(prof->folded_path, "w")) != NULL) {
+            fwrite(text, 1, len, f);
+            fclose(f);
+            AC_LOG_INFO("Profile written to %s (%zu stacks)", prof->folded_path, prof->count);
+        } else {
+            AC_LOG_WARN("Cannot write profile to %s", prof->folded_path);
+        }
+        ARC_FREE(text);
+    }
+    if (prof->dropped) {
+        AC_LOG_WARN("Profile table full, %zu samples dropped", prof->dropped);
+    }
+
+    pthread_mutex_destroy(&prof->lock);
+    ARC_FREE(prof->folded_path);
+    ARC_FREE(prof->entries);
+    ARC_FREE(prof);
+}
+
+/** Add a stack's time to the totals; caller holds the lock */
+static void merge_locked(ac_profiler_t *prof, const char *agent, uint32_t key, uint64_t us) {
+    for (size_t i = 0; i < prof->count; i++) {
+        prof_entry_t *e = &prof->entries[i];
+        if (e->key == key && strcmp(e->agent, agent) == 0) {
+            e->us += us;
+            return;
+        }
+    }
+    if (prof->count == PROF_MAX_ENTRIES) {
+        prof->dropped++;
+        return;
+    }
+    prof_entry_t *e = &prof->entries[prof->count++];
+    memcpy(e->agent, agent, strlen(agent) + 1);
+    e->key = key;
+    e->us = us;
+}
+
+/*============================================================================
+ * Per-Thread Phase Stack
+ *============================================================================*/
+
+#ifdef ARC_THREAD_LOCAL
+
+typedef struct {
+    ac_profiler_t *prof;             /* NULL = not in a profiled iteration */
+    const char *agent_name;
+    int iteration;
+    int nested;                      /* Iterations begun inside this one */
+    uint64_t start_us;
+    uint64_t mark_us;                /* Last charge */
+    uint32_t key;                    /* Current stack */
+    int depth;
+    int folded;                      /* Pushes folded into the open phase */
+    struct {
+        uint32_t key;
+        uint64_t us;
+    } stacks[PROF_THREAD_STACKS];
+    int stack_count;
+} prof_thread_t;
+
+static ARC_THREAD_LOCAL prof_thread_t t_prof;
+
+static uint64_t *stack_slot(uint32_t key) {
+    for (int i = 0; i < t_prof.stack_count; i++) {
+        if (t_prof.stacks[i].key == key) {
+            return &t_prof.stacks[i].us;
+        }
+    }
+    if (t_prof.stack_count == PROF_THREAD_STACKS) {
+        /* Out of room: the parent keeps it */
+        return key ? stack_slot(key >> 4) : &t_prof.stacks[0].us;
+    }
+    int i = t_prof.stack_count++;
+    t_prof.stacks[i].key = key;
+    t_prof.stacks[i].us = 0;
+    return &t_prof.stacks[i].us;
+}
+
+/** Charge the time since the last change to the current stack */
+static void charge(void) {
+    uint64_t now = ac_platform_monotonic_us();
+    *stack_slot(t_prof.key) += now - t_prof.mark_us;
+    t_prof.mark_us = now;
+}
+
+void ac_profiler_iter_begin(ac_profiler_t *prof, const char *agent_name, int iteration) {
+    if (t_prof.prof) {
+        t_prof.nested++;
+        return;
+    }
+    if (!prof || !atomic_load_explicit(&prof->enabled, memory_order_relaxed)) {
+        return;
+    }
+
+    memset(&t_prof, 0, sizeof(t_prof));
+    t_prof.prof = prof;
+    t_prof.agent_name = agent_name;
+    t_prof.iteration = iteration;
+    t_prof.start_us = ac_platform_monotonic_us();
+    t_prof.mark_us = t_prof.start_us;
+    stack_slot(0);                   /* Root first, the overflow fallback */
+}
+
+void ac_profiler_iter_end(void) {
+    if (!t_prof.prof) {
+        return;
+    }
+    if (t_prof.nested) {
+        t_prof.nested--;
+        return;
+    }
+    charge();
+
+    ac_profiler_t *prof = t_prof.prof;
+    t_prof.prof = NULL;
+
+    /* Folded stacks separate frames with ';' and the count with ' ' */
+    char agent[PROF_AGENT_NAME];
+    snprintf(agent, sizeof(agent), "%s", t_prof.agent_name ? t_prof.agent_name : "agent");
+    for (char *c = agent; *c; c++) {
+        if (*c == ';' || *c == ' ') {
+            *c = '_';
+        }
+    }
+
+    ac_prof_iteration_t it;
+    memset(&it, 0, sizeof(it));
+    it.agent_name = t_prof.agent_name;
+    it.iteration = t_prof.iteration;
+    it.total_us = t_prof.mark_us - t_prof.start_us;
+
+    pthread_mutex_lock(&prof->lock);
+    for (int i = 0; i < t_prof.stack_count; i++) {
+        uint32_t key = t_prof.stacks[i].key;
+        uint64_t us = t_prof.stacks[i].us;
+        it.phase_us[key_phase(key)] += us;
+        if (us) {
+            merge_locked(prof, agent, key, us);
+        }
+    }
+    ac_prof_callback_t cb = prof->on_iteration;
+    void *ctx = prof->ctx;
+    pthread_mutex_unlock(&prof->lock);
+
+    if (cb) {
+        cb(ctx, &it);
+    }
+}
+
+void ac_prof_push(ac_prof_phase_t phase) {
+    if (!t_prof.prof || t_prof.nested) {
+        return;
+    }
+    ac_prof_phase_t top = key_phase(t_prof.key);
+    if (t_prof.folded || (unsigned)phase >= AC_PROF_PHASE_COUNT || phase == AC_PROF_AGENT ||
+        (t_prof.depth > 0 && (phase == top || top == AC_PROF_TOOLS)) ||
+        t_prof.depth == PROF_MAX_DEPTH) {
+        t_prof.folded++;
+        return;
+    }
+    charge();
+    t_prof.key = (t_prof.key << 4) | (uint32_t)(phase + 1);
+    t_prof.depth++;
+}
+
+void ac_prof_pop(void) {
+    if (!t_prof.prof || t_prof.nested) {
+        return;
+    }
+    if (t_prof.folded) {
+        t_prof.folded--;
+        return;
+    }
+    if (t_prof.depth == 0) {
+        return;
+    }
+    charge();
+    t_prof.key >>= 4;
+    t_prof.depth--;
+}
+
+void ac_prof_split(ac_prof_phase_t phase, uint64_t us) {
+    if (!t_prof.prof || t_prof.nested || t_prof.folded ||
+        (unsigned)phase >= AC_PROF_PHASE_COUNT || phase == AC_PROF_AGENT ||
+        phase == key_phase(t_prof.key) || t_prof.depth == PROF_MAX_DEPTH) {
+        return;
+    }
+    charge();
+
+    uint64_t *from = stack_slot(t_prof.key);
+    uint64_t *to = stack_slot((t_prof.key << 4) | (uint32_t)(phase + 1));
+    if (from == to) {
+        return;
+    }
+    if (us > *from) {
+        us = *from;
+    }
+    *from -= us;
+    *to += us;
+}
+
+#else /* !ARC_THREAD_LOCAL */
+
+void ac_profiler_iter_begin(ac_profiler_t *prof, const char *agent_name, int iteration) {
+    (void)prof;
+    (void)agent_name;
+    (void)iteration;
+}
+
+void ac_profiler_iter_end(void) {
+}
+
+void ac_prof_push(ac_prof_phase_t phase) {
+    (void)phase;
+}
+
+void ac_prof_pop(void) {
+}
+
+void ac_prof_split(ac_prof_phase_t phase, uint64_t us) {
+    (void)phase;
+    (void)us;
+}
+
+#endif /* ARC_THREAD_LOCAL */
@@ -0,0 +1,64 @@
+/**
+ * @file profile.h
+ * @brief Iteration profiler (internal)
+ *
+ * A session owns at most one profiler, created by ac_session_profile()
+ * and destroyed with the session, so agents may hold its pointer for as
+ * long as they run. The agent brackets each iteration with
+ * ac_profiler_iter_begin()/ac_profiler_iter_end(); in between, the
+ * thread's phase stack is driven by ac_prof_push()/ac_prof_pop() calls
+ * in the layers below (see arc/profile.h).
+ */
+
+#ifndef ARC_PROFILE_INTERNAL_H
+#define ARC_PROFILE_INTERNAL_H
+
+#include "arc/profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ac_profiler ac_profiler_t;
+
+ac_profiler_t *ac_profiler_create(void);
+
+/**
+ * @brief Write folded_path (if configured) and free
+ */
+void ac_profiler_destroy(ac_profiler_t *prof);
+
+/**
+ * @brief Replace the configuration; NULL stops profiling, totals stay
+ */
+arc_err_t ac_profiler_configure(ac_profiler_t *prof, const ac_profile_config_t *config);
+
+arc_err_t ac_profiler_render(ac_profiler_t *prof, char **out, size_t *len);
+
+/**
+ * @brief Start timing an iteration on the calling thread
+ *
+ * Does nothing when prof is NULL or stopped. An iteration begun while
+ * another is timed on the thread (an agent run inside a tool) is not
+ * timed on its own.
+ */
+void ac_profiler_iter_begin(ac_profiler_t *prof, const char *agent_name, int iteration);
+
+/**
+ * @brief Finish the thread's iteration: add it to the totals and report it
+ */
+void ac_profiler_iter_end(void);
+
+/**
+ * @brief Move us microseconds of the open phase into a child phase
+ *
+ * For time measured by someone else after the fact, such as the
+ * connection setup curl reports inside a request.
+ */
+void ac_prof_split(ac_prof_phase_t phase, uint64_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_PROFILE_INTERNAL_H */
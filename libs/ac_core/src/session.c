@@ -10,6 +10,8 @@
  * - All session operations are protected by a mutex
  * - Safe to call ac_session_add_* from multiple threads
  * - ac_session_close should only be called once, after all agents complete
+ * - The executor is created lazily on first use
+ * - Jobs touching the session arena off the caller thread hold arena_lock
  */
 
 #include "arc/session.h"
@@ -20,9 +22,16 @@
 #include "arc/log.h"
 #include "arc/platform.h"
 #include "pthread_port.h"
+#include "executor.h"
+#include "agent_hooks_internal.h"
+#include "profile.h"
 #include <stdlib.h>
 #include <string.h>
 
+/* Declared in affinity.c */
+extern arc_err_t ac_affinity_copy(ac_affinity_t *dst, const ac_affinity_t *src);
+extern void ac_affinity_free(ac_affinity_t *affinity);
+
 /*============================================================================
  * Constants (from platform.h, can be overridden at compile time)
  *============================================================================*/
@@ -31,6 +40,7 @@
 #define INITIAL_CAPACITY        ARC_ARRAY_INITIAL_CAPACITY
 #define GROWTH_FACTOR           ARC_ARENA_GROWTH_FACTOR
 #define SESSION_ARENA_SIZE      ARC_SESSION_ARENA_SIZE
+#define EXECUTOR_THREADS        ARC_SESSION_EXECUTOR_THREADS
 
 /*============================================================================
  * Dynamic Array Type
@@ -48,11 +58,20 @@ typedef struct {
 
 struct ac_session {
     arena_t *arena;                     /* Session arena for registries */
+    ac_allocator_t allocator;           /* Arena allocator (ac_session_open_with) */
+    int has_allocator;
 
     dyn_array_t agents;                 /* Dynamic array of agents */
     dyn_array_t registries;             /* Dynamic array of tool registries */
     dyn_array_t mcp_clients;            /* Dynamic array of MCP clients */
 
+    ac_executor_t *executor;            /* Shared workers (lazy) */
+    size_t executor_threads;            /* Worker count for lazy start */
+    ac_affinity_t executor_affinity;    /* Worker placement (owned copy) */
+    pthread_mutex_t arena_lock;         /* Arena use off the owner thread */
+    ac_hook_chain_t hooks;              /* Subscribers for all agents */
+    ac_profiler_t *profiler;            /* ac_session_profile() (lazy) */
+
     pthread_mutex_t lock;               /* Thread safety mutex */
     int closed;                         /* Flag to prevent double-close */
 };
@@ -62,6 +81,11 @@ struct ac_session {
  *============================================================================*/
 
 extern void ac_mcp_cleanup(ac_mcp_client_t *client);
+extern void ac_tool_registry_cleanup(ac_tool_registry_t *registry);
+extern void ac_agent_free(ac_agent_t *agent);
+
+const ac_allocator_t *ac_session_get_allocator(ac_session_t *session);
+ac_profiler_t *ac_session_get_profiler(ac_session_t *session);
 
 /*============================================================================
  * Dynamic Array Operations
@@ -94,6 +118,17 @@ static arc_err_t dyn_array_add(dyn_array_t *arr, void *item) {
     return ARC_OK;
 }
 
+static int dyn_array_remove(dyn_array_t *arr, const void *item) {
+    for (size_t i = 0; i < arr->count; i++) {
+        if (arr->items[i] == item) {
+            memmove(&arr->items[i], &arr->items[i + 1], (arr->count - i - 1) * sizeof(void *));
+            arr->count--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
 static void dyn_array_free(dyn_array_t *arr) {
     if (arr->items) {
         ARC_FREE(arr->items);
@@ -108,18 +143,38 @@ static void dyn_array_free(dyn_array_t *arr) {
  *============================================================================*/
 
 ac_session_t *ac_session_open(void) {
+    return ac_session_open_with(NULL);
+}
+
+ac_session_t *ac_session_open_with(const ac_allocator_t *allocator) {
+    if (allocator && (!allocator->alloc || !allocator->realloc || !allocator->free)) {
+        AC_LOG_ERROR("Session allocator is missing a function");
+        return NULL;
+    }
+
     ac_session_t *session = (ac_session_t *)ARC_CALLOC(1, sizeof(ac_session_t));
     if (!session) {
         AC_LOG_ERROR("Failed to allocate session");
         return NULL;
     }
 
-    /* Initialize mutex */
+    if (allocator) {
+        session->allocator = *allocator;
+        session->has_allocator = 1;
+    }
+
+    /* Initialize mutexes */
     if (pthread_mutex_init(&session->lock, NULL) != 0) {
         AC_LOG_ERROR("Failed to initialize session mutex");
         ARC_FREE(session);
         return NULL;
     }
+    if (pthread_mutex_init(&session->arena_lock, NULL) != 0) {
+        AC_LOG_ERROR("Failed to initialize session mutex");
+        pthread_mutex_destroy(&session->lock);
+        ARC_FREE(session);
+        return NULL;
+    }
 
     /* Initialize dynamic arrays */
     if (dyn_array_init(&session->agents, INITIAL_CAPACITY) != ARC_OK ||
@@ -129,24 +184,28 @@ ac_session_t *ac_session_open(void) {
         dyn_array_free(&session->agents);
         dyn_array_free(&session->registries);
         dyn_array_free(&session->mcp_clients);
+        pthread_mutex_destroy(&session->arena_lock);
         pthread_mutex_destroy(&session->lock);
         ARC_FREE(session);
         return NULL;
     }
 
     /* Create session arena for registries and MCP clients */
-    session->arena = arena_create(SESSION_ARENA_SIZE);
+    session->arena = arena_create_with(SESSION_ARENA_SIZE, ac_session_get_allocator(session));
     if (!session->arena) {
         AC_LOG_ERROR("Failed to create session arena");
         dyn_array_free(&session->agents);
         dyn_array_free(&session->registries);
         dyn_array_free(&session->mcp_clients);
+        pthread_mutex_destroy(&session->arena_lock);
         pthread_mutex_destroy(&session->lock);
         ARC_FREE(session);
         return NULL;
     }
 
+    ac_hook_chain_init(&session->hooks);
     session->closed = 0;
+    session->executor_threads = EXECUTOR_THREADS;
 
     AC_LOG_INFO("Session opened (arena=%zuKB, initial_capacity=%d)",
                 SESSION_ARENA_SIZE / 1024, INITIAL_CAPACITY);
@@ -167,11 +226,22 @@ void ac_session_close(ac_session_t *session) {
         return;
     }
     session->closed = 1;
+    ac_executor_t *executor = session->executor;
+    session->executor = NULL;
+
+    /* Drain async runs before tearing down agents. The lock is released
+     * meanwhile so in-flight runs can still reach the session. */
+    if (executor) {
+        pthread_mutex_unlock(&session->lock);
+        ac_executor_destroy(executor);
+        pthread_mutex_lock(&session->lock);
+    }
 
     size_t agent_count = session->agents.count;
     size_t registry_count = session->registries.count;
     size_t mcp_count = session->mcp_clients.count;
 
+#if ARC_FEATURE_MCP
     /* Cleanup MCP clients first (they may be referenced by tools) */
     for (size_t i = 0; i < session->mcp_clients.count; i++) {
         ac_mcp_client_t *client = (ac_mcp_client_t *)session->mcp_clients.items[i];
@@ -179,17 +249,28 @@ void ac_session_close(ac_session_t *session) {
             ac_mcp_cleanup(client);
         }
     }
+#endif
 
     /* Destroy all agents (each has its own arena) */
     for (size_t i = 0; i < session->agents.count; i++) {
         ac_agent_t *agent = (ac_agent_t *)session->agents.items[i];
         if (agent) {
-            ac_agent_destroy(agent);
+            ac_agent_free(agent);
         }
     }
 
-    /* Tool registries are allocated from session arena,
-     * they will be freed when arena is destroyed */
+    /* Tool registries are allocated from session arena, they will be
+     * freed when arena is destroyed; only their heap caches go here */
+    for (size_t i = 0; i < session->registries.count; i++) {
+        ac_tool_registry_t *registry = (ac_tool_registry_t *)session->registries.items[i];
+        if (registry) {
+            ac_tool_registry_cleanup(registry);
+        }
+    }
+
+    /* After the agents: no iteration can still report to it */
+    ac_profiler_destroy(session->profiler);
+    session->profiler = NULL;
 
     /* Free dynamic arrays */
     dyn_array_free(&session->agents);
@@ -201,23 +282,203 @@ void ac_session_close(ac_session_t *session) {
         arena_destroy(session->arena);
     }
 
+    ac_affinity_free(&session->executor_affinity);
+
     pthread_mutex_unlock(&session->lock);
 
     AC_LOG_INFO("Session closed: destroyed %zu agents, %zu registries, %zu MCP clients",
                 agent_count, registry_count, mcp_count);
 
+    ac_hook_chain_destroy(&session->hooks);
+    pthread_mutex_destroy(&session->arena_lock);
     pthread_mutex_destroy(&session->lock);
     ARC_FREE(session);
 }
 
+arc_err_t ac_session_set_executor_threads(ac_session_t *session, size_t threads) {
+    if (!session) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&session->lock);
+
+    if (session->closed || session->executor) {
+        pthread_mutex_unlock(&session->lock);
+        AC_LOG_ERROR("Executor size must be set before first use");
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    session->executor_threads = threads > 0 ? threads : EXECUTOR_THREADS;
+
+    pthread_mutex_unlock(&session->lock);
+    return ARC_OK;
+}
+
+arc_err_t ac_session_set_executor_affinity(ac_session_t *session,
+                                           const ac_affinity_t *affinity) {
+    if (!session) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    ac_affinity_t copy;
+    arc_err_t err = ac_affinity_copy(&copy, affinity);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    pthread_mutex_lock(&session->lock);
+
+    if (session->closed || session->executor) {
+        pthread_mutex_unlock(&session->lock);
+        ac_affinity_free(&copy);
+        AC_LOG_ERROR("Executor affinity must be set before first use");
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    ac_affinity_free(&session->executor_affinity);
+    session->executor_affinity = copy;
+
+    pthread_mutex_unlock(&session->lock);
+    return ARC_OK;
+}
+
+arc_err_t ac_session_get_executor_stats(ac_session_t *session,
+                                        ac_session_executor_stats_t *stats) {
+    if (!session || !stats) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    pthread_mutex_lock(&session->lock);
+    arc_err_t err = session->executor ?
+        ac_executor_get_stats(session->executor, stats) : ARC_ERR_NOT_INITIALIZED;
+    pthread_mutex_unlock(&session->lock);
+
+    return err;
+}
+
+#if ARC_FEATURE_HOOKS
+
+arc_err_t ac_session_add_hooks(ac_session_t *session, const ac_agent_hooks_t *hooks) {
+    if (!session) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    return ac_hook_chain_add(&session->hooks, hooks);
+}
+
+arc_err_t ac_session_remove_hooks(ac_session_t *session, const ac_agent_hooks_t *hooks) {
+    if (!session) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    return ac_hook_chain_remove(&session->hooks, hooks);
+}
+
+#endif /* ARC_FEATURE_HOOKS */
+
+arc_err_t ac_session_profile(ac_session_t *session, const ac_profile_config_t *config) {
+    if (!session) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&session->lock);
+
+    if (session->closed) {
+        pthread_mutex_unlock(&session->lock);
+        return ARC_ERR_INVALID_STATE;
+    }
+    if (!session->profiler) {
+        if (!config) {
+            pthread_mutex_unlock(&session->lock);
+            return ARC_OK;
+        }
+        session->profiler = ac_profiler_create();
+        if (!session->profiler) {
+            pthread_mutex_unlock(&session->lock);
+            return ARC_ERR_MEMORY;
+        }
+    }
+    arc_err_t err = ac_profiler_configure(session->profiler, config);
+
+    pthread_mutex_unlock(&session->lock);
+    return err;
+}
+
+arc_err_t ac_session_profile_folded(ac_session_t *session, char **out, size_t *len) {
+    if (!session || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    pthread_mutex_lock(&session->lock);
+    arc_err_t err = session->profiler ?
+        ac_profiler_render(session->profiler, out, len) : ARC_ERR_NOT_INITIALIZED;
+    pthread_mutex_unlock(&session->lock);
+
+    return err;
+}
+
 /*============================================================================
  * Internal API (used by agent.c, tool.c, mcp.c)
  *============================================================================*/
 
+ac_hook_chain_t *ac_session_get_hooks(ac_session_t *session) {
+    return session ? &session->hooks : NULL;
+}
+
 arena_t *ac_session_get_arena(ac_session_t *session) {
     return session ? session->arena : NULL;
 }
 
+const ac_allocator_t *ac_session_get_allocator(ac_session_t *session) {
+    return session && session->has_allocator ? &session->allocator : NULL;
+}
+
+ac_profiler_t *ac_session_get_profiler(ac_session_t *session) {
+    if (!session) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&session->lock);
+    ac_profiler_t *prof = session->profiler;
+    pthread_mutex_unlock(&session->lock);
+
+    return prof;
+}
+
+ac_executor_t *ac_session_get_executor(ac_session_t *session) {
+    if (!session) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&session->lock);
+
+    if (!session->closed && !session->executor) {
+        session->executor = ac_executor_create(session->executor_threads,
+                                               &session->executor_affinity);
+        if (session->executor) {
+            AC_LOG_INFO("Session executor started (%zu workers)",
+                        session->executor_threads);
+        }
+    }
+    ac_executor_t *executor = session->closed ? NULL : session->executor;
+
+    pthread_mutex_unlock(&session->lock);
+    return executor;
+}
+
+void ac_session_arena_lock(ac_session_t *session) {
+    if (session) {
+        pthread_mutex_lock(&session->arena_lock);
+    }
+}
+
+void ac_session_arena_unlock(ac_session_t *session) {
+    if (session) {
+        pthread_mutex_unlock(&session->arena_lock);
+    }
+}
+
 arc_err_t ac_session_add_agent(ac_session_t *session, ac_agent_t *agent) {
     if (!session || !agent) {
         return ARC_ERR_INVALID_ARG;
@@ -243,6 +504,18 @@ arc_err_t ac_session_add_agent(ac_session_t *session, ac_agent_t *agent) {
     return err;
 }
 
+void ac_session_remove_agent(ac_session_t *session, ac_agent_t *agent) {
+    if (!session || !agent) {
+        return;
+    }
+
+    pthread_mutex_lock(&session->lock);
+    if (!session->closed && dyn_array_remove(&session->agents, agent)) {
+        AC_LOG_DEBUG("Agent removed from session (total=%zu)", session->agents.count);
+    }
+    pthread_mutex_unlock(&session->lock);
+}
+
 arc_err_t ac_session_add_registry(ac_session_t *session, ac_tool_registry_t *registry) {
     if (!session || !registry) {
         return ARC_ERR_INVALID_ARG;
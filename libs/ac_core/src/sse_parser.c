@@ -4,7 +4,9 @@
  */
 
 #include "arc/sse_parser.h"
+#include "arc/log.h"
 #include "arc/platform.h"
+#include "arc/profile.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -12,12 +14,97 @@
  * Internal Helpers
  *============================================================================*/
 
+/**
+ * @brief Grow the accumulator to hold at least size bytes
+ */
+static int field_reserve(sse_field_t *f, size_t size) {
+    if (size <= f->own_cap) {
+        return 0;
+    }
+    size_t cap = f->own_cap ? f->own_cap : 64;
+    while (cap < size) {
+        cap *= 2;
+    }
+#if ARC_SSE_LINE_MAX > 0
+    /* Callers keep values within the limit: never reserve past it */
+    if (cap > ARC_SSE_LINE_MAX && size <= ARC_SSE_LINE_MAX) {
+        cap = ARC_SSE_LINE_MAX;
+    }
+#endif
+    char *own = ARC_REALLOC(f->own, cap);
+    if (!own) {
+        return -1;
+    }
+    if (f->ptr == f->own) {
+        f->ptr = own;
+    }
+    f->own = own;
+    f->own_cap = cap;
+    return 0;
+}
+
+/**
+ * @brief Move a view into the accumulator before its line goes away
+ */
+static void field_pin(sse_field_t *f) {
+    if (!f->ptr || f->ptr == f->own) {
+        return;
+    }
+    if (field_reserve(f, f->len + 1) != 0) {
+        f->ptr = NULL;
+        f->len = 0;
+        return;
+    }
+    memcpy(f->own, f->ptr, f->len);
+    f->own[f->len] = '\0';
+    f->ptr = f->own;
+}
+
+static void field_set(sse_field_t *f, const char *value, size_t len) {
+    f->ptr = value;
+    f->len = len;
+}
+
+static void field_append_line(sse_field_t *f, const char *value, size_t len) {
+    if (!f->ptr) {
+        field_set(f, value, len);
+        return;
+    }
+    /* Second data line: only now does the value need its own storage */
+    field_pin(f);
+    if (!f->ptr || field_reserve(f, f->len + 1 + len + 1) != 0) {
+        return;
+    }
+    f->own[f->len] = '\n';
+    memcpy(f->own + f->len + 1, value, len);
+    f->len += 1 + len;
+    f->own[f->len] = '\0';
+}
+
+static void field_free(sse_field_t *f) {
+    if (f->own) ARC_FREE(f->own);
+    memset(f, 0, sizeof(*f));
+}
+
+/**
+ * @brief Give up on the stream: a line or event is over ARC_SSE_LINE_MAX
+ */
+static void parser_overflow(sse_parser_t *p, size_t len) {
+    AC_LOG_ERROR("SSE: %zu byte line or event exceeds ARC_SSE_LINE_MAX (%zu)",
+                 len, (size_t)ARC_SSE_LINE_MAX);
+    p->overflow = 1;
+    p->aborted = 1;
+}
+
 static void emit_event(sse_parser_t *p) {
-    if (p->data && p->callback && !p->aborted) {
+    if (p->data.ptr && p->callback && !p->aborted) {
         sse_event_t event = {
-            .event = p->event_type ? p->event_type : "message",
-            .data = p->data,
-            .id = p->id
+            .event = p->event_type.ptr ? p->event_type.ptr : "message",
+            .event_len = p->event_type.ptr ? p->event_type.len : 7,
+            .data = p->data.ptr,
+            .data_len = p->data.len,
+            .id = p->id.ptr,
+            .id_len = p->id.len,
         };
 
         int ret = p->callback(&event, p->ctx);
@@ -26,12 +113,15 @@ static void emit_event(sse_parser_t *p) {
         }
     }
 
-    /* Reset current event */
-    if (p->event_type) { ARC_FREE(p->event_type); p->event_type = NULL; }
-    if (p->data) { ARC_FREE(p->data); p->data = NULL; }
-    if (p->id) { ARC_FREE(p->id); p->id = NULL; }
+    /* Reset current event (accumulators are reused) */
+    p->event_type.ptr = NULL;
+    p->data.ptr = NULL;
+    p->id.ptr = NULL;
 }
 
+/**
+ * @brief Handle one line (not NUL-terminated, may point into the input)
+ */
 static void process_line(sse_parser_t *p, const char *line, size_t len) {
     /* Empty line = dispatch event */
     if (len == 0) {
@@ -65,88 +155,168 @@ static void process_line(sse_parser_t *p, const char *line, size_t len) {
         value_len = 0;
     }
 
-    /* Process field */
+    /* Process field: values stay views into the line for now */
     if (field_len == 5 && strncmp(line, "event", 5) == 0) {
-        if (p->event_type) ARC_FREE(p->event_type);
-        p->event_type = ARC_STRNDUP(value, value_len);
+        field_set(&p->event_type, value, value_len);
     } else if (field_len == 4 && strncmp(line, "data", 4) == 0) {
-        if (p->data) {
-            /* Append to existing data with newline */
-            size_t old_len = strlen(p->data);
-            char *new_data = ARC_REALLOC(p->data, old_len + 1 + value_len + 1);
-            if (new_data) {
-                new_data[old_len] = '\n';
-                memcpy(new_data + old_len + 1, value, value_len);
-                new_data[old_len + 1 + value_len] = '\0';
-                p->data = new_data;
-            }
-        } else {
-            p->data = ARC_STRNDUP(value, value_len);
+#if ARC_SSE_LINE_MAX > 0
+        /* A single line is within the limit; the joined lines must be too */
+        if (p->data.ptr && p->data.len + 1 + value_len >= ARC_SSE_LINE_MAX) {
+            parser_overflow(p, p->data.len + 1 + value_len);
+            return;
         }
+#endif
+        field_append_line(&p->data, value, value_len);
     } else if (field_len == 2 && strncmp(line, "id", 2) == 0) {
-        if (p->id) ARC_FREE(p->id);
-        p->id = ARC_STRNDUP(value, value_len);
+        field_set(&p->id, value, value_len);
     }
     /* Ignore other fields */
 }
 
+/**
+ * @brief Copy a partly assembled event out of the input / line buffer
+ */
+static void pin_fields(sse_parser_t *p) {
+    field_pin(&p->event_type);
+    field_pin(&p->data);
+    field_pin(&p->id);
+}
+
 /*============================================================================
  * Public API
  *============================================================================*/
 
 void sse_parser_init(sse_parser_t *p, sse_event_callback_t callback, void *ctx) {
     memset(p, 0, sizeof(*p));
-    p->buffer_size = 8192;
-    p->buffer = ARC_MALLOC(p->buffer_size);
+    /* Bounded: the one buffer this parser will ever have */
+    size_t size = ARC_SSE_LINE_MAX > 0 ? (size_t)ARC_SSE_LINE_MAX : 8192;
+    p->buffer = ARC_MALLOC(size);
+    p->buffer_size = p->buffer ? size : 0;
     p->callback = callback;
     p->ctx = ctx;
 }
 
 void sse_parser_free(sse_parser_t *p) {
     if (p->buffer) ARC_FREE(p->buffer);
-    if (p->event_type) ARC_FREE(p->event_type);
-    if (p->data) ARC_FREE(p->data);
-    if (p->id) ARC_FREE(p->id);
+    field_free(&p->event_type);
+    field_free(&p->data);
+    field_free(&p->id);
     memset(p, 0, sizeof(*p));
 }
 
-int sse_parser_feed(sse_parser_t *p, const char *data, size_t len) {
+/**
+ * @brief Find the next CR or LF in [s, end)
+ *
+ * Two memchr passes (LF, then CR before it) rather than a byte loop:
+ * libc scans a word or vector at a time on every target we build for.
+ */
+static const char *find_eol(const char *s, const char *end) {
+    const char *lf = memchr(s, '\n', (size_t)(end - s));
+    const char *limit = lf ? lf : end;
+    const char *cr = memchr(s, '\r', (size_t)(limit - s));
+    return cr ? cr : lf;
+}
+
+/**
+ * @brief Append a partial line to the line buffer
+ */
+static int buffer_append(sse_parser_t *p, const char *s, size_t n) {
+#if ARC_SSE_LINE_MAX > 0
+    if (p->buffer_len + n + 1 > ARC_SSE_LINE_MAX) {
+        parser_overflow(p, p->buffer_len + n);
+        return -1;
+    }
+#endif
+    if (p->buffer_len + n + 1 > p->buffer_size) {
+        size_t new_size = p->buffer_size ? p->buffer_size : 256;
+        while (p->buffer_len + n + 1 > new_size) {
+            new_size *= 2;
+        }
+#if ARC_SSE_LINE_MAX > 0
+        if (new_size > ARC_SSE_LINE_MAX) {
+            new_size = ARC_SSE_LINE_MAX;
+        }
+#endif
+        char *new_buf = ARC_REALLOC(p->buffer, new_size);
+        if (!new_buf) {
+            return -1;
+        }
+        p->buffer = new_buf;
+        p->buffer_size = new_size;
+    }
+    memcpy(p->buffer + p->buffer_len, s, n);
+    p->buffer_len += n;
+    p->buffer[p->buffer_len] = '\0';
+    return 0;
+}
+
+static int sse_parser_feed_impl(sse_parser_t *p, const char *data, size_t len) {
     if (!p || !data || p->aborted) {
         return -1;
     }
 
-    for (size_t i = 0; i < len; i++) {
-        char c = data[i];
+    const char *s = data;
+    const char *end = data + len;
 
-        if (c == '\n' || c == '\r') {
-            /* End of line - process it */
-            if (p->buffer_len > 0 || c == '\n') {
-                p->buffer[p->buffer_len] = '\0';
-                process_line(p, p->buffer, p->buffer_len);
-                p->buffer_len = 0;
+    /* LF of a CRLF split across chunks */
+    if (p->skip_lf && s < end) {
+        if (*s == '\n') {
+            s++;
+        }
+        p->skip_lf = 0;
+    }
 
-                if (p->aborted) {
-                    return -1;
-                }
-            }
-            /* Skip \r\n as single newline */
-            if (c == '\r' && i + 1 < len && data[i + 1] == '\n') {
-                i++;
-            }
+    while (s < end) {
+        const char *eol = find_eol(s, end);
+        if (!eol) {
+            /* Incomplete line: keep it for the next chunk */
+            pin_fields(p);
+            return buffer_append(p, s, (size_t)(end - s));
+        }
+
+        size_t n = (size_t)(eol - s);
+#if ARC_SSE_LINE_MAX > 0
+        if (p->buffer_len + n >= ARC_SSE_LINE_MAX) {
+            parser_overflow(p, p->buffer_len + n);
+            return -1;
+        }
+#endif
+        if (p->buffer_len == 0) {
+            /* Whole line inside this chunk: parse it in place */
+            process_line(p, s, n);
         } else {
-            /* Append to buffer */
-            if (p->buffer_len + 1 >= p->buffer_size) {
-                size_t new_size = p->buffer_size * 2;
-                char *new_buf = ARC_REALLOC(p->buffer, new_size);
-                if (!new_buf) {
-                    return -1;
+            if (buffer_append(p, s, n) != 0) {
+                return -1;
+            }
+            process_line(p, p->buffer, p->buffer_len);
+            p->buffer_len = 0;
+        }
+
+        if (p->aborted) {
+            return -1;
+        }
+
+        /* CR, LF and CRLF each end a line */
+        s = eol + 1;
+        if (*eol == '\r') {
+            if (s < end) {
+                if (*s == '\n') {
+                    s++;
                 }
-                p->buffer = new_buf;
-                p->buffer_size = new_size;
+            } else {
+                p->skip_lf = 1;
             }
-            p->buffer[p->buffer_len++] = c;
         }
     }
 
+    /* Views into this chunk end with the call */
+    pin_fields(p);
     return 0;
 }
+
+int sse_parser_feed(sse_parser_t *p, const char *data, size_t len) {
+    ac_prof_push(AC_PROF_SSE);
+    int rc = sse_parser_feed_impl(p, data, len);
+    ac_prof_pop();
+    return rc;
+}
@@ -0,0 +1,330 @@
+/**
+ * @file static_pool.c
+ * @brief Fixed-region pool allocator
+ *
+ * Layout: [pool bookkeeping][block][block]... Blocks are cut from the
+ * region in order and, once freed, kept on their class's free list. Each
+ * block starts with a 16-byte header holding its class and requested
+ * size, so free() and realloc() need no size from the caller.
+ *
+ * When a class has nothing free and the region is used up, a free block
+ * of a larger class is handed out whole: it stays in its own class, so
+ * nothing is ever split.
+ */
+
+#include "arc/static_pool.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "cjson_arena.h"
+#include <pthread.h>
+#include <string.h>
+
+/*============================================================================
+ * Size Classes
+ *============================================================================*/
+
+#define POOL_ALIGN        16
+#define POOL_HEADER       16
+#define POOL_SMALL_MAX    128                  /* 16-byte steps up to here */
+#define POOL_MAX_SHIFT    32                   /* Largest class: 4 GiB */
+#define POOL_CLASSES      (8 + 8 * (POOL_MAX_SHIFT - 7))
+#define POOL_MAGIC        0xAC5B1C0Du
+
+typedef union {
+    struct {
+        size_t size;                           /* Requested bytes */
+        uint32_t cls;
+        uint32_t magic;
+    } h;
+    unsigned char pad[POOL_HEADER];
+} block_header_t;
+
+struct ac_static_pool {
+    pthread_mutex_t lock;
+    unsigned char *base;                       /* First block */
+    size_t capacity;
+    size_t top;                                /* Carved so far */
+    void *free_list[POOL_CLASSES];
+    int exhausted_logged;
+    ac_static_pool_stats_t stats;
+};
+
+static unsigned msb(size_t v) {
+    unsigned e = 0;
+    while (v >>= 1) {
+        e++;
+    }
+    return e;
+}
+
+/**
+ * @brief Class of a block of need bytes (header included)
+ * @return Class index, -1 if too large
+ */
+static int class_of(size_t need) {
+    if (need <= POOL_SMALL_MAX) {
+        return (int)((need + 15) / 16) - 1;
+    }
+    unsigned e = msb(need - 1);
+    if (e >= POOL_MAX_SHIFT || e >= sizeof(size_t) * 8 - 1) {
+        return -1;
+    }
+    size_t step = (size_t)1 << (e - 3);
+    size_t steps = (need + step - 1) / step;   /* 9..16 */
+    return 8 + (int)(e - 7) * 8 + (int)steps - 9;
+}
+
+static size_t class_size(int cls) {
+    if (cls < 8) {
+        return (size_t)(cls + 1) * 16;
+    }
+    unsigned e = 7 + (unsigned)(cls - 8) / 8;
+    return (size_t)((cls - 8) % 8 + 9) << (e - 3);
+}
+
+size_t ac_static_pool_block_size(size_t size) {
+    if (size > SIZE_MAX - POOL_HEADER) {
+        return 0;
+    }
+    int cls = class_of(size + POOL_HEADER);
+    return cls < 0 ? 0 : class_size(cls);
+}
+
+/*============================================================================
+ * Pool API
+ *============================================================================*/
+
+ac_static_pool_t *ac_static_pool_create(void *region, size_t size) {
+    if (!region) {
+        return NULL;
+    }
+    uintptr_t start = (uintptr_t)region;
+    uintptr_t aligned = (start + POOL_ALIGN - 1) & ~(uintptr_t)(POOL_ALIGN - 1);
+    size_t control = (sizeof(ac_static_pool_t) + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+    if (size < (aligned - start) + control + POOL_ALIGN) {
+        return NULL;
+    }
+
+    ac_static_pool_t *pool = (ac_static_pool_t *)aligned;
+    memset(pool, 0, sizeof(*pool));
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        return NULL;
+    }
+    pool->base = (unsigned char *)aligned + control;
+    pool->capacity = (size - (aligned - start) - control) & ~(size_t)(POOL_ALIGN - 1);
+    pool->stats.capacity = pool->capacity;
+    return pool;
+}
+
+static void *pool_alloc(void *ctx, size_t size) {
+    ac_static_pool_t *pool = (ac_static_pool_t *)ctx;
+    if (size > SIZE_MAX - POOL_HEADER) {
+        return NULL;
+    }
+    int cls = class_of(size + POOL_HEADER);
+    if (cls < 0) {
+        return NULL;
+    }
+    size_t bytes = class_size(cls);
+
+    pthread_mutex_lock(&pool->lock);
+
+    block_header_t *block = pool->free_list[cls];
+    if (block) {
+        pool->free_list[cls] = *(void **)(block + 1);
+    } else if (pool->capacity - pool->top >= bytes) {
+        block = (block_header_t *)(pool->base + pool->top);
+        block->h.cls = (uint32_t)cls;
+        block->h.magic = POOL_MAGIC;
+        pool->top += bytes;
+        pool->stats.carved = pool->top;
+    } else {
+        /* Region used up: take a free block of a larger class whole */
+        for (int c = cls + 1; c < POOL_CLASSES && !block; c++) {
+            block = pool->free_list[c];
+            if (block) {
+                pool->free_list[c] = *(void **)(block + 1);
+                bytes = class_size(c);
+            }
+        }
+    }
+
+    if (!block) {
+        pool->stats.failures++;
+        int first = !pool->exhausted_logged;
+        pool->exhausted_logged = 1;
+        size_t in_use = pool->stats.in_use;
+        pthread_mutex_unlock(&pool->lock);
+        if (first) {
+            AC_LOG_ERROR("Static pool exhausted: %zu bytes requested, %zu of %zu in use",
+                         size, in_use, pool->capacity);
+        }
+        return NULL;
+    }
+
+    block->h.size = size;
+    pool->stats.in_use += bytes;
+    if (pool->stats.in_use > pool->stats.peak) {
+        pool->stats.peak = pool->stats.in_use;
+    }
+    pool->stats.live_blocks++;
+    pool->stats.allocations++;
+
+    pthread_mutex_unlock(&pool->lock);
+    return block + 1;
+}
+
+static void pool_free(void *ctx, void *ptr, size_t size) {
+    (void)size;
+    if (!ptr) {
+        return;
+    }
+    ac_static_pool_t *pool = (ac_static_pool_t *)ctx;
+    block_header_t *block = (block_header_t *)ptr - 1;
+    if (block->h.magic != POOL_MAGIC) {
+        AC_LOG_ERROR("Static pool: free of a pointer it did not allocate (%p)", ptr);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    *(void **)ptr = pool->free_list[block->h.cls];
+    pool->free_list[block->h.cls] = block;
+    pool->stats.in_use -= class_size((int)block->h.cls);
+    pool->stats.live_blocks--;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void *pool_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)old_size;
+    if (!ptr) {
+        return pool_alloc(ctx, new_size);
+    }
+    block_header_t *block = (block_header_t *)ptr - 1;
+
+    /* Shrinking, or growing within the class: stay in place */
+    if (new_size <= class_size((int)block->h.cls) - POOL_HEADER) {
+        block->h.size = new_size;
+        return ptr;
+    }
+
+    void *grown = pool_alloc(ctx, new_size);
+    if (!grown) {
+        return NULL;
+    }
+    memcpy(grown, ptr, block->h.size);
+    pool_free(ctx, ptr, 0);
+    return grown;
+}
+
+void ac_static_pool_allocator(ac_static_pool_t *pool, ac_allocator_t *out) {
+    if (!out) {
+        return;
+    }
+    out->alloc = pool_alloc;
+    out->realloc = pool_realloc;
+    out->free = pool_free;
+    out->ctx = pool;
+}
+
+arc_err_t ac_static_pool_get_stats(ac_static_pool_t *pool, ac_static_pool_stats_t *stats) {
+    if (!pool || !stats) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Process Pool
+ *============================================================================*/
+
+#if ARC_STATIC_MEMORY
+
+#if ARC_STATIC_HEAP_SIZE > 0
+static _Alignas(POOL_ALIGN) unsigned char s_heap[ARC_STATIC_HEAP_SIZE];
+#endif
+
+static ac_static_pool_t *s_pool = NULL;
+static pthread_once_t s_pool_once = PTHREAD_ONCE_INIT;
+
+static void pool_default_init(void) {
+#if ARC_STATIC_HEAP_SIZE > 0
+    if (!s_pool) {
+        s_pool = ac_static_pool_create(s_heap, sizeof(s_heap));
+    }
+#endif
+    if (!s_pool) {
+        AC_LOG_ERROR("No static heap: call ac_static_memory_init() or set ARC_STATIC_HEAP_SIZE");
+    }
+}
+
+static ac_static_pool_t *pool_default(void) {
+    if (!s_pool) {
+        pthread_once(&s_pool_once, pool_default_init);
+    }
+    return s_pool;
+}
+
+arc_err_t ac_static_memory_init(void *region, size_t size) {
+    if (s_pool && s_pool->stats.allocations > 0) {
+        return ARC_ERR_INVALID_STATE;
+    }
+    ac_static_pool_t *pool = ac_static_pool_create(region, size);
+    if (!pool) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    s_pool = pool;
+    return ARC_OK;
+}
+
+ac_static_pool_t *ac_static_memory_pool(void) {
+    return s_pool;
+}
+
+/* What ARC_MALLOC & co. fall back to without an installed allocator (allocator.c) */
+
+void *ac_static_memory_alloc(size_t size) {
+    ac_static_pool_t *pool = pool_default();
+    if (!pool) {
+        return NULL;
+    }
+    /* cJSON frees its output with ARC_FREE: keep it in the pool too */
+    if (pool->stats.allocations == 0) {
+        ac_cjson_install_hooks();
+    }
+    return pool_alloc(pool, size);
+}
+
+void *ac_static_memory_realloc(void *ptr, size_t size) {
+    ac_static_pool_t *pool = pool_default();
+    if (!pool) {
+        return NULL;
+    }
+    if (ptr && size == 0) {
+        pool_free(pool, ptr, 0);
+        return NULL;
+    }
+    return ptr ? pool_realloc(pool, ptr, 0, size) : ac_static_memory_alloc(size);
+}
+
+void ac_static_memory_free(void *ptr) {
+    if (ptr && s_pool) {
+        pool_free(s_pool, ptr, 0);
+    }
+}
+
+#else /* !ARC_STATIC_MEMORY */
+
+arc_err_t ac_static_memory_init(void *region, size_t size) {
+    (void)region;
+    (void)size;
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+ac_static_pool_t *ac_static_memory_pool(void) {
+    return NULL;
+}
+
+#endif /* ARC_STATIC_MEMORY */
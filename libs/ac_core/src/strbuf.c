@@ -0,0 +1,102 @@
+/**
+ * @file strbuf.c
+ * @brief Growable string builder
+ */
+
+#include "strbuf.h"
+#include "arc/platform.h"
+#include <string.h>
+
+void ac_strbuf_init_arena(ac_strbuf_t *sb, arena_t *arena) {
+    if (!sb) {
+        return;
+    }
+    sb->data = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+    sb->arena = arena;
+}
+
+static arc_err_t strbuf_reserve(ac_strbuf_t *sb, size_t need) {
+    if (need <= sb->cap) {
+        return ARC_OK;
+    }
+
+    size_t cap = sb->cap ? sb->cap : AC_STRBUF_MIN_CAPACITY;
+    while (cap < need) {
+        cap *= 2;
+    }
+
+    char *data;
+    if (sb->arena) {
+        data = arena_alloc(sb->arena, cap);
+        if (data && sb->data) {
+            memcpy(data, sb->data, sb->len + 1);
+        }
+    } else {
+        data = (char *)ARC_REALLOC(sb->data, cap);
+    }
+
+    if (!data) {
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    sb->data = data;
+    sb->cap = cap;
+    return ARC_OK;
+}
+
+arc_err_t ac_strbuf_append(ac_strbuf_t *sb, const char *src, size_t len) {
+    if (!sb) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (!src || len == 0) {
+        return ARC_OK;
+    }
+
+    arc_err_t err = strbuf_reserve(sb, sb->len + len + 1);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    memcpy(sb->data + sb->len, src, len);
+    sb->len += len;
+    sb->data[sb->len] = '\0';
+    return ARC_OK;
+}
+
+const char *ac_strbuf_tail(const ac_strbuf_t *sb, size_t from) {
+    return sb && sb->data && from <= sb->len ? sb->data + from : "";
+}
+
+void ac_strbuf_clear(ac_strbuf_t *sb) {
+    if (sb && sb->data) {
+        sb->len = 0;
+        sb->data[0] = '\0';
+    }
+}
+
+char *ac_strbuf_take(ac_strbuf_t *sb) {
+    if (!sb) {
+        return NULL;
+    }
+
+    /* Storage only exists once something was appended */
+    char *data = sb->data;
+    sb->data = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+    return data;
+}
+
+void ac_strbuf_reset(ac_strbuf_t *sb) {
+    if (!sb) {
+        return;
+    }
+    if (!sb->arena && sb->data) {
+        ARC_FREE(sb->data);
+    }
+    sb->data = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file strbuf.h
+ * @brief Growable string builder (internal)
+ *
+ * Tracks length and capacity so appends are amortized O(1); used to
+ * accumulate streaming deltas (text, thinking, tool arguments).
+ *
+ * Heap-backed by default: ac_strbuf_take() hands out an ARC_MALLOC'd
+ * string the caller frees with ARC_FREE. With ac_strbuf_init_arena()
+ * the buffer grows inside an arena instead (superseded buffers stay in
+ * the arena until it is reset) and taken strings must not be freed.
+ */
+
+#ifndef ARC_STRBUF_H
+#define ARC_STRBUF_H
+
+#include "arc/arena.h"
+#include "arc/error.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** First allocation size in bytes */
+#define AC_STRBUF_MIN_CAPACITY 64
+
+typedef struct {
+    char *data;                      /* NUL-terminated, NULL until first append */
+    size_t len;
+    size_t cap;                      /* Allocated bytes, including NUL */
+    arena_t *arena;                  /* NULL = heap */
+} ac_strbuf_t;
+
+#define AC_STRBUF_INIT { NULL, 0, 0, NULL }
+
+/**
+ * @brief Initialize an arena-backed builder
+ */
+void ac_strbuf_init_arena(ac_strbuf_t *sb, arena_t *arena);
+
+/**
+ * @brief Append len bytes of src
+ *
+ * @return ARC_OK, ARC_ERR_NO_MEMORY (contents unchanged)
+ */
+arc_err_t ac_strbuf_append(ac_strbuf_t *sb, const char *src, size_t len);
+
+/**
+ * @brief Text appended since the builder was from bytes long
+ *
+ * @return NUL-terminated tail ("" if nothing was appended), valid until
+ *         the next append
+ */
+const char *ac_strbuf_tail(const ac_strbuf_t *sb, size_t from);
+
+/**
+ * @brief Empty the builder but keep its storage for reuse
+ */
+void ac_strbuf_clear(ac_strbuf_t *sb);
+
+/**
+ * @brief Detach the accumulated string and reset the builder
+ *
+ * @return String (NULL if nothing was appended)
+ */
+char *ac_strbuf_take(ac_strbuf_t *sb);
+
+/**
+ * @brief Drop the contents (frees heap storage)
+ */
+void ac_strbuf_reset(ac_strbuf_t *sb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_STRBUF_H */
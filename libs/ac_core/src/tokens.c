@@ -0,0 +1,210 @@
+/**
+ * @file tokens.c
+ * @brief Client-side token estimation
+ *
+ * Byte-level BPE tokenizers (tiktoken, Claude, Llama 3) first split text
+ * with a pre-tokenizer regex and then merge bytes within each piece. The
+ * split is cheap to mimic; the merges are what the vocabulary decides, so
+ * they are approximated per family by how many characters a token covers
+ * in each kind of piece.
+ */
+
+#include "arc/tokens.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+/*============================================================================
+ * Family Costs
+ *============================================================================*/
+
+/**
+ * @brief Characters per token by piece kind (non-ASCII in tenths of a token)
+ */
+typedef struct {
+    uint8_t word_chars;      /* Letters covered by one token of a word */
+    uint8_t digit_chars;     /* Digits per token (tiktoken groups by 3) */
+    uint8_t punct_chars;     /* Punctuation per token ("{\"", "();") */
+    uint8_t space_chars;     /* Spaces per token in indentation runs */
+    uint8_t latin_tenths;    /* Per 2-byte character (accented Latin, Cyrillic, Greek) */
+    uint8_t wide_tenths;     /* Per 3-byte character (CJK, most other scripts) */
+    uint8_t astral_tenths;   /* Per 4-byte character (emoji) */
+} family_costs_t;
+
+static const family_costs_t s_costs[AC_TOKENS_FAMILY_COUNT] = {
+    [AC_TOKENS_GENERIC] = { 4, 2, 2, 4, 10, 15, 30 },
+    [AC_TOKENS_CL100K]  = { 5, 3, 2, 8,  6, 12, 25 },
+    [AC_TOKENS_O200K]   = { 6, 3, 2, 8,  4,  8, 20 },
+    [AC_TOKENS_CLAUDE]  = { 5, 3, 2, 4,  7, 12, 25 },
+    [AC_TOKENS_LLAMA]   = { 5, 3, 2, 8,  5,  9, 25 },
+};
+
+/*============================================================================
+ * Model Families
+ *============================================================================*/
+
+static int has_prefix(const char *s, const char *prefix) {
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+ac_tokens_family_t ac_tokens_family(const char *model) {
+    if (!model) {
+        return AC_TOKENS_GENERIC;
+    }
+
+    /* "openai/gpt-4o", "anthropic.claude-...": match on the lowercased name */
+    const char *slash = strrchr(model, '/');
+    if (slash) {
+        model = slash + 1;
+    }
+    char name[64];
+    size_t n = 0;
+    for (; model[n] && n < sizeof(name) - 1; n++) {
+        name[n] = (char)tolower((unsigned char)model[n]);
+    }
+    name[n] = '\0';
+
+    if (strstr(name, "claude")) {
+        return AC_TOKENS_CLAUDE;
+    }
+    if (strstr(name, "gpt-4o") || strstr(name, "gpt-4.1") || strstr(name, "gpt-4.5") ||
+        strstr(name, "gpt-5") || strstr(name, "gpt-oss") || strstr(name, "chatgpt") ||
+        has_prefix(name, "o1") || has_prefix(name, "o3") || has_prefix(name, "o4")) {
+        return AC_TOKENS_O200K;
+    }
+    if (strstr(name, "gpt-4") || strstr(name, "gpt-3.5") || strstr(name, "text-embedding-3")) {
+        return AC_TOKENS_CL100K;
+    }
+    if (strstr(name, "llama-3") || strstr(name, "llama3") || strstr(name, "llama-4") ||
+        strstr(name, "qwen") || strstr(name, "deepseek")) {
+        return AC_TOKENS_LLAMA;
+    }
+    return AC_TOKENS_GENERIC;
+}
+
+/*============================================================================
+ * Estimation
+ *============================================================================*/
+
+static int is_letter(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static int is_digit(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+static int is_space(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/** Tokens for a run of len characters at chars per token */
+static size_t run_tokens(size_t len, unsigned chars) {
+    return 1 + (len - 1) / chars;
+}
+
+size_t ac_tokens_estimate(const char *text, size_t len, ac_tokens_family_t family) {
+    if (!text || len == 0) {
+        return 0;
+    }
+    if ((unsigned)family >= AC_TOKENS_FAMILY_COUNT) {
+        family = AC_TOKENS_GENERIC;
+    }
+
+    const family_costs_t *cost = &s_costs[family];
+    const unsigned char *p = (const unsigned char *)text;
+    const unsigned char *end = p + len;
+    size_t tokens = 0;
+    size_t tenths = 0;
+
+    while (p < end) {
+        const unsigned char *start = p;
+        unsigned char c = *p;
+
+        if (is_letter(c)) {
+            while (p < end && is_letter(*p)) p++;
+            tokens += run_tokens((size_t)(p - start), cost->word_chars);
+        } else if (is_digit(c)) {
+            while (p < end && is_digit(*p)) p++;
+            tokens += run_tokens((size_t)(p - start), cost->digit_chars);
+        } else if (c == '\n' || c == '\r') {
+            /* A run of line breaks (with trailing indentation) is one piece */
+            while (p < end && is_space(*p)) p++;
+            tokens++;
+        } else if (is_space(c)) {
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            size_t run = (size_t)(p - start);
+            /* One space is absorbed by the word or symbol that follows */
+            if (run == 1 && p < end && (*p >= 0x80 || (!is_space(*p) && !is_digit(*p)))) {
+                continue;
+            }
+            tokens += run_tokens(run, cost->space_chars);
+        } else if (c < 0x80) {
+            while (p < end && *p < 0x80 && !is_letter(*p) && !is_digit(*p) && !is_space(*p)) p++;
+            tokens += run_tokens((size_t)(p - start), cost->punct_chars);
+        } else {
+            /* UTF-8: charge by sequence length, skip the continuation bytes */
+            size_t seq = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+            tenths += seq == 4 ? cost->astral_tenths :
+                      seq == 3 ? cost->wide_tenths :
+                      seq == 2 ? cost->latin_tenths : 10;
+            p++;
+            for (size_t i = 1; i < seq && p < end && (*p & 0xC0) == 0x80; i++) p++;
+        }
+    }
+
+    return tokens + (tenths + 9) / 10;
+}
+
+size_t ac_tokens_estimate_str(const char *text, ac_tokens_family_t family) {
+    return text ? ac_tokens_estimate(text, strlen(text), family) : 0;
+}
+
+static size_t estimate_str(ac_str_t s, ac_tokens_family_t family) {
+    return s.ptr ? ac_tokens_estimate(s.ptr, s.len, family) : 0;
+}
+
+size_t ac_message_tokens(const ac_message_t *msg, ac_tokens_family_t family) {
+    if (!msg) {
+        return 0;
+    }
+    if (msg->tokens && msg->tokens_family == (uint8_t)family) {
+        return msg->tokens;
+    }
+
+    size_t tokens = AC_TOKENS_MESSAGE_OVERHEAD +
+                    estimate_str(ac_message_content(msg), family) +
+                    ac_tokens_estimate_str(msg->tool_call_id, family);
+
+    for (const ac_tool_call_t *tc = msg->tool_calls; tc; tc = tc->next) {
+        tokens += ac_tokens_estimate_str(tc->id, family) +
+                  ac_tokens_estimate_str(tc->name, family) +
+                  estimate_str(ac_tool_call_arguments(tc), family);
+    }
+
+    for (const ac_content_block_t *b = msg->blocks; b; b = b->next) {
+        tokens += estimate_str(ac_block_text(b), family) +
+                  ac_tokens_estimate_str(b->signature, family) +
+                  ac_tokens_estimate_str(b->data, family);
+        tokens += ac_tokens_estimate_str(b->id, family) +
+                  ac_tokens_estimate_str(b->name, family) +
+                  estimate_str(ac_block_input(b), family);
+        if (b->type == AC_BLOCK_IMAGE) {
+            tokens += AC_TOKENS_IMAGE;
+        }
+    }
+
+    /* Cache only, like json_cache: the message itself is not modified */
+    ac_message_t *m = (ac_message_t *)msg;
+    m->tokens = tokens > UINT32_MAX ? UINT32_MAX : (uint32_t)tokens;
+    m->tokens_family = (uint8_t)family;
+    return tokens;
+}
+
+size_t ac_messages_tokens(const ac_message_t *messages, ac_tokens_family_t family) {
+    size_t tokens = 0;
+    for (const ac_message_t *msg = messages; msg; msg = msg->next) {
+        tokens += ac_message_tokens(msg, family);
+    }
+    return tokens;
+}
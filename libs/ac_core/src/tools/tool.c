@@ -3,15 +3,29 @@
  * @brief Tool Registry Implementation
  *
  * Provides dynamic tool registration for builtin and MCP tools.
+ *
+ * Lookups never lock: they read the current snapshot, an immutable
+ * version of the catalog published through one atomic pointer. Writers
+ * take the write lock, build the next snapshot (sharing what did not
+ * change) and publish it when they unlock. Replaced snapshots stay in the
+ * session arena until the session closes, so a reader may keep using the
+ * version it loaded, and tools it found stay valid, however long it runs.
  */
 
 #include "arc/tool.h"
 #include "arc/log.h"
 #include "arc/platform.h"
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include "cJSON.h"
+#include "cjson_arena.h"
+#include "json_scan.h"
+#include "json_writer.h"
+#include "strbuf.h"
+#include "pthread_port.h"
 
 /*============================================================================
  * Constants
@@ -20,17 +34,65 @@
 #define INITIAL_CAPACITY 16
 #define GROWTH_FACTOR 2
 
+/* Name index: open addressing, slots = 2 x array capacity (power of two) */
+#define INDEX_LOAD_FACTOR 2
+#define INDEX_EMPTY 0
+
+/* Decoded arguments up to this size stay on the stack */
+#if ARC_STACK_BUDGET
+#define ARGS_STACK_ITEMS 4
+#define ARGS_STACK_TEXT  128
+#else
+#define ARGS_STACK_ITEMS 16
+#define ARGS_STACK_TEXT  1024
+#endif
+
 /*============================================================================
  * Tool Registry Structure
  *============================================================================*/
 
+/**
+ * One published version of the catalog
+ *
+ * Nothing changes once published except schema_cache, set once per
+ * format. A later snapshot may share tools (appending past count, which
+ * no earlier snapshot reads), index and tables with this one.
+ */
+typedef struct {
+    ac_tool_t *tools;                /* Copied tools, count of capacity used */
+    size_t count;
+    size_t capacity;
+
+    /* Name -> tool index + 1 (INDEX_EMPTY = free slot) */
+    uint32_t *index;
+    size_t index_mask;               /* Slot count - 1 */
+
+    /* Static tables (ac_tool_registry_attach()), after the tools above */
+    const ac_tool_table_t **tables;  /* Arena */
+    size_t table_count;
+    size_t table_tools;              /* Tools in all tables */
+
+    /* Serialized schema per format (arena, NULL = not built yet) */
+    _Atomic(const char *) schema_cache[AC_TOOL_SCHEMA_FORMAT_COUNT];
+} registry_snapshot_t;
+
 struct ac_tool_registry {
     ac_session_t *session;           /* Owning session */
     arena_t *arena;                  /* Arena for allocations */
 
-    ac_tool_t *tools;                /* Dynamic array of tools */
-    size_t count;                    /* Current tool count */
-    size_t capacity;                 /* Array capacity */
+    _Atomic(registry_snapshot_t *) current;  /* What lookups read */
+
+    /* Writers, one at a time; the session arena lock is held with it */
+    pthread_mutex_t write_lock;
+    registry_snapshot_t *draft;      /* Next version (write lock), NULL = unchanged */
+    int draft_owns_tools;            /* draft->tools is not shared with current */
+    int draft_owns_index;            /* draft->index is not shared with current */
+
+    /* MCP clients and result cache (tool_mcp.c, NULL = none) */
+    void *mcp_state;
+
+    /* Large result spilling (tool_spill.c, NULL = off) */
+    void *spill_state;
 };
 
 /*============================================================================
@@ -40,6 +102,231 @@ struct ac_tool_registry {
 /* Declared in session.c */
 extern arena_t *ac_session_get_arena(ac_session_t *session);
 extern arc_err_t ac_session_add_registry(ac_session_t *session, ac_tool_registry_t *registry);
+extern void ac_session_arena_lock(ac_session_t *session);
+extern void ac_session_arena_unlock(ac_session_t *session);
+
+/*============================================================================
+ * Internal: Snapshots
+ *============================================================================*/
+
+/**
+ * @brief The published snapshot (lock-free)
+ */
+static registry_snapshot_t *registry_snapshot(const ac_tool_registry_t *registry) {
+    return atomic_load_explicit(&registry->current, memory_order_acquire);
+}
+
+/**
+ * @brief What a writer sees: its draft, else the published snapshot
+ */
+static registry_snapshot_t *registry_view(const ac_tool_registry_t *registry) {
+    return registry->draft ? registry->draft :
+        atomic_load_explicit(&registry->current, memory_order_relaxed);
+}
+
+/**
+ * @brief The snapshot being built, started from the published one
+ */
+static registry_snapshot_t *draft_get(ac_tool_registry_t *registry) {
+    if (registry->draft) {
+        return registry->draft;
+    }
+
+    registry_snapshot_t *draft = (registry_snapshot_t *)arena_alloc(
+        registry->arena, sizeof(registry_snapshot_t));
+    if (!draft) {
+        AC_LOG_ERROR("Failed to allocate tool registry snapshot");
+        return NULL;
+    }
+
+    const registry_snapshot_t *cur = atomic_load_explicit(&registry->current,
+                                                          memory_order_relaxed);
+    draft->tools = cur->tools;
+    draft->count = cur->count;
+    draft->capacity = cur->capacity;
+    draft->index = cur->index;
+    draft->index_mask = cur->index_mask;
+    draft->tables = cur->tables;
+    draft->table_count = cur->table_count;
+    draft->table_tools = cur->table_tools;
+    for (int f = 0; f < AC_TOOL_SCHEMA_FORMAT_COUNT; f++) {
+        atomic_init(&draft->schema_cache[f], NULL);
+    }
+
+    registry->draft = draft;
+    registry->draft_owns_tools = 0;
+    registry->draft_owns_index = 0;
+    return draft;
+}
+
+/**
+ * @brief Give the draft its own tool array, so entries may change in place
+ */
+static arc_err_t draft_own_tools(ac_tool_registry_t *registry, registry_snapshot_t *draft) {
+    if (registry->draft_owns_tools) {
+        return ARC_OK;
+    }
+
+    ac_tool_t *tools = (ac_tool_t *)arena_alloc(
+        registry->arena, sizeof(ac_tool_t) * draft->capacity);
+    if (!tools) {
+        AC_LOG_ERROR("Failed to allocate tool array");
+        return ARC_ERR_MEMORY;
+    }
+    memcpy(tools, draft->tools, sizeof(ac_tool_t) * draft->count);
+
+    draft->tools = tools;
+    registry->draft_owns_tools = 1;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Internal: Write Lock
+ *============================================================================*/
+
+/**
+ * @brief Start a write section (internal, for tool_mcp.c and tool_spill.c)
+ *
+ * Not recursive: inside a section use the *_locked entry points.
+ */
+void ac_tool_registry_write_lock(ac_tool_registry_t *registry) {
+    pthread_mutex_lock(&registry->write_lock);
+    ac_session_arena_lock(registry->session);
+}
+
+/**
+ * @brief Start a write section unless another one is open
+ *
+ * @return 1 if the section was started
+ */
+int ac_tool_registry_write_trylock(ac_tool_registry_t *registry) {
+    if (pthread_mutex_trylock(&registry->write_lock) != 0) {
+        return 0;
+    }
+    ac_session_arena_lock(registry->session);
+    return 1;
+}
+
+/**
+ * @brief Publish what the section changed and end it
+ */
+void ac_tool_registry_write_unlock(ac_tool_registry_t *registry) {
+    if (registry->draft) {
+        atomic_store_explicit(&registry->current, registry->draft, memory_order_release);
+        registry->draft = NULL;
+    }
+    ac_session_arena_unlock(registry->session);
+    pthread_mutex_unlock(&registry->write_lock);
+}
+
+/*============================================================================
+ * Internal: Name Index
+ *============================================================================*/
+
+/** FNV-1a */
+static uint32_t tool_name_hash(const char *name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Find the slot holding name, or the empty slot where it would go
+ */
+static size_t index_probe(const registry_snapshot_t *snap, const char *name) {
+    size_t slot = tool_name_hash(name) & snap->index_mask;
+
+    while (snap->index[slot] != INDEX_EMPTY) {
+        const ac_tool_t *tool = &snap->tools[snap->index[slot] - 1];
+        if (strcmp(tool->name, name) == 0) {
+            break;
+        }
+        slot = (slot + 1) & snap->index_mask;
+    }
+    return slot;
+}
+
+/**
+ * @brief Build a fresh index for the snapshot's array capacity
+ *
+ * The old index stays in the arena, like old tool arrays.
+ */
+static arc_err_t index_rebuild(ac_tool_registry_t *registry, registry_snapshot_t *snap) {
+    size_t slots = 1;
+    while (slots < snap->capacity * INDEX_LOAD_FACTOR) {
+        slots <<= 1;
+    }
+
+    uint32_t *index = (uint32_t *)arena_alloc(registry->arena, sizeof(uint32_t) * slots);
+    if (!index) {
+        AC_LOG_ERROR("Failed to allocate tool index");
+        return ARC_ERR_MEMORY;
+    }
+    memset(index, 0, sizeof(uint32_t) * slots);
+
+    snap->index = index;
+    snap->index_mask = slots - 1;
+
+    for (size_t i = 0; i < snap->count; i++) {
+        size_t slot = index_probe(snap, snap->tools[i].name);
+        snap->index[slot] = (uint32_t)(i + 1);
+    }
+    return ARC_OK;
+}
+
+/**
+ * @brief Give the draft its own index, so slots may be filled in place
+ */
+static arc_err_t draft_own_index(ac_tool_registry_t *registry, registry_snapshot_t *draft) {
+    if (registry->draft_owns_index) {
+        return ARC_OK;
+    }
+
+    size_t size = sizeof(uint32_t) * (draft->index_mask + 1);
+    uint32_t *index = (uint32_t *)arena_alloc(registry->arena, size);
+    if (!index) {
+        AC_LOG_ERROR("Failed to allocate tool index");
+        return ARC_ERR_MEMORY;
+    }
+    memcpy(index, draft->index, size);
+
+    draft->index = index;
+    registry->draft_owns_index = 1;
+    return ARC_OK;
+}
+
+/**
+ * @brief Find name in the attached tables
+ */
+static const ac_tool_t *tables_find(const registry_snapshot_t *snap, const char *name) {
+    for (size_t i = 0; i < snap->table_count; i++) {
+        const ac_tool_t *tool = snap->tables[i]->find(name);
+        if (tool) {
+            return tool;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Tool i of all tools: copied ones first, then the tables'
+ */
+static const ac_tool_t *snapshot_tool_at(const registry_snapshot_t *snap, size_t i) {
+    if (i < snap->count) {
+        return &snap->tools[i];
+    }
+    i -= snap->count;
+    for (size_t t = 0; t < snap->table_count; t++) {
+        if (i < snap->tables[t]->count) {
+            return snap->tables[t]->tools[i];
+        }
+        i -= snap->tables[t]->count;
+    }
+    return NULL;
+}
 
 /*============================================================================
  * Registry Creation
@@ -57,36 +344,59 @@ ac_tool_registry_t *ac_tool_registry_create(ac_session_t *session) {
         return NULL;
     }
 
-    /* Allocate registry from arena */
+    /* Allocate registry and its first snapshot from arena */
+    ac_session_arena_lock(session);
     ac_tool_registry_t *registry = (ac_tool_registry_t *)arena_alloc(
         arena, sizeof(ac_tool_registry_t)
     );
-    if (!registry) {
+    registry_snapshot_t *snap = (registry_snapshot_t *)arena_alloc(
+        arena, sizeof(registry_snapshot_t)
+    );
+    ac_tool_t *tools = (ac_tool_t *)arena_alloc(
+        arena, sizeof(ac_tool_t) * INITIAL_CAPACITY
+    );
+    arc_err_t err = ARC_ERR_MEMORY;
+    if (registry && snap && tools) {
+        registry->arena = arena;
+        snap->tools = tools;
+        snap->count = 0;
+        snap->capacity = INITIAL_CAPACITY;
+        snap->tables = NULL;
+        snap->table_count = 0;
+        snap->table_tools = 0;
+        for (int f = 0; f < AC_TOOL_SCHEMA_FORMAT_COUNT; f++) {
+            atomic_init(&snap->schema_cache[f], NULL);
+        }
+        err = index_rebuild(registry, snap);
+    }
+    ac_session_arena_unlock(session);
+
+    if (err != ARC_OK) {
         AC_LOG_ERROR("Failed to allocate registry");
         return NULL;
     }
 
-    /* Allocate initial tool array */
-    registry->tools = (ac_tool_t *)arena_alloc(
-        arena, sizeof(ac_tool_t) * INITIAL_CAPACITY
-    );
-    if (!registry->tools) {
-        AC_LOG_ERROR("Failed to allocate tool array");
+    if (pthread_mutex_init(&registry->write_lock, NULL) != 0) {
+        AC_LOG_ERROR("Failed to initialize registry lock");
         return NULL;
     }
 
     registry->session = session;
-    registry->arena = arena;
-    registry->count = 0;
-    registry->capacity = INITIAL_CAPACITY;
+    atomic_init(&registry->current, snap);
+    registry->draft = NULL;
+    registry->draft_owns_tools = 0;
+    registry->draft_owns_index = 0;
+    registry->mcp_state = NULL;
+    registry->spill_state = NULL;
 
     /* Register with session for lifecycle management */
     if (ac_session_add_registry(session, registry) != ARC_OK) {
         AC_LOG_ERROR("Failed to register with session");
+        pthread_mutex_destroy(&registry->write_lock);
         return NULL;
     }
 
-    AC_LOG_DEBUG("Tool registry created (capacity=%zu)", registry->capacity);
+    AC_LOG_DEBUG("Tool registry created (capacity=%zu)", snap->capacity);
     return registry;
 }
 
@@ -94,8 +404,8 @@ ac_tool_registry_t *ac_tool_registry_create(ac_session_t *session) {
  * Internal: Grow Array
  *============================================================================*/
 
-static arc_err_t registry_grow(ac_tool_registry_t *registry) {
-    size_t new_capacity = registry->capacity * GROWTH_FACTOR;
+static arc_err_t draft_grow(ac_tool_registry_t *registry, registry_snapshot_t *draft) {
+    size_t new_capacity = draft->capacity * GROWTH_FACTOR;
 
     ac_tool_t *new_tools = (ac_tool_t *)arena_alloc(
         registry->arena, sizeof(ac_tool_t) * new_capacity
@@ -106,11 +416,23 @@ static arc_err_t registry_grow(ac_tool_registry_t *registry) {
     }
 
     /* Copy existing tools */
-    memcpy(new_tools, registry->tools, sizeof(ac_tool_t) * registry->count);
+    memcpy(new_tools, draft->tools, sizeof(ac_tool_t) * draft->count);
 
     /* Old array remains in arena (will be freed when arena is destroyed) */
-    registry->tools = new_tools;
-    registry->capacity = new_capacity;
+    ac_tool_t *old_tools = draft->tools;
+    size_t old_capacity = draft->capacity;
+    draft->tools = new_tools;
+    draft->capacity = new_capacity;
+
+    arc_err_t err = index_rebuild(registry, draft);
+    if (err != ARC_OK) {
+        /* The index still matches the old array */
+        draft->tools = old_tools;
+        draft->capacity = old_capacity;
+        return err;
+    }
+    registry->draft_owns_tools = 1;
+    registry->draft_owns_index = 1;
 
     AC_LOG_DEBUG("Tool registry grown to capacity=%zu", new_capacity);
     return ARC_OK;
@@ -120,32 +442,36 @@ static arc_err_t registry_grow(ac_tool_registry_t *registry) {
  * Tool Registration
  *============================================================================*/
 
-arc_err_t ac_tool_registry_add(
+/**
+ * @brief ac_tool_registry_add() inside a write section (internal, for
+ *        tool_mcp.c and tool_spill.c)
+ */
+arc_err_t ac_tool_registry_add_locked(
     ac_tool_registry_t *registry,
     const ac_tool_t *tool
 ) {
-    if (!registry || !tool || !tool->name) {
-        return ARC_ERR_INVALID_ARG;
+    /* Reject duplicates: lookups would only ever see the first one */
+    const registry_snapshot_t *view = registry_view(registry);
+    if (view->index[index_probe(view, tool->name)] != INDEX_EMPTY ||
+        tables_find(view, tool->name)) {
+        AC_LOG_WARN("Tool '%s' already registered, skipping", tool->name);
+        return ARC_ERR_EXISTS;
     }
 
-    /* Check for duplicate */
-    for (size_t i = 0; i < registry->count; i++) {
-        if (strcmp(registry->tools[i].name, tool->name) == 0) {
-            AC_LOG_WARN("Tool '%s' already registered, skipping", tool->name);
-            return ARC_OK;
-        }
+    registry_snapshot_t *draft = draft_get(registry);
+    if (!draft) {
+        return ARC_ERR_MEMORY;
     }
 
-    /* Grow if needed */
-    if (registry->count >= registry->capacity) {
-        arc_err_t err = registry_grow(registry);
-        if (err != ARC_OK) {
-            return err;
-        }
+    /* Grow if needed; otherwise append past every published count */
+    arc_err_t err = draft->count >= draft->capacity ?
+        draft_grow(registry, draft) : draft_own_index(registry, draft);
+    if (err != ARC_OK) {
+        return err;
     }
 
     /* Copy tool definition */
-    ac_tool_t *dest = &registry->tools[registry->count];
+    ac_tool_t *dest = &draft->tools[draft->count];
 
     dest->name = arena_strdup(registry->arena, tool->name);
     dest->description = tool->description ?
@@ -154,18 +480,43 @@ arc_err_t ac_tool_registry_add(
         arena_strdup(registry->arena, tool->parameters) : NULL;
     dest->execute = tool->execute;
     dest->priv = tool->priv;
+    dest->parallel_safe = tool->parallel_safe;
+    dest->parse_args = tool->parse_args;
+    dest->execute_args = tool->execute_args;
+    dest->execute_write = tool->execute_write;
+    dest->execute_async = tool->execute_async;
+    dest->deferred = tool->deferred;
+    dest->schema_openai = tool->schema_openai ?
+        arena_strdup(registry->arena, tool->schema_openai) : NULL;
+    dest->schema_anthropic = tool->schema_anthropic ?
+        arena_strdup(registry->arena, tool->schema_anthropic) : NULL;
 
     if (!dest->name) {
         AC_LOG_ERROR("Failed to copy tool name");
         return ARC_ERR_MEMORY;
     }
 
-    registry->count++;
+    draft->index[index_probe(draft, dest->name)] = (uint32_t)(draft->count + 1);
+    draft->count++;
 
-    AC_LOG_DEBUG("Tool registered: %s (total=%zu)", tool->name, registry->count);
+    AC_LOG_DEBUG("Tool registered: %s (total=%zu)", tool->name, draft->count);
     return ARC_OK;
 }
 
+arc_err_t ac_tool_registry_add(
+    ac_tool_registry_t *registry,
+    const ac_tool_t *tool
+) {
+    if (!registry || !tool || !tool->name) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    ac_tool_registry_write_lock(registry);
+    arc_err_t err = ac_tool_registry_add_locked(registry, tool);
+    ac_tool_registry_write_unlock(registry);
+    return err;
+}
+
 arc_err_t ac_tool_registry_add_array(
     ac_tool_registry_t *registry,
     const ac_tool_t **tools
@@ -174,16 +525,211 @@ arc_err_t ac_tool_registry_add_array(
         return ARC_ERR_INVALID_ARG;
     }
 
+    arc_err_t result = ARC_OK;
+
+    /* One snapshot for the whole array */
+    ac_tool_registry_write_lock(registry);
     for (const ac_tool_t **p = tools; *p != NULL; p++) {
-        arc_err_t err = ac_tool_registry_add(registry, *p);
-        if (err != ARC_OK) {
-            return err;
+        arc_err_t err = (*p)->name ? ac_tool_registry_add_locked(registry, *p)
+                                   : ARC_ERR_INVALID_ARG;
+        if (err == ARC_ERR_EXISTS) {
+            /* Keep going; report the clash once everything else is in */
+            result = err;
+        } else if (err != ARC_OK) {
+            result = err;
+            break;
+        }
+    }
+    ac_tool_registry_write_unlock(registry);
+
+    return result;
+}
+
+arc_err_t ac_tool_registry_attach(
+    ac_tool_registry_t *registry,
+    const ac_tool_table_t *table
+) {
+    if (!registry || !table || !table->find || (table->count > 0 && !table->tools)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    ac_tool_registry_write_lock(registry);
+    const registry_snapshot_t *view = registry_view(registry);
+    arc_err_t err = ARC_OK;
+
+    /* Clash check from the smaller side, so a large table costs nothing */
+    for (size_t i = 0; i < view->count && err == ARC_OK; i++) {
+        if (table->find(view->tools[i].name)) {
+            AC_LOG_WARN("Tool '%s' already registered, table not attached",
+                        view->tools[i].name);
+            err = ARC_ERR_EXISTS;
+        }
+    }
+    for (size_t t = 0; t < view->table_count && err == ARC_OK; t++) {
+        const ac_tool_table_t *other = view->tables[t];
+        const ac_tool_table_t *small = other->count < table->count ? other : table;
+        const ac_tool_table_t *large = small == other ? table : other;
+        for (size_t i = 0; i < small->count; i++) {
+            if (large->find(small->tools[i]->name)) {
+                AC_LOG_WARN("Tool '%s' already registered, table not attached",
+                            small->tools[i]->name);
+                err = ARC_ERR_EXISTS;
+                break;
+            }
+        }
+    }
+
+    /* The old array stays in the arena, like old tool arrays */
+    const ac_tool_table_t **tables = NULL;
+    registry_snapshot_t *draft = NULL;
+    if (err == ARC_OK) {
+        tables = (const ac_tool_table_t **)arena_alloc(
+            registry->arena, sizeof(*tables) * (view->table_count + 1));
+        draft = tables ? draft_get(registry) : NULL;
+        if (!draft) {
+            AC_LOG_ERROR("Failed to attach tool table");
+            err = ARC_ERR_MEMORY;
+        }
+    }
+    if (err == ARC_OK) {
+        if (draft->table_count > 0) {
+            memcpy(tables, draft->tables, sizeof(*tables) * draft->table_count);
+        }
+        tables[draft->table_count] = table;
+        draft->tables = tables;
+        draft->table_count++;
+        draft->table_tools += table->count;
+
+        AC_LOG_DEBUG("Tool table attached: %zu tools (total=%zu)",
+                     table->count, draft->count + draft->table_tools);
+    }
+    ac_tool_registry_write_unlock(registry);
+
+    return err;
+}
+
+/**
+ * @brief Drop every tool match() accepts (internal, for tool_mcp.c; write
+ *        lock held)
+ *
+ * Survivors keep their order. The old array stays in the arena, so
+ * pointers handed out by find() stay readable.
+ *
+ * @return Number of tools removed
+ */
+size_t ac_tool_registry_remove_if(
+    ac_tool_registry_t *registry,
+    int (*match)(const ac_tool_t *tool, void *arg),
+    void *arg
+) {
+    if (!registry || !match) {
+        return 0;
+    }
+
+    const registry_snapshot_t *view = registry_view(registry);
+    ac_tool_t *kept = (ac_tool_t *)arena_alloc(
+        registry->arena, sizeof(ac_tool_t) * view->capacity
+    );
+    if (!kept) {
+        AC_LOG_ERROR("Failed to allocate tool array");
+        return 0;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < view->count; i++) {
+        if (!match(&view->tools[i], arg)) {
+            kept[count++] = view->tools[i];
         }
     }
 
+    size_t removed = view->count - count;
+    if (removed == 0) {
+        return 0;
+    }
+
+    registry_snapshot_t *draft = draft_get(registry);
+    if (!draft) {
+        return 0;
+    }
+
+    ac_tool_t *old_tools = draft->tools;
+    size_t old_count = draft->count;
+    uint32_t *old_index = draft->index;
+    size_t old_mask = draft->index_mask;
+
+    draft->tools = kept;
+    draft->count = count;
+    if (index_rebuild(registry, draft) != ARC_OK) {
+        /* The old index still matches the old array */
+        draft->tools = old_tools;
+        draft->count = old_count;
+        draft->index = old_index;
+        draft->index_mask = old_mask;
+        return 0;
+    }
+    registry->draft_owns_tools = 1;
+    registry->draft_owns_index = 1;
+
+    return removed;
+}
+
+/**
+ * @brief ac_tool_registry_update_schema() inside a write section
+ *        (internal, for tool_mcp.c)
+ *
+ * Clears deferred. The old strings stay in the arena, like tools dropped
+ * by remove_if.
+ */
+arc_err_t ac_tool_registry_update_schema_locked(
+    ac_tool_registry_t *registry,
+    const char *name,
+    const char *description,
+    const char *parameters
+) {
+    const registry_snapshot_t *view = registry_view(registry);
+    uint32_t entry = view->index[index_probe(view, name)];
+    if (entry == INDEX_EMPTY) {
+        return ARC_ERR_NOT_FOUND;
+    }
+
+    char *desc = description ? arena_strdup(registry->arena, description) : NULL;
+    char *params = parameters ? arena_strdup(registry->arena, parameters) : NULL;
+    if ((description && !desc) || (parameters && !params)) {
+        return ARC_ERR_MEMORY;
+    }
+
+    /* Entries of published snapshots never change: edit a copy */
+    registry_snapshot_t *draft = draft_get(registry);
+    if (!draft || draft_own_tools(registry, draft) != ARC_OK) {
+        return ARC_ERR_MEMORY;
+    }
+
+    ac_tool_t *tool = &draft->tools[entry - 1];
+    tool->description = desc;
+    tool->parameters = params;
+    tool->deferred = 0;
+    tool->schema_openai = NULL;      /* Serialized from the old schema */
+    tool->schema_anthropic = NULL;
+
     return ARC_OK;
 }
 
+arc_err_t ac_tool_registry_update_schema(
+    ac_tool_registry_t *registry,
+    const char *name,
+    const char *description,
+    const char *parameters
+) {
+    if (!registry || !name) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    ac_tool_registry_write_lock(registry);
+    arc_err_t err = ac_tool_registry_update_schema_locked(registry, name, description, parameters);
+    ac_tool_registry_write_unlock(registry);
+    return err;
+}
+
 /*============================================================================
  * Tool Query
  *============================================================================*/
@@ -196,29 +742,531 @@ const ac_tool_t *ac_tool_registry_find(
         return NULL;
     }
 
-    for (size_t i = 0; i < registry->count; i++) {
-        if (strcmp(registry->tools[i].name, name) == 0) {
-            return &registry->tools[i];
+    const registry_snapshot_t *snap = registry_snapshot(registry);
+    uint32_t entry = snap->index[index_probe(snap, name)];
+    if (entry != INDEX_EMPTY) {
+        return &snap->tools[entry - 1];
+    }
+    return snap->table_count > 0 ? tables_find(snap, name) : NULL;
+}
+
+size_t ac_tool_registry_count(const ac_tool_registry_t *registry) {
+    if (!registry) {
+        return 0;
+    }
+    const registry_snapshot_t *snap = registry_snapshot(registry);
+    return snap->count + snap->table_tools;
+}
+
+/*============================================================================
+ * Decoded Arguments
+ *============================================================================*/
+
+/**
+ * @brief Decode one member into arg, writing key and text at *text
+ */
+static void args_decode_member(ac_json_span_t key, ac_json_span_t value,
+                               ac_tool_arg_t *arg, char **text) {
+    memset(arg, 0, sizeof(*arg));
+
+    arg->key = *text;
+    *text += ac_json_scan_unescape(key, *text) + 1;
+
+    switch (value.kind) {
+        case AC_JSON_TRUE:
+        case AC_JSON_FALSE:
+            arg->type = AC_TOOL_ARG_BOOL;
+            arg->boolean = value.kind == AC_JSON_TRUE;
+            break;
+        case AC_JSON_NUMBER: {
+            /* Terminated scratch copy for strtod; the space is reused */
+            size_t n = (size_t)(value.end - value.start);
+            memcpy(*text, value.start, n);
+            (*text)[n] = '\0';
+            arg->type = AC_TOOL_ARG_NUMBER;
+            arg->number = strtod(*text, NULL);
+            break;
         }
+        case AC_JSON_STRING:
+            arg->type = AC_TOOL_ARG_STRING;
+            arg->str = *text;
+            arg->len = ac_json_scan_unescape(value, *text);
+            *text += arg->len + 1;
+            break;
+        case AC_JSON_ARRAY:
+        case AC_JSON_OBJECT:
+            arg->type = AC_TOOL_ARG_JSON;
+            arg->str = *text;
+            arg->len = (size_t)(value.end - value.start);
+            memcpy(*text, value.start, arg->len);
+            (*text)[arg->len] = '\0';
+            *text += arg->len + 1;
+            break;
+        default:
+            arg->type = AC_TOOL_ARG_NULL;
+            break;
     }
+}
 
+/* Decoded arguments; small objects fit the stack buffers */
+typedef struct {
+    ac_tool_args_t args;
+    ac_tool_arg_t stack_items[ARGS_STACK_ITEMS];
+    char stack_text[ARGS_STACK_TEXT];
+    void *heap;
+} args_decoded_t;
+
+/**
+ * @brief Decode args (a NUL-terminated JSON object)
+ *
+ * Decoded text never exceeds the source (escapes only shrink), so len + 1
+ * bytes hold every key and value.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG (not a JSON object), ARC_ERR_MEMORY
+ */
+static arc_err_t args_decode(args_decoded_t *d, const char *args, size_t args_len) {
+    d->heap = NULL;
+
+    ac_json_span_t root = ac_json_scan_root(args, args_len);
+    if (root.kind != AC_JSON_OBJECT || !ac_json_scan_valid(args, args_len)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    size_t count = 0;
+    ac_json_iter_t it = ac_json_scan_members(root);
+    while (ac_json_scan_next_member(&it, NULL, NULL)) {
+        count++;
+    }
+
+    ac_tool_arg_t *items = d->stack_items;
+    char *text = d->stack_text;
+
+    if (count > ARGS_STACK_ITEMS || args_len + 1 > ARGS_STACK_TEXT) {
+        d->heap = ARC_MALLOC(count * sizeof(ac_tool_arg_t) + args_len + 1);
+        if (!d->heap) {
+            return ARC_ERR_MEMORY;
+        }
+        items = (ac_tool_arg_t *)d->heap;
+        text = (char *)(items + count);
+    }
+
+    ac_json_span_t key, value;
+    size_t n = 0;
+    it = ac_json_scan_members(root);
+    while (n < count && ac_json_scan_next_member(&it, &key, &value)) {
+        args_decode_member(key, value, &items[n++], &text);
+    }
+
+    d->args.items = items;
+    d->args.count = n;
+    return ARC_OK;
+}
+
+static void args_release(args_decoded_t *d) {
+    if (d->heap) {
+        ARC_FREE(d->heap);
+    }
+}
+
+/**
+ * @brief Decode args and call fn
+ */
+static char *args_call(ac_tool_args_fn fn, const ac_tool_ctx_t *ctx,
+                       const char *args, size_t args_len, void *priv, int *invalid) {
+    args_decoded_t decoded;
+    arc_err_t err = args_decode(&decoded, args, args_len);
+    if (err == ARC_ERR_INVALID_ARG) {
+        *invalid = 1;
+        return NULL;
+    }
+    if (err != ARC_OK) {
+        return ARC_STRDUP("{\"error\":\"Out of memory\"}");
+    }
+
+    char *result = fn(ctx, &decoded.args, priv);
+    args_release(&decoded);
+    return result;
+}
+
+int ac_tool_ctx_cancelled(const ac_tool_ctx_t *ctx) {
+    if (!ctx) {
+        return 0;
+    }
+    if (ctx->cancel && *ctx->cancel) {
+        return 1;
+    }
+    return ctx->deadline_ms && ac_platform_timestamp_ms() >= ctx->deadline_ms;
+}
+
+const ac_tool_arg_t *ac_tool_args_get(const ac_tool_args_t *args, const char *key) {
+    if (!args || !key) {
+        return NULL;
+    }
+    for (size_t i = 0; i < args->count; i++) {
+        if (strcmp(args->items[i].key, key) == 0) {
+            return &args->items[i];
+        }
+    }
     return NULL;
 }
 
-size_t ac_tool_registry_count(const ac_tool_registry_t *registry) {
-    return registry ? registry->count : 0;
+char *ac_tool_args_invoke(
+    ac_tool_args_fn fn,
+    const ac_tool_ctx_t *ctx,
+    const char *args_json,
+    void *priv
+) {
+    if (!fn) {
+        return ARC_STRDUP("{\"error\":\"Tool has no execute function\"}");
+    }
+
+    const char *args = args_json && *args_json ? args_json : "{}";
+    int invalid = 0;
+    char *result = args_call(fn, ctx, args, strlen(args), priv, &invalid);
+    if (invalid) {
+        return ARC_STRDUP("{\"error\":\"Invalid JSON arguments\"}");
+    }
+    return result;
+}
+
+/*============================================================================
+ * Result Writer
+ *============================================================================*/
+
+struct ac_tool_out {
+    ac_json_writer_t w;
+};
+
+void ac_tool_out_object_begin(ac_tool_out_t *out) { ac_json_write_object_begin(&out->w); }
+void ac_tool_out_object_end(ac_tool_out_t *out) { ac_json_write_object_end(&out->w); }
+void ac_tool_out_array_begin(ac_tool_out_t *out) { ac_json_write_array_begin(&out->w); }
+void ac_tool_out_array_end(ac_tool_out_t *out) { ac_json_write_array_end(&out->w); }
+void ac_tool_out_key(ac_tool_out_t *out, const char *key) { ac_json_write_key(&out->w, key); }
+void ac_tool_out_string(ac_tool_out_t *out, const char *s) { ac_json_write_string(&out->w, s); }
+void ac_tool_out_int(ac_tool_out_t *out, long long v) { ac_json_write_int(&out->w, v); }
+void ac_tool_out_double(ac_tool_out_t *out, double v) { ac_json_write_double(&out->w, v); }
+void ac_tool_out_bool(ac_tool_out_t *out, int v) { ac_json_write_bool(&out->w, v); }
+void ac_tool_out_null(ac_tool_out_t *out) { ac_json_write_null(&out->w); }
+
+void ac_tool_out_raw(ac_tool_out_t *out, const char *json, size_t len) {
+    ac_json_write_raw(&out->w, json, len);
+}
+
+/**
+ * @brief Decode args and have fn write its result (into arena, NULL = heap)
+ */
+static char *args_write(ac_tool_write_fn fn, const ac_tool_ctx_t *ctx,
+                        const char *args, size_t args_len, void *priv,
+                        arena_t *arena, int *invalid) {
+    args_decoded_t decoded;
+    arc_err_t err = args_decode(&decoded, args, args_len);
+    if (err == ARC_ERR_INVALID_ARG) {
+        *invalid = 1;
+        return NULL;
+    }
+    if (err != ARC_OK) {
+        return NULL;
+    }
+
+    ac_tool_out_t out;
+    ac_json_writer_init(&out.w, arena);
+    fn(ctx, &decoded.args, &out, priv);
+    args_release(&decoded);
+
+    /* NULL (and nothing to free) on error or an incomplete document */
+    return ac_json_writer_take(&out.w);
+}
+
+char *ac_tool_args_write(
+    ac_tool_write_fn fn,
+    const ac_tool_ctx_t *ctx,
+    const char *args_json,
+    void *priv
+) {
+    if (!fn) {
+        return ARC_STRDUP("{\"error\":\"Tool has no execute function\"}");
+    }
+
+    const char *args = args_json && *args_json ? args_json : "{}";
+    int invalid = 0;
+    char *result = args_write(fn, ctx, args, strlen(args), priv, NULL, &invalid);
+    if (invalid) {
+        return ARC_STRDUP("{\"error\":\"Invalid JSON arguments\"}");
+    }
+    return result;
 }
 
 /*============================================================================
  * Tool Execution
  *============================================================================*/
 
-char *ac_tool_registry_call(
-    ac_tool_registry_t *registry,
-    const char *name,
+/* Forward declaration - large result spilling (tool_spill.c) */
+extern char *ac_tool_spill_apply(ac_tool_registry_t *registry, const ac_tool_t *tool,
+                                 char *result);
+
+/*============================================================================
+ * Tool Usage
+ *============================================================================*/
+
+#ifdef ARC_THREAD_LOCAL
+static ARC_THREAD_LOCAL const ac_tool_ctx_t *t_ctx;  /* Of the call on this thread */
+#endif
+
+const ac_tool_ctx_t *ac_tool_current_ctx(void) {
+#ifdef ARC_THREAD_LOCAL
+    return t_ctx;
+#else
+    return NULL;
+#endif
+}
+
+void ac_tool_report_usage(const ac_tool_usage_t *usage) {
+#ifdef ARC_THREAD_LOCAL
+    ac_tool_usage_t *sum = t_ctx ? t_ctx->usage : NULL;
+    if (!sum || !usage) {
+        return;
+    }
+    sum->processes += usage->processes;
+    sum->cpu_usec += usage->cpu_usec;
+    sum->io_read_bytes += usage->io_read_bytes;
+    sum->io_write_bytes += usage->io_write_bytes;
+    if (usage->memory_peak > sum->memory_peak) {
+        sum->memory_peak = usage->memory_peak;
+    }
+#else
+    (void)usage;
+#endif
+}
+
+/*============================================================================
+ * Asynchronous Tools
+ *============================================================================*/
+
+typedef void (*tool_call_done_fn)(char *result, void *arg);
+
+struct ac_tool_call {
+    ac_tool_registry_t *registry;    /* Spill the result (NULL = deliver as is) */
+    const ac_tool_t *tool;
+    tool_call_done_fn done;          /* Receives the heap result */
+    void *arg;
+};
+
+void ac_tool_call_complete(ac_tool_call_t *call, char *result) {
+    if (!call) {
+        if (result) ARC_FREE(result);
+        return;
+    }
+
+    if (call->registry && call->registry->spill_state) {
+        result = ac_tool_spill_apply(call->registry, call->tool, result);
+    }
+
+    tool_call_done_fn done = call->done;
+    void *arg = call->arg;
+    ARC_FREE(call);
+    done(result, arg);
+}
+
+/**
+ * @brief Complete with {"<key>": <string or null>}
+ */
+static void call_complete_member(ac_tool_call_t *call, const char *key, const char *value) {
+    ac_json_writer_t w;
+    ac_json_writer_init(&w, NULL);
+    ac_json_write_object_begin(&w);
+    ac_json_write_key(&w, key);
+    ac_json_write_string(&w, value);
+    ac_json_write_object_end(&w);
+    ac_tool_call_complete(call, ac_json_writer_take(&w));
+}
+
+void ac_tool_call_complete_string(ac_tool_call_t *call, const char *value) {
+    call_complete_member(call, "result", value);
+}
+
+void ac_tool_call_fail(ac_tool_call_t *call, const char *message) {
+    call_complete_member(call, "error", message ? message : "Tool failed");
+}
+
+/**
+ * @brief Decode args and start fn; done receives the result exactly once
+ *
+ * Argument and allocation errors are delivered through done as well,
+ * before this returns.
+ */
+static void call_start(ac_tool_async_fn fn, const ac_tool_ctx_t *ctx,
+                       const char *args, size_t args_len, void *priv,
+                       ac_tool_registry_t *registry, const ac_tool_t *tool,
+                       tool_call_done_fn done, void *arg) {
+    args_decoded_t decoded;
+    arc_err_t err = args_decode(&decoded, args, args_len);
+    if (err != ARC_OK) {
+        done(ARC_STRDUP(err == ARC_ERR_INVALID_ARG ? "{\"error\":\"Invalid JSON arguments\"}"
+                                                   : "{\"error\":\"Out of memory\"}"), arg);
+        return;
+    }
+
+    ac_tool_call_t *call = (ac_tool_call_t *)ARC_MALLOC(sizeof(ac_tool_call_t));
+    if (!call) {
+        args_release(&decoded);
+        done(ARC_STRDUP("{\"error\":\"Out of memory\"}"), arg);
+        return;
+    }
+    call->registry = registry;
+    call->tool = tool;
+    call->done = done;
+    call->arg = arg;
+
+    fn(ctx, &decoded.args, call, priv);
+    args_release(&decoded);
+}
+
+/**
+ * @brief Where a blocking caller waits for the completion
+ */
+typedef struct {
+#ifdef ARC_HAS_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+    int done;
+    char *result;
+} call_waiter_t;
+
+static void call_waiter_done(char *result, void *arg) {
+    call_waiter_t *waiter = (call_waiter_t *)arg;
+#ifdef ARC_HAS_THREADS
+    pthread_mutex_lock(&waiter->lock);
+    waiter->result = result;
+    waiter->done = 1;
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->lock);
+#else
+    waiter->result = result;
+    waiter->done = 1;
+#endif
+}
+
+/**
+ * @brief Start fn and block until it completes
+ */
+static char *call_await(ac_tool_async_fn fn, const ac_tool_ctx_t *ctx,
+                        const char *args, size_t args_len, void *priv) {
+    call_waiter_t waiter = { 0 };
+
+#ifdef ARC_HAS_THREADS
+    if (pthread_mutex_init(&waiter.lock, NULL) != 0) {
+        return ARC_STRDUP("{\"error\":\"Out of memory\"}");
+    }
+    if (pthread_cond_init(&waiter.cond, NULL) != 0) {
+        pthread_mutex_destroy(&waiter.lock);
+        return ARC_STRDUP("{\"error\":\"Out of memory\"}");
+    }
+
+    call_start(fn, ctx, args, args_len, priv, NULL, NULL, call_waiter_done, &waiter);
+
+    pthread_mutex_lock(&waiter.lock);
+    while (!waiter.done) {
+        pthread_cond_wait(&waiter.cond, &waiter.lock);
+    }
+    pthread_mutex_unlock(&waiter.lock);
+
+    pthread_cond_destroy(&waiter.cond);
+    pthread_mutex_destroy(&waiter.lock);
+#else
+    call_start(fn, ctx, args, args_len, priv, NULL, NULL, call_waiter_done, &waiter);
+    if (!waiter.done) {
+        /* Nothing else could complete it later */
+        AC_LOG_ERROR("Asynchronous tool did not complete before returning");
+        return ARC_STRDUP("{\"error\":\"Tool did not complete\"}");
+    }
+#endif
+
+    return waiter.result;
+}
+
+char *ac_tool_args_await(
+    ac_tool_async_fn fn,
+    const ac_tool_ctx_t *ctx,
     const char *args_json,
-    const ac_tool_ctx_t *ctx
+    void *priv
 ) {
+    if (!fn) {
+        return ARC_STRDUP("{\"error\":\"Tool has no execute function\"}");
+    }
+
+    const char *args = args_json && *args_json ? args_json : "{}";
+    return call_await(fn, ctx, args, strlen(args), priv);
+}
+
+/**
+ * @brief Run a tool's execute function on checked arguments
+ *
+ * Writer tools write into arena when one is given (*in_arena set); every
+ * other result is on the heap.
+ */
+static char *tool_execute(const ac_tool_t *tool, const char *name, const ac_tool_ctx_t *ctx,
+                          const char *args, size_t args_len, arena_t *arena, int *in_arena) {
+    char *result;
+
+    if (tool->execute_write) {
+        int invalid = 0;
+        result = args_write(tool->execute_write, ctx, args, args_len, tool->priv,
+                            arena, &invalid);
+        if (invalid) {
+            AC_LOG_WARN("Tool %s: arguments are not a JSON object", name);
+            return ARC_STRDUP("{\"error\":\"Invalid JSON arguments\"}");
+        }
+        *in_arena = arena && result;
+    } else if (tool->execute_args) {
+        int invalid = 0;
+        result = args_call(tool->execute_args, ctx, args, args_len, tool->priv, &invalid);
+        if (invalid) {
+            AC_LOG_WARN("Tool %s: arguments are not a JSON object", name);
+            return ARC_STRDUP("{\"error\":\"Invalid JSON arguments\"}");
+        }
+    } else if (tool->execute_async) {
+        result = call_await(tool->execute_async, ctx, args, args_len, tool->priv);
+    } else if (tool->parse_args) {
+        /* Parsed once here, in a scratch arena released after the call */
+        ac_cjson_scope_t scope;
+        ac_cjson_scope_begin(&scope, NULL);
+        cJSON *parsed = ac_cjson_scope_parse(&scope, args, args_len);
+        if (!parsed) {
+            ac_cjson_scope_end(&scope);
+            AC_LOG_WARN("Tool %s: arguments are not valid JSON", name);
+            return ARC_STRDUP("{\"error\":\"Invalid JSON arguments\"}");
+        }
+
+        ac_tool_ctx_t call_ctx = { 0 };
+        if (ctx) {
+            call_ctx = *ctx;
+        }
+        call_ctx.args = parsed;
+        result = tool->execute(&call_ctx, args, tool->priv);
+
+        cJSON_Delete(parsed);
+        ac_cjson_scope_end(&scope);
+    } else {
+        if (!ac_json_scan_valid(args, args_len)) {
+            AC_LOG_WARN("Tool %s: arguments are not valid JSON", name);
+            return ARC_STRDUP("{\"error\":\"Invalid JSON arguments\"}");
+        }
+        result = tool->execute(ctx, args, tool->priv);
+    }
+    return result;
+}
+
+/**
+ * @brief Shared body of the call entry points
+ *
+ * @param arena     Where writer tools put the result (NULL = heap)
+ * @param in_arena  Out: the result is in arena rather than on the heap
+ */
+static char *registry_call(ac_tool_registry_t *registry, const char *name,
+                           const char *args_json, const ac_tool_ctx_t *ctx,
+                           arena_t *arena, int *in_arena) {
+    *in_arena = 0;
     if (!registry || !name) {
         return ARC_STRDUP("{\"error\":\"Invalid arguments\"}");
     }
@@ -233,101 +1281,325 @@ char *ac_tool_registry_call(
         return err;
     }
 
-    if (!tool->execute) {
+    if (!tool->execute && !tool->execute_args && !tool->execute_write && !tool->execute_async) {
         AC_LOG_ERROR("Tool '%s' has no execute function", name);
         return ARC_STRDUP("{\"error\":\"Tool has no execute function\"}");
     }
 
     AC_LOG_INFO("Executing tool: %s", name);
 
-    const char *args = args_json ? args_json : "{}";
-    char *result = tool->execute(ctx, args, tool->priv);
+    const char *args = args_json && *args_json ? args_json : "{}";
+
+    /* Spilling takes the result over as a heap string */
+    arena_t *direct = registry->spill_state ? NULL : arena;
+
+#ifdef ARC_THREAD_LOCAL
+    /* Tool calls can nest (a tool calling a sub-agent) */
+    const ac_tool_ctx_t *outer_ctx = t_ctx;
+    t_ctx = ctx;
+#endif
+    char *result = tool_execute(tool, name, ctx, args, strlen(args), direct, in_arena);
+#ifdef ARC_THREAD_LOCAL
+    t_ctx = outer_ctx;
+#endif
 
     AC_LOG_DEBUG("Tool %s returned: %.100s%s",
                  name,
                  result ? result : "NULL",
                  (result && strlen(result) > 100) ? "..." : "");
 
+    if (registry->spill_state) {
+        result = ac_tool_spill_apply(registry, tool, result);
+    }
+
     return result ? result : ARC_STRDUP("{\"error\":\"Tool returned NULL\"}");
 }
 
-/*============================================================================
- * Schema Generation
- *============================================================================*/
+char *ac_tool_registry_call(
+    ac_tool_registry_t *registry,
+    const char *name,
+    const char *args_json,
+    const ac_tool_ctx_t *ctx
+) {
+    int in_arena;
+    return registry_call(registry, name, args_json, ctx, NULL, &in_arena);
+}
+
+/**
+ * @brief Call a tool with the result placed in arena (internal, for agent.c)
+ *
+ * Writer tools serialize straight into arena; any other result is copied
+ * in. Only for the thread that owns arena.
+ *
+ * @return Result in arena, NULL if out of memory
+ */
+char *ac_tool_registry_call_into(
+    ac_tool_registry_t *registry,
+    const char *name,
+    const char *args_json,
+    const ac_tool_ctx_t *ctx,
+    arena_t *arena
+) {
+    int in_arena;
+    char *result = registry_call(registry, name, args_json, ctx, arena, &in_arena);
+    if (in_arena) {
+        return result;
+    }
+    char *copy = arena_strdup(arena, result);
+    ARC_FREE(result);
+    return copy;
+}
+
+/**
+ * @brief Start a tool without waiting for it (internal, for agent.c)
+ *
+ * Asynchronous tools are started here and complete later, possibly on
+ * another thread; any other tool runs here. Either way done receives the
+ * heap result (NULL if the tool returned NULL) exactly once.
+ */
+void ac_tool_registry_call_async(
+    ac_tool_registry_t *registry,
+    const char *name,
+    const char *args_json,
+    const ac_tool_ctx_t *ctx,
+    void (*done)(char *result, void *arg),
+    void *arg
+) {
+    const ac_tool_t *tool = registry && name ? ac_tool_registry_find(registry, name) : NULL;
+    if (!tool || !tool->execute_async) {
+        int in_arena;
+        done(registry_call(registry, name, args_json, ctx, NULL, &in_arena), arg);
+        return;
+    }
+
+    AC_LOG_INFO("Starting tool: %s", name);
+
+    const char *args = args_json && *args_json ? args_json : "{}";
+
+#ifdef ARC_THREAD_LOCAL
+    const ac_tool_ctx_t *outer_ctx = t_ctx;
+    t_ctx = ctx;
+#endif
+    call_start(tool->execute_async, ctx, args, strlen(args), tool->priv,
+               registry, tool, done, arg);
+#ifdef ARC_THREAD_LOCAL
+    t_ctx = outer_ctx;
+#endif
+}
 
 /*============================================================================
- * Internal API (for tool_mcp.c)
+ * Internal API (for tool_mcp.c, tool_spill.c)
  *============================================================================*/
 
 arena_t *ac_tool_registry_get_arena(const ac_tool_registry_t *registry) {
     return registry ? registry->arena : NULL;
 }
 
+void **ac_tool_registry_mcp_state(ac_tool_registry_t *registry) {
+    return registry ? &registry->mcp_state : NULL;
+}
+
+void **ac_tool_registry_spill_state(ac_tool_registry_t *registry) {
+    return registry ? &registry->spill_state : NULL;
+}
+
+/* Forward declaration - MCP integration (tool_mcp.c) */
+extern void ac_tool_registry_mcp_cleanup(ac_tool_registry_t *registry);
+
+/**
+ * @brief Release what the registry holds outside the arena (called by session)
+ */
+void ac_tool_registry_cleanup(ac_tool_registry_t *registry) {
+    if (!registry) {
+        return;
+    }
+#if ARC_FEATURE_MCP
+    if (registry->mcp_state) {
+        ac_tool_registry_mcp_cleanup(registry);
+    }
+#endif
+    pthread_mutex_destroy(&registry->write_lock);
+}
+
 /*============================================================================
  * Schema Generation
  *============================================================================*/
 
-char *ac_tool_registry_schema(const ac_tool_registry_t *registry) {
-    if (!registry || registry->count == 0) {
-        return NULL;
+/**
+ * @brief Parse a tool's parameters, falling back to an empty object schema
+ */
+static cJSON *tool_parameters_json(const ac_tool_t *tool) {
+    const char *params_str = tool->parameters ?
+        tool->parameters : "{\"type\":\"object\",\"properties\":{}}";
+    cJSON *params = cJSON_Parse(params_str);
+    if (params) {
+        return params;
     }
 
-    /* Use cJSON for safe JSON construction */
-    cJSON *array = cJSON_CreateArray();
-    if (!array) {
-        AC_LOG_ERROR("Failed to create JSON array");
+    cJSON *empty_params = cJSON_CreateObject();
+    cJSON_AddStringToObject(empty_params, "type", "object");
+    cJSON_AddItemToObject(empty_params, "properties", cJSON_CreateObject());
+    return empty_params;
+}
+
+/**
+ * @brief Serialize one tool's entry of the tools array (cJSON_free)
+ *
+ * OpenAI:    {"type":"function","function":{"name":...,"description":...,"parameters":{...}}}
+ * Anthropic: {"name":...,"description":...,"input_schema":{...}}
+ */
+static char *tool_schema_entry(const ac_tool_t *tool, ac_tool_schema_format_t format) {
+    cJSON *tool_obj = cJSON_CreateObject();
+    if (!tool_obj) {
         return NULL;
     }
 
-    for (size_t i = 0; i < registry->count; i++) {
-        const ac_tool_t *tool = &registry->tools[i];
-
-        /* Create tool object */
-        cJSON *tool_obj = cJSON_CreateObject();
-        if (!tool_obj) {
-            cJSON_Delete(array);
+    cJSON *target = tool_obj;
+    if (format == AC_TOOL_SCHEMA_OPENAI) {
+        cJSON_AddStringToObject(tool_obj, "type", "function");
+        target = cJSON_AddObjectToObject(tool_obj, "function");
+        if (!target) {
+            cJSON_Delete(tool_obj);
             return NULL;
         }
+    }
 
-        cJSON_AddStringToObject(tool_obj, "type", "function");
+    cJSON_AddStringToObject(target, "name", tool->name);
+    cJSON_AddStringToObject(target, "description",
+                            tool->description ? tool->description : "");
+    cJSON_AddItemToObject(target,
+                          format == AC_TOOL_SCHEMA_OPENAI ? "parameters" : "input_schema",
+                          tool_parameters_json(tool));
 
-        /* Create function object */
-        cJSON *func_obj = cJSON_CreateObject();
-        if (!func_obj) {
-            cJSON_Delete(tool_obj);
-            cJSON_Delete(array);
-            return NULL;
+    char *result = cJSON_PrintUnformatted(tool_obj);
+    cJSON_Delete(tool_obj);
+    return result;
+}
+
+/**
+ * @brief Build the tools array for a format (heap string, ARC_FREE)
+ *
+ * Entries MOC serialized ahead of time are copied as is; only the others
+ * go through cJSON.
+ */
+static char *build_schema(const registry_snapshot_t *snap, ac_tool_schema_format_t format) {
+    ac_strbuf_t sb = AC_STRBUF_INIT;
+    arc_err_t err = ac_strbuf_append(&sb, "[", 1);
+    size_t emitted = 0;
+
+    size_t total = snap->count + snap->table_tools;
+    for (size_t i = 0; i < total && err == ARC_OK; i++) {
+        const ac_tool_t *tool = snapshot_tool_at(snap, i);
+        if (tool->deferred) {
+            continue;
+        }
+        if (emitted++ > 0) {
+            err = ac_strbuf_append(&sb, ",", 1);
         }
 
-        cJSON_AddStringToObject(func_obj, "name", tool->name);
-        cJSON_AddStringToObject(func_obj, "description",
-                                tool->description ? tool->description : "");
-
-        /* Parse parameters JSON and add as object */
-        const char *params_str = tool->parameters ?
-            tool->parameters : "{\"type\":\"object\",\"properties\":{}}";
-        cJSON *params = cJSON_Parse(params_str);
-        if (params) {
-            cJSON_AddItemToObject(func_obj, "parameters", params);
-        } else {
-            /* Fallback: add empty parameters */
-            cJSON *empty_params = cJSON_CreateObject();
-            cJSON_AddStringToObject(empty_params, "type", "object");
-            cJSON_AddItemToObject(empty_params, "properties", cJSON_CreateObject());
-            cJSON_AddItemToObject(func_obj, "parameters", empty_params);
+        const char *entry = (format == AC_TOOL_SCHEMA_ANTHROPIC) ?
+            tool->schema_anthropic : tool->schema_openai;
+        if (entry) {
+            if (err == ARC_OK) {
+                err = ac_strbuf_append(&sb, entry, strlen(entry));
+            }
+            continue;
         }
 
-        cJSON_AddItemToObject(tool_obj, "function", func_obj);
-        cJSON_AddItemToArray(array, tool_obj);
+        char *built = tool_schema_entry(tool, format);
+        if (!built) {
+            err = ARC_ERR_MEMORY;
+            break;
+        }
+        if (err == ARC_OK) {
+            err = ac_strbuf_append(&sb, built, strlen(built));
+        }
+        cJSON_free(built);
     }
 
-    char *result = cJSON_PrintUnformatted(array);
-    cJSON_Delete(array);
+    if (err == ARC_OK) {
+        err = ac_strbuf_append(&sb, "]", 1);
+    }
+    if (err != ARC_OK) {
+        AC_LOG_ERROR("Failed to build tools schema");
+        ac_strbuf_reset(&sb);
+        return NULL;
+    }
+    return ac_strbuf_take(&sb);
+}
 
+char *ac_tool_registry_schema(const ac_tool_registry_t *registry) {
+    if (!registry) {
+        return NULL;
+    }
+
+    const registry_snapshot_t *snap = registry_snapshot(registry);
+    size_t total = snap->count + snap->table_tools;
+    if (total == 0) {
+        return NULL;
+    }
+
+    char *result = build_schema(snap, AC_TOOL_SCHEMA_OPENAI);
     if (result) {
         AC_LOG_DEBUG("Built schema for %zu tools (%zu bytes)",
-                     registry->count, strlen(result));
+                     total, strlen(result));
     }
-
     return result;
 }
+
+const char *ac_tool_registry_schema_cached(
+    ac_tool_registry_t *registry,
+    ac_tool_schema_format_t format
+) {
+    if (!registry || (unsigned)format >= AC_TOOL_SCHEMA_FORMAT_COUNT) {
+        return NULL;
+    }
+
+#if ARC_FEATURE_MCP
+    /* Between requests: pick up MCP lists that changed */
+    if (registry->mcp_state) {
+        ac_tool_registry_sync_mcp(registry);
+    }
+#endif
+
+    registry_snapshot_t *snap = registry_snapshot(registry);
+    if (snap->count + snap->table_tools == 0) {
+        return NULL;
+    }
+
+    const char *cached = atomic_load_explicit(&snap->schema_cache[format], memory_order_acquire);
+    if (cached) {
+        return cached;
+    }
+
+    /* Only a generated table: its array literal is the schema */
+    if (snap->count == 0 && snap->table_count == 1) {
+        const ac_tool_table_t *table = snap->tables[0];
+        const char *literal = (format == AC_TOOL_SCHEMA_ANTHROPIC) ?
+            table->schema_anthropic : table->schema_openai;
+        if (literal) {
+            atomic_store_explicit(&snap->schema_cache[format], literal, memory_order_release);
+            return literal;
+        }
+    }
+
+    /* Built outside the lock; concurrent misses may build it twice */
+    char *json = build_schema(snap, format);
+    if (!json) {
+        return NULL;
+    }
+
+    /* The copy is kept with the snapshot until the session closes */
+    ac_tool_registry_write_lock(registry);
+    cached = atomic_load_explicit(&snap->schema_cache[format], memory_order_relaxed);
+    if (!cached) {
+        cached = arena_strdup(registry->arena, json);
+        atomic_store_explicit(&snap->schema_cache[format], cached, memory_order_release);
+    }
+    ac_tool_registry_write_unlock(registry);
+    ARC_FREE(json);
+
+    AC_LOG_DEBUG("Cached tools schema (format=%d, %zu tools)",
+                 (int)format, snap->count + snap->table_tools);
+    return cached;
+}
@@ -2,52 +2,431 @@
  * @file tool_mcp.c
  * @brief MCP Tool Integration
  *
- * Bridges MCP tools to the unified tool registry.
+ * Bridges MCP tools to the unified tool registry, with an optional result
+ * cache for tools that are safe to answer twice from one call, and an
+ * optional lazy mode that registers stubs for large catalogs.
  */
 
 #include "arc/tool.h"
 #include "arc/mcp.h"
 #include "arc/log.h"
 #include "arc/platform.h"
+#include "pthread_port.h"
+#include "json_scan.h"
+#include "json_writer.h"
+#include "strbuf.h"
 #include <stdlib.h>
 #include <string.h>
 
 /*============================================================================
- * MCP Tool Wrapper Data
+ * Constants
  *============================================================================*/
 
+#define MCP_CACHE_DEFAULT_TTL_MS     300000
+#define MCP_CACHE_DEFAULT_ENTRIES    256
+#define MCP_CACHE_DEFAULT_BYTES      (4 * 1024 * 1024)
+#define MCP_CACHE_BUCKETS            64        /* Power of two */
+#define MCP_CACHE_MAX_KEY            (16 * 1024) /* Larger arguments bypass the cache */
+
+#define MCP_LOADER_NAME              "load_tools"
+#define MCP_SUMMARY_MAX              100       /* Stub description length */
+
+/*============================================================================
+ * Result Cache
+ *
+ * One per client and registry. Entries sit in a hash on the key and in an
+ * LRU list; lookups past their TTL drop them, inserts evict from the cold
+ * end until both limits hold. Tools run concurrently, so every access
+ * takes the cache mutex; results are copied out, never shared.
+ *============================================================================*/
+
+typedef struct mcp_cache_entry {
+    uint64_t hash;
+    char *key;                       /* "<tool>\n<canonical args>" */
+    char *result;
+    size_t size;                     /* Bytes of key and result */
+    uint64_t expires_ms;
+    struct mcp_cache_entry *chain;   /* Bucket chain */
+    struct mcp_cache_entry *prev;    /* LRU, most recent first */
+    struct mcp_cache_entry *next;
+} mcp_cache_entry_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    mcp_cache_entry_t *buckets[MCP_CACHE_BUCKETS];
+    mcp_cache_entry_t *head;
+    mcp_cache_entry_t *tail;
+    size_t count;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+} mcp_result_cache_t;
+
+/**
+ * @brief A client whose tools are in the registry
+ */
+typedef struct mcp_source {
+    ac_mcp_client_t *client;
+    unsigned generation;             /* Tool list generation registered */
+    mcp_result_cache_t cache;        /* Used when the registry caches results */
+    struct mcp_source *next;
+} mcp_source_t;
+
+struct mcp_wrapper_data;
+
+/**
+ * @brief MCP state of a registry (arena, via ac_tool_registry_mcp_state)
+ */
 typedef struct {
+    ac_tool_registry_t *registry;
+    mcp_source_t *sources;
+    int cache_enabled;
+    uint32_t ttl_ms;
+    size_t max_entries;
+    size_t max_bytes;
+    int ignore_annotations;
+    char **cache_tools;              /* NULL-terminated, NULL = none */
+
+    /* Lazy stubs. Tools mark themselves for loading while running; the
+     * loads are applied by ac_tool_registry_sync_mcp() between requests. */
+    int lazy;
+    int loader_added;
+    struct mcp_wrapper_data *stubs;
+    volatile int loads_pending;
+} mcp_registry_state_t;
+
+static uint64_t cache_hash(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static void cache_init(mcp_result_cache_t *cache) {
+    memset(cache, 0, sizeof(*cache));
+    pthread_mutex_init(&cache->lock, NULL);
+}
+
+/**
+ * @brief Unlink and free an entry (caller holds lock)
+ */
+static void cache_remove(mcp_result_cache_t *cache, mcp_cache_entry_t *e) {
+    mcp_cache_entry_t **link = &cache->buckets[e->hash & (MCP_CACHE_BUCKETS - 1)];
+    while (*link != e) {
+        link = &(*link)->chain;
+    }
+    *link = e->chain;
+
+    if (e->prev) e->prev->next = e->next; else cache->head = e->next;
+    if (e->next) e->next->prev = e->prev; else cache->tail = e->prev;
+
+    cache->count--;
+    cache->bytes -= e->size;
+
+    ARC_FREE(e->key);
+    ARC_FREE(e->result);
+    ARC_FREE(e);
+}
+
+/**
+ * @brief Drop every entry (caller holds lock)
+ */
+static void cache_clear(mcp_result_cache_t *cache) {
+    while (cache->head) {
+        cache_remove(cache, cache->head);
+    }
+}
+
+/**
+ * @brief Copy of a live cached result, NULL on a miss
+ */
+static char *cache_get(mcp_result_cache_t *cache, const char *key, size_t key_len) {
+    uint64_t hash = cache_hash(key, key_len);
+    uint64_t now = ac_platform_timestamp_ms();
+    char *result = NULL;
+
+    pthread_mutex_lock(&cache->lock);
+
+    mcp_cache_entry_t *e = cache->buckets[hash & (MCP_CACHE_BUCKETS - 1)];
+    while (e && (e->hash != hash || strcmp(e->key, key) != 0)) {
+        e = e->chain;
+    }
+
+    if (e && now >= e->expires_ms) {
+        cache_remove(cache, e);
+        e = NULL;
+    }
+
+    if (e) {
+        /* Move to the front of the LRU list */
+        if (e != cache->head) {
+            e->prev->next = e->next;
+            if (e->next) e->next->prev = e->prev; else cache->tail = e->prev;
+            e->prev = NULL;
+            e->next = cache->head;
+            cache->head->prev = e;
+            cache->head = e;
+        }
+        result = ARC_STRDUP(e->result);
+    }
+
+    if (result) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+    return result;
+}
+
+/**
+ * @brief Store a copy of result, evicting cold entries to fit
+ */
+static void cache_put(mcp_result_cache_t *cache, const mcp_registry_state_t *state,
+                      const char *key, size_t key_len, const char *result) {
+    size_t size = key_len + strlen(result) + 2;
+    if (size > state->max_bytes) {
+        return;
+    }
+
+    mcp_cache_entry_t *e = (mcp_cache_entry_t *)ARC_MALLOC(sizeof(mcp_cache_entry_t));
+    if (!e) return;
+
+    e->hash = cache_hash(key, key_len);
+    e->key = ARC_STRDUP(key);
+    e->result = ARC_STRDUP(result);
+    e->size = size;
+    e->expires_ms = ac_platform_timestamp_ms() + state->ttl_ms;
+    if (!e->key || !e->result) {
+        ARC_FREE(e->key);
+        ARC_FREE(e->result);
+        ARC_FREE(e);
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+
+    /* A concurrent identical call may have stored it first: replace */
+    mcp_cache_entry_t **bucket = &cache->buckets[e->hash & (MCP_CACHE_BUCKETS - 1)];
+    for (mcp_cache_entry_t *old = *bucket; old; old = old->chain) {
+        if (old->hash == e->hash && strcmp(old->key, e->key) == 0) {
+            cache_remove(cache, old);
+            break;
+        }
+    }
+
+    while (cache->tail &&
+           (cache->count >= state->max_entries || cache->bytes + size > state->max_bytes)) {
+        cache_remove(cache, cache->tail);
+    }
+
+    e->chain = *bucket;
+    *bucket = e;
+    e->prev = NULL;
+    e->next = cache->head;
+    if (cache->head) cache->head->prev = e; else cache->tail = e;
+    cache->head = e;
+    cache->count++;
+    cache->bytes += size;
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/*============================================================================
+ * Argument Canonicalization
+ *============================================================================*/
+
+typedef struct {
+    ac_json_span_t key;
+    ac_json_span_t value;
+} canon_member_t;
+
+static int canon_member_cmp(const void *a, const void *b) {
+    const ac_json_span_t *ka = &((const canon_member_t *)a)->key;
+    const ac_json_span_t *kb = &((const canon_member_t *)b)->key;
+    size_t la = (size_t)(ka->end - ka->start);
+    size_t lb = (size_t)(kb->end - kb->start);
+    int c = memcmp(ka->start, kb->start, la < lb ? la : lb);
+    return c ? c : (la > lb) - (la < lb);
+}
+
+/**
+ * @brief Append value with object keys sorted and whitespace dropped
+ *
+ * Keys compare by their raw bytes; strings and numbers are kept as
+ * written, so equal arguments spelled differently only miss.
+ */
+static int canon_append(ac_strbuf_t *sb, ac_json_span_t value) {
+    if (value.kind == AC_JSON_OBJECT) {
+        size_t n = 0;
+        ac_json_iter_t it = ac_json_scan_members(value);
+        while (ac_json_scan_next_member(&it, NULL, NULL)) {
+            n++;
+        }
+
+        canon_member_t *members = (canon_member_t *)ARC_MALLOC(
+            sizeof(canon_member_t) * (n ? n : 1));
+        if (!members) return 0;
+
+        size_t filled = 0;
+        it = ac_json_scan_members(value);
+        while (filled < n &&
+               ac_json_scan_next_member(&it, &members[filled].key, &members[filled].value)) {
+            filled++;
+        }
+        qsort(members, filled, sizeof(canon_member_t), canon_member_cmp);
+
+        int ok = ac_strbuf_append(sb, "{", 1) == ARC_OK;
+        for (size_t i = 0; i < filled && ok; i++) {
+            const ac_json_span_t *k = &members[i].key;
+            ok = (i == 0 || ac_strbuf_append(sb, ",", 1) == ARC_OK) &&
+                 ac_strbuf_append(sb, k->start, (size_t)(k->end - k->start)) == ARC_OK &&
+                 ac_strbuf_append(sb, ":", 1) == ARC_OK &&
+                 canon_append(sb, members[i].value);
+        }
+        ARC_FREE(members);
+        return ok && ac_strbuf_append(sb, "}", 1) == ARC_OK;
+    }
+
+    if (value.kind == AC_JSON_ARRAY) {
+        int ok = ac_strbuf_append(sb, "[", 1) == ARC_OK;
+        for (size_t i = 0; ok; i++) {
+            ac_json_span_t item = ac_json_scan_index(value, i);
+            if (item.kind == AC_JSON_NONE) break;
+            ok = (i == 0 || ac_strbuf_append(sb, ",", 1) == ARC_OK) &&
+                 canon_append(sb, item);
+        }
+        return ok && ac_strbuf_append(sb, "]", 1) == ARC_OK;
+    }
+
+    if (value.kind == AC_JSON_NONE) {
+        return 0;
+    }
+    return ac_strbuf_append(sb, value.start, (size_t)(value.end - value.start)) == ARC_OK;
+}
+
+/**
+ * @brief Cache key for a call, NULL if the arguments are not cacheable
+ */
+static char *cache_key(const char *tool_name, const char *args_json, size_t *key_len) {
+    size_t args_len = strlen(args_json);
+    if (args_len > MCP_CACHE_MAX_KEY || !ac_json_scan_valid(args_json, args_len)) {
+        return NULL;
+    }
+
+    ac_strbuf_t sb = AC_STRBUF_INIT;
+    if (ac_strbuf_append(&sb, tool_name, strlen(tool_name)) != ARC_OK ||
+        ac_strbuf_append(&sb, "\n", 1) != ARC_OK ||
+        !canon_append(&sb, ac_json_scan_root(args_json, args_len))) {
+        ac_strbuf_reset(&sb);
+        return NULL;
+    }
+
+    *key_len = sb.len;
+    return ac_strbuf_take(&sb);
+}
+
+/*============================================================================
+ * MCP Tool Wrapper Data
+ *============================================================================*/
+
+typedef struct mcp_wrapper_data {
     ac_mcp_client_t *client;
     char *tool_name;
+    mcp_source_t *cached;            /* Source whose cache holds results (NULL = off) */
+    mcp_registry_state_t *state;
+    int deferred;                    /* Registered as a stub, not loaded yet */
+    volatile int load_requested;
+    const char *summary;             /* Stub description */
+    struct mcp_wrapper_data *next_stub;
 } mcp_wrapper_data_t;
 
 /*============================================================================
  * MCP Tool Executor
  *============================================================================*/
 
+typedef struct {
+    const ac_tool_ctx_t *ctx;
+    const char *tool_name;
+} mcp_progress_relay_t;
+
+/**
+ * @brief Forward MCP progress to the tool context's callback
+ */
+static void mcp_tool_progress(const ac_mcp_progress_t *progress, void *user_data) {
+    const mcp_progress_relay_t *relay = (const mcp_progress_relay_t *)user_data;
+    ac_tool_progress_t tp = {
+        .tool_name = relay->tool_name,
+        .progress = progress->progress,
+        .total = progress->total,
+        .message = progress->message,
+        .message_len = progress->message_len
+    };
+    relay->ctx->on_progress(&tp, relay->ctx->progress_user_data);
+}
+
 /**
  * @brief Execute an MCP tool
  *
  * This function is called when an MCP tool is invoked through the registry.
- * It proxies the call to the MCP server.
+ * It proxies the call to the MCP server, or answers from the result cache.
  */
 static char *mcp_tool_execute(
     const ac_tool_ctx_t *ctx,
     const char *args_json,
     void *priv
 ) {
-    (void)ctx;  /* MCP doesn't use local context */
-
     mcp_wrapper_data_t *data = (mcp_wrapper_data_t *)priv;
     if (!data || !data->client || !data->tool_name) {
         return ARC_STRDUP("{\"error\":\"Invalid MCP tool data\"}");
     }
 
+    const char *args = args_json ? args_json : "{}";
+
+    /* Called without being loaded: send its schema from now on */
+    if (data->deferred && !data->load_requested) {
+        data->load_requested = 1;
+        data->state->loads_pending = 1;
+    }
+
+    char *key = NULL;
+    size_t key_len = 0;
+    if (data->cached) {
+        key = cache_key(data->tool_name, args, &key_len);
+    }
+
+    if (key) {
+        char *hit = cache_get(&data->cached->cache, key, key_len);
+        if (ctx && ctx->cache_status) {
+            *ctx->cache_status = hit ? AC_TOOL_CACHE_HIT : AC_TOOL_CACHE_MISS;
+        }
+        if (hit) {
+            AC_LOG_DEBUG("MCP tool %s: result from cache", data->tool_name);
+            ARC_FREE(key);
+            return hit;
+        }
+    }
+
+    mcp_progress_relay_t relay = { ctx, data->tool_name };
+    ac_mcp_call_opts_t opts = { 0 };
+    if (ctx && ctx->on_progress) {
+        opts.on_progress = mcp_tool_progress;
+        opts.user_data = &relay;
+    }
+    if (ctx) {
+        opts.cancel = ctx->cancel;
+        opts.deadline_ms = ctx->deadline_ms;
+    }
+
     char *result = NULL;
-    arc_err_t err = ac_mcp_call_tool(
+    arc_err_t err = ac_mcp_call_tool_ex(
         data->client,
         data->tool_name,
-        args_json ? args_json : "{}",
+        args,
+        &opts,
         &result
     );
 
@@ -56,8 +435,11 @@ static char *mcp_tool_execute(
         if (!result) {
             result = ARC_STRDUP("{\"error\":\"MCP tool call failed\"}");
         }
+    } else if (key && result) {
+        cache_put(&data->cached->cache, data->state, key, key_len, result);
     }
 
+    ARC_FREE(key);
     return result;
 }
 
@@ -65,30 +447,300 @@ static char *mcp_tool_execute(
  * Registry Integration
  *============================================================================*/
 
-/* Forward declaration - get arena from registry */
+/* Forward declarations - registry internals (tool.c) */
 extern arena_t *ac_tool_registry_get_arena(const ac_tool_registry_t *registry);
-
-arc_err_t ac_tool_registry_add_mcp(
+extern void **ac_tool_registry_mcp_state(ac_tool_registry_t *registry);
+extern size_t ac_tool_registry_remove_if(
     ac_tool_registry_t *registry,
-    ac_mcp_client_t *client
+    int (*match)(const ac_tool_t *tool, void *arg),
+    void *arg
+);
+extern void ac_tool_registry_write_lock(ac_tool_registry_t *registry);
+extern int ac_tool_registry_write_trylock(ac_tool_registry_t *registry);
+extern void ac_tool_registry_write_unlock(ac_tool_registry_t *registry);
+extern arc_err_t ac_tool_registry_add_locked(ac_tool_registry_t *registry,
+                                             const ac_tool_t *tool);
+extern arc_err_t ac_tool_registry_update_schema_locked(ac_tool_registry_t *registry,
+                                                       const char *name,
+                                                       const char *description,
+                                                       const char *parameters);
+
+/**
+ * @brief The registry's MCP state, created on first use
+ */
+static mcp_registry_state_t *registry_state(ac_tool_registry_t *registry, arena_t *arena) {
+    mcp_registry_state_t **slot = (mcp_registry_state_t **)ac_tool_registry_mcp_state(registry);
+    if (!*slot) {
+        mcp_registry_state_t *state = (mcp_registry_state_t *)arena_alloc(
+            arena, sizeof(mcp_registry_state_t));
+        if (!state) {
+            AC_LOG_ERROR("Failed to allocate MCP registry state");
+            return NULL;
+        }
+        memset(state, 0, sizeof(*state));
+        state->registry = registry;
+        *slot = state;
+    }
+    return *slot;
+}
+
+/*============================================================================
+ * Lazy Stubs
+ *============================================================================*/
+
+static const char *const s_loader_parameters =
+    "{\"type\":\"object\",\"properties\":{\"names\":{\"type\":\"array\","
+    "\"items\":{\"type\":\"string\"},\"description\":\"Tools to load\"}},"
+    "\"required\":[\"names\"]}";
+
+/**
+ * @brief First line or sentence of a description, at most MCP_SUMMARY_MAX
+ */
+static const char *stub_summary(arena_t *arena, const char *description) {
+    if (!description) {
+        return "";
+    }
+    while (*description == ' ' || *description == '\t' || *description == '\n') {
+        description++;
+    }
+
+    size_t len = 0;
+    while (description[len] && description[len] != '\n' && description[len] != '\r' &&
+           !(description[len] == '.' && (description[len + 1] == ' ' || !description[len + 1]))) {
+        len++;
+    }
+    const char *ellipsis = "";
+    if (len > MCP_SUMMARY_MAX) {
+        /* Cut at a word boundary */
+        len = MCP_SUMMARY_MAX;
+        while (len > MCP_SUMMARY_MAX / 2 && description[len] != ' ') {
+            len--;
+        }
+        ellipsis = "...";
+    }
+
+    char *summary = arena_alloc(arena, len + strlen(ellipsis) + 1);
+    if (summary) {
+        memcpy(summary, description, len);
+        strcpy(summary + len, ellipsis);
+    }
+    return summary;
+}
+
+/**
+ * @brief The registered stub for name, NULL if name is not an MCP stub
+ */
+static mcp_wrapper_data_t *stub_find(const mcp_registry_state_t *state, const char *name) {
+    for (mcp_wrapper_data_t *w = state->stubs; w; w = w->next_stub) {
+        if (strcmp(w->tool_name, name) == 0) {
+            return w;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief load_tools: mark stubs for loading at the next request
+ */
+static char *mcp_loader_execute(
+    const ac_tool_ctx_t *ctx,
+    const char *args_json,
+    void *priv
 ) {
-    if (!registry || !client) {
-        return ARC_ERR_INVALID_ARG;
+    (void)ctx;
+    mcp_registry_state_t *state = (mcp_registry_state_t *)priv;
+    const char *args = args_json ? args_json : "{}";
+    ac_json_span_t names = ac_json_scan_get(ac_json_scan_root(args, strlen(args)), "names");
+
+    ac_json_writer_t w;
+    ac_json_writer_init(&w, NULL);
+    ac_json_write_object_begin(&w);
+
+    /* Two passes: loaded names first, then the unknown ones */
+    for (int pass = 0; pass < 2; pass++) {
+        ac_json_write_key(&w, pass == 0 ? "loaded" : "unknown");
+        ac_json_write_array_begin(&w);
+
+        ac_json_span_t item;
+        for (size_t i = 0; (item = ac_json_scan_index(names, i)).kind != AC_JSON_NONE; i++) {
+            char *name = ac_json_scan_strdup(item);
+            if (!name) {
+                continue;
+            }
+            mcp_wrapper_data_t *stub = stub_find(state, name);
+            if (pass == 0 && stub) {
+                if (stub->deferred && !stub->load_requested) {
+                    stub->load_requested = 1;
+                    state->loads_pending = 1;
+                }
+                ac_json_write_string(&w, name);
+            } else if (pass == 1 && !stub) {
+                ac_json_write_string(&w, name);
+            }
+            ARC_FREE(name);
+        }
+        ac_json_write_array_end(&w);
     }
 
-    size_t tool_count = ac_mcp_tool_count(client);
-    if (tool_count == 0) {
-        AC_LOG_WARN("No MCP tools to add");
-        return ARC_OK;
+    ac_json_write_member_string(&w, "note", "Loaded tools can be called from the next step");
+    ac_json_write_object_end(&w);
+
+    char *result = ac_json_writer_take(&w);
+    return result ? result : ARC_STRDUP("{\"error\":\"Out of memory\"}");
+}
+
+/**
+ * @brief Rewrite load_tools' description to list the unloaded stubs
+ */
+static void loader_refresh(ac_tool_registry_t *registry, const mcp_registry_state_t *state) {
+    if (!state->loader_added) {
+        return;
     }
 
-    arena_t *arena = ac_tool_registry_get_arena(registry);
-    if (!arena) {
-        AC_LOG_ERROR("Failed to get registry arena");
-        return ARC_ERR_INVALID_ARG;
+    ac_strbuf_t sb = AC_STRBUF_INIT;
+    const char *intro =
+        "Load tools before calling them: their parameters are sent from the "
+        "next step on. Tools not loaded yet:";
+    arc_err_t err = ac_strbuf_append(&sb, intro, strlen(intro));
+
+    size_t unloaded = 0;
+    for (const mcp_wrapper_data_t *w = state->stubs; w && err == ARC_OK; w = w->next_stub) {
+        if (!w->deferred) {
+            continue;
+        }
+        unloaded++;
+        err = ac_strbuf_append(&sb, "\n- ", 3);
+        if (err == ARC_OK) err = ac_strbuf_append(&sb, w->tool_name, strlen(w->tool_name));
+        if (err == ARC_OK && *w->summary) {
+            err = ac_strbuf_append(&sb, ": ", 2);
+            if (err == ARC_OK) err = ac_strbuf_append(&sb, w->summary, strlen(w->summary));
+        }
+    }
+    if (err == ARC_OK && unloaded == 0) {
+        err = ac_strbuf_append(&sb, " none", 5);
     }
 
-    AC_LOG_INFO("Adding %zu MCP tools to registry", tool_count);
+    if (err != ARC_OK ||
+        ac_tool_registry_update_schema_locked(registry, MCP_LOADER_NAME, sb.data,
+                                              s_loader_parameters) != ARC_OK) {
+        AC_LOG_WARN("Failed to update the %s tool", MCP_LOADER_NAME);
+    }
+    ac_strbuf_reset(&sb);
+}
+
+/**
+ * @brief Add the load_tools tool once per registry
+ */
+static void loader_add(ac_tool_registry_t *registry, mcp_registry_state_t *state) {
+    if (state->loader_added) {
+        return;
+    }
+
+    ac_tool_t loader = {
+        .name = MCP_LOADER_NAME,
+        .description = "Load tools before calling them.",
+        .parameters = s_loader_parameters,
+        .execute = mcp_loader_execute,
+        .priv = state
+    };
+    if (ac_tool_registry_add_locked(registry, &loader) != ARC_OK) {
+        AC_LOG_WARN("Cannot add %s: stubs can only be loaded by calling them", MCP_LOADER_NAME);
+        return;
+    }
+    state->loader_added = 1;
+}
+
+/**
+ * @brief Put the full description and schema of a stub in the registry
+ */
+static int stub_load(ac_tool_registry_t *registry, mcp_wrapper_data_t *stub) {
+    size_t count = ac_mcp_tool_count(stub->client);
+    for (size_t i = 0; i < count; i++) {
+        const char *name = NULL;
+        const char *description = NULL;
+        const char *parameters = NULL;
+        if (ac_mcp_get_tool_info(stub->client, i, &name, &description, &parameters) != ARC_OK ||
+            !name || strcmp(name, stub->tool_name) != 0) {
+            continue;
+        }
+        if (ac_tool_registry_update_schema_locked(registry, name, description,
+                                                  parameters) != ARC_OK) {
+            return 0;
+        }
+        stub->deferred = 0;
+        AC_LOG_DEBUG("MCP tool %s: schema loaded", name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Apply the loads requested since the last request
+ *
+ * @return Number of tools loaded
+ */
+static size_t stubs_apply_loads(ac_tool_registry_t *registry, mcp_registry_state_t *state) {
+    if (!state->loads_pending) {
+        return 0;
+    }
+    state->loads_pending = 0;
+
+    size_t loaded = 0;
+    for (mcp_wrapper_data_t *w = state->stubs; w; w = w->next_stub) {
+        if (w->deferred && w->load_requested) {
+            loaded += stub_load(registry, w);
+        }
+    }
+    return loaded;
+}
+
+/**
+ * @brief Forget the stubs of a client whose tools are being replaced
+ */
+static void stubs_drop_client(mcp_registry_state_t *state, const ac_mcp_client_t *client) {
+    mcp_wrapper_data_t **link = &state->stubs;
+    while (*link) {
+        if ((*link)->client == client) {
+            *link = (*link)->next_stub;
+        } else {
+            link = &(*link)->next_stub;
+        }
+    }
+}
+
+/**
+ * @brief Whether results of a tool may be served from the cache
+ */
+static int tool_is_cacheable(const mcp_registry_state_t *state,
+                             const char *name, unsigned hints) {
+    if (!state->cache_enabled) {
+        return 0;
+    }
+    if (!state->ignore_annotations &&
+        (hints & (AC_MCP_TOOL_READ_ONLY | AC_MCP_TOOL_IDEMPOTENT))) {
+        return 1;
+    }
+    for (char **tool = state->cache_tools; tool && *tool; tool++) {
+        if (strcmp(*tool, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Register every tool of the client's current list (write lock held)
+ */
+static void add_client_tools(ac_tool_registry_t *registry, arena_t *arena,
+                             mcp_registry_state_t *state, mcp_source_t *source) {
+    ac_mcp_client_t *client = source->client;
+    size_t tool_count = ac_mcp_tool_count(client);
+
+    /* Stubs are listed in catalog order */
+    mcp_wrapper_data_t **stub_tail = &state->stubs;
+    while (*stub_tail) {
+        stub_tail = &(*stub_tail)->next_stub;
+    }
 
     for (size_t i = 0; i < tool_count; i++) {
         const char *name = NULL;
@@ -115,27 +767,281 @@ arc_err_t ac_tool_registry_add_mcp(
 
         wrapper_data->client = client;
         wrapper_data->tool_name = arena_strdup(arena, name);
+        wrapper_data->state = state;
+        wrapper_data->cached = tool_is_cacheable(state, name, ac_mcp_get_tool_hints(client, i)) ?
+            source : NULL;
 
         if (!wrapper_data->tool_name) {
             AC_LOG_ERROR("Failed to copy MCP tool name");
             continue;
         }
 
+        if (wrapper_data->cached) {
+            AC_LOG_DEBUG("MCP tool %s: results cached", name);
+        }
+
+        /* Stub: the summary stands in for the description until loaded */
+        if (state->lazy) {
+            wrapper_data->summary = stub_summary(arena, description);
+            if (!wrapper_data->summary) {
+                AC_LOG_ERROR("Failed to copy MCP tool summary");
+                continue;
+            }
+            wrapper_data->deferred = 1;
+        }
+
         /* Create tool definition */
         ac_tool_t tool = {
             .name = name,
-            .description = description,
-            .parameters = parameters,
+            .description = state->lazy ? wrapper_data->summary : description,
+            .parameters = state->lazy ? NULL : parameters,
             .execute = mcp_tool_execute,
-            .priv = wrapper_data
+            .priv = wrapper_data,
+            .parallel_safe = 1,          /* Concurrent calls are batched per client */
+            .deferred = state->lazy
         };
 
-        err = ac_tool_registry_add(registry, &tool);
-        if (err != ARC_OK) {
+        err = ac_tool_registry_add_locked(registry, &tool);
+        if (err == ARC_ERR_EXISTS) {
+            AC_LOG_WARN("MCP tool '%s' clashes with a registered tool, skipped", name);
+        } else if (err != ARC_OK) {
             AC_LOG_WARN("Failed to add MCP tool: %s", name);
+        } else if (state->lazy) {
+            *stub_tail = wrapper_data;
+            stub_tail = &wrapper_data->next_stub;
+        }
+    }
+
+    if (state->lazy) {
+        loader_add(registry, state);
+        loader_refresh(registry, state);
+    }
+}
+
+static int is_client_tool(const ac_tool_t *tool, void *client) {
+    return tool->execute == mcp_tool_execute &&
+           ((const mcp_wrapper_data_t *)tool->priv)->client == client;
+}
+
+arc_err_t ac_tool_registry_add_mcp(
+    ac_tool_registry_t *registry,
+    ac_mcp_client_t *client
+) {
+    if (!registry || !client) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    arena_t *arena = ac_tool_registry_get_arena(registry);
+    if (!arena) {
+        AC_LOG_ERROR("Failed to get registry arena");
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    /* Agents sharing the registry see all of the client's tools at once */
+    ac_tool_registry_write_lock(registry);
+
+    mcp_registry_state_t *state = registry_state(registry, arena);
+    if (!state) {
+        ac_tool_registry_write_unlock(registry);
+        return ARC_ERR_MEMORY;
+    }
+
+    /* Remember the client so a revalidated list can replace these tools */
+    mcp_source_t *source = state->sources;
+    while (source && source->client != client) {
+        source = source->next;
+    }
+    if (!source) {
+        source = (mcp_source_t *)arena_alloc(arena, sizeof(mcp_source_t));
+        if (!source) {
+            AC_LOG_ERROR("Failed to allocate MCP source");
+            ac_tool_registry_write_unlock(registry);
+            return ARC_ERR_MEMORY;
         }
+        source->client = client;
+        cache_init(&source->cache);
+        source->next = state->sources;
+        state->sources = source;
+    }
+    source->generation = ac_mcp_tools_refresh(client);
+
+    size_t tool_count = ac_mcp_tool_count(client);
+    if (tool_count == 0) {
+        AC_LOG_WARN("No MCP tools to add");
+    } else {
+        AC_LOG_INFO("Adding %zu MCP tools to registry", tool_count);
+        add_client_tools(registry, arena, state, source);
+        AC_LOG_INFO("MCP tools added to registry");
     }
 
-    AC_LOG_INFO("MCP tools added to registry");
+    ac_tool_registry_write_unlock(registry);
     return ARC_OK;
 }
+
+size_t ac_tool_registry_sync_mcp(ac_tool_registry_t *registry) {
+    if (!registry) {
+        return 0;
+    }
+
+    mcp_registry_state_t *state = *(mcp_registry_state_t **)ac_tool_registry_mcp_state(registry);
+    if (!state) {
+        return 0;
+    }
+
+    /* Someone else is writing (maybe syncing): the next request catches up */
+    if (!ac_tool_registry_write_trylock(registry)) {
+        return 0;
+    }
+
+    arena_t *arena = ac_tool_registry_get_arena(registry);
+    size_t replaced = 0;
+
+    for (mcp_source_t *source = state->sources; source; source = source->next) {
+        unsigned generation = ac_mcp_tools_refresh(source->client);
+        if (generation == source->generation) {
+            continue;
+        }
+        source->generation = generation;
+
+        stubs_drop_client(state, source->client);
+        size_t removed = ac_tool_registry_remove_if(registry, is_client_tool, source->client);
+        add_client_tools(registry, arena, state, source);
+
+        /* Results may depend on what changed with the list */
+        pthread_mutex_lock(&source->cache.lock);
+        cache_clear(&source->cache);
+        pthread_mutex_unlock(&source->cache.lock);
+        replaced++;
+
+        AC_LOG_INFO("MCP tools replaced: %zu removed, %zu listed",
+                    removed, ac_mcp_tool_count(source->client));
+    }
+
+    size_t loaded = stubs_apply_loads(registry, state);
+    if (loaded > 0) {
+        loader_refresh(registry, state);
+        AC_LOG_INFO("MCP tools loaded: %zu", loaded);
+    }
+
+    ac_tool_registry_write_unlock(registry);
+    return replaced;
+}
+
+/*============================================================================
+ * Lazy Stubs Configuration
+ *============================================================================*/
+
+arc_err_t ac_tool_registry_lazy_mcp(ac_tool_registry_t *registry, int enabled) {
+    if (!registry) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    arena_t *arena = ac_tool_registry_get_arena(registry);
+    ac_tool_registry_write_lock(registry);
+    mcp_registry_state_t *state = arena ? registry_state(registry, arena) : NULL;
+    if (state) {
+        state->lazy = enabled ? 1 : 0;
+    }
+    ac_tool_registry_write_unlock(registry);
+    if (!state) {
+        return ARC_ERR_MEMORY;
+    }
+
+    AC_LOG_INFO("MCP lazy tool stubs %s", state->lazy ? "enabled" : "disabled");
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Result Cache Configuration
+ *============================================================================*/
+
+/**
+ * @brief Apply a result cache configuration (write lock held)
+ */
+static arc_err_t cache_configure(mcp_registry_state_t *state, arena_t *arena,
+                                 const ac_mcp_result_cache_config_t *config) {
+    char **tools = NULL;
+    if (config->tools) {
+        size_t n = 0;
+        while (config->tools[n]) n++;
+
+        tools = (char **)arena_alloc(arena, sizeof(char *) * (n + 1));
+        if (!tools) {
+            return ARC_ERR_MEMORY;
+        }
+        for (size_t i = 0; i < n; i++) {
+            tools[i] = arena_strdup(arena, config->tools[i]);
+            if (!tools[i]) {
+                return ARC_ERR_MEMORY;
+            }
+        }
+        tools[n] = NULL;
+    }
+
+    state->cache_enabled = 1;
+    state->ttl_ms = config->ttl_ms ? config->ttl_ms : MCP_CACHE_DEFAULT_TTL_MS;
+    state->max_entries = config->max_entries ? config->max_entries : MCP_CACHE_DEFAULT_ENTRIES;
+    state->max_bytes = config->max_bytes ? config->max_bytes : MCP_CACHE_DEFAULT_BYTES;
+    state->ignore_annotations = config->ignore_annotations;
+    state->cache_tools = tools;
+    return ARC_OK;
+}
+
+arc_err_t ac_tool_registry_cache_mcp(
+    ac_tool_registry_t *registry,
+    const ac_mcp_result_cache_config_t *config
+) {
+    if (!registry || !config) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    arena_t *arena = ac_tool_registry_get_arena(registry);
+    ac_tool_registry_write_lock(registry);
+    mcp_registry_state_t *state = arena ? registry_state(registry, arena) : NULL;
+    arc_err_t err = state ? cache_configure(state, arena, config) : ARC_ERR_MEMORY;
+    ac_tool_registry_write_unlock(registry);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    AC_LOG_INFO("MCP result cache enabled (ttl %u ms, %zu entries, %zu bytes per server)",
+                state->ttl_ms, state->max_entries, state->max_bytes);
+    return ARC_OK;
+}
+
+void ac_tool_registry_mcp_cache_stats(
+    const ac_tool_registry_t *registry,
+    uint64_t *hits,
+    uint64_t *misses
+) {
+    uint64_t h = 0;
+    uint64_t m = 0;
+
+    const mcp_registry_state_t *state = registry ?
+        *(mcp_registry_state_t **)ac_tool_registry_mcp_state((ac_tool_registry_t *)registry) : NULL;
+
+    for (mcp_source_t *source = state ? state->sources : NULL; source; source = source->next) {
+        pthread_mutex_lock(&source->cache.lock);
+        h += source->cache.hits;
+        m += source->cache.misses;
+        pthread_mutex_unlock(&source->cache.lock);
+    }
+
+    if (hits) *hits = h;
+    if (misses) *misses = m;
+}
+
+/**
+ * @brief Free cached results (internal, called from tool.c at session close)
+ */
+void ac_tool_registry_mcp_cleanup(ac_tool_registry_t *registry) {
+    mcp_registry_state_t *state = *(mcp_registry_state_t **)ac_tool_registry_mcp_state(registry);
+    if (!state) {
+        return;
+    }
+
+    for (mcp_source_t *source = state->sources; source; source = source->next) {
+        cache_clear(&source->cache);
+        pthread_mutex_destroy(&source->cache.lock);
+    }
+}
@@ -0,0 +1,421 @@
+/**
+ * @file tool_spill.c
+ * @brief Spill files for large tool results
+ *
+ * With ac_tool_registry_spill() enabled, a result longer than the
+ * threshold is written to <dir>/spill-<fnv1a64>.out and the caller gets
+ * a short JSON stand-in instead: the size, a handle, and the head and tail
+ * of the output. Only the stand-in enters history, so a multi-megabyte
+ * command output costs a few KB in every later request. Files are content
+ * addressed: a result seen before is not written again.
+ *
+ * The model pages through a spilled result with the read_spilled_output
+ * tool, added to the registry when spilling is enabled:
+ * @code{.json}
+ * {"handle":"spill-0123456789abcdef","offset":0,"length":16384}
+ * @endcode
+ */
+
+#include "arc/tool.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "json_writer.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir_p(path) _mkdir(path)
+#else
+#define mkdir_p(path) mkdir(path, 0755)
+#endif
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define SPILL_TOOL_NAME          "read_spilled_output"
+#define SPILL_DEFAULT_THRESHOLD  (32 * 1024)
+#define SPILL_DEFAULT_EXCERPT    (2 * 1024)
+#define SPILL_PAGE_DEFAULT       (16 * 1024)
+#define SPILL_HANDLE_LEN         22          /* "spill-" + 16 hex digits */
+#define SPILL_PATH_MAX           1024
+
+static const char s_spill_parameters[] =
+    "{\"type\":\"object\",\"properties\":{"
+    "\"handle\":{\"type\":\"string\",\"description\":\"Handle from a spilled result\"},"
+    "\"offset\":{\"type\":\"integer\",\"description\":\"Byte offset to start at (default 0)\"},"
+    "\"length\":{\"type\":\"integer\",\"description\":\"Bytes to read (default 16384)\"}},"
+    "\"required\":[\"handle\"]}";
+
+/*============================================================================
+ * Spill State
+ *============================================================================*/
+
+/**
+ * @brief Spill settings of a registry (arena, via ac_tool_registry_spill_state)
+ */
+typedef struct {
+    const char *dir;
+    size_t threshold;
+    size_t excerpt;
+    size_t page_max;                 /* Cap on one read, keeps pages unspilled */
+} spill_state_t;
+
+/* Forward declarations - registry internals (tool.c) */
+extern arena_t *ac_tool_registry_get_arena(const ac_tool_registry_t *registry);
+extern void ac_tool_registry_write_lock(ac_tool_registry_t *registry);
+extern void ac_tool_registry_write_unlock(ac_tool_registry_t *registry);
+extern arc_err_t ac_tool_registry_add_locked(ac_tool_registry_t *registry,
+                                             const ac_tool_t *tool);
+extern void **ac_tool_registry_spill_state(ac_tool_registry_t *registry);
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+static uint64_t fnv1a64(const char *data, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static int spill_path(char *out, size_t size, const char *dir, const char *handle) {
+    int n = snprintf(out, size, "%s/%s.out", dir, handle);
+    return n > 0 && (size_t)n < size;
+}
+
+/**
+ * @brief Handles are generated here; anything else could name another file
+ */
+static int handle_valid(const char *handle, size_t len) {
+    if (len != SPILL_HANDLE_LEN || strncmp(handle, "spill-", 6) != 0) {
+        return 0;
+    }
+    for (size_t i = 6; i < len; i++) {
+        char c = handle[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** UTF-8 continuation byte */
+static int utf8_cont(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+/**
+ * @brief Length of the head excerpt: at most max bytes, ending on a line
+ *        break when one falls in its second half, never inside a character
+ */
+static size_t head_len(const char *text, size_t len, size_t max) {
+    if (len <= max) {
+        return len;
+    }
+    size_t n = max;
+    while (n > 0 && utf8_cont((unsigned char)text[n])) {
+        n--;
+    }
+    for (size_t i = n; i > max / 2; i--) {
+        if (text[i - 1] == '\n') {
+            return i;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Start of the tail excerpt (same rules, mirrored)
+ */
+static size_t tail_start(const char *text, size_t len, size_t max) {
+    if (len <= max) {
+        return 0;
+    }
+    size_t start = len - max;
+    while (start < len && utf8_cont((unsigned char)text[start])) {
+        start++;
+    }
+    for (size_t i = start; i < len - max / 2; i++) {
+        if (text[i] == '\n') {
+            return i + 1;
+        }
+    }
+    return start;
+}
+
+/**
+ * @brief Write data to path unless a file of that size is already there
+ *
+ * Goes through a temporary name so a concurrent reader never sees a
+ * partial file.
+ */
+static int spill_write(const char *path, const char *data, size_t len) {
+    struct stat st;
+    if (stat(path, &st) == 0 && (size_t)st.st_size == len) {
+        return 1;
+    }
+
+    char tmp[SPILL_PATH_MAX];
+    int n = snprintf(tmp, sizeof(tmp), "%s.%p.tmp", path, (const void *)data);
+    if (n <= 0 || (size_t)n >= sizeof(tmp)) {
+        return 0;
+    }
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        return 0;
+    }
+    int ok = fwrite(data, 1, len, fp) == len;
+    ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+/*============================================================================
+ * Spilling
+ *============================================================================*/
+
+/**
+ * @brief Replace result by its stand-in if it is over the threshold
+ *
+ * Called by ac_tool_registry_call(). Takes ownership of result; on any
+ * failure the original result is returned unchanged.
+ */
+char *ac_tool_spill_apply(ac_tool_registry_t *registry, const ac_tool_t *tool, char *result) {
+    spill_state_t *state = *(spill_state_t **)ac_tool_registry_spill_state(registry);
+    if (!state || !result || strcmp(tool->name, SPILL_TOOL_NAME) == 0) {
+        return result;
+    }
+
+    size_t len = strlen(result);
+    if (len <= state->threshold) {
+        return result;
+    }
+
+    char handle[SPILL_HANDLE_LEN + 1];
+    snprintf(handle, sizeof(handle), "spill-%016llx",
+             (unsigned long long)fnv1a64(result, len));
+
+    char path[SPILL_PATH_MAX];
+    if (!spill_path(path, sizeof(path), state->dir, handle) ||
+        !spill_write(path, result, len)) {
+        AC_LOG_WARN("Tool %s: cannot spill %zu bytes to %s, keeping it inline",
+                    tool->name, len, state->dir);
+        return result;
+    }
+
+    size_t head = head_len(result, len, state->excerpt);
+    size_t tail = tail_start(result, len, state->excerpt);
+    if (tail < head) {
+        tail = head;
+    }
+
+    ac_json_writer_t w;
+    ac_json_writer_init(&w, NULL);
+    ac_json_write_object_begin(&w);
+    ac_json_write_member_bool(&w, "spilled", 1);
+    ac_json_write_member_string(&w, "handle", handle);
+    ac_json_write_member_int(&w, "bytes", (long long)len);
+    ac_json_write_key(&w, "head");
+    ac_json_write_string_len(&w, result, head);
+    ac_json_write_member_int(&w, "tail_offset", (long long)tail);
+    ac_json_write_key(&w, "tail");
+    ac_json_write_string_len(&w, result + tail, len - tail);
+    ac_json_write_member_string(&w, "note",
+        "Output too large to show in full; read the rest with " SPILL_TOOL_NAME);
+    ac_json_write_object_end(&w);
+
+    char *stub = ac_json_writer_take(&w);
+    if (!stub) {
+        return result;
+    }
+
+    AC_LOG_INFO("Tool %s: %zu bytes spilled to %s", tool->name, len, path);
+    ARC_FREE(result);
+    return stub;
+}
+
+/*============================================================================
+ * read_spilled_output
+ *============================================================================*/
+
+static char *spill_error(const char *message) {
+    ac_json_writer_t w;
+    ac_json_writer_init(&w, NULL);
+    ac_json_write_object_begin(&w);
+    ac_json_write_member_string(&w, "error", message);
+    ac_json_write_object_end(&w);
+    char *result = ac_json_writer_take(&w);
+    return result ? result : ARC_STRDUP("{\"error\":\"Out of memory\"}");
+}
+
+static char *spill_read_execute(
+    const ac_tool_ctx_t *ctx,
+    const ac_tool_args_t *args,
+    void *priv
+) {
+    (void)ctx;
+    const spill_state_t *state = (const spill_state_t *)priv;
+
+    const ac_tool_arg_t *handle = ac_tool_args_get(args, "handle");
+    const ac_tool_arg_t *offset_arg = ac_tool_args_get(args, "offset");
+    const ac_tool_arg_t *length_arg = ac_tool_args_get(args, "length");
+
+    if (!handle || handle->type != AC_TOOL_ARG_STRING ||
+        !handle_valid(handle->str, handle->len)) {
+        return spill_error("Unknown handle");
+    }
+
+    size_t offset = 0;
+    if (offset_arg && offset_arg->type == AC_TOOL_ARG_NUMBER && offset_arg->number > 0) {
+        offset = (size_t)offset_arg->number;
+    }
+    size_t length = SPILL_PAGE_DEFAULT;
+    if (length_arg && length_arg->type == AC_TOOL_ARG_NUMBER && length_arg->number >= 1) {
+        length = (size_t)length_arg->number;
+    }
+    if (length > state->page_max) {
+        length = state->page_max;
+    }
+
+    char path[SPILL_PATH_MAX];
+    if (!spill_path(path, sizeof(path), state->dir, handle->str)) {
+        return spill_error("Unknown handle");
+    }
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return spill_error("Spilled output no longer available");
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    if (size < 0) {
+        fclose(fp);
+        return spill_error("Spilled output unreadable");
+    }
+    size_t total = (size_t)size;
+    if (offset > total) {
+        offset = total;
+    }
+    if (length > total - offset) {
+        length = total - offset;
+    }
+
+    /* One byte of lookahead to avoid ending inside a character */
+    char *buf = (char *)ARC_MALLOC(length + 1);
+    if (!buf) {
+        fclose(fp);
+        return spill_error("Out of memory");
+    }
+    fseek(fp, (long)offset, SEEK_SET);
+    size_t got = fread(buf, 1, length + (offset + length < total ? 1 : 0), fp);
+    fclose(fp);
+
+    size_t n = got < length ? got : length;
+    if (got > n) {
+        while (n > 0 && utf8_cont((unsigned char)buf[n])) {
+            n--;
+        }
+    }
+
+    ac_json_writer_t w;
+    ac_json_writer_init(&w, NULL);
+    ac_json_write_object_begin(&w);
+    ac_json_write_member_string(&w, "handle", handle->str);
+    ac_json_write_member_int(&w, "offset", (long long)offset);
+    ac_json_write_member_int(&w, "next_offset", (long long)(offset + n));
+    ac_json_write_member_int(&w, "total", (long long)total);
+    ac_json_write_member_bool(&w, "eof", offset + n >= total);
+    ac_json_write_key(&w, "content");
+    ac_json_write_string_len(&w, buf, n);
+    ac_json_write_object_end(&w);
+    ARC_FREE(buf);
+
+    char *result = ac_json_writer_take(&w);
+    return result ? result : spill_error("Out of memory");
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t ac_tool_registry_spill(
+    ac_tool_registry_t *registry,
+    const ac_tool_spill_config_t *config
+) {
+    if (!registry || !config || !config->dir || !*config->dir) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    struct stat st;
+    if (stat(config->dir, &st) != 0) {
+        if (mkdir_p(config->dir) != 0 && errno != EEXIST) {
+            AC_LOG_ERROR("Tool spill: cannot create %s", config->dir);
+            return ARC_ERR_IO;
+        }
+    } else if (!S_ISDIR(st.st_mode)) {
+        AC_LOG_ERROR("Tool spill: %s is not a directory", config->dir);
+        return ARC_ERR_IO;
+    }
+
+    /* The reader tool and the state appear together */
+    ac_tool_registry_write_lock(registry);
+    spill_state_t **slot = (spill_state_t **)ac_tool_registry_spill_state(registry);
+    if (*slot) {
+        ac_tool_registry_write_unlock(registry);
+        return ARC_ERR_EXISTS;
+    }
+
+    arena_t *arena = ac_tool_registry_get_arena(registry);
+    spill_state_t *state = (spill_state_t *)arena_alloc(arena, sizeof(spill_state_t));
+    if (state) {
+        state->dir = arena_strdup(arena, config->dir);
+    }
+    if (!state || !state->dir) {
+        ac_tool_registry_write_unlock(registry);
+        return ARC_ERR_NO_MEMORY;
+    }
+    state->threshold = config->threshold ? config->threshold : SPILL_DEFAULT_THRESHOLD;
+    state->excerpt = config->excerpt_bytes ? config->excerpt_bytes : SPILL_DEFAULT_EXCERPT;
+    if (state->excerpt * 2 > state->threshold) {
+        state->excerpt = state->threshold / 2;
+    }
+    /* Escaping can double a page; keep it clear of the threshold */
+    state->page_max = state->threshold / 2;
+
+    ac_tool_t reader = {
+        .name = SPILL_TOOL_NAME,
+        .description = "Read part of a tool output that was too large to return "
+                       "in full. Pass the handle from the spilled result and a "
+                       "byte offset; continue from next_offset until eof.",
+        .parameters = s_spill_parameters,
+        .execute_args = spill_read_execute,
+        .priv = state,
+        .parallel_safe = 1
+    };
+    arc_err_t err = ac_tool_registry_add_locked(registry, &reader);
+    if (err == ARC_OK) {
+        *slot = state;
+    }
+    ac_tool_registry_write_unlock(registry);
+    if (err != ARC_OK) {
+        AC_LOG_ERROR("Tool spill: cannot add %s", SPILL_TOOL_NAME);
+        return err;
+    }
+    AC_LOG_INFO("Tool results over %zu bytes spill to %s", state->threshold, state->dir);
+    return ARC_OK;
+}
@@ -10,10 +10,17 @@
 #include "arc/agent_hooks.h"
 #include "arc/platform.h"
 #include "llm/message/message_json.h"
+#include "pthread_port.h"
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef ARC_HAS_THREADS
+#include <errno.h>
+#include <time.h>
+#endif
+
 /*============================================================================
  * Event Type Names
  *============================================================================*/
@@ -26,7 +33,9 @@ static const char *s_event_names[] = {
     "llm_request",
     "llm_response",
     "tool_start",
-    "tool_end"
+    "tool_end",
+    "mcp_connection",
+    "arena"
 };
 
 /*============================================================================
@@ -37,11 +46,393 @@ typedef struct {
     ac_trace_handler_t handler;
     void *user_data;
     char trace_id[32];
-    int sequence;
+    atomic_int sequence;
     int enabled;
+
+    /* Counters (ac_trace_get_stats) */
+    atomic_uint_least64_t emitted;
+    atomic_uint_least64_t delivered;
+    atomic_uint_least64_t dropped;
+
+    /* Sampling (ac_trace_set_sampling) */
+    ac_trace_sampling_t sampling;
+    uint64_t runs;                      /* Runs started */
+    int run_traced;                     /* Current run is sampled */
+    uint32_t requests;                  /* LLM requests in the current run */
+    const ac_message_t *history_last;   /* Last message recorded (delta mode) */
 } trace_ctx_t;
 
-static trace_ctx_t s_ctx = {0};
+static trace_ctx_t s_ctx = { .run_traced = 1 };
+
+/*============================================================================
+ * Async Ring
+ *
+ * Bounded MPSC queue (Vyukov): a producer claims a position with one CAS
+ * on head and publishes the slot by advancing its sequence; the exporter
+ * thread is the only consumer. A full ring fails the push instead of
+ * blocking. The consumer sleeps on a condvar with a short timeout, and
+ * producers only take the lock to wake it when it is asleep.
+ *
+ * Producers enter the ring (ring_enter) before touching a slot and leave
+ * it after: ring_stop() clears the running flag, then waits for the
+ * producers inside to leave before it drains and frees the slots.
+ *============================================================================*/
+
+#ifdef ARC_HAS_THREADS
+
+/** Longest consumer sleep: bounds the delay of a missed wake-up */
+#define TRACE_IDLE_MS 10
+
+typedef struct {
+    atomic_size_t seq;
+    ac_trace_event_t *event;     /* Heap copy, strings in the same block */
+    char *owned;                 /* Payload handed over by the hook (ARC_FREE) */
+} trace_slot_t;
+
+typedef struct {
+    trace_slot_t *slots;
+    size_t mask;
+    atomic_size_t head;          /* Next position to claim */
+    size_t tail;                 /* Next position to consume (consumer only) */
+    atomic_size_t consumed;      /* Positions handled, for flush and stats */
+    atomic_size_t high_water;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;         /* Consumer: work or stop */
+    pthread_cond_t drained;      /* Flushers: consumed advanced */
+    atomic_int sleeping;
+    atomic_int stop;
+} trace_ring_t;
+
+static trace_ring_t s_ring;
+
+/* Outside s_ring: ring_start() clears that while late producers may still
+ * be backing out of a stopped ring */
+static atomic_int s_ring_running;
+static atomic_size_t s_ring_inflight;  /* Producers between enter and leave */
+
+/**
+ * @brief Enter the ring if it is running (then ring_leave() after the push)
+ */
+static int ring_enter(void) {
+    atomic_fetch_add_explicit(&s_ring_inflight, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&s_ring_running, memory_order_seq_cst)) {
+        return 1;
+    }
+    atomic_fetch_sub_explicit(&s_ring_inflight, 1, memory_order_release);
+    return 0;
+}
+
+static void ring_leave(void) {
+    atomic_fetch_sub_explicit(&s_ring_inflight, 1, memory_order_release);
+}
+
+static int ring_push(ac_trace_event_t *event, char *owned) {
+    trace_ring_t *r = &s_ring;
+    size_t pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+    trace_slot_t *slot;
+
+    for (;;) {
+        slot = &r->slots[pos & r->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->head, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return 0;   /* Full */
+        } else {
+            pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+        }
+    }
+
+    slot->event = event;
+    slot->owned = owned;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+    /* consumed trails tail by at most one batch */
+    size_t queued = pos + 1 - atomic_load_explicit(&r->consumed, memory_order_relaxed);
+    if (queued > r->mask + 1) {
+        queued = r->mask + 1;
+    }
+    size_t high = atomic_load_explicit(&r->high_water, memory_order_relaxed);
+    while (queued > high &&
+           !atomic_compare_exchange_weak_explicit(&r->high_water, &high, queued,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+
+    if (atomic_load_explicit(&r->sleeping, memory_order_acquire)) {
+        pthread_mutex_lock(&r->lock);
+        pthread_cond_signal(&r->wake);
+        pthread_mutex_unlock(&r->lock);
+    }
+    return 1;
+}
+
+/**
+ * @brief Take the next published slot (consumer only)
+ */
+static int ring_pop(ac_trace_event_t **event, char **owned) {
+    trace_ring_t *r = &s_ring;
+    trace_slot_t *slot = &r->slots[r->tail & r->mask];
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != r->tail + 1) {
+        return 0;
+    }
+    *event = slot->event;
+    *owned = slot->owned;
+    atomic_store_explicit(&slot->seq, r->tail + r->mask + 1, memory_order_release);
+    r->tail++;
+    return 1;
+}
+
+static void deliver(ac_trace_event_t *event, char *owned) {
+    if (s_ctx.handler) {
+        s_ctx.handler(event, s_ctx.user_data);
+    }
+    atomic_fetch_add_explicit(&s_ctx.delivered, 1, memory_order_relaxed);
+    ARC_FREE(owned);
+    ARC_FREE(event);
+}
+
+static void *ring_consumer(void *arg) {
+    (void)arg;
+    trace_ring_t *r = &s_ring;
+
+    for (;;) {
+        ac_trace_event_t *event;
+        char *owned;
+        size_t handled = 0;
+        while (ring_pop(&event, &owned)) {
+            deliver(event, owned);
+            handled++;
+        }
+
+        pthread_mutex_lock(&r->lock);
+        if (handled > 0) {
+            atomic_fetch_add_explicit(&r->consumed, handled, memory_order_release);
+            pthread_cond_broadcast(&r->drained);
+        }
+        if (atomic_load_explicit(&r->stop, memory_order_acquire) &&
+            r->tail == atomic_load_explicit(&r->head, memory_order_acquire)) {
+            pthread_mutex_unlock(&r->lock);
+            break;
+        }
+
+        /* Re-check under the flag so a push that saw it clear is not missed */
+        atomic_store_explicit(&r->sleeping, 1, memory_order_seq_cst);
+        trace_slot_t *next = &r->slots[r->tail & r->mask];
+        if (atomic_load_explicit(&next->seq, memory_order_acquire) != r->tail + 1 &&
+            !atomic_load_explicit(&r->stop, memory_order_acquire)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += TRACE_IDLE_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&r->wake, &r->lock, &deadline);
+        }
+        atomic_store_explicit(&r->sleeping, 0, memory_order_relaxed);
+        pthread_mutex_unlock(&r->lock);
+    }
+    return NULL;
+}
+
+static arc_err_t ring_start(size_t capacity) {
+    trace_ring_t *r = &s_ring;
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    memset(r, 0, sizeof(*r));
+    r->slots = (trace_slot_t *)ARC_CALLOC(size, sizeof(trace_slot_t));
+    if (!r->slots) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    r->mask = size - 1;
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&r->slots[i].seq, i);
+    }
+
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->wake, NULL);
+    pthread_cond_init(&r->drained, NULL);
+    if (pthread_create(&r->thread, NULL, ring_consumer, NULL) != 0) {
+        pthread_cond_destroy(&r->drained);
+        pthread_cond_destroy(&r->wake);
+        pthread_mutex_destroy(&r->lock);
+        ARC_FREE(r->slots);
+        r->slots = NULL;
+        return ARC_ERR_BACKEND;
+    }
+    atomic_store_explicit(&s_ring_running, 1, memory_order_seq_cst);
+    return ARC_OK;
+}
+
+/**
+ * @brief Deliver what is queued, then stop the consumer
+ */
+static void ring_stop(void) {
+    trace_ring_t *r = &s_ring;
+    if (!atomic_exchange_explicit(&s_ring_running, 0, memory_order_seq_cst)) {
+        return;
+    }
+
+    /* No new producer gets in; the consumer keeps draining for those inside */
+    while (atomic_load_explicit(&s_ring_inflight, memory_order_acquire) > 0) {
+        ac_platform_sleep_ms(1);
+    }
+
+    pthread_mutex_lock(&r->lock);
+    atomic_store_explicit(&r->stop, 1, memory_order_release);
+    pthread_cond_signal(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->thread, NULL);
+
+    /* A push that landed after the consumer's last pass: not delivered, only freed */
+    ac_trace_event_t *event;
+    char *owned;
+    while (ring_pop(&event, &owned)) {
+        atomic_fetch_add_explicit(&s_ctx.dropped, 1, memory_order_relaxed);
+        ARC_FREE(owned);
+        ARC_FREE(event);
+    }
+
+    pthread_cond_destroy(&r->drained);
+    pthread_cond_destroy(&r->wake);
+    pthread_mutex_destroy(&r->lock);
+    ARC_FREE(r->slots);
+    r->slots = NULL;
+}
+
+static int ring_running(void) {
+    return atomic_load_explicit(&s_ring_running, memory_order_acquire);
+}
+
+#else /* !ARC_HAS_THREADS */
+
+static int ring_push(ac_trace_event_t *event, char *owned) {
+    (void)event;
+    (void)owned;
+    return 0;
+}
+
+static void ring_stop(void) {
+}
+
+static int ring_enter(void) {
+    return 0;
+}
+
+static void ring_leave(void) {
+}
+
+#endif /* ARC_HAS_THREADS */
+
+/*============================================================================
+ * Event Copies
+ *
+ * A queued event outlives the hook that produced it: its strings (and the
+ * arena tag table) are copied into one block behind the event. A payload
+ * the hook built for the event (owned) is handed over instead of copied.
+ *============================================================================*/
+
+/** Most string members of any event type, trace_id and agent_name included */
+#define TRACE_MAX_STRINGS 5
+
+/**
+ * @brief Addresses of an event's string members
+ */
+static size_t event_strings(ac_trace_event_t *e, const char **fields[TRACE_MAX_STRINGS]) {
+    size_t n = 0;
+    fields[n++] = &e->trace_id;
+    fields[n++] = &e->agent_name;
+    switch (e->type) {
+        case AC_TRACE_AGENT_START:
+            fields[n++] = &e->data.agent_start.message;
+            fields[n++] = &e->data.agent_start.instructions;
+            break;
+        case AC_TRACE_AGENT_END:
+            fields[n++] = &e->data.agent_end.content;
+            break;
+        case AC_TRACE_LLM_REQUEST:
+            fields[n++] = &e->data.llm_request.model;
+            fields[n++] = &e->data.llm_request.messages_json;
+            fields[n++] = &e->data.llm_request.tools_json;
+            break;
+        case AC_TRACE_LLM_RESPONSE:
+            fields[n++] = &e->data.llm_response.content;
+            fields[n++] = &e->data.llm_response.tool_calls_json;
+            fields[n++] = &e->data.llm_response.finish_reason;
+            break;
+        case AC_TRACE_TOOL_START:
+            fields[n++] = &e->data.tool_start.id;
+            fields[n++] = &e->data.tool_start.name;
+            fields[n++] = &e->data.tool_start.arguments;
+            break;
+        case AC_TRACE_TOOL_END:
+            fields[n++] = &e->data.tool_end.id;
+            fields[n++] = &e->data.tool_end.name;
+            fields[n++] = &e->data.tool_end.result;
+            break;
+        case AC_TRACE_MCP_CONNECTION:
+            fields[n++] = &e->data.mcp_connection.server_url;
+            fields[n++] = &e->data.mcp_connection.error;
+            break;
+        default:
+            break;
+    }
+    return n;
+}
+
+static ac_trace_event_t *event_copy(const ac_trace_event_t *event, const char *owned) {
+    ac_trace_event_t tmp = *event;
+    const char **fields[TRACE_MAX_STRINGS];
+    size_t n = event_strings(&tmp, fields);
+
+    size_t tags_size = 0;
+    if (tmp.type == AC_TRACE_ARENA && tmp.data.arena.tags) {
+        tags_size = ARENA_TAG_MAX * sizeof(arena_tag_stats_t);
+    }
+    size_t total = sizeof(ac_trace_event_t) + tags_size;
+    size_t lens[TRACE_MAX_STRINGS];
+    for (size_t i = 0; i < n; i++) {
+        const char *s = *fields[i];
+        lens[i] = s && s != owned ? strlen(s) + 1 : 0;
+        total += lens[i];
+    }
+
+    ac_trace_event_t *copy = (ac_trace_event_t *)ARC_MALLOC(total);
+    if (!copy) {
+        return NULL;
+    }
+    *copy = tmp;
+
+    /* The tag table first: it keeps the alignment of the event */
+    char *p = (char *)(copy + 1);
+    if (tags_size > 0) {
+        memcpy(p, tmp.data.arena.tags, tags_size);
+        copy->data.arena.tags = (const arena_tag_stats_t *)p;
+        p += tags_size;
+    }
+
+    const char **copy_fields[TRACE_MAX_STRINGS];
+    event_strings(copy, copy_fields);
+    for (size_t i = 0; i < n; i++) {
+        if (lens[i] > 0) {
+            memcpy(p, *fields[i], lens[i]);
+            *copy_fields[i] = p;
+            p += lens[i];
+        }
+    }
+    return copy;
+}
 
 /*============================================================================
  * Utility Functions
@@ -80,8 +471,34 @@ int ac_trace_is_enabled(void) {
  * Internal: Emit trace event
  *============================================================================*/
 
-static void emit_event(ac_trace_event_type_t type, const char *agent_name, ac_trace_event_t *event) {
-    if (!s_ctx.enabled || !s_ctx.handler) {
+#ifdef ARC_THREAD_LOCAL
+static ARC_THREAD_LOCAL uint32_t t_thread_id;
+static atomic_uint s_next_thread_id;
+
+/** Small stable number of the calling thread, for exporters drawing per-thread tracks */
+static uint32_t trace_thread_id(void) {
+    if (t_thread_id == 0) {
+        t_thread_id = atomic_fetch_add_explicit(&s_next_thread_id, 1, memory_order_relaxed) + 1;
+    }
+    return t_thread_id;
+}
+#else
+static uint32_t trace_thread_id(void) {
+    return 0;
+}
+#endif
+
+/**
+ * @brief Stamp and deliver an event (or queue a copy of it)
+ *
+ * @param owned  Payload built for this event and referenced by it (freed
+ *               once handled, may be NULL)
+ */
+static void emit_owned(ac_trace_event_type_t type, const char *agent_name,
+                       ac_trace_event_t *event, char *owned) {
+    if (!s_ctx.enabled || !s_ctx.handler ||
+        (!s_ctx.run_traced && type != AC_TRACE_MCP_CONNECTION)) {
+        ARC_FREE(owned);
         return;
     }
 
@@ -89,9 +506,28 @@ static void emit_event(ac_trace_event_type_t type, const char *agent_name, ac_tr
     event->timestamp_ms = ac_trace_timestamp_ms();
     event->trace_id = s_ctx.trace_id;
     event->agent_name = agent_name;
-    event->sequence = ++s_ctx.sequence;
+    event->sequence = atomic_fetch_add_explicit(&s_ctx.sequence, 1, memory_order_relaxed) + 1;
+    event->thread_id = trace_thread_id();
+    atomic_fetch_add_explicit(&s_ctx.emitted, 1, memory_order_relaxed);
+
+    if (ring_enter()) {
+        ac_trace_event_t *copy = event_copy(event, owned);
+        if (!copy || !ring_push(copy, owned)) {
+            atomic_fetch_add_explicit(&s_ctx.dropped, 1, memory_order_relaxed);
+            ARC_FREE(copy);
+            ARC_FREE(owned);
+        }
+        ring_leave();
+        return;
+    }
 
     s_ctx.handler(event, s_ctx.user_data);
+    atomic_fetch_add_explicit(&s_ctx.delivered, 1, memory_order_relaxed);
+    ARC_FREE(owned);
+}
+
+static void emit_event(ac_trace_event_type_t type, const char *agent_name, ac_trace_event_t *event) {
+    emit_owned(type, agent_name, event, NULL);
 }
 
 /*============================================================================
@@ -101,9 +537,18 @@ static void emit_event(ac_trace_event_type_t type, const char *agent_name, ac_tr
 static void on_run_start(void *ctx, const ac_hook_run_start_t *info) {
     (void)ctx;
 
+    uint32_t every = s_ctx.sampling.run_every;
+    s_ctx.run_traced = every <= 1 || s_ctx.runs % every == 0;
+    s_ctx.runs++;
+    s_ctx.requests = 0;
+    s_ctx.history_last = NULL;
+    if (!s_ctx.run_traced) {
+        return;
+    }
+
     /* Initialize new trace */
     ac_trace_generate_id(s_ctx.trace_id, sizeof(s_ctx.trace_id));
-    s_ctx.sequence = 0;
+    atomic_store_explicit(&s_ctx.sequence, 0, memory_order_relaxed);
 
     ac_trace_event_t event = {0};
     event.data.agent_start.message = info->message;
@@ -117,6 +562,18 @@ static void on_run_start(void *ctx, const ac_hook_run_start_t *info) {
 static void on_run_end(void *ctx, const ac_hook_run_end_t *info) {
     (void)ctx;
 
+    /* Before agent_end, which closes the trace for file exporters */
+    if (info->arena) {
+        ac_trace_event_t arena_event = {0};
+        arena_event.data.arena.total_capacity = info->arena->total_capacity;
+        arena_event.data.arena.total_allocated = info->arena->total_allocated;
+        arena_event.data.arena.peak_allocated = info->arena->peak_allocated;
+        arena_event.data.arena.wasted_tail = info->arena->wasted_tail;
+        arena_event.data.arena.tags = info->arena->tags;
+
+        emit_event(AC_TRACE_ARENA, info->agent_name, &arena_event);
+    }
+
     ac_trace_event_t event = {0};
     event.data.agent_end.content = info->content;
     event.data.agent_end.iterations = info->iterations;
@@ -147,27 +604,79 @@ static void on_iter_end(void *ctx, const ac_hook_iter_t *info) {
     emit_event(AC_TRACE_ITER_END, info->agent_name, &event);
 }
 
+/**
+ * @brief First message to record for this request (NULL = none)
+ *
+ * Delta mode resumes after the last recorded message; if that one is no
+ * longer in the history (trimmed), the whole history is recorded again.
+ */
+static const ac_message_t *history_begin(const ac_hook_llm_request_t *info, size_t *offset) {
+    *offset = 0;
+    uint32_t every = s_ctx.sampling.history_every;
+    uint32_t request = s_ctx.requests++;
+    if (s_ctx.sampling.history == AC_TRACE_HISTORY_OFF ||
+        (every > 1 && request % every != 0)) {
+        return NULL;
+    }
+    if (s_ctx.sampling.history != AC_TRACE_HISTORY_DELTA || !s_ctx.history_last) {
+        return info->messages;
+    }
+
+    size_t index = 0;
+    for (const ac_message_t *m = info->messages; m; m = m->next, index++) {
+        if (m == s_ctx.history_last) {
+            *offset = index + 1;
+            return m->next;
+        }
+    }
+    return info->messages;
+}
+
 static void on_llm_request(void *ctx, const ac_hook_llm_request_t *info) {
     (void)ctx;
 
+    if (!s_ctx.run_traced) {
+        return;
+    }
+
+    size_t offset;
+    const ac_message_t *first = history_begin(info, &offset);
+
     /* Serialize messages on demand - only when trace is active */
-    char *messages_json = ac_messages_to_json_string(info->messages);
+    char *messages_json = NULL;
+    if (first) {
+        messages_json = ac_messages_to_json_string(first);
+    } else if (offset > 0) {
+        messages_json = ARC_STRDUP("[]");
+    }
+    if (messages_json && s_ctx.sampling.history == AC_TRACE_HISTORY_DELTA) {
+        const ac_message_t *last = first ? first : s_ctx.history_last;
+        while (last->next) {
+            last = last->next;
+        }
+        s_ctx.history_last = last;
+    }
 
     ac_trace_event_t event = {0};
     event.data.llm_request.model = info->model;
     event.data.llm_request.messages_json = messages_json;
     event.data.llm_request.tools_json = info->tools_schema;
     event.data.llm_request.message_count = info->message_count;
+    event.data.llm_request.message_offset = offset;
+    event.data.llm_request.max_tokens = info->max_tokens;
+    event.data.llm_request.thinking_budget = info->thinking_budget;
+    event.data.llm_request.budget_reason = info->budget_reason;
 
-    emit_event(AC_TRACE_LLM_REQUEST, info->agent_name, &event);
-
-    /* Cleanup */
-    if (messages_json) ARC_FREE(messages_json);
+    emit_owned(AC_TRACE_LLM_REQUEST, info->agent_name, &event, messages_json);
 }
 
 static void on_llm_response(void *ctx, const ac_hook_llm_response_t *info) {
     (void)ctx;
 
+    if (!s_ctx.run_traced) {
+        return;
+    }
+
     /* Serialize tool calls on demand - only when trace is active */
     char *tool_calls_json = ac_tool_calls_to_json_string(info->tool_calls);
 
@@ -180,11 +689,12 @@ static void on_llm_response(void *ctx, const ac_hook_llm_response_t *info) {
     event.data.llm_response.total_tokens = info->total_tokens;
     event.data.llm_response.finish_reason = info->finish_reason;
     event.data.llm_response.duration_ms = info->duration_ms;
+    event.data.llm_response.ratelimit_wait_ms = info->ratelimit_wait_ms;
+    event.data.llm_response.draft = info->draft;
+    event.data.llm_response.thinking_tokens = info->thinking_tokens;
+    event.data.llm_response.timing = info->timing;
 
-    emit_event(AC_TRACE_LLM_RESPONSE, info->agent_name, &event);
-
-    /* Cleanup */
-    if (tool_calls_json) ARC_FREE(tool_calls_json);
+    emit_owned(AC_TRACE_LLM_RESPONSE, info->agent_name, &event, tool_calls_json);
 }
 
 static void on_tool_start(void *ctx, const ac_hook_tool_start_t *info) {
@@ -207,24 +717,50 @@ static void on_tool_end(void *ctx, const ac_hook_tool_end_t *info) {
     event.data.tool_end.result = info->result;
     event.data.tool_end.duration_ms = info->duration_ms;
     event.data.tool_end.success = info->success;
+    event.data.tool_end.cache_status = info->cache_status;
+    event.data.tool_end.cache_hits = info->cache_hits;
+    event.data.tool_end.cache_misses = info->cache_misses;
+    event.data.tool_end.processes = info->processes;
+    event.data.tool_end.cpu_usec = info->cpu_usec;
+    event.data.tool_end.memory_peak = info->memory_peak;
+    event.data.tool_end.io_read_bytes = info->io_read_bytes;
+    event.data.tool_end.io_write_bytes = info->io_write_bytes;
 
     emit_event(AC_TRACE_TOOL_END, info->agent_name, &event);
 }
 
+static void on_mcp_connection(void *ctx, const ac_hook_mcp_connection_t *info) {
+    (void)ctx;
+
+    ac_trace_event_t event = {0};
+    event.data.mcp_connection.server_url = info->server_url;
+    event.data.mcp_connection.event = info->event;
+    event.data.mcp_connection.attempt = info->attempt;
+    event.data.mcp_connection.delay_ms = info->delay_ms;
+    event.data.mcp_connection.downtime_ms = info->downtime_ms;
+    event.data.mcp_connection.resumed = info->resumed;
+    event.data.mcp_connection.error = info->error;
+
+    emit_event(AC_TRACE_MCP_CONNECTION, NULL, &event);
+}
+
 /*============================================================================
  * Public API
  *============================================================================*/
 
-void ac_trace_enable(ac_trace_handler_t handler, void *user_data) {
-    if (!handler) {
-        return;
-    }
-
+/**
+ * @brief Install the handler and register the hooks
+ */
+static void trace_start(ac_trace_handler_t handler, void *user_data) {
     /* Store handler */
     s_ctx.handler = handler;
     s_ctx.user_data = user_data;
     s_ctx.enabled = 1;
-    s_ctx.sequence = 0;
+    s_ctx.run_traced = 1;
+    atomic_store(&s_ctx.sequence, 0);
+    atomic_store(&s_ctx.emitted, 0);
+    atomic_store(&s_ctx.delivered, 0);
+    atomic_store(&s_ctx.dropped, 0);
     memset(s_ctx.trace_id, 0, sizeof(s_ctx.trace_id));
 
     /* Register agent hooks */
@@ -237,17 +773,121 @@ void ac_trace_enable(ac_trace_handler_t handler, void *user_data) {
         .on_llm_request = on_llm_request,
         .on_llm_response = on_llm_response,
         .on_tool_start = on_tool_start,
-        .on_tool_end = on_tool_end
+        .on_tool_end = on_tool_end,
+        .on_mcp_connection = on_mcp_connection
     };
 
     ac_agent_set_hooks(&trace_hooks);
 }
 
+void ac_trace_enable(ac_trace_handler_t handler, void *user_data) {
+    if (!handler) {
+        return;
+    }
+    ring_stop();
+    trace_start(handler, user_data);
+}
+
+arc_err_t ac_trace_enable_async(
+    ac_trace_handler_t handler,
+    void *user_data,
+    const ac_trace_async_config_t *config
+) {
+    if (!handler) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    ring_stop();
+
+#ifdef ARC_HAS_THREADS
+    /* The consumer reads the handler: install it before the thread starts */
+    s_ctx.enabled = 0;
+    s_ctx.handler = handler;
+    s_ctx.user_data = user_data;
+    size_t capacity = config && config->capacity > 0 ?
+        config->capacity : AC_TRACE_ASYNC_DEFAULT_CAPACITY;
+    arc_err_t err = ring_start(capacity);
+    if (err != ARC_OK) {
+        s_ctx.handler = NULL;
+        return err;
+    }
+#else
+    (void)config;
+#endif
+
+    trace_start(handler, user_data);
+    return ARC_OK;
+}
+
 void ac_trace_disable(void) {
     s_ctx.enabled = 0;
-    s_ctx.handler = NULL;
-    s_ctx.user_data = NULL;
 
     /* Unregister hooks */
     ac_agent_set_hooks(NULL);
+
+    /* Queued events still go to the handler */
+    ring_stop();
+
+    s_ctx.handler = NULL;
+    s_ctx.user_data = NULL;
+}
+
+arc_err_t ac_trace_flush(uint32_t timeout_ms) {
+#ifdef ARC_HAS_THREADS
+    trace_ring_t *r = &s_ring;
+    if (!ring_running() || pthread_equal(pthread_self(), r->thread)) {
+        return ARC_OK;
+    }
+
+    size_t target = atomic_load_explicit(&r->head, memory_order_acquire);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    arc_err_t err = ARC_OK;
+    pthread_mutex_lock(&r->lock);
+    pthread_cond_signal(&r->wake);
+    while ((intptr_t)(atomic_load_explicit(&r->consumed, memory_order_acquire) - target) < 0) {
+        if (timeout_ms == 0) {
+            pthread_cond_wait(&r->drained, &r->lock);
+        } else if (pthread_cond_timedwait(&r->drained, &r->lock, &deadline) == ETIMEDOUT) {
+            err = ARC_ERR_TIMEOUT;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&r->lock);
+    return err;
+#else
+    (void)timeout_ms;
+    return ARC_OK;
+#endif
+}
+
+void ac_trace_set_sampling(const ac_trace_sampling_t *sampling) {
+    if (sampling) {
+        s_ctx.sampling = *sampling;
+    } else {
+        memset(&s_ctx.sampling, 0, sizeof(s_ctx.sampling));
+    }
+}
+
+void ac_trace_get_stats(ac_trace_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->emitted = atomic_load_explicit(&s_ctx.emitted, memory_order_relaxed);
+    stats->delivered = atomic_load_explicit(&s_ctx.delivered, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&s_ctx.dropped, memory_order_relaxed);
+#ifdef ARC_HAS_THREADS
+    if (ring_running()) {
+        stats->queued = atomic_load_explicit(&s_ring.head, memory_order_relaxed) -
+                        atomic_load_explicit(&s_ring.consumed, memory_order_relaxed);
+        stats->high_water = atomic_load_explicit(&s_ring.high_water, memory_order_relaxed);
+    }
+#endif
 }
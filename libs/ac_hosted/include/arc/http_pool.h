@@ -11,6 +11,13 @@
  * 2. LLM/MCP clients will automatically use pooled connections
  * 3. Call ac_http_pool_shutdown() at application exit
  *
+ * Pooled clients share one HTTP engine: concurrent requests from all
+ * borrowers are multiplexed as HTTP/2 streams over one connection per
+ * origin instead of one TCP+TLS connection each. Servers that only speak
+ * HTTP/1.1 get a connection per in-flight request, reused across
+ * borrowers. max_connections_per_host caps either case; with HTTP/1.1 a
+ * low cap queues requests behind each other.
+ *
  * This is an optional optimization for hosted platforms (Linux/Windows/macOS).
  * If not initialized, LLM/MCP clients fall back to creating their own connections.
  */
@@ -18,7 +25,9 @@
 #ifndef ARC_HTTP_POOL_H
 #define ARC_HTTP_POOL_H
 
+#include "arc/affinity.h"
 #include "arc/error.h"
+#include "arc/priority.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -30,8 +39,9 @@ extern "C" {
  * Forward Declarations
  *============================================================================*/
 
-/* HTTP client handle from ac_core port layer */
+/* HTTP client and engine handles from ac_core port layer */
 typedef struct arc_http_client arc_http_client_t;
+typedef struct arc_http_engine arc_http_engine_t;
 
 /*============================================================================
  * Pool Configuration
@@ -41,10 +51,17 @@ typedef struct arc_http_client arc_http_client_t;
  * @brief HTTP connection pool configuration
  */
 typedef struct {
-    size_t max_connections;        /**< Max pooled connections (default: 16) */
+    size_t max_connections;        /**< Max pooled clients borrowed at once (default: 16) */
     uint32_t idle_timeout_ms;      /**< Idle connection timeout (default: 60000) */
     uint32_t acquire_timeout_ms;   /**< Max wait time to acquire (default: 5000) */
     uint32_t default_request_timeout_ms; /**< Default request timeout (default: 30000) */
+    size_t max_connections_per_host; /**< Cap on connections per origin (0 = unlimited) */
+    int disable_multiplex;         /**< 1 = each pooled client keeps its own connection */
+    const char *const *warm_urls;  /**< NULL-terminated URLs to pre-connect to (optional, copied) */
+    size_t warm_connections;       /**< Connections to pre-open per warm URL (default: 1) */
+    uint32_t keepalive_interval_ms; /**< HEAD probe to each warm URL this often (0 = off) */
+    int external_loop;             /**< 1 = no pool threads, host drives I/O (see arc/runtime.h) */
+    const ac_affinity_t *io_affinity; /**< Pin the I/O and maintenance threads (copied, NULL = unpinned) */
 } ac_http_pool_config_t;
 
 /*============================================================================
@@ -57,14 +74,44 @@ typedef struct {
  * Call once at application startup, before creating any LLM/MCP clients.
  * Thread-safe: can be called from multiple threads, only first call takes effect.
  *
+ * Starts a maintenance thread that reaps idle clients and, when warm_urls
+ * is set, opens connections to them (TCP+TLS handshake with a HEAD
+ * request) right away and re-probes them every keepalive_interval_ms, so
+ * the first real request finds a live connection. Warming runs in the
+ * background; init does not wait for it. Without multiplexing one
+ * connection per URL is warmed regardless of warm_connections.
+ *
+ * With external_loop the pool starts no threads at all: the shared engine
+ * runs inside ac_runtime_process() on the host's loop, warm URLs are not
+ * probed and acquire expires idle clients itself.
+ *
  * @param config  Pool configuration (NULL for defaults)
  * @return ARC_OK on success
  */
 arc_err_t ac_http_pool_init(const ac_http_pool_config_t *config);
 
+/**
+ * @brief Initialize the pool on a background thread
+ *
+ * Same as ac_http_pool_init(), but returns at once: curl and TLS set-up,
+ * the warm clients and the engine are created on a short-lived thread,
+ * and warm URLs are pre-connected after that as usual. For applications
+ * that want their first prompt up before any network set-up is done.
+ *
+ * Every other pool function, ac_http_pool_is_initialized() included,
+ * first waits for a pending background init, so providers created early
+ * still find the pool. An external_loop config is initialized right away.
+ *
+ * @param config  Pool configuration (NULL for defaults; copied)
+ * @return ARC_OK when the init started (its own failure is only logged)
+ */
+arc_err_t ac_http_pool_init_async(const ac_http_pool_config_t *config);
+
 /**
  * @brief Check if the pool is initialized
  *
+ * Waits for a pending ac_http_pool_init_async().
+ *
  * @return 1 if initialized, 0 otherwise
  */
 int ac_http_pool_is_initialized(void);
@@ -84,14 +131,32 @@ void ac_http_pool_shutdown(void);
 /**
  * @brief Acquire an HTTP client from the pool
  *
- * Blocks until a connection is available or timeout expires.
+ * Returns the most recently released idle client without locking; blocks
+ * only when none is idle and max_connections are borrowed, until one is
+ * released or timeout expires.
  * The returned client must be released with ac_http_pool_release().
  *
+ * Same as ac_http_pool_acquire_priority() with AC_PRIORITY_NORMAL.
+ *
  * @param timeout_ms  Max wait time in milliseconds (0 = use default)
  * @return HTTP client handle, or NULL on timeout/error
  */
 arc_http_client_t *ac_http_pool_acquire(uint32_t timeout_ms);
 
+/**
+ * @brief Acquire an HTTP client for a request of the given class
+ *
+ * Blocked callers queue per class and released clients go to the caller
+ * arc/priority.h picks: interactive requests overtake queued batch ones,
+ * which still get their weighted share. While anyone is queued, new
+ * callers queue too instead of taking a client on the way in.
+ *
+ * @param timeout_ms  Max wait time in milliseconds (0 = use default)
+ * @param priority    Request class
+ * @return HTTP client handle, or NULL on timeout/error
+ */
+arc_http_client_t *ac_http_pool_acquire_priority(uint32_t timeout_ms, ac_priority_t priority);
+
 /**
  * @brief Release an HTTP client back to the pool
  *
@@ -102,10 +167,60 @@ arc_http_client_t *ac_http_pool_acquire(uint32_t timeout_ms);
  */
 void ac_http_pool_release(arc_http_client_t *client);
 
+/**
+ * @brief Engine the pooled clients share
+ *
+ * Requests that must not block their caller (the model calls of stepped
+ * agent runs) are submitted to it directly.
+ *
+ * @return Engine, NULL if the pool is not initialized or multiplexing is off
+ */
+arc_http_engine_t *ac_http_pool_engine(void);
+
+/*============================================================================
+ * Warm URLs
+ *============================================================================*/
+
+/**
+ * @brief Add a URL to the warm set after init
+ *
+ * The maintenance thread pre-connects to it on its next pass and then
+ * keeps it alive with the keepalive_interval_ms probes, exactly like the
+ * init-time warm_urls. MCP clients register their server URL here, so
+ * many servers behind one gateway share a few warm connections. URLs
+ * whose origin is already warm are accepted without adding an entry, as
+ * are all URLs on an external_loop pool (nothing probes there).
+ *
+ * @param url  URL to probe (copied)
+ * @return ARC_OK, ARC_ERR_NOT_INITIALIZED, or ARC_ERR_NO_MEMORY when the
+ *         warm set is full
+ */
+arc_err_t ac_http_pool_add_warm_url(const char *url);
+
 /*============================================================================
  * Pool Statistics
  *============================================================================*/
 
+/** Origins reported in ac_http_pool_stats_t */
+#define AC_HTTP_POOL_MAX_ORIGINS 16
+
+/** Size of ac_http_pool_origin_stats_t.origin: the engine's ARC_HTTP_ORIGIN_MAX */
+#define AC_HTTP_POOL_ORIGIN_MAX 128
+
+/**
+ * @brief Per-origin counters (multiplexed pools only)
+ */
+typedef struct {
+    char origin[AC_HTTP_POOL_ORIGIN_MAX];  /**< scheme://host:port */
+    size_t active_streams;         /**< Requests in flight */
+    uint64_t total_requests;       /**< Requests sent */
+    uint64_t connections_opened;   /**< TCP+TLS connections opened */
+    uint64_t http2_requests;       /**< Requests served over HTTP/2 */
+} ac_http_pool_origin_stats_t;
+
+/** Buckets of ac_http_pool_stats_t.acquire_latency */
+#define AC_HTTP_POOL_LATENCY_BUCKETS 24
+
 /**
  * @brief Pool statistics
  */
@@ -119,6 +234,17 @@ typedef struct {
     uint64_t pool_hits;            /**< Reused existing connection */
     uint64_t pool_misses;          /**< Created new connection */
     uint64_t timeouts;             /**< Acquire timeouts */
+    uint64_t contended_acquires;   /**< Took the locked path (no idle client) */
+    /** Acquire latency histogram: bucket 0 < 1us, bucket i < 2^i us, last = longer */
+    uint64_t acquire_latency[AC_HTTP_POOL_LATENCY_BUCKETS];
+    int multiplexed;               /**< Clients share the HTTP/2 engine */
+    size_t origin_count;           /**< Valid entries in origins */
+    ac_http_pool_origin_stats_t origins[AC_HTTP_POOL_MAX_ORIGINS];
+    /* Process-wide traffic (all clients, see arc_http_get_io_stats) */
+    uint64_t body_bytes;           /**< Request bodies before compression */
+    uint64_t body_wire_bytes;      /**< Request bodies as sent */
+    uint64_t response_bytes;       /**< Response bodies after decoding */
+    uint64_t response_wire_bytes;  /**< Response bodies as received */
 } ac_http_pool_stats_t;
 
 /**
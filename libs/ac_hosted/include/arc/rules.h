@@ -12,6 +12,7 @@
 #include <arc/platform.h>
 #include <arc/error.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -84,11 +85,32 @@ arc_err_t ac_rules_add(
     int priority
 );
 
+/**
+ * @brief All rules as prompt text, shared
+ *
+ * Each rule's content on its own line, preceded by a newline, in
+ * priority order: the text ac_rules_build_prompt() appends to the base
+ * prompt. Built once per ac_rules_version() and owned by the manager;
+ * valid until rules are added or cleared, or the manager is destroyed.
+ *
+ * @param rules  Rules manager
+ * @return Prompt text (do not free), NULL if there are no rules
+ */
+const char *ac_rules_prompt(const ac_rules_t *rules);
+
+/**
+ * @brief Counter bumped whenever rules are added or cleared
+ *
+ * @param rules  Rules manager
+ * @return Version
+ */
+uint64_t ac_rules_version(const ac_rules_t *rules);
+
 /**
  * @brief Build system prompt with all rules
  *
  * Generates a system prompt string by combining all rules
- * in priority order.
+ * in priority order: base_prompt followed by ac_rules_prompt().
  *
  * @param rules        Rules manager
  * @param base_prompt  Base system prompt (optional, can be NULL)
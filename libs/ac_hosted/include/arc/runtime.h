@@ -0,0 +1,93 @@
+/**
+ * @file runtime.h
+ * @brief Host Event Loop Integration (Hosted Feature)
+ *
+ * Lets an application that already runs its own epoll/kqueue/libuv loop
+ * drive arc's network I/O from that loop instead of from arc's threads.
+ * Initialize the HTTP pool with external_loop set; it then starts no
+ * threads and its shared engine only makes progress inside
+ * ac_runtime_process().
+ *
+ * Usage:
+ * @code
+ * ac_http_pool_config_t cfg = { .external_loop = 1 };
+ * ac_http_pool_init(&cfg);
+ *
+ * // Register ac_runtime_fd() for readability in the host loop, arm a
+ * // timer with ac_runtime_timeout_ms(), and on either event:
+ * ac_runtime_process(0);
+ * @endcode
+ *
+ * Requests made through pooled clients still block their caller until
+ * the response arrives, so they must not be made from the loop thread
+ * itself: run agents with ac_agent_run_async() (or the swarm) and let the
+ * loop only dispatch I/O. Everything that talks to the pool from other
+ * threads wakes the loop through the fd.
+ *
+ * Stepped runs (ac_agent_start/ac_agent_step) may be driven from the
+ * loop thread: their model requests go through the engine and complete
+ * inside ac_runtime_process(), which fires the agent's wake callback.
+ * Tool batches, and model calls ac_llm_chat_submit() refuses (see
+ * llm.h), still run on the session executor.
+ *
+ * MCP SSE transports keep their event stream on the engine too, so the
+ * pool starts no thread for them; their requests and disconnect wait on
+ * the loop like any other pooled request.
+ */
+
+#ifndef ARC_HOSTED_RUNTIME_H
+#define ARC_HOSTED_RUNTIME_H
+
+#include "arc/error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Host Event Loop
+ *============================================================================*/
+
+/**
+ * @brief Descriptor to watch for readability
+ *
+ * Becomes readable when sockets have data, a transfer is submitted or
+ * cancelled, or shutdown is requested. Stable for the pool's lifetime.
+ *
+ * @return fd, or -1 if the pool is not an external_loop pool or the
+ *         platform has no epoll/kqueue (then call ac_runtime_process()
+ *         with a short timeout periodically). On Windows the engine
+ *         waits on an I/O completion port, so ac_runtime_process(-1) on
+ *         a dedicated thread sleeps until there is work, like the pool's
+ *         own I/O thread.
+ */
+int ac_runtime_fd(void);
+
+/**
+ * @brief Milliseconds until ac_runtime_process() must run even without fd activity
+ *
+ * Recompute after every ac_runtime_process() call.
+ *
+ * @return Timeout (0 = now), or -1 if no timer is pending
+ */
+int ac_runtime_timeout_ms(void);
+
+/**
+ * @brief Run one round of I/O on the calling thread
+ *
+ * Waits up to timeout_ms (0 = just handle what is ready, -1 = until
+ * something happens or the next timer) and then dispatches socket events,
+ * expired timers, new submissions and completions. Must always be called
+ * from the same thread.
+ *
+ * @param timeout_ms  Max wait
+ * @return ARC_OK, ARC_ERR_NOT_INITIALIZED (no pool or shutting down),
+ *         ARC_ERR_INVALID_STATE (pool not in external_loop mode)
+ */
+arc_err_t ac_runtime_process(int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_RUNTIME_H */
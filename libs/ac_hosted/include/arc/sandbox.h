@@ -124,6 +124,44 @@ typedef struct {
     /* Behavior flags */
     int strict_mode;                    /* Deny everything not explicitly allowed */
     int log_violations;                 /* Log access violations */
+
+    /*
+     * Command screening, in addition to the built-in lists (NULL = none).
+     * Patterns are matched on whole shell words: "rm -rf /" matches
+     * `rm  -rf /tmp` and `'rm' -rf /`, but not `echo "rm -rf /"`. The
+     * last word of a pattern matches as a prefix unless the pattern ends
+     * with a space ("sudo " is the word sudo, "mkfs" also finds mkfs.ext4).
+     * A command run by path also matches by name (/usr/bin/sudo as sudo).
+     */
+    const char **dangerous_patterns;    /* NULL-terminated; need confirmation */
+    const char **safe_patterns;         /* NULL-terminated; exempt a dangerous
+                                           match starting at the same word */
+
+    /*
+     * Resource limits (Linux cgroup v2, ignored elsewhere). With
+     * cgroup_parent set, each command runs in a cgroup of its own created
+     * below it, which is removed, killing whatever the command left
+     * running, once the command has finished. cgroup_parent must be a
+     * cgroup this process may create groups and move processes in
+     * (a systemd Delegate=yes unit or a container's own cgroup) and that
+     * this process is not itself a member of. A limit that cannot be set
+     * makes the commands fail rather than run unlimited.
+     */
+    const char *cgroup_parent;          /* e.g. /sys/fs/cgroup/agents (NULL = none) */
+    int cpu_max_percent;                /* cpu.max, % of one CPU (0 = no limit) */
+    size_t memory_max;                  /* memory.max, bytes (0 = no limit) */
+    int pids_max;                       /* pids.max (0 = no limit) */
+
+    /*
+     * Admission (POSIX). Commands beyond max_concurrent_execs wait in a
+     * queue; a freed slot goes to the waiting owner with the fewest
+     * commands running, the longest waiting among equals, and no owner
+     * holds more than max_execs_per_owner slots. The owner is
+     * ac_sandbox_exec_opts_t.owner, else that of the tool call running
+     * the command (the agent, see ac_tool_ctx_t.owner).
+     */
+    int max_concurrent_execs;           /* Commands running at once (0 = no limit) */
+    int max_execs_per_owner;            /* Of those, per owner (0 = no limit) */
 } ac_sandbox_config_t;
 
 /*============================================================================
@@ -191,6 +229,13 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config);
  *
  * WARNING: This is typically irreversible for the current process.
  *
+ * On Linux this installs a seccomp filter on all threads, inherited by
+ * every command run afterwards: without allow_network only AF_UNIX
+ * sockets can be created, and in strict mode without allow_process_exec
+ * nothing can be executed. Network commands are then left to the kernel
+ * rather than confirmed one by one, so ALLOW_SESSION answers no longer
+ * open the network.
+ *
  * @param sandbox  Sandbox handle
  * @return ARC_OK on success, error code otherwise
  */
@@ -218,6 +263,32 @@ void ac_sandbox_destroy(ac_sandbox_t *sandbox);
  * Capability Query API
  *============================================================================*/
 
+/**
+ * @brief What the sandbox can use on this machine
+ *
+ * Probed once per process, on first use, and shared by every sandbox.
+ */
+typedef struct {
+    const char *platform;               /* "Linux", "macOS", "Windows", ... */
+    ac_sandbox_backend_t backend;
+    const char *backend_name;           /* As ac_sandbox_backend_name() */
+    ac_sandbox_level_t level;
+    int landlock_abi;                   /* Landlock ABI version (0 = none) */
+    int seccomp;                        /* Seccomp filters available */
+    const char *info;                   /* As ac_sandbox_platform_info() */
+} ac_sandbox_caps_t;
+
+/**
+ * @brief Get the probed capabilities
+ *
+ * The first call probes the kernel; later calls, from any thread, return
+ * the same result without system calls. The capability queries below
+ * all read from it, so creating sandboxes does not probe again.
+ *
+ * @return Capabilities (static, never NULL)
+ */
+const ac_sandbox_caps_t *ac_sandbox_capabilities(void);
+
 /**
  * @brief Check if sandboxing is supported on this platform
  *
@@ -348,7 +419,8 @@ const char *ac_sandbox_denial_reason(void);
  *
  * This is the RECOMMENDED way to use sandbox for CLI tools.
  * Instead of sandboxing the main process, this function:
- * 1. Forks a child process
+ * 1. Spawns a child process (posix_spawn on POSIX, so launch cost does not
+ *    grow with the size of the parent)
  * 2. Applies sandbox restrictions in the child
  * 3. Executes the command
  * 4. Returns the result to the parent
@@ -373,11 +445,12 @@ arc_err_t ac_sandbox_exec(
 /**
  * @brief Execute a command in sandbox with timeout
  *
- * Same as ac_sandbox_exec but with timeout support.
+ * Same as ac_sandbox_exec but with timeout support. See
+ * ac_sandbox_exec_ex() for what happens at the deadline.
  *
  * @param sandbox      Sandbox configuration
  * @param command      Command to execute
- * @param output       Output buffer
+ * @param output       Output buffer (stdout and stderr as they arrive)
  * @param output_size  Size of output buffer
  * @param exit_code    Pointer to receive exit code
  * @param timeout_ms   Timeout in milliseconds (0 = no timeout)
@@ -392,6 +465,216 @@ arc_err_t ac_sandbox_exec_timeout(
     int timeout_ms
 );
 
+/** Default delay between SIGTERM and SIGKILL when a command times out */
+#define AC_SANDBOX_KILL_GRACE_MS 2000
+
+/**
+ * @brief Stream a chunk of command output came from
+ */
+typedef enum {
+    AC_SANDBOX_STDOUT,
+    AC_SANDBOX_STDERR
+} ac_sandbox_stream_t;
+
+/**
+ * @brief Output callback, called on the executing thread as output arrives
+ *
+ * @param stream     Which stream the data came from
+ * @param data       Output bytes (not NUL-terminated)
+ * @param len        Number of bytes
+ * @param user_data  ac_sandbox_exec_opts_t.user_data
+ */
+typedef void (*ac_sandbox_output_fn)(
+    ac_sandbox_stream_t stream,
+    const char *data,
+    size_t len,
+    void *user_data
+);
+
+/**
+ * @brief Resources used by one command, children included
+ *
+ * From the command's cgroup when ac_sandbox_config_t.cgroup_parent is
+ * set, else from the shell's rusage, which only counts children it
+ * waited for and no IO done through the page cache.
+ */
+typedef struct {
+    uint64_t cpu_usec;                  /* User + system CPU time */
+    uint64_t memory_peak;               /* Peak memory, bytes */
+    uint64_t io_read_bytes;             /* Block IO */
+    uint64_t io_write_bytes;
+    int from_cgroup;                    /* Counted by the cgroup */
+} ac_sandbox_usage_t;
+
+/**
+ * @brief Options for ac_sandbox_exec_ex()
+ *
+ * All fields are optional; zero means the default.
+ */
+typedef struct {
+    int timeout_ms;                     /* Hard deadline (0 = none) */
+    int kill_grace_ms;                  /* SIGTERM to SIGKILL (0 = AC_SANDBOX_KILL_GRACE_MS) */
+
+    char *output;                       /* stdout, plus stderr unless error_output is set */
+    size_t output_size;
+    char *error_output;                 /* stderr on its own (NULL: into output) */
+    size_t error_output_size;
+
+    ac_sandbox_output_fn on_output;     /* Streamed output, including what the buffers drop */
+    void *user_data;
+
+    ac_sandbox_usage_t *usage;          /* Out: filled once the command ran (may be NULL) */
+
+    const void *owner;                  /* Share of max_concurrent_execs (NULL: the tool call's) */
+
+    const volatile int *stop;           /* Terminated once *stop != 0, e.g. set by on_output (POSIX) */
+} ac_sandbox_exec_opts_t;
+
+/**
+ * @brief Execute a command in sandbox, streaming its output
+ *
+ * The command runs in its own process group. Its stdout and stderr are
+ * read as they arrive, without blocking on either. Each chunk goes to
+ * on_output and is appended to the buffers, which are truncated when
+ * full and stay NUL-terminated.
+ *
+ * At the deadline the whole process group gets SIGTERM, then SIGKILL
+ * kill_grace_ms later if it is still running. The same happens once
+ * *stop is set, which lets on_output end a command whose output is no
+ * longer wanted. The buffers keep the output captured until then. Background jobs left behind by a command
+ * that has exited do not hold up the return, even if they keep the
+ * output pipes open.
+ *
+ * With max_concurrent_execs set, an approved command may first wait for
+ * a slot; the deadline only starts once it runs.
+ *
+ * @param sandbox    Sandbox configuration
+ * @param command    Command to execute
+ * @param opts       Options (NULL: no timeout, output discarded)
+ * @param exit_code  Pointer to receive exit code (128 + signal if killed,
+ *                   -1 on timeout or stop; can be NULL)
+ * @return ARC_OK when the command ran, ARC_ERR_TIMEOUT on timeout,
+ *         ARC_ERR_CANCELLED if stopped through opts->stop,
+ *         ARC_ERR_INVALID_ARG if the sandbox blocked it
+ */
+arc_err_t ac_sandbox_exec_ex(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
+);
+
+/*============================================================================
+ * Captured Output
+ *============================================================================*/
+
+/** Complete output of a command (see ac_sandbox_exec_capture()) */
+typedef struct ac_sandbox_output ac_sandbox_output_t;
+
+/**
+ * @brief Execute a command in sandbox, keeping all of its output
+ *
+ * Like ac_sandbox_exec_ex(), but stdout and stderr are also written, in
+ * the order they arrive, to an anonymous file (a memfd on Linux) that is
+ * mapped once the command is done. Nothing is truncated and no buffer
+ * has to be sized up front; read it whole or page it with
+ * ac_sandbox_output_head() and ac_sandbox_output_tail(). The buffers and
+ * on_output of opts still work as they do for ac_sandbox_exec_ex().
+ *
+ * @param sandbox    Sandbox configuration
+ * @param command    Command to execute
+ * @param opts       Options (may be NULL)
+ * @param output     Receives the output on ARC_OK, ARC_ERR_TIMEOUT and
+ *                   ARC_ERR_CANCELLED (free with ac_sandbox_output_free())
+ * @param exit_code  Pointer to receive exit code (can be NULL)
+ * @return As ac_sandbox_exec_ex(), or ARC_ERR_IO if the output could not
+ *         be stored
+ */
+arc_err_t ac_sandbox_exec_capture(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    const ac_sandbox_exec_opts_t *opts,
+    ac_sandbox_output_t **output,
+    int *exit_code
+);
+
+/**
+ * @brief All captured output
+ * @param output  Captured output (NULL: empty)
+ * @param len     Receives its length
+ * @return The bytes, valid until ac_sandbox_output_free() (not NUL-terminated)
+ */
+const char *ac_sandbox_output_data(const ac_sandbox_output_t *output, size_t *len);
+
+/**
+ * @brief At most max_bytes from the start, cut after a complete line
+ *
+ * Cut at max_bytes when the first line alone is longer.
+ *
+ * @return The start of the output; *len receives the part's length
+ */
+const char *ac_sandbox_output_head(const ac_sandbox_output_t *output, size_t max_bytes,
+                                   size_t *len);
+
+/**
+ * @brief At most max_bytes from the end, starting at a line boundary
+ *
+ * Starts mid-line when the last line alone is longer.
+ *
+ * @return Start of the part; *len receives its length
+ */
+const char *ac_sandbox_output_tail(const ac_sandbox_output_t *output, size_t max_bytes,
+                                   size_t *len);
+
+/**
+ * @brief Release captured output
+ */
+void ac_sandbox_output_free(ac_sandbox_output_t *output);
+
+/*============================================================================
+ * Worker Pool
+ *============================================================================*/
+
+/** Workers started by ac_sandbox_pool_start() when 0 is requested */
+#define AC_SANDBOX_POOL_DEFAULT_WORKERS 4
+
+/**
+ * @brief Run this sandbox's commands on pre-started helper processes
+ *
+ * Forks a small zygote process, which forks up to workers helpers.
+ * Afterwards ac_sandbox_exec_ex() and its wrappers hand each approved
+ * command to an idle helper over a UNIX socket instead of starting it
+ * from this process; when all helpers are busy the command runs
+ * directly. Output, deadline and exit status behave the same either way.
+ * A helper that dies is replaced on the next command.
+ *
+ * With enforce set, the zygote enters the sandbox (ac_sandbox_enter())
+ * before forking, so every command run by the pool is under the kernel
+ * restrictions without the ruleset being rebuilt per command. This
+ * process itself stays unrestricted. Without it, helpers are as
+ * unrestricted as direct runs. On Linux, enforced commands cannot write
+ * outside the workspace and path rules, /dev/null included, which is why
+ * direct runs do not apply Landlock.
+ *
+ * The zygote is a fork of this process: call this early, before other
+ * threads are started. Helpers have stdin on /dev/null and none of this
+ * process's other files open.
+ *
+ * @param sandbox  Sandbox configuration
+ * @param workers  Number of helpers (0 = AC_SANDBOX_POOL_DEFAULT_WORKERS)
+ * @param enforce  Apply the sandbox in the helpers
+ * @return ARC_OK on success, ARC_ERR_INVALID_STATE if already started,
+ *         ARC_ERR_NOT_IMPLEMENTED on Windows
+ */
+arc_err_t ac_sandbox_pool_start(ac_sandbox_t *sandbox, int workers, int enforce);
+
+/**
+ * @brief Stop the helper processes (also done by ac_sandbox_destroy())
+ *
+ * Must not be called while commands are running on the pool.
+ */
+void ac_sandbox_pool_stop(ac_sandbox_t *sandbox);
+
 /*============================================================================
  * Human-in-the-Loop Confirmation API
  *============================================================================*/
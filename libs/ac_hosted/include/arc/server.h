@@ -0,0 +1,166 @@
+/**
+ * @file server.h
+ * @brief Multi-Tenant Agent Server (Hosted Feature)
+ *
+ * Serves the agents of a session over HTTP/1.1, streaming each run to
+ * its client as Server-Sent Events. One event-loop thread multiplexes
+ * every connection; agent runs execute on the session executor and hand
+ * their stream events to the loop, so an open stream costs a socket and
+ * a buffer, not a thread.
+ *
+ * Routes (tenant from the tenant header, default "X-Tenant"):
+ * @code
+ * GET    /healthz                          200 {"status":"ok"}
+ * POST   /v1/conversations                 201 {"id":"..."}
+ * POST   /v1/conversations/{id}/messages   200 text/event-stream
+ *        body {"message":"..."}
+ * DELETE /v1/conversations/{id}            204
+ * @endcode
+ *
+ * A message stream carries one SSE event per ac_stream_event_t, named
+ * after its type ("message_start", "delta", "content_block_stop", ...),
+ * and ends with a "done" event holding {"content":...} or {"error":...}.
+ * Conversations belong to the tenant that created them and answer 404 to
+ * any other. Limits are per tenant: more conversations or concurrent
+ * streams than allowed answer 429, a message to a busy conversation 409.
+ *
+ * Agents are pooled per tenant: a deleted or expired conversation returns
+ * its agent, which the next conversation of the tenant reuses with a
+ * fresh history. A tenant never has more agents than its
+ * max_conversations allows.
+ *
+ * Usage:
+ * @code
+ * ac_server_t *server = ac_server_create(session, &(ac_server_config_t){
+ *     .port = 8080,
+ *     .agent = { .instructions = "You are helpful.", .llm = llm },
+ *     .limits = { .max_conversations = 100, .max_streams = 8 },
+ * });
+ * ...
+ * ac_server_destroy(server);
+ * @endcode
+ */
+
+#ifndef ARC_HOSTED_SERVER_H
+#define ARC_HOSTED_SERVER_H
+
+#include <arc/agent.h>
+#include <arc/session.h>
+#include <arc/error.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_server ac_server_t;
+
+/**
+ * @brief Per-tenant limits (0 = unlimited)
+ */
+typedef struct {
+    size_t max_conversations;          /**< Open conversations (and pooled agents) */
+    size_t max_streams;                /**< Message streams running at once */
+} ac_server_limits_t;
+
+/**
+ * @brief Tenant admission and agent configuration
+ *
+ * Called on the loop thread for every /v1 request, before anything is
+ * created for it. limits holds the server defaults and may be changed
+ * for this tenant; params holds a copy of the server's agent parameters
+ * and may be changed for agents created for this request (its strings
+ * only need to live until the callback's next invocation). The stream
+ * callback in params is always replaced by the server's.
+ *
+ * @param tenant         Tenant header value ("" if absent)
+ * @param authorization  Authorization header value (NULL if absent)
+ * @return ARC_OK to serve the request, anything else answers 403
+ */
+typedef arc_err_t (*ac_server_tenant_fn)(
+    const char *tenant,
+    const char *authorization,
+    ac_server_limits_t *limits,
+    ac_agent_params_t *params,
+    void *user_data
+);
+
+/**
+ * @brief Server configuration
+ */
+typedef struct {
+    const char *bind;                  /**< Listen address (default "127.0.0.1") */
+    uint16_t port;                     /**< Listen port (0 = any, see ac_server_port()) */
+    const char *tenant_header;         /**< Header naming the tenant (default "X-Tenant") */
+    ac_agent_params_t agent;           /**< Parameters of pooled agents (referenced, must
+                                            outlive the server) */
+    ac_server_limits_t limits;         /**< Default per-tenant limits */
+    ac_server_tenant_fn tenant;        /**< Admission callback (optional: admit all) */
+    void *user_data;                   /**< Passed to tenant */
+    size_t max_body;                   /**< Largest request body (default 1 MiB) */
+    size_t max_connections;            /**< Open sockets (default 4096) */
+    size_t max_pending_output;         /**< Unsent stream bytes per connection before the run
+                                            is cancelled and the connection closed (default
+                                            4 MiB) */
+    uint32_t idle_timeout_ms;          /**< Close conversations idle this long (default 10 min) */
+    int drive_runtime;                 /**< Also dispatch the HTTP pool's I/O (external_loop pool,
+                                            arc/runtime.h) from the server loop */
+} ac_server_config_t;
+
+/**
+ * @brief Server counters
+ */
+typedef struct {
+    size_t connections;                /**< Open client sockets */
+    size_t tenants;                    /**< Tenants seen */
+    size_t conversations;              /**< Open conversations */
+    size_t streams;                    /**< Message streams running */
+    size_t agents;                     /**< Agents created (busy + pooled) */
+    uint64_t requests;                 /**< Requests parsed */
+    uint64_t rejected;                 /**< Requests refused by a limit (429/409) */
+} ac_server_stats_t;
+
+/*============================================================================
+ * Server API
+ *============================================================================*/
+
+/**
+ * @brief Bind and start serving
+ *
+ * Starts the loop thread. Agents are created in session as needed; the
+ * session must outlive the server.
+ *
+ * @param session  Session owning the agents (with executor threads)
+ * @param config   Configuration (agent.llm required)
+ * @return Server, NULL on error (bad config, address in use)
+ */
+ac_server_t *ac_server_create(ac_session_t *session, const ac_server_config_t *config);
+
+/**
+ * @brief Port the server listens on (the chosen one if config.port was 0)
+ */
+uint16_t ac_server_port(const ac_server_t *server);
+
+/**
+ * @brief Snapshot of the counters (thread-safe)
+ */
+arc_err_t ac_server_get_stats(ac_server_t *server, ac_server_stats_t *stats);
+
+/**
+ * @brief Stop serving and free the server
+ *
+ * Cancels the running streams and waits for their runs, then closes
+ * every connection. The agents stay in the session until it closes.
+ */
+void ac_server_destroy(ac_server_t *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_SERVER_H */
@@ -18,6 +18,7 @@
 #include <arc/tool.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -67,10 +68,13 @@ typedef struct {
  */
 typedef struct ac_skill {
     ac_skill_meta_t meta;           /* Parsed frontmatter */
-    char *content;                  /* Markdown body (NULL if not loaded) */
+    const char *content;            /* Markdown body (NULL if not loaded), NUL-terminated
+                                       view into the mapped SKILL.md */
+    size_t content_len;             /* Length of content */
     char *dir_path;                 /* Skill directory path */
     ac_skill_state_t state;         /* Current state */
     struct ac_skill *next;          /* Linked list pointer */
+    struct skill_file *file;        /* Internal: SKILL.md mapping content points into */
 } ac_skill_t;
 
 /*============================================================================
@@ -101,7 +105,9 @@ void ac_skills_destroy(ac_skills_t *skills);
  * @brief Discover skills from directory (metadata only)
  *
  * Scans directory for subdirectories containing SKILL.md files.
- * Only loads name and description for efficient discovery.
+ * Only loads name and description for efficient discovery. Entries are
+ * statted and parsed by several threads at once; with an index (see
+ * ac_skills_set_index()) unchanged SKILL.md files are not read at all.
  *
  * Directory structure expected:
  *   skills_dir/
@@ -120,6 +126,20 @@ arc_err_t ac_skills_discover_dir(
     const char *skills_dir
 );
 
+/**
+ * @brief Keep parsed frontmatter in an index file between runs
+ *
+ * ac_skills_discover_dir() then stats each SKILL.md and reads only those
+ * whose mtime or size differs from the index, rewriting the index when
+ * anything changed. Several skill directories may share one index.
+ * Without an index every SKILL.md is read and parsed.
+ *
+ * @param skills      Skills manager
+ * @param index_path  Index file, created if missing (NULL = no index)
+ * @return ARC_OK on success
+ */
+arc_err_t ac_skills_set_index(ac_skills_t *skills, const char *index_path);
+
 /**
  * @brief Discover a single skill from directory
  *
@@ -223,15 +243,101 @@ size_t ac_skills_enabled_count(const ac_skills_t *skills);
  */
 const ac_skill_t *ac_skills_list(const ac_skills_t *skills);
 
+/**
+ * @brief Counter bumped whenever skills are added, changed, removed,
+ *        enabled or disabled
+ *
+ * Compare with the value seen when a discovery or active prompt was
+ * built to know when to build it again.
+ *
+ * @param skills  Skills manager
+ * @return Generation
+ */
+uint64_t ac_skills_generation(const ac_skills_t *skills);
+
+/*============================================================================
+ * Hot Reload
+ *============================================================================*/
+
+/**
+ * @brief Watch discovered skills for changes
+ *
+ * Tracks the directories given to ac_skills_discover_dir() (new and
+ * removed skill folders) and every skill folder (SKILL.md edits), with
+ * inotify on Linux and kqueue on macOS/BSD; elsewhere each
+ * ac_skills_watch_poll() stats them instead. Nothing changes until
+ * ac_skills_watch_poll() is called.
+ *
+ * @param skills  Skills manager
+ * @param enable  true to start watching, false to stop
+ * @return ARC_OK, ARC_ERR_MEMORY
+ */
+arc_err_t ac_skills_watch(ac_skills_t *skills, bool enable);
+
+/**
+ * @brief Descriptor that becomes readable when a watched file changes
+ *
+ * For adding to an application's poll()/epoll loop.
+ *
+ * @param skills  Skills manager
+ * @return File descriptor, -1 when not watching or on platforms that
+ *         poll by stat()
+ */
+int ac_skills_watch_fd(const ac_skills_t *skills);
+
+/**
+ * @brief Apply changes to watched skills (non-blocking)
+ *
+ * Only skills whose SKILL.md changed are re-read: their metadata is
+ * replaced, enabled skills get their new content, and skills whose
+ * SKILL.md is gone are dropped. A SKILL.md that no longer parses keeps
+ * the previous version. When anything changed, ac_skills_generation()
+ * advances and, given a registry holding the tool from
+ * ac_skills_create_tool(), that tool's description is rebuilt.
+ *
+ * Skill pointers and content obtained earlier may be invalid
+ * afterwards. Call it only while no tool from the registry is running,
+ * e.g. between agent requests.
+ *
+ * @param skills    Skills manager
+ * @param registry  Registry with the skill tool (may be NULL)
+ * @return Number of skills added, changed or removed
+ */
+size_t ac_skills_watch_poll(ac_skills_t *skills, ac_tool_registry_t *registry);
+
 /*============================================================================
  * Prompt Generation
  *============================================================================*/
 
+/**
+ * @brief Discovery prompt, shared
+ *
+ * Same text as ac_skills_build_discovery_prompt(), built once per
+ * ac_skills_generation() and owned by the manager. Valid until skills
+ * change (ac_skills_generation() advances) or the manager is destroyed.
+ *
+ * @param skills  Skills manager
+ * @return Prompt (do not free), NULL if empty
+ */
+const char *ac_skills_discovery_prompt(const ac_skills_t *skills);
+
+/**
+ * @brief Active prompt, shared
+ *
+ * Same text as ac_skills_build_active_prompt(), with the lifetime of
+ * ac_skills_discovery_prompt().
+ *
+ * @param skills  Skills manager
+ * @return Prompt (do not free), NULL if no enabled skills
+ */
+const char *ac_skills_active_prompt(const ac_skills_t *skills);
+
 /**
  * @brief Build discovery prompt (list of all available skills)
  *
  * Generates a compact list of skill names and descriptions.
- * Use this in system prompt for skill awareness.
+ * Use this in system prompt for skill awareness. Returns a copy of
+ * ac_skills_discovery_prompt().
  *
  * Format:
  *   <available-skills>
@@ -248,7 +354,8 @@ char *ac_skills_build_discovery_prompt(const ac_skills_t *skills);
  * @brief Build active prompt (full instructions for enabled skills)
  *
  * Generates detailed instructions from all enabled skills.
- * Includes full SKILL.md content.
+ * Includes full SKILL.md content. Returns a copy of
+ * ac_skills_active_prompt().
  *
  * Format:
  *   <active-skills>
@@ -262,6 +369,81 @@ char *ac_skills_build_discovery_prompt(const ac_skills_t *skills);
  */
 char *ac_skills_build_active_prompt(const ac_skills_t *skills);
 
+/*============================================================================
+ * Relevance Selection
+ *============================================================================*/
+
+/**
+ * @brief Scores skills for a query, replacing the built-in BM25 ranking
+ *
+ * For plugging in e.g. an embedding backend. Called with every skill
+ * that has a name and description; only skills scored above 0 can be
+ * selected.
+ *
+ * @param query      User message
+ * @param skills     Skills to score
+ * @param count      Number of skills
+ * @param scores     Receives one score per skill (zeroed by the caller)
+ * @param user_data  From ac_skills_set_scorer()
+ * @return ARC_OK, or an error to fall back to BM25 for this query
+ */
+typedef arc_err_t (*ac_skill_scorer_fn)(
+    const char *query,
+    const ac_skill_t *const *skills,
+    size_t count,
+    double *scores,
+    void *user_data
+);
+
+/**
+ * @brief Replace the relevance scorer
+ *
+ * @param skills     Skills manager
+ * @param scorer     Scorer (NULL = built-in BM25)
+ * @param user_data  Passed to scorer
+ * @return ARC_OK on success
+ */
+arc_err_t ac_skills_set_scorer(ac_skills_t *skills, ac_skill_scorer_fn scorer, void *user_data);
+
+/**
+ * @brief Select the skills most relevant to a user message
+ *
+ * Without a scorer, ranks by BM25 over each skill's name, description
+ * and SKILL.md headings. The index behind it is built on first use and
+ * again after skills change; building it reads SKILL.md bodies not
+ * loaded yet. Skills sharing no term with the query are never selected.
+ *
+ * @param skills  Skills manager
+ * @param query   User message
+ * @param out     Receives up to top_k skills, most relevant first
+ * @param top_k   Capacity of out
+ * @return Number of skills selected
+ */
+size_t ac_skills_select(
+    const ac_skills_t *skills,
+    const char *query,
+    const ac_skill_t **out,
+    size_t top_k
+);
+
+/**
+ * @brief Build a discovery prompt with only the skills relevant to a query
+ *
+ * Same format as ac_skills_build_discovery_prompt(), listing the result
+ * of ac_skills_select(), so the prompt stays bounded by top_k however
+ * many skills are installed.
+ *
+ * @param skills  Skills manager
+ * @param query   User message
+ * @param top_k   Most skills to list
+ * @return Prompt string (caller must free), NULL if no skill is relevant
+ */
+char *ac_skills_build_relevant_prompt(
+    const ac_skills_t *skills,
+    const char *query,
+    size_t top_k
+);
+
 /*============================================================================
  * Tool Validation
  *============================================================================*/
@@ -286,11 +468,23 @@ arc_err_t ac_skills_validate_tools(
  * Skill Tool (for Agent to load skills dynamically)
  *============================================================================*/
 
+/**
+ * @brief Tool description, shared
+ *
+ * Same text as ac_skills_build_tool_description(), with the lifetime of
+ * ac_skills_discovery_prompt().
+ *
+ * @param skills  Skills manager
+ * @return Description (do not free), NULL on error
+ */
+const char *ac_skills_tool_description(const ac_skills_t *skills);
+
 /**
  * @brief Build tool description with available skills
  *
  * Generates a description string that includes the list of available skills.
- * Used as the description for the skill loading tool.
+ * Used as the description for the skill loading tool. Returns a copy of
+ * ac_skills_tool_description().
  *
  * @param skills  Skills manager
  * @return Description string (caller must free), NULL on error
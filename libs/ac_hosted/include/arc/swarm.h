@@ -0,0 +1,222 @@
+/**
+ * @file swarm.h
+ * @brief Agent Swarm Scheduler (Hosted Feature)
+ *
+ * Runs a DAG of agent tasks - fan-out, fan-in, handoffs - on the session
+ * executor (the work-stealing worker pool shared by async agent runs).
+ * A task starts once every task it depends on has finished; its prompt
+ * then carries their outputs. Failed tasks skip everything downstream.
+ *
+ * Usage:
+ * @code
+ * ac_swarm_t *swarm = ac_swarm_create(session, NULL);
+ *
+ * size_t experts[3], summary;
+ * for (int i = 0; i < 3; i++) {
+ *     ac_swarm_add(swarm, &(ac_swarm_task_t){
+ *         .name = names[i], .agent = expert_agents[i], .message = word
+ *     }, &experts[i]);
+ * }
+ * ac_swarm_add(swarm, &(ac_swarm_task_t){
+ *     .name = "summary", .agent = summary_agent, .message = "Summarize:"
+ * }, &summary);
+ * for (int i = 0; i < 3; i++) {
+ *     ac_swarm_depend(swarm, summary, experts[i]);
+ * }
+ *
+ * ac_swarm_run(swarm);
+ * printf("%s\n", ac_swarm_output(swarm, summary));
+ * ac_swarm_destroy(swarm);
+ * @endcode
+ *
+ * Concurrency is capped by max_inflight, which defaults to the HTTP
+ * pool's max_connections, so tasks never queue for a pooled connection
+ * while holding an executor worker. Provider quotas are enforced by the
+ * LLM client rate limiter (ac_llm_params_t.rate_limit); set it on the
+ * agents' llm params. Runs beyond the executor size queue in the
+ * executor: size it with ac_session_set_executor_threads().
+ */
+
+#ifndef ARC_HOSTED_SWARM_H
+#define ARC_HOSTED_SWARM_H
+
+#include <arc/error.h>
+#include <arc/session.h>
+#include <arc/agent.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Tasks
+ *============================================================================*/
+
+typedef struct ac_swarm ac_swarm_t;
+
+/**
+ * @brief Output of a finished dependency, as passed to build_prompt
+ */
+typedef struct {
+    const char *name;                  /* Task name */
+    const char *output;                /* Agent response */
+} ac_swarm_input_t;
+
+/**
+ * @brief Build a task's prompt from its dependencies' outputs
+ *
+ * Called on a worker thread just before the task starts.
+ *
+ * @param message    The task's message
+ * @param inputs     Outputs of the tasks it depends on, in the order the
+ *                   edges were added
+ * @param count      Number of inputs
+ * @param user_data  The task's user_data
+ * @return Prompt (malloc'd, freed by the swarm), NULL fails the task
+ */
+typedef char *(*ac_swarm_prompt_fn)(
+    const char *message,
+    const ac_swarm_input_t *inputs,
+    size_t count,
+    void *user_data
+);
+
+/**
+ * @brief Task definition
+ *
+ * An agent runs one conversation at a time: tasks sharing an agent run
+ * one after another even when both are ready.
+ */
+typedef struct {
+    const char *name;                  /* For reports and default prompts (copied, optional) */
+    ac_agent_t *agent;                 /* Runs the task */
+    const char *message;               /* Prompt (copied) */
+    ac_swarm_prompt_fn build_prompt;   /* Combine dependency outputs (NULL = default) */
+    void *user_data;                   /* Passed to build_prompt */
+} ac_swarm_task_t;
+
+/**
+ * @brief Task state
+ */
+typedef enum {
+    AC_SWARM_TASK_PENDING = 0,         /* Waiting for dependencies or a slot */
+    AC_SWARM_TASK_RUNNING,
+    AC_SWARM_TASK_DONE,
+    AC_SWARM_TASK_FAILED,              /* Agent returned no result */
+    AC_SWARM_TASK_SKIPPED              /* A dependency failed or was skipped */
+} ac_swarm_task_status_t;
+
+/*============================================================================
+ * Swarm Lifecycle
+ *============================================================================*/
+
+/**
+ * @brief Swarm configuration
+ */
+typedef struct {
+    size_t max_inflight;               /* Tasks running at once (0 = HTTP pool
+                                          max_connections, unlimited without a pool) */
+} ac_swarm_config_t;
+
+/**
+ * @brief Create an empty swarm
+ *
+ * @param session  Session whose executor runs the tasks
+ * @param config   Configuration (NULL for defaults)
+ * @return Swarm, NULL on error
+ */
+ac_swarm_t *ac_swarm_create(ac_session_t *session, const ac_swarm_config_t *config);
+
+/**
+ * @brief Add a task
+ *
+ * @param swarm  Swarm (not yet run)
+ * @param task   Task definition
+ * @param id     Out: task id, for edges and results
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_INVALID_STATE after
+ *         ac_swarm_run(), ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_swarm_add(ac_swarm_t *swarm, const ac_swarm_task_t *task, size_t *id);
+
+/**
+ * @brief Make task wait for on (and receive its output)
+ *
+ * A handoff is a single edge: the next agent gets the previous one's
+ * answer. Fan-in is several edges into one task.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG (unknown id, self edge),
+ *         ARC_ERR_INVALID_STATE after ac_swarm_run(), ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_swarm_depend(ac_swarm_t *swarm, size_t task, size_t on);
+
+/**
+ * @brief Run every task and wait for all of them
+ *
+ * A swarm runs once.
+ *
+ * @return ARC_OK when every task is done, ARC_ERR_BACKEND if any failed
+ *         or was skipped, ARC_ERR_INVALID_ARG if the edges form a cycle
+ *         (nothing runs), ARC_ERR_INVALID_STATE if already run
+ */
+arc_err_t ac_swarm_run(ac_swarm_t *swarm);
+
+/**
+ * @brief Destroy a swarm (not while ac_swarm_run() is in progress)
+ */
+void ac_swarm_destroy(ac_swarm_t *swarm);
+
+/*============================================================================
+ * Results and Report
+ *============================================================================*/
+
+ac_swarm_task_status_t ac_swarm_status(const ac_swarm_t *swarm, size_t task);
+
+/**
+ * @brief Agent response of a finished task
+ *
+ * @return Output (owned by the swarm), NULL unless the task is done
+ */
+const char *ac_swarm_output(const ac_swarm_t *swarm, size_t task);
+
+/**
+ * @brief Timing of a run
+ */
+typedef struct {
+    size_t tasks;
+    size_t done;
+    size_t failed;
+    size_t skipped;
+    size_t max_inflight;               /* Effective cap (0 = unlimited) */
+    size_t peak_inflight;              /* Most tasks running at once */
+    uint64_t wall_ms;                  /* ac_swarm_run() duration */
+    uint64_t busy_ms;                  /* Sum of task run times */
+    uint64_t queue_ms;                 /* Sum of ready-to-started waits */
+    uint64_t critical_path_ms;         /* Longest dependency chain, by run time */
+    size_t critical_path_tasks;        /* Tasks on it (ac_swarm_critical_path()) */
+    double parallelism;                /* busy_ms / wall_ms */
+    double utilization;                /* busy_ms / (wall_ms * peak_inflight) */
+} ac_swarm_report_t;
+
+/**
+ * @brief Report of the last run
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_STATE if not run yet
+ */
+arc_err_t ac_swarm_get_report(const ac_swarm_t *swarm, ac_swarm_report_t *report);
+
+/**
+ * @brief Task ids on the critical path, first to last
+ *
+ * @param ids  Output array (may be NULL to get the length)
+ * @param max  Capacity of ids
+ * @return Length of the path (may exceed max)
+ */
+size_t ac_swarm_critical_path(const ac_swarm_t *swarm, size_t *ids, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_SWARM_H */
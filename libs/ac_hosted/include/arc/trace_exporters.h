@@ -50,6 +50,8 @@ typedef struct {
     int pretty_print;            /**< Pretty-print JSON (default: 1) */
     int include_timestamps;      /**< Include ISO timestamps (default: 1) */
     int flush_after_event;       /**< Flush file after each event (default: 0) */
+    size_t async_queue;          /**< Events queued for a writer thread; 0 writes
+                                      from the agent thread (default: 1024) */
 } ac_trace_json_config_t;
 
 /**
@@ -59,6 +61,7 @@ typedef struct {
 #define AC_TRACE_JSON_DEFAULT_PRETTY    1
 #define AC_TRACE_JSON_DEFAULT_TIMESTAMPS 1
 #define AC_TRACE_JSON_DEFAULT_FLUSH     0
+#define AC_TRACE_JSON_DEFAULT_QUEUE     AC_TRACE_ASYNC_DEFAULT_CAPACITY
 
 /*============================================================================
  * JSON File Exporter API
@@ -101,7 +104,7 @@ int ac_trace_json_exporter_init(const ac_trace_json_config_t *config);
 /**
  * @brief Cleanup the JSON file exporter
  *
- * Flushes any pending data and closes open files.
+ * Writes queued events, then closes open files.
  * Should be called before program exit.
  */
 void ac_trace_json_exporter_cleanup(void);
@@ -110,12 +113,222 @@ void ac_trace_json_exporter_cleanup(void);
  * @brief Get the current trace output file path
  *
  * Returns the path to the currently active trace file.
- * Returns NULL if no trace is in progress.
+ * Returns NULL if no trace is in progress. With async_queue set, the file
+ * is opened by the writer thread: call ac_trace_flush() first.
  *
  * @return File path (static buffer, valid until next call)
  */
 const char *ac_trace_json_exporter_get_path(void);
 
+/**
+ * @brief Write one event as the exporter's handler would
+ *
+ * For replaying recorded events (see ac_trace_binary_replay()); the
+ * file name is taken from the agent_start event's timestamp, so a
+ * replayed run gets the name it would have had live.
+ *
+ * @param event Event to write
+ */
+void ac_trace_json_exporter_write(const ac_trace_event_t *event);
+
+/*============================================================================
+ * OTLP Exporter
+ *
+ * Sends runs as OpenTelemetry traces (OTLP/HTTP, JSON encoding) to a
+ * collector, Jaeger or Tempo. Each run is one trace:
+ *
+ *   invoke_agent <name>          tokens, iterations, arena peak
+ *     iteration <n>
+ *       chat <model>             model, tokens, finish reason, latency
+ *       execute_tool <name>      call id, success, cache status
+ *
+ * Spans are batched and exported from the trace exporter thread, on a
+ * pooled HTTP client when ac_http_pool_init() was called. NULL endpoint,
+ * service_name and headers fall back to OTEL_EXPORTER_OTLP_ENDPOINT,
+ * OTEL_SERVICE_NAME and OTEL_EXPORTER_OTLP_HEADERS.
+ *============================================================================*/
+
+/**
+ * @brief OTLP exporter configuration
+ */
+typedef struct {
+    const char *endpoint;        /**< Collector URL; /v1/traces is appended
+                                      (default: "http://localhost:4318") */
+    const char *service_name;    /**< service.name resource attribute (default: "arc") */
+    const char *headers;         /**< Extra headers, "name=value,name=value" (optional) */
+    size_t batch_spans;          /**< Export once this many spans are pending (default: 256) */
+    uint32_t flush_interval_ms;  /**< Or once the last export is this old (default: 5000) */
+    uint32_t timeout_ms;         /**< Export request timeout (default: 10000) */
+    int compress;                /**< gzip request bodies (default: 1) */
+    size_t async_queue;          /**< As in ac_trace_json_config_t (default: 1024) */
+} ac_trace_otlp_config_t;
+
+#define AC_TRACE_OTLP_DEFAULT_BATCH        256
+#define AC_TRACE_OTLP_DEFAULT_INTERVAL_MS  5000
+#define AC_TRACE_OTLP_DEFAULT_TIMEOUT_MS   10000
+#define AC_TRACE_OTLP_DEFAULT_QUEUE        AC_TRACE_ASYNC_DEFAULT_CAPACITY
+
+/**
+ * @brief Initialize the OTLP exporter (replaces any other trace handler)
+ *
+ * With a config, zero fields take their defaults except compress and
+ * async_queue, which are used as given.
+ *
+ * @param config Configuration options (NULL for defaults)
+ * @return 0 on success, -1 on error
+ */
+int ac_trace_otlp_exporter_init(const ac_trace_otlp_config_t *config);
+
+/**
+ * @brief Export every span finished so far
+ *
+ * The interval is only checked when events arrive; call this when a
+ * process goes idle with spans pending.
+ */
+void ac_trace_otlp_exporter_flush(void);
+
+/**
+ * @brief Export what is pending and stop tracing
+ */
+void ac_trace_otlp_exporter_cleanup(void);
+
+/*============================================================================
+ * Binary File Exporter
+ *
+ * Writes every run of a process into one compact file, for services
+ * where the JSON exporter's output is too large to keep:
+ *
+ *   - records are length-prefixed, so readers skip kinds they don't know
+ *   - names, models, trace ids and instructions go into a string table
+ *     once and are referenced by index afterwards
+ *   - each request's history and tool list are stored as the bytes
+ *     added to the previous request's of the same agent
+ *   - records are grouped into frames, deflated when built with zlib
+ *
+ * tools/trace_convert renders a file back into the JSON exporter's
+ * layout or into Chrome trace JSON (chrome://tracing, Perfetto).
+ *============================================================================*/
+
+/**
+ * @brief Binary exporter configuration
+ */
+typedef struct {
+    const char *output_dir;      /**< Output directory (default: "logs") */
+    const char *path;            /**< Exact file to write; overrides output_dir and
+                                      the trace_{YYYYMMDD_HHMMSS}_{pid}.arct name */
+    int compress;                /**< Deflate frames when built with zlib (default: 1) */
+    size_t frame_bytes;          /**< Records buffered before a frame is written;
+                                      runs always end a frame (default: 256 KiB) */
+    size_t async_queue;          /**< As in ac_trace_json_config_t (default: 1024) */
+} ac_trace_binary_config_t;
+
+#define AC_TRACE_BINARY_DEFAULT_DIR    AC_TRACE_JSON_DEFAULT_DIR
+#define AC_TRACE_BINARY_DEFAULT_FRAME  (256 * 1024)
+#define AC_TRACE_BINARY_DEFAULT_QUEUE  AC_TRACE_ASYNC_DEFAULT_CAPACITY
+
+/**
+ * @brief Initialize the binary exporter (replaces any other trace handler)
+ *
+ * With a config, zero fields take their defaults except compress and
+ * async_queue, which are used as given.
+ *
+ * @param config Configuration options (NULL for defaults)
+ * @return 0 on success, -1 on error
+ */
+int ac_trace_binary_exporter_init(const ac_trace_binary_config_t *config);
+
+/**
+ * @brief Write buffered records out as a frame
+ */
+void ac_trace_binary_exporter_flush(void);
+
+/**
+ * @brief Write what is buffered, close the file and stop tracing
+ */
+void ac_trace_binary_exporter_cleanup(void);
+
+/**
+ * @brief Path of the file being written, NULL if none
+ */
+const char *ac_trace_binary_exporter_get_path(void);
+
+/**
+ * @brief Decode a binary trace file, calling handler for every event
+ *
+ * Events carry the fields they were recorded with, histories restored
+ * in full. Strings are only valid during the call. A frame cut short
+ * (by a crash while writing) ends the replay without error.
+ *
+ * @param path      File written by the binary exporter
+ * @param handler   Called for each event, in file order
+ * @param user_data Passed to handler
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_IO, ARC_ERR_NO_MEMORY,
+ *         ARC_ERR_PARSE (not a trace file or corrupt),
+ *         ARC_ERR_NOT_IMPLEMENTED (deflated frames without zlib)
+ */
+arc_err_t ac_trace_binary_replay(const char *path, ac_trace_handler_t handler, void *user_data);
+
+/*============================================================================
+ * Chrome Trace Exporter
+ *
+ * Writes every run of a process into one Chrome trace event file for
+ * chrome://tracing or ui.perfetto.dev, laid out to show concurrency:
+ *
+ *   Agents    a track per agent (and per overlapping run of one): runs,
+ *             iterations, LLM calls with their rate limit, pool,
+ *             connect and first-byte waits, and the span of the tools
+ *   Threads   a track per thread: what each thread was running,
+ *             including tools executed on workers
+ *
+ * Arrows lead from each LLM response to the tool calls it asked for.
+ *============================================================================*/
+
+/**
+ * @brief Chrome trace exporter configuration
+ */
+typedef struct {
+    const char *output_dir;      /**< Output directory (default: "logs") */
+    const char *path;            /**< Exact file to write ("-" = stdout); overrides
+                                      output_dir and the
+                                      timeline_{YYYYMMDD_HHMMSS}_{pid}.json name */
+    size_t async_queue;          /**< As in ac_trace_json_config_t (default: 1024) */
+} ac_trace_chrome_config_t;
+
+#define AC_TRACE_CHROME_DEFAULT_DIR    AC_TRACE_JSON_DEFAULT_DIR
+#define AC_TRACE_CHROME_DEFAULT_QUEUE  AC_TRACE_ASYNC_DEFAULT_CAPACITY
+
+/**
+ * @brief Initialize the Chrome trace exporter (replaces any other trace handler)
+ *
+ * With a config, zero fields take their defaults except async_queue,
+ * which is used as given.
+ *
+ * @param config Configuration options (NULL for defaults)
+ * @return 0 on success, -1 on error
+ */
+int ac_trace_chrome_exporter_init(const ac_trace_chrome_config_t *config);
+
+/**
+ * @brief Write one event as the exporter's handler would
+ *
+ * For replaying recorded events (see ac_trace_binary_replay()).
+ *
+ * @param event Event to write
+ */
+void ac_trace_chrome_exporter_write(const ac_trace_event_t *event);
+
+/**
+ * @brief Close the file and stop tracing
+ *
+ * The file is valid JSON from here on; viewers also load it unclosed.
+ */
+void ac_trace_chrome_exporter_cleanup(void);
+
+/**
+ * @brief Path of the file being written, NULL if none
+ */
+const char *ac_trace_chrome_exporter_get_path(void);
+
 /*============================================================================
  * Console Exporter API (for development/debugging)
  *============================================================================*/
@@ -0,0 +1,162 @@
+/**
+ * @file vector_index.h
+ * @brief In-process vector index for embeddings
+ *
+ * Brute-force nearest neighbours over a contiguous row-major matrix: a
+ * search scores every row with one dot product (SIMD where the CPU has
+ * it) and keeps the best k. At the sizes an agent indexes (a code base,
+ * a document set: up to a few hundred thousand rows) that is a few
+ * milliseconds and always exact, with nothing to train or tune.
+ *
+ * Rows are stored as float32, or quantized to int8 with one scale per
+ * row: a quarter of the memory and of the bytes a search streams
+ * through, for scores that are off by well under 1%.
+ *
+ * Saved indexes are opened with mmap, so opening is instant, the pages
+ * are shared between processes and only the touched ones are read. The
+ * first change to an opened index copies it to memory.
+ *
+ * Usage:
+ * 1. ac_vector_index_create() with the embedding size, or
+ *    ac_vector_index_open() on a saved file
+ * 2. ac_vector_index_add() the vectors from ac_llm_embed(), each with
+ *    the caller's id (a chunk number, a row id, ...)
+ * 3. ac_vector_index_search() with an embedded query
+ *
+ * Not thread-safe: searches may run concurrently with each other, but
+ * not with changes.
+ */
+
+#ifndef ARC_VECTOR_INDEX_H
+#define ARC_VECTOR_INDEX_H
+
+#include "arc/error.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_vector_index ac_vector_index_t;
+
+/**
+ * @brief How rows are stored
+ */
+typedef enum {
+    AC_VECTOR_F32 = 0,             /**< 4 bytes per dimension, exact scores */
+    AC_VECTOR_I8 = 1,              /**< 1 byte per dimension + a scale per row */
+} ac_vector_storage_t;
+
+/**
+ * @brief Index configuration
+ */
+typedef struct {
+    size_t dims;                   /**< Vector size (required) */
+    ac_vector_storage_t storage;   /**< Row format (default: AC_VECTOR_F32) */
+    int normalize;                 /**< 1 = scale added vectors and queries to unit length,
+                                        so scores are cosine similarities */
+    size_t capacity;               /**< Rows to allocate up front (0 = grow as needed) */
+} ac_vector_index_config_t;
+
+/**
+ * @brief One search result
+ */
+typedef struct {
+    uint64_t id;                   /**< Id the row was added with */
+    float score;                   /**< Dot product with the query */
+} ac_vector_hit_t;
+
+/*============================================================================
+ * Lifecycle
+ *============================================================================*/
+
+/**
+ * @brief Create an empty index
+ *
+ * @param config  Index configuration
+ * @param out     Output index
+ * @return ARC_OK, ARC_ERR_INVALID_ARG without dims
+ */
+arc_err_t ac_vector_index_create(const ac_vector_index_config_t *config,
+                                 ac_vector_index_t **out);
+
+/**
+ * @brief Open an index saved with ac_vector_index_save()
+ *
+ * The file is mapped read-only (read into memory where mmap is not
+ * available) and must not be changed while the index is open.
+ *
+ * @return ARC_OK, ARC_ERR_NOT_FOUND, ARC_ERR_PARSE for a file that is not
+ *         an index or is truncated
+ */
+arc_err_t ac_vector_index_open(const char *path, ac_vector_index_t **out);
+
+/**
+ * @brief Write the index to path (through a temporary file and a rename)
+ */
+arc_err_t ac_vector_index_save(const ac_vector_index_t *index, const char *path);
+
+/**
+ * @brief Free the index (and unmap its file)
+ */
+void ac_vector_index_destroy(ac_vector_index_t *index);
+
+/*============================================================================
+ * Rows
+ *============================================================================*/
+
+/**
+ * @brief Add count vectors (row-major, dims floats each)
+ *
+ * Ids are not checked for duplicates: an id added twice is found twice.
+ *
+ * @param ids      count ids
+ * @param vectors  count * dims floats, e.g. ac_embeddings_t.vectors
+ */
+arc_err_t ac_vector_index_add(ac_vector_index_t *index, const uint64_t *ids,
+                              const float *vectors, size_t count);
+
+/**
+ * @brief Remove every row with this id
+ *
+ * The last rows move into the freed places.
+ *
+ * @return ARC_OK, ARC_ERR_NOT_FOUND
+ */
+arc_err_t ac_vector_index_remove(ac_vector_index_t *index, uint64_t id);
+
+/**
+ * @brief Number of rows
+ */
+size_t ac_vector_index_count(const ac_vector_index_t *index);
+
+/**
+ * @brief Vector size
+ */
+size_t ac_vector_index_dims(const ac_vector_index_t *index);
+
+/*============================================================================
+ * Search
+ *============================================================================*/
+
+/**
+ * @brief Find the k rows with the highest dot product with query
+ *
+ * @param query  dims floats
+ * @param k      Results wanted
+ * @param hits   Receives up to k results, best first
+ * @return Number of results (min(k, count))
+ */
+size_t ac_vector_index_search(const ac_vector_index_t *index, const float *query,
+                              size_t k, ac_vector_hit_t *hits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_VECTOR_INDEX_H */
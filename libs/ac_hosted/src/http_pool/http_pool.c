@@ -3,20 +3,45 @@
  * @brief HTTP Connection Pool Implementation
  *
  * Provides a thread-safe global HTTP connection pool for hosted platforms.
- * Uses pthread for synchronization and condition variables for waiting.
+ * Acquire/release of an idle client is lock-free (an MRU stack, so the
+ * warmest connection is reused first); the mutex and condition variable
+ * are only taken to create a client, wait for one, or expire idle ones.
+ *
+ * Unless disabled, pooled clients are bound to one shared arc_http_engine_t
+ * so their requests become HTTP/2 streams on the engine's connections;
+ * the entries then only bound how many callers may borrow at once.
+ *
+ * A maintenance thread reaps idle clients and keeps connections to the
+ * warm URLs open (pre-connect at init or when added, periodic HEAD probes).
+ *
+ * With config.external_loop neither thread exists: the engine is stepped
+ * by ac_runtime_process() from the host's event loop (arc/runtime.h).
  */
 
 #include "arc/http_pool.h"
+#include "arc/runtime.h"
 #include "arc/log.h"
 #include "arc/platform.h"
+#include "arc/metrics.h"
+#include "arc/profile.h"
 #include "http_client.h"
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <errno.h>
 
+/* Declared in affinity.c (ac_core) */
+extern arc_err_t ac_affinity_copy(ac_affinity_t *dst, const ac_affinity_t *src);
+extern void ac_affinity_free(ac_affinity_t *affinity);
+
+/* ac_http_pool_get_stats() copies engine origins whole */
+ARC_STATIC_ASSERT(AC_HTTP_POOL_ORIGIN_MAX == ARC_HTTP_ORIGIN_MAX,
+                  "AC_HTTP_POOL_ORIGIN_MAX must match ARC_HTTP_ORIGIN_MAX");
+
 /*============================================================================
  * Default Configuration
  *============================================================================*/
@@ -26,18 +51,36 @@
 #define HTTP_POOL_DEFAULT_ACQUIRE_TIMEOUT_MS    5000
 #define HTTP_POOL_DEFAULT_REQUEST_TIMEOUT_MS    30000
 #define HTTP_POOL_SHUTDOWN_TIMEOUT_MS           10000
+#define HTTP_POOL_CLEANUP_INTERVAL_MS           1000
+#define HTTP_POOL_PROBE_TIMEOUT_MS              10000
+#define HTTP_POOL_ADDED_WARM_URLS               32  /* Room for ac_http_pool_add_warm_url() */
 
 /*============================================================================
  * Pool Entry
  *============================================================================*/
 
+/**
+ * Entries live in a fixed array of max_connections slots for the pool's
+ * lifetime, so a slot can be read (idle stack links, client lookup) without
+ * holding the mutex. A slot is empty (no client), idle (on the idle stack)
+ * or in use.
+ */
 typedef struct pool_entry {
-    arc_http_client_t *client;  /**< HTTP client handle */
+    arc_http_client_t *_Atomic client;  /**< HTTP client handle (NULL = empty slot) */
     uint64_t last_used_ms;         /**< Last use timestamp (for idle timeout) */
-    int in_use;                    /**< Currently borrowed */
-    struct pool_entry *next;       /**< Next in linked list */
+    atomic_int in_use;             /**< Currently borrowed */
+    _Atomic uint32_t next;         /**< Next idle slot (index + 1, 0 = none) */
 } pool_entry_t;
 
+/**
+ * @brief A caller blocked in acquire (lives on its stack)
+ */
+typedef struct pool_waiter {
+    uint64_t since_ms;             /**< Queued at (monotonic) */
+    ac_priority_t priority;
+    struct pool_waiter *next;
+} pool_waiter_t;
+
 /*============================================================================
  * Global Pool State
  *============================================================================*/
@@ -47,36 +90,82 @@ typedef struct {
     ac_http_pool_config_t config;
 
     /* Connection storage */
-    pool_entry_t *entries;         /**< Head of entries list */
-    size_t total_count;            /**< Total entries */
-    size_t active_count;           /**< In-use entries */
+    arc_http_engine_t *engine;     /**< Shared multiplexing engine (NULL = off) */
+    pool_entry_t *slots;           /**< max_connections entries */
+    _Atomic uint64_t idle_head;    /**< Idle stack, MRU on top: tag << 32 | (slot + 1) */
+    size_t total_count;            /**< Slots with a client (mutex) */
+    atomic_size_t active_count;    /**< In-use entries */
 
-    /* Synchronization */
+    /* Synchronization (slow path only) */
     pthread_mutex_t mutex;
     pthread_cond_t available;      /**< Signal when connection returned */
-    size_t waiting_count;          /**< Threads waiting for connection */
+    atomic_size_t waiting_count;   /**< Threads waiting for connection */
+    pool_waiter_t *waiters[AC_PRIORITY_COUNT];  /**< FIFO per class (mutex) */
+    ac_priority_sched_t sched;     /**< Which class is served next (mutex) */
+    _Atomic uint64_t next_cleanup_ms;
 
     /* Statistics */
-    uint64_t total_acquires;
-    uint64_t pool_hits;
-    uint64_t pool_misses;
-    uint64_t timeouts;
+    _Atomic uint64_t total_acquires;
+    _Atomic uint64_t pool_hits;
+    _Atomic uint64_t pool_misses;
+    _Atomic uint64_t timeouts;
+    _Atomic uint64_t contended;
+    _Atomic uint64_t latency[AC_HTTP_POOL_LATENCY_BUCKETS];
+
+    /* Maintenance thread: reaper, warm-up, keepalive probes */
+    pthread_t maintainer;
+    int maintainer_running;
+    pthread_cond_t maintain_wake;  /**< Signalled at shutdown */
+    volatile int maintain_stop;    /**< Cancels in-flight probes */
+    char **warm_urls;              /**< Config + added URLs, never reallocated */
+    size_t warm_cap;
+    atomic_size_t warm_count;      /**< Published after the entry is written */
+    arc_http_client_t *probe_client; /**< Maintenance thread's own client */
+    ac_affinity_t io_affinity;     /**< Placement of the pool's threads (owned copy) */
 
     /* State */
     int initialized;
-    int shutting_down;
+    atomic_int shutting_down;
 } http_pool_t;
 
-static http_pool_t s_pool = {0};
+static http_pool_t s_pool;
+
+/* ac_http_pool_init_async(): the config copy its init thread works from */
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t done;
+    atomic_int pending;            /**< Init thread still running */
+    ac_http_pool_config_t config;
+    char **warm_urls;              /**< Owned copies behind config.warm_urls */
+    ac_affinity_t io_affinity;     /**< Owned copy behind config.io_affinity */
+} s_async = { .mutex = PTHREAD_MUTEX_INITIALIZER, .done = PTHREAD_COND_INITIALIZER };
+
+/**
+ * @brief Wait for a background init to finish (one atomic load if none runs)
+ */
+static void async_wait(void) {
+    if (!atomic_load(&s_async.pending)) {
+        return;
+    }
+    pthread_mutex_lock(&s_async.mutex);
+    while (atomic_load(&s_async.pending)) {
+        pthread_cond_wait(&s_async.done, &s_async.mutex);
+    }
+    pthread_mutex_unlock(&s_async.mutex);
+}
 
 /*============================================================================
  * Time Helpers
  *============================================================================*/
 
-static uint64_t get_current_time_ms(void) {
+static uint64_t get_current_time_us(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint64_t get_current_time_ms(void) {
+    return get_current_time_us() / 1000;
 }
 
 static void timespec_from_timeout(struct timespec *ts, uint32_t timeout_ms) {
@@ -88,70 +177,125 @@ static void timespec_from_timeout(struct timespec *ts, uint32_t timeout_ms) {
     ts->tv_nsec = ns % 1000000000;
 }
 
+/**
+ * @brief Count an acquire in the log2 latency histogram (and the metrics registry)
+ */
+static void record_latency(uint64_t start_us) {
+    uint64_t waited_us = get_current_time_us() - start_us;
+    uint64_t us = waited_us;
+    size_t bucket = 0;
+    while (us > 0 && bucket < AC_HTTP_POOL_LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    atomic_fetch_add_explicit(&s_pool.latency[bucket], 1, memory_order_relaxed);
+    ac_metric_observe(ac_metrics_histogram("arc_http_pool_acquire_wait_seconds", NULL,
+                                           "Wait for a pooled HTTP client", 1e-6),
+                      waited_us);
+}
+
 /*============================================================================
- * Pool Entry Management
+ * Idle Stack (lock-free)
+ *
+ * Treiber stack of slot indices. The tag in the upper half of idle_head
+ * changes on every update, so a pop racing with pop+push of the same slot
+ * fails its CAS instead of linking a stale next (ABA).
  *============================================================================*/
 
-static pool_entry_t *entry_create(void) {
-    pool_entry_t *entry = ARC_CALLOC(1, sizeof(pool_entry_t));
-    if (!entry) {
-        return NULL;
+static uint32_t slot_index(const pool_entry_t *e) {
+    return (uint32_t)(e - s_pool.slots) + 1;
+}
+
+static void idle_push(pool_entry_t *e) {
+    uint64_t head = atomic_load(&s_pool.idle_head);
+    uint64_t desired;
+    do {
+        atomic_store_explicit(&e->next, (uint32_t)head, memory_order_relaxed);
+        desired = (((head >> 32) + 1) << 32) | slot_index(e);
+    } while (!atomic_compare_exchange_weak(&s_pool.idle_head, &head, desired));
+}
+
+static pool_entry_t *idle_pop(void) {
+    uint64_t head = atomic_load(&s_pool.idle_head);
+    for (;;) {
+        uint32_t idx = (uint32_t)head;
+        if (idx == 0) {
+            return NULL;
+        }
+        pool_entry_t *e = &s_pool.slots[idx - 1];
+        uint64_t desired = (((head >> 32) + 1) << 32) |
+                           atomic_load_explicit(&e->next, memory_order_relaxed);
+        if (atomic_compare_exchange_weak(&s_pool.idle_head, &head, desired)) {
+            return e;
+        }
     }
+}
+
+/*============================================================================
+ * Pool Entry Management
+ *============================================================================*/
 
+static arc_err_t entry_open(pool_entry_t *entry) {
     /* Create HTTP client with default config */
     arc_http_client_config_t http_cfg = {
         .default_timeout_ms = s_pool.config.default_request_timeout_ms,
+        .engine = s_pool.engine,
     };
 
-    arc_err_t err = arc_http_client_create(&http_cfg, &entry->client);
-    if (err != ARC_OK || !entry->client) {
+    arc_http_client_t *client = NULL;
+    arc_err_t err = arc_http_client_create(&http_cfg, &client);
+    if (err != ARC_OK || !client) {
         AC_LOG_ERROR("HTTP pool: failed to create client: %s", ac_strerror(err));
-        ARC_FREE(entry);
-        return NULL;
+        return err != ARC_OK ? err : ARC_ERR_NO_MEMORY;
     }
 
     entry->last_used_ms = get_current_time_ms();
-    entry->in_use = 0;
-    entry->next = NULL;
-
-    return entry;
+    atomic_store(&entry->client, client);
+    return ARC_OK;
 }
 
-static void entry_destroy(pool_entry_t *entry) {
-    if (!entry) return;
-
-    if (entry->client) {
-        arc_http_client_destroy(entry->client);
+static void entry_close(pool_entry_t *entry) {
+    arc_http_client_t *client = atomic_exchange(&entry->client, NULL);
+    if (client) {
+        arc_http_client_destroy(client);
     }
-    ARC_FREE(entry);
+}
+
+static void entry_claim(pool_entry_t *entry) {
+    /* last_used_ms only matters once the entry is idle again */
+    atomic_store(&entry->in_use, 1);
+    atomic_fetch_add(&s_pool.active_count, 1);
 }
 
 /**
- * @brief Find an available (idle) entry
+ * @brief Find an empty slot (mutex held)
  */
-static pool_entry_t *find_idle_entry(void) {
-    for (pool_entry_t *e = s_pool.entries; e; e = e->next) {
-        if (!e->in_use) {
-            return e;
+static pool_entry_t *find_empty_slot(void) {
+    for (size_t i = 0; i < s_pool.config.max_connections; i++) {
+        if (!atomic_load(&s_pool.slots[i].client)) {
+            return &s_pool.slots[i];
         }
     }
     return NULL;
 }
 
 /**
- * @brief Find entry by client pointer
+ * @brief Find entry by client pointer (lock-free)
  */
 static pool_entry_t *find_entry_by_client(arc_http_client_t *client) {
-    for (pool_entry_t *e = s_pool.entries; e; e = e->next) {
-        if (e->client == client) {
-            return e;
+    for (size_t i = 0; i < s_pool.config.max_connections; i++) {
+        if (atomic_load_explicit(&s_pool.slots[i].client, memory_order_relaxed) == client) {
+            return &s_pool.slots[i];
         }
     }
     return NULL;
 }
 
 /**
- * @brief Clean up idle connections that have timed out
+ * @brief Clean up idle connections that have timed out (mutex held)
+ *
+ * Drains the idle stack into a private chain (LRU first), closes expired
+ * entries and pushes the rest back so the MRU entry ends up on top again.
  */
 static void cleanup_idle_connections(void) {
     if (s_pool.config.idle_timeout_ms == 0) {
@@ -159,29 +303,257 @@ static void cleanup_idle_connections(void) {
     }
 
     uint64_t now = get_current_time_ms();
+    atomic_store(&s_pool.next_cleanup_ms, now + HTTP_POOL_CLEANUP_INTERVAL_MS);
     uint64_t cutoff = now - s_pool.config.idle_timeout_ms;
 
-    pool_entry_t **pp = &s_pool.entries;
-    while (*pp) {
-        pool_entry_t *e = *pp;
+    uint32_t chain = 0;
+    pool_entry_t *e;
+    while ((e = idle_pop()) != NULL) {
+        atomic_store(&e->next, chain);
+        chain = slot_index(e);
+    }
+
+    while (chain) {
+        e = &s_pool.slots[chain - 1];
+        chain = atomic_load(&e->next);
 
         /* Remove if idle and timed out (keep at least one connection) */
-        if (!e->in_use && e->last_used_ms < cutoff && s_pool.total_count > 1) {
-            *pp = e->next;
-            entry_destroy(e);
+        if (e->last_used_ms < cutoff && s_pool.total_count > 1) {
+            entry_close(e);
             s_pool.total_count--;
             AC_LOG_DEBUG("HTTP pool: removed idle connection (total=%zu)", s_pool.total_count);
         } else {
-            pp = &e->next;
+            idle_push(e);
         }
     }
 }
 
+/*============================================================================
+ * Maintenance Thread
+ *============================================================================*/
+
+/**
+ * @brief HEAD warm URLs [first, last), per_url times concurrently when multiplexed
+ *
+ * Opens the TCP+TLS connection on first use and resets the server's idle
+ * timer afterwards. The status does not matter, only the connection.
+ */
+static void probe_warm_urls(size_t first, size_t last, size_t per_url) {
+    if (s_pool.engine) {
+        size_t count = (last - first) * per_url;
+        arc_http_transfer_t **transfers = ARC_CALLOC(count, sizeof(*transfers));
+        if (!transfers) {
+            return;
+        }
+        for (size_t i = 0; i < count; i++) {
+            arc_http_request_t req = {
+                .url = s_pool.warm_urls[first + i / per_url],
+                .method = ARC_HTTP_HEAD,
+                .timeout_ms = HTTP_POOL_PROBE_TIMEOUT_MS,
+                .verify_ssl = 1,
+            };
+            if (arc_http_submit(s_pool.engine, &req, NULL, NULL, &transfers[i]) != ARC_OK) {
+                transfers[i] = NULL;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (!transfers[i]) {
+                continue;
+            }
+            /* Polled so shutdown does not wait out a slow handshake */
+            while (!arc_http_transfer_poll(transfers[i]) && !s_pool.maintain_stop) {
+                ac_platform_sleep_ms(20);
+            }
+            if (s_pool.maintain_stop) {
+                arc_http_transfer_cancel(transfers[i]);
+            }
+            arc_err_t err = arc_http_transfer_wait(transfers[i], NULL);
+            if (err != ARC_OK && err != ARC_ERR_CANCELLED) {
+                AC_LOG_DEBUG("HTTP pool: probe %s failed: %s",
+                             s_pool.warm_urls[first + i / per_url], ac_strerror(err));
+            }
+            arc_http_transfer_release(transfers[i]);
+        }
+        ARC_FREE(transfers);
+        return;
+    }
+
+    /* Per-client connections live in the process-wide share, so one
+     * sequential probe warms the connection pooled clients will reuse */
+    for (size_t i = first; i < last && !s_pool.maintain_stop; i++) {
+        arc_http_request_t req = {
+            .url = s_pool.warm_urls[i],
+            .method = ARC_HTTP_HEAD,
+            .timeout_ms = HTTP_POOL_PROBE_TIMEOUT_MS,
+            .verify_ssl = 1,
+            .cancel = &s_pool.maintain_stop,
+        };
+        arc_http_response_t resp = {0};
+        arc_err_t err = arc_http_request(s_pool.probe_client, &req, &resp);
+        if (err != ARC_OK && err != ARC_ERR_CANCELLED) {
+            AC_LOG_DEBUG("HTTP pool: probe %s failed: %s", s_pool.warm_urls[i], ac_strerror(err));
+        }
+        arc_http_response_free(&resp);
+    }
+}
+
+static void *maintenance_main(void *arg) {
+    (void)arg;
+    ac_affinity_apply(&s_pool.io_affinity, 0);
+
+    size_t warmed = 0;
+    uint64_t interval = s_pool.config.keepalive_interval_ms;
+    uint64_t next_probe_ms = get_current_time_ms() + interval;
+
+    pthread_mutex_lock(&s_pool.mutex);
+    while (!atomic_load(&s_pool.shutting_down)) {
+        /* Pre-connect URLs from init and any added since */
+        size_t count = atomic_load(&s_pool.warm_count);
+        if (count > warmed) {
+            size_t per_url = s_pool.config.warm_connections;
+            pthread_mutex_unlock(&s_pool.mutex);
+            probe_warm_urls(warmed, count, per_url);
+            AC_LOG_DEBUG("HTTP pool: warmed %zu URL(s) x %zu", count - warmed, per_url);
+            warmed = count;
+            pthread_mutex_lock(&s_pool.mutex);
+            continue;
+        }
+
+        struct timespec deadline;
+        timespec_from_timeout(&deadline, HTTP_POOL_CLEANUP_INTERVAL_MS);
+        pthread_cond_timedwait(&s_pool.maintain_wake, &s_pool.mutex, &deadline);
+        if (atomic_load(&s_pool.shutting_down)) {
+            break;
+        }
+
+        cleanup_idle_connections();
+
+        uint64_t now = get_current_time_ms();
+        if (warmed > 0 && interval > 0 && now >= next_probe_ms) {
+            next_probe_ms = now + interval;
+            pthread_mutex_unlock(&s_pool.mutex);
+            probe_warm_urls(0, warmed, 1);
+            pthread_mutex_lock(&s_pool.mutex);
+        }
+    }
+    pthread_mutex_unlock(&s_pool.mutex);
+
+    return NULL;
+}
+
+static void free_warm_urls(void) {
+    size_t count = atomic_load(&s_pool.warm_count);
+    for (size_t i = 0; i < count; i++) {
+        ARC_FREE(s_pool.warm_urls[i]);
+    }
+    ARC_FREE(s_pool.warm_urls);
+    s_pool.warm_urls = NULL;
+    s_pool.warm_cap = 0;
+    atomic_store(&s_pool.warm_count, 0);
+}
+
+/**
+ * @brief Probe client for the non-multiplexed path (mutex or init)
+ */
+static arc_err_t ensure_probe_client(void) {
+    if (s_pool.engine || s_pool.probe_client) {
+        return ARC_OK;
+    }
+    arc_http_client_config_t http_cfg = {
+        .default_timeout_ms = HTTP_POOL_PROBE_TIMEOUT_MS,
+    };
+    if (arc_http_client_create(&http_cfg, &s_pool.probe_client) != ARC_OK) {
+        s_pool.probe_client = NULL;
+        return ARC_ERR_NO_MEMORY;
+    }
+    return ARC_OK;
+}
+
+/**
+ * @brief Length of the scheme://host:port prefix of url
+ */
+static size_t origin_len(const char *url) {
+    const char *host = strstr(url, "://");
+    host = host ? host + 3 : url;
+    return (size_t)(host - url) + strcspn(host, "/?#");
+}
+
+/**
+ * @brief Copy warm URLs, pre-create clients and start the thread
+ *
+ * Failure only costs the background work; acquire then expires idle
+ * clients itself.
+ */
+static void maintenance_start(void) {
+    size_t count = 0;
+    while (s_pool.config.warm_urls && s_pool.config.warm_urls[count]) {
+        count++;
+    }
+    if (count > 0) {
+        s_pool.warm_urls = ARC_CALLOC(count + HTTP_POOL_ADDED_WARM_URLS + 1, sizeof(char *));
+        s_pool.warm_cap = s_pool.warm_urls ? count + HTTP_POOL_ADDED_WARM_URLS : 0;
+        for (size_t i = 0; s_pool.warm_urls && i < count; i++) {
+            s_pool.warm_urls[i] = ARC_STRDUP(s_pool.config.warm_urls[i]);
+            if (!s_pool.warm_urls[i]) {
+                break;
+            }
+            atomic_fetch_add(&s_pool.warm_count, 1);
+        }
+    }
+    s_pool.config.warm_urls = NULL;  /* Caller's array need not outlive init */
+
+    if (atomic_load(&s_pool.warm_count) > 0) {
+        /* Idle clients for the first acquires, so they skip creation too */
+        size_t clients = s_pool.config.warm_connections;
+        if (clients > s_pool.config.max_connections) {
+            clients = s_pool.config.max_connections;
+        }
+        for (size_t i = 0; i < clients; i++) {
+            if (entry_open(&s_pool.slots[i]) != ARC_OK) {
+                break;
+            }
+            s_pool.total_count++;
+            idle_push(&s_pool.slots[i]);
+        }
+
+        if (ensure_probe_client() != ARC_OK) {
+            free_warm_urls();
+        }
+    }
+
+    if (pthread_cond_init(&s_pool.maintain_wake, NULL) != 0) {
+        AC_LOG_WARN("HTTP pool: no maintenance thread");
+        return;
+    }
+    if (pthread_create(&s_pool.maintainer, NULL, maintenance_main, NULL) != 0) {
+        AC_LOG_WARN("HTTP pool: no maintenance thread");
+        pthread_cond_destroy(&s_pool.maintain_wake);
+        return;
+    }
+    s_pool.maintainer_running = 1;
+}
+
+static void maintenance_stop(void) {
+    if (s_pool.maintainer_running) {
+        s_pool.maintain_stop = 1;
+        pthread_mutex_lock(&s_pool.mutex);
+        pthread_cond_broadcast(&s_pool.maintain_wake);
+        pthread_mutex_unlock(&s_pool.mutex);
+        pthread_join(s_pool.maintainer, NULL);
+        pthread_cond_destroy(&s_pool.maintain_wake);
+        s_pool.maintainer_running = 0;
+    }
+
+    arc_http_client_destroy(s_pool.probe_client);
+    s_pool.probe_client = NULL;
+    free_warm_urls();
+}
+
 /*============================================================================
  * Public API: Lifecycle
  *============================================================================*/
 
-arc_err_t ac_http_pool_init(const ac_http_pool_config_t *config) {
+static arc_err_t pool_init(const ac_http_pool_config_t *config) {
     /* Thread-safe initialization check */
     static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -199,6 +571,11 @@ arc_err_t ac_http_pool_init(const ac_http_pool_config_t *config) {
     if (config) {
         s_pool.config = *config;
     }
+    if (ac_affinity_copy(&s_pool.io_affinity, s_pool.config.io_affinity) != ARC_OK) {
+        pthread_mutex_unlock(&init_mutex);
+        return ARC_ERR_INVALID_ARG;
+    }
+    s_pool.config.io_affinity = NULL;  /* Caller's copy need not outlive init */
 
     /* Set defaults */
     if (s_pool.config.max_connections == 0) {
@@ -213,75 +590,214 @@ arc_err_t ac_http_pool_init(const ac_http_pool_config_t *config) {
     if (s_pool.config.default_request_timeout_ms == 0) {
         s_pool.config.default_request_timeout_ms = HTTP_POOL_DEFAULT_REQUEST_TIMEOUT_MS;
     }
+    if (s_pool.config.warm_connections == 0) {
+        s_pool.config.warm_connections = 1;
+    }
+
+    s_pool.slots = ARC_CALLOC(s_pool.config.max_connections, sizeof(pool_entry_t));
+    if (!s_pool.slots) {
+        ac_affinity_free(&s_pool.io_affinity);
+        pthread_mutex_unlock(&init_mutex);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    /* Shared engine for HTTP/2 multiplexing */
+    if (!s_pool.config.disable_multiplex) {
+        arc_http_client_config_t engine_cfg = {
+            .default_timeout_ms = s_pool.config.default_request_timeout_ms,
+            .http2 = 1,
+            .max_host_connections = s_pool.config.max_connections_per_host,
+            .external_loop = s_pool.config.external_loop,
+            .affinity = &s_pool.io_affinity,
+        };
+        arc_err_t err = arc_http_engine_create(&engine_cfg, &s_pool.engine);
+        if (err != ARC_OK) {
+            AC_LOG_WARN("HTTP pool: no shared engine (%s), using per-client connections",
+                        ac_strerror(err));
+            s_pool.engine = NULL;
+        }
+    }
 
     /* Initialize synchronization primitives */
     if (pthread_mutex_init(&s_pool.mutex, NULL) != 0) {
+        arc_http_engine_destroy(s_pool.engine);
+        ARC_FREE(s_pool.slots);
+        ac_affinity_free(&s_pool.io_affinity);
         pthread_mutex_unlock(&init_mutex);
         return ARC_ERR_BACKEND;
     }
 
     if (pthread_cond_init(&s_pool.available, NULL) != 0) {
         pthread_mutex_destroy(&s_pool.mutex);
+        arc_http_engine_destroy(s_pool.engine);
+        ARC_FREE(s_pool.slots);
+        ac_affinity_free(&s_pool.io_affinity);
         pthread_mutex_unlock(&init_mutex);
         return ARC_ERR_BACKEND;
     }
 
-    s_pool.initialized = 1;
+    s_pool.next_cleanup_ms = get_current_time_ms() + HTTP_POOL_CLEANUP_INTERVAL_MS;
     s_pool.shutting_down = 0;
+    if (s_pool.config.external_loop) {
+        /* Probes would block the host's loop; acquire reaps idle clients */
+        s_pool.config.warm_urls = NULL;
+    } else {
+        maintenance_start();
+    }
+    s_pool.initialized = 1;
 
     pthread_mutex_unlock(&init_mutex);
 
-    AC_LOG_INFO("HTTP pool initialized: max_connections=%zu, idle_timeout=%ums, acquire_timeout=%ums",
+    AC_LOG_INFO("HTTP pool initialized: max_connections=%zu, idle_timeout=%ums, acquire_timeout=%ums, "
+                "multiplex=%s (per host=%zu), warm_urls=%zu%s",
                 s_pool.config.max_connections,
                 s_pool.config.idle_timeout_ms,
-                s_pool.config.acquire_timeout_ms);
+                s_pool.config.acquire_timeout_ms,
+                s_pool.engine ? "on" : "off",
+                s_pool.config.max_connections_per_host,
+                atomic_load(&s_pool.warm_count),
+                s_pool.config.external_loop ? ", external loop" : "");
 
     return ARC_OK;
 }
 
+arc_err_t ac_http_pool_init(const ac_http_pool_config_t *config) {
+    async_wait();
+    return pool_init(config);
+}
+
+static void async_free_config(void) {
+    for (size_t i = 0; s_async.warm_urls && s_async.warm_urls[i]; i++) {
+        ARC_FREE(s_async.warm_urls[i]);
+    }
+    ARC_FREE(s_async.warm_urls);
+    s_async.warm_urls = NULL;
+    ac_affinity_free(&s_async.io_affinity);
+    memset(&s_async.config, 0, sizeof(s_async.config));
+}
+
+/**
+ * @brief Copy what the caller's config points to (s_async.mutex held)
+ */
+static arc_err_t async_copy_config(const ac_http_pool_config_t *config) {
+    if (!config) {
+        return ARC_OK;
+    }
+    s_async.config = *config;
+
+    size_t count = 0;
+    while (config->warm_urls && config->warm_urls[count]) {
+        count++;
+    }
+    if (count > 0) {
+        s_async.warm_urls = ARC_CALLOC(count + 1, sizeof(char *));
+        for (size_t i = 0; s_async.warm_urls && i < count; i++) {
+            if (!(s_async.warm_urls[i] = ARC_STRDUP(config->warm_urls[i]))) {
+                return ARC_ERR_NO_MEMORY;
+            }
+        }
+        if (!s_async.warm_urls) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        s_async.config.warm_urls = (const char *const *)s_async.warm_urls;
+    }
+
+    s_async.config.io_affinity = config->io_affinity ? &s_async.io_affinity : NULL;
+    return ac_affinity_copy(&s_async.io_affinity, config->io_affinity);
+}
+
+static void *async_init_main(void *arg) {
+    (void)arg;
+    arc_err_t err = pool_init(&s_async.config);
+    if (err != ARC_OK) {
+        AC_LOG_WARN("HTTP pool: background init failed: %s", ac_strerror(err));
+    }
+
+    pthread_mutex_lock(&s_async.mutex);
+    async_free_config();
+    atomic_store(&s_async.pending, 0);
+    pthread_cond_broadcast(&s_async.done);
+    pthread_mutex_unlock(&s_async.mutex);
+    return NULL;
+}
+
+arc_err_t ac_http_pool_init_async(const ac_http_pool_config_t *config) {
+    if (config && config->external_loop) {
+        return ac_http_pool_init(config);  /* The host wants no pool threads */
+    }
+
+    pthread_mutex_lock(&s_async.mutex);
+    if (atomic_load(&s_async.pending) || s_pool.initialized) {
+        pthread_mutex_unlock(&s_async.mutex);
+        return ARC_OK;
+    }
+
+    arc_err_t err = async_copy_config(config);
+    if (err == ARC_OK) {
+        pthread_t thread;
+        atomic_store(&s_async.pending, 1);
+        if (pthread_create(&thread, NULL, async_init_main, NULL) == 0) {
+            pthread_detach(thread);
+            pthread_mutex_unlock(&s_async.mutex);
+            return ARC_OK;
+        }
+        atomic_store(&s_async.pending, 0);
+    }
+    async_free_config();
+    pthread_mutex_unlock(&s_async.mutex);
+
+    /* No thread: initialize right here instead */
+    return err == ARC_OK ? pool_init(config) : err;
+}
+
 int ac_http_pool_is_initialized(void) {
-    return s_pool.initialized && !s_pool.shutting_down;
+    async_wait();
+    return s_pool.initialized && !atomic_load(&s_pool.shutting_down);
 }
 
 void ac_http_pool_shutdown(void) {
+    async_wait();
     if (!s_pool.initialized) {
         return;
     }
 
     AC_LOG_INFO("HTTP pool shutting down...");
 
+    atomic_store(&s_pool.shutting_down, 1);
+    maintenance_stop();
+
     pthread_mutex_lock(&s_pool.mutex);
-    s_pool.shutting_down = 1;
 
     /* Wake up all waiting threads */
     pthread_cond_broadcast(&s_pool.available);
 
     /* Wait for active connections to be returned (with timeout) */
-    if (s_pool.active_count > 0) {
+    if (atomic_load(&s_pool.active_count) > 0) {
         struct timespec timeout;
         timespec_from_timeout(&timeout, HTTP_POOL_SHUTDOWN_TIMEOUT_MS);
 
-        while (s_pool.active_count > 0) {
+        while (atomic_load(&s_pool.active_count) > 0) {
             int ret = pthread_cond_timedwait(&s_pool.available, &s_pool.mutex, &timeout);
             if (ret == ETIMEDOUT) {
                 AC_LOG_WARN("HTTP pool: shutdown timeout, %zu connections still active",
-                            s_pool.active_count);
+                            atomic_load(&s_pool.active_count));
                 break;
             }
         }
     }
 
     /* Destroy all entries */
-    pool_entry_t *e = s_pool.entries;
-    while (e) {
-        pool_entry_t *next = e->next;
-        entry_destroy(e);
-        e = next;
+    for (size_t i = 0; i < s_pool.config.max_connections; i++) {
+        entry_close(&s_pool.slots[i]);
     }
 
-    s_pool.entries = NULL;
+    atomic_store(&s_pool.idle_head, 0);
     s_pool.total_count = 0;
-    s_pool.active_count = 0;
+    atomic_store(&s_pool.active_count, 0);
+
+    /* Clients still out after the timeout see ARC_ERR_CANCELLED */
+    arc_http_engine_destroy(s_pool.engine);
+    s_pool.engine = NULL;
 
     pthread_mutex_unlock(&s_pool.mutex);
 
@@ -295,66 +811,80 @@ void ac_http_pool_shutdown(void) {
                 (unsigned long long)s_pool.pool_misses,
                 (unsigned long long)s_pool.timeouts);
 
+    ARC_FREE(s_pool.slots);
+    s_pool.slots = NULL;
+    ac_affinity_free(&s_pool.io_affinity);
     s_pool.initialized = 0;
 }
 
 /*============================================================================
- * Public API: Acquire/Release
+ * Wait Queue
  *============================================================================*/
 
-arc_http_client_t *ac_http_pool_acquire(uint32_t timeout_ms) {
-    if (!s_pool.initialized || s_pool.shutting_down) {
-        AC_LOG_ERROR("HTTP pool: not initialized or shutting down");
-        return NULL;
+static void waiter_enqueue(pool_waiter_t *w) {
+    pool_waiter_t **link = &s_pool.waiters[w->priority];
+    while (*link) {
+        link = &(*link)->next;
     }
+    w->next = NULL;
+    *link = w;
+}
 
-    if (timeout_ms == 0) {
-        timeout_ms = s_pool.config.acquire_timeout_ms;
+static void waiter_remove(pool_waiter_t *w) {
+    for (pool_waiter_t **link = &s_pool.waiters[w->priority]; *link; link = &(*link)->next) {
+        if (*link == w) {
+            *link = w->next;
+            return;
+        }
     }
+}
 
-    pthread_mutex_lock(&s_pool.mutex);
+/**
+ * @brief Waiter the next released client goes to (mutex held)
+ */
+static pool_waiter_t *waiter_front(void) {
+    uint64_t oldest[AC_PRIORITY_COUNT];
+    for (int c = 0; c < AC_PRIORITY_COUNT; c++) {
+        oldest[c] = s_pool.waiters[c] ? s_pool.waiters[c]->since_ms : 0;
+    }
+    int c = ac_priority_next(&s_pool.sched, oldest, get_current_time_ms());
+    return c >= 0 ? s_pool.waiters[c] : NULL;
+}
 
-    s_pool.total_acquires++;
+/*============================================================================
+ * Public API: Acquire/Release
+ *============================================================================*/
 
-    /* Periodic cleanup of idle connections */
-    cleanup_idle_connections();
+/**
+ * @brief Acquire when the idle stack was empty or others queue: create or wait
+ */
+static pool_entry_t *acquire_slow(uint32_t timeout_ms, ac_priority_t priority) {
+    atomic_fetch_add(&s_pool.contended, 1);
 
-    /* Try to find an idle connection */
-    pool_entry_t *entry = find_idle_entry();
+    pthread_mutex_lock(&s_pool.mutex);
 
+    /* A release may have landed meanwhile; queued callers go first */
+    pool_entry_t *entry = atomic_load(&s_pool.waiting_count) == 0 ? idle_pop() : NULL;
     if (entry) {
-        /* Pool hit: reuse existing connection */
-        entry->in_use = 1;
-        entry->last_used_ms = get_current_time_ms();
-        s_pool.active_count++;
-        s_pool.pool_hits++;
-
+        entry_claim(entry);
+        atomic_fetch_add(&s_pool.pool_hits, 1);
         pthread_mutex_unlock(&s_pool.mutex);
-
-        AC_LOG_DEBUG("HTTP pool: acquired (hit, active=%zu, total=%zu)",
-                     s_pool.active_count, s_pool.total_count);
-        return entry->client;
+        return entry;
     }
 
-    /* No idle connection available */
-
     /* Can we create a new one? */
     if (s_pool.total_count < s_pool.config.max_connections) {
         /* Pool miss: create new connection */
-        entry = entry_create();
-        if (entry) {
-            entry->in_use = 1;
-            entry->next = s_pool.entries;
-            s_pool.entries = entry;
+        entry = find_empty_slot();
+        if (entry && entry_open(entry) == ARC_OK) {
             s_pool.total_count++;
-            s_pool.active_count++;
-            s_pool.pool_misses++;
+            entry_claim(entry);
+            atomic_fetch_add(&s_pool.pool_misses, 1);
 
             pthread_mutex_unlock(&s_pool.mutex);
 
-            AC_LOG_DEBUG("HTTP pool: acquired (new, active=%zu, total=%zu)",
-                         s_pool.active_count, s_pool.total_count);
-            return entry->client;
+            AC_LOG_DEBUG("HTTP pool: acquired (new, total=%zu)", s_pool.total_count);
+            return entry;
         }
         /* Failed to create, fall through to wait */
     }
@@ -363,28 +893,38 @@ arc_http_client_t *ac_http_pool_acquire(uint32_t timeout_ms) {
     struct timespec deadline;
     timespec_from_timeout(&deadline, timeout_ms);
 
-    s_pool.waiting_count++;
+    pool_waiter_t self = { get_current_time_ms(), priority, NULL };
+    waiter_enqueue(&self);
+    atomic_fetch_add(&s_pool.waiting_count, 1);
 
-    while (!s_pool.shutting_down) {
-        entry = find_idle_entry();
+    while (!atomic_load(&s_pool.shutting_down)) {
+        /* waiting_count is visible before this pop, so a release that
+         * missed it pushed first and the front's pop sees its entry */
+        entry = waiter_front() == &self ? idle_pop() : NULL;
         if (entry) {
-            entry->in_use = 1;
-            entry->last_used_ms = get_current_time_ms();
-            s_pool.active_count++;
-            s_pool.waiting_count--;
-            s_pool.pool_hits++;
+            entry_claim(entry);
+            waiter_remove(&self);
+            ac_priority_charge(&s_pool.sched, priority);
+            atomic_fetch_add(&s_pool.pool_hits, 1);
+            /* More may be idle: let the new front look */
+            if (atomic_fetch_sub(&s_pool.waiting_count, 1) > 1) {
+                pthread_cond_broadcast(&s_pool.available);
+            }
 
             pthread_mutex_unlock(&s_pool.mutex);
 
-            AC_LOG_DEBUG("HTTP pool: acquired (waited, active=%zu, total=%zu)",
-                         s_pool.active_count, s_pool.total_count);
-            return entry->client;
+            AC_LOG_DEBUG("HTTP pool: acquired (waited)");
+            return entry;
         }
 
         int ret = pthread_cond_timedwait(&s_pool.available, &s_pool.mutex, &deadline);
         if (ret == ETIMEDOUT) {
-            s_pool.waiting_count--;
-            s_pool.timeouts++;
+            waiter_remove(&self);
+            pthread_cond_broadcast(&s_pool.available);
+            atomic_fetch_sub(&s_pool.waiting_count, 1);
+            atomic_fetch_add(&s_pool.timeouts, 1);
+            ac_metric_add(ac_metrics_counter("arc_http_pool_acquire_timeouts", NULL,
+                                             "Pool acquires that timed out"), 1);
 
             pthread_mutex_unlock(&s_pool.mutex);
 
@@ -394,12 +934,64 @@ arc_http_client_t *ac_http_pool_acquire(uint32_t timeout_ms) {
     }
 
     /* Shutting down */
-    s_pool.waiting_count--;
+    waiter_remove(&self);
+    atomic_fetch_sub(&s_pool.waiting_count, 1);
     pthread_mutex_unlock(&s_pool.mutex);
 
     return NULL;
 }
 
+static arc_http_client_t *pool_acquire(uint32_t timeout_ms, ac_priority_t priority) {
+    async_wait();
+    if (!s_pool.initialized || atomic_load(&s_pool.shutting_down)) {
+        AC_LOG_ERROR("HTTP pool: not initialized or shutting down");
+        return NULL;
+    }
+
+    if (timeout_ms == 0) {
+        timeout_ms = s_pool.config.acquire_timeout_ms;
+    }
+
+    uint64_t start_us = get_current_time_us();
+    atomic_fetch_add_explicit(&s_pool.total_acquires, 1, memory_order_relaxed);
+
+    /* Without the maintenance thread: periodic cleanup, skipped while contended */
+    if (!s_pool.maintainer_running &&
+        start_us / 1000 >= atomic_load_explicit(&s_pool.next_cleanup_ms, memory_order_relaxed) &&
+        pthread_mutex_trylock(&s_pool.mutex) == 0) {
+        cleanup_idle_connections();
+        pthread_mutex_unlock(&s_pool.mutex);
+    }
+
+    /* Fast path: most recently released idle connection, unless others queue */
+    pool_entry_t *entry = atomic_load(&s_pool.waiting_count) == 0 ? idle_pop() : NULL;
+    if (entry) {
+        /* Pool hit: reuse existing connection */
+        entry_claim(entry);
+        atomic_fetch_add_explicit(&s_pool.pool_hits, 1, memory_order_relaxed);
+        record_latency(start_us);
+        return atomic_load_explicit(&entry->client, memory_order_relaxed);
+    }
+
+    entry = acquire_slow(timeout_ms, priority);
+    if (!entry) {
+        return NULL;
+    }
+    record_latency(start_us);
+    return atomic_load_explicit(&entry->client, memory_order_relaxed);
+}
+
+arc_http_client_t *ac_http_pool_acquire(uint32_t timeout_ms) {
+    return ac_http_pool_acquire_priority(timeout_ms, AC_PRIORITY_NORMAL);
+}
+
+arc_http_client_t *ac_http_pool_acquire_priority(uint32_t timeout_ms, ac_priority_t priority) {
+    ac_prof_push(AC_PROF_CONNECT);
+    arc_http_client_t *client = pool_acquire(timeout_ms, ac_priority_clamp((int)priority));
+    ac_prof_pop();
+    return client;
+}
+
 void ac_http_pool_release(arc_http_client_t *client) {
     if (!client) {
         return;
@@ -412,32 +1004,112 @@ void ac_http_pool_release(arc_http_client_t *client) {
         return;
     }
 
-    pthread_mutex_lock(&s_pool.mutex);
-
     pool_entry_t *entry = find_entry_by_client(client);
     if (!entry) {
-        pthread_mutex_unlock(&s_pool.mutex);
         AC_LOG_WARN("HTTP pool: releasing unknown client");
         return;
     }
 
-    if (!entry->in_use) {
-        pthread_mutex_unlock(&s_pool.mutex);
+    int expected = 1;
+    if (!atomic_compare_exchange_strong(&entry->in_use, &expected, 0)) {
         AC_LOG_WARN("HTTP pool: double release detected");
         return;
     }
 
-    entry->in_use = 0;
     entry->last_used_ms = get_current_time_ms();
-    s_pool.active_count--;
+    atomic_fetch_sub(&s_pool.active_count, 1);
+    idle_push(entry);
+
+    /* Signal waiting threads (and a shutdown waiting for active == 0) */
+    if (atomic_load(&s_pool.waiting_count) > 0 || atomic_load(&s_pool.shutting_down)) {
+        pthread_mutex_lock(&s_pool.mutex);
+        pthread_cond_broadcast(&s_pool.available);
+        pthread_mutex_unlock(&s_pool.mutex);
+    }
+}
+
+arc_http_engine_t *ac_http_pool_engine(void) {
+    async_wait();
+    if (!s_pool.initialized || atomic_load(&s_pool.shutting_down)) {
+        return NULL;
+    }
+    return s_pool.engine;
+}
+
+/*============================================================================
+ * Public API: Warm URLs
+ *============================================================================*/
+
+arc_err_t ac_http_pool_add_warm_url(const char *url) {
+    if (!url || !*url) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    async_wait();
+    if (!s_pool.initialized || atomic_load(&s_pool.shutting_down)) {
+        return ARC_ERR_NOT_INITIALIZED;
+    }
+    if (s_pool.config.external_loop) {
+        return ARC_OK;  /* Nothing probes on a host-driven pool */
+    }
 
-    /* Signal waiting threads */
-    pthread_cond_signal(&s_pool.available);
+    pthread_mutex_lock(&s_pool.mutex);
+
+    /* One URL per origin: a probe to any path keeps the connection warm */
+    size_t count = atomic_load(&s_pool.warm_count);
+    size_t len = origin_len(url);
+    for (size_t i = 0; i < count; i++) {
+        if (origin_len(s_pool.warm_urls[i]) == len &&
+            strncmp(s_pool.warm_urls[i], url, len) == 0) {
+            pthread_mutex_unlock(&s_pool.mutex);
+            return ARC_OK;
+        }
+    }
+
+    arc_err_t err = ARC_OK;
+    if (!s_pool.warm_urls) {
+        s_pool.warm_urls = ARC_CALLOC(HTTP_POOL_ADDED_WARM_URLS + 1, sizeof(char *));
+        s_pool.warm_cap = s_pool.warm_urls ? HTTP_POOL_ADDED_WARM_URLS : 0;
+    }
+    if (count >= s_pool.warm_cap) {
+        err = ARC_ERR_NO_MEMORY;
+    } else if (ensure_probe_client() != ARC_OK ||
+               !(s_pool.warm_urls[count] = ARC_STRDUP(url))) {
+        err = ARC_ERR_NO_MEMORY;
+    } else {
+        atomic_store(&s_pool.warm_count, count + 1);
+        if (s_pool.maintainer_running) {
+            pthread_cond_broadcast(&s_pool.maintain_wake);
+        }
+    }
 
     pthread_mutex_unlock(&s_pool.mutex);
 
-    AC_LOG_DEBUG("HTTP pool: released (active=%zu, total=%zu)",
-                 s_pool.active_count, s_pool.total_count);
+    if (err == ARC_OK) {
+        AC_LOG_DEBUG("HTTP pool: warm URL added: %.*s", (int)len, url);
+    }
+    return err;
+}
+
+/*============================================================================
+ * Public API: Host Event Loop
+ *============================================================================*/
+
+int ac_runtime_fd(void) {
+    return s_pool.initialized ? arc_http_engine_fd(s_pool.engine) : -1;
+}
+
+int ac_runtime_timeout_ms(void) {
+    return s_pool.initialized ? arc_http_engine_timeout(s_pool.engine) : -1;
+}
+
+arc_err_t ac_runtime_process(int timeout_ms) {
+    if (!s_pool.initialized || atomic_load(&s_pool.shutting_down)) {
+        return ARC_ERR_NOT_INITIALIZED;
+    }
+    if (!s_pool.engine || !s_pool.config.external_loop) {
+        return ARC_ERR_INVALID_STATE;
+    }
+    return arc_http_engine_process(s_pool.engine, timeout_ms);
 }
 
 /*============================================================================
@@ -449,6 +1121,7 @@ arc_err_t ac_http_pool_get_stats(ac_http_pool_stats_t *stats) {
         return ARC_ERR_INVALID_ARG;
     }
 
+    async_wait();
     if (!s_pool.initialized) {
         memset(stats, 0, sizeof(*stats));
         return ARC_ERR_NOT_INITIALIZED;
@@ -456,17 +1129,43 @@ arc_err_t ac_http_pool_get_stats(ac_http_pool_stats_t *stats) {
 
     pthread_mutex_lock(&s_pool.mutex);
 
+    size_t active = atomic_load(&s_pool.active_count);
     stats->max_connections = s_pool.config.max_connections;
     stats->total_connections = s_pool.total_count;
-    stats->active_connections = s_pool.active_count;
-    stats->idle_connections = s_pool.total_count - s_pool.active_count;
-    stats->waiting_requests = s_pool.waiting_count;
-    stats->total_acquires = s_pool.total_acquires;
-    stats->pool_hits = s_pool.pool_hits;
-    stats->pool_misses = s_pool.pool_misses;
-    stats->timeouts = s_pool.timeouts;
+    stats->active_connections = active;
+    stats->idle_connections = s_pool.total_count > active ? s_pool.total_count - active : 0;
+    stats->waiting_requests = atomic_load(&s_pool.waiting_count);
+    stats->total_acquires = atomic_load(&s_pool.total_acquires);
+    stats->pool_hits = atomic_load(&s_pool.pool_hits);
+    stats->pool_misses = atomic_load(&s_pool.pool_misses);
+    stats->timeouts = atomic_load(&s_pool.timeouts);
+    stats->contended_acquires = atomic_load(&s_pool.contended);
+    for (size_t i = 0; i < AC_HTTP_POOL_LATENCY_BUCKETS; i++) {
+        stats->acquire_latency[i] = atomic_load(&s_pool.latency[i]);
+    }
+    stats->multiplexed = s_pool.engine != NULL;
+
+    arc_http_origin_stats_t origins[AC_HTTP_POOL_MAX_ORIGINS];
+    size_t count = arc_http_engine_origin_stats(s_pool.engine, origins, AC_HTTP_POOL_MAX_ORIGINS);
+    stats->origin_count = count < AC_HTTP_POOL_MAX_ORIGINS ? count : AC_HTTP_POOL_MAX_ORIGINS;
+
+    for (size_t i = 0; i < stats->origin_count; i++) {
+        ac_http_pool_origin_stats_t *o = &stats->origins[i];
+        memcpy(o->origin, origins[i].origin, sizeof(o->origin));
+        o->active_streams = origins[i].active_streams;
+        o->total_requests = origins[i].total_requests;
+        o->connections_opened = origins[i].connections_opened;
+        o->http2_requests = origins[i].http2_requests;
+    }
 
     pthread_mutex_unlock(&s_pool.mutex);
 
+    arc_http_io_stats_t io;
+    arc_http_get_io_stats(&io);
+    stats->body_bytes = io.body_bytes;
+    stats->body_wire_bytes = io.body_wire_bytes;
+    stats->response_bytes = io.response_bytes;
+    stats->response_wire_bytes = io.response_wire_bytes;
+
     return ARC_OK;
 }
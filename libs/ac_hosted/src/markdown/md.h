@@ -10,7 +10,8 @@
  *   - Paragraphs
  *   - Block quotes
  *   - Ordered and unordered lists (with nesting)
- *   - Fenced code blocks with language labels
+ *   - Fenced code blocks with language labels and syntax highlighting
+ *     (C, Python, JavaScript, shell, JSON, diff; see md_highlight.h)
  *   - Horizontal rules
  *   - Tables with alignment
  * 
@@ -24,6 +25,7 @@
  * Features:
  *   - UTF-8 support with proper CJK character width handling
  *   - Streaming API for incremental rendering
+ *   - Render thread so slow terminals do not hold up the network (md_async.h)
  *   - OSC 8 hyperlink support detection
  * 
  * Example usage:
@@ -46,8 +48,11 @@
 #include "md_types.h"
 #include "md_style.h"
 #include "md_utils.h"
+#include "md_highlight.h"
 #include "md_parser.h"
 #include "md_renderer.h"
 #include "md_stream.h"
+#include "md_async.h"
+#include "md_transcript.h"
 
 #endif /* MD_H */
@@ -0,0 +1,245 @@
+/**
+ * @file md_async.c
+ * @brief Render thread for streamed Markdown
+ */
+
+#include "md_async.h"
+#include "md_utils.h"
+#include "arc/platform.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========== Event queue ========== */
+
+typedef enum {
+    MD_EVENT_FEED,
+    MD_EVENT_WRITE,
+    MD_EVENT_FINISH
+} md_event_type_t;
+
+typedef struct {
+    md_event_type_t type;
+    size_t offset;          /* Text in the queue's buffer */
+    size_t len;
+} md_event_t;
+
+/* Events with their text; consecutive feeds or writes share one event */
+typedef struct {
+    md_event_t* events;
+    size_t count;
+    size_t cap;
+    char* text;
+    size_t text_len;
+    size_t text_size;
+} md_queue_t;
+
+struct md_async {
+    md_stream_t* stream;
+    int frame_ms;
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;   /* Queue not empty, or stopping */
+    pthread_cond_t idle;    /* Queue empty and nothing being rendered */
+    md_queue_t queued;      /* Filled by producers */
+    md_queue_t rendering;   /* Owned by the render thread between frames */
+    int busy;
+    int stopping;
+    md_async_frame_fn frame;
+    void* frame_userdata;
+    size_t fed;             /* Render thread: feed bytes rendered */
+    size_t finished;        /* Render thread: finishes rendered */
+};
+
+static int queue_push(md_queue_t* q, md_event_type_t type, const char* data, size_t len) {
+    md_event_t* last = q->count > 0 ? &q->events[q->count - 1] : NULL;
+
+    if (!last || last->type != type || type == MD_EVENT_FINISH) {
+        if (q->count >= q->cap) {
+            size_t cap = q->cap ? q->cap * 2 : 16;
+            md_event_t* events = (md_event_t*)realloc(q->events, cap * sizeof(*events));
+            if (!events) return -1;
+            q->events = events;
+            q->cap = cap;
+        }
+        last = &q->events[q->count++];
+        last->type = type;
+        last->offset = q->text_len;
+        last->len = 0;
+    }
+
+    if (len > 0) {
+        if (md_buffer_append_n(&q->text, &q->text_size, &q->text_len, data, len) != 0) {
+            if (last->len == 0) q->count--;
+            return -1;
+        }
+        last->len += len;
+    }
+    return 0;
+}
+
+static void queue_free(md_queue_t* q) {
+    free(q->events);
+    free(q->text);
+}
+
+/* ========== Render thread ========== */
+
+static void render_events(md_async_t* ui, const md_queue_t* q) {
+    for (size_t i = 0; i < q->count; i++) {
+        const md_event_t* e = &q->events[i];
+        switch (e->type) {
+            case MD_EVENT_FEED:
+                md_stream_feed(ui->stream, q->text + e->offset, e->len);
+                ui->fed += e->len;
+                break;
+            case MD_EVENT_WRITE:
+                md_stream_write(ui->stream, q->text + e->offset, e->len);
+                break;
+            case MD_EVENT_FINISH:
+                md_stream_finish(ui->stream);
+                md_stream_reset(ui->stream);
+                ui->finished++;
+                break;
+        }
+    }
+    md_stream_flush(ui->stream);
+    if (ui->frame) {
+        ui->frame(ui->fed, ui->finished, ui->frame_userdata);
+    }
+}
+
+static void* render_main(void* arg) {
+    md_async_t* ui = (md_async_t*)arg;
+
+    pthread_mutex_lock(&ui->lock);
+    for (;;) {
+        while (ui->queued.count == 0 && !ui->stopping) {
+            pthread_cond_wait(&ui->ready, &ui->lock);
+        }
+        if (ui->queued.count == 0) break;
+
+        /* Take everything queued; producers refill the emptied buffers */
+        md_queue_t taken = ui->queued;
+        ui->queued = ui->rendering;
+        ui->rendering = taken;
+        ui->busy = 1;
+        pthread_mutex_unlock(&ui->lock);
+
+        uint64_t frame_start = ac_platform_monotonic_us();
+        render_events(ui, &ui->rendering);
+        ui->rendering.count = 0;
+        ui->rendering.text_len = 0;
+
+        pthread_mutex_lock(&ui->lock);
+        ui->busy = 0;
+        if (ui->queued.count == 0) {
+            pthread_cond_broadcast(&ui->idle);
+        }
+
+        /* Let the next frame's deltas pile up rather than render each one */
+        if (ui->frame_ms > 0 && !ui->stopping) {
+            uint64_t spent_ms = (ac_platform_monotonic_us() - frame_start) / 1000;
+            if (spent_ms < (uint64_t)ui->frame_ms) {
+                pthread_mutex_unlock(&ui->lock);
+                ac_platform_sleep_ms((uint32_t)((uint64_t)ui->frame_ms - spent_ms));
+                pthread_mutex_lock(&ui->lock);
+            }
+        }
+    }
+    pthread_cond_broadcast(&ui->idle);
+    pthread_mutex_unlock(&ui->lock);
+    return NULL;
+}
+
+/* ========== Public API ========== */
+
+md_async_t* md_async_new(md_stream_t* stream, int frame_ms) {
+    if (!stream) return NULL;
+
+    md_async_t* ui = (md_async_t*)calloc(1, sizeof(md_async_t));
+    if (!ui) return NULL;
+
+    ui->stream = stream;
+    ui->frame_ms = frame_ms > 0 ? frame_ms : 0;
+    pthread_mutex_init(&ui->lock, NULL);
+    pthread_cond_init(&ui->ready, NULL);
+    pthread_cond_init(&ui->idle, NULL);
+
+    /* Frames pace the writes; each frame ends with a flush */
+    md_stream_set_batching(stream, ui->frame_ms);
+
+    if (pthread_create(&ui->thread, NULL, render_main, ui) != 0) {
+        pthread_cond_destroy(&ui->idle);
+        pthread_cond_destroy(&ui->ready);
+        pthread_mutex_destroy(&ui->lock);
+        free(ui);
+        return NULL;
+    }
+    return ui;
+}
+
+void md_async_set_frame_callback(md_async_t* ui, md_async_frame_fn frame, void* userdata) {
+    if (!ui) return;
+    pthread_mutex_lock(&ui->lock);
+    ui->frame = frame;
+    ui->frame_userdata = userdata;
+    pthread_mutex_unlock(&ui->lock);
+}
+
+static int enqueue(md_async_t* ui, md_event_type_t type, const char* data, size_t len) {
+    if (!ui) return -1;
+    if (type != MD_EVENT_FINISH && (!data || len == 0)) return 0;
+
+    pthread_mutex_lock(&ui->lock);
+    int was_empty = ui->queued.count == 0;
+    int rc = queue_push(&ui->queued, type, data, len);
+    if (rc == 0 && was_empty) {
+        pthread_cond_signal(&ui->ready);
+    }
+    pthread_mutex_unlock(&ui->lock);
+    return rc;
+}
+
+int md_async_feed(md_async_t* ui, const char* data, size_t len) {
+    return enqueue(ui, MD_EVENT_FEED, data, len);
+}
+
+int md_async_write(md_async_t* ui, const char* data, size_t len) {
+    return enqueue(ui, MD_EVENT_WRITE, data, len);
+}
+
+int md_async_finish(md_async_t* ui) {
+    return enqueue(ui, MD_EVENT_FINISH, NULL, 0);
+}
+
+void md_async_wait(md_async_t* ui) {
+    if (!ui) return;
+
+    pthread_mutex_lock(&ui->lock);
+    while (ui->queued.count > 0 || ui->busy) {
+        pthread_cond_wait(&ui->idle, &ui->lock);
+    }
+    pthread_mutex_unlock(&ui->lock);
+}
+
+void md_async_free(md_async_t* ui) {
+    if (!ui) return;
+
+    pthread_mutex_lock(&ui->lock);
+    ui->stopping = 1;
+    pthread_cond_signal(&ui->ready);
+    pthread_mutex_unlock(&ui->lock);
+    pthread_join(ui->thread, NULL);
+
+    md_stream_free(ui->stream);
+    queue_free(&ui->queued);
+    queue_free(&ui->rendering);
+    pthread_cond_destroy(&ui->idle);
+    pthread_cond_destroy(&ui->ready);
+    pthread_mutex_destroy(&ui->lock);
+    free(ui);
+}
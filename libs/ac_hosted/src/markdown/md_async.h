@@ -0,0 +1,112 @@
+/**
+ * @file md_async.h
+ * @brief Render thread for streamed Markdown
+ *
+ * Stream callbacks run on the thread that reads the socket, so rendering
+ * there lets a slow terminal hold up the read. An md_async_t queues what
+ * the callback hands it and renders on its own thread: the callback only
+ * copies bytes under a mutex, and the render thread takes everything
+ * queued at once, at most once per frame, so a burst of small deltas is
+ * parsed and written as one chunk.
+ *
+ * Example:
+ *
+ *   md_async_t* ui = md_async_new(md_stream_new(), MD_ASYNC_FRAME_MS);
+ *   // in the stream callback
+ *   md_async_feed(ui, event->delta, event->delta_len);
+ *   // once the response is done
+ *   md_async_finish(ui);
+ *   md_async_wait(ui);
+ *   ...
+ *   md_async_free(ui);
+ */
+
+#ifndef MD_ASYNC_H
+#define MD_ASYNC_H
+
+#include "md_stream.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default frame interval: ~60 frames per second */
+#define MD_ASYNC_FRAME_MS 16
+
+typedef struct md_async md_async_t;
+
+/**
+ * Called on the render thread after each frame has been written
+ * @param fed Markdown bytes fed since the context was created; the
+ *        complete lines among them are on screen, and all of them once a
+ *        finish queued after them has been rendered
+ * @param finished Finishes rendered since the context was created
+ * @param userdata User data given with the callback
+ */
+typedef void (*md_async_frame_fn)(size_t fed, size_t finished, void* userdata);
+
+/**
+ * Start a render thread for a stream
+ * The stream is owned by the md_async_t from here on and freed with it;
+ * do not use it directly until then.
+ * @param stream Stream to render into
+ * @param frame_ms Minimum time between frames (0: render as soon as queued)
+ * @return New context, or NULL on failure (the stream is then left to the caller)
+ */
+md_async_t* md_async_new(md_stream_t* stream, int frame_ms);
+
+/**
+ * Set a callback for the end of each frame, e.g. to measure how long
+ * text takes to reach the screen
+ * Set it before queuing anything.
+ * @param ui Context
+ * @param frame Callback (NULL to remove)
+ * @param userdata User data passed to it
+ */
+void md_async_set_frame_callback(md_async_t* ui, md_async_frame_fn frame, void* userdata);
+
+/**
+ * Queue Markdown text (any thread; never waits for rendering)
+ * @param ui Context
+ * @param data Text (need not be NUL-terminated)
+ * @param len Length of text
+ * @return 0 on success, -1 if out of memory
+ */
+int md_async_feed(md_async_t* ui, const char* data, size_t len);
+
+/**
+ * Queue text to write as-is, e.g. escape sequences or tool status
+ * It follows the output of the complete lines queued before it.
+ * @param ui Context
+ * @param data Text (need not be NUL-terminated)
+ * @param len Length of text
+ * @return 0 on success, -1 if out of memory
+ */
+int md_async_write(md_async_t* ui, const char* data, size_t len);
+
+/**
+ * Queue the end of the document (md_stream_finish, then md_stream_reset)
+ * so the next text starts a new one
+ * @param ui Context
+ * @return 0 on success, -1 if out of memory
+ */
+int md_async_finish(md_async_t* ui);
+
+/**
+ * Wait until everything queued so far has been rendered and written
+ * @param ui Context
+ */
+void md_async_wait(md_async_t* ui);
+
+/**
+ * Render what is still queued, stop the thread and free the stream
+ * @param ui Context
+ */
+void md_async_free(md_async_t* ui);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MD_ASYNC_H */
@@ -0,0 +1,643 @@
+/**
+ * @file md_highlight.c
+ * @brief Syntax highlighting for fenced code blocks
+ */
+
+#include "md_highlight.h"
+#include "md_style.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========== Language tables ========== */
+
+/* Lexer state between lines (md_hl_state_t) */
+enum {
+    MD_HL_IN_BLOCK_COMMENT = 1,
+    MD_HL_IN_TRIPLE_SINGLE,
+    MD_HL_IN_TRIPLE_DOUBLE,
+    MD_HL_IN_MULTILINE_STRING
+};
+
+/* Lexer features of a language */
+#define MD_HL_TRIPLE_QUOTES  0x01   /* ''' and """ strings span lines */
+#define MD_HL_DIRECTIVES     0x02   /* '#' starting a line is a directive */
+#define MD_HL_DECORATORS     0x04   /* '@' starting a line is a decorator */
+#define MD_HL_VARIABLES      0x08   /* '$' expansions */
+#define MD_HL_KEYS           0x10   /* A string before ':' is a key */
+#define MD_HL_NUMBERS        0x20
+#define MD_HL_WORD_COMMENTS  0x40   /* Line comments only start a word */
+
+/* Sorted word list, searched by bisection */
+typedef struct {
+    const char* const* words;
+    size_t count;
+} md_hl_words_t;
+
+#define MD_HL_WORDS(list) { list, sizeof(list) / sizeof(list[0]) }
+#define MD_HL_NO_WORDS { NULL, 0 }
+
+typedef struct {
+    const char* line_comment;   /* NULL: none */
+    const char* block_open;     /* NULL: no block comments */
+    const char* block_close;
+    const char* quotes;         /* Delimiters of strings ending on their line */
+    char multiline_quote;       /* Delimiter of strings that span lines, or 0 */
+    unsigned flags;
+    md_hl_words_t keywords;
+    md_hl_words_t types;
+    md_hl_words_t literals;
+} md_hl_spec_t;
+
+static const char* const c_keywords[] = {
+    "auto", "break", "case", "catch", "class", "const", "constexpr", "continue",
+    "default", "delete", "do", "else", "enum", "extern", "for", "goto", "if",
+    "inline", "namespace", "new", "private", "protected", "public", "register",
+    "restrict", "return", "sizeof", "static", "static_assert", "struct", "switch",
+    "template", "throw", "try", "typedef", "typename", "union", "using", "virtual",
+    "volatile", "while"
+};
+static const char* const c_types[] = {
+    "bool", "char", "double", "float", "int", "int16_t", "int32_t", "int64_t",
+    "int8_t", "long", "ptrdiff_t", "short", "signed", "size_t", "ssize_t",
+    "uint16_t", "uint32_t", "uint64_t", "uint8_t", "uintptr_t", "unsigned", "void",
+    "wchar_t"
+};
+static const char* const c_literals[] = {
+    "NULL", "false", "nullptr", "true"
+};
+
+static const char* const py_keywords[] = {
+    "and", "as", "assert", "async", "await", "break", "class", "continue", "def",
+    "del", "elif", "else", "except", "finally", "for", "from", "global", "if",
+    "import", "in", "is", "lambda", "nonlocal", "not", "or", "pass", "raise",
+    "return", "try", "while", "with", "yield"
+};
+static const char* const py_types[] = {
+    "bool", "bytes", "dict", "float", "int", "list", "object", "set", "str", "tuple"
+};
+static const char* const py_literals[] = {
+    "False", "None", "True", "self"
+};
+
+static const char* const js_keywords[] = {
+    "async", "await", "break", "case", "catch", "class", "const", "continue",
+    "default", "delete", "do", "else", "export", "extends", "finally", "for",
+    "from", "function", "if", "import", "in", "instanceof", "interface", "let",
+    "new", "of", "return", "static", "super", "switch", "throw", "try", "type",
+    "typeof", "var", "void", "while", "yield"
+};
+static const char* const js_types[] = {
+    "any", "boolean", "never", "number", "string", "unknown"
+};
+static const char* const js_literals[] = {
+    "Infinity", "NaN", "false", "null", "this", "true", "undefined"
+};
+
+static const char* const sh_keywords[] = {
+    "case", "do", "done", "elif", "else", "esac", "export", "fi", "for",
+    "function", "if", "in", "local", "readonly", "return", "select", "then",
+    "until", "while"
+};
+static const char* const sh_builtins[] = {
+    "cd", "echo", "eval", "exec", "exit", "printf", "read", "set", "shift",
+    "source", "test", "trap", "unset"
+};
+static const char* const sh_literals[] = {
+    "false", "true"
+};
+
+static const char* const json_literals[] = {
+    "false", "null", "true"
+};
+
+/* Indexed by md_hl_lang_t; MD_HL_DIFF is lexed by diff_line() */
+static const md_hl_spec_t specs[] = {
+    [MD_HL_C] = {
+        "//", "/*", "*/", "\"'", 0,
+        MD_HL_DIRECTIVES | MD_HL_NUMBERS,
+        MD_HL_WORDS(c_keywords), MD_HL_WORDS(c_types), MD_HL_WORDS(c_literals)
+    },
+    [MD_HL_PYTHON] = {
+        "#", NULL, NULL, "\"'", 0,
+        MD_HL_TRIPLE_QUOTES | MD_HL_DECORATORS | MD_HL_NUMBERS,
+        MD_HL_WORDS(py_keywords), MD_HL_WORDS(py_types), MD_HL_WORDS(py_literals)
+    },
+    [MD_HL_JS] = {
+        "//", "/*", "*/", "\"'", '`',
+        MD_HL_DECORATORS | MD_HL_NUMBERS,
+        MD_HL_WORDS(js_keywords), MD_HL_WORDS(js_types), MD_HL_WORDS(js_literals)
+    },
+    [MD_HL_SHELL] = {
+        "#", NULL, NULL, "\"'", 0,
+        MD_HL_VARIABLES | MD_HL_WORD_COMMENTS,
+        MD_HL_WORDS(sh_keywords), MD_HL_WORDS(sh_builtins), MD_HL_WORDS(sh_literals)
+    },
+    [MD_HL_JSON] = {
+        "//", "/*", "*/", "\"", 0,
+        MD_HL_KEYS | MD_HL_NUMBERS,
+        MD_HL_NO_WORDS, MD_HL_NO_WORDS, MD_HL_WORDS(json_literals)
+    },
+};
+
+static const struct {
+    const char* name;
+    md_hl_lang_t lang;
+} lang_names[] = {
+    { "c", MD_HL_C }, { "h", MD_HL_C }, { "cpp", MD_HL_C }, { "c++", MD_HL_C },
+    { "cc", MD_HL_C }, { "cxx", MD_HL_C }, { "hpp", MD_HL_C },
+    { "python", MD_HL_PYTHON }, { "py", MD_HL_PYTHON }, { "python3", MD_HL_PYTHON },
+    { "javascript", MD_HL_JS }, { "js", MD_HL_JS }, { "jsx", MD_HL_JS },
+    { "mjs", MD_HL_JS }, { "typescript", MD_HL_JS }, { "ts", MD_HL_JS },
+    { "tsx", MD_HL_JS },
+    { "sh", MD_HL_SHELL }, { "bash", MD_HL_SHELL }, { "shell", MD_HL_SHELL },
+    { "zsh", MD_HL_SHELL },
+    { "json", MD_HL_JSON }, { "jsonc", MD_HL_JSON },
+    { "diff", MD_HL_DIFF }, { "patch", MD_HL_DIFF },
+};
+
+md_hl_lang_t md_hl_lang_from_name(const char* name, size_t len) {
+    if (!name) return MD_HL_NONE;
+
+    /* The language is the first word of the info string */
+    while (len > 0 && isspace((unsigned char)*name)) {
+        name++;
+        len--;
+    }
+    size_t word = 0;
+    while (word < len && !isspace((unsigned char)name[word]) &&
+           name[word] != '{' && name[word] != ',') {
+        word++;
+    }
+
+    for (size_t i = 0; i < sizeof(lang_names) / sizeof(lang_names[0]); i++) {
+        const char* candidate = lang_names[i].name;
+        size_t n = strlen(candidate);
+        if (n != word) continue;
+
+        size_t k = 0;
+        while (k < n && tolower((unsigned char)name[k]) == candidate[k]) k++;
+        if (k == n) return lang_names[i].lang;
+    }
+    return MD_HL_NONE;
+}
+
+const char* md_hl_style(md_hl_class_t cls) {
+    switch (cls) {
+        case MD_HL_KEYWORD:  return MD_HL_KEYWORD_STYLE;
+        case MD_HL_TYPE:     return MD_HL_TYPE_STYLE;
+        case MD_HL_LITERAL:  return MD_HL_LITERAL_STYLE;
+        case MD_HL_STRING:   return MD_HL_STRING_STYLE;
+        case MD_HL_NUMBER:   return MD_HL_NUMBER_STYLE;
+        case MD_HL_COMMENT:  return MD_HL_COMMENT_STYLE;
+        case MD_HL_PREPROC:  return MD_HL_PREPROC_STYLE;
+        case MD_HL_VARIABLE: return MD_HL_VARIABLE_STYLE;
+        case MD_HL_PROPERTY: return MD_HL_PROPERTY_STYLE;
+        case MD_HL_ADDED:    return MD_HL_ADDED_STYLE;
+        case MD_HL_REMOVED:  return MD_HL_REMOVED_STYLE;
+        case MD_HL_HUNK:     return MD_HL_HUNK_STYLE;
+        case MD_HL_HEADER:   return MD_HL_HEADER_STYLE;
+        case MD_HL_PLAIN:    break;
+    }
+    return "";
+}
+
+/* ========== Line lexer ========== */
+
+static int push_span(md_hl_spans_t* spans, size_t first, size_t start, size_t len,
+                     md_hl_class_t cls) {
+    if (len == 0) return 0;
+
+    /* Runs of one class merge, but never with the previous line's */
+    if (spans->count > first) {
+        md_hl_span_t* last = &spans->items[spans->count - 1];
+        if (last->cls == cls && last->start + last->len == start) {
+            last->len += (uint32_t)len;
+            return 0;
+        }
+    }
+
+    if (spans->count >= spans->cap) {
+        size_t cap = spans->cap ? spans->cap * 2 : 16;
+        md_hl_span_t* items = (md_hl_span_t*)realloc(spans->items, cap * sizeof(*items));
+        if (!items) return -1;
+        spans->items = items;
+        spans->cap = cap;
+    }
+    md_hl_span_t* span = &spans->items[spans->count++];
+    span->start = (uint32_t)start;
+    span->len = (uint32_t)len;
+    span->cls = cls;
+    return 0;
+}
+
+static int is_word_start(unsigned char c) {
+    return isalpha(c) || c == '_' || c >= 0x80;
+}
+
+static int is_word_char(unsigned char c) {
+    return isalnum(c) || c == '_' || c >= 0x80;
+}
+
+static int has_at(const char* s, size_t i, size_t len, const char* str) {
+    size_t n = strlen(str);
+    return n <= len - i && memcmp(s + i, str, n) == 0;
+}
+
+/* Index of the first str at or after i, or len */
+static size_t find_str(const char* s, size_t i, size_t len, const char* str) {
+    size_t n = strlen(str);
+    for (; i + n <= len; i++) {
+        if (s[i] == str[0] && memcmp(s + i, str, n) == 0) return i;
+    }
+    return len;
+}
+
+/* End of a string whose opening quote is before i; *closed is 0 if it runs off the line */
+static size_t scan_string(const char* s, size_t i, size_t len, char quote, int* closed) {
+    while (i < len) {
+        if (s[i] == '\\') {
+            i += 2;
+            continue;
+        }
+        if (s[i] == quote) {
+            *closed = 1;
+            return i + 1;
+        }
+        i++;
+    }
+    *closed = 0;
+    return len;
+}
+
+static size_t scan_triple(const char* s, size_t i, size_t len, char quote, int* closed) {
+    const char triple[4] = { quote, quote, quote, '\0' };
+    while (i < len) {
+        if (s[i] == '\\') {
+            i += 2;
+            continue;
+        }
+        if (has_at(s, i, len, triple)) {
+            *closed = 1;
+            return i + 3;
+        }
+        i++;
+    }
+    *closed = 0;
+    return len;
+}
+
+static int in_words(const md_hl_words_t* list, const char* word, size_t len) {
+    size_t lo = 0;
+    size_t hi = list->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const char* w = list->words[mid];
+        int cmp = strncmp(w, word, len);
+        if (cmp == 0) cmp = w[len] == '\0' ? 0 : 1;
+        if (cmp == 0) return 1;
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0;
+}
+
+static int only_spaces_before(const char* s, size_t i) {
+    while (i > 0) {
+        if (!isspace((unsigned char)s[--i])) return 0;
+    }
+    return 1;
+}
+
+static int diff_line(const char* line, size_t len, md_hl_spans_t* spans) {
+    md_hl_class_t cls = MD_HL_PLAIN;
+    if (has_at(line, 0, len, "+++ ") || has_at(line, 0, len, "--- ") ||
+        has_at(line, 0, len, "diff ") || has_at(line, 0, len, "index ")) {
+        cls = MD_HL_HEADER;
+    } else if (has_at(line, 0, len, "@@")) {
+        cls = MD_HL_HUNK;
+    } else if (len > 0 && line[0] == '+') {
+        cls = MD_HL_ADDED;
+    } else if (len > 0 && line[0] == '-') {
+        cls = MD_HL_REMOVED;
+    }
+    if (cls == MD_HL_PLAIN) return 0;
+    return push_span(spans, spans->count, 0, len, cls);
+}
+
+/* Finish a comment or string left open by the previous line; returns where lexing resumes */
+static size_t resume_state(const md_hl_spec_t* spec, md_hl_state_t* state, const char* line,
+                           size_t len, md_hl_spans_t* spans, size_t first, int* rc) {
+    size_t end = len;
+    int closed = 0;
+    md_hl_class_t cls = MD_HL_STRING;
+
+    switch (*state) {
+        case MD_HL_IN_BLOCK_COMMENT:
+            cls = MD_HL_COMMENT;
+            end = spec->block_close ? find_str(line, 0, len, spec->block_close) : len;
+            closed = end < len;
+            if (closed) end += strlen(spec->block_close);
+            break;
+        case MD_HL_IN_TRIPLE_SINGLE:
+            end = scan_triple(line, 0, len, '\'', &closed);
+            break;
+        case MD_HL_IN_TRIPLE_DOUBLE:
+            end = scan_triple(line, 0, len, '"', &closed);
+            break;
+        case MD_HL_IN_MULTILINE_STRING:
+            end = scan_string(line, 0, len, spec->multiline_quote, &closed);
+            break;
+        default:
+            *state = MD_HL_STATE_INIT;
+            return 0;
+    }
+
+    if (closed) *state = MD_HL_STATE_INIT;
+    if (end > len) end = len;
+    *rc = push_span(spans, first, 0, end, cls);
+    return end;
+}
+
+int md_hl_line(md_hl_lang_t lang, md_hl_state_t* state, const char* line, size_t len,
+               md_hl_spans_t* spans) {
+    if (!state || !spans || (!line && len > 0)) return -1;
+    if (lang == MD_HL_NONE || len > UINT32_MAX) return 0;
+    if (lang == MD_HL_DIFF) return diff_line(line, len, spans);
+
+    const md_hl_spec_t* spec = &specs[lang];
+    size_t first = spans->count;
+    int rc = 0;
+    size_t i = resume_state(spec, state, line, len, spans, first, &rc);
+
+    while (i < len && rc == 0) {
+        unsigned char c = (unsigned char)line[i];
+        size_t start = i;
+        md_hl_class_t cls = MD_HL_PLAIN;
+        int closed = 1;
+
+        if (spec->block_open && has_at(line, i, len, spec->block_open)) {
+            size_t open = strlen(spec->block_open);
+            i = find_str(line, i + open, len, spec->block_close);
+            if (i < len) {
+                i += strlen(spec->block_close);
+            } else {
+                *state = MD_HL_IN_BLOCK_COMMENT;
+            }
+            cls = MD_HL_COMMENT;
+        } else if (spec->line_comment && has_at(line, i, len, spec->line_comment) &&
+                   (!(spec->flags & MD_HL_WORD_COMMENTS) || i == 0 ||
+                    isspace((unsigned char)line[i - 1]))) {
+            i = len;
+            cls = MD_HL_COMMENT;
+        } else if ((spec->flags & MD_HL_TRIPLE_QUOTES) && (c == '"' || c == '\'') &&
+                   i + 2 < len && line[i + 1] == (char)c && line[i + 2] == (char)c) {
+            i = scan_triple(line, i + 3, len, (char)c, &closed);
+            if (!closed) *state = c == '\'' ? MD_HL_IN_TRIPLE_SINGLE : MD_HL_IN_TRIPLE_DOUBLE;
+            cls = MD_HL_STRING;
+        } else if (spec->multiline_quote && c == (unsigned char)spec->multiline_quote) {
+            i = scan_string(line, i + 1, len, (char)c, &closed);
+            if (!closed) *state = MD_HL_IN_MULTILINE_STRING;
+            cls = MD_HL_STRING;
+        } else if (c != '\0' && strchr(spec->quotes, c)) {
+            i = scan_string(line, i + 1, len, (char)c, &closed);
+            if (i > len) i = len;
+            cls = MD_HL_STRING;
+            if (spec->flags & MD_HL_KEYS) {
+                size_t j = i;
+                while (j < len && isspace((unsigned char)line[j])) j++;
+                if (j < len && line[j] == ':') cls = MD_HL_PROPERTY;
+            }
+        } else if ((spec->flags & MD_HL_DIRECTIVES) && c == '#' && only_spaces_before(line, i)) {
+            i++;
+            while (i < len && isspace((unsigned char)line[i])) i++;
+            size_t name = i;
+            while (i < len && is_word_char((unsigned char)line[i])) i++;
+            int is_include = i - name == 7 && memcmp(line + name, "include", 7) == 0;
+            rc = push_span(spans, first, start, i - start, MD_HL_PREPROC);
+
+            /* The header of an #include is drawn as a string */
+            size_t j = i;
+            while (j < len && isspace((unsigned char)line[j])) j++;
+            if (is_include && j < len && line[j] == '<') {
+                size_t close = find_str(line, j, len, ">");
+                start = j;
+                i = close < len ? close + 1 : len;
+                cls = MD_HL_STRING;
+            } else {
+                continue;
+            }
+        } else if ((spec->flags & MD_HL_DECORATORS) && c == '@' && only_spaces_before(line, i)) {
+            i++;
+            while (i < len && (is_word_char((unsigned char)line[i]) || line[i] == '.')) i++;
+            cls = MD_HL_PREPROC;
+        } else if ((spec->flags & MD_HL_VARIABLES) && c == '$' && i + 1 < len) {
+            unsigned char n = (unsigned char)line[i + 1];
+            if (n == '{') {
+                size_t close = find_str(line, i + 2, len, "}");
+                i = close < len ? close + 1 : len;
+            } else if (is_word_start(n)) {
+                i += 2;
+                while (i < len && is_word_char((unsigned char)line[i])) i++;
+            } else if (isdigit(n) || strchr("@*#?$!-", n)) {
+                i += 2;
+            } else {
+                i++;
+                continue;
+            }
+            cls = MD_HL_VARIABLE;
+        } else if ((spec->flags & MD_HL_NUMBERS) && isdigit(c)) {
+            int hex = c == '0' && i + 1 < len && (line[i + 1] == 'x' || line[i + 1] == 'X');
+            i++;
+            while (i < len) {
+                unsigned char d = (unsigned char)line[i];
+                if (isalnum(d) || d == '.' || d == '_') {
+                    i++;
+                } else if ((d == '+' || d == '-') && !hex &&
+                           (line[i - 1] == 'e' || line[i - 1] == 'E')) {
+                    i++;
+                } else {
+                    break;
+                }
+            }
+            cls = MD_HL_NUMBER;
+        } else if (is_word_start(c)) {
+            i++;
+            while (i < len && is_word_char((unsigned char)line[i])) i++;
+            size_t n = i - start;
+            if (in_words(&spec->keywords, line + start, n)) {
+                cls = MD_HL_KEYWORD;
+            } else if (in_words(&spec->types, line + start, n)) {
+                cls = MD_HL_TYPE;
+            } else if (in_words(&spec->literals, line + start, n)) {
+                cls = MD_HL_LITERAL;
+            }
+        } else {
+            i++;
+            continue;
+        }
+
+        if (cls != MD_HL_PLAIN) {
+            rc = push_span(spans, first, start, i - start, cls);
+        }
+    }
+    return rc;
+}
+
+void md_hl_spans_free(md_hl_spans_t* spans) {
+    if (!spans) return;
+    free(spans->items);
+    spans->items = NULL;
+    spans->count = 0;
+    spans->cap = 0;
+}
+
+/* ========== Block cache ========== */
+
+struct md_highlight {
+    md_hl_lang_t lang;
+    uint64_t hash;
+    char* code;             /* Copy of the block, to rule out hash collisions */
+    size_t len;
+    md_hl_spans_t spans;
+    size_t* line_spans;     /* Index of each line's first span, plus one past the end */
+    size_t line_count;
+    int refs;               /* The cache's slot and each caller holding it */
+    uint64_t used;          /* cache_tick at the last lookup */
+};
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static md_highlight_t* cache[MD_HL_CACHE_SLOTS];
+static uint64_t cache_tick;
+
+static uint64_t block_hash(md_hl_lang_t lang, const char* code, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    h ^= (uint64_t)lang;
+    h *= 1099511628211ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)code[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static void highlight_free(md_highlight_t* hl) {
+    free(hl->code);
+    md_hl_spans_free(&hl->spans);
+    free(hl->line_spans);
+    free(hl);
+}
+
+/* Drop one reference; call with cache_lock held */
+static void highlight_unref(md_highlight_t* hl) {
+    if (--hl->refs == 0) highlight_free(hl);
+}
+
+static md_highlight_t* highlight_new(md_hl_lang_t lang, const char* code, size_t len,
+                                     uint64_t hash) {
+    md_highlight_t* hl = (md_highlight_t*)calloc(1, sizeof(md_highlight_t));
+    if (!hl) return NULL;
+    hl->lang = lang;
+    hl->hash = hash;
+    hl->len = len;
+    hl->code = (char*)malloc(len + 1);
+    if (!hl->code) goto fail;
+    memcpy(hl->code, code, len);
+    hl->code[len] = '\0';
+
+    for (const char* p = code; p < code + len; hl->line_count++) {
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(code + len - p));
+        p = nl ? nl + 1 : code + len;
+    }
+    hl->line_spans = (size_t*)malloc((hl->line_count + 1) * sizeof(size_t));
+    if (!hl->line_spans) goto fail;
+
+    md_hl_state_t state = MD_HL_STATE_INIT;
+    const char* p = code;
+    for (size_t i = 0; i < hl->line_count; i++) {
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(code + len - p));
+        const char* end = nl ? nl : code + len;
+        hl->line_spans[i] = hl->spans.count;
+        if (md_hl_line(lang, &state, p, (size_t)(end - p), &hl->spans) != 0) goto fail;
+        p = nl ? nl + 1 : end;
+    }
+    hl->line_spans[hl->line_count] = hl->spans.count;
+    return hl;
+
+fail:
+    highlight_free(hl);
+    return NULL;
+}
+
+const md_highlight_t* md_highlight_block(md_hl_lang_t lang, const char* code, size_t len) {
+    if (lang == MD_HL_NONE || !code) return NULL;
+
+    uint64_t hash = block_hash(lang, code, len);
+
+    pthread_mutex_lock(&cache_lock);
+    for (size_t i = 0; i < MD_HL_CACHE_SLOTS; i++) {
+        md_highlight_t* hl = cache[i];
+        if (hl && hl->hash == hash && hl->lang == lang && hl->len == len &&
+            memcmp(hl->code, code, len) == 0) {
+            hl->refs++;
+            hl->used = ++cache_tick;
+            pthread_mutex_unlock(&cache_lock);
+            return hl;
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    /* Lex outside the lock; blocks being drawn keep their reference */
+    md_highlight_t* hl = highlight_new(lang, code, len, hash);
+    if (!hl) return NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    size_t slot = 0;
+    for (size_t i = 0; i < MD_HL_CACHE_SLOTS; i++) {
+        if (!cache[i]) {
+            slot = i;
+            break;
+        }
+        if (cache[i]->used < cache[slot]->used) slot = i;
+    }
+    if (cache[slot]) highlight_unref(cache[slot]);
+    hl->refs = 2;
+    hl->used = ++cache_tick;
+    cache[slot] = hl;
+    pthread_mutex_unlock(&cache_lock);
+    return hl;
+}
+
+const md_hl_span_t* md_highlight_line_spans(const md_highlight_t* hl, size_t line, size_t* count) {
+    if (count) *count = 0;
+    if (!hl || line >= hl->line_count) return NULL;
+
+    size_t first = hl->line_spans[line];
+    size_t n = hl->line_spans[line + 1] - first;
+    if (count) *count = n;
+    return n > 0 ? hl->spans.items + first : NULL;
+}
+
+void md_highlight_release(const md_highlight_t* hl) {
+    if (!hl) return;
+
+    pthread_mutex_lock(&cache_lock);
+    highlight_unref((md_highlight_t*)hl);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void md_highlight_cache_clear(void) {
+    pthread_mutex_lock(&cache_lock);
+    for (size_t i = 0; i < MD_HL_CACHE_SLOTS; i++) {
+        if (cache[i]) {
+            highlight_unref(cache[i]);
+            cache[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,147 @@
+/**
+ * @file md_highlight.h
+ * @brief Syntax highlighting for fenced code blocks
+ *
+ * Each language is a table (comment markers, quotes, sorted keyword
+ * lists) driving one small lexer. Code is lexed a line at a time; what
+ * is still open at the end of a line (a block comment, a triple-quoted
+ * string) is carried in an md_hl_state_t, so streamed code can be lexed
+ * as it arrives.
+ *
+ * Whole blocks are lexed through md_highlight_block(), which keeps the
+ * result in a small process-wide cache keyed by the block's hash: the
+ * same block rendered again, or re-rendered after a resize, is not lexed
+ * again.
+ */
+
+#ifndef MD_HIGHLIGHT_H
+#define MD_HIGHLIGHT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Blocks kept by md_highlight_block() */
+#define MD_HL_CACHE_SLOTS 32
+
+typedef enum {
+    MD_HL_NONE,             /* Unknown language: not highlighted */
+    MD_HL_C,                /* C and C++ */
+    MD_HL_PYTHON,
+    MD_HL_JS,               /* JavaScript and TypeScript */
+    MD_HL_SHELL,
+    MD_HL_JSON,
+    MD_HL_DIFF
+} md_hl_lang_t;
+
+typedef enum {
+    MD_HL_PLAIN,
+    MD_HL_KEYWORD,
+    MD_HL_TYPE,
+    MD_HL_LITERAL,          /* true, NULL, None, ... */
+    MD_HL_STRING,
+    MD_HL_NUMBER,
+    MD_HL_COMMENT,
+    MD_HL_PREPROC,          /* C directives, Python decorators */
+    MD_HL_VARIABLE,         /* Shell expansions */
+    MD_HL_PROPERTY,         /* JSON keys */
+    MD_HL_ADDED,
+    MD_HL_REMOVED,
+    MD_HL_HUNK,
+    MD_HL_HEADER            /* Diff file headers */
+} md_hl_class_t;
+
+/* Lexer state carried from one line to the next */
+typedef int md_hl_state_t;
+#define MD_HL_STATE_INIT 0
+
+/** Highlighted run within a line; text between spans is plain */
+typedef struct {
+    uint32_t start;         /* Byte offset in the line */
+    uint32_t len;
+    md_hl_class_t cls;
+} md_hl_span_t;
+
+/** Growable span list */
+typedef struct {
+    md_hl_span_t* items;
+    size_t count;
+    size_t cap;
+} md_hl_spans_t;
+
+/** Cached highlighting of a whole block (see md_highlight_block) */
+typedef struct md_highlight md_highlight_t;
+
+/**
+ * Look up a language by its fence info string ("c", "py", "bash", ...)
+ * @param name Language name (need not be NUL-terminated)
+ * @param len Length of name
+ * @return Language, or MD_HL_NONE if not recognised
+ */
+md_hl_lang_t md_hl_lang_from_name(const char* name, size_t len);
+
+/**
+ * Lex one line, appending its highlighted runs to spans
+ * @param lang Language
+ * @param state State left by the previous line, updated for the next
+ *              (MD_HL_STATE_INIT for the first line)
+ * @param line Line text without its newline
+ * @param len Length of line
+ * @param spans Span list to append to (offsets are relative to line)
+ * @return 0 on success, -1 if out of memory
+ */
+int md_hl_line(md_hl_lang_t lang, md_hl_state_t* state, const char* line, size_t len,
+               md_hl_spans_t* spans);
+
+/**
+ * Free a span list's storage
+ * @param spans Span list
+ */
+void md_hl_spans_free(md_hl_spans_t* spans);
+
+/**
+ * Escape sequence a class is drawn with
+ * @param cls Class
+ * @return Escape sequence ("" for plain text)
+ */
+const char* md_hl_style(md_hl_class_t cls);
+
+/**
+ * Highlight a block, or take its highlighting from the cache
+ * Lines are split at '\n' as the renderer splits them. Release the
+ * result with md_highlight_release() once drawn.
+ * @param lang Language
+ * @param code Block text
+ * @param len Length of code
+ * @return Highlighting, or NULL if lang is MD_HL_NONE or out of memory
+ */
+const md_highlight_t* md_highlight_block(md_hl_lang_t lang, const char* code, size_t len);
+
+/**
+ * Runs of one line of a highlighted block
+ * @param hl Highlighting
+ * @param line Line index
+ * @param count Output: number of spans
+ * @return Spans, or NULL if the line has none
+ */
+const md_hl_span_t* md_highlight_line_spans(const md_highlight_t* hl, size_t line, size_t* count);
+
+/**
+ * Release highlighting returned by md_highlight_block()
+ * @param hl Highlighting (may be NULL)
+ */
+void md_highlight_release(const md_highlight_t* hl);
+
+/**
+ * Drop all cached blocks not currently in use
+ */
+void md_highlight_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MD_HIGHLIGHT_H */
@@ -1,6 +1,11 @@
 /**
  * @file md_parser.c
- * @brief Markdown parser implementation using PCRE2
+ * @brief Markdown parser implementation
+ *
+ * Block lines are classified in a single pass by a hand-written matcher
+ * (dispatch on the first non-blank byte). Building with MD_USE_PCRE2
+ * (CMake option ARC_MARKDOWN_PCRE2) classifies them with the original
+ * PCRE2 patterns instead; both report the same captures.
  */
 
 #include "md_parser.h"
@@ -8,66 +13,48 @@
 #include "arc/platform.h"
 #include "arc/log.h"
 
+#ifdef MD_USE_PCRE2
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
+#endif
 
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
 
-/* ========== Regex patterns ========== */
-static pcre2_code* re_heading = NULL;
-static pcre2_code* re_quote = NULL;
-static pcre2_code* re_bullet = NULL;
-static pcre2_code* re_ordered = NULL;
-static pcre2_code* re_hr = NULL;
-static pcre2_code* re_table_sep = NULL;
-
-static int regex_initialized = 0;
-
 /* ========== Helper macros ========== */
 #define STARTS_WITH(s, prefix) (strncmp((s), (prefix), strlen(prefix)) == 0)
 
-/* ========== Regex compilation ========== */
-
-static pcre2_code* compile_regex(const char* pattern) {
-    int errornumber;
-    PCRE2_SIZE erroroffset;
-    pcre2_code* re = pcre2_compile(
-        (PCRE2_SPTR)pattern,
-        PCRE2_ZERO_TERMINATED,
-        0,
-        &errornumber,
-        &erroroffset,
-        NULL
-    );
-    if (re == NULL) {
-        PCRE2_UCHAR buffer[256];
-        pcre2_get_error_message(errornumber, buffer, sizeof(buffer));
-        AC_LOG_ERROR( "PCRE2 compile error at offset %d: %s\n", (int)erroroffset, buffer);
-    }
-    return re;
-}
+/* ========== Allocation ========== */
 
-static void init_regex(void) {
-    if (regex_initialized) return;
+/*
+ * Tokens and their strings come from the arena when one is given, from
+ * the heap otherwise (md_free_tokens). Scratch buffers always use the heap.
+ */
 
-    re_heading = compile_regex("^(#{1,6})\\s+(.*)$");
-    re_quote = compile_regex("^\\s*>\\s?(.*)$");
-    re_bullet = compile_regex("^(\\s*)([-*+])\\s+(.*)$");
-    re_ordered = compile_regex("^(\\s*)(\\d+)\\.\\s+(.*)$");
-    re_hr = compile_regex("^\\s*([-*_])\\s*\\1\\s*\\1\\s*$");
-    re_table_sep = compile_regex("^\\|?\\s*(:?-+:?)\\s*(\\|\\s*:?-+:?\\s*)*\\|?\\s*$");
+/* Zeroed memory */
+static void* md_alloc(arena_t* arena, size_t size) {
+    if (!arena) return calloc(1, size);
+    void* p = arena_alloc(arena, size);
+    if (p) memset(p, 0, size);
+    return p;
+}
 
-    regex_initialized = 1;
+/* NUL-terminated copy of the first n bytes of str */
+static char* md_dup(arena_t* arena, const char* str, size_t n) {
+    char* copy = arena ? arena_alloc(arena, n + 1) : (char*)malloc(n + 1);
+    if (copy) {
+        memcpy(copy, str, n);
+        copy[n] = '\0';
+    }
+    return copy;
 }
 
 /* ========== Inline parser ========== */
 
-/* Parse until a delimiter is found, return content before delimiter */
-static char* parse_until(const char* text, size_t* pos, const char* delim) {
-    size_t start = *pos;
+/* Advance pos to the next delimiter (or the end of text) */
+static void parse_until(const char* text, size_t* pos, const char* delim) {
     size_t delim_len = strlen(delim);
 
     while (text[*pos] != '\0') {
@@ -76,17 +63,17 @@ static char* parse_until(const char* text, size_t* pos, const char* delim) {
         }
         (*pos)++;
     }
-
-    return md_strndup(text + start, *pos - start);
 }
 
 /* Create a new inline token */
-static md_inline_token_t* new_inline_token(md_inline_type_t type, const char* text, const char* url) {
-    md_inline_token_t* tok = (md_inline_token_t*)calloc(1, sizeof(md_inline_token_t));
+static md_inline_token_t* new_inline_token(arena_t* arena, md_inline_type_t type,
+                                           const char* text, size_t text_len,
+                                           const char* url, size_t url_len) {
+    md_inline_token_t* tok = (md_inline_token_t*)md_alloc(arena, sizeof(md_inline_token_t));
     if (!tok) return NULL;
     tok->type = type;
-    tok->text = text ? md_strdup(text) : NULL;
-    tok->url = url ? md_strdup(url) : NULL;
+    tok->text = text ? md_dup(arena, text, text_len) : NULL;
+    tok->url = url ? md_dup(arena, url, url_len) : NULL;
     tok->next = NULL;
     return tok;
 }
@@ -102,7 +89,7 @@ static void append_inline_token(md_inline_token_t** head, md_inline_token_t** ta
     }
 }
 
-md_inline_token_t* md_parse_inline(const char* text) {
+static md_inline_token_t* parse_inline(arena_t* arena, const char* text) {
     if (!text || !*text) return NULL;
 
     md_inline_token_t* head = NULL;
@@ -117,7 +104,7 @@ md_inline_token_t* md_parse_inline(const char* text) {
     /* Flush accumulated plain text */
     #define FLUSH_PLAIN() do { \
         if (plain_len > 0) { \
-            md_inline_token_t* tok = new_inline_token(MD_INLINE_PLAIN, plain_buf, NULL); \
+            md_inline_token_t* tok = new_inline_token(arena, MD_INLINE_PLAIN, plain_buf, plain_len, NULL, 0); \
             append_inline_token(&head, &tail, tok); \
             plain_len = 0; \
             if (plain_buf) plain_buf[0] = '\0'; \
@@ -129,17 +116,17 @@ md_inline_token_t* md_parse_inline(const char* text) {
         if (pos + 2 < len && text[pos] == '*' && text[pos+1] == '*' && text[pos+2] == '*') {
             FLUSH_PLAIN();
             pos += 3;
-            char* content = parse_until(text, &pos, "***");
+            size_t start = pos;
+            parse_until(text, &pos, "***");
             if (pos + 3 <= len && strncmp(text + pos, "***", 3) == 0) {
                 pos += 3;
-                md_inline_token_t* tok = new_inline_token(MD_INLINE_BOLD_ITALIC, content, NULL);
+                md_inline_token_t* tok = new_inline_token(arena, MD_INLINE_BOLD_ITALIC, text + start, pos - start - 3, NULL, 0);
                 append_inline_token(&head, &tail, tok);
             } else {
                 /* No closing, treat as plain */
                 md_buffer_append(&plain_buf, &plain_size, &plain_len, "***");
-                md_buffer_append(&plain_buf, &plain_size, &plain_len, content);
+                md_buffer_append_n(&plain_buf, &plain_size, &plain_len, text + start, pos - start);
             }
-            free(content);
             continue;
         }
 
@@ -149,16 +136,16 @@ md_inline_token_t* md_parse_inline(const char* text) {
             char delim[3] = {text[pos], text[pos+1], '\0'};
             FLUSH_PLAIN();
             pos += 2;
-            char* content = parse_until(text, &pos, delim);
+            size_t start = pos;
+            parse_until(text, &pos, delim);
             if (pos + 2 <= len && strncmp(text + pos, delim, 2) == 0) {
                 pos += 2;
-                md_inline_token_t* tok = new_inline_token(MD_INLINE_BOLD, content, NULL);
+                md_inline_token_t* tok = new_inline_token(arena, MD_INLINE_BOLD, text + start, pos - start - 2, NULL, 0);
                 append_inline_token(&head, &tail, tok);
             } else {
                 md_buffer_append(&plain_buf, &plain_size, &plain_len, delim);
-                md_buffer_append(&plain_buf, &plain_size, &plain_len, content);
+                md_buffer_append_n(&plain_buf, &plain_size, &plain_len, text + start, pos - start);
             }
-            free(content);
             continue;
         }
 
@@ -168,16 +155,16 @@ md_inline_token_t* md_parse_inline(const char* text) {
             char delim[2] = {text[pos], '\0'};
             FLUSH_PLAIN();
             pos += 1;
-            char* content = parse_until(text, &pos, delim);
+            size_t start = pos;
+            parse_until(text, &pos, delim);
             if (pos < len && text[pos] == delim[0]) {
                 pos += 1;
-                md_inline_token_t* tok = new_inline_token(MD_INLINE_ITALIC, content, NULL);
+                md_inline_token_t* tok = new_inline_token(arena, MD_INLINE_ITALIC, text + start, pos - start - 1, NULL, 0);
                 append_inline_token(&head, &tail, tok);
             } else {
                 md_buffer_append(&plain_buf, &plain_size, &plain_len, delim);
-                md_buffer_append(&plain_buf, &plain_size, &plain_len, content);
+                md_buffer_append_n(&plain_buf, &plain_size, &plain_len, text + start, pos - start);
             }
-            free(content);
             continue;
         }
 
@@ -185,16 +172,16 @@ md_inline_token_t* md_parse_inline(const char* text) {
         if (text[pos] == '`') {
             FLUSH_PLAIN();
             pos += 1;
-            char* content = parse_until(text, &pos, "`");
+            size_t start = pos;
+            parse_until(text, &pos, "`");
             if (pos < len && text[pos] == '`') {
                 pos += 1;
-                md_inline_token_t* tok = new_inline_token(MD_INLINE_CODE, content, NULL);
+                md_inline_token_t* tok = new_inline_token(arena, MD_INLINE_CODE, text + start, pos - start - 1, NULL, 0);
                 append_inline_token(&head, &tail, tok);
             } else {
                 md_buffer_append(&plain_buf, &plain_size, &plain_len, "`");
-                md_buffer_append(&plain_buf, &plain_size, &plain_len, content);
+                md_buffer_append_n(&plain_buf, &plain_size, &plain_len, text + start, pos - start);
             }
-            free(content);
             continue;
         }
 
@@ -219,12 +206,10 @@ md_inline_token_t* md_parse_inline(const char* text) {
 
                 if (paren_end < len) {
                     FLUSH_PLAIN();
-                    char* link_text = md_strndup(text + bracket_start, bracket_end - bracket_start);
-                    char* link_url = md_strndup(text + paren_start, paren_end - paren_start);
-                    md_inline_token_t* tok = new_inline_token(MD_INLINE_LINK, link_text, link_url);
+                    md_inline_token_t* tok = new_inline_token(arena, MD_INLINE_LINK,
+                                                              text + bracket_start, bracket_end - bracket_start,
+                                                              text + paren_start, paren_end - paren_start);
                     append_inline_token(&head, &tail, tok);
-                    free(link_text);
-                    free(link_url);
                     pos = paren_end + 1;
                     continue;
                 }
@@ -248,18 +233,206 @@ md_inline_token_t* md_parse_inline(const char* text) {
     return head;
 }
 
-/* ========== Block parser helpers ========== */
+md_inline_token_t* md_parse_inline(const char* text) {
+    return parse_inline(NULL, text);
+}
+
+md_inline_token_t* md_parse_inline_arena(arena_t* arena, const char* text) {
+    if (!arena) return NULL;
+    return parse_inline(arena, text);
+}
+
+/* ========== Line classifier ========== */
+
+typedef enum {
+    MD_LINE_TEXT = 0,
+    MD_LINE_HEADING,
+    MD_LINE_HR,
+    MD_LINE_QUOTE,
+    MD_LINE_BULLET,
+    MD_LINE_ORDERED
+} md_line_kind_t;
+
+/* Classified line; offsets are into the line, content runs to its end */
+typedef struct {
+    int level;              /* Heading level */
+    size_t indent;          /* List item: leading whitespace length */
+    size_t content;         /* Start of the content */
+} md_line_t;
+
+#ifndef MD_USE_PCRE2
+
+/* Same set as PCRE2's \s */
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static size_t skip_blank(const char* line, size_t i, size_t len) {
+    while (i < len && is_blank(line[i])) i++;
+    return i;
+}
+
+/* ^(#{1,6})\s+(.*)$ */
+static int match_heading(const char* line, size_t len, md_line_t* out) {
+    size_t n = 0;
+    while (n < len && line[n] == '#') n++;
+    if (n == 0 || n > 6 || n == len || !is_blank(line[n])) return 0;
+    out->level = (int)n;
+    out->content = skip_blank(line, n, len);
+    return 1;
+}
+
+/* ^\s*([-*_])\s*\1\s*\1\s*$ */
+static int match_hr(const char* line, size_t len, size_t i) {
+    char c = line[i];
+    for (int k = 0; k < 2; k++) {
+        i = skip_blank(line, i + 1, len);
+        if (i == len || line[i] != c) return 0;
+    }
+    return skip_blank(line, i + 1, len) == len;
+}
+
+/* ^\s*>\s?(.*)$ */
+static int match_quote(const char* line, size_t len, size_t i, md_line_t* out) {
+    i++;
+    if (i < len && is_blank(line[i])) i++;
+    out->content = i;
+    return 1;
+}
+
+/* ^(\s*)([-*+])\s+(.*)$ */
+static int match_bullet(const char* line, size_t len, size_t i, md_line_t* out) {
+    if (i + 1 == len || !is_blank(line[i + 1])) return 0;
+    out->indent = i;
+    out->content = skip_blank(line, i + 1, len);
+    return 1;
+}
+
+/* ^(\s*)(\d+)\.\s+(.*)$ */
+static int match_ordered(const char* line, size_t len, size_t i, md_line_t* out) {
+    size_t j = i;
+    while (j < len && line[j] >= '0' && line[j] <= '9') j++;
+    if (j == len || line[j] != '.' || j + 1 == len || !is_blank(line[j + 1])) return 0;
+    out->indent = i;
+    out->content = skip_blank(line, j + 1, len);
+    return 1;
+}
+
+static md_line_kind_t classify_line(const char* line, size_t len, md_line_t* out) {
+    memset(out, 0, sizeof(*out));
+
+    size_t i = skip_blank(line, 0, len);
+    if (i == len) return MD_LINE_TEXT;
+
+    switch (line[i]) {
+        case '#':
+            if (i == 0 && match_heading(line, len, out)) return MD_LINE_HEADING;
+            break;
+        case '-':
+        case '*':
+            if (match_hr(line, len, i)) return MD_LINE_HR;
+            if (match_bullet(line, len, i, out)) return MD_LINE_BULLET;
+            break;
+        case '_':
+            if (match_hr(line, len, i)) return MD_LINE_HR;
+            break;
+        case '+':
+            if (match_bullet(line, len, i, out)) return MD_LINE_BULLET;
+            break;
+        case '>':
+            if (match_quote(line, len, i, out)) return MD_LINE_QUOTE;
+            break;
+        default:
+            if (line[i] >= '0' && line[i] <= '9' && match_ordered(line, len, i, out)) {
+                return MD_LINE_ORDERED;
+            }
+            break;
+    }
+    return MD_LINE_TEXT;
+}
+
+/* :?-+:? at i; returns the end, or 0 if there is none */
+static size_t skip_align_cell(const char* line, size_t i, size_t len) {
+    if (i < len && line[i] == ':') i++;
+    size_t dashes = i;
+    while (i < len && line[i] == '-') i++;
+    if (i == dashes) return 0;
+    if (i < len && line[i] == ':') i++;
+    return i;
+}
+
+/* ^\|?\s*(:?-+:?)\s*(\|\s*:?-+:?\s*)*\|?\s*$ */
+static int is_table_sep(const char* line, size_t len) {
+    size_t i = 0;
+    if (i < len && line[i] == '|') i++;
+    i = skip_blank(line, i, len);
+
+    size_t end = skip_align_cell(line, i, len);
+    if (!end) return 0;
+
+    for (i = skip_blank(line, end, len); i < len; ) {
+        if (line[i] != '|') return 0;
+        i = skip_blank(line, i + 1, len);
+        if (i == len) break;
+        end = skip_align_cell(line, i, len);
+        if (!end) return 0;
+        i = skip_blank(line, end, len);
+    }
+    return 1;
+}
+
+#else /* MD_USE_PCRE2 */
+
+static pcre2_code* re_heading = NULL;
+static pcre2_code* re_quote = NULL;
+static pcre2_code* re_bullet = NULL;
+static pcre2_code* re_ordered = NULL;
+static pcre2_code* re_hr = NULL;
+static pcre2_code* re_table_sep = NULL;
+
+static int regex_initialized = 0;
+
+static pcre2_code* compile_regex(const char* pattern) {
+    int errornumber;
+    PCRE2_SIZE erroroffset;
+    pcre2_code* re = pcre2_compile(
+        (PCRE2_SPTR)pattern,
+        PCRE2_ZERO_TERMINATED,
+        0,
+        &errornumber,
+        &erroroffset,
+        NULL
+    );
+    if (re == NULL) {
+        PCRE2_UCHAR buffer[256];
+        pcre2_get_error_message(errornumber, buffer, sizeof(buffer));
+        AC_LOG_ERROR( "PCRE2 compile error at offset %d: %s\n", (int)erroroffset, buffer);
+    }
+    return re;
+}
+
+static void init_regex(void) {
+    if (regex_initialized) return;
+
+    re_heading = compile_regex("^(#{1,6})\\s+(.*)$");
+    re_quote = compile_regex("^\\s*>\\s?(.*)$");
+    re_bullet = compile_regex("^(\\s*)([-*+])\\s+(.*)$");
+    re_ordered = compile_regex("^(\\s*)(\\d+)\\.\\s+(.*)$");
+    re_hr = compile_regex("^\\s*([-*_])\\s*\\1\\s*\\1\\s*$");
+    re_table_sep = compile_regex("^\\|?\\s*(:?-+:?)\\s*(\\|\\s*:?-+:?\\s*)*\\|?\\s*$");
+
+    regex_initialized = 1;
+}
 
 /* Match regex and get captured groups */
-static int match_regex(pcre2_code* re, const char* subject,
+static int match_regex(pcre2_code* re, const char* subject, size_t len,
                        PCRE2_SIZE* ovector, int ovector_count) {
     if (!re) return 0;
 
     pcre2_match_data* match_data = pcre2_match_data_create(ovector_count, NULL);
     if (!match_data) return 0;
 
-    int rc = pcre2_match(re, (PCRE2_SPTR)subject, PCRE2_ZERO_TERMINATED,
-                         0, 0, match_data, NULL);
+    int rc = pcre2_match(re, (PCRE2_SPTR)subject, len, 0, 0, match_data, NULL);
 
     if (rc > 0) {
         PCRE2_SIZE* ov = pcre2_get_ovector_pointer(match_data);
@@ -272,15 +445,50 @@ static int match_regex(pcre2_code* re, const char* subject,
     return rc > 0 ? rc : 0;
 }
 
-/* Extract substring from match */
-static char* extract_match(const char* subject, PCRE2_SIZE start, PCRE2_SIZE end) {
-    if (start == PCRE2_UNSET || end == PCRE2_UNSET) return NULL;
-    return md_strndup(subject + start, end - start);
+static md_line_kind_t classify_line(const char* line, size_t len, md_line_t* out) {
+    PCRE2_SIZE ov[20];
+
+    memset(out, 0, sizeof(*out));
+    init_regex();
+
+    if (match_regex(re_heading, line, len, ov, 10)) {
+        out->level = (int)(ov[3] - ov[2]);
+        out->content = ov[4];
+        return MD_LINE_HEADING;
+    }
+    if (match_regex(re_hr, line, len, ov, 10)) {
+        return MD_LINE_HR;
+    }
+    if (match_regex(re_quote, line, len, ov, 10)) {
+        out->content = ov[2];
+        return MD_LINE_QUOTE;
+    }
+    if (match_regex(re_bullet, line, len, ov, 10)) {
+        out->indent = ov[3] - ov[2];
+        out->content = ov[6];
+        return MD_LINE_BULLET;
+    }
+    if (match_regex(re_ordered, line, len, ov, 10)) {
+        out->indent = ov[3] - ov[2];
+        out->content = ov[6];
+        return MD_LINE_ORDERED;
+    }
+    return MD_LINE_TEXT;
+}
+
+static int is_table_sep(const char* line, size_t len) {
+    PCRE2_SIZE ov[20];
+    init_regex();
+    return match_regex(re_table_sep, line, len, ov, 10);
 }
 
+#endif /* MD_USE_PCRE2 */
+
+/* ========== Block parser helpers ========== */
+
 /* Create a new block token */
-static md_block_token_t* new_block_token(md_block_type_t type) {
-    md_block_token_t* tok = (md_block_token_t*)calloc(1, sizeof(md_block_token_t));
+static md_block_token_t* new_block_token(arena_t* arena, md_block_type_t type) {
+    md_block_token_t* tok = (md_block_token_t*)md_alloc(arena, sizeof(md_block_token_t));
     if (tok) {
         tok->type = type;
     }
@@ -300,12 +508,15 @@ static void append_block_token(md_block_token_t** head, md_block_token_t** tail,
 
 /* ========== Table parser ========== */
 
-/* Parse table alignment from separator row */
-static md_align_t parse_align(const char* cell) {
-    const char* trimmed = md_ltrim(cell);
-    size_t len = strlen(trimmed);
+/* Parse table alignment from one separator cell */
+static md_align_t parse_align(const char* cell, size_t len) {
+    const char* trimmed = cell;
 
-    /* Trim trailing whitespace */
+    /* Trim surrounding whitespace */
+    while (len > 0 && isspace((unsigned char)*trimmed)) {
+        trimmed++;
+        len--;
+    }
     while (len > 0 && isspace((unsigned char)trimmed[len-1])) {
         len--;
     }
@@ -320,8 +531,28 @@ static md_align_t parse_align(const char* cell) {
     return MD_ALIGN_LEFT;
 }
 
-/* Split a table row into cells */
-static md_inline_token_t** split_table_row(const char* line, size_t* out_count) {
+/* Column alignments from a separator row */
+static md_align_t* parse_aligns(arena_t* arena, const char* sep_line, size_t col_count) {
+    md_align_t* aligns = (md_align_t*)md_alloc(arena, col_count * sizeof(md_align_t));
+    if (!aligns) return NULL;
+
+    const char* p = sep_line;
+    while (*p && isspace((unsigned char)*p)) p++;
+    if (*p == '|') p++;
+
+    size_t align_idx = 0;
+    while (*p && align_idx < col_count) {
+        const char* cell_start = p;
+        while (*p && *p != '|') p++;
+        aligns[align_idx++] = parse_align(cell_start, (size_t)(p - cell_start));
+        if (*p == '|') p++;
+    }
+    return aligns;
+}
+
+/* Split a table row into cells; the array has room for at least min_cells */
+static md_inline_token_t** split_table_row(arena_t* arena, const char* line, size_t min_cells,
+                                           size_t* out_count) {
     /* Skip leading | */
     const char* p = line;
     while (*p && isspace((unsigned char)*p)) p++;
@@ -335,8 +566,9 @@ static md_inline_token_t** split_table_row(const char* line, size_t* out_count)
         tmp++;
     }
     count++; /* Last cell after final content */
+    if (count < min_cells) count = min_cells;
 
-    md_inline_token_t** cells = (md_inline_token_t**)calloc(count + 1, sizeof(md_inline_token_t*));
+    md_inline_token_t** cells = (md_inline_token_t**)md_alloc(arena, (count + 1) * sizeof(md_inline_token_t*));
     if (!cells) {
         *out_count = 0;
         return NULL;
@@ -349,14 +581,15 @@ static md_inline_token_t** split_table_row(const char* line, size_t* out_count)
         while (*p && *p != '|') p++;
 
         /* Trim and parse cell */
-        char* cell = md_strndup(start, p - start);
-        if (cell) {
-            md_rtrim(cell);
-            const char* trimmed = md_ltrim(cell);
-            if (*trimmed) {
-                cells[idx] = md_parse_inline(trimmed);
+        const char* end = p;
+        while (start < end && isspace((unsigned char)*start)) start++;
+        while (end > start && isspace((unsigned char)end[-1])) end--;
+        if (end > start) {
+            char* cell = md_strndup(start, (size_t)(end - start));
+            if (cell) {
+                cells[idx] = parse_inline(arena, cell);
+                free(cell);
             }
-            free(cell);
         }
         idx++;
 
@@ -374,17 +607,37 @@ static md_inline_token_t** split_table_row(const char* line, size_t* out_count)
 
 /* ========== List parser ========== */
 
-static md_list_item_t* new_list_item(void) {
-    return (md_list_item_t*)calloc(1, sizeof(md_list_item_t));
+static md_list_item_t* new_list_item(arena_t* arena) {
+    return (md_list_item_t*)md_alloc(arena, sizeof(md_list_item_t));
+}
+
+/* Append a row to a table; arena-backed row arrays double in place of realloc */
+static int append_table_row(arena_t* arena, md_table_t* table, md_inline_token_t** row) {
+    size_t count = table->row_count;
+    md_inline_token_t*** rows = table->rows;
+
+    if (!arena) {
+        rows = (md_inline_token_t***)realloc(rows, (count + 1) * sizeof(md_inline_token_t**));
+        if (!rows) return -1;
+    } else if (count == 0 || (count >= 8 && (count & (count - 1)) == 0)) {
+        /* Capacity is 8, then the next power of two */
+        size_t cap = count ? count * 2 : 8;
+        rows = (md_inline_token_t***)arena_alloc(arena, cap * sizeof(md_inline_token_t**));
+        if (!rows) return -1;
+        if (count) memcpy(rows, table->rows, count * sizeof(md_inline_token_t**));
+    }
+
+    rows[count] = row;
+    table->rows = rows;
+    table->row_count = count + 1;
+    return 0;
 }
 
 /* ========== Main parser ========== */
 
-md_block_token_t* md_parse(const char* markdown) {
+static md_block_token_t* parse_blocks(arena_t* arena, const char* markdown) {
     if (!markdown || !*markdown) return NULL;
 
-    init_regex();
-
     md_block_token_t* head = NULL;
     md_block_token_t* tail = NULL;
 
@@ -425,8 +678,6 @@ md_block_token_t* md_parse(const char* markdown) {
             line_len--;
         }
 
-        PCRE2_SIZE ov[20];
-
         /* ---- Code block handling ---- */
         if (STARTS_WITH(line, "```")) {
             if (!in_code_block) {
@@ -434,7 +685,7 @@ md_block_token_t* md_parse(const char* markdown) {
                 in_code_block = 1;
                 in_list = 0;
                 in_table = 0;
-                code_lang = md_strdup(line + 3);
+                code_lang = md_dup(arena, line + 3, line_len - 3);
                 if (code_lang) md_rtrim(code_lang);
                 code_buf_len = 0;
                 if (!code_buffer) {
@@ -445,10 +696,10 @@ md_block_token_t* md_parse(const char* markdown) {
             } else {
                 /* End code block */
                 in_code_block = 0;
-                md_block_token_t* tok = new_block_token(MD_BLOCK_CODE);
+                md_block_token_t* tok = new_block_token(arena, MD_BLOCK_CODE);
                 if (tok) {
                     tok->data.code.lang = code_lang;
-                    tok->data.code.code = md_strdup(code_buffer ? code_buffer : "");
+                    tok->data.code.code = md_dup(arena, code_buffer ? code_buffer : "", code_buffer ? code_buf_len : 0);
                     append_block_token(&head, &tail, tok);
                 }
                 code_lang = NULL;
@@ -459,8 +710,8 @@ md_block_token_t* md_parse(const char* markdown) {
         }
 
         if (in_code_block) {
-            md_buffer_append(&code_buffer, &code_buf_size, &code_buf_len, line);
-            md_buffer_append(&code_buffer, &code_buf_size, &code_buf_len, "\n");
+            md_buffer_append_n(&code_buffer, &code_buf_size, &code_buf_len, line, line_len);
+            md_buffer_append_n(&code_buffer, &code_buf_size, &code_buf_len, "\n", 1);
             line = next_line;
             continue;
         }
@@ -473,62 +724,57 @@ md_block_token_t* md_parse(const char* markdown) {
             continue;
         }
 
+        md_line_t m;
+        md_line_kind_t kind = classify_line(line, line_len, &m);
+
         /* ---- Heading ---- */
-        if (match_regex(re_heading, line, ov, 10)) {
+        if (kind == MD_LINE_HEADING) {
             in_list = 0;
             in_table = 0;
-            char* hashes = extract_match(line, ov[2], ov[3]);
-            char* content = extract_match(line, ov[4], ov[5]);
-
-            md_block_token_t* tok = new_block_token(MD_BLOCK_HEADING);
-            if (tok && hashes && content) {
-                tok->data.heading.level = (int)strlen(hashes);
-                tok->data.heading.content = md_parse_inline(content);
+            md_block_token_t* tok = new_block_token(arena, MD_BLOCK_HEADING);
+            if (tok) {
+                tok->data.heading.level = m.level;
+                tok->data.heading.content = parse_inline(arena, line + m.content);
                 append_block_token(&head, &tail, tok);
             }
-            free(hashes);
-            free(content);
             line = next_line;
             continue;
         }
 
         /* ---- Horizontal rule ---- */
-        if (match_regex(re_hr, line, ov, 10)) {
+        if (kind == MD_LINE_HR) {
             in_list = 0;
             in_table = 0;
-            md_block_token_t* tok = new_block_token(MD_BLOCK_HR);
+            md_block_token_t* tok = new_block_token(arena, MD_BLOCK_HR);
             append_block_token(&head, &tail, tok);
             line = next_line;
             continue;
         }
 
         /* ---- Block quote ---- */
-        if (match_regex(re_quote, line, ov, 10)) {
+        if (kind == MD_LINE_QUOTE) {
             in_list = 0;
             in_table = 0;
-            char* content = extract_match(line, ov[2], ov[3]);
-            md_block_token_t* tok = new_block_token(MD_BLOCK_QUOTE);
+            md_block_token_t* tok = new_block_token(arena, MD_BLOCK_QUOTE);
             if (tok) {
-                tok->data.quote.content = md_parse_inline(content ? content : "");
+                tok->data.quote.content = parse_inline(arena, line + m.content);
                 append_block_token(&head, &tail, tok);
             }
-            free(content);
             line = next_line;
             continue;
         }
 
         /* ---- Unordered list ---- */
-        if (match_regex(re_bullet, line, ov, 10)) {
+        if (kind == MD_LINE_BULLET) {
             in_table = 0;
-            char* indent_str = extract_match(line, ov[2], ov[3]);
-            char* content = extract_match(line, ov[6], ov[7]);
-            int indent = indent_str ? md_count_indent(indent_str) : 0;
+            /* The indent ends at the marker, so counting from the line start is enough */
+            int indent = m.indent ? md_count_indent(line) : 0;
 
             if (!in_list || current_list_type != MD_LIST_UNORDERED) {
                 /* Start new list */
                 in_list = 1;
                 current_list_type = MD_LIST_UNORDERED;
-                current_list = new_block_token(MD_BLOCK_LIST);
+                current_list = new_block_token(arena, MD_BLOCK_LIST);
                 if (current_list) {
                     current_list->data.list.type = MD_LIST_UNORDERED;
                     current_list->data.list.items = NULL;
@@ -538,9 +784,9 @@ md_block_token_t* md_parse(const char* markdown) {
             }
 
             /* Add item */
-            md_list_item_t* item = new_list_item();
+            md_list_item_t* item = new_list_item(arena);
             if (item) {
-                item->content = md_parse_inline(content ? content : "");
+                item->content = parse_inline(arena, line + m.content);
                 item->indent_level = indent / 2; /* 2 spaces per level */
                 if (list_tail) {
                     list_tail->next = item;
@@ -550,23 +796,19 @@ md_block_token_t* md_parse(const char* markdown) {
                 list_tail = item;
             }
 
-            free(indent_str);
-            free(content);
             line = next_line;
             continue;
         }
 
         /* ---- Ordered list ---- */
-        if (match_regex(re_ordered, line, ov, 10)) {
+        if (kind == MD_LINE_ORDERED) {
             in_table = 0;
-            char* indent_str = extract_match(line, ov[2], ov[3]);
-            char* content = extract_match(line, ov[6], ov[7]);
-            int indent = indent_str ? md_count_indent(indent_str) : 0;
+            int indent = m.indent ? md_count_indent(line) : 0;
 
             if (!in_list || current_list_type != MD_LIST_ORDERED) {
                 in_list = 1;
                 current_list_type = MD_LIST_ORDERED;
-                current_list = new_block_token(MD_BLOCK_LIST);
+                current_list = new_block_token(arena, MD_BLOCK_LIST);
                 if (current_list) {
                     current_list->data.list.type = MD_LIST_ORDERED;
                     current_list->data.list.items = NULL;
@@ -575,9 +817,9 @@ md_block_token_t* md_parse(const char* markdown) {
                 list_tail = NULL;
             }
 
-            md_list_item_t* item = new_list_item();
+            md_list_item_t* item = new_list_item(arena);
             if (item) {
-                item->content = md_parse_inline(content ? content : "");
+                item->content = parse_inline(arena, line + m.content);
                 item->indent_level = indent / 3; /* 3 chars per level (e.g., "1. ") */
                 if (list_tail) {
                     list_tail->next = item;
@@ -587,8 +829,6 @@ md_block_token_t* md_parse(const char* markdown) {
                 list_tail = item;
             }
 
-            free(indent_str);
-            free(content);
             line = next_line;
             continue;
         }
@@ -606,40 +846,22 @@ md_block_token_t* md_parse(const char* markdown) {
                     *sep_end = '\0';
                 }
 
-                if (match_regex(re_table_sep, sep_line, ov, 10)) {
+                if (is_table_sep(sep_line, strlen(sep_line))) {
                     /* This is a table! */
                     in_table = 1;
                     in_list = 0;
 
-                    current_table = new_block_token(MD_BLOCK_TABLE);
+                    current_table = new_block_token(arena, MD_BLOCK_TABLE);
                     if (current_table) {
                         /* Parse header row */
                         size_t col_count;
-                        current_table->data.table.headers = split_table_row(line, &col_count);
+                        current_table->data.table.headers = split_table_row(arena, line, 0, &col_count);
                         current_table->data.table.col_count = col_count;
                         current_table->data.table.row_count = 0;
                         current_table->data.table.rows = NULL;
 
                         /* Parse alignments from separator */
-                        current_table->data.table.aligns = (md_align_t*)calloc(col_count, sizeof(md_align_t));
-                        if (current_table->data.table.aligns) {
-                            const char* p = sep_line;
-                            while (*p && isspace((unsigned char)*p)) p++;
-                            if (*p == '|') p++;
-
-                            size_t align_idx = 0;
-                            while (*p && align_idx < col_count) {
-                                const char* cell_start = p;
-                                while (*p && *p != '|') p++;
-                                char* cell = md_strndup(cell_start, p - cell_start);
-                                if (cell) {
-                                    current_table->data.table.aligns[align_idx] = parse_align(cell);
-                                    free(cell);
-                                }
-                                align_idx++;
-                                if (*p == '|') p++;
-                            }
-                        }
+                        current_table->data.table.aligns = parse_aligns(arena, sep_line, col_count);
 
                         append_block_token(&head, &tail, current_table);
                     }
@@ -658,22 +880,12 @@ md_block_token_t* md_parse(const char* markdown) {
         /* Continue parsing table rows */
         if (in_table && current_table && strchr(line, '|')) {
             size_t row_col_count;
-            md_inline_token_t** row = split_table_row(line, &row_col_count);
-
-            if (row) {
-                /* Resize rows array */
-                size_t new_count = current_table->data.table.row_count + 1;
-                md_inline_token_t*** new_rows = (md_inline_token_t***)realloc(
-                    current_table->data.table.rows,
-                    new_count * sizeof(md_inline_token_t**)
-                );
-                if (new_rows) {
-                    current_table->data.table.rows = new_rows;
-                    current_table->data.table.rows[current_table->data.table.row_count] = row;
-                    current_table->data.table.row_count = new_count;
-                } else {
-                    free(row);
-                }
+            /* Rows are read up to col_count cells, so keep at least that many */
+            md_inline_token_t** row = split_table_row(arena, line, current_table->data.table.col_count,
+                                                      &row_col_count);
+
+            if (row && append_table_row(arena, &current_table->data.table, row) != 0 && !arena) {
+                free(row);
             }
 
             line = next_line;
@@ -683,9 +895,9 @@ md_block_token_t* md_parse(const char* markdown) {
         /* ---- Default: Paragraph ---- */
         in_list = 0;
         in_table = 0;
-        md_block_token_t* tok = new_block_token(MD_BLOCK_PARAGRAPH);
+        md_block_token_t* tok = new_block_token(arena, MD_BLOCK_PARAGRAPH);
         if (tok) {
-            tok->data.paragraph.content = md_parse_inline(line);
+            tok->data.paragraph.content = parse_inline(arena, line);
             append_block_token(&head, &tail, tok);
         }
 
@@ -693,12 +905,41 @@ md_block_token_t* md_parse(const char* markdown) {
     }
 
     /* Cleanup */
+    if (!arena) free(code_lang);   /* Unclosed code block */
     free(input);
     free(code_buffer);
 
     return head;
 }
 
+md_block_token_t* md_parse(const char* markdown) {
+    return parse_blocks(NULL, markdown);
+}
+
+md_block_token_t* md_parse_arena(arena_t* arena, const char* markdown) {
+    if (!arena) return NULL;
+    return parse_blocks(arena, markdown);
+}
+
+/* ========== Table rows ========== */
+
+int md_is_table_separator(const char* line) {
+    if (!line) return 0;
+    return is_table_sep(line, strlen(line));
+}
+
+md_inline_token_t** md_parse_table_row(arena_t* arena, const char* line, size_t min_cells,
+                                       size_t* count) {
+    if (count) *count = 0;
+    if (!line || !count) return NULL;
+    return split_table_row(arena, line, min_cells, count);
+}
+
+md_align_t* md_parse_table_aligns(arena_t* arena, const char* separator, size_t col_count) {
+    if (!separator) return NULL;
+    return parse_aligns(arena, separator, col_count);
+}
+
 /* ========== Memory cleanup ========== */
 
 void md_free_inline_tokens(md_inline_token_t* token) {
@@ -7,6 +7,7 @@
 #define MD_PARSER_H
 
 #include "md_types.h"
+#include "arc/arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,6 +27,56 @@ md_inline_token_t* md_parse_inline(const char* text);
  */
 md_block_token_t* md_parse(const char* markdown);
 
+/**
+ * Parse inline Markdown content into an arena
+ * Tokens and strings are allocated from the arena and released with it
+ * (arena_reset, arena_rewind, arena_destroy); do not pass them to
+ * md_free_inline_tokens.
+ * @param arena Arena that owns the result
+ * @param text Input text
+ * @return Linked list of inline tokens, or NULL on empty/error
+ */
+md_inline_token_t* md_parse_inline_arena(arena_t* arena, const char* text);
+
+/**
+ * Parse full Markdown document into an arena
+ * The whole token tree lives in the arena, so a document is released in
+ * one call instead of md_free_tokens.
+ * @param arena Arena that owns the result
+ * @param markdown Input Markdown string
+ * @return Linked list of block tokens, or NULL on empty/error
+ */
+md_block_token_t* md_parse_arena(arena_t* arena, const char* markdown);
+
+/**
+ * Check whether a line is a table separator row (e.g. "|:--|--:|")
+ * @param line Input line
+ * @return 1 if it is, 0 otherwise
+ */
+int md_is_table_separator(const char* line);
+
+/**
+ * Split a table row into cells and parse each cell's inline content
+ * For renderers that receive a table row by row. With a NULL arena the
+ * cells are freed with md_free_inline_tokens and the array with free.
+ * @param arena Arena that owns the result, or NULL for the heap
+ * @param line Row line
+ * @param min_cells Minimum array size (missing cells are NULL)
+ * @param count Receives the number of cells up to the last non-empty one
+ * @return Array of cell token lists, or NULL on error
+ */
+md_inline_token_t** md_parse_table_row(arena_t* arena, const char* line, size_t min_cells,
+                                       size_t* count);
+
+/**
+ * Parse the column alignments of a table separator row
+ * @param arena Arena that owns the result, or NULL for the heap (free)
+ * @param separator Separator line
+ * @param col_count Number of columns
+ * @return Array of col_count alignments, or NULL on error
+ */
+md_align_t* md_parse_table_aligns(arena_t* arena, const char* separator, size_t col_count);
+
 /**
  * Free inline token list
  * @param token Head of inline token list
@@ -7,22 +7,100 @@
 #include "md_parser.h"
 #include "md_style.h"
 #include "md_utils.h"
+#include "arc/platform.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* ========== Output helpers ========== */
+/* Initial arena for md_render(); grows by chaining blocks */
+#define MD_RENDER_ARENA_SIZE (16 * 1024)
 
-static void output(md_renderer_t* r, const char* text) {
-    if (!text) return;
+/* Wrapped text keeps at least this many columns, however deep the indent */
+#define MD_WRAP_MIN_WIDTH 20
+
+/* Table columns are not narrowed below this to fit the terminal */
+#define MD_TABLE_MIN_FIT_WIDTH 3
+
+/* ========== Output batching ========== */
+
+static void sink_write(md_renderer_t* r, const char* text, size_t len) {
     if (r->output) {
-        r->output(text, strlen(text), r->userdata);
+        r->output(text, len, r->userdata);
     } else {
-        fputs(text, stdout);
+        fwrite(text, 1, len, stdout);
     }
 }
 
+static void batch_flush(md_renderer_t* r) {
+    if (r->batch_len > 0) {
+        sink_write(r, r->batch, r->batch_len);
+        r->batch_len = 0;
+        if (!r->output) fflush(stdout);
+    }
+    r->batch_flush_us = ac_platform_monotonic_us();
+}
+
+static int batch_due(const md_renderer_t* r) {
+    return ac_platform_monotonic_us() - r->batch_flush_us >= (uint64_t)r->batch_interval_ms * 1000;
+}
+
+void md_renderer_write(md_renderer_t* r, const char* text, size_t len) {
+    if (!r || !text || len == 0) return;
+    
+    if (r->batch_interval_ms < 0) {
+        sink_write(r, text, len);
+        return;
+    }
+    
+    if (r->batch_len + len > sizeof(r->batch)) {
+        batch_flush(r);
+        if (len > sizeof(r->batch)) {
+            sink_write(r, text, len);
+            return;
+        }
+    }
+    memcpy(r->batch + r->batch_len, text, len);
+    r->batch_len += len;
+    
+    if (text[len - 1] == '\n' && batch_due(r)) {
+        batch_flush(r);
+    }
+}
+
+void md_renderer_flush(md_renderer_t* r) {
+    if (!r) return;
+    if (r->batch_interval_ms >= 0) {
+        batch_flush(r);
+    } else if (!r->output) {
+        fflush(stdout);
+    }
+}
+
+void md_renderer_flush_due(md_renderer_t* r) {
+    if (!r) return;
+    if (r->batch_interval_ms < 0 || (r->batch_len > 0 && batch_due(r))) {
+        md_renderer_flush(r);
+    }
+}
+
+void md_renderer_set_batching(md_renderer_t* r, int interval_ms) {
+    if (!r) return;
+    batch_flush(r);
+    r->batch_interval_ms = interval_ms < 0 ? -1 : interval_ms;
+}
+
+/* ========== Output helpers ========== */
+
+static void output(md_renderer_t* r, const char* text) {
+    if (!text) return;
+    md_renderer_write(r, text, strlen(text));
+}
+
+static void output_len(md_renderer_t* r, const char* text, size_t len) {
+    md_renderer_write(r, text, len);
+}
+
 static void output_n(md_renderer_t* r, const char* text, int n) {
     for (int i = 0; i < n; i++) {
         output(r, text);
@@ -48,6 +126,9 @@ void md_renderer_init(md_renderer_t* renderer) {
     renderer->userdata = NULL;
     renderer->term_width = md_get_terminal_width();
     renderer->supports_hyperlink = md_supports_hyperlink();
+    renderer->batch_interval_ms = -1;
+    renderer->batch_flush_us = 0;
+    renderer->batch_len = 0;
 }
 
 void md_renderer_set_output(md_renderer_t* renderer, md_output_fn output_fn, void* userdata) {
@@ -58,76 +139,177 @@ void md_renderer_set_output(md_renderer_t* renderer, md_output_fn output_fn, voi
 
 /* ========== Inline rendering ========== */
 
+/* Style that opens a token; md_render_inline resets after each one */
+static void inline_style(md_renderer_t* r, md_inline_type_t type) {
+    switch (type) {
+        case MD_INLINE_BOLD:
+            output(r, MD_STYLE_BOLD);
+            break;
+        case MD_INLINE_ITALIC:
+            output(r, MD_STYLE_ITALIC);
+            break;
+        case MD_INLINE_BOLD_ITALIC:
+            output(r, MD_STYLE_BOLD);
+            output(r, MD_STYLE_ITALIC);
+            break;
+        case MD_INLINE_CODE:
+            output(r, MD_BG_DARK_GRAY);
+            output(r, MD_COLOR_LIGHT_GRAY);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Part of a token's text, in the token's style */
+static void render_span(md_renderer_t* r, const md_inline_token_t* tok,
+                        const char* text, size_t len) {
+    if (tok->type == MD_INLINE_PLAIN) {
+        output_len(r, text, len);
+        return;
+    }
+    inline_style(r, tok->type);
+    output_len(r, text, len);
+    output(r, MD_STYLE_RESET);
+}
+
+static void render_link(md_renderer_t* r, const md_inline_token_t* tok) {
+    if (r->supports_hyperlink) {
+        output(r, MD_COLOR_BRIGHT_BLUE);
+        output(r, MD_HYPERLINK_START);
+        output(r, tok->url);
+        output(r, MD_HYPERLINK_SEP);
+        output(r, MD_STYLE_UNDERLINE);
+        output(r, tok->text);
+        output(r, MD_STYLE_RESET);
+        output(r, MD_HYPERLINK_END);
+    } else {
+        output(r, tok->text);
+        output(r, " (");
+        output(r, MD_STYLE_UNDERLINE);
+        output(r, tok->url);
+        output(r, MD_STYLE_RESET);
+        output(r, ")");
+    }
+}
+
 void md_render_inline(md_renderer_t* r, const md_inline_token_t* tokens) {
     for (const md_inline_token_t* tok = tokens; tok; tok = tok->next) {
-        switch (tok->type) {
-            case MD_INLINE_PLAIN:
-                output(r, tok->text);
-                break;
-                
-            case MD_INLINE_BOLD:
-                output(r, MD_STYLE_BOLD);
-                output(r, tok->text);
-                output(r, MD_STYLE_RESET);
-                break;
-                
-            case MD_INLINE_ITALIC:
-                output(r, MD_STYLE_ITALIC);
-                output(r, tok->text);
-                output(r, MD_STYLE_RESET);
-                break;
-                
-            case MD_INLINE_BOLD_ITALIC:
-                output(r, MD_STYLE_BOLD);
-                output(r, MD_STYLE_ITALIC);
-                output(r, tok->text);
-                output(r, MD_STYLE_RESET);
-                break;
-                
-            case MD_INLINE_CODE:
-                output(r, MD_BG_DARK_GRAY);
-                output(r, MD_COLOR_LIGHT_GRAY);
-                output(r, tok->text);
-                output(r, MD_STYLE_RESET);
-                break;
-                
-            case MD_INLINE_LINK:
-                if (r->supports_hyperlink) {
-                    output(r, MD_COLOR_BRIGHT_BLUE);
-                    output(r, MD_HYPERLINK_START);
-                    output(r, tok->url);
-                    output(r, MD_HYPERLINK_SEP);
-                    output(r, MD_STYLE_UNDERLINE);
-                    output(r, tok->text);
-                    output(r, MD_STYLE_RESET);
-                    output(r, MD_HYPERLINK_END);
-                } else {
-                    output(r, tok->text);
-                    output(r, " (");
-                    output(r, MD_STYLE_UNDERLINE);
-                    output(r, tok->url);
-                    output(r, MD_STYLE_RESET);
-                    output(r, ")");
-                }
-                break;
+        if (tok->type == MD_INLINE_LINK) {
+            render_link(r, tok);
+        } else if (tok->text) {
+            render_span(r, tok, tok->text, strlen(tok->text));
         }
     }
 }
 
 /* ========== Get inline text for width calculation ========== */
 
-static int get_inline_width(const md_inline_token_t* tokens) {
+static int token_width(const md_inline_token_t* tok) {
+    int width = tok->text ? md_utf8_display_width(tok->text) : 0;
+    if (tok->type == MD_INLINE_LINK && tok->url) {
+        /* For non-hyperlink terminals, we show " (url)" */
+        width += 3 + md_utf8_display_width(tok->url);
+    }
+    return width;
+}
+
+int md_inline_width(const md_inline_token_t* tokens) {
     int width = 0;
     for (const md_inline_token_t* tok = tokens; tok; tok = tok->next) {
-        if (tok->text) {
-            width += md_utf8_display_width(tok->text);
+        width += token_width(tok);
+    }
+    return width;
+}
+
+/* ========== Wrapped inline rendering ========== */
+
+/* Where the next line of a run of inline tokens starts */
+typedef struct {
+    const md_inline_token_t* tok;
+    size_t offset;          /* Into tok->text */
+} inline_cursor_t;
+
+/*
+ * Render one line of at most max_width columns from the cursor, or only
+ * measure it when !draw, and move the cursor to the next line. Text wraps
+ * at spaces (md_wrap_line); a word that does not fit moves to the next
+ * line unless the line is empty, and links are never split.
+ * Returns the columns used.
+ */
+static int inline_line(md_renderer_t* r, inline_cursor_t* c, int max_width, int draw) {
+    int col = 0;
+    
+    while (c->tok) {
+        const md_inline_token_t* tok = c->tok;
+        
+        if (tok->type == MD_INLINE_LINK) {
+            int w = token_width(tok);
+            if (col > 0 && col + w > max_width) break;
+            if (draw) render_link(r, tok);
+            col += w;
+            c->tok = tok->next;
+            c->offset = 0;
+            continue;
+        }
+        
+        const char* text = tok->text ? tok->text + c->offset : "";
+        size_t len = strlen(text);
+        md_wrap_line_t line;
+        md_wrap_line(text, len, max_width - col, &line);
+        
+        if (line.brk == MD_WRAP_END) {
+            if (draw && len > 0) render_span(r, tok, text, len);
+            col += line.width;
+            c->tok = tok->next;
+            c->offset = 0;
+            continue;
+        }
+        if (line.brk == MD_WRAP_FORCED && col > 0) break;
+        
+        if (draw && line.len > 0) render_span(r, tok, text, line.len);
+        col += line.width;
+        if (line.next >= len) {
+            c->tok = tok->next;
+            c->offset = 0;
+        } else {
+            c->offset += line.next;
         }
-        if (tok->type == MD_INLINE_LINK && tok->url) {
-            /* For non-hyperlink terminals, we show " (url)" */
-            width += 3 + md_utf8_display_width(tok->url);
+        break;
+    }
+    
+    /* The next line starts at a word, even if it is in the next token */
+    while (c->tok && c->tok->type != MD_INLINE_LINK && c->tok->text) {
+        const char* text = c->tok->text + c->offset;
+        while (*text == ' ') text++;
+        if (*text) {
+            c->offset = (size_t)(text - c->tok->text);
+            break;
         }
+        c->tok = c->tok->next;
+        c->offset = 0;
+    }
+    return col;
+}
+
+void md_render_inline_wrapped(md_renderer_t* r, const md_inline_token_t* tokens,
+                              int indent, const char* lead, const char* style) {
+    if (!r) return;
+    
+    int width = r->term_width - indent;
+    if (width < MD_WRAP_MIN_WIDTH) width = MD_WRAP_MIN_WIDTH;
+    int lead_width = lead ? md_utf8_display_width(lead) : 0;
+    
+    inline_cursor_t c = { tokens, 0 };
+    inline_line(r, &c, width, 1);
+    while (c.tok) {
+        output(r, MD_STYLE_RESET);
+        output(r, "\n");
+        if (style) output(r, style);
+        if (lead) output(r, lead);
+        output_n(r, " ", indent - lead_width);
+        inline_line(r, &c, width, 1);
     }
-    return width;
 }
 
 /* ========== Block rendering ========== */
@@ -161,7 +343,7 @@ static void render_quote(md_renderer_t* r, const md_block_token_t* tok) {
     output(r, MD_COLOR_LIGHT_GRAY);
     output(r, "> ");
     output(r, MD_STYLE_ITALIC);
-    md_render_inline(r, tok->data.quote.content);
+    md_render_inline_wrapped(r, tok->data.quote.content, 2, "> ", MD_QUOTE_STYLE);
     output(r, MD_STYLE_RESET);
     output(r, "\n\n");
 }
@@ -177,11 +359,13 @@ static void render_list_item(md_renderer_t* r, const md_list_item_t* item,
                              md_list_type_t type, int number, int indent) {
     /* Indentation */
     output_n(r, "  ", indent);
+    int lead = indent * 2;
     
     /* Bullet or number */
     if (type == MD_LIST_ORDERED) {
         output_int(r, number);
         output(r, ". ");
+        lead += snprintf(NULL, 0, "%d. ", number);
     } else {
         /* Different bullets for different indent levels */
         const char* bullet;
@@ -192,9 +376,11 @@ static void render_list_item(md_renderer_t* r, const md_list_item_t* item,
         }
         output(r, bullet);
         output(r, " ");
+        lead += md_utf8_display_width(bullet) + 1;
     }
     
-    md_render_inline(r, item->content);
+    /* Continuation lines hang under the text */
+    md_render_inline_wrapped(r, item->content, lead, NULL, NULL);
     output(r, "\n");
 }
 
@@ -207,29 +393,43 @@ static void render_list(md_renderer_t* r, const md_block_token_t* tok) {
     output(r, "\n");
 }
 
+void md_render_code_line(md_renderer_t* r, const char* line, size_t len,
+                         const md_hl_span_t* spans, size_t count) {
+    if (!r || !line) return;
+    
+    size_t pos = 0;
+    for (size_t i = 0; i < count; i++) {
+        const md_hl_span_t* span = &spans[i];
+        if (span->start < pos || span->start + span->len > len) break;
+        output_len(r, line + pos, span->start - pos);
+        output(r, md_hl_style(span->cls));
+        output_len(r, line + span->start, span->len);
+        output(r, MD_STYLE_RESET);
+        pos = span->start + span->len;
+    }
+    output_len(r, line + pos, len - pos);
+}
+
 static void render_code_block(md_renderer_t* r, const md_block_token_t* tok) {
     const char* lang = tok->data.code.lang;
     const char* code = tok->data.code.code;
     
+    /* Cached per block, so a re-render after a resize does not lex again */
+    md_hl_lang_t hl_lang = lang ? md_hl_lang_from_name(lang, strlen(lang)) : MD_HL_NONE;
+    const md_highlight_t* hl = md_highlight_block(hl_lang, code, strlen(code));
+    
     if (!lang || !*lang) lang = "code";
     
     /* Calculate max line width */
     int max_width = 0;
     const char* p = code;
-    int current_width = 0;
     while (*p) {
-        if (*p == '\n') {
-            if (current_width > max_width) max_width = current_width;
-            current_width = 0;
-        } else {
-            int bytes;
-            uint32_t cp = md_utf8_decode(p, &bytes);
-            current_width += md_char_width(cp);
-            p += bytes - 1;
-        }
-        p++;
+        size_t len = strcspn(p, "\n");
+        int w = md_utf8_display_width_n(p, len);
+        if (w > max_width) max_width = w;
+        p += len;
+        if (*p) p++;
     }
-    if (current_width > max_width) max_width = current_width;
     
     /* Draw top border */
     int lang_len = md_utf8_display_width(lang);
@@ -255,7 +455,7 @@ static void render_code_block(md_renderer_t* r, const md_block_token_t* tok) {
     
     /* Draw code lines */
     p = code;
-    while (*p) {
+    for (size_t line = 0; *p; line++) {
         output(r, MD_COLOR_BRIGHT_YELLOW);
         output(r, MD_BOX_VERTICAL);
         output(r, " ");
@@ -265,15 +465,11 @@ static void render_code_block(md_renderer_t* r, const md_block_token_t* tok) {
         const char* line_start = p;
         while (*p && *p != '\n') p++;
         
-        int line_width = 0;
-        if (p > line_start) {
-            char* line = md_strndup(line_start, p - line_start);
-            if (line) {
-                output(r, line);
-                line_width = md_utf8_display_width(line);
-                free(line);
-            }
-        }
+        size_t line_len = (size_t)(p - line_start);
+        size_t span_count;
+        const md_hl_span_t* spans = md_highlight_line_spans(hl, line, &span_count);
+        md_render_code_line(r, line_start, line_len, spans, span_count);
+        int line_width = md_utf8_display_width_n(line_start, line_len);
         
         /* Pad to content_width and add right border */
         int padding = content_width - line_width;
@@ -295,6 +491,125 @@ static void render_code_block(md_renderer_t* r, const md_block_token_t* tok) {
     output(r, MD_BOX_BOTTOM_RIGHT);
     output(r, MD_STYLE_RESET);
     output(r, "\n\n");
+    
+    md_highlight_release(hl);
+}
+
+/* ========== Table rendering ========== */
+
+void md_render_table_divider(md_renderer_t* r, const int* col_widths, size_t col_count,
+                             const char* left, const char* mid, const char* right) {
+    output(r, MD_COLOR_BRIGHT_BLACK);
+    output(r, left);
+    for (size_t i = 0; i < col_count; i++) {
+        output_n(r, MD_BOX_HORIZONTAL, col_widths[i] + 2);
+        output(r, i == col_count - 1 ? right : mid);
+    }
+    output(r, MD_STYLE_RESET);
+    output(r, "\n");
+}
+
+void md_fit_table_widths(const md_renderer_t* r, int* col_widths, size_t col_count) {
+    if (!r || !col_widths || col_count == 0) return;
+    
+    /* Borders and padding: "│ " before each cell, " │" after the last */
+    int budget = r->term_width - (int)(3 * col_count + 1);
+    int total = 0, widest = 0;
+    for (size_t i = 0; i < col_count; i++) {
+        total += col_widths[i];
+        if (col_widths[i] > widest) widest = col_widths[i];
+    }
+    if (total <= budget) return;
+    
+    /* Largest cap on every column that fits, found by bisection */
+    int lo = MD_TABLE_MIN_FIT_WIDTH, hi = widest;
+    while (lo < hi) {
+        int cap = lo + (hi - lo + 1) / 2;
+        int sum = 0;
+        for (size_t i = 0; i < col_count; i++) {
+            sum += col_widths[i] < cap ? col_widths[i] : cap;
+        }
+        if (sum <= budget) {
+            lo = cap;
+        } else {
+            hi = cap - 1;
+        }
+    }
+    for (size_t i = 0; i < col_count; i++) {
+        if (col_widths[i] > lo) col_widths[i] = lo;
+    }
+}
+
+/* One line of a cell, aligned in its column; the cursor moves to the next line */
+static void render_table_cell(md_renderer_t* r, inline_cursor_t* c, md_align_t align, int width) {
+    inline_cursor_t measure = *c;
+    int padding = width - inline_line(r, &measure, width, 0);
+    int left_pad = 0, right_pad = 0;
+    if (align == MD_ALIGN_CENTER) {
+        left_pad = padding / 2;
+        right_pad = padding - left_pad;
+    } else if (align == MD_ALIGN_RIGHT) {
+        left_pad = padding;
+    } else {
+        right_pad = padding;
+    }
+    output_n(r, " ", left_pad);
+    inline_line(r, c, width, 1);
+    output_n(r, " ", right_pad);
+}
+
+void md_render_table_row(md_renderer_t* r, md_inline_token_t* const* cells,
+                         const md_align_t* aligns, const int* col_widths,
+                         size_t col_count, int is_header) {
+    if (!r || col_count == 0) return;
+    
+    /* A cursor per cell, only allocated for cells that wrap */
+    inline_cursor_t* cursors = NULL;
+    for (size_t i = 0; cells && i < col_count; i++) {
+        if (cells[i] && md_inline_width(cells[i]) > col_widths[i]) {
+            cursors = (inline_cursor_t*)calloc(col_count, sizeof(inline_cursor_t));
+            break;
+        }
+    }
+    if (cursors) {
+        for (size_t i = 0; i < col_count; i++) {
+            cursors[i].tok = cells[i];
+        }
+    }
+    
+    int more;
+    do {
+        more = 0;
+        output(r, MD_COLOR_BRIGHT_BLACK);
+        output(r, MD_BOX_VERTICAL);
+        output(r, MD_STYLE_RESET);
+        for (size_t i = 0; i < col_count; i++) {
+            output(r, " ");
+            if (is_header) output(r, MD_COLOR_BRIGHT_BLUE);
+            md_align_t align = aligns ? aligns[i] : MD_ALIGN_LEFT;
+            if (cursors) {
+                if (cursors[i].tok) {
+                    render_table_cell(r, &cursors[i], align, col_widths[i]);
+                    if (cursors[i].tok) more = 1;
+                } else {
+                    output_n(r, " ", col_widths[i]);
+                }
+            } else if (cells && cells[i]) {
+                inline_cursor_t c = { cells[i], 0 };
+                render_table_cell(r, &c, align, col_widths[i]);
+            } else {
+                output_n(r, " ", col_widths[i]);
+            }
+            output(r, MD_STYLE_RESET);
+            output(r, " ");
+            output(r, MD_COLOR_BRIGHT_BLACK);
+            output(r, MD_BOX_VERTICAL);
+            output(r, MD_STYLE_RESET);
+        }
+        output(r, "\n");
+    } while (more);
+    
+    free(cursors);
 }
 
 static void render_table(md_renderer_t* r, const md_block_token_t* tok) {
@@ -310,7 +625,7 @@ static void render_table(md_renderer_t* r, const md_block_token_t* tok) {
     /* Headers */
     for (size_t i = 0; i < col_count; i++) {
         if (table->headers && table->headers[i]) {
-            int w = get_inline_width(table->headers[i]);
+            int w = md_inline_width(table->headers[i]);
             if (w > col_widths[i]) col_widths[i] = w;
         }
     }
@@ -320,91 +635,39 @@ static void render_table(md_renderer_t* r, const md_block_token_t* tok) {
         if (table->rows && table->rows[row]) {
             for (size_t col = 0; col < col_count; col++) {
                 if (table->rows[row][col]) {
-                    int w = get_inline_width(table->rows[row][col]);
+                    int w = md_inline_width(table->rows[row][col]);
                     if (w > col_widths[col]) col_widths[col] = w;
                 }
             }
         }
     }
     
-    /* Helper: print horizontal divider */
-    #define PRINT_DIVIDER(left, mid, right) do { \
-        output(r, MD_COLOR_BRIGHT_BLACK); \
-        output(r, left); \
-        for (size_t i = 0; i < col_count; i++) { \
-            output_n(r, MD_BOX_HORIZONTAL, col_widths[i] + 2); \
-            output(r, i == col_count - 1 ? right : mid); \
-        } \
-        output(r, MD_STYLE_RESET); \
-        output(r, "\n"); \
-    } while(0)
-    
-    /* Helper: print row */
-    #define PRINT_ROW(cells, is_header) do { \
-        output(r, MD_COLOR_BRIGHT_BLACK); \
-        output(r, MD_BOX_VERTICAL); \
-        output(r, MD_STYLE_RESET); \
-        for (size_t i = 0; i < col_count; i++) { \
-            output(r, " "); \
-            if (is_header) output(r, MD_COLOR_BRIGHT_BLUE); \
-            int content_width = 0; \
-            if (cells && cells[i]) { \
-                content_width = get_inline_width(cells[i]); \
-                /* Apply alignment */ \
-                md_align_t align = table->aligns ? table->aligns[i] : MD_ALIGN_LEFT; \
-                int padding = col_widths[i] - content_width; \
-                int left_pad = 0, right_pad = 0; \
-                if (align == MD_ALIGN_CENTER) { \
-                    left_pad = padding / 2; \
-                    right_pad = padding - left_pad; \
-                } else if (align == MD_ALIGN_RIGHT) { \
-                    left_pad = padding; \
-                } else { \
-                    right_pad = padding; \
-                } \
-                output_n(r, " ", left_pad); \
-                md_render_inline(r, cells[i]); \
-                output_n(r, " ", right_pad); \
-            } else { \
-                output_n(r, " ", col_widths[i]); \
-            } \
-            output(r, MD_STYLE_RESET); \
-            output(r, " "); \
-            output(r, MD_COLOR_BRIGHT_BLACK); \
-            output(r, MD_BOX_VERTICAL); \
-            output(r, MD_STYLE_RESET); \
-        } \
-        output(r, "\n"); \
-    } while(0)
+    md_fit_table_widths(r, col_widths, col_count);
     
     /* Top border */
-    PRINT_DIVIDER(MD_BOX_TOP_LEFT, MD_BOX_T_DOWN, MD_BOX_TOP_RIGHT);
+    md_render_table_divider(r, col_widths, col_count, MD_BOX_TOP_LEFT, MD_BOX_T_DOWN, MD_BOX_TOP_RIGHT);
     
     /* Header row */
-    PRINT_ROW(table->headers, 1);
+    md_render_table_row(r, table->headers, table->aligns, col_widths, col_count, 1);
     
     /* Separator */
-    PRINT_DIVIDER(MD_BOX_T_RIGHT, MD_BOX_CROSS, MD_BOX_T_LEFT);
+    md_render_table_divider(r, col_widths, col_count, MD_BOX_T_RIGHT, MD_BOX_CROSS, MD_BOX_T_LEFT);
     
     /* Data rows */
     for (size_t row = 0; row < table->row_count; row++) {
         md_inline_token_t** row_cells = (table->rows && table->rows[row]) ? table->rows[row] : NULL;
-        PRINT_ROW(row_cells, 0);
+        md_render_table_row(r, row_cells, table->aligns, col_widths, col_count, 0);
     }
     
     /* Bottom border */
-    PRINT_DIVIDER(MD_BOX_BOTTOM_LEFT, MD_BOX_T_UP, MD_BOX_BOTTOM_RIGHT);
+    md_render_table_divider(r, col_widths, col_count, MD_BOX_BOTTOM_LEFT, MD_BOX_T_UP, MD_BOX_BOTTOM_RIGHT);
     
     output(r, "\n");
     
-    #undef PRINT_DIVIDER
-    #undef PRINT_ROW
-    
     free(col_widths);
 }
 
-void md_render_block(md_renderer_t* r, const md_block_token_t* tok) {
-    if (!r || !tok) return;
+static void render_block(md_renderer_t* r, const md_block_token_t* tok) {
     
     switch (tok->type) {
         case MD_BLOCK_HEADING:
@@ -431,10 +694,18 @@ void md_render_block(md_renderer_t* r, const md_block_token_t* tok) {
     }
 }
 
+void md_render_block(md_renderer_t* r, const md_block_token_t* tok) {
+    if (!r || !tok) return;
+    render_block(r, tok);
+    if (r->batch_interval_ms >= 0) batch_flush(r);
+}
+
 void md_render_blocks(md_renderer_t* r, const md_block_token_t* tokens) {
+    if (!r) return;
     for (const md_block_token_t* tok = tokens; tok; tok = tok->next) {
-        md_render_block(r, tok);
+        render_block(r, tok);
     }
+    if (r->batch_interval_ms >= 0) batch_flush(r);
 }
 
 /* ========== Simple API ========== */
@@ -442,15 +713,20 @@ void md_render_blocks(md_renderer_t* r, const md_block_token_t* tokens) {
 void md_render(const char* markdown) {
     if (!markdown) return;
     
-    md_block_token_t* tokens = md_parse(markdown);
+    /* One arena for the whole token tree; its blocks come from the arena cache */
+    arena_t* arena = arena_create(MD_RENDER_ARENA_SIZE);
+    if (!arena) return;
+
+    md_block_token_t* tokens = md_parse_arena(arena, markdown);
     if (tokens) {
         md_render_tokens(tokens);
-        md_free_tokens(tokens);
     }
+    arena_destroy(arena);
 }
 
 void md_render_tokens(const md_block_token_t* tokens) {
     md_renderer_t renderer;
     md_renderer_init(&renderer);
+    md_renderer_set_batching(&renderer, 0);
     md_render_blocks(&renderer, tokens);
 }
@@ -7,12 +7,17 @@
 #define MD_RENDERER_H
 
 #include "md_types.h"
+#include "md_highlight.h"
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Size of the renderer's output batch */
+#define MD_RENDER_BATCH_SIZE 4096
+
 /**
  * Output callback function type
  * @param text Text to output
@@ -29,6 +34,12 @@ typedef struct md_renderer {
     void* userdata;         /* User data for callback */
     int term_width;         /* Terminal width */
     int supports_hyperlink; /* OSC 8 hyperlink support */
+    
+    /* Output batching (see md_renderer_set_batching) */
+    int batch_interval_ms;  /* Line-end flush interval, -1 when off */
+    uint64_t batch_flush_us;/* Time of the last flush */
+    size_t batch_len;
+    char batch[MD_RENDER_BATCH_SIZE];
 } md_renderer_t;
 
 /**
@@ -45,6 +56,41 @@ void md_renderer_init(md_renderer_t* renderer);
  */
 void md_renderer_set_output(md_renderer_t* renderer, md_output_fn output, void* userdata);
 
+/**
+ * Coalesce output into fewer, larger writes
+ * Fragments (escape sequences, words, padding) collect in a buffer that
+ * is written when it fills, at a line end once interval_ms has passed
+ * since the last write (0: every line end), and on md_renderer_flush.
+ * md_render_block(s) and md_render_tokens flush before returning.
+ * @param renderer Renderer context
+ * @param interval_ms Latency bound for complete lines, or -1 to write
+ *                    every fragment directly (the default)
+ */
+void md_renderer_set_batching(md_renderer_t* renderer, int interval_ms);
+
+/**
+ * Write pending batched output to the sink
+ * Also flushes stdout when there is no output callback.
+ * @param renderer Renderer context
+ */
+void md_renderer_flush(md_renderer_t* renderer);
+
+/**
+ * Flush if the batching interval has passed since the last write
+ * For callers that render at their own pace (end of a stream chunk, a
+ * UI tick); with batching off it only flushes stdout.
+ * @param renderer Renderer context
+ */
+void md_renderer_flush_due(md_renderer_t* renderer);
+
+/**
+ * Write text through the renderer (batched when enabled)
+ * @param renderer Renderer context
+ * @param text Text to write
+ * @param len Length of text
+ */
+void md_renderer_write(md_renderer_t* renderer, const char* text, size_t len);
+
 /**
  * Render inline tokens
  * @param renderer Renderer context
@@ -66,6 +112,75 @@ void md_render_blocks(md_renderer_t* renderer, const md_block_token_t* tokens);
  */
 void md_render_block(md_renderer_t* renderer, const md_block_token_t* token);
 
+/**
+ * Display width of inline tokens as md_render_inline prints them
+ * @param tokens Inline token list
+ * @return Width in terminal columns
+ */
+int md_inline_width(const md_inline_token_t* tokens);
+
+/**
+ * Render inline tokens wrapped to the terminal width
+ * The caller has written the first line's lead-in, indent columns wide.
+ * Each further line starts with style, then lead, then spaces up to
+ * indent, so list items hang under their text and quotes keep their bar.
+ * Text breaks at spaces; links are not split.
+ * @param renderer Renderer context
+ * @param tokens Inline token list
+ * @param indent Columns before the text on every line
+ * @param lead Start of each continuation line (NULL: spaces only)
+ * @param style Escape sequence restored on each continuation line (optional)
+ */
+void md_render_inline_wrapped(md_renderer_t* renderer, const md_inline_token_t* tokens,
+                              int indent, const char* lead, const char* style);
+
+/**
+ * Render one line of code with its highlighted runs
+ * @param renderer Renderer context
+ * @param line Line text without its newline
+ * @param len Length of line
+ * @param spans Highlighted runs, in order (see md_hl_line)
+ * @param count Number of spans
+ */
+void md_render_code_line(md_renderer_t* renderer, const char* line, size_t len,
+                         const md_hl_span_t* spans, size_t count);
+
+/**
+ * Render a horizontal table border or divider
+ * @param renderer Renderer context
+ * @param col_widths Content width of each column
+ * @param col_count Number of columns
+ * @param left Left corner or junction
+ * @param mid Junction between columns
+ * @param right Right corner or junction
+ */
+void md_render_table_divider(md_renderer_t* renderer, const int* col_widths, size_t col_count,
+                             const char* left, const char* mid, const char* right);
+
+/**
+ * Narrow the widest columns until the table fits the terminal
+ * Cells wider than their column then wrap onto more lines.
+ * @param renderer Renderer context
+ * @param col_widths Content width of each column, narrowed in place
+ * @param col_count Number of columns
+ */
+void md_fit_table_widths(const md_renderer_t* renderer, int* col_widths, size_t col_count);
+
+/**
+ * Render one table row, padding each cell to its column width
+ * A cell wider than its column wraps, and the row takes as many lines as
+ * its tallest cell.
+ * @param renderer Renderer context
+ * @param cells Cell token lists, col_count entries (NULL entries are empty)
+ * @param aligns Column alignments (NULL: left)
+ * @param col_widths Content width of each column
+ * @param col_count Number of columns
+ * @param is_header Nonzero to style the cells as a header
+ */
+void md_render_table_row(md_renderer_t* renderer, md_inline_token_t* const* cells,
+                         const md_align_t* aligns, const int* col_widths,
+                         size_t col_count, int is_header);
+
 /**
  * Simple render function - render Markdown to stdout
  * @param markdown Markdown string
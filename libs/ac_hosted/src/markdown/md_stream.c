@@ -12,6 +12,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
+
+/* Initial arena for the open table's header, alignments and current row */
+#define MD_TABLE_ARENA_SIZE (4 * 1024)
+
+/* Default batching interval: write at every line end */
+#define MD_STREAM_BATCH_MS 0
+
+/* Columns start at least this wide, so short headers do not widen on every row */
+#define MD_TABLE_MIN_WIDTH 3
 
 /* ========== Stream state ========== */
 
@@ -28,14 +38,19 @@ struct md_stream {
     md_stream_state_t state;
     
     /* Code block state */
-    char* code_lang;
-    char* code_buffer;
-    size_t code_buf_size;
-    size_t code_buf_len;
+    int code_width;                 /* Rule width of the open code frame */
+    md_hl_lang_t code_lang;
+    md_hl_state_t code_state;       /* Carried from line to line */
+    md_hl_spans_t code_spans;       /* Runs of the current line */
     
     /* Table state */
-    md_block_token_t* pending_table;
-    int table_header_seen;
+    char* table_header;             /* Line that may be a table header, held for one line */
+    arena_t* table_arena;           /* Alignments and widths of the open table */
+    arena_mark_t table_mark;        /* Each row is rewound to here once rendered */
+    md_align_t* table_aligns;
+    int* col_widths;                /* Widest cell so far; only grow, see table_row() */
+    int* fit_widths;                /* col_widths narrowed to the terminal, as drawn */
+    size_t col_count;
     
     /* List state */
     int in_list;
@@ -50,6 +65,7 @@ md_stream_t* md_stream_new(void) {
     if (!stream) return NULL;
     
     md_renderer_init(&stream->renderer);
+    md_renderer_set_batching(&stream->renderer, MD_STREAM_BATCH_MS);
     stream->state = MD_STATE_NORMAL;
     
     return stream;
@@ -57,12 +73,36 @@ md_stream_t* md_stream_new(void) {
 
 void md_stream_set_output(md_stream_t* stream, md_output_fn output, void* userdata) {
     if (!stream) return;
+    md_renderer_flush(&stream->renderer);
     md_renderer_set_output(&stream->renderer, output, userdata);
 }
 
+void md_stream_set_batching(md_stream_t* stream, int interval_ms) {
+    if (!stream) return;
+    md_renderer_set_batching(&stream->renderer, interval_ms);
+}
+
+void md_stream_set_width(md_stream_t* stream, int columns) {
+    if (!stream || columns <= 0) return;
+    stream->renderer.term_width = columns;
+}
+
+void md_stream_flush(md_stream_t* stream) {
+    if (!stream) return;
+    md_renderer_flush(&stream->renderer);
+}
+
+void md_stream_write(md_stream_t* stream, const char* text, size_t len) {
+    if (!stream || !text || len == 0) return;
+    md_renderer_write(&stream->renderer, text, len);
+}
+
 void md_stream_reset(md_stream_t* stream) {
     if (!stream) return;
     
+    /* Output already rendered still goes out */
+    md_renderer_flush(&stream->renderer);
+    
     /* Clear line buffer */
     stream->line_buf_len = 0;
     if (stream->line_buffer) stream->line_buffer[0] = '\0';
@@ -70,18 +110,9 @@ void md_stream_reset(md_stream_t* stream) {
     /* Reset state */
     stream->state = MD_STATE_NORMAL;
     
-    /* Clear code buffer */
-    free(stream->code_lang);
-    stream->code_lang = NULL;
-    stream->code_buf_len = 0;
-    if (stream->code_buffer) stream->code_buffer[0] = '\0';
-    
-    /* Clear table state */
-    if (stream->pending_table) {
-        md_free_tokens(stream->pending_table);
-        stream->pending_table = NULL;
-    }
-    stream->table_header_seen = 0;
+    /* Clear table state (the arena is kept for the next table) */
+    free(stream->table_header);
+    stream->table_header = NULL;
     
     /* Reset list state */
     stream->in_list = 0;
@@ -91,12 +122,12 @@ void md_stream_reset(md_stream_t* stream) {
 void md_stream_free(md_stream_t* stream) {
     if (!stream) return;
     
+    md_renderer_flush(&stream->renderer);
     free(stream->line_buffer);
-    free(stream->code_lang);
-    free(stream->code_buffer);
-    
-    if (stream->pending_table) {
-        md_free_tokens(stream->pending_table);
+    free(stream->table_header);
+    md_hl_spans_free(&stream->code_spans);
+    if (stream->table_arena) {
+        arena_destroy(stream->table_arena);
     }
     
     free(stream);
@@ -105,17 +136,12 @@ void md_stream_free(md_stream_t* stream) {
 /* ========== Line processing ========== */
 
 /* Forward declaration */
-static void process_line(md_stream_t* stream, const char* line);
+static void process_line(md_stream_t* stream, const char* line, size_t len);
 
-/* Helper to output directly */
+/* Helper to output through the renderer's batch */
 static void output(md_stream_t* stream, const char* text) {
     if (!text) return;
-    if (stream->renderer.output) {
-        stream->renderer.output(text, strlen(text), stream->renderer.userdata);
-    } else {
-        fputs(text, stdout);
-        fflush(stdout);
-    }
+    md_renderer_write(&stream->renderer, text, strlen(text));
 }
 
 static void output_n(md_stream_t* stream, const char* text, int n) {
@@ -130,128 +156,206 @@ static void render_and_free_inline(md_stream_t* stream, md_inline_token_t* token
     md_free_inline_tokens(tokens);
 }
 
+static void render_paragraph(md_stream_t* stream, const char* line) {
+    md_inline_token_t* tokens = md_parse_inline(line);
+    render_and_free_inline(stream, tokens);
+    output(stream, "\n\n");
+}
+
+/* ========== Code blocks ========== */
+
+/*
+ * Code lines are printed as they arrive. The width of the lines still to
+ * come is unknown, so the frame is open on the right and its rules span
+ * the terminal. Each line is highlighted once, with the lexer state
+ * carried over from the line before.
+ */
+
+static void code_open(md_stream_t* stream, const char* info, size_t info_len) {
+    while (info_len > 0 && isspace((unsigned char)info[info_len - 1])) info_len--;
+    char* lang = info_len > 0 ? md_strndup(info, info_len) : NULL;
+    const char* title = lang ? lang : "code";
+    
+    int title_width = md_utf8_display_width(title);
+    int width = stream->renderer.term_width - 1;
+    if (width < title_width + 4) width = title_width + 4;
+    stream->code_width = width;
+    stream->code_lang = md_hl_lang_from_name(info, info_len);
+    stream->code_state = MD_HL_STATE_INIT;
+    
+    output(stream, MD_STYLE_BOLD);
+    output(stream, MD_COLOR_BRIGHT_YELLOW);
+    output(stream, MD_BOX_TOP_LEFT);
+    output(stream, MD_BOX_HORIZONTAL);
+    output(stream, " ");
+    output(stream, title);
+    output(stream, " ");
+    output_n(stream, MD_BOX_HORIZONTAL, width - title_width - 3);
+    output(stream, MD_STYLE_RESET);
+    output(stream, "\n");
+    
+    free(lang);
+}
+
+static void code_line(md_stream_t* stream, const char* line) {
+    output(stream, MD_COLOR_BRIGHT_YELLOW);
+    output(stream, MD_BOX_VERTICAL);
+    output(stream, " ");
+    output(stream, MD_STYLE_RESET);
+    
+    size_t len = strlen(line);
+    stream->code_spans.count = 0;
+    if (md_hl_line(stream->code_lang, &stream->code_state, line, len, &stream->code_spans) != 0) {
+        stream->code_spans.count = 0;
+    }
+    md_render_code_line(&stream->renderer, line, len, stream->code_spans.items,
+                        stream->code_spans.count);
+    output(stream, "\n");
+}
+
+static void code_close(md_stream_t* stream) {
+    output(stream, MD_COLOR_BRIGHT_YELLOW);
+    output(stream, MD_BOX_BOTTOM_LEFT);
+    output_n(stream, MD_BOX_HORIZONTAL, stream->code_width);
+    output(stream, MD_STYLE_RESET);
+    output(stream, "\n\n");
+}
+
+/* ========== Tables ========== */
+
+/*
+ * A line containing '|' is held until the next one shows whether it is a
+ * table header. Once the separator arrives the header is drawn and each
+ * row is drawn as it comes.
+ */
+
+/* Returns 0 (nothing drawn) if the header has no cells */
+static int table_open(md_stream_t* stream, const char* header, const char* separator) {
+    if (!stream->table_arena) {
+        stream->table_arena = arena_create(MD_TABLE_ARENA_SIZE);
+        if (!stream->table_arena) return 0;
+    } else {
+        arena_reset(stream->table_arena);
+    }
+    arena_t* arena = stream->table_arena;
+    
+    size_t count;
+    md_inline_token_t** cells = md_parse_table_row(arena, header, 0, &count);
+    if (!cells || count == 0) return 0;
+    
+    md_align_t* aligns = md_parse_table_aligns(arena, separator, count);
+    int* widths = (int*)arena_alloc(arena, count * sizeof(int));
+    int* fit = (int*)arena_alloc(arena, count * sizeof(int));
+    if (!aligns || !widths || !fit) return 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        int w = cells[i] ? md_inline_width(cells[i]) : 0;
+        widths[i] = w > MD_TABLE_MIN_WIDTH ? w : MD_TABLE_MIN_WIDTH;
+        fit[i] = widths[i];
+    }
+    
+    md_renderer_t* r = &stream->renderer;
+    md_fit_table_widths(r, fit, count);
+    
+    stream->state = MD_STATE_TABLE;
+    stream->table_aligns = aligns;
+    stream->col_widths = widths;
+    stream->fit_widths = fit;
+    stream->col_count = count;
+    
+    md_render_table_divider(r, fit, count, MD_BOX_TOP_LEFT, MD_BOX_T_DOWN, MD_BOX_TOP_RIGHT);
+    md_render_table_row(r, cells, aligns, fit, count, 1);
+    md_render_table_divider(r, fit, count, MD_BOX_T_RIGHT, MD_BOX_CROSS, MD_BOX_T_LEFT);
+    
+    /* The header cells are not needed any more */
+    stream->table_mark = arena_mark(arena);
+    return 1;
+}
+
+static void table_row(md_stream_t* stream, const char* line) {
+    arena_rewind(stream->table_arena, stream->table_mark);
+    
+    size_t count;
+    md_inline_token_t** cells = md_parse_table_row(stream->table_arena, line,
+                                                   stream->col_count, &count);
+    if (!cells) return;
+    
+    /*
+     * Rows on screen cannot be redrawn, so a wider cell widens its column
+     * from this row on, with a divider where the widths change. Columns
+     * that no longer fit the terminal are narrowed and their cells wrap.
+     */
+    int widened = 0;
+    for (size_t i = 0; i < stream->col_count; i++) {
+        int w = cells[i] ? md_inline_width(cells[i]) : 0;
+        if (w > stream->col_widths[i]) {
+            stream->col_widths[i] = w;
+            widened = 1;
+        }
+    }
+    
+    md_renderer_t* r = &stream->renderer;
+    if (widened) {
+        int* fit = (int*)arena_alloc(stream->table_arena, stream->col_count * sizeof(int));
+        if (fit) {
+            memcpy(fit, stream->col_widths, stream->col_count * sizeof(int));
+            md_fit_table_widths(r, fit, stream->col_count);
+            widened = memcmp(fit, stream->fit_widths, stream->col_count * sizeof(int)) != 0;
+            memcpy(stream->fit_widths, fit, stream->col_count * sizeof(int));
+        }
+    }
+    if (widened) {
+        md_render_table_divider(r, stream->fit_widths, stream->col_count,
+                                MD_BOX_T_RIGHT, MD_BOX_CROSS, MD_BOX_T_LEFT);
+    }
+    md_render_table_row(r, cells, stream->table_aligns, stream->fit_widths, stream->col_count, 0);
+}
+
+static void table_close(md_stream_t* stream) {
+    md_render_table_divider(&stream->renderer, stream->fit_widths, stream->col_count,
+                            MD_BOX_BOTTOM_LEFT, MD_BOX_T_UP, MD_BOX_BOTTOM_RIGHT);
+    output(stream, "\n");
+    stream->state = MD_STATE_NORMAL;
+}
+
+/* ========== Line dispatch ========== */
+
 /* Process a complete line */
-static void process_line(md_stream_t* stream, const char* line) {
+static void process_line(md_stream_t* stream, const char* line, size_t len) {
     if (!stream || !line) return;
     
-    size_t len = strlen(line);
+    /* ---- Table rows, and the line after a possible header ---- */
+    if (stream->state == MD_STATE_TABLE) {
+        if (memchr(line, '|', len)) {
+            table_row(stream, line);
+            return;
+        }
+        table_close(stream);
+    }
+    if (stream->table_header) {
+        char* header = stream->table_header;
+        stream->table_header = NULL;
+        int is_table = md_is_table_separator(line) && table_open(stream, header, line);
+        if (!is_table) render_paragraph(stream, header);
+        free(header);
+        if (is_table) return;
+    }
     
     /* ---- Code block handling ---- */
     if (strncmp(line, "```", 3) == 0) {
         if (stream->state != MD_STATE_CODE_BLOCK) {
-            /* Start code block */
             stream->state = MD_STATE_CODE_BLOCK;
             stream->in_list = 0;
-            
-            /* Extract language */
-            free(stream->code_lang);
-            stream->code_lang = md_strdup(line + 3);
-            if (stream->code_lang) md_rtrim(stream->code_lang);
-            
-            /* Reset code buffer */
-            stream->code_buf_len = 0;
-            if (!stream->code_buffer) {
-                stream->code_buf_size = 256;
-                stream->code_buffer = (char*)malloc(stream->code_buf_size);
-            }
-            if (stream->code_buffer) stream->code_buffer[0] = '\0';
-            
-            /* We'll render the code block when it ends */
+            code_open(stream, line + 3, len - 3);
         } else {
-            /* End code block - render it now */
             stream->state = MD_STATE_NORMAL;
-            
-            const char* lang = stream->code_lang && stream->code_lang[0] ? stream->code_lang : "code";
-            const char* code = stream->code_buffer ? stream->code_buffer : "";
-            
-            /* Calculate max line width */
-            int max_width = 0;
-            const char* p = code;
-            int current_width = 0;
-            while (*p) {
-                if (*p == '\n') {
-                    if (current_width > max_width) max_width = current_width;
-                    current_width = 0;
-                } else {
-                    int bytes;
-                    uint32_t cp = md_utf8_decode(p, &bytes);
-                    current_width += md_char_width(cp);
-                    p += bytes - 1;
-                }
-                p++;
-            }
-            if (current_width > max_width) max_width = current_width;
-            
-            /* Draw code block */
-            int lang_len = md_utf8_display_width(lang);
-            int content_width = max_width > lang_len ? max_width : lang_len;
-            int box_inner = content_width + 2;
-            
-            output(stream, MD_STYLE_BOLD);
-            output(stream, MD_COLOR_BRIGHT_YELLOW);
-            output(stream, MD_BOX_TOP_LEFT);
-            output(stream, MD_BOX_HORIZONTAL);
-            output(stream, " ");
-            output(stream, lang);
-            output(stream, " ");
-            int remaining = box_inner - lang_len - 3;
-            if (remaining > 0) {
-                output_n(stream, MD_BOX_HORIZONTAL, remaining);
-            }
-            output(stream, MD_BOX_TOP_RIGHT);
-            output(stream, MD_STYLE_RESET);
-            output(stream, "\n");
-            
-            p = code;
-            while (*p) {
-                output(stream, MD_COLOR_BRIGHT_YELLOW);
-                output(stream, MD_BOX_VERTICAL);
-                output(stream, " ");
-                output(stream, MD_STYLE_RESET);
-                
-                const char* line_start = p;
-                while (*p && *p != '\n') p++;
-                
-                int line_width = 0;
-                if (p > line_start) {
-                    char* code_line = md_strndup(line_start, p - line_start);
-                    if (code_line) {
-                        output(stream, code_line);
-                        line_width = md_utf8_display_width(code_line);
-                        free(code_line);
-                    }
-                }
-                
-                /* Pad and add right border */
-                int padding = content_width - line_width;
-                if (padding > 0) {
-                    output_n(stream, " ", padding);
-                }
-                output(stream, " ");
-                output(stream, MD_COLOR_BRIGHT_YELLOW);
-                output(stream, MD_BOX_VERTICAL);
-                output(stream, MD_STYLE_RESET);
-                output(stream, "\n");
-                if (*p == '\n') p++;
-            }
-            
-            output(stream, MD_COLOR_BRIGHT_YELLOW);
-            output(stream, MD_BOX_BOTTOM_LEFT);
-            output_n(stream, MD_BOX_HORIZONTAL, box_inner);
-            output(stream, MD_BOX_BOTTOM_RIGHT);
-            output(stream, MD_STYLE_RESET);
-            output(stream, "\n\n");
-            
-            free(stream->code_lang);
-            stream->code_lang = NULL;
+            code_close(stream);
         }
         return;
     }
     
     if (stream->state == MD_STATE_CODE_BLOCK) {
-        /* Accumulate code */
-        md_buffer_append(&stream->code_buffer, &stream->code_buf_size, &stream->code_buf_len, line);
-        md_buffer_append(&stream->code_buffer, &stream->code_buf_size, &stream->code_buf_len, "\n");
+        code_line(stream, line);
         return;
     }
     
@@ -323,7 +427,8 @@ static void process_line(md_stream_t* stream, const char* line) {
         output(stream, "> ");
         output(stream, MD_STYLE_ITALIC);
         md_inline_token_t* tokens = md_parse_inline(content);
-        render_and_free_inline(stream, tokens);
+        md_render_inline_wrapped(&stream->renderer, tokens, 2, "> ", MD_QUOTE_STYLE);
+        md_free_inline_tokens(tokens);
         output(stream, MD_STYLE_RESET);
         output(stream, "\n\n");
         return;
@@ -354,8 +459,11 @@ static void process_line(md_stream_t* stream, const char* line) {
         output(stream, bullet);
         output(stream, " ");
         
+        /* Continuation lines hang under the text */
         md_inline_token_t* tokens = md_parse_inline(content);
-        render_and_free_inline(stream, tokens);
+        md_render_inline_wrapped(&stream->renderer, tokens,
+                                 indent * 2 + md_utf8_display_width(bullet) + 1, NULL, NULL);
+        md_free_inline_tokens(tokens);
         output(stream, "\n");
         return;
     }
@@ -379,48 +487,72 @@ static void process_line(md_stream_t* stream, const char* line) {
             
             /* Number */
             char num_buf[16];
-            snprintf(num_buf, sizeof(num_buf), "%d. ", stream->list_item_number);
+            int num_len = snprintf(num_buf, sizeof(num_buf), "%d. ", stream->list_item_number);
             output(stream, num_buf);
             stream->list_item_number++;
             
             md_inline_token_t* tokens = md_parse_inline(content);
-            render_and_free_inline(stream, tokens);
+            md_render_inline_wrapped(&stream->renderer, tokens, indent * 2 + num_len, NULL, NULL);
+            md_free_inline_tokens(tokens);
             output(stream, "\n");
             return;
         }
     }
     
-    /* ---- Default: Paragraph ---- */
+    /* ---- Default: Paragraph, or a table header (not right after a list) ---- */
+    int after_list = stream->in_list;
     stream->in_list = 0;
-    md_inline_token_t* tokens = md_parse_inline(line);
-    render_and_free_inline(stream, tokens);
-    output(stream, "\n\n");
+    if (!after_list && memchr(line, '|', len)) {
+        stream->table_header = md_strndup(line, len);
+        if (stream->table_header) return;
+    }
+    render_paragraph(stream, line);
 }
 
 /* ========== Streaming interface ========== */
 
+/* Append a span of the current line, dropping carriage returns */
+static void line_append(md_stream_t* stream, const char* p, const char* end) {
+    while (p < end) {
+        const char* cr = memchr(p, '\r', (size_t)(end - p));
+        const char* stop = cr ? cr : end;
+        if (stop > p) {
+            md_buffer_append_n(&stream->line_buffer, &stream->line_buf_size,
+                               &stream->line_buf_len, p, (size_t)(stop - p));
+        }
+        p = cr ? cr + 1 : end;
+    }
+}
+
+/* Process the buffered line and start a new one */
+static void line_flush(md_stream_t* stream) {
+    if (stream->line_buffer) {
+        stream->line_buffer[stream->line_buf_len] = '\0';
+    }
+    process_line(stream, stream->line_buffer ? stream->line_buffer : "", stream->line_buf_len);
+    stream->line_buf_len = 0;
+    if (stream->line_buffer) stream->line_buffer[0] = '\0';
+}
+
 void md_stream_feed(md_stream_t* stream, const char* data, size_t len) {
     if (!stream || !data || len == 0) return;
     
-    for (size_t i = 0; i < len; i++) {
-        char c = data[i];
-        
-        if (c == '\n') {
-            /* Complete line - process it */
-            if (stream->line_buffer) {
-                stream->line_buffer[stream->line_buf_len] = '\0';
-            }
-            process_line(stream, stream->line_buffer ? stream->line_buffer : "");
-            
-            /* Reset line buffer */
-            stream->line_buf_len = 0;
-            if (stream->line_buffer) stream->line_buffer[0] = '\0';
-        } else if (c != '\r') {
-            /* Add to line buffer */
-            md_buffer_append_char(&stream->line_buffer, &stream->line_buf_size, 
-                                  &stream->line_buf_len, c);
+    const char* p = data;
+    const char* end = data + len;
+    
+    while (p < end) {
+        const char* nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl) {
+            /* Partial line - keep it for the next chunk */
+            line_append(stream, p, end);
+            break;
         }
+        line_append(stream, p, nl);
+        line_flush(stream);
+        p = nl + 1;
     }
+    
+    md_renderer_flush_due(&stream->renderer);
 }
 
 void md_stream_feed_str(md_stream_t* stream, const char* str) {
@@ -433,17 +565,21 @@ void md_stream_finish(md_stream_t* stream) {
     
     /* Process any remaining content in line buffer */
     if (stream->line_buf_len > 0) {
-        if (stream->line_buffer) {
-            stream->line_buffer[stream->line_buf_len] = '\0';
-        }
-        process_line(stream, stream->line_buffer ? stream->line_buffer : "");
-        stream->line_buf_len = 0;
+        line_flush(stream);
     }
     
-    /* If we're in an unclosed code block, render what we have */
-    if (stream->state == MD_STATE_CODE_BLOCK && stream->code_buffer) {
-        output(stream, stream->code_buffer);
+    /* Close whatever is still open */
+    if (stream->table_header) {
+        render_paragraph(stream, stream->table_header);
+        free(stream->table_header);
+        stream->table_header = NULL;
+    }
+    if (stream->state == MD_STATE_TABLE) {
+        table_close(stream);
+    } else if (stream->state == MD_STATE_CODE_BLOCK) {
+        code_close(stream);
     }
     
     stream->state = MD_STATE_NORMAL;
+    md_renderer_flush(&stream->renderer);
 }
@@ -33,9 +33,47 @@ md_stream_t* md_stream_new(void);
  */
 void md_stream_set_output(md_stream_t* stream, md_output_fn output, void* userdata);
 
+/**
+ * Set the output batching interval
+ * Rendered output is coalesced and written at line ends at most every
+ * interval_ms (default 0: every line end), at the end of md_stream_feed
+ * once the interval has passed, and on md_stream_finish/md_stream_flush.
+ * A larger interval means fewer writes over slow links; output batched
+ * when the input stalls waits for the next feed or an md_stream_flush.
+ * @param stream Stream context
+ * @param interval_ms Interval in milliseconds, or -1 to write every fragment
+ */
+void md_stream_set_batching(md_stream_t* stream, int interval_ms);
+
+/**
+ * Set the width output is laid out for
+ * Defaults to the terminal's width when the stream is created.
+ * @param stream Stream context
+ * @param columns Width in columns (ignored if not positive)
+ */
+void md_stream_set_width(md_stream_t* stream, int columns);
+
+/**
+ * Write any batched output now
+ * @param stream Stream context
+ */
+void md_stream_flush(md_stream_t* stream);
+
+/**
+ * Write text as-is, bypassing Markdown
+ * Goes out after the lines fed so far; a partial line still buffered is
+ * rendered later.
+ * @param stream Stream context
+ * @param text Text (need not be NUL-terminated)
+ * @param len Length of text
+ */
+void md_stream_write(md_stream_t* stream, const char* text, size_t len);
+
 /**
  * Feed data to the stream
  * Data will be parsed and rendered incrementally as complete lines are received.
+ * Code block lines and table rows are drawn as they arrive; a line with '|'
+ * is held until the next line shows whether it starts a table.
  * @param stream Stream context
  * @param data Input data (may be partial, doesn't need to be null-terminated)
  * @param len Length of data
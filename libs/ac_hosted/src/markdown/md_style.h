@@ -93,6 +93,25 @@ extern "C" {
 #define MD_BULLET_LEVEL1     "◦"
 #define MD_BULLET_LEVEL2     "▪"
 
+/* ========== Block quotes ========== */
+/* Restored at the start of each wrapped line of a quote */
+#define MD_QUOTE_STYLE       MD_BG_DARK_GRAY MD_COLOR_LIGHT_GRAY MD_STYLE_ITALIC
+
+/* ========== Syntax highlighting (see md_highlight.h) ========== */
+#define MD_HL_KEYWORD_STYLE  MD_STYLE_BOLD MD_COLOR_MAGENTA
+#define MD_HL_TYPE_STYLE     MD_COLOR_CYAN
+#define MD_HL_LITERAL_STYLE  MD_COLOR_BRIGHT_MAGENTA
+#define MD_HL_STRING_STYLE   MD_COLOR_GREEN
+#define MD_HL_NUMBER_STYLE   MD_COLOR_YELLOW
+#define MD_HL_COMMENT_STYLE  MD_COLOR_DARK_GRAY MD_STYLE_ITALIC
+#define MD_HL_PREPROC_STYLE  MD_COLOR_BLUE
+#define MD_HL_VARIABLE_STYLE MD_COLOR_BRIGHT_CYAN
+#define MD_HL_PROPERTY_STYLE MD_COLOR_BLUE
+#define MD_HL_ADDED_STYLE    MD_COLOR_GREEN
+#define MD_HL_REMOVED_STYLE  MD_COLOR_RED
+#define MD_HL_HUNK_STYLE     MD_COLOR_CYAN
+#define MD_HL_HEADER_STYLE   MD_STYLE_BOLD
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,259 @@
+/**
+ * @file md_transcript.c
+ * @brief Chat transcript with cached line layout
+ */
+
+#include "md_transcript.h"
+#include "md_utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MD_TRANSCRIPT_NO_DAMAGE SIZE_MAX
+
+typedef struct {
+    md_transcript_role_t role;
+    char* text;
+    size_t len;
+    size_t size;
+    md_transcript_line_t* lines;
+    size_t line_count;
+    size_t line_cap;
+    int width;              /* Widest line */
+} md_message_t;
+
+struct md_transcript {
+    md_message_t* messages;
+    size_t count;
+    size_t cap;
+    int wrap_width;
+    size_t total_lines;
+    size_t damage_first;    /* MD_TRANSCRIPT_NO_DAMAGE when clean */
+    int damage_shifted;
+};
+
+/* ========== Layout ========== */
+
+static int push_line(md_message_t* m, const char* start, const char* end, int width) {
+    if (m->line_count >= m->line_cap) {
+        size_t cap = m->line_cap ? m->line_cap * 2 : 4;
+        md_transcript_line_t* lines = (md_transcript_line_t*)realloc(m->lines, cap * sizeof(*lines));
+        if (!lines) return -1;
+        m->lines = lines;
+        m->line_cap = cap;
+    }
+    md_transcript_line_t* line = &m->lines[m->line_count++];
+    line->text = start;
+    line->len = (size_t)(end - start);
+    line->width = width;
+    if (width > m->width) m->width = width;
+    return 0;
+}
+
+/*
+ * Wrap m->text from line `from` on (see md_wrap_line). A line only
+ * depends on the text up to the character that ended it, so appended
+ * text never moves a break before the start of the last line.
+ */
+static int layout_from(md_message_t* m, size_t from, int max_width) {
+    const char* p = from < m->line_count ? m->lines[from].text : m->text;
+    const char* text_end = m->text + m->len;
+
+    m->line_count = from < m->line_count ? from : m->line_count;
+    m->width = 0;
+    for (size_t i = 0; i < m->line_count; i++) {
+        if (m->lines[i].width > m->width) m->width = m->lines[i].width;
+    }
+    if (max_width < 1) max_width = 1;
+
+    while (p < text_end) {
+        md_wrap_line_t line;
+        md_wrap_line(p, (size_t)(text_end - p), max_width, &line);
+
+        /* The last line keeps its trailing spaces; the bubble does not */
+        size_t len = line.len;
+        int width = line.width;
+        while (line.brk == MD_WRAP_END && len > 0 && p[len - 1] == ' ') {
+            len--;
+            width--;
+        }
+
+        if (push_line(m, p, p + len, width) != 0) return -1;
+        p += line.next;
+    }
+    return 0;
+}
+
+static void total_lines_update(md_transcript_t* t, size_t before, size_t after) {
+    t->total_lines = t->total_lines - before + after;
+}
+
+static void damage(md_transcript_t* t, size_t index, int shifted) {
+    if (index < t->damage_first) t->damage_first = index;
+    if (shifted) t->damage_shifted = 1;
+}
+
+static void message_free(md_message_t* m) {
+    free(m->text);
+    free(m->lines);
+}
+
+/* ========== Public API ========== */
+
+md_transcript_t* md_transcript_new(int wrap_width) {
+    md_transcript_t* t = (md_transcript_t*)calloc(1, sizeof(md_transcript_t));
+    if (!t) return NULL;
+    t->wrap_width = wrap_width;
+    t->damage_first = MD_TRANSCRIPT_NO_DAMAGE;
+    return t;
+}
+
+void md_transcript_free(md_transcript_t* t) {
+    if (!t) return;
+    for (size_t i = 0; i < t->count; i++) {
+        message_free(&t->messages[i]);
+    }
+    free(t->messages);
+    free(t);
+}
+
+int md_transcript_set_width(md_transcript_t* t, int wrap_width) {
+    if (!t) return -1;
+    if (wrap_width == t->wrap_width) return 0;
+
+    t->wrap_width = wrap_width;
+    t->total_lines = 0;
+    int rc = 0;
+    for (size_t i = 0; i < t->count; i++) {
+        if (layout_from(&t->messages[i], 0, wrap_width) != 0) rc = -1;
+        t->total_lines += t->messages[i].line_count;
+    }
+    if (t->count > 0) damage(t, 0, 1);
+    return rc;
+}
+
+int md_transcript_append(md_transcript_t* t, md_transcript_role_t role, const char* text) {
+    if (!t) return -1;
+
+    if (t->count >= t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 16;
+        md_message_t* messages = (md_message_t*)realloc(t->messages, cap * sizeof(*messages));
+        if (!messages) return -1;
+        t->messages = messages;
+        t->cap = cap;
+    }
+
+    md_message_t* m = &t->messages[t->count];
+    memset(m, 0, sizeof(*m));
+    m->role = role;
+    size_t len = text ? strlen(text) : 0;
+    if (md_buffer_append_n(&m->text, &m->size, &m->len, text ? text : "", len) != 0 ||
+        layout_from(m, 0, t->wrap_width) != 0) {
+        message_free(m);
+        return -1;
+    }
+
+    t->total_lines += m->line_count;
+    damage(t, t->count, 1);
+    return (int)t->count++;
+}
+
+int md_transcript_append_text(md_transcript_t* t, size_t index, const char* text, size_t len) {
+    if (!t || index >= t->count || !text) return -1;
+    if (len == 0) return 0;
+
+    md_message_t* m = &t->messages[index];
+    const char* old_text = m->text;
+    if (md_buffer_append_n(&m->text, &m->size, &m->len, text, len) != 0) return -1;
+
+    /* Cached lines point into the text; follow it if realloc moved it */
+    if (m->text != old_text) {
+        for (size_t i = 0; i < m->line_count; i++) {
+            m->lines[i].text = m->text + (m->lines[i].text - old_text);
+        }
+    }
+
+    size_t before = m->line_count;
+    size_t from = before > 0 ? before - 1 : 0;
+    int rc = layout_from(m, from, t->wrap_width);
+    total_lines_update(t, before, m->line_count);
+    damage(t, index, m->line_count != before);
+    return rc;
+}
+
+int md_transcript_set_text(md_transcript_t* t, size_t index, const char* text) {
+    if (!t || index >= t->count) return -1;
+
+    md_message_t* m = &t->messages[index];
+    size_t before = m->line_count;
+    m->len = 0;
+    m->line_count = 0;
+    if (md_buffer_append_n(&m->text, &m->size, &m->len, text ? text : "",
+                           text ? strlen(text) : 0) != 0) {
+        total_lines_update(t, before, 0);
+        damage(t, index, 1);
+        return -1;
+    }
+
+    int rc = layout_from(m, 0, t->wrap_width);
+    total_lines_update(t, before, m->line_count);
+    damage(t, index, m->line_count != before);
+    return rc;
+}
+
+void md_transcript_drop_oldest(md_transcript_t* t) {
+    if (!t || t->count == 0) return;
+
+    total_lines_update(t, t->messages[0].line_count, 0);
+    message_free(&t->messages[0]);
+    memmove(&t->messages[0], &t->messages[1], (t->count - 1) * sizeof(md_message_t));
+    t->count--;
+    damage(t, 0, 1);
+}
+
+void md_transcript_clear(md_transcript_t* t) {
+    if (!t) return;
+
+    for (size_t i = 0; i < t->count; i++) {
+        message_free(&t->messages[i]);
+    }
+    t->count = 0;
+    t->total_lines = 0;
+    damage(t, 0, 1);
+}
+
+size_t md_transcript_count(const md_transcript_t* t) {
+    return t ? t->count : 0;
+}
+
+md_transcript_role_t md_transcript_role(const md_transcript_t* t, size_t index) {
+    if (!t || index >= t->count) return MD_TRANSCRIPT_SYSTEM;
+    return t->messages[index].role;
+}
+
+const md_transcript_line_t* md_transcript_lines(const md_transcript_t* t, size_t index,
+                                                size_t* count, int* width) {
+    if (count) *count = 0;
+    if (width) *width = 0;
+    if (!t || index >= t->count) return NULL;
+
+    const md_message_t* m = &t->messages[index];
+    if (count) *count = m->line_count;
+    if (width) *width = m->width;
+    return m->line_count > 0 ? m->lines : NULL;
+}
+
+size_t md_transcript_total_lines(const md_transcript_t* t) {
+    return t ? t->total_lines : 0;
+}
+
+int md_transcript_take_damage(md_transcript_t* t, size_t* first, int* shifted) {
+    if (!t) return 0;
+
+    int dirty = t->damage_first != MD_TRANSCRIPT_NO_DAMAGE;
+    if (first) *first = dirty ? t->damage_first : 0;
+    if (shifted) *shifted = t->damage_shifted;
+    t->damage_first = MD_TRANSCRIPT_NO_DAMAGE;
+    t->damage_shifted = 0;
+    return dirty;
+}
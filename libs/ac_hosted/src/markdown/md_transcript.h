@@ -0,0 +1,148 @@
+/**
+ * @file md_transcript.h
+ * @brief Chat transcript with cached line layout
+ *
+ * Holds the messages of a chat view together with their word-wrapped
+ * lines, so a terminal UI can repaint from the cache instead of wrapping
+ * every message on every frame. Appending streamed text re-wraps only
+ * the last line of that message; a width change re-wraps everything.
+ *
+ * Changes are recorded as damage (see md_transcript_take_damage) so the
+ * UI can skip the repaint, repaint one message's rows, or repaint the
+ * viewport when lines moved.
+ */
+
+#ifndef MD_TRANSCRIPT_H
+#define MD_TRANSCRIPT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct md_transcript md_transcript_t;
+
+typedef enum {
+    MD_TRANSCRIPT_USER,
+    MD_TRANSCRIPT_ASSISTANT,
+    MD_TRANSCRIPT_SYSTEM
+} md_transcript_role_t;
+
+/**
+ * One wrapped line; text points into the message and is not NUL-terminated
+ */
+typedef struct {
+    const char* text;
+    size_t len;
+    int width;              /* Display columns */
+} md_transcript_line_t;
+
+/**
+ * Create an empty transcript
+ * @param wrap_width Columns available for message text
+ * @return New transcript, or NULL on failure
+ */
+md_transcript_t* md_transcript_new(int wrap_width);
+
+/**
+ * Free a transcript and its messages
+ * @param t Transcript
+ */
+void md_transcript_free(md_transcript_t* t);
+
+/**
+ * Change the wrap width (terminal resize); re-wraps every message
+ * @param t Transcript
+ * @param wrap_width Columns available for message text
+ * @return 0 on success, -1 on failure
+ */
+int md_transcript_set_width(md_transcript_t* t, int wrap_width);
+
+/**
+ * Add a message
+ * @param t Transcript
+ * @param role Who sent it
+ * @param text Message text
+ * @return Index of the message, or -1 on failure
+ */
+int md_transcript_append(md_transcript_t* t, md_transcript_role_t role, const char* text);
+
+/**
+ * Append streamed text to a message, re-wrapping from its last line
+ * @param t Transcript
+ * @param index Message index
+ * @param text Text to append (need not be NUL-terminated)
+ * @param len Length of text
+ * @return 0 on success, -1 on failure
+ */
+int md_transcript_append_text(md_transcript_t* t, size_t index, const char* text, size_t len);
+
+/**
+ * Replace the text of a message
+ * @param t Transcript
+ * @param index Message index
+ * @param text New text
+ * @return 0 on success, -1 on failure
+ */
+int md_transcript_set_text(md_transcript_t* t, size_t index, const char* text);
+
+/**
+ * Remove the oldest message
+ * @param t Transcript
+ */
+void md_transcript_drop_oldest(md_transcript_t* t);
+
+/**
+ * Remove all messages
+ * @param t Transcript
+ */
+void md_transcript_clear(md_transcript_t* t);
+
+/**
+ * @param t Transcript
+ * @return Number of messages
+ */
+size_t md_transcript_count(const md_transcript_t* t);
+
+/**
+ * @param t Transcript
+ * @param index Message index
+ * @return Role of the message
+ */
+md_transcript_role_t md_transcript_role(const md_transcript_t* t, size_t index);
+
+/**
+ * Wrapped lines of a message
+ * Valid until the message is next changed or the width is set.
+ * @param t Transcript
+ * @param index Message index
+ * @param count Receives the number of lines
+ * @param width Receives the widest line's width (optional)
+ * @return Line array, or NULL if the message is empty or out of range
+ */
+const md_transcript_line_t* md_transcript_lines(const md_transcript_t* t, size_t index,
+                                                size_t* count, int* width);
+
+/**
+ * @param t Transcript
+ * @return Wrapped lines of all messages together
+ */
+size_t md_transcript_total_lines(const md_transcript_t* t);
+
+/**
+ * Report what changed since the last call, and start over
+ * @param t Transcript
+ * @param first Receives the first changed message (optional)
+ * @param shifted Receives 1 if a line count changed or messages were
+ *                added or removed, i.e. rows below (or above, when
+ *                bottom-anchored) the change moved (optional)
+ * @return 1 if anything changed, 0 otherwise
+ */
+int md_transcript_take_damage(md_transcript_t* t, size_t* first, int* shifted);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MD_TRANSCRIPT_H */
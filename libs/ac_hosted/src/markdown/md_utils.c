@@ -111,56 +111,275 @@ uint32_t md_utf8_decode(const char* str, int* bytes_read) {
     return codepoint;
 }
 
+/*
+ * Code point ranges, sorted, searched by bisection. Wide is East Asian
+ * Wide/Fullwidth plus emoji presentation; zero-width is combining marks,
+ * format characters and variation selectors.
+ */
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} md_range_t;
+
+static const md_range_t zero_width_ranges[] = {
+    {0x0300, 0x036F},   /* Combining diacritical marks */
+    {0x0483, 0x0489},   /* Cyrillic combining */
+    {0x0591, 0x05BD},   /* Hebrew points */
+    {0x0610, 0x061A},   /* Arabic marks */
+    {0x064B, 0x065F},
+    {0x0E31, 0x0E31},   /* Thai vowels and tones */
+    {0x0E34, 0x0E3A},
+    {0x0E47, 0x0E4E},
+    {0x1160, 0x11FF},   /* Hangul medial vowels, final consonants */
+    {0x1AB0, 0x1AFF},   /* Combining diacritical marks extended */
+    {0x1DC0, 0x1DFF},   /* Combining diacritical marks supplement */
+    {0x200B, 0x200F},   /* Zero-width space, joiners, direction marks */
+    {0x2060, 0x206F},   /* Word joiner, invisible operators */
+    {0x20D0, 0x20FF},   /* Combining marks for symbols */
+    {0x302A, 0x302D},   /* Ideographic tone marks */
+    {0x3099, 0x309A},   /* Kana voicing marks */
+    {0xFE00, 0xFE0F},   /* Variation selectors */
+    {0xFE20, 0xFE2F},   /* Combining half marks */
+    {0xFEFF, 0xFEFF},   /* Byte order mark */
+    {0xE0100, 0xE01EF}, /* Variation selectors supplement */
+};
+
+static const md_range_t wide_ranges[] = {
+    {0x1100, 0x115F},   /* Hangul Jamo initials */
+    {0x231A, 0x231B},   /* Watch, hourglass */
+    {0x2329, 0x232A},   /* Angle brackets */
+    {0x23E9, 0x23EC},
+    {0x23F0, 0x23F0},
+    {0x23F3, 0x23F3},
+    {0x25FD, 0x25FE},
+    {0x2614, 0x2615},
+    {0x2648, 0x2653},   /* Zodiac */
+    {0x267F, 0x267F},
+    {0x2693, 0x2693},
+    {0x26A1, 0x26A1},
+    {0x26AA, 0x26AB},
+    {0x26BD, 0x26BE},
+    {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE},
+    {0x26D4, 0x26D4},
+    {0x26EA, 0x26EA},
+    {0x26F2, 0x26F3},
+    {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA},
+    {0x26FD, 0x26FD},
+    {0x2705, 0x2705},
+    {0x270A, 0x270B},
+    {0x2728, 0x2728},
+    {0x274C, 0x274C},
+    {0x274E, 0x274E},
+    {0x2753, 0x2755},
+    {0x2757, 0x2757},
+    {0x2795, 0x2797},
+    {0x27B0, 0x27B0},
+    {0x27BF, 0x27BF},
+    {0x2B1B, 0x2B1C},
+    {0x2B50, 0x2B50},
+    {0x2B55, 0x2B55},
+    {0x2E80, 0x3029},   /* CJK radicals, punctuation */
+    {0x302E, 0x303E},
+    {0x3041, 0x3098},   /* Hiragana */
+    {0x309B, 0x33FF},   /* Katakana, Bopomofo, CJK compatibility */
+    {0x3400, 0x4DBF},   /* CJK extension A */
+    {0x4E00, 0x9FFF},   /* CJK unified ideographs */
+    {0xA000, 0xA4CF},   /* Yi */
+    {0xA960, 0xA97F},   /* Hangul Jamo extended A */
+    {0xAC00, 0xD7A3},   /* Hangul syllables */
+    {0xF900, 0xFAFF},   /* CJK compatibility ideographs */
+    {0xFE10, 0xFE19},   /* Vertical forms */
+    {0xFE30, 0xFE6F},   /* CJK compatibility forms, small forms */
+    {0xFF00, 0xFF60},   /* Fullwidth forms */
+    {0xFFE0, 0xFFE6},   /* Fullwidth signs */
+    {0x16FE0, 0x16FE4},
+    {0x17000, 0x18CFF}, /* Tangut, Khitan */
+    {0x1B000, 0x1B2FF}, /* Kana supplement, Nushu */
+    {0x1F004, 0x1F004}, /* Mahjong tile */
+    {0x1F0CF, 0x1F0CF}, /* Joker */
+    {0x1F18E, 0x1F18E},
+    {0x1F191, 0x1F19A}, /* Squared letters */
+    {0x1F200, 0x1F202},
+    {0x1F210, 0x1F23B},
+    {0x1F240, 0x1F248},
+    {0x1F250, 0x1F251},
+    {0x1F260, 0x1F265},
+    {0x1F300, 0x1F64F}, /* Pictographs, emoticons */
+    {0x1F680, 0x1F6FF}, /* Transport and map */
+    {0x1F7E0, 0x1F7EB}, /* Coloured circles and squares */
+    {0x1F90C, 0x1F9FF}, /* Supplemental symbols and pictographs */
+    {0x1FA70, 0x1FAFF}, /* Symbols and pictographs extended A */
+    {0x20000, 0x2FFFD}, /* CJK extensions B-F */
+    {0x30000, 0x3FFFD}, /* CJK extension G+ */
+};
+
+static int in_ranges(uint32_t cp, const md_range_t* ranges, size_t count) {
+    if (cp < ranges[0].first || cp > ranges[count - 1].last) return 0;
+
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cp > ranges[mid].last) {
+            lo = mid + 1;
+        } else if (cp < ranges[mid].first) {
+            hi = mid;
+        } else {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#define MD_RANGE_COUNT(ranges) (sizeof(ranges) / sizeof((ranges)[0]))
+
 int md_char_width(uint32_t codepoint) {
-    /* Zero-width characters */
-    if (codepoint == 0 ||
-        (codepoint >= 0x0300 && codepoint <= 0x036F) ||  /* Combining diacritical */
-        (codepoint >= 0x200B && codepoint <= 0x200F) ||  /* Zero-width space, etc. */
-        (codepoint >= 0x2060 && codepoint <= 0x206F) ||  /* Word joiner, etc. */
-        (codepoint >= 0xFE00 && codepoint <= 0xFE0F) ||  /* Variation selectors */
-        (codepoint >= 0xFE20 && codepoint <= 0xFE2F)) {  /* Combining half marks */
+    /* Nothing below U+0300 is wide or combining */
+    if (codepoint < 0x0300) return codepoint != 0;
+
+    /* CJK unified ideographs, most of any Chinese text */
+    if (codepoint >= 0x4E00 && codepoint <= 0x9FFF) return 2;
+
+    if (in_ranges(codepoint, zero_width_ranges, MD_RANGE_COUNT(zero_width_ranges))) {
         return 0;
     }
-    
-    /* Wide characters (CJK, fullwidth forms, etc.) */
-    if ((codepoint >= 0x1100 && codepoint <= 0x115F) ||   /* Hangul Jamo */
-        (codepoint >= 0x2E80 && codepoint <= 0x9FFF) ||   /* CJK */
-        (codepoint >= 0xAC00 && codepoint <= 0xD7A3) ||   /* Hangul syllables */
-        (codepoint >= 0xF900 && codepoint <= 0xFAFF) ||   /* CJK Compatibility */
-        (codepoint >= 0xFE10 && codepoint <= 0xFE1F) ||   /* Vertical forms */
-        (codepoint >= 0xFE30 && codepoint <= 0xFE6F) ||   /* CJK Compatibility Forms */
-        (codepoint >= 0xFF00 && codepoint <= 0xFF60) ||   /* Fullwidth forms */
-        (codepoint >= 0xFFE0 && codepoint <= 0xFFE6) ||   /* Fullwidth signs */
-        (codepoint >= 0x20000 && codepoint <= 0x2FFFD) || /* CJK Extension B-F */
-        (codepoint >= 0x30000 && codepoint <= 0x3FFFD)) { /* CJK Extension G+ */
+    if (in_ranges(codepoint, wide_ranges, MD_RANGE_COUNT(wide_ranges))) {
         return 2;
     }
-    
-    /* Emoji (most are wide) */
-    if ((codepoint >= 0x1F300 && codepoint <= 0x1F9FF) || /* Misc Symbols, Emoticons */
-        (codepoint >= 0x1FA00 && codepoint <= 0x1FAFF)) { /* Chess, Extended-A */
-        return 2;
-    }
-    
     return 1;
 }
 
-int md_utf8_display_width(const char* str) {
+/*
+ * md_utf8_decode() for a span. A sequence cut off by the end of the span
+ * (a chunk boundary while streaming) takes the rest of it and no width,
+ * so it cannot move a line break before it.
+ */
+static uint32_t utf8_decode_n(const unsigned char* s, size_t avail, int* bytes_read) {
+    int len = (s[0] & 0xE0) == 0xC0 ? 2 : (s[0] & 0xF0) == 0xE0 ? 3 : (s[0] & 0xF8) == 0xF0 ? 4 : 1;
+    if ((size_t)len > avail) {
+        size_t i = 1;
+        while (i < avail && (s[i] & 0xC0) == 0x80) i++;
+        if (i == avail) {
+            *bytes_read = (int)avail;
+            return 0;
+        }
+        /* Not cut off but malformed: md_utf8_decode stops at s[i] */
+    }
+    uint32_t cp = md_utf8_decode((const char*)s, bytes_read);
+    if (*bytes_read == 0) *bytes_read = 1;      /* Embedded NUL */
+    return cp;
+}
+
+/* Length of the run of ASCII bytes at s, eight at a time */
+static size_t ascii_run(const unsigned char* s, size_t len) {
+    size_t n = 0;
+    while (n + 8 <= len) {
+        uint64_t word;
+        memcpy(&word, s + n, sizeof(word));
+        if (word & 0x8080808080808080ULL) break;
+        n += 8;
+    }
+    while (n < len && s[n] < 0x80) n++;
+    return n;
+}
+
+int md_utf8_display_width_n(const char* str, size_t len) {
     if (!str) return 0;
-    
+
+    const unsigned char* s = (const unsigned char*)str;
+    const unsigned char* end = s + len;
     int width = 0;
-    int bytes;
-    
-    while (*str) {
-        uint32_t cp = md_utf8_decode(str, &bytes);
-        if (bytes == 0) break;
+
+    while (s < end) {
+        /* ASCII is one column a byte */
+        size_t run = ascii_run(s, (size_t)(end - s));
+        width += (int)run;
+        s += run;
+        if (s >= end) break;
+
+        int bytes;
+        uint32_t cp = utf8_decode_n(s, (size_t)(end - s), &bytes);
         width += md_char_width(cp);
-        str += bytes;
+        s += bytes;
     }
-    
+
     return width;
 }
 
+int md_utf8_display_width(const char* str) {
+    if (!str) return 0;
+    return md_utf8_display_width_n(str, strlen(str));
+}
+
+/* ========== Wrapping ========== */
+
+void md_wrap_line(const char* str, size_t len, int max_width, md_wrap_line_t* line) {
+    const unsigned char* start = (const unsigned char*)str;
+    const unsigned char* end = start + len;
+    const unsigned char* p = start;
+    const unsigned char* word_end = start;  /* After the last non-space */
+    const unsigned char* wrap_end = NULL;   /* End of the last word followed by a space */
+    int word_width = 0;
+    int wrap_width = 0;
+    int width = 0;
+
+    while (p < end && *p != '\n') {
+        int bytes = 1;
+        int cw = 1;
+        if (*p >= 0x80) {
+            cw = md_char_width(utf8_decode_n(p, (size_t)(end - p), &bytes));
+        }
+
+        if (width + cw > max_width && p > start) {
+            if (*p == ' ') {
+                /* Break at this run of spaces */
+                line->brk = MD_WRAP_SPACE;
+                line->len = (size_t)(word_end - start);
+                line->width = word_width;
+            } else if (wrap_end) {
+                line->brk = MD_WRAP_SPACE;
+                line->len = (size_t)(wrap_end - start);
+                line->width = wrap_width;
+                p = wrap_end;
+            } else {
+                line->brk = MD_WRAP_FORCED;
+                line->len = (size_t)(p - start);
+                line->width = width;
+                line->next = line->len;
+                return;
+            }
+            while (p < end && *p == ' ') p++;
+            line->next = (size_t)(p - start);
+            return;
+        }
+
+        if (*p == ' ') {
+            if (p > start && p[-1] != ' ') {
+                wrap_end = p;
+                wrap_width = width;
+            }
+        } else {
+            word_end = p + bytes;
+            word_width = width + cw;
+        }
+        width += cw;
+        p += bytes;
+    }
+
+    if (p < end) {
+        line->brk = MD_WRAP_NEWLINE;
+        line->len = (size_t)(word_end - start);
+        line->width = word_width;
+        line->next = (size_t)(p - start) + 1;
+    } else {
+        line->brk = MD_WRAP_END;
+        line->len = len;
+        line->width = width;
+        line->next = len;
+    }
+}
+
 /* ========== String utilities ========== */
 
 char* md_strdup(const char* str) {
@@ -222,7 +441,11 @@ int md_count_indent(const char* str) {
 
 int md_buffer_append(char** buf, size_t* buf_size, size_t* buf_len, const char* str) {
     if (!str) return 0;
-    size_t str_len = strlen(str);
+    return md_buffer_append_n(buf, buf_size, buf_len, str, strlen(str));
+}
+
+int md_buffer_append_n(char** buf, size_t* buf_size, size_t* buf_len, const char* str, size_t str_len) {
+    if (!str) return 0;
     
     /* Ensure capacity */
     size_t needed = *buf_len + str_len + 1;
@@ -238,12 +461,12 @@ int md_buffer_append(char** buf, size_t* buf_size, size_t* buf_len, const char*
         *buf_size = new_size;
     }
     
-    memcpy(*buf + *buf_len, str, str_len + 1);
+    memcpy(*buf + *buf_len, str, str_len);
     *buf_len += str_len;
+    (*buf)[*buf_len] = '\0';
     return 0;
 }
 
 int md_buffer_append_char(char** buf, size_t* buf_size, size_t* buf_len, char c) {
-    char str[2] = {c, '\0'};
-    return md_buffer_append(buf, buf_size, buf_len, str);
+    return md_buffer_append_n(buf, buf_size, buf_len, &c, 1);
 }
@@ -35,6 +35,8 @@ uint32_t md_utf8_decode(const char* str, int* bytes_read);
 
 /**
  * Check if a Unicode code point is a wide character (e.g., CJK)
+ * East Asian Wide/Fullwidth and emoji presentation characters are wide;
+ * combining marks, zero-width spaces and variation selectors take none.
  * @param codepoint Unicode code point
  * @return 2 if wide, 1 if normal, 0 if zero-width
  */
@@ -47,6 +49,47 @@ int md_char_width(uint32_t codepoint);
  */
 int md_utf8_display_width(const char* str);
 
+/**
+ * Calculate display width of a UTF-8 byte span
+ * @param str UTF-8 bytes (need not be NUL-terminated)
+ * @param len Number of bytes
+ * @return Display width in terminal columns
+ */
+int md_utf8_display_width_n(const char* str, size_t len);
+
+/**
+ * How a wrapped line ended
+ */
+typedef enum {
+    MD_WRAP_END,            /* The text ran out; the line keeps trailing spaces */
+    MD_WRAP_NEWLINE,        /* At a '\n' */
+    MD_WRAP_SPACE,          /* At the last space that fits */
+    MD_WRAP_FORCED          /* Inside a word wider than the line */
+} md_wrap_break_t;
+
+/**
+ * One wrapped line of a byte span
+ */
+typedef struct {
+    size_t len;             /* Bytes on the line, without the spaces at a break */
+    int width;              /* Display width of those bytes */
+    size_t next;            /* Where the following line starts */
+    md_wrap_break_t brk;
+} md_wrap_line_t;
+
+/**
+ * Find the first line of a span when wrapped greedily to max_width
+ * Breaks after the last space that fits, or inside a word longer than the
+ * line; spaces at a break are skipped. At least one character is taken,
+ * even if it is wider than max_width. Nothing is copied: call again on
+ * str + line->next for the following line.
+ * @param str UTF-8 bytes (need not be NUL-terminated)
+ * @param len Number of bytes
+ * @param max_width Line width in columns
+ * @param line Output: the line
+ */
+void md_wrap_line(const char* str, size_t len, int max_width, md_wrap_line_t* line);
+
 /**
  * Duplicate a string
  * @param str Source string
@@ -93,6 +136,17 @@ int md_count_indent(const char* str);
  */
 int md_buffer_append(char** buf, size_t* buf_size, size_t* buf_len, const char* str);
 
+/**
+ * Append len bytes to a dynamic buffer (str need not be NUL-terminated)
+ * @param buf Pointer to buffer pointer
+ * @param buf_size Pointer to buffer size
+ * @param buf_len Pointer to current content length
+ * @param str Bytes to append
+ * @param len Number of bytes
+ * @return 0 on success, -1 on failure
+ */
+int md_buffer_append_n(char** buf, size_t* buf_size, size_t* buf_len, const char* str, size_t len);
+
 /**
  * Append character to a dynamic buffer
  * @param buf Pointer to buffer pointer
@@ -18,6 +18,12 @@
 struct ac_rules {
     ac_rule_t *head;
     size_t count;
+    uint64_t version;                  /* See ac_rules_version() */
+
+    /* ac_rules_prompt() text; a cache, so filled in through const */
+    char *prompt;
+    size_t prompt_len;
+    uint64_t prompt_version;           /* version + 1 it was built at, 0 = never */
 };
 
 /*============================================================================
@@ -176,57 +182,86 @@ arc_err_t ac_rules_add(
     }
 
     rules->count++;
+    rules->version++;
     AC_LOG_DEBUG("Added rule: %s (priority=%d)", name, priority);
 
     return ARC_OK;
 }
 
-char *ac_rules_build_prompt(ac_rules_t *rules, const char *base_prompt) {
-    if (!rules) {
-        return base_prompt ? strdup(base_prompt) : NULL;
-    }
-
-    /* Calculate total size */
-    size_t total_size = base_prompt ? strlen(base_prompt) : 0;
-    ac_rule_t *rule = rules->head;
-    while (rule) {
+/**
+ * @brief Concatenate all rules, "\n" + content + "\n" each
+ */
+static char *build_rules_text(const ac_rules_t *rules, size_t *out_len) {
+    size_t total_size = 0;
+    for (const ac_rule_t *rule = rules->head; rule; rule = rule->next) {
         total_size += strlen(rule->content) + 2;  /* +2 for newlines */
-        rule = rule->next;
     }
-
     if (total_size == 0) {
         return NULL;
     }
 
-    /* Allocate buffer */
-    char *prompt = malloc(total_size + 1);
-    if (!prompt) {
+    char *text = malloc(total_size + 1);
+    if (!text) {
         AC_LOG_ERROR("Failed to allocate prompt buffer");
         return NULL;
     }
 
-    /* Build prompt */
-    char *ptr = prompt;
-    if (base_prompt) {
-        size_t len = strlen(base_prompt);
-        memcpy(ptr, base_prompt, len);
-        ptr += len;
-    }
-
-    rule = rules->head;
-    while (rule) {
+    char *ptr = text;
+    for (const ac_rule_t *rule = rules->head; rule; rule = rule->next) {
         *ptr++ = '\n';
         size_t len = strlen(rule->content);
         memcpy(ptr, rule->content, len);
         ptr += len;
         *ptr++ = '\n';
-        rule = rule->next;
     }
     *ptr = '\0';
 
-    AC_LOG_DEBUG("Built system prompt with %zu rules (%zu bytes)",
+    AC_LOG_DEBUG("Built rules prompt with %zu rules (%zu bytes)",
                  rules->count, total_size);
+    *out_len = total_size;
+    return text;
+}
+
+const char *ac_rules_prompt(const ac_rules_t *rules) {
+    if (!rules) {
+        return NULL;
+    }
+    if (rules->prompt_version != rules->version + 1) {
+        /* The cache is not part of the manager's observable state */
+        ac_rules_t *r = (ac_rules_t *)rules;
+        free(r->prompt);
+        r->prompt_len = 0;
+        r->prompt = build_rules_text(rules, &r->prompt_len);
+        r->prompt_version = rules->version + 1;
+    }
+    return rules->prompt;
+}
+
+uint64_t ac_rules_version(const ac_rules_t *rules) {
+    return rules ? rules->version : 0;
+}
 
+char *ac_rules_build_prompt(ac_rules_t *rules, const char *base_prompt) {
+    const char *text = ac_rules_prompt(rules);
+    size_t text_len = text ? rules->prompt_len : 0;
+    size_t base_len = base_prompt ? strlen(base_prompt) : 0;
+
+    if (!rules) {
+        return base_prompt ? strdup(base_prompt) : NULL;
+    }
+    if (!text) {
+        return base_len > 0 ? strdup(base_prompt) : NULL;
+    }
+
+    char *prompt = malloc(base_len + text_len + 1);
+    if (!prompt) {
+        AC_LOG_ERROR("Failed to allocate prompt buffer");
+        return NULL;
+    }
+    if (base_len > 0) {
+        memcpy(prompt, base_prompt, base_len);
+    }
+    memcpy(prompt + base_len, text, text_len + 1);
     return prompt;
 }
 
@@ -254,6 +289,7 @@ void ac_rules_clear(ac_rules_t *rules) {
 
     rules->head = NULL;
     rules->count = 0;
+    rules->version++;
 }
 
 void ac_rules_destroy(ac_rules_t *rules) {
@@ -262,6 +298,7 @@ void ac_rules_destroy(ac_rules_t *rules) {
     }
 
     ac_rules_clear(rules);
+    free(rules->prompt);
     free(rules);
 
     AC_LOG_DEBUG("Destroyed rules manager");
@@ -0,0 +1,248 @@
+/**
+ * @file sandbox_admit.c
+ * @brief Admission queue for ac_sandbox_config_t.max_concurrent_execs
+ *
+ * Every approved command takes a slot before it starts and returns it
+ * when it is done. Callers that find no slot wait in arrival order; a
+ * freed slot goes to the waiter whose owner has the fewest commands
+ * running, skipping owners at max_execs_per_owner:
+ *
+ *   running: A A A B    waiting: A1 A2 C1 B1    freed slot -> C1
+ *
+ * so an agent firing a dozen commands at once cannot starve one running
+ * a single command, while an idle host still runs everything at once.
+ *
+ * Waiters sleep on their own condition variable; only the one granted a
+ * slot is woken.
+ */
+
+#include "sandbox_internal.h"
+#include <arc/metrics.h>
+#include <arc/platform.h>
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+
+#include <pthread.h>
+
+typedef struct {
+    const void *owner;
+    int running;
+    int waiting;
+} admit_owner_t;
+
+typedef struct admit_waiter {
+    struct admit_waiter *next;
+    admit_owner_t *owner;            /* Stays valid while waiting > 0 */
+    pthread_cond_t cond;
+    int granted;
+} admit_waiter_t;
+
+struct ac_sandbox_admit {
+    pthread_mutex_t lock;
+    int max_concurrent;
+    int max_per_owner;               /* 0 = no limit */
+    int running;
+
+    admit_waiter_t *head;            /* Arrival order */
+    admit_waiter_t *tail;
+
+    admit_owner_t *owners;           /* Owners running or waiting */
+    size_t owner_count;
+    size_t owner_cap;
+};
+
+static ac_metric_t *g_wait_metric;
+static ac_metric_t *g_running_metric;
+static ac_metric_t *g_queued_metric;
+
+/**
+ * @brief Find or add the record of an owner
+ * @return NULL when out of memory
+ */
+static admit_owner_t *owner_get(struct ac_sandbox_admit *admit, const void *owner) {
+    for (size_t i = 0; i < admit->owner_count; i++) {
+        if (admit->owners[i].owner == owner) {
+            return &admit->owners[i];
+        }
+    }
+    if (admit->owner_count == admit->owner_cap) {
+        size_t cap = admit->owner_cap ? admit->owner_cap * 2 : 8;
+        admit_owner_t *owners = realloc(admit->owners, cap * sizeof(*owners));
+        if (!owners) {
+            return NULL;
+        }
+        /* Records moved; re-point the waiters */
+        for (admit_waiter_t *w = admit->head; w; w = w->next) {
+            w->owner = owners + (w->owner - admit->owners);
+        }
+        admit->owners = owners;
+        admit->owner_cap = cap;
+    }
+    admit_owner_t *o = &admit->owners[admit->owner_count++];
+    *o = (admit_owner_t){ owner, 0, 0 };
+    return o;
+}
+
+/** Drop an owner with nothing running or waiting */
+static void owner_put(struct ac_sandbox_admit *admit, admit_owner_t *o) {
+    if (o->running > 0 || o->waiting > 0) {
+        return;
+    }
+    admit_owner_t *last = &admit->owners[--admit->owner_count];
+    if (o != last) {
+        for (admit_waiter_t *w = admit->head; w; w = w->next) {
+            if (w->owner == last) {
+                w->owner = o;
+            }
+        }
+        *o = *last;
+    }
+}
+
+/** Hand free slots to waiters, fewest running owner first */
+static void admit_dispatch(struct ac_sandbox_admit *admit) {
+    while (admit->running < admit->max_concurrent) {
+        admit_waiter_t *best = NULL;
+        admit_waiter_t *best_prev = NULL;
+        admit_waiter_t *prev = NULL;
+        for (admit_waiter_t *w = admit->head; w; prev = w, w = w->next) {
+            if (admit->max_per_owner > 0 && w->owner->running >= admit->max_per_owner) {
+                continue;
+            }
+            if (!best || w->owner->running < best->owner->running) {
+                best = w;
+                best_prev = prev;
+            }
+        }
+        if (!best) {
+            return;
+        }
+
+        if (best_prev) {
+            best_prev->next = best->next;
+        } else {
+            admit->head = best->next;
+        }
+        if (admit->tail == best) {
+            admit->tail = best_prev;
+        }
+        best->owner->waiting--;
+        best->owner->running++;
+        admit->running++;
+        best->granted = 1;
+        pthread_cond_signal(&best->cond);
+    }
+}
+
+struct ac_sandbox_admit *ac_sandbox_admit_create(int max_concurrent, int max_per_owner) {
+    if (max_concurrent <= 0) {
+        return NULL;
+    }
+    struct ac_sandbox_admit *admit = calloc(1, sizeof(*admit));
+    if (!admit) {
+        return NULL;
+    }
+    pthread_mutex_init(&admit->lock, NULL);
+    admit->max_concurrent = max_concurrent;
+    admit->max_per_owner = max_per_owner > 0 ? max_per_owner : 0;
+
+    g_wait_metric = ac_metrics_histogram("arc_sandbox_admit_wait_seconds", NULL,
+                                         "Time sandboxed commands waited for a slot", 1e-6);
+    g_running_metric = ac_metrics_gauge("arc_sandbox_admit_running", NULL,
+                                        "Sandboxed commands holding a slot");
+    g_queued_metric = ac_metrics_gauge("arc_sandbox_admit_queued", NULL,
+                                       "Sandboxed commands waiting for a slot");
+    return admit;
+}
+
+void ac_sandbox_admit_acquire(struct ac_sandbox_admit *admit, const void *owner) {
+    if (!admit) {
+        return;
+    }
+    uint64_t started = ac_platform_monotonic_us();
+
+    pthread_mutex_lock(&admit->lock);
+    admit_owner_t *o = owner_get(admit, owner);
+    if (!o) {
+        /* No memory to queue fairly; run rather than fail the command */
+        admit->running++;
+        pthread_mutex_unlock(&admit->lock);
+        ac_metric_add(g_running_metric, 1);
+        return;
+    }
+
+    admit_waiter_t self = { NULL, o, PTHREAD_COND_INITIALIZER, 0 };
+    o->waiting++;
+    if (admit->tail) {
+        admit->tail->next = &self;
+    } else {
+        admit->head = &self;
+    }
+    admit->tail = &self;
+
+    admit_dispatch(admit);
+    if (!self.granted) {
+        ac_metric_add(g_queued_metric, 1);
+        while (!self.granted) {
+            pthread_cond_wait(&self.cond, &admit->lock);
+        }
+        ac_metric_add(g_queued_metric, -1);
+    }
+    pthread_mutex_unlock(&admit->lock);
+    pthread_cond_destroy(&self.cond);
+
+    ac_metric_add(g_running_metric, 1);
+    ac_metric_observe(g_wait_metric, ac_platform_monotonic_us() - started);
+}
+
+void ac_sandbox_admit_release(struct ac_sandbox_admit *admit, const void *owner) {
+    if (!admit) {
+        return;
+    }
+    pthread_mutex_lock(&admit->lock);
+    admit->running--;
+    for (size_t i = 0; i < admit->owner_count; i++) {
+        if (admit->owners[i].owner == owner) {
+            admit->owners[i].running--;
+            owner_put(admit, &admit->owners[i]);
+            break;
+        }
+    }
+    admit_dispatch(admit);
+    pthread_mutex_unlock(&admit->lock);
+    ac_metric_add(g_running_metric, -1);
+}
+
+void ac_sandbox_admit_free(struct ac_sandbox_admit *admit) {
+    if (!admit) {
+        return;
+    }
+    pthread_mutex_destroy(&admit->lock);
+    free(admit->owners);
+    free(admit);
+}
+
+#else /* _WIN32 */
+
+struct ac_sandbox_admit *ac_sandbox_admit_create(int max_concurrent, int max_per_owner) {
+    (void)max_concurrent;
+    (void)max_per_owner;
+    return NULL;
+}
+
+void ac_sandbox_admit_acquire(struct ac_sandbox_admit *admit, const void *owner) {
+    (void)admit;
+    (void)owner;
+}
+
+void ac_sandbox_admit_release(struct ac_sandbox_admit *admit, const void *owner) {
+    (void)admit;
+    (void)owner;
+}
+
+void ac_sandbox_admit_free(struct ac_sandbox_admit *admit) {
+    (void)admit;
+}
+
+#endif /* !_WIN32 */
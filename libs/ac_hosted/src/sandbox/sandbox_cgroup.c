@@ -0,0 +1,264 @@
+/**
+ * @file sandbox_cgroup.c
+ * @brief Per-command cgroup v2 limits and accounting (Linux)
+ *
+ * Each command gets a cgroup below ac_sandbox_config_t.cgroup_parent:
+ *
+ *   <parent>/arc-<pid>-<n>   cpu.max, memory.max, pids.max as configured
+ *
+ * The runner passes the group's cgroup.procs to the shell, which moves
+ * itself in before it runs the command (see exec_spawn()), so nothing the
+ * command starts is ever outside it. Once the command has been reaped the
+ * counters are read and the group is emptied and removed.
+ */
+
+#include "sandbox_internal.h"
+#include <arc/log.h>
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* cpu.max period (the kernel default) */
+#define CGROUP_CPU_PERIOD_US 100000
+
+/* How long a killed cgroup may take to empty before it is left behind */
+#define CGROUP_EMPTY_WAIT_MS 200
+
+static atomic_uint g_cgroup_seq;
+
+/*============================================================================
+ * Control Files
+ *============================================================================*/
+
+static int cg_write(const char *dir, const char *file, const char *value) {
+    char path[640];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    size_t len = strlen(value);
+    ssize_t n = write(fd, value, len);
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return n == (ssize_t)len ? 0 : -1;
+}
+
+/**
+ * @brief Read a small control file
+ * @return Bytes read, or -1
+ */
+static ssize_t cg_read(const char *dir, const char *file, char *buf, size_t size) {
+    char path[640];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+/** Value of "key N" in a flat-keyed file such as cpu.stat */
+static int cg_key(const char *text, const char *key, uint64_t *value) {
+    size_t len = strlen(key);
+    for (const char *p = text; p && *p; p = strchr(p, '\n'), p = p ? p + 1 : NULL) {
+        if (strncmp(p, key, len) == 0 && p[len] == ' ') {
+            *value = strtoull(p + len + 1, NULL, 10);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Sum of "key=N" over the devices of io.stat */
+static uint64_t cg_io_sum(const char *text, const char *key) {
+    uint64_t sum = 0;
+    size_t len = strlen(key);
+    for (const char *p = strstr(text, key); p; p = strstr(p + len, key)) {
+        if ((p == text || p[-1] == ' ') && p[len] == '=') {
+            sum += strtoull(p + len + 1, NULL, 10);
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief Make the controllers the limits need available to child groups
+ *
+ * Each is asked for separately: one that is not delegated must not keep
+ * the others from being enabled.
+ */
+static void cg_enable_controllers(const char *parent) {
+    static const char *const controllers[] = { "+cpu", "+memory", "+pids", "+io" };
+    for (size_t i = 0; i < sizeof(controllers) / sizeof(controllers[0]); i++) {
+        cg_write(parent, "cgroup.subtree_control", controllers[i]);
+    }
+}
+
+static int cg_limit(const ac_sandbox_limits_t *limits, const ac_sandbox_cgroup_t *cg,
+                    const char *file, const char *value) {
+    if (cg_write(cg->path, file, value) == 0) {
+        return 0;
+    }
+    if (errno == ENOENT) {
+        /* Controller not enabled below the parent yet */
+        cg_enable_controllers(limits->parent);
+        if (cg_write(cg->path, file, value) == 0) {
+            return 0;
+        }
+    }
+    AC_LOG_ERROR("Sandbox: cannot set %s in %s: %s", file, cg->path, strerror(errno));
+    return -1;
+}
+
+/*============================================================================
+ * Internal API
+ *============================================================================*/
+
+int ac_sandbox_cgroup_create(const ac_sandbox_limits_t *limits, ac_sandbox_cgroup_t *cg) {
+    cg->path[0] = '\0';
+    cg->procs_fd = -1;
+    if (!limits || !limits->parent) {
+        return 0;
+    }
+
+    int n = snprintf(cg->path, sizeof(cg->path), "%s/arc-%d-%u", limits->parent,
+                     (int)getpid(), atomic_fetch_add(&g_cgroup_seq, 1));
+    if (n < 0 || (size_t)n >= sizeof(cg->path)) {
+        AC_LOG_ERROR("Sandbox: cgroup path too long: %s", limits->parent);
+        cg->path[0] = '\0';
+        return -1;
+    }
+    if (mkdir(cg->path, 0755) < 0) {
+        AC_LOG_ERROR("Sandbox: cannot create cgroup %s: %s", cg->path, strerror(errno));
+        cg->path[0] = '\0';
+        return -1;
+    }
+
+    char value[64];
+    int rc = 0;
+    if (limits->cpu_max_percent > 0) {
+        snprintf(value, sizeof(value), "%lld %d",
+                 (long long)limits->cpu_max_percent * CGROUP_CPU_PERIOD_US / 100,
+                 CGROUP_CPU_PERIOD_US);
+        rc |= cg_limit(limits, cg, "cpu.max", value);
+    }
+    if (rc == 0 && limits->memory_max > 0) {
+        snprintf(value, sizeof(value), "%zu", limits->memory_max);
+        rc |= cg_limit(limits, cg, "memory.max", value);
+    }
+    if (rc == 0 && limits->pids_max > 0) {
+        snprintf(value, sizeof(value), "%d", limits->pids_max);
+        rc |= cg_limit(limits, cg, "pids.max", value);
+    }
+    if (rc != 0) {
+        ac_sandbox_cgroup_destroy(cg);
+        return -1;
+    }
+
+    char procs[640];
+    snprintf(procs, sizeof(procs), "%s/cgroup.procs", cg->path);
+    cg->procs_fd = open(procs, O_WRONLY | O_CLOEXEC);
+    if (cg->procs_fd < 0) {
+        AC_LOG_ERROR("Sandbox: cannot open %s: %s", procs, strerror(errno));
+        ac_sandbox_cgroup_destroy(cg);
+        return -1;
+    }
+    return 0;
+}
+
+void ac_sandbox_cgroup_usage(const ac_sandbox_cgroup_t *cg, ac_sandbox_usage_t *usage) {
+    if (!cg->path[0]) {
+        return;
+    }
+
+    char buf[4096];
+    uint64_t value;
+    if (cg_read(cg->path, "cpu.stat", buf, sizeof(buf)) > 0 &&
+        cg_key(buf, "usage_usec", &value)) {
+        usage->cpu_usec = value;
+        usage->from_cgroup = 1;
+    }
+    /* memory.peak needs 5.19; older kernels keep the rusage figure */
+    if (cg_read(cg->path, "memory.peak", buf, sizeof(buf)) > 0) {
+        usage->memory_peak = strtoull(buf, NULL, 10);
+    }
+    if (cg_read(cg->path, "io.stat", buf, sizeof(buf)) >= 0) {
+        usage->io_read_bytes = cg_io_sum(buf, "rbytes");
+        usage->io_write_bytes = cg_io_sum(buf, "wbytes");
+    }
+}
+
+void ac_sandbox_cgroup_destroy(ac_sandbox_cgroup_t *cg) {
+    if (cg->procs_fd >= 0) {
+        close(cg->procs_fd);
+        cg->procs_fd = -1;
+    }
+    if (!cg->path[0]) {
+        return;
+    }
+
+    /* Background jobs the command left; cgroup.kill needs 5.14 */
+    char buf[4096];
+    if (cg_write(cg->path, "cgroup.kill", "1") < 0 &&
+        cg_read(cg->path, "cgroup.procs", buf, sizeof(buf)) > 0) {
+        for (char *p = buf; *p; ) {
+            char *end;
+            long pid = strtol(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+            if (pid > 0) {
+                kill((pid_t)pid, SIGKILL);
+            }
+            p = end;
+        }
+    }
+
+    for (int waited = 0; rmdir(cg->path) < 0; waited++) {
+        if (errno != EBUSY || waited >= CGROUP_EMPTY_WAIT_MS) {
+            AC_LOG_WARN("Sandbox: cannot remove cgroup %s: %s", cg->path, strerror(errno));
+            break;
+        }
+        struct timespec ts = { 0, 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    cg->path[0] = '\0';
+}
+
+#else /* !__linux__ */
+
+int ac_sandbox_cgroup_create(const ac_sandbox_limits_t *limits, ac_sandbox_cgroup_t *cg) {
+    (void)limits;
+    cg->path[0] = '\0';
+    cg->procs_fd = -1;
+    return 0;
+}
+
+void ac_sandbox_cgroup_usage(const ac_sandbox_cgroup_t *cg, ac_sandbox_usage_t *usage) {
+    (void)cg;
+    (void)usage;
+}
+
+void ac_sandbox_cgroup_destroy(ac_sandbox_cgroup_t *cg) {
+    (void)cg;
+}
+
+#endif /* __linux__ */
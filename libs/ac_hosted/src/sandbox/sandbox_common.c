@@ -7,12 +7,42 @@
 
 #include <arc/sandbox.h>
 #include <arc/log.h>
+#include <arc/metrics.h>
+#include <arc/platform.h>
+#include <arc/tool.h>
 #include "sandbox_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+/* Longest poll wait, so the child's exit is seen while others hold the pipes */
+#define SANDBOX_POLL_MS 100
+
+/* Exit check interval once the command has closed its output: starts
+ * small, since the exit usually follows at once, and doubles up to the cap */
+#define SANDBOX_REAP_FIRST_US 50
+#define SANDBOX_REAP_MS 5
+
+/* How long output is still read once the shell has exited */
+#define SANDBOX_DRAIN_MS 200
+
+/* Reads per pipe before the deadline is checked again */
+#define SANDBOX_READS_PER_WAKE 16
+
 /*============================================================================
  * Thread-Local Error Storage
  *============================================================================*/
@@ -276,24 +306,38 @@ static const char *g_safe_overrides[] = {
     NULL
 };
 
-int ac_sandbox_is_command_dangerous(const char *command) {
-    if (!command) {
-        return 0;
+static int matcher_add_all(ac_sandbox_matcher_t *m, const char *const *patterns, int safe) {
+    for (int i = 0; patterns && patterns[i] != NULL; i++) {
+        if (ac_sandbox_matcher_add(m, patterns[i], safe) < 0) {
+            return -1;
+        }
     }
+    return 0;
+}
 
-    /* Check safe overrides first */
-    for (int i = 0; g_safe_overrides[i] != NULL; i++) {
-        if (strstr(command, g_safe_overrides[i]) != NULL) {
-            return 0;
-        }
+ac_sandbox_matcher_t *ac_sandbox_command_matcher_create(const ac_sandbox_config_t *config) {
+    ac_sandbox_matcher_t *m = ac_sandbox_matcher_new();
+    if (!m ||
+        matcher_add_all(m, g_dangerous_patterns, 0) < 0 ||
+        matcher_add_all(m, g_safe_overrides, 1) < 0 ||
+        matcher_add_all(m, config->dangerous_patterns, 0) < 0 ||
+        matcher_add_all(m, config->safe_patterns, 1) < 0 ||
+        ac_sandbox_matcher_build(m) < 0) {
+        ac_sandbox_matcher_free(m);
+        return NULL;
     }
+    return m;
+}
 
-    /* Check dangerous patterns */
-    for (int i = 0; g_dangerous_patterns[i] != NULL; i++) {
-        if (strstr(command, g_dangerous_patterns[i]) != NULL) {
-            AC_LOG_WARN("Dangerous command pattern detected: %s", g_dangerous_patterns[i]);
-            return 1;
-        }
+int ac_sandbox_is_command_dangerous(const ac_sandbox_t *sandbox, const char *command) {
+    if (!sandbox || !command) {
+        return 0;
+    }
+
+    const char *pattern = ac_sandbox_matcher_find(sandbox->command_matcher, command);
+    if (pattern) {
+        AC_LOG_WARN("Dangerous command pattern detected: %s", pattern);
+        return 1;
     }
 
     return 0;
@@ -442,6 +486,403 @@ const char *ac_sandbox_confirm_type_str(ac_sandbox_confirm_type_t type) {
     }
 }
 
+/*============================================================================
+ * Execution
+ *============================================================================*/
+
+arc_err_t ac_sandbox_exec_timeout(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    char *output,
+    size_t output_size,
+    int *exit_code,
+    int timeout_ms
+) {
+    ac_sandbox_exec_opts_t opts = {
+        .timeout_ms = timeout_ms,
+        .output = output,
+        .output_size = output_size,
+    };
+    return ac_sandbox_exec_ex(sandbox, command, &opts, exit_code);
+}
+
+arc_err_t ac_sandbox_exec_ex(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
+) {
+    static const ac_sandbox_exec_opts_t no_opts = {0};
+    if (!opts) {
+        opts = &no_opts;
+    }
+
+    /* Usage is always collected, so the running tool can be charged for it */
+    ac_sandbox_usage_t usage;
+    ac_sandbox_exec_opts_t with_usage;
+    if (!opts->usage) {
+        with_usage = *opts;
+        with_usage.usage = &usage;
+        opts = &with_usage;
+    }
+    memset(opts->usage, 0, sizeof(*opts->usage));
+
+    uint64_t started = ac_platform_timestamp_ms();
+    arc_err_t err = ac_sandbox_exec_platform(sandbox, command, opts, exit_code);
+
+    if (err == ARC_OK || err == ARC_ERR_TIMEOUT || err == ARC_ERR_CANCELLED) {
+        ac_tool_report_usage(&(ac_tool_usage_t){
+            .processes = 1,
+            .cpu_usec = opts->usage->cpu_usec,
+            .memory_peak = opts->usage->memory_peak,
+            .io_read_bytes = opts->usage->io_read_bytes,
+            .io_write_bytes = opts->usage->io_write_bytes,
+        });
+    }
+
+    /* The command may have moved directories the path cache resolved */
+    if (sandbox) {
+        ac_sandbox_paths_invalidate(sandbox->paths);
+    }
+
+    ac_metric_add(ac_metrics_counter("arc_sandbox_execs", NULL, "Sandboxed command runs"), 1);
+    if (err != ARC_OK) {
+        ac_metric_add(ac_metrics_counter("arc_sandbox_exec_errors", NULL,
+                                         "Sandboxed runs that failed or timed out"), 1);
+    }
+    ac_metric_observe(ac_metrics_histogram("arc_sandbox_exec_duration_seconds", NULL,
+                                           "Sandboxed command run time", 1e-6),
+                      (ac_platform_timestamp_ms() - started) * 1000);
+    return err;
+}
+
+#if !defined(_WIN32)
+
+/*============================================================================
+ * POSIX Process Runner
+ *============================================================================*/
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} exec_capture_t;
+
+typedef struct {
+    exec_capture_t *capture;
+    ac_sandbox_stream_t stream;
+} exec_pipe_t;
+
+static void capture_append(exec_capture_t *capture, const char *data, size_t len) {
+    if (!capture->buf || capture->size == 0) {
+        return;
+    }
+    size_t room = capture->size - 1 - capture->len;
+    if (len > room) {
+        len = room;
+    }
+    memcpy(capture->buf + capture->len, data, len);
+    capture->len += len;
+    capture->buf[capture->len] = '\0';
+}
+
+/**
+ * @brief Pipe whose ends are not inherited by other children; the read end does not block
+ */
+static int exec_pipe_open(int fds[2]) {
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+/**
+ * @brief Read what a pipe has, a bounded amount at a time
+ * @return 1 while the pipe is open, 0 at EOF or on error
+ */
+static int exec_pipe_read(int fd, const exec_pipe_t *p, const ac_sandbox_exec_opts_t *opts) {
+    char buf[4096];
+    for (int i = 0; i < SANDBOX_READS_PER_WAKE; i++) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            capture_append(p->capture, buf, (size_t)n);
+            if (opts->on_output) {
+                opts->on_output(p->stream, buf, (size_t)n, opts->user_data);
+            }
+        } else if (n == 0) {
+            return 0;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Start /bin/sh -c command in its own process group
+ *
+ * posix_spawn rather than fork: glibc clones with CLONE_VM|CLONE_VFORK and
+ * macOS spawns natively, so the parent's page tables are never copied and
+ * launch time does not grow with its RSS (arenas, curl and TLS state).
+ * Signal dispositions and the mask are reset, so a parent ignoring SIGPIPE
+ * does not pass that on to the command.
+ *
+ * With a cgroup, its cgroup.procs is handed over as fd 3 and the shell
+ * writes its own pid there before it runs the command. The shell cannot
+ * be placed from outside without a window in which the command already
+ * runs unlimited; if joining fails it exits with 125 instead.
+ *
+ * @return 0 on success, else an errno value
+ */
+static int exec_spawn(const char *command, int procs_fd, int out_fd, int err_fd, pid_t *pid) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    int rc = posix_spawn_file_actions_init(&actions);
+    if (rc != 0) {
+        return rc;
+    }
+    rc = posix_spawnattr_init(&attr);
+    if (rc != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return rc;
+    }
+
+    sigset_t all;
+    sigset_t none;
+    sigfillset(&all);
+    sigemptyset(&none);
+
+    /* The pipe ends are close-on-exec; dup2 clears that on stdout/stderr */
+    if (rc == 0) rc = posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    if (rc == 0) rc = posix_spawn_file_actions_adddup2(&actions, err_fd, STDERR_FILENO);
+    if (rc == 0 && procs_fd >= 0) rc = posix_spawn_file_actions_adddup2(&actions, procs_fd, 3);
+
+    /* Own process group, so a timeout reaches everything the command starts */
+    if (rc == 0) rc = posix_spawnattr_setpgroup(&attr, 0);
+    if (rc == 0) rc = posix_spawnattr_setsigdefault(&attr, &all);
+    if (rc == 0) rc = posix_spawnattr_setsigmask(&attr, &none);
+    if (rc == 0) {
+        rc = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF |
+                                             POSIX_SPAWN_SETSIGMASK);
+    }
+    if (rc == 0 && procs_fd >= 0) {
+        char *const argv[] = {
+            "sh", "-c", "echo $$ >&3 || exit 125; exec /bin/sh -c \"$1\" 3>&-",
+            "sh", (char *)command, NULL
+        };
+        rc = posix_spawn(pid, "/bin/sh", &actions, &attr, argv, environ);
+    } else if (rc == 0) {
+        char *const argv[] = { "sh", "-c", (char *)command, NULL };
+        rc = posix_spawn(pid, "/bin/sh", &actions, &attr, argv, environ);
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return rc;
+}
+
+static int wait_until(uint64_t now, uint64_t at, int wait_ms) {
+    if (at > now && at - now < (uint64_t)wait_ms) {
+        return (int)(at - now);
+    }
+    return at > now ? wait_ms : 0;
+}
+
+/** Resource use of the reaped shell and its waited-for descendants */
+static void usage_from_rusage(const struct rusage *ru, ac_sandbox_usage_t *usage) {
+    usage->cpu_usec = (uint64_t)ru->ru_utime.tv_sec * 1000000u + (uint64_t)ru->ru_utime.tv_usec +
+                      (uint64_t)ru->ru_stime.tv_sec * 1000000u + (uint64_t)ru->ru_stime.tv_usec;
+#if defined(__APPLE__)
+    usage->memory_peak = (uint64_t)ru->ru_maxrss;           /* bytes */
+#else
+    usage->memory_peak = (uint64_t)ru->ru_maxrss * 1024u;   /* KiB */
+#endif
+    usage->io_read_bytes = (uint64_t)ru->ru_inblock * 512u;
+    usage->io_write_bytes = (uint64_t)ru->ru_oublock * 512u;
+}
+
+arc_err_t ac_sandbox_run_posix(
+    const ac_sandbox_limits_t *limits,
+    const char *command,
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
+) {
+    if (opts->usage) {
+        memset(opts->usage, 0, sizeof(*opts->usage));
+    }
+
+    exec_capture_t out = { opts->output, opts->output_size, 0 };
+    exec_capture_t err = { opts->error_output, opts->error_output_size, 0 };
+    if (out.buf && out.size > 0) {
+        out.buf[0] = '\0';
+    }
+    if (err.buf && err.size > 0) {
+        err.buf[0] = '\0';
+    }
+
+    /* Limits that cannot be applied fail the run rather than being dropped */
+    ac_sandbox_cgroup_t cgroup;
+    if (ac_sandbox_cgroup_create(limits, &cgroup) < 0) {
+        return ARC_ERR_IO;
+    }
+
+    int out_fds[2];
+    int err_fds[2];
+    if (exec_pipe_open(out_fds) < 0) {
+        AC_LOG_ERROR("Failed to create pipe: %s", strerror(errno));
+        ac_sandbox_cgroup_destroy(&cgroup);
+        return ARC_ERR_IO;
+    }
+    if (exec_pipe_open(err_fds) < 0) {
+        AC_LOG_ERROR("Failed to create pipe: %s", strerror(errno));
+        close(out_fds[0]);
+        close(out_fds[1]);
+        ac_sandbox_cgroup_destroy(&cgroup);
+        return ARC_ERR_IO;
+    }
+
+    pid_t pid;
+    int spawn_err = exec_spawn(command, cgroup.procs_fd, out_fds[1], err_fds[1], &pid);
+    close(out_fds[1]);
+    close(err_fds[1]);
+    if (spawn_err != 0) {
+        AC_LOG_ERROR("Failed to start /bin/sh: %s", strerror(spawn_err));
+        close(out_fds[0]);
+        close(err_fds[0]);
+        ac_sandbox_cgroup_destroy(&cgroup);
+        return ARC_ERR_IO;
+    }
+
+    struct pollfd fds[2] = {
+        { out_fds[0], POLLIN, 0 },
+        { err_fds[0], POLLIN, 0 },
+    };
+    const exec_pipe_t pipes[2] = {
+        { &out, AC_SANDBOX_STDOUT },
+        { opts->error_output ? &err : &out, AC_SANDBOX_STDERR },
+    };
+    int open_count = 2;
+
+    int grace_ms = opts->kill_grace_ms > 0 ? opts->kill_grace_ms : AC_SANDBOX_KILL_GRACE_MS;
+    uint64_t now = ac_platform_timestamp_ms();
+    uint64_t deadline = opts->timeout_ms > 0 ? now + (uint64_t)opts->timeout_ms : 0;
+    uint64_t kill_at = 0;           /* SIGKILL due, once SIGTERM was sent */
+    uint64_t drain_until = 0;       /* Set when the shell exits */
+    int status = 0;
+    int status_known = 0;
+    int exited = 0;
+    int timed_out = 0;
+    int stopped = 0;
+    long reap_us = 0;
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
+
+    for (;;) {
+        if (!exited) {
+            pid_t r = wait4(pid, &status, WNOHANG, &ru);
+            if (r == pid) {
+                exited = 1;
+                status_known = 1;
+            } else if (r < 0 && errno != EINTR) {
+                /* ECHILD: reaped elsewhere (SIGCHLD ignored); status is lost */
+                exited = 1;
+            }
+            if (exited) {
+                drain_until = now + SANDBOX_DRAIN_MS;
+            }
+        }
+
+        /* Background jobs may keep the pipes open; do not wait for them */
+        if (exited && (open_count == 0 || now >= drain_until)) {
+            break;
+        }
+
+        if (!exited && deadline && !timed_out && !stopped && now >= deadline) {
+            AC_LOG_WARN("Sandbox: command timed out after %d ms, terminating", opts->timeout_ms);
+            timed_out = 1;
+            kill(-pid, SIGTERM);
+            kill_at = now + (uint64_t)grace_ms;
+        }
+        if (!exited && opts->stop && *opts->stop && !timed_out && !stopped) {
+            AC_LOG_DEBUG("Sandbox: command stopped by caller, terminating");
+            stopped = 1;
+            kill(-pid, SIGTERM);
+            kill_at = now + (uint64_t)grace_ms;
+        }
+        if (!exited && kill_at && now >= kill_at) {
+            kill(-pid, SIGKILL);
+            kill_at = 0;
+        }
+
+        int wait_ms = SANDBOX_POLL_MS;
+        if (exited) {
+            wait_ms = wait_until(now, drain_until, wait_ms);
+        } else if (kill_at) {
+            wait_ms = wait_until(now, kill_at, wait_ms);
+        } else if (deadline && !timed_out && !stopped) {
+            wait_ms = wait_until(now, deadline, wait_ms);
+        }
+
+        if (open_count > 0) {
+            if (poll(fds, 2, wait_ms) > 0) {
+                for (int i = 0; i < 2; i++) {
+                    if (fds[i].fd >= 0 && fds[i].revents &&
+                        !exec_pipe_read(fds[i].fd, &pipes[i], opts)) {
+                        close(fds[i].fd);
+                        fds[i].fd = -1;
+                        open_count--;
+                    }
+                }
+            }
+        } else if (wait_ms > 0) {
+            /* Output closed; usually the exit is a moment away */
+            reap_us = reap_us ? reap_us * 2 : SANDBOX_REAP_FIRST_US;
+            if (reap_us > SANDBOX_REAP_MS * 1000L) {
+                reap_us = SANDBOX_REAP_MS * 1000L;
+            }
+            long sleep_us = reap_us < wait_ms * 1000L ? reap_us : wait_ms * 1000L;
+            struct timespec ts = { 0, sleep_us * 1000L };
+            nanosleep(&ts, NULL);
+        }
+        now = ac_platform_timestamp_ms();
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (fds[i].fd >= 0) {
+            close(fds[i].fd);
+        }
+    }
+
+    if (opts->usage) {
+        usage_from_rusage(&ru, opts->usage);
+        ac_sandbox_cgroup_usage(&cgroup, opts->usage);
+    }
+    ac_sandbox_cgroup_destroy(&cgroup);
+
+    if (timed_out || stopped) {
+        if (exit_code) *exit_code = -1;
+        return timed_out ? ARC_ERR_TIMEOUT : ARC_ERR_CANCELLED;
+    }
+
+    if (exit_code) {
+        if (status_known && WIFEXITED(status)) {
+            *exit_code = WEXITSTATUS(status);
+        } else if (status_known && WIFSIGNALED(status)) {
+            *exit_code = 128 + WTERMSIG(status);
+        } else {
+            *exit_code = -1;
+        }
+    }
+    return ARC_OK;
+}
+
+#endif /* !_WIN32 */
+
 /*============================================================================
  * Internal API Declaration (for platform implementations)
  *============================================================================*/
@@ -460,6 +901,6 @@ void ac_sandbox_set_error(
 void ac_sandbox_set_denial_reason(const char *reason);
 int ac_sandbox_normalize_path(const char *path, char *buffer, size_t size);
 int ac_sandbox_path_is_under(const char *parent, const char *child);
-int ac_sandbox_is_command_dangerous(const char *command);
+int ac_sandbox_is_command_dangerous(const ac_sandbox_t *sandbox, const char *command);
 const char **ac_sandbox_get_default_readonly_paths(void);
 const char *ac_sandbox_confirm_type_str(ac_sandbox_confirm_type_t type);
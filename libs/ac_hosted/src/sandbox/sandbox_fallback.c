@@ -42,6 +42,8 @@ typedef struct {
     int initialized;
 } fallback_sandbox_data_t;
 
+static int normalize_path_for_check(const char *path, char *buffer, size_t size);
+
 /*============================================================================
  * Public API Implementation
  *============================================================================*/
@@ -51,38 +53,43 @@ int ac_sandbox_is_supported(void) {
     return 1;
 }
 
+#if defined(_WIN32)
+#define FALLBACK_PLATFORM "Windows"
+#else
+#define FALLBACK_PLATFORM "Unknown"
+#endif
+
+static const ac_sandbox_caps_t g_caps = {
+    .platform = FALLBACK_PLATFORM,
+    .backend = AC_SANDBOX_BACKEND_SOFTWARE,
+    .backend_name = "Software",
+    .level = AC_SANDBOX_LEVEL_BASIC,
+    .info = "{"
+            "\"platform\":\"" FALLBACK_PLATFORM "\","
+            "\"backend\":\"Software\","
+            "\"level\":\"basic\","
+            "\"warning\":\"No kernel sandbox - software filtering only\""
+            "}",
+};
+
+const ac_sandbox_caps_t *ac_sandbox_capabilities(void) {
+    return &g_caps;
+}
+
 ac_sandbox_backend_t ac_sandbox_get_backend(void) {
-    return AC_SANDBOX_BACKEND_SOFTWARE;
+    return g_caps.backend;
 }
 
 const char *ac_sandbox_backend_name(void) {
-    return "Software";
+    return g_caps.backend_name;
 }
 
 ac_sandbox_level_t ac_sandbox_get_level(void) {
-    return AC_SANDBOX_LEVEL_BASIC;
+    return g_caps.level;
 }
 
 const char *ac_sandbox_platform_info(void) {
-    static char info[256];
-
-#if defined(_WIN32)
-    const char *platform = "Windows";
-#else
-    const char *platform = "Unknown";
-#endif
-
-    snprintf(info, sizeof(info),
-        "{"
-        "\"platform\":\"%s\","
-        "\"backend\":\"Software\","
-        "\"level\":\"basic\","
-        "\"warning\":\"No kernel sandbox - software filtering only\""
-        "}",
-        platform
-    );
-
-    return info;
+    return g_caps.info;
 }
 
 ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
@@ -137,6 +144,8 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
     sandbox->allow_process_exec = config->allow_process_exec;
     sandbox->strict_mode = config->strict_mode;
     sandbox->log_violations = config->log_violations;
+    sandbox->admit = ac_sandbox_admit_create(config->max_concurrent_execs,
+                                             config->max_execs_per_owner);
 
     /* Copy path rules */
     if (config->path_rules && config->path_rules_count > 0) {
@@ -164,6 +173,34 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
         }
     }
 
+    /* Compile the command screening patterns */
+    sandbox->command_matcher = ac_sandbox_command_matcher_create(config);
+    if (!sandbox->command_matcher) {
+        ac_sandbox_destroy(sandbox);
+        ac_sandbox_set_error(
+            AC_SANDBOX_ERR_INTERNAL,
+            "Memory allocation failed",
+            "Failed to compile the dangerous command patterns.",
+            "Check available memory.",
+            NULL, errno
+        );
+        return NULL;
+    }
+
+    /* Compile the path rules */
+    sandbox->paths = ac_sandbox_paths_compile(sandbox, 0, normalize_path_for_check);
+    if (!sandbox->paths) {
+        ac_sandbox_destroy(sandbox);
+        ac_sandbox_set_error(
+            AC_SANDBOX_ERR_INTERNAL,
+            "Memory allocation failed",
+            "Failed to compile the sandbox path rules.",
+            "Check available memory.",
+            NULL, errno
+        );
+        return NULL;
+    }
+
     sandbox->backend = AC_SANDBOX_BACKEND_SOFTWARE;
     sandbox->level = AC_SANDBOX_LEVEL_BASIC;
 
@@ -210,11 +247,16 @@ void ac_sandbox_destroy(ac_sandbox_t *sandbox) {
         return;
     }
 
+    ac_sandbox_pool_stop(sandbox);
+    ac_sandbox_admit_free(sandbox->admit);
+
     fallback_sandbox_data_t *data = (fallback_sandbox_data_t *)sandbox->platform_data;
     if (data) {
         free(data);
     }
 
+    ac_sandbox_matcher_free(sandbox->command_matcher);
+    ac_sandbox_paths_free(sandbox->paths);
     free(sandbox->workspace_path);
 
     if (sandbox->path_rules) {
@@ -276,41 +318,6 @@ static int normalize_path_for_check(const char *path, char *buffer, size_t size)
     return 0;
 }
 
-/**
- * @brief Check if child path is under parent (Windows-aware)
- */
-static int path_is_under_fallback(const char *parent, const char *child) {
-    char norm_parent[4096];
-    char norm_child[4096];
-
-    if (normalize_path_for_check(parent, norm_parent, sizeof(norm_parent)) < 0) {
-        return 0;
-    }
-    if (normalize_path_for_check(child, norm_child, sizeof(norm_child)) < 0) {
-        return 0;
-    }
-
-    size_t parent_len = strlen(norm_parent);
-
-    /* Remove trailing slash from parent if present */
-    if (parent_len > 0 && norm_parent[parent_len - 1] == '/') {
-        norm_parent[parent_len - 1] = '\0';
-        parent_len--;
-    }
-
-    /* Check if child starts with parent path */
-    if (strncmp(norm_parent, norm_child, parent_len) != 0) {
-        return 0;
-    }
-
-    /* Child must either equal parent or have a separator after parent */
-    if (norm_child[parent_len] == '\0' || norm_child[parent_len] == '/') {
-        return 1;
-    }
-
-    return 0;
-}
-
 int ac_sandbox_check_path(
     const ac_sandbox_t *sandbox,
     const char *path,
@@ -320,33 +327,13 @@ int ac_sandbox_check_path(
         return 0;
     }
 
-    /* Check workspace path */
-    if (sandbox->workspace_path &&
-        path_is_under_fallback(sandbox->workspace_path, path)) {
+    /* Workspace, path rules and readonly paths (sandbox_paths.c) */
+    char normalized[4096];
+    normalize_path_for_check(path, normalized, sizeof(normalized));
+    if (ac_sandbox_paths_allows(sandbox->paths, normalized, permissions)) {
         return 1;
     }
 
-    /* Check custom path rules */
-    for (size_t i = 0; i < sandbox->path_rules_count; i++) {
-        const ac_sandbox_path_rule_t *rule = &sandbox->path_rules[i];
-        if (path_is_under_fallback(rule->path, path)) {
-            if ((rule->permissions & permissions) == permissions) {
-                return 1;
-            }
-        }
-    }
-
-    /* Check readonly paths for read-only access */
-    if ((permissions & ~AC_SANDBOX_PERM_FS_READ) == 0) {
-        if (sandbox->readonly_paths) {
-            for (int i = 0; sandbox->readonly_paths[i]; i++) {
-                if (path_is_under_fallback(sandbox->readonly_paths[i], path)) {
-                    return 1;
-                }
-            }
-        }
-    }
-
     /* If not strict mode and sandbox is not fully active, allow */
     if (!sandbox->strict_mode && !sandbox->is_active) {
         return 1;
@@ -398,7 +385,7 @@ int ac_sandbox_check_command(
     }
 
     /* Check for dangerous command patterns */
-    if (ac_sandbox_is_command_dangerous(command)) {
+    if (ac_sandbox_is_command_dangerous(sandbox, command)) {
         if (!sandbox->session_allow_dangerous_commands) {
             ac_sandbox_confirm_request_t request = {
                 .type = AC_SANDBOX_CONFIRM_DANGEROUS,
@@ -499,13 +486,11 @@ int ac_sandbox_check_command(
  * Sandboxed Subprocess Execution (Fallback - Software filtering only)
  *============================================================================*/
 
-arc_err_t ac_sandbox_exec_timeout(
+arc_err_t ac_sandbox_exec_platform(
     ac_sandbox_t *sandbox,
     const char *command,
-    char *output,
-    size_t output_size,
-    int *exit_code,
-    int timeout_ms
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
 ) {
     if (!sandbox || !command) {
         return ARC_ERR_INVALID_ARG;
@@ -513,8 +498,8 @@ arc_err_t ac_sandbox_exec_timeout(
 
     /* Software filtering: check command before execution */
     if (!ac_sandbox_check_command(sandbox, command)) {
-        if (output && output_size > 0) {
-            snprintf(output, output_size,
+        if (opts->output && opts->output_size > 0) {
+            snprintf(opts->output, opts->output_size,
                      "{\"error\":\"Command blocked by sandbox\",\"reason\":\"%s\"}",
                      ac_sandbox_denial_reason());
         }
@@ -525,79 +510,46 @@ arc_err_t ac_sandbox_exec_timeout(
     AC_LOG_WARN("Fallback sandbox: executing without kernel isolation");
 
 #if defined(_WIN32)
-    /* Windows implementation using _popen */
+    /* Windows implementation using _popen: stdout only, no timeout */
     FILE *fp = _popen(command, "r");
     if (!fp) {
-        if (output && output_size > 0) {
-            snprintf(output, output_size,
+        if (opts->output && opts->output_size > 0) {
+            snprintf(opts->output, opts->output_size,
                      "{\"error\":\"Failed to execute command\"}");
         }
         if (exit_code) *exit_code = -1;
         return ARC_ERR_IO;
     }
 
+    char *output = opts->output;
+    size_t output_size = opts->output_size;
     if (output && output_size > 0) {
         output[0] = '\0';
-        size_t total_read = 0;
-        char buf[256];
+    }
+    size_t total_read = 0;
+    char buf[256];
 
-        while (fgets(buf, sizeof(buf), fp) != NULL) {
-            size_t len = strlen(buf);
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+        size_t len = strlen(buf);
+        if (opts->on_output) {
+            opts->on_output(AC_SANDBOX_STDOUT, buf, len, opts->user_data);
+        }
+        if (output && output_size > 0) {
             size_t remaining = output_size - total_read - 1;
-            if (remaining > 0) {
-                size_t to_copy = len < remaining ? len : remaining;
-                memcpy(output + total_read, buf, to_copy);
-                total_read += to_copy;
-                output[total_read] = '\0';
-            }
+            size_t to_copy = len < remaining ? len : remaining;
+            memcpy(output + total_read, buf, to_copy);
+            total_read += to_copy;
+            output[total_read] = '\0';
         }
     }
 
     int status = _pclose(fp);
     if (exit_code) *exit_code = status;
-
+    return ARC_OK;
 #else
-    /* Non-Windows fallback using popen (no kernel sandbox) */
-    FILE *fp = popen(command, "r");
-    if (!fp) {
-        if (output && output_size > 0) {
-            snprintf(output, output_size,
-                     "{\"error\":\"Failed to execute command\"}");
-        }
-        if (exit_code) *exit_code = -1;
-        return ARC_ERR_IO;
-    }
-
-    if (output && output_size > 0) {
-        output[0] = '\0';
-        size_t total_read = 0;
-        char buf[256];
-
-        while (fgets(buf, sizeof(buf), fp) != NULL) {
-            size_t len = strlen(buf);
-            size_t remaining = output_size - total_read - 1;
-            if (remaining > 0) {
-                size_t to_copy = len < remaining ? len : remaining;
-                memcpy(output + total_read, buf, to_copy);
-                total_read += to_copy;
-                output[total_read] = '\0';
-            }
-        }
-    }
-
-    int status = pclose(fp);
-    if (exit_code) {
-        if (WIFEXITED(status)) {
-            *exit_code = WEXITSTATUS(status);
-        } else {
-            *exit_code = -1;
-        }
-    }
+    /* No kernel sandbox, but the same capture, deadline and kill as the others */
+    return ac_sandbox_run_command(sandbox, command, opts, exit_code);
 #endif
-
-    (void)timeout_ms;  /* Timeout not implemented in fallback */
-
-    return ARC_OK;
 }
 
 arc_err_t ac_sandbox_exec(
@@ -19,6 +19,17 @@ extern "C" {
  * Internal Sandbox Structure
  *============================================================================*/
 
+typedef struct ac_sandbox_matcher ac_sandbox_matcher_t;
+typedef struct ac_sandbox_paths ac_sandbox_paths_t;
+
+/* Resource limits of commands (Linux only; parent NULL = no cgroups) */
+typedef struct {
+    char *parent;
+    int cpu_max_percent;
+    size_t memory_max;
+    int pids_max;
+} ac_sandbox_limits_t;
+
 struct ac_sandbox {
     /* Configuration (copied from user config) */
     char *workspace_path;
@@ -35,6 +46,12 @@ struct ac_sandbox {
     ac_sandbox_backend_t backend;
     ac_sandbox_level_t level;
 
+    /* Path rules, compiled (sandbox_paths.c) */
+    ac_sandbox_paths_t *paths;
+
+    /* Dangerous command patterns, compiled (sandbox_match.c) */
+    ac_sandbox_matcher_t *command_matcher;
+
     /* Human-in-the-loop callback */
     ac_sandbox_confirm_fn confirm_callback;
     void *confirm_user_data;
@@ -44,6 +61,15 @@ struct ac_sandbox {
     int session_allow_external_paths;
     int session_allow_network;
 
+    /* Per-command cgroups (sandbox_cgroup.c) */
+    ac_sandbox_limits_t limits;
+
+    /* Admission queue (sandbox_admit.c; NULL = no limit) */
+    struct ac_sandbox_admit *admit;
+
+    /* Helper processes (sandbox_pool.c; NULL unless started) */
+    struct ac_sandbox_pool *pool;
+
     /* Platform-specific data */
     void *platform_data;
 };
@@ -86,13 +112,202 @@ int ac_sandbox_path_is_under(const char *parent, const char *child);
 /**
  * @brief Check if command contains dangerous patterns
  */
-int ac_sandbox_is_command_dangerous(const char *command);
+int ac_sandbox_is_command_dangerous(const ac_sandbox_t *sandbox, const char *command);
+
+/**
+ * @brief Compile the built-in and configured command patterns
+ * @return Matcher, or NULL if out of memory
+ */
+ac_sandbox_matcher_t *ac_sandbox_command_matcher_create(const ac_sandbox_config_t *config);
 
 /**
  * @brief Get default readonly paths for current platform
  */
 const char **ac_sandbox_get_default_readonly_paths(void);
 
+/*============================================================================
+ * Command Pattern Matching (from sandbox_match.c)
+ *============================================================================*/
+
+/**
+ * @brief Create an empty matcher
+ */
+ac_sandbox_matcher_t *ac_sandbox_matcher_new(void);
+
+/**
+ * @brief Add a pattern (see ac_sandbox_config_t.dangerous_patterns)
+ *
+ * @param safe  Exempts dangerous matches that start at the same word
+ * @return 0 on success, -1 if out of memory
+ */
+int ac_sandbox_matcher_add(ac_sandbox_matcher_t *m, const char *pattern, int safe);
+
+/**
+ * @brief Compile the patterns added so far
+ * @return 0 on success, -1 if out of memory
+ */
+int ac_sandbox_matcher_build(ac_sandbox_matcher_t *m);
+
+/**
+ * @brief Screen a command in one pass
+ * @return The dangerous pattern that matched (a placeholder if the command
+ *         could not be screened), or NULL
+ */
+const char *ac_sandbox_matcher_find(const ac_sandbox_matcher_t *m, const char *command);
+
+void ac_sandbox_matcher_free(ac_sandbox_matcher_t *m);
+
+/*============================================================================
+ * Compiled Path Rules (from sandbox_paths.c)
+ *============================================================================*/
+
+/**
+ * @brief Create an empty rule set
+ */
+ac_sandbox_paths_t *ac_sandbox_paths_new(void);
+
+/**
+ * @brief Add a rule for an already normalized path
+ * @return 0 on success, -1 if out of memory
+ */
+int ac_sandbox_paths_add(ac_sandbox_paths_t *p, const char *normalized, unsigned int permissions);
+
+/**
+ * @brief Compile the workspace, path rules and readonly paths of a sandbox
+ *
+ * @param with_defaults  Also add ac_sandbox_get_default_readonly_paths()
+ * @param normalize      Applied to every rule path (and by the caller to
+ *                       checked paths)
+ * @return Rule set, or NULL if out of memory
+ */
+ac_sandbox_paths_t *ac_sandbox_paths_compile(
+    const ac_sandbox_t *sandbox,
+    int with_defaults,
+    int (*normalize)(const char *path, char *buffer, size_t size)
+);
+
+/**
+ * @brief Check whether a rule on a normalized path covers permissions
+ * @return 1 if allowed, 0 if no rule applies
+ */
+int ac_sandbox_paths_allows(
+    const ac_sandbox_paths_t *p,
+    const char *normalized,
+    unsigned int permissions
+);
+
+/**
+ * @brief ac_sandbox_normalize_path() with resolved directories cached
+ */
+int ac_sandbox_paths_normalize(ac_sandbox_paths_t *p, const char *path, char *buffer, size_t size);
+
+/**
+ * @brief Drop cached directories (after anything may have changed them)
+ */
+void ac_sandbox_paths_invalidate(ac_sandbox_paths_t *p);
+
+void ac_sandbox_paths_free(ac_sandbox_paths_t *p);
+
+/*============================================================================
+ * Per-Command Cgroups (from sandbox_cgroup.c)
+ *============================================================================*/
+
+/* A command's cgroup; procs_fd is its cgroup.procs, -1 when there is none */
+typedef struct {
+    char path[512];
+    int procs_fd;
+} ac_sandbox_cgroup_t;
+
+/**
+ * @brief Create a cgroup for one command and apply the limits
+ *
+ * With no limits->parent, sets cg->procs_fd to -1 and succeeds.
+ * @return 0 on success, -1 if the cgroup or a limit could not be set up
+ */
+int ac_sandbox_cgroup_create(const ac_sandbox_limits_t *limits, ac_sandbox_cgroup_t *cg);
+
+/**
+ * @brief Read the CPU time, peak memory and IO of a command's cgroup
+ *
+ * Leaves usage untouched for fields the kernel does not report.
+ */
+void ac_sandbox_cgroup_usage(const ac_sandbox_cgroup_t *cg, ac_sandbox_usage_t *usage);
+
+/**
+ * @brief Kill what is left in a command's cgroup and remove it
+ */
+void ac_sandbox_cgroup_destroy(ac_sandbox_cgroup_t *cg);
+
+/*============================================================================
+ * Admission Queue (from sandbox_admit.c)
+ *============================================================================*/
+
+/**
+ * @brief Create the queue for ac_sandbox_config_t.max_concurrent_execs
+ * @return NULL when max_concurrent is 0, on Windows, or out of memory
+ */
+struct ac_sandbox_admit *ac_sandbox_admit_create(int max_concurrent, int max_per_owner);
+
+/**
+ * @brief Wait for a slot for owner (returns at once without a queue)
+ */
+void ac_sandbox_admit_acquire(struct ac_sandbox_admit *admit, const void *owner);
+
+/**
+ * @brief Give back the slot of owner and hand it to the next waiter
+ */
+void ac_sandbox_admit_release(struct ac_sandbox_admit *admit, const void *owner);
+
+void ac_sandbox_admit_free(struct ac_sandbox_admit *admit);
+
+/*============================================================================
+ * Execution (one per platform file)
+ *============================================================================*/
+
+/**
+ * @brief Run a command under the platform backend
+ *
+ * ac_sandbox_exec_ex() (sandbox_common.c) wraps it with metrics.
+ * opts is never NULL.
+ */
+arc_err_t ac_sandbox_exec_platform(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
+);
+
+#if !defined(_WIN32)
+
+/**
+ * @brief Run an already approved command with /bin/sh (sandbox_common.c)
+ *
+ * Implements the process handling of ac_sandbox_exec_ex() for POSIX
+ * backends: process group, poll-driven capture, deadline and kill, and
+ * the command's cgroup when limits->parent is set (limits may be NULL).
+ */
+arc_err_t ac_sandbox_run_posix(
+    const ac_sandbox_limits_t *limits,
+    const char *command,
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
+);
+
+/**
+ * @brief Run an already approved command, on a pool worker if one is free
+ *
+ * Falls back to ac_sandbox_run_posix() when no pool was started or all
+ * workers are busy (sandbox_pool.c).
+ */
+arc_err_t ac_sandbox_run_command(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
+);
+
+#endif
+
 /*============================================================================
  * Platform Detection Helpers
  *============================================================================*/
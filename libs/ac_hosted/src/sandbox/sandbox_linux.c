@@ -25,10 +25,13 @@
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <stddef.h>
 #include <sys/prctl.h>
+#include <sys/socket.h>
 #include <sys/syscall.h>
 #include <linux/filter.h>
 #include <linux/seccomp.h>
@@ -117,19 +120,12 @@ static inline int landlock_restrict_self(int ruleset_fd, __u32 flags) {
  * Platform Detection
  *============================================================================*/
 
-static int g_landlock_abi = -1;  /* -1 = not checked, 0 = not available */
-static int g_seccomp_available = -1;
-
-int ac_sandbox_linux_landlock_abi(void) {
-    if (g_landlock_abi >= 0) {
-        return g_landlock_abi;
-    }
-
-    /* Check Landlock ABI version */
-    struct landlock_ruleset_attr attr = {
-        .handled_access_fs = 0,
-    };
+/* Probed once per process; the kernel's answers do not change */
+static ac_sandbox_caps_t g_caps;
+static char g_caps_info[256];
+static pthread_once_t g_caps_once = PTHREAD_ONCE_INIT;
 
+static void caps_probe(void) {
     int abi = landlock_create_ruleset(NULL, 0, LANDLOCK_CREATE_RULESET_VERSION);
     if (abi < 0) {
         if (errno == ENOSYS) {
@@ -137,41 +133,81 @@ int ac_sandbox_linux_landlock_abi(void) {
         } else if (errno == EOPNOTSUPP) {
             AC_LOG_INFO("Landlock disabled in kernel config");
         }
-        g_landlock_abi = 0;
+        abi = 0;
     } else {
-        g_landlock_abi = abi;
         AC_LOG_INFO("Landlock ABI version: %d", abi);
     }
 
-    return g_landlock_abi;
-}
-
-int ac_sandbox_linux_seccomp_available(void) {
-    if (g_seccomp_available >= 0) {
-        return g_seccomp_available;
+    int seccomp = !(prctl(PR_GET_SECCOMP) == -1 && errno == EINVAL);
+    if (seccomp) {
+        AC_LOG_DEBUG("Seccomp is available");
+    } else {
+        AC_LOG_INFO("Seccomp not available");
     }
 
-    /* Check if seccomp is available */
-    if (prctl(PR_GET_SECCOMP) == -1 && errno == EINVAL) {
-        g_seccomp_available = 0;
-        AC_LOG_INFO("Seccomp not available");
+    g_caps.platform = "Linux";
+    g_caps.landlock_abi = abi;
+    g_caps.seccomp = seccomp;
+    if (abi > 0) {
+        g_caps.backend = AC_SANDBOX_BACKEND_LANDLOCK;
+        g_caps.backend_name = "Landlock+Seccomp";
+        g_caps.level = AC_SANDBOX_LEVEL_FULL;
+    } else if (seccomp) {
+        g_caps.backend = AC_SANDBOX_BACKEND_SECCOMP;
+        g_caps.backend_name = "Seccomp";
+        g_caps.level = AC_SANDBOX_LEVEL_MODERATE;
     } else {
-        g_seccomp_available = 1;
-        AC_LOG_DEBUG("Seccomp is available");
+        g_caps.backend = AC_SANDBOX_BACKEND_SOFTWARE;
+        g_caps.backend_name = "Software";
+        g_caps.level = AC_SANDBOX_LEVEL_BASIC;
     }
 
-    return g_seccomp_available;
+    snprintf(g_caps_info, sizeof(g_caps_info),
+        "{"
+        "\"platform\":\"Linux\","
+        "\"backend\":\"%s\","
+        "\"level\":\"%s\","
+        "\"landlock_abi\":%d,"
+        "\"seccomp_available\":%s"
+        "}",
+        g_caps.backend_name,
+        abi > 0 ? "full" : seccomp ? "moderate" : "basic",
+        abi,
+        seccomp ? "true" : "false"
+    );
+    g_caps.info = g_caps_info;
+}
+
+const ac_sandbox_caps_t *ac_sandbox_capabilities(void) {
+    pthread_once(&g_caps_once, caps_probe);
+    return &g_caps;
+}
+
+int ac_sandbox_linux_landlock_abi(void) {
+    return ac_sandbox_capabilities()->landlock_abi;
+}
+
+int ac_sandbox_linux_seccomp_available(void) {
+    return ac_sandbox_capabilities()->seccomp;
 }
 
 /*============================================================================
  * Landlock Implementation
  *============================================================================*/
 
+/* Longest seccomp program build_seccomp_filter() emits */
+#define SECCOMP_FILTER_MAX 24
+
 /* Linux-specific platform data */
 typedef struct {
     int ruleset_fd;
     int landlock_enforced;
     int seccomp_enforced;
+
+    /* Seccomp program for the configured policy, built at create */
+    struct sock_filter seccomp_filter[SECCOMP_FILTER_MAX];
+    unsigned short seccomp_len;      /* 0 = nothing to filter */
+    int seccomp_blocks_network;      /* Program denies non-UNIX sockets */
 } linux_sandbox_data_t;
 
 /**
@@ -366,18 +402,106 @@ static int enforce_landlock(ac_sandbox_t *sandbox) {
  * Seccomp Implementation
  *============================================================================*/
 
+#if defined(__x86_64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_X86_64
+#elif defined(__aarch64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_AARCH64
+#endif
+
+#ifndef SECCOMP_RET_KILL_PROCESS
+#define SECCOMP_RET_KILL_PROCESS SECCOMP_RET_KILL
+#endif
+
+#ifndef SECCOMP_FILTER_FLAG_TSYNC
+#define SECCOMP_FILTER_FLAG_TSYNC (1UL << 0)
+#endif
+
+/* Low 32 bits of the first syscall argument */
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SECCOMP_ARG0_LO offsetof(struct seccomp_data, args[0])
+#else
+#define SECCOMP_ARG0_LO (offsetof(struct seccomp_data, args[0]) + 4)
+#endif
+
+#define SECCOMP_EMIT(code, k, jt, jf) \
+    (data->seccomp_filter[n++] = (struct sock_filter){ (code), (jt), (jf), (k) })
+
 /**
- * @brief Set up basic Seccomp filter
+ * @brief Build the seccomp program for the configured policy
  *
- * This provides syscall-level restrictions to complement Landlock.
- * Uses a whitelist approach for safe syscalls.
+ * - allow_network = 0: socket() is refused (EACCES) for every family
+ *   but AF_UNIX, and io_uring, which can open sockets itself, is
+ *   refused too. Without a socket there is nothing to connect().
+ * - allow_process_exec = 0 in strict mode: execve()/execveat() are
+ *   refused, matching ac_sandbox_check_command().
+ *
+ * Syscalls of another ABI (i386 int 0x80, x32) would bypass the number
+ * checks and kill the process. Called once per sandbox; on architectures
+ * without a known audit arch nothing is built and the software checks
+ * stay in charge.
  */
-static int setup_seccomp(ac_sandbox_t *sandbox) {
-    /* Seccomp-bpf filter to block dangerous syscalls */
+static void build_seccomp_filter(const ac_sandbox_t *sandbox, linux_sandbox_data_t *data) {
+    data->seccomp_len = 0;
+    data->seccomp_blocks_network = 0;
+
+#if defined(SECCOMP_AUDIT_ARCH)
+    int block_network = !sandbox->allow_network;
+    int block_exec = !sandbox->allow_process_exec && sandbox->strict_mode;
+    if (!block_network && !block_exec) {
+        return;
+    }
+
+    unsigned short n = 0;
+    const __u32 refuse = SECCOMP_RET_ERRNO | (EACCES & SECCOMP_RET_DATA);
+
+    SECCOMP_EMIT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch), 0, 0);
+    SECCOMP_EMIT(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0);
+    SECCOMP_EMIT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS, 0, 0);
+    SECCOMP_EMIT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr), 0, 0);
+#if defined(__x86_64__)
+    SECCOMP_EMIT(BPF_JMP | BPF_JGE | BPF_K, 0x40000000, 0, 1);     /* __X32_SYSCALL_BIT */
+    SECCOMP_EMIT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS, 0, 0);
+#endif
+
+    if (block_exec) {
+        SECCOMP_EMIT(BPF_JMP | BPF_JEQ | BPF_K, __NR_execve, 0, 1);
+        SECCOMP_EMIT(BPF_RET | BPF_K, refuse, 0, 0);
+#ifdef __NR_execveat
+        SECCOMP_EMIT(BPF_JMP | BPF_JEQ | BPF_K, __NR_execveat, 0, 1);
+        SECCOMP_EMIT(BPF_RET | BPF_K, refuse, 0, 0);
+#endif
+    }
+
+    if (block_network) {
+#ifdef __NR_io_uring_setup
+        SECCOMP_EMIT(BPF_JMP | BPF_JEQ | BPF_K, __NR_io_uring_setup, 0, 1);
+        SECCOMP_EMIT(BPF_RET | BPF_K, refuse, 0, 0);
+#endif
+        /* Last check: it replaces the syscall number with the family */
+        SECCOMP_EMIT(BPF_JMP | BPF_JEQ | BPF_K, __NR_socket, 0, 4);
+        SECCOMP_EMIT(BPF_LD | BPF_W | BPF_ABS, SECCOMP_ARG0_LO, 0, 0);
+        SECCOMP_EMIT(BPF_JMP | BPF_JEQ | BPF_K, AF_UNIX, 0, 1);
+        SECCOMP_EMIT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW, 0, 0);
+        SECCOMP_EMIT(BPF_RET | BPF_K, refuse, 0, 0);
+        data->seccomp_blocks_network = 1;
+    }
 
-    /* For now, we use a simple filter that logs violations
-     * A full implementation would use libseccomp for easier filter creation */
+    SECCOMP_EMIT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW, 0, 0);
+    data->seccomp_len = n;
+#else
+    (void)sandbox;
+#endif
+}
 
+#undef SECCOMP_EMIT
+
+/**
+ * @brief Install the seccomp filter built by build_seccomp_filter()
+ *
+ * The filter goes on every thread of the process (TSYNC) and, as seccomp
+ * filters survive fork and execve, on every command run afterwards.
+ */
+static int setup_seccomp(ac_sandbox_t *sandbox) {
     if (!ac_sandbox_linux_seccomp_available()) {
         AC_LOG_WARN("Seccomp not available, skipping");
         return -1;
@@ -390,24 +514,42 @@ static int setup_seccomp(ac_sandbox_t *sandbox) {
         }
     }
 
-    /* Basic filter: allow most syscalls but log network operations if blocked */
-    /* Full seccomp implementation would go here using BPF */
-
     linux_sandbox_data_t *data = (linux_sandbox_data_t *)sandbox->platform_data;
 
-    if (!sandbox->allow_network) {
-        /* TODO: Add BPF filter to block network syscalls */
-        AC_LOG_DEBUG("Network blocking via seccomp not implemented, using software check");
-    }
-
-    if (!sandbox->allow_process_exec) {
-        /* TODO: Add BPF filter to block exec syscalls */
-        AC_LOG_DEBUG("Process exec blocking via seccomp not implemented, using software check");
+    if (data->seccomp_len > 0) {
+        struct sock_fprog prog = {
+            .len = data->seccomp_len,
+            .filter = data->seccomp_filter,
+        };
+
+        long rc = syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER,
+                          SECCOMP_FILTER_FLAG_TSYNC, &prog);
+        if (rc < 0 && (errno == ENOSYS || errno == EINVAL)) {
+            /* Pre-3.17 kernel: calling thread only */
+            AC_LOG_WARN("Seccomp TSYNC unavailable, filtering this thread only");
+            rc = prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog, 0, 0);
+        }
+        if (rc != 0) {
+            AC_LOG_ERROR("Failed to install seccomp filter: %s",
+                         rc > 0 ? "thread not synchronizable" : strerror(errno));
+            ac_sandbox_set_error(
+                AC_SANDBOX_ERR_INTERNAL,
+                "Failed to apply seccomp filter",
+                "The syscall filter for network and process restrictions "
+                "could not be installed. Network and exec limits are only "
+                "checked in software.",
+                "Check that seccomp is not blocked by a container policy.",
+                NULL,
+                rc > 0 ? 0 : errno
+            );
+            return -1;
+        }
+        AC_LOG_DEBUG("Seccomp filter installed (%u instructions, network %s)",
+                     data->seccomp_len,
+                     data->seccomp_blocks_network ? "blocked" : "allowed");
     }
 
     data->seccomp_enforced = 1;
-    AC_LOG_DEBUG("Seccomp basic setup complete");
-
     return 0;
 }
 
@@ -421,57 +563,19 @@ int ac_sandbox_is_supported(void) {
 }
 
 ac_sandbox_backend_t ac_sandbox_get_backend(void) {
-    if (ac_sandbox_linux_landlock_abi() > 0) {
-        return AC_SANDBOX_BACKEND_LANDLOCK;
-    }
-    if (ac_sandbox_linux_seccomp_available()) {
-        return AC_SANDBOX_BACKEND_SECCOMP;
-    }
-    return AC_SANDBOX_BACKEND_SOFTWARE;
+    return ac_sandbox_capabilities()->backend;
 }
 
 const char *ac_sandbox_backend_name(void) {
-    switch (ac_sandbox_get_backend()) {
-        case AC_SANDBOX_BACKEND_LANDLOCK:
-            return "Landlock+Seccomp";
-        case AC_SANDBOX_BACKEND_SECCOMP:
-            return "Seccomp";
-        case AC_SANDBOX_BACKEND_SOFTWARE:
-            return "Software";
-        default:
-            return "Unknown";
-    }
+    return ac_sandbox_capabilities()->backend_name;
 }
 
 ac_sandbox_level_t ac_sandbox_get_level(void) {
-    if (ac_sandbox_linux_landlock_abi() > 0) {
-        return AC_SANDBOX_LEVEL_FULL;
-    }
-    if (ac_sandbox_linux_seccomp_available()) {
-        return AC_SANDBOX_LEVEL_MODERATE;
-    }
-    return AC_SANDBOX_LEVEL_BASIC;
+    return ac_sandbox_capabilities()->level;
 }
 
 const char *ac_sandbox_platform_info(void) {
-    static char info[512];
-
-    snprintf(info, sizeof(info),
-        "{"
-        "\"platform\":\"Linux\","
-        "\"backend\":\"%s\","
-        "\"level\":\"%s\","
-        "\"landlock_abi\":%d,"
-        "\"seccomp_available\":%s"
-        "}",
-        ac_sandbox_backend_name(),
-        ac_sandbox_get_level() == AC_SANDBOX_LEVEL_FULL ? "full" :
-        ac_sandbox_get_level() == AC_SANDBOX_LEVEL_MODERATE ? "moderate" : "basic",
-        ac_sandbox_linux_landlock_abi(),
-        ac_sandbox_linux_seccomp_available() ? "true" : "false"
-    );
-
-    return info;
+    return ac_sandbox_capabilities()->info;
 }
 
 ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
@@ -527,6 +631,16 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
     sandbox->allow_process_exec = config->allow_process_exec;
     sandbox->strict_mode = config->strict_mode;
     sandbox->log_violations = config->log_violations;
+    sandbox->admit = ac_sandbox_admit_create(config->max_concurrent_execs,
+                                             config->max_execs_per_owner);
+
+    /* Resource limits apply only with a cgroup to create groups under */
+    if (config->cgroup_parent) {
+        sandbox->limits.parent = strdup(config->cgroup_parent);
+        sandbox->limits.cpu_max_percent = config->cpu_max_percent;
+        sandbox->limits.memory_max = config->memory_max;
+        sandbox->limits.pids_max = config->pids_max;
+    }
 
     /* Copy path rules */
     if (config->path_rules && config->path_rules_count > 0) {
@@ -554,12 +668,43 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
         }
     }
 
+    /* Compile the command screening patterns */
+    sandbox->command_matcher = ac_sandbox_command_matcher_create(config);
+    if (!sandbox->command_matcher) {
+        ac_sandbox_destroy(sandbox);
+        ac_sandbox_set_error(
+            AC_SANDBOX_ERR_INTERNAL,
+            "Memory allocation failed",
+            "Failed to compile the dangerous command patterns.",
+            "Check available memory.",
+            NULL, errno
+        );
+        return NULL;
+    }
+
+    /* Compile the path rules */
+    sandbox->paths = ac_sandbox_paths_compile(sandbox, 1, ac_sandbox_normalize_path);
+    if (!sandbox->paths) {
+        ac_sandbox_destroy(sandbox);
+        ac_sandbox_set_error(
+            AC_SANDBOX_ERR_INTERNAL,
+            "Memory allocation failed",
+            "Failed to compile the sandbox path rules.",
+            "Check available memory.",
+            NULL, errno
+        );
+        return NULL;
+    }
+
+    /* Precompute the syscall filter ac_sandbox_enter() installs */
+    build_seccomp_filter(sandbox, data);
+
     /* Determine backend based on availability */
-    sandbox->backend = ac_sandbox_get_backend();
-    sandbox->level = ac_sandbox_get_level();
+    const ac_sandbox_caps_t *caps = ac_sandbox_capabilities();
+    sandbox->backend = caps->backend;
+    sandbox->level = caps->level;
 
-    AC_LOG_INFO("Created sandbox (backend=%s, level=%d)",
-                ac_sandbox_backend_name(), sandbox->level);
+    AC_LOG_DEBUG("Created sandbox (backend=%s, level=%d)", caps->backend_name, sandbox->level);
 
     return sandbox;
 }
@@ -631,6 +776,9 @@ void ac_sandbox_destroy(ac_sandbox_t *sandbox) {
         return;
     }
 
+    ac_sandbox_pool_stop(sandbox);
+    ac_sandbox_admit_free(sandbox->admit);
+
     linux_sandbox_data_t *data = (linux_sandbox_data_t *)sandbox->platform_data;
     if (data) {
         if (data->ruleset_fd >= 0) {
@@ -639,7 +787,10 @@ void ac_sandbox_destroy(ac_sandbox_t *sandbox) {
         free(data);
     }
 
+    ac_sandbox_matcher_free(sandbox->command_matcher);
+    ac_sandbox_paths_free(sandbox->paths);
     free(sandbox->workspace_path);
+    free(sandbox->limits.parent);
 
     if (sandbox->path_rules) {
         for (size_t i = 0; i < sandbox->path_rules_count; i++) {
@@ -672,42 +823,13 @@ int ac_sandbox_check_path(
         return 0;
     }
 
-    /* Check workspace path */
-    if (sandbox->workspace_path &&
-        ac_sandbox_path_is_under(sandbox->workspace_path, path)) {
+    /* Workspace, path rules and readonly paths (sandbox_paths.c) */
+    char normalized[4096];
+    if (ac_sandbox_paths_normalize(sandbox->paths, path, normalized, sizeof(normalized)) == 0 &&
+        ac_sandbox_paths_allows(sandbox->paths, normalized, permissions)) {
         return 1;
     }
 
-    /* Check custom path rules */
-    for (size_t i = 0; i < sandbox->path_rules_count; i++) {
-        const ac_sandbox_path_rule_t *rule = &sandbox->path_rules[i];
-        if (ac_sandbox_path_is_under(rule->path, path)) {
-            if ((rule->permissions & permissions) == permissions) {
-                return 1;
-            }
-        }
-    }
-
-    /* Check readonly paths */
-    if ((permissions & ~AC_SANDBOX_PERM_FS_READ) == 0) {
-        /* Only read permission requested */
-        if (sandbox->readonly_paths) {
-            for (int i = 0; sandbox->readonly_paths[i]; i++) {
-                if (ac_sandbox_path_is_under(sandbox->readonly_paths[i], path)) {
-                    return 1;
-                }
-            }
-        }
-
-        /* Check default readonly paths */
-        const char **defaults = ac_sandbox_get_default_readonly_paths();
-        for (int i = 0; defaults[i]; i++) {
-            if (ac_sandbox_path_is_under(defaults[i], path)) {
-                return 1;
-            }
-        }
-    }
-
     /* Path not in allowed list - request human confirmation */
 
     /* Check if session-level permission was granted */
@@ -759,7 +881,7 @@ int ac_sandbox_check_command(
     }
 
     /* Check for dangerous command patterns */
-    if (ac_sandbox_is_command_dangerous(command)) {
+    if (ac_sandbox_is_command_dangerous(sandbox, command)) {
         /* Check if session-level permission was granted */
         if (!sandbox->session_allow_dangerous_commands) {
             /* Request human confirmation */
@@ -787,8 +909,11 @@ int ac_sandbox_check_command(
         return 0;
     }
 
-    /* Check for network commands if network is disabled */
-    if (!sandbox->allow_network && !sandbox->session_allow_network) {
+    /* Check for network commands if network is disabled. Once the seccomp
+     * filter is in, the kernel refuses the sockets instead. */
+    const linux_sandbox_data_t *data = (const linux_sandbox_data_t *)sandbox->platform_data;
+    int kernel_blocks_network = data && data->seccomp_enforced && data->seccomp_blocks_network;
+    if (!sandbox->allow_network && !sandbox->session_allow_network && !kernel_blocks_network) {
         const char *net_commands[] = {"curl", "wget", "nc", "netcat", "ssh", "scp", NULL};
         for (int i = 0; net_commands[i]; i++) {
             if (strstr(command, net_commands[i])) {
@@ -825,13 +950,11 @@ int ac_sandbox_check_command(
  * Sandboxed Subprocess Execution
  *============================================================================*/
 
-arc_err_t ac_sandbox_exec_timeout(
+arc_err_t ac_sandbox_exec_platform(
     ac_sandbox_t *sandbox,
     const char *command,
-    char *output,
-    size_t output_size,
-    int *exit_code,
-    int timeout_ms
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
 ) {
     if (!sandbox || !command) {
         return ARC_ERR_INVALID_ARG;
@@ -839,8 +962,8 @@ arc_err_t ac_sandbox_exec_timeout(
 
     /* First check if command is allowed */
     if (!ac_sandbox_check_command(sandbox, command)) {
-        if (output && output_size > 0) {
-            snprintf(output, output_size,
+        if (opts->output && opts->output_size > 0) {
+            snprintf(opts->output, opts->output_size,
                      "{\"error\":\"Command blocked by sandbox\",\"reason\":\"%s\"}",
                      ac_sandbox_denial_reason());
         }
@@ -848,139 +971,24 @@ arc_err_t ac_sandbox_exec_timeout(
         return ARC_ERR_INVALID_ARG;
     }
 
-    /* Create pipe for capturing output */
-    int pipefd[2];
-    if (pipe(pipefd) < 0) {
-        AC_LOG_ERROR("Failed to create pipe: %s", strerror(errno));
-        return ARC_ERR_IO;
-    }
-
-    pid_t pid = fork();
-
-    if (pid < 0) {
-        /* Fork failed */
-        close(pipefd[0]);
-        close(pipefd[1]);
-        AC_LOG_ERROR("Fork failed: %s", strerror(errno));
-        return ARC_ERR_IO;
-    }
-
-    if (pid == 0) {
-        /* ===== Child process ===== */
-
-        /* Close read end of pipe */
-        close(pipefd[0]);
-
-        /* Redirect stdout and stderr to pipe */
-        dup2(pipefd[1], STDOUT_FILENO);
-        dup2(pipefd[1], STDERR_FILENO);
-        close(pipefd[1]);
-
-        /*
-         * NOTE: We do NOT enter Landlock sandbox in child process.
-         *
-         * Reason: Landlock has compatibility issues with special filesystems
-         * like /dev, /proc, /sys which are needed by many commands (git, etc.)
-         *
-         * Security is ensured by:
-         * 1. Software-level command validation (ac_sandbox_check_command)
-         * 2. Human-in-the-loop confirmation for dangerous operations
-         * 3. The command has already been approved before reaching here
-         *
-         * This approach trades kernel-level enforcement for better compatibility
-         * while maintaining security through explicit user consent.
-         */
-
-        /* Execute command via shell */
-        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
-
-        /* If execl fails */
-        fprintf(stderr, "execl failed: %s\n", strerror(errno));
-        _exit(127);
-    }
-
-    /* ===== Parent process ===== */
-
-    /* Close write end of pipe */
-    close(pipefd[1]);
-
-    /* Set up for reading with optional timeout */
-    if (output && output_size > 0) {
-        output[0] = '\0';
-        size_t total_read = 0;
-        char buf[256];
-        ssize_t n;
-
-        /* TODO: Implement proper timeout with select/poll if needed */
-        while ((n = read(pipefd[0], buf, sizeof(buf) - 1)) > 0) {
-            buf[n] = '\0';
-            size_t remaining = output_size - total_read - 1;
-            if (remaining > 0) {
-                size_t to_copy = (size_t)n < remaining ? (size_t)n : remaining;
-                memcpy(output + total_read, buf, to_copy);
-                total_read += to_copy;
-                output[total_read] = '\0';
-            }
-        }
-    }
-
-    close(pipefd[0]);
-
-    /* Wait for child process */
-    int status;
-    pid_t wait_result;
-
-    if (timeout_ms > 0) {
-        /* Implement timeout with alarm or polling */
-        int waited_ms = 0;
-        int interval_ms = 10;
-
-        while (waited_ms < timeout_ms) {
-            wait_result = waitpid(pid, &status, WNOHANG);
-            if (wait_result == pid) {
-                break;
-            } else if (wait_result < 0) {
-                AC_LOG_ERROR("waitpid failed: %s", strerror(errno));
-                return ARC_ERR_IO;
-            }
-
-            usleep(interval_ms * 1000);
-            waited_ms += interval_ms;
-        }
-
-        if (waited_ms >= timeout_ms) {
-            /* Timeout - kill child process */
-            kill(pid, SIGKILL);
-            waitpid(pid, &status, 0);
-
-            if (output && output_size > 0) {
-                snprintf(output, output_size,
-                         "{\"error\":\"Command timed out after %d ms\"}", timeout_ms);
-            }
-            if (exit_code) *exit_code = -1;
-            return ARC_ERR_TIMEOUT;
-        }
-    } else {
-        /* No timeout - wait indefinitely */
-        wait_result = waitpid(pid, &status, 0);
-        if (wait_result < 0) {
-            AC_LOG_ERROR("waitpid failed: %s", strerror(errno));
-            return ARC_ERR_IO;
-        }
-    }
-
-    /* Extract exit code */
-    if (exit_code) {
-        if (WIFEXITED(status)) {
-            *exit_code = WEXITSTATUS(status);
-        } else if (WIFSIGNALED(status)) {
-            *exit_code = 128 + WTERMSIG(status);
-        } else {
-            *exit_code = -1;
-        }
-    }
-
-    return ARC_OK;
+    /*
+     * NOTE: We do NOT enter Landlock sandbox in child process.
+     *
+     * Reason: Landlock has compatibility issues with special filesystems
+     * like /dev, /proc, /sys which are needed by many commands (git, etc.)
+     *
+     * Security is ensured by:
+     * 1. Software-level command validation (ac_sandbox_check_command)
+     * 2. Human-in-the-loop confirmation for dangerous operations
+     * 3. The command has already been approved before reaching here
+     *
+     * This approach trades kernel-level enforcement for better compatibility
+     * while maintaining security through explicit user consent.
+     *
+     * Callers that want it anyway start a pool with enforce set: its
+     * workers run under Landlock applied once in the zygote.
+     */
+    return ac_sandbox_run_command(sandbox, command, opts, exit_code);
 }
 
 arc_err_t ac_sandbox_exec(
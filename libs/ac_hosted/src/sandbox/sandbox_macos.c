@@ -176,31 +176,37 @@ int ac_sandbox_is_supported(void) {
     return 1;
 }
 
+static const ac_sandbox_caps_t g_caps = {
+    .platform = "macOS",
+    .backend = AC_SANDBOX_BACKEND_SEATBELT,
+    .backend_name = "Seatbelt",
+    .level = AC_SANDBOX_LEVEL_FULL,
+    .info = "{"
+            "\"platform\":\"macOS\","
+            "\"backend\":\"Seatbelt\","
+            "\"level\":\"full\","
+            "\"seatbelt_available\":true"
+            "}",
+};
+
+const ac_sandbox_caps_t *ac_sandbox_capabilities(void) {
+    return &g_caps;
+}
+
 ac_sandbox_backend_t ac_sandbox_get_backend(void) {
-    return AC_SANDBOX_BACKEND_SEATBELT;
+    return g_caps.backend;
 }
 
 const char *ac_sandbox_backend_name(void) {
-    return "Seatbelt";
+    return g_caps.backend_name;
 }
 
 ac_sandbox_level_t ac_sandbox_get_level(void) {
-    return AC_SANDBOX_LEVEL_FULL;
+    return g_caps.level;
 }
 
 const char *ac_sandbox_platform_info(void) {
-    static char info[256];
-
-    snprintf(info, sizeof(info),
-        "{"
-        "\"platform\":\"macOS\","
-        "\"backend\":\"Seatbelt\","
-        "\"level\":\"full\","
-        "\"seatbelt_available\":true"
-        "}"
-    );
-
-    return info;
+    return g_caps.info;
 }
 
 ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
@@ -255,6 +261,8 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
     sandbox->allow_process_exec = config->allow_process_exec;
     sandbox->strict_mode = config->strict_mode;
     sandbox->log_violations = config->log_violations;
+    sandbox->admit = ac_sandbox_admit_create(config->max_concurrent_execs,
+                                             config->max_execs_per_owner);
 
     /* Copy path rules */
     if (config->path_rules && config->path_rules_count > 0) {
@@ -282,6 +290,34 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
         }
     }
 
+    /* Compile the command screening patterns */
+    sandbox->command_matcher = ac_sandbox_command_matcher_create(config);
+    if (!sandbox->command_matcher) {
+        ac_sandbox_destroy(sandbox);
+        ac_sandbox_set_error(
+            AC_SANDBOX_ERR_INTERNAL,
+            "Memory allocation failed",
+            "Failed to compile the dangerous command patterns.",
+            "Check available memory.",
+            NULL, errno
+        );
+        return NULL;
+    }
+
+    /* Compile the path rules */
+    sandbox->paths = ac_sandbox_paths_compile(sandbox, 1, ac_sandbox_normalize_path);
+    if (!sandbox->paths) {
+        ac_sandbox_destroy(sandbox);
+        ac_sandbox_set_error(
+            AC_SANDBOX_ERR_INTERNAL,
+            "Memory allocation failed",
+            "Failed to compile the sandbox path rules.",
+            "Check available memory.",
+            NULL, errno
+        );
+        return NULL;
+    }
+
     sandbox->backend = AC_SANDBOX_BACKEND_SEATBELT;
     sandbox->level = AC_SANDBOX_LEVEL_FULL;
 
@@ -293,7 +329,7 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
         return NULL;
     }
 
-    AC_LOG_INFO("Created macOS sandbox (Seatbelt)");
+    AC_LOG_DEBUG("Created macOS sandbox (Seatbelt)");
     AC_LOG_DEBUG("Sandbox profile:\n%s", data->profile);
 
     return sandbox;
@@ -381,12 +417,17 @@ void ac_sandbox_destroy(ac_sandbox_t *sandbox) {
         return;
     }
 
+    ac_sandbox_pool_stop(sandbox);
+    ac_sandbox_admit_free(sandbox->admit);
+
     macos_sandbox_data_t *data = (macos_sandbox_data_t *)sandbox->platform_data;
     if (data) {
         free(data->profile);
         free(data);
     }
 
+    ac_sandbox_matcher_free(sandbox->command_matcher);
+    ac_sandbox_paths_free(sandbox->paths);
     free(sandbox->workspace_path);
 
     if (sandbox->path_rules) {
@@ -420,41 +461,13 @@ int ac_sandbox_check_path(
         return 0;
     }
 
-    /* Check workspace path */
-    if (sandbox->workspace_path &&
-        ac_sandbox_path_is_under(sandbox->workspace_path, path)) {
+    /* Workspace, path rules and readonly paths (sandbox_paths.c) */
+    char normalized[4096];
+    if (ac_sandbox_paths_normalize(sandbox->paths, path, normalized, sizeof(normalized)) == 0 &&
+        ac_sandbox_paths_allows(sandbox->paths, normalized, permissions)) {
         return 1;
     }
 
-    /* Check custom path rules */
-    for (size_t i = 0; i < sandbox->path_rules_count; i++) {
-        const ac_sandbox_path_rule_t *rule = &sandbox->path_rules[i];
-        if (ac_sandbox_path_is_under(rule->path, path)) {
-            if ((rule->permissions & permissions) == permissions) {
-                return 1;
-            }
-        }
-    }
-
-    /* Check readonly paths for read-only access */
-    if ((permissions & ~AC_SANDBOX_PERM_FS_READ) == 0) {
-        if (sandbox->readonly_paths) {
-            for (int i = 0; sandbox->readonly_paths[i]; i++) {
-                if (ac_sandbox_path_is_under(sandbox->readonly_paths[i], path)) {
-                    return 1;
-                }
-            }
-        }
-
-        /* Check default readonly paths */
-        const char **defaults = ac_sandbox_get_default_readonly_paths();
-        for (int i = 0; defaults[i]; i++) {
-            if (ac_sandbox_path_is_under(defaults[i], path)) {
-                return 1;
-            }
-        }
-    }
-
     /* Path not in allowed list - request human confirmation */
     if (sandbox->session_allow_external_paths) {
         return 1;
@@ -501,7 +514,7 @@ int ac_sandbox_check_command(
     }
 
     /* Check for dangerous command patterns */
-    if (ac_sandbox_is_command_dangerous(command)) {
+    if (ac_sandbox_is_command_dangerous(sandbox, command)) {
         if (!sandbox->session_allow_dangerous_commands) {
             ac_sandbox_confirm_request_t request = {
                 .type = AC_SANDBOX_CONFIRM_DANGEROUS,
@@ -561,13 +574,11 @@ int ac_sandbox_check_command(
  * Sandboxed Subprocess Execution
  *============================================================================*/
 
-arc_err_t ac_sandbox_exec_timeout(
+arc_err_t ac_sandbox_exec_platform(
     ac_sandbox_t *sandbox,
     const char *command,
-    char *output,
-    size_t output_size,
-    int *exit_code,
-    int timeout_ms
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
 ) {
     if (!sandbox || !command) {
         return ARC_ERR_INVALID_ARG;
@@ -575,8 +586,8 @@ arc_err_t ac_sandbox_exec_timeout(
 
     /* First check if command is allowed */
     if (!ac_sandbox_check_command(sandbox, command)) {
-        if (output && output_size > 0) {
-            snprintf(output, output_size,
+        if (opts->output && opts->output_size > 0) {
+            snprintf(opts->output, opts->output_size,
                      "{\"error\":\"Command blocked by sandbox\",\"reason\":\"%s\"}",
                      ac_sandbox_denial_reason());
         }
@@ -584,104 +595,12 @@ arc_err_t ac_sandbox_exec_timeout(
         return ARC_ERR_INVALID_ARG;
     }
 
-    /* Create pipe for capturing output */
-    int pipefd[2];
-    if (pipe(pipefd) < 0) {
-        AC_LOG_ERROR("Failed to create pipe: %s", strerror(errno));
-        return ARC_ERR_IO;
-    }
-
-    pid_t pid = fork();
-
-    if (pid < 0) {
-        close(pipefd[0]);
-        close(pipefd[1]);
-        AC_LOG_ERROR("Fork failed: %s", strerror(errno));
-        return ARC_ERR_IO;
-    }
-
-    if (pid == 0) {
-        /* ===== Child process ===== */
-        close(pipefd[0]);
-        dup2(pipefd[1], STDOUT_FILENO);
-        dup2(pipefd[1], STDERR_FILENO);
-        close(pipefd[1]);
-
-        /*
-         * NOTE: We do NOT enter Seatbelt sandbox in child process.
-         * Security is ensured by software-level checks and human confirmation.
-         * The command has already been validated before reaching here.
-         */
-
-        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
-        fprintf(stderr, "execl failed: %s\n", strerror(errno));
-        _exit(127);
-    }
-
-    /* ===== Parent process ===== */
-    close(pipefd[1]);
-
-    if (output && output_size > 0) {
-        output[0] = '\0';
-        size_t total_read = 0;
-        char buf[256];
-        ssize_t n;
-
-        while ((n = read(pipefd[0], buf, sizeof(buf) - 1)) > 0) {
-            buf[n] = '\0';
-            size_t remaining = output_size - total_read - 1;
-            if (remaining > 0) {
-                size_t to_copy = (size_t)n < remaining ? (size_t)n : remaining;
-                memcpy(output + total_read, buf, to_copy);
-                total_read += to_copy;
-                output[total_read] = '\0';
-            }
-        }
-    }
-
-    close(pipefd[0]);
-
-    int status;
-    pid_t wait_result;
-
-    if (timeout_ms > 0) {
-        int waited_ms = 0;
-        int interval_ms = 10;
-
-        while (waited_ms < timeout_ms) {
-            wait_result = waitpid(pid, &status, WNOHANG);
-            if (wait_result == pid) break;
-            if (wait_result < 0) return ARC_ERR_IO;
-            usleep(interval_ms * 1000);
-            waited_ms += interval_ms;
-        }
-
-        if (waited_ms >= timeout_ms) {
-            kill(pid, SIGKILL);
-            waitpid(pid, &status, 0);
-            if (output && output_size > 0) {
-                snprintf(output, output_size,
-                         "{\"error\":\"Command timed out after %d ms\"}", timeout_ms);
-            }
-            if (exit_code) *exit_code = -1;
-            return ARC_ERR_TIMEOUT;
-        }
-    } else {
-        wait_result = waitpid(pid, &status, 0);
-        if (wait_result < 0) return ARC_ERR_IO;
-    }
-
-    if (exit_code) {
-        if (WIFEXITED(status)) {
-            *exit_code = WEXITSTATUS(status);
-        } else if (WIFSIGNALED(status)) {
-            *exit_code = 128 + WTERMSIG(status);
-        } else {
-            *exit_code = -1;
-        }
-    }
-
-    return ARC_OK;
+    /*
+     * NOTE: We do NOT enter Seatbelt sandbox in child process.
+     * Security is ensured by software-level checks and human confirmation.
+     * The command has already been validated before reaching here.
+     */
+    return ac_sandbox_run_command(sandbox, command, opts, exit_code);
 }
 
 arc_err_t ac_sandbox_exec(
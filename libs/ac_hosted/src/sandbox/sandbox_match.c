@@ -0,0 +1,708 @@
+/**
+ * @file sandbox_match.c
+ * @brief Shell-aware multi-pattern matching for command screening
+ *
+ * A command is split into words and operators the way /bin/sh splits it
+ * (quotes, backslashes, comments, $(...) and backticks) and written out
+ * as a canonical stream in which every word and operator is preceded by
+ * MATCH_SEP, with one more at the end. Patterns go through the same
+ * tokenizer, so they only match whole words, whatever the quoting:
+ *
+ *   "rm -rf /"   SEP rm SEP -rf SEP /     the last word may be a prefix
+ *   "sudo "      SEP sudo SEP             trailing space: whole word only
+ *
+ * Quoted text is one word, so `echo "rm -rf /"` does not match. It is
+ * scanned again as a command of its own (`sh -c '...'`, `ssh host "..."`)
+ * unless the command it belongs to only prints or searches text.
+ *
+ * All patterns are compiled into a single Aho-Corasick automaton, stored
+ * as a DFA over byte classes, so screening is one pass over the stream
+ * however many patterns there are.
+ */
+
+#include "sandbox_internal.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Precedes every word and operator in the canonical stream */
+#define MATCH_SEP '\x1f'
+
+/* Nesting of $(...), backticks and re-scanned quoted text */
+#define MATCH_MAX_DEPTH 4
+
+/* Depth patterns are tokenized at: taken literally, nothing added */
+#define MATCH_PATTERN_DEPTH MATCH_MAX_DEPTH
+
+/* Returned when a command could not be screened (out of memory) */
+#define MATCH_UNSCREENED "(command could not be screened)"
+
+/*============================================================================
+ * Tokenizer
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;
+} match_buf_t;
+
+static void buf_putc(match_buf_t *b, char c) {
+    if (b->len == b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 256;
+        char *data = realloc(b->data, cap);
+        if (!data) {
+            b->failed = 1;
+            return;
+        }
+        b->data = data;
+        b->cap = cap;
+    }
+    b->data[b->len++] = c;
+}
+
+static void buf_append(match_buf_t *b, const char *data, size_t len) {
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 256;
+        while (cap < b->len + len) {
+            cap *= 2;
+        }
+        char *grown = realloc(b->data, cap);
+        if (!grown) {
+            b->failed = 1;
+            return;
+        }
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+/* Bytes with a meaning of their own, by quote state */
+#define SPECIAL_BARE   0x01         /* Outside quotes */
+#define SPECIAL_DOUBLE 0x02         /* Inside "..." */
+#define SPECIAL_SINGLE 0x04         /* Inside '...' */
+#define SPECIAL_ALL    (SPECIAL_BARE | SPECIAL_DOUBLE | SPECIAL_SINGLE)
+
+static const uint8_t g_special[256] = {
+    [0] = SPECIAL_ALL, [(unsigned char)MATCH_SEP] = SPECIAL_ALL,
+    ['\t'] = SPECIAL_BARE, ['\n'] = SPECIAL_BARE, ['\r'] = SPECIAL_BARE, [' '] = SPECIAL_BARE,
+    ['\\'] = SPECIAL_BARE | SPECIAL_DOUBLE, ['"'] = SPECIAL_BARE | SPECIAL_DOUBLE,
+    ['`'] = SPECIAL_BARE | SPECIAL_DOUBLE, ['$'] = SPECIAL_BARE | SPECIAL_DOUBLE,
+    ['\''] = SPECIAL_BARE | SPECIAL_SINGLE,
+    ['('] = SPECIAL_BARE, [')'] = SPECIAL_BARE, [';'] = SPECIAL_BARE, ['&'] = SPECIAL_BARE,
+    ['|'] = SPECIAL_BARE, ['<'] = SPECIAL_BARE, ['>'] = SPECIAL_BARE, ['#'] = SPECIAL_BARE,
+};
+
+/**
+ * @brief Length of the run at s with no special meaning in this quote state
+ *
+ * Such bytes are copied into the current word as they are.
+ */
+static size_t plain_run(const char *s, size_t n, char quote) {
+    uint8_t mask = quote == '\'' ? SPECIAL_SINGLE : quote == '"' ? SPECIAL_DOUBLE : SPECIAL_BARE;
+    size_t i = 0;
+    while (i < n && !(g_special[(unsigned char)s[i]] & mask)) {
+        i++;
+    }
+    return i;
+}
+
+/* Commands whose quoted arguments are text, not shell code */
+static const struct {
+    const char *name;
+    size_t len;
+} g_inert_commands[] = {
+    { "echo", 4 }, { "printf", 6 }, { "grep", 4 }, { "egrep", 5 },
+    { "fgrep", 5 }, { "rg", 2 }, { "git", 3 },
+};
+
+/* Two-character operators; the first character alone is one too */
+static const char g_operators2[][2] = {
+    { '&', '&' }, { '|', '|' }, { ';', ';' }, { '>', '>' }, { '<', '<' },
+    { '&', '>' }, { '>', '&' }, { '>', '|' }, { '|', '&' },
+};
+
+typedef struct {
+    char kind;                      /* '(' for $(...), '`' for backticks */
+    char quote;                     /* Quote state to return to */
+    int parens;                     /* Unmatched '(' inside */
+    int at_head;                    /* Command state to return to */
+    int head_inert;
+} match_ctx_t;
+
+typedef struct {
+    size_t start;
+    size_t len;
+} match_span_t;
+
+typedef struct {
+    match_buf_t *out;
+    int depth;
+
+    int in_word;
+    int word_quoted;
+    size_t word_start;
+
+    int at_head;                    /* Next word names a command */
+    int head_inert;
+
+    match_span_t *rescan;           /* Quoted words to scan as commands */
+    size_t rescan_count;
+    size_t rescan_cap;
+} match_lexer_t;
+
+static void lex_begin_word(match_lexer_t *lx) {
+    if (!lx->in_word) {
+        buf_putc(lx->out, MATCH_SEP);
+        lx->in_word = 1;
+        lx->word_quoted = 0;
+        lx->word_start = lx->out->len;
+    }
+}
+
+static void lex_putc(match_lexer_t *lx, char c) {
+    lex_begin_word(lx);
+    buf_putc(lx->out, c == MATCH_SEP || c == '\0' ? ' ' : c);
+}
+
+static int is_assignment(const char *word, size_t len) {
+    size_t i = 0;
+    while (i < len && (word[i] == '_' || (word[i] >= 'a' && word[i] <= 'z') ||
+                       (word[i] >= 'A' && word[i] <= 'Z') ||
+                       (i > 0 && word[i] >= '0' && word[i] <= '9'))) {
+        i++;
+    }
+    return i > 0 && i < len && word[i] == '=';
+}
+
+static int is_inert(const char *word, size_t len) {
+    const char *slash = NULL;
+    for (size_t i = 0; i < len; i++) {
+        if (word[i] == '/') {
+            slash = word + i;
+        }
+    }
+    if (slash) {
+        len -= (size_t)(slash + 1 - word);
+        word = slash + 1;
+    }
+    for (size_t i = 0; i < sizeof(g_inert_commands) / sizeof(g_inert_commands[0]); i++) {
+        if (g_inert_commands[i].len == len && memcmp(g_inert_commands[i].name, word, len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Follow a command given by path with its bare name
+ *
+ * `/usr/bin/sudo ls` then matches "sudo " as `sudo ls` does.
+ */
+static void emit_basename(match_buf_t *out, size_t start, size_t len) {
+    size_t base = len;
+    while (base > 0 && out->data[start + base - 1] != '/') {
+        base--;
+    }
+    if (base == 0 || base == len) {
+        return;
+    }
+    buf_putc(out, MATCH_SEP);
+    for (size_t i = base; i < len && !out->failed; i++) {
+        buf_putc(out, out->data[start + i]);
+    }
+}
+
+static void lex_end_word(match_lexer_t *lx) {
+    if (!lx->in_word) {
+        return;
+    }
+    lx->in_word = 0;
+    if (lx->out->failed) {
+        return;
+    }
+
+    const char *word = lx->out->data + lx->word_start;
+    size_t len = lx->out->len - lx->word_start;
+    if (lx->at_head) {
+        if (!is_assignment(word, len)) {
+            lx->at_head = 0;
+            lx->head_inert = is_inert(word, len);
+            if (lx->depth < MATCH_PATTERN_DEPTH) {
+                emit_basename(lx->out, lx->word_start, len);
+            }
+        }
+        return;
+    }
+
+    if (lx->word_quoted && !lx->head_inert && lx->depth + 1 < MATCH_MAX_DEPTH) {
+        if (lx->rescan_count == lx->rescan_cap) {
+            size_t cap = lx->rescan_cap ? lx->rescan_cap * 2 : 8;
+            match_span_t *spans = realloc(lx->rescan, cap * sizeof(*spans));
+            if (!spans) {
+                lx->out->failed = 1;
+                return;
+            }
+            lx->rescan = spans;
+            lx->rescan_cap = cap;
+        }
+        lx->rescan[lx->rescan_count++] = (match_span_t){ lx->word_start, len };
+    }
+}
+
+/**
+ * @brief Emit an operator; those that end a command make the next word a head
+ */
+static void lex_op_n(match_lexer_t *lx, const char *op, size_t len) {
+    lex_end_word(lx);
+    buf_putc(lx->out, MATCH_SEP);
+    for (size_t i = 0; i < len; i++) {
+        buf_putc(lx->out, op[i]);
+    }
+    int redirect = op[0] == '<' || op[0] == '>' || (len == 2 && op[1] == '>');
+    if (!redirect) {
+        lx->at_head = 1;
+        lx->head_inert = 0;
+    }
+}
+
+static void lex_op(match_lexer_t *lx, const char *op) {
+    lex_op_n(lx, op, strlen(op));
+}
+
+/**
+ * @brief Length of the operator at s: "<<<", a two-character one, or 1
+ */
+static size_t op_length(const char *s, size_t n) {
+    if (n >= 3 && s[0] == '<' && s[1] == '<' && s[2] == '<') {
+        return 3;
+    }
+    if (n >= 2) {
+        for (size_t k = 0; k < sizeof(g_operators2) / sizeof(g_operators2[0]); k++) {
+            if (s[0] == g_operators2[k][0] && s[1] == g_operators2[k][1]) {
+                return 2;
+            }
+        }
+    }
+    return 1;
+}
+
+static int tokenize(const char *s, size_t n, int depth, match_buf_t *out);
+
+/**
+ * @brief Leave a $(...) or backtick substitution, back in the enclosing command
+ */
+static void lex_pop(match_lexer_t *lx, const match_ctx_t *ctx, char *quote) {
+    *quote = ctx->quote;
+    lx->at_head = ctx->at_head;
+    lx->head_inert = ctx->head_inert;
+}
+
+/**
+ * @brief Scan the quoted words collected by a pass as commands
+ */
+static void lex_rescan(match_lexer_t *lx) {
+    for (size_t i = 0; i < lx->rescan_count && !lx->out->failed; i++) {
+        match_span_t span = lx->rescan[i];
+        char *text = malloc(span.len + 1);
+        if (!text) {
+            lx->out->failed = 1;
+            break;
+        }
+        memcpy(text, lx->out->data + span.start, span.len);
+        buf_putc(lx->out, MATCH_SEP);
+        buf_putc(lx->out, ';');
+        tokenize(text, span.len, lx->depth + 1, lx->out);
+        free(text);
+    }
+}
+
+/**
+ * @brief Append the canonical words and operators of s to out
+ * @return 0, or -1 if out of memory
+ */
+static int tokenize(const char *s, size_t n, int depth, match_buf_t *out) {
+    match_lexer_t lx = { .out = out, .depth = depth, .at_head = 1 };
+    match_ctx_t stack[MATCH_MAX_DEPTH];
+    int sp = 0;
+    char quote = 0;
+
+    for (size_t i = 0; i < n && !out->failed; i++) {
+        size_t run = plain_run(s + i, n - i, quote);
+        if (run > 0) {
+            lex_begin_word(&lx);
+            lx.word_quoted |= quote != 0;
+            buf_append(out, s + i, run);
+            i += run - 1;
+            continue;
+        }
+
+        char c = s[i];
+        char next = i + 1 < n ? s[i + 1] : '\0';
+
+        if (quote == '\'') {
+            if (c == '\'') {
+                quote = 0;
+            } else {
+                lex_putc(&lx, c);
+                lx.word_quoted = 1;
+            }
+            continue;
+        }
+
+        /* Command substitution runs even inside double quotes */
+        if (((c == '$' && next == '(') || c == '`') &&
+            !(c == '`' && quote == 0 && sp > 0 && stack[sp - 1].kind == '`')) {
+            if (sp < MATCH_MAX_DEPTH) {
+                stack[sp++] = (match_ctx_t){ c == '`' ? '`' : '(', quote, 0,
+                                             lx.at_head, lx.head_inert };
+                quote = 0;
+                lex_op(&lx, c == '`' ? "`" : "$(");
+                i += c == '$';
+            } else {
+                lex_putc(&lx, c);
+            }
+            continue;
+        }
+
+        if (quote == '"') {
+            if (c == '"') {
+                quote = 0;
+            } else if (c == '\\' && next && strchr("$`\"\\\n", next)) {
+                lex_putc(&lx, next);
+                i++;
+            } else {
+                lex_putc(&lx, c);
+            }
+            lx.word_quoted = 1;
+            continue;
+        }
+
+        switch (c) {
+        case '\\':
+            if (next == '\n') {
+                i++;
+            } else if (next) {
+                lex_putc(&lx, next);
+                lx.word_quoted = 1;
+                i++;
+            }
+            continue;
+        case ' ':
+        case '\t':
+        case '\r':
+            lex_end_word(&lx);
+            continue;
+        case '\n':
+            lex_op(&lx, ";");
+            continue;
+        case '#':
+            if (!lx.in_word) {
+                while (i + 1 < n && s[i + 1] != '\n') {
+                    i++;
+                }
+                continue;
+            }
+            break;
+        case '\'':
+        case '"':
+            lex_begin_word(&lx);
+            lx.word_quoted = 1;
+            quote = c;
+            continue;
+        case '`':
+            /* Closes the innermost backtick substitution */
+            lex_op(&lx, "`");
+            lex_pop(&lx, &stack[--sp], &quote);
+            continue;
+        case '(':
+            if (sp > 0 && stack[sp - 1].kind == '(') {
+                stack[sp - 1].parens++;
+            }
+            lex_op(&lx, "(");
+            continue;
+        case ')':
+            lex_op(&lx, ")");
+            if (sp > 0 && stack[sp - 1].kind == '(') {
+                if (stack[sp - 1].parens > 0) {
+                    stack[sp - 1].parens--;
+                } else {
+                    lex_pop(&lx, &stack[--sp], &quote);
+                }
+            }
+            continue;
+        case ';':
+        case '&':
+        case '|':
+        case '<':
+        case '>': {
+            size_t len = op_length(s + i, n - i);
+            lex_op_n(&lx, s + i, len);
+            i += len - 1;
+            continue;
+        }
+        default:
+            break;
+        }
+        lex_putc(&lx, c);
+    }
+    lex_end_word(&lx);
+
+    lex_rescan(&lx);
+    free(lx.rescan);
+    return out->failed ? -1 : 0;
+}
+
+/*============================================================================
+ * Automaton
+ *============================================================================*/
+
+typedef struct {
+    char *text;                     /* As added, for reporting */
+    char *canon;                    /* Canonical form */
+    size_t canon_len;
+    int safe;
+} match_pattern_t;
+
+struct ac_sandbox_matcher {
+    match_pattern_t *patterns;
+    size_t count;
+    size_t cap;
+
+    /* Built by ac_sandbox_matcher_build() */
+    uint8_t classes[256];           /* Byte -> class; 0 = in no pattern */
+    int class_count;
+    int32_t *delta;                 /* state * class_count + class -> state */
+    int32_t *match;                 /* Pattern ending at a state, or -1 */
+    int32_t *out_link;              /* Nearest shorter suffix state with a match */
+};
+
+ac_sandbox_matcher_t *ac_sandbox_matcher_new(void) {
+    return calloc(1, sizeof(ac_sandbox_matcher_t));
+}
+
+static void matcher_clear(ac_sandbox_matcher_t *m) {
+    free(m->delta);
+    free(m->match);
+    free(m->out_link);
+    m->delta = NULL;
+    m->match = NULL;
+    m->out_link = NULL;
+}
+
+void ac_sandbox_matcher_free(ac_sandbox_matcher_t *m) {
+    if (!m) {
+        return;
+    }
+    for (size_t i = 0; i < m->count; i++) {
+        free(m->patterns[i].text);
+        free(m->patterns[i].canon);
+    }
+    free(m->patterns);
+    matcher_clear(m);
+    free(m);
+}
+
+int ac_sandbox_matcher_add(ac_sandbox_matcher_t *m, const char *pattern, int safe) {
+    if (!m || !pattern) {
+        return -1;
+    }
+
+    match_buf_t canon = { 0 };
+    size_t len = strlen(pattern);
+    tokenize(pattern, len, MATCH_PATTERN_DEPTH, &canon);
+    if (len > 0 && (pattern[len - 1] == ' ' || pattern[len - 1] == '\t')) {
+        buf_putc(&canon, MATCH_SEP);
+    }
+    if (canon.failed || canon.len == 0) {
+        free(canon.data);
+        return canon.failed ? -1 : 0;
+    }
+
+    if (m->count == m->cap) {
+        size_t cap = m->cap ? m->cap * 2 : 32;
+        match_pattern_t *patterns = realloc(m->patterns, cap * sizeof(*patterns));
+        if (!patterns) {
+            free(canon.data);
+            return -1;
+        }
+        m->patterns = patterns;
+        m->cap = cap;
+    }
+    char *text = strdup(pattern);
+    if (!text) {
+        free(canon.data);
+        return -1;
+    }
+    m->patterns[m->count++] = (match_pattern_t){ text, canon.data, canon.len, safe };
+    return 0;
+}
+
+int ac_sandbox_matcher_build(ac_sandbox_matcher_t *m) {
+    if (!m) {
+        return -1;
+    }
+    matcher_clear(m);
+
+    /* Byte classes: one per byte used by some pattern, 0 for the rest */
+    memset(m->classes, 0, sizeof(m->classes));
+    m->class_count = 1;
+    size_t total = 1;
+    for (size_t i = 0; i < m->count; i++) {
+        for (size_t j = 0; j < m->patterns[i].canon_len; j++) {
+            unsigned char b = (unsigned char)m->patterns[i].canon[j];
+            if (m->classes[b] == 0) {
+                m->classes[b] = (uint8_t)m->class_count++;
+            }
+        }
+        total += m->patterns[i].canon_len;
+    }
+
+    int classes = m->class_count;
+    m->delta = malloc(total * (size_t)classes * sizeof(int32_t));
+    m->match = malloc(total * sizeof(int32_t));
+    m->out_link = malloc(total * sizeof(int32_t));
+    int32_t *fail = malloc(total * sizeof(int32_t));
+    int32_t *queue = malloc(total * sizeof(int32_t));
+    if (!m->delta || !m->match || !m->out_link || !fail || !queue) {
+        free(fail);
+        free(queue);
+        matcher_clear(m);
+        return -1;
+    }
+    for (size_t i = 0; i < total * (size_t)classes; i++) {
+        m->delta[i] = -1;
+    }
+
+    /* Trie */
+    int states = 1;
+    m->match[0] = -1;
+    for (size_t i = 0; i < m->count; i++) {
+        int32_t s = 0;
+        for (size_t j = 0; j < m->patterns[i].canon_len; j++) {
+            int c = m->classes[(unsigned char)m->patterns[i].canon[j]];
+            int32_t *next = &m->delta[(size_t)s * (size_t)classes + (size_t)c];
+            if (*next < 0) {
+                m->match[states] = -1;
+                *next = states++;
+            }
+            s = *next;
+        }
+        if (m->match[s] < 0) {
+            m->match[s] = (int32_t)i;
+        }
+    }
+
+    /* Failure links, breadth first, folded into the transition table */
+    size_t head = 0;
+    size_t tail = 0;
+    fail[0] = 0;
+    m->out_link[0] = -1;
+    for (int c = 0; c < classes; c++) {
+        int32_t t = m->delta[c];
+        if (t < 0) {
+            m->delta[c] = 0;
+        } else {
+            fail[t] = 0;
+            m->out_link[t] = -1;
+            queue[tail++] = t;
+        }
+    }
+    while (head < tail) {
+        int32_t s = queue[head++];
+        int32_t *row = &m->delta[(size_t)s * (size_t)classes];
+        const int32_t *fail_row = &m->delta[(size_t)fail[s] * (size_t)classes];
+        for (int c = 0; c < classes; c++) {
+            int32_t t = row[c];
+            if (t < 0) {
+                row[c] = fail_row[c];
+                continue;
+            }
+            int32_t f = fail_row[c];
+            fail[t] = f;
+            m->out_link[t] = m->match[f] >= 0 ? f : m->out_link[f];
+            queue[tail++] = t;
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+const char *ac_sandbox_matcher_find(const ac_sandbox_matcher_t *m, const char *command) {
+    if (!m || !command || !m->delta) {
+        return NULL;
+    }
+
+    match_buf_t canon = { 0 };
+    tokenize(command, strlen(command), 0, &canon);
+    buf_putc(&canon, MATCH_SEP);
+    if (canon.failed) {
+        free(canon.data);
+        return MATCH_UNSCREENED;
+    }
+
+    /* Starts of safe matches, and the first dangerous match not yet exempted */
+    size_t *safe_starts = NULL;
+    size_t safe_count = 0;
+    size_t safe_cap = 0;
+    size_t *hits = NULL;
+    size_t hit_count = 0;
+    size_t hit_cap = 0;
+    const char *found = NULL;
+
+    int32_t s = 0;
+    for (size_t i = 0; i < canon.len; i++) {
+        if (s == 0) {
+            /* Every pattern starts with MATCH_SEP; skip to the next word */
+            const char *sep = memchr(canon.data + i, MATCH_SEP, canon.len - i);
+            if (!sep) {
+                break;
+            }
+            i = (size_t)(sep - canon.data);
+        }
+        s = m->delta[(size_t)s * (size_t)m->class_count +
+                     m->classes[(unsigned char)canon.data[i]]];
+        for (int32_t t = m->match[s] >= 0 ? s : m->out_link[s]; t >= 0; t = m->out_link[t]) {
+            const match_pattern_t *p = &m->patterns[m->match[t]];
+            size_t start = i + 1 - p->canon_len;
+            size_t **list = p->safe ? &safe_starts : &hits;
+            size_t *count = p->safe ? &safe_count : &hit_count;
+            size_t *cap = p->safe ? &safe_cap : &hit_cap;
+            if (*count == *cap) {
+                size_t grown = *cap ? *cap * 2 : 8;
+                size_t *items = realloc(*list, grown * 2 * sizeof(size_t));
+                if (!items) {
+                    found = MATCH_UNSCREENED;
+                    goto done;
+                }
+                *list = items;
+                *cap = grown;
+            }
+            (*list)[*count * 2] = start;
+            (*list)[*count * 2 + 1] = (size_t)m->match[t];
+            (*count)++;
+        }
+    }
+
+    /* A safe pattern exempts dangerous ones starting at the same word */
+    for (size_t h = 0; h < hit_count && !found; h++) {
+        int exempt = 0;
+        for (size_t k = 0; k < safe_count && !exempt; k++) {
+            exempt = safe_starts[k * 2] == hits[h * 2];
+        }
+        if (!exempt) {
+            found = m->patterns[hits[h * 2 + 1]].text;
+        }
+    }
+
+done:
+    free(safe_starts);
+    free(hits);
+    free(canon.data);
+    return found;
+}
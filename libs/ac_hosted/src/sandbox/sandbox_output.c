@@ -0,0 +1,239 @@
+/**
+ * @file sandbox_output.c
+ * @brief Unbounded command output for ac_sandbox_exec_capture()
+ *
+ * Output is written to an anonymous file as it arrives: a memfd on Linux,
+ * an unlinked temporary file elsewhere. Once the command is done the file
+ * is mapped read-only, so the caller sees all of it without a buffer sized
+ * for the worst case, and pages it never touches are never read back.
+ * Windows keeps the output on the heap.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* memfd_create */
+#endif
+
+#include <arc/sandbox.h>
+#include <arc/log.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if !defined(_WIN32)
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct ac_sandbox_output {
+    char *data;                      /* Mapping (or heap copy on Windows) */
+    size_t len;
+#if !defined(_WIN32)
+    int fd;
+    int failed;                      /* A write failed; the file is short */
+#else
+    size_t cap;
+#endif
+    ac_sandbox_output_fn forward;    /* Caller's on_output */
+    void *forward_data;
+};
+
+/*============================================================================
+ * Spill File
+ *============================================================================*/
+
+#if !defined(_WIN32)
+
+static int spill_open(void) {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    int memfd = memfd_create("arc-output", MFD_CLOEXEC);
+    if (memfd >= 0) {
+        return memfd;
+    }
+#endif
+    /* No memfd (older kernel or not Linux): a file nobody else can open */
+    const char *dir = getenv("TMPDIR");
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/arc-output-XXXXXX", dir && dir[0] ? dir : "/tmp");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);
+    return fd;
+}
+
+static void spill_write(ac_sandbox_output_t *out, const char *data, size_t len) {
+    while (len > 0 && !out->failed) {
+        ssize_t n = write(out->fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            AC_LOG_ERROR("Sandbox: cannot spill output: %s", strerror(errno));
+            out->failed = 1;
+            break;
+        }
+        data += n;
+        len -= (size_t)n;
+        out->len += (size_t)n;
+    }
+}
+
+#else /* _WIN32 */
+
+static void spill_write(ac_sandbox_output_t *out, const char *data, size_t len) {
+    if (out->len + len > out->cap) {
+        size_t cap = out->cap ? out->cap : 65536;
+        while (cap < out->len + len) {
+            cap *= 2;
+        }
+        char *grown = realloc(out->data, cap);
+        if (!grown) {
+            return;
+        }
+        out->data = grown;
+        out->cap = cap;
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+#endif /* !_WIN32 */
+
+static void capture_output(ac_sandbox_stream_t stream, const char *data, size_t len,
+                           void *user_data) {
+    ac_sandbox_output_t *out = user_data;
+    spill_write(out, data, len);
+    if (out->forward) {
+        out->forward(stream, data, len, out->forward_data);
+    }
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t ac_sandbox_exec_capture(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    const ac_sandbox_exec_opts_t *opts,
+    ac_sandbox_output_t **output,
+    int *exit_code
+) {
+    if (!output) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *output = NULL;
+
+    ac_sandbox_output_t *out = calloc(1, sizeof(*out));
+    if (!out) {
+        return ARC_ERR_NO_MEMORY;
+    }
+#if !defined(_WIN32)
+    out->fd = spill_open();
+    if (out->fd < 0) {
+        AC_LOG_ERROR("Sandbox: cannot create output file: %s", strerror(errno));
+        free(out);
+        return ARC_ERR_IO;
+    }
+#endif
+
+    ac_sandbox_exec_opts_t run = opts ? *opts : (ac_sandbox_exec_opts_t){ 0 };
+    out->forward = run.on_output;
+    out->forward_data = run.user_data;
+    run.on_output = capture_output;
+    run.user_data = out;
+
+    arc_err_t err = ac_sandbox_exec_ex(sandbox, command, &run, exit_code);
+    if (err != ARC_OK && err != ARC_ERR_TIMEOUT && err != ARC_ERR_CANCELLED) {
+        ac_sandbox_output_free(out);
+        return err;
+    }
+
+#if !defined(_WIN32)
+    if (out->failed) {
+        ac_sandbox_output_free(out);
+        return ARC_ERR_IO;
+    }
+    if (out->len > 0) {
+        void *map = mmap(NULL, out->len, PROT_READ, MAP_PRIVATE, out->fd, 0);
+        if (map == MAP_FAILED) {
+            AC_LOG_ERROR("Sandbox: cannot map output: %s", strerror(errno));
+            ac_sandbox_output_free(out);
+            return ARC_ERR_IO;
+        }
+        out->data = map;
+    }
+#endif
+
+    /* A timeout or stop is still reported; the output up to it is kept */
+    *output = out;
+    return err;
+}
+
+const char *ac_sandbox_output_data(const ac_sandbox_output_t *output, size_t *len) {
+    if (len) {
+        *len = output ? output->len : 0;
+    }
+    return output && output->data ? output->data : "";
+}
+
+const char *ac_sandbox_output_head(const ac_sandbox_output_t *output, size_t max_bytes,
+                                   size_t *len) {
+    size_t total;
+    const char *data = ac_sandbox_output_data(output, &total);
+    size_t n = total;
+    if (n > max_bytes) {
+        /* End after the last complete line that fits */
+        n = max_bytes;
+        while (n > 0 && data[n - 1] != '\n') {
+            n--;
+        }
+        if (n == 0) {
+            n = max_bytes;
+        }
+    }
+    if (len) {
+        *len = n;
+    }
+    return data;
+}
+
+const char *ac_sandbox_output_tail(const ac_sandbox_output_t *output, size_t max_bytes,
+                                   size_t *len) {
+    size_t total;
+    const char *data = ac_sandbox_output_data(output, &total);
+    size_t start = 0;
+    if (total > max_bytes) {
+        /* Start at the first line that begins inside the window */
+        start = total - max_bytes;
+        size_t s = start;
+        while (s < total && data[s - 1] != '\n') {
+            s++;
+        }
+        if (s < total) {
+            start = s;
+        }
+    }
+    if (len) {
+        *len = total - start;
+    }
+    return data + start;
+}
+
+void ac_sandbox_output_free(ac_sandbox_output_t *output) {
+    if (!output) {
+        return;
+    }
+#if !defined(_WIN32)
+    if (output->data) {
+        munmap(output->data, output->len);
+    }
+    close(output->fd);
+#else
+    free(output->data);
+#endif
+    free(output);
+}
@@ -0,0 +1,373 @@
+/**
+ * @file sandbox_paths.c
+ * @brief Compiled path rules for ac_sandbox_check_path()
+ *
+ * The workspace, path rules, readonly paths and default readonly paths
+ * are normalized once, when the sandbox is created, and stored as a trie
+ * of path components. Each node keeps the permission masks of the rules
+ * that end there, so a check walks the checked path once and stops at the
+ * first rule that covers the request:
+ *
+ *   /home/u/proj      all permissions      (workspace)
+ *   /usr              -> lib -> ...        FS_READ (defaults)
+ *
+ * Components are split on every '/', empty ones included, which makes a
+ * walk equivalent to the prefix test of ac_sandbox_path_is_under().
+ *
+ * Checked paths are normalized with realpath() semantics. For absolute
+ * paths the resolved parent directory is kept in a small LRU, so a tool
+ * reading many files of a directory costs one lstat() per file instead of
+ * a realpath() per file per rule. Entries expire after PATHS_CACHE_TTL_MS
+ * and are dropped whenever the sandbox runs a command, which may have
+ * moved or replaced directories.
+ */
+
+#include "sandbox_internal.h"
+#include <arc/platform.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <sys/stat.h>
+#endif
+
+/* Resolved directories kept per sandbox */
+#define PATHS_CACHE_SIZE 32
+
+/* Age after which a resolved directory is looked up again */
+#define PATHS_CACHE_TTL_MS 1000
+
+/*============================================================================
+ * Trie
+ *============================================================================*/
+
+typedef struct paths_node {
+    char *name;                      /* Component (may be empty) */
+    struct paths_node *child;        /* First child */
+    struct paths_node *next;         /* Next sibling */
+    unsigned int *masks;             /* Permissions of rules ending here */
+    size_t mask_count;
+} paths_node_t;
+
+#if !defined(_WIN32)
+typedef struct {
+    char *dir;                       /* Directory as given */
+    char *resolved;                  /* Its realpath() */
+    uint64_t stamp;                  /* When resolved (ms) */
+    uint64_t used;                   /* LRU clock */
+} paths_cache_entry_t;
+#endif
+
+struct ac_sandbox_paths {
+    paths_node_t root;
+#if !defined(_WIN32)
+    pthread_mutex_t lock;
+    paths_cache_entry_t cache[PATHS_CACHE_SIZE];
+    uint64_t clock;
+#endif
+};
+
+static void node_free(paths_node_t *node) {
+    paths_node_t *child = node->child;
+    while (child) {
+        paths_node_t *next = child->next;
+        node_free(child);
+        free(child);
+        child = next;
+    }
+    free(node->name);
+    free(node->masks);
+}
+
+static paths_node_t *node_child(paths_node_t *node, const char *name, size_t len, int create) {
+    for (paths_node_t *c = node->child; c; c = c->next) {
+        if (strncmp(c->name, name, len) == 0 && c->name[len] == '\0') {
+            return c;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    paths_node_t *c = calloc(1, sizeof(*c));
+    if (!c || !(c->name = malloc(len + 1))) {
+        free(c);
+        return NULL;
+    }
+    memcpy(c->name, name, len);
+    c->name[len] = '\0';
+    c->next = node->child;
+    node->child = c;
+    return c;
+}
+
+static int node_allows(const paths_node_t *node, unsigned int permissions) {
+    for (size_t i = 0; i < node->mask_count; i++) {
+        if ((node->masks[i] & permissions) == permissions) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+ac_sandbox_paths_t *ac_sandbox_paths_new(void) {
+    ac_sandbox_paths_t *p = calloc(1, sizeof(*p));
+    if (!p) {
+        return NULL;
+    }
+#if !defined(_WIN32)
+    pthread_mutex_init(&p->lock, NULL);
+#endif
+    return p;
+}
+
+int ac_sandbox_paths_add(ac_sandbox_paths_t *p, const char *normalized, unsigned int permissions) {
+    size_t len = strlen(normalized);
+
+    /* Same trailing slash handling as ac_sandbox_path_is_under() */
+    if (len > 0 && normalized[len - 1] == '/') {
+        len--;
+    }
+
+    paths_node_t *node = &p->root;
+    const char *s = normalized;
+    const char *end = normalized + len;
+    for (;;) {
+        const char *slash = memchr(s, '/', (size_t)(end - s));
+        const char *stop = slash ? slash : end;
+        node = node_child(node, s, (size_t)(stop - s), 1);
+        if (!node) {
+            return -1;
+        }
+        if (!slash) {
+            break;
+        }
+        s = slash + 1;
+    }
+
+    for (size_t i = 0; i < node->mask_count; i++) {
+        if (node->masks[i] == permissions) {
+            return 0;
+        }
+    }
+    unsigned int *masks = realloc(node->masks, (node->mask_count + 1) * sizeof(*masks));
+    if (!masks) {
+        return -1;
+    }
+    masks[node->mask_count++] = permissions;
+    node->masks = masks;
+    return 0;
+}
+
+int ac_sandbox_paths_allows(
+    const ac_sandbox_paths_t *p,
+    const char *normalized,
+    unsigned int permissions
+) {
+    if (!p) {
+        return 0;
+    }
+
+    const paths_node_t *node = &p->root;
+    const char *s = normalized;
+    for (;;) {
+        const char *slash = strchr(s, '/');
+        size_t len = slash ? (size_t)(slash - s) : strlen(s);
+        node = node_child((paths_node_t *)node, s, len, 0);
+        if (!node) {
+            return 0;
+        }
+        if (node_allows(node, permissions)) {
+            return 1;
+        }
+        if (!slash) {
+            return 0;
+        }
+        s = slash + 1;
+    }
+}
+
+ac_sandbox_paths_t *ac_sandbox_paths_compile(
+    const ac_sandbox_t *sandbox,
+    int with_defaults,
+    int (*normalize)(const char *path, char *buffer, size_t size)
+) {
+    ac_sandbox_paths_t *p = ac_sandbox_paths_new();
+    if (!p) {
+        return NULL;
+    }
+
+    char norm[4096];
+    int failed = 0;
+
+    /* Rules that cannot be normalized never matched; leave them out */
+    if (sandbox->workspace_path && normalize(sandbox->workspace_path, norm, sizeof(norm)) == 0) {
+        failed |= ac_sandbox_paths_add(p, norm, ~0u);
+    }
+    for (size_t i = 0; i < sandbox->path_rules_count; i++) {
+        const ac_sandbox_path_rule_t *rule = &sandbox->path_rules[i];
+        if (rule->path && normalize(rule->path, norm, sizeof(norm)) == 0) {
+            failed |= ac_sandbox_paths_add(p, norm, rule->permissions);
+        }
+    }
+
+    /* Readonly paths only cover read-only requests */
+    for (size_t i = 0; sandbox->readonly_paths && sandbox->readonly_paths[i]; i++) {
+        if (normalize(sandbox->readonly_paths[i], norm, sizeof(norm)) == 0) {
+            failed |= ac_sandbox_paths_add(p, norm, AC_SANDBOX_PERM_FS_READ);
+        }
+    }
+    if (with_defaults) {
+        const char **defaults = ac_sandbox_get_default_readonly_paths();
+        for (size_t i = 0; defaults[i]; i++) {
+            if (normalize(defaults[i], norm, sizeof(norm)) == 0) {
+                failed |= ac_sandbox_paths_add(p, norm, AC_SANDBOX_PERM_FS_READ);
+            }
+        }
+    }
+
+    if (failed) {
+        ac_sandbox_paths_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+/*============================================================================
+ * Normalization Cache
+ *============================================================================*/
+
+#if !defined(_WIN32)
+
+static void cache_clear(ac_sandbox_paths_t *p) {
+    for (size_t i = 0; i < PATHS_CACHE_SIZE; i++) {
+        free(p->cache[i].dir);
+        free(p->cache[i].resolved);
+        p->cache[i] = (paths_cache_entry_t){ 0 };
+    }
+}
+
+/**
+ * @brief Copy the resolved form of dir into buffer
+ * @return Length written, or -1 if dir did not resolve or does not fit
+ */
+static int cache_resolve(ac_sandbox_paths_t *p, const char *dir, char *buffer, size_t size) {
+    uint64_t now = ac_platform_timestamp_ms();
+    int len = -1;
+
+    pthread_mutex_lock(&p->lock);
+    paths_cache_entry_t *slot = &p->cache[0];
+    for (size_t i = 0; i < PATHS_CACHE_SIZE; i++) {
+        paths_cache_entry_t *e = &p->cache[i];
+        if (e->dir && strcmp(e->dir, dir) == 0) {
+            if (now - e->stamp < PATHS_CACHE_TTL_MS) {
+                size_t n = strlen(e->resolved);
+                if (n < size) {
+                    memcpy(buffer, e->resolved, n + 1);
+                    len = (int)n;
+                }
+                e->used = ++p->clock;
+                pthread_mutex_unlock(&p->lock);
+                return len;
+            }
+            slot = e;
+            break;
+        }
+        if (!e->dir || e->used < slot->used) {
+            slot = e;
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    char *resolved = realpath(dir, NULL);
+    if (!resolved) {
+        return -1;
+    }
+    size_t n = strlen(resolved);
+    if (n < size) {
+        memcpy(buffer, resolved, n + 1);
+        len = (int)n;
+    }
+
+    char *key = strdup(dir);
+    pthread_mutex_lock(&p->lock);
+    if (key) {
+        /* The slot may have been refilled meanwhile; the newest wins */
+        free(slot->dir);
+        free(slot->resolved);
+        slot->dir = key;
+        slot->resolved = resolved;
+        slot->stamp = now;
+        slot->used = ++p->clock;
+        resolved = NULL;
+    }
+    pthread_mutex_unlock(&p->lock);
+    free(resolved);
+    return len;
+}
+
+#endif /* !_WIN32 */
+
+int ac_sandbox_paths_normalize(ac_sandbox_paths_t *p, const char *path, char *buffer, size_t size) {
+#if !defined(_WIN32)
+    /* realpath(dir/base) is realpath(dir)/base when base is an existing
+     * entry that is not a symlink, '.' or '..'. Relative paths depend on
+     * the working directory and are not cached. */
+    const char *slash = p && path[0] == '/' ? strrchr(path, '/') : NULL;
+    const char *base = slash ? slash + 1 : NULL;
+    struct stat st;
+    if (base && base[0] != '\0' && strcmp(base, ".") != 0 && strcmp(base, "..") != 0 &&
+        lstat(path, &st) == 0 && !S_ISLNK(st.st_mode)) {
+        char dir[4096];
+        size_t dir_len = slash == path ? 1 : (size_t)(slash - path);
+        if (dir_len < sizeof(dir)) {
+            memcpy(dir, path, dir_len);
+            dir[dir_len] = '\0';
+
+            int len = cache_resolve(p, dir, buffer, size);
+            if (len >= 0) {
+                size_t base_len = strlen(base);
+                size_t at = (size_t)len;
+                if (at == 1 && buffer[0] == '/') {
+                    at = 0;
+                }
+                if (at + 1 + base_len < size) {
+                    buffer[at] = '/';
+                    memcpy(buffer + at + 1, base, base_len + 1);
+                    return 0;
+                }
+            }
+        }
+    }
+#else
+    (void)p;
+#endif
+    return ac_sandbox_normalize_path(path, buffer, size);
+}
+
+void ac_sandbox_paths_invalidate(ac_sandbox_paths_t *p) {
+#if !defined(_WIN32)
+    if (!p) {
+        return;
+    }
+    pthread_mutex_lock(&p->lock);
+    cache_clear(p);
+    pthread_mutex_unlock(&p->lock);
+#else
+    (void)p;
+#endif
+}
+
+void ac_sandbox_paths_free(ac_sandbox_paths_t *p) {
+    if (!p) {
+        return;
+    }
+#if !defined(_WIN32)
+    cache_clear(p);
+    pthread_mutex_destroy(&p->lock);
+#endif
+    node_free(&p->root);
+    free(p);
+}
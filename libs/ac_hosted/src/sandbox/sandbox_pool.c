@@ -0,0 +1,684 @@
+/**
+ * @file sandbox_pool.c
+ * @brief Pre-started helper processes for sandboxed commands
+ *
+ * ac_sandbox_pool_start() forks a zygote once. The zygote optionally
+ * enters the sandbox, then forks workers on request and hands their
+ * socket back over its control socket. Workers inherit the zygote's
+ * restrictions, so the ruleset is built and applied once per pool rather
+ * than once per command.
+ *
+ * A worker runs one command at a time with ac_sandbox_run_posix() and
+ * streams the output back in frames:
+ *
+ *   parent -> worker   RUN  (a = timeout_ms, b = kill_grace_ms) + command
+ *                      SIGUSR1 to stop the command (ac_sandbox_exec_opts_t.stop)
+ *   worker -> parent   OUT / ERR + data, then DONE (a = arc_err_t, b = exit code)
+ *                      + ac_sandbox_usage_t
+ *   parent -> zygote   SPAWN
+ *   zygote -> parent   SPAWNED (a = pid), worker socket as SCM_RIGHTS
+ */
+
+#include <arc/sandbox.h>
+#include <arc/log.h>
+#include <arc/platform.h>
+#include <arc/tool.h>
+#include "sandbox_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Extra time a worker gets past its own deadline before it is killed */
+#define POOL_SLACK_MS 1000
+
+/* Largest output frame; the runner reads 4 KiB at a time */
+#define POOL_CHUNK 4096
+
+/* Highest fd the zygote closes when it starts */
+#define POOL_MAX_FD 4096
+
+/* How often a run that can be stopped looks at its stop flag */
+#define POOL_STOP_POLL_MS 100
+
+#ifdef MSG_NOSIGNAL
+#define POOL_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define POOL_SEND_FLAGS 0
+#endif
+
+/*============================================================================
+ * Wire Format
+ *============================================================================*/
+
+enum {
+    POOL_RUN = 1,
+    POOL_OUT,
+    POOL_ERR,
+    POOL_DONE,
+    POOL_SPAWN,
+    POOL_SPAWNED,
+};
+
+typedef struct {
+    uint32_t type;
+    uint32_t len;                   /* Payload bytes after the header */
+    int32_t a;
+    int32_t b;
+} pool_frame_t;
+
+typedef struct {
+    pid_t pid;
+    int fd;                         /* -1: slot empty */
+    int busy;
+} pool_worker_t;
+
+struct ac_sandbox_pool {
+    pthread_mutex_t lock;
+    pid_t zygote;
+    int zygote_fd;
+    int count;
+    pool_worker_t workers[];
+};
+
+static int send_all(int fd, const void *data, size_t len) {
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, POOL_SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read exactly len bytes
+ * @param deadline  ac_platform_timestamp_ms() to give up at (0 = never)
+ * @return 0 on success, -1 on EOF or error, -2 at the deadline
+ */
+static int recv_all(int fd, void *data, size_t len, uint64_t deadline) {
+    char *p = (char *)data;
+    while (len > 0) {
+        if (deadline) {
+            uint64_t now = ac_platform_timestamp_ms();
+            if (now >= deadline) {
+                return -2;
+            }
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            int wait_ms = deadline - now > INT32_MAX ? INT32_MAX : (int)(deadline - now);
+            if (poll(&pfd, 1, wait_ms) == 0) {
+                continue;
+            }
+        }
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int send_frame(int fd, uint32_t type, int32_t a, int32_t b,
+                      const void *data, size_t len) {
+    pool_frame_t f = { type, (uint32_t)len, a, b };
+    if (send_all(fd, &f, sizeof(f)) < 0) {
+        return -1;
+    }
+    return len > 0 ? send_all(fd, data, len) : 0;
+}
+
+static int socket_pair(int fds[2]) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fds[i], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    }
+    return 0;
+}
+
+/**
+ * @brief Send a frame with a file descriptor attached
+ */
+static int send_fd(int sock, const pool_frame_t *f, int fd) {
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov = { (void *)f, sizeof(*f) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &msg, POOL_SEND_FLAGS);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)sizeof(*f) ? 0 : -1;
+}
+
+/**
+ * @brief Receive a frame and the descriptor attached to it
+ * @return Received fd (close-on-exec), or -1
+ */
+static int recv_fd(int sock, pool_frame_t *f) {
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct iovec iov = { f, sizeof(*f) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+    flags |= MSG_CMSG_CLOEXEC;
+#endif
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, flags);
+    } while (n < 0 && errno == EINTR);
+    if (n != (ssize_t)sizeof(*f)) {
+        return -1;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        return -1;
+    }
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+/*============================================================================
+ * Worker and Zygote (child side)
+ *============================================================================*/
+
+static void worker_output(ac_sandbox_stream_t stream, const char *data, size_t len,
+                          void *user_data) {
+    int fd = *(const int *)user_data;
+    uint32_t type = stream == AC_SANDBOX_STDERR ? POOL_ERR : POOL_OUT;
+    /* A parent that went away is noticed at the next read */
+    send_frame(fd, type, 0, 0, data, len);
+}
+
+/* Set by SIGUSR1: the parent wants the running command stopped */
+static volatile int g_worker_stop;
+
+static void worker_stop_signal(int sig) {
+    (void)sig;
+    g_worker_stop = 1;
+}
+
+static void worker_main(int fd) {
+    /* Not SA_RESTART: the runner's poll() wakes up and sees the flag */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = worker_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+
+    for (;;) {
+        pool_frame_t f;
+        if (recv_all(fd, &f, sizeof(f), 0) < 0 || f.type != POOL_RUN) {
+            break;
+        }
+        /* A stop sent for the previous command arrived before this frame */
+        g_worker_stop = 0;
+        char *command = malloc((size_t)f.len + 1);
+        if (!command || recv_all(fd, command, f.len, 0) < 0) {
+            free(command);
+            break;
+        }
+        command[f.len] = '\0';
+
+        /* Streams are kept apart here; the parent merges them if asked to */
+        ac_sandbox_usage_t usage;
+        ac_sandbox_exec_opts_t opts = {
+            .timeout_ms = f.a,
+            .kill_grace_ms = f.b,
+            .on_output = worker_output,
+            .user_data = &fd,
+            .usage = &usage,
+            .stop = &g_worker_stop,
+        };
+        int code = -1;
+        arc_err_t err = ac_sandbox_run_posix(NULL, command, &opts, &code);
+        free(command);
+
+        if (send_frame(fd, POOL_DONE, err, code, &usage, sizeof(usage)) < 0) {
+            break;
+        }
+    }
+    _exit(0);
+}
+
+static void zygote_main(ac_sandbox_t *sandbox, int fd, int enforce) {
+    /* Out of the terminal's foreground group: Ctrl-C is for the agent */
+    setpgid(0, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Commands never read the agent's terminal */
+    int null_fd = open("/dev/null", O_RDONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        close(null_fd);
+    }
+
+    /* Drop the agent's connections and files; workers must not hold them open */
+    long max_fd = sysconf(_SC_OPEN_MAX);
+    if (max_fd < 0 || max_fd > POOL_MAX_FD) {
+        max_fd = POOL_MAX_FD;
+    }
+    for (int i = STDERR_FILENO + 1; i < max_fd; i++) {
+        if (i != fd) {
+            close(i);
+        }
+    }
+
+    if (enforce && ac_sandbox_enter(sandbox) != ARC_OK) {
+        AC_LOG_WARN("Sandbox pool: could not enter sandbox, workers run unrestricted");
+    }
+
+    for (;;) {
+        pool_frame_t f;
+        if (recv_all(fd, &f, sizeof(f), 0) < 0 || f.type != POOL_SPAWN) {
+            break;
+        }
+
+        int fds[2];
+        pid_t pid = -1;
+        if (socket_pair(fds) == 0) {
+            pid = fork();
+            if (pid == 0) {
+                close(fd);
+                close(fds[0]);
+                worker_main(fds[1]);
+            }
+            close(fds[1]);
+        }
+
+        pool_frame_t reply = { POOL_SPAWNED, 0, (int32_t)pid, 0 };
+        int sent = pid > 0 ? send_fd(fd, &reply, fds[0]) : send_all(fd, &reply, sizeof(reply));
+        if (pid > 0) {
+            close(fds[0]);
+        }
+
+        /* Reap workers that have exited */
+        while (waitpid(-1, NULL, WNOHANG) > 0) {
+        }
+        if (sent < 0) {
+            break;
+        }
+    }
+    _exit(0);
+}
+
+/*============================================================================
+ * Pool (parent side)
+ *============================================================================*/
+
+/**
+ * @brief Have the zygote fork a worker into an empty slot (lock held)
+ */
+static int pool_spawn(struct ac_sandbox_pool *pool, pool_worker_t *w) {
+    if (pool->zygote_fd < 0 ||
+        send_frame(pool->zygote_fd, POOL_SPAWN, 0, 0, NULL, 0) < 0) {
+        return -1;
+    }
+    pool_frame_t reply;
+    int fd = recv_fd(pool->zygote_fd, &reply);
+    if (fd < 0 || reply.type != POOL_SPAWNED || reply.a <= 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        AC_LOG_WARN("Sandbox pool: zygote failed to start a worker");
+        return -1;
+    }
+    w->pid = (pid_t)reply.a;
+    w->fd = fd;
+    w->busy = 0;
+    return 0;
+}
+
+static void pool_drop(pool_worker_t *w) {
+    if (w->fd >= 0) {
+        close(w->fd);
+    }
+    w->fd = -1;
+    w->pid = 0;
+    w->busy = 0;
+}
+
+/**
+ * @brief Take an idle worker, starting one if a slot is empty
+ * @return Worker, or NULL when all are busy
+ */
+static pool_worker_t *pool_acquire(struct ac_sandbox_pool *pool) {
+    pool_worker_t *found = NULL;
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < pool->count && !found; i++) {
+        if (pool->workers[i].fd >= 0 && !pool->workers[i].busy) {
+            found = &pool->workers[i];
+        }
+    }
+    for (int i = 0; i < pool->count && !found; i++) {
+        if (pool->workers[i].fd < 0 && pool_spawn(pool, &pool->workers[i]) == 0) {
+            found = &pool->workers[i];
+        }
+    }
+    if (found) {
+        found->busy = 1;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return found;
+}
+
+static void pool_release(struct ac_sandbox_pool *pool, pool_worker_t *w, int dead) {
+    pthread_mutex_lock(&pool->lock);
+    if (dead) {
+        pool_drop(w);
+    } else {
+        w->busy = 0;
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_append(char *buf, size_t size, size_t *len, const char *data, size_t n) {
+    if (!buf || size == 0) {
+        return;
+    }
+    size_t room = size - 1 - *len;
+    if (n > room) {
+        n = room;
+    }
+    memcpy(buf + *len, data, n);
+    *len += n;
+    buf[*len] = '\0';
+}
+
+/**
+ * @brief Wait for the worker's next frame, passing opts->stop on meanwhile
+ * @return 0 once there is something to read, -2 at give_up
+ */
+static int pool_wait_stop(const pool_worker_t *w, const ac_sandbox_exec_opts_t *opts,
+                          uint64_t give_up, int *stop_sent) {
+    struct pollfd pfd = { w->fd, POLLIN, 0 };
+    for (;;) {
+        if (!*stop_sent && *opts->stop) {
+            kill(w->pid, SIGUSR1);
+            *stop_sent = 1;
+            return 0;
+        }
+        int wait_ms = POOL_STOP_POLL_MS;
+        if (give_up) {
+            uint64_t now = ac_platform_timestamp_ms();
+            if (now >= give_up) {
+                return -2;
+            }
+            if (give_up - now < (uint64_t)wait_ms) {
+                wait_ms = (int)(give_up - now);
+            }
+        }
+        if (poll(&pfd, 1, wait_ms) > 0) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief Run a command on a pool worker
+ * @return 1 if the pool ran it (result in *result), 0 to run it directly
+ */
+static int pool_run(struct ac_sandbox_pool *pool, const char *command,
+                    const ac_sandbox_exec_opts_t *opts, int *exit_code, arc_err_t *result) {
+    pool_worker_t *w = pool_acquire(pool);
+    if (!w) {
+        return 0;
+    }
+
+    int grace_ms = opts->kill_grace_ms > 0 ? opts->kill_grace_ms : AC_SANDBOX_KILL_GRACE_MS;
+    if (send_frame(w->fd, POOL_RUN, opts->timeout_ms, grace_ms, command, strlen(command)) < 0) {
+        /* Nothing ran; the caller can still run it directly */
+        pool_release(pool, w, 1);
+        return 0;
+    }
+
+    size_t out_len = 0;
+    size_t err_len = 0;
+    if (opts->output && opts->output_size > 0) {
+        opts->output[0] = '\0';
+    }
+    if (opts->error_output && opts->error_output_size > 0) {
+        opts->error_output[0] = '\0';
+    }
+
+    /* The worker keeps the deadline; this only covers a worker that hangs */
+    uint64_t give_up = 0;
+    if (opts->timeout_ms > 0) {
+        give_up = ac_platform_timestamp_ms() + (uint64_t)opts->timeout_ms +
+                  (uint64_t)grace_ms + POOL_SLACK_MS;
+    }
+
+    char buf[POOL_CHUNK];
+    *result = ARC_ERR_IO;
+    int code = -1;
+    int stop_sent = 0;
+    int rc;
+    for (;;) {
+        pool_frame_t f;
+        rc = opts->stop && !stop_sent ? pool_wait_stop(w, opts, give_up, &stop_sent) : 0;
+        if (rc == 0) {
+            rc = recv_all(w->fd, &f, sizeof(f), give_up);
+        }
+        if (rc < 0) {
+            break;
+        }
+        if (f.type == POOL_DONE) {
+            ac_sandbox_usage_t usage;
+            rc = f.len == sizeof(usage) ? recv_all(w->fd, &usage, f.len, give_up) : -1;
+            if (rc < 0) {
+                break;
+            }
+            if (opts->usage) {
+                *opts->usage = usage;
+            }
+            *result = (arc_err_t)f.a;
+            code = f.b;
+            break;
+        }
+        if ((f.type != POOL_OUT && f.type != POOL_ERR) || f.len > sizeof(buf)) {
+            rc = -1;
+            break;
+        }
+        rc = recv_all(w->fd, buf, f.len, give_up);
+        if (rc < 0) {
+            break;
+        }
+
+        ac_sandbox_stream_t stream = f.type == POOL_ERR ? AC_SANDBOX_STDERR : AC_SANDBOX_STDOUT;
+        if (stream == AC_SANDBOX_STDERR && opts->error_output) {
+            pool_append(opts->error_output, opts->error_output_size, &err_len, buf, f.len);
+        } else {
+            pool_append(opts->output, opts->output_size, &out_len, buf, f.len);
+        }
+        if (opts->on_output) {
+            opts->on_output(stream, buf, f.len, opts->user_data);
+        }
+    }
+
+    if (rc == -2) {
+        AC_LOG_WARN("Sandbox pool: worker %d did not finish, killing it", (int)w->pid);
+        kill(w->pid, SIGKILL);
+        *result = ARC_ERR_TIMEOUT;
+    } else if (rc < 0) {
+        AC_LOG_WARN("Sandbox pool: worker %d exited mid-command", (int)w->pid);
+    }
+    pool_release(pool, w, rc < 0);
+
+    if (exit_code) {
+        *exit_code = code;
+    }
+    return 1;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t ac_sandbox_pool_start(ac_sandbox_t *sandbox, int workers, int enforce) {
+    if (!sandbox || workers < 0) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (sandbox->pool) {
+        return ARC_ERR_INVALID_STATE;
+    }
+    if (workers == 0) {
+        workers = AC_SANDBOX_POOL_DEFAULT_WORKERS;
+    }
+
+    struct ac_sandbox_pool *pool = calloc(1, sizeof(*pool) +
+                                             (size_t)workers * sizeof(pool_worker_t));
+    if (!pool) {
+        return ARC_ERR_NO_MEMORY;
+    }
+    pool->count = workers;
+    for (int i = 0; i < workers; i++) {
+        pool->workers[i].fd = -1;
+    }
+
+    int fds[2];
+    if (socket_pair(fds) < 0) {
+        AC_LOG_ERROR("Sandbox pool: socketpair failed: %s", strerror(errno));
+        free(pool);
+        return ARC_ERR_IO;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        AC_LOG_ERROR("Sandbox pool: fork failed: %s", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        free(pool);
+        return ARC_ERR_IO;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        zygote_main(sandbox, fds[1], enforce);
+    }
+    close(fds[1]);
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->zygote = pid;
+    pool->zygote_fd = fds[0];
+
+    /* Start the workers now so the first commands do not pay for it */
+    for (int i = 0; i < workers; i++) {
+        if (pool_spawn(pool, &pool->workers[i]) < 0) {
+            break;
+        }
+    }
+
+    sandbox->pool = pool;
+    AC_LOG_INFO("Sandbox pool started (workers=%d, enforce=%d)", workers, enforce);
+    return ARC_OK;
+}
+
+void ac_sandbox_pool_stop(ac_sandbox_t *sandbox) {
+    if (!sandbox || !sandbox->pool) {
+        return;
+    }
+    struct ac_sandbox_pool *pool = sandbox->pool;
+    sandbox->pool = NULL;
+
+    /* Workers and the zygote exit when their socket closes */
+    for (int i = 0; i < pool->count; i++) {
+        pool_drop(&pool->workers[i]);
+    }
+    close(pool->zygote_fd);
+    while (waitpid(pool->zygote, NULL, 0) < 0 && errno == EINTR) {
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+arc_err_t ac_sandbox_run_command(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    const ac_sandbox_exec_opts_t *opts,
+    int *exit_code
+) {
+    const void *owner = opts->owner;
+    if (!owner && ac_tool_current_ctx()) {
+        owner = ac_tool_current_ctx()->owner;
+    }
+    ac_sandbox_admit_acquire(sandbox->admit, owner);
+
+    /* Workers run inside the sandbox, where the cgroup tree is out of reach */
+    arc_err_t result;
+    if (!sandbox->pool || sandbox->limits.parent ||
+        !pool_run(sandbox->pool, command, opts, exit_code, &result)) {
+        result = ac_sandbox_run_posix(&sandbox->limits, command, opts, exit_code);
+    }
+
+    ac_sandbox_admit_release(sandbox->admit, owner);
+    return result;
+}
+
+#else /* _WIN32 */
+
+arc_err_t ac_sandbox_pool_start(ac_sandbox_t *sandbox, int workers, int enforce) {
+    (void)sandbox;
+    (void)workers;
+    (void)enforce;
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+void ac_sandbox_pool_stop(ac_sandbox_t *sandbox) {
+    (void)sandbox;
+}
+
+#endif /* !_WIN32 */
@@ -0,0 +1,1505 @@
+/**
+ * @file server.c
+ * @brief Multi-Tenant Agent Server Implementation
+ *
+ * One loop thread owns the listening socket, the connections, the
+ * tenants and the conversations. Runs execute on the session executor:
+ * their stream events are formatted on the worker straight into the
+ * connection's output buffer (under the connection lock) and the loop is
+ * woken through a pipe to flush it. Completions are queued for the loop,
+ * the only thread that changes conversation state.
+ *
+ * poll() rather than epoll/kqueue keeps the loop portable; the per-
+ * iteration scan is linear in open connections.
+ */
+
+#include <arc/server.h>
+#include <arc/runtime.h>
+#include <arc/log.h>
+#include <arc/platform.h>
+#include "cJSON.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define SERVER_DEFAULT_BIND           "127.0.0.1"
+#define SERVER_DEFAULT_TENANT_HEADER  "X-Tenant"
+#define SERVER_DEFAULT_MAX_BODY       (1024 * 1024)
+#define SERVER_DEFAULT_MAX_CONNS      4096
+#define SERVER_DEFAULT_MAX_OUTPUT     (4 * 1024 * 1024)
+#define SERVER_DEFAULT_IDLE_MS        (10 * 60 * 1000)
+#define SERVER_MAX_HEADER             (16 * 1024)
+#define SERVER_MAX_TENANT             128
+#define SERVER_CONV_BUCKETS           1024
+#define SERVER_SWEEP_MS               1000
+#define SERVER_ID_LEN                 24
+#define SERVER_READ_CHUNK             4096
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0                 /* SO_NOSIGPIPE is set instead */
+#endif
+
+#ifdef _WIN32
+
+ac_server_t *ac_server_create(ac_session_t *session, const ac_server_config_t *config) {
+    (void)session;
+    (void)config;
+    AC_LOG_ERROR("Agent server is not supported on this platform");
+    return NULL;
+}
+
+uint16_t ac_server_port(const ac_server_t *server) {
+    (void)server;
+    return 0;
+}
+
+arc_err_t ac_server_get_stats(ac_server_t *server, ac_server_stats_t *stats) {
+    (void)server;
+    (void)stats;
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+void ac_server_destroy(ac_server_t *server) {
+    (void)server;
+}
+
+#else
+
+/*============================================================================
+ * Internal Structure
+ *============================================================================*/
+
+typedef struct server_tenant server_tenant_t;
+typedef struct server_conv server_conv_t;
+
+typedef struct {
+    int fd;
+    atomic_int refs;                   /* Loop + agent streaming to it */
+
+    pthread_mutex_t lock;              /* Guards the fields up to in */
+    char *out;
+    size_t out_pos;
+    size_t out_len;
+    size_t out_cap;
+    int finished;                      /* Stream ended: close once flushed */
+    int failed;                        /* Output lost (no memory, reader too slow): close */
+    int closed;                        /* Socket gone: stop formatting events */
+    size_t max_out;                    /* Unsent event bytes allowed (set once) */
+
+    /* Loop thread only */
+    char *in;
+    size_t in_len;
+    size_t in_cap;
+    int streaming;                     /* Response is an event stream */
+    int close_after;                   /* Close once flushed */
+    server_conv_t *conv;               /* Conversation streaming to it */
+    uint64_t last_ms;
+} server_conn_t;
+
+typedef struct server_agent {
+    ac_server_t *server;
+    ac_agent_t *agent;
+    pthread_mutex_t lock;              /* Guards conn */
+    server_conn_t *conn;               /* Stream target of the current run */
+    struct server_agent *next;         /* Tenant's idle list */
+} server_agent_t;
+
+struct server_conv {
+    char id[SERVER_ID_LEN + 1];
+    server_tenant_t *tenant;
+    server_agent_t *slot;
+    ac_agent_run_t *run;               /* Message in progress */
+    server_conn_t *conn;               /* Its stream */
+    int closing;                       /* Deleted while running */
+    uint64_t last_ms;
+    server_conv_t *next;               /* Hash chain */
+    server_conv_t *done_next;          /* Completion queue */
+};
+
+struct server_tenant {
+    char *name;
+    ac_server_limits_t limits;
+    size_t conversations;
+    size_t streams;
+    size_t agents;
+    server_agent_t *idle;
+    ac_history_segment_t *blank;       /* History of a fresh agent */
+    server_tenant_t *next;
+};
+
+struct ac_server {
+    ac_session_t *session;
+    ac_server_config_t config;
+    char *tenant_header;
+
+    int listen_fd;
+    uint16_t port;
+    int wake[2];
+    atomic_int wake_pending;
+    atomic_int stop;
+    pthread_t thread;
+
+    /* Loop thread only */
+    server_conn_t **conns;
+    size_t conn_count;
+    size_t conn_capacity;
+    struct pollfd *polls;
+    size_t poll_capacity;
+    server_tenant_t *tenants;
+    server_conv_t *buckets[SERVER_CONV_BUCKETS];
+    server_agent_t **agents;           /* Every slot, for destroy */
+    size_t agent_count;
+    size_t agent_capacity;
+    uint64_t id_state;
+    uint64_t last_sweep_ms;
+
+    pthread_mutex_t lock;              /* Guards done and stats */
+    server_conv_t *done;
+    ac_server_stats_t stats;
+};
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+static char *str_dup(const char *s) {
+    if (!s) {
+        return NULL;
+    }
+    size_t len = strlen(s);
+    char *copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, s, len + 1);
+    }
+    return copy;
+}
+
+static arc_err_t buf_append(char **buf, size_t *len, size_t *capacity,
+                            const char *data, size_t size) {
+    if (*len + size + 1 > *capacity) {
+        size_t new_capacity = *capacity ? *capacity : 256;
+        while (new_capacity < *len + size + 1) {
+            new_capacity *= 2;
+        }
+        char *grown = realloc(*buf, new_capacity);
+        if (!grown) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        *buf = grown;
+        *capacity = new_capacity;
+    }
+    memcpy(*buf + *len, data, size);
+    *len += size;
+    (*buf)[*len] = '\0';
+    return ARC_OK;
+}
+
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static size_t id_hash(const char *id) {
+    size_t h = 5381;
+    for (; *id; id++) {
+        h = h * 33 + (unsigned char)*id;
+    }
+    return h % SERVER_CONV_BUCKETS;
+}
+
+#define STATS_ADD(server, field, n) do {          \
+        pthread_mutex_lock(&(server)->lock);      \
+        (server)->stats.field += (n);             \
+        pthread_mutex_unlock(&(server)->lock);    \
+    } while (0)
+
+static void server_wake(ac_server_t *server) {
+    if (!atomic_exchange(&server->wake_pending, 1)) {
+        char byte = 1;
+        ssize_t n = write(server->wake[1], &byte, 1);
+        (void)n;
+    }
+}
+
+/*============================================================================
+ * Connections
+ *============================================================================*/
+
+static void conn_release(server_conn_t *conn) {
+    if (atomic_fetch_sub(&conn->refs, 1) != 1) {
+        return;
+    }
+    pthread_mutex_destroy(&conn->lock);
+    free(conn->out);
+    free(conn->in);
+    free(conn);
+}
+
+/* Caller holds conn->lock */
+static void conn_write_locked(server_conn_t *conn, const char *data, size_t size) {
+    if (conn->failed || conn->closed) {
+        return;
+    }
+    if (buf_append(&conn->out, &conn->out_len, &conn->out_cap, data, size) != ARC_OK) {
+        conn->failed = 1;
+    }
+}
+
+static void conn_write(server_conn_t *conn, const char *data, size_t size) {
+    pthread_mutex_lock(&conn->lock);
+    conn_write_locked(conn, data, size);
+    pthread_mutex_unlock(&conn->lock);
+}
+
+static const char *status_text(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 503: return "Service Unavailable";
+    default:  return "Internal Server Error";
+    }
+}
+
+static void conn_respond(server_conn_t *conn, int status, const char *body) {
+    char head[256];
+    size_t body_len = body ? strlen(body) : 0;
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\n"
+                     "Content-Type: application/json\r\n"
+                     "Content-Length: %zu\r\n"
+                     "%s\r\n",
+                     status, status_text(status), body_len,
+                     conn->close_after ? "Connection: close\r\n" : "");
+    pthread_mutex_lock(&conn->lock);
+    conn_write_locked(conn, head, (size_t)n);
+    if (body_len) {
+        conn_write_locked(conn, body, body_len);
+    }
+    pthread_mutex_unlock(&conn->lock);
+}
+
+static void conn_error(server_conn_t *conn, int status, const char *message) {
+    char body[256];
+    snprintf(body, sizeof(body), "{\"error\":\"%s\"}", message);
+    conn_respond(conn, status, body);
+}
+
+/**
+ * @brief Send buffered output without blocking
+ *
+ * @return 0 while the connection stays open, -1 to close it
+ */
+static int conn_flush(server_conn_t *conn) {
+    int result = 0;
+    pthread_mutex_lock(&conn->lock);
+    while (conn->out_pos < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + conn->out_pos,
+                         conn->out_len - conn->out_pos, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->out_pos += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                result = -1;
+            }
+            break;
+        }
+    }
+    if (conn->out_pos == conn->out_len) {
+        conn->out_pos = 0;
+        conn->out_len = 0;
+        if (conn->finished || (conn->close_after && !conn->streaming)) {
+            result = -1;
+        }
+    } else if (conn->out_pos > 0) {
+        /* Slow reader: drop what was sent so the buffer holds only the backlog */
+        memmove(conn->out, conn->out + conn->out_pos, conn->out_len - conn->out_pos);
+        conn->out_len -= conn->out_pos;
+        conn->out_pos = 0;
+    }
+    if (conn->failed) {
+        result = -1;
+    }
+    pthread_mutex_unlock(&conn->lock);
+    return result;
+}
+
+static int conn_pending(server_conn_t *conn) {
+    pthread_mutex_lock(&conn->lock);
+    int pending = conn->out_pos < conn->out_len;
+    pthread_mutex_unlock(&conn->lock);
+    return pending;
+}
+
+static void server_close_conn(ac_server_t *server, size_t index) {
+    server_conn_t *conn = server->conns[index];
+
+    pthread_mutex_lock(&conn->lock);
+    conn->closed = 1;
+    pthread_mutex_unlock(&conn->lock);
+    close(conn->fd);
+
+    /* Client went away mid-stream: nobody is reading the answer */
+    if (conn->conv) {
+        if (conn->conv->run) {
+            ac_agent_run_cancel(conn->conv->run);
+        }
+        conn->conv->conn = NULL;
+        conn->conv = NULL;
+    }
+
+    server->conns[index] = server->conns[--server->conn_count];
+    STATS_ADD(server, connections, (size_t)-1);
+    conn_release(conn);
+}
+
+/*============================================================================
+ * Stream Events
+ *============================================================================*/
+
+static const char *const s_event_names[] = {
+    [AC_STREAM_MESSAGE_START] = "message_start",
+    [AC_STREAM_CONTENT_BLOCK_START] = "content_block_start",
+    [AC_STREAM_DELTA] = "delta",
+    [AC_STREAM_CONTENT_BLOCK_STOP] = "content_block_stop",
+    [AC_STREAM_MESSAGE_DELTA] = "message_delta",
+    [AC_STREAM_MESSAGE_STOP] = "message_stop",
+    [AC_STREAM_ERROR] = "error",
+    [AC_STREAM_TOOL_PROGRESS] = "tool_progress",
+};
+
+static const char *const s_block_names[] = {
+    [AC_BLOCK_TEXT] = "text",
+    [AC_BLOCK_THINKING] = "thinking",
+    [AC_BLOCK_REDACTED_THINKING] = "redacted_thinking",
+    [AC_BLOCK_REASONING] = "reasoning",
+    [AC_BLOCK_TOOL_USE] = "tool_use",
+    [AC_BLOCK_TOOL_RESULT] = "tool_result",
+};
+
+static const char *const s_delta_names[] = {
+    [AC_DELTA_THINKING] = "thinking",
+    [AC_DELTA_TEXT] = "text",
+    [AC_DELTA_INPUT_JSON] = "input_json",
+    [AC_DELTA_SIGNATURE] = "signature",
+    [AC_DELTA_REASONING] = "reasoning",
+};
+
+#define NAME_OF(table, value) \
+    ((size_t)(value) < sizeof(table) / sizeof(table[0]) ? table[value] : "unknown")
+
+static void add_string(cJSON *obj, const char *name, const char *value) {
+    if (value) {
+        cJSON_AddStringToObject(obj, name, value);
+    }
+}
+
+static cJSON *event_json(const ac_stream_event_t *event) {
+    cJSON *obj = cJSON_CreateObject();
+    if (!obj) {
+        return NULL;
+    }
+
+    switch (event->type) {
+    case AC_STREAM_CONTENT_BLOCK_START:
+        cJSON_AddNumberToObject(obj, "index", event->block_index);
+        cJSON_AddStringToObject(obj, "block_type", NAME_OF(s_block_names, event->block_type));
+        add_string(obj, "tool_id", event->tool_id);
+        add_string(obj, "tool_name", event->tool_name);
+        break;
+    case AC_STREAM_DELTA: {
+        cJSON_AddNumberToObject(obj, "index", event->block_index);
+        cJSON_AddStringToObject(obj, "delta_type", NAME_OF(s_delta_names, event->delta_type));
+        char *text = malloc(event->delta_len + 1);
+        if (text) {
+            if (event->delta_len) {
+                memcpy(text, event->delta, event->delta_len);
+            }
+            text[event->delta_len] = '\0';
+            cJSON_AddStringToObject(obj, "text", text);
+            free(text);
+        }
+        break;
+    }
+    case AC_STREAM_CONTENT_BLOCK_STOP:
+        cJSON_AddNumberToObject(obj, "index", event->block_index);
+        add_string(obj, "tool_input", event->tool_input);
+        break;
+    case AC_STREAM_MESSAGE_DELTA:
+        add_string(obj, "stop_reason", event->stop_reason);
+        cJSON_AddNumberToObject(obj, "output_tokens", event->output_tokens);
+        break;
+    case AC_STREAM_ERROR:
+        add_string(obj, "type", event->error_type);
+        add_string(obj, "message", event->error_msg);
+        break;
+    case AC_STREAM_TOOL_PROGRESS:
+        add_string(obj, "tool_id", event->tool_id);
+        add_string(obj, "tool_name", event->tool_name);
+        cJSON_AddNumberToObject(obj, "progress", event->progress);
+        cJSON_AddNumberToObject(obj, "total", event->progress_total);
+        if (event->delta && event->delta_len) {
+            char *text = malloc(event->delta_len + 1);
+            if (text) {
+                memcpy(text, event->delta, event->delta_len);
+                text[event->delta_len] = '\0';
+                cJSON_AddStringToObject(obj, "output", text);
+                free(text);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    return obj;
+}
+
+/**
+ * @brief Append one SSE event (caller holds conn->lock)
+ *
+ * A client that falls more than max_out bytes behind fails the
+ * connection: the stream callback then cancels the run and the loop
+ * closes the socket.
+ */
+static void conn_event_locked(server_conn_t *conn, const char *name, cJSON *data) {
+    char *json = data ? cJSON_PrintUnformatted(data) : NULL;
+    if (!json) {
+        conn->failed = 1;
+        return;
+    }
+    char head[64];
+    int n = snprintf(head, sizeof(head), "event: %s\ndata: ", name);
+    size_t size = (size_t)n + strlen(json) + 2;
+    if (conn->out_len - conn->out_pos + size > conn->max_out) {
+        conn->failed = 1;
+        cJSON_free(json);
+        return;
+    }
+    conn_write_locked(conn, head, (size_t)n);
+    conn_write_locked(conn, json, strlen(json));
+    conn_write_locked(conn, "\n\n", 2);
+    cJSON_free(json);
+}
+
+static int server_on_stream(const ac_stream_event_t *event, void *user_data) {
+    server_agent_t *slot = (server_agent_t *)user_data;
+    int abort = 0;
+
+    pthread_mutex_lock(&slot->lock);
+    server_conn_t *conn = slot->conn;
+    if (conn) {
+        cJSON *data = event_json(event);
+        pthread_mutex_lock(&conn->lock);
+        conn_event_locked(conn, NAME_OF(s_event_names, event->type), data);
+        abort = conn->closed || conn->failed;
+        pthread_mutex_unlock(&conn->lock);
+        cJSON_Delete(data);
+    }
+    pthread_mutex_unlock(&slot->lock);
+
+    if (conn) {
+        server_wake(slot->server);
+    }
+    return abort;
+}
+
+static void server_on_done(ac_agent_t *agent, ac_agent_result_t *result, void *user_data) {
+    (void)agent;
+    server_conv_t *conv = (server_conv_t *)user_data;
+    server_agent_t *slot = conv->slot;
+    ac_server_t *server = slot->server;
+
+    pthread_mutex_lock(&slot->lock);
+    server_conn_t *conn = slot->conn;
+    slot->conn = NULL;
+    pthread_mutex_unlock(&slot->lock);
+
+    if (conn) {
+        cJSON *data = cJSON_CreateObject();
+        if (data) {
+            if (result && result->content) {
+                cJSON_AddStringToObject(data, "content", result->content);
+            } else {
+                cJSON_AddStringToObject(data, "error", "run failed or was cancelled");
+            }
+        }
+        pthread_mutex_lock(&conn->lock);
+        conn_event_locked(conn, "done", data);
+        conn->finished = 1;
+        pthread_mutex_unlock(&conn->lock);
+        cJSON_Delete(data);
+        conn_release(conn);
+    }
+
+    pthread_mutex_lock(&server->lock);
+    conv->done_next = server->done;
+    server->done = conv;
+    pthread_mutex_unlock(&server->lock);
+    server_wake(server);
+}
+
+/*============================================================================
+ * Tenants and Agents
+ *============================================================================*/
+
+static server_tenant_t *tenant_find(ac_server_t *server, const char *name) {
+    for (server_tenant_t *t = server->tenants; t; t = t->next) {
+        if (strcmp(t->name, name) == 0) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static server_tenant_t *tenant_add(ac_server_t *server, const char *name) {
+    server_tenant_t *tenant = calloc(1, sizeof(*tenant));
+    if (!tenant || !(tenant->name = str_dup(name))) {
+        free(tenant);
+        return NULL;
+    }
+    tenant->next = server->tenants;
+    server->tenants = tenant;
+    STATS_ADD(server, tenants, 1);
+    return tenant;
+}
+
+/**
+ * @brief Idle agent of the tenant, or a new one within its limit
+ */
+static server_agent_t *tenant_acquire(ac_server_t *server, server_tenant_t *tenant,
+                                      const ac_agent_params_t *params) {
+    server_agent_t *slot = tenant->idle;
+    if (slot) {
+        tenant->idle = slot->next;
+        slot->next = NULL;
+        return slot;
+    }
+
+    size_t max = tenant->limits.max_conversations;
+    if (max && tenant->agents >= max) {
+        return NULL;
+    }
+    if (server->agent_count == server->agent_capacity) {
+        size_t new_capacity = server->agent_capacity ? server->agent_capacity * 2 : 16;
+        server_agent_t **grown = realloc(server->agents, new_capacity * sizeof(*grown));
+        if (!grown) {
+            return NULL;
+        }
+        server->agents = grown;
+        server->agent_capacity = new_capacity;
+    }
+
+    slot = calloc(1, sizeof(*slot));
+    if (!slot || pthread_mutex_init(&slot->lock, NULL) != 0) {
+        free(slot);
+        return NULL;
+    }
+    slot->server = server;
+
+    ac_agent_params_t agent_params = *params;
+    agent_params.callbacks.on_stream = server_on_stream;
+    agent_params.callbacks.user_data = slot;
+    slot->agent = ac_agent_create(server->session, &agent_params);
+    if (!slot->agent) {
+        AC_LOG_ERROR("Server: failed to create agent for tenant '%s'", tenant->name);
+        pthread_mutex_destroy(&slot->lock);
+        free(slot);
+        return NULL;
+    }
+
+    /* Pooled agents go back to this history between conversations */
+    if (!tenant->blank && ac_agent_history_share(slot->agent, &tenant->blank) != ARC_OK) {
+        tenant->blank = NULL;
+    }
+
+    server->agents[server->agent_count++] = slot;
+    tenant->agents++;
+    STATS_ADD(server, agents, 1);
+    return slot;
+}
+
+static void tenant_release(server_tenant_t *tenant, server_agent_t *slot) {
+    if (!tenant->blank || ac_agent_history_attach(slot->agent, tenant->blank) != ARC_OK) {
+        /* Cannot clear its history: keep it out of the pool */
+        AC_LOG_WARN("Server: agent of tenant '%s' not reusable", tenant->name);
+        tenant->agents--;
+        return;
+    }
+    slot->next = tenant->idle;
+    tenant->idle = slot;
+}
+
+/*============================================================================
+ * Conversations
+ *============================================================================*/
+
+static server_conv_t *conv_find(ac_server_t *server, const char *id, size_t id_len,
+                                const server_tenant_t *tenant) {
+    if (id_len != SERVER_ID_LEN) {
+        return NULL;
+    }
+    char key[SERVER_ID_LEN + 1];
+    memcpy(key, id, SERVER_ID_LEN);
+    key[SERVER_ID_LEN] = '\0';
+
+    for (server_conv_t *c = server->buckets[id_hash(key)]; c; c = c->next) {
+        if (!c->closing && c->tenant == tenant && strcmp(c->id, key) == 0) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+static void conv_unlink(ac_server_t *server, server_conv_t *conv) {
+    server_conv_t **link = &server->buckets[id_hash(conv->id)];
+    while (*link && *link != conv) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = conv->next;
+    }
+}
+
+/**
+ * @brief Free a conversation that is not running and return its agent
+ */
+static void conv_close(ac_server_t *server, server_conv_t *conv) {
+    conv_unlink(server, conv);
+    tenant_release(conv->tenant, conv->slot);
+    conv->tenant->conversations--;
+    STATS_ADD(server, conversations, (size_t)-1);
+    free(conv);
+}
+
+static void server_drain_done(ac_server_t *server) {
+    pthread_mutex_lock(&server->lock);
+    server_conv_t *conv = server->done;
+    server->done = NULL;
+    pthread_mutex_unlock(&server->lock);
+
+    uint64_t now = ac_platform_timestamp_ms();
+    while (conv) {
+        server_conv_t *next = conv->done_next;
+        ac_agent_run_release(conv->run);
+        conv->run = NULL;
+        if (conv->conn) {
+            conv->conn->conv = NULL;
+            conv->conn = NULL;
+        }
+        conv->tenant->streams--;
+        STATS_ADD(server, streams, (size_t)-1);
+        conv->last_ms = now;
+        if (conv->closing) {
+            conv_close(server, conv);
+        }
+        conv = next;
+    }
+}
+
+/*============================================================================
+ * Routes
+ *============================================================================*/
+
+typedef struct {
+    const char *method;
+    const char *path;
+    size_t path_len;
+    const char *tenant;
+    const char *authorization;
+    const char *body;
+    size_t body_len;
+} server_request_t;
+
+static void route_create(ac_server_t *server, server_conn_t *conn,
+                         server_tenant_t *tenant, const ac_agent_params_t *params) {
+    size_t max = tenant->limits.max_conversations;
+    if (max && tenant->conversations >= max) {
+        STATS_ADD(server, rejected, 1);
+        conn_error(conn, 429, "conversation limit reached");
+        return;
+    }
+
+    server_conv_t *conv = calloc(1, sizeof(*conv));
+    server_agent_t *slot = conv ? tenant_acquire(server, tenant, params) : NULL;
+    if (!slot) {
+        free(conv);
+        conn_error(conn, 503, "no agent available");
+        return;
+    }
+
+    uint64_t a = next_random(&server->id_state);
+    uint64_t b = next_random(&server->id_state);
+    snprintf(conv->id, sizeof(conv->id), "%016llx%08llx",
+             (unsigned long long)a, (unsigned long long)(b & 0xFFFFFFFFull));
+    conv->tenant = tenant;
+    conv->slot = slot;
+    conv->last_ms = ac_platform_timestamp_ms();
+
+    size_t bucket = id_hash(conv->id);
+    conv->next = server->buckets[bucket];
+    server->buckets[bucket] = conv;
+    tenant->conversations++;
+    STATS_ADD(server, conversations, 1);
+
+    char body[64];
+    snprintf(body, sizeof(body), "{\"id\":\"%s\"}", conv->id);
+    conn_respond(conn, 201, body);
+}
+
+static void route_message(ac_server_t *server, server_conn_t *conn,
+                          server_conv_t *conv, const server_request_t *req) {
+    server_tenant_t *tenant = conv->tenant;
+    if (conv->run) {
+        STATS_ADD(server, rejected, 1);
+        conn_error(conn, 409, "conversation is busy");
+        return;
+    }
+    size_t max = tenant->limits.max_streams;
+    if (max && tenant->streams >= max) {
+        STATS_ADD(server, rejected, 1);
+        conn_error(conn, 429, "stream limit reached");
+        return;
+    }
+
+    cJSON *body = cJSON_ParseWithLength(req->body, req->body_len);
+    const cJSON *message = cJSON_GetObjectItemCaseSensitive(body, "message");
+    if (!cJSON_IsString(message) || !message->valuestring[0]) {
+        cJSON_Delete(body);
+        conn_error(conn, 400, "expected {\"message\":\"...\"}");
+        return;
+    }
+
+    static const char head[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n"
+        "\r\n";
+    conn_write(conn, head, sizeof(head) - 1);
+    conn->streaming = 1;
+    conn->close_after = 1;
+
+    server_agent_t *slot = conv->slot;
+    atomic_fetch_add(&conn->refs, 1);
+    pthread_mutex_lock(&slot->lock);
+    slot->conn = conn;
+    pthread_mutex_unlock(&slot->lock);
+
+    conv->conn = conn;
+    conn->conv = conv;
+    tenant->streams++;
+    STATS_ADD(server, streams, 1);
+
+    /* Without executor threads on_done has run (and queued conv) by now */
+    conv->run = ac_agent_run_async(slot->agent, message->valuestring, server_on_done, conv);
+    cJSON_Delete(body);
+
+    if (!conv->run) {
+        static const char failed[] = "event: done\ndata: {\"error\":\"run not started\"}\n\n";
+        pthread_mutex_lock(&slot->lock);
+        int attached = slot->conn == conn;
+        slot->conn = NULL;
+        pthread_mutex_unlock(&slot->lock);
+        if (attached) {
+            pthread_mutex_lock(&conn->lock);
+            conn_write_locked(conn, failed, sizeof(failed) - 1);
+            conn->finished = 1;
+            pthread_mutex_unlock(&conn->lock);
+            conn_release(conn);
+        }
+        conv->conn = NULL;
+        conn->conv = NULL;
+        tenant->streams--;
+        STATS_ADD(server, streams, (size_t)-1);
+    }
+}
+
+static void route_delete(ac_server_t *server, server_conn_t *conn, server_conv_t *conv) {
+    if (conv->run) {
+        /* Freed once the run reports back */
+        conv->closing = 1;
+        ac_agent_run_cancel(conv->run);
+    } else {
+        conv_close(server, conv);
+    }
+    conn_respond(conn, 204, NULL);
+}
+
+static int path_is(const server_request_t *req, size_t start, size_t len, const char *s) {
+    return strlen(s) == len && memcmp(req->path + start, s, len) == 0;
+}
+
+static void server_route(ac_server_t *server, server_conn_t *conn, const server_request_t *req) {
+    static const char prefix[] = "/v1/conversations";
+    const size_t prefix_len = sizeof(prefix) - 1;
+    int is_get = strcmp(req->method, "GET") == 0;
+    int is_post = strcmp(req->method, "POST") == 0;
+    int is_delete = strcmp(req->method, "DELETE") == 0;
+
+    if (path_is(req, 0, req->path_len, "/healthz")) {
+        if (is_get) {
+            conn_respond(conn, 200, "{\"status\":\"ok\"}");
+        } else {
+            conn_error(conn, 405, "method not allowed");
+        }
+        return;
+    }
+    if (req->path_len < prefix_len || memcmp(req->path, prefix, prefix_len) != 0 ||
+        (req->path_len > prefix_len && req->path[prefix_len] != '/')) {
+        conn_error(conn, 404, "not found");
+        return;
+    }
+
+    /* Admission before anything is created for the tenant */
+    server_tenant_t *tenant = tenant_find(server, req->tenant);
+    ac_server_limits_t limits = tenant ? tenant->limits : server->config.limits;
+    ac_agent_params_t params = server->config.agent;
+    if (server->config.tenant &&
+        server->config.tenant(req->tenant, req->authorization, &limits, &params,
+                              server->config.user_data) != ARC_OK) {
+        conn_error(conn, 403, "forbidden");
+        return;
+    }
+    if (!tenant && !(tenant = tenant_add(server, req->tenant))) {
+        conn_error(conn, 503, "out of memory");
+        return;
+    }
+    tenant->limits = limits;
+
+    if (req->path_len == prefix_len) {
+        if (is_post) {
+            route_create(server, conn, tenant, &params);
+        } else {
+            conn_error(conn, 405, "method not allowed");
+        }
+        return;
+    }
+
+    /* /v1/conversations/{id}[/messages] */
+    size_t id_start = prefix_len + 1;
+    size_t id_end = id_start;
+    while (id_end < req->path_len && req->path[id_end] != '/') {
+        id_end++;
+    }
+    size_t rest = req->path_len - id_end;
+    int messages = rest && path_is(req, id_end, rest, "/messages");
+    if (rest && !messages) {
+        conn_error(conn, 404, "not found");
+        return;
+    }
+
+    server_conv_t *conv = conv_find(server, req->path + id_start, id_end - id_start, tenant);
+    if (!conv) {
+        conn_error(conn, 404, "no such conversation");
+        return;
+    }
+    conv->last_ms = ac_platform_timestamp_ms();
+
+    if (messages && is_post) {
+        route_message(server, conn, conv, req);
+    } else if (!messages && is_delete) {
+        route_delete(server, conn, conv);
+    } else {
+        conn_error(conn, 405, "method not allowed");
+    }
+}
+
+/*============================================================================
+ * HTTP Parsing
+ *============================================================================*/
+
+/**
+ * @brief Content-Length value: digits only
+ *
+ * @return The length, -1 unless all digits ("12abc", "", "-1") or if it
+ *         overflows
+ */
+static long long parse_length(const char *value) {
+    long long length = 0;
+    if (!*value) {
+        return -1;
+    }
+    for (; *value; value++) {
+        if (*value < '0' || *value > '9' || length > (LLONG_MAX - 9) / 10) {
+            return -1;
+        }
+        length = length * 10 + (*value - '0');
+    }
+    return length;
+}
+
+static char *trim(char *s) {
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    size_t len = strlen(s);
+    while (len && (s[len - 1] == ' ' || s[len - 1] == '\t')) {
+        s[--len] = '\0';
+    }
+    return s;
+}
+
+/**
+ * @brief Handle the next complete request in the input buffer
+ *
+ * @return 1 if one was handled, 0 if more input is needed, -1 after an
+ *         error response (close once flushed)
+ */
+static int conn_parse(ac_server_t *server, server_conn_t *conn) {
+    if (!conn->in_len) {
+        return 0;
+    }
+    const char *end = strstr(conn->in, "\r\n\r\n");
+    if (!end) {
+        if (conn->in_len > SERVER_MAX_HEADER) {
+            conn->close_after = 1;
+            conn_error(conn, 431, "header too large");
+            return -1;
+        }
+        return 0;
+    }
+
+    /* Parsed in a copy: the buffer stays intact until the body is in */
+    size_t head_len = (size_t)(end - conn->in) + 4;
+    char *head = malloc(head_len);
+    if (!head) {
+        return -1;
+    }
+    memcpy(head, conn->in, head_len - 4);
+    head[head_len - 4] = '\0';
+
+    /* Request line */
+    char *line_end = strstr(head, "\r\n");
+    if (line_end) {
+        *line_end = '\0';
+    }
+    char *method = head;
+    char *path = strchr(method, ' ');
+    char *version = path ? strchr(path + 1, ' ') : NULL;
+    if (!path || !version || strncmp(version + 1, "HTTP/1.", 7) != 0) {
+        free(head);
+        conn->close_after = 1;
+        conn_error(conn, 400, "bad request line");
+        return -1;
+    }
+    *path++ = '\0';
+    *version++ = '\0';
+    char *query = strchr(path, '?');
+    if (query) {
+        *query = '\0';
+    }
+    int close_after = strcmp(version, "HTTP/1.0") == 0;
+
+    /* Headers */
+    long long content_length = -1;         /* None yet */
+    const char *tenant = "";
+    const char *authorization = NULL;
+    const char *error = NULL;
+    int status = 0;
+    for (char *line = line_end ? line_end + 2 : NULL; line && *line; ) {
+        char *next = strstr(line, "\r\n");
+        if (next) {
+            *next = '\0';
+            next += 2;
+        }
+        char *colon = strchr(line, ':');
+        if (colon) {
+            *colon = '\0';
+            char *value = trim(colon + 1);
+            if (strcasecmp(line, "Content-Length") == 0) {
+                long long length = parse_length(value);
+                if (length < 0 || (content_length >= 0 && length != content_length)) {
+                    status = 400;
+                    error = "bad Content-Length";
+                }
+                content_length = length;
+            } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+                status = 411;
+                error = "chunked bodies are not supported";
+            } else if (strcasecmp(line, "Connection") == 0) {
+                close_after = strcasecmp(value, "close") == 0;
+            } else if (strcasecmp(line, "Authorization") == 0) {
+                authorization = value;
+            } else if (strcasecmp(line, server->tenant_header) == 0) {
+                tenant = value;
+            }
+        }
+        line = next;
+    }
+
+    if (content_length < 0) {
+        content_length = 0;
+    }
+    if (!status && (size_t)content_length > server->config.max_body) {
+        status = 413;
+        error = "body too large";
+    }
+    if (!status && strlen(tenant) > SERVER_MAX_TENANT) {
+        status = 400;
+        error = "tenant name too long";
+    }
+    if (status) {
+        free(head);
+        conn->close_after = 1;
+        conn_error(conn, status, error);
+        return -1;
+    }
+
+    size_t total = head_len + (size_t)content_length;
+    if (conn->in_len < total) {
+        free(head);
+        return 0;
+    }
+
+    conn->close_after = close_after;
+    server_request_t req = {
+        .method = method,
+        .path = path,
+        .path_len = strlen(path),
+        .tenant = tenant,
+        .authorization = authorization,
+        .body = conn->in + head_len,
+        .body_len = (size_t)content_length,
+    };
+    STATS_ADD(server, requests, 1);
+    server_route(server, conn, &req);
+    free(head);
+
+    memmove(conn->in, conn->in + total, conn->in_len - total);
+    conn->in_len -= total;
+    conn->in[conn->in_len] = '\0';
+    return 1;
+}
+
+/**
+ * @brief Read and discard what the socket has
+ *
+ * For a streaming connection whose input buffer is full: the stream
+ * closes the connection when it ends, so the bytes would never be parsed,
+ * and draining them keeps the socket from polling readable forever.
+ *
+ * @return 0 while open, -1 on EOF or error
+ */
+static int conn_discard(server_conn_t *conn) {
+    char scratch[SERVER_READ_CHUNK];
+    for (;;) {
+        ssize_t n = recv(conn->fd, scratch, sizeof(scratch), 0);
+        if (n > 0 || (n < 0 && errno == EINTR)) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        return -1;
+    }
+}
+
+/**
+ * @brief Read what the socket has
+ *
+ * @return 0 while open, -1 on EOF or error
+ */
+static int conn_read(ac_server_t *server, server_conn_t *conn) {
+    for (;;) {
+        if (conn->in_len + SERVER_READ_CHUNK + 1 > conn->in_cap) {
+            size_t limit = SERVER_MAX_HEADER + server->config.max_body + SERVER_READ_CHUNK;
+            if (conn->in_cap >= limit) {
+                return conn->streaming ? conn_discard(conn) : -1;
+            }
+            size_t new_capacity = conn->in_cap ? conn->in_cap * 2 : SERVER_READ_CHUNK * 2;
+            char *grown = realloc(conn->in, new_capacity);
+            if (!grown) {
+                return -1;
+            }
+            conn->in = grown;
+            conn->in_cap = new_capacity;
+        }
+        ssize_t n = recv(conn->fd, conn->in + conn->in_len,
+                         conn->in_cap - conn->in_len - 1, 0);
+        if (n > 0) {
+            conn->in_len += (size_t)n;
+            conn->in[conn->in_len] = '\0';
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        return -1;
+    }
+}
+
+/*============================================================================
+ * Event Loop
+ *============================================================================*/
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static void server_accept(ac_server_t *server) {
+    while (server->conn_count < server->config.max_connections) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (set_nonblocking(fd) != 0) {
+            close(fd);
+            continue;
+        }
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        if (server->conn_count == server->conn_capacity) {
+            size_t new_capacity = server->conn_capacity ? server->conn_capacity * 2 : 64;
+            server_conn_t **grown = realloc(server->conns, new_capacity * sizeof(*grown));
+            if (!grown) {
+                close(fd);
+                return;
+            }
+            server->conns = grown;
+            server->conn_capacity = new_capacity;
+        }
+        server_conn_t *conn = calloc(1, sizeof(*conn));
+        if (!conn || pthread_mutex_init(&conn->lock, NULL) != 0) {
+            free(conn);
+            close(fd);
+            return;
+        }
+        conn->fd = fd;
+        conn->max_out = server->config.max_pending_output;
+        atomic_init(&conn->refs, 1);
+        conn->last_ms = ac_platform_timestamp_ms();
+        server->conns[server->conn_count++] = conn;
+        STATS_ADD(server, connections, 1);
+    }
+}
+
+/**
+ * @brief Close what has been idle for idle_timeout_ms
+ */
+static void server_sweep(ac_server_t *server, uint64_t now) {
+    if (now - server->last_sweep_ms < SERVER_SWEEP_MS) {
+        return;
+    }
+    server->last_sweep_ms = now;
+    uint64_t timeout = server->config.idle_timeout_ms;
+
+    for (size_t b = 0; b < SERVER_CONV_BUCKETS; b++) {
+        server_conv_t *conv = server->buckets[b];
+        while (conv) {
+            server_conv_t *next = conv->next;
+            if (!conv->run && !conv->closing && now - conv->last_ms >= timeout) {
+                AC_LOG_DEBUG("Server: conversation %s expired", conv->id);
+                conv_close(server, conv);
+            }
+            conv = next;
+        }
+    }
+    for (size_t i = server->conn_count; i-- > 0; ) {
+        server_conn_t *conn = server->conns[i];
+        if (!conn->streaming && now - conn->last_ms >= timeout) {
+            server_close_conn(server, i);
+        }
+    }
+}
+
+static void *server_loop(void *arg) {
+    ac_server_t *server = (ac_server_t *)arg;
+    int runtime_fd = server->config.drive_runtime ? ac_runtime_fd() : -1;
+
+    while (!atomic_load(&server->stop)) {
+        size_t fixed = 3;
+        size_t needed = fixed + server->conn_count;
+        if (needed > server->poll_capacity) {
+            struct pollfd *grown = realloc(server->polls, needed * 2 * sizeof(*grown));
+            if (!grown) {
+                ac_platform_sleep_ms(10);
+                continue;
+            }
+            server->polls = grown;
+            server->poll_capacity = needed * 2;
+        }
+
+        struct pollfd *polls = server->polls;
+        polls[0] = (struct pollfd){ .fd = server->wake[0], .events = POLLIN };
+        polls[1] = (struct pollfd){
+            .fd = server->conn_count < server->config.max_connections ? server->listen_fd : -1,
+            .events = POLLIN,
+        };
+        polls[2] = (struct pollfd){ .fd = runtime_fd, .events = POLLIN };
+        size_t polled = server->conn_count;
+        for (size_t i = 0; i < polled; i++) {
+            server_conn_t *conn = server->conns[i];
+            polls[fixed + i] = (struct pollfd){
+                .fd = conn->fd,
+                .events = (short)(POLLIN | (conn_pending(conn) ? POLLOUT : 0)),
+            };
+        }
+
+        int timeout = SERVER_SWEEP_MS;
+        if (server->config.drive_runtime) {
+            int runtime_timeout = ac_runtime_timeout_ms();
+            if (runtime_fd < 0) {
+                runtime_timeout = 10;  /* No fd to watch: poll the engine */
+            }
+            if (runtime_timeout >= 0 && runtime_timeout < timeout) {
+                timeout = runtime_timeout;
+            }
+        }
+
+        int ready = poll(polls, (nfds_t)(fixed + polled), timeout);
+        if (ready < 0 && errno != EINTR) {
+            AC_LOG_ERROR("Server: poll failed (errno %d)", errno);
+            ac_platform_sleep_ms(10);
+            continue;
+        }
+
+        if (server->config.drive_runtime) {
+            ac_runtime_process(0);
+        }
+        if (polls[0].revents & POLLIN) {
+            char drain[64];
+            while (read(server->wake[0], drain, sizeof(drain)) > 0) {
+            }
+            atomic_store(&server->wake_pending, 0);
+        }
+        server_drain_done(server);
+
+        uint64_t now = ac_platform_timestamp_ms();
+
+        /* Backwards: closing swaps in the last, already handled, connection */
+        for (size_t i = polled; i-- > 0; ) {
+            server_conn_t *conn = server->conns[i];
+            short revents = polls[fixed + i].revents;
+            int close_it = 0;
+
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                conn->last_ms = now;
+                if (conn_read(server, conn) != 0) {
+                    close_it = 1;
+                }
+            }
+            while (!close_it && !conn->streaming) {
+                int parsed = conn_parse(server, conn);
+                if (parsed <= 0) {
+                    break;
+                }
+            }
+            if (revents & POLLNVAL) {
+                close_it = 1;
+            }
+            if (!close_it && conn_flush(conn) != 0) {
+                close_it = 1;
+            }
+            if (close_it) {
+                server_close_conn(server, i);
+            }
+        }
+
+        server_sweep(server, now);
+        if (polls[1].revents & POLLIN) {
+            server_accept(server);
+        }
+    }
+    return NULL;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+static int server_listen(ac_server_t *server, const char *bind_addr, uint16_t port) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    if (inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1) {
+        AC_LOG_ERROR("Server: invalid bind address '%s'", bind_addr);
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, SOMAXCONN) != 0 || set_nonblocking(fd) != 0) {
+        AC_LOG_ERROR("Server: cannot listen on %s:%u (errno %d)", bind_addr,
+                     (unsigned)port, errno);
+        close(fd);
+        return -1;
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (struct sockaddr *)&addr, &len);
+    server->port = ntohs(addr.sin_port);
+    return fd;
+}
+
+ac_server_t *ac_server_create(ac_session_t *session, const ac_server_config_t *config) {
+    if (!session || !config || !config->agent.llm.provider) {
+        AC_LOG_ERROR("ac_server_create: session and config.agent.llm required");
+        return NULL;
+    }
+
+    ac_server_t *server = calloc(1, sizeof(*server));
+    if (!server) {
+        return NULL;
+    }
+    server->session = session;
+    server->config = *config;
+    server->listen_fd = -1;
+    server->wake[0] = server->wake[1] = -1;
+
+    if (!server->config.max_body) {
+        server->config.max_body = SERVER_DEFAULT_MAX_BODY;
+    }
+    if (!server->config.max_connections) {
+        server->config.max_connections = SERVER_DEFAULT_MAX_CONNS;
+    }
+    if (!server->config.max_pending_output) {
+        server->config.max_pending_output = SERVER_DEFAULT_MAX_OUTPUT;
+    }
+    if (!server->config.idle_timeout_ms) {
+        server->config.idle_timeout_ms = SERVER_DEFAULT_IDLE_MS;
+    }
+    server->tenant_header = str_dup(config->tenant_header ? config->tenant_header
+                                                          : SERVER_DEFAULT_TENANT_HEADER);
+    server->config.tenant_header = server->tenant_header;
+    server->config.bind = NULL;
+    server->id_state = ac_platform_monotonic_us() ^ ((uint64_t)(uintptr_t)server << 16);
+    server->last_sweep_ms = ac_platform_timestamp_ms();
+
+    if (!server->tenant_header || pthread_mutex_init(&server->lock, NULL) != 0) {
+        free(server->tenant_header);
+        free(server);
+        return NULL;
+    }
+
+    server->listen_fd = server_listen(server, config->bind ? config->bind : SERVER_DEFAULT_BIND,
+                                      config->port);
+    if (server->listen_fd < 0 || pipe(server->wake) != 0 ||
+        set_nonblocking(server->wake[0]) != 0 || set_nonblocking(server->wake[1]) != 0 ||
+        pthread_create(&server->thread, NULL, server_loop, server) != 0) {
+        if (server->listen_fd >= 0) {
+            close(server->listen_fd);
+        }
+        if (server->wake[0] >= 0) {
+            close(server->wake[0]);
+            close(server->wake[1]);
+        }
+        pthread_mutex_destroy(&server->lock);
+        free(server->tenant_header);
+        free(server);
+        return NULL;
+    }
+
+    AC_LOG_INFO("Server: listening on port %u", (unsigned)server->port);
+    return server;
+}
+
+uint16_t ac_server_port(const ac_server_t *server) {
+    return server ? server->port : 0;
+}
+
+arc_err_t ac_server_get_stats(ac_server_t *server, ac_server_stats_t *stats) {
+    if (!server || !stats) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&server->lock);
+    *stats = server->stats;
+    pthread_mutex_unlock(&server->lock);
+    return ARC_OK;
+}
+
+void ac_server_destroy(ac_server_t *server) {
+    if (!server) {
+        return;
+    }
+
+    atomic_store(&server->stop, 1);
+    server_wake(server);
+    pthread_join(server->thread, NULL);
+
+    /* Runs report to the connections: finish them first */
+    for (size_t b = 0; b < SERVER_CONV_BUCKETS; b++) {
+        for (server_conv_t *conv = server->buckets[b]; conv; conv = conv->next) {
+            if (conv->run) {
+                ac_agent_run_cancel(conv->run);
+                ac_agent_run_wait(conv->run);
+            }
+        }
+    }
+    server_drain_done(server);
+
+    while (server->conn_count) {
+        server_close_conn(server, server->conn_count - 1);
+    }
+    for (size_t b = 0; b < SERVER_CONV_BUCKETS; b++) {
+        server_conv_t *conv = server->buckets[b];
+        while (conv) {
+            server_conv_t *next = conv->next;
+            free(conv);
+            conv = next;
+        }
+    }
+    for (size_t i = 0; i < server->agent_count; i++) {
+        pthread_mutex_destroy(&server->agents[i]->lock);
+        free(server->agents[i]);
+    }
+    server_tenant_t *tenant = server->tenants;
+    while (tenant) {
+        server_tenant_t *next = tenant->next;
+        ac_history_segment_release(tenant->blank);
+        free(tenant->name);
+        free(tenant);
+        tenant = next;
+    }
+
+    close(server->listen_fd);
+    close(server->wake[0]);
+    close(server->wake[1]);
+    pthread_mutex_destroy(&server->lock);
+    free(server->conns);
+    free(server->polls);
+    free(server->agents);
+    free(server->tenant_header);
+    free(server);
+}
+
+#endif /* _WIN32 */
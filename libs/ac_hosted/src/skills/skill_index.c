@@ -0,0 +1,318 @@
+/**
+ * @file skill_index.c
+ * @brief Persistent index of parsed SKILL.md frontmatter
+ *
+ * Discovery with an index (ac_skills_set_index()) only stats SKILL.md
+ * files; one whose path, mtime and size match its index entry is not
+ * read again. The index is a text file, one skill per line:
+ *
+ *   arc-skills-index 1
+ *   <dir>\t<mtime s>\t<mtime ns>\t<size>\t<name>\t<description>\t<license>\t<compatibility>\t<tools>
+ *
+ * Tabs, newlines and backslashes in fields are escaped as \t, \n, \r and
+ * \\; absent optional fields are empty and tools are space-separated.
+ * A file that does not parse is treated as empty and rewritten.
+ */
+
+#include "skills_internal.h"
+#include <arc/log.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <process.h>
+#define index_getpid _getpid
+#else
+#include <unistd.h>
+#define index_getpid getpid
+#endif
+
+#define INDEX_HEADER "arc-skills-index 1\n"
+#define INDEX_FIELDS 9
+
+struct skill_index {
+    skill_index_entry_t *entries;   /* Sorted by dir_path */
+    size_t count;
+};
+
+/*============================================================================
+ * Escaping
+ *============================================================================*/
+
+static void write_field(FILE *fp, const char *s) {
+    for (; s && *s; s++) {
+        switch (*s) {
+            case '\\': fputs("\\\\", fp); break;
+            case '\t': fputs("\\t", fp); break;
+            case '\n': fputs("\\n", fp); break;
+            case '\r': fputs("\\r", fp); break;
+            default: fputc(*s, fp); break;
+        }
+    }
+}
+
+/**
+ * @brief Unescape a field of len bytes
+ * @return New string, NULL for an empty field or when out of memory
+ */
+static char *read_field(const char *s, size_t len) {
+    if (len == 0) {
+        return NULL;
+    }
+    char *out = malloc(len + 1);
+    if (!out) {
+        return NULL;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '\\' && i + 1 < len) {
+            i++;
+            out[n++] = s[i] == 't' ? '\t' : s[i] == 'n' ? '\n' : s[i] == 'r' ? '\r' : s[i];
+        } else {
+            out[n++] = s[i];
+        }
+    }
+    out[n] = '\0';
+    return out;
+}
+
+/** Split a space-separated tool list into a NULL-terminated array */
+static char **read_tools(const char *s, size_t *count) {
+    *count = 0;
+    if (!s) {
+        return NULL;
+    }
+    size_t n = 1;
+    for (const char *p = s; *p; p++) {
+        n += *p == ' ';
+    }
+    char **tools = calloc(n + 1, sizeof(char *));
+    if (!tools) {
+        return NULL;
+    }
+    const char *p = s;
+    for (;;) {
+        const char *end = strchr(p, ' ');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len > 0) {
+            tools[*count] = malloc(len + 1);
+            if (!tools[*count]) {
+                break;
+            }
+            memcpy(tools[*count], p, len);
+            tools[*count][len] = '\0';
+            (*count)++;
+        }
+        if (!end) {
+            break;
+        }
+        p = end + 1;
+    }
+    return tools;
+}
+
+/*============================================================================
+ * Loading
+ *============================================================================*/
+
+/**
+ * @brief Parse one index line into entry
+ * @return 0 on success, -1 if the line is malformed
+ */
+static int parse_line(const char *line, size_t len, skill_index_entry_t *entry) {
+    const char *fields[INDEX_FIELDS];
+    size_t lens[INDEX_FIELDS];
+    size_t n = 0;
+    const char *p = line;
+    const char *end = line + len;
+    while (n < INDEX_FIELDS) {
+        const char *tab = memchr(p, '\t', (size_t)(end - p));
+        const char *stop = tab ? tab : end;
+        fields[n] = p;
+        lens[n] = (size_t)(stop - p);
+        n++;
+        if (!tab) {
+            break;
+        }
+        p = tab + 1;
+    }
+    if (n != INDEX_FIELDS) {
+        return -1;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->mtime_sec = strtoll(fields[1], NULL, 10);
+    entry->mtime_nsec = strtol(fields[2], NULL, 10);
+    entry->size = strtoll(fields[3], NULL, 10);
+
+    char *tools = read_field(fields[8], lens[8]);
+    entry->dir_path = read_field(fields[0], lens[0]);
+    entry->meta.name = read_field(fields[4], lens[4]);
+    entry->meta.description = read_field(fields[5], lens[5]);
+    entry->meta.license = read_field(fields[6], lens[6]);
+    entry->meta.compatibility = read_field(fields[7], lens[7]);
+    entry->meta.allowed_tools = read_tools(tools, &entry->meta.allowed_tools_count);
+    free(tools);
+
+    if (!entry->dir_path || !entry->meta.name || !entry->meta.description) {
+        free(entry->dir_path);
+        skill_meta_free(&entry->meta);
+        return -1;
+    }
+    return 0;
+}
+
+static int entry_cmp(const void *a, const void *b) {
+    return strcmp(((const skill_index_entry_t *)a)->dir_path,
+                  ((const skill_index_entry_t *)b)->dir_path);
+}
+
+skill_index_t *skill_index_load(const char *path) {
+    skill_index_t *index = calloc(1, sizeof(*index));
+    if (!index) {
+        return NULL;
+    }
+
+    char *content = path ? skill_read_file(path) : NULL;
+    if (!content || strncmp(content, INDEX_HEADER, strlen(INDEX_HEADER)) != 0) {
+        if (content) {
+            AC_LOG_WARN("Ignoring skills index of another format: %s", path);
+        }
+        free(content);
+        return index;
+    }
+
+    size_t lines = 0;
+    for (const char *p = content; *p; p++) {
+        lines += *p == '\n';
+    }
+    index->entries = calloc(lines ? lines : 1, sizeof(skill_index_entry_t));
+    if (!index->entries) {
+        free(content);
+        free(index);
+        return NULL;
+    }
+
+    const char *p = content + strlen(INDEX_HEADER);
+    while (*p) {
+        const char *nl = strchr(p, '\n');
+        size_t len = nl ? (size_t)(nl - p) : strlen(p);
+        if (len > 0 && index->count < lines &&
+            parse_line(p, len, &index->entries[index->count]) == 0) {
+            index->count++;
+        }
+        p += len + (nl ? 1 : 0);
+    }
+    free(content);
+
+    qsort(index->entries, index->count, sizeof(skill_index_entry_t), entry_cmp);
+    AC_LOG_DEBUG("Loaded skills index %s (%zu entries)", path, index->count);
+    return index;
+}
+
+const skill_index_entry_t *skill_index_find(const skill_index_t *index, const char *dir_path) {
+    if (!index || index->count == 0) {
+        return NULL;
+    }
+    skill_index_entry_t key = { .dir_path = (char *)dir_path };
+    return bsearch(&key, index->entries, index->count, sizeof(skill_index_entry_t), entry_cmp);
+}
+
+size_t skill_index_count_under(const skill_index_t *index, const char *prefix) {
+    size_t n = 0;
+    size_t len = strlen(prefix);
+    for (size_t i = 0; index && i < index->count; i++) {
+        n += strncmp(index->entries[i].dir_path, prefix, len) == 0;
+    }
+    return n;
+}
+
+/*============================================================================
+ * Saving
+ *============================================================================*/
+
+static void write_entry(FILE *fp, const skill_index_entry_t *e) {
+    write_field(fp, e->dir_path);
+    fprintf(fp, "\t%lld\t%ld\t%lld\t", (long long)e->mtime_sec, e->mtime_nsec,
+            (long long)e->size);
+    write_field(fp, e->meta.name);
+    fputc('\t', fp);
+    write_field(fp, e->meta.description);
+    fputc('\t', fp);
+    write_field(fp, e->meta.license);
+    fputc('\t', fp);
+    write_field(fp, e->meta.compatibility);
+    fputc('\t', fp);
+    for (size_t i = 0; i < e->meta.allowed_tools_count; i++) {
+        if (i > 0) {
+            fputc(' ', fp);
+        }
+        write_field(fp, e->meta.allowed_tools[i]);
+    }
+    fputc('\n', fp);
+}
+
+arc_err_t skill_index_save(
+    const char *path,
+    const skill_index_t *old,
+    const char *prefix,
+    const skill_index_entry_t *const *entries,
+    size_t count
+) {
+    size_t tmp_len = strlen(path) + 32;
+    char *tmp = malloc(tmp_len);
+    if (!tmp) {
+        return ARC_ERR_MEMORY;
+    }
+    snprintf(tmp, tmp_len, "%s.%d.tmp", path, (int)index_getpid());
+
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) {
+        AC_LOG_WARN("Cannot write skills index %s", tmp);
+        free(tmp);
+        return ARC_ERR_IO;
+    }
+
+    fputs(INDEX_HEADER, fp);
+    size_t prefix_len = strlen(prefix);
+    for (size_t i = 0; old && i < old->count; i++) {
+        if (strncmp(old->entries[i].dir_path, prefix, prefix_len) != 0) {
+            write_entry(fp, &old->entries[i]);
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        write_entry(fp, entries[i]);
+    }
+
+    int failed = ferror(fp);
+    failed |= fclose(fp) != 0;
+#if defined(_WIN32)
+    /* rename() does not replace an existing file here */
+    if (!failed) {
+        remove(path);
+    }
+#endif
+    if (failed || rename(tmp, path) != 0) {
+        AC_LOG_WARN("Cannot write skills index %s", path);
+        remove(tmp);
+        free(tmp);
+        return ARC_ERR_IO;
+    }
+    free(tmp);
+
+    AC_LOG_DEBUG("Saved skills index %s", path);
+    return ARC_OK;
+}
+
+void skill_index_free(skill_index_t *index) {
+    if (!index) {
+        return;
+    }
+    for (size_t i = 0; i < index->count; i++) {
+        free(index->entries[i].dir_path);
+        skill_meta_free(&index->entries[i].meta);
+    }
+    free(index->entries);
+    free(index);
+}
@@ -25,6 +25,12 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 /* Windows compatibility: S_ISREG may not be defined in sys/stat.h */
 #ifndef S_ISREG
 #define S_ISREG(mode) (((mode) & S_IFMT) == S_IFREG)
@@ -227,6 +233,31 @@ bool skill_validate_name(const char *name) {
     return true;
 }
 
+/**
+ * @brief Find the "---" line closing the frontmatter that starts at p
+ */
+static const char *find_closing_fence(const char *p) {
+    while (*p) {
+        if (is_fence_line(p)) {
+            return p;
+        }
+        p = next_line(p);
+    }
+    return NULL;
+}
+
+const char *skill_find_body(const char *content) {
+    const char *p = content;
+    while (*p && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+    if (!is_fence_line(p)) {
+        return NULL;
+    }
+    const char *fm_end = find_closing_fence(next_line(p));
+    return fm_end ? next_line(fm_end) : NULL;
+}
+
 arc_err_t skill_parse_frontmatter(
     const char *content,
     ac_skill_meta_t *meta,
@@ -257,15 +288,7 @@ arc_err_t skill_parse_frontmatter(
     const char *fm_start = p;
 
     /* Find closing fence */
-    const char *fm_end = NULL;
-    while (*p) {
-        if (is_fence_line(p)) {
-            fm_end = p;
-            break;
-        }
-        p = next_line(p);
-    }
-
+    const char *fm_end = find_closing_fence(p);
     if (!fm_end) {
         AC_LOG_WARN("SKILL.md missing closing '---' fence");
         return ARC_ERR_PARSE;
@@ -369,6 +392,38 @@ void skill_meta_free(ac_skill_meta_t *meta) {
     memset(meta, 0, sizeof(*meta));
 }
 
+arc_err_t skill_meta_copy(ac_skill_meta_t *dst, const ac_skill_meta_t *src) {
+    memset(dst, 0, sizeof(*dst));
+
+    dst->name = src->name ? strdup(src->name) : NULL;
+    dst->description = src->description ? strdup(src->description) : NULL;
+    dst->license = src->license ? strdup(src->license) : NULL;
+    dst->compatibility = src->compatibility ? strdup(src->compatibility) : NULL;
+    if ((src->name && !dst->name) || (src->description && !dst->description) ||
+        (src->license && !dst->license) || (src->compatibility && !dst->compatibility)) {
+        skill_meta_free(dst);
+        return ARC_ERR_MEMORY;
+    }
+
+    if (src->allowed_tools_count > 0) {
+        dst->allowed_tools = calloc(src->allowed_tools_count + 1, sizeof(char *));
+        if (!dst->allowed_tools) {
+            skill_meta_free(dst);
+            return ARC_ERR_MEMORY;
+        }
+        for (size_t i = 0; i < src->allowed_tools_count; i++) {
+            dst->allowed_tools[i] = strdup(src->allowed_tools[i]);
+            if (!dst->allowed_tools[i]) {
+                dst->allowed_tools_count = i;
+                skill_meta_free(dst);
+                return ARC_ERR_MEMORY;
+            }
+        }
+        dst->allowed_tools_count = src->allowed_tools_count;
+    }
+    return ARC_OK;
+}
+
 /*============================================================================
  * File Utilities
  *============================================================================*/
@@ -407,6 +462,78 @@ char *skill_read_file(const char *filepath) {
     return content;
 }
 
+#if !defined(_WIN32)
+
+skill_file_t *skill_file_map(const char *filepath) {
+    if (!filepath) return NULL;
+
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        AC_LOG_DEBUG("Failed to open file: %s", filepath);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t len = (size_t)st.st_size;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t map_len = (len / page + 1) * page;
+
+    /* Zero pages first, then the file over them: the byte after the file
+     * is either the zeroed tail of its last page or in a zero page */
+    void *map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map != MAP_FAILED &&
+        mmap(map, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(map, map_len);
+        map = MAP_FAILED;
+    }
+    close(fd);
+
+    skill_file_t *file = map != MAP_FAILED ? malloc(sizeof(*file)) : NULL;
+    if (!file) {
+        if (map != MAP_FAILED) munmap(map, map_len);
+        return NULL;
+    }
+    file->data = map;
+    file->len = len;
+    file->map = map;
+    file->map_len = map_len;
+    return file;
+}
+
+void skill_file_unmap(skill_file_t *file) {
+    if (!file) return;
+    munmap(file->map, file->map_len);
+    free(file);
+}
+
+#else /* _WIN32 */
+
+skill_file_t *skill_file_map(const char *filepath) {
+    char *content = skill_read_file(filepath);
+    skill_file_t *file = content ? malloc(sizeof(*file)) : NULL;
+    if (!file) {
+        free(content);
+        return NULL;
+    }
+    file->data = content;
+    file->len = strlen(content);
+    file->map = content;
+    file->map_len = file->len + 1;
+    return file;
+}
+
+void skill_file_unmap(skill_file_t *file) {
+    if (!file) return;
+    free(file->map);
+    free(file);
+}
+
+#endif /* !_WIN32 */
+
 bool skill_file_exists(const char *filepath) {
     if (!filepath) return false;
 
@@ -83,7 +83,7 @@ char *skill_format_active(const ac_skill_t *skill) {
      */
 
     size_t name_len = strlen(skill->meta.name);
-    size_t content_len = strlen(content);
+    size_t content_len = skill->content ? skill->content_len : 0;
 
     /* <skill name=""> + content + \n</skill>\n\n + null */
     size_t total = 14 + name_len + 2 + content_len + 12 + 1;
@@ -113,11 +113,32 @@ char *skill_format_active(const ac_skill_t *skill) {
     return result;
 }
 
-char *ac_skills_build_discovery_prompt(const ac_skills_t *skills) {
-    if (!skills || !skills->head) {
-        return NULL;
+/*============================================================================
+ * Prompt Cache
+ *============================================================================*/
+
+const char *skill_prompt_cached(
+    const ac_skills_t *skills,
+    const skill_prompt_cache_t *cache,
+    char *(*build)(const ac_skills_t *skills)
+) {
+    /* The cache is not part of the manager's observable state */
+    skill_prompt_cache_t *c = (skill_prompt_cache_t *)cache;
+    if (c->generation != skills->generation + 1) {
+        free(c->text);
+        c->text = build(skills);
+        c->generation = skills->generation + 1;
     }
+    return c->text;
+}
+
+void skill_prompt_cache_free(skill_prompt_cache_t *cache) {
+    free(cache->text);
+    cache->text = NULL;
+    cache->generation = 0;
+}
 
+char *skill_discovery_prompt_for(const ac_skill_t *const *list, size_t count) {
     /* Calculate total size for XML format:
      * <available_skills>
      *   <skill>
@@ -128,15 +149,14 @@ char *ac_skills_build_discovery_prompt(const ac_skills_t *skills) {
      */
     size_t total_size = strlen(DISCOVERY_HEADER) + strlen(DISCOVERY_FOOTER) + 1;
 
-    const ac_skill_t *skill = skills->head;
-    while (skill) {
+    for (size_t i = 0; i < count; i++) {
+        const ac_skill_t *skill = list[i];
         if (skill->meta.name && skill->meta.description) {
             /* XML tags overhead + content */
             total_size += 80; /* <skill>\n  <name></name>\n  <description></description>\n</skill>\n */
             total_size += strlen(skill->meta.name);
             total_size += strlen(skill->meta.description);
         }
-        skill = skill->next;
     }
 
     /* Allocate buffer */
@@ -155,8 +175,8 @@ char *ac_skills_build_discovery_prompt(const ac_skills_t *skills) {
     p += header_len;
 
     /* Skill entries in XML format */
-    skill = skills->head;
-    while (skill) {
+    for (size_t i = 0; i < count; i++) {
+        const ac_skill_t *skill = list[i];
         if (skill->meta.name && skill->meta.description) {
             p += sprintf(p,
                 "  <skill>\n"
@@ -165,7 +185,6 @@ char *ac_skills_build_discovery_prompt(const ac_skills_t *skills) {
                 "  </skill>\n",
                 skill->meta.name, skill->meta.description);
         }
-        skill = skill->next;
     }
 
     /* Footer */
@@ -176,13 +195,33 @@ char *ac_skills_build_discovery_prompt(const ac_skills_t *skills) {
     *p = '\0';
 
     AC_LOG_DEBUG("Built discovery prompt (%zu bytes, %zu skills)",
-                 p - prompt, skills->count);
+                 p - prompt, count);
 
     return prompt;
 }
 
-char *ac_skills_build_active_prompt(const ac_skills_t *skills) {
-    if (!skills || skills->enabled_count == 0) {
+static char *build_discovery_prompt(const ac_skills_t *skills) {
+    if (!skills->head) {
+        return NULL;
+    }
+
+    const ac_skill_t **list = malloc(skills->count * sizeof(*list));
+    if (!list) {
+        AC_LOG_ERROR("Failed to allocate discovery prompt buffer");
+        return NULL;
+    }
+    size_t count = 0;
+    for (const ac_skill_t *skill = skills->head; skill && count < skills->count; skill = skill->next) {
+        list[count++] = skill;
+    }
+
+    char *prompt = skill_discovery_prompt_for(list, count);
+    free(list);
+    return prompt;
+}
+
+static char *build_active_prompt(const ac_skills_t *skills) {
+    if (skills->enabled_count == 0) {
         return NULL;
     }
 
@@ -192,9 +231,9 @@ char *ac_skills_build_active_prompt(const ac_skills_t *skills) {
     const ac_skill_t *skill = skills->head;
     while (skill) {
         if (skill->state == AC_SKILL_ENABLED && skill->meta.name) {
-            const char *content = skill->content ? skill->content : "";
+            size_t content_len = skill->content ? skill->content_len : 0;
             /* <skill name="name">\ncontent\n</skill>\n\n */
-            total_size += 14 + strlen(skill->meta.name) + 2 + strlen(content) + 12;
+            total_size += 14 + strlen(skill->meta.name) + 2 + content_len + 12;
         }
         skill = skill->next;
     }
@@ -241,3 +280,23 @@ char *ac_skills_build_active_prompt(const ac_skills_t *skills) {
 
     return prompt;
 }
+
+const char *ac_skills_discovery_prompt(const ac_skills_t *skills) {
+    return skills ? skill_prompt_cached(skills, &skills->discovery_prompt,
+                                        build_discovery_prompt) : NULL;
+}
+
+const char *ac_skills_active_prompt(const ac_skills_t *skills) {
+    return skills ? skill_prompt_cached(skills, &skills->active_prompt,
+                                        build_active_prompt) : NULL;
+}
+
+char *ac_skills_build_discovery_prompt(const ac_skills_t *skills) {
+    const char *prompt = ac_skills_discovery_prompt(skills);
+    return prompt ? strdup(prompt) : NULL;
+}
+
+char *ac_skills_build_active_prompt(const ac_skills_t *skills) {
+    const char *prompt = ac_skills_active_prompt(skills);
+    return prompt ? strdup(prompt) : NULL;
+}
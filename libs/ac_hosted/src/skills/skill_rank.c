@@ -0,0 +1,438 @@
+/**
+ * @file skill_rank.c
+ * @brief Relevance ranking of skills for a user message
+ *
+ * Okapi BM25 over each skill's name, description and SKILL.md headings,
+ * with name and heading terms counting as several occurrences. Terms are
+ * lowercase ASCII alphanumeric runs of two or more characters, minus a
+ * few English stopwords, so "code-review" indexes as "code" and "review".
+ *
+ * The inverted index is built on first use and kept until skills change
+ * (ac_skills_generation()). Building it reads the body of every skill
+ * that is not loaded yet, for the headings.
+ */
+
+#include "skills_internal.h"
+#include <arc/log.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RANK_K1 1.2
+#define RANK_B 0.75
+
+/* Occurrences a term counts for, by field */
+#define RANK_NAME_WEIGHT 3
+#define RANK_HEADING_WEIGHT 2
+#define RANK_TEXT_WEIGHT 1
+
+/* Longer terms are cut; nothing useful is that long */
+#define RANK_MAX_TERM 32
+
+/* Distinct terms taken from one query */
+#define RANK_MAX_QUERY_TERMS 64
+
+typedef struct {
+    uint32_t doc;
+    uint32_t tf;                     /* Weighted occurrences */
+} rank_posting_t;
+
+typedef struct {
+    char *term;
+    rank_posting_t *postings;        /* Ascending doc */
+    size_t count;
+    size_t cap;
+} rank_term_t;
+
+struct skill_rank {
+    const ac_skill_t **docs;
+    size_t doc_count;
+    double *doc_len;
+    double avg_len;
+
+    rank_term_t *terms;
+    size_t term_count;
+    size_t term_cap;
+
+    uint32_t *slots;                 /* Term index + 1, 0 = free */
+    size_t slot_mask;
+};
+
+static const char *const STOPWORDS[] = {
+    "an", "and", "are", "as", "at", "be", "by", "can", "do", "for", "from",
+    "how", "in", "is", "it", "me", "my", "of", "on", "or", "please", "that",
+    "the", "this", "to", "use", "what", "when", "with", "you", "your",
+};
+
+/*============================================================================
+ * Terms
+ *============================================================================*/
+
+typedef void (*term_fn)(const char *term, size_t len, void *arg);
+
+static bool is_stopword(const char *term, size_t len) {
+    for (size_t i = 0; i < sizeof(STOPWORDS) / sizeof(STOPWORDS[0]); i++) {
+        if (strlen(STOPWORDS[i]) == len && memcmp(STOPWORDS[i], term, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Split len bytes of text into terms */
+static void tokenize(const char *text, size_t len, term_fn fn, void *arg) {
+    char term[RANK_MAX_TERM];
+    size_t n = 0;
+    for (size_t i = 0; i <= len; i++) {
+        unsigned char c = i < len ? (unsigned char)text[i] : 0;
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+            if (n < sizeof(term)) term[n++] = (char)c;
+        } else if (c >= 'A' && c <= 'Z') {
+            if (n < sizeof(term)) term[n++] = (char)(c - 'A' + 'a');
+        } else {
+            if (n >= 2 && !is_stopword(term, n)) {
+                fn(term, n, arg);
+            }
+            n = 0;
+        }
+    }
+}
+
+static uint32_t term_hash(const char *term, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)term[i]) * 16777619u;
+    }
+    return h;
+}
+
+/** Slot of a term: holding it, or the free slot where it would go */
+static size_t term_slot(const struct skill_rank *rank, const char *term, size_t len) {
+    size_t slot = term_hash(term, len) & rank->slot_mask;
+    while (rank->slots[slot] != 0) {
+        const char *t = rank->terms[rank->slots[slot] - 1].term;
+        if (strncmp(t, term, len) == 0 && t[len] == '\0') {
+            break;
+        }
+        slot = (slot + 1) & rank->slot_mask;
+    }
+    return slot;
+}
+
+static rank_term_t *term_find(const struct skill_rank *rank, const char *term, size_t len) {
+    if (!rank->slots) {
+        return NULL;
+    }
+    uint32_t entry = rank->slots[term_slot(rank, term, len)];
+    return entry ? &rank->terms[entry - 1] : NULL;
+}
+
+static bool slots_grow(struct skill_rank *rank) {
+    size_t count = rank->slot_mask ? (rank->slot_mask + 1) * 2 : 256;
+    uint32_t *slots = calloc(count, sizeof(uint32_t));
+    if (!slots) {
+        return false;
+    }
+    free(rank->slots);
+    rank->slots = slots;
+    rank->slot_mask = count - 1;
+    for (size_t i = 0; i < rank->term_count; i++) {
+        const char *t = rank->terms[i].term;
+        rank->slots[term_slot(rank, t, strlen(t))] = (uint32_t)(i + 1);
+    }
+    return true;
+}
+
+static rank_term_t *term_get(struct skill_rank *rank, const char *term, size_t len) {
+    if ((rank->term_count + 1) * 2 > rank->slot_mask + 1 && !slots_grow(rank)) {
+        return NULL;
+    }
+    size_t slot = term_slot(rank, term, len);
+    if (rank->slots[slot] != 0) {
+        return &rank->terms[rank->slots[slot] - 1];
+    }
+    if (rank->term_count == rank->term_cap) {
+        size_t cap = rank->term_cap ? rank->term_cap * 2 : 256;
+        rank_term_t *terms = realloc(rank->terms, cap * sizeof(*terms));
+        if (!terms) {
+            return NULL;
+        }
+        rank->terms = terms;
+        rank->term_cap = cap;
+    }
+    rank_term_t *t = &rank->terms[rank->term_count];
+    memset(t, 0, sizeof(*t));
+    if (!(t->term = malloc(len + 1))) {
+        return NULL;
+    }
+    memcpy(t->term, term, len);
+    t->term[len] = '\0';
+    rank->slots[slot] = (uint32_t)++rank->term_count;
+    return t;
+}
+
+/*============================================================================
+ * Building
+ *============================================================================*/
+
+typedef struct {
+    struct skill_rank *rank;
+    uint32_t doc;
+    uint32_t weight;
+} add_ctx_t;
+
+static void add_term(const char *term, size_t len, void *arg) {
+    add_ctx_t *ctx = arg;
+    rank_term_t *t = term_get(ctx->rank, term, len);
+    if (!t) {
+        return;
+    }
+    if (t->count > 0 && t->postings[t->count - 1].doc == ctx->doc) {
+        t->postings[t->count - 1].tf += ctx->weight;
+    } else {
+        if (t->count == t->cap) {
+            size_t cap = t->cap ? t->cap * 2 : 4;
+            rank_posting_t *postings = realloc(t->postings, cap * sizeof(*postings));
+            if (!postings) {
+                return;
+            }
+            t->postings = postings;
+            t->cap = cap;
+        }
+        t->postings[t->count++] = (rank_posting_t){ ctx->doc, ctx->weight };
+    }
+    ctx->rank->doc_len[ctx->doc] += ctx->weight;
+}
+
+/** Index the markdown headings of a body, skipping fenced code */
+static void add_headings(add_ctx_t *ctx, const char *body, size_t len) {
+    const char *p = body;
+    const char *end = body + len;
+    bool in_fence = false;
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        const char *eol = nl ? nl : end;
+        const char *s = p;
+        while (s < eol && s - p < 4 && *s == ' ') s++;
+        if (eol - s >= 3 && (strncmp(s, "```", 3) == 0 || strncmp(s, "~~~", 3) == 0)) {
+            in_fence = !in_fence;
+        } else if (!in_fence && s < eol && *s == '#') {
+            while (s < eol && *s == '#') s++;
+            tokenize(s, (size_t)(eol - s), add_term, ctx);
+        }
+        p = nl ? nl + 1 : end;
+    }
+}
+
+static void add_skill(struct skill_rank *rank, uint32_t doc, const ac_skill_t *skill) {
+    add_ctx_t ctx = { rank, doc, RANK_NAME_WEIGHT };
+    tokenize(skill->meta.name, strlen(skill->meta.name), add_term, &ctx);
+    ctx.weight = RANK_TEXT_WEIGHT;
+    tokenize(skill->meta.description, strlen(skill->meta.description), add_term, &ctx);
+
+    ctx.weight = RANK_HEADING_WEIGHT;
+    if (skill->content) {
+        add_headings(&ctx, skill->content, skill->content_len);
+        return;
+    }
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/SKILL.md", skill->dir_path);
+    skill_file_t *file = skill_file_map(path);
+    const char *body = file ? skill_find_body(file->data) : NULL;
+    if (body) {
+        add_headings(&ctx, body, file->len - (size_t)(body - file->data));
+    }
+    skill_file_unmap(file);
+}
+
+static skill_rank_t *rank_build(const ac_skills_t *skills) {
+    skill_rank_t *rank = calloc(1, sizeof(*rank));
+    if (!rank) {
+        return NULL;
+    }
+    rank->docs = calloc(skills->count ? skills->count : 1, sizeof(*rank->docs));
+    rank->doc_len = calloc(skills->count ? skills->count : 1, sizeof(double));
+    if (!rank->docs || !rank->doc_len) {
+        skill_rank_free(rank);
+        return NULL;
+    }
+
+    double total = 0;
+    for (const ac_skill_t *s = skills->head; s && rank->doc_count < skills->count; s = s->next) {
+        if (!s->meta.name || !s->meta.description) {
+            continue;
+        }
+        uint32_t doc = (uint32_t)rank->doc_count++;
+        rank->docs[doc] = s;
+        add_skill(rank, doc, s);
+        total += rank->doc_len[doc];
+    }
+    rank->avg_len = rank->doc_count ? total / (double)rank->doc_count : 0;
+
+    AC_LOG_DEBUG("Built skill relevance index (%zu skills, %zu terms)",
+                 rank->doc_count, rank->term_count);
+    return rank;
+}
+
+void skill_rank_free(skill_rank_t *rank) {
+    if (!rank) {
+        return;
+    }
+    for (size_t i = 0; i < rank->term_count; i++) {
+        free(rank->terms[i].term);
+        free(rank->terms[i].postings);
+    }
+    free(rank->terms);
+    free(rank->slots);
+    free(rank->docs);
+    free(rank->doc_len);
+    free(rank);
+}
+
+/*============================================================================
+ * Scoring
+ *============================================================================*/
+
+typedef struct {
+    const struct skill_rank *rank;
+    const rank_term_t *terms[RANK_MAX_QUERY_TERMS];
+    size_t count;
+} query_ctx_t;
+
+static void query_term(const char *term, size_t len, void *arg) {
+    query_ctx_t *q = arg;
+    const rank_term_t *t = term_find(q->rank, term, len);
+    if (!t || q->count == RANK_MAX_QUERY_TERMS) {
+        return;
+    }
+    for (size_t i = 0; i < q->count; i++) {
+        if (q->terms[i] == t) {
+            return;
+        }
+    }
+    q->terms[q->count++] = t;
+}
+
+/** BM25 score of every indexed skill for query */
+static void rank_score(const struct skill_rank *rank, const char *query, double *scores) {
+    query_ctx_t q = { .rank = rank };
+    tokenize(query, strlen(query), query_term, &q);
+
+    double n = (double)rank->doc_count;
+    for (size_t i = 0; i < q.count; i++) {
+        const rank_term_t *t = q.terms[i];
+        double df = (double)t->count;
+        double idf = log(1.0 + (n - df + 0.5) / (df + 0.5));
+        for (size_t j = 0; j < t->count; j++) {
+            const rank_posting_t *p = &t->postings[j];
+            double tf = p->tf;
+            double norm = 1.0 - RANK_B + RANK_B * rank->doc_len[p->doc] / rank->avg_len;
+            scores[p->doc] += idf * tf * (RANK_K1 + 1.0) / (tf + RANK_K1 * norm);
+        }
+    }
+}
+
+typedef struct {
+    const ac_skill_t *skill;
+    double score;
+    size_t order;
+} ranked_t;
+
+static int ranked_cmp(const void *a, const void *b) {
+    const ranked_t *x = a;
+    const ranked_t *y = b;
+    if (x->score != y->score) {
+        return x->score < y->score ? 1 : -1;
+    }
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t ac_skills_set_scorer(ac_skills_t *skills, ac_skill_scorer_fn scorer, void *user_data) {
+    if (!skills) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    skills->scorer = scorer;
+    skills->scorer_data = user_data;
+    return ARC_OK;
+}
+
+size_t ac_skills_select(
+    const ac_skills_t *skills,
+    const char *query,
+    const ac_skill_t **out,
+    size_t top_k
+) {
+    if (!skills || !query || !out || top_k == 0) {
+        return 0;
+    }
+
+    /* The index is a cache, like the prompts */
+    ac_skills_t *mut = (ac_skills_t *)skills;
+    if (mut->rank_generation != skills->generation + 1) {
+        skill_rank_free(mut->rank);
+        mut->rank = rank_build(skills);
+        mut->rank_generation = mut->rank ? skills->generation + 1 : 0;
+    }
+    const skill_rank_t *rank = skills->rank;
+    if (!rank || rank->doc_count == 0) {
+        return 0;
+    }
+
+    double *scores = calloc(rank->doc_count, sizeof(double));
+    ranked_t *ranked = calloc(rank->doc_count, sizeof(ranked_t));
+    if (!scores || !ranked) {
+        free(scores);
+        free(ranked);
+        return 0;
+    }
+
+    if (!skills->scorer ||
+        skills->scorer(query, rank->docs, rank->doc_count, scores, skills->scorer_data) != ARC_OK) {
+        memset(scores, 0, rank->doc_count * sizeof(double));
+        rank_score(rank, query, scores);
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < rank->doc_count; i++) {
+        if (scores[i] > 0) {
+            ranked[count++] = (ranked_t){ rank->docs[i], scores[i], i };
+        }
+    }
+    qsort(ranked, count, sizeof(ranked_t), ranked_cmp);
+
+    if (count > top_k) {
+        count = top_k;
+    }
+    for (size_t i = 0; i < count; i++) {
+        out[i] = ranked[i].skill;
+    }
+    free(scores);
+    free(ranked);
+    return count;
+}
+
+char *ac_skills_build_relevant_prompt(
+    const ac_skills_t *skills,
+    const char *query,
+    size_t top_k
+) {
+    if (!skills || !query || top_k == 0) {
+        return NULL;
+    }
+    const ac_skill_t **selected = calloc(top_k, sizeof(*selected));
+    if (!selected) {
+        return NULL;
+    }
+    size_t count = ac_skills_select(skills, query, selected, top_k);
+    char *prompt = count > 0 ? skill_discovery_prompt_for(selected, count) : NULL;
+    free(selected);
+
+    AC_LOG_DEBUG("Selected %zu of %zu skills for the discovery prompt",
+                 count, skills->count);
+    return prompt;
+}
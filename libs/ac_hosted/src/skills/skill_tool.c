@@ -9,11 +9,26 @@
 
 #include "skills_internal.h"
 #include <arc/log.h>
+#include <arc/platform.h>
 #include <arc/tool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define SKILL_TOOL_NAME "skill"
+
+#define SKILL_TOOL_PARAMETERS \
+    "{" \
+    "\"type\": \"object\"," \
+    "\"properties\": {" \
+    "  \"name\": {" \
+    "    \"type\": \"string\"," \
+    "    \"description\": \"The skill identifier from available_skills (e.g., 'code-review' or 'debugging')\"" \
+    "  }" \
+    "}," \
+    "\"required\": [\"name\"]" \
+    "}"
+
 /*============================================================================
  * Tool Implementation
  *============================================================================*/
@@ -30,39 +45,39 @@ static char *skill_tool_execute(
     ac_skills_t *skills = (ac_skills_t *)priv;
 
     if (!skills || !args_json) {
-        return strdup("{\"error\": \"Invalid arguments\"}");
+        return ARC_STRDUP("{\"error\": \"Invalid arguments\"}");
     }
 
     /* Parse skill name from JSON: {"name": "skill-name"} */
     /* Simple parsing - find "name": "value" */
     const char *name_key = strstr(args_json, "\"name\"");
     if (!name_key) {
-        return strdup("{\"error\": \"Missing 'name' parameter\"}");
+        return ARC_STRDUP("{\"error\": \"Missing 'name' parameter\"}");
     }
 
     const char *colon = strchr(name_key, ':');
     if (!colon) {
-        return strdup("{\"error\": \"Invalid JSON format\"}");
+        return ARC_STRDUP("{\"error\": \"Invalid JSON format\"}");
     }
 
     /* Find opening quote of value */
     const char *quote_start = strchr(colon, '"');
     if (!quote_start) {
-        return strdup("{\"error\": \"Invalid JSON format\"}");
+        return ARC_STRDUP("{\"error\": \"Invalid JSON format\"}");
     }
     quote_start++; /* Skip the quote */
 
     /* Find closing quote */
     const char *quote_end = strchr(quote_start, '"');
     if (!quote_end) {
-        return strdup("{\"error\": \"Invalid JSON format\"}");
+        return ARC_STRDUP("{\"error\": \"Invalid JSON format\"}");
     }
 
     /* Extract skill name */
     size_t name_len = quote_end - quote_start;
-    char *skill_name = malloc(name_len + 1);
+    char *skill_name = ARC_MALLOC(name_len + 1);
     if (!skill_name) {
-        return strdup("{\"error\": \"Memory allocation failed\"}");
+        return ARC_STRDUP("{\"error\": \"Memory allocation failed\"}");
     }
     memcpy(skill_name, quote_start, name_len);
     skill_name[name_len] = '\0';
@@ -73,10 +88,10 @@ static char *skill_tool_execute(
     const ac_skill_t *skill = ac_skills_find(skills, skill_name);
     if (!skill) {
         /* Build error with available skills */
-        char *result = malloc(1024);
+        char *result = ARC_MALLOC(1024);
         if (!result) {
-            free(skill_name);
-            return strdup("{\"error\": \"Memory allocation failed\"}");
+            ARC_FREE(skill_name);
+            return ARC_STRDUP("{\"error\": \"Memory allocation failed\"}");
         }
 
         char *p = result;
@@ -92,33 +107,33 @@ static char *skill_tool_execute(
         }
         p += sprintf(p, "]}");
 
-        free(skill_name);
+        ARC_FREE(skill_name);
         return result;
     }
 
     /* Enable the skill to load content if not already loaded */
     arc_err_t err = ac_skills_enable(skills, skill_name);
     if (err != ARC_OK) {
-        free(skill_name);
-        return strdup("{\"error\": \"Failed to load skill content\"}");
+        ARC_FREE(skill_name);
+        return ARC_STRDUP("{\"error\": \"Failed to load skill content\"}");
     }
 
     /* Re-fetch to get updated content */
     skill = ac_skills_find(skills, skill_name);
     if (!skill || !skill->content) {
-        free(skill_name);
-        return strdup("{\"error\": \"Skill content not available\"}");
+        ARC_FREE(skill_name);
+        return ARC_STRDUP("{\"error\": \"Skill content not available\"}");
     }
 
     /* Build result with skill content */
-    size_t content_len = strlen(skill->content);
+    size_t content_len = skill->content_len;
     size_t dir_len = skill->dir_path ? strlen(skill->dir_path) : 0;
     size_t result_size = content_len + dir_len + name_len + 256;
 
-    char *result = malloc(result_size);
+    char *result = ARC_MALLOC(result_size);
     if (!result) {
-        free(skill_name);
-        return strdup("{\"error\": \"Memory allocation failed\"}");
+        ARC_FREE(skill_name);
+        return ARC_STRDUP("{\"error\": \"Memory allocation failed\"}");
     }
 
     /* Format output similar to the TypeScript version */
@@ -131,7 +146,7 @@ static char *skill_tool_execute(
         skill->content
     );
 
-    free(skill_name);
+    ARC_FREE(skill_name);
 
     AC_LOG_DEBUG("Skill tool: loaded %zu bytes of content", strlen(result));
     return result;
@@ -141,14 +156,13 @@ static char *skill_tool_execute(
  * Public API
  *============================================================================*/
 
-char *ac_skills_build_tool_description(const ac_skills_t *skills) {
-    if (!skills) {
-        return strdup("Load a skill to get detailed instructions for a specific task. No skills are currently available.");
-    }
+#define SKILL_TOOL_NO_SKILLS \
+    "Load a skill to get detailed instructions for a specific task. No skills are currently available."
 
+static char *build_tool_description(const ac_skills_t *skills) {
     size_t count = ac_skills_count(skills);
     if (count == 0) {
-        return strdup("Load a skill to get detailed instructions for a specific task. No skills are currently available.");
+        return strdup(SKILL_TOOL_NO_SKILLS);
     }
 
     /* Calculate size */
@@ -190,25 +204,25 @@ char *ac_skills_build_tool_description(const ac_skills_t *skills) {
     return desc;
 }
 
+const char *ac_skills_tool_description(const ac_skills_t *skills) {
+    return skills ? skill_prompt_cached(skills, &skills->tool_description,
+                                        build_tool_description) : SKILL_TOOL_NO_SKILLS;
+}
+
+char *ac_skills_build_tool_description(const ac_skills_t *skills) {
+    const char *desc = ac_skills_tool_description(skills);
+    return desc ? strdup(desc) : NULL;
+}
+
 ac_tool_t *ac_skills_create_tool(ac_skills_t *skills) {
     if (!skills) return NULL;
 
     ac_tool_t *tool = calloc(1, sizeof(ac_tool_t));
     if (!tool) return NULL;
 
-    tool->name = "skill";
+    tool->name = SKILL_TOOL_NAME;
     tool->description = ac_skills_build_tool_description(skills);
-    tool->parameters =
-        "{"
-        "\"type\": \"object\","
-        "\"properties\": {"
-        "  \"name\": {"
-        "    \"type\": \"string\","
-        "    \"description\": \"The skill identifier from available_skills (e.g., 'code-review' or 'debugging')\""
-        "  }"
-        "},"
-        "\"required\": [\"name\"]"
-        "}";
+    tool->parameters = SKILL_TOOL_PARAMETERS;
     tool->execute = skill_tool_execute;
     tool->priv = skills;
 
@@ -217,6 +231,17 @@ ac_tool_t *ac_skills_create_tool(ac_skills_t *skills) {
     return tool;
 }
 
+void skill_tool_refresh(ac_skills_t *skills, ac_tool_registry_t *registry) {
+    const ac_tool_t *tool = ac_tool_registry_find(registry, SKILL_TOOL_NAME);
+    if (!tool || tool->execute != skill_tool_execute || tool->priv != skills) {
+        return;
+    }
+    const char *desc = ac_skills_tool_description(skills);
+    if (desc) {
+        ac_tool_registry_update_schema(registry, SKILL_TOOL_NAME, desc, SKILL_TOOL_PARAMETERS);
+    }
+}
+
 void ac_skills_destroy_tool(ac_tool_t *tool) {
     if (!tool) return;
 
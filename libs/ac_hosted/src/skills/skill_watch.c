@@ -0,0 +1,465 @@
+/**
+ * @file skill_watch.c
+ * @brief Hot reload of skills (ac_skills_watch())
+ *
+ * Every watched directory has an entry: roots (directories given to
+ * ac_skills_discover_dir()) and skill folders. Each entry keeps the stamp
+ * (mtime, size) of what it covers, the root directory itself or the
+ * folder's SKILL.md. The kernel only says which entries to look at:
+ *
+ *   Linux      inotify watch per entry, events name the entry
+ *   macOS/BSD  kqueue vnode filter per entry (and per SKILL.md, since a
+ *              directory is not notified of writes to its files)
+ *   otherwise  every entry is looked at on each poll
+ *
+ * Looking at an entry compares stamps, so repeated or irrelevant events
+ * cost a stat() and only a SKILL.md that really changed is reloaded.
+ * Looking at a root also picks up new skill folders.
+ */
+
+#include "skills_internal.h"
+#include <arc/log.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#define WATCH_INOTIFY 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/event.h>
+#include <unistd.h>
+#define WATCH_KQUEUE 1
+#ifndef O_EVTONLY
+#define O_EVTONLY O_RDONLY
+#endif
+#endif
+
+#ifndef S_ISDIR
+#define S_ISDIR(mode) (((mode) & S_IFMT) == S_IFDIR)
+#endif
+
+#define SKILL_MD_FILENAME "SKILL.md"
+
+typedef struct {
+    char *path;
+    bool root;
+    int wd;                          /* inotify watch / kqueue fd, -1 = none */
+    int file_fd;                     /* kqueue: SKILL.md fd, -1 = none */
+    bool exists;                     /* Stamp of the root or SKILL.md */
+    int64_t mtime_sec;
+    long mtime_nsec;
+    int64_t size;
+} watch_entry_t;
+
+struct skill_watch {
+    int fd;                          /* inotify / kqueue, -1 = stat every poll */
+    watch_entry_t *entries;          /* Never shrinks; kqueue keys by index */
+    size_t count;
+    size_t cap;
+
+    char **dirty;                    /* Skill folders to reload */
+    size_t dirty_count;
+    size_t dirty_cap;
+};
+
+/*============================================================================
+ * Entries
+ *============================================================================*/
+
+static char *join_path(const char *dir, const char *name) {
+    size_t dir_len = strlen(dir);
+    while (dir_len > 1 && dir[dir_len - 1] == '/') {
+        dir_len--;
+    }
+    size_t name_len = strlen(name);
+    char *path = malloc(dir_len + 1 + name_len + 1);
+    if (path) {
+        memcpy(path, dir, dir_len);
+        path[dir_len] = '/';
+        memcpy(path + dir_len + 1, name, name_len + 1);
+    }
+    return path;
+}
+
+/**
+ * @brief Read the current stamp of an entry
+ * @return true if it differs from the recorded one (which is updated)
+ */
+static bool entry_restamp(watch_entry_t *e) {
+    char *path = e->root ? e->path : join_path(e->path, SKILL_MD_FILENAME);
+    struct stat st;
+    bool exists = path && stat(path, &st) == 0;
+    if (path != e->path) {
+        free(path);
+    }
+
+    int64_t sec = exists ? (int64_t)st.st_mtime : 0;
+    long nsec = 0;
+#if defined(__APPLE__)
+    nsec = exists ? st.st_mtimespec.tv_nsec : 0;
+#elif defined(__linux__)
+    nsec = exists ? st.st_mtim.tv_nsec : 0;
+#endif
+    int64_t size = exists ? (int64_t)st.st_size : 0;
+
+    if (exists == e->exists && sec == e->mtime_sec && nsec == e->mtime_nsec &&
+        size == e->size) {
+        return false;
+    }
+    e->exists = exists;
+    e->mtime_sec = sec;
+    e->mtime_nsec = nsec;
+    e->size = size;
+    return true;
+}
+
+#if defined(WATCH_KQUEUE)
+static int kq_open(int kq, const char *path, size_t index) {
+    int fd = open(path, O_EVTONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct kevent kev;
+    EV_SET(&kev, fd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+           NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME | NOTE_ATTRIB,
+           0, (void *)(uintptr_t)index);
+    if (kevent(kq, &kev, 1, NULL, 0, NULL) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+#endif
+
+/**
+ * @brief Ask the kernel for events on an entry, if not asked already
+ *
+ * kqueue follows the SKILL.md inode, so after the file is replaced
+ * (saved by rename) its descriptor is reopened.
+ */
+static void entry_arm(skill_watch_t *watch, size_t index, bool reopen_file) {
+    watch_entry_t *e = &watch->entries[index];
+    if (watch->fd < 0) {
+        return;
+    }
+#if defined(WATCH_INOTIFY)
+    (void)reopen_file;
+    if (e->wd < 0) {
+        uint32_t mask = e->root ?
+            IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR :
+            IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+        e->wd = inotify_add_watch(watch->fd, e->path, mask);
+    }
+#elif defined(WATCH_KQUEUE)
+    if (e->wd < 0) {
+        e->wd = kq_open(watch->fd, e->path, index);
+    }
+    if (!e->root && (reopen_file || e->file_fd < 0)) {
+        if (e->file_fd >= 0) {
+            close(e->file_fd);
+        }
+        char *md_path = join_path(e->path, SKILL_MD_FILENAME);
+        e->file_fd = md_path ? kq_open(watch->fd, md_path, index) : -1;
+        free(md_path);
+    }
+#else
+    (void)e;
+    (void)reopen_file;
+#endif
+}
+
+static bool entry_exists(const skill_watch_t *watch, const char *path) {
+    for (size_t i = 0; i < watch->count; i++) {
+        if (strcmp(watch->entries[i].path, path) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void skill_watch_add(skill_watch_t *watch, const char *path, bool root) {
+    if (!watch || entry_exists(watch, path)) {
+        return;
+    }
+    if (watch->count == watch->cap) {
+        size_t cap = watch->cap ? watch->cap * 2 : 32;
+        watch_entry_t *entries = realloc(watch->entries, cap * sizeof(*entries));
+        if (!entries) {
+            return;
+        }
+        watch->entries = entries;
+        watch->cap = cap;
+    }
+    watch_entry_t *e = &watch->entries[watch->count];
+    memset(e, 0, sizeof(*e));
+    if (!(e->path = strdup(path))) {
+        return;
+    }
+    e->root = root;
+    e->wd = -1;
+    e->file_fd = -1;
+    entry_restamp(e);
+    entry_arm(watch, watch->count++, false);
+}
+
+/*============================================================================
+ * Checking Entries
+ *============================================================================*/
+
+static void mark_dirty(skill_watch_t *watch, const char *path) {
+    for (size_t i = 0; i < watch->dirty_count; i++) {
+        if (strcmp(watch->dirty[i], path) == 0) {
+            return;
+        }
+    }
+    if (watch->dirty_count == watch->dirty_cap) {
+        size_t cap = watch->dirty_cap ? watch->dirty_cap * 2 : 8;
+        char **dirty = realloc(watch->dirty, cap * sizeof(char *));
+        if (!dirty) {
+            return;
+        }
+        watch->dirty = dirty;
+        watch->dirty_cap = cap;
+    }
+    if ((watch->dirty[watch->dirty_count] = strdup(path)) != NULL) {
+        watch->dirty_count++;
+    }
+}
+
+static void check_skill(skill_watch_t *watch, size_t index) {
+    bool changed = entry_restamp(&watch->entries[index]);
+    if (changed) {
+        mark_dirty(watch, watch->entries[index].path);
+    }
+    entry_arm(watch, index, changed);
+}
+
+/** Is path a direct child of dir? */
+static bool is_child(const char *path, const char *dir) {
+    size_t len = strlen(dir);
+    while (len > 1 && dir[len - 1] == '/') {
+        len--;
+    }
+    return strncmp(path, dir, len) == 0 && path[len] == '/' &&
+           path[len + 1] != '\0' && !strchr(path + len + 1, '/');
+}
+
+/**
+ * @brief Look at a root: add new skill folders, check the known ones
+ *
+ * Removed folders show up as their SKILL.md stamp going away.
+ */
+static void check_root(skill_watch_t *watch, size_t index) {
+    entry_restamp(&watch->entries[index]);
+    entry_arm(watch, index, false);
+
+    char *root = strdup(watch->entries[index].path);
+    DIR *dir = root ? opendir(root) : NULL;
+    struct dirent *d;
+    while (dir && (d = readdir(dir)) != NULL) {
+        if (d->d_name[0] == '.') {
+            continue;
+        }
+        char *path = join_path(root, d->d_name);
+        struct stat st;
+        if (path && !entry_exists(watch, path) && stat(path, &st) == 0 &&
+            S_ISDIR(st.st_mode)) {
+            /* Stamped as it is now: reload it regardless */
+            skill_watch_add(watch, path, false);
+            mark_dirty(watch, path);
+        }
+        free(path);
+    }
+    if (dir) {
+        closedir(dir);
+    }
+
+    for (size_t i = 0; root && i < watch->count; i++) {
+        if (!watch->entries[i].root && is_child(watch->entries[i].path, root)) {
+            check_skill(watch, i);
+        }
+    }
+    free(root);
+}
+
+/**
+ * @brief Mark the entries the kernel reported (all of them without one)
+ */
+static void collect_events(skill_watch_t *watch, bool *pending) {
+    if (watch->fd < 0) {
+        for (size_t i = 0; i < watch->count; i++) {
+            /* A root's listing only changes with its mtime */
+            pending[i] = !watch->entries[i].root || entry_restamp(&watch->entries[i]);
+        }
+        return;
+    }
+
+#if defined(WATCH_INOTIFY)
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t n = read(watch->fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        for (char *p = buf; p < buf + n;) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(*ev) + ev->len;
+            for (size_t i = 0; i < watch->count; i++) {
+                watch_entry_t *e = &watch->entries[i];
+                if (e->wd != ev->wd) {
+                    continue;
+                }
+                if (ev->mask & IN_IGNORED) {
+                    e->wd = -1;     /* Folder gone; its root re-adds it */
+                }
+                if (e->root || ev->mask & (IN_DELETE_SELF | IN_IGNORED) ||
+                    (ev->len > 0 && strcmp(ev->name, SKILL_MD_FILENAME) == 0)) {
+                    pending[i] = true;
+                }
+                break;
+            }
+        }
+    }
+#elif defined(WATCH_KQUEUE)
+    struct kevent evs[64];
+    struct timespec zero = { 0, 0 };
+    int n;
+    while ((n = kevent(watch->fd, NULL, 0, evs, 64, &zero)) > 0) {
+        for (int k = 0; k < n; k++) {
+            size_t i = (size_t)(uintptr_t)evs[k].udata;
+            if (i >= watch->count) {
+                continue;
+            }
+            watch_entry_t *e = &watch->entries[i];
+            if ((int)evs[k].ident == e->wd && evs[k].fflags & (NOTE_DELETE | NOTE_RENAME)) {
+                close(e->wd);       /* Folder gone; its root re-adds it */
+                e->wd = -1;
+            }
+            pending[i] = true;
+        }
+        if (n < 64) {
+            break;
+        }
+    }
+#endif
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t ac_skills_watch(ac_skills_t *skills, bool enable) {
+    if (!skills) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (!enable) {
+        skill_watch_free(skills->watch);
+        skills->watch = NULL;
+        return ARC_OK;
+    }
+    if (skills->watch) {
+        return ARC_OK;
+    }
+
+    skill_watch_t *watch = calloc(1, sizeof(*watch));
+    if (!watch) {
+        return ARC_ERR_MEMORY;
+    }
+#if defined(WATCH_INOTIFY)
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#elif defined(WATCH_KQUEUE)
+    watch->fd = kqueue();
+#else
+    watch->fd = -1;
+#endif
+#if defined(WATCH_INOTIFY) || defined(WATCH_KQUEUE)
+    if (watch->fd < 0) {
+        AC_LOG_WARN("No file notifications for skills; polling by stat()");
+    }
+#endif
+
+    for (size_t i = 0; i < skills->root_count; i++) {
+        skill_watch_add(watch, skills->roots[i], true);
+    }
+    for (const ac_skill_t *s = skills->head; s; s = s->next) {
+        skill_watch_add(watch, s->dir_path, false);
+    }
+    skills->watch = watch;
+
+    AC_LOG_DEBUG("Watching %zu skill directories", watch->count);
+    return ARC_OK;
+}
+
+int ac_skills_watch_fd(const ac_skills_t *skills) {
+    return skills && skills->watch ? skills->watch->fd : -1;
+}
+
+size_t ac_skills_watch_poll(ac_skills_t *skills, ac_tool_registry_t *registry) {
+    skill_watch_t *watch = skills ? skills->watch : NULL;
+    if (!watch || watch->count == 0) {
+        return 0;
+    }
+
+    /* Entries added while checking are stamped already */
+    size_t count = watch->count;
+    bool *pending = calloc(count, sizeof(bool));
+    if (!pending) {
+        return 0;
+    }
+    collect_events(watch, pending);
+    for (size_t i = 0; i < count; i++) {
+        if (pending[i]) {
+            if (watch->entries[i].root) {
+                check_root(watch, i);
+            } else {
+                check_skill(watch, i);
+            }
+        }
+    }
+    free(pending);
+
+    size_t changed = 0;
+    for (size_t i = 0; i < watch->dirty_count; i++) {
+        changed += skills_reload_dir(skills, watch->dirty[i]);
+        free(watch->dirty[i]);
+    }
+    watch->dirty_count = 0;
+
+    if (changed > 0 && registry) {
+        skill_tool_refresh(skills, registry);
+    }
+    return changed;
+}
+
+void skill_watch_free(skill_watch_t *watch) {
+    if (!watch) {
+        return;
+    }
+    for (size_t i = 0; i < watch->count; i++) {
+#if defined(WATCH_KQUEUE)
+        if (watch->entries[i].wd >= 0) {
+            close(watch->entries[i].wd);
+        }
+        if (watch->entries[i].file_fd >= 0) {
+            close(watch->entries[i].file_fd);
+        }
+#endif
+        free(watch->entries[i].path);
+    }
+#if defined(WATCH_INOTIFY) || defined(WATCH_KQUEUE)
+    if (watch->fd >= 0) {
+        close(watch->fd);
+    }
+#endif
+    for (size_t i = 0; i < watch->dirty_count; i++) {
+        free(watch->dirty[i]);
+    }
+    free(watch->dirty);
+    free(watch->entries);
+    free(watch);
+}
@@ -13,6 +13,11 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
 /* Windows compatibility: S_ISDIR may not be defined in sys/stat.h */
 #ifndef S_ISDIR
 #define S_ISDIR(mode) (((mode) & S_IFMT) == S_IFDIR)
@@ -25,6 +30,9 @@
 #define SKILL_MD_FILENAME "SKILL.md"
 #define MAX_PATH_LEN 1024
 
+/* Threads statting and parsing skills in ac_skills_discover_dir() */
+#define DISCOVER_THREADS 8
+
 /*============================================================================
  * Helper Functions
  *============================================================================*/
@@ -36,7 +44,7 @@ static void skill_free(ac_skill_t *skill) {
     if (!skill) return;
 
     skill_meta_free(&skill->meta);
-    free(skill->content);
+    skill_file_unmap(skill->file);
     free(skill->dir_path);
     free(skill);
 }
@@ -72,6 +80,73 @@ static char *build_path(const char *dir, const char *name) {
     return path;
 }
 
+/**
+ * @brief Add a discovered skill, taking ownership of meta
+ *
+ * A skill whose name is already known is skipped (meta is freed).
+ */
+static arc_err_t skills_add(ac_skills_t *skills, const char *dir_path, ac_skill_meta_t *meta) {
+    /* Check for duplicate */
+    if (ac_skills_find(skills, meta->name)) {
+        AC_LOG_WARN("Skill already discovered: %s", meta->name);
+        skill_meta_free(meta);
+        return ARC_OK; /* Not an error, just skip */
+    }
+
+    /* Create skill entry */
+    ac_skill_t *skill = calloc(1, sizeof(ac_skill_t));
+    if (!skill) {
+        skill_meta_free(meta);
+        return ARC_ERR_MEMORY;
+    }
+
+    skill->meta = *meta;
+    memset(meta, 0, sizeof(*meta));
+    skill->dir_path = strdup(dir_path);
+    skill->state = AC_SKILL_DISCOVERED;
+    skill->content = NULL; /* Loaded on enable */
+
+    if (!skill->dir_path) {
+        skill_free(skill);
+        return ARC_ERR_MEMORY;
+    }
+
+    /* Add to list (prepend) */
+    skill->next = skills->head;
+    skills->head = skill;
+    skills->count++;
+    skills->generation++;
+
+    if (skills->watch) {
+        skill_watch_add(skills->watch, skill->dir_path, false);
+    }
+
+    AC_LOG_INFO("Discovered skill: %s", skill->meta.name);
+    return ARC_OK;
+}
+
+/**
+ * @brief Remember a directory given to ac_skills_discover_dir()
+ */
+static void skills_add_root(ac_skills_t *skills, const char *skills_dir) {
+    for (size_t i = 0; i < skills->root_count; i++) {
+        if (strcmp(skills->roots[i], skills_dir) == 0) {
+            return;
+        }
+    }
+    char **roots = realloc(skills->roots, (skills->root_count + 1) * sizeof(char *));
+    if (!roots) {
+        return;
+    }
+    skills->roots = roots;
+    if ((roots[skills->root_count] = strdup(skills_dir)) != NULL) {
+        skills->root_count++;
+        if (skills->watch) {
+            skill_watch_add(skills->watch, skills_dir, true);
+        }
+    }
+}
+
 /**
  * @brief Load full content for a skill
  */
@@ -91,41 +166,29 @@ static arc_err_t skill_load_content(ac_skill_t *skill) {
         return ARC_ERR_MEMORY;
     }
 
-    /* Read file */
-    char *file_content = skill_read_file(skill_md_path);
+    /* Map file; content stays a view into the mapping */
+    skill_file_t *file = skill_file_map(skill_md_path);
     free(skill_md_path);
 
-    if (!file_content) {
+    if (!file) {
         AC_LOG_ERROR("Failed to read SKILL.md for skill: %s", skill->meta.name);
         return ARC_ERR_IO;
     }
 
-    /* Parse to get body */
-    ac_skill_meta_t temp_meta;
-    const char *body_start = NULL;
-
-    arc_err_t err = skill_parse_frontmatter(file_content, &temp_meta, &body_start);
-    if (err != ARC_OK) {
-        free(file_content);
-        return err;
+    /* Frontmatter is already in meta; only find where the body starts */
+    const char *body_start = skill_find_body(file->data);
+    if (!body_start) {
+        AC_LOG_WARN("SKILL.md missing '---' fences for skill: %s", skill->meta.name);
+        skill_file_unmap(file);
+        return ARC_ERR_PARSE;
     }
 
-    /* Copy body content */
-    if (body_start && *body_start) {
-        skill->content = strdup(body_start);
-    } else {
-        skill->content = strdup("");
-    }
-
-    skill_meta_free(&temp_meta);
-    free(file_content);
-
-    if (!skill->content) {
-        return ARC_ERR_MEMORY;
-    }
+    skill->file = file;
+    skill->content = body_start;
+    skill->content_len = file->len - (size_t)(body_start - file->data);
 
     AC_LOG_DEBUG("Loaded content for skill: %s (%zu bytes)",
-                 skill->meta.name, strlen(skill->content));
+                 skill->meta.name, skill->content_len);
 
     return ARC_OK;
 }
@@ -156,6 +219,16 @@ void ac_skills_destroy(ac_skills_t *skills) {
         curr = next;
     }
 
+    skill_watch_free(skills->watch);
+    skill_prompt_cache_free(&skills->discovery_prompt);
+    skill_prompt_cache_free(&skills->active_prompt);
+    skill_prompt_cache_free(&skills->tool_description);
+    skill_rank_free(skills->rank);
+    for (size_t i = 0; i < skills->root_count; i++) {
+        free(skills->roots[i]);
+    }
+    free(skills->roots);
+    free(skills->index_path);
     free(skills);
     AC_LOG_DEBUG("Destroyed skills manager");
 }
@@ -202,42 +275,119 @@ arc_err_t ac_skills_discover(ac_skills_t *skills, const char *skill_dir) {
         return err;
     }
 
-    /* Check for duplicate */
-    if (ac_skills_find(skills, meta.name)) {
-        AC_LOG_WARN("Skill already discovered: %s", meta.name);
-        skill_meta_free(&meta);
-        free(file_content);
-        return ARC_OK; /* Not an error, just skip */
-    }
+    free(file_content);
+    return skills_add(skills, skill_dir, &meta);
+}
 
-    /* Create skill entry */
-    ac_skill_t *skill = calloc(1, sizeof(ac_skill_t));
-    if (!skill) {
-        skill_meta_free(&meta);
-        free(file_content);
-        return ARC_ERR_MEMORY;
-    }
+/*============================================================================
+ * Directory Discovery
+ *============================================================================*/
 
-    skill->meta = meta;
-    skill->dir_path = strdup(skill_dir);
-    skill->state = AC_SKILL_DISCOVERED;
-    skill->content = NULL; /* Loaded on enable */
+typedef enum {
+    SCAN_NONE,                      /* No skill here */
+    SCAN_CACHED,                    /* Frontmatter taken from the index */
+    SCAN_PARSED                     /* SKILL.md read and parsed */
+} scan_status_t;
+
+typedef struct {
+    skill_index_entry_t entry;      /* dir_path set before the scan */
+    scan_status_t status;
+} skill_scan_t;
+
+typedef struct {
+    skill_scan_t *scans;
+    size_t count;
+    const skill_index_t *index;
+#if !defined(_WIN32)
+    atomic_size_t next;
+#endif
+} scan_job_t;
 
-    if (!skill->dir_path) {
-        skill_free(skill);
-        free(file_content);
-        return ARC_ERR_MEMORY;
-    }
+/**
+ * @brief Stat one candidate and take its frontmatter from the index or the file
+ *
+ * A SKILL.md that stats as a regular file also means its parent is a
+ * directory, so an unchanged skill costs exactly one stat().
+ */
+static void scan_one(skill_scan_t *scan, const skill_index_t *index) {
+    skill_index_entry_t *e = &scan->entry;
+    char *md_path = build_path(e->dir_path, SKILL_MD_FILENAME);
+    struct stat st;
+    if (!md_path || stat(md_path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        free(md_path);
+        return;
+    }
+
+    e->mtime_sec = (int64_t)st.st_mtime;
+#if defined(__APPLE__)
+    e->mtime_nsec = st.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+    e->mtime_nsec = st.st_mtim.tv_nsec;
+#else
+    e->mtime_nsec = 0;
+#endif
+    e->size = (int64_t)st.st_size;
 
-    /* Add to list (prepend) */
-    skill->next = skills->head;
-    skills->head = skill;
-    skills->count++;
+    const skill_index_entry_t *hit = skill_index_find(index, e->dir_path);
+    if (hit && hit->mtime_sec == e->mtime_sec && hit->mtime_nsec == e->mtime_nsec &&
+        hit->size == e->size && skill_meta_copy(&e->meta, &hit->meta) == ARC_OK) {
+        scan->status = SCAN_CACHED;
+        free(md_path);
+        return;
+    }
 
+    char *file_content = skill_read_file(md_path);
+    free(md_path);
+    if (!file_content) {
+        return;
+    }
+    const char *body_start = NULL;
+    if (skill_parse_frontmatter(file_content, &e->meta, &body_start) == ARC_OK) {
+        scan->status = SCAN_PARSED;
+    }
     free(file_content);
+}
 
-    AC_LOG_INFO("Discovered skill: %s", skill->meta.name);
-    return ARC_OK;
+#if !defined(_WIN32)
+static void *scan_worker(void *arg) {
+    scan_job_t *job = arg;
+    for (;;) {
+        size_t i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->count) {
+            break;
+        }
+        scan_one(&job->scans[i], job->index);
+    }
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Scan all candidates, several at a time where threads are available
+ *
+ * Latency of stat() and read() on network storage dominates, so the
+ * threads overlap waits rather than compute.
+ */
+static void scan_all(scan_job_t *job) {
+#if !defined(_WIN32)
+    atomic_init(&job->next, 0);
+    pthread_t threads[DISCOVER_THREADS];
+    size_t started = 0;
+    size_t wanted = job->count < DISCOVER_THREADS ? job->count : DISCOVER_THREADS;
+    /* The calling thread is one of the scanners */
+    while (started + 1 < wanted &&
+           pthread_create(&threads[started], NULL, scan_worker, job) == 0) {
+        started++;
+    }
+    scan_worker(job);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    for (size_t i = 0; i < job->count; i++) {
+        scan_one(&job->scans[i], job->index);
+    }
+#endif
 }
 
 arc_err_t ac_skills_discover_dir(ac_skills_t *skills, const char *skills_dir) {
@@ -252,34 +402,174 @@ arc_err_t ac_skills_discover_dir(ac_skills_t *skills, const char *skills_dir) {
         return ARC_OK; /* Not an error if directory doesn't exist */
     }
 
+    /* Collect candidates in directory order */
+    skill_scan_t *scans = NULL;
+    size_t count = 0;
+    size_t cap = 0;
+    arc_err_t err = ARC_OK;
     struct dirent *entry;
-    int discovered = 0;
-
     while ((entry = readdir(dir)) != NULL) {
         /* Skip . and .. */
         if (entry->d_name[0] == '.') continue;
 
-        /* Build full path */
-        char *subdir_path = build_path(skills_dir, entry->d_name);
-        if (!subdir_path) continue;
+        if (count == cap) {
+            size_t new_cap = cap ? cap * 2 : 32;
+            skill_scan_t *grown = realloc(scans, new_cap * sizeof(*scans));
+            if (!grown) {
+                err = ARC_ERR_MEMORY;
+                break;
+            }
+            scans = grown;
+            cap = new_cap;
+        }
+        memset(&scans[count], 0, sizeof(scans[count]));
+        scans[count].entry.dir_path = build_path(skills_dir, entry->d_name);
+        if (!scans[count].entry.dir_path) {
+            err = ARC_ERR_MEMORY;
+            break;
+        }
+        count++;
+    }
+    closedir(dir);
+    skills_add_root(skills, skills_dir);
+
+    skill_index_t *index = NULL;
+    if (err == ARC_OK && skills->index_path) {
+        index = skill_index_load(skills->index_path);
+    }
+
+    scan_job_t job = { .scans = scans, .count = count, .index = index };
+    if (err == ARC_OK) {
+        scan_all(&job);
+    }
 
-        /* Check if it's a directory */
-        if (!is_directory(subdir_path)) {
-            free(subdir_path);
+    /* Add in directory order, as one-by-one discovery did */
+    int discovered = 0;
+    size_t parsed = 0;
+    size_t found = 0;
+    const skill_index_entry_t **found_entries = calloc(count ? count : 1, sizeof(*found_entries));
+    for (size_t i = 0; i < count && err == ARC_OK; i++) {
+        if (scans[i].status == SCAN_NONE) {
             continue;
         }
+        parsed += scans[i].status == SCAN_PARSED;
+        if (found_entries) {
+            found_entries[found++] = &scans[i].entry;
+        }
 
-        /* Try to discover skill */
-        if (ac_skills_discover(skills, subdir_path) == ARC_OK) {
+        /* The index keeps its own copy; the manager takes this one */
+        ac_skill_meta_t meta;
+        if (skill_meta_copy(&meta, &scans[i].entry.meta) != ARC_OK) {
+            err = ARC_ERR_MEMORY;
+            break;
+        }
+        if (skills_add(skills, scans[i].entry.dir_path, &meta) == ARC_OK) {
             discovered++;
         }
+    }
 
-        free(subdir_path);
+    /* Rewrite the index when a skill was added, changed or removed */
+    if (err == ARC_OK && skills->index_path && found_entries) {
+        char *prefix = build_path(skills_dir, "");
+        if (prefix && (parsed > 0 || skill_index_count_under(index, prefix) != found)) {
+            skill_index_save(skills->index_path, index, prefix, found_entries, found);
+        }
+        free(prefix);
     }
 
-    closedir(dir);
+    free(found_entries);
+    skill_index_free(index);
+    for (size_t i = 0; i < count; i++) {
+        free(scans[i].entry.dir_path);
+        skill_meta_free(&scans[i].entry.meta);
+    }
+    free(scans);
 
-    AC_LOG_INFO("Discovered %d skills from %s", discovered, skills_dir);
+    if (err != ARC_OK) {
+        return err;
+    }
+    AC_LOG_INFO("Discovered %d skills from %s (%zu parsed, %zu from index)",
+                discovered, skills_dir, parsed, found - parsed);
+    return ARC_OK;
+}
+
+bool skills_reload_dir(ac_skills_t *skills, const char *dir_path) {
+    ac_skill_t **link = &skills->head;
+    while (*link && strcmp((*link)->dir_path, dir_path) != 0) {
+        link = &(*link)->next;
+    }
+    ac_skill_t *skill = *link;
+
+    char *skill_md_path = build_path(dir_path, SKILL_MD_FILENAME);
+    char *file_content = skill_md_path ? skill_read_file(skill_md_path) : NULL;
+    free(skill_md_path);
+
+    if (!file_content) {
+        if (!skill) {
+            return false;
+        }
+        /* SKILL.md (or the whole folder) is gone */
+        AC_LOG_INFO("Removed skill: %s", skill->meta.name);
+        *link = skill->next;
+        skills->count--;
+        if (skill->state == AC_SKILL_ENABLED) {
+            skills->enabled_count--;
+        }
+        skills->generation++;
+        skill_free(skill);
+        return true;
+    }
+
+    ac_skill_meta_t meta;
+    const char *body_start = NULL;
+    arc_err_t err = skill_parse_frontmatter(file_content, &meta, &body_start);
+    free(file_content);
+    if (err != ARC_OK) {
+        /* Likely caught mid-edit; the next save triggers another reload */
+        AC_LOG_WARN("SKILL.md in %s does not parse, keeping previous version", dir_path);
+        return false;
+    }
+
+    if (!skill) {
+        size_t count = skills->count;
+        return skills_add(skills, dir_path, &meta) == ARC_OK && skills->count > count;
+    }
+
+    const ac_skill_t *other = ac_skills_find(skills, meta.name);
+    if (other && other != skill) {
+        AC_LOG_WARN("Skill %s renamed to %s, which already exists", skill->meta.name, meta.name);
+        skill_meta_free(&meta);
+        return false;
+    }
+
+    skill_meta_free(&skill->meta);
+    skill->meta = meta;
+    skill_file_unmap(skill->file);
+    skill->file = NULL;
+    skill->content = NULL;
+    skill->content_len = 0;
+
+    /* An enabled skill keeps serving its instructions */
+    if (skill->state == AC_SKILL_ENABLED && skill_load_content(skill) != ARC_OK) {
+        skill->state = AC_SKILL_DISCOVERED;
+        skills->enabled_count--;
+    }
+    skills->generation++;
+
+    AC_LOG_INFO("Reloaded skill: %s", skill->meta.name);
+    return true;
+}
+
+arc_err_t ac_skills_set_index(ac_skills_t *skills, const char *index_path) {
+    if (!skills) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    char *copy = NULL;
+    if (index_path && !(copy = strdup(index_path))) {
+        return ARC_ERR_MEMORY;
+    }
+    free(skills->index_path);
+    skills->index_path = copy;
     return ARC_OK;
 }
 
@@ -317,6 +607,7 @@ arc_err_t ac_skills_enable(ac_skills_t *skills, const char *name) {
     if (skill->state != AC_SKILL_ENABLED) {
         skill->state = AC_SKILL_ENABLED;
         skills->enabled_count++;
+        skills->generation++;
     }
 
     AC_LOG_INFO("Enabled skill: %s", name);
@@ -345,6 +636,7 @@ arc_err_t ac_skills_disable(ac_skills_t *skills, const char *name) {
     if (skill->state == AC_SKILL_ENABLED) {
         skill->state = AC_SKILL_DISABLED;
         skills->enabled_count--;
+        skills->generation++;
     } else {
         skill->state = AC_SKILL_DISABLED;
     }
@@ -381,6 +673,7 @@ void ac_skills_disable_all(ac_skills_t *skills) {
     }
 
     skills->enabled_count = 0;
+    skills->generation++;
     AC_LOG_DEBUG("Disabled all skills");
 }
 
@@ -410,6 +703,10 @@ const ac_skill_t *ac_skills_list(const ac_skills_t *skills) {
     return skills ? skills->head : NULL;
 }
 
+uint64_t ac_skills_generation(const ac_skills_t *skills) {
+    return skills ? skills->generation : 0;
+}
+
 arc_err_t ac_skills_validate_tools(
     const ac_skills_t *skills,
     const char *name,
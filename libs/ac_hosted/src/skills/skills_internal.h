@@ -7,11 +7,20 @@
 #define ARC_SKILLS_INTERNAL_H
 
 #include <arc/skills.h>
+#include <stdint.h>
 
 /*============================================================================
  * Internal Structures
  *============================================================================*/
 
+/**
+ * @brief A prompt built at some generation of the skills manager
+ */
+typedef struct {
+    char *text;                     /* NULL = none (also a valid result) */
+    uint64_t generation;            /* Generation + 1 it was built at, 0 = never */
+} skill_prompt_cache_t;
+
 /**
  * @brief Skills manager internal structure
  */
@@ -20,11 +29,47 @@ struct ac_skills {
     size_t count;                   /* Total discovered skills */
     size_t enabled_count;           /* Currently enabled skills */
 
+    /* Frontmatter index (skill_index.c; NULL = parse every SKILL.md) */
+    char *index_path;
+
+    /* Directories given to ac_skills_discover_dir() */
+    char **roots;
+    size_t root_count;
+
+    /* Hot reload (skill_watch.c; NULL = not watching) */
+    struct skill_watch *watch;
+    uint64_t generation;            /* See ac_skills_generation() */
+
+    /* Built prompts (skill_prompt.c); a cache, so filled in through
+     * const ac_skills_t * */
+    skill_prompt_cache_t discovery_prompt;
+    skill_prompt_cache_t active_prompt;
+    skill_prompt_cache_t tool_description;
+
+    /* Relevance index (skill_rank.c), a cache like the prompts */
+    struct skill_rank *rank;
+    uint64_t rank_generation;       /* Generation + 1 it was built at, 0 = never */
+    ac_skill_scorer_fn scorer;      /* NULL = BM25 */
+    void *scorer_data;
+
     /* Script executor (reserved for future use) */
     ac_skill_script_fn script_executor;
     void *script_user_data;
 };
 
+/*============================================================================
+ * Manager Functions (skills.c)
+ *============================================================================*/
+
+/**
+ * @brief Bring the skill in dir_path in line with its SKILL.md
+ *
+ * Adds, re-reads or drops the skill; reloads content of an enabled one.
+ *
+ * @return true if the skill set changed
+ */
+bool skills_reload_dir(ac_skills_t *skills, const char *dir_path);
+
 /*============================================================================
  * Parser Functions (skill_parser.c)
  *============================================================================*/
@@ -46,6 +91,16 @@ arc_err_t skill_parse_frontmatter(
     const char **body_start
 );
 
+/**
+ * @brief Find the markdown body after the frontmatter
+ *
+ * Only locates the fences; nothing is parsed or allocated.
+ *
+ * @param content  SKILL.md content
+ * @return Body start (within content), NULL if a fence is missing
+ */
+const char *skill_find_body(const char *content);
+
 /**
  * @brief Free skill metadata fields
  *
@@ -56,6 +111,15 @@ arc_err_t skill_parse_frontmatter(
  */
 void skill_meta_free(ac_skill_meta_t *meta);
 
+/**
+ * @brief Deep-copy skill metadata
+ *
+ * @param dst  Receives the copy (free with skill_meta_free())
+ * @param src  Metadata to copy
+ * @return ARC_OK, or ARC_ERR_MEMORY with dst left empty
+ */
+arc_err_t skill_meta_copy(ac_skill_meta_t *dst, const ac_skill_meta_t *src);
+
 /**
  * @brief Validate skill name format
  *
@@ -70,10 +134,129 @@ void skill_meta_free(ac_skill_meta_t *meta);
  */
 bool skill_validate_name(const char *name);
 
+/*============================================================================
+ * Frontmatter Index (skill_index.c)
+ *============================================================================*/
+
+/**
+ * @brief Parsed SKILL.md of one skill directory, with the file's stamp
+ */
+typedef struct {
+    char *dir_path;                 /* Skill directory */
+    int64_t mtime_sec;              /* SKILL.md modification time */
+    long mtime_nsec;
+    int64_t size;                   /* SKILL.md size */
+    ac_skill_meta_t meta;
+} skill_index_entry_t;
+
+typedef struct skill_index skill_index_t;
+
+/**
+ * @brief Load an index file
+ *
+ * A missing, unreadable or outdated file loads as an empty index.
+ *
+ * @return Index, NULL only when out of memory
+ */
+skill_index_t *skill_index_load(const char *path);
+
+/**
+ * @brief Find the entry of a skill directory
+ * @return Entry, or NULL if the directory is not indexed
+ */
+const skill_index_entry_t *skill_index_find(const skill_index_t *index, const char *dir_path);
+
+/**
+ * @brief Number of entries whose directory starts with prefix
+ */
+size_t skill_index_count_under(const skill_index_t *index, const char *prefix);
+
+/**
+ * @brief Write the index back with the entries below prefix replaced
+ *
+ * Entries of other directories are kept, so several skill directories
+ * can share one index. The file is replaced atomically.
+ *
+ * @param path     Index file
+ * @param old      Index loaded before the scan (may be NULL)
+ * @param prefix   Scanned directory, with a trailing '/'
+ * @param entries  Skills found below prefix
+ * @param count    Number of entries
+ * @return ARC_OK, or ARC_ERR_IO if the file could not be written
+ */
+arc_err_t skill_index_save(
+    const char *path,
+    const skill_index_t *old,
+    const char *prefix,
+    const skill_index_entry_t *const *entries,
+    size_t count
+);
+
+void skill_index_free(skill_index_t *index);
+
+/*============================================================================
+ * Hot Reload (skill_watch.c)
+ *============================================================================*/
+
+typedef struct skill_watch skill_watch_t;
+
+/**
+ * @brief Start watching a directory
+ *
+ * @param watch  Watcher
+ * @param path   Directory of skill folders (root) or a skill folder
+ * @param root   true for a directory of skill folders
+ */
+void skill_watch_add(skill_watch_t *watch, const char *path, bool root);
+
+void skill_watch_free(skill_watch_t *watch);
+
+/*============================================================================
+ * Skill Tool (skill_tool.c)
+ *============================================================================*/
+
+/**
+ * @brief Rebuild the description of this manager's skill tool in registry
+ *
+ * Does nothing if registry holds no skill tool of this manager.
+ */
+void skill_tool_refresh(ac_skills_t *skills, ac_tool_registry_t *registry);
+
 /*============================================================================
  * Prompt Builder Functions (skill_prompt.c)
  *============================================================================*/
 
+/**
+ * @brief Text of a cached prompt, rebuilt if skills changed since
+ *
+ * @param skills  Skills manager
+ * @param cache   One of the manager's caches
+ * @param build   Builder (result caller-freed, NULL = empty)
+ * @return Cached text (owned by the cache), NULL if empty
+ */
+const char *skill_prompt_cached(
+    const ac_skills_t *skills,
+    const skill_prompt_cache_t *cache,
+    char *(*build)(const ac_skills_t *skills)
+);
+
+void skill_prompt_cache_free(skill_prompt_cache_t *cache);
+
+/**
+ * @brief Discovery prompt listing the given skills, in that order
+ *
+ * @return Prompt (caller must free), NULL on error
+ */
+char *skill_discovery_prompt_for(const ac_skill_t *const *list, size_t count);
+
+/*============================================================================
+ * Relevance Index (skill_rank.c)
+ *============================================================================*/
+
+typedef struct skill_rank skill_rank_t;
+
+void skill_rank_free(skill_rank_t *rank);
+
 /**
  * @brief Format a single skill for discovery prompt
  *
@@ -109,6 +292,31 @@ char *skill_format_active(const ac_skill_t *skill);
  */
 char *skill_read_file(const char *filepath);
 
+/**
+ * @brief A file mapped read-only, followed by a NUL byte
+ */
+typedef struct skill_file {
+    const char *data;               /* len bytes, then '\0' */
+    size_t len;
+    void *map;                      /* Mapping (heap copy on Windows) */
+    size_t map_len;
+} skill_file_t;
+
+/**
+ * @brief Map a file for reading
+ *
+ * The pages are only read when touched. The mapping reaches at least one
+ * byte past the end of the file, where the kernel supplies zeros, so
+ * data is a C string without a copy.
+ *
+ * @param filepath  Path to file
+ * @return Mapped file (release with skill_file_unmap()), NULL on error or
+ *         for an empty file
+ */
+skill_file_t *skill_file_map(const char *filepath);
+
+void skill_file_unmap(skill_file_t *file);
+
 /**
  * @brief Check if file exists
  *
@@ -0,0 +1,654 @@
+/**
+ * @file swarm.c
+ * @brief Agent Swarm Scheduler Implementation
+ *
+ * Tasks are started with ac_agent_run_async(), so they run on the session
+ * executor; completions arrive on its workers, which release dependents
+ * and start whatever became ready from there (a worker's submissions stay
+ * on its own deque). All scheduling state is under one lock, never held
+ * while an agent run is started: without threads runs complete inline.
+ */
+
+#include <arc/swarm.h>
+#include <arc/http_pool.h>
+#include <arc/log.h>
+#include <arc/platform.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Internal Structure
+ *============================================================================*/
+
+#define NO_TASK ((size_t)-1)
+
+typedef struct {
+    ac_swarm_t *swarm;
+    char *name;
+    ac_agent_t *agent;
+    char *message;
+    ac_swarm_prompt_fn build_prompt;
+    void *user_data;
+
+    size_t *deps;                      /* Tasks this one waits for */
+    size_t dep_count;
+    size_t dep_capacity;
+    size_t *next;                      /* Tasks waiting for this one */
+    size_t next_count;
+    size_t next_capacity;
+
+    size_t waiting;                    /* Unfinished dependencies */
+    ac_swarm_task_status_t status;
+    char *output;
+    uint64_t ready_ms;
+    uint64_t start_ms;
+    uint64_t end_ms;
+
+    uint64_t path_ms;                  /* Longest chain ending here */
+    size_t path_prev;                  /* Its previous task */
+} swarm_task_t;
+
+struct ac_swarm {
+    ac_session_t *session;
+    size_t max_inflight;               /* 0 = unlimited */
+
+    swarm_task_t *tasks;
+    size_t count;
+    size_t capacity;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;               /* Signalled when the last task finishes */
+    size_t *ready;                     /* FIFO of startable tasks */
+    size_t ready_count;
+    size_t *running;                   /* Started, not finished */
+    size_t running_count;
+    size_t *stack;                     /* Skip propagation */
+    size_t finished;
+    size_t peak_inflight;
+
+    int ran;
+    size_t *order;                     /* Topological order */
+    uint64_t start_ms;
+    uint64_t end_ms;
+    size_t path_end;                   /* Last task of the critical path */
+};
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+static char *str_dup(const char *s) {
+    if (!s) {
+        return NULL;
+    }
+    size_t len = strlen(s);
+    char *copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, s, len + 1);
+    }
+    return copy;
+}
+
+static arc_err_t id_push(size_t **items, size_t *count, size_t *capacity, size_t id) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 4;
+        size_t *grown = realloc(*items, new_capacity * sizeof(size_t));
+        if (!grown) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        *items = grown;
+        *capacity = new_capacity;
+    }
+    (*items)[(*count)++] = id;
+    return ARC_OK;
+}
+
+/**
+ * @brief Default prompt: the message, then each input under its name
+ */
+static char *default_prompt(const char *message, const ac_swarm_input_t *inputs, size_t count) {
+    size_t len = strlen(message) + 1;
+    for (size_t i = 0; i < count; i++) {
+        len += strlen(inputs[i].name) + strlen(inputs[i].output) + 8;
+    }
+
+    char *prompt = malloc(len);
+    if (!prompt) {
+        return NULL;
+    }
+
+    char *p = prompt;
+    p += sprintf(p, "%s", message);
+    for (size_t i = 0; i < count; i++) {
+        p += sprintf(p, "\n\n## %s\n%s", inputs[i].name, inputs[i].output);
+    }
+    return prompt;
+}
+
+/*============================================================================
+ * Swarm Lifecycle
+ *============================================================================*/
+
+ac_swarm_t *ac_swarm_create(ac_session_t *session, const ac_swarm_config_t *config) {
+    if (!session) {
+        return NULL;
+    }
+
+    ac_swarm_t *swarm = calloc(1, sizeof(ac_swarm_t));
+    if (!swarm) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&swarm->lock, NULL) != 0) {
+        free(swarm);
+        return NULL;
+    }
+    if (pthread_cond_init(&swarm->cond, NULL) != 0) {
+        pthread_mutex_destroy(&swarm->lock);
+        free(swarm);
+        return NULL;
+    }
+
+    swarm->session = session;
+    swarm->max_inflight = config ? config->max_inflight : 0;
+    swarm->path_end = NO_TASK;
+
+    /* Stay within the connections the pool can lend at once */
+    ac_http_pool_stats_t pool;
+    if (swarm->max_inflight == 0 && ac_http_pool_get_stats(&pool) == ARC_OK) {
+        swarm->max_inflight = pool.max_connections;
+    }
+
+    return swarm;
+}
+
+arc_err_t ac_swarm_add(ac_swarm_t *swarm, const ac_swarm_task_t *task, size_t *id) {
+    if (!swarm || !task || !task->agent || !task->message) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (swarm->ran) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    if (swarm->count == swarm->capacity) {
+        size_t new_capacity = swarm->capacity ? swarm->capacity * 2 : 16;
+        swarm_task_t *grown = realloc(swarm->tasks, new_capacity * sizeof(swarm_task_t));
+        if (!grown) {
+            return ARC_ERR_NO_MEMORY;
+        }
+        swarm->tasks = grown;
+        swarm->capacity = new_capacity;
+    }
+
+    swarm_task_t *t = &swarm->tasks[swarm->count];
+    memset(t, 0, sizeof(*t));
+
+    char default_name[32];
+    if (!task->name) {
+        snprintf(default_name, sizeof(default_name), "task %zu", swarm->count);
+    }
+    t->name = str_dup(task->name ? task->name : default_name);
+    t->message = str_dup(task->message);
+    if (!t->name || !t->message) {
+        free(t->name);
+        free(t->message);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    t->agent = task->agent;
+    t->build_prompt = task->build_prompt;
+    t->user_data = task->user_data;
+    t->path_prev = NO_TASK;
+
+    if (id) {
+        *id = swarm->count;
+    }
+    swarm->count++;
+    return ARC_OK;
+}
+
+arc_err_t ac_swarm_depend(ac_swarm_t *swarm, size_t task, size_t on) {
+    if (!swarm || task >= swarm->count || on >= swarm->count || task == on) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (swarm->ran) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    swarm_task_t *t = &swarm->tasks[task];
+    swarm_task_t *o = &swarm->tasks[on];
+
+    arc_err_t err = id_push(&t->deps, &t->dep_count, &t->dep_capacity, on);
+    if (err != ARC_OK) {
+        return err;
+    }
+    err = id_push(&o->next, &o->next_count, &o->next_capacity, task);
+    if (err != ARC_OK) {
+        t->dep_count--;
+        return err;
+    }
+    return ARC_OK;
+}
+
+void ac_swarm_destroy(ac_swarm_t *swarm) {
+    if (!swarm) {
+        return;
+    }
+
+    for (size_t i = 0; i < swarm->count; i++) {
+        swarm_task_t *t = &swarm->tasks[i];
+        free(t->name);
+        free(t->message);
+        free(t->deps);
+        free(t->next);
+        free(t->output);
+    }
+    free(swarm->tasks);
+    free(swarm->ready);
+    free(swarm->running);
+    free(swarm->stack);
+    free(swarm->order);
+
+    pthread_cond_destroy(&swarm->cond);
+    pthread_mutex_destroy(&swarm->lock);
+    free(swarm);
+}
+
+/*============================================================================
+ * Scheduling
+ *============================================================================*/
+
+static int agent_running(const ac_swarm_t *swarm, const ac_agent_t *agent) {
+    for (size_t i = 0; i < swarm->running_count; i++) {
+        if (swarm->tasks[swarm->running[i]].agent == agent) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Take the first ready task whose agent is idle, if a slot is free
+ *
+ * Call with the lock held. Marks it running.
+ *
+ * @return Task id, NO_TASK if nothing can start now
+ */
+static size_t take_ready(ac_swarm_t *swarm) {
+    if (swarm->max_inflight > 0 && swarm->running_count >= swarm->max_inflight) {
+        return NO_TASK;
+    }
+
+    for (size_t i = 0; i < swarm->ready_count; i++) {
+        size_t id = swarm->ready[i];
+        swarm_task_t *t = &swarm->tasks[id];
+        if (agent_running(swarm, t->agent)) {
+            continue;
+        }
+
+        memmove(&swarm->ready[i], &swarm->ready[i + 1],
+                (swarm->ready_count - i - 1) * sizeof(size_t));
+        swarm->ready_count--;
+
+        t->status = AC_SWARM_TASK_RUNNING;
+        t->start_ms = ac_platform_timestamp_ms();
+        swarm->running[swarm->running_count++] = id;
+        if (swarm->running_count > swarm->peak_inflight) {
+            swarm->peak_inflight = swarm->running_count;
+        }
+        return id;
+    }
+    return NO_TASK;
+}
+
+/**
+ * @brief Mark a task and everything downstream of it skipped
+ *
+ * Call with the lock held.
+ */
+static void skip_downstream(ac_swarm_t *swarm, size_t id) {
+    size_t depth = 0;
+    swarm->stack[depth++] = id;
+
+    while (depth > 0) {
+        swarm_task_t *t = &swarm->tasks[swarm->stack[--depth]];
+        for (size_t i = 0; i < t->next_count; i++) {
+            swarm_task_t *n = &swarm->tasks[t->next[i]];
+            if (n->status != AC_SWARM_TASK_PENDING) {
+                continue;
+            }
+            n->status = AC_SWARM_TASK_SKIPPED;
+            swarm->finished++;
+            swarm->stack[depth++] = t->next[i];
+        }
+    }
+}
+
+static void start_tasks(ac_swarm_t *swarm);
+
+/**
+ * @brief Record a task's outcome and release its dependents
+ *
+ * @param content  Agent response (copied), NULL if the run failed
+ */
+static void finish_task(swarm_task_t *t, const char *content) {
+    ac_swarm_t *swarm = t->swarm;
+    char *output = str_dup(content);
+    uint64_t now = ac_platform_timestamp_ms();
+    size_t id = (size_t)(t - swarm->tasks);
+
+    pthread_mutex_lock(&swarm->lock);
+
+    t->end_ms = now;
+    t->output = output;
+    t->status = output ? AC_SWARM_TASK_DONE : AC_SWARM_TASK_FAILED;
+    swarm->finished++;
+
+    for (size_t i = 0; i < swarm->running_count; i++) {
+        if (swarm->running[i] == id) {
+            swarm->running[i] = swarm->running[--swarm->running_count];
+            break;
+        }
+    }
+
+    if (t->status == AC_SWARM_TASK_DONE) {
+        for (size_t i = 0; i < t->next_count; i++) {
+            swarm_task_t *n = &swarm->tasks[t->next[i]];
+            if (--n->waiting == 0 && n->status == AC_SWARM_TASK_PENDING) {
+                n->ready_ms = now;
+                swarm->ready[swarm->ready_count++] = t->next[i];
+            }
+        }
+    } else {
+        AC_LOG_WARN("Swarm task '%s' failed, skipping its dependents", t->name);
+        skip_downstream(swarm, id);
+    }
+
+    int all_finished = swarm->finished == swarm->count;
+    if (all_finished) {
+        pthread_cond_broadcast(&swarm->cond);
+    }
+
+    pthread_mutex_unlock(&swarm->lock);
+
+    /* Once the last task is in, ac_swarm_run() may return and the swarm
+     * be destroyed: do not touch it again */
+    if (!all_finished) {
+        start_tasks(swarm);
+    }
+}
+
+static void task_done(ac_agent_t *agent, ac_agent_result_t *result, void *user_data) {
+    (void)agent;
+    finish_task((swarm_task_t *)user_data, result ? result->content : NULL);
+}
+
+/**
+ * @brief Build the prompt and queue the agent run
+ */
+static void start_task(swarm_task_t *t) {
+    ac_swarm_t *swarm = t->swarm;
+    char *prompt = t->message;
+
+    if (t->dep_count > 0) {
+        /* Dependencies are finished: their outputs no longer change */
+        ac_swarm_input_t stack_inputs[16];
+        ac_swarm_input_t *inputs = stack_inputs;
+        if (t->dep_count > 16) {
+            inputs = malloc(t->dep_count * sizeof(ac_swarm_input_t));
+        }
+
+        prompt = NULL;
+        if (inputs) {
+            for (size_t i = 0; i < t->dep_count; i++) {
+                const swarm_task_t *dep = &swarm->tasks[t->deps[i]];
+                inputs[i].name = dep->name;
+                inputs[i].output = dep->output;
+            }
+            prompt = t->build_prompt
+                   ? t->build_prompt(t->message, inputs, t->dep_count, t->user_data)
+                   : default_prompt(t->message, inputs, t->dep_count);
+            if (inputs != stack_inputs) {
+                free(inputs);
+            }
+        }
+    }
+
+    ac_agent_run_t *run = prompt ? ac_agent_run_async(t->agent, prompt, task_done, t) : NULL;
+    if (prompt != t->message) {
+        free(prompt);
+    }
+
+    if (!run) {
+        AC_LOG_ERROR("Swarm task '%s' could not be started", t->name);
+        finish_task(t, NULL);
+        return;
+    }
+    ac_agent_run_release(run);
+}
+
+/**
+ * @brief Start ready tasks while slots are free
+ */
+static void start_tasks(ac_swarm_t *swarm) {
+    for (;;) {
+        pthread_mutex_lock(&swarm->lock);
+        size_t id = take_ready(swarm);
+        pthread_mutex_unlock(&swarm->lock);
+
+        if (id == NO_TASK) {
+            return;
+        }
+        start_task(&swarm->tasks[id]);
+    }
+}
+
+/*============================================================================
+ * Run
+ *============================================================================*/
+
+/**
+ * @brief Topological order into swarm->order
+ *
+ * @return 0, -1 if the edges form a cycle
+ */
+static int topo_sort(ac_swarm_t *swarm) {
+    size_t head = 0;
+    size_t tail = 0;
+
+    for (size_t i = 0; i < swarm->count; i++) {
+        swarm->tasks[i].waiting = swarm->tasks[i].dep_count;
+        if (swarm->tasks[i].waiting == 0) {
+            swarm->order[tail++] = i;
+        }
+    }
+
+    while (head < tail) {
+        const swarm_task_t *t = &swarm->tasks[swarm->order[head++]];
+        for (size_t i = 0; i < t->next_count; i++) {
+            if (--swarm->tasks[t->next[i]].waiting == 0) {
+                swarm->order[tail++] = t->next[i];
+            }
+        }
+    }
+
+    return tail == swarm->count ? 0 : -1;
+}
+
+/**
+ * @brief Longest chain of run times through the DAG
+ */
+static void compute_critical_path(ac_swarm_t *swarm) {
+    uint64_t best = 0;
+
+    for (size_t k = 0; k < swarm->count; k++) {
+        size_t id = swarm->order[k];
+        swarm_task_t *t = &swarm->tasks[id];
+
+        uint64_t before = 0;
+        t->path_prev = NO_TASK;
+        for (size_t i = 0; i < t->dep_count; i++) {
+            const swarm_task_t *dep = &swarm->tasks[t->deps[i]];
+            if (t->path_prev == NO_TASK || dep->path_ms > before) {
+                before = dep->path_ms;
+                t->path_prev = t->deps[i];
+            }
+        }
+
+        uint64_t own = t->start_ms ? t->end_ms - t->start_ms : 0;
+        t->path_ms = before + own;
+        if (swarm->path_end == NO_TASK || t->path_ms > best) {
+            best = t->path_ms;
+            swarm->path_end = id;
+        }
+    }
+}
+
+arc_err_t ac_swarm_run(ac_swarm_t *swarm) {
+    if (!swarm) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (swarm->ran) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    size_t n = swarm->count ? swarm->count : 1;
+    swarm->order = malloc(n * sizeof(size_t));
+    swarm->ready = malloc(n * sizeof(size_t));
+    swarm->running = malloc(n * sizeof(size_t));
+    swarm->stack = malloc(n * sizeof(size_t));
+    if (!swarm->order || !swarm->ready || !swarm->running || !swarm->stack) {
+        free(swarm->order);
+        free(swarm->ready);
+        free(swarm->running);
+        free(swarm->stack);
+        swarm->order = swarm->ready = swarm->running = swarm->stack = NULL;
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    if (topo_sort(swarm) != 0) {
+        AC_LOG_ERROR("Swarm dependencies form a cycle");
+        free(swarm->order);
+        free(swarm->ready);
+        free(swarm->running);
+        free(swarm->stack);
+        swarm->order = swarm->ready = swarm->running = swarm->stack = NULL;
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    swarm->ran = 1;
+    swarm->start_ms = ac_platform_timestamp_ms();
+
+    for (size_t i = 0; i < swarm->count; i++) {
+        swarm_task_t *t = &swarm->tasks[i];
+        t->swarm = swarm;
+        t->waiting = t->dep_count;
+        if (t->waiting == 0) {
+            t->ready_ms = swarm->start_ms;
+            swarm->ready[swarm->ready_count++] = i;
+        }
+    }
+
+    AC_LOG_INFO("Swarm running %zu tasks (max in flight: %zu)",
+                swarm->count, swarm->max_inflight);
+
+    start_tasks(swarm);
+
+    pthread_mutex_lock(&swarm->lock);
+    while (swarm->finished < swarm->count) {
+        pthread_cond_wait(&swarm->cond, &swarm->lock);
+    }
+    pthread_mutex_unlock(&swarm->lock);
+
+    swarm->end_ms = ac_platform_timestamp_ms();
+    compute_critical_path(swarm);
+
+    for (size_t i = 0; i < swarm->count; i++) {
+        if (swarm->tasks[i].status != AC_SWARM_TASK_DONE) {
+            return ARC_ERR_BACKEND;
+        }
+    }
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Results and Report
+ *============================================================================*/
+
+ac_swarm_task_status_t ac_swarm_status(const ac_swarm_t *swarm, size_t task) {
+    if (!swarm || task >= swarm->count) {
+        return AC_SWARM_TASK_FAILED;
+    }
+    return swarm->tasks[task].status;
+}
+
+const char *ac_swarm_output(const ac_swarm_t *swarm, size_t task) {
+    if (!swarm || task >= swarm->count) {
+        return NULL;
+    }
+    return swarm->tasks[task].output;
+}
+
+size_t ac_swarm_critical_path(const ac_swarm_t *swarm, size_t *ids, size_t max) {
+    if (!swarm || !swarm->ran) {
+        return 0;
+    }
+
+    size_t len = 0;
+    for (size_t id = swarm->path_end; id != NO_TASK; id = swarm->tasks[id].path_prev) {
+        len++;
+    }
+
+    /* Walked last to first: fill from the back */
+    size_t pos = len;
+    for (size_t id = swarm->path_end; id != NO_TASK; id = swarm->tasks[id].path_prev) {
+        pos--;
+        if (ids && pos < max) {
+            ids[pos] = id;
+        }
+    }
+    return len;
+}
+
+arc_err_t ac_swarm_get_report(const ac_swarm_t *swarm, ac_swarm_report_t *report) {
+    if (!swarm || !report) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (!swarm->ran) {
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    memset(report, 0, sizeof(*report));
+    report->tasks = swarm->count;
+    report->max_inflight = swarm->max_inflight;
+    report->peak_inflight = swarm->peak_inflight;
+    report->wall_ms = swarm->end_ms - swarm->start_ms;
+
+    for (size_t i = 0; i < swarm->count; i++) {
+        const swarm_task_t *t = &swarm->tasks[i];
+        switch (t->status) {
+            case AC_SWARM_TASK_DONE:    report->done++; break;
+            case AC_SWARM_TASK_FAILED:  report->failed++; break;
+            case AC_SWARM_TASK_SKIPPED: report->skipped++; break;
+            default: break;
+        }
+        if (t->start_ms) {
+            report->busy_ms += t->end_ms - t->start_ms;
+            report->queue_ms += t->start_ms - t->ready_ms;
+        }
+    }
+
+    if (swarm->path_end != NO_TASK) {
+        report->critical_path_ms = swarm->tasks[swarm->path_end].path_ms;
+        report->critical_path_tasks = ac_swarm_critical_path(swarm, NULL, 0);
+    }
+    if (report->wall_ms > 0) {
+        report->parallelism = (double)report->busy_ms / (double)report->wall_ms;
+        if (report->peak_inflight > 0) {
+            report->utilization = report->parallelism / (double)report->peak_inflight;
+        }
+    }
+    return ARC_OK;
+}
@@ -0,0 +1,1139 @@
+/**
+ * @file trace_binary_exporter.c
+ * @brief Compact binary trace files and their reader
+ *
+ * File layout (integers little-endian; "varint" is LEB128, "zz" a
+ * zigzag varint):
+ *
+ *   header  "ARCT", u8 version (4), u8 flags (0), u16 reserved
+ *   frame*  u32 raw_len, u32 stored_len, u8 codec, stored_len bytes
+ *
+ * A frame holds whole records, each a varint length and a payload:
+ *
+ *   string  u8 1, varint id, bytes          ids count up from 1 per file
+ *   event   u8 2, u8 type, zz time delta, zz sequence, varint thread_id,
+ *           sym trace_id, sym agent_name, then the fields of the type
+ *           (encode_event)
+ *
+ * Version 1 files, still read, lack thread_id and the pool wait of
+ * LLM responses; version 2 files lack the process usage of tool ends;
+ * version 3 files lack the token budget of LLM requests and the thinking
+ * tokens of LLM responses.
+ *
+ * Field strings are "str": varint len + 1 (0 = NULL), the bytes and a
+ * NUL, so the reader hands out pointers into the frame; or "sym": varint
+ * 0 = NULL, 2 * id for a string table entry, 2 * len + 1 for an inline
+ * str once the table is full. History and tool lists are "delta": varint
+ * bytes kept from the previous request of the same agent, then a str
+ * with the rest.
+ */
+
+#include "arc/trace_exporters.h"
+#include "arc/trace.h"
+#include "arc/platform.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#ifdef ARC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define mkdir_p(path) _mkdir(path)
+#define get_pid() _getpid()
+#else
+#include <unistd.h>
+#define mkdir_p(path) mkdir(path, 0755)
+#define get_pid() getpid()
+#endif
+
+/*============================================================================
+ * Format
+ *============================================================================*/
+
+#define ARCT_MAGIC          "ARCT"
+#define ARCT_VERSION        4
+#define ARCT_HEADER_SIZE    8
+#define ARCT_FRAME_HEADER   9
+
+#define ARCT_CODEC_RAW      0
+#define ARCT_CODEC_DEFLATE  1
+
+#define ARCT_REC_STRING     1
+#define ARCT_REC_EVENT      2
+
+/** String table entries per file; later strings are written inline */
+#define ARCT_MAX_STRINGS    4096
+#define ARCT_SYM_BUCKETS    (ARCT_MAX_STRINGS * 2)
+
+/** Largest frame the reader accepts */
+#define ARCT_MAX_FRAME      (256u * 1024 * 1024)
+
+/** Agents whose last history is kept for deltas */
+#define ARCT_HISTORY_SLOTS  8
+
+/** How long flush waits for queued events */
+#define ARCT_FLUSH_TIMEOUT_MS 5000
+
+/**
+ * @brief Previous history and tools of one agent, keyed by its name's id
+ *
+ * Writer and reader update these the same way, so a delta written
+ * against one decodes against the other.
+ */
+typedef struct {
+    int used;
+    uint32_t agent;
+    char *messages;
+    size_t messages_len;
+    char *tools;
+    size_t tools_len;
+} history_slot_t;
+
+typedef struct {
+    history_slot_t slots[ARCT_HISTORY_SLOTS];
+    unsigned next;
+} history_t;
+
+static history_slot_t *history_slot(history_t *h, uint32_t agent) {
+    for (int i = 0; i < ARCT_HISTORY_SLOTS; i++) {
+        if (h->slots[i].used && h->slots[i].agent == agent) {
+            return &h->slots[i];
+        }
+    }
+    history_slot_t *slot = &h->slots[h->next++ % ARCT_HISTORY_SLOTS];
+    ARC_FREE(slot->messages);
+    ARC_FREE(slot->tools);
+    memset(slot, 0, sizeof(*slot));
+    slot->used = 1;
+    slot->agent = agent;
+    return slot;
+}
+
+static void history_free(history_t *h) {
+    for (int i = 0; i < ARCT_HISTORY_SLOTS; i++) {
+        ARC_FREE(h->slots[i].messages);
+        ARC_FREE(h->slots[i].tools);
+    }
+    memset(h, 0, sizeof(*h));
+}
+
+/**
+ * @brief Replace a kept string with head[0..head_len) + tail[0..tail_len)
+ *
+ * head may point into the kept string itself.
+ */
+static int history_store(char **prev, size_t *prev_len,
+                         const char *head, size_t head_len,
+                         const char *tail, size_t tail_len) {
+    char *s = (char *)ARC_MALLOC(head_len + tail_len + 1);
+    if (!s) {
+        return -1;
+    }
+    memcpy(s, head, head_len);
+    memcpy(s + head_len, tail, tail_len);
+    s[head_len + tail_len] = '\0';
+    ARC_FREE(*prev);
+    *prev = s;
+    *prev_len = head_len + tail_len;
+    return 0;
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*============================================================================
+ * Writer: Buffers
+ *============================================================================*/
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    int failed;                  /**< An append ran out of memory */
+} bin_buf_t;
+
+static int buf_reserve(bin_buf_t *b, size_t extra) {
+    if (b->failed) {
+        return -1;
+    }
+    if (b->len + extra <= b->cap) {
+        return 0;
+    }
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + extra) {
+        cap *= 2;
+    }
+    uint8_t *data = (uint8_t *)ARC_REALLOC(b->data, cap);
+    if (!data) {
+        b->failed = 1;
+        return -1;
+    }
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+static void put_bytes(bin_buf_t *b, const void *p, size_t n) {
+    if (buf_reserve(b, n) == 0) {
+        memcpy(b->data + b->len, p, n);
+        b->len += n;
+    }
+}
+
+static void put_u8(bin_buf_t *b, uint8_t v) {
+    put_bytes(b, &v, 1);
+}
+
+static size_t encode_varint(uint8_t out[10], uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static void put_varint(bin_buf_t *b, uint64_t v) {
+    uint8_t tmp[10];
+    put_bytes(b, tmp, encode_varint(tmp, v));
+}
+
+static void put_zz(bin_buf_t *b, int64_t v) {
+    put_varint(b, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void put_str_n(bin_buf_t *b, const char *s, size_t len) {
+    put_varint(b, (uint64_t)len + 1);
+    put_bytes(b, s, len);
+    put_u8(b, 0);
+}
+
+static void put_str(bin_buf_t *b, const char *s) {
+    if (!s) {
+        put_varint(b, 0);
+        return;
+    }
+    put_str_n(b, s, strlen(s));
+}
+
+/*============================================================================
+ * Writer: State
+ *============================================================================*/
+
+typedef struct {
+    const char *str;
+    uint32_t hash;
+    uint32_t id;
+} sym_entry_t;
+
+typedef struct {
+    ac_trace_binary_config_t config;
+    FILE *file;
+    char path[512];
+    bin_buf_t frame;             /**< Records not yet written */
+    bin_buf_t rec;               /**< Event being encoded */
+    sym_entry_t *syms;           /**< ARCT_SYM_BUCKETS, open addressing */
+    uint32_t sym_count;
+    history_t history;
+    uint64_t last_ts;
+    int initialized;
+} binary_exporter_state_t;
+
+static binary_exporter_state_t s_bin = {0};
+
+/* MCP connection events arrive on transport threads; one writer at a time */
+static atomic_flag s_bin_lock = ATOMIC_FLAG_INIT;
+
+static void bin_lock(void) {
+    while (atomic_flag_test_and_set_explicit(&s_bin_lock, memory_order_acquire)) {
+    }
+}
+
+static void bin_unlock(void) {
+    atomic_flag_clear_explicit(&s_bin_lock, memory_order_release);
+}
+
+static uint32_t fnv1a(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Encode a sym, defining it in the frame the first time it is seen
+ *
+ * @return Its table id, 0 if NULL or written inline
+ */
+static uint32_t put_sym(binary_exporter_state_t *st, const char *s) {
+    if (!s) {
+        put_varint(&st->rec, 0);
+        return 0;
+    }
+
+    size_t len = strlen(s);
+    uint32_t hash = fnv1a(s, len);
+    uint32_t i = hash & (ARCT_SYM_BUCKETS - 1);
+    while (st->syms[i].str) {
+        if (st->syms[i].hash == hash && strcmp(st->syms[i].str, s) == 0) {
+            put_varint(&st->rec, (uint64_t)st->syms[i].id << 1);
+            return st->syms[i].id;
+        }
+        i = (i + 1) & (ARCT_SYM_BUCKETS - 1);
+    }
+
+    /* A string record is appended whole or not at all */
+    char *copy = NULL;
+    if (st->sym_count < ARCT_MAX_STRINGS &&
+        buf_reserve(&st->frame, len + 16) == 0 &&
+        (copy = ARC_STRDUP(s)) != NULL) {
+        uint32_t id = ++st->sym_count;
+        st->syms[i].str = copy;
+        st->syms[i].hash = hash;
+        st->syms[i].id = id;
+
+        uint8_t head[11];
+        head[0] = ARCT_REC_STRING;
+        size_t n = 1 + encode_varint(head + 1, id);
+        put_varint(&st->frame, n + len);
+        put_bytes(&st->frame, head, n);
+        put_bytes(&st->frame, s, len);
+
+        put_varint(&st->rec, (uint64_t)id << 1);
+        return id;
+    }
+
+    put_varint(&st->rec, ((uint64_t)len << 1) | 1);
+    put_bytes(&st->rec, s, len);
+    put_u8(&st->rec, 0);
+    return 0;
+}
+
+/**
+ * @brief Encode s as the bytes it adds to the previous one
+ */
+static void put_delta(bin_buf_t *b, char **prev, size_t *prev_len, const char *s) {
+    if (!s) {
+        put_varint(b, 0);
+        put_str(b, NULL);
+        return;
+    }
+
+    size_t len = strlen(s);
+    size_t keep = 0;
+    if (*prev) {
+        size_t max = len < *prev_len ? len : *prev_len;
+        while (keep + 64 <= max && memcmp(*prev + keep, s + keep, 64) == 0) {
+            keep += 64;
+        }
+        while (keep < max && (*prev)[keep] == s[keep]) {
+            keep++;
+        }
+    }
+
+    put_varint(b, keep);
+    put_str_n(b, s + keep, len - keep);
+
+    /* Without a copy the next delta is taken against nothing: keep 0 */
+    if (history_store(prev, prev_len, s, len, "", 0) != 0) {
+        ARC_FREE(*prev);
+        *prev = NULL;
+        *prev_len = 0;
+    }
+}
+
+static void encode_event(binary_exporter_state_t *st, const ac_trace_event_t *event) {
+    bin_buf_t *b = &st->rec;
+
+    put_u8(b, ARCT_REC_EVENT);
+    put_u8(b, (uint8_t)event->type);
+    put_zz(b, (int64_t)(event->timestamp_ms - st->last_ts));
+    st->last_ts = event->timestamp_ms;
+    put_zz(b, event->sequence);
+    put_varint(b, event->thread_id);
+    put_sym(st, event->trace_id);
+    uint32_t agent = put_sym(st, event->agent_name);
+
+    switch (event->type) {
+        case AC_TRACE_AGENT_START: {
+            const ac_trace_agent_start_t *d = &event->data.agent_start;
+            put_str(b, d->message);
+            put_sym(st, d->instructions);
+            put_zz(b, d->max_iterations);
+            put_varint(b, d->tool_count);
+            break;
+        }
+        case AC_TRACE_AGENT_END: {
+            const ac_trace_agent_end_t *d = &event->data.agent_end;
+            put_str(b, d->content);
+            put_zz(b, d->iterations);
+            put_zz(b, d->total_prompt_tokens);
+            put_zz(b, d->total_completion_tokens);
+            put_varint(b, d->duration_ms);
+            break;
+        }
+        case AC_TRACE_ITER_START:
+        case AC_TRACE_ITER_END:
+            put_zz(b, event->data.iter.iteration);
+            put_zz(b, event->data.iter.max_iterations);
+            break;
+        case AC_TRACE_LLM_REQUEST: {
+            const ac_trace_llm_request_t *d = &event->data.llm_request;
+            put_sym(st, d->model);
+            put_varint(b, d->message_count);
+            put_varint(b, d->message_offset);
+            history_slot_t *slot = history_slot(&st->history, agent);
+            put_delta(b, &slot->messages, &slot->messages_len, d->messages_json);
+            put_delta(b, &slot->tools, &slot->tools_len, d->tools_json);
+            put_zz(b, d->max_tokens);
+            put_zz(b, d->thinking_budget);
+            put_zz(b, d->budget_reason);
+            break;
+        }
+        case AC_TRACE_LLM_RESPONSE: {
+            const ac_trace_llm_response_t *d = &event->data.llm_response;
+            put_str(b, d->content);
+            put_str(b, d->tool_calls_json);
+            put_zz(b, d->tool_call_count);
+            put_zz(b, d->prompt_tokens);
+            put_zz(b, d->completion_tokens);
+            put_zz(b, d->total_tokens);
+            put_sym(st, d->finish_reason);
+            put_varint(b, d->duration_ms);
+            put_varint(b, d->ratelimit_wait_ms);
+            put_zz(b, d->draft);
+            put_varint(b, d->timing.connect_ms);
+            put_varint(b, d->timing.ttfb_ms);
+            put_varint(b, d->timing.first_token_ms);
+            put_varint(b, d->timing.stream_ms);
+            put_varint(b, d->timing.max_gap_ms);
+            put_varint(b, d->timing.deltas);
+            uint32_t bits;
+            uint8_t raw[4];
+            memcpy(&bits, &d->timing.tokens_per_sec, sizeof(bits));
+            put_le32(raw, bits);
+            put_bytes(b, raw, sizeof(raw));
+            put_varint(b, d->timing.pool_wait_ms);
+            put_zz(b, d->thinking_tokens);
+            break;
+        }
+        case AC_TRACE_TOOL_START: {
+            const ac_trace_tool_start_t *d = &event->data.tool_start;
+            put_str(b, d->id);
+            put_sym(st, d->name);
+            put_str(b, d->arguments);
+            break;
+        }
+        case AC_TRACE_TOOL_END: {
+            const ac_trace_tool_end_t *d = &event->data.tool_end;
+            put_str(b, d->id);
+            put_sym(st, d->name);
+            put_str(b, d->result);
+            put_varint(b, d->duration_ms);
+            put_zz(b, d->success);
+            put_zz(b, d->cache_status);
+            put_varint(b, d->cache_hits);
+            put_varint(b, d->cache_misses);
+            put_varint(b, d->processes);
+            put_varint(b, d->cpu_usec);
+            put_varint(b, d->memory_peak);
+            put_varint(b, d->io_read_bytes);
+            put_varint(b, d->io_write_bytes);
+            break;
+        }
+        case AC_TRACE_MCP_CONNECTION: {
+            const ac_trace_mcp_connection_t *d = &event->data.mcp_connection;
+            put_sym(st, d->server_url);
+            put_zz(b, d->event);
+            put_zz(b, d->attempt);
+            put_varint(b, d->delay_ms);
+            put_varint(b, d->downtime_ms);
+            put_zz(b, d->resumed);
+            put_str(b, d->error);
+            break;
+        }
+        case AC_TRACE_ARENA: {
+            const ac_trace_arena_t *d = &event->data.arena;
+            put_varint(b, d->total_capacity);
+            put_varint(b, d->total_allocated);
+            put_varint(b, d->peak_allocated);
+            put_varint(b, d->wasted_tail);
+            /* Tags that saw no allocations are left out of the mask */
+            uint32_t mask = 0;
+            for (int t = 0; d->tags && t < ARENA_TAG_MAX; t++) {
+                if (d->tags[t].count > 0) {
+                    mask |= 1u << t;
+                }
+            }
+            put_varint(b, mask);
+            for (int t = 0; t < ARENA_TAG_MAX; t++) {
+                if (mask & (1u << t)) {
+                    put_varint(b, d->tags[t].bytes);
+                    put_varint(b, d->tags[t].count);
+                }
+            }
+            break;
+        }
+    }
+}
+
+/*============================================================================
+ * Writer: Frames
+ *============================================================================*/
+
+static void write_frame(binary_exporter_state_t *st) {
+    if (!st->file || st->frame.len == 0) {
+        return;
+    }
+
+    const uint8_t *out = st->frame.data;
+    size_t out_len = st->frame.len;
+    uint8_t codec = ARCT_CODEC_RAW;
+
+#ifdef ARC_HAVE_ZLIB
+    uint8_t *deflated = NULL;
+    if (st->config.compress) {
+        uLongf zlen = compressBound((uLong)st->frame.len);
+        deflated = (uint8_t *)ARC_MALLOC(zlen);
+        if (deflated &&
+            compress2(deflated, &zlen, st->frame.data, (uLong)st->frame.len,
+                      Z_DEFAULT_COMPRESSION) == Z_OK &&
+            zlen < st->frame.len) {
+            out = deflated;
+            out_len = zlen;
+            codec = ARCT_CODEC_DEFLATE;
+        }
+    }
+#endif
+
+    uint8_t header[ARCT_FRAME_HEADER];
+    put_le32(header, (uint32_t)st->frame.len);
+    put_le32(header + 4, (uint32_t)out_len);
+    header[8] = codec;
+
+    if (fwrite(header, 1, sizeof(header), st->file) != sizeof(header) ||
+        fwrite(out, 1, out_len, st->file) != out_len ||
+        fflush(st->file) != 0) {
+        fprintf(stderr, "[TRACE] Failed to write %s: %s\n", st->path, strerror(errno));
+    }
+
+#ifdef ARC_HAVE_ZLIB
+    ARC_FREE(deflated);
+#endif
+    st->frame.len = 0;
+}
+
+static void close_file(binary_exporter_state_t *st) {
+    if (st->file) {
+        write_frame(st);
+        fclose(st->file);
+        st->file = NULL;
+    }
+}
+
+static void binary_write_event(binary_exporter_state_t *st, const ac_trace_event_t *event) {
+    if (!st->file) {
+        return;
+    }
+
+    st->rec.len = 0;
+    encode_event(st, event);
+
+    /* Make room by writing what is buffered; failing that the file ends
+     * here, since the reader's string table and deltas would go astray */
+    size_t need = st->rec.len + 10;
+    if (!st->rec.failed && !st->frame.failed && buf_reserve(&st->frame, need) != 0) {
+        st->frame.failed = 0;
+        write_frame(st);
+        buf_reserve(&st->frame, need);
+    }
+    if (st->rec.failed || st->frame.failed) {
+        fprintf(stderr, "[TRACE] Out of memory, %s ends here\n", st->path);
+        st->frame.failed = 0;
+        close_file(st);
+        return;
+    }
+
+    put_varint(&st->frame, st->rec.len);
+    put_bytes(&st->frame, st->rec.data, st->rec.len);
+
+    if (st->frame.len >= st->config.frame_bytes || event->type == AC_TRACE_AGENT_END) {
+        write_frame(st);
+    }
+}
+
+static void binary_trace_handler(const ac_trace_event_t *event, void *user_data) {
+    (void)user_data;
+
+    if (!event) return;
+
+    bin_lock();
+    binary_write_event(&s_bin, event);
+    bin_unlock();
+}
+
+static void free_writer(binary_exporter_state_t *st) {
+    if (st->syms) {
+        for (uint32_t i = 0; i < ARCT_SYM_BUCKETS; i++) {
+            ARC_FREE((void *)st->syms[i].str);
+        }
+        ARC_FREE(st->syms);
+    }
+    ARC_FREE(st->frame.data);
+    ARC_FREE(st->rec.data);
+    history_free(&st->history);
+    memset(st, 0, sizeof(*st));
+}
+
+/*============================================================================
+ * Writer: Public API
+ *============================================================================*/
+
+static int ensure_dir(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        return S_ISDIR(st.st_mode) ? 0 : -1;
+    }
+    if (mkdir_p(path) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+int ac_trace_binary_exporter_init(const ac_trace_binary_config_t *config) {
+    if (s_bin.initialized) {
+        ac_trace_binary_exporter_cleanup();
+    }
+    memset(&s_bin, 0, sizeof(s_bin));
+
+    if (config) {
+        s_bin.config = *config;
+    } else {
+        s_bin.config.compress = 1;
+        s_bin.config.async_queue = AC_TRACE_BINARY_DEFAULT_QUEUE;
+    }
+    if (!s_bin.config.output_dir) {
+        s_bin.config.output_dir = AC_TRACE_BINARY_DEFAULT_DIR;
+    }
+    if (s_bin.config.frame_bytes == 0) {
+        s_bin.config.frame_bytes = AC_TRACE_BINARY_DEFAULT_FRAME;
+    }
+
+    if (s_bin.config.path) {
+        snprintf(s_bin.path, sizeof(s_bin.path), "%s", s_bin.config.path);
+    } else {
+        if (ensure_dir(s_bin.config.output_dir) != 0) {
+            fprintf(stderr, "[TRACE] Failed to create directory: %s\n",
+                    s_bin.config.output_dir);
+            return -1;
+        }
+        time_t now = time(NULL);
+        struct tm *tm_info = localtime(&now);
+        snprintf(s_bin.path, sizeof(s_bin.path),
+                 "%s/trace_%04d%02d%02d_%02d%02d%02d_%d.arct",
+                 s_bin.config.output_dir,
+                 tm_info->tm_year + 1900, tm_info->tm_mon + 1, tm_info->tm_mday,
+                 tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec,
+                 (int)get_pid());
+    }
+
+    s_bin.syms = (sym_entry_t *)ARC_CALLOC(ARCT_SYM_BUCKETS, sizeof(sym_entry_t));
+    if (!s_bin.syms) {
+        free_writer(&s_bin);
+        return -1;
+    }
+
+    s_bin.file = fopen(s_bin.path, "wb");
+    if (!s_bin.file) {
+        fprintf(stderr, "[TRACE] Failed to open %s: %s\n", s_bin.path, strerror(errno));
+        free_writer(&s_bin);
+        return -1;
+    }
+
+    uint8_t header[ARCT_HEADER_SIZE] = { 'A', 'R', 'C', 'T', ARCT_VERSION, 0, 0, 0 };
+    if (fwrite(header, 1, sizeof(header), s_bin.file) != sizeof(header)) {
+        fprintf(stderr, "[TRACE] Failed to write %s: %s\n", s_bin.path, strerror(errno));
+        fclose(s_bin.file);
+        free_writer(&s_bin);
+        return -1;
+    }
+
+    if (s_bin.config.async_queue > 0) {
+        ac_trace_async_config_t async = { .capacity = s_bin.config.async_queue };
+        if (ac_trace_enable_async(binary_trace_handler, NULL, &async) != ARC_OK) {
+            fprintf(stderr, "[TRACE] Failed to start writer thread\n");
+            fclose(s_bin.file);
+            free_writer(&s_bin);
+            return -1;
+        }
+    } else {
+        ac_trace_enable(binary_trace_handler, NULL);
+    }
+
+    s_bin.initialized = 1;
+    return 0;
+}
+
+void ac_trace_binary_exporter_flush(void) {
+    ac_trace_flush(ARCT_FLUSH_TIMEOUT_MS);
+
+    bin_lock();
+    write_frame(&s_bin);
+    bin_unlock();
+}
+
+void ac_trace_binary_exporter_cleanup(void) {
+    if (!s_bin.initialized) {
+        return;
+    }
+
+    /* Writes what is still queued before the file is closed */
+    ac_trace_disable();
+
+    bin_lock();
+    close_file(&s_bin);
+    free_writer(&s_bin);
+    bin_unlock();
+}
+
+const char *ac_trace_binary_exporter_get_path(void) {
+    return s_bin.initialized && s_bin.path[0] ? s_bin.path : NULL;
+}
+
+/*============================================================================
+ * Reader
+ *============================================================================*/
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    int bad;
+} cursor_t;
+
+typedef struct {
+    char **strings;              /**< strings[id - 1] */
+    uint32_t string_count;
+    uint32_t string_cap;
+    history_t history;
+    uint64_t last_ts;
+    uint8_t version;
+} binary_reader_t;
+
+static uint64_t get_varint(cursor_t *c) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (c->p >= c->end) {
+            break;
+        }
+        uint8_t byte = *c->p++;
+        v |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return v;
+        }
+    }
+    c->bad = 1;
+    return 0;
+}
+
+static int64_t get_zz(cursor_t *c) {
+    uint64_t v = get_varint(c);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static int get_int(cursor_t *c) {
+    return (int)get_zz(c);
+}
+
+static uint8_t get_u8(cursor_t *c) {
+    if (c->p >= c->end) {
+        c->bad = 1;
+        return 0;
+    }
+    return *c->p++;
+}
+
+/** len bytes and their NUL, in place */
+static const char *get_text(cursor_t *c, uint64_t len) {
+    if (c->bad || len >= (uint64_t)(c->end - c->p) || c->p[len] != 0) {
+        c->bad = 1;
+        return NULL;
+    }
+    const char *s = (const char *)c->p;
+    c->p += len + 1;
+    return s;
+}
+
+static const char *get_str(cursor_t *c) {
+    uint64_t v = get_varint(c);
+    return v ? get_text(c, v - 1) : NULL;
+}
+
+static const char *get_sym(binary_reader_t *r, cursor_t *c, uint32_t *id) {
+    uint64_t v = get_varint(c);
+    *id = 0;
+    if (v == 0) {
+        return NULL;
+    }
+    if (v & 1) {
+        return get_text(c, v >> 1);
+    }
+    if ((v >> 1) > r->string_count) {
+        c->bad = 1;
+        return NULL;
+    }
+    *id = (uint32_t)(v >> 1);
+    return r->strings[*id - 1];
+}
+
+static const char *get_delta(cursor_t *c, char **prev, size_t *prev_len) {
+    uint64_t keep = get_varint(c);
+    uint64_t v = get_varint(c);
+    if (v == 0) {
+        if (keep != 0) {
+            c->bad = 1;
+        }
+        return NULL;
+    }
+    const char *tail = get_text(c, v - 1);
+    if (!tail || keep > *prev_len) {
+        c->bad = 1;
+        return NULL;
+    }
+    if (history_store(prev, prev_len, *prev ? *prev : "", (size_t)keep,
+                      tail, (size_t)(v - 1)) != 0) {
+        c->bad = 1;
+        return NULL;
+    }
+    return *prev;
+}
+
+static int add_string(binary_reader_t *r, cursor_t *c) {
+    uint64_t id = get_varint(c);
+    if (c->bad || id != (uint64_t)r->string_count + 1) {
+        return -1;
+    }
+    if (r->string_count == r->string_cap) {
+        uint32_t cap = r->string_cap ? r->string_cap * 2 : 256;
+        char **strings = (char **)ARC_REALLOC(r->strings, cap * sizeof(char *));
+        if (!strings) {
+            return -1;
+        }
+        r->strings = strings;
+        r->string_cap = cap;
+    }
+    size_t len = (size_t)(c->end - c->p);
+    char *s = (char *)ARC_MALLOC(len + 1);
+    if (!s) {
+        return -1;
+    }
+    memcpy(s, c->p, len);
+    s[len] = '\0';
+    r->strings[r->string_count++] = s;
+    return 0;
+}
+
+static int decode_event(binary_reader_t *r, cursor_t *c,
+                        ac_trace_handler_t handler, void *user_data) {
+    ac_trace_event_t event;
+    arena_tag_stats_t tags[ARENA_TAG_MAX];
+    uint32_t id;
+
+    memset(&event, 0, sizeof(event));
+    uint8_t type = get_u8(c);
+    event.type = (ac_trace_event_type_t)type;
+    r->last_ts += (uint64_t)get_zz(c);
+    event.timestamp_ms = r->last_ts;
+    event.sequence = get_int(c);
+    if (r->version >= 2) {
+        event.thread_id = (uint32_t)get_varint(c);
+    }
+    event.trace_id = get_sym(r, c, &id);
+    uint32_t agent;
+    event.agent_name = get_sym(r, c, &agent);
+
+    switch (event.type) {
+        case AC_TRACE_AGENT_START: {
+            ac_trace_agent_start_t *d = &event.data.agent_start;
+            d->message = get_str(c);
+            d->instructions = get_sym(r, c, &id);
+            d->max_iterations = get_int(c);
+            d->tool_count = (size_t)get_varint(c);
+            break;
+        }
+        case AC_TRACE_AGENT_END: {
+            ac_trace_agent_end_t *d = &event.data.agent_end;
+            d->content = get_str(c);
+            d->iterations = get_int(c);
+            d->total_prompt_tokens = get_int(c);
+            d->total_completion_tokens = get_int(c);
+            d->duration_ms = get_varint(c);
+            break;
+        }
+        case AC_TRACE_ITER_START:
+        case AC_TRACE_ITER_END:
+            event.data.iter.iteration = get_int(c);
+            event.data.iter.max_iterations = get_int(c);
+            break;
+        case AC_TRACE_LLM_REQUEST: {
+            ac_trace_llm_request_t *d = &event.data.llm_request;
+            d->model = get_sym(r, c, &id);
+            d->message_count = (size_t)get_varint(c);
+            d->message_offset = (size_t)get_varint(c);
+            history_slot_t *slot = history_slot(&r->history, agent);
+            d->messages_json = get_delta(c, &slot->messages, &slot->messages_len);
+            d->tools_json = get_delta(c, &slot->tools, &slot->tools_len);
+            if (r->version >= 4) {
+                d->max_tokens = get_int(c);
+                d->thinking_budget = get_int(c);
+                d->budget_reason = get_int(c);
+            }
+            break;
+        }
+        case AC_TRACE_LLM_RESPONSE: {
+            ac_trace_llm_response_t *d = &event.data.llm_response;
+            d->content = get_str(c);
+            d->tool_calls_json = get_str(c);
+            d->tool_call_count = get_int(c);
+            d->prompt_tokens = get_int(c);
+            d->completion_tokens = get_int(c);
+            d->total_tokens = get_int(c);
+            d->finish_reason = get_sym(r, c, &id);
+            d->duration_ms = get_varint(c);
+            d->ratelimit_wait_ms = (uint32_t)get_varint(c);
+            d->draft = get_int(c);
+            d->timing.connect_ms = (uint32_t)get_varint(c);
+            d->timing.ttfb_ms = (uint32_t)get_varint(c);
+            d->timing.first_token_ms = (uint32_t)get_varint(c);
+            d->timing.stream_ms = (uint32_t)get_varint(c);
+            d->timing.max_gap_ms = (uint32_t)get_varint(c);
+            d->timing.deltas = (uint32_t)get_varint(c);
+            if (c->end - c->p < 4) {
+                c->bad = 1;
+                break;
+            }
+            uint32_t bits = get_le32(c->p);
+            c->p += 4;
+            memcpy(&d->timing.tokens_per_sec, &bits, sizeof(bits));
+            if (r->version >= 2) {
+                d->timing.pool_wait_ms = (uint32_t)get_varint(c);
+            }
+            if (r->version >= 4) {
+                d->thinking_tokens = get_int(c);
+            }
+            break;
+        }
+        case AC_TRACE_TOOL_START: {
+            ac_trace_tool_start_t *d = &event.data.tool_start;
+            d->id = get_str(c);
+            d->name = get_sym(r, c, &id);
+            d->arguments = get_str(c);
+            break;
+        }
+        case AC_TRACE_TOOL_END: {
+            ac_trace_tool_end_t *d = &event.data.tool_end;
+            d->id = get_str(c);
+            d->name = get_sym(r, c, &id);
+            d->result = get_str(c);
+            d->duration_ms = get_varint(c);
+            d->success = get_int(c);
+            d->cache_status = get_int(c);
+            d->cache_hits = get_varint(c);
+            d->cache_misses = get_varint(c);
+            if (r->version >= 3) {
+                d->processes = get_varint(c);
+                d->cpu_usec = get_varint(c);
+                d->memory_peak = get_varint(c);
+                d->io_read_bytes = get_varint(c);
+                d->io_write_bytes = get_varint(c);
+            }
+            break;
+        }
+        case AC_TRACE_MCP_CONNECTION: {
+            ac_trace_mcp_connection_t *d = &event.data.mcp_connection;
+            d->server_url = get_sym(r, c, &id);
+            d->event = get_int(c);
+            d->attempt = get_int(c);
+            d->delay_ms = (uint32_t)get_varint(c);
+            d->downtime_ms = get_varint(c);
+            d->resumed = get_int(c);
+            d->error = get_str(c);
+            break;
+        }
+        case AC_TRACE_ARENA: {
+            ac_trace_arena_t *d = &event.data.arena;
+            d->total_capacity = (size_t)get_varint(c);
+            d->total_allocated = (size_t)get_varint(c);
+            d->peak_allocated = (size_t)get_varint(c);
+            d->wasted_tail = (size_t)get_varint(c);
+            memset(tags, 0, sizeof(tags));
+            uint64_t mask = get_varint(c);
+            for (int t = 0; t < ARENA_TAG_MAX; t++) {
+                if (mask & (1u << t)) {
+                    tags[t].bytes = (size_t)get_varint(c);
+                    tags[t].count = (size_t)get_varint(c);
+                }
+            }
+            d->tags = tags;
+            break;
+        }
+        default:
+            /* A type from a newer writer: skipped, it carries no state */
+            return c->bad ? -1 : 0;
+    }
+
+    if (c->bad) {
+        return -1;
+    }
+    handler(&event, user_data);
+    return 0;
+}
+
+static int decode_frame(binary_reader_t *r, const uint8_t *data, size_t len,
+                        ac_trace_handler_t handler, void *user_data) {
+    cursor_t frame = { data, data + len, 0 };
+
+    while (frame.p < frame.end) {
+        uint64_t rec_len = get_varint(&frame);
+        if (frame.bad || rec_len > (uint64_t)(frame.end - frame.p)) {
+            return -1;
+        }
+        cursor_t rec = { frame.p, frame.p + rec_len, 0 };
+        frame.p += rec_len;
+
+        uint8_t kind = get_u8(&rec);
+        if (rec.bad) {
+            return -1;
+        }
+        if (kind == ARCT_REC_STRING) {
+            if (add_string(r, &rec) != 0) {
+                return -1;
+            }
+        } else if (kind == ARCT_REC_EVENT) {
+            if (decode_event(r, &rec, handler, user_data) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+arc_err_t ac_trace_binary_replay(const char *path, ac_trace_handler_t handler, void *user_data) {
+    if (!path || !handler) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return ARC_ERR_IO;
+    }
+
+    uint8_t header[ARCT_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) ||
+        memcmp(header, ARCT_MAGIC, 4) != 0 || header[4] == 0 || header[4] > ARCT_VERSION) {
+        fclose(f);
+        return ARC_ERR_PARSE;
+    }
+
+    binary_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.version = header[4];
+    uint8_t *stored = NULL;
+    size_t stored_cap = 0;
+#ifdef ARC_HAVE_ZLIB
+    uint8_t *raw = NULL;
+    size_t raw_cap = 0;
+#endif
+    arc_err_t err = ARC_OK;
+
+    for (;;) {
+        uint8_t fh[ARCT_FRAME_HEADER];
+        if (fread(fh, 1, sizeof(fh), f) != sizeof(fh)) {
+            break;
+        }
+        uint32_t raw_len = get_le32(fh);
+        uint32_t stored_len = get_le32(fh + 4);
+        uint8_t codec = fh[8];
+        if (raw_len > ARCT_MAX_FRAME || stored_len > ARCT_MAX_FRAME ||
+            (codec == ARCT_CODEC_RAW && raw_len != stored_len)) {
+            err = ARC_ERR_PARSE;
+            break;
+        }
+
+        if (stored_len > stored_cap) {
+            uint8_t *p = (uint8_t *)ARC_REALLOC(stored, stored_len);
+            if (!p) {
+                err = ARC_ERR_NO_MEMORY;
+                break;
+            }
+            stored = p;
+            stored_cap = stored_len;
+        }
+        if (fread(stored, 1, stored_len, f) != stored_len) {
+            break;
+        }
+
+        const uint8_t *data = stored;
+        if (codec == ARCT_CODEC_DEFLATE) {
+#ifdef ARC_HAVE_ZLIB
+            if (raw_len > raw_cap) {
+                uint8_t *p = (uint8_t *)ARC_REALLOC(raw, raw_len);
+                if (!p) {
+                    err = ARC_ERR_NO_MEMORY;
+                    break;
+                }
+                raw = p;
+                raw_cap = raw_len;
+            }
+            uLongf out_len = raw_len;
+            if (uncompress(raw, &out_len, stored, stored_len) != Z_OK || out_len != raw_len) {
+                err = ARC_ERR_PARSE;
+                break;
+            }
+            data = raw;
+#else
+            err = ARC_ERR_NOT_IMPLEMENTED;
+            break;
+#endif
+        } else if (codec != ARCT_CODEC_RAW) {
+            err = ARC_ERR_PARSE;
+            break;
+        }
+
+        if (decode_frame(&reader, data, raw_len, handler, user_data) != 0) {
+            err = ARC_ERR_PARSE;
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < reader.string_count; i++) {
+        ARC_FREE(reader.strings[i]);
+    }
+    ARC_FREE(reader.strings);
+    history_free(&reader.history);
+    ARC_FREE(stored);
+#ifdef ARC_HAVE_ZLIB
+    ARC_FREE(raw);
+#endif
+    fclose(f);
+    return err;
+}
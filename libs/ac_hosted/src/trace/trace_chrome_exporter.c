@@ -0,0 +1,639 @@
+/**
+ * @file trace_chrome_exporter.c
+ * @brief Chrome trace event (Perfetto) exporter for concurrent agents
+ *
+ * Writes the JSON array form of the trace event format, which viewers
+ * accept without the closing bracket, so a file cut short by a crash
+ * still loads. Two processes hold the tracks:
+ *
+ *   Agents   one track per agent; a run of an agent whose previous run
+ *            is still open gets its own track ("Analyst #2"). Runs,
+ *            iterations, LLM calls split into their waits (rate limit,
+ *            pool, connect, first byte) and the span of each
+ *            iteration's tools.
+ *   Threads  one track per emitting thread (event thread_id): runs,
+ *            iterations, LLM calls and each tool execution, wherever
+ *            the tool ran.
+ *
+ * Flow arrows lead from an LLM response to every tool call it asked for.
+ * Spans are complete (X) events written when they end, from the end
+ * event's timestamp and duration, so they need no matching on replay.
+ */
+
+#include "arc/trace_exporters.h"
+#include "arc/trace.h"
+#include "arc/agent_hooks.h"
+#include "arc/tool.h"
+#include "arc/platform.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define mkdir_p(path) _mkdir(path)
+#define get_pid() _getpid()
+#else
+#include <unistd.h>
+#define mkdir_p(path) mkdir(path, 0755)
+#define get_pid() getpid()
+#endif
+
+/*============================================================================
+ * Static State
+ *============================================================================*/
+
+#define CHROME_PID_AGENTS   1
+#define CHROME_PID_THREADS  2
+#define CHROME_MAX_LANES    256
+#define CHROME_FILE_BUFFER  (64 * 1024)
+
+typedef struct {
+    char *name;                  /**< Agent name */
+    int copy;                    /**< Nth concurrent run of the name (1 = first) */
+    int busy;                    /**< A run is open on this track */
+    uint32_t thread_id;          /**< Thread of the open run */
+    char *model;                 /**< Model of the last request */
+    char *tool_calls;            /**< Last response's tool calls, to place tool events */
+    uint64_t iter_start_us;
+    uint64_t llm_end_us;         /**< Last response: its tools' flows start here */
+    uint64_t tools_start_us;     /**< Tools of the open iteration */
+    uint64_t tools_end_us;
+    int tools;
+} chrome_lane_t;
+
+typedef struct {
+    ac_trace_chrome_config_t config;
+    FILE *file;
+    int to_stdout;
+    char path[512];
+    char file_buffer[CHROME_FILE_BUFFER];
+    int count;                   /**< Events written */
+    uint64_t flows;              /**< Flow ids handed out */
+    chrome_lane_t lanes[CHROME_MAX_LANES];
+    int lane_count;
+    uint32_t *threads;           /**< Thread ids given a track name */
+    size_t thread_count;
+    size_t thread_cap;
+    int initialized;
+} chrome_exporter_state_t;
+
+static chrome_exporter_state_t s_chrome = {0};
+
+/* Sync delivery calls the handler from each agent thread */
+static atomic_flag s_chrome_lock = ATOMIC_FLAG_INIT;
+
+static void chrome_lock(void) {
+    while (atomic_flag_test_and_set_explicit(&s_chrome_lock, memory_order_acquire)) {
+    }
+}
+
+static void chrome_unlock(void) {
+    atomic_flag_clear_explicit(&s_chrome_lock, memory_order_release);
+}
+
+/*============================================================================
+ * Writing
+ *============================================================================*/
+
+static void write_string(FILE *f, const char *s) {
+    if (!s) {
+        fputs("null", f);
+        return;
+    }
+    fputc('"', f);
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        switch (*p) {
+            case '"':  fputs("\\\"", f); break;
+            case '\\': fputs("\\\\", f); break;
+            case '\n': fputs("\\n", f); break;
+            case '\r': fputs("\\r", f); break;
+            case '\t': fputs("\\t", f); break;
+            default:
+                if (*p < 0x20) {
+                    fprintf(f, "\\u%04x", *p);
+                } else {
+                    fputc(*p, f);
+                }
+        }
+    }
+    fputc('"', f);
+}
+
+/**
+ * @brief Start an event up to its args; the caller adds them and end_event()
+ */
+static void begin_event(chrome_exporter_state_t *st, const char *ph, int pid, uint32_t tid,
+                        uint64_t ts_us) {
+    fprintf(st->file, "%s\n{\"ph\":\"%s\",\"pid\":%d,\"tid\":%u,\"ts\":%llu",
+            st->count++ ? "," : "", ph, pid, tid, (unsigned long long)ts_us);
+}
+
+static void end_event(chrome_exporter_state_t *st, const char *name) {
+    fputs(",\"cat\":\"arc\",\"name\":", st->file);
+    write_string(st->file, name);
+    fputs("}", st->file);
+}
+
+/**
+ * @brief Complete event; args is the inside of the args object (or NULL)
+ */
+static void write_slice(chrome_exporter_state_t *st, int pid, uint32_t tid, const char *name,
+                        uint64_t start_us, uint64_t end_us, const char *args) {
+    begin_event(st, "X", pid, tid, start_us);
+    fprintf(st->file, ",\"dur\":%llu",
+            (unsigned long long)(end_us > start_us ? end_us - start_us : 0));
+    if (args && args[0]) {
+        fprintf(st->file, ",\"args\":{%s}", args);
+    }
+    end_event(st, name);
+}
+
+static void write_metadata(chrome_exporter_state_t *st, const char *kind, int pid, uint32_t tid,
+                           const char *key, const char *name, int sort_index) {
+    fprintf(st->file, "%s\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"name\":\"%s\",\"args\":{",
+            st->count++ ? "," : "", pid, tid, kind);
+    if (name) {
+        fprintf(st->file, "\"%s\":", key);
+        write_string(st->file, name);
+    } else {
+        fprintf(st->file, "\"%s\":%d", key, sort_index);
+    }
+    fputs("}}", st->file);
+}
+
+/*============================================================================
+ * Tracks
+ *============================================================================*/
+
+static uint32_t thread_track(chrome_exporter_state_t *st, uint32_t thread_id) {
+    for (size_t i = 0; i < st->thread_count; i++) {
+        if (st->threads[i] == thread_id) {
+            return thread_id;
+        }
+    }
+    if (st->thread_count == st->thread_cap) {
+        size_t cap = st->thread_cap ? st->thread_cap * 2 : 16;
+        uint32_t *threads = (uint32_t *)ARC_REALLOC(st->threads, cap * sizeof(uint32_t));
+        if (!threads) {
+            return thread_id;    /* Unnamed track */
+        }
+        st->threads = threads;
+        st->thread_cap = cap;
+    }
+    st->threads[st->thread_count++] = thread_id;
+
+    char name[32];
+    if (thread_id) {
+        snprintf(name, sizeof(name), "thread %u", thread_id);
+    } else {
+        snprintf(name, sizeof(name), "unknown thread");
+    }
+    write_metadata(st, "thread_name", CHROME_PID_THREADS, thread_id, "name", name, 0);
+    write_metadata(st, "thread_sort_index", CHROME_PID_THREADS, thread_id, "sort_index", NULL,
+                   (int)thread_id);
+    return thread_id;
+}
+
+static uint32_t lane_tid(const chrome_exporter_state_t *st, const chrome_lane_t *lane) {
+    return (uint32_t)(lane - st->lanes) + 1;
+}
+
+static chrome_lane_t *lane_new(chrome_exporter_state_t *st, const char *name) {
+    if (st->lane_count == CHROME_MAX_LANES) {
+        return NULL;
+    }
+    chrome_lane_t *lane = &st->lanes[st->lane_count];
+    lane->name = ARC_STRDUP(name);
+    if (!lane->name) {
+        return NULL;
+    }
+    st->lane_count++;
+
+    for (int i = 0; i < st->lane_count - 1; i++) {
+        if (strcmp(st->lanes[i].name, name) == 0) {
+            lane->copy++;
+        }
+    }
+    lane->copy++;
+
+    char label[160];
+    if (lane->copy > 1) {
+        snprintf(label, sizeof(label), "%s #%d", name, lane->copy);
+    } else {
+        snprintf(label, sizeof(label), "%s", name);
+    }
+    uint32_t tid = lane_tid(st, lane);
+    write_metadata(st, "thread_name", CHROME_PID_AGENTS, tid, "name", label, 0);
+    write_metadata(st, "thread_sort_index", CHROME_PID_AGENTS, tid, "sort_index", NULL, (int)tid);
+    return lane;
+}
+
+/**
+ * @brief Track for a starting run: the first idle one of the agent's
+ */
+static chrome_lane_t *lane_open(chrome_exporter_state_t *st, const char *name,
+                                uint32_t thread_id) {
+    chrome_lane_t *lane = NULL;
+    for (int i = 0; i < st->lane_count && !lane; i++) {
+        if (!st->lanes[i].busy && strcmp(st->lanes[i].name, name) == 0) {
+            lane = &st->lanes[i];
+        }
+    }
+    if (!lane) {
+        lane = lane_new(st, name);
+    }
+    if (lane) {
+        lane->busy = 1;
+        lane->thread_id = thread_id;
+        lane->llm_end_us = 0;
+        lane->tools = 0;
+    }
+    return lane;
+}
+
+/**
+ * @brief Track of an event's run
+ *
+ * Run events come from the run's thread. Tool events may come from
+ * workers, so the call id in the last response counts first for them.
+ */
+static chrome_lane_t *lane_find(chrome_exporter_state_t *st, const ac_trace_event_t *event,
+                                const char *tool_id) {
+    const char *name = event->agent_name ? event->agent_name : "agent";
+    chrome_lane_t *best = NULL;
+    int best_score = -1;
+
+    for (int i = 0; i < st->lane_count; i++) {
+        chrome_lane_t *lane = &st->lanes[i];
+        if (!lane->busy || strcmp(lane->name, name) != 0) {
+            continue;
+        }
+        int score = (lane->thread_id == event->thread_id) +
+                    (tool_id && lane->tool_calls && strstr(lane->tool_calls, tool_id) ? 2 : 0);
+        if (score > best_score) {
+            best = lane;
+            best_score = score;
+        }
+    }
+    /* Tracing began mid-run: open a track for it */
+    return best ? best : lane_open(st, name, event->thread_id);
+}
+
+static void lane_reset(chrome_lane_t *lane) {
+    ARC_FREE(lane->name);
+    ARC_FREE(lane->model);
+    ARC_FREE(lane->tool_calls);
+    memset(lane, 0, sizeof(*lane));
+}
+
+static void replace_string(char **field, const char *value) {
+    ARC_FREE(*field);
+    *field = value ? ARC_STRDUP(value) : NULL;
+}
+
+/*============================================================================
+ * Events
+ *============================================================================*/
+
+static uint64_t ms_to_us(uint64_t ms) {
+    return ms * 1000;
+}
+
+/**
+ * @brief The waits of an LLM call as consecutive slices from its start
+ */
+static void write_llm_phases(chrome_exporter_state_t *st, uint32_t tid,
+                             const ac_trace_llm_response_t *d,
+                             uint64_t start_us, uint64_t end_us) {
+    const ac_llm_timing_t *t = &d->timing;
+    struct {
+        const char *name;
+        uint64_t us;
+    } phases[] = {
+        { "ratelimit wait", ms_to_us(d->ratelimit_wait_ms) },
+        { "pool wait", ms_to_us(t->pool_wait_ms) },
+        { "connect", ms_to_us(t->connect_ms) },
+        { "first byte", ms_to_us(t->ttfb_ms > t->connect_ms ? t->ttfb_ms - t->connect_ms : 0) },
+    };
+
+    uint64_t at = start_us;
+    for (size_t i = 0; i < sizeof(phases) / sizeof(phases[0]); i++) {
+        if (phases[i].us == 0 || at >= end_us) {
+            continue;
+        }
+        uint64_t next = at + phases[i].us < end_us ? at + phases[i].us : end_us;
+        write_slice(st, CHROME_PID_AGENTS, tid, phases[i].name, at, next, NULL);
+        at = next;
+    }
+    /* The body only once the first byte is known to have arrived */
+    if (t->ttfb_ms > 0 && at < end_us) {
+        write_slice(st, CHROME_PID_AGENTS, tid, t->deltas > 0 ? "streaming" : "receiving",
+                    at, end_us, NULL);
+    }
+}
+
+static void chrome_write_event(chrome_exporter_state_t *st, const ac_trace_event_t *event) {
+    if (!st->file) {
+        return;
+    }
+
+    const char *name = event->agent_name ? event->agent_name : "agent";
+    uint64_t ts = ms_to_us(event->timestamp_ms);
+    uint32_t thread = thread_track(st, event->thread_id);
+    char label[192];
+    char args[320];
+
+    switch (event->type) {
+        case AC_TRACE_AGENT_START:
+            lane_open(st, name, event->thread_id);
+            break;
+
+        case AC_TRACE_AGENT_END: {
+            const ac_trace_agent_end_t *d = &event->data.agent_end;
+            chrome_lane_t *lane = lane_find(st, event, NULL);
+            uint64_t start = ts - ms_to_us(d->duration_ms);
+            snprintf(label, sizeof(label), "invoke_agent %s", name);
+            snprintf(args, sizeof(args),
+                     "\"iterations\":%d,\"prompt_tokens\":%d,\"completion_tokens\":%d",
+                     d->iterations, d->total_prompt_tokens, d->total_completion_tokens);
+            write_slice(st, CHROME_PID_THREADS, thread, label, start, ts, args);
+            if (lane) {
+                write_slice(st, CHROME_PID_AGENTS, lane_tid(st, lane), label, start, ts, args);
+                lane->busy = 0;
+            }
+            break;
+        }
+
+        case AC_TRACE_ITER_START: {
+            chrome_lane_t *lane = lane_find(st, event, NULL);
+            if (lane) {
+                lane->iter_start_us = ts;
+                lane->tools = 0;
+            }
+            break;
+        }
+
+        case AC_TRACE_ITER_END: {
+            chrome_lane_t *lane = lane_find(st, event, NULL);
+            if (!lane) {
+                break;
+            }
+            uint32_t tid = lane_tid(st, lane);
+            snprintf(label, sizeof(label), "iteration %d", event->data.iter.iteration);
+            write_slice(st, CHROME_PID_THREADS, thread, label, lane->iter_start_us, ts, NULL);
+            write_slice(st, CHROME_PID_AGENTS, tid, label, lane->iter_start_us, ts, NULL);
+            if (lane->tools > 0) {
+                snprintf(args, sizeof(args), "\"calls\":%d", lane->tools);
+                write_slice(st, CHROME_PID_AGENTS, tid, "tools",
+                            lane->tools_start_us, lane->tools_end_us, args);
+            }
+            break;
+        }
+
+        case AC_TRACE_LLM_REQUEST: {
+            chrome_lane_t *lane = lane_find(st, event, NULL);
+            if (lane) {
+                replace_string(&lane->model, event->data.llm_request.model);
+            }
+            break;
+        }
+
+        case AC_TRACE_LLM_RESPONSE: {
+            const ac_trace_llm_response_t *d = &event->data.llm_response;
+            chrome_lane_t *lane = lane_find(st, event, NULL);
+            uint64_t start = ts - ms_to_us(d->duration_ms);
+            snprintf(label, sizeof(label), "chat %s", lane && lane->model ? lane->model : "");
+            snprintf(args, sizeof(args),
+                     "\"prompt_tokens\":%d,\"completion_tokens\":%d,\"tool_calls\":%d",
+                     d->prompt_tokens, d->completion_tokens, d->tool_call_count);
+            write_slice(st, CHROME_PID_THREADS, thread, label, start, ts, args);
+            if (lane) {
+                uint32_t tid = lane_tid(st, lane);
+                write_slice(st, CHROME_PID_AGENTS, tid, label, start, ts, args);
+                write_llm_phases(st, tid, d, start, ts);
+                lane->llm_end_us = ts;
+                replace_string(&lane->tool_calls, d->tool_calls_json);
+            }
+            break;
+        }
+
+        case AC_TRACE_TOOL_START:
+            /* Drawn when the tool ends */
+            break;
+
+        case AC_TRACE_TOOL_END: {
+            const ac_trace_tool_end_t *d = &event->data.tool_end;
+            chrome_lane_t *lane = lane_find(st, event, d->id);
+            uint64_t start = ts - ms_to_us(d->duration_ms);
+            snprintf(label, sizeof(label), "execute_tool %s", d->name ? d->name : "");
+            int n = snprintf(args, sizeof(args), "\"success\":%s%s",
+                             d->success ? "true" : "false",
+                             d->cache_status == AC_TOOL_CACHE_HIT ? ",\"cache\":\"hit\"" : "");
+            if (d->processes > 0 && n > 0 && (size_t)n < sizeof(args)) {
+                snprintf(args + n, sizeof(args) - (size_t)n,
+                         ",\"processes\":%llu,\"cpu_usec\":%llu,\"memory_peak\":%llu",
+                         (unsigned long long)d->processes, (unsigned long long)d->cpu_usec,
+                         (unsigned long long)d->memory_peak);
+            }
+            write_slice(st, CHROME_PID_THREADS, thread, label, start, ts, args);
+            if (!lane) {
+                break;
+            }
+
+            if (lane->tools++ == 0 || start < lane->tools_start_us) {
+                lane->tools_start_us = start;
+            }
+            if (ts > lane->tools_end_us || lane->tools == 1) {
+                lane->tools_end_us = ts;
+            }
+
+            /* Arrow from the response that asked for it (inside its slice) */
+            if (lane->llm_end_us > 0) {
+                uint64_t id = ++st->flows;
+                begin_event(st, "s", CHROME_PID_AGENTS, lane_tid(st, lane), lane->llm_end_us - 1);
+                fprintf(st->file, ",\"id\":%llu", (unsigned long long)id);
+                end_event(st, "tool_call");
+                begin_event(st, "f", CHROME_PID_THREADS, thread, start);
+                fprintf(st->file, ",\"id\":%llu,\"bp\":\"e\"", (unsigned long long)id);
+                end_event(st, "tool_call");
+            }
+            break;
+        }
+
+        case AC_TRACE_MCP_CONNECTION: {
+            const ac_trace_mcp_connection_t *d = &event->data.mcp_connection;
+            snprintf(label, sizeof(label), "mcp %s",
+                     d->event == AC_MCP_CONN_LOST ? "lost" :
+                     d->event == AC_MCP_CONN_RETRY ? "retry" :
+                     d->event == AC_MCP_CONN_RESTORED ? "restored" : "unknown");
+            begin_event(st, "i", CHROME_PID_THREADS, thread, ts);
+            fputs(",\"s\":\"t\",\"args\":{\"server_url\":", st->file);
+            write_string(st->file, d->server_url);
+            fprintf(st->file, ",\"attempt\":%d}", d->attempt);
+            end_event(st, label);
+            break;
+        }
+
+        case AC_TRACE_ARENA: {
+            chrome_lane_t *lane = lane_find(st, event, NULL);
+            if (!lane) {
+                break;
+            }
+            if (lane->copy > 1) {
+                snprintf(label, sizeof(label), "arena %s #%d", lane->name, lane->copy);
+            } else {
+                snprintf(label, sizeof(label), "arena %s", lane->name);
+            }
+            begin_event(st, "C", CHROME_PID_AGENTS, lane_tid(st, lane), ts);
+            fprintf(st->file, ",\"args\":{\"allocated\":%zu,\"peak\":%zu}",
+                    event->data.arena.total_allocated, event->data.arena.peak_allocated);
+            end_event(st, label);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+static void chrome_trace_handler(const ac_trace_event_t *event, void *user_data) {
+    (void)user_data;
+
+    if (!event) return;
+
+    chrome_lock();
+    chrome_write_event(&s_chrome, event);
+    chrome_unlock();
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+static int ensure_dir(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        return S_ISDIR(st.st_mode) ? 0 : -1;
+    }
+    if (mkdir_p(path) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+static void free_exporter(chrome_exporter_state_t *st) {
+    for (int i = 0; i < st->lane_count; i++) {
+        lane_reset(&st->lanes[i]);
+    }
+    ARC_FREE(st->threads);
+    memset(st, 0, sizeof(*st));
+}
+
+static void close_file(chrome_exporter_state_t *st) {
+    if (!st->file) {
+        return;
+    }
+    fputs("\n]\n", st->file);
+    if (st->to_stdout) {
+        fflush(st->file);
+    } else {
+        fclose(st->file);
+    }
+    st->file = NULL;
+}
+
+int ac_trace_chrome_exporter_init(const ac_trace_chrome_config_t *config) {
+    if (s_chrome.initialized) {
+        ac_trace_chrome_exporter_cleanup();
+    }
+    memset(&s_chrome, 0, sizeof(s_chrome));
+
+    if (config) {
+        s_chrome.config = *config;
+    } else {
+        s_chrome.config.async_queue = AC_TRACE_CHROME_DEFAULT_QUEUE;
+    }
+    if (!s_chrome.config.output_dir) {
+        s_chrome.config.output_dir = AC_TRACE_CHROME_DEFAULT_DIR;
+    }
+
+    if (s_chrome.config.path) {
+        snprintf(s_chrome.path, sizeof(s_chrome.path), "%s", s_chrome.config.path);
+    } else {
+        if (ensure_dir(s_chrome.config.output_dir) != 0) {
+            fprintf(stderr, "[TRACE] Failed to create directory: %s\n",
+                    s_chrome.config.output_dir);
+            return -1;
+        }
+        time_t now = time(NULL);
+        struct tm *tm_info = localtime(&now);
+        snprintf(s_chrome.path, sizeof(s_chrome.path),
+                 "%s/timeline_%04d%02d%02d_%02d%02d%02d_%d.json",
+                 s_chrome.config.output_dir,
+                 tm_info->tm_year + 1900, tm_info->tm_mon + 1, tm_info->tm_mday,
+                 tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec,
+                 (int)get_pid());
+    }
+
+    if (strcmp(s_chrome.path, "-") == 0) {
+        s_chrome.file = stdout;
+        s_chrome.to_stdout = 1;
+    } else {
+        s_chrome.file = fopen(s_chrome.path, "w");
+        if (!s_chrome.file) {
+            fprintf(stderr, "[TRACE] Failed to open %s: %s\n", s_chrome.path, strerror(errno));
+            return -1;
+        }
+        setvbuf(s_chrome.file, s_chrome.file_buffer, _IOFBF, sizeof(s_chrome.file_buffer));
+    }
+
+    fputs("[", s_chrome.file);
+    write_metadata(&s_chrome, "process_name", CHROME_PID_AGENTS, 0, "name", "Agents", 0);
+    write_metadata(&s_chrome, "process_sort_index", CHROME_PID_AGENTS, 0, "sort_index", NULL, 1);
+    write_metadata(&s_chrome, "process_name", CHROME_PID_THREADS, 0, "name", "Threads", 0);
+    write_metadata(&s_chrome, "process_sort_index", CHROME_PID_THREADS, 0, "sort_index", NULL, 2);
+
+    if (s_chrome.config.async_queue > 0) {
+        ac_trace_async_config_t async = { .capacity = s_chrome.config.async_queue };
+        if (ac_trace_enable_async(chrome_trace_handler, NULL, &async) != ARC_OK) {
+            fprintf(stderr, "[TRACE] Failed to start writer thread\n");
+            close_file(&s_chrome);
+            free_exporter(&s_chrome);
+            return -1;
+        }
+    } else {
+        ac_trace_enable(chrome_trace_handler, NULL);
+    }
+
+    s_chrome.initialized = 1;
+    return 0;
+}
+
+void ac_trace_chrome_exporter_write(const ac_trace_event_t *event) {
+    chrome_trace_handler(event, NULL);
+}
+
+void ac_trace_chrome_exporter_cleanup(void) {
+    if (!s_chrome.initialized) {
+        return;
+    }
+
+    /* Writes what is still queued before the file is closed */
+    ac_trace_disable();
+
+    chrome_lock();
+    close_file(&s_chrome);
+    free_exporter(&s_chrome);
+    chrome_unlock();
+}
+
+const char *ac_trace_chrome_exporter_get_path(void) {
+    return s_chrome.initialized && s_chrome.path[0] ? s_chrome.path : NULL;
+}
@@ -5,6 +5,11 @@
 
 #include "arc/trace_exporters.h"
 #include "arc/trace.h"
+#include "arc/agent_hooks.h"
+#include "arc/tool.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,9 +30,13 @@
  * Static State
  *============================================================================*/
 
+/** stdio buffer for the trace file: a request event writes the whole history */
+#define TRACE_FILE_BUFFER_SIZE (64 * 1024)
+
 typedef struct {
     ac_trace_json_config_t config;
     FILE *file;
+    char file_buffer[TRACE_FILE_BUFFER_SIZE];
     char current_path[512];
     char current_trace_id[64];
     int event_count;
@@ -36,6 +45,9 @@ typedef struct {
 
 static json_exporter_state_t s_state = {0};
 
+/* MCP connection events arrive on transport threads; one writer at a time */
+static atomic_flag s_write_lock = ATOMIC_FLAG_INIT;
+
 /*============================================================================
  * Helper Functions
  *============================================================================*/
@@ -66,9 +78,9 @@ static void format_iso_timestamp(uint64_t ts_ms, char *buf, size_t size) {
              ms);
 }
 
-static void format_file_timestamp(char *buf, size_t size) {
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
+static void format_file_timestamp(uint64_t ts_ms, char *buf, size_t size) {
+    time_t secs = (time_t)(ts_ms / 1000);
+    struct tm *tm_info = localtime(&secs);
 
     snprintf(buf, size, "%04d%02d%02d_%02d%02d%02d",
              tm_info->tm_year + 1900,
@@ -79,27 +91,78 @@ static void format_file_timestamp(char *buf, size_t size) {
              tm_info->tm_sec);
 }
 
+/**
+ * @brief Escape for each byte: 0 = copy, 'u' = \u00XX, else the letter after '\'
+ */
+static const char k_json_escape[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    ['"'] = '"',
+    ['\\'] = '\\',
+};
+
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+
+/**
+ * @brief Nonzero if any byte of the word needs escaping
+ *
+ * Zero-byte tests on (v ^ c) find '"' and '\\'; (v - 0x20..) & ~v finds
+ * control bytes. Borrows can flag a safe byte after a real match; the
+ * byte loop sorts that out.
+ */
+static inline uint64_t swar_needs_escape(uint64_t v) {
+    uint64_t quote = v ^ (SWAR_ONES * '"');
+    uint64_t bslash = v ^ (SWAR_ONES * '\\');
+    uint64_t ctrl = (v - SWAR_ONES * 0x20) & ~v;
+    quote = (quote - SWAR_ONES) & ~quote;
+    bslash = (bslash - SWAR_ONES) & ~bslash;
+    return (quote | bslash | ctrl) & SWAR_HIGHS;
+}
+
+/**
+ * @brief Write a quoted, escaped string, copying runs of safe bytes in bulk
+ */
 static void write_json_string(FILE *f, const char *str) {
     if (!str) {
-        fprintf(f, "null");
+        fputs("null", f);
         return;
     }
 
+    const unsigned char *p = (const unsigned char *)str;
+    const unsigned char *end = p + strlen(str);
+    const unsigned char *run = p;
+
     fputc('"', f);
-    for (const char *p = str; *p; p++) {
-        switch (*p) {
-            case '"':  fputs("\\\"", f); break;
-            case '\\': fputs("\\\\", f); break;
-            case '\n': fputs("\\n", f); break;
-            case '\r': fputs("\\r", f); break;
-            case '\t': fputs("\\t", f); break;
-            default:
-                if ((unsigned char)*p < 0x20) {
-                    fprintf(f, "\\u%04x", (unsigned char)*p);
-                } else {
-                    fputc(*p, f);
-                }
+    while (p < end) {
+        /* Skip eight safe bytes at a time, then finish byte by byte */
+        uint64_t word;
+        while (end - p >= (ptrdiff_t)sizeof(word)) {
+            memcpy(&word, p, sizeof(word));
+            if (swar_needs_escape(word)) {
+                break;
+            }
+            p += sizeof(word);
         }
+        while (p < end && !k_json_escape[*p]) {
+            p++;
+        }
+
+        if (p > run) {
+            fwrite(run, 1, (size_t)(p - run), f);
+        }
+        if (p == end) {
+            break;
+        }
+
+        char esc = k_json_escape[*p];
+        if (esc == 'u') {
+            fprintf(f, "\\u%04x", *p);
+        } else {
+            char pair[2] = { '\\', esc };
+            fwrite(pair, 1, sizeof(pair), f);
+        }
+        run = ++p;
     }
     fputc('"', f);
 }
@@ -191,6 +254,12 @@ static void write_llm_request(FILE *f, const ac_trace_llm_request_t *data, int p
     fprintf(f, "\"message_count\": %zu,", data->message_count);
     write_newline(f, pretty);
 
+    if (data->message_offset > 0) {
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"message_offset\": %zu,", data->message_offset);
+        write_newline(f, pretty);
+    }
+
     write_indent(f, indent, pretty);
     fputs("\"messages\": ", f);
     if (data->messages_json) {
@@ -208,6 +277,24 @@ static void write_llm_request(FILE *f, const ac_trace_llm_request_t *data, int p
     } else {
         fputs("null", f);
     }
+    if (data->max_tokens > 0 || data->thinking_budget > 0) {
+        fputs(",", f);
+        write_newline(f, pretty);
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"max_tokens\": %d,", data->max_tokens);
+        write_newline(f, pretty);
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"thinking_budget\": %d", data->thinking_budget);
+    }
+    if (data->budget_reason > 0) {
+        static const char *const reasons[] = { "fixed", "open", "tool_result", "escalated", "slo" };
+        fputs(",", f);
+        write_newline(f, pretty);
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"budget\": \"%s\"",
+                data->budget_reason < (int)(sizeof(reasons) / sizeof(reasons[0])) ?
+                reasons[data->budget_reason] : "unknown");
+    }
 }
 
 static void write_llm_response(FILE *f, const ac_trace_llm_response_t *data, int pretty) {
@@ -253,6 +340,44 @@ static void write_llm_response(FILE *f, const ac_trace_llm_response_t *data, int
 
     write_indent(f, indent, pretty);
     fprintf(f, "\"duration_ms\": %llu", (unsigned long long)data->duration_ms);
+    if (data->ratelimit_wait_ms > 0) {
+        fputs(",", f);
+        write_newline(f, pretty);
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"ratelimit_wait_ms\": %u", data->ratelimit_wait_ms);
+    }
+    if (data->draft > 0) {
+        static const char *const decisions[] = { "none", "accepted", "declined", "rejected", "failed" };
+        fputs(",", f);
+        write_newline(f, pretty);
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"draft\": \"%s\"",
+                data->draft < (int)(sizeof(decisions) / sizeof(decisions[0])) ?
+                decisions[data->draft] : "unknown");
+    }
+    if (data->thinking_tokens > 0) {
+        fputs(",", f);
+        write_newline(f, pretty);
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"thinking_tokens\": %d", data->thinking_tokens);
+    }
+    const ac_llm_timing_t *t = &data->timing;
+    if (t->ttfb_ms > 0 || t->deltas > 0) {
+        fputs(",", f);
+        write_newline(f, pretty);
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"timing\": {\"connect_ms\": %u, \"ttfb_ms\": %u", t->connect_ms, t->ttfb_ms);
+        if (t->deltas > 0) {
+            fprintf(f, ", \"first_token_ms\": %u, \"stream_ms\": %u, \"max_gap_ms\": %u, "
+                    "\"deltas\": %u, \"tokens_per_sec\": %.1f",
+                    t->first_token_ms, t->stream_ms, t->max_gap_ms, t->deltas,
+                    (double)t->tokens_per_sec);
+        }
+        if (t->pool_wait_ms > 0) {
+            fprintf(f, ", \"pool_wait_ms\": %u", t->pool_wait_ms);
+        }
+        fputs("}", f);
+    }
 }
 
 static void write_tool_start(FILE *f, const ac_trace_tool_start_t *data, int pretty) {
@@ -310,17 +435,134 @@ static void write_tool_end(FILE *f, const ac_trace_tool_end_t *data, int pretty)
 
     write_indent(f, indent, pretty);
     fprintf(f, "\"success\": %s", data->success ? "true" : "false");
+
+    if (data->cache_status != AC_TOOL_CACHE_NONE) {
+        fputs(",", f);
+        write_newline(f, pretty);
+
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"cache\": \"%s\",",
+                data->cache_status == AC_TOOL_CACHE_HIT ? "hit" : "miss");
+        write_newline(f, pretty);
+
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"cache_hits\": %llu,", (unsigned long long)data->cache_hits);
+        write_newline(f, pretty);
+
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"cache_misses\": %llu", (unsigned long long)data->cache_misses);
+    }
+
+    if (data->processes > 0) {
+        fputs(",", f);
+        write_newline(f, pretty);
+
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"usage\": {\"processes\": %llu, \"cpu_usec\": %llu, "
+                   "\"memory_peak\": %llu, \"io_read_bytes\": %llu, \"io_write_bytes\": %llu}",
+                (unsigned long long)data->processes, (unsigned long long)data->cpu_usec,
+                (unsigned long long)data->memory_peak, (unsigned long long)data->io_read_bytes,
+                (unsigned long long)data->io_write_bytes);
+    }
+}
+
+static const char *mcp_conn_event_name(int event) {
+    switch (event) {
+        case AC_MCP_CONN_LOST:     return "lost";
+        case AC_MCP_CONN_RETRY:    return "retry";
+        case AC_MCP_CONN_RESTORED: return "restored";
+        default:                   return "unknown";
+    }
+}
+
+static void write_mcp_connection(FILE *f, const ac_trace_mcp_connection_t *data, int pretty) {
+    int indent = pretty ? 4 : 0;
+
+    write_indent(f, indent, pretty);
+    fputs("\"server_url\": ", f);
+    write_json_string(f, data->server_url);
+    fputs(",", f);
+    write_newline(f, pretty);
+
+    write_indent(f, indent, pretty);
+    fprintf(f, "\"event\": \"%s\",", mcp_conn_event_name(data->event));
+    write_newline(f, pretty);
+
+    write_indent(f, indent, pretty);
+    fprintf(f, "\"attempt\": %d,", data->attempt);
+    write_newline(f, pretty);
+
+    if (data->event == AC_MCP_CONN_RESTORED) {
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"downtime_ms\": %llu,", (unsigned long long)data->downtime_ms);
+        write_newline(f, pretty);
+
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"resumed\": %s", data->resumed ? "true" : "false");
+    } else {
+        write_indent(f, indent, pretty);
+        fprintf(f, "\"delay_ms\": %u,", (unsigned)data->delay_ms);
+        write_newline(f, pretty);
+
+        write_indent(f, indent, pretty);
+        fputs("\"error\": ", f);
+        write_json_string(f, data->error);
+    }
+}
+
+static void write_arena(FILE *f, const ac_trace_arena_t *data, int pretty) {
+    int indent = pretty ? 4 : 0;
+
+    write_indent(f, indent, pretty);
+    fprintf(f, "\"total_capacity\": %zu,", data->total_capacity);
+    write_newline(f, pretty);
+
+    write_indent(f, indent, pretty);
+    fprintf(f, "\"total_allocated\": %zu,", data->total_allocated);
+    write_newline(f, pretty);
+
+    write_indent(f, indent, pretty);
+    fprintf(f, "\"peak_allocated\": %zu,", data->peak_allocated);
+    write_newline(f, pretty);
+
+    write_indent(f, indent, pretty);
+    fprintf(f, "\"wasted_tail\": %zu,", data->wasted_tail);
+    write_newline(f, pretty);
+
+    /* Tags that saw no allocations are omitted */
+    write_indent(f, indent, pretty);
+    fputs("\"tags\": {", f);
+    int first = 1;
+    for (int t = 0; data->tags && t < ARENA_TAG_MAX; t++) {
+        if (data->tags[t].count == 0) {
+            continue;
+        }
+        if (!first) {
+            fputs(",", f);
+        }
+        first = 0;
+        write_newline(f, pretty);
+        write_indent(f, indent + 2, pretty);
+        if (t >= ARENA_TAG_USER) {
+            fprintf(f, "\"user_%d\": ", t - ARENA_TAG_USER);
+        } else {
+            fprintf(f, "\"%s\": ", arena_tag_name(t));
+        }
+        fprintf(f, "{\"bytes\": %zu, \"count\": %zu}",
+                data->tags[t].bytes, data->tags[t].count);
+    }
+    if (!first) {
+        write_newline(f, pretty);
+        write_indent(f, indent, pretty);
+    }
+    fputs("}", f);
 }
 
 /*============================================================================
  * Trace Handler
  *============================================================================*/
 
-static void json_trace_handler(const ac_trace_event_t *event, void *user_data) {
-    (void)user_data;
-
-    if (!event) return;
-
+static void json_write_event(const ac_trace_event_t *event) {
     json_exporter_state_t *state = &s_state;
     int pretty = state->config.pretty_print;
 
@@ -338,7 +580,7 @@ static void json_trace_handler(const ac_trace_event_t *event, void *user_data) {
         }
 
         char ts_buf[32];
-        format_file_timestamp(ts_buf, sizeof(ts_buf));
+        format_file_timestamp(event->timestamp_ms, ts_buf, sizeof(ts_buf));
 
         const char *agent_name = event->agent_name ? event->agent_name : "agent";
         snprintf(state->current_path, sizeof(state->current_path),
@@ -347,6 +589,17 @@ static void json_trace_handler(const ac_trace_event_t *event, void *user_data) {
                  agent_name,
                  ts_buf);
 
+        /* Runs started within the same second get a counter suffix */
+        struct stat st;
+        for (int n = 2; stat(state->current_path, &st) == 0 && n < 1000; n++) {
+            snprintf(state->current_path, sizeof(state->current_path),
+                     "%s/%s_%s_%d.json",
+                     state->config.output_dir,
+                     agent_name,
+                     ts_buf,
+                     n);
+        }
+
         snprintf(state->current_trace_id, sizeof(state->current_trace_id),
                  "%s", event->trace_id ? event->trace_id : "");
 
@@ -356,6 +609,7 @@ static void json_trace_handler(const ac_trace_event_t *event, void *user_data) {
                     state->current_path, strerror(errno));
             return;
         }
+        setvbuf(state->file, state->file_buffer, _IOFBF, sizeof(state->file_buffer));
 
         state->event_count = 0;
 
@@ -451,6 +705,12 @@ static void json_trace_handler(const ac_trace_event_t *event, void *user_data) {
         case AC_TRACE_TOOL_END:
             write_tool_end(state->file, &event->data.tool_end, pretty);
             break;
+        case AC_TRACE_MCP_CONNECTION:
+            write_mcp_connection(state->file, &event->data.mcp_connection, pretty);
+            break;
+        case AC_TRACE_ARENA:
+            write_arena(state->file, &event->data.arena, pretty);
+            break;
     }
 
     write_newline(state->file, pretty);
@@ -475,11 +735,26 @@ static void json_trace_handler(const ac_trace_event_t *event, void *user_data) {
     }
 }
 
+static void json_trace_handler(const ac_trace_event_t *event, void *user_data) {
+    (void)user_data;
+
+    if (!event) return;
+
+    while (atomic_flag_test_and_set_explicit(&s_write_lock, memory_order_acquire)) {
+    }
+    json_write_event(event);
+    atomic_flag_clear_explicit(&s_write_lock, memory_order_release);
+}
+
 /*============================================================================
  * Public API
  *============================================================================*/
 
 int ac_trace_json_exporter_init(const ac_trace_json_config_t *config) {
+    /* An open file still uses the stdio buffer in s_state */
+    if (s_state.file) {
+        ac_trace_json_exporter_cleanup();
+    }
     memset(&s_state, 0, sizeof(s_state));
 
     if (config) {
@@ -492,6 +767,7 @@ int ac_trace_json_exporter_init(const ac_trace_json_config_t *config) {
         s_state.config.pretty_print = AC_TRACE_JSON_DEFAULT_PRETTY;
         s_state.config.include_timestamps = AC_TRACE_JSON_DEFAULT_TIMESTAMPS;
         s_state.config.flush_after_event = AC_TRACE_JSON_DEFAULT_FLUSH;
+        s_state.config.async_queue = AC_TRACE_JSON_DEFAULT_QUEUE;
     }
 
     if (ensure_dir(s_state.config.output_dir) != 0) {
@@ -501,7 +777,15 @@ int ac_trace_json_exporter_init(const ac_trace_json_config_t *config) {
     }
 
     /* Enable tracing with our handler */
-    ac_trace_enable(json_trace_handler, NULL);
+    if (s_state.config.async_queue > 0) {
+        ac_trace_async_config_t async = { .capacity = s_state.config.async_queue };
+        if (ac_trace_enable_async(json_trace_handler, NULL, &async) != ARC_OK) {
+            fprintf(stderr, "[TRACE] Failed to start writer thread\n");
+            return -1;
+        }
+    } else {
+        ac_trace_enable(json_trace_handler, NULL);
+    }
 
     s_state.initialized = 1;
 
@@ -509,6 +793,9 @@ int ac_trace_json_exporter_init(const ac_trace_json_config_t *config) {
 }
 
 void ac_trace_json_exporter_cleanup(void) {
+    /* Writes what is still queued before the file is closed */
+    ac_trace_disable();
+
     if (s_state.file) {
         int pretty = s_state.config.pretty_print;
         write_newline(s_state.file, pretty);
@@ -521,8 +808,6 @@ void ac_trace_json_exporter_cleanup(void) {
         s_state.file = NULL;
     }
 
-    ac_trace_disable();
-
     memset(&s_state, 0, sizeof(s_state));
 }
 
@@ -533,6 +818,12 @@ const char *ac_trace_json_exporter_get_path(void) {
     return NULL;
 }
 
+void ac_trace_json_exporter_write(const ac_trace_event_t *event) {
+    if (s_state.initialized) {
+        json_trace_handler(event, NULL);
+    }
+}
+
 /*============================================================================
  * Console Exporter
  *============================================================================*/
@@ -562,6 +853,10 @@ static const char *get_event_color(ac_trace_event_type_t type) {
         case AC_TRACE_TOOL_START:
         case AC_TRACE_TOOL_END:
             return ANSI_MAGENTA;
+        case AC_TRACE_MCP_CONNECTION:
+            return ANSI_YELLOW;
+        case AC_TRACE_ARENA:
+            return ANSI_DIM;
         default:
             return "";
     }
@@ -631,11 +926,35 @@ static void console_trace_handler(const ac_trace_event_t *event, void *user_data
             break;
 
         case AC_TRACE_TOOL_END:
-            fprintf(stderr, "%s -> %.60s%s (%llums)",
+            fprintf(stderr, "%s -> %.60s%s (%llums%s)",
                     event->data.tool_end.name ? event->data.tool_end.name : "?",
                     event->data.tool_end.result ? event->data.tool_end.result : "null",
                     (event->data.tool_end.result && strlen(event->data.tool_end.result) > 60) ? "..." : "",
-                    (unsigned long long)event->data.tool_end.duration_ms);
+                    (unsigned long long)event->data.tool_end.duration_ms,
+                    event->data.tool_end.cache_status == AC_TOOL_CACHE_HIT ? ", cached" : "");
+            break;
+
+        case AC_TRACE_MCP_CONNECTION:
+            if (event->data.mcp_connection.event == AC_MCP_CONN_RESTORED) {
+                fprintf(stderr, "%s restored after %llums (%s)",
+                        event->data.mcp_connection.server_url ? event->data.mcp_connection.server_url : "?",
+                        (unsigned long long)event->data.mcp_connection.downtime_ms,
+                        event->data.mcp_connection.resumed ? "resumed" : "new session");
+            } else {
+                fprintf(stderr, "%s %s, retry in %ums: %s",
+                        event->data.mcp_connection.server_url ? event->data.mcp_connection.server_url : "?",
+                        mcp_conn_event_name(event->data.mcp_connection.event),
+                        (unsigned)event->data.mcp_connection.delay_ms,
+                        event->data.mcp_connection.error ? event->data.mcp_connection.error : "");
+            }
+            break;
+
+        case AC_TRACE_ARENA:
+            fprintf(stderr, "%zuKB used, peak %zuKB of %zuKB, %zuB wasted",
+                    event->data.arena.total_allocated / 1024,
+                    event->data.arena.peak_allocated / 1024,
+                    event->data.arena.total_capacity / 1024,
+                    event->data.arena.wasted_tail);
             break;
     }
 
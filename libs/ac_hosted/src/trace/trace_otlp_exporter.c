@@ -0,0 +1,773 @@
+/**
+ * @file trace_otlp_exporter.c
+ * @brief OTLP/HTTP (JSON) exporter for ArC traces
+ *
+ * Trace events become OpenTelemetry spans:
+ *
+ *   invoke_agent <name>                 AGENT_START .. AGENT_END
+ *     iteration <n>                     ITER_START .. ITER_END
+ *       chat <model>                    LLM_REQUEST .. LLM_RESPONSE
+ *       execute_tool <name>             TOOL_START .. TOOL_END (by call id)
+ *
+ * Finished spans are appended to a pending batch, which is POSTed to
+ * {endpoint}/v1/traces once it holds batch_spans spans or flush_interval_ms
+ * has passed, on a pooled HTTP client when the pool is up. With
+ * async_queue set (default) all of this runs on the trace exporter thread.
+ */
+
+#include "arc/trace_exporters.h"
+#include "arc/trace.h"
+#include "arc/http_pool.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "http_client.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define OTLP_DEFAULT_ENDPOINT     "http://localhost:4318"
+#define OTLP_TRACES_PATH          "/v1/traces"
+#define OTLP_MAX_TOOLS            32       /* Tool calls open at once */
+#define OTLP_MAX_HEADERS          16
+#define OTLP_SPAN_KIND_INTERNAL   1
+#define OTLP_SPAN_KIND_CLIENT     3
+#define OTLP_STATUS_ERROR         2
+
+/*============================================================================
+ * Buffer
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} otlp_buf_t;
+
+static int buf_reserve(otlp_buf_t *b, size_t extra) {
+    if (b->len + extra + 1 <= b->cap) {
+        return 0;
+    }
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + extra + 1) {
+        cap *= 2;
+    }
+    char *data = (char *)ARC_REALLOC(b->data, cap);
+    if (!data) {
+        return -1;
+    }
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+static void buf_append(otlp_buf_t *b, const char *s, size_t n) {
+    if (buf_reserve(b, n) != 0) {
+        return;
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+}
+
+static void buf_puts(otlp_buf_t *b, const char *s) {
+    buf_append(b, s, strlen(s));
+}
+
+static void buf_printf(otlp_buf_t *b, const char *fmt, ...) {
+    char tmp[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        buf_append(b, tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+    }
+}
+
+static void buf_string(otlp_buf_t *b, const char *s) {
+    buf_puts(b, "\"");
+    for (const unsigned char *p = (const unsigned char *)(s ? s : ""); *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            char esc[2] = { '\\', (char)*p };
+            buf_append(b, esc, 2);
+        } else if (*p < 0x20) {
+            buf_printf(b, "\\u%04x", *p);
+        } else {
+            buf_append(b, (const char *)p, 1);
+        }
+    }
+    buf_puts(b, "\"");
+}
+
+static void buf_free(otlp_buf_t *b) {
+    ARC_FREE(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+/*============================================================================
+ * Attributes
+ *============================================================================*/
+
+static void attr_begin(otlp_buf_t *b, const char *key) {
+    if (b->len > 0) {
+        buf_puts(b, ",");
+    }
+    buf_puts(b, "{\"key\":");
+    buf_string(b, key);
+    buf_puts(b, ",\"value\":");
+}
+
+static void attr_str(otlp_buf_t *b, const char *key, const char *value) {
+    if (!value) {
+        return;
+    }
+    attr_begin(b, key);
+    buf_puts(b, "{\"stringValue\":");
+    buf_string(b, value);
+    buf_puts(b, "}}");
+}
+
+/* OTLP/JSON carries 64-bit integers as strings */
+static void attr_int(otlp_buf_t *b, const char *key, int64_t value) {
+    attr_begin(b, key);
+    buf_printf(b, "{\"intValue\":\"%lld\"}}", (long long)value);
+}
+
+static void attr_double(otlp_buf_t *b, const char *key, double value) {
+    attr_begin(b, key);
+    buf_printf(b, "{\"doubleValue\":%.3f}}", value);
+}
+
+static void attr_bool(otlp_buf_t *b, const char *key, int value) {
+    attr_begin(b, key);
+    buf_printf(b, "{\"boolValue\":%s}}", value ? "true" : "false");
+}
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+typedef struct {
+    char id[17];                 /* Hex span id, "" = not open */
+    uint64_t start_ns;
+} otlp_span_t;
+
+typedef struct {
+    otlp_span_t span;
+    char *call_id;
+    char *name;
+} otlp_tool_span_t;
+
+typedef struct {
+    /* Configuration */
+    char *url;
+    char *service_name;
+    arc_http_header_t headers[OTLP_MAX_HEADERS + 1];
+    char *header_data;           /* Backing store of the extra headers */
+    size_t batch_spans;
+    uint32_t flush_interval_ms;
+    uint32_t timeout_ms;
+    int compress;
+
+    /* Current run */
+    char trace_id[33];
+    char *agent_name;
+    char *arc_trace_id;
+    otlp_span_t run;
+    otlp_span_t iter;
+    int iteration;
+    otlp_span_t llm;
+    char *llm_model;
+    size_t llm_message_count;
+    int llm_max_tokens;
+    int llm_thinking_budget;
+    int llm_budget_reason;
+    otlp_tool_span_t tools[OTLP_MAX_TOOLS];
+    otlp_buf_t run_attrs;        /* Arena stats, written when the run ends */
+
+    /* Pending batch */
+    otlp_buf_t spans;
+    size_t span_count;
+    uint64_t last_export_ms;
+    uint64_t rng;
+
+    arc_http_client_t *http;     /* Own client when the pool is not up */
+    uint64_t exported;
+    uint64_t failed;
+    int initialized;
+} otlp_state_t;
+
+static otlp_state_t s_otlp;
+
+/* Sync delivery calls the handler from each agent thread */
+static pthread_mutex_t s_otlp_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*============================================================================
+ * Ids
+ *============================================================================*/
+
+static uint64_t otlp_random(void) {
+    /* splitmix64 */
+    uint64_t z = (s_otlp.rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void span_open(otlp_span_t *span, uint64_t ts_ms) {
+    snprintf(span->id, sizeof(span->id), "%016llx", (unsigned long long)otlp_random());
+    span->start_ns = ts_ms * 1000000ULL;
+}
+
+/*============================================================================
+ * Export
+ *============================================================================*/
+
+static void otlp_export(void) {
+    if (s_otlp.span_count == 0) {
+        return;
+    }
+
+    otlp_buf_t body = {0};
+    buf_puts(&body, "{\"resourceSpans\":[{\"resource\":{\"attributes\":[");
+    otlp_buf_t resource = {0};
+    attr_str(&resource, "service.name", s_otlp.service_name);
+    attr_str(&resource, "telemetry.sdk.name", "arc");
+    attr_str(&resource, "telemetry.sdk.language", "c");
+    if (resource.data) {
+        buf_append(&body, resource.data, resource.len);
+    }
+    buf_free(&resource);
+    buf_puts(&body, "]},\"scopeSpans\":[{\"scope\":{\"name\":\"arc.trace\"},\"spans\":[");
+    buf_append(&body, s_otlp.spans.data, s_otlp.spans.len);
+    buf_puts(&body, "]}]}]}");
+
+    size_t count = s_otlp.span_count;
+    s_otlp.spans.len = 0;
+    s_otlp.span_count = 0;
+    s_otlp.last_export_ms = ac_trace_timestamp_ms();
+
+    if (!body.data) {
+        s_otlp.failed += count;
+        return;
+    }
+
+    arc_http_client_t *http = NULL;
+    int pooled = 0;
+    if (ac_http_pool_is_initialized()) {
+        http = ac_http_pool_acquire(s_otlp.timeout_ms);
+        pooled = http != NULL;
+    }
+    if (!http) {
+        if (!s_otlp.http && arc_http_client_create(NULL, &s_otlp.http) != ARC_OK) {
+            s_otlp.http = NULL;
+        }
+        http = s_otlp.http;
+    }
+
+    arc_err_t err = ARC_ERR_NOT_CONNECTED;
+    arc_http_response_t response = {0};
+    if (http) {
+        arc_http_request_t request = {
+            .url = s_otlp.url,
+            .method = ARC_HTTP_POST,
+            .headers = s_otlp.headers,
+            .body = body.data,
+            .body_len = body.len,
+            .timeout_ms = s_otlp.timeout_ms,
+            .verify_ssl = 1,
+            .compress_body = s_otlp.compress
+        };
+        err = arc_http_request(http, &request, &response);
+    }
+    if (pooled) {
+        ac_http_pool_release(http);
+    }
+
+    if (err == ARC_OK && response.status_code >= 200 && response.status_code < 300) {
+        s_otlp.exported += count;
+    } else {
+        s_otlp.failed += count;
+        AC_LOG_WARN("OTLP export of %zu spans failed (err=%d, status=%d)",
+                    count, err, response.status_code);
+    }
+    arc_http_response_free(&response);
+    buf_free(&body);
+}
+
+/*============================================================================
+ * Spans
+ *============================================================================*/
+
+/**
+ * @brief Append a finished span to the pending batch
+ */
+static void span_finish(otlp_span_t *span, const char *parent_id, const char *name,
+                        int kind, uint64_t end_ms, otlp_buf_t *attrs,
+                        const char *error) {
+    if (!span->id[0]) {
+        return;
+    }
+
+    otlp_buf_t *b = &s_otlp.spans;
+    uint64_t end_ns = end_ms * 1000000ULL;
+    if (end_ns < span->start_ns) {
+        end_ns = span->start_ns;
+    }
+
+    if (s_otlp.span_count > 0) {
+        buf_puts(b, ",");
+    }
+    buf_printf(b, "{\"traceId\":\"%s\",\"spanId\":\"%s\"", s_otlp.trace_id, span->id);
+    if (parent_id && parent_id[0]) {
+        buf_printf(b, ",\"parentSpanId\":\"%s\"", parent_id);
+    }
+    buf_puts(b, ",\"name\":");
+    buf_string(b, name);
+    buf_printf(b, ",\"kind\":%d,\"startTimeUnixNano\":\"%llu\",\"endTimeUnixNano\":\"%llu\"",
+               kind, (unsigned long long)span->start_ns, (unsigned long long)end_ns);
+    buf_puts(b, ",\"attributes\":[");
+    if (attrs && attrs->data) {
+        buf_append(b, attrs->data, attrs->len);
+    }
+    buf_puts(b, "]");
+    if (error) {
+        buf_printf(b, ",\"status\":{\"code\":%d,\"message\":", OTLP_STATUS_ERROR);
+        buf_string(b, error);
+        buf_puts(b, "}");
+    }
+    buf_puts(b, "}");
+    s_otlp.span_count++;
+
+    span->id[0] = '\0';
+}
+
+static const char *parent_of_call(void) {
+    return s_otlp.iter.id[0] ? s_otlp.iter.id : s_otlp.run.id;
+}
+
+static void name_span(char *buf, size_t size, const char *prefix, const char *what) {
+    if (what && what[0]) {
+        snprintf(buf, size, "%s %s", prefix, what);
+    } else {
+        snprintf(buf, size, "%s", prefix);
+    }
+}
+
+static void llm_close(uint64_t end_ms, const ac_trace_llm_response_t *data) {
+    if (!s_otlp.llm.id[0]) {
+        return;
+    }
+
+    otlp_buf_t attrs = {0};
+    attr_str(&attrs, "gen_ai.operation.name", "chat");
+    attr_str(&attrs, "gen_ai.request.model", s_otlp.llm_model);
+    attr_int(&attrs, "arc.message_count", (int64_t)s_otlp.llm_message_count);
+    if (s_otlp.llm_max_tokens > 0) {
+        attr_int(&attrs, "gen_ai.request.max_tokens", s_otlp.llm_max_tokens);
+    }
+    if (s_otlp.llm_thinking_budget > 0) {
+        attr_int(&attrs, "arc.thinking_budget", s_otlp.llm_thinking_budget);
+    }
+    if (s_otlp.llm_budget_reason) {
+        attr_int(&attrs, "arc.budget", s_otlp.llm_budget_reason);
+    }
+    if (data) {
+        attr_int(&attrs, "gen_ai.usage.input_tokens", data->prompt_tokens);
+        attr_int(&attrs, "gen_ai.usage.output_tokens", data->completion_tokens);
+        if (data->finish_reason) {
+            attr_str(&attrs, "gen_ai.response.finish_reasons", data->finish_reason);
+        }
+        attr_int(&attrs, "arc.tool_call_count", data->tool_call_count);
+        attr_int(&attrs, "arc.llm.duration_ms", (int64_t)data->duration_ms);
+        if (data->ratelimit_wait_ms > 0) {
+            attr_int(&attrs, "arc.ratelimit_wait_ms", data->ratelimit_wait_ms);
+        }
+        if (data->draft) {
+            attr_int(&attrs, "arc.draft", data->draft);
+        }
+        if (data->thinking_tokens > 0) {
+            attr_int(&attrs, "arc.thinking_tokens", data->thinking_tokens);
+        }
+        const ac_llm_timing_t *t = &data->timing;
+        if (t->ttfb_ms > 0) {
+            attr_int(&attrs, "arc.llm.connect_ms", t->connect_ms);
+            attr_int(&attrs, "arc.llm.ttfb_ms", t->ttfb_ms);
+        }
+        if (t->pool_wait_ms > 0) {
+            attr_int(&attrs, "arc.llm.pool_wait_ms", t->pool_wait_ms);
+        }
+        if (t->deltas > 0) {
+            attr_int(&attrs, "arc.llm.ttft_ms", t->first_token_ms);
+            attr_int(&attrs, "arc.llm.max_gap_ms", t->max_gap_ms);
+            attr_double(&attrs, "arc.llm.tokens_per_sec", t->tokens_per_sec);
+        }
+    }
+
+    char name[128];
+    name_span(name, sizeof(name), "chat", s_otlp.llm_model);
+    span_finish(&s_otlp.llm, parent_of_call(), name, OTLP_SPAN_KIND_CLIENT, end_ms,
+                &attrs, data ? NULL : "no response");
+    buf_free(&attrs);
+    ARC_FREE(s_otlp.llm_model);
+    s_otlp.llm_model = NULL;
+}
+
+static void tool_close(otlp_tool_span_t *tool, uint64_t end_ms, const ac_trace_tool_end_t *data) {
+    otlp_buf_t attrs = {0};
+    attr_str(&attrs, "gen_ai.operation.name", "execute_tool");
+    attr_str(&attrs, "gen_ai.tool.name", tool->name);
+    attr_str(&attrs, "gen_ai.tool.call.id", tool->call_id);
+    const char *error = "no result";
+    if (data) {
+        attr_int(&attrs, "arc.tool.duration_ms", (int64_t)data->duration_ms);
+        attr_bool(&attrs, "arc.tool.success", data->success);
+        if (data->cache_status) {
+            attr_int(&attrs, "arc.tool.cache_status", data->cache_status);
+        }
+        if (data->processes) {
+            attr_int(&attrs, "arc.tool.processes", (int64_t)data->processes);
+            attr_int(&attrs, "arc.tool.cpu_usec", (int64_t)data->cpu_usec);
+            attr_int(&attrs, "arc.tool.memory_peak", (int64_t)data->memory_peak);
+            attr_int(&attrs, "arc.tool.io_read_bytes", (int64_t)data->io_read_bytes);
+            attr_int(&attrs, "arc.tool.io_write_bytes", (int64_t)data->io_write_bytes);
+        }
+        error = data->success ? NULL : "tool returned an error";
+    }
+
+    char name[128];
+    name_span(name, sizeof(name), "execute_tool", tool->name);
+    span_finish(&tool->span, parent_of_call(), name, OTLP_SPAN_KIND_INTERNAL, end_ms,
+                &attrs, error);
+    buf_free(&attrs);
+    ARC_FREE(tool->call_id);
+    ARC_FREE(tool->name);
+    tool->call_id = NULL;
+    tool->name = NULL;
+}
+
+static void iter_close(uint64_t end_ms) {
+    llm_close(end_ms, NULL);
+    for (size_t i = 0; i < OTLP_MAX_TOOLS; i++) {
+        if (s_otlp.tools[i].span.id[0]) {
+            tool_close(&s_otlp.tools[i], end_ms, NULL);
+        }
+    }
+    if (!s_otlp.iter.id[0]) {
+        return;
+    }
+
+    otlp_buf_t attrs = {0};
+    attr_int(&attrs, "arc.iteration", s_otlp.iteration);
+    char name[64];
+    snprintf(name, sizeof(name), "iteration %d", s_otlp.iteration);
+    span_finish(&s_otlp.iter, s_otlp.run.id, name, OTLP_SPAN_KIND_INTERNAL, end_ms,
+                &attrs, NULL);
+    buf_free(&attrs);
+}
+
+static void run_close(uint64_t end_ms, const ac_trace_agent_end_t *data) {
+    iter_close(end_ms);
+
+    otlp_buf_t attrs = {0};
+    attr_str(&attrs, "gen_ai.operation.name", "invoke_agent");
+    attr_str(&attrs, "gen_ai.agent.name", s_otlp.agent_name);
+    attr_str(&attrs, "arc.trace_id", s_otlp.arc_trace_id);
+    if (data) {
+        attr_int(&attrs, "arc.iterations", data->iterations);
+        attr_int(&attrs, "gen_ai.usage.input_tokens", data->total_prompt_tokens);
+        attr_int(&attrs, "gen_ai.usage.output_tokens", data->total_completion_tokens);
+    }
+    if (s_otlp.run_attrs.data) {
+        buf_puts(&attrs, ",");
+        buf_append(&attrs, s_otlp.run_attrs.data, s_otlp.run_attrs.len);
+    }
+
+    char name[128];
+    name_span(name, sizeof(name), "invoke_agent", s_otlp.agent_name);
+    span_finish(&s_otlp.run, NULL, name, OTLP_SPAN_KIND_INTERNAL, end_ms,
+                &attrs, data ? NULL : "run interrupted");
+    buf_free(&attrs);
+    buf_free(&s_otlp.run_attrs);
+    ARC_FREE(s_otlp.agent_name);
+    ARC_FREE(s_otlp.arc_trace_id);
+    s_otlp.agent_name = NULL;
+    s_otlp.arc_trace_id = NULL;
+}
+
+static otlp_tool_span_t *tool_find(const char *call_id) {
+    for (size_t i = 0; i < OTLP_MAX_TOOLS; i++) {
+        otlp_tool_span_t *tool = &s_otlp.tools[i];
+        if (tool->span.id[0] && tool->call_id && call_id && strcmp(tool->call_id, call_id) == 0) {
+            return tool;
+        }
+    }
+    return NULL;
+}
+
+static otlp_tool_span_t *tool_slot(void) {
+    for (size_t i = 0; i < OTLP_MAX_TOOLS; i++) {
+        if (!s_otlp.tools[i].span.id[0]) {
+            return &s_otlp.tools[i];
+        }
+    }
+    return NULL;
+}
+
+/*============================================================================
+ * Trace Handler
+ *============================================================================*/
+
+static void otlp_trace_handler(const ac_trace_event_t *event, void *user_data) {
+    (void)user_data;
+    uint64_t ts = event->timestamp_ms;
+
+    pthread_mutex_lock(&s_otlp_lock);
+    if (!s_otlp.initialized) {
+        pthread_mutex_unlock(&s_otlp_lock);
+        return;
+    }
+
+    switch (event->type) {
+        case AC_TRACE_AGENT_START:
+            if (s_otlp.run.id[0]) {
+                run_close(ts, NULL);
+            }
+            snprintf(s_otlp.trace_id, sizeof(s_otlp.trace_id), "%016llx%016llx",
+                     (unsigned long long)otlp_random(), (unsigned long long)otlp_random());
+            s_otlp.agent_name = event->agent_name ? ARC_STRDUP(event->agent_name) : NULL;
+            s_otlp.arc_trace_id = event->trace_id ? ARC_STRDUP(event->trace_id) : NULL;
+            span_open(&s_otlp.run, ts);
+            break;
+
+        case AC_TRACE_AGENT_END:
+            run_close(ts, &event->data.agent_end);
+            break;
+
+        case AC_TRACE_ITER_START:
+            iter_close(ts);
+            s_otlp.iteration = event->data.iter.iteration;
+            span_open(&s_otlp.iter, ts);
+            break;
+
+        case AC_TRACE_ITER_END:
+            iter_close(ts);
+            break;
+
+        case AC_TRACE_LLM_REQUEST:
+            llm_close(ts, NULL);
+            s_otlp.llm_model = event->data.llm_request.model ?
+                ARC_STRDUP(event->data.llm_request.model) : NULL;
+            s_otlp.llm_message_count = event->data.llm_request.message_count;
+            s_otlp.llm_max_tokens = event->data.llm_request.max_tokens;
+            s_otlp.llm_thinking_budget = event->data.llm_request.thinking_budget;
+            s_otlp.llm_budget_reason = event->data.llm_request.budget_reason;
+            span_open(&s_otlp.llm, ts);
+            break;
+
+        case AC_TRACE_LLM_RESPONSE:
+            llm_close(ts, &event->data.llm_response);
+            break;
+
+        case AC_TRACE_TOOL_START: {
+            otlp_tool_span_t *tool = tool_slot();
+            if (tool) {
+                tool->call_id = event->data.tool_start.id ? ARC_STRDUP(event->data.tool_start.id) : NULL;
+                tool->name = event->data.tool_start.name ? ARC_STRDUP(event->data.tool_start.name) : NULL;
+                span_open(&tool->span, ts);
+            }
+            break;
+        }
+
+        case AC_TRACE_TOOL_END: {
+            otlp_tool_span_t *tool = tool_find(event->data.tool_end.id);
+            if (tool) {
+                tool_close(tool, ts, &event->data.tool_end);
+            }
+            break;
+        }
+
+        case AC_TRACE_ARENA:
+            s_otlp.run_attrs.len = 0;
+            attr_int(&s_otlp.run_attrs, "arc.arena.peak_allocated",
+                     (int64_t)event->data.arena.peak_allocated);
+            attr_int(&s_otlp.run_attrs, "arc.arena.total_capacity",
+                     (int64_t)event->data.arena.total_capacity);
+            break;
+
+        default:
+            break;
+    }
+
+    if (s_otlp.span_count >= s_otlp.batch_spans ||
+        (s_otlp.span_count > 0 && ts - s_otlp.last_export_ms >= s_otlp.flush_interval_ms)) {
+        otlp_export();
+    }
+    pthread_mutex_unlock(&s_otlp_lock);
+}
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+
+/**
+ * @brief Parse "name=value,name=value" (OTEL_EXPORTER_OTLP_HEADERS format)
+ */
+static void parse_headers(const char *spec) {
+    size_t n = 0;
+    s_otlp.headers[n].name = "Content-Type";
+    s_otlp.headers[n].value = "application/json";
+    n++;
+
+    s_otlp.header_data = spec && spec[0] ? ARC_STRDUP(spec) : NULL;
+    for (char *tok = s_otlp.header_data; tok && *tok && n < OTLP_MAX_HEADERS; ) {
+        char *end = strchr(tok, ',');
+        if (end) {
+            *end = '\0';
+        }
+        char *eq = strchr(tok, '=');
+        if (eq) {
+            *eq = '\0';
+            while (*tok == ' ') {
+                tok++;
+            }
+            s_otlp.headers[n].name = tok;
+            s_otlp.headers[n].value = eq + 1;
+            n++;
+        }
+        tok = end ? end + 1 : NULL;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        s_otlp.headers[i].next = i + 1 < n ? &s_otlp.headers[i + 1] : NULL;
+    }
+}
+
+static char *traces_url(const char *endpoint) {
+    size_t len = strlen(endpoint);
+    while (len > 0 && endpoint[len - 1] == '/') {
+        len--;
+    }
+    size_t path_len = strlen(OTLP_TRACES_PATH);
+    int has_path = len >= path_len && strncmp(endpoint + len - path_len, OTLP_TRACES_PATH, path_len) == 0;
+
+    char *url = (char *)ARC_MALLOC(len + path_len + 1);
+    if (!url) {
+        return NULL;
+    }
+    memcpy(url, endpoint, len);
+    url[len] = '\0';
+    if (!has_path) {
+        strcat(url, OTLP_TRACES_PATH);
+    }
+    return url;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+int ac_trace_otlp_exporter_init(const ac_trace_otlp_config_t *config) {
+    if (s_otlp.initialized) {
+        ac_trace_otlp_exporter_cleanup();
+    }
+
+    ac_trace_otlp_config_t cfg = {
+        .batch_spans = AC_TRACE_OTLP_DEFAULT_BATCH,
+        .flush_interval_ms = AC_TRACE_OTLP_DEFAULT_INTERVAL_MS,
+        .timeout_ms = AC_TRACE_OTLP_DEFAULT_TIMEOUT_MS,
+        .compress = 1,
+        .async_queue = AC_TRACE_OTLP_DEFAULT_QUEUE
+    };
+    if (config) {
+        cfg = *config;
+    }
+
+    const char *endpoint = cfg.endpoint ? cfg.endpoint : getenv("OTEL_EXPORTER_OTLP_ENDPOINT");
+    const char *service = cfg.service_name ? cfg.service_name : getenv("OTEL_SERVICE_NAME");
+    const char *headers = cfg.headers ? cfg.headers : getenv("OTEL_EXPORTER_OTLP_HEADERS");
+
+    pthread_mutex_lock(&s_otlp_lock);
+    memset(&s_otlp, 0, sizeof(s_otlp));
+    s_otlp.url = traces_url(endpoint && endpoint[0] ? endpoint : OTLP_DEFAULT_ENDPOINT);
+    s_otlp.service_name = ARC_STRDUP(service && service[0] ? service : "arc");
+    parse_headers(headers);
+    s_otlp.batch_spans = cfg.batch_spans > 0 ? cfg.batch_spans : AC_TRACE_OTLP_DEFAULT_BATCH;
+    s_otlp.flush_interval_ms = cfg.flush_interval_ms > 0 ?
+        cfg.flush_interval_ms : AC_TRACE_OTLP_DEFAULT_INTERVAL_MS;
+    s_otlp.timeout_ms = cfg.timeout_ms > 0 ? cfg.timeout_ms : AC_TRACE_OTLP_DEFAULT_TIMEOUT_MS;
+    s_otlp.compress = cfg.compress;
+    s_otlp.last_export_ms = ac_trace_timestamp_ms();
+    s_otlp.rng = s_otlp.last_export_ms ^ ((uint64_t)(uintptr_t)&s_otlp << 16);
+    int ok = s_otlp.url && s_otlp.service_name;
+    s_otlp.initialized = ok;
+    pthread_mutex_unlock(&s_otlp_lock);
+
+    if (!ok) {
+        ac_trace_otlp_exporter_cleanup();
+        return -1;
+    }
+
+    if (cfg.async_queue > 0) {
+        ac_trace_async_config_t async = { .capacity = cfg.async_queue };
+        if (ac_trace_enable_async(otlp_trace_handler, NULL, &async) != ARC_OK) {
+            AC_LOG_ERROR("OTLP exporter: failed to start the trace exporter thread");
+            ac_trace_otlp_exporter_cleanup();
+            return -1;
+        }
+    } else {
+        ac_trace_enable(otlp_trace_handler, NULL);
+    }
+
+    AC_LOG_INFO("OTLP exporter: %s (service=%s)", s_otlp.url, s_otlp.service_name);
+    return 0;
+}
+
+void ac_trace_otlp_exporter_flush(void) {
+    ac_trace_flush(s_otlp.timeout_ms);
+
+    pthread_mutex_lock(&s_otlp_lock);
+    if (s_otlp.initialized) {
+        otlp_export();
+    }
+    pthread_mutex_unlock(&s_otlp_lock);
+}
+
+void ac_trace_otlp_exporter_cleanup(void) {
+    /* Handles what is still queued */
+    if (s_otlp.initialized) {
+        ac_trace_disable();
+    }
+
+    pthread_mutex_lock(&s_otlp_lock);
+    if (s_otlp.run.id[0]) {
+        run_close(ac_trace_timestamp_ms(), NULL);
+    }
+    if (s_otlp.initialized) {
+        otlp_export();
+        AC_LOG_DEBUG("OTLP exporter: %llu spans exported, %llu failed",
+                     (unsigned long long)s_otlp.exported,
+                     (unsigned long long)s_otlp.failed);
+    }
+
+    if (s_otlp.http) {
+        arc_http_client_destroy(s_otlp.http);
+    }
+    buf_free(&s_otlp.spans);
+    buf_free(&s_otlp.run_attrs);
+    ARC_FREE(s_otlp.llm_model);
+    ARC_FREE(s_otlp.agent_name);
+    ARC_FREE(s_otlp.arc_trace_id);
+    ARC_FREE(s_otlp.header_data);
+    ARC_FREE(s_otlp.service_name);
+    ARC_FREE(s_otlp.url);
+    memset(&s_otlp, 0, sizeof(s_otlp));
+    pthread_mutex_unlock(&s_otlp_lock);
+}
@@ -0,0 +1,683 @@
+/**
+ * @file vector_index.c
+ * @brief Brute-force vector index: float32 or int8 rows, mmap-able file
+ *
+ * Ids, per-row scales (int8 only) and rows are three parallel arrays.
+ * The file holds the same arrays after a 64-byte header, with the rows
+ * 64-byte aligned, in the host's byte order:
+ *
+ *   "ARCVEC1\0" | 0x01020304 | storage | normalize | 0 | dims (u64) | count (u64) | 0...
+ *   ids[count] (u64) | scales[count] (f32, int8 only) | 0... | rows
+ *
+ * An opened index points into the mapping until its first change.
+ */
+
+#include <arc/vector_index.h>
+#include <arc/log.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define index_getpid getpid
+#else
+#include <process.h>
+#define index_getpid _getpid
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define VECTOR_X86_AVX2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VECTOR_NEON 1
+#endif
+
+#define INDEX_MAGIC "ARCVEC1"
+#define INDEX_BYTE_ORDER 0x01020304u
+#define INDEX_HEADER_SIZE 64
+#define INDEX_ALIGN 64
+#define INDEX_MIN_CAPACITY 64
+
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t storage;
+    uint32_t normalize;
+    uint32_t reserved;
+    uint64_t dims;
+    uint64_t count;
+} index_header_t;
+
+struct ac_vector_index {
+    size_t dims;
+    ac_vector_storage_t storage;
+    int normalize;
+
+    size_t count;
+    size_t capacity;
+    uint64_t *ids;
+    float *scales;                  /* Row i is rows[i] * scales[i] (int8 only) */
+    void *rows;                     /* count * dims floats or int8s */
+
+    void *map;                      /* Opened file, NULL once copied to memory */
+    size_t map_len;
+};
+
+static size_t row_size(const ac_vector_index_t *index) {
+    return index->dims * (index->storage == AC_VECTOR_I8 ? sizeof(int8_t) : sizeof(float));
+}
+
+static size_t align_up(size_t n) {
+    return (n + INDEX_ALIGN - 1) & ~(size_t)(INDEX_ALIGN - 1);
+}
+
+/** Offset of the rows in a file with count rows */
+static size_t rows_offset(const ac_vector_index_t *index, size_t count) {
+    size_t scales = index->storage == AC_VECTOR_I8 ? count * sizeof(float) : 0;
+    return align_up(INDEX_HEADER_SIZE + count * sizeof(uint64_t) + scales);
+}
+
+/*============================================================================
+ * Dot Products
+ *============================================================================*/
+
+static float dot_f32(const float *a, const float *b, size_t n) {
+    /* Independent sums the compiler can keep in vector registers */
+    float s[8] = {0};
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (int j = 0; j < 8; j++) {
+            s[j] += a[i + j] * b[i + j];
+        }
+    }
+    float sum = ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static float dot_i8(const float *a, const int8_t *b, size_t n) {
+    float s[8] = {0};
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (int j = 0; j < 8; j++) {
+            s[j] += a[i + j] * (float)b[i + j];
+        }
+    }
+    float sum = ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));
+    for (; i < n; i++) {
+        sum += a[i] * (float)b[i];
+    }
+    return sum;
+}
+
+#if defined(VECTOR_X86_AVX2)
+
+__attribute__((target("avx2,fma")))
+static float hsum_avx(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_f32_avx2(const float *a, const float *b, size_t n) {
+    __m256 s0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+    }
+    float sum = hsum_avx(_mm256_add_ps(s0, s1));
+    return sum + dot_f32(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_i8_avx2(const float *a, const int8_t *b, size_t n) {
+    __m256 s0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i q = _mm_loadu_si128((const __m128i *)(b + i));
+        __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(q));
+        __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(q, 8)));
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), lo, s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), hi, s1);
+    }
+    float sum = hsum_avx(_mm256_add_ps(s0, s1));
+    return sum + dot_i8(a + i, b + i, n - i);
+}
+
+static int have_avx2(void) {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#elif defined(VECTOR_NEON)
+
+static float dot_f32_neon(const float *a, const float *b, size_t n) {
+    float32x4_t s0 = vdupq_n_f32(0);
+    float32x4_t s1 = vdupq_n_f32(0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = vmlaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+        s1 = vmlaq_f32(s1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t s = vaddq_f32(s0, s1);
+    float sum = vgetq_lane_f32(s, 0) + vgetq_lane_f32(s, 1) +
+                vgetq_lane_f32(s, 2) + vgetq_lane_f32(s, 3);
+    return sum + dot_f32(a + i, b + i, n - i);
+}
+
+static float dot_i8_neon(const float *a, const int8_t *b, size_t n) {
+    float32x4_t s0 = vdupq_n_f32(0);
+    float32x4_t s1 = vdupq_n_f32(0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t q = vmovl_s8(vld1_s8(b + i));
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(q)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(q)));
+        s0 = vmlaq_f32(s0, vld1q_f32(a + i), lo);
+        s1 = vmlaq_f32(s1, vld1q_f32(a + i + 4), hi);
+    }
+    float32x4_t s = vaddq_f32(s0, s1);
+    float sum = vgetq_lane_f32(s, 0) + vgetq_lane_f32(s, 1) +
+                vgetq_lane_f32(s, 2) + vgetq_lane_f32(s, 3);
+    return sum + dot_i8(a + i, b + i, n - i);
+}
+
+#endif
+
+typedef float (*dot_f32_fn)(const float *, const float *, size_t);
+typedef float (*dot_i8_fn)(const float *, const int8_t *, size_t);
+
+static dot_f32_fn pick_dot_f32(void) {
+#if defined(VECTOR_X86_AVX2)
+    if (have_avx2()) return dot_f32_avx2;
+#elif defined(VECTOR_NEON)
+    return dot_f32_neon;
+#endif
+    return dot_f32;
+}
+
+static dot_i8_fn pick_dot_i8(void) {
+#if defined(VECTOR_X86_AVX2)
+    if (have_avx2()) return dot_i8_avx2;
+#elif defined(VECTOR_NEON)
+    return dot_i8_neon;
+#endif
+    return dot_i8;
+}
+
+/*============================================================================
+ * Storage
+ *============================================================================*/
+
+static void index_unmap(ac_vector_index_t *index) {
+    if (!index->map) {
+        return;
+    }
+#if !defined(_WIN32)
+    munmap(index->map, index->map_len);
+#else
+    free(index->map);
+#endif
+    index->map = NULL;
+    index->map_len = 0;
+}
+
+/**
+ * @brief Make room for capacity rows, copying an opened file to memory
+ */
+static arc_err_t index_reserve(ac_vector_index_t *index, size_t capacity) {
+    if (!index->map && capacity <= index->capacity) {
+        return ARC_OK;
+    }
+    if (capacity < INDEX_MIN_CAPACITY) {
+        capacity = INDEX_MIN_CAPACITY;
+    }
+    if (capacity > SIZE_MAX / (row_size(index) + sizeof(uint64_t) + sizeof(float))) {
+        return ARC_ERR_MEMORY;
+    }
+
+    int mapped = index->map != NULL;
+    uint64_t *ids = malloc(capacity * sizeof(uint64_t));
+    float *scales = index->storage == AC_VECTOR_I8 ? malloc(capacity * sizeof(float)) : NULL;
+    void *rows = malloc(capacity * row_size(index));
+    if (!ids || !rows || (index->storage == AC_VECTOR_I8 && !scales)) {
+        free(ids);
+        free(scales);
+        free(rows);
+        return ARC_ERR_MEMORY;
+    }
+    if (index->count > 0) {
+        memcpy(ids, index->ids, index->count * sizeof(uint64_t));
+        if (scales) {
+            memcpy(scales, index->scales, index->count * sizeof(float));
+        }
+        memcpy(rows, index->rows, index->count * row_size(index));
+    }
+
+    if (mapped) {
+        index_unmap(index);
+    } else {
+        free(index->ids);
+        free(index->scales);
+        free(index->rows);
+    }
+    index->ids = ids;
+    index->scales = scales;
+    index->rows = rows;
+    index->capacity = capacity;
+    return ARC_OK;
+}
+
+/**
+ * @brief Store one vector in row i (already normalized if the index is)
+ */
+static void index_set_row(ac_vector_index_t *index, size_t i, const float *v, float norm) {
+    size_t dims = index->dims;
+    float mul = norm > 0.0f ? 1.0f / norm : 1.0f;
+
+    if (index->storage == AC_VECTOR_F32) {
+        float *row = (float *)index->rows + i * dims;
+        for (size_t d = 0; d < dims; d++) {
+            row[d] = v[d] * mul;
+        }
+        return;
+    }
+
+    float max = 0.0f;
+    for (size_t d = 0; d < dims; d++) {
+        float a = fabsf(v[d] * mul);
+        if (a > max) max = a;
+    }
+    int8_t *row = (int8_t *)index->rows + i * dims;
+    float scale = max / 127.0f;
+    float inv = max > 0.0f ? 127.0f / max : 0.0f;
+    for (size_t d = 0; d < dims; d++) {
+        long q = lrintf(v[d] * mul * inv);
+        row[d] = (int8_t)(q > 127 ? 127 : q < -127 ? -127 : q);
+    }
+    index->scales[i] = scale;
+}
+
+/*============================================================================
+ * Lifecycle
+ *============================================================================*/
+
+arc_err_t ac_vector_index_create(const ac_vector_index_config_t *config,
+                                 ac_vector_index_t **out) {
+    if (!config || !out || config->dims == 0 ||
+        (config->storage != AC_VECTOR_F32 && config->storage != AC_VECTOR_I8)) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    ac_vector_index_t *index = calloc(1, sizeof(*index));
+    if (!index) {
+        return ARC_ERR_MEMORY;
+    }
+    index->dims = config->dims;
+    index->storage = config->storage;
+    index->normalize = config->normalize;
+
+    arc_err_t err = index_reserve(index, config->capacity);
+    if (err != ARC_OK) {
+        free(index);
+        return err;
+    }
+    *out = index;
+    return ARC_OK;
+}
+
+#if !defined(_WIN32)
+
+static arc_err_t index_map_file(const char *path, void **map, size_t *len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return ARC_ERR_NOT_FOUND;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < INDEX_HEADER_SIZE) {
+        close(fd);
+        return ARC_ERR_PARSE;
+    }
+    *len = (size_t)st.st_size;
+    *map = mmap(NULL, *len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return *map == MAP_FAILED ? ARC_ERR_IO : ARC_OK;
+}
+
+#else /* _WIN32 */
+
+static arc_err_t index_map_file(const char *path, void **map, size_t *len) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return ARC_ERR_NOT_FOUND;
+    }
+    long size = (fseek(fp, 0, SEEK_END) == 0) ? ftell(fp) : -1;
+    if (size < INDEX_HEADER_SIZE || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return ARC_ERR_PARSE;
+    }
+    *len = (size_t)size;
+    *map = malloc(*len);
+    int ok = *map && fread(*map, 1, *len, fp) == *len;
+    fclose(fp);
+    if (!ok) {
+        free(*map);
+        return ARC_ERR_IO;
+    }
+    return ARC_OK;
+}
+
+#endif /* !_WIN32 */
+
+arc_err_t ac_vector_index_open(const char *path, ac_vector_index_t **out) {
+    if (!path || !out) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    ac_vector_index_t *index = calloc(1, sizeof(*index));
+    if (!index) {
+        return ARC_ERR_MEMORY;
+    }
+    arc_err_t err = index_map_file(path, &index->map, &index->map_len);
+    if (err != ARC_OK) {
+        index->map = NULL;
+        free(index);
+        return err;
+    }
+
+    index_header_t header;
+    memcpy(&header, index->map, sizeof(header));
+    int valid = memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+                header.byte_order == INDEX_BYTE_ORDER &&
+                (header.storage == AC_VECTOR_F32 || header.storage == AC_VECTOR_I8) &&
+                header.dims > 0 && header.dims <= SIZE_MAX / sizeof(float);
+    if (valid) {
+        index->dims = (size_t)header.dims;
+        index->storage = (ac_vector_storage_t)header.storage;
+        index->normalize = header.normalize != 0;
+
+        /* Every row costs at least its id and its bytes */
+        size_t per_row = sizeof(uint64_t) + row_size(index);
+        valid = header.count <= index->map_len / per_row;
+        if (valid) {
+            index->count = (size_t)header.count;
+            size_t rows_at = rows_offset(index, index->count);
+            valid = rows_at <= index->map_len &&
+                    index->count * row_size(index) <= index->map_len - rows_at;
+        }
+    }
+    if (!valid) {
+        AC_LOG_WARN("%s is not a vector index", path);
+        index_unmap(index);
+        free(index);
+        return ARC_ERR_PARSE;
+    }
+
+    char *base = index->map;
+    index->ids = (uint64_t *)(base + INDEX_HEADER_SIZE);
+    if (index->storage == AC_VECTOR_I8) {
+        index->scales = (float *)(base + INDEX_HEADER_SIZE + index->count * sizeof(uint64_t));
+    }
+    index->rows = base + rows_offset(index, index->count);
+    index->capacity = index->count;
+
+    AC_LOG_DEBUG("Opened vector index %s: %zu rows of %zu", path, index->count, index->dims);
+    *out = index;
+    return ARC_OK;
+}
+
+arc_err_t ac_vector_index_save(const ac_vector_index_t *index, const char *path) {
+    if (!index || !path) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    size_t tmp_len = strlen(path) + 32;
+    char *tmp = malloc(tmp_len);
+    if (!tmp) {
+        return ARC_ERR_MEMORY;
+    }
+    snprintf(tmp, tmp_len, "%s.%d.tmp", path, (int)index_getpid());
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        AC_LOG_WARN("Cannot write vector index %s", tmp);
+        free(tmp);
+        return ARC_ERR_IO;
+    }
+
+    unsigned char header[INDEX_HEADER_SIZE] = {0};
+    index_header_t h = {
+        .byte_order = INDEX_BYTE_ORDER,
+        .storage = (uint32_t)index->storage,
+        .normalize = (uint32_t)(index->normalize != 0),
+        .dims = index->dims,
+        .count = index->count,
+    };
+    memcpy(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    memcpy(header, &h, sizeof(h));
+
+    static const unsigned char zeros[INDEX_ALIGN];
+    size_t written = INDEX_HEADER_SIZE + index->count * sizeof(uint64_t);
+    fwrite(header, 1, sizeof(header), fp);
+    fwrite(index->ids, sizeof(uint64_t), index->count, fp);
+    if (index->storage == AC_VECTOR_I8) {
+        fwrite(index->scales, sizeof(float), index->count, fp);
+        written += index->count * sizeof(float);
+    }
+    fwrite(zeros, 1, rows_offset(index, index->count) - written, fp);
+    fwrite(index->rows, row_size(index), index->count, fp);
+
+    int failed = ferror(fp);
+    failed |= fclose(fp) != 0;
+#if defined(_WIN32)
+    /* rename() does not replace an existing file here */
+    if (!failed) {
+        remove(path);
+    }
+#endif
+    if (failed || rename(tmp, path) != 0) {
+        AC_LOG_WARN("Cannot write vector index %s", path);
+        remove(tmp);
+        free(tmp);
+        return ARC_ERR_IO;
+    }
+    free(tmp);
+
+    AC_LOG_DEBUG("Saved vector index %s: %zu rows", path, index->count);
+    return ARC_OK;
+}
+
+void ac_vector_index_destroy(ac_vector_index_t *index) {
+    if (!index) {
+        return;
+    }
+    if (index->map) {
+        index_unmap(index);
+    } else {
+        free(index->ids);
+        free(index->scales);
+        free(index->rows);
+    }
+    free(index);
+}
+
+/*============================================================================
+ * Rows
+ *============================================================================*/
+
+arc_err_t ac_vector_index_add(ac_vector_index_t *index, const uint64_t *ids,
+                              const float *vectors, size_t count) {
+    if (!index || (count > 0 && (!ids || !vectors))) {
+        return ARC_ERR_INVALID_ARG;
+    }
+    if (count == 0) {
+        return ARC_OK;
+    }
+
+    size_t need = index->count + count;
+    if (index->map || need > index->capacity) {
+        size_t capacity = index->capacity * 2;
+        arc_err_t err = index_reserve(index, capacity > need ? capacity : need);
+        if (err != ARC_OK) {
+            return err;
+        }
+    }
+
+    dot_f32_fn dot = pick_dot_f32();
+    for (size_t i = 0; i < count; i++) {
+        const float *v = vectors + i * index->dims;
+        float norm = index->normalize ? sqrtf(dot(v, v, index->dims)) : 0.0f;
+        index->ids[index->count] = ids[i];
+        index_set_row(index, index->count, v, norm);
+        index->count++;
+    }
+    return ARC_OK;
+}
+
+arc_err_t ac_vector_index_remove(ac_vector_index_t *index, uint64_t id) {
+    if (!index) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    size_t found = 0;
+    for (size_t i = 0; i < index->count; i++) {
+        found += index->ids[i] == id;
+    }
+    if (found == 0) {
+        return ARC_ERR_NOT_FOUND;
+    }
+    arc_err_t err = index_reserve(index, index->capacity);
+    if (err != ARC_OK) {
+        return err;
+    }
+
+    size_t size = row_size(index);
+    char *rows = index->rows;
+    for (size_t i = 0; i < index->count;) {
+        if (index->ids[i] != id) {
+            i++;
+            continue;
+        }
+        size_t last = --index->count;
+        if (i != last) {
+            index->ids[i] = index->ids[last];
+            if (index->scales) {
+                index->scales[i] = index->scales[last];
+            }
+            memcpy(rows + i * size, rows + last * size, size);
+        }
+    }
+    return ARC_OK;
+}
+
+size_t ac_vector_index_count(const ac_vector_index_t *index) {
+    return index ? index->count : 0;
+}
+
+size_t ac_vector_index_dims(const ac_vector_index_t *index) {
+    return index ? index->dims : 0;
+}
+
+/*============================================================================
+ * Search
+ *============================================================================*/
+
+/** Min-heap of the best hits so far: the worst of them is at the root */
+static void heap_sift_down(ac_vector_hit_t *heap, size_t n, size_t i) {
+    for (;;) {
+        size_t min = i;
+        size_t l = 2 * i + 1;
+        size_t r = l + 1;
+        if (l < n && heap[l].score < heap[min].score) min = l;
+        if (r < n && heap[r].score < heap[min].score) min = r;
+        if (min == i) {
+            return;
+        }
+        ac_vector_hit_t t = heap[i];
+        heap[i] = heap[min];
+        heap[min] = t;
+        i = min;
+    }
+}
+
+static void heap_sift_up(ac_vector_hit_t *heap, size_t i) {
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap[parent].score <= heap[i].score) {
+            return;
+        }
+        ac_vector_hit_t t = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = t;
+        i = parent;
+    }
+}
+
+size_t ac_vector_index_search(const ac_vector_index_t *index, const float *query,
+                              size_t k, ac_vector_hit_t *hits) {
+    if (!index || !query || !hits || k == 0) {
+        return 0;
+    }
+
+    size_t dims = index->dims;
+    size_t n = 0;
+    if (index->storage == AC_VECTOR_F32) {
+        dot_f32_fn dot = pick_dot_f32();
+        const float *rows = index->rows;
+        for (size_t i = 0; i < index->count; i++) {
+            float score = dot(query, rows + i * dims, dims);
+            if (n < k) {
+                hits[n] = (ac_vector_hit_t){ index->ids[i], score };
+                heap_sift_up(hits, n++);
+            } else if (score > hits[0].score) {
+                hits[0] = (ac_vector_hit_t){ index->ids[i], score };
+                heap_sift_down(hits, n, 0);
+            }
+        }
+    } else {
+        dot_i8_fn dot = pick_dot_i8();
+        const int8_t *rows = index->rows;
+        for (size_t i = 0; i < index->count; i++) {
+            float score = dot(query, rows + i * dims, dims) * index->scales[i];
+            if (n < k) {
+                hits[n] = (ac_vector_hit_t){ index->ids[i], score };
+                heap_sift_up(hits, n++);
+            } else if (score > hits[0].score) {
+                hits[0] = (ac_vector_hit_t){ index->ids[i], score };
+                heap_sift_down(hits, n, 0);
+            }
+        }
+    }
+
+    /* Pop the worst to the back: best first */
+    for (size_t end = n; end > 1; end--) {
+        ac_vector_hit_t t = hits[0];
+        hits[0] = hits[end - 1];
+        hits[end - 1] = t;
+        heap_sift_down(hits, end - 1, 0);
+    }
+
+    if (index->normalize && n > 0) {
+        float norm = sqrtf(pick_dot_f32()(query, query, dims));
+        if (norm > 0.0f) {
+            for (size_t i = 0; i < n; i++) {
+                hits[i].score /= norm;
+            }
+        }
+    }
+    return n;
+}
@@ -0,0 +1,370 @@
+/**
+ * @file test_alloc_budget.c
+ * @brief Allocation budgets for the hot paths
+ *
+ * Holds the per-message and per-delta paths to a fixed number of heap
+ * allocations, counted with ac_alloc_count_start() (arc/allocator.h):
+ * - Appending a message to an arena-backed history allocates nothing
+ *   from the heap while the arena has room
+ * - A streaming delta allocates nothing once the parser is warm, both at
+ *   the SSE framing level and through a full OpenAI streaming call
+ *   against a loopback server (where the accumulated text may still
+ *   double its buffer a few times)
+ *
+ * Exits 77 (skipped) when built without ARC_RUNTIME_ALLOCATOR.
+ */
+
+#include "arc/allocator.h"
+#include "arc/arena.h"
+#include "arc/error.h"
+#include "arc/llm.h"
+#include "arc/message.h"
+#include "arc/platform.h"
+#include "arc/sse_parser.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/** ctest's SKIP_RETURN_CODE */
+#define TEST_SKIPPED 77
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static uint64_t thread_allocs(void) {
+    ac_alloc_counts_t counts;
+    ac_alloc_count_thread(&counts);
+    return counts.allocs + counts.reallocs;
+}
+
+/*============================================================================
+ * Message Append
+ *============================================================================*/
+
+#define APPEND_COUNT 200
+
+static void test_message_append(void) {
+    TEST("message append allocates nothing from the heap");
+
+    arena_t *arena = arena_create(256 * 1024);
+    if (!arena) {
+        FAIL("arena_create");
+        return;
+    }
+    ac_message_t *history = NULL;
+
+    uint64_t before = thread_allocs();
+    for (int i = 0; i < APPEND_COUNT; i++) {
+        ac_role_t role = (i % 2) ? AC_ROLE_ASSISTANT : AC_ROLE_USER;
+        ac_message_append(&history, ac_message_create(arena, role, "Check the sensors."));
+    }
+    uint64_t used = thread_allocs() - before;
+
+    size_t count = ac_message_count(history);
+    arena_destroy(arena);
+
+    char msg[96];
+    if (count != APPEND_COUNT) {
+        snprintf(msg, sizeof(msg), "expected %d messages, got %zu", APPEND_COUNT, count);
+        FAIL(msg);
+    } else if (used != 0) {
+        snprintf(msg, sizeof(msg), "%llu heap allocations for %d appends",
+                 (unsigned long long)used, APPEND_COUNT);
+        FAIL(msg);
+    } else {
+        PASS();
+    }
+}
+
+/*============================================================================
+ * SSE Framing
+ *============================================================================*/
+
+#define DELTA_COUNT 100
+
+static const char s_delta_event[] =
+    "data: {\"id\":\"chatcmpl-1\",\"object\":\"chat.completion.chunk\","
+    "\"choices\":[{\"index\":0,\"delta\":{\"content\":\"token \"},"
+    "\"finish_reason\":null}]}\n\n";
+
+static int count_sse_event(const sse_event_t *event, void *ctx) {
+    (void)event;
+    (*(int *)ctx)++;
+    return 0;
+}
+
+static void test_sse_delta(void) {
+    TEST("SSE delta allocates nothing once warm");
+
+    int events = 0;
+    sse_parser_t parser;
+    sse_parser_init(&parser, count_sse_event, &events);
+
+    /* Each event split mid-line, so the partial line goes through the
+     * line buffer; the first one sizes it */
+    size_t len = sizeof(s_delta_event) - 1;
+    size_t half = len / 2;
+    sse_parser_feed(&parser, s_delta_event, half);
+    sse_parser_feed(&parser, s_delta_event + half, len - half);
+
+    uint64_t before = thread_allocs();
+    for (int i = 0; i < DELTA_COUNT; i++) {
+        sse_parser_feed(&parser, s_delta_event, half);
+        sse_parser_feed(&parser, s_delta_event + half, len - half);
+    }
+    uint64_t used = thread_allocs() - before;
+    sse_parser_free(&parser);
+
+    char msg[96];
+    if (events != DELTA_COUNT + 1) {
+        snprintf(msg, sizeof(msg), "expected %d events, got %d", DELTA_COUNT + 1, events);
+        FAIL(msg);
+    } else if (used != 0) {
+        snprintf(msg, sizeof(msg), "%llu heap allocations for %d deltas",
+                 (unsigned long long)used, DELTA_COUNT);
+        FAIL(msg);
+    } else {
+        PASS();
+    }
+}
+
+#if ARC_FEATURE_OPENAI
+
+/*============================================================================
+ * Provider Stream (loopback)
+ *============================================================================*/
+
+typedef struct {
+    int listen_fd;
+    int port;
+    const char *body;
+    size_t body_len;
+    pthread_t thread;
+} replay_server_t;
+
+/**
+ * @brief Answer one request with the canned SSE body
+ */
+static void *replay_thread(void *arg) {
+    replay_server_t *srv = (replay_server_t *)arg;
+    char req[16384];
+
+    int fd = accept(srv->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+    size_t got = 0;
+    size_t need = 0;
+    for (;;) {
+        ssize_t n = read(fd, req + got, sizeof(req) - 1 - got);
+        if (n <= 0) {
+            break;
+        }
+        got += (size_t)n;
+        req[got] = '\0';
+        char *end = strstr(req, "\r\n\r\n");
+        if (end && need == 0) {
+            char *cl = strstr(req, "Content-Length:");
+            if (!cl) {
+                cl = strstr(req, "content-length:");
+            }
+            need = (size_t)(end + 4 - req) + (cl ? (size_t)strtoul(cl + 15, NULL, 10) : 0);
+        }
+        if ((need && got >= need) || got == sizeof(req) - 1) {
+            break;
+        }
+    }
+
+    char head[256];
+    int hn = snprintf(head, sizeof(head),
+                      "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                      "Content-Length: %zu\r\nConnection: close\r\n\r\n", srv->body_len);
+    if (write(fd, head, (size_t)hn) < 0 || write(fd, srv->body, srv->body_len) < 0) {
+        /* Client went away: the test reports it */
+    }
+    close(fd);
+    return NULL;
+}
+
+static int replay_start(replay_server_t *srv) {
+    srv->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (srv->listen_fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t alen = sizeof(addr);
+    if (bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(srv->listen_fd, 1) != 0 ||
+        getsockname(srv->listen_fd, (struct sockaddr *)&addr, &alen) != 0) {
+        close(srv->listen_fd);
+        return -1;
+    }
+    srv->port = ntohs(addr.sin_port);
+    return pthread_create(&srv->thread, NULL, replay_thread, srv) == 0 ? 0 : -1;
+}
+
+/** Deltas left out of the budget while buffers size themselves */
+#define STREAM_WARMUP 4
+
+/**
+ * The response keeps the text so far in a buffer that doubles: a few
+ * resizes over the whole stream, never a new block per delta
+ */
+#define STREAM_REALLOC_BUDGET 8
+
+typedef struct {
+    int deltas;
+    ac_alloc_counts_t mark;          /* Counts at the previous delta */
+    uint64_t allocs;                 /* New blocks between warm deltas */
+    uint64_t reallocs;               /* Resizes between warm deltas */
+} stream_count_t;
+
+static int count_stream_delta(const ac_stream_event_t *event, void *user_data) {
+    stream_count_t *c = (stream_count_t *)user_data;
+    if (event->type != AC_STREAM_DELTA) {
+        return 0;
+    }
+    ac_alloc_counts_t now;
+    ac_alloc_count_thread(&now);
+    if (c->deltas >= STREAM_WARMUP) {
+        c->allocs += now.allocs - c->mark.allocs;
+        c->reallocs += now.reallocs - c->mark.reallocs;
+    }
+    c->mark = now;
+    c->deltas++;
+    return 0;
+}
+
+static void test_provider_stream_delta(void) {
+    TEST("OpenAI stream delta allocates nothing once warm");
+
+    size_t event_len = sizeof(s_delta_event) - 1;
+    static const char done[] = "data: [DONE]\n\n";
+    size_t body_len = event_len * DELTA_COUNT + sizeof(done) - 1;
+    char *body = malloc(body_len + 1);
+    if (!body) {
+        FAIL("malloc");
+        return;
+    }
+    for (int i = 0; i < DELTA_COUNT; i++) {
+        memcpy(body + (size_t)i * event_len, s_delta_event, event_len);
+    }
+    memcpy(body + event_len * DELTA_COUNT, done, sizeof(done));
+
+    replay_server_t srv = { .body = body, .body_len = body_len };
+    if (replay_start(&srv) != 0) {
+        free(body);
+        FAIL("loopback server");
+        return;
+    }
+    char base[64];
+    snprintf(base, sizeof(base), "http://127.0.0.1:%d", srv.port);
+
+    arena_t *arena = arena_create(64 * 1024);
+    ac_message_t *messages = ac_message_create(arena, AC_ROLE_USER, "hi");
+    ac_llm_t *llm = ac_llm_create(arena, &(ac_llm_params_t){
+        .provider = "openai",
+        .model = "test",
+        .api_key = "test",
+        .api_base = base,
+    });
+
+    stream_count_t c;
+    memset(&c, 0, sizeof(c));
+    ac_chat_response_t response;
+    arc_err_t err = llm ? ac_llm_chat_stream(llm, messages, NULL, count_stream_delta, &c, &response)
+                        : ARC_ERR_INVALID_ARG;
+    if (err == ARC_OK) {
+        ac_chat_response_free(&response);
+    }
+    if (llm) {
+        ac_llm_cleanup(llm);
+    }
+    arena_destroy(arena);
+    pthread_join(srv.thread, NULL);
+    close(srv.listen_fd);
+    free(body);
+
+    char msg[96];
+    if (err != ARC_OK) {
+        snprintf(msg, sizeof(msg), "stream failed: %s", ac_strerror(err));
+        FAIL(msg);
+    } else if (c.deltas != DELTA_COUNT) {
+        snprintf(msg, sizeof(msg), "expected %d deltas, got %d", DELTA_COUNT, c.deltas);
+        FAIL(msg);
+    } else if (c.allocs != 0) {
+        snprintf(msg, sizeof(msg), "%llu heap allocations over %d warm deltas",
+                 (unsigned long long)c.allocs, DELTA_COUNT - STREAM_WARMUP);
+        FAIL(msg);
+    } else if (c.reallocs > STREAM_REALLOC_BUDGET) {
+        snprintf(msg, sizeof(msg), "%llu resizes over %d warm deltas (budget %d)",
+                 (unsigned long long)c.reallocs, DELTA_COUNT - STREAM_WARMUP,
+                 STREAM_REALLOC_BUDGET);
+        FAIL(msg);
+    } else {
+        PASS();
+    }
+}
+
+#endif /* ARC_FEATURE_OPENAI */
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(void) {
+    printf("=== Allocation Budget Tests ===\n\n");
+
+    arc_err_t err = ac_alloc_count_start();
+    if (err == ARC_ERR_NOT_IMPLEMENTED) {
+        printf("Skipped: built without ARC_RUNTIME_ALLOCATOR\n");
+        return TEST_SKIPPED;
+    }
+    if (err != ARC_OK) {
+        printf("ac_alloc_count_start: %s\n", ac_strerror(err));
+        return 1;
+    }
+
+    test_message_append();
+    test_sse_delta();
+#if ARC_FEATURE_OPENAI
+    test_provider_stream_delta();
+#endif
+
+    ac_alloc_count_stop();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
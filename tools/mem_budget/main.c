@@ -0,0 +1,272 @@
+/**
+ * @file main.c
+ * @brief mem_budget - Report the memory a configuration needs
+ *
+ * Measures what a session and each agent take from a static pool for
+ * the configuration ac_core was built with (arena sizes, HTTP backend,
+ * ARC_STATIC_MEMORY), adds the static buffers that live outside the
+ * pool, and works out how many agents fit in the heap. With -u it also
+ * runs one turn against an endpoint and reports the run's peak, the part
+ * that depends on what the model sends back.
+ *
+ * Usage:
+ *   mem_budget [options]
+ *
+ * Options:
+ *   -a <n>      Agents to create (default 2)
+ *   -s <bytes>  Heap to measure in (default ARC_STATIC_HEAP_SIZE, else 16 MiB)
+ *   -u <url>    OpenAI-compatible api_base: also run one turn
+ *   -k <key>    API key for -u (default "none")
+ *   -m <model>  Model for -u (default "gpt-4o-mini")
+ *   -p <text>   Prompt for -u (default "Hello")
+ *   -h          Show help
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "arc/agent.h"
+#include "arc/log.h"
+#include "arc/platform.h"
+#include "arc/session.h"
+#include "arc/static_pool.h"
+
+#define DEFAULT_HEAP_SIZE (16 * 1024 * 1024)
+
+/*============================================================================
+ * Usage and Help
+ *============================================================================*/
+
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [options]\n", prog_name);
+    printf("\n");
+    printf("Reports the memory one session and its agents need with this build's\n");
+    printf("configuration, measured in a static pool.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -a <n>      Agents to create (default 2)\n");
+    printf("  -s <bytes>  Heap to measure in (default ARC_STATIC_HEAP_SIZE, else 16 MiB)\n");
+    printf("  -u <url>    OpenAI-compatible api_base: also run one turn\n");
+    printf("  -k <key>    API key for -u (default \"none\")\n");
+    printf("  -m <model>  Model for -u (default \"gpt-4o-mini\")\n");
+    printf("  -p <text>   Prompt for -u (default \"Hello\")\n");
+    printf("  -h          Show this help message\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("  %s -a 4 -u http://127.0.0.1:8080/v1\n", prog_name);
+}
+
+/*============================================================================
+ * Pool Setup
+ *============================================================================*/
+
+/**
+ * @brief Route the library's allocations to a pool of heap_size bytes
+ *
+ * ARC_STATIC_MEMORY builds already allocate from the process pool; other
+ * builds get one installed as the process allocator.
+ */
+static ac_static_pool_t *pool_setup(size_t heap_size) {
+#if ARC_STATIC_MEMORY
+    if (heap_size) {
+        void *region = malloc(heap_size);
+        if (!region || ac_static_memory_init(region, heap_size) != ARC_OK) {
+            fprintf(stderr, "Error: cannot set up a %zu byte heap\n", heap_size);
+            return NULL;
+        }
+    }
+    /* The process pool comes into being with the first allocation */
+    ac_free(ac_alloc(1));
+    return ac_static_memory_pool();
+#else
+    if (!heap_size) {
+        heap_size = DEFAULT_HEAP_SIZE;
+    }
+    void *region = malloc(heap_size);
+    ac_static_pool_t *pool = region ? ac_static_pool_create(region, heap_size) : NULL;
+    if (!pool) {
+        fprintf(stderr, "Error: cannot set up a %zu byte heap\n", heap_size);
+        return NULL;
+    }
+    ac_allocator_t allocator;
+    ac_static_pool_allocator(pool, &allocator);
+    if (ac_allocator_set(&allocator) != ARC_OK) {
+        fprintf(stderr, "Error: ac_core was built without ARC_RUNTIME_ALLOCATOR\n");
+        return NULL;
+    }
+    return pool;
+#endif
+}
+
+static ac_static_pool_stats_t snapshot(ac_static_pool_t *pool) {
+    ac_static_pool_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    ac_static_pool_get_stats(pool, &stats);
+    return stats;
+}
+
+/*============================================================================
+ * Report
+ *============================================================================*/
+
+static void print_row(const char *label, size_t bytes) {
+    printf("  %-28s %10zu  (%.1f KiB)\n", label, bytes, bytes / 1024.0);
+}
+
+static size_t static_buffers(void) {
+#if defined(ARC_HTTP_BACKEND_MONGOOSE)
+    return (size_t)ARC_HTTP_MAX_CLIENTS *
+           (ARC_HTTP_TX_BUFFER_SIZE + ARC_HTTP_HEAD_BUFFER_SIZE + ARC_HTTP_BODY_BUFFER_SIZE);
+#else
+    return 0;
+#endif
+}
+
+static void print_config(void) {
+    printf("Configuration\n");
+    printf("  %-28s %10d\n", "ARC_STATIC_MEMORY", ARC_STATIC_MEMORY);
+#if ARC_STATIC_MEMORY
+    print_row("ARC_STATIC_HEAP_SIZE", (size_t)ARC_STATIC_HEAP_SIZE);
+#endif
+    print_row("ARC_SESSION_ARENA_SIZE", (size_t)ARC_SESSION_ARENA_SIZE);
+    print_row("ARC_AGENT_ARENA_SIZE", (size_t)ARC_AGENT_ARENA_SIZE);
+    print_row("ARC_ARENA_MIN_BLOCK_SIZE", (size_t)ARC_ARENA_MIN_BLOCK_SIZE);
+    printf("  %-28s %10d\n", "ARC_STREAM_DELTA_ONLY", ARC_STREAM_DELTA_ONLY);
+    if (ARC_SSE_LINE_MAX > 0) {
+        print_row("ARC_SSE_LINE_MAX", (size_t)ARC_SSE_LINE_MAX);
+    } else {
+        printf("  %-28s %10s\n", "ARC_SSE_LINE_MAX", "unbounded");
+    }
+#if defined(ARC_HTTP_BACKEND_MONGOOSE)
+    printf("  %-28s mongoose, %d clients x %d bytes static\n", "HTTP backend",
+           (int)ARC_HTTP_MAX_CLIENTS,
+           (int)(ARC_HTTP_TX_BUFFER_SIZE + ARC_HTTP_HEAD_BUFFER_SIZE + ARC_HTTP_BODY_BUFFER_SIZE));
+#else
+    printf("  %-28s libcurl (buffers from the heap)\n", "HTTP backend");
+#endif
+    printf("\n");
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(int argc, char *argv[]) {
+    int agent_count = 2;
+    size_t heap_size = 0;
+    const char *url = NULL;
+    const char *key = "none";
+    const char *model = "gpt-4o-mini";
+    const char *prompt = "Hello";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "a:s:u:k:m:p:h")) != -1) {
+        switch (opt) {
+            case 'a': agent_count = atoi(optarg); break;
+            case 's': heap_size = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'u': url = optarg; break;
+            case 'k': key = optarg; break;
+            case 'm': model = optarg; break;
+            case 'p': prompt = optarg; break;
+            case 'h': print_usage(argv[0]); return 0;
+            default:  print_usage(argv[0]); return 1;
+        }
+    }
+    if (agent_count < 1) {
+        agent_count = 1;
+    }
+
+    ac_log_set_level(AC_LOG_LEVEL_ERROR);
+
+    ac_static_pool_t *pool = pool_setup(heap_size);
+    if (!pool) {
+        return 1;
+    }
+
+    print_config();
+
+    /* Fixed costs: a session, then its agents */
+    ac_static_pool_stats_t base = snapshot(pool);
+    ac_session_t *session = ac_session_open();
+    if (!session) {
+        fprintf(stderr, "Error: the session does not fit in %zu bytes\n", base.capacity);
+        return 1;
+    }
+    ac_static_pool_stats_t opened = snapshot(pool);
+
+    ac_agent_params_t params = {
+        .name = "budget",
+        .instructions = "You are a helpful assistant.",
+        .llm = {
+            .provider = "openai",
+            .model = model,
+            .api_key = key,
+            .api_base = url ? url : "http://127.0.0.1:1/v1",
+        },
+    };
+    ac_agent_t *first = NULL;
+    int created = 0;
+    for (; created < agent_count; created++) {
+        ac_agent_t *agent = ac_agent_create(session, &params);
+        if (!agent) {
+            break;
+        }
+        if (!first) {
+            first = agent;
+        }
+    }
+    if (created == 0) {
+        fprintf(stderr, "Error: no agent fits in the heap\n");
+        ac_session_close(session);
+        return 1;
+    }
+    ac_static_pool_stats_t populated = snapshot(pool);
+
+    size_t session_cost = opened.in_use - base.in_use;
+    size_t agent_cost = (populated.in_use - opened.in_use) / (size_t)created;
+
+    /* Variable cost: one turn (history growth, JSON trees, stream buffers) */
+    size_t run_peak = 0;
+    size_t run_retained = 0;
+    int run_ok = 0;
+    if (url) {
+        ac_agent_result_t *result = ac_agent_run(first, prompt);
+        ac_static_pool_stats_t after = snapshot(pool);
+        run_ok = result && result->content;
+        run_peak = after.peak > populated.in_use ? after.peak - populated.in_use : 0;
+        run_retained = after.in_use > populated.in_use ? after.in_use - populated.in_use : 0;
+    }
+
+    printf("Pool usage (bytes, headers and class rounding included)\n");
+    print_row("session", session_cost);
+    print_row("per agent", agent_cost);
+    if (url) {
+        print_row(run_ok ? "run peak" : "run peak (run failed)", run_peak);
+        print_row("retained after the run", run_retained);
+    } else {
+        printf("  %-28s not measured (pass -u)\n", "run peak");
+    }
+    if ((int)created < agent_count) {
+        printf("  only %d of %d agents fit\n", created, agent_count);
+    }
+    printf("\n");
+
+    size_t heap = populated.capacity;
+    size_t fixed = session_cost + agent_cost * (size_t)created;
+    size_t static_bytes = static_buffers();
+    size_t fit = heap > session_cost + run_peak && agent_cost
+        ? (heap - session_cost - run_peak) / agent_cost : 0;
+
+    printf("Budget\n");
+    print_row("heap", heap);
+    print_row("session + agents", fixed);
+    print_row("static buffers outside heap", static_bytes);
+    print_row("worst case total", heap + static_bytes);
+    printf("  %-28s %10zu%s\n", "agents that fit", fit,
+           url ? " (with one run in flight)" : " (no run headroom: pass -u)");
+
+    ac_session_close(session);
+    return 0;
+}
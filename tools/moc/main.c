@@ -6,10 +6,13 @@
  * wrapper functions and tool registration code.
  *
  * Usage:
- *   moc [options] <input.h>
+ *   moc [options] <input.h>...
  *
  * Options:
  *   -o <basename>   Output file base name (generates basename.h and basename.c)
+ *   -c <file>       Parse cache: headers whose contents did not change are
+ *                   not parsed again
+ *   -d <file>       Write a Makefile/Ninja depfile for the outputs
  *   -v              Verbose output
  *   -h              Show help
  */
@@ -26,7 +29,7 @@
  *============================================================================*/
 
 static void print_usage(const char *prog_name) {
-    printf("Usage: %s [options] <input.h>\n", prog_name);
+    printf("Usage: %s [options] <input.h>...\n", prog_name);
     printf("\n");
     printf("MOC (Meta-Object Compiler) for ArC Tool Generation\n");
     printf("\n");
@@ -36,12 +39,16 @@ static void print_usage(const char *prog_name) {
     printf("Options:\n");
     printf("  -o <basename>   Output file base name (generates basename.h and basename.c)\n");
     printf("                  If not specified, outputs to stdout\n");
+    printf("  -c <file>       Parse cache; unchanged headers are not parsed again\n");
+    printf("  -d <file>       Write a Makefile/Ninja depfile for the outputs\n");
     printf("  -v              Verbose output (show parsed tools)\n");
     printf("  -h              Show this help message\n");
     printf("\n");
     printf("Example:\n");
     printf("  %s -o tools_gen tools.h\n", prog_name);
     printf("  This generates tools_gen.h and tools_gen.c from tools.h\n");
+    printf("  %s -c tools.moccache -d tools_gen.d -o tools_gen fs.h net.h\n", prog_name);
+    printf("  One combined registry (ALL_TOOLS) over the tools of every header\n");
     printf("\n");
     printf("Input file format:\n");
     printf("  /**\n");
@@ -56,22 +63,79 @@ static void print_version(void) {
     printf("Part of ArC - C-native AI Agent Framework\n");
 }
 
+/*============================================================================
+ * Input Processing
+ *============================================================================*/
+
+/**
+ * Parse the current input, or take its tools from the cache when its
+ * contents are unchanged
+ */
+static int process_input(moc_ctx_t *ctx, moc_cache_t *cache) {
+    uint64_t hash = moc_hash(ctx->source_code, ctx->source_len);
+
+    const moc_cache_entry_t *hit = cache ? moc_cache_lookup(cache, ctx->input_file, hash) : NULL;
+    if (hit) {
+        if (ctx->tool_count + hit->tool_count > MOC_MAX_TOOLS) {
+            fprintf(stderr, "Error: Too many tools (max %d)\n", MOC_MAX_TOOLS);
+            return -1;
+        }
+        if (hit->tool_count > 0) {
+            memcpy(&ctx->tools[ctx->tool_count], hit->tools,
+                   sizeof(moc_tool_t) * hit->tool_count);
+        }
+        ctx->tool_count += hit->tool_count;
+        if (ctx->verbose) {
+            printf("MOC: %s unchanged, %d cached tool(s)\n", ctx->input_file, hit->tool_count);
+        }
+        return 0;
+    }
+
+    if (ctx->verbose) {
+        printf("MOC: Processing %s\n", ctx->input_file);
+    }
+
+    int first = ctx->tool_count;
+    if (moc_parse(ctx) != 0) {
+        fprintf(stderr, "Error: Failed to parse %s\n", ctx->input_file);
+        return -1;
+    }
+
+    if (ctx->tool_count == first) {
+        fprintf(stderr, "Warning: No AC_TOOL_META functions found in %s\n", ctx->input_file);
+    }
+
+    if (cache && moc_cache_store(cache, ctx->input_file, hash,
+                                 &ctx->tools[first], ctx->tool_count - first) != 0) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return -1;
+    }
+    return 0;
+}
+
 /*============================================================================
  * Main Entry Point
  *============================================================================*/
 
 int main(int argc, char *argv[]) {
     const char *output_base = NULL;
-    const char *input_file = NULL;
+    const char *cache_file = NULL;
+    const char *dep_file = NULL;
     bool verbose = false;
     int opt;
 
     /* Parse command line options */
-    while ((opt = getopt(argc, argv, "o:vhV")) != -1) {
+    while ((opt = getopt(argc, argv, "o:c:d:vhV")) != -1) {
         switch (opt) {
             case 'o':
                 output_base = optarg;
                 break;
+            case 'c':
+                cache_file = optarg;
+                break;
+            case 'd':
+                dep_file = optarg;
+                break;
             case 'v':
                 verbose = true;
                 break;
@@ -87,59 +151,74 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    /* Get input file */
+    /* Get input files */
     if (optind >= argc) {
         fprintf(stderr, "Error: No input file specified\n\n");
         print_usage(argv[0]);
         return 1;
     }
 
-    input_file = argv[optind];
-
-    /* Initialize MOC context */
-    moc_ctx_t ctx;
-    if (moc_init(&ctx, input_file, output_base) != 0) {
+    /* Too large for the stack with MOC_MAX_TOOLS tools */
+    moc_ctx_t *ctx = malloc(sizeof(moc_ctx_t));
+    if (!ctx) {
+        fprintf(stderr, "Error: Out of memory\n");
         return 1;
     }
 
-    ctx.verbose = verbose;
-
-    if (verbose) {
-        printf("MOC: Processing %s\n", input_file);
+    moc_cache_t cache;
+    if (cache_file) {
+        moc_cache_load(&cache, cache_file);
     }
 
-    /* Parse input file */
-    if (moc_parse(&ctx) != 0) {
-        fprintf(stderr, "Error: Failed to parse %s\n", input_file);
-        moc_cleanup(&ctx);
-        return 1;
+    int rc = 0;
+    for (int i = optind; i < argc && rc == 0; i++) {
+        if (i == optind) {
+            rc = moc_init(ctx, argv[i], output_base);
+            ctx->verbose = verbose;
+        } else {
+            rc = moc_add_input(ctx, argv[i]);
+        }
+        if (rc == 0) {
+            rc = process_input(ctx, cache_file ? &cache : NULL);
+        }
     }
 
-    if (ctx.tool_count == 0) {
-        fprintf(stderr, "Warning: No AC_TOOL_META functions found in %s\n", input_file);
-        moc_cleanup(&ctx);
-        return 0;
-    }
+    if (rc == 0 && ctx->tool_count == 0) {
+        /* Nothing to generate; only a depfile keeps Ninja tracking the inputs */
+        if (dep_file && output_base) {
+            rc = moc_write_depfile(ctx, dep_file);
+        }
+    } else if (rc == 0) {
+        if (verbose) {
+            printf("Found %d tool(s)\n\n", ctx->tool_count);
+        }
 
-    if (verbose) {
-        printf("Found %d tool(s)\n\n", ctx.tool_count);
-    }
+        /* Generate output */
+        if (moc_generate(ctx) != 0) {
+            fprintf(stderr, "Error: Failed to generate output\n");
+            rc = -1;
+        } else if (dep_file && moc_write_depfile(ctx, dep_file) != 0) {
+            rc = -1;
+        }
 
-    /* Generate output */
-    if (moc_generate(&ctx) != 0) {
-        fprintf(stderr, "Error: Failed to generate output\n");
-        moc_cleanup(&ctx);
-        return 1;
+        if (rc == 0 && verbose && output_base) {
+            printf("\nGeneration complete:\n");
+            printf("  %s.h - Header with wrapper declarations\n", output_base);
+            printf("  %s.c - Source with wrappers and registration table\n", output_base);
+        }
     }
 
-    if (verbose && output_base) {
-        printf("\nGeneration complete:\n");
-        printf("  %s.h - Header with wrapper declarations\n", output_base);
-        printf("  %s.c - Source with wrappers and registration table\n", output_base);
+    /* Only a successful run may vouch for what it parsed */
+    if (cache_file) {
+        if (rc == 0) {
+            moc_cache_save(&cache, cache_file);
+        }
+        moc_cache_free(&cache);
     }
 
     /* Cleanup */
-    moc_cleanup(&ctx);
+    moc_cleanup(ctx);
+    free(ctx);
 
-    return 0;
+    return rc == 0 ? 0 : 1;
 }
@@ -10,6 +10,7 @@
 #define MOC_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -23,7 +24,8 @@ extern "C" {
 #define MOC_MAX_PARAMS      16    /* Maximum number of parameters per function */
 #define MOC_MAX_NAME_LEN    128   /* Maximum length of identifiers */
 #define MOC_MAX_DESC_LEN    512   /* Maximum length of descriptions */
-#define MOC_MAX_TOOLS       64    /* Maximum number of tools to process */
+#define MOC_MAX_TOOLS       256   /* Maximum number of tools to process */
+#define MOC_MAX_INPUTS      128   /* Maximum number of input headers */
 
 /*============================================================================
  * Type Definitions
@@ -64,15 +66,19 @@ typedef struct {
     moc_param_t params[MOC_MAX_PARAMS];  /* Parameter list */
     int param_count;                     /* Number of parameters */
     int line_number;                     /* Line number in source file */
+    bool is_async;                       /* Takes a trailing ac_tool_call_t* (not in params) */
+    bool parallel_safe;                  /* @parallel_safe tag */
 } moc_tool_t;
 
 /**
  * @brief MOC context for parsing and code generation
  */
 typedef struct {
-    const char *source_code;             /* Source code buffer */
+    const char *source_code;             /* Source code buffer (current input) */
     size_t source_len;                   /* Source code length */
-    const char *input_file;              /* Input file path */
+    const char *input_file;              /* Input file path (current input) */
+    const char *inputs[MOC_MAX_INPUTS];  /* Every input, included by the generated source */
+    int input_count;
     const char *output_base;             /* Output file base name (without extension) */
     moc_tool_t tools[MOC_MAX_TOOLS];     /* Extracted tool functions */
     int tool_count;                      /* Number of tools found */
@@ -93,6 +99,18 @@ typedef struct {
  */
 int moc_init(moc_ctx_t *ctx, const char *input_file, const char *output_base);
 
+/**
+ * @brief Make another header the current input
+ *
+ * Tools parsed from it are appended to the ones already found, and the
+ * generated source includes every input.
+ *
+ * @param ctx         Initialized context
+ * @param input_file  Path to input header file
+ * @return 0 on success, -1 on error
+ */
+int moc_add_input(moc_ctx_t *ctx, const char *input_file);
+
 /**
  * @brief Free resources associated with MOC context
  *
@@ -100,6 +118,70 @@ int moc_init(moc_ctx_t *ctx, const char *input_file, const char *output_base);
  */
 void moc_cleanup(moc_ctx_t *ctx);
 
+/*============================================================================
+ * Parse Cache
+ *============================================================================*/
+
+/**
+ * @brief Tools parsed from one header, keyed by its content hash
+ */
+typedef struct {
+    char *path;
+    uint64_t hash;                       /* moc_hash() of the contents */
+    moc_tool_t *tools;
+    int tool_count;
+    bool used;                           /* Seen in this run (others are dropped) */
+} moc_cache_entry_t;
+
+/**
+ * @brief Parsed tools of previous runs, so unchanged headers skip parsing
+ */
+typedef struct {
+    moc_cache_entry_t *entries;
+    int count;
+    int capacity;
+    bool dirty;                          /* Needs saving */
+} moc_cache_t;
+
+/**
+ * @brief 64-bit FNV-1a of a buffer
+ */
+uint64_t moc_hash(const char *data, size_t len);
+
+/**
+ * @brief Load a cache file
+ *
+ * A missing, truncated or foreign file (other MOC build, other layout)
+ * leaves the cache empty: everything is parsed again.
+ *
+ * @return 0 (always; the cache is only an accelerator)
+ */
+int moc_cache_load(moc_cache_t *cache, const char *path);
+
+/**
+ * @brief Tools cached for path, if its contents still hash to hash
+ *
+ * @return Entry (marked used), NULL on a miss
+ */
+const moc_cache_entry_t *moc_cache_lookup(moc_cache_t *cache, const char *path, uint64_t hash);
+
+/**
+ * @brief Record the tools parsed from path
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int moc_cache_store(moc_cache_t *cache, const char *path, uint64_t hash,
+                    const moc_tool_t *tools, int tool_count);
+
+/**
+ * @brief Write the cache back if it changed, dropping unused entries
+ *
+ * @return 0 on success, -1 on error
+ */
+int moc_cache_save(moc_cache_t *cache, const char *path);
+
+void moc_cache_free(moc_cache_t *cache);
+
 /*============================================================================
  * Parsing Functions
  *============================================================================*/
@@ -118,7 +200,8 @@ int moc_parse(moc_ctx_t *ctx);
 /**
  * @brief Parse Doxygen-style comment block
  *
- * Extracts @description and @param tags from a comment block.
+ * Extracts @description, @param and @parallel_safe tags from a comment
+ * block.
  *
  * @param comment_text  Raw comment text (including delimiters)
  * @param comment_len   Length of comment text
@@ -154,13 +237,24 @@ const char *moc_type_to_json_schema(moc_type_t type);
 /**
  * @brief Generate all output files
  *
- * Generates tools_gen.h and tools_gen.c files.
+ * Generates tools_gen.h and tools_gen.c files. A file whose contents
+ * would not change is left untouched, so its timestamp does not trigger
+ * rebuilds (Ninja restat).
  *
  * @param ctx  MOC context with parsed tool metadata
  * @return 0 on success, -1 on error
  */
 int moc_generate(moc_ctx_t *ctx);
 
+/**
+ * @brief Write a Makefile-style depfile: both outputs depend on every input
+ *
+ * @param ctx   MOC context (output_base must be set)
+ * @param path  Depfile path
+ * @return 0 on success, -1 on error
+ */
+int moc_write_depfile(const moc_ctx_t *ctx, const char *path);
+
 /**
  * @brief Generate header file content
  *
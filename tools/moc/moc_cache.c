@@ -0,0 +1,241 @@
+/**
+ * @file moc_cache.c
+ * @brief Parse cache for MOC
+ *
+ * Keeps the tools parsed from each header together with a hash of the
+ * header's contents, so a run over many headers only parses the ones
+ * that changed. The file is a plain dump of moc_tool_t records guarded
+ * by a magic, a format version and the record size; it is local to a
+ * build directory and never shared between builds of MOC.
+ *
+ * Layout:
+ *   "MOCCACHE" u32 version u32 sizeof(moc_tool_t) u32 entry_count
+ *   per entry: u32 path_len, path, u64 hash, u32 tool_count, tools
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "moc.h"
+
+#define CACHE_MAGIC   "MOCCACHE"
+#define CACHE_VERSION 2u
+
+/*============================================================================
+ * Hashing
+ *============================================================================*/
+
+uint64_t moc_hash(const char *data, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/*============================================================================
+ * Entries
+ *============================================================================*/
+
+static moc_cache_entry_t *cache_find(moc_cache_t *cache, const char *path) {
+    for (int i = 0; i < cache->count; i++) {
+        if (strcmp(cache->entries[i].path, path) == 0) {
+            return &cache->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static moc_cache_entry_t *cache_append(moc_cache_t *cache) {
+    if (cache->count == cache->capacity) {
+        int capacity = cache->capacity ? cache->capacity * 2 : 16;
+        moc_cache_entry_t *entries = realloc(cache->entries, sizeof(*entries) * capacity);
+        if (!entries) {
+            return NULL;
+        }
+        cache->entries = entries;
+        cache->capacity = capacity;
+    }
+    moc_cache_entry_t *entry = &cache->entries[cache->count++];
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+}
+
+const moc_cache_entry_t *moc_cache_lookup(moc_cache_t *cache, const char *path, uint64_t hash) {
+    moc_cache_entry_t *entry = cache_find(cache, path);
+    if (!entry || entry->hash != hash) {
+        return NULL;
+    }
+    entry->used = true;
+    return entry;
+}
+
+int moc_cache_store(moc_cache_t *cache, const char *path, uint64_t hash,
+                    const moc_tool_t *tools, int tool_count) {
+    moc_tool_t *copy = NULL;
+    if (tool_count > 0) {
+        copy = malloc(sizeof(moc_tool_t) * tool_count);
+        if (!copy) {
+            return -1;
+        }
+        memcpy(copy, tools, sizeof(moc_tool_t) * tool_count);
+    }
+
+    moc_cache_entry_t *entry = cache_find(cache, path);
+    if (entry) {
+        free(entry->tools);
+    } else {
+        char *path_copy = strdup(path);
+        entry = path_copy ? cache_append(cache) : NULL;
+        if (!entry) {
+            free(path_copy);
+            free(copy);
+            return -1;
+        }
+        entry->path = path_copy;
+    }
+
+    entry->hash = hash;
+    entry->tools = copy;
+    entry->tool_count = tool_count;
+    entry->used = true;
+    cache->dirty = true;
+    return 0;
+}
+
+/*============================================================================
+ * File I/O
+ *============================================================================*/
+
+static bool read_u32(FILE *f, uint32_t *v) {
+    return fread(v, sizeof(*v), 1, f) == 1;
+}
+
+int moc_cache_load(moc_cache_t *cache, const char *path) {
+    memset(cache, 0, sizeof(*cache));
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return 0;
+    }
+
+    char magic[sizeof(CACHE_MAGIC) - 1];
+    uint32_t version, record_size, count;
+    if (fread(magic, sizeof(magic), 1, f) != 1 ||
+        memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 ||
+        !read_u32(f, &version) || version != CACHE_VERSION ||
+        !read_u32(f, &record_size) || record_size != sizeof(moc_tool_t) ||
+        !read_u32(f, &count)) {
+        fclose(f);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t path_len, tool_count;
+        uint64_t hash;
+        if (!read_u32(f, &path_len) || path_len == 0 || path_len > 4096) {
+            break;
+        }
+        char *entry_path = malloc(path_len + 1);
+        if (!entry_path || fread(entry_path, path_len, 1, f) != 1) {
+            free(entry_path);
+            break;
+        }
+        entry_path[path_len] = '\0';
+
+        moc_tool_t *tools = NULL;
+        bool ok = fread(&hash, sizeof(hash), 1, f) == 1 &&
+                  read_u32(f, &tool_count) && tool_count <= MOC_MAX_TOOLS;
+        if (ok && tool_count > 0) {
+            tools = malloc(sizeof(moc_tool_t) * tool_count);
+            ok = tools && fread(tools, sizeof(moc_tool_t), tool_count, f) == tool_count;
+        }
+
+        moc_cache_entry_t *entry = ok ? cache_append(cache) : NULL;
+        if (!entry) {
+            free(entry_path);
+            free(tools);
+            break;
+        }
+        entry->path = entry_path;
+        entry->hash = hash;
+        entry->tools = tools;
+        entry->tool_count = (int)tool_count;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+int moc_cache_save(moc_cache_t *cache, const char *path) {
+    /* Entries of headers no longer passed to MOC are dropped too */
+    for (int i = 0; i < cache->count; i++) {
+        if (!cache->entries[i].used) {
+            cache->dirty = true;
+        }
+    }
+    if (!cache->dirty) {
+        return 0;
+    }
+
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        fprintf(stderr, "Error: Failed to open %s for writing\n", tmp_path);
+        return -1;
+    }
+
+    uint32_t version = CACHE_VERSION;
+    uint32_t record_size = sizeof(moc_tool_t);
+    uint32_t count = 0;
+    for (int i = 0; i < cache->count; i++) {
+        count += cache->entries[i].used;
+    }
+
+    bool ok = fwrite(CACHE_MAGIC, sizeof(CACHE_MAGIC) - 1, 1, f) == 1 &&
+              fwrite(&version, sizeof(version), 1, f) == 1 &&
+              fwrite(&record_size, sizeof(record_size), 1, f) == 1 &&
+              fwrite(&count, sizeof(count), 1, f) == 1;
+
+    for (int i = 0; ok && i < cache->count; i++) {
+        const moc_cache_entry_t *entry = &cache->entries[i];
+        if (!entry->used) {
+            continue;
+        }
+        uint32_t path_len = (uint32_t)strlen(entry->path);
+        uint32_t tool_count = (uint32_t)entry->tool_count;
+        ok = fwrite(&path_len, sizeof(path_len), 1, f) == 1 &&
+             fwrite(entry->path, path_len, 1, f) == 1 &&
+             fwrite(&entry->hash, sizeof(entry->hash), 1, f) == 1 &&
+             fwrite(&tool_count, sizeof(tool_count), 1, f) == 1 &&
+             (tool_count == 0 ||
+              fwrite(entry->tools, sizeof(moc_tool_t), tool_count, f) == tool_count);
+    }
+
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Error: Failed to write cache %s\n", path);
+        remove(tmp_path);
+        return -1;
+    }
+
+    cache->dirty = false;
+    return 0;
+}
+
+void moc_cache_free(moc_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    for (int i = 0; i < cache->count; i++) {
+        free(cache->entries[i].path);
+        free(cache->entries[i].tools);
+    }
+    free(cache->entries);
+    memset(cache, 0, sizeof(*cache));
+}
@@ -6,6 +6,7 @@
  * ac_tool_t structure with unified signature.
  */
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,6 +55,21 @@ static const char *HEADER_TEMPLATE_ALL_TOOLS =
     " */\n"
     "extern const ac_tool_t *ALL_TOOLS[];\n"
     "extern const size_t ALL_TOOLS_COUNT;\n"
+    "\n"
+    "/**\n"
+    " * @brief Find a generated tool by name (perfect hash, no probing)\n"
+    " *\n"
+    " * @return Tool, NULL if name is not one of ALL_TOOLS\n"
+    " */\n"
+    "const ac_tool_t *ALL_TOOLS_find(const char *name);\n"
+    "\n"
+    "/**\n"
+    " * @brief ALL_TOOLS as a static table\n"
+    " *\n"
+    " * Usage (no per-tool copying):\n"
+    " *   ac_tool_registry_attach(registry, &ALL_TOOLS_TABLE);\n"
+    " */\n"
+    "extern const ac_tool_table_t ALL_TOOLS_TABLE;\n"
     "\n";
 
 static const char *HEADER_TEMPLATE_END =
@@ -73,72 +89,54 @@ static const char *SOURCE_TEMPLATE_START =
     " * DO NOT EDIT - This file is automatically generated\n"
     " */\n"
     "\n"
+    "#include <stdint.h>\n"
     "#include <stdio.h>\n"
     "#include <stdlib.h>\n"
     "#include <string.h>\n"
     "#include <stdbool.h>\n"
     "#include \"%s.h\"\n"
-    "#include \"cJSON.h\"\n"
     "\n"
-    "/* Include the original header with tool declarations */\n"
-    "#include \"%s\"\n"
+    "/* Include the original headers with tool declarations */\n";
+
+static const char *SOURCE_TEMPLATE_MACROS =
     "\n"
     "/*============================================================================\n"
     " * Helper Macros\n"
     " *============================================================================*/\n"
     "\n"
-    "#define WRAPPER_ERROR(msg) \\\n"
+    "/* Write {\"<key>\": <value>} into out and return */\n"
+    "#define WRAPPER_MEMBER(key, write_value) \\\n"
     "    do { \\\n"
-    "        cJSON *err = cJSON_CreateObject(); \\\n"
-    "        cJSON_AddStringToObject(err, \"error\", msg); \\\n"
-    "        char *result = cJSON_PrintUnformatted(err); \\\n"
-    "        cJSON_Delete(err); \\\n"
-    "        return result; \\\n"
+    "        ac_tool_out_object_begin(out); \\\n"
+    "        ac_tool_out_key(out, key); \\\n"
+    "        write_value; \\\n"
+    "        ac_tool_out_object_end(out); \\\n"
+    "        return; \\\n"
     "    } while(0)\n"
     "\n"
+    "#define WRAPPER_ERROR(msg) \\\n"
+    "    WRAPPER_MEMBER(\"error\", ac_tool_out_string(out, msg))\n"
+    "\n"
     "#define WRAPPER_RESULT_STRING(val) \\\n"
-    "    do { \\\n"
-    "        cJSON *res = cJSON_CreateObject(); \\\n"
-    "        cJSON_AddStringToObject(res, \"result\", val ? val : \"\"); \\\n"
-    "        char *result = cJSON_PrintUnformatted(res); \\\n"
-    "        cJSON_Delete(res); \\\n"
-    "        return result; \\\n"
-    "    } while(0)\n"
+    "    WRAPPER_MEMBER(\"result\", ac_tool_out_string(out, (val) ? (val) : \"\"))\n"
     "\n"
     "#define WRAPPER_RESULT_INT(val) \\\n"
-    "    do { \\\n"
-    "        cJSON *res = cJSON_CreateObject(); \\\n"
-    "        cJSON_AddNumberToObject(res, \"result\", (double)(val)); \\\n"
-    "        char *result = cJSON_PrintUnformatted(res); \\\n"
-    "        cJSON_Delete(res); \\\n"
-    "        return result; \\\n"
-    "    } while(0)\n"
+    "    WRAPPER_MEMBER(\"result\", ac_tool_out_int(out, (int)(val)))\n"
     "\n"
     "#define WRAPPER_RESULT_FLOAT(val) \\\n"
-    "    do { \\\n"
-    "        cJSON *res = cJSON_CreateObject(); \\\n"
-    "        cJSON_AddNumberToObject(res, \"result\", (double)(val)); \\\n"
-    "        char *result = cJSON_PrintUnformatted(res); \\\n"
-    "        cJSON_Delete(res); \\\n"
-    "        return result; \\\n"
-    "    } while(0)\n"
+    "    WRAPPER_MEMBER(\"result\", ac_tool_out_double(out, (double)(val)))\n"
     "\n"
     "#define WRAPPER_RESULT_BOOL(val) \\\n"
-    "    do { \\\n"
-    "        cJSON *res = cJSON_CreateObject(); \\\n"
-    "        cJSON_AddBoolToObject(res, \"result\", val); \\\n"
-    "        char *result = cJSON_PrintUnformatted(res); \\\n"
-    "        cJSON_Delete(res); \\\n"
-    "        return result; \\\n"
-    "    } while(0)\n"
+    "    WRAPPER_MEMBER(\"result\", ac_tool_out_bool(out, (val) ? 1 : 0))\n"
     "\n"
     "#define WRAPPER_RESULT_VOID() \\\n"
+    "    WRAPPER_MEMBER(\"result\", ac_tool_out_null(out))\n"
+    "\n"
+    "/* Asynchronous wrappers complete the call instead */\n"
+    "#define WRAPPER_ASYNC_ERROR(msg) \\\n"
     "    do { \\\n"
-    "        cJSON *res = cJSON_CreateObject(); \\\n"
-    "        cJSON_AddNullToObject(res, \"result\"); \\\n"
-    "        char *result = cJSON_PrintUnformatted(res); \\\n"
-    "        cJSON_Delete(res); \\\n"
-    "        return result; \\\n"
+    "        ac_tool_call_fail(call, msg); \\\n"
+    "        return; \\\n"
     "    } while(0)\n"
     "\n";
 
@@ -165,6 +163,36 @@ static void escape_json_string(const char *src, char *dest, size_t dest_sz) {
     dest[j] = '\0';
 }
 
+/**
+ * Write a JSON string value ("..." with quotes) as it appears inside a
+ * C string literal
+ *
+ * Escapes like cJSON_PrintUnformatted(), so the literal is byte for byte
+ * what the registry would serialize.
+ */
+static void emit_json_string(FILE *out, const char *src) {
+    fputs("\\\"", out);
+    for (const unsigned char *p = (const unsigned char *)src; *p; p++) {
+        switch (*p) {
+            case '"':  fputs("\\\\\\\"", out); break;
+            case '\\': fputs("\\\\\\\\", out); break;
+            case '\b': fputs("\\\\b", out); break;
+            case '\f': fputs("\\\\f", out); break;
+            case '\n': fputs("\\\\n", out); break;
+            case '\r': fputs("\\\\r", out); break;
+            case '\t': fputs("\\\\t", out); break;
+            default:
+                if (*p < 0x20) {
+                    fprintf(out, "\\\\u%04x", *p);
+                } else {
+                    fputc(*p, out);
+                }
+                break;
+        }
+    }
+    fputs("\\\"", out);
+}
+
 /**
  * Generate uppercase version of string for header guard
  */
@@ -215,26 +243,30 @@ static void generate_description(FILE *out, const moc_tool_t *tool) {
 
 /**
  * Generate parameters JSON Schema string constant
+ *
+ * Also emits the tool's ready-made entries of the tools array for each
+ * provider format (SCHEMA_OPENAI_x, SCHEMA_ANTHROPIC_x), built from the
+ * same literal so the registry never parses and reprints them.
  */
 static void generate_parameters_schema(FILE *out, const moc_tool_t *tool) {
-    fprintf(out, "static const char PARAMS_%s[] = \n", tool->name);
-    fprintf(out, "    \"{\\\"type\\\":\\\"object\\\",\"\n");
+    fprintf(out, "#define PARAMS_JSON_%s \\\n", tool->name);
+    fprintf(out, "    \"{\\\"type\\\":\\\"object\\\",\" \\\n");
     fprintf(out, "    \"\\\"properties\\\":{");
 
     for (int i = 0; i < tool->param_count; i++) {
         const moc_param_t *param = &tool->params[i];
-        char escaped_desc[MOC_MAX_DESC_LEN * 2];
-        escape_json_string(param->description, escaped_desc, sizeof(escaped_desc));
 
-        fprintf(out, "\\\"%s\\\":{\\\"type\\\":\\\"%s\\\",\\\"description\\\":\\\"%s\\\"}",
-                param->name, moc_type_to_json_schema(param->type), escaped_desc);
+        fprintf(out, "\\\"%s\\\":{\\\"type\\\":\\\"%s\\\",\\\"description\\\":",
+                param->name, moc_type_to_json_schema(param->type));
+        emit_json_string(out, param->description);
+        fprintf(out, "}");
 
         if (i < tool->param_count - 1) {
             fprintf(out, ",");
         }
     }
 
-    fprintf(out, "},\"\n");
+    fprintf(out, "},\" \\\n");
     fprintf(out, "    \"\\\"required\\\":[");
 
     for (int i = 0; i < tool->param_count; i++) {
@@ -244,7 +276,23 @@ static void generate_parameters_schema(FILE *out, const moc_tool_t *tool) {
         }
     }
 
-    fprintf(out, "]}\";\n\n");
+    fprintf(out, "]}\"\n\n");
+    fprintf(out, "static const char PARAMS_%s[] = PARAMS_JSON_%s;\n\n", tool->name, tool->name);
+
+    /* {"type":"function","function":{"name":...,"description":...,"parameters":{...}}} */
+    fprintf(out, "#define SCHEMA_OPENAI_%s \\\n", tool->name);
+    fprintf(out, "    \"{\\\"type\\\":\\\"function\\\",\\\"function\\\":{\\\"name\\\":\\\"%s\\\",\" \\\n",
+            tool->name);
+    fprintf(out, "    \"\\\"description\\\":");
+    emit_json_string(out, tool->description);
+    fprintf(out, ",\\\"parameters\\\":\" PARAMS_JSON_%s \"}}\"\n\n", tool->name);
+
+    /* {"name":...,"description":...,"input_schema":{...}} */
+    fprintf(out, "#define SCHEMA_ANTHROPIC_%s \\\n", tool->name);
+    fprintf(out, "    \"{\\\"name\\\":\\\"%s\\\",\" \\\n", tool->name);
+    fprintf(out, "    \"\\\"description\\\":");
+    emit_json_string(out, tool->description);
+    fprintf(out, ",\\\"input_schema\\\":\" PARAMS_JSON_%s \"}\"\n\n", tool->name);
 }
 
 /*============================================================================
@@ -254,95 +302,126 @@ static void generate_parameters_schema(FILE *out, const moc_tool_t *tool) {
 /**
  * Generate argument extraction code for a parameter
  */
-static void generate_param_extraction(FILE *out, const moc_param_t *param) {
+static void generate_param_lookup(FILE *out, const moc_param_t *param) {
+    fprintf(out, "    const ac_tool_arg_t *in_%s = ac_tool_args_get(args, \"%s\");\n",
+            param->name, param->name);
+}
+
+static void generate_param_check(FILE *out, const moc_param_t *param, const char *type,
+                                 bool async) {
+    fprintf(out, "    if (!in_%s || in_%s->type != %s) {\n", param->name, param->name, type);
+    fprintf(out, "        %s(\"Missing or invalid parameter: %s\");\n",
+            async ? "WRAPPER_ASYNC_ERROR" : "WRAPPER_ERROR", param->name);
+    fprintf(out, "    }\n");
+}
+
+static void generate_param_extraction(FILE *out, const moc_param_t *param, bool async) {
+    generate_param_lookup(out, param);
+
     switch (param->type) {
         case MOC_TYPE_STRING:
-            fprintf(out, "    cJSON *json_%s = cJSON_GetObjectItem(root, \"%s\");\n",
-                    param->name, param->name);
-            fprintf(out, "    if (!json_%s || !cJSON_IsString(json_%s)) {\n",
-                    param->name, param->name);
-            fprintf(out, "        cJSON_Delete(root);\n");
-            fprintf(out, "        WRAPPER_ERROR(\"Missing or invalid parameter: %s\");\n",
-                    param->name);
-            fprintf(out, "    }\n");
-            fprintf(out, "    const char *arg_%s = cJSON_GetStringValue(json_%s);\n\n",
-                    param->name, param->name);
+            generate_param_check(out, param, "AC_TOOL_ARG_STRING", async);
+            fprintf(out, "    const char *arg_%s = in_%s->str;\n\n", param->name, param->name);
             break;
 
         case MOC_TYPE_INT:
-            fprintf(out, "    cJSON *json_%s = cJSON_GetObjectItem(root, \"%s\");\n",
-                    param->name, param->name);
-            fprintf(out, "    if (!json_%s || !cJSON_IsNumber(json_%s)) {\n",
-                    param->name, param->name);
-            fprintf(out, "        cJSON_Delete(root);\n");
-            fprintf(out, "        WRAPPER_ERROR(\"Missing or invalid parameter: %s\");\n",
-                    param->name);
-            fprintf(out, "    }\n");
-            fprintf(out, "    int arg_%s = (int)cJSON_GetNumberValue(json_%s);\n\n",
-                    param->name, param->name);
+            generate_param_check(out, param, "AC_TOOL_ARG_NUMBER", async);
+            fprintf(out, "    int arg_%s = (int)in_%s->number;\n\n", param->name, param->name);
             break;
 
         case MOC_TYPE_FLOAT:
-            fprintf(out, "    cJSON *json_%s = cJSON_GetObjectItem(root, \"%s\");\n",
-                    param->name, param->name);
-            fprintf(out, "    if (!json_%s || !cJSON_IsNumber(json_%s)) {\n",
-                    param->name, param->name);
-            fprintf(out, "        cJSON_Delete(root);\n");
-            fprintf(out, "        WRAPPER_ERROR(\"Missing or invalid parameter: %s\");\n",
-                    param->name);
-            fprintf(out, "    }\n");
-            fprintf(out, "    double arg_%s = cJSON_GetNumberValue(json_%s);\n\n",
-                    param->name, param->name);
+            generate_param_check(out, param, "AC_TOOL_ARG_NUMBER", async);
+            fprintf(out, "    double arg_%s = in_%s->number;\n\n", param->name, param->name);
             break;
 
         case MOC_TYPE_BOOL:
-            fprintf(out, "    cJSON *json_%s = cJSON_GetObjectItem(root, \"%s\");\n",
-                    param->name, param->name);
-            fprintf(out, "    if (!json_%s || !cJSON_IsBool(json_%s)) {\n",
-                    param->name, param->name);
-            fprintf(out, "        cJSON_Delete(root);\n");
-            fprintf(out, "        WRAPPER_ERROR(\"Missing or invalid parameter: %s\");\n",
-                    param->name);
-            fprintf(out, "    }\n");
-            fprintf(out, "    bool arg_%s = cJSON_IsTrue(json_%s);\n\n",
-                    param->name, param->name);
+            generate_param_check(out, param, "AC_TOOL_ARG_BOOL", async);
+            fprintf(out, "    bool arg_%s = in_%s->boolean != 0;\n\n", param->name, param->name);
             break;
 
         default:
             fprintf(out, "    /* Unknown type for parameter %s, treating as string */\n",
                     param->name);
-            fprintf(out, "    cJSON *json_%s = cJSON_GetObjectItem(root, \"%s\");\n",
+            fprintf(out, "    const char *arg_%s = !in_%s ? \"\" :\n", param->name, param->name);
+            fprintf(out, "        in_%s->type == AC_TOOL_ARG_STRING ? in_%s->str : NULL;\n\n",
                     param->name, param->name);
-            fprintf(out, "    const char *arg_%s = json_%s ? cJSON_GetStringValue(json_%s) : \"\";\n\n",
-                    param->name, param->name, param->name);
             break;
     }
 }
 
 /**
- * Generate wrapper function with new unified signature
+ * Generate wrapper functions of an asynchronous tool: the entry point the
+ * registry starts, passing the call through to the tool, and the
+ * ac_tool_fn form for direct calls, which waits for the completion
  */
-static void generate_wrapper(FILE *out, const moc_tool_t *tool) {
+static void generate_async_wrapper(FILE *out, const moc_tool_t *tool) {
     fprintf(out, "/**\n");
-    fprintf(out, " * @brief Wrapper for %s\n", tool->name);
+    fprintf(out, " * @brief Asynchronous wrapper for %s\n", tool->name);
     fprintf(out, " */\n");
-    /* New signature: (ctx, args_json, priv) */
+    fprintf(out, "static void exec_async_%s(\n", tool->name);
+    fprintf(out, "    const ac_tool_ctx_t *ctx,\n");
+    fprintf(out, "    const ac_tool_args_t *args,\n");
+    fprintf(out, "    ac_tool_call_t *call,\n");
+    fprintf(out, "    void *priv\n");
+    fprintf(out, ") {\n");
+    fprintf(out, "    (void)ctx;\n");
+    fprintf(out, "    (void)priv; /* Not used for builtin tools */\n");
+    if (tool->param_count == 0) {
+        fprintf(out, "    (void)args;\n");
+    }
+    fprintf(out, "\n");
+
+    for (int i = 0; i < tool->param_count; i++) {
+        generate_param_extraction(out, &tool->params[i], true);
+    }
+
+    /* Start the actual function; it completes the call */
+    fprintf(out, "    /* Start the actual function, which completes the call */\n");
+    fprintf(out, "    %s(", tool->name);
+    for (int i = 0; i < tool->param_count; i++) {
+        fprintf(out, "arg_%s, ", tool->params[i].name);
+    }
+    fprintf(out, "call);\n");
+    fprintf(out, "}\n\n");
+
     fprintf(out, "static char* exec_%s(\n", tool->name);
     fprintf(out, "    const ac_tool_ctx_t *ctx,\n");
     fprintf(out, "    const char *args_json,\n");
     fprintf(out, "    void *priv\n");
     fprintf(out, ") {\n");
-    fprintf(out, "    (void)ctx;  /* May be unused */\n");
+    fprintf(out, "    return ac_tool_args_await(exec_async_%s, ctx, args_json, priv);\n", tool->name);
+    fprintf(out, "}\n\n");
+}
+
+/**
+ * Generate wrapper functions: the result-writer entry point the registry
+ * calls, and the ac_tool_fn form for direct calls
+ */
+static void generate_wrapper(FILE *out, const moc_tool_t *tool) {
+    if (tool->is_async) {
+        generate_async_wrapper(out, tool);
+        return;
+    }
+
+    fprintf(out, "/**\n");
+    fprintf(out, " * @brief Wrapper for %s\n", tool->name);
+    fprintf(out, " */\n");
+    fprintf(out, "static void exec_write_%s(\n", tool->name);
+    fprintf(out, "    const ac_tool_ctx_t *ctx,\n");
+    fprintf(out, "    const ac_tool_args_t *args,\n");
+    fprintf(out, "    ac_tool_out_t *out,\n");
+    fprintf(out, "    void *priv\n");
+    fprintf(out, ") {\n");
+    fprintf(out, "    (void)ctx;\n");
     fprintf(out, "    (void)priv; /* Not used for builtin tools */\n");
+    if (tool->param_count == 0) {
+        fprintf(out, "    (void)args;\n");
+    }
     fprintf(out, "\n");
-    fprintf(out, "    cJSON *root = cJSON_Parse(args_json);\n");
-    fprintf(out, "    if (!root) {\n");
-    fprintf(out, "        WRAPPER_ERROR(\"Failed to parse JSON arguments\");\n");
-    fprintf(out, "    }\n\n");
 
     /* Generate parameter extraction */
     for (int i = 0; i < tool->param_count; i++) {
-        generate_param_extraction(out, &tool->params[i]);
+        generate_param_extraction(out, &tool->params[i], false);
     }
 
     /* Generate function call */
@@ -370,9 +449,6 @@ static void generate_wrapper(FILE *out, const moc_tool_t *tool) {
     }
     fprintf(out, ");\n\n");
 
-    /* Clean up and return result */
-    fprintf(out, "    cJSON_Delete(root);\n\n");
-
     switch (tool->return_type_cat) {
         case MOC_TYPE_STRING:
             fprintf(out, "    WRAPPER_RESULT_STRING(result);\n");
@@ -395,6 +471,15 @@ static void generate_wrapper(FILE *out, const moc_tool_t *tool) {
     }
 
     fprintf(out, "}\n\n");
+
+    /* Unified signature: (ctx, args_json, priv) */
+    fprintf(out, "static char* exec_%s(\n", tool->name);
+    fprintf(out, "    const ac_tool_ctx_t *ctx,\n");
+    fprintf(out, "    const char *args_json,\n");
+    fprintf(out, "    void *priv\n");
+    fprintf(out, ") {\n");
+    fprintf(out, "    return ac_tool_args_write(exec_write_%s, ctx, args_json, priv);\n", tool->name);
+    fprintf(out, "}\n\n");
 }
 
 /**
@@ -406,10 +491,210 @@ static void generate_tool_definition(FILE *out, const moc_tool_t *tool) {
     fprintf(out, "    .description = DESC_%s,\n", tool->name);
     fprintf(out, "    .parameters = PARAMS_%s,\n", tool->name);
     fprintf(out, "    .execute = exec_%s,\n", tool->name);
-    fprintf(out, "    .priv = NULL\n");
+    fprintf(out, "    .priv = NULL,\n");
+    if (tool->parallel_safe) {
+        fprintf(out, "    .parallel_safe = 1,\n");
+    }
+    fprintf(out, "    .schema_openai = SCHEMA_OPENAI_%s,\n", tool->name);
+    fprintf(out, "    .schema_anthropic = SCHEMA_ANTHROPIC_%s,\n", tool->name);
+    if (tool->is_async) {
+        fprintf(out, "    .execute_async = exec_async_%s\n", tool->name);
+    } else {
+        fprintf(out, "    .execute_write = exec_write_%s\n", tool->name);
+    }
     fprintf(out, "};\n\n");
 }
 
+/*============================================================================
+ * Perfect Hash
+ *============================================================================*/
+
+/* Hash emitted into generated sources; must match tools_hash() below */
+static const char *HASH_FUNCTION =
+    "static uint32_t tools_hash(const char *s, uint32_t seed) {\n"
+    "    uint32_t h = 2166136261u ^ seed;\n"
+    "    while (*s) {\n"
+    "        h = (h ^ (unsigned char)*s++) * 16777619u;\n"
+    "    }\n"
+    "    h ^= h >> 16;\n"
+    "    h *= 0x85ebca6bu;\n"
+    "    h ^= h >> 13;\n"
+    "    h *= 0xc2b2ae35u;\n"
+    "    h ^= h >> 16;\n"
+    "    return h;\n"
+    "}\n\n";
+
+/** Seeded FNV-1a with a murmur3 finalizer */
+static uint32_t tools_hash(const char *s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/* Give up on a bucket after this many seeds (never reached in practice) */
+#define PHASH_MAX_SEED 1000000u
+
+/**
+ * Build a hash-and-displace perfect hash over the tool names
+ *
+ * Names fall into buckets by tools_hash(name, 0). Largest bucket first,
+ * each bucket gets the first seed d for which tools_hash(name, d) puts
+ * all its names into free slots. Lookup is then two hashes and one
+ * strcmp: slot = tools_hash(name, seeds[bucket]) % slot_count.
+ *
+ * @param slots  Receives tool index + 1 per slot (0 = empty)
+ * @param seeds  Receives one seed per bucket
+ * @return 0 on success, -1 if no seed was found
+ */
+static int build_perfect_hash(const moc_ctx_t *ctx, uint32_t bucket_count,
+                              uint32_t slot_count, uint32_t *seeds, int *slots) {
+    int order[MOC_MAX_TOOLS];
+    uint32_t bucket_of[MOC_MAX_TOOLS];
+    uint32_t size[MOC_MAX_TOOLS] = {0};
+    int n = ctx->tool_count;
+
+    for (int i = 0; i < n; i++) {
+        bucket_of[i] = tools_hash(ctx->tools[i].name, 0) % bucket_count;
+        size[bucket_of[i]]++;
+        order[i] = i;
+    }
+    /* Tools of larger buckets first (insertion sort; n is small) */
+    for (int i = 1; i < n; i++) {
+        int t = order[i];
+        int j = i;
+        while (j > 0 && (size[bucket_of[order[j - 1]]] < size[bucket_of[t]] ||
+                         (size[bucket_of[order[j - 1]]] == size[bucket_of[t]] &&
+                          bucket_of[order[j - 1]] > bucket_of[t]))) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = t;
+    }
+
+    memset(slots, 0, sizeof(int) * slot_count);
+    for (uint32_t b = 0; b < bucket_count; b++) {
+        seeds[b] = 0;
+    }
+
+    for (int start = 0; start < n;) {
+        uint32_t bucket = bucket_of[order[start]];
+        int end = start;
+        while (end < n && bucket_of[order[end]] == bucket) {
+            end++;
+        }
+
+        uint32_t seed;
+        for (seed = 1; seed < PHASH_MAX_SEED; seed++) {
+            uint32_t taken[MOC_MAX_TOOLS];
+            int ok = 1;
+            for (int k = start; k < end && ok; k++) {
+                taken[k - start] = tools_hash(ctx->tools[order[k]].name, seed) % slot_count;
+                if (slots[taken[k - start]] != 0) {
+                    ok = 0;
+                }
+                for (int j = start; j < k && ok; j++) {
+                    if (taken[j - start] == taken[k - start]) {
+                        ok = 0;
+                    }
+                }
+            }
+            if (ok) {
+                for (int k = start; k < end; k++) {
+                    slots[taken[k - start]] = order[k] + 1;
+                }
+                seeds[bucket] = seed;
+                break;
+            }
+        }
+        if (seed == PHASH_MAX_SEED) {
+            return -1;
+        }
+        start = end;
+    }
+    return 0;
+}
+
+/**
+ * Generate a whole tools array literal by concatenating per-tool entries
+ */
+static void generate_schema_array(FILE *out, const moc_ctx_t *ctx,
+                                  const char *field, const char *prefix) {
+    fprintf(out, "    .%s =\n        \"[\"", field);
+    for (int i = 0; i < ctx->tool_count; i++) {
+        fprintf(out, "%s\n        %s_%s", i > 0 ? " \",\"" : "", prefix, ctx->tools[i].name);
+    }
+    fprintf(out, "\n        \"]\"");
+}
+
+/**
+ * Generate ALL_TOOLS_find() and ALL_TOOLS_TABLE
+ */
+static int generate_perfect_hash(FILE *out, const moc_ctx_t *ctx) {
+    uint32_t bucket_count = (uint32_t)ctx->tool_count / 2 + 1;
+    uint32_t slot_count = (uint32_t)ctx->tool_count + (uint32_t)ctx->tool_count / 4 + 1;
+    uint32_t seeds[MOC_MAX_TOOLS];
+    int slots[MOC_MAX_TOOLS * 2];
+
+    for (int i = 0; i < ctx->tool_count; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(ctx->tools[i].name, ctx->tools[j].name) == 0) {
+                fprintf(stderr, "Error: Duplicate tool name: %s\n", ctx->tools[i].name);
+                return -1;
+            }
+        }
+    }
+    if (build_perfect_hash(ctx, bucket_count, slot_count, seeds, slots) != 0) {
+        fprintf(stderr, "Error: Failed to build perfect hash over tool names\n");
+        return -1;
+    }
+
+    fprintf(out, "/*============================================================================\n");
+    fprintf(out, " * Name Lookup (perfect hash)\n");
+    fprintf(out, " *============================================================================*/\n\n");
+
+    fprintf(out, "%s", HASH_FUNCTION);
+
+    fprintf(out, "static const uint32_t ALL_TOOLS_SEEDS[%u] = {", bucket_count);
+    for (uint32_t b = 0; b < bucket_count; b++) {
+        fprintf(out, "%s%u", b % 8 == 0 ? "\n    " : " ", seeds[b]);
+        if (b + 1 < bucket_count) fputc(',', out);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "static const ac_tool_t *const ALL_TOOLS_SLOTS[%u] = {\n", slot_count);
+    for (uint32_t s = 0; s < slot_count; s++) {
+        if (slots[s] != 0) {
+            fprintf(out, "    &TOOL_%s,\n", ctx->tools[slots[s] - 1].name);
+        } else {
+            fprintf(out, "    NULL,\n");
+        }
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "const ac_tool_t *ALL_TOOLS_find(const char *name) {\n");
+    fprintf(out, "    uint32_t seed = ALL_TOOLS_SEEDS[tools_hash(name, 0) %% %uu];\n", bucket_count);
+    fprintf(out, "    const ac_tool_t *tool = ALL_TOOLS_SLOTS[tools_hash(name, seed) %% %uu];\n", slot_count);
+    fprintf(out, "    return tool && strcmp(tool->name, name) == 0 ? tool : NULL;\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "const ac_tool_table_t ALL_TOOLS_TABLE = {\n");
+    fprintf(out, "    .tools = ALL_TOOLS,\n");
+    fprintf(out, "    .count = %d,\n", ctx->tool_count);
+    fprintf(out, "    .find = ALL_TOOLS_find,\n");
+    generate_schema_array(out, ctx, "schema_openai", "SCHEMA_OPENAI");
+    fprintf(out, ",\n");
+    generate_schema_array(out, ctx, "schema_anthropic", "SCHEMA_ANTHROPIC");
+    fprintf(out, "\n};\n");
+    return 0;
+}
+
 /*============================================================================
  * Main Generation Functions
  *============================================================================*/
@@ -456,11 +741,12 @@ int moc_generate_source(moc_ctx_t *ctx, FILE *out) {
         base_name[sizeof(base_name) - 1] = '\0';
     }
 
-    /* Get input file base name */
-    const char *input_basename = get_basename(ctx->input_file);
-
-    /* Write source start */
-    fprintf(out, SOURCE_TEMPLATE_START, base_name, base_name, input_basename);
+    /* Write source start, including every input by base name */
+    fprintf(out, SOURCE_TEMPLATE_START, base_name, base_name);
+    for (int i = 0; i < ctx->input_count; i++) {
+        fprintf(out, "#include \"%s\"\n", get_basename(ctx->inputs[i]));
+    }
+    fprintf(out, "%s", SOURCE_TEMPLATE_MACROS);
 
     /* Generate description and parameters schema for each tool */
     fprintf(out, "/*============================================================================\n");
@@ -503,8 +789,70 @@ int moc_generate_source(moc_ctx_t *ctx, FILE *out) {
     fprintf(out, "    NULL  /* Sentinel */\n");
     fprintf(out, "};\n\n");
 
-    fprintf(out, "const size_t ALL_TOOLS_COUNT = %d;\n", ctx->tool_count);
+    fprintf(out, "const size_t ALL_TOOLS_COUNT = %d;\n\n", ctx->tool_count);
+
+    return generate_perfect_hash(out, ctx);
+}
+
+/**
+ * Generate into path.tmp and replace path only if the contents differ
+ */
+static int write_if_changed(moc_ctx_t *ctx, const char *path,
+                            int (*generate)(moc_ctx_t *ctx, FILE *out)) {
+    char tmp_path[520];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *tmp = fopen(tmp_path, "w+b");
+    if (!tmp) {
+        fprintf(stderr, "Error: Failed to open %s for writing\n", tmp_path);
+        return -1;
+    }
+    if (generate(ctx, tmp) != 0) {
+        fclose(tmp);
+        remove(tmp_path);
+        return -1;
+    }
+
+    /* Compare with the existing file */
+    bool same = false;
+    FILE *old = fopen(path, "rb");
+    if (old) {
+        char a[4096], b[4096];
+        size_t na, nb;
+        rewind(tmp);
+        same = true;
+        do {
+            na = fread(a, 1, sizeof(a), tmp);
+            nb = fread(b, 1, sizeof(b), old);
+            if (na != nb || memcmp(a, b, na) != 0) {
+                same = false;
+                break;
+            }
+        } while (na > 0);
+        fclose(old);
+    }
+
+    if (fclose(tmp) != 0) {
+        remove(tmp_path);
+        fprintf(stderr, "Error: Failed to write %s\n", tmp_path);
+        return -1;
+    }
+    if (same) {
+        remove(tmp_path);
+        if (ctx->verbose) {
+            printf("Unchanged: %s\n", path);
+        }
+        return 0;
+    }
+    if (rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        fprintf(stderr, "Error: Failed to write %s\n", path);
+        return -1;
+    }
 
+    if (ctx->verbose) {
+        printf("Generated: %s\n", path);
+    }
     return 0;
 }
 
@@ -523,45 +871,60 @@ int moc_generate(moc_ctx_t *ctx) {
         return 0;
     }
 
-    /* Generate header file */
-    char header_path[512];
-    snprintf(header_path, sizeof(header_path), "%s.h", ctx->output_base);
+    char path[512];
 
-    FILE *header_file = fopen(header_path, "w");
-    if (!header_file) {
-        fprintf(stderr, "Error: Failed to open %s for writing\n", header_path);
+    snprintf(path, sizeof(path), "%s.h", ctx->output_base);
+    if (write_if_changed(ctx, path, moc_generate_header) != 0) {
         return -1;
     }
 
-    if (moc_generate_header(ctx, header_file) != 0) {
-        fclose(header_file);
+    snprintf(path, sizeof(path), "%s.c", ctx->output_base);
+    if (write_if_changed(ctx, path, moc_generate_source) != 0) {
         return -1;
     }
-    fclose(header_file);
 
-    if (ctx->verbose) {
-        printf("Generated: %s\n", header_path);
-    }
+    return 0;
+}
 
-    /* Generate source file */
-    char source_path[512];
-    snprintf(source_path, sizeof(source_path), "%s.c", ctx->output_base);
+/**
+ * Write a path with the characters Make and Ninja treat specially escaped
+ */
+static void write_dep_path(FILE *out, const char *path) {
+    for (const char *p = path; *p; p++) {
+        if (*p == ' ' || *p == '#') {
+            fputc('\\', out);
+        } else if (*p == '$') {
+            fputc('$', out);
+        }
+        fputc(*p, out);
+    }
+}
 
-    FILE *source_file = fopen(source_path, "w");
-    if (!source_file) {
-        fprintf(stderr, "Error: Failed to open %s for writing\n", source_path);
+int moc_write_depfile(const moc_ctx_t *ctx, const char *path) {
+    if (!ctx->output_base) {
+        fprintf(stderr, "Error: A depfile needs an output base name (-o)\n");
         return -1;
     }
 
-    if (moc_generate_source(ctx, source_file) != 0) {
-        fclose(source_file);
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Failed to open %s for writing\n", path);
         return -1;
     }
-    fclose(source_file);
 
-    if (ctx->verbose) {
-        printf("Generated: %s\n", source_path);
+    write_dep_path(out, ctx->output_base);
+    fputs(".c ", out);
+    write_dep_path(out, ctx->output_base);
+    fputs(".h:", out);
+    for (int i = 0; i < ctx->input_count; i++) {
+        fputs(" \\\n  ", out);
+        write_dep_path(out, ctx->inputs[i]);
     }
+    fputc('\n', out);
 
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Error: Failed to write %s\n", path);
+        return -1;
+    }
     return 0;
 }
@@ -196,6 +196,7 @@ static int parse_param_tag(const char *start, const char *end, moc_tool_t *tool)
  * - @description: Description text
  * - @param name Description
  * - @param: name Description (with colon)
+ * - @parallel_safe (the tool may run concurrently with other tools)
  *
  * Both C-style and C++-style comments are supported:
  * - Block comments: / * ... * /
@@ -248,6 +249,10 @@ int moc_parse_comment(const char *comment_text, size_t comment_len, moc_tool_t *
                 p = tag_end;
                 continue;
             }
+            /* Check for @parallel_safe tag (before @param, a prefix of it) */
+            else if (strncmp(p, "@parallel_safe", 14) == 0) {
+                tool->parallel_safe = true;
+            }
             /* Check for @param tag */
             else if (strncmp(p, "@param", 6) == 0) {
                 const char *tag_end = p + 6;
@@ -487,6 +487,20 @@ int moc_parse(moc_ctx_t *ctx) {
             parse_parameters(params_node, ctx->source_code, tool);
         }
 
+        /* A trailing ac_tool_call_t* makes it asynchronous: MOC passes the
+         * call in, the function completes it later */
+        if (tool->param_count > 0 &&
+            strcmp(tool->params[tool->param_count - 1].type_str, "ac_tool_call_t*") == 0) {
+            if (tool->return_type_cat != MOC_TYPE_VOID) {
+                fprintf(stderr, "Error: %s:%d: asynchronous tool %s must return void\n",
+                        ctx->input_file, tool->line_number, tool->name);
+                cleanup_parser_state(&state);
+                return -1;
+            }
+            tool->is_async = true;
+            tool->param_count--;
+        }
+
         /* Find and parse preceding comment */
         TSNode comment_node = find_preceding_comment(decl_node, root, ctx->source_code);
         if (!ts_node_is_null(comment_node) &&
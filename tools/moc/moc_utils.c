@@ -62,9 +62,21 @@ int moc_init(moc_ctx_t *ctx, const char *input_file, const char *output_base) {
     }
 
     memset(ctx, 0, sizeof(moc_ctx_t));
-    ctx->input_file = input_file;
     ctx->output_base = output_base;
 
+    return moc_add_input(ctx, input_file);
+}
+
+int moc_add_input(moc_ctx_t *ctx, const char *input_file) {
+    if (!ctx || !input_file) {
+        fprintf(stderr, "Error: Invalid arguments to moc_add_input\n");
+        return -1;
+    }
+    if (ctx->input_count >= MOC_MAX_INPUTS) {
+        fprintf(stderr, "Error: Too many input files (max %d)\n", MOC_MAX_INPUTS);
+        return -1;
+    }
+
     /* Read input file */
     size_t source_len;
     char *source = read_file(input_file, &source_len);
@@ -73,8 +85,11 @@ int moc_init(moc_ctx_t *ctx, const char *input_file, const char *output_base) {
         return -1;
     }
 
+    free((void *)ctx->source_code);
     ctx->source_code = source;
     ctx->source_len = source_len;
+    ctx->input_file = input_file;
+    ctx->inputs[ctx->input_count++] = input_file;
 
     return 0;
 }
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include "sample_tools.h"
 
@@ -52,6 +53,42 @@ void print_greeting(const char* name) {
     }
 }
 
+typedef struct {
+    char country[64];
+    ac_tool_call_t *call;
+} capital_lookup_t;
+
+/* Stands in for an I/O completion callback */
+static void *capital_lookup_run(void *arg) {
+    capital_lookup_t *lookup = (capital_lookup_t *)arg;
+
+    if (strcmp(lookup->country, "France") == 0) {
+        ac_tool_call_complete_string(lookup->call, "Paris");
+    } else {
+        ac_tool_call_fail(lookup->call, "Unknown country");
+    }
+    free(lookup);
+    return NULL;
+}
+
+void lookup_capital(const char* country, ac_tool_call_t* call) {
+    capital_lookup_t *lookup = malloc(sizeof(capital_lookup_t));
+    if (!lookup) {
+        ac_tool_call_fail(call, "Out of memory");
+        return;
+    }
+    snprintf(lookup->country, sizeof(lookup->country), "%s", country);
+    lookup->call = call;
+
+    /* Complete from another thread, as an HTTP engine would */
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, capital_lookup_run, lookup) != 0) {
+        capital_lookup_run(lookup);
+        return;
+    }
+    pthread_detach(thread);
+}
+
 int helper_function(int x) {
     return x * 2;
 }
@@ -8,6 +8,8 @@
 #ifndef SAMPLE_TOOLS_H
 #define SAMPLE_TOOLS_H
 
+#include <arc/tool.h>
+
 /* AC_TOOL_META marker - recognized by MOC but ignored by compiler */
 #define AC_TOOL_META
 
@@ -47,6 +49,13 @@ AC_TOOL_META bool is_positive(int value);
  */
 AC_TOOL_META void print_greeting(const char* name);
 
+/**
+ * @description: Look up the capital of a country
+ * @param: country  The country name
+ * @parallel_safe
+ */
+AC_TOOL_META void lookup_capital(const char* country, ac_tool_call_t* call);
+
 /* This function is NOT marked with AC_TOOL_META - should be ignored */
 int helper_function(int x);
 
@@ -46,12 +46,7 @@ static int pass_count = 0;
  *============================================================================*/
 
 static const ac_tool_t *find_tool(const char *name) {
-    for (size_t i = 0; ALL_TOOLS[i] != NULL; i++) {
-        if (strcmp(ALL_TOOLS[i]->name, name) == 0) {
-            return ALL_TOOLS[i];
-        }
-    }
-    return NULL;
+    return ALL_TOOLS_find(name);
 }
 
 /*============================================================================
@@ -61,12 +56,12 @@ static const ac_tool_t *find_tool(const char *name) {
 void test_tool_count(void) {
     TEST("Tool count");
     
-    /* We defined 5 AC_TOOL_META functions in sample_tools.h */
-    if (ALL_TOOLS_COUNT >= 4 && ALL_TOOLS_COUNT <= 5) {
+    /* We defined 6 AC_TOOL_META functions in sample_tools.h */
+    if (ALL_TOOLS_COUNT >= 5 && ALL_TOOLS_COUNT <= 6) {
         PASS();
     } else {
         char msg[64];
-        snprintf(msg, sizeof(msg), "Expected 4-5 tools, got %zu", ALL_TOOLS_COUNT);
+        snprintf(msg, sizeof(msg), "Expected 5-6 tools, got %zu", ALL_TOOLS_COUNT);
         FAIL(msg);
     }
 }
@@ -301,6 +296,123 @@ void test_tool_description(void) {
     PASS();
 }
 
+void test_perfect_hash_find(void) {
+    TEST("Perfect hash lookup");
+
+    /* Every generated tool resolves to itself */
+    for (size_t i = 0; ALL_TOOLS[i] != NULL; i++) {
+        if (ALL_TOOLS_find(ALL_TOOLS[i]->name) != ALL_TOOLS[i]) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "ALL_TOOLS_find missed '%s'", ALL_TOOLS[i]->name);
+            FAIL(msg);
+            return;
+        }
+    }
+
+    if (ALL_TOOLS_find("no_such_tool") || ALL_TOOLS_find("") ||
+        ALL_TOOLS_find("add_two_number")) {
+        FAIL("ALL_TOOLS_find matched an unknown name");
+        return;
+    }
+
+    if (ALL_TOOLS_TABLE.count != ALL_TOOLS_COUNT ||
+        ALL_TOOLS_TABLE.find != ALL_TOOLS_find) {
+        FAIL("ALL_TOOLS_TABLE does not describe ALL_TOOLS");
+        return;
+    }
+    PASS();
+}
+
+/* Serialize a tool's entry the way the registry does without literals */
+static char *print_entry(const ac_tool_t *tool, int openai) {
+    cJSON *obj = cJSON_CreateObject();
+    cJSON *target = obj;
+    if (openai) {
+        cJSON_AddStringToObject(obj, "type", "function");
+        target = cJSON_AddObjectToObject(obj, "function");
+    }
+    cJSON_AddStringToObject(target, "name", tool->name);
+    cJSON_AddStringToObject(target, "description", tool->description);
+    cJSON_AddItemToObject(target, openai ? "parameters" : "input_schema",
+                          cJSON_Parse(tool->parameters));
+    char *text = cJSON_PrintUnformatted(obj);
+    cJSON_Delete(obj);
+    return text;
+}
+
+void test_preserialized_schemas(void) {
+    TEST("Pre-serialized schemas");
+
+    for (size_t i = 0; ALL_TOOLS[i] != NULL; i++) {
+        const ac_tool_t *tool = ALL_TOOLS[i];
+        for (int openai = 0; openai <= 1; openai++) {
+            const char *literal = openai ? tool->schema_openai : tool->schema_anthropic;
+            char *expected = print_entry(tool, openai);
+            int same = literal && expected && strcmp(literal, expected) == 0;
+            cJSON_free(expected);
+            if (!same) {
+                char msg[128];
+                snprintf(msg, sizeof(msg), "Tool '%s' %s entry differs from cJSON",
+                         tool->name, openai ? "OpenAI" : "Anthropic");
+                FAIL(msg);
+                return;
+            }
+        }
+    }
+
+    cJSON *array = cJSON_Parse(ALL_TOOLS_TABLE.schema_anthropic);
+    int ok = array && cJSON_GetArraySize(array) == (int)ALL_TOOLS_COUNT;
+    cJSON_Delete(array);
+    array = cJSON_Parse(ALL_TOOLS_TABLE.schema_openai);
+    ok = ok && array && cJSON_GetArraySize(array) == (int)ALL_TOOLS_COUNT;
+    cJSON_Delete(array);
+    if (!ok) {
+        FAIL("ALL_TOOLS_TABLE schema arrays are not valid JSON");
+        return;
+    }
+    PASS();
+}
+
+void test_async_wrapper(void) {
+    TEST("Asynchronous tool");
+
+    const ac_tool_t *tool = find_tool("lookup_capital");
+    if (!tool || !tool->execute_async || tool->execute_write || !tool->parallel_safe) {
+        FAIL("lookup_capital is not an async, parallel-safe tool");
+        return;
+    }
+
+    /* The call parameter is not part of the schema */
+    cJSON *params = cJSON_Parse(tool->parameters);
+    cJSON *props = cJSON_GetObjectItem(params, "properties");
+    int schema_ok = props && cJSON_GetArraySize(props) == 1 &&
+                    cJSON_GetObjectItem(props, "country");
+    cJSON_Delete(params);
+    if (!schema_ok) {
+        FAIL("Schema should only hold 'country'");
+        return;
+    }
+
+    /* Direct calls wait for the completion from the other thread */
+    char *result = tool->execute(NULL, "{\"country\":\"France\"}", NULL);
+    int ok = result && strcmp(result, "{\"result\":\"Paris\"}") == 0;
+    free(result);
+
+    result = tool->execute(NULL, "{\"country\":\"Atlantis\"}", NULL);
+    ok = ok && result && strcmp(result, "{\"error\":\"Unknown country\"}") == 0;
+    free(result);
+
+    result = tool->execute(NULL, "{}", NULL);
+    ok = ok && result && strstr(result, "Missing or invalid parameter: country");
+    free(result);
+
+    if (!ok) {
+        FAIL("Unexpected async result");
+        return;
+    }
+    PASS();
+}
+
 /*============================================================================
  * Main
  *============================================================================*/
@@ -316,6 +428,9 @@ int main(void) {
     test_error_handling();
     test_parameters_format();
     test_tool_description();
+    test_perfect_hash_find();
+    test_preserialized_schemas();
+    test_async_wrapper();
     
     printf("\n=== Results ===\n");
     printf("Passed: %d/%d\n", pass_count, test_count);
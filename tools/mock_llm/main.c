@@ -0,0 +1,1052 @@
+/**
+ * @file main.c
+ * @brief mock_llm - Scriptable OpenAI / Anthropic endpoint for load tests
+ *
+ * Serves the two wire protocols ac_core speaks, streaming and not, so the
+ * whole agent stack can be benchmarked against a local, deterministic
+ * endpoint instead of a paid provider:
+ * - POST .../chat/completions  OpenAI Chat Completions
+ * - POST .../messages          Anthropic Messages
+ *
+ * Replies are made of generated words, one token each. Time to first
+ * token, token rate and reply length are options; errors can be injected
+ * with a given probability, as an HTTP status (with the provider's error
+ * body and Retry-After for 429) or as a stream cut off midway.
+ *
+ * A script turns replies into tool-call sequences. Steps are separated by
+ * blank lines; each step holds "tool <name> <json args>" lines (parallel
+ * calls) and/or one "text <reply>" line:
+ *
+ *     tool read_sensor {"zone":"living"}
+ *
+ *     tool set_valve {"zone":"living","open":true}
+ *     tool log_event {"msg":"valve opened"}
+ *
+ *     text Done: the living room valve is open.
+ *
+ * The step is picked by the number of assistant messages in the request,
+ * so the server keeps no conversation state and any number of clients can
+ * run the script at once. Past the last step replies are generated text.
+ * With -l only the assistant messages after the last user prompt count:
+ * every user turn of a long conversation replays the script.
+ *
+ * Connections are HTTP/1.1 keep-alive, one thread each; streams use
+ * chunked encoding so they keep the connection too.
+ *
+ * Usage:
+ *   mock_llm [options]
+ *
+ * Options:
+ *   -p <port>    Port to listen on (default 8089)
+ *   -b <addr>    Address to bind (default 127.0.0.1)
+ *   -t <ms>      Time to first token (default 0)
+ *   -r <tok/s>   Tokens per second after the first (default 0 = no delay)
+ *   -n <tokens>  Reply length in tokens (default 32)
+ *   -e <pct>     Percentage of requests answered with an error (default 0)
+ *   -E <status>  HTTP status of injected errors (default 500; 429 adds Retry-After)
+ *   -d <pct>     Percentage of streams cut off halfway (default 0)
+ *   -s <file>    Tool-call script
+ *   -S <seed>    Seed for error injection and generated text (default 1)
+ *   -v           Log every request
+ *   -h           Show help
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cJSON.h"
+
+#define MOCK_DEFAULT_PORT    8089
+#define MOCK_HEADER_MAX      (16 * 1024)
+#define MOCK_BODY_MAX        (64 * 1024 * 1024)
+#define MOCK_MAX_CALLS       16      /* Tool calls per script step */
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+
+typedef struct {
+    char *name;
+    char *args;                      /* JSON object text */
+} script_call_t;
+
+typedef struct {
+    char *text;                      /* NULL = none */
+    script_call_t calls[MOCK_MAX_CALLS];
+    int call_count;
+} script_step_t;
+
+static struct {
+    int port;
+    const char *bind_addr;
+    int ttft_ms;
+    int rate;
+    int tokens;
+    int error_pct;
+    int error_status;
+    int drop_pct;
+    unsigned seed;
+    int verbose;
+    int per_turn;
+    script_step_t *steps;
+    int step_count;
+} g_cfg = {
+    .port = MOCK_DEFAULT_PORT,
+    .bind_addr = "127.0.0.1",
+    .tokens = 32,
+    .error_status = 500,
+    .seed = 1,
+};
+
+static atomic_ulong g_requests;
+static atomic_ulong g_errors;
+
+/*============================================================================
+ * Usage and Help
+ *============================================================================*/
+
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [options]\n", prog_name);
+    printf("\n");
+    printf("Serves OpenAI chat completions and Anthropic messages (streaming or\n");
+    printf("not) with generated replies, for load and latency tests.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -p <port>    Port to listen on (default %d)\n", MOCK_DEFAULT_PORT);
+    printf("  -b <addr>    Address to bind (default 127.0.0.1)\n");
+    printf("  -t <ms>      Time to first token (default 0)\n");
+    printf("  -r <tok/s>   Tokens per second after the first (default 0 = no delay)\n");
+    printf("  -n <tokens>  Reply length in tokens (default 32, capped by max_tokens)\n");
+    printf("  -e <pct>     Percentage of requests answered with an error (default 0)\n");
+    printf("  -E <status>  HTTP status of injected errors (default 500; 429 adds Retry-After)\n");
+    printf("  -d <pct>     Percentage of streams cut off halfway (default 0)\n");
+    printf("  -s <file>    Tool-call script (see below)\n");
+    printf("  -l           Replay the script on every user turn\n");
+    printf("  -S <seed>    Seed for error injection and generated text (default 1)\n");
+    printf("  -v           Log every request\n");
+    printf("  -h           Show this help message\n");
+    printf("\n");
+    printf("Script: steps separated by blank lines, each with \"tool <name> <json>\"\n");
+    printf("lines and/or one \"text <reply>\" line. The request's assistant message\n");
+    printf("count picks the step; '#' starts a comment.\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("  %s -t 300 -r 50 -n 200 -e 2 -E 429\n", prog_name);
+    printf("  api_base = http://127.0.0.1:%d/v1\n", MOCK_DEFAULT_PORT);
+}
+
+/*============================================================================
+ * Script
+ *============================================================================*/
+
+static char *trim(char *s) {
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    size_t n = strlen(s);
+    while (n > 0 && (s[n - 1] == ' ' || s[n - 1] == '\t' || s[n - 1] == '\r' || s[n - 1] == '\n')) {
+        s[--n] = '\0';
+    }
+    return s;
+}
+
+static int script_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Error: cannot open %s\n", path);
+        return -1;
+    }
+
+    char line[8192];
+    int lineno = 0;
+    script_step_t *step = NULL;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *s = trim(line);
+        if (*s == '#') {
+            continue;
+        }
+        if (*s == '\0') {
+            step = NULL;
+            continue;
+        }
+        if (!step) {
+            script_step_t *steps = realloc(g_cfg.steps, (size_t)(g_cfg.step_count + 1) * sizeof(*steps));
+            if (!steps) {
+                fclose(f);
+                return -1;
+            }
+            g_cfg.steps = steps;
+            step = &g_cfg.steps[g_cfg.step_count++];
+            memset(step, 0, sizeof(*step));
+        }
+
+        if (strncmp(s, "text ", 5) == 0) {
+            step->text = strdup(trim(s + 5));
+        } else if (strncmp(s, "tool ", 5) == 0) {
+            char *name = trim(s + 5);
+            char *args = strpbrk(name, " \t");
+            if (args) {
+                *args++ = '\0';
+                args = trim(args);
+            }
+            cJSON *check = cJSON_Parse(args && *args ? args : "{}");
+            if (!cJSON_IsObject(check) || step->call_count == MOCK_MAX_CALLS) {
+                fprintf(stderr, "Error: %s:%d: bad tool call (arguments must be a JSON object)\n",
+                        path, lineno);
+                cJSON_Delete(check);
+                fclose(f);
+                return -1;
+            }
+            cJSON_Delete(check);
+            script_call_t *call = &step->calls[step->call_count++];
+            call->name = strdup(name);
+            call->args = strdup(args && *args ? args : "{}");
+        } else {
+            fprintf(stderr, "Error: %s:%d: expected \"tool ...\" or \"text ...\"\n", path, lineno);
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/*============================================================================
+ * Output Buffer
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} buf_t;
+
+static void buf_reserve(buf_t *b, size_t extra) {
+    if (b->len + extra + 1 <= b->cap) {
+        return;
+    }
+    size_t cap = b->cap ? b->cap : 1024;
+    while (cap < b->len + extra + 1) {
+        cap *= 2;
+    }
+    char *data = realloc(b->data, cap);
+    if (!data) {
+        abort();
+    }
+    b->data = data;
+    b->cap = cap;
+}
+
+static void buf_add(buf_t *b, const char *s, size_t n) {
+    buf_reserve(b, n);
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+}
+
+static void buf_printf(buf_t *b, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    va_list ap2;
+    va_copy(ap2, ap);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    buf_reserve(b, (size_t)n);
+    vsnprintf(b->data + b->len, (size_t)n + 1, fmt, ap2);
+    va_end(ap2);
+    b->len += (size_t)n;
+}
+
+static void buf_puts(buf_t *b, const char *s) {
+    buf_add(b, s, strlen(s));
+}
+
+/**
+ * @brief Append s as a JSON string literal (quotes included)
+ */
+static void buf_json_str(buf_t *b, const char *s) {
+    buf_puts(b, "\"");
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        switch (*p) {
+        case '"':  buf_puts(b, "\\\""); break;
+        case '\\': buf_puts(b, "\\\\"); break;
+        case '\n': buf_puts(b, "\\n"); break;
+        case '\r': buf_puts(b, "\\r"); break;
+        case '\t': buf_puts(b, "\\t"); break;
+        default:
+            if (*p < 0x20) {
+                buf_printf(b, "\\u%04x", *p);
+            } else {
+                buf_add(b, (const char *)p, 1);
+            }
+        }
+    }
+    buf_puts(b, "\"");
+}
+
+/*============================================================================
+ * Connection I/O
+ *============================================================================*/
+
+typedef struct {
+    int fd;
+    char *in;                        /* Bytes read and not consumed */
+    size_t in_len;
+    size_t in_cap;
+    int broken;                      /* A write failed: drop the connection */
+} conn_t;
+
+static void conn_write(conn_t *c, const char *data, size_t len) {
+    while (len > 0 && !c->broken) {
+        ssize_t n = send(c->fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            c->broken = 1;
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+/**
+ * @brief Send one chunk of a chunked body (len 0 ends it)
+ */
+static void conn_chunk(conn_t *c, const char *data, size_t len) {
+    char head[32];
+    int n = snprintf(head, sizeof(head), "%zx\r\n", len);
+    conn_write(c, head, (size_t)n);
+    conn_write(c, data, len);
+    conn_write(c, "\r\n", 2);
+}
+
+static int conn_fill(conn_t *c) {
+    if (c->in_cap - c->in_len < 4096) {
+        size_t cap = c->in_cap ? c->in_cap * 2 : 16384;
+        char *in = realloc(c->in, cap);
+        if (!in) {
+            return -1;
+        }
+        c->in = in;
+        c->in_cap = cap;
+    }
+    ssize_t n;
+    do {
+        n = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len - 1, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        return -1;
+    }
+    c->in_len += (size_t)n;
+    c->in[c->in_len] = '\0';
+    return 0;
+}
+
+typedef struct {
+    char method[8];
+    char path[256];
+    char *body;                      /* NUL-terminated, owned */
+    size_t body_len;
+    int keep_alive;
+} request_t;
+
+static const char *header_value(const char *head, const char *end, const char *name) {
+    size_t n = strlen(name);
+    for (const char *p = strstr(head, "\r\n"); p && p < end; p = strstr(p, "\r\n")) {
+        p += 2;
+        if (strncasecmp(p, name, n) == 0 && p[n] == ':') {
+            p += n + 1;
+            while (*p == ' ') {
+                p++;
+            }
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @return 0 with a request, -1 when the connection is done
+ */
+static int read_request(conn_t *c, request_t *req) {
+    char *end;
+    while (!(end = c->in_len ? strstr(c->in, "\r\n\r\n") : NULL)) {
+        if (c->in_len > MOCK_HEADER_MAX || conn_fill(c) != 0) {
+            return -1;
+        }
+    }
+    size_t head_len = (size_t)(end - c->in) + 4;
+
+    memset(req, 0, sizeof(*req));
+    if (sscanf(c->in, "%7s %255s", req->method, req->path) != 2) {
+        return -1;
+    }
+    const char *cl = header_value(c->in, end, "Content-Length");
+    size_t body_len = cl ? (size_t)strtoull(cl, NULL, 10) : 0;
+    if (body_len > MOCK_BODY_MAX) {
+        return -1;
+    }
+    const char *conn = header_value(c->in, end, "Connection");
+    req->keep_alive = !(conn && strncasecmp(conn, "close", 5) == 0) &&
+                      strstr(c->in, "HTTP/1.0\r\n") == NULL;
+
+    while (c->in_len < head_len + body_len) {
+        if (conn_fill(c) != 0) {
+            return -1;
+        }
+    }
+    req->body = malloc(body_len + 1);
+    if (!req->body) {
+        return -1;
+    }
+    memcpy(req->body, c->in + head_len, body_len);
+    req->body[body_len] = '\0';
+    req->body_len = body_len;
+
+    size_t used = head_len + body_len;
+    memmove(c->in, c->in + used, c->in_len - used);
+    c->in_len -= used;
+    c->in[c->in_len] = '\0';
+    return 0;
+}
+
+static void send_head(conn_t *c, int status, const char *type, const request_t *req,
+                      long content_length, const char *extra) {
+    const char *reason = status == 200 ? "OK" : status == 400 ? "Bad Request" :
+                         status == 404 ? "Not Found" : status == 429 ? "Too Many Requests" :
+                         status == 503 ? "Service Unavailable" : "Error";
+    char head[512];
+    int n;
+    if (content_length >= 0) {
+        n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %ld\r\n%s%s\r\n",
+                     status, reason, type, content_length,
+                     req->keep_alive ? "" : "Connection: close\r\n", extra ? extra : "");
+    } else {
+        n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\n"
+                     "Cache-Control: no-cache\r\n%s%s\r\n",
+                     status, reason, type,
+                     req->keep_alive ? "" : "Connection: close\r\n", extra ? extra : "");
+    }
+    conn_write(c, head, (size_t)n);
+}
+
+static void send_json(conn_t *c, const request_t *req, int status, const buf_t *body,
+                      const char *extra) {
+    send_head(c, status, "application/json", req, (long)body->len, extra);
+    conn_write(c, body->data, body->len);
+}
+
+/*============================================================================
+ * Reply Generation
+ *============================================================================*/
+
+static const char *const k_words[] = {
+    "the", "agent", "reads", "a", "sensor", "and", "reports", "back", "with", "its",
+    "value", "of", "21.5", "degrees", "so", "no", "action", "is", "needed", "now",
+    "but", "the", "valve", "stays", "open", "until", "noon", "tomorrow", "café", "über",
+};
+#define WORD_COUNT (sizeof(k_words) / sizeof(k_words[0]))
+
+/**
+ * @brief Token i of a generated reply (leading space after the first)
+ */
+static void reply_token(buf_t *out, unsigned seed, int i) {
+    const char *w = k_words[(seed + (unsigned)i * 7u) % WORD_COUNT];
+    if (i > 0) {
+        buf_puts(out, " ");
+    }
+    buf_add(out, w, strlen(w));
+}
+
+typedef struct {
+    int anthropic;
+    int stream;
+    int include_usage;               /* OpenAI stream_options.include_usage */
+    int prompt_tokens;               /* Rough: request bytes / 4 */
+    int max_tokens;                  /* Request's max_tokens (0 = none) */
+    const script_step_t *step;       /* NULL = generated text */
+    char model[128];
+    unsigned seed;                   /* Per request */
+    uint64_t id;
+} reply_t;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void sleep_until(uint64_t t) {
+    uint64_t now = now_us();
+    if (t > now) {
+        struct timespec ts = { (time_t)((t - now) / 1000000), (long)((t - now) % 1000000) * 1000 };
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+        }
+    }
+}
+
+/**
+ * @brief Pace token i: TTFT before the first, 1/rate after that
+ */
+static void pace(uint64_t start, int i) {
+    uint64_t t = start + (uint64_t)g_cfg.ttft_ms * 1000;
+    if (g_cfg.rate > 0 && i > 0) {
+        t += (uint64_t)i * 1000000 / (uint64_t)g_cfg.rate;
+    }
+    sleep_until(t);
+}
+
+/**
+ * @brief Tokens the reply has: script text, else generated words (at most
+ * the request's max_tokens)
+ */
+static int reply_text_tokens(const reply_t *r) {
+    if (r->step) {
+        if (!r->step->text) {
+            return 0;
+        }
+        int n = 1;
+        for (const char *p = r->step->text; *p; p++) {
+            n += *p == ' ';
+        }
+        return n;
+    }
+    return r->max_tokens > 0 && r->max_tokens < g_cfg.tokens ? r->max_tokens : g_cfg.tokens;
+}
+
+/**
+ * @brief Text of token i (script text is split at spaces)
+ */
+static void reply_text_token(const reply_t *r, buf_t *out, int i) {
+    if (!r->step) {
+        reply_token(out, r->seed, i);
+        return;
+    }
+    const char *p = r->step->text;
+    for (int k = 0; k < i; k++) {
+        p = strchr(p, ' ') + 1;
+    }
+    const char *e = strchr(p, ' ');
+    if (i > 0) {
+        buf_puts(out, " ");
+    }
+    buf_add(out, p, e ? (size_t)(e - p) : strlen(p));
+}
+
+static int reply_calls(const reply_t *r) {
+    return r->step ? r->step->call_count : 0;
+}
+
+/*============================================================================
+ * OpenAI Chat Completions
+ *============================================================================*/
+
+static void openai_complete(conn_t *c, const request_t *req, const reply_t *r) {
+    uint64_t start = now_us();
+    int n = reply_text_tokens(r);
+    pace(start, n > 0 ? n - 1 : 0);
+
+    buf_t text = { 0 };
+    for (int i = 0; i < n; i++) {
+        reply_text_token(r, &text, i);
+    }
+
+    buf_t b = { 0 };
+    buf_printf(&b, "{\"id\":\"chatcmpl-mock%llu\",\"object\":\"chat.completion\",\"created\":%ld,"
+               "\"model\":", (unsigned long long)r->id, (long)time(NULL));
+    buf_json_str(&b, r->model);
+    buf_puts(&b, ",\"choices\":[{\"index\":0,\"message\":{\"role\":\"assistant\",\"content\":");
+    if (n > 0) {
+        buf_json_str(&b, text.data);
+    } else {
+        buf_puts(&b, "null");
+    }
+    if (reply_calls(r) > 0) {
+        buf_puts(&b, ",\"tool_calls\":[");
+        for (int i = 0; i < reply_calls(r); i++) {
+            const script_call_t *call = &r->step->calls[i];
+            buf_printf(&b, "%s{\"id\":\"call_mock%llu_%d\",\"type\":\"function\",\"function\":{\"name\":",
+                       i ? "," : "", (unsigned long long)r->id, i);
+            buf_json_str(&b, call->name);
+            buf_puts(&b, ",\"arguments\":");
+            buf_json_str(&b, call->args);
+            buf_puts(&b, "}}");
+        }
+        buf_puts(&b, "]");
+    }
+    buf_printf(&b, "},\"finish_reason\":\"%s\"}],\"usage\":{\"prompt_tokens\":%d,"
+               "\"completion_tokens\":%d,\"total_tokens\":%d}}",
+               reply_calls(r) > 0 ? "tool_calls" : "stop", r->prompt_tokens, n,
+               r->prompt_tokens + n);
+
+    send_json(c, req, 200, &b, NULL);
+    free(text.data);
+    free(b.data);
+}
+
+static void openai_event(conn_t *c, const reply_t *r, buf_t *ev, const char *delta,
+                         const char *finish) {
+    ev->len = 0;
+    buf_printf(ev, "data: {\"id\":\"chatcmpl-mock%llu\",\"object\":\"chat.completion.chunk\","
+               "\"created\":%ld,\"model\":", (unsigned long long)r->id, (long)time(NULL));
+    buf_json_str(ev, r->model);
+    buf_printf(ev, ",\"choices\":[{\"index\":0,\"delta\":%s,\"finish_reason\":%s}]}\n\n",
+               delta, finish);
+    conn_chunk(c, ev->data, ev->len);
+}
+
+static void openai_stream(conn_t *c, const request_t *req, const reply_t *r, int drop) {
+    uint64_t start = now_us();
+    int n = reply_text_tokens(r);
+    int calls = reply_calls(r);
+    int total = n + calls;
+    int cut = drop ? total / 2 : -1;
+
+    send_head(c, 200, "text/event-stream", req, -1, NULL);
+    buf_t ev = { 0 };
+    buf_t delta = { 0 };
+    openai_event(c, r, &ev, "{\"role\":\"assistant\",\"content\":\"\"}", "null");
+
+    for (int i = 0; i < total && !c->broken; i++) {
+        pace(start, i);
+        if (i == cut) {
+            c->broken = 1;           /* Mid-stream disconnect */
+            break;
+        }
+        delta.len = 0;
+        if (i < n) {
+            buf_t tok = { 0 };
+            reply_text_token(r, &tok, i);
+            buf_puts(&delta, "{\"content\":");
+            buf_json_str(&delta, tok.data);
+            buf_puts(&delta, "}");
+            free(tok.data);
+        } else {
+            int k = i - n;
+            const script_call_t *call = &r->step->calls[k];
+            buf_printf(&delta, "{\"tool_calls\":[{\"index\":%d,\"id\":\"call_mock%llu_%d\","
+                       "\"type\":\"function\",\"function\":{\"name\":",
+                       k, (unsigned long long)r->id, k);
+            buf_json_str(&delta, call->name);
+            buf_puts(&delta, ",\"arguments\":");
+            buf_json_str(&delta, call->args);
+            buf_puts(&delta, "}}]}");
+        }
+        openai_event(c, r, &ev, delta.data, "null");
+    }
+
+    if (!c->broken) {
+        openai_event(c, r, &ev, "{}", calls > 0 ? "\"tool_calls\"" : "\"stop\"");
+        if (r->include_usage) {
+            ev.len = 0;
+            buf_printf(&ev, "data: {\"id\":\"chatcmpl-mock%llu\",\"object\":\"chat.completion.chunk\","
+                       "\"choices\":[],\"usage\":{\"prompt_tokens\":%d,\"completion_tokens\":%d,"
+                       "\"total_tokens\":%d}}\n\n",
+                       (unsigned long long)r->id, r->prompt_tokens, total, r->prompt_tokens + total);
+            conn_chunk(c, ev.data, ev.len);
+        }
+        conn_chunk(c, "data: [DONE]\n\n", 14);
+        conn_chunk(c, NULL, 0);
+    }
+    free(ev.data);
+    free(delta.data);
+}
+
+/*============================================================================
+ * Anthropic Messages
+ *============================================================================*/
+
+static void anthropic_complete(conn_t *c, const request_t *req, const reply_t *r) {
+    uint64_t start = now_us();
+    int n = reply_text_tokens(r);
+    pace(start, n > 0 ? n - 1 : 0);
+
+    buf_t b = { 0 };
+    buf_printf(&b, "{\"id\":\"msg_mock%llu\",\"type\":\"message\",\"role\":\"assistant\",\"model\":",
+               (unsigned long long)r->id);
+    buf_json_str(&b, r->model);
+    buf_puts(&b, ",\"content\":[");
+    int first = 1;
+    if (n > 0) {
+        buf_t text = { 0 };
+        for (int i = 0; i < n; i++) {
+            reply_text_token(r, &text, i);
+        }
+        buf_puts(&b, "{\"type\":\"text\",\"text\":");
+        buf_json_str(&b, text.data);
+        buf_puts(&b, "}");
+        free(text.data);
+        first = 0;
+    }
+    for (int i = 0; i < reply_calls(r); i++) {
+        const script_call_t *call = &r->step->calls[i];
+        buf_printf(&b, "%s{\"type\":\"tool_use\",\"id\":\"toolu_mock%llu_%d\",\"name\":",
+                   first ? "" : ",", (unsigned long long)r->id, i);
+        buf_json_str(&b, call->name);
+        buf_printf(&b, ",\"input\":%s}", call->args);
+        first = 0;
+    }
+    buf_printf(&b, "],\"stop_reason\":\"%s\",\"stop_sequence\":null,"
+               "\"usage\":{\"input_tokens\":%d,\"output_tokens\":%d}}",
+               reply_calls(r) > 0 ? "tool_use" : "end_turn", r->prompt_tokens, n);
+
+    send_json(c, req, 200, &b, NULL);
+    free(b.data);
+}
+
+static void anthropic_event(conn_t *c, buf_t *ev, const char *type, const char *data) {
+    ev->len = 0;
+    buf_printf(ev, "event: %s\ndata: %s\n\n", type, data);
+    conn_chunk(c, ev->data, ev->len);
+}
+
+static void anthropic_stream(conn_t *c, const request_t *req, const reply_t *r, int drop) {
+    uint64_t start = now_us();
+    int n = reply_text_tokens(r);
+    int calls = reply_calls(r);
+    int total = n + calls;
+    int cut = drop ? total / 2 : -1;
+
+    send_head(c, 200, "text/event-stream", req, -1, NULL);
+    buf_t ev = { 0 };
+    buf_t data = { 0 };
+
+    buf_printf(&data, "{\"type\":\"message_start\",\"message\":{\"id\":\"msg_mock%llu\","
+               "\"type\":\"message\",\"role\":\"assistant\",\"content\":[],\"model\":",
+               (unsigned long long)r->id);
+    buf_json_str(&data, r->model);
+    buf_printf(&data, ",\"stop_reason\":null,\"stop_sequence\":null,"
+               "\"usage\":{\"input_tokens\":%d,\"output_tokens\":1}}}", r->prompt_tokens);
+    anthropic_event(c, &ev, "message_start", data.data);
+
+    int block = 0;
+    for (int i = 0; i < total && !c->broken; i++) {
+        pace(start, i);
+        if (i == cut) {
+            c->broken = 1;           /* Mid-stream disconnect */
+            break;
+        }
+        if (i < n) {
+            if (i == 0) {
+                data.len = 0;
+                buf_printf(&data, "{\"type\":\"content_block_start\",\"index\":%d,"
+                           "\"content_block\":{\"type\":\"text\",\"text\":\"\"}}", block);
+                anthropic_event(c, &ev, "content_block_start", data.data);
+            }
+            buf_t tok = { 0 };
+            reply_text_token(r, &tok, i);
+            data.len = 0;
+            buf_printf(&data, "{\"type\":\"content_block_delta\",\"index\":%d,"
+                       "\"delta\":{\"type\":\"text_delta\",\"text\":", block);
+            buf_json_str(&data, tok.data);
+            buf_puts(&data, "}}");
+            free(tok.data);
+            anthropic_event(c, &ev, "content_block_delta", data.data);
+            if (i == n - 1) {
+                data.len = 0;
+                buf_printf(&data, "{\"type\":\"content_block_stop\",\"index\":%d}", block++);
+                anthropic_event(c, &ev, "content_block_stop", data.data);
+            }
+        } else {
+            int k = i - n;
+            const script_call_t *call = &r->step->calls[k];
+            data.len = 0;
+            buf_printf(&data, "{\"type\":\"content_block_start\",\"index\":%d,\"content_block\":"
+                       "{\"type\":\"tool_use\",\"id\":\"toolu_mock%llu_%d\",\"name\":",
+                       block, (unsigned long long)r->id, k);
+            buf_json_str(&data, call->name);
+            buf_puts(&data, ",\"input\":{}}}");
+            anthropic_event(c, &ev, "content_block_start", data.data);
+
+            data.len = 0;
+            buf_printf(&data, "{\"type\":\"content_block_delta\",\"index\":%d,"
+                       "\"delta\":{\"type\":\"input_json_delta\",\"partial_json\":", block);
+            buf_json_str(&data, call->args);
+            buf_puts(&data, "}}");
+            anthropic_event(c, &ev, "content_block_delta", data.data);
+
+            data.len = 0;
+            buf_printf(&data, "{\"type\":\"content_block_stop\",\"index\":%d}", block++);
+            anthropic_event(c, &ev, "content_block_stop", data.data);
+        }
+    }
+
+    if (!c->broken) {
+        data.len = 0;
+        buf_printf(&data, "{\"type\":\"message_delta\",\"delta\":{\"stop_reason\":\"%s\","
+                   "\"stop_sequence\":null},\"usage\":{\"output_tokens\":%d}}",
+                   calls > 0 ? "tool_use" : "end_turn", total);
+        anthropic_event(c, &ev, "message_delta", data.data);
+        anthropic_event(c, &ev, "message_stop", "{\"type\":\"message_stop\"}");
+        conn_chunk(c, NULL, 0);
+    }
+    free(ev.data);
+    free(data.data);
+}
+
+/*============================================================================
+ * Request Handling
+ *============================================================================*/
+
+static void send_error(conn_t *c, const request_t *req, int anthropic, int status,
+                       const char *message) {
+    buf_t b = { 0 };
+    const char *type = status == 429 ? "rate_limit_error" : status == 400 ? "invalid_request_error" :
+                       status == 404 ? "not_found_error" : "api_error";
+    if (anthropic) {
+        buf_printf(&b, "{\"type\":\"error\",\"error\":{\"type\":\"%s\",\"message\":", type);
+    } else {
+        buf_printf(&b, "{\"error\":{\"type\":\"%s\",\"code\":null,\"message\":", type);
+    }
+    buf_json_str(&b, message);
+    buf_puts(&b, "}}");
+    send_json(c, req, status, &b, status == 429 ? "Retry-After: 1\r\n" : NULL);
+    free(b.data);
+    atomic_fetch_add(&g_errors, 1);
+}
+
+static int ends_with(const char *s, const char *suffix) {
+    size_t n = strlen(s);
+    size_t m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+/**
+ * @brief Per-request pseudo-random draw in [0, 100)
+ */
+static int roll(unsigned *state) {
+    *state = *state * 1103515245u + 12345u;
+    return (int)((*state >> 16) % 100);
+}
+
+/**
+ * @brief A user message typed by the user, not tool results (Anthropic
+ *        sends those as user messages of tool_result blocks)
+ */
+static int is_user_prompt(const cJSON *msg) {
+    const cJSON *role = cJSON_GetObjectItem(msg, "role");
+    if (!cJSON_IsString(role) || strcmp(role->valuestring, "user") != 0) {
+        return 0;
+    }
+    const cJSON *block;
+    cJSON_ArrayForEach(block, cJSON_GetObjectItem(msg, "content")) {
+        const cJSON *type = cJSON_GetObjectItem(block, "type");
+        if (cJSON_IsString(type) && strcmp(type->valuestring, "tool_result") == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void handle(conn_t *c, request_t *req) {
+    uint64_t id = atomic_fetch_add(&g_requests, 1) + 1;
+
+    /* Query strings are ignored */
+    char *q = strchr(req->path, '?');
+    if (q) {
+        *q = '\0';
+    }
+    int anthropic = ends_with(req->path, "/messages");
+    if (strcmp(req->method, "POST") != 0 ||
+        (!anthropic && !ends_with(req->path, "/chat/completions"))) {
+        send_error(c, req, anthropic, 404, "Unknown endpoint");
+        return;
+    }
+
+    cJSON *body = cJSON_Parse(req->body);
+    if (!cJSON_IsObject(body)) {
+        cJSON_Delete(body);
+        send_error(c, req, anthropic, 400, "Request body is not a JSON object");
+        return;
+    }
+
+    reply_t r;
+    memset(&r, 0, sizeof(r));
+    r.anthropic = anthropic;
+    r.id = id;
+    r.seed = g_cfg.seed + (unsigned)id;
+    r.stream = cJSON_IsTrue(cJSON_GetObjectItem(body, "stream"));
+    r.include_usage = cJSON_IsTrue(cJSON_GetObjectItem(
+        cJSON_GetObjectItem(body, "stream_options"), "include_usage"));
+    r.prompt_tokens = (int)(req->body_len / 4) + 1;
+    const cJSON *max_tokens = cJSON_GetObjectItem(body, "max_tokens");
+    r.max_tokens = cJSON_IsNumber(max_tokens) ? max_tokens->valueint : 0;
+    const cJSON *model = cJSON_GetObjectItem(body, "model");
+    snprintf(r.model, sizeof(r.model), "%s", cJSON_IsString(model) ? model->valuestring : "mock");
+
+    /* Script step: one per assistant turn already in the conversation */
+    int turn = 0;
+    const cJSON *msg;
+    cJSON_ArrayForEach(msg, cJSON_GetObjectItem(body, "messages")) {
+        const cJSON *role = cJSON_GetObjectItem(msg, "role");
+        if (g_cfg.per_turn && is_user_prompt(msg)) {
+            turn = 0;
+        }
+        turn += cJSON_IsString(role) && strcmp(role->valuestring, "assistant") == 0;
+    }
+    if (turn < g_cfg.step_count) {
+        r.step = &g_cfg.steps[turn];
+    }
+    cJSON_Delete(body);
+
+    unsigned state = r.seed * 2654435761u;
+    int fail = g_cfg.error_pct > 0 && roll(&state) < g_cfg.error_pct;
+    int drop = !fail && r.stream && g_cfg.drop_pct > 0 && roll(&state) < g_cfg.drop_pct;
+
+    if (g_cfg.verbose) {
+        fprintf(stderr, "#%llu %s %s%s turn=%d%s%s\n", (unsigned long long)id, req->method,
+                req->path, r.stream ? " stream" : "", turn,
+                fail ? " error" : "", drop ? " drop" : "");
+    }
+
+    if (fail) {
+        sleep_until(now_us() + (uint64_t)g_cfg.ttft_ms * 1000);
+        send_error(c, req, anthropic, g_cfg.error_status, "Injected error");
+    } else if (anthropic) {
+        r.stream ? anthropic_stream(c, req, &r, drop) : anthropic_complete(c, req, &r);
+    } else {
+        r.stream ? openai_stream(c, req, &r, drop) : openai_complete(c, req, &r);
+    }
+    if (drop) {
+        atomic_fetch_add(&g_errors, 1);
+    }
+}
+
+static void *conn_thread(void *arg) {
+    conn_t c;
+    memset(&c, 0, sizeof(c));
+    c.fd = (int)(intptr_t)arg;
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    request_t req;
+    while (!c.broken && read_request(&c, &req) == 0) {
+        handle(&c, &req);
+        free(req.body);
+        if (!req.keep_alive) {
+            break;
+        }
+    }
+    close(c.fd);
+    free(c.in);
+    return NULL;
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+static void on_signal(int sig) {
+    (void)sig;
+    char line[96];
+    int n = snprintf(line, sizeof(line), "\nmock_llm: %lu requests, %lu errors or drops injected\n",
+                     atomic_load(&g_requests), atomic_load(&g_errors));
+    if (write(STDERR_FILENO, line, (size_t)n) < 0) {
+        /* Exiting anyway */
+    }
+    _exit(0);
+}
+
+int main(int argc, char *argv[]) {
+    const char *script = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:b:t:r:n:e:E:d:s:lS:vh")) != -1) {
+        switch (opt) {
+        case 'p': g_cfg.port = atoi(optarg); break;
+        case 'b': g_cfg.bind_addr = optarg; break;
+        case 't': g_cfg.ttft_ms = atoi(optarg); break;
+        case 'r': g_cfg.rate = atoi(optarg); break;
+        case 'n': g_cfg.tokens = atoi(optarg); break;
+        case 'e': g_cfg.error_pct = atoi(optarg); break;
+        case 'E': g_cfg.error_status = atoi(optarg); break;
+        case 'd': g_cfg.drop_pct = atoi(optarg); break;
+        case 's': script = optarg; break;
+        case 'l': g_cfg.per_turn = 1; break;
+        case 'S': g_cfg.seed = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'v': g_cfg.verbose = 1; break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (g_cfg.tokens < 0 || g_cfg.ttft_ms < 0 || g_cfg.rate < 0 ||
+        g_cfg.error_status < 400 || g_cfg.error_status > 599) {
+        fprintf(stderr, "Error: invalid option value\n");
+        return 1;
+    }
+    if (script && script_load(script) != 0) {
+        return 1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)g_cfg.port);
+    if (inet_pton(AF_INET, g_cfg.bind_addr, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Error: bad address %s\n", g_cfg.bind_addr);
+        return 1;
+    }
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 1024) != 0) {
+        fprintf(stderr, "Error: cannot listen on %s:%d: %s\n", g_cfg.bind_addr, g_cfg.port,
+                strerror(errno));
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "mock_llm: listening on http://%s:%d (ttft %d ms, %d tok/s, %d tokens, "
+            "%d%% errors, %d step script)\n", g_cfg.bind_addr, g_cfg.port, g_cfg.ttft_ms,
+            g_cfg.rate, g_cfg.tokens, g_cfg.error_pct, g_cfg.step_count);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, 256 * 1024);
+
+    for (;;) {
+        int cfd = accept(fd, NULL, NULL);
+        if (cfd < 0) {
+            if (errno == EMFILE || errno == ENFILE) {
+                sleep_until(now_us() + 10000);      /* Let connections close */
+                continue;
+            }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            fprintf(stderr, "Error: accept: %s\n", strerror(errno));
+            return 1;
+        }
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, conn_thread, (void *)(intptr_t)cfd) != 0) {
+            close(cfd);
+        }
+    }
+}
@@ -0,0 +1,161 @@
+/**
+ * @file main.c
+ * @brief trace_convert - Render binary trace files as JSON
+ *
+ * Reads a file written by the binary trace exporter and writes either
+ * the JSON exporter's layout (one file per run) or the Chrome trace
+ * exporter's timeline (chrome://tracing, ui.perfetto.dev) with every run
+ * in one file.
+ *
+ * Usage:
+ *   trace_convert [options] <trace.arct>
+ *
+ * Options:
+ *   -f json|chrome  Output format (default: json)
+ *   -o <path>       json: output directory (default: logs)
+ *                   chrome: output file (default: stdout)
+ *   -c              json: compact instead of pretty-printed
+ *   -h              Show help
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "arc/trace.h"
+#include "arc/trace_exporters.h"
+
+/*============================================================================
+ * Usage and Help
+ *============================================================================*/
+
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [options] <trace.arct>\n", prog_name);
+    printf("\n");
+    printf("Renders a binary ArC trace file as JSON.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -f json|chrome  Output format (default: json)\n");
+    printf("                  json:   the JSON exporter's layout, one file per run\n");
+    printf("                  chrome: Chrome trace event JSON, all runs in one file\n");
+    printf("  -o <path>       json: output directory (default: %s)\n", AC_TRACE_JSON_DEFAULT_DIR);
+    printf("                  chrome: output file (default: stdout)\n");
+    printf("  -c              json: compact instead of pretty-printed\n");
+    printf("  -h              Show this help message\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("  %s -f chrome -o run.json logs/trace_20260129_143052_4242.arct\n", prog_name);
+}
+
+/*============================================================================
+ * JSON Exporter Layout
+ *============================================================================*/
+
+static void json_replay_handler(const ac_trace_event_t *event, void *user_data) {
+    int *runs = (int *)user_data;
+
+    ac_trace_json_exporter_write(event);
+    if (event->type == AC_TRACE_AGENT_START) {
+        (*runs)++;
+        fprintf(stderr, "%s\n", ac_trace_json_exporter_get_path());
+    }
+}
+
+/*============================================================================
+ * Chrome Trace Events
+ *============================================================================*/
+
+static void chrome_replay_handler(const ac_trace_event_t *event, void *user_data) {
+    (void)user_data;
+    ac_trace_chrome_exporter_write(event);
+}
+
+static int convert_chrome(const char *input, const char *output) {
+    ac_trace_chrome_config_t config = {
+        .path = output ? output : "-",
+        .async_queue = 0,
+    };
+    if (ac_trace_chrome_exporter_init(&config) != 0) {
+        return 1;
+    }
+
+    arc_err_t err = ac_trace_binary_replay(input, chrome_replay_handler, NULL);
+    ac_trace_chrome_exporter_cleanup();
+
+    if (err != ARC_OK) {
+        fprintf(stderr, "Error: cannot read %s (%d)\n", input, (int)err);
+        return 1;
+    }
+    return 0;
+}
+
+static int convert_json(const char *input, const char *output_dir, int pretty) {
+    ac_trace_json_config_t config = {
+        .output_dir = output_dir ? output_dir : AC_TRACE_JSON_DEFAULT_DIR,
+        .pretty_print = pretty,
+        .include_timestamps = 1,
+        .async_queue = 0,
+    };
+    if (ac_trace_json_exporter_init(&config) != 0) {
+        return 1;
+    }
+
+    int runs = 0;
+    arc_err_t err = ac_trace_binary_replay(input, json_replay_handler, &runs);
+    ac_trace_json_exporter_cleanup();
+
+    if (err != ARC_OK) {
+        fprintf(stderr, "Error: cannot read %s (%d)\n", input, (int)err);
+        return 1;
+    }
+    fprintf(stderr, "%d run%s converted\n", runs, runs == 1 ? "" : "s");
+    return 0;
+}
+
+/*============================================================================
+ * Main Entry Point
+ *============================================================================*/
+
+int main(int argc, char *argv[]) {
+    const char *format = "json";
+    const char *output = NULL;
+    int pretty = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:o:ch")) != -1) {
+        switch (opt) {
+            case 'f':
+                format = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'c':
+                pretty = 0;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "Error: No input file specified\n\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(format, "chrome") == 0) {
+        return convert_chrome(argv[optind], output);
+    }
+    if (strcmp(format, "json") == 0) {
+        return convert_json(argv[optind], output, pretty);
+    }
+
+    fprintf(stderr, "Error: Unknown format '%s'\n", format);
+    return 1;
+}